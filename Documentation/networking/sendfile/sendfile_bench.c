@@ -0,0 +1,317 @@
+/*
+ * sendfile_bench.c
+ *
+ * Serve a file over TCP with either sendfile() or a read()/write() loop and
+ * report throughput together with the CPU time it cost, both for the
+ * serving process and for the whole system (the latter includes softirq
+ * work such as the software checksum pass and the driver's TX completion).
+ *
+ * Run the server on the target, next to the file system under test:
+ *
+ *	sendfile_bench -s [-m sendfile|rw] [-b bufsize] [-p port] <file>
+ *
+ * and drain it from a peer, optionally in a loop:
+ *
+ *	sendfile_bench -c <host> [-p port] [-n count]
+ *
+ * Each request served prints one line on the server:
+ *
+ *	mode=sendfile bytes=.. secs=.. MB/s=.. proc_cpu=..% sys_cpu=..%
+ *
+ * proc_cpu is user+system time of the server over wall time; sys_cpu is
+ * the busy share of all CPUs from /proc/stat over the same interval.
+ * Drop the page cache between runs ("echo 3 > /proc/sys/vm/drop_caches")
+ * to include the MMC/NAND read cost, or leave it warm to look at the
+ * network path alone.
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+enum { MODE_SENDFILE, MODE_RW };
+
+static void bail(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: sendfile_bench -s [-m sendfile|rw] [-b bufsize] [-p port] <file>\n"
+		"       sendfile_bench -c <host> [-p port] [-n count]\n");
+	exit(1);
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double rusage_secs(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+	       ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+/* total and busy jiffies summed over all CPUs */
+static void cpu_jiffies(unsigned long long *total, unsigned long long *busy)
+{
+	unsigned long long v[8] = { 0 };
+	FILE *f;
+	int i;
+
+	*total = *busy = 0;
+	f = fopen("/proc/stat", "r");
+	if (!f)
+		return;
+	if (fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+		   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) >= 4) {
+		for (i = 0; i < 8; i++)
+			*total += v[i];
+		/* idle and iowait are the only non-busy columns */
+		*busy = *total - v[3] - v[4];
+	}
+	fclose(f);
+}
+
+static long long serve_sendfile(int sock, int fd, off_t size)
+{
+	off_t off = 0;
+	ssize_t n;
+
+	while (off < size) {
+		n = sendfile(sock, fd, &off, size - off);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("sendfile");
+			break;
+		}
+		if (n == 0)
+			break;
+	}
+	return off;
+}
+
+static long long serve_rw(int sock, int fd, char *buf, size_t bufsize)
+{
+	long long total = 0;
+	ssize_t n, w, done;
+
+	while ((n = read(fd, buf, bufsize)) > 0) {
+		for (done = 0; done < n; done += w) {
+			w = write(sock, buf + done, n - done);
+			if (w < 0) {
+				if (errno == EINTR) {
+					w = 0;
+					continue;
+				}
+				perror("write");
+				return total + done;
+			}
+		}
+		total += n;
+	}
+	if (n < 0)
+		perror("read");
+	return total;
+}
+
+static void server(const char *path, int port, int mode, size_t bufsize)
+{
+	struct sockaddr_in addr;
+	char *buf = NULL;
+	int lsock, one = 1;
+
+	if (mode == MODE_RW) {
+		buf = malloc(bufsize);
+		if (!buf)
+			bail("malloc");
+	}
+
+	lsock = socket(AF_INET, SOCK_STREAM, 0);
+	if (lsock < 0)
+		bail("socket");
+	setsockopt(lsock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if (bind(lsock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+		bail("bind");
+	if (listen(lsock, 4) < 0)
+		bail("listen");
+
+	for (;;) {
+		unsigned long long t0, b0, t1, b1;
+		double w0, c0, wall, cpu;
+		long long bytes;
+		struct stat st;
+		int sock, fd;
+
+		sock = accept(lsock, NULL, NULL);
+		if (sock < 0) {
+			if (errno == EINTR)
+				continue;
+			bail("accept");
+		}
+
+		/* open per request, like a file server would */
+		fd = open(path, O_RDONLY);
+		if (fd < 0 || fstat(fd, &st) < 0)
+			bail(path);
+
+		cpu_jiffies(&t0, &b0);
+		c0 = rusage_secs();
+		w0 = now();
+
+		if (mode == MODE_SENDFILE)
+			bytes = serve_sendfile(sock, fd, st.st_size);
+		else
+			bytes = serve_rw(sock, fd, buf, bufsize);
+
+		/* make sure everything has left the box before stopping */
+		shutdown(sock, SHUT_WR);
+		while (read(sock, &one, sizeof(one)) > 0)
+			;
+
+		wall = now() - w0;
+		cpu = rusage_secs() - c0;
+		cpu_jiffies(&t1, &b1);
+
+		printf("mode=%s bytes=%lld secs=%.3f MB/s=%.2f "
+		       "proc_cpu=%.1f%% sys_cpu=%.1f%%\n",
+		       mode == MODE_SENDFILE ? "sendfile" : "rw", bytes, wall,
+		       wall > 0 ? bytes / wall / 1e6 : 0.0,
+		       wall > 0 ? 100.0 * cpu / wall : 0.0,
+		       t1 > t0 ? 100.0 * (b1 - b0) / (t1 - t0) : 0.0);
+		fflush(stdout);
+
+		close(fd);
+		close(sock);
+	}
+}
+
+static void client(const char *host, int port, int count)
+{
+	static char buf[65536];
+	struct addrinfo hints, *res;
+	char service[16];
+	int i;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	snprintf(service, sizeof(service), "%d", port);
+	if (getaddrinfo(host, service, &hints, &res)) {
+		fprintf(stderr, "cannot resolve %s\n", host);
+		exit(1);
+	}
+
+	for (i = 0; i < count; i++) {
+		long long bytes = 0;
+		double w0;
+		ssize_t n;
+		int sock;
+
+		sock = socket(AF_INET, SOCK_STREAM, 0);
+		if (sock < 0)
+			bail("socket");
+		if (connect(sock, res->ai_addr, res->ai_addrlen) < 0)
+			bail("connect");
+
+		w0 = now();
+		while ((n = read(sock, buf, sizeof(buf))) > 0)
+			bytes += n;
+		if (n < 0)
+			bail("read");
+		printf("bytes=%lld MB/s=%.2f\n", bytes,
+		       bytes / (now() - w0) / 1e6);
+		close(sock);
+	}
+	freeaddrinfo(res);
+}
+
+int main(int argc, char **argv)
+{
+	const char *host = NULL;
+	size_t bufsize = 65536;
+	int mode = MODE_SENDFILE;
+	int port = 8089, count = 1, is_server = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "sc:m:b:p:n:")) != -1) {
+		switch (c) {
+		case 's':
+			is_server = 1;
+			break;
+		case 'c':
+			host = optarg;
+			break;
+		case 'm':
+			if (!strcmp(optarg, "sendfile"))
+				mode = MODE_SENDFILE;
+			else if (!strcmp(optarg, "rw"))
+				mode = MODE_RW;
+			else
+				usage();
+			break;
+		case 'b':
+			bufsize = strtoul(optarg, NULL, 0);
+			if (!bufsize)
+				usage();
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (is_server == !!host)
+		usage();
+	if (is_server) {
+		if (optind != argc - 1)
+			usage();
+		server(argv[optind], port, mode, bufsize);
+	} else {
+		client(host, port, count);
+	}
+	return 0;
+}
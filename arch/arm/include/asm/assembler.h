@@ -63,8 +63,12 @@
  * is used).
  *
  * On Feroceon there is much to gain however, regardless of cache mode.
+ *
+ * The same holds for the ARM926 on DaVinci: an aligned STM of eight words
+ * is a whole line, which its write buffer drains as one address entry and
+ * the DDR controller sees as one full burst, instead of two partial ones.
  */
-#ifdef CONFIG_CPU_FEROCEON
+#if defined(CONFIG_CPU_FEROCEON) || defined(CONFIG_CPU_ARM926T)
 #define CALGN(code...) code
 #else
 #define CALGN(code...)
@@ -0,0 +1,31 @@
+/*
+ * ARM926 cache lockdown
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASMARM_CACHELOCK_H
+#define __ASMARM_CACHELOCK_H
+
+#include <linux/compiler.h>
+
+/*
+ * With CPU_ARM926_CACHE_LOCKDOWN, built-in functions and variables tagged
+ * below are gathered into one contiguous range each and pinned into way 0
+ * of the I and D caches at boot, so no amount of other activity evicts
+ * them.  Each range must fit in one cache way (4K on a 16K cache).
+ * Locked data must not be a DMA buffer.  Without the option the tags do
+ * nothing.
+ */
+#ifdef CONFIG_CPU_ARM926_CACHE_LOCKDOWN
+#define __cachelock_text	__section(.cachelock.text)
+#define __cachelock_data	__section(.cachelock.data)
+#else
+#define __cachelock_text
+#define __cachelock_data
+#endif
+
+#endif
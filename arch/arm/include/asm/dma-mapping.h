@@ -70,6 +70,20 @@ extern void dma_cache_maint(const void *kaddr, size_t size, int rw);
 extern void dma_cache_maint_page(struct page *page, unsigned long offset,
 				 size_t size, int rw);
 
+/*
+ * Ranges of at least this many bytes are cleaned and/or invalidated by
+ * walking the whole D cache, on CPUs whose cache code supports that.
+ */
+extern u32 dma_cache_whole_limit;
+
+#ifdef CONFIG_DMA_CACHE_STATS
+extern void dma_cache_account(struct device *dev, size_t size, int rw);
+#else
+static inline void dma_cache_account(struct device *dev, size_t size, int rw)
+{
+}
+#endif
+
 /*
  * Return whether the given device DMA address mask can be supported
  * properly.  For example, if your device can only drive the low 24-bits
@@ -304,8 +318,10 @@ static inline dma_addr_t dma_map_single(struct device *dev, void *cpu_addr,
 {
 	BUG_ON(!valid_dma_direction(dir));
 
-	if (!arch_is_coherent())
+	if (!arch_is_coherent()) {
+		dma_cache_account(dev, size, dir);
 		dma_cache_maint(cpu_addr, size, dir);
+	}
 
 	return virt_to_dma(dev, cpu_addr);
 }
@@ -329,8 +345,10 @@ static inline dma_addr_t dma_map_page(struct device *dev, struct page *page,
 {
 	BUG_ON(!valid_dma_direction(dir));
 
-	if (!arch_is_coherent())
+	if (!arch_is_coherent()) {
+		dma_cache_account(dev, size, dir);
 		dma_cache_maint_page(page, offset, size, dir);
+	}
 
 	return page_to_dma(dev, page) + offset;
 }
@@ -412,8 +430,10 @@ static inline void dma_sync_single_range_for_device(struct device *dev,
 	if (!dmabounce_sync_for_device(dev, handle, offset, size, dir))
 		return;
 
-	if (!arch_is_coherent())
+	if (!arch_is_coherent()) {
+		dma_cache_account(dev, size, dir);
 		dma_cache_maint(dma_to_virt(dev, handle) + offset, size, dir);
+	}
 }
 
 static inline void dma_sync_single_for_cpu(struct device *dev,
@@ -12,6 +12,7 @@
  */
 #include <linux/sched.h>
 #include <linux/mm.h>
+#include <linux/suspend.h>
 #include <asm/mach/arch.h>
 #include <asm/thread_info.h>
 #include <asm/memory.h>
@@ -93,6 +94,12 @@ int main(void)
   BLANK();
   DEFINE(PAGE_SZ,	       	PAGE_SIZE);
   BLANK();
+#ifdef CONFIG_HIBERNATION
+  DEFINE(PBE_ADDRESS,		offsetof(struct pbe, address));
+  DEFINE(PBE_ORIG_ADDRESS,	offsetof(struct pbe, orig_address));
+  DEFINE(PBE_NEXT,		offsetof(struct pbe, next));
+  BLANK();
+#endif
   DEFINE(SYS_ERROR0,		0x9f0000);
   BLANK();
   DEFINE(SIZEOF_MACHINE_DESC,	sizeof(struct machine_desc));
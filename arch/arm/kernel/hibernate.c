@@ -0,0 +1,38 @@
+/*
+ * Hibernation support for ARM
+ *
+ * The register and MMU state is saved and reloaded in swsusp.S; the
+ * save area below lives in ordinary data so that it is part of the image
+ * and comes back with it.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/mm.h>
+#include <linux/suspend.h>
+#include <asm/cacheflush.h>
+#include <asm/tlbflush.h>
+
+extern char __nosave_begin[], __nosave_end[];
+
+/* cpsr, TTB, DACR, FCSE PID, r4 - r11, sp, lr */
+unsigned long swsusp_arch_regs[14];
+
+int pfn_is_nosave(unsigned long pfn)
+{
+	unsigned long begin_pfn = __pa(__nosave_begin) >> PAGE_SHIFT;
+	unsigned long end_pfn = PAGE_ALIGN(__pa(__nosave_end)) >> PAGE_SHIFT;
+
+	return (pfn >= begin_pfn) && (pfn < end_pfn);
+}
+
+void save_processor_state(void)
+{
+}
+
+void restore_processor_state(void)
+{
+	flush_cache_all();
+	local_flush_tlb_all();
+}
@@ -13,9 +13,39 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/module.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/rwsem.h>
+#include <linux/cpufreq.h>
+
+#include <asm/div64.h>
 
 #include <mach/aemif.h>
 
+/*
+ * Chip selects whose timings came through davinci_aemif_setup_timing().
+ * They are recomputed for the AEMIF clock of every cpufreq transition,
+ * so boards can give the datasheet timings instead of ones padded to
+ * hold at all operating points.
+ */
+struct aemif_cs {
+	struct list_head		list;
+	void __iomem			*base;
+	unsigned			cs;
+	bool				has_timing;
+	struct davinci_aemif_timing	timing;
+	unsigned			page_words;	/* 0: no page mode */
+	unsigned			page_delay;	/* ns */
+};
+
+static LIST_HEAD(aemif_cs_list);
+static DEFINE_MUTEX(aemif_cs_mutex);
+static struct clk *aemif_clk;
+
+/* held for reading across accesses that must not see a timing change */
+static DECLARE_RWSEM(aemif_timing_sem);
+
 /* timing calculations */
 
 #define NS_IN_KHZ 1000000
@@ -48,25 +78,13 @@ static int aemif_calc_rate(int wanted, unsigned long clk, int max)
 	return result;
 }
 
-int davinci_aemif_setup_timing(struct davinci_aemif_timing *t,
-					void __iomem *base, unsigned cs)
+static int aemif_program(struct davinci_aemif_timing *t,
+				void __iomem *base, unsigned cs,
+				unsigned long clkrate)
 {
-	unsigned set, val;
-	unsigned ta, rhold, rstrobe, rsetup, whold, wstrobe, wsetup;
+	int ta, rhold, rstrobe, rsetup, whold, wstrobe, wsetup;
 	unsigned offset = A1CR_OFFSET + cs * 4;
-	struct clk *aemif_clk;
-	unsigned long clkrate;
-
-	if (!t)
-		return 0;	/* Nothing to do */
-
-	aemif_clk = clk_get(NULL, "aemif");
-	if (IS_ERR(aemif_clk))
-		return PTR_ERR(aemif_clk);
-
-	clkrate = clk_get_rate(aemif_clk);
-
-	clkrate /= 1000;	/* turn clock into kHz for ease of use */
+	unsigned set, val;
 
 	ta	= aemif_calc_rate(t->ta, clkrate, TA_MAX);
 	rhold	= aemif_calc_rate(t->rhold, clkrate, RHOLD_MAX);
@@ -97,4 +115,254 @@ int davinci_aemif_setup_timing(struct davinci_aemif_timing *t,
 
 	return 0;
 }
+
+static int aemif_program_page(struct aemif_cs *c, unsigned long clkrate)
+{
+	unsigned shift = c->cs * 8;
+	unsigned set, val;
+	int delay;
+
+	delay = aemif_calc_rate(c->page_delay, clkrate, PMCR_PG_DEL_MAX);
+	if (delay < 0)
+		return delay;
+
+	set = PMCR_PG_MD_EN | PMCR_PG_DEL(delay);
+	if (c->page_words == 8)
+		set |= PMCR_PG_SIZE_8;
+
+	val = __raw_readl(c->base + PMCR_OFFSET);
+	val &= ~(PMCR_CS_MASK << shift);
+	val |= set << shift;
+	__raw_writel(val, c->base + PMCR_OFFSET);
+
+	return 0;
+}
+
+static void aemif_cs_program(struct aemif_cs *c, unsigned long clkrate)
+{
+	if (c->has_timing)
+		aemif_program(&c->timing, c->base, c->cs, clkrate);
+	if (c->page_words)
+		aemif_program_page(c, clkrate);
+}
+
+#ifdef CONFIG_CPU_FREQ
+static int aemif_cpufreq_transition(struct notifier_block *nb,
+				    unsigned long val, void *data)
+{
+	struct cpufreq_freqs *freqs = data;
+	struct aemif_cs *c;
+	unsigned long rate;
+	u64 tmp;
+
+	if (val == CPUFREQ_PRECHANGE ? freqs->new <= freqs->old :
+			val != CPUFREQ_POSTCHANGE)
+		return NOTIFY_OK;
+
+	mutex_lock(&aemif_cs_mutex);
+	down_write(&aemif_timing_sem);
+
+	rate = clk_get_rate(aemif_clk) / 1000;
+	if (val == CPUFREQ_PRECHANGE) {
+		/*
+		 * The AEMIF clock may follow the CPU up until the transition
+		 * settles; timings for the faster clock hold at both.
+		 */
+		tmp = (u64)rate * freqs->new;
+		do_div(tmp, freqs->old);
+		rate = tmp;
+	}
+
+	list_for_each_entry(c, &aemif_cs_list, list)
+		aemif_cs_program(c, rate);
+
+	up_write(&aemif_timing_sem);
+	mutex_unlock(&aemif_cs_mutex);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block aemif_cpufreq_nb = {
+	.notifier_call	= aemif_cpufreq_transition,
+};
+
+static void aemif_cpufreq_register(void)
+{
+	if (cpufreq_register_notifier(&aemif_cpufreq_nb,
+				      CPUFREQ_TRANSITION_NOTIFIER))
+		pr_warning("%s: timings will not follow cpufreq\n", __func__);
+}
+#else
+static inline void aemif_cpufreq_register(void) {}
+#endif
+
+/* Caller holds aemif_cs_mutex; returns the AEMIF clock rate in kHz. */
+static long aemif_clk_rate(void)
+{
+	if (!aemif_clk) {
+		struct clk *clk = clk_get(NULL, "aemif");
+
+		if (IS_ERR(clk))
+			return PTR_ERR(clk);
+		aemif_clk = clk;
+		aemif_cpufreq_register();
+	}
+
+	return clk_get_rate(aemif_clk) / 1000;
+}
+
+/* Caller holds aemif_cs_mutex. */
+static struct aemif_cs *aemif_cs_get(void __iomem *base, unsigned cs)
+{
+	struct aemif_cs *c;
+
+	list_for_each_entry(c, &aemif_cs_list, list)
+		if (c->base == base && c->cs == cs)
+			return c;
+
+	c = kzalloc(sizeof(*c), GFP_KERNEL);
+	if (c) {
+		c->base = base;
+		c->cs = cs;
+		list_add_tail(&c->list, &aemif_cs_list);
+	}
+	return c;
+}
+
+/**
+ * davinci_aemif_setup_timing - program and track a chip select's timings
+ * @t: timings in nanoseconds, may be NULL to keep the current ones
+ * @base: AEMIF control registers
+ * @cs: chip select, 0 for CS2
+ *
+ * The timings are kept and reprogrammed whenever the AEMIF clock changes,
+ * until davinci_aemif_release_timing() is called for the chip select.
+ */
+int davinci_aemif_setup_timing(struct davinci_aemif_timing *t,
+					void __iomem *base, unsigned cs)
+{
+	struct aemif_cs *c;
+	long rate;
+	int ret;
+
+	if (!t)
+		return 0;	/* Nothing to do */
+
+	mutex_lock(&aemif_cs_mutex);
+
+	rate = aemif_clk_rate();
+	if (rate < 0) {
+		ret = rate;
+		goto out;
+	}
+
+	ret = aemif_program(t, base, cs, rate);
+	if (ret)
+		goto out;
+
+	c = aemif_cs_get(base, cs);
+	if (!c) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	c->timing = *t;
+	c->has_timing = true;
+out:
+	mutex_unlock(&aemif_cs_mutex);
+	return ret;
+}
 EXPORT_SYMBOL(davinci_aemif_setup_timing);
+
+/**
+ * davinci_aemif_setup_page_mode - enable NOR page mode reads
+ * @base: AEMIF control registers
+ * @cs: chip select, 0 for CS2
+ * @words: page size of the flash in bus words, 4 or 8; 0 disables
+ * @delay: page access time of the flash in nanoseconds
+ *
+ * Like the strobe timings, the page delay is tracked until
+ * davinci_aemif_release_timing() and follows the AEMIF clock.
+ */
+int davinci_aemif_setup_page_mode(void __iomem *base, unsigned cs,
+					unsigned words, unsigned delay)
+{
+	struct aemif_cs *c;
+	long rate;
+	int ret;
+
+	if (words && words != 4 && words != 8)
+		return -EINVAL;
+
+	mutex_lock(&aemif_cs_mutex);
+
+	rate = aemif_clk_rate();
+	if (rate < 0) {
+		ret = rate;
+		goto out;
+	}
+
+	c = aemif_cs_get(base, cs);
+	if (!c) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (!words) {
+		__raw_writel(__raw_readl(base + PMCR_OFFSET) &
+				~(PMCR_CS_MASK << (cs * 8)), base + PMCR_OFFSET);
+		c->page_words = 0;
+		ret = 0;
+		goto out;
+	}
+
+	c->page_words = words;
+	c->page_delay = delay;
+	ret = aemif_program_page(c, rate);
+	if (ret)
+		c->page_words = 0;
+out:
+	mutex_unlock(&aemif_cs_mutex);
+	return ret;
+}
+EXPORT_SYMBOL(davinci_aemif_setup_page_mode);
+
+/**
+ * davinci_aemif_release_timing - stop tracking a chip select
+ * @base: AEMIF control registers, as passed to davinci_aemif_setup_timing()
+ * @cs: chip select
+ *
+ * Must be called before @base is unmapped.
+ */
+void davinci_aemif_release_timing(void __iomem *base, unsigned cs)
+{
+	struct aemif_cs *c;
+
+	mutex_lock(&aemif_cs_mutex);
+	list_for_each_entry(c, &aemif_cs_list, list) {
+		if (c->base == base && c->cs == cs) {
+			list_del(&c->list);
+			kfree(c);
+			break;
+		}
+	}
+	mutex_unlock(&aemif_cs_mutex);
+}
+EXPORT_SYMBOL(davinci_aemif_release_timing);
+
+/**
+ * davinci_aemif_timing_lock - hold off timing changes
+ *
+ * For drivers whose accesses span several bus cycles that must all use
+ * the same timings, such as a NAND operation.  May sleep.
+ */
+void davinci_aemif_timing_lock(void)
+{
+	down_read(&aemif_timing_sem);
+}
+EXPORT_SYMBOL(davinci_aemif_timing_lock);
+
+void davinci_aemif_timing_unlock(void)
+{
+	up_read(&aemif_timing_sem);
+}
+EXPORT_SYMBOL(davinci_aemif_timing_unlock);
@@ -191,7 +191,7 @@ static __init int da830_evm_config_pru_suart(void)
         pr_warning("da830_evm_init: pru suart registration failed: %d\n", ret);
     return ret;
 }
-device_initcall(da830_evm_config_pru_suart);
+davinci_async_device_initcall(da830_evm_config_pru_suart);
 
 static struct davinci_uart_config da830_evm_uart_config __initdata = {
 	.enabled_uarts = 0x7,
@@ -491,20 +491,11 @@ static struct spi_board_info da830_spi_board_info[] = {
 #ifdef CONFIG_DA830_UI_LCD
 static int da830_lcd_hw_init(void)
 {
-	void __iomem *cfg_mstpri2_base;
-	u32 val;
-
 	/*
 	 * Reconfigure the LCDC priority to the highest to ensure that
 	 * the throughput/latency requirements for the LCDC are met.
 	 */
-	cfg_mstpri2_base = DA8XX_SYSCFG0_VIRT(DA8XX_MSTPRI2_REG);
-
-	val = __raw_readl(cfg_mstpri2_base);
-	val &= 0x0fffffff;
-	__raw_writel(val, cfg_mstpri2_base);
-
-	return 0;
+	return da8xx_set_master_priority(DA8XX_MASTER_LCDC, 0);
 }
 
 static const short da830_evm_lcdc_pins[] = {
@@ -705,6 +696,8 @@ static __init void da830_evm_init(void)
 	struct davinci_soc_info *soc_info = &davinci_soc_info;
 	int ret;
 
+	davinci_boot_mark("da830_evm_init");
+
 	ret = da8xx_register_edma();
 	if (ret)
 		pr_warning("da830_evm_init: edma registration failed: %d\n",
@@ -768,6 +761,8 @@ static __init void da830_evm_init(void)
 
 	da830_init_spi0(BIT(0), da830_spi_board_info,
 			ARRAY_SIZE(da830_spi_board_info));
+
+	davinci_boot_mark("da830_evm_init done");
 }
 
 #ifdef CONFIG_SERIAL_8250_CONSOLE
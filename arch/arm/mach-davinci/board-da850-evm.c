@@ -29,6 +29,7 @@
 #include <linux/spi/flash.h>
 #include <linux/usb/musb.h>
 #include <linux/i2c-gpio.h>
+#include <linux/dma-contiguous.h>
 
 #include <asm/mach-types.h>
 #include <asm/mach/arch.h>
@@ -208,6 +209,11 @@ static struct resource da850_evm_nandflash_resource[] = {
 		.end	= DA8XX_AEMIF_CTL_BASE + SZ_32K - 1,
 		.flags	= IORESOURCE_MEM,
 	},
+	{		/* EM_WAIT rising edge: ready */
+		.start	= IRQ_DA8XX_AEMIFINT,
+		.end	= IRQ_DA8XX_AEMIFINT,
+		.flags	= IORESOURCE_IRQ,
+	},
 };
 
 static struct platform_device da850_evm_nandflash_device = {
@@ -592,6 +598,9 @@ static struct snd_platform_data da850_evm_snd_data = {
 	.version	= MCASP_VERSION_2,
 	.txnumevt	= 1,
 	.rxnumevt	= 1,
+	/* keep audio off the EMIF it shares with LCDC refresh */
+	.sram_size_playback = SZ_2K,
+	.sram_size_capture = SZ_2K,
 };
 
 static struct davinci_mcbsp_platform_data da850_mcbsp0_config = {
@@ -634,19 +643,13 @@ static void da850_panel_power_ctrl(int val)
 
 static int da850_lcd_hw_init(void)
 {
-	void __iomem *cfg_mstpri2_base;
 	int status;
-	u32 val;
 
 	/*
 	 * Reconfigure the LCDC priority to the highest to ensure that
 	 * the throughput/latency requirements for the LCDC are met.
 	 */
-	cfg_mstpri2_base = DA8XX_SYSCFG0_VIRT(DA8XX_MSTPRI2_REG);
-
-	val = __raw_readl(cfg_mstpri2_base);
-	val &= 0x0fffffff;
-	__raw_writel(val, cfg_mstpri2_base);
+	da8xx_set_master_priority(DA8XX_MASTER_LCDC, 0);
 
 	status = gpio_request(DA850_LCD_BL_PIN, "lcd bl\n");
 	if (status < 0)
@@ -1052,6 +1055,7 @@ static struct davinci_i2c_platform_data da850_davinci_i2c_pdata = {
 	//.bus_freq	= 10,
 	.bus_freq	= 100,
 	.bus_delay	= 0,
+	.use_dma	= 1,
 };
 
 
@@ -1127,14 +1131,50 @@ static int __init da850_evm_config_pru_suart(void)
         pr_warning("da850_evm_init: pru suart registration failed: %d\n", ret);
     return ret;
 }
-device_initcall(da850_evm_config_pru_suart);
+davinci_async_device_initcall(da850_evm_config_pru_suart);
+
+/* dsp_ipc=<size>@<start>: DDR that mem= left to the DSP exchange */
+static resource_size_t da850_evm_dsp_ipc_base, da850_evm_dsp_ipc_size;
+
+static int __init da850_evm_dsp_ipc_setup(char *str)
+{
+	da850_evm_dsp_ipc_size = memparse(str, &str);
+	if (*str == '@')
+		da850_evm_dsp_ipc_base = memparse(str + 1, &str);
+	else
+		da850_evm_dsp_ipc_size = 0;
+	return 1;
+}
+__setup("dsp_ipc=", da850_evm_dsp_ipc_setup);
+
+/* dsp_mem=<size>@<start>: DDR that mem= left for DSP code and data */
+static resource_size_t da850_evm_dsp_mem_base, da850_evm_dsp_mem_size;
+
+static int __init da850_evm_dsp_mem_setup(char *str)
+{
+	da850_evm_dsp_mem_size = memparse(str, &str);
+	if (*str == '@')
+		da850_evm_dsp_mem_base = memparse(str + 1, &str);
+	else
+		da850_evm_dsp_mem_size = 0;
+	return 1;
+}
+__setup("dsp_mem=", da850_evm_dsp_mem_setup);
 
 extern struct clk pwm1_clk;
 extern struct clk ecap_clk;
+static int __init da850_evm_usb_init_async(void)
+{
+	da850_evm_usb_init();
+	return 0;
+}
+
 static __init void da850_evm_init(void)
 {
 	int ret;
 
+	davinci_boot_mark("da850_evm_init");
+
 	ret = da8xx_register_edma();
 	if (ret)
 		pr_warning("da850_evm_init: edma registration failed: %d\n",
@@ -1289,6 +1329,20 @@ static __init void da850_evm_init(void)
 	if (ret)
 		pr_warning("da850_evm_init: cpuidle registration failed: %d\n",
 				ret);
+
+	if (da850_evm_dsp_ipc_size) {
+		ret = da850_register_dsp_ipc(da850_evm_dsp_ipc_base,
+					     da850_evm_dsp_ipc_size);
+		if (ret)
+			pr_warning("da850_evm_init: dsp ipc registration "
+					"failed: %d\n", ret);
+	}
+
+	ret = da850_register_dsp_loader(da850_evm_dsp_mem_base,
+					da850_evm_dsp_mem_size);
+	if (ret)
+		pr_warning("da850_evm_init: dsp loader registration "
+				"failed: %d\n", ret);
 /*
 	ret = da850_register_pm(&da850_pm_device);
 	if (ret)
@@ -1303,7 +1357,8 @@ static __init void da850_evm_init(void)
 	da850_init_spi1(BIT(0), da850_spi_board_info,
 			ARRAY_SIZE(da850_spi_board_info));
 */
-	da850_evm_usb_init();
+	/* USB 1.1 VBUS/OC GPIOs and the OHCI device: nothing else needs them */
+	davinci_init_async(da850_evm_usb_init_async);
 /*
 	ret = da8xx_register_sata();
 	if (ret)
@@ -1382,6 +1437,8 @@ static __init void da850_evm_init(void)
 				" %d\n", ret);
 
 	clk_enable(&pwm1_clk);
+
+	davinci_boot_mark("da850_evm_init done");
 }
 
 #ifdef CONFIG_SERIAL_8250_CONSOLE
@@ -1400,9 +1457,28 @@ static __init void da850_evm_irq_init(void)
 			soc_info->intc_irq_prios);
 }
 
+/*
+ * Capture/display frame buffers and the uPP transfer buffer come from
+ * contiguous DMA regions; the page cache uses them while they are idle.
+ */
+static struct cma_region da850_evm_cma_regions[] = {
+	{
+		.name	= "video",
+		.size	= SZ_16M,
+		.devs	= "vpif_capture,vpif_display,zcbuf",
+	},
+	{
+		.name	= "upp",
+		.size	= SZ_8M,
+		.devs	= "davinci-upp",
+	},
+};
+
 static void __init da850_evm_map_io(void)
 {
 	da850_init();
+	dma_contiguous_reserve(da850_evm_cma_regions,
+			       ARRAY_SIZE(da850_evm_cma_regions));
 }
 
 MACHINE_START(DAVINCI_DA850_EVM, "DaVinci DA850/OMAP-L138/AM18xx EVM")
@@ -24,6 +24,7 @@
 #include <linux/clk.h>
 #include <linux/videodev2.h>
 #include <linux/usb/musb.h>
+#include <linux/dma-contiguous.h>
 
 #include <media/tvp514x.h>
 
@@ -656,12 +657,23 @@ static struct davinci_uart_config uart_config __initdata = {
 	.enabled_uarts = (1 << 0),
 };
 
+/* vpfe capture buffers, lent to the page cache while capture is idle */
+static struct cma_region dm644x_evm_cma_regions[] = {
+	{
+		.name	= "video",
+		.size	= SZ_12M,
+		.devs	= CAPTURE_DRV_NAME ",zcbuf",
+	},
+};
+
 static void __init
 davinci_evm_map_io(void)
 {
 	/* setup input configuration for VPFE input devices */
 	dm644x_set_vpfe_config(&vpfe_cfg);
 	dm644x_init();
+	dma_contiguous_reserve(dm644x_evm_cma_regions,
+			       ARRAY_SIZE(dm644x_evm_cma_regions));
 }
 
 static int davinci_phy_fixup(struct phy_device *phydev)
@@ -0,0 +1,159 @@
+/*
+ * DaVinci boot phase timestamps and asynchronous board initcalls
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc. http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/async.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+
+#include <mach/common.h>
+
+/*
+ * Timestamps come from sched_clock(), i.e. the 64-bit timer where the SoC
+ * has one, jiffies otherwise.  Marks beyond the table are dropped.
+ */
+#define DAVINCI_BOOT_MARKS	48
+
+struct davinci_boot_mark {
+	const char		*phase;
+	void			*fn;
+	unsigned long long	ns;
+	unsigned long long	took;
+};
+
+static struct davinci_boot_mark davinci_boot_marks[DAVINCI_BOOT_MARKS];
+static unsigned davinci_boot_nmarks;
+static DEFINE_SPINLOCK(davinci_boot_lock);
+
+static int davinci_sync_init;
+
+static int __init davinci_sync_init_setup(char *str)
+{
+	davinci_sync_init = 1;
+	return 1;
+}
+__setup("davinci_sync_init", davinci_sync_init_setup);
+
+static void davinci_boot_record(const char *phase, void *fn,
+				unsigned long long ns, unsigned long long took)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&davinci_boot_lock, flags);
+	if (davinci_boot_nmarks < DAVINCI_BOOT_MARKS) {
+		struct davinci_boot_mark *m =
+				&davinci_boot_marks[davinci_boot_nmarks++];
+
+		m->phase = phase;
+		m->fn = fn;
+		m->ns = ns;
+		m->took = took;
+	}
+	spin_unlock_irqrestore(&davinci_boot_lock, flags);
+}
+
+/**
+ * davinci_boot_mark - timestamp a point in board or SoC init
+ * @phase: static string naming the point reached
+ *
+ * The marks, and the time between each and the one before it, show up
+ * in debugfs davinci_boot.
+ */
+void davinci_boot_mark(const char *phase)
+{
+	davinci_boot_record(phase, NULL, sched_clock(), 0);
+}
+
+static void __init davinci_async_run(void *data, async_cookie_t cookie)
+{
+	int (*fn)(void) = data;
+	unsigned long long start = sched_clock();
+	int ret;
+
+	ret = fn();
+	davinci_boot_record(NULL, fn, start, sched_clock() - start);
+	if (ret)
+		pr_warning("%pf returned %d\n", fn, ret);
+}
+
+/**
+ * davinci_init_async - run a board initcall off the boot thread
+ * @fn: the initcall
+ *
+ * For setup that doesn't depend on anything later in boot and that
+ * nothing later depends on, e.g. registering a device whose driver may
+ * sleep probing it.  Everything is done before init memory is freed.
+ * "davinci_sync_init" on the command line runs them inline instead.
+ */
+int __init davinci_init_async(int (*fn)(void))
+{
+	if (davinci_sync_init)
+		davinci_async_run(fn, 0);
+	else
+		async_schedule(davinci_async_run, fn);
+	return 0;
+}
+
+#ifdef CONFIG_DEBUG_FS
+
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+static int davinci_boot_show(struct seq_file *m, void *v)
+{
+	unsigned long long prev = 0;
+	unsigned long flags;
+	unsigned i;
+
+	spin_lock_irqsave(&davinci_boot_lock, flags);
+	for (i = 0; i < davinci_boot_nmarks; i++) {
+		struct davinci_boot_mark *b = &davinci_boot_marks[i];
+
+		if (b->phase) {
+			seq_printf(m, "%12llu us  +%9llu us  %s\n",
+				   b->ns / 1000, (b->ns - prev) / 1000,
+				   b->phase);
+			prev = b->ns;
+		} else {
+			seq_printf(m, "%12llu us  %10llu us  %pf (async)\n",
+				   b->ns / 1000, b->took / 1000, b->fn);
+		}
+	}
+	spin_unlock_irqrestore(&davinci_boot_lock, flags);
+
+	return 0;
+}
+
+static int davinci_boot_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, davinci_boot_show, NULL);
+}
+
+static const struct file_operations davinci_boot_operations = {
+	.open		= davinci_boot_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init davinci_boot_debugfs_init(void)
+{
+	davinci_boot_mark("late initcalls");
+	debugfs_create_file("davinci_boot", S_IFREG | S_IRUGO, NULL, NULL,
+			    &davinci_boot_operations);
+	return 0;
+}
+late_initcall(davinci_boot_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
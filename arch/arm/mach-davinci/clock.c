@@ -37,12 +37,61 @@ static unsigned psc_domain(struct clk *clk)
 		: DAVINCI_GPSC_ARMDOMAIN;
 }
 
+/*
+ * While a batch is open, module transitions are only queued and later
+ * issued with one GO per controller and power domain (see psc_batch_run()).
+ * Used for the bulk enables and disables done at boot.
+ */
+#define PSC_BATCH_MAX	64
+
+static struct clk *psc_batch[PSC_BATCH_MAX];
+static int psc_batch_cnt;
+static bool psc_batching;
+
+static void psc_transition(struct clk *clk, char enable)
+{
+	if (psc_batching && psc_batch_cnt < PSC_BATCH_MAX)
+		psc_batch[psc_batch_cnt++] = clk;
+	else
+		davinci_psc_config(psc_domain(clk), clk->gpsc, clk->lpsc,
+				   enable);
+}
+
+/* Issue the queued transitions; called with clockfw_lock held */
+static void __init psc_batch_run(char enable)
+{
+	unsigned int ids[PSC_BATCH_MAX];
+	struct clk *ck;
+	int i, j, n;
+
+	for (i = 0; i < psc_batch_cnt; i++) {
+		ck = psc_batch[i];
+		if (!ck)
+			continue;
+
+		n = 0;
+		for (j = i; j < psc_batch_cnt; j++) {
+			if (!psc_batch[j] ||
+			    psc_batch[j]->gpsc != ck->gpsc ||
+			    psc_domain(psc_batch[j]) != psc_domain(ck))
+				continue;
+			ids[n++] = psc_batch[j]->lpsc;
+			psc_batch[j] = NULL;
+		}
+		davinci_psc_config_batch(psc_domain(ck), ck->gpsc, ids, n,
+					 enable);
+	}
+
+	psc_batch_cnt = 0;
+	psc_batching = false;
+}
+
 static void __clk_enable(struct clk *clk)
 {
 	if (clk->parent)
 		__clk_enable(clk->parent);
 	if (clk->usecount++ == 0 && (clk->flags & CLK_PSC))
-		davinci_psc_config(psc_domain(clk), clk->gpsc, clk->lpsc, 1);
+		psc_transition(clk, 1);
 }
 
 static void __clk_disable(struct clk *clk)
@@ -221,6 +270,7 @@ static int __init clk_disable_unused(void)
 	struct clk *ck;
 
 	spin_lock_irq(&clockfw_lock);
+	psc_batching = true;
 	list_for_each_entry(ck, &clocks, node) {
 		if (ck->usecount > 0)
 			continue;
@@ -232,8 +282,9 @@ static int __init clk_disable_unused(void)
 			continue;
 
 		pr_info("Clocks: disable unused %s\n", ck->name);
-		davinci_psc_config(psc_domain(ck), ck->gpsc, ck->lpsc, 0);
+		psc_transition(ck, 0);
 	}
+	psc_batch_run(0);
 	spin_unlock_irq(&clockfw_lock);
 
 	return 0;
@@ -483,6 +534,7 @@ int __init davinci_clk_init(struct clk_lookup *clocks)
 	struct clk *clk;
 	size_t num_clocks = 0;
 
+	psc_batching = true;
 	for (c = clocks; c->clk; c++) {
 		clk = c->clk;
 
@@ -515,11 +567,133 @@ int __init davinci_clk_init(struct clk_lookup *clocks)
 			clk_enable(clk);
 	}
 
+	spin_lock_irq(&clockfw_lock);
+	psc_batch_run(1);
+	spin_unlock_irq(&clockfw_lock);
+
 	clkdev_add_table(clocks, num_clocks);
 
 	return 0;
 }
 
+#ifdef CONFIG_HIBERNATION
+/*
+ * The kernel that loads a hibernation image has set up the PLLs and the
+ * PSC its own way.  Record the PLL and divider settings when the image is
+ * made, then bring the hardware back in line with them and with the use
+ * counts of the restored clock tree.  Only what differs is touched, so a
+ * PLL left alone by both kernels (e.g. the one clocking DDR) is never
+ * relocked.  Both run from sysdev PM with interrupts off.
+ */
+void davinci_clk_save(void)
+{
+	struct pll_data *pll;
+	struct clk *ck;
+
+	list_for_each_entry(ck, &clocks, node) {
+		pll = ck->pll_data;
+		if (pll && pll->base) {
+			pll->saved_pllm = __raw_readl(pll->base + PLLM);
+			if (pll->flags & PLL_HAS_PREDIV)
+				pll->saved_prediv = __raw_readl(pll->base +
+								PREDIV);
+			if (pll->flags & PLL_HAS_POSTDIV)
+				pll->saved_postdiv = __raw_readl(pll->base +
+								 POSTDIV);
+		} else if (ck->div_reg && ck->parent && ck->parent->pll_data) {
+			pll = ck->parent->pll_data;
+			ck->saved_div = __raw_readl(pll->base + ck->div_reg);
+		}
+	}
+}
+
+static unsigned pll_saved_div(u32 v)
+{
+	return (v & PLLDIV_EN) ? (v & PLLDIV_RATIO_MASK) + 1 : 0;
+}
+
+static void clk_restore_plls(void)
+{
+	struct pll_data *pll;
+	struct clk *ck;
+
+	list_for_each_entry(ck, &clocks, node) {
+		pll = ck->pll_data;
+		if (!pll || !pll->base)
+			continue;
+
+		if (__raw_readl(pll->base + PLLM) == pll->saved_pllm &&
+		    (!(pll->flags & PLL_HAS_PREDIV) ||
+		     __raw_readl(pll->base + PREDIV) == pll->saved_prediv) &&
+		    (!(pll->flags & PLL_HAS_POSTDIV) ||
+		     __raw_readl(pll->base + POSTDIV) == pll->saved_postdiv))
+			continue;
+
+		davinci_set_pllrate(pll, pll_saved_div(pll->saved_prediv),
+				    (pll->saved_pllm & PLLM_PLLM_MASK) + 1,
+				    pll_saved_div(pll->saved_postdiv));
+	}
+}
+
+static void clk_restore_dividers(void)
+{
+	struct pll_data *pll;
+	struct clk *ck;
+	u32 v;
+
+	list_for_each_entry(ck, &clocks, node) {
+		if (ck->pll_data || !ck->div_reg || !ck->parent ||
+		    !ck->parent->pll_data)
+			continue;
+
+		pll = ck->parent->pll_data;
+		if (__raw_readl(pll->base + ck->div_reg) == ck->saved_div)
+			continue;
+
+		do {
+			v = __raw_readl(pll->base + PLLSTAT);
+		} while (v & PLLSTAT_GOSTAT);
+
+		__raw_writel(ck->saved_div, pll->base + ck->div_reg);
+
+		v = __raw_readl(pll->base + PLLCMD);
+		v |= PLLCMD_GOSET;
+		__raw_writel(v, pll->base + PLLCMD);
+
+		do {
+			v = __raw_readl(pll->base + PLLSTAT);
+		} while (v & PLLSTAT_GOSTAT);
+	}
+}
+
+static void clk_restore_psc(void)
+{
+	struct clk *ck;
+	int active;
+
+	list_for_each_entry(ck, &clocks, node) {
+		if (!(ck->flags & CLK_PSC))
+			continue;
+
+		active = davinci_psc_is_clk_active(ck->gpsc, ck->lpsc);
+		if (ck->usecount > 0 && !active)
+			davinci_psc_config(psc_domain(ck), ck->gpsc, ck->lpsc, 1);
+#ifdef CONFIG_DAVINCI_RESET_CLOCKS
+		/* the image kernel had already turned unused modules off */
+		else if (ck->usecount == 0 && active)
+			davinci_psc_config(psc_domain(ck), ck->gpsc, ck->lpsc, 0);
+#endif
+	}
+}
+
+void davinci_clk_restore(void)
+{
+	clk_restore_plls();
+	clk_restore_dividers();
+	clk_restore_psc();
+}
+#endif
+
 #ifdef CONFIG_DEBUG_FS
 
 #include <linux/debugfs.h>
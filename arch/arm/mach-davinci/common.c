@@ -103,6 +103,12 @@ void __init davinci_common_init(struct davinci_soc_info *soc_info)
 
 	davinci_intc_base = davinci_soc_info.intc_base;
 	davinci_intc_type = davinci_soc_info.intc_type;
+
+	/* the SoC files keep these tables in __initdata */
+	davinci_soc_info.io_desc = NULL;
+	davinci_soc_info.io_desc_num = 0;
+	davinci_soc_info.ids = NULL;
+	davinci_soc_info.ids_num = 0;
 	return;
 
 err:
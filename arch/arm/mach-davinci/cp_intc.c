@@ -12,10 +12,14 @@
 #include <linux/init.h>
 #include <linux/irq.h>
 #include <linux/io.h>
+#include <linux/module.h>
+#include <linux/spinlock.h>
 
 #include <mach/cp_intc.h>
 
 static void __iomem *cp_intc_base;
+static unsigned short cp_intc_num_irq;
+static DEFINE_SPINLOCK(cp_intc_lock);
 
 static inline unsigned int cp_intc_read(unsigned offset)
 {
@@ -100,6 +104,65 @@ static struct irq_chip cp_intc_irq_chip = {
 	.set_wake	= cp_intc_set_wake,
 };
 
+/**
+ * cp_intc_set_irq_channel - change the channel a system interrupt maps to
+ * @irq: system interrupt number
+ * @channel: 2 (highest priority) to 31 for nIRQ, 0-1 for nFIQ
+ *
+ * Lower channels win when several interrupts are pending, so this sets
+ * the order the entry code dispatches them in.  Returns 0 or -EINVAL.
+ */
+int cp_intc_set_irq_channel(unsigned int irq, unsigned int channel)
+{
+	unsigned shift = (irq & 3) * 8;
+	unsigned long flags;
+	u32 val;
+
+	if (irq >= cp_intc_num_irq || channel >= CP_INTC_NUM_CHANNELS)
+		return -EINVAL;
+
+	spin_lock_irqsave(&cp_intc_lock, flags);
+	val = cp_intc_read(CP_INTC_CHAN_MAP(irq >> 2));
+	val &= ~(0xff << shift);
+	val |= channel << shift;
+	cp_intc_write(val, CP_INTC_CHAN_MAP(irq >> 2));
+	spin_unlock_irqrestore(&cp_intc_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(cp_intc_set_irq_channel);
+
+int cp_intc_get_irq_channel(unsigned int irq)
+{
+	if (irq >= cp_intc_num_irq)
+		return -EINVAL;
+
+	return (cp_intc_read(CP_INTC_CHAN_MAP(irq >> 2)) >>
+			((irq & 3) * 8)) & 0xff;
+}
+
+/**
+ * cp_intc_set_fiq - route one system interrupt to nFIQ
+ * @irq: system interrupt number, also its FIQ number (FIQ_START is 0)
+ *
+ * Meant for a single high-rate source such as the PRU or McASP.  The
+ * caller installs its handler with set_fiq_handler() and enables it with
+ * enable_fiq(); the handler must clear the source by writing its number
+ * to CP_INTC_SYS_STAT_IDX_CLR, since it never goes through genirq.
+ */
+int cp_intc_set_fiq(unsigned int irq)
+{
+	int ret;
+
+	ret = cp_intc_set_irq_channel(irq, CP_INTC_FIQ_CHANNEL);
+	if (ret)
+		return ret;
+
+	cp_intc_write(CP_INTC_HOST_FIQ, CP_INTC_HOST_ENABLE_IDX_SET);
+	return 0;
+}
+EXPORT_SYMBOL(cp_intc_set_fiq);
+
 void __init cp_intc_init(void __iomem *base, unsigned short num_irq,
 			 u8 *irq_prio)
 {
@@ -107,6 +170,7 @@ void __init cp_intc_init(void __iomem *base, unsigned short num_irq,
 	int i;
 
 	cp_intc_base = base;
+	cp_intc_num_irq = num_irq;
 
 	cp_intc_write(0, CP_INTC_GLOBAL_ENABLE);
 
@@ -125,8 +189,8 @@ void __init cp_intc_init(void __iomem *base, unsigned short num_irq,
 	for (i = 0; i < num_reg; i++)
 		cp_intc_write(~0, CP_INTC_SYS_STAT_CLR(i));
 
-	/* Enable nIRQ (what about nFIQ?) */
-	cp_intc_write(1, CP_INTC_HOST_ENABLE_IDX_SET);
+	/* Enable nIRQ; nFIQ is enabled by cp_intc_set_fiq() */
+	cp_intc_write(CP_INTC_HOST_IRQ, CP_INTC_HOST_ENABLE_IDX_SET);
 
 	/*
 	 * Priority is determined by host channel: lower channel number has
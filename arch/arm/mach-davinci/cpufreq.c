@@ -24,6 +24,11 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/platform_device.h>
+#include <linux/hrtimer.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/suspend.h>
+#include <linux/pm_qos_params.h>
 
 #include <mach/hardware.h>
 #include <mach/cpufreq.h>
@@ -36,9 +41,94 @@ struct davinci_cpufreq {
 	struct clk *armclk;
 	struct clk *asyncclk;
 	unsigned long asyncrate;
+
+	/* lowering the voltage is left to a work item, see davinci_target() */
+	struct work_struct volt_work;
+	struct mutex volt_lock;
+	unsigned int volt_idx;
+	bool volt_pending;
+
+	/* measured cost of davinci_target(), in ns */
+	u32 latency_last;
+	u32 latency_max;
+
+	/* re-evaluates the OPP when the PM_QOS_CPU_FREQ_MIN floor moves */
+	struct work_struct qos_work;
 };
 static struct davinci_cpufreq cpufreq;
 
+static void davinci_lower_voltage(struct work_struct *work)
+{
+	struct davinci_cpufreq_config *pdata = cpufreq.dev->platform_data;
+	int ret;
+
+	mutex_lock(&cpufreq.volt_lock);
+	if (cpufreq.volt_pending) {
+		cpufreq.volt_pending = false;
+		ret = pdata->set_voltage(cpufreq.volt_idx);
+		if (ret)
+			dev_warn(cpufreq.dev, "unable to lower voltage: %d\n",
+					ret);
+	}
+	mutex_unlock(&cpufreq.volt_lock);
+}
+
+/*
+ * The OPP is kept across suspend as is: the PLL multipliers and regulator
+ * output survive deep sleep, so resume has nothing to redo.  Only a
+ * voltage lowering still pending is done now, before the regulator's bus
+ * is suspended, rather than left to hold up resume.
+ */
+static int davinci_cpufreq_pm_notify(struct notifier_block *nb,
+				     unsigned long event, void *unused)
+{
+	if (event == PM_SUSPEND_PREPARE)
+		flush_work(&cpufreq.volt_work);
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block davinci_cpufreq_pm_nb = {
+	.notifier_call	= davinci_cpufreq_pm_notify,
+};
+
+/*
+ * Drivers moving a lot of data (EMAC, audio DMA) ask for a minimum CPU
+ * frequency through PM_QOS_CPU_FREQ_MIN while they are busy, since an
+ * idle-looking CPU at the lowest OPP can't keep up with their interrupt
+ * and buffer handling.  davinci_target() never goes below that floor;
+ * this only makes a change of the floor take effect right away instead
+ * of at the governor's next decision.
+ */
+static void davinci_cpufreq_qos_work(struct work_struct *work)
+{
+	struct cpufreq_policy *policy;
+	unsigned int qos_min;
+
+	policy = cpufreq_cpu_get(0);
+	if (!policy)
+		return;
+
+	qos_min = pm_qos_requirement(PM_QOS_CPU_FREQ_MIN);
+	if (policy->cur < qos_min)
+		cpufreq_driver_target(policy, qos_min, CPUFREQ_RELATION_L);
+	else
+		/* floor dropped: let the governor apply its own target again */
+		cpufreq_update_policy(0);
+
+	cpufreq_cpu_put(policy);
+}
+
+static int davinci_cpufreq_qos_notify(struct notifier_block *nb,
+				      unsigned long value, void *unused)
+{
+	schedule_work(&cpufreq.qos_work);
+	return NOTIFY_OK;
+}
+
+static struct notifier_block davinci_cpufreq_qos_nb = {
+	.notifier_call	= davinci_cpufreq_qos_notify,
+};
+
 static int davinci_verify_speed(struct cpufreq_policy *policy)
 {
 	struct davinci_cpufreq_config *pdata = cpufreq.dev->platform_data;
@@ -77,6 +167,9 @@ static int davinci_target(struct cpufreq_policy *policy,
 	struct cpufreq_freqs freqs;
 	struct davinci_cpufreq_config *pdata = cpufreq.dev->platform_data;
 	struct clk *armclk = cpufreq.armclk;
+	ktime_t start;
+	u32 latency;
+	unsigned int qos_min;
 
 	/*
 	 * Ensure desired rate is within allowed range.  Some govenors
@@ -87,10 +180,21 @@ static int davinci_target(struct cpufreq_policy *policy,
 	if (target_freq > policy->cpuinfo.max_freq)
 		target_freq = policy->cpuinfo.max_freq;
 
+	/* stay at or above what busy peripherals asked for */
+	qos_min = min(pm_qos_requirement(PM_QOS_CPU_FREQ_MIN), (int)policy->max);
+	if (target_freq < qos_min)
+		target_freq = qos_min;
+
 	freqs.old = davinci_getspeed(0);
 	freqs.new = clk_round_rate(armclk, target_freq * 1000) / 1000;
 	freqs.cpu = 0;
 
+	/* clk_round_rate() picks the nearest OPP, which may be below it */
+	if (freqs.new < qos_min &&
+	    !cpufreq_frequency_table_target(policy, pdata->freq_table, qos_min,
+					    CPUFREQ_RELATION_L, &idx))
+		freqs.new = pdata->freq_table[idx].frequency;
+
 	if (freqs.old == freqs.new)
 		return ret;
 
@@ -103,11 +207,20 @@ static int davinci_target(struct cpufreq_policy *policy,
 	if (ret)
 		return -EINVAL;
 
+	start = ktime_get();
+
 	cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
 
-	/* if moving to higher frequency, up the voltage beforehand */
+	/*
+	 * if moving to higher frequency, up the voltage beforehand; a lowering
+	 * still pending from an earlier transition is simply dropped, since
+	 * the voltage hasn't gone below what that frequency needed.
+	 */
 	if (pdata->set_voltage && freqs.new > freqs.old) {
+		mutex_lock(&cpufreq.volt_lock);
+		cpufreq.volt_pending = false;
 		ret = pdata->set_voltage(idx);
+		mutex_unlock(&cpufreq.volt_lock);
 		if (ret)
 			goto out;
 	}
@@ -122,12 +235,32 @@ static int davinci_target(struct cpufreq_policy *policy,
 			goto out;
 	}
 
-	/* if moving to lower freq, lower the voltage after lowering freq */
-	if (pdata->set_voltage && freqs.new < freqs.old)
-		ret = pdata->set_voltage(idx);
+	/*
+	 * if moving to lower freq, lower the voltage after lowering freq;
+	 * running overvolted for a while is harmless, so don't make the
+	 * transition wait for the regulator.
+	 */
+	if (pdata->set_voltage && freqs.new < freqs.old) {
+		mutex_lock(&cpufreq.volt_lock);
+		cpufreq.volt_idx = idx;
+		cpufreq.volt_pending = true;
+		mutex_unlock(&cpufreq.volt_lock);
+		schedule_work(&cpufreq.volt_work);
+	}
 out:
 	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
 
+	/* report what transitions really cost, not a guess */
+	latency = ktime_to_ns(ktime_sub(ktime_get(), start));
+	cpufreq.latency_last = latency;
+	if (latency > cpufreq.latency_max)
+		cpufreq.latency_max = latency;
+	policy->cpuinfo.transition_latency = cpufreq.latency_max;
+
+	cpufreq_debug_printk(CPUFREQ_DEBUG_DRIVER,
+			dev_driver_string(cpufreq.dev),
+			"transition took %u ns\n", latency);
+
 	return ret;
 }
 
@@ -167,7 +300,8 @@ static int __init davinci_cpu_init(struct cpufreq_policy *policy)
 	 * Time measurement across the target() function yields ~1500-1800us
 	 * time taken with no drivers on notification list.
 	 * Setting the latency to 2000 us to accomodate addition of drivers
-	 * to pre/post change notification list.
+	 * to pre/post change notification list.  Replaced by the worst case
+	 * actually measured once transitions have been made.
 	 */
 	policy->cpuinfo.transition_latency = 2000 * 1000;
 	return 0;
@@ -179,8 +313,19 @@ static int davinci_cpu_exit(struct cpufreq_policy *policy)
 	return 0;
 }
 
+static ssize_t show_transition_latency_last(struct cpufreq_policy *policy,
+					    char *buf)
+{
+	return sprintf(buf, "%u\n", cpufreq.latency_last);
+}
+
+static struct freq_attr davinci_freq_attr_transition_latency_last =
+	__ATTR(transition_latency_last, S_IRUGO,
+			show_transition_latency_last, NULL);
+
 static struct freq_attr *davinci_cpufreq_attr[] = {
 	&cpufreq_freq_attr_scaling_available_freqs,
+	&davinci_freq_attr_transition_latency_last,
 	NULL,
 };
 
@@ -199,6 +344,7 @@ static int __init davinci_cpufreq_probe(struct platform_device *pdev)
 {
 	struct davinci_cpufreq_config *pdata = pdev->dev.platform_data;
 	struct clk *asyncclk;
+	int ret;
 
 	if (!pdata)
 		return -EINVAL;
@@ -206,6 +352,9 @@ static int __init davinci_cpufreq_probe(struct platform_device *pdev)
 		return -EINVAL;
 
 	cpufreq.dev = &pdev->dev;
+	INIT_WORK(&cpufreq.volt_work, davinci_lower_voltage);
+	mutex_init(&cpufreq.volt_lock);
+	INIT_WORK(&cpufreq.qos_work, davinci_cpufreq_qos_work);
 
 	cpufreq.armclk = clk_get(NULL, "arm");
 	if (IS_ERR(cpufreq.armclk)) {
@@ -219,14 +368,31 @@ static int __init davinci_cpufreq_probe(struct platform_device *pdev)
 		cpufreq.asyncrate = pdata->asyncrate;
 	}
 
-	return cpufreq_register_driver(&davinci_driver);
+	register_pm_notifier(&davinci_cpufreq_pm_nb);
+
+	ret = cpufreq_register_driver(&davinci_driver);
+	if (ret) {
+		unregister_pm_notifier(&davinci_cpufreq_pm_nb);
+		return ret;
+	}
+
+	pm_qos_add_notifier(PM_QOS_CPU_FREQ_MIN, &davinci_cpufreq_qos_nb);
+
+	return 0;
 }
 
 static int __exit davinci_cpufreq_remove(struct platform_device *pdev)
 {
+	int ret;
+
+	pm_qos_remove_notifier(PM_QOS_CPU_FREQ_MIN, &davinci_cpufreq_qos_nb);
+	flush_work(&cpufreq.qos_work);
+	ret = cpufreq_unregister_driver(&davinci_driver);
+	unregister_pm_notifier(&davinci_cpufreq_pm_nb);
+	flush_work(&cpufreq.volt_work);
 	clk_put(cpufreq.armclk);
 
-	return cpufreq_unregister_driver(&davinci_driver);
+	return ret;
 }
 
 static struct platform_driver davinci_cpufreq_driver = {
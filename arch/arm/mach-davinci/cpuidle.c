@@ -17,15 +17,20 @@
 #include <linux/cpuidle.h>
 #include <linux/io.h>
 #include <asm/proc-fns.h>
+#include <asm/cacheflush.h>
 
 #include <mach/cpuidle.h>
 #include <mach/memory.h>
+#include <mach/sram.h>
 
-#define DAVINCI_CPUIDLE_MAX_STATES	2
+#include "clock.h"
+
+#define DAVINCI_CPUIDLE_MAX_STATES	4
 
 struct davinci_ops {
 	void (*enter) (u32 flags);
 	void (*exit) (u32 flags);
+	void (*idle) (void);		/* instead of plain WFI */
 	u32 flags;
 };
 
@@ -39,6 +44,10 @@ static struct cpuidle_driver davinci_idle_driver = {
 
 static DEFINE_PER_CPU(struct cpuidle_device, davinci_cpuidle_device);
 static void __iomem *ddr2_reg_base;
+static void __iomem *cpupll_reg_base;
+static u32 cpupll_ctl;
+
+static void (*davinci_sram_idle) (void __iomem *, void __iomem *);
 
 static void davinci_save_ddr_power(int enter, bool pdown)
 {
@@ -69,11 +78,44 @@ static void davinci_c2state_exit(u32 flags)
 	davinci_save_ddr_power(0, !!(flags & DAVINCI_CPUIDLE_FLAGS_DDR2_PWDN));
 }
 
+/*
+ * The PLL stays locked while bypassed, so it can be switched back in
+ * without waiting; only the CPU and its PLL0 SYSCLKs run slow meanwhile.
+ */
+static void davinci_c3state_enter(u32 flags)
+{
+	davinci_c2state_enter(flags);
+
+	cpupll_ctl = __raw_readl(cpupll_reg_base + PLLCTL);
+	__raw_writel(cpupll_ctl & ~(PLLCTL_PLLENSRC | PLLCTL_PLLEN),
+			cpupll_reg_base + PLLCTL);
+}
+
+static void davinci_c3state_exit(u32 flags)
+{
+	__raw_writel(cpupll_ctl, cpupll_reg_base + PLLCTL);
+
+	davinci_c2state_exit(flags);
+}
+
+/* DDR2 can't be touched in here, so all of it runs from SRAM */
+static void davinci_c4state_idle(void)
+{
+	davinci_sram_idle(ddr2_reg_base, cpupll_reg_base);
+}
+
 static struct davinci_ops davinci_states[DAVINCI_CPUIDLE_MAX_STATES] = {
 	[1] = {
 		.enter	= davinci_c2state_enter,
 		.exit	= davinci_c2state_exit,
 	},
+	[2] = {
+		.enter	= davinci_c3state_enter,
+		.exit	= davinci_c3state_exit,
+	},
+	[3] = {
+		.idle	= davinci_c4state_idle,
+	},
 };
 
 /* Actual code that puts the SoC in different idle states */
@@ -90,7 +132,10 @@ static int davinci_enter_idle(struct cpuidle_device *dev,
 	if (ops && ops->enter)
 		ops->enter(ops->flags);
 	/* Wait for interrupt state */
-	cpu_do_idle();
+	if (ops && ops->idle)
+		ops->idle();
+	else
+		cpu_do_idle();
 	if (ops && ops->exit)
 		ops->exit(ops->flags);
 
@@ -115,6 +160,7 @@ static int __init davinci_cpuidle_probe(struct platform_device *pdev)
 	}
 
 	ddr2_reg_base = pdata->ddr2_ctlr_base;
+	cpupll_reg_base = pdata->cpupll_reg_base;
 
 	ret = cpuidle_register_driver(&davinci_idle_driver);
 	if (ret) {
@@ -122,10 +168,19 @@ static int __init davinci_cpuidle_probe(struct platform_device *pdev)
 		return ret;
 	}
 
+	/*
+	 * Latencies and residencies below are worst case figures from the
+	 * OMAP-L138 datasheet: DDR2 self-refresh exit, PLL bypass switch
+	 * (PLL_BYPASS_TIME) and PLL reset plus lock (PLL_RESET_TIME,
+	 * PLL_LOCK_TIME), plus the time taken at OSCIN speed to get back
+	 * out of the state.  Residencies are where the saving is expected
+	 * to outweigh the cost of getting in and out.
+	 */
+
 	/* Wait for interrupt state */
 	device->states[0].enter = davinci_enter_idle;
 	device->states[0].exit_latency = 1;
-	device->states[0].target_residency = 10000;
+	device->states[0].target_residency = 1;
 	device->states[0].flags = CPUIDLE_FLAG_TIME_VALID;
 	strcpy(device->states[0].name, "WFI");
 	strcpy(device->states[0].desc, "Wait for interrupt");
@@ -133,7 +188,7 @@ static int __init davinci_cpuidle_probe(struct platform_device *pdev)
 	/* Wait for interrupt and DDR self refresh state */
 	device->states[1].enter = davinci_enter_idle;
 	device->states[1].exit_latency = 10;
-	device->states[1].target_residency = 10000;
+	device->states[1].target_residency = 100;
 	device->states[1].flags = CPUIDLE_FLAG_TIME_VALID;
 	strcpy(device->states[1].name, "DDR SR");
 	strcpy(device->states[1].desc, "WFI and DDR Self Refresh");
@@ -141,8 +196,43 @@ static int __init davinci_cpuidle_probe(struct platform_device *pdev)
 		davinci_states[1].flags |= DAVINCI_CPUIDLE_FLAGS_DDR2_PWDN;
 	cpuidle_set_statedata(&device->states[1], &davinci_states[1]);
 
-	device->state_count = DAVINCI_CPUIDLE_MAX_STATES;
+	device->state_count = 2;
+
+	if (!cpupll_reg_base)
+		goto register_device;
+
+	/* DDR self refresh with the CPU PLL bypassed */
+	device->states[2].enter = davinci_enter_idle;
+	device->states[2].exit_latency = 20;
+	device->states[2].target_residency = 500;
+	device->states[2].flags = CPUIDLE_FLAG_TIME_VALID;
+	strcpy(device->states[2].name, "DDR SR PLL BYP");
+	strcpy(device->states[2].desc, "WFI, DDR SR and CPU PLL bypass");
+	davinci_states[2].flags = davinci_states[1].flags;
+	cpuidle_set_statedata(&device->states[2], &davinci_states[2]);
+	device->state_count++;
+
+	davinci_sram_idle = sram_alloc_pool(SRAM_POOL_PM, davinci_cpu_idle_sz,
+					    NULL);
+	if (!davinci_sram_idle) {
+		dev_warn(&pdev->dev, "no SRAM, deep idle state disabled\n");
+		goto register_device;
+	}
+	memcpy(davinci_sram_idle, davinci_cpu_idle, davinci_cpu_idle_sz);
+	flush_icache_range((unsigned long)davinci_sram_idle,
+			(unsigned long)davinci_sram_idle + davinci_cpu_idle_sz);
+
+	/* DDR clock stopped and CPU PLL powered down, from SRAM */
+	device->states[3].enter = davinci_enter_idle;
+	device->states[3].exit_latency = 50;
+	device->states[3].target_residency = 2000;
+	device->states[3].flags = CPUIDLE_FLAG_TIME_VALID;
+	strcpy(device->states[3].name, "SRAM PLL OFF");
+	strcpy(device->states[3].desc, "SRAM WFI, DDR clock, PLL off");
+	cpuidle_set_statedata(&device->states[3], &davinci_states[3]);
+	device->state_count++;
 
+register_device:
 	ret = cpuidle_register_device(device);
 	if (ret) {
 		dev_err(&pdev->dev, "failed to register device\n");
@@ -1152,7 +1152,7 @@ static u8 da830_default_priorities[DA830_N_CP_INTC_IRQ] = {
 	[IRQ_DA8XX_ARMCLKSTOPREQ]	= 7,
 };
 
-static struct map_desc da830_io_desc[] = {
+static struct map_desc da830_io_desc[] __initdata = {
 	{
 		.virtual	= IO_VIRT,
 		.pfn		= __phys_to_pfn(IO_PHYS),
@@ -1173,7 +1173,7 @@ static void __iomem *da830_psc_bases[] = {
 };
 
 /* Contents of JTAG ID register used to identify exact cpu type */
-static struct davinci_id da830_ids[] = {
+static struct davinci_id da830_ids[] __initdata = {
 	{
 		.variant	= 0x0,
 		.part_no	= 0xb7df,
@@ -1225,7 +1225,7 @@ static struct davinci_timer_info da830_timer_info = {
 	.clocksource_id	= T0_BOT,
 };
 
-static struct davinci_soc_info davinci_soc_info_da830 = {
+static struct davinci_soc_info davinci_soc_info_da830 __initdata = {
 	.io_desc		= da830_io_desc,
 	.io_desc_num		= ARRAY_SIZE(da830_io_desc),
 	.ids			= da830_ids,
@@ -1245,6 +1245,8 @@ static struct davinci_soc_info davinci_soc_info_da830 = {
 	.gpio_irq		= IRQ_DA8XX_GPIO0,
 	.serial_dev		= &da8xx_serial_device,
 	.emac_pdata		= &da8xx_emac_pdata,
+	.dma_pool_ram		= DA8XX_DMA_POOL_RAM,
+	.dma_pool_ram_len	= DA8XX_DMA_POOL_RAM_SIZE,
 };
 
 void __init da830_init(void)
@@ -29,6 +29,7 @@
 #include <mach/da8xx.h>
 #include <mach/cpufreq.h>
 #include <mach/pm.h>
+#include <mach/sram.h>
 
 #include "clock.h"
 #include "mux.h"
@@ -339,6 +340,12 @@ static struct clk timerp64_2_pru_clk = {
         .flags          = DA850_CLK_ASYNC3,
 };
 
+static struct clk timerp64_3_clk = {
+	.name		= "timer3",
+	.parent		= &pll0_sysclk2,
+	.flags		= DA850_CLK_ASYNC3,
+};
+
 static struct clk lcdc_clk = {
 	.name		= "lcdc",
 	.parent		= &pll0_sysclk2,
@@ -393,6 +400,13 @@ static struct clk vpif_clk = {
 	.gpsc		= 1,
 };
 
+static struct clk upp_clk = {
+	.name		= "upp",
+	.parent		= &pll0_sysclk2,
+	.lpsc		= DA850_LPSC1_UPP,
+	.gpsc		= 1,
+};
+
 static struct clk usb11_clk = {
 	.name		= "usb11",
 	.parent		= &pll0_sysclk4,
@@ -465,6 +479,7 @@ static struct clk_lookup da850_clks[] = {
 	CLK("i2c_davinci.1",	NULL,		&i2c0_clk),
 	CLK(NULL,		"timer0",	&timerp64_0_clk),
 	CLK("watchdog",		NULL,		&timerp64_1_clk),
+	CLK(NULL,		"timer1",	&timerp64_1_clk),
 	CLK(NULL,		"arm_rom",	&arm_rom_clk),
 	CLK(NULL,		"tpcc0",	&tpcc0_clk),
 	CLK(NULL,		"tptc0",	&tptc0_clk),
@@ -485,6 +500,7 @@ static struct clk_lookup da850_clks[] = {
 	CLK(NULL,	"mcasp_pru",	&mcasp_pru_clk),
 	CLK("davinci-mcasp.0",	NULL,		&mcasp_clk),
 	CLK(NULL,               "timer2_pru",   &timerp64_2_pru_clk),
+	CLK(NULL,		"timer3",	&timerp64_3_clk),
 	CLK("da8xx_lcdc.0",	NULL,		&lcdc_clk),
 	CLK("davinci_mmc.0",	NULL,		&mmcsd_clk),
 	CLK(NULL,		"aemif",	&aemif_clk),
@@ -493,6 +509,7 @@ static struct clk_lookup da850_clks[] = {
 	CLK("davinci-mcbsp.0",	NULL,		&mcbsp0_clk),
 	CLK("davinci-mcbsp.1",	NULL,		&mcbsp1_clk),
 	CLK(NULL, 		"vpif",		&vpif_clk),
+	CLK(NULL,		"upp",		&upp_clk),
 	CLK(NULL, 		"ecap", 	&ecap_clk),
 	CLK(NULL,		"usb11",	&usb11_clk),
 	CLK(NULL,		"usb20",	&usb20_clk),
@@ -979,7 +996,7 @@ static u8 da850_default_priorities[DA850_N_CP_INTC_IRQ] = {
 	[IRQ_DA8XX_EVTOUT6]		= 7,
 	[IRQ_DA8XX_EVTOUT6]		= 7,
 	[IRQ_DA8XX_EVTOUT7]		= 7,
-	[IRQ_DA8XX_CCINT0]		= 7,
+	[IRQ_DA8XX_CCINT0]		= 3,
 	[IRQ_DA8XX_CCERRINT]		= 7,
 	[IRQ_DA8XX_TCERRINT0]		= 7,
 	[IRQ_DA8XX_AEMIFINT]		= 7,
@@ -989,7 +1006,7 @@ static u8 da850_default_priorities[DA850_N_CP_INTC_IRQ] = {
 	[IRQ_DA8XX_ALLINT0]		= 7,
 	[IRQ_DA8XX_RTC]			= 7,
 	[IRQ_DA8XX_SPINT0]		= 7,
-	[IRQ_DA8XX_TINT12_0]		= 7,
+	[IRQ_DA8XX_TINT12_0]		= 2,
 	[IRQ_DA8XX_TINT34_0]		= 7,
 	[IRQ_DA8XX_TINT12_1]		= 7,
 	[IRQ_DA8XX_TINT34_1]		= 7,
@@ -1042,7 +1059,7 @@ static u8 da850_default_priorities[DA850_N_CP_INTC_IRQ] = {
 	[IRQ_DA8XX_I2CINT1]		= 7,
 	[IRQ_DA8XX_LCDINT]		= 7,
 	[IRQ_DA8XX_UARTINT1]		= 7,
-	[IRQ_DA8XX_MCASPINT]		= 7,
+	[IRQ_DA8XX_MCASPINT]		= 3,
 	[IRQ_DA8XX_ALLINT1]		= 7,
 	[IRQ_DA8XX_SPINT1]		= 7,
 	[IRQ_DA8XX_UHPI_INT1]		= 7,
@@ -1095,7 +1112,7 @@ static u8 da850_default_priorities[DA850_N_CP_INTC_IRQ] = {
 	[IRQ_DA8XX_ARMCLKSTOPREQ]	= 7,
 };
 
-static struct map_desc da850_io_desc[] = {
+static struct map_desc da850_io_desc[] __initdata = {
 	{
 		.virtual	= IO_VIRT,
 		.pfn		= __phys_to_pfn(IO_PHYS),
@@ -1114,6 +1131,21 @@ static struct map_desc da850_io_desc[] = {
 		.length		= SZ_8K,
 		.type		= MT_DEVICE
 	},
+#ifdef CONFIG_DAVINCI_SRAM_TEXT
+	{
+		.virtual	= DAVINCI_SRAM_TEXT_VIRT,
+		.pfn		= __phys_to_pfn(DA850_SRAM_TEXT_BASE),
+		.length		= DAVINCI_SRAM_TEXT_SIZE,
+		.type		= MT_MEMORY
+	},
+#endif
+};
+
+/* ARM RAM: McASP ping-pong buffers, idle and suspend code, rest general */
+static const struct davinci_sram_carveout da850_sram_carveouts[] = {
+	{ SRAM_POOL_AUDIO,	SZ_4K },
+	{ SRAM_POOL_PM,		SZ_2K },
+	{ },
 };
 
 static void __iomem *da850_psc_bases[] = {
@@ -1122,7 +1154,7 @@ static void __iomem *da850_psc_bases[] = {
 };
 
 /* Contents of JTAG ID register used to identify exact cpu type */
-static struct davinci_id da850_ids[] = {
+static struct davinci_id da850_ids[] __initdata = {
 	{
 		.variant	= 0x0,
 		.part_no	= 0xb7d1,
@@ -1165,29 +1197,52 @@ static struct davinci_timer_instance da850_timer_instance[4] = {
 /*
  * T0_BOT: Timer 0, bottom		: Used for clock_event
  * T0_TOP: Timer 0, top			: Used for clocksource
- * T1_BOT, T1_TOP: Timer 1, bottom & top: Used for watchdog timer
+ * T1_BOT, T1_TOP: Timer 1, bottom & top: Used for watchdog timer, or by
+ *		   oprofile for sampling when the watchdog isn't in use
+ * Timer 3: 64-bit free-running clocksource and sched_clock.  It runs off
+ *	    Async3, see da850_set_async3_src().
  */
 static struct davinci_timer_info da850_timer_info = {
-	.timers		= da850_timer_instance,
-	.clockevent_id	= T0_BOT,
-	.clocksource_id	= T0_TOP,
-};
-
-static void da850_set_async3_src(int pllnum)
+	.timers			= da850_timer_instance,
+	.clockevent_id		= T0_BOT,
+	.clocksource_id		= T0_TOP,
+	.clocksource64		= &da850_timer_instance[3],
+	.clocksource64_clk	= "timer3",
+	.profile		= &da850_timer_instance[1],
+	.profile_clk		= "timer1",
+};
+
+/**
+ * da850_set_async3_src - select the PLL the Async3 clock domain runs off
+ * @pllnum: 0 for PLL0 SYSCLK2, 1 for PLL1 SYSCLK2
+ *
+ * Async3 clocks the UART1/2, McASP, SPI1, eHRPWM and eCAP modules. On
+ * PLL1 they are unaffected by the PLL0 changes DVFS makes; da850_init()
+ * selects that.  Boards needing them on PLL0 instead (e.g. because PLL1
+ * isn't set up to match PLL0) can call this from their map_io, after
+ * da850_init() and before any of those peripherals is registered.
+ * With cpufreq enabled that also gives up the timer 3 clocksource, whose
+ * rate would otherwise change under the timekeeping code.
+ */
+int da850_set_async3_src(int pllnum)
 {
 	struct clk *clk, *newparent = pllnum ? &pll1_sysclk2 : &pll0_sysclk2;
 	struct clk_lookup *c;
 	unsigned int v;
-	int ret;
+	int ret, err = 0;
+
+	if (pllnum < 0 || pllnum > 1)
+		return -EINVAL;
 
 	for (c = da850_clks; c->clk; c++) {
 		clk = c->clk;
 		if (clk->flags & DA850_CLK_ASYNC3) {
 			ret = clk_set_parent(clk, newparent);
-			WARN(ret, "DA850: unable to re-parent clock %s",
-								clk->name);
+			if (WARN(ret, "DA850: unable to re-parent clock %s",
+								clk->name))
+				err = ret;
 		}
-       }
+	}
 
 	v = __raw_readl(DA8XX_SYSCFG0_VIRT(DA8XX_CFGCHIP3_REG));
 	if (pllnum)
@@ -1195,6 +1250,18 @@ static void da850_set_async3_src(int pllnum)
 	else
 		v &= ~CFGCHIP3_ASYNC3_CLKSRC;
 	__raw_writel(v, DA8XX_SYSCFG0_VIRT(DA8XX_CFGCHIP3_REG));
+
+#ifdef CONFIG_CPU_FREQ
+	if (!pllnum)
+		da850_timer_info.clocksource64 = NULL;
+#endif
+
+	if (clk_get_rate(&pll0_sysclk2) != clk_get_rate(&pll1_sysclk2))
+		pr_info("DA850: Async3 now %lu Hz, was %lu Hz\n",
+			clk_get_rate(newparent),
+			clk_get_rate(pllnum ? &pll0_sysclk2 : &pll1_sysclk2));
+
+	return err;
 }
 
 #ifdef CONFIG_CPU_FREQ
@@ -1485,6 +1552,81 @@ int __init da850_register_ecap(char instance)
 		return -EINVAL;
 }
 
+static struct resource da850_ecap_capture_resources[][2] = {
+	{
+		{
+			.start	= DA8XX_ECAP0_BASE,
+			.end	= DA8XX_ECAP0_BASE + 0xfff,
+			.flags	= IORESOURCE_MEM,
+		},
+		{
+			.start	= IRQ_DA8XX_ECAP0,
+			.end	= IRQ_DA8XX_ECAP0,
+			.flags	= IORESOURCE_IRQ,
+		},
+	},
+	{
+		{
+			.start	= DA8XX_ECAP1_BASE,
+			.end	= DA8XX_ECAP1_BASE + 0xfff,
+			.flags	= IORESOURCE_MEM,
+		},
+		{
+			.start	= IRQ_DA8XX_ECAP1,
+			.end	= IRQ_DA8XX_ECAP1,
+			.flags	= IORESOURCE_IRQ,
+		},
+	},
+	{
+		{
+			.start	= DA8XX_ECAP2_BASE,
+			.end	= DA8XX_ECAP2_BASE + 0xfff,
+			.flags	= IORESOURCE_MEM,
+		},
+		{
+			.start	= IRQ_DA8XX_ECAP2,
+			.end	= IRQ_DA8XX_ECAP2,
+			.flags	= IORESOURCE_IRQ,
+		},
+	},
+};
+
+static struct platform_device da850_ecap_capture_devices[] = {
+	{
+		.name		= "ecap_capture",
+		.id		= 0,
+		.resource	= da850_ecap_capture_resources[0],
+		.num_resources	= 2,
+	},
+	{
+		.name		= "ecap_capture",
+		.id		= 1,
+		.resource	= da850_ecap_capture_resources[1],
+		.num_resources	= 2,
+	},
+	{
+		.name		= "ecap_capture",
+		.id		= 2,
+		.resource	= da850_ecap_capture_resources[2],
+		.num_resources	= 2,
+	},
+};
+
+/*
+ * Use an eCAP to timestamp its input pin instead of as a PWM; the board
+ * muxes the pin (DA850_ECAPn_APWMn) and doesn't register the same
+ * instance with da850_register_ecap().
+ */
+int __init da850_register_ecap_capture(unsigned instance,
+		struct davinci_ecap_capture_platform_data *pdata)
+{
+	if (instance >= ARRAY_SIZE(da850_ecap_capture_devices))
+		return -EINVAL;
+
+	da850_ecap_capture_devices[instance].dev.platform_data = pdata;
+	return platform_device_register(&da850_ecap_capture_devices[instance]);
+}
+
 int da850_register_pm(struct platform_device *pdev)
 {
 	int ret;
@@ -1608,7 +1750,7 @@ int __init da850_register_vpif_capture(struct vpif_capture_config
 	return platform_device_register(&da850_vpif_capture_dev);
 }
 
-static struct davinci_soc_info davinci_soc_info_da850 = {
+static struct davinci_soc_info davinci_soc_info_da850 __initdata = {
 	.io_desc		= da850_io_desc,
 	.io_desc_num		= ARRAY_SIZE(da850_io_desc),
 	.ids			= da850_ids,
@@ -1630,6 +1772,9 @@ static struct davinci_soc_info davinci_soc_info_da850 = {
 	.emac_pdata		= &da8xx_emac_pdata,
 	.sram_dma		= DA8XX_ARM_RAM_BASE,
 	.sram_len		= SZ_8K,
+	.sram_carveouts		= da850_sram_carveouts,
+	.dma_pool_ram		= DA8XX_DMA_POOL_RAM,
+	.dma_pool_ram_len	= DA8XX_DMA_POOL_RAM_SIZE,
 };
 
 void __init da850_init(void)
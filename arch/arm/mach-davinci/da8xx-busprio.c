@@ -0,0 +1,424 @@
+/*
+ * DA8xx bus master priorities
+ *
+ * Which master wins the EMIF and the switched central resource is set by
+ * the 3 bit fields of SYSCFG MSTPRI0-2, 0 being the highest priority, and
+ * by the DDR2/mDDR controller's PBBPR, the number of commands after which
+ * an older request is served ahead of newer, higher priority ones.  Left
+ * at their reset values, the ARM and the EDMA can starve the LCDC or the
+ * EMAC under load.
+ *
+ * Boards set priorities with da8xx_set_master_priority() or pick one of
+ * the profiles below with da8xx_set_bus_profile() (or bus_prio=<profile>
+ * on the command line).  At runtime:
+ *
+ *	/sys/devices/system/bus_prio/masters	"<master> <prio>" per line,
+ *						write one such line to change it
+ *	/sys/devices/system/bus_prio/pbbpr	PBBPR old command count, DA850
+ *	/sys/devices/system/bus_prio/profile	available profiles, the one
+ *						last applied in brackets
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/sysdev.h>
+
+#include <mach/cputype.h>
+#include <mach/da8xx.h>
+
+#define DA8XX_MSTPRI_REG(n)		(0x110 + ((n) << 2))
+#define DA8XX_MSTPRI_MAX		7
+
+/* DDR2/mDDR controller, DA850 only */
+#define DDR2_PBBPR			0x20
+#define PBBPR_PR_OLD_COUNT_MASK		0xff
+
+struct da8xx_master {
+	const char	*name;
+	u8		reg;	/* MSTPRIn */
+	u8		shift;
+	bool		da850;	/* not on DA830 */
+};
+
+static const struct da8xx_master da8xx_masters[DA8XX_NR_MASTERS] = {
+	[DA8XX_MASTER_ARM_I]	 = { "arm_i",	  0,  0 },
+	[DA8XX_MASTER_ARM_D]	 = { "arm_d",	  0,  4 },
+	[DA8XX_MASTER_DSP_MDMA]	 = { "dsp_mdma",  0,  8 },
+	[DA8XX_MASTER_DSP_CFG]	 = { "dsp_cfg",	  0, 12 },
+	[DA8XX_MASTER_UPP]	 = { "upp",	  0, 16, true },
+	[DA8XX_MASTER_SATA]	 = { "sata",	  0, 20, true },
+	[DA8XX_MASTER_PRU0]	 = { "pru0",	  1,  0 },
+	[DA8XX_MASTER_PRU1]	 = { "pru1",	  1,  4 },
+	[DA8XX_MASTER_EDMA0_TC0] = { "edma0_tc0", 1,  8 },
+	[DA8XX_MASTER_EDMA0_TC1] = { "edma0_tc1", 1, 12 },
+	[DA8XX_MASTER_EDMA1_TC0] = { "edma1_tc0", 1, 16, true },
+	[DA8XX_MASTER_VPIF_DMA0] = { "vpif_dma0", 1, 24, true },
+	[DA8XX_MASTER_VPIF_DMA1] = { "vpif_dma1", 1, 28, true },
+	[DA8XX_MASTER_EMAC]	 = { "emac",	  2,  0 },
+	[DA8XX_MASTER_USB0_CFG]	 = { "usb0_cfg",  2,  8 },
+	[DA8XX_MASTER_USB0_CDMA] = { "usb0_cdma", 2, 12 },
+	[DA8XX_MASTER_UHPI]	 = { "uhpi",	  2, 20 },
+	[DA8XX_MASTER_USB1]	 = { "usb1",	  2, 24 },
+	[DA8XX_MASTER_LCDC]	 = { "lcdc",	  2, 28 },
+};
+
+struct da8xx_bus_profile {
+	const char			*name;
+	const struct da8xx_master_prio	*prio;
+	int				nr_prio;
+	int				pbbpr;	/* -1: leave alone */
+};
+
+/*
+ * Display first: the LCDC and VPIF have no slack once their FIFOs run
+ * dry, audio EDMA comes next and the ARM last.  A short PBBPR count keeps
+ * the display's long bursts from being held back by row hits of others.
+ */
+static const struct da8xx_master_prio da8xx_display_first[] = {
+	{ DA8XX_MASTER_LCDC,		0 },
+	{ DA8XX_MASTER_VPIF_DMA0,	0 },
+	{ DA8XX_MASTER_VPIF_DMA1,	0 },
+	{ DA8XX_MASTER_EDMA0_TC0,	1 },
+	{ DA8XX_MASTER_EDMA0_TC1,	2 },
+	{ DA8XX_MASTER_EDMA1_TC0,	2 },
+	{ DA8XX_MASTER_EMAC,		3 },
+	{ DA8XX_MASTER_USB0_CDMA,	4 },
+	{ DA8XX_MASTER_USB1,		4 },
+	{ DA8XX_MASTER_ARM_I,		5 },
+	{ DA8XX_MASTER_ARM_D,		5 },
+	{ DA8XX_MASTER_DSP_MDMA,	6 },
+	{ DA8XX_MASTER_DSP_CFG,		6 },
+};
+
+/*
+ * Network first: the EMAC's descriptor and buffer accesses ahead of all
+ * but the LCDC, which still underflows visibly if it waits too long.
+ */
+static const struct da8xx_master_prio da8xx_network_first[] = {
+	{ DA8XX_MASTER_EMAC,		0 },
+	{ DA8XX_MASTER_LCDC,		1 },
+	{ DA8XX_MASTER_EDMA0_TC0,	2 },
+	{ DA8XX_MASTER_EDMA0_TC1,	3 },
+	{ DA8XX_MASTER_EDMA1_TC0,	3 },
+	{ DA8XX_MASTER_ARM_I,		3 },
+	{ DA8XX_MASTER_ARM_D,		3 },
+	{ DA8XX_MASTER_VPIF_DMA0,	4 },
+	{ DA8XX_MASTER_VPIF_DMA1,	4 },
+	{ DA8XX_MASTER_USB0_CDMA,	5 },
+	{ DA8XX_MASTER_USB1,		5 },
+	{ DA8XX_MASTER_DSP_MDMA,	6 },
+	{ DA8XX_MASTER_DSP_CFG,		6 },
+};
+
+/* "default" is what the boot loader and board code set, captured at init */
+static struct da8xx_master_prio da8xx_boot_prio[DA8XX_NR_MASTERS];
+
+static struct da8xx_bus_profile da8xx_bus_profiles[] = {
+	{ "default", da8xx_boot_prio, ARRAY_SIZE(da8xx_boot_prio), -1 },
+	{ "display", da8xx_display_first,
+		ARRAY_SIZE(da8xx_display_first), 0x10 },
+	{ "network", da8xx_network_first,
+		ARRAY_SIZE(da8xx_network_first), 0x20 },
+};
+
+static DEFINE_SPINLOCK(da8xx_busprio_lock);
+static void __iomem *da8xx_busprio_ddr;
+static int da8xx_boot_pbbpr = -1;
+static const char *da8xx_bus_profile_name;
+static char da8xx_bus_profile_param[16] __initdata;
+static const char *da8xx_board_profile __initdata;
+
+static bool da8xx_master_valid(enum da8xx_bus_master master)
+{
+	if ((unsigned)master >= DA8XX_NR_MASTERS)
+		return false;
+	return !da8xx_masters[master].da850 || cpu_is_davinci_da850();
+}
+
+/**
+ * da8xx_get_master_priority() - current priority of a bus master
+ * @master:	DA8XX_MASTER_*
+ *
+ * Returns 0 (highest) to 7, or -EINVAL if the SoC has no such master.
+ */
+int da8xx_get_master_priority(enum da8xx_bus_master master)
+{
+	const struct da8xx_master *m = &da8xx_masters[master];
+
+	if (!da8xx_master_valid(master))
+		return -EINVAL;
+
+	return (__raw_readl(DA8XX_SYSCFG0_VIRT(DA8XX_MSTPRI_REG(m->reg)))
+			>> m->shift) & DA8XX_MSTPRI_MAX;
+}
+
+/**
+ * da8xx_set_master_priority() - set the priority of a bus master
+ * @master:	DA8XX_MASTER_*
+ * @prio:	0 (highest) to 7
+ */
+int da8xx_set_master_priority(enum da8xx_bus_master master, unsigned prio)
+{
+	const struct da8xx_master *m = &da8xx_masters[master];
+	void __iomem *reg;
+	unsigned long flags;
+	u32 val;
+
+	if (!da8xx_master_valid(master) || prio > DA8XX_MSTPRI_MAX)
+		return -EINVAL;
+
+	reg = DA8XX_SYSCFG0_VIRT(DA8XX_MSTPRI_REG(m->reg));
+
+	spin_lock_irqsave(&da8xx_busprio_lock, flags);
+	val = __raw_readl(reg) & ~(DA8XX_MSTPRI_MAX << m->shift);
+	__raw_writel(val | (prio << m->shift), reg);
+	spin_unlock_irqrestore(&da8xx_busprio_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(da8xx_set_master_priority);
+
+/**
+ * da8xx_set_ddr_pbbpr() - set the DDR2/mDDR old command priority count
+ * @count:	commands served before an older one is raised, 0 to 255
+ *
+ * DA850 only.  Lower counts bound the latency of every master at some
+ * cost in row hits, and so in total DDR throughput.
+ */
+int da8xx_set_ddr_pbbpr(unsigned count)
+{
+	if (!da8xx_busprio_ddr)
+		return -ENODEV;
+	if (count > PBBPR_PR_OLD_COUNT_MASK)
+		return -EINVAL;
+
+	__raw_writel(count, da8xx_busprio_ddr + DDR2_PBBPR);
+	return 0;
+}
+EXPORT_SYMBOL(da8xx_set_ddr_pbbpr);
+
+static int da8xx_get_ddr_pbbpr(void)
+{
+	if (!da8xx_busprio_ddr)
+		return -ENODEV;
+
+	return __raw_readl(da8xx_busprio_ddr + DDR2_PBBPR) &
+			PBBPR_PR_OLD_COUNT_MASK;
+}
+
+/**
+ * da8xx_set_bus_profile() - apply a named set of bus priorities
+ * @name:	"default", "display" or "network"
+ *
+ * Masters the SoC doesn't have are skipped.
+ */
+int da8xx_set_bus_profile(const char *name)
+{
+	struct da8xx_bus_profile *p;
+	int i;
+
+	for (p = da8xx_bus_profiles;
+	     p < da8xx_bus_profiles + ARRAY_SIZE(da8xx_bus_profiles); p++) {
+		if (strcmp(p->name, name))
+			continue;
+
+		for (i = 0; i < p->nr_prio; i++)
+			if (da8xx_master_valid(p->prio[i].master))
+				da8xx_set_master_priority(p->prio[i].master,
+							  p->prio[i].prio);
+		if (p->pbbpr >= 0)
+			da8xx_set_ddr_pbbpr(p->pbbpr);
+		else if (da8xx_boot_pbbpr >= 0)
+			da8xx_set_ddr_pbbpr(da8xx_boot_pbbpr);
+
+		da8xx_bus_profile_name = p->name;
+		return 0;
+	}
+
+	return -EINVAL;
+}
+EXPORT_SYMBOL(da8xx_set_bus_profile);
+
+static ssize_t masters_show(struct sysdev_class *cls, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < DA8XX_NR_MASTERS; i++)
+		if (da8xx_master_valid(i))
+			len += sprintf(buf + len, "%s %d\n",
+				       da8xx_masters[i].name,
+				       da8xx_get_master_priority(i));
+	return len;
+}
+
+static ssize_t masters_store(struct sysdev_class *cls, const char *buf,
+			     size_t count)
+{
+	char name[16];
+	unsigned prio;
+	int i, ret;
+
+	if (sscanf(buf, "%15s %u", name, &prio) != 2)
+		return -EINVAL;
+
+	for (i = 0; i < DA8XX_NR_MASTERS; i++)
+		if (!strcmp(da8xx_masters[i].name, name))
+			break;
+	if (i == DA8XX_NR_MASTERS)
+		return -EINVAL;
+
+	ret = da8xx_set_master_priority(i, prio);
+	if (ret)
+		return ret;
+
+	da8xx_bus_profile_name = NULL;
+	return count;
+}
+
+static ssize_t pbbpr_show(struct sysdev_class *cls, char *buf)
+{
+	int val = da8xx_get_ddr_pbbpr();
+
+	if (val < 0)
+		return val;
+	return sprintf(buf, "%d\n", val);
+}
+
+static ssize_t pbbpr_store(struct sysdev_class *cls, const char *buf,
+			   size_t count)
+{
+	unsigned long val;
+	int ret;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+
+	ret = da8xx_set_ddr_pbbpr(val);
+	if (ret)
+		return ret;
+
+	da8xx_bus_profile_name = NULL;
+	return count;
+}
+
+static ssize_t profile_show(struct sysdev_class *cls, char *buf)
+{
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(da8xx_bus_profiles); i++) {
+		const char *name = da8xx_bus_profiles[i].name;
+
+		len += sprintf(buf + len, name == da8xx_bus_profile_name ?
+			       "%s[%s]" : "%s%s", i ? " " : "", name);
+	}
+	len += sprintf(buf + len, "\n");
+	return len;
+}
+
+static ssize_t profile_store(struct sysdev_class *cls, const char *buf,
+			     size_t count)
+{
+	char name[16];
+	int ret;
+
+	if (sscanf(buf, "%15s", name) != 1)
+		return -EINVAL;
+
+	ret = da8xx_set_bus_profile(name);
+	return ret ? ret : count;
+}
+
+static SYSDEV_CLASS_ATTR(masters, S_IRUGO | S_IWUSR, masters_show,
+			 masters_store);
+static SYSDEV_CLASS_ATTR(pbbpr, S_IRUGO | S_IWUSR, pbbpr_show, pbbpr_store);
+static SYSDEV_CLASS_ATTR(profile, S_IRUGO | S_IWUSR, profile_show,
+			 profile_store);
+
+static struct sysdev_class_attribute *da8xx_busprio_attrs[] = {
+	&attr_masters,
+	&attr_pbbpr,
+	&attr_profile,
+};
+
+static struct sysdev_class da8xx_busprio_sysclass = {
+	.name		= "bus_prio",
+};
+
+/**
+ * da8xx_init_bus_prio() - profile for a board to start with
+ * @profile:	profile name, see da8xx_set_bus_profile()
+ *
+ * For board init_machine code, which runs before PBBPR is accessible here.
+ * Applied at device initcall time unless bus_prio= overrides it.
+ */
+void __init da8xx_init_bus_prio(const char *profile)
+{
+	da8xx_board_profile = profile;
+}
+
+static int __init da8xx_bus_prio_setup(char *str)
+{
+	strlcpy(da8xx_bus_profile_param, str,
+		sizeof(da8xx_bus_profile_param));
+	return 1;
+}
+__setup("bus_prio=", da8xx_bus_prio_setup);
+
+/*
+ * Runs after the board's init_machine, so that "default" includes what
+ * the board set up there, and before the board's or bus_prio= profile is
+ * applied.
+ */
+static int __init da8xx_busprio_init(void)
+{
+	const char *profile = da8xx_board_profile;
+	int i, n = 0, ret;
+
+	if (!cpu_is_davinci_da8xx())
+		return -ENODEV;
+
+	if (cpu_is_davinci_da850()) {
+		da8xx_busprio_ddr = da8xx_get_mem_ctlr();
+		da8xx_boot_pbbpr = da8xx_get_ddr_pbbpr();
+	}
+
+	for (i = 0; i < DA8XX_NR_MASTERS; i++) {
+		if (!da8xx_master_valid(i))
+			continue;
+		da8xx_boot_prio[n].master = i;
+		da8xx_boot_prio[n].prio = da8xx_get_master_priority(i);
+		n++;
+	}
+	da8xx_bus_profiles[0].nr_prio = n;
+
+	if (da8xx_bus_profile_param[0])
+		profile = da8xx_bus_profile_param;
+	if (profile && da8xx_set_bus_profile(profile))
+		pr_warning("bus_prio: no profile %s\n", profile);
+
+	ret = sysdev_class_register(&da8xx_busprio_sysclass);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < ARRAY_SIZE(da8xx_busprio_attrs); i++) {
+		ret = sysdev_class_create_file(&da8xx_busprio_sysclass,
+					       da8xx_busprio_attrs[i]);
+		if (ret)
+			pr_warning("bus_prio: no sysfs %s\n",
+				   da8xx_busprio_attrs[i]->attr.name);
+	}
+
+	return 0;
+}
+device_initcall(da8xx_busprio_init);
@@ -0,0 +1,287 @@
+/*
+ * DA8xx DDR2/mDDR controller and EDMA traffic monitor
+ *
+ * Samples the two DDR2 controller performance counters and the EDMA
+ * event queue and transfer controller status every interval_ms, and
+ * reports what accumulated since the last read of perfmon/stats:
+ *
+ *	perfmon/interval_ms	sampling period, 0 stops sampling
+ *	perfmon/ddr_event{1,2}	counter event, e.g. 0 all accesses,
+ *				1 activates, 2 reads, 3 writes
+ *	perfmon/ddr_master{1,2}	count only this master ID (see the SoC
+ *				data manual), or 0xff for all of them
+ *	perfmon/stats		rates and queue occupancy, read and clear
+ *
+ * Running counter 1 unfiltered and counter 2 on one master shows that
+ * master's share of the DDR traffic.
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/io.h>
+#include <linux/timer.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include <mach/cputype.h>
+#include <mach/da8xx.h>
+
+/* DDR2/mDDR controller */
+#define DDR2_PERFCNT(n)			(0x40 + ((n) << 2))
+#define DDR2_PERFCNTCFG			0x48
+#define DDR2_PERFCNTMSTREGSEL		0x4c
+
+#define PERFCNTCFG_CFG(n, ev)		(((ev) & 0xf) << ((n) * 16))
+#define PERFCNTCFG_MSTIDEN(n)		(BIT(15) << ((n) * 16))
+#define PERFCNTMSTREGSEL_MSTID(n, id)	(((id) & 0xff) << (8 + (n) * 16))
+
+#define PERFMON_ALL_MASTERS		0xff
+
+/* EDMA channel controller queues and transfer controllers */
+#define EDMA_QSTAT(q)			(0x600 + ((q) << 2))
+#define QSTAT_NUMVAL(v)			(((v) >> 8) & 0x1f)
+#define EDMA_TCSTAT			0x100
+#define TCSTAT_ACTV			BIT(8)
+#define TCSTAT_DSTACTV(v)		(((v) >> 4) & 0x7)
+
+#define PERFMON_MAX_QUEUES		3
+
+/* the sums are what accumulated since the last read */
+struct perfmon_queue {
+	const char	*name;
+	void __iomem	*cc;
+	unsigned	q;
+	unsigned long	numval_sum;
+	unsigned	numval_max;
+};
+
+struct perfmon_tc {
+	const char	*name;
+	void __iomem	*base;
+	unsigned long	active;
+	unsigned long	dstactv_sum;
+};
+
+static struct perfmon_queue perfmon_queues[PERFMON_MAX_QUEUES];
+static struct perfmon_tc perfmon_tcs[PERFMON_MAX_QUEUES];
+static unsigned perfmon_nr_queues;
+
+static void __iomem *perfmon_ddr;
+static u32 perfmon_interval_ms = 100;
+static u32 perfmon_event[2] = { 0, 0 };
+static u32 perfmon_master[2] = { PERFMON_ALL_MASTERS, PERFMON_ALL_MASTERS };
+static u32 perfmon_cfg, perfmon_sel;
+
+static u32 perfmon_last[2];
+static u64 perfmon_count[2];
+static unsigned long perfmon_samples;
+static unsigned long perfmon_since;
+
+static struct timer_list perfmon_timer;
+static DEFINE_SPINLOCK(perfmon_lock);
+
+/* reprogramming restarts the counts, so only do it when something changed */
+static bool perfmon_program_ddr(void)
+{
+	u32 cfg = 0, sel = 0;
+	int n;
+
+	for (n = 0; n < 2; n++) {
+		cfg |= PERFCNTCFG_CFG(n, perfmon_event[n]);
+		if (perfmon_master[n] != PERFMON_ALL_MASTERS) {
+			cfg |= PERFCNTCFG_MSTIDEN(n);
+			sel |= PERFCNTMSTREGSEL_MSTID(n, perfmon_master[n]);
+		}
+	}
+	if (cfg == perfmon_cfg && sel == perfmon_sel)
+		return false;
+
+	perfmon_cfg = cfg;
+	perfmon_sel = sel;
+	__raw_writel(sel, perfmon_ddr + DDR2_PERFCNTMSTREGSEL);
+	__raw_writel(cfg, perfmon_ddr + DDR2_PERFCNTCFG);
+	for (n = 0; n < 2; n++) {
+		perfmon_last[n] = __raw_readl(perfmon_ddr + DDR2_PERFCNT(n));
+		perfmon_count[n] = 0;
+	}
+	return true;
+}
+
+static void perfmon_sample(unsigned long unused)
+{
+	int i;
+
+	spin_lock(&perfmon_lock);
+
+	if (!perfmon_program_ddr()) {
+		for (i = 0; i < 2; i++) {
+			u32 v = __raw_readl(perfmon_ddr + DDR2_PERFCNT(i));
+
+			/* free running 32-bit counters */
+			perfmon_count[i] += v - perfmon_last[i];
+			perfmon_last[i] = v;
+		}
+	}
+
+	for (i = 0; i < perfmon_nr_queues; i++) {
+		struct perfmon_queue *pq = &perfmon_queues[i];
+		struct perfmon_tc *pt = &perfmon_tcs[i];
+		unsigned numval;
+		u32 tcstat;
+
+		numval = QSTAT_NUMVAL(__raw_readl(pq->cc + EDMA_QSTAT(pq->q)));
+		pq->numval_sum += numval;
+		if (numval > pq->numval_max)
+			pq->numval_max = numval;
+
+		tcstat = __raw_readl(pt->base + EDMA_TCSTAT);
+		if (tcstat & TCSTAT_ACTV)
+			pt->active++;
+		pt->dstactv_sum += TCSTAT_DSTACTV(tcstat);
+	}
+	perfmon_samples++;
+
+	spin_unlock(&perfmon_lock);
+
+	if (perfmon_interval_ms)
+		mod_timer(&perfmon_timer,
+			jiffies + msecs_to_jiffies(perfmon_interval_ms));
+}
+
+static int perfmon_stats_show(struct seq_file *s, void *unused)
+{
+	unsigned long elapsed_ms, samples;
+	int i;
+
+	/* sampling may have been stopped, restart it */
+	if (perfmon_interval_ms && !timer_pending(&perfmon_timer))
+		mod_timer(&perfmon_timer,
+			jiffies + msecs_to_jiffies(perfmon_interval_ms));
+
+	spin_lock_bh(&perfmon_lock);
+
+	elapsed_ms = jiffies_to_msecs(jiffies - perfmon_since) ? : 1;
+	samples = perfmon_samples ? : 1;
+
+	seq_printf(s, "%lu ms, %lu samples\n", elapsed_ms, perfmon_samples);
+	for (i = 0; i < 2; i++) {
+		seq_printf(s, "ddr%d: event %u master ", i + 1,
+				perfmon_event[i]);
+		if (perfmon_master[i] == PERFMON_ALL_MASTERS)
+			seq_printf(s, "all");
+		else
+			seq_printf(s, "0x%02x", perfmon_master[i]);
+		seq_printf(s, ": %llu, %llu/s\n", perfmon_count[i],
+				div_u64(perfmon_count[i] * 1000, elapsed_ms));
+		perfmon_count[i] = 0;
+	}
+
+	seq_printf(s, "queue  avg depth max  tc   active  dst sets\n");
+	for (i = 0; i < perfmon_nr_queues; i++) {
+		struct perfmon_queue *pq = &perfmon_queues[i];
+		struct perfmon_tc *pt = &perfmon_tcs[i];
+
+		seq_printf(s, "%-5s  %5lu.%02lu  %3u  %-3s  %5lu%%  %5lu.%02lu\n",
+			pq->name,
+			pq->numval_sum / samples,
+			pq->numval_sum * 100 / samples % 100,
+			pq->numval_max,
+			pt->name,
+			pt->active * 100 / samples,
+			pt->dstactv_sum / samples,
+			pt->dstactv_sum * 100 / samples % 100);
+		pq->numval_sum = 0;
+		pq->numval_max = 0;
+		pt->active = 0;
+		pt->dstactv_sum = 0;
+	}
+
+	perfmon_samples = 0;
+	perfmon_since = jiffies;
+
+	spin_unlock_bh(&perfmon_lock);
+	return 0;
+}
+
+static int perfmon_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, perfmon_stats_show, NULL);
+}
+
+static const struct file_operations perfmon_stats_fops = {
+	.open		= perfmon_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * Queues and TCs are listed in pairs, but edma_set_queue_tc() can change
+ * which TC serves a queue, so they are sampled and reported separately.
+ */
+static void __init perfmon_add_queue(const char *name, unsigned long cc,
+		unsigned q, const char *tc_name, unsigned long tc)
+{
+	struct perfmon_queue *pq = &perfmon_queues[perfmon_nr_queues];
+	struct perfmon_tc *pt = &perfmon_tcs[perfmon_nr_queues];
+
+	/* all inside the static IO window */
+	pq->name = name;
+	pq->cc = IO_ADDRESS(cc);
+	pq->q = q;
+	pt->name = tc_name;
+	pt->base = IO_ADDRESS(tc);
+	perfmon_nr_queues++;
+}
+
+static int __init da8xx_perfmon_init(void)
+{
+	struct dentry *dir;
+
+	if (!cpu_is_davinci_da8xx())
+		return -ENODEV;
+
+	perfmon_ddr = da8xx_get_mem_ctlr();
+	if (!perfmon_ddr)
+		return -ENOMEM;
+
+	perfmon_add_queue("cc0q0", DA8XX_TPCC_BASE, 0, "tc0", DA8XX_TPTC0_BASE);
+	perfmon_add_queue("cc0q1", DA8XX_TPCC_BASE, 1, "tc1", DA8XX_TPTC1_BASE);
+	if (cpu_is_davinci_da850())
+		perfmon_add_queue("cc1q0", DA850_TPCC1_BASE, 0,
+				"tc2", DA850_TPTC2_BASE);
+
+	dir = debugfs_create_dir("perfmon", NULL);
+	if (IS_ERR_OR_NULL(dir))
+		return -ENOMEM;
+	debugfs_create_u32("interval_ms", S_IRUGO | S_IWUSR, dir,
+			&perfmon_interval_ms);
+	debugfs_create_x32("ddr_event1", S_IRUGO | S_IWUSR, dir,
+			&perfmon_event[0]);
+	debugfs_create_x32("ddr_event2", S_IRUGO | S_IWUSR, dir,
+			&perfmon_event[1]);
+	debugfs_create_x32("ddr_master1", S_IRUGO | S_IWUSR, dir,
+			&perfmon_master[0]);
+	debugfs_create_x32("ddr_master2", S_IRUGO | S_IWUSR, dir,
+			&perfmon_master[1]);
+	debugfs_create_file("stats", S_IRUGO, dir, NULL, &perfmon_stats_fops);
+
+	/* force the first sample to program the counters */
+	perfmon_cfg = ~0;
+	perfmon_since = jiffies;
+	setup_timer(&perfmon_timer, perfmon_sample, 0);
+	mod_timer(&perfmon_timer,
+		jiffies + msecs_to_jiffies(perfmon_interval_ms));
+
+	return 0;
+}
+late_initcall(da8xx_perfmon_init);
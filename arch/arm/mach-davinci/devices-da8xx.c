@@ -16,6 +16,9 @@
 #include <linux/serial_8250.h>
 #include <linux/ti_omapl_pru_suart.h>
 #include <linux/can/platform/ti_omapl_pru_can.h>
+#include <linux/davinci_dsp_ipc.h>
+#include <linux/davinci_upp.h>
+#include <linux/davinci_pru_capture.h>
 
 #include <mach/cputype.h>
 #include <mach/common.h>
@@ -27,11 +30,6 @@
 
 #include "clock.h"
 
-#define DA8XX_TPCC_BASE			0x01c00000
-#define DA850_TPCC1_BASE		0x01e30000
-#define DA8XX_TPTC0_BASE		0x01c08000
-#define DA8XX_TPTC1_BASE		0x01c08400
-#define DA850_TPTC2_BASE		0x01e38000
 #define DA8XX_WDOG_BASE			0x01c21000 /* DA8XX_TIMER64P1_BASE */
 #define DA8XX_I2C0_BASE			0x01c22000
 #define DA8XX_RTC_BASE			0x01C23000
@@ -276,33 +274,29 @@ static const s16 da830_dma_rsv_chans[][2] = {
 	/* (offset, number) */
 	{ 8,  2},
 	{12,  2},
-	{24,  4},
 	{30,  2},
 	{-1, -1}
 };
 
+/* UART event slots stay free for ports that opt into EDMA */
 static const s16 da830_dma_rsv_slots[][2] = {
 	/* (offset, number) */
-	{ 8,  2},
-	{12,  2},
-	{24,  4},
-	{30, 26},
+	{32, 24},
 	{-1, -1}
 };
 
 static const s16 da850_dma0_rsv_chans[][2] = {
 	/* (offset, number) */
 	{ 8,  6},
-	{24,  4},
 	{30,  2},
 	{-1, -1}
 };
 
+/* UART event slots stay free for ports that opt into EDMA */
 static const s16 da850_dma0_rsv_slots[][2] = {
 	/* (offset, number) */
-	{ 8,  6},
-	{24,  4},
-	{30, 50},
+	{10,  2},
+	{32, 48},
 	{-1, -1}
 };
 
@@ -493,6 +487,16 @@ static struct resource da8xx_i2c_resources0[] = {
 		.end	= IRQ_DA8XX_I2CINT0,
 		.flags	= IORESOURCE_IRQ,
 	},
+	{		/* DMA RX: ICREVT0 */
+		.start	= EDMA_CTLR_CHAN(0, 24),
+		.end	= EDMA_CTLR_CHAN(0, 24),
+		.flags	= IORESOURCE_DMA,
+	},
+	{		/* DMA TX: ICXEVT0 */
+		.start	= EDMA_CTLR_CHAN(0, 25),
+		.end	= EDMA_CTLR_CHAN(0, 25),
+		.flags	= IORESOURCE_DMA,
+	},
 };
 
 static struct platform_device da8xx_i2c_device0 = {
@@ -513,6 +517,16 @@ static struct resource da8xx_i2c_resources1[] = {
 		.end	= IRQ_DA8XX_I2CINT1,
 		.flags	= IORESOURCE_IRQ,
 	},
+	{		/* DMA RX: ICREVT1 */
+		.start	= EDMA_CTLR_CHAN(0, 26),
+		.end	= EDMA_CTLR_CHAN(0, 26),
+		.flags	= IORESOURCE_DMA,
+	},
+	{		/* DMA TX: ICXEVT1 */
+		.start	= EDMA_CTLR_CHAN(0, 27),
+		.end	= EDMA_CTLR_CHAN(0, 27),
+		.flags	= IORESOURCE_DMA,
+	},
 };
 
 static struct platform_device da8xx_i2c_device1 = {
@@ -593,6 +607,12 @@ struct emac_platform_data da8xx_emac_pdata = {
 	.mdio_reg_offset	= DA8XX_MDIO_REG_OFFSET,
 	.ctrl_ram_size		= DA8XX_EMAC_CTRL_RAM_SIZE,
 	.version		= EMAC_VERSION_2,
+	.num_tx_ch		= 8,
+	.num_rx_ch		= 2,
+	.rx_mcast_ch		= 1,	/* PTP and other multicast control */
+	.tx_ring_size		= 32,	/* 8 x 32 TX BD's fill half CPPI RAM */
+	.rx_ring_size		= 128,	/* absorb RX bursts, rings in DDR */
+	.bd_ddr			= 1,
 };
 
 static struct platform_device da8xx_emac_device = {
@@ -703,16 +723,26 @@ static struct lcd_ctrl_config lcd_cfg = {
 	.fifo_th		= 6,
 };
 
+/* LCDC master priority in MSTPRI2, 0 being the highest */
+static int da8xx_lcdc_set_priority(unsigned int prio)
+{
+	return da8xx_set_master_priority(DA8XX_MASTER_LCDC, prio);
+}
+
 struct da8xx_lcdc_platform_data sharp_lcd035q3dg01_pdata = {
 	.manu_name		= "sharp",
 	.controller_data	= &lcd_cfg,
 	.type			= "Sharp_LCD035Q3DG01",
+	.set_priority		= da8xx_lcdc_set_priority,
+	.priority		= 0,
 };
 
 struct da8xx_lcdc_platform_data sharp_lk043t1dg01_pdata = {
 	.manu_name		= "sharp",
 	.controller_data	= &lcd_cfg,
 	.type			= "Sharp_LK043T1DG01",
+	.set_priority		= da8xx_lcdc_set_priority,
+	.priority		= 0,
 };
 
 #if !defined(CONFIG_FB_DA8XX) && !defined(CONFIG_FB_DA8XX_MODULE)
@@ -760,11 +790,17 @@ static struct resource da8xx_mmcsd0_resources[] = {
 		.end	= DA8XX_MMCSD0_BASE + SZ_4K - 1,
 		.flags	= IORESOURCE_MEM,
 	},
-	{		/* interrupt */
+	/* IRQs:  MMC/SD, then SDIO */
+	{
 		.start	= IRQ_DA8XX_MMCSDINT0,
 		.end	= IRQ_DA8XX_MMCSDINT0,
 		.flags	= IORESOURCE_IRQ,
 	},
+	{
+		.start	= IRQ_DA8XX_MMCSDINT1,
+		.end	= IRQ_DA8XX_MMCSDINT1,
+		.flags	= IORESOURCE_IRQ,
+	},
 	{		/* DMA RX */
 		.start	= EDMA_CTLR_CHAN(0, 16),
 		.end	= EDMA_CTLR_CHAN(0, 16),
@@ -871,9 +907,170 @@ int __init da8xx_register_cpuidle(void)
 {
 	da8xx_cpuidle_pdata.ddr2_ctlr_base = da8xx_get_mem_ctlr();
 
+	/* DDR2 is on PLL1 on DA850, so PLL0 can be bypassed while idle */
+	if (cpu_is_davinci_da850()) {
+		da8xx_cpuidle_pdata.cpupll_reg_base =
+				ioremap(DA8XX_PLL0_BASE, SZ_4K);
+		if (!da8xx_cpuidle_pdata.cpupll_reg_base)
+			pr_warning("%s: Unable to map PLL0", __func__);
+	}
+
 	return platform_device_register(&da8xx_cpuidle_device);
 }
 
+static struct resource da850_dsp_ipc_resources[] = {
+	{	/* shared carve-out, filled in at registration */
+		.flags		= IORESOURCE_MEM,
+	},
+	{
+		/* CHIPSIG and CHIPSIG_CLR */
+		.start		= DA8XX_SYSCFG0_BASE + DA8XX_CHIPSIG_REG,
+		.end		= DA8XX_SYSCFG0_BASE + DA8XX_CHIPSIG_REG + 0x7,
+		.flags		= IORESOURCE_MEM,
+	},
+	{
+		.start		= IRQ_DA8XX_CHIPINT0,
+		.end		= IRQ_DA8XX_CHIPINT0,
+		.flags		= IORESOURCE_IRQ,
+	},
+};
+
+/* CHIPSIG0 raises CHIPINT0 on the ARM, CHIPSIG2 raises CHIPINT2 on the DSP */
+static struct davinci_dsp_ipc_platform_data da850_dsp_ipc_pdata = {
+	.arm_sig	= 0,
+	.dsp_sig	= 2,
+};
+
+static struct platform_device da850_dsp_ipc_device = {
+	.name			= "davinci-dsp-ipc",
+	.id			= -1,
+	.num_resources		= ARRAY_SIZE(da850_dsp_ipc_resources),
+	.resource		= da850_dsp_ipc_resources,
+	.dev = {
+		.platform_data	= &da850_dsp_ipc_pdata,
+	},
+};
+
+/*
+ * The carve-out must be kept out of the kernel's memory, e.g. with mem=,
+ * and agree with the DSP firmware's memory map.
+ */
+int __init da850_register_dsp_ipc(resource_size_t base, resource_size_t size)
+{
+	da850_dsp_ipc_resources[0].start = base;
+	da850_dsp_ipc_resources[0].end = base + size - 1;
+
+	return platform_device_register(&da850_dsp_ipc_device);
+}
+
+/*
+ * SYSCFG0 for the DSP boot address, then the memories a DSP image may
+ * load into, by their global addresses: L2, L1P, L1D and the board's DDR
+ * for the DSP, if any.  Shared RAM is left out, the ARM allocates from it.
+ */
+static struct resource da850_dsp_loader_resources[] = {
+	{
+		.start		= DA8XX_SYSCFG0_BASE,
+		.end		= DA8XX_SYSCFG0_BASE + SZ_4K - 1,
+		.flags		= IORESOURCE_MEM,
+	},
+	{
+		.start		= 0x11800000,
+		.end		= 0x11800000 + SZ_256K - 1,
+		.flags		= IORESOURCE_MEM,
+	},
+	{
+		.start		= 0x11e00000,
+		.end		= 0x11e00000 + SZ_32K - 1,
+		.flags		= IORESOURCE_MEM,
+	},
+	{
+		.start		= 0x11f00000,
+		.end		= 0x11f00000 + SZ_32K - 1,
+		.flags		= IORESOURCE_MEM,
+	},
+	{	/* DDR, filled in at registration */
+		.flags		= IORESOURCE_MEM,
+	},
+};
+
+static struct platform_device da850_dsp_loader_device = {
+	.name			= "davinci-dsp-loader",
+	.id			= -1,
+	.num_resources		= ARRAY_SIZE(da850_dsp_loader_resources) - 1,
+	.resource		= da850_dsp_loader_resources,
+};
+
+/* ddr_size may be 0; otherwise that DDR must be kept from the kernel */
+int __init da850_register_dsp_loader(resource_size_t ddr_base,
+		resource_size_t ddr_size)
+{
+	if (ddr_size) {
+		struct resource *ddr = &da850_dsp_loader_resources[
+				ARRAY_SIZE(da850_dsp_loader_resources) - 1];
+
+		ddr->start = ddr_base;
+		ddr->end = ddr_base + ddr_size - 1;
+		da850_dsp_loader_device.num_resources++;
+	}
+	return platform_device_register(&da850_dsp_loader_device);
+}
+
+static struct resource da850_upp_resources[] = {
+	{
+		.start		= DA850_UPP_BASE,
+		.end		= DA850_UPP_BASE + SZ_4K - 1,
+		.flags		= IORESOURCE_MEM,
+	},
+	{
+		.start		= IRQ_DA850_UPPINT,
+		.end		= IRQ_DA850_UPPINT,
+		.flags		= IORESOURCE_IRQ,
+	},
+};
+
+static u64 da850_upp_dma_mask = DMA_BIT_MASK(32);
+
+static struct platform_device da850_upp_device = {
+	.name			= "davinci-upp",
+	.id			= -1,
+	.num_resources		= ARRAY_SIZE(da850_upp_resources),
+	.resource		= da850_upp_resources,
+	.dev = {
+		.dma_mask		= &da850_upp_dma_mask,
+		.coherent_dma_mask	= DMA_BIT_MASK(32),
+	},
+};
+
+/* The board sets up the uPP pin multiplexing for the channels it uses. */
+int __init da850_register_upp(struct davinci_upp_platform_data *pdata)
+{
+	da850_upp_device.dev.platform_data = pdata;
+	return platform_device_register(&da850_upp_device);
+}
+
+static u64 da8xx_pru_capture_dma_mask = DMA_BIT_MASK(32);
+
+static struct platform_device da8xx_pru_capture_device = {
+	.name			= "davinci-pru-capture",
+	.id			= -1,
+	.dev = {
+		.dma_mask		= &da8xx_pru_capture_dma_mask,
+		.coherent_dma_mask	= DMA_BIT_MASK(32),
+	},
+};
+
+/*
+ * The board muxes the sampled pins to the core's R31 inputs and picks an
+ * event and host interrupt no other PRU driver uses.
+ */
+int __init da8xx_register_pru_capture(
+		struct davinci_pru_capture_platform_data *pdata)
+{
+	da8xx_pru_capture_device.dev.platform_data = pdata;
+	return platform_device_register(&da8xx_pru_capture_device);
+}
+
 static struct davinci_spi_platform_data da850_spi1_pdata = {
 	.version 	= SPI_VERSION_2,
 	.num_chipselect = 1,
@@ -937,6 +1134,13 @@ void __init da850_init_spi1(unsigned chipselect_mask,
 	platform_device_register(&da850_spi1_device);
 }
 
+/* SPI1 as a receive-only slave of an external master */
+void __init da850_init_spi1_slave(struct davinci_spi_slave_config *cfg)
+{
+	da850_spi1_pdata.slave = cfg;
+	platform_device_register(&da850_spi1_device);
+}
+
 static struct davinci_spi_platform_data da830_spi0_pdata = {
 	.version 	= SPI_VERSION_2,
 	.num_chipselect = 1,
@@ -1247,6 +1451,11 @@ static struct resource da8xx_usb11_resources[] = {
 		.end	= IRQ_DA8XX_IRQN,
 		.flags	= IORESOURCE_IRQ,
 	},
+	[2] = {		/* shared RAM for the HCCA and ED/TD pools */
+		.start	= DA8XX_OHCI_DESC_RAM,
+		.end	= DA8XX_OHCI_DESC_RAM + DA8XX_OHCI_DESC_RAM_SIZE - 1,
+		.flags	= IORESOURCE_MEM,
+	},
 };
 
 static u64 da8xx_usb11_dma_mask = DMA_BIT_MASK(32);
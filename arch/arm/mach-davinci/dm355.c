@@ -747,7 +747,7 @@ void dm355_set_vpfe_config(struct vpfe_config *cfg)
 
 /*----------------------------------------------------------------------*/
 
-static struct map_desc dm355_io_desc[] = {
+static struct map_desc dm355_io_desc[] __initdata = {
 	{
 		.virtual	= IO_VIRT,
 		.pfn		= __phys_to_pfn(IO_PHYS),
@@ -764,7 +764,7 @@ static struct map_desc dm355_io_desc[] = {
 };
 
 /* Contents of JTAG ID register used to identify exact cpu type */
-static struct davinci_id dm355_ids[] = {
+static struct davinci_id dm355_ids[] __initdata = {
 	{
 		.variant	= 0x0,
 		.part_no	= 0xb73b,
@@ -828,7 +828,7 @@ static struct platform_device dm355_serial_device = {
 	},
 };
 
-static struct davinci_soc_info davinci_soc_info_dm355 = {
+static struct davinci_soc_info davinci_soc_info_dm355 __initdata = {
 	.io_desc		= dm355_io_desc,
 	.io_desc_num		= ARRAY_SIZE(dm355_io_desc),
 	.jtag_id_base		= IO_ADDRESS(0x01c40028),
@@ -854,7 +854,7 @@ static struct platform_device dm365_rtc_device = {
 	.resource = dm365_rtc_resources,
 };
 
-static struct map_desc dm365_io_desc[] = {
+static struct map_desc dm365_io_desc[] __initdata = {
 	{
 		.virtual	= IO_VIRT,
 		.pfn		= __phys_to_pfn(IO_PHYS),
@@ -893,7 +893,7 @@ static struct platform_device dm365_ks_device = {
 };
 
 /* Contents of JTAG ID register used to identify exact cpu type */
-static struct davinci_id dm365_ids[] = {
+static struct davinci_id dm365_ids[] __initdata = {
 	{
 		.variant	= 0x0,
 		.part_no	= 0xb83e,
@@ -950,7 +950,7 @@ static struct platform_device dm365_serial_device = {
 	},
 };
 
-static struct davinci_soc_info davinci_soc_info_dm365 = {
+static struct davinci_soc_info davinci_soc_info_dm365 __initdata = {
 	.io_desc		= dm365_io_desc,
 	.io_desc_num		= ARRAY_SIZE(dm365_io_desc),
 	.jtag_id_base		= IO_ADDRESS(0x01c40028),
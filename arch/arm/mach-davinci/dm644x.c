@@ -645,7 +645,7 @@ void dm644x_set_vpfe_config(struct vpfe_config *cfg)
 
 /*----------------------------------------------------------------------*/
 
-static struct map_desc dm644x_io_desc[] = {
+static struct map_desc dm644x_io_desc[] __initdata = {
 	{
 		.virtual	= IO_VIRT,
 		.pfn		= __phys_to_pfn(IO_PHYS),
@@ -662,7 +662,7 @@ static struct map_desc dm644x_io_desc[] = {
 };
 
 /* Contents of JTAG ID register used to identify exact cpu type */
-static struct davinci_id dm644x_ids[] = {
+static struct davinci_id dm644x_ids[] __initdata = {
 	{
 		.variant	= 0x0,
 		.part_no	= 0xb700,
@@ -688,11 +688,14 @@ static void __iomem *dm644x_psc_bases[] = {
  * T0_TOP: Timer 0, top   :  clocksource for generic timekeeping
  * T1_BOT: Timer 1, bottom:  (used by DSP in TI DSPLink code)
  * T1_TOP: Timer 1, top   :  <unused>
+ * Timer 1 doubles as the oprofile sampling timer when the DSP leaves it.
  */
 struct davinci_timer_info dm644x_timer_info = {
 	.timers		= davinci_timer_instance,
 	.clockevent_id	= T0_BOT,
 	.clocksource_id	= T0_TOP,
+	.profile	= &davinci_timer_instance[1],
+	.profile_clk	= "timer1",
 };
 
 static struct plat_serial8250_port dm644x_serial_platform_data[] = {
@@ -733,7 +736,7 @@ static struct platform_device dm644x_serial_device = {
 	},
 };
 
-static struct davinci_soc_info davinci_soc_info_dm644x = {
+static struct davinci_soc_info davinci_soc_info_dm644x __initdata = {
 	.io_desc		= dm644x_io_desc,
 	.io_desc_num		= ARRAY_SIZE(dm644x_io_desc),
 	.jtag_id_base		= IO_ADDRESS(0x01c40028),
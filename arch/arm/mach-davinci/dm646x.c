@@ -785,7 +785,7 @@ static struct platform_device vpif_capture_dev = {
 
 /*----------------------------------------------------------------------*/
 
-static struct map_desc dm646x_io_desc[] = {
+static struct map_desc dm646x_io_desc[] __initdata = {
 	{
 		.virtual	= IO_VIRT,
 		.pfn		= __phys_to_pfn(IO_PHYS),
@@ -802,7 +802,7 @@ static struct map_desc dm646x_io_desc[] = {
 };
 
 /* Contents of JTAG ID register used to identify exact cpu type */
-static struct davinci_id dm646x_ids[] = {
+static struct davinci_id dm646x_ids[] __initdata = {
 	{
 		.variant	= 0x0,
 		.part_no	= 0xb770,
@@ -873,7 +873,7 @@ static struct platform_device dm646x_serial_device = {
 	},
 };
 
-static struct davinci_soc_info davinci_soc_info_dm646x = {
+static struct davinci_soc_info davinci_soc_info_dm646x __initdata = {
 	.io_desc		= dm646x_io_desc,
 	.io_desc_num		= ARRAY_SIZE(dm646x_io_desc),
 	.jtag_id_base		= IO_ADDRESS(0x01c40028),
@@ -0,0 +1,115 @@
+/*
+ * mach-davinci/dma-pool.c - platform-wide small coherent DMA buffers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/string.h>
+#include <linux/platform_device.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmapool.h>
+
+#include <mach/common.h>
+#include <mach/dma-pool.h>
+
+/*
+ * One dma_pool per power-of-two size class from a cache line up, all on
+ * one platform device.  Their pages come from the SoC's on-chip RAM while
+ * it lasts, then from the consistent mapping as usual.
+ */
+#define DMA_POOL_MIN_SHIFT	5
+#define DMA_POOL_CLASSES	(ilog2(DAVINCI_DMA_POOL_MAX) - \
+					DMA_POOL_MIN_SHIFT + 1)
+
+static struct dma_pool *davinci_dma_pools[DMA_POOL_CLASSES];
+
+static u64 davinci_dma_pool_mask = DMA_BIT_MASK(32);
+
+static struct platform_device davinci_dma_pool_device = {
+	.name		= "davinci-dma-pool",
+	.id		= -1,
+	.dev = {
+		.dma_mask		= &davinci_dma_pool_mask,
+		.coherent_dma_mask	= DMA_BIT_MASK(32),
+	},
+};
+
+static struct dma_pool *davinci_dma_pool_get(size_t size)
+{
+	if (size > DAVINCI_DMA_POOL_MAX)
+		return NULL;
+	if (size <= (1 << DMA_POOL_MIN_SHIFT))
+		return davinci_dma_pools[0];
+	return davinci_dma_pools[order_base_2(size) - DMA_POOL_MIN_SHIFT];
+}
+
+/**
+ * davinci_dma_pool_alloc - get a small, zeroed coherent DMA buffer
+ * @size: size in bytes
+ * @gfp: allocation flags
+ * @dma: returns the DMA address of the buffer
+ *
+ * The buffer is aligned to its size rounded up to a power of two. Sizes
+ * above DAVINCI_DMA_POOL_MAX are passed on to dma_alloc_coherent().
+ */
+void *davinci_dma_pool_alloc(size_t size, gfp_t gfp, dma_addr_t *dma)
+{
+	struct dma_pool *pool = davinci_dma_pool_get(size);
+	void *vaddr;
+
+	if (!pool)
+		return dma_alloc_coherent(&davinci_dma_pool_device.dev, size,
+					  dma, gfp);
+
+	vaddr = dma_pool_alloc(pool, gfp, dma);
+	if (vaddr)
+		memset(vaddr, 0, size);
+	return vaddr;
+}
+EXPORT_SYMBOL(davinci_dma_pool_alloc);
+
+void davinci_dma_pool_free(size_t size, void *vaddr, dma_addr_t dma)
+{
+	struct dma_pool *pool = davinci_dma_pool_get(size);
+
+	if (!pool)
+		dma_free_coherent(&davinci_dma_pool_device.dev, size, vaddr,
+				  dma);
+	else
+		dma_pool_free(pool, vaddr, dma);
+}
+EXPORT_SYMBOL(davinci_dma_pool_free);
+
+static int __init davinci_dma_pool_init(void)
+{
+	struct device *dev = &davinci_dma_pool_device.dev;
+	dma_addr_t ram = davinci_soc_info.dma_pool_ram;
+	unsigned len = davinci_soc_info.dma_pool_ram_len;
+	char name[16];
+	size_t size;
+	int i, ret;
+
+	ret = platform_device_register(&davinci_dma_pool_device);
+	if (ret)
+		return ret;
+
+	if (len && dma_declare_coherent_memory(dev, ram, ram, len,
+					DMA_MEMORY_MAP) != DMA_MEMORY_MAP)
+		pr_warning("davinci: no on-chip RAM for the DMA pools\n");
+
+	/* a class without a pool falls back to dma_alloc_coherent() */
+	for (i = 0; i < DMA_POOL_CLASSES; i++) {
+		size = 1 << (DMA_POOL_MIN_SHIFT + i);
+		snprintf(name, sizeof(name), "davinci%zu", size);
+		davinci_dma_pools[i] = dma_pool_create(name, dev, size, size,
+						       0);
+	}
+
+	return 0;
+}
+postcore_initcall(davinci_dma_pool_init);
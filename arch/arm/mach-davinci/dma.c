@@ -23,6 +23,14 @@
 #include <linux/interrupt.h>
 #include <linux/platform_device.h>
 #include <linux/io.h>
+#include <linux/scatterlist.h>
+#include <linux/spinlock.h>
+#include <linux/log2.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
 
 #include <mach/edma.h>
 
@@ -80,7 +88,7 @@
 #define EDMA_DRAE	0x0340	/* 4 x 64 bits*/
 #define EDMA_QRAE	0x0380	/* 4 registers */
 #define EDMA_QUEEVTENTRY	0x0400	/* 2 x 16 registers */
-#define EDMA_QSTAT	0x0600	/* 2 registers */
+#define EDMA_QSTAT	0x0600	/* 8 registers */
 #define EDMA_QWMTHRA	0x0620
 #define EDMA_QWMTHRB	0x0624
 #define EDMA_CCSTAT	0x0640
@@ -96,8 +104,15 @@
 #define EDMA_DCHMAP	0x0100  /* 64 registers */
 #define CHMAP_EXIST	BIT(24)
 
+/* QDMA channel mapping: PaRAM set and the word whose write triggers it */
+#define QCHMAP_PAENTRY(slot)	((slot) << 5)
+#define QCHMAP_TRWORD(offset)	(offset)	/* word index in bits 4:2 */
+
 #define EDMA_MAX_DMACH           64
+#define EDMA_NUM_QDMACH		8
 #define EDMA_MAX_PARAMENTRY     512
+#define EDMA_MAX_CCNT           0xffff
+#define EDMA_SLOT_ORDERS        10	/* blocks of up to 512 slots */
 #define EDMA_MAX_CC               2
 
 
@@ -220,6 +235,16 @@ static inline void clear_bits(int offset, int len, unsigned long *p)
 
 /*****************************************************************************/
 
+struct dma_interrupt_data {
+	void (*callback)(unsigned channel, unsigned short ch_status,
+			void *data);
+	void *data;
+	unsigned flags;			/* EDMA_CB_* */
+	unsigned long completions;
+	u64 handler_ns;
+	u32 handler_max_ns;
+};
+
 /* actual number of DMA channels and slots on this silicon */
 struct edma {
 	/* how many dma resources of each type */
@@ -235,25 +260,62 @@ struct edma {
 
 	/* The edma_inuse bit for each PaRAM slot is clear unless the
 	 * channel is in use ... by ARM or DSP, for QDMA, or whatever.
+	 * Above the channel slots it only marks reserved slots; the
+	 * others are tracked by the slot allocator below.
+	 *
+	 * This and the other per-slot and per-channel arrays are sized
+	 * for num_slots and num_channels, see edma_alloc_cc().
 	 */
-	DECLARE_BITMAP(edma_inuse, EDMA_MAX_PARAMENTRY);
+	unsigned long	*edma_inuse;
+
+	/* buddy allocator state for the non-channel slots */
+	spinlock_t	slot_lock;
+	s16		slot_free[EDMA_SLOT_ORDERS];
+	unsigned	slot_nr_free[EDMA_SLOT_ORDERS];
+	s16		*slot_next;
+	s16		*slot_prev;
+	s8		*slot_order;
+	unsigned	slots_free;
+	unsigned long	slot_allocs;
+	unsigned long	slot_fails;
 
 	/* The edma_unused bit for each channel is clear unless
 	 * it is not being used on this platform. It uses a bit
 	 * of SOC-specific initialization code.
 	 */
-	DECLARE_BITMAP(edma_unused, EDMA_MAX_DMACH);
+	unsigned long	*edma_unused;
+
+	/* QDMA channels handed out, and the DMA channel each is bound to */
+	unsigned long	qdma_inuse;
+	s8		qdma_chan[EDMA_NUM_QDMACH];
 
 	unsigned	irq_res_start;
 	unsigned	irq_res_end;
 
-	struct dma_interrupt_data {
-		void (*callback)(unsigned channel, unsigned short ch_status,
-				void *data);
-		void *data;
-	} intr_data[EDMA_MAX_DMACH];
+	struct dma_interrupt_data *intr_data;
+
+	/* completion dispatch, see edma_set_callback_flags() */
+	spinlock_t	defer_lock;
+	u32		prio_mask[2];
+	u32		defer_mask[2];
+	u32		defer_pending[2];
+	struct tasklet_struct	defer_tasklet;
+	struct tasklet_struct	defer_hi_tasklet;
+	struct task_struct	*defer_thread;	/* replaces both, defer_prio */
+
+	struct edma_context	*ctx;	/* hibernation save area */
 };
 
+/*
+ * With defer_prio set, deferred callbacks run in one SCHED_FIFO thread per
+ * channel controller at that priority instead of in tasklets, so they can
+ * be ranked against application realtime tasks.
+ */
+static int defer_prio;
+module_param(defer_prio, int, S_IRUGO);
+MODULE_PARM_DESC(defer_prio, "EDMA deferred callback thread SCHED_FIFO "
+		 "priority, 0 = tasklets");
+
 static struct edma *edma_info[EDMA_MAX_CC];
 static int arch_num_cc;
 
@@ -279,13 +341,13 @@ static void map_dmach_queue(unsigned ctlr, unsigned ch_no,
 			~(0x7 << bit), queue_no << bit);
 }
 
-static void __init map_queue_tc(unsigned ctlr, int queue_no, int tc_no)
+static void map_queue_tc(unsigned ctlr, int queue_no, int tc_no)
 {
 	int bit = queue_no * 4;
 	edma_modify(ctlr, EDMA_QUETCMAP, ~(0x7 << bit), ((tc_no & 0x7) << bit));
 }
 
-static void __init assign_priority_to_queue(unsigned ctlr, int queue_no,
+static void assign_priority_to_queue(unsigned ctlr, int queue_no,
 		int priority)
 {
 	int bit = queue_no * 4;
@@ -324,6 +386,7 @@ setup_dma_interrupt(unsigned lch,
 	if (!callback) {
 		edma_shadow0_write_array(ctlr, SH_IECR, lch >> 5,
 				(1 << (lch & 0x1f)));
+		edma_set_callback_flags(EDMA_CTLR_CHAN(ctlr, lch), 0);
 	}
 
 	edma_info[ctlr]->intr_data[lch].callback = callback;
@@ -354,49 +417,155 @@ static int irq2ctlr(int irq)
  * DMA interrupt handler
  *
  *****************************************************************************/
+static inline void edma_callback(unsigned ctlr, unsigned k, u16 ch_status)
+{
+	struct dma_interrupt_data *intr = &edma_info[ctlr]->intr_data[k];
+#ifdef CONFIG_DEBUG_FS
+	ktime_t start;
+	u32 ns;
+#endif
+
+	if (!intr->callback)
+		return;
+
+#ifdef CONFIG_DEBUG_FS
+	start = ktime_get();
+	intr->callback(EDMA_CTLR_CHAN(ctlr, k), ch_status, intr->data);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	intr->handler_ns += ns;
+	if (ns > intr->handler_max_ns)
+		intr->handler_max_ns = ns;
+#else
+	intr->callback(EDMA_CTLR_CHAN(ctlr, k), ch_status, intr->data);
+#endif
+	intr->completions++;
+}
+
+static void edma_dispatch(unsigned ctlr, unsigned j, u32 pending)
+{
+	unsigned k;
+
+	while (pending) {
+		k = __ffs(pending);
+		pending &= pending - 1;
+		edma_callback(ctlr, (j << 5) + k, DMA_COMPLETE);
+	}
+}
+
+/*
+ * Deferred completions are coalesced per channel: several completions
+ * before the tasklet runs are reported with one callback.
+ */
+static void edma_defer_run(unsigned ctlr, bool hi)
+{
+	struct edma *cc = edma_info[ctlr];
+	unsigned long flags;
+	u32 pending;
+	int j;
+
+	for (j = 0; j < 2; j++) {
+		spin_lock_irqsave(&cc->defer_lock, flags);
+		pending = cc->defer_pending[j] &
+			(hi ? cc->prio_mask[j] : ~cc->prio_mask[j]);
+		cc->defer_pending[j] &= ~pending;
+		spin_unlock_irqrestore(&cc->defer_lock, flags);
+
+		edma_dispatch(ctlr, j, pending);
+	}
+}
+
+static void edma_defer_tasklet(unsigned long ctlr)
+{
+	edma_defer_run(ctlr, false);
+}
+
+static void edma_defer_hi_tasklet(unsigned long ctlr)
+{
+	edma_defer_run(ctlr, true);
+}
+
+static int edma_defer_thread(void *data)
+{
+	unsigned ctlr = (unsigned long)data;
+	struct edma *cc = edma_info[ctlr];
+	struct sched_param param = {
+		.sched_priority = min(defer_prio, MAX_USER_RT_PRIO - 1),
+	};
+
+	sched_setscheduler(current, SCHED_FIFO, &param);
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!ACCESS_ONCE(cc->defer_pending[0]) &&
+		    !ACCESS_ONCE(cc->defer_pending[1]))
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		/* callbacks get the context the tasklets gave them */
+		local_bh_disable();
+		edma_defer_run(ctlr, true);
+		edma_defer_run(ctlr, false);
+		local_bh_enable();
+	}
+	return 0;
+}
+
 static irqreturn_t dma_irq_handler(int irq, void *data)
 {
-	int i;
+	struct edma *cc;
 	unsigned ctlr;
-	unsigned int cnt = 0;
+	u32 ipr[2], defer, prio;
+	bool hi = false, lo = false;
+	int j;
 
 	ctlr = irq2ctlr(irq);
+	cc = edma_info[ctlr];
 
-	dev_dbg(data, "dma_irq_handler\n");
-
-	if ((edma_shadow0_read_array(ctlr, SH_IPR, 0) == 0)
-	    && (edma_shadow0_read_array(ctlr, SH_IPR, 1) == 0))
+	ipr[0] = edma_shadow0_read_array(ctlr, SH_IPR, 0);
+	ipr[1] = edma_shadow0_read_array(ctlr, SH_IPR, 1);
+	if (!ipr[0] && !ipr[1])
 		return IRQ_NONE;
 
-	while (1) {
-		int j;
-		if (edma_shadow0_read_array(ctlr, SH_IPR, 0))
-			j = 0;
-		else if (edma_shadow0_read_array(ctlr, SH_IPR, 1))
-			j = 1;
-		else
-			break;
-		dev_dbg(data, "IPR%d %08x\n", j,
-				edma_shadow0_read_array(ctlr, SH_IPR, j));
-		for (i = 0; i < 32; i++) {
-			int k = (j << 5) + i;
-			if (edma_shadow0_read_array(ctlr, SH_IPR, j) &
-							(1 << i)) {
-				/* Clear the corresponding IPR bits */
-				edma_shadow0_write_array(ctlr, SH_ICR, j,
-							(1 << i));
-				if (edma_info[ctlr]->intr_data[k].callback) {
-					edma_info[ctlr]->intr_data[k].callback(
-						k, DMA_COMPLETE,
-						edma_info[ctlr]->intr_data[k].
-						data);
-				}
-			}
+	dev_dbg(data, "dma_irq_handler IPR %08x %08x\n", ipr[0], ipr[1]);
+
+	/* Ack first, so completions raised by the callbacks are not lost */
+	for (j = 0; j < 2; j++)
+		if (ipr[j])
+			edma_shadow0_write_array(ctlr, SH_ICR, j, ipr[j]);
+
+	spin_lock(&cc->defer_lock);
+	for (j = 0; j < 2; j++) {
+		defer = ipr[j] & cc->defer_mask[j];
+		if (defer) {
+			cc->defer_pending[j] |= defer;
+			if (defer & cc->prio_mask[j])
+				hi = true;
+			if (defer & ~cc->prio_mask[j])
+				lo = true;
+			ipr[j] &= ~defer;
 		}
-		cnt++;
-		if (cnt > 10)
-			break;
 	}
+	spin_unlock(&cc->defer_lock);
+
+	if (cc->defer_thread) {
+		if (hi || lo)
+			wake_up_process(cc->defer_thread);
+	} else {
+		if (hi)
+			tasklet_hi_schedule(&cc->defer_hi_tasklet);
+		if (lo)
+			tasklet_schedule(&cc->defer_tasklet);
+	}
+
+	/* latency critical channels first, then everyone else */
+	for (j = 0; j < 2; j++) {
+		prio = ipr[j] & cc->prio_mask[j];
+		edma_dispatch(ctlr, j, prio);
+		ipr[j] &= ~prio;
+	}
+	for (j = 0; j < 2; j++)
+		edma_dispatch(ctlr, j, ipr[j]);
+
+	/* anything that arrived meanwhile raises the interrupt again */
 	edma_shadow0_write(ctlr, SH_IEVAL, 1);
 	return IRQ_HANDLED;
 }
@@ -408,7 +577,7 @@ static irqreturn_t dma_irq_handler(int irq, void *data)
  *****************************************************************************/
 static irqreturn_t dma_ccerr_handler(int irq, void *data)
 {
-	int i;
+	int i, k;
 	unsigned ctlr;
 	unsigned int cnt = 0;
 
@@ -441,14 +610,7 @@ static irqreturn_t dma_ccerr_handler(int irq, void *data)
 					/* Clear any SER */
 					edma_shadow0_write_array(ctlr, SH_SECR,
 								j, (1 << i));
-					if (edma_info[ctlr]->intr_data[k].
-								callback) {
-						edma_info[ctlr]->intr_data[k].
-						callback(k,
-						DMA_CC_ERROR,
-						edma_info[ctlr]->intr_data
-						[k].data);
-					}
+					edma_callback(ctlr, k, DMA_CC_ERROR);
 				}
 			}
 		} else if (edma_read(ctlr, EDMA_QEMR)) {
@@ -460,8 +622,10 @@ static irqreturn_t dma_ccerr_handler(int irq, void *data)
 					edma_write(ctlr, EDMA_QEMCR, 1 << i);
 					edma_shadow0_write(ctlr, SH_QSECR,
 								(1 << i));
-
-					/* NOTE:  not reported!! */
+					k = edma_info[ctlr]->qdma_chan[i];
+					if (k >= 0)
+						edma_callback(ctlr, k,
+							DMA_CC_ERROR);
 				}
 			}
 		} else if (edma_read(ctlr, EDMA_CCERR)) {
@@ -513,61 +677,272 @@ static irqreturn_t dma_tc1err_handler(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
-static int reserve_contiguous_slots(int ctlr, unsigned int id,
-				     unsigned int num_slots,
-				     unsigned int start_slot)
+/*
+ * PaRAM slot allocator
+ *
+ * Slots above the channel slots are handed out by a buddy allocator.
+ * Free blocks of 2^order slots sit on per-order lists threaded through
+ * slot_next[]/slot_prev[]; slot_order[] holds the order of a free block
+ * at its first slot and -1 everywhere else.  Every free slot already
+ * holds the dummy param set (it is rewritten when the slot is freed), so
+ * allocation never touches PaRAM and costs O(log n) list operations.
+ *
+ * Reserved slots never enter the lists.  All of this is protected by
+ * the controller's slot_lock.
+ */
+
+static void slot_list_add(struct edma *cc, int slot, int order)
+{
+	int head = cc->slot_free[order];
+
+	cc->slot_next[slot] = head;
+	cc->slot_prev[slot] = -1;
+	if (head >= 0)
+		cc->slot_prev[head] = slot;
+	cc->slot_free[order] = slot;
+	cc->slot_order[slot] = order;
+	cc->slot_nr_free[order]++;
+}
+
+static void slot_list_del(struct edma *cc, int slot, int order)
 {
-	int i, j;
-	unsigned int count = num_slots;
-	int stop_slot = start_slot;
-	DECLARE_BITMAP(tmp_inuse, EDMA_MAX_PARAMENTRY);
+	int next = cc->slot_next[slot];
+	int prev = cc->slot_prev[slot];
 
-	for (i = start_slot; i < edma_info[ctlr]->num_slots; ++i) {
-		j = EDMA_CHAN_SLOT(i);
-		if (!test_and_set_bit(j, edma_info[ctlr]->edma_inuse)) {
-			/* Record our current beginning slot */
-			if (count == num_slots)
-				stop_slot = i;
+	if (prev >= 0)
+		cc->slot_next[prev] = next;
+	else
+		cc->slot_free[order] = next;
+	if (next >= 0)
+		cc->slot_prev[next] = prev;
+	cc->slot_order[slot] = -1;
+	cc->slot_nr_free[order]--;
+}
 
-			count--;
-			set_bit(j, tmp_inuse);
+/* find the free block holding @slot, returning its first slot or -1 */
+static int slot_find_free(struct edma *cc, int slot, int *order)
+{
+	int k, head;
 
-			if (count == 0)
-				break;
-		} else {
-			clear_bit(j, tmp_inuse);
+	for (k = 0; k < EDMA_SLOT_ORDERS; k++) {
+		head = slot & ~((1 << k) - 1);
+		if (head < cc->num_channels)
+			break;
+		if (cc->slot_order[head] == k) {
+			*order = k;
+			return head;
+		}
+	}
+	return -1;
+}
+
+static void slot_block_free(struct edma *cc, int slot, int order)
+{
+	int buddy;
+
+	while (order < EDMA_SLOT_ORDERS - 1) {
+		buddy = slot ^ (1 << order);
+		if (buddy >= cc->num_slots || cc->slot_order[buddy] != order)
+			break;
+		slot_list_del(cc, buddy, order);
+		slot &= ~(1 << order);
+		order++;
+	}
+	slot_list_add(cc, slot, order);
+}
+
+/* free [slot, slot + count) as maximal naturally aligned blocks */
+static void slot_range_free(struct edma *cc, int slot, int count)
+{
+	int order;
+
+	cc->slots_free += count;
+	while (count) {
+		order = min_t(int, __ffs(slot), ilog2(count));
+		order = min(order, EDMA_SLOT_ORDERS - 1);
+		slot_block_free(cc, slot, order);
+		slot += 1 << order;
+		count -= 1 << order;
+	}
+}
+
+static int slot_range_alloc(struct edma *cc, int count)
+{
+	int order = get_count_order(count);
+	int k, slot;
+
+	for (k = order; k < EDMA_SLOT_ORDERS; k++)
+		if (cc->slot_free[k] >= 0)
+			break;
+	if (k == EDMA_SLOT_ORDERS) {
+		cc->slot_fails++;
+		return -ENOMEM;
+	}
+
+	slot = cc->slot_free[k];
+	slot_list_del(cc, slot, k);
+	while (k > order) {
+		k--;
+		slot_list_add(cc, slot + (1 << k), k);
+	}
+	cc->slots_free -= 1 << order;
+
+	/* hand back the tail of a rounded up block */
+	if ((1 << order) > count)
+		slot_range_free(cc, slot + count, (1 << order) - count);
+
+	cc->slot_allocs++;
+	return slot;
+}
 
-			if (id == EDMA_CONT_PARAMS_FIXED_EXACT) {
-				stop_slot = i;
+/* take the specific slots [slot, slot + count), all or nothing */
+static int slot_range_claim(struct edma *cc, int slot, int count)
+{
+	int i, head, order;
+
+	for (i = slot; i < slot + count; i++)
+		if (slot_find_free(cc, i, &order) < 0)
+			return -EBUSY;
+
+	for (i = slot; i < slot + count; i++) {
+		head = slot_find_free(cc, i, &order);
+		slot_list_del(cc, head, order);
+		cc->slots_free -= 1 << order;
+		if (i > head)
+			slot_range_free(cc, head, i - head);
+		if (head + (1 << order) > i + 1)
+			slot_range_free(cc, i + 1, head + (1 << order) - i - 1);
+	}
+
+	cc->slot_allocs++;
+	return slot;
+}
+
+/* Initialize the slot allocator: everything not reserved is free. */
+static void __init slot_alloc_init(struct edma *cc)
+{
+	int slot, end;
+
+	spin_lock_init(&cc->slot_lock);
+	memset(cc->slot_order, -1, cc->num_slots);
+	for (slot = 0; slot < EDMA_SLOT_ORDERS; slot++)
+		cc->slot_free[slot] = -1;
+
+	for (slot = cc->num_channels; slot < cc->num_slots; slot = end) {
+		slot = find_next_zero_bit(cc->edma_inuse, cc->num_slots, slot);
+		if (slot >= cc->num_slots)
+			break;
+		end = find_next_bit(cc->edma_inuse, cc->num_slots, slot);
+		slot_range_free(cc, slot, end - slot);
+	}
+}
+
+#ifdef CONFIG_DEBUG_FS
+
+static struct dentry *edma_debugfs;
+
+static int edma_slots_show(struct seq_file *s, void *unused)
+{
+	struct edma *cc;
+	unsigned long flags;
+	int ctlr, k, largest;
+
+	for (ctlr = 0; ctlr < arch_num_cc; ctlr++) {
+		cc = edma_info[ctlr];
+
+		spin_lock_irqsave(&cc->slot_lock, flags);
+		largest = 0;
+		for (k = EDMA_SLOT_ORDERS - 1; k >= 0; k--)
+			if (cc->slot_nr_free[k]) {
+				largest = 1 << k;
 				break;
-			} else
-				count = num_slots;
+			}
+
+		seq_printf(s, "cc%d: slots %u-%u, %u free, largest block %d",
+				ctlr, cc->num_channels, cc->num_slots - 1,
+				cc->slots_free, largest);
+		if (cc->slots_free)
+			seq_printf(s, ", fragmentation %u%%",
+				100 - largest * 100 / cc->slots_free);
+		seq_printf(s, "\n     allocs %lu failed %lu\n     free blocks:",
+				cc->slot_allocs, cc->slot_fails);
+		for (k = 0; k < EDMA_SLOT_ORDERS; k++)
+			seq_printf(s, " %u", cc->slot_nr_free[k]);
+		seq_printf(s, "\n");
+		spin_unlock_irqrestore(&cc->slot_lock, flags);
+	}
+	return 0;
+}
+
+static int edma_slots_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, edma_slots_show, inode->i_private);
+}
+
+static const struct file_operations edma_slots_fops = {
+	.owner		= THIS_MODULE,
+	.open		= edma_slots_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int edma_channels_show(struct seq_file *s, void *unused)
+{
+	struct dma_interrupt_data *intr;
+	int ctlr, i;
+
+	seq_printf(s, "chan      completions  avg ns  max ns  flags\n");
+	for (ctlr = 0; ctlr < arch_num_cc; ctlr++) {
+		for (i = 0; i < edma_info[ctlr]->num_channels; i++) {
+			intr = &edma_info[ctlr]->intr_data[i];
+			if (!intr->completions)
+				continue;
+			seq_printf(s, "%d:%-2d  %16lu  %6llu  %6u  %s%s\n",
+				ctlr, i, intr->completions,
+				div_u64(intr->handler_ns, intr->completions),
+				intr->handler_max_ns,
+				intr->flags & EDMA_CB_PRIORITY ? "P" : "-",
+				intr->flags & EDMA_CB_DEFERRED ? "D" : "-");
 		}
 	}
+	return 0;
+}
 
-	/*
-	 * We have to clear any bits that we set
-	 * if we run out parameter RAM slots, i.e we do find a set
-	 * of contiguous parameter RAM slots but do not find the exact number
-	 * requested as we may reach the total number of parameter RAM slots
-	 */
-	if (i == edma_info[ctlr]->num_slots)
-		stop_slot = i;
+static int edma_channels_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, edma_channels_show, inode->i_private);
+}
 
-	for (j = start_slot; j < stop_slot; j++)
-		if (test_bit(j, tmp_inuse))
-			clear_bit(j, edma_info[ctlr]->edma_inuse);
+static const struct file_operations edma_channels_fops = {
+	.owner		= THIS_MODULE,
+	.open		= edma_channels_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
 
-	if (count)
-		return -EBUSY;
+static void __init edma_debugfs_init(void)
+{
+	edma_debugfs = debugfs_create_dir("edma", NULL);
+	if (IS_ERR_OR_NULL(edma_debugfs)) {
+		edma_debugfs = NULL;
+		return;
+	}
+	debugfs_create_file("slots", S_IRUGO, edma_debugfs, NULL,
+			&edma_slots_fops);
+	debugfs_create_file("channels", S_IRUGO, edma_debugfs, NULL,
+			&edma_channels_fops);
+}
 
-	for (j = i - num_slots + 1; j <= i; ++j)
-		memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(j),
-			&dummy_paramset, PARM_SIZE);
+#else
 
-	return EDMA_CTLR_CHAN(ctlr, i - num_slots + 1);
+static inline void edma_debugfs_init(void)
+{
 }
 
+#endif /* CONFIG_DEBUG_FS */
+
 static int prepare_unused_channel_list(struct device *dev, void *data)
 {
 	struct platform_device *pdev = to_platform_device(dev);
@@ -577,6 +952,9 @@ static int prepare_unused_channel_list(struct device *dev, void *data)
 		if ((pdev->resource[i].flags & IORESOURCE_DMA) &&
 				(int)pdev->resource[i].start >= 0) {
 			ctlr = EDMA_CTLR(pdev->resource[i].start);
+			if (EDMA_CHAN_SLOT(pdev->resource[i].start) >=
+					edma_info[ctlr]->num_channels)
+				continue;
 			clear_bit(EDMA_CHAN_SLOT(pdev->resource[i].start),
 					edma_info[ctlr]->edma_unused);
 		}
@@ -717,7 +1095,7 @@ void edma_free_channel(unsigned channel)
 	if (channel >= edma_info[ctlr]->num_channels)
 		return;
 
-	setup_dma_interrupt(channel, NULL, NULL);
+	setup_dma_interrupt(EDMA_CTLR_CHAN(ctlr, channel), NULL, NULL);
 	/* REVISIT should probably take out of shadow region 0 */
 
 	memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(channel),
@@ -726,6 +1104,57 @@ void edma_free_channel(unsigned channel)
 }
 EXPORT_SYMBOL(edma_free_channel);
 
+/**
+ * edma_set_callback_flags - choose how a channel's completions are reported
+ * @channel: dma channel returned from edma_alloc_channel()
+ * @flags: zero, or a mask of EDMA_CB_DEFERRED and EDMA_CB_PRIORITY
+ *
+ * By default completion callbacks run in hard IRQ context, in channel
+ * order.  EDMA_CB_PRIORITY channels are dispatched ahead of the others
+ * sharing the controller's completion interrupt.  EDMA_CB_DEFERRED moves
+ * the callback to a tasklet (a high priority one if EDMA_CB_PRIORITY is
+ * also set), or to the controller's defer thread if the defer_prio
+ * parameter is set; completions arriving before it runs are coalesced
+ * into one callback.  Error callbacks are always issued from hard IRQ context.
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_set_callback_flags(unsigned channel, unsigned flags)
+{
+	struct edma *cc;
+	unsigned ctlr;
+	unsigned long irqflags;
+	u32 mask;
+	int j;
+
+	ctlr = EDMA_CTLR(channel);
+	channel = EDMA_CHAN_SLOT(channel);
+	cc = edma_info[ctlr];
+
+	if (channel >= cc->num_channels)
+		return -EINVAL;
+
+	j = channel >> 5;
+	mask = 1 << (channel & 0x1f);
+
+	spin_lock_irqsave(&cc->defer_lock, irqflags);
+	cc->intr_data[channel].flags = flags;
+	if (flags & EDMA_CB_PRIORITY)
+		cc->prio_mask[j] |= mask;
+	else
+		cc->prio_mask[j] &= ~mask;
+	if (flags & EDMA_CB_DEFERRED) {
+		cc->defer_mask[j] |= mask;
+	} else {
+		cc->defer_mask[j] &= ~mask;
+		cc->defer_pending[j] &= ~mask;
+	}
+	spin_unlock_irqrestore(&cc->defer_lock, irqflags);
+
+	return 0;
+}
+EXPORT_SYMBOL(edma_set_callback_flags);
+
 /**
  * edma_alloc_slot - allocate DMA parameter RAM
  * @slot: specific slot to allocate; negative for "any unused slot"
@@ -742,29 +1171,24 @@ EXPORT_SYMBOL(edma_free_channel);
  */
 int edma_alloc_slot(unsigned ctlr, int slot)
 {
-	if (slot >= 0)
-		slot = EDMA_CHAN_SLOT(slot);
+	struct edma *cc = edma_info[ctlr];
+	unsigned long flags;
 
-	if (slot < 0) {
-		slot = edma_info[ctlr]->num_channels;
-		for (;;) {
-			slot = find_next_zero_bit(edma_info[ctlr]->edma_inuse,
-					edma_info[ctlr]->num_slots, slot);
-			if (slot == edma_info[ctlr]->num_slots)
-				return -ENOMEM;
-			if (!test_and_set_bit(slot,
-						edma_info[ctlr]->edma_inuse))
-				break;
-		}
-	} else if (slot < edma_info[ctlr]->num_channels ||
-			slot >= edma_info[ctlr]->num_slots) {
-		return -EINVAL;
-	} else if (test_and_set_bit(slot, edma_info[ctlr]->edma_inuse)) {
-		return -EBUSY;
+	if (slot >= 0) {
+		slot = EDMA_CHAN_SLOT(slot);
+		if (slot < cc->num_channels || slot >= cc->num_slots)
+			return -EINVAL;
 	}
 
-	memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(slot),
-			&dummy_paramset, PARM_SIZE);
+	spin_lock_irqsave(&cc->slot_lock, flags);
+	if (slot < 0)
+		slot = slot_range_alloc(cc, 1);
+	else
+		slot = slot_range_claim(cc, slot, 1);
+	spin_unlock_irqrestore(&cc->slot_lock, flags);
+
+	if (slot < 0)
+		return slot;
 
 	return EDMA_CTLR_CHAN(ctlr, slot);
 }
@@ -785,13 +1209,7 @@ void edma_free_slot(unsigned slot)
 	ctlr = EDMA_CTLR(slot);
 	slot = EDMA_CHAN_SLOT(slot);
 
-	if (slot < edma_info[ctlr]->num_channels ||
-		slot >= edma_info[ctlr]->num_slots)
-		return;
-
-	memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(slot),
-			&dummy_paramset, PARM_SIZE);
-	clear_bit(slot, edma_info[ctlr]->edma_inuse);
+	edma_free_cont_slots(EDMA_CTLR_CHAN(ctlr, slot), 1);
 }
 EXPORT_SYMBOL(edma_free_slot);
 
@@ -823,14 +1241,17 @@ EXPORT_SYMBOL(edma_free_slot);
  */
 int edma_alloc_cont_slots(unsigned ctlr, unsigned int id, int slot, int count)
 {
+	struct edma *cc = edma_info[ctlr];
+	unsigned long flags;
+	int ret;
+
 	/*
 	 * The start slot requested should be greater than
 	 * the number of channels and lesser than the total number
 	 * of slots
 	 */
 	if ((id != EDMA_CONT_PARAMS_ANY) &&
-		(slot < edma_info[ctlr]->num_channels ||
-		slot >= edma_info[ctlr]->num_slots))
+		(slot < cc->num_channels || slot >= cc->num_slots))
 		return -EINVAL;
 
 	/*
@@ -838,21 +1259,36 @@ int edma_alloc_cont_slots(unsigned ctlr, unsigned int id, int slot, int count)
 	 * and cannot be more than the number of slots minus the number of
 	 * channels
 	 */
-	if (count < 1 || count >
-		(edma_info[ctlr]->num_slots - edma_info[ctlr]->num_channels))
+	if (count < 1 || count > (cc->num_slots - cc->num_channels))
 		return -EINVAL;
 
+	spin_lock_irqsave(&cc->slot_lock, flags);
 	switch (id) {
 	case EDMA_CONT_PARAMS_ANY:
-		return reserve_contiguous_slots(ctlr, id, count,
-						 edma_info[ctlr]->num_channels);
+		ret = slot_range_alloc(cc, count);
+		break;
 	case EDMA_CONT_PARAMS_FIXED_EXACT:
+		ret = -EBUSY;
+		if (slot + count <= cc->num_slots)
+			ret = slot_range_claim(cc, slot, count);
+		break;
 	case EDMA_CONT_PARAMS_FIXED_NOT_EXACT:
-		return reserve_contiguous_slots(ctlr, id, count, slot);
+		ret = -EBUSY;
+		if (slot + count <= cc->num_slots)
+			ret = slot_range_claim(cc, slot, count);
+		if (ret < 0)
+			ret = slot_range_alloc(cc, count);
+		break;
 	default:
-		return -EINVAL;
+		ret = -EINVAL;
+		break;
 	}
+	spin_unlock_irqrestore(&cc->slot_lock, flags);
 
+	if (ret < 0)
+		return ret;
+
+	return EDMA_CTLR_CHAN(ctlr, ret);
 }
 EXPORT_SYMBOL(edma_alloc_cont_slots);
 
@@ -871,25 +1307,37 @@ EXPORT_SYMBOL(edma_alloc_cont_slots);
  */
 int edma_free_cont_slots(unsigned slot, int count)
 {
-	unsigned ctlr, slot_to_free;
-	int i;
+	struct edma *cc;
+	unsigned ctlr;
+	unsigned long flags;
+	int i, order;
 
 	ctlr = EDMA_CTLR(slot);
 	slot = EDMA_CHAN_SLOT(slot);
+	cc = edma_info[ctlr];
 
-	if (slot < edma_info[ctlr]->num_channels ||
-		slot >= edma_info[ctlr]->num_slots ||
-		count < 1)
+	if (slot < cc->num_channels || count < 1 ||
+		slot + count > cc->num_slots)
 		return -EINVAL;
 
+	spin_lock_irqsave(&cc->slot_lock, flags);
 	for (i = slot; i < slot + count; ++i) {
-		ctlr = EDMA_CTLR(i);
-		slot_to_free = EDMA_CHAN_SLOT(i);
+		if (test_bit(i, cc->edma_inuse) ||
+				slot_find_free(cc, i, &order) >= 0) {
+			spin_unlock_irqrestore(&cc->slot_lock, flags);
+			WARN(1, "EDMA: freeing unallocated slot %d:%d\n",
+					ctlr, i);
+			return -EINVAL;
+		}
+	}
 
-		memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(slot_to_free),
+	/* free slots go back to the pool already holding the dummy set */
+	for (i = slot; i < slot + count; ++i)
+		memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(i),
 			&dummy_paramset, PARM_SIZE);
-		clear_bit(slot_to_free, edma_info[ctlr]->edma_inuse);
-	}
+
+	slot_range_free(cc, slot, count);
+	spin_unlock_irqrestore(&cc->slot_lock, flags);
 
 	return 0;
 }
@@ -1200,68 +1648,366 @@ EXPORT_SYMBOL(edma_read_slot);
 
 /*-----------------------------------------------------------------------*/
 
-/* Various EDMA channel control operations */
+/* Parameter RAM operations (iii) -- scatterlist chains */
 
-/**
- * edma_pause - pause dma on a channel
- * @channel: on which edma_start() has been called
- *
- * This temporarily disables EDMA hardware events on the specified channel,
- * preventing them from triggering new transfers on its behalf
- */
-void edma_pause(unsigned channel)
+/* fill in the next set of a chain, advancing its scatterlist cursor */
+static void edma_sg_chain_next(struct edma_sg_chain *chain,
+		struct edmacc_param *param)
 {
-	unsigned ctlr;
+	unsigned ccnt;
 
-	ctlr = EDMA_CTLR(channel);
-	channel = EDMA_CHAN_SLOT(channel);
+	if (!chain->frames_left) {
+		chain->sg = sg_next(chain->sg);
+		chain->addr = sg_dma_address(chain->sg);
+		chain->frames_left = sg_dma_len(chain->sg) / chain->frame;
+	}
+	ccnt = min_t(unsigned, chain->frames_left, EDMA_MAX_CCNT);
 
-	if (channel < edma_info[ctlr]->num_channels) {
-		unsigned int mask = (1 << (channel & 0x1f));
+	*param = chain->param;
+	if (chain->to_device)
+		param->src = chain->addr;
+	else
+		param->dst = chain->addr;
+	param->ccnt = ccnt;
 
-		edma_shadow0_write_array(ctlr, SH_EECR, channel >> 5, mask);
-	}
+	chain->addr += ccnt * chain->frame;
+	chain->frames_left -= ccnt;
+	chain->sets_left--;
 }
-EXPORT_SYMBOL(edma_pause);
 
-/**
- * edma_resume - resumes dma on a paused channel
- * @channel: on which edma_pause() has been called
- *
- * This re-enables EDMA hardware events on the specified channel.
+/*
+ * Program one half of a windowed chain's ring.  Its last set raises an
+ * interrupt and stays unlinked until the other half has been refilled
+ * behind it; the half programmed before this one is linked on to it.
  */
-void edma_resume(unsigned channel)
+static void edma_sg_chain_fill_half(struct edma_sg_chain *chain, unsigned h)
 {
-	unsigned ctlr;
+	unsigned ctlr = EDMA_CTLR(chain->channel);
+	unsigned len = chain->nr_slots / 2;
+	unsigned ring = EDMA_CHAN_SLOT(chain->slot);
+	unsigned base = ring + h * len;
+	struct edmacc_param param;
+	unsigned k;
+
+	for (k = 0; k < len && chain->sets_left; k++) {
+		edma_sg_chain_next(chain, &param);
+		if (!chain->sets_left) {
+			param.link_bcntrld = 0xffff;
+			if (chain->intr)
+				param.opt |= TCINTEN;
+		} else if (k == len - 1) {
+			param.link_bcntrld = 0xffff;
+			param.opt |= TCINTEN;
+			chain->irqs++;
+			chain->open |= BIT(h);
+		} else
+			param.link_bcntrld = PARM_OFFSET(base + k + 1);
 
-	ctlr = EDMA_CTLR(channel);
-	channel = EDMA_CHAN_SLOT(channel);
+		memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(base + k),
+				&param, PARM_SIZE);
+	}
 
-	if (channel < edma_info[ctlr]->num_channels) {
-		unsigned int mask = (1 << (channel & 0x1f));
+	if (k && (chain->open & BIT(!h))) {
+		edma_parm_modify(ctlr, PARM_LINK_BCNTRLD,
+				ring + !h * len + len - 1,
+				0xffff0000, PARM_OFFSET(base));
+		chain->open &= ~BIT(!h);
+	}
+}
 
-		edma_shadow0_write_array(ctlr, SH_EESR, channel >> 5, mask);
+static int edma_fill_sg_chain(struct edma_sg_chain *chain, unsigned channel,
+		struct scatterlist *sgl, unsigned sg_len, dma_addr_t fifo,
+		u16 acnt, u16 bcnt, enum dma_data_direction direction,
+		bool intr, bool staged)
+{
+	unsigned ctlr = EDMA_CTLR(channel);
+	unsigned ch = EDMA_CHAN_SLOT(channel);
+	unsigned frame = acnt * bcnt;
+	struct edmacc_param param;
+	struct scatterlist *sg;
+	unsigned i, k, nr, n = 0;
+	bool ring;
+	int slot = 0;
+
+	chain->channel = channel;
+	chain->slot = -1;
+	chain->nr_slots = 0;
+	chain->staged = false;
+	chain->irqs = 0;
+	chain->open = 0;
+	chain->half = 0;
+
+	if (ch >= edma_info[ctlr]->num_channels || !sg_len ||
+			!frame || frame > SHORT_MAX)
+		return -EINVAL;
+
+	for_each_sg(sgl, sg, sg_len, i) {
+		if (!sg_dma_len(sg) || sg_dma_len(sg) % frame)
+			return -EINVAL;
+		n += DIV_ROUND_UP(sg_dma_len(sg) / frame, EDMA_MAX_CCNT);
+	}
+
+	/*
+	 * A staged chain keeps its first set off the channel until loaded.
+	 * One that won't fit its window streams through a ring instead,
+	 * always staged, so the channel starts on a copy of the ring's
+	 * first set.
+	 */
+	nr = n - 1 + staged;
+	ring = chain->window && nr > chain->window;
+	if (ring) {
+		nr = chain->window & ~1;
+		if (!nr)
+			return -EINVAL;
+	}
+
+	if (nr) {
+		slot = edma_alloc_cont_slots(ctlr, EDMA_CONT_PARAMS_ANY,
+				0, nr);
+		if (slot < 0)
+			return slot;
+		chain->slot = slot;
+		chain->nr_slots = nr;
+		chain->staged = staged || ring;
+		slot = EDMA_CHAN_SLOT(slot);
+	}
+
+	chain->param.opt = EDMA_TCC(ch) | SYNCDIM;
+	chain->param.a_b_cnt = (bcnt << 16) | acnt;
+	if (direction == DMA_TO_DEVICE) {
+		chain->param.dst = fifo;
+		chain->param.src_dst_bidx = acnt;
+		chain->param.src_dst_cidx = frame;
+	} else {
+		chain->param.src = fifo;
+		chain->param.src_dst_bidx = acnt << 16;
+		chain->param.src_dst_cidx = frame << 16;
+	}
+	chain->to_device = (direction == DMA_TO_DEVICE);
+	chain->intr = intr;
+	chain->frame = frame;
+	chain->sg = sgl;
+	chain->addr = sg_dma_address(sgl);
+	chain->frames_left = sg_dma_len(sgl) / frame;
+	chain->sets_left = n;
+
+	if (ring) {
+		edma_sg_chain_fill_half(chain, 0);
+		edma_sg_chain_fill_half(chain, 1);
+		return staged ? channel : edma_load_sg_chain(chain);
 	}
+
+	for (k = staged; chain->sets_left; k++) {
+		edma_sg_chain_next(chain, &param);
+		if (!chain->sets_left) {
+			param.link_bcntrld = 0xffff;
+			if (intr)
+				param.opt |= TCINTEN;
+		} else
+			param.link_bcntrld = PARM_OFFSET(slot + k);
+
+		memcpy_toio(edmacc_regs_base[ctlr] +
+				PARM_OFFSET(k ? slot + k - 1 : ch),
+				&param, PARM_SIZE);
+	}
+
+	return channel;
 }
-EXPORT_SYMBOL(edma_resume);
 
 /**
- * edma_start - start dma on a channel
- * @channel: channel being activated
+ * edma_prep_sg_chain - program a scatterlist as a chain of linked slots
+ * @chain: bookkeeping for the chain, released with edma_free_sg_chain()
+ * @channel: event channel driving the transfer, from edma_alloc_channel()
+ * @sgl: DMA mapped scatterlist
+ * @sg_len: number of mapped entries in @sgl
+ * @fifo: physical address of the peripheral FIFO
+ * @acnt: FIFO access width in bytes
+ * @bcnt: FIFO accesses per hardware event
+ * @direction: DMA_TO_DEVICE or DMA_FROM_DEVICE
+ * @intr: raise the channel's completion callback when the chain is done
  *
- * Channels with event associations will be triggered by their hardware
- * events, and channels without such associations will be triggered by
- * software.  (At this writing there is no interface for using software
- * triggers except with channels that don't support hardware triggers.)
+ * Each scatterlist entry becomes an A-B synchronized transfer of
+ * @acnt * @bcnt byte frames; entries longer than one slot can describe
+ * are split across several.  The first set is written to @channel's own
+ * slot, the rest to contiguous slots from edma_alloc_cont_slots(), each
+ * linked to the next.  Entry lengths must be multiples of the frame size.
  *
- * Returns zero on success, else negative errno.
+ * Returns the channel to pass to edma_start(), else negative errno.
  */
-int edma_start(unsigned channel)
+int edma_prep_sg_chain(struct edma_sg_chain *chain, unsigned channel,
+		struct scatterlist *sgl, unsigned sg_len, dma_addr_t fifo,
+		u16 acnt, u16 bcnt, enum dma_data_direction direction,
+		bool intr)
 {
-	unsigned ctlr;
+	return edma_fill_sg_chain(chain, channel, sgl, sg_len, fifo,
+			acnt, bcnt, direction, intr, false);
+}
+EXPORT_SYMBOL(edma_prep_sg_chain);
 
-	ctlr = EDMA_CTLR(channel);
-	channel = EDMA_CHAN_SLOT(channel);
+/**
+ * edma_stage_sg_chain - program a scatterlist chain without touching
+ *	its channel
+ * @chain: bookkeeping for the chain, released with edma_free_sg_chain()
+ * @channel: event channel that will drive the transfer
+ * @sgl: DMA mapped scatterlist
+ * @sg_len: number of mapped entries in @sgl
+ * @fifo: physical address of the peripheral FIFO
+ * @acnt: FIFO access width in bytes
+ * @bcnt: FIFO accesses per hardware event
+ * @direction: DMA_TO_DEVICE or DMA_FROM_DEVICE
+ * @intr: raise the channel's completion callback when the chain is done
+ *
+ * Like edma_prep_sg_chain(), except that every set goes to a linked
+ * slot, so the chain can be built while @channel is still busy with
+ * an earlier transfer.  edma_load_sg_chain() later points the channel
+ * at it.
+ *
+ * Returns @channel, else negative errno.
+ */
+int edma_stage_sg_chain(struct edma_sg_chain *chain, unsigned channel,
+		struct scatterlist *sgl, unsigned sg_len, dma_addr_t fifo,
+		u16 acnt, u16 bcnt, enum dma_data_direction direction,
+		bool intr)
+{
+	return edma_fill_sg_chain(chain, channel, sgl, sg_len, fifo,
+			acnt, bcnt, direction, intr, true);
+}
+EXPORT_SYMBOL(edma_stage_sg_chain);
+
+/**
+ * edma_load_sg_chain - copy a staged chain's first set to its channel
+ * @chain: chain set up by edma_stage_sg_chain()
+ *
+ * This is one PaRAM set copy, cheap enough for the path that starts
+ * the transfer.  The channel must be idle.
+ *
+ * Returns the channel to pass to edma_start(), else negative errno.
+ */
+int edma_load_sg_chain(struct edma_sg_chain *chain)
+{
+	unsigned ctlr = EDMA_CTLR(chain->channel);
+	struct edmacc_param param;
+
+	if (!chain->staged)
+		return -EINVAL;
+
+	memcpy_fromio(&param, edmacc_regs_base[ctlr] +
+			PARM_OFFSET(EDMA_CHAN_SLOT(chain->slot)), PARM_SIZE);
+	memcpy_toio(edmacc_regs_base[ctlr] +
+			PARM_OFFSET(EDMA_CHAN_SLOT(chain->channel)),
+			&param, PARM_SIZE);
+	return chain->channel;
+}
+EXPORT_SYMBOL(edma_load_sg_chain);
+
+/**
+ * edma_free_sg_chain - release the linked slots of a scatterlist chain
+ * @chain: chain set up by edma_prep_sg_chain()
+ *
+ * Callers are responsible for ensuring the channel is stopped first.
+ */
+void edma_free_sg_chain(struct edma_sg_chain *chain)
+{
+	if (chain->nr_slots)
+		edma_free_cont_slots(chain->slot, chain->nr_slots);
+	chain->slot = -1;
+	chain->nr_slots = 0;
+	chain->staged = false;
+	chain->irqs = 0;
+}
+EXPORT_SYMBOL(edma_free_sg_chain);
+
+/**
+ * edma_sg_chain_refill - keep a windowed chain streaming
+ * @chain: chain set up by edma_prep_sg_chain() or edma_stage_sg_chain()
+ *
+ * Call this from the channel's completion callback.  When a chain has
+ * more sets than its window allows, the transfer signals each time it
+ * leaves one half of its slot ring, and this reprograms that half from
+ * the rest of the scatterlist.  If the transfer overtakes the refill
+ * and runs through the whole other half first, it stops on a null
+ * link and the channel reports an error, rather than replaying stale
+ * sets.
+ *
+ * Returns true if the completion was such a half boundary, false if
+ * it was the end of the chain.
+ */
+bool edma_sg_chain_refill(struct edma_sg_chain *chain)
+{
+	if (!chain->irqs)
+		return false;
+
+	chain->irqs--;
+	edma_sg_chain_fill_half(chain, chain->half);
+	chain->half ^= 1;
+	return true;
+}
+EXPORT_SYMBOL(edma_sg_chain_refill);
+
+/*-----------------------------------------------------------------------*/
+
+/* Various EDMA channel control operations */
+
+/**
+ * edma_pause - pause dma on a channel
+ * @channel: on which edma_start() has been called
+ *
+ * This temporarily disables EDMA hardware events on the specified channel,
+ * preventing them from triggering new transfers on its behalf
+ */
+void edma_pause(unsigned channel)
+{
+	unsigned ctlr;
+
+	ctlr = EDMA_CTLR(channel);
+	channel = EDMA_CHAN_SLOT(channel);
+
+	if (channel < edma_info[ctlr]->num_channels) {
+		unsigned int mask = (1 << (channel & 0x1f));
+
+		edma_shadow0_write_array(ctlr, SH_EECR, channel >> 5, mask);
+	}
+}
+EXPORT_SYMBOL(edma_pause);
+
+/**
+ * edma_resume - resumes dma on a paused channel
+ * @channel: on which edma_pause() has been called
+ *
+ * This re-enables EDMA hardware events on the specified channel.
+ */
+void edma_resume(unsigned channel)
+{
+	unsigned ctlr;
+
+	ctlr = EDMA_CTLR(channel);
+	channel = EDMA_CHAN_SLOT(channel);
+
+	if (channel < edma_info[ctlr]->num_channels) {
+		unsigned int mask = (1 << (channel & 0x1f));
+
+		edma_shadow0_write_array(ctlr, SH_EESR, channel >> 5, mask);
+	}
+}
+EXPORT_SYMBOL(edma_resume);
+
+/**
+ * edma_start - start dma on a channel
+ * @channel: channel being activated
+ *
+ * Channels with event associations will be triggered by their hardware
+ * events, and channels without such associations will be triggered by
+ * software.  (At this writing there is no interface for using software
+ * triggers except with channels that don't support hardware triggers.)
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_start(unsigned channel)
+{
+	unsigned ctlr;
+
+	ctlr = EDMA_CTLR(channel);
+	channel = EDMA_CHAN_SLOT(channel);
 
 	if (channel < edma_info[ctlr]->num_channels) {
 		int j = channel >> 5;
@@ -1386,6 +2132,805 @@ EXPORT_SYMBOL(edma_clear_event);
 
 /*-----------------------------------------------------------------------*/
 
+/*
+ * QDMA channels start a transfer when the CPU writes a chosen word of
+ * their PaRAM set, with no event enable or ESR write in between.  Each one
+ * handed out here is bound to a DMA channel without hardware events: that
+ * channel's PaRAM set is the one the QDMA channel triggers, its TCC reports
+ * completion, and its callback (if any) gets completions and errors.  The
+ * trigger word is always CCNT, the last word of the set.
+ */
+
+/* STATIC keeps the set intact after each transfer so it can be retriggered */
+static const struct edmacc_param qdma_paramset = {
+	.opt = STATIC | TCINTEN,
+	.link_bcntrld = 0xffff,
+	.a_b_cnt = 1 << 16,
+};
+
+/**
+ * edma_alloc_qdma - allocate a QDMA channel with its own parameter RAM
+ * @callback: optional; issued on transfer completion or missed triggers
+ * @data: passed to callback
+ * @eventq_no: an EVENTQ_* constant, choosing the Transfer Controller
+ *
+ * The parameter RAM set is initialized for A-synchronized transfers of
+ * one array that complete on the channel's own TCC, and left STATIC so a
+ * single trigger write restarts it.  It can be changed with edma_set_src(),
+ * edma_set_dest() and the other slot calls on the returned channel; note
+ * that edma_set_transfer_params() and edma_write_slot() write the trigger
+ * word and so start a transfer, and that the option word must keep STATIC,
+ * TCINTEN and the channel's TCC.
+ *
+ * Without @callback, completion is found with edma_qdma_done().
+ *
+ * Returns the DMA channel the QDMA channel is bound to, which identifies it
+ * in the calls below, else negative errno.
+ */
+int edma_alloc_qdma(void (*callback)(unsigned channel, u16 ch_status,
+			void *data),
+		void *data, enum dma_event_q eventq_no)
+{
+	struct edmacc_param param = qdma_paramset;
+	unsigned ctlr, slot;
+	struct edma *cc;
+	int channel, q;
+
+	channel = edma_alloc_channel(EDMA_CHANNEL_ANY, callback, data,
+				     eventq_no);
+	if (channel < 0)
+		return channel;
+
+	ctlr = EDMA_CTLR(channel);
+	slot = EDMA_CHAN_SLOT(channel);
+	cc = edma_info[ctlr];
+
+	for (q = 0; q < EDMA_NUM_QDMACH; q++)
+		if (!test_and_set_bit(q, &cc->qdma_inuse))
+			break;
+	if (q == EDMA_NUM_QDMACH) {
+		edma_free_channel(channel);
+		return -EBUSY;
+	}
+	cc->qdma_chan[q] = slot;
+
+	/* CCNT stays zero, and the channel unmapped, until a trigger */
+	param.opt |= EDMA_TCC(slot);
+	memcpy_toio(edmacc_regs_base[ctlr] + PARM_OFFSET(slot),
+			&param, PARM_SIZE);
+
+	if (eventq_no == EVENTQ_DEFAULT)
+		eventq_no = cc->default_queue;
+	edma_modify(ctlr, EDMA_QDMAQNUM, ~(0x7 << (q * 4)),
+			(eventq_no & 0x7) << (q * 4));
+	edma_write_array(ctlr, EDMA_QCHMAP, q,
+			QCHMAP_PAENTRY(slot) | QCHMAP_TRWORD(PARM_CCNT));
+
+	/* ensure access through shadow region 0, then enable triggers */
+	edma_or_array(ctlr, EDMA_QRAE, 0, 1 << q);
+	edma_write(ctlr, EDMA_QEMCR, 1 << q);
+	edma_shadow0_write(ctlr, SH_QSECR, 1 << q);
+	edma_shadow0_write(ctlr, SH_QEESR, 1 << q);
+
+	return channel;
+}
+EXPORT_SYMBOL(edma_alloc_qdma);
+
+/**
+ * edma_free_qdma - deallocate a QDMA channel
+ * @channel: channel returned from edma_alloc_qdma()
+ *
+ * Callers are responsible for ensuring no transfer is in flight.
+ */
+void edma_free_qdma(unsigned channel)
+{
+	unsigned ctlr = EDMA_CTLR(channel);
+	unsigned slot = EDMA_CHAN_SLOT(channel);
+	struct edma *cc = edma_info[ctlr];
+	int q;
+
+	for (q = 0; q < EDMA_NUM_QDMACH; q++)
+		if (cc->qdma_chan[q] == slot)
+			break;
+	if (WARN_ON(q == EDMA_NUM_QDMACH))
+		return;
+
+	edma_shadow0_write(ctlr, SH_QEECR, 1 << q);
+	edma_shadow0_write(ctlr, SH_QSECR, 1 << q);
+	edma_write(ctlr, EDMA_QEMCR, 1 << q);
+	edma_write_array(ctlr, EDMA_QCHMAP, q, 0);
+	edma_modify_array(ctlr, EDMA_QRAE, 0, ~(1 << q), 0);
+
+	cc->qdma_chan[q] = -1;
+	clear_bit(q, &cc->qdma_inuse);
+
+	edma_free_channel(channel);
+}
+EXPORT_SYMBOL(edma_free_qdma);
+
+/**
+ * edma_qdma_trigger - start the transfer held in a QDMA channel's PaRAM
+ * @channel: channel returned from edma_alloc_qdma()
+ * @ccnt: C count for the transfer, normally 1
+ *
+ * This is the single register write that submits a prepared transfer.
+ */
+void edma_qdma_trigger(unsigned channel, u16 ccnt)
+{
+	edma_parm_write(EDMA_CTLR(channel), PARM_CCNT,
+			EDMA_CHAN_SLOT(channel), ccnt);
+}
+EXPORT_SYMBOL(edma_qdma_trigger);
+
+/**
+ * edma_qdma_memcpy - copy a small buffer through a QDMA channel
+ * @channel: channel returned from edma_alloc_qdma()
+ * @dst: destination bus address
+ * @src: source bus address
+ * @len: bytes to copy, at most 65535
+ *
+ * Starts the copy and returns; completion is reported as for any other
+ * transfer on @channel.  Only one copy may be in flight per channel.
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_qdma_memcpy(unsigned channel, dma_addr_t dst, dma_addr_t src,
+		size_t len)
+{
+	unsigned ctlr = EDMA_CTLR(channel);
+	unsigned slot = EDMA_CHAN_SLOT(channel);
+
+	if (!len || len > 0xffff)
+		return -EINVAL;
+
+	edma_parm_write(ctlr, PARM_SRC, slot, src);
+	edma_parm_write(ctlr, PARM_DST, slot, dst);
+	edma_parm_write(ctlr, PARM_A_B_CNT, slot, (1 << 16) | len);
+	edma_parm_write(ctlr, PARM_CCNT, slot, 1);
+
+	return 0;
+}
+EXPORT_SYMBOL(edma_qdma_memcpy);
+
+/**
+ * edma_qdma_done - poll for completion of a QDMA channel's transfer
+ * @channel: channel returned from edma_alloc_qdma() without a callback
+ *
+ * Returns true, and acknowledges the completion, once the transfer
+ * started last has finished.
+ */
+bool edma_qdma_done(unsigned channel)
+{
+	unsigned ctlr = EDMA_CTLR(channel);
+	unsigned slot = EDMA_CHAN_SLOT(channel);
+	unsigned mask = 1 << (slot & 0x1f);
+
+	if (!(edma_shadow0_read_array(ctlr, SH_IPR, slot >> 5) & mask))
+		return false;
+
+	edma_shadow0_write_array(ctlr, SH_ICR, slot >> 5, mask);
+	return true;
+}
+EXPORT_SYMBOL(edma_qdma_done);
+
+/*-----------------------------------------------------------------------*/
+
+/*
+ * Pipelines: channels wired together with transfer completion chaining,
+ * so that each transfer (or each array/frame of it) of one stage triggers
+ * the next stage in hardware.  Only the last stage raises an interrupt.
+ */
+
+#define EDMA_OPT_CHAIN_MASK	(EDMA_TCC(0x3f) | TCINTEN | ITCINTEN | \
+				 TCCHEN | ITCCHEN)
+
+/* point the completion code of a set, and every set it links to, at @tcc */
+static int edma_chain_slots(unsigned ctlr, unsigned slot, unsigned tcc,
+		unsigned opt)
+{
+	struct edma *cc = edma_info[ctlr];
+	unsigned first = slot, n, link;
+
+	for (n = 0; n < cc->num_slots; n++) {
+		edma_parm_modify(ctlr, PARM_OPT, slot, ~EDMA_OPT_CHAIN_MASK,
+				EDMA_TCC(tcc) | opt);
+
+		link = edma_parm_read(ctlr, PARM_LINK_BCNTRLD, slot) & 0xffff;
+		if (link == 0xffff)
+			return 0;
+		slot = (link - EDMA_PARM) / PARM_SIZE;
+		if (slot >= cc->num_slots)
+			return -EINVAL;
+		if (slot == first)
+			return 0;
+	}
+
+	/* a link loop that does not come back to the channel's own set */
+	return -ELOOP;
+}
+
+/**
+ * edma_pipeline_connect - chain the stages of a pipeline together
+ * @p: pipeline; stages hold channels from edma_alloc_channel(), all on
+ *	the same channel controller, with their transfers already set up
+ *
+ * Each stage's completion codes are pointed at the next stage's channel,
+ * chaining on final and/or intermediate completion as its @chain flags
+ * ask, in its own parameter RAM set and every set linked from it.  Its
+ * own completion interrupts are turned off.  The last stage completes on
+ * its own channel with an interrupt, so its callback sees one completion
+ * per transfer of the whole pipeline.
+ *
+ * Call this after the slots are written and linked, and again after they
+ * are rewritten.
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_pipeline_connect(struct edma_pipeline *p)
+{
+	unsigned ctlr, i, ch, next, opt;
+	int ret;
+
+	if (!p->nr_stages || p->nr_stages > EDMA_PIPELINE_MAX_STAGES)
+		return -EINVAL;
+
+	ctlr = EDMA_CTLR(p->stage[0].channel);
+	for (i = 0; i < p->nr_stages; i++) {
+		ch = p->stage[i].channel;
+		if (EDMA_CTLR(ch) != ctlr ||
+		    EDMA_CHAN_SLOT(ch) >= edma_info[ctlr]->num_channels)
+			return -EINVAL;
+		if (i < p->nr_stages - 1 &&
+		    !(p->stage[i].chain & (EDMA_CHAIN_FINAL |
+					   EDMA_CHAIN_INTERMEDIATE)))
+			return -EINVAL;
+	}
+
+	for (i = 0; i < p->nr_stages; i++) {
+		ch = EDMA_CHAN_SLOT(p->stage[i].channel);
+		if (i == p->nr_stages - 1) {
+			next = ch;
+			opt = TCINTEN;
+		} else {
+			next = EDMA_CHAN_SLOT(p->stage[i + 1].channel);
+			opt = 0;
+			if (p->stage[i].chain & EDMA_CHAIN_FINAL)
+				opt |= TCCHEN;
+			if (p->stage[i].chain & EDMA_CHAIN_INTERMEDIATE)
+				opt |= ITCCHEN;
+		}
+
+		ret = edma_chain_slots(ctlr, ch, next, opt);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(edma_pipeline_connect);
+
+/**
+ * edma_pipeline_start - start a connected pipeline
+ * @p: pipeline set up with edma_pipeline_connect()
+ *
+ * The first stage, and any stage marked EDMA_CHAIN_EVENTS, is started
+ * with edma_start() and so runs on its hardware event (or a manual
+ * trigger, for channels without one).  The other stages have their
+ * events disabled and pending ones cleared, and only run when chained.
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_pipeline_start(struct edma_pipeline *p)
+{
+	int i, ret;
+
+	/* downstream first, so nothing is chained into a stale state */
+	for (i = p->nr_stages - 1; i >= 0; i--) {
+		if (i && !(p->stage[i].chain & EDMA_CHAIN_EVENTS)) {
+			edma_stop(p->stage[i].channel);
+			continue;
+		}
+		ret = edma_start(p->stage[i].channel);
+		if (ret) {
+			while (++i < p->nr_stages)
+				edma_stop(p->stage[i].channel);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(edma_pipeline_start);
+
+/**
+ * edma_pipeline_stop - stop all stages of a pipeline
+ * @p: pipeline started with edma_pipeline_start()
+ *
+ * Stages are stopped from the first one on, so none is retriggered
+ * by chaining after it was stopped.
+ */
+void edma_pipeline_stop(struct edma_pipeline *p)
+{
+	unsigned i;
+
+	for (i = 0; i < p->nr_stages; i++)
+		edma_stop(p->stage[i].channel);
+}
+EXPORT_SYMBOL(edma_pipeline_stop);
+
+/*-----------------------------------------------------------------------*/
+
+/* Event queue and transfer controller QoS */
+
+#define EDMA_QSTAT_NUMVAL(q)	(((q) >> 8) & 0x1f)
+#define EDMA_QSTAT_WM(q)	(((q) >> 16) & 0x1f)
+#define EDMA_QSTAT_THRXCD	BIT(24)
+#define EDMA_QUEUE_DEPTH	16
+#define EDMA_WM_DISABLE		(EDMA_QUEUE_DEPTH + 1)
+
+static DEFINE_SPINLOCK(edma_qos_lock);
+
+static inline bool edma_valid_queue(unsigned ctlr, int queue)
+{
+	return ctlr < arch_num_cc && queue >= 0 &&
+		queue < edma_info[ctlr]->num_tc;
+}
+
+/**
+ * edma_set_queue_tc - route an event queue to a transfer controller
+ * @ctlr: channel controller
+ * @queue: EVENTQ_* queue
+ * @tc: transfer controller number
+ *
+ * Queues are normally routed at boot from the SoC's queue_tc_mapping.
+ * Changing the routing while transfers are queued is allowed; requests
+ * already submitted to the old TC complete there.
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_set_queue_tc(unsigned ctlr, enum dma_event_q queue, int tc)
+{
+	unsigned long flags;
+
+	if (!edma_valid_queue(ctlr, queue) || tc < 0 ||
+			tc >= edma_info[ctlr]->num_tc)
+		return -EINVAL;
+
+	spin_lock_irqsave(&edma_qos_lock, flags);
+	map_queue_tc(ctlr, queue, tc);
+	spin_unlock_irqrestore(&edma_qos_lock, flags);
+	return 0;
+}
+EXPORT_SYMBOL(edma_set_queue_tc);
+
+/**
+ * edma_set_queue_priority - set the system bus priority of an event queue
+ * @ctlr: channel controller
+ * @queue: EVENTQ_* queue
+ * @priority: 0 (highest) to 7 (lowest)
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_set_queue_priority(unsigned ctlr, enum dma_event_q queue,
+		int priority)
+{
+	unsigned long flags;
+
+	if (!edma_valid_queue(ctlr, queue) || priority < 0 || priority > 7)
+		return -EINVAL;
+
+	spin_lock_irqsave(&edma_qos_lock, flags);
+	assign_priority_to_queue(ctlr, queue, priority);
+	spin_unlock_irqrestore(&edma_qos_lock, flags);
+	return 0;
+}
+EXPORT_SYMBOL(edma_set_queue_priority);
+
+/**
+ * edma_set_queue_watermark - set an event queue's watermark threshold
+ * @ctlr: channel controller
+ * @queue: EVENTQ_* queue
+ * @threshold: queue entries that trip QSTAT.THRXCD and the CC error
+ *	interrupt; 0 to 16, or EDMA_QUEUE_DEPTH + 1 to disable
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_set_queue_watermark(unsigned ctlr, enum dma_event_q queue,
+		int threshold)
+{
+	unsigned long flags;
+	int reg, bit;
+
+	if (!edma_valid_queue(ctlr, queue) || threshold < 0 ||
+			threshold > EDMA_WM_DISABLE)
+		return -EINVAL;
+
+	reg = queue < 4 ? EDMA_QWMTHRA : EDMA_QWMTHRB;
+	bit = (queue & 3) * 8;
+
+	spin_lock_irqsave(&edma_qos_lock, flags);
+	edma_modify(ctlr, reg, ~(0x1f << bit), threshold << bit);
+	spin_unlock_irqrestore(&edma_qos_lock, flags);
+	return 0;
+}
+EXPORT_SYMBOL(edma_set_queue_watermark);
+
+/**
+ * edma_get_queue_stats - sample an event queue's occupancy
+ * @ctlr: channel controller
+ * @queue: EVENTQ_* queue
+ * @stats: filled with the current and peak number of queued events
+ * @clear: restart peak tracking once sampled
+ *
+ * The peak is the hardware watermark (QSTAT.WM), i.e. the highest
+ * occupancy since it was last cleared.
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_get_queue_stats(unsigned ctlr, enum dma_event_q queue,
+		struct edma_queue_stats *stats, bool clear)
+{
+	u32 qstat;
+
+	if (!edma_valid_queue(ctlr, queue))
+		return -EINVAL;
+
+	qstat = edma_read(ctlr, EDMA_QSTAT + (queue << 2));
+	stats->queued = EDMA_QSTAT_NUMVAL(qstat);
+	stats->peak = EDMA_QSTAT_WM(qstat);
+	stats->exceeded = !!(qstat & EDMA_QSTAT_THRXCD);
+
+	/* clears both QSTAT.WM and QSTAT.THRXCD */
+	if (clear)
+		edma_write(ctlr, EDMA_CCERRCLR, BIT(queue));
+	return 0;
+}
+EXPORT_SYMBOL(edma_get_queue_stats);
+
+/**
+ * edma_set_channel_queue - move a channel to another event queue
+ * @channel: dma channel returned from edma_alloc_channel()
+ * @queue: EVENTQ_* queue; EVENTQ_DEFAULT for the controller's default
+ *
+ * Lets clients spread their channels over the queues at runtime instead
+ * of fixing the choice at edma_alloc_channel() time.  Events already in
+ * the old queue are still serviced from it.
+ *
+ * Returns zero on success, else negative errno.
+ */
+int edma_set_channel_queue(unsigned channel, enum dma_event_q queue)
+{
+	unsigned ctlr = EDMA_CTLR(channel);
+	unsigned long flags;
+
+	channel = EDMA_CHAN_SLOT(channel);
+	if (ctlr >= arch_num_cc || channel >= edma_info[ctlr]->num_channels)
+		return -EINVAL;
+	if (queue != EVENTQ_DEFAULT && !edma_valid_queue(ctlr, queue))
+		return -EINVAL;
+
+	spin_lock_irqsave(&edma_qos_lock, flags);
+	map_dmach_queue(ctlr, channel, queue);
+	spin_unlock_irqrestore(&edma_qos_lock, flags);
+	return 0;
+}
+EXPORT_SYMBOL(edma_set_channel_queue);
+
+/*
+ * sysfs:  /sys/devices/platform/edma/ccN/queue_{tc,priority,watermark}
+ * list one value per queue; write "<queue> <value>" to change one.
+ * queue_stat shows per queue occupancy and peak; writing clears peaks.
+ */
+
+struct edma_cc_attr {
+	struct device_attribute	attr;
+	unsigned		ctlr;
+};
+
+#define to_edma_cc_attr(a)	container_of(a, struct edma_cc_attr, attr)
+
+static ssize_t edma_queue_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	unsigned ctlr = to_edma_cc_attr(attr)->ctlr;
+	const char *name = attr->attr.name;
+	ssize_t len = 0;
+	u32 val;
+	int q;
+
+	for (q = 0; q < edma_info[ctlr]->num_tc; q++) {
+		if (!strcmp(name, "queue_tc")) {
+			val = edma_read(ctlr, EDMA_QUETCMAP) >> (q * 4);
+			val &= 0x7;
+		} else if (!strcmp(name, "queue_priority")) {
+			val = edma_read(ctlr, EDMA_QUEPRI) >> (q * 4);
+			val &= 0x7;
+		} else {
+			val = edma_read(ctlr, q < 4 ?
+					EDMA_QWMTHRA : EDMA_QWMTHRB);
+			val = (val >> ((q & 3) * 8)) & 0x1f;
+		}
+		len += sprintf(buf + len, "%s%u", q ? " " : "", val);
+	}
+	len += sprintf(buf + len, "\n");
+	return len;
+}
+
+static ssize_t edma_queue_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	unsigned ctlr = to_edma_cc_attr(attr)->ctlr;
+	const char *name = attr->attr.name;
+	int q, val, ret;
+
+	if (sscanf(buf, "%d %d", &q, &val) != 2)
+		return -EINVAL;
+
+	if (!strcmp(name, "queue_tc"))
+		ret = edma_set_queue_tc(ctlr, q, val);
+	else if (!strcmp(name, "queue_priority"))
+		ret = edma_set_queue_priority(ctlr, q, val);
+	else
+		ret = edma_set_queue_watermark(ctlr, q, val);
+
+	return ret ? ret : count;
+}
+
+static ssize_t edma_queue_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	unsigned ctlr = to_edma_cc_attr(attr)->ctlr;
+	struct edma_queue_stats stats;
+	ssize_t len = 0;
+	int q;
+
+	for (q = 0; q < edma_info[ctlr]->num_tc; q++) {
+		edma_get_queue_stats(ctlr, q, &stats, false);
+		len += sprintf(buf + len, "q%d: queued %u peak %u%s\n", q,
+				stats.queued, stats.peak,
+				stats.exceeded ? " exceeded" : "");
+	}
+	return len;
+}
+
+static ssize_t edma_queue_stat_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	unsigned ctlr = to_edma_cc_attr(attr)->ctlr;
+	struct edma_queue_stats stats;
+	int q;
+
+	for (q = 0; q < edma_info[ctlr]->num_tc; q++)
+		edma_get_queue_stats(ctlr, q, &stats, true);
+	return count;
+}
+
+#define EDMA_CC_ATTR(_ctlr, _name, _show, _store) {			\
+	.attr	= __ATTR(_name, S_IRUGO | S_IWUSR, _show, _store),	\
+	.ctlr	= _ctlr,						\
+}
+
+#define EDMA_CC_ATTRS(_ctlr) {						\
+	EDMA_CC_ATTR(_ctlr, queue_tc, edma_queue_show, edma_queue_store), \
+	EDMA_CC_ATTR(_ctlr, queue_priority, edma_queue_show,		\
+			edma_queue_store),				\
+	EDMA_CC_ATTR(_ctlr, queue_watermark, edma_queue_show,		\
+			edma_queue_store),				\
+	EDMA_CC_ATTR(_ctlr, queue_stat, edma_queue_stat_show,		\
+			edma_queue_stat_store),				\
+}
+
+static struct edma_cc_attr edma_cc_attrs[EDMA_MAX_CC][4] = {
+	EDMA_CC_ATTRS(0),
+	EDMA_CC_ATTRS(1),
+};
+
+static struct attribute *edma_cc_attr_list[EDMA_MAX_CC][5];
+static struct attribute_group edma_cc_groups[EDMA_MAX_CC];
+static const char *edma_cc_names[EDMA_MAX_CC] = { "cc0", "cc1" };
+
+static void __init edma_sysfs_init(struct device *dev)
+{
+	int j, i;
+
+	for (j = 0; j < arch_num_cc; j++) {
+		for (i = 0; i < ARRAY_SIZE(edma_cc_attrs[j]); i++)
+			edma_cc_attr_list[j][i] = &edma_cc_attrs[j][i].attr.attr;
+		edma_cc_groups[j].name = edma_cc_names[j];
+		edma_cc_groups[j].attrs = edma_cc_attr_list[j];
+		if (sysfs_create_group(&dev->kobj, &edma_cc_groups[j]))
+			dev_warn(dev, "cc%d: no sysfs QoS controls\n", j);
+	}
+}
+
+/*-----------------------------------------------------------------------*/
+
+#ifdef CONFIG_HIBERNATION
+/*
+ * A hibernation image is restored by a kernel that programmed the channel
+ * controllers its own way, and the PaRAM of slots that stay linked across
+ * the snapshot (audio, video ring buffers) has to come back with the image.
+ * Save the controller setup and the whole PaRAM at freeze time, and put it
+ * back in place of the boot kernel's once the image is in memory.
+ */
+struct edma_context {
+	u32	dchmap[EDMA_MAX_DMACH];
+	u32	dmaqnum[EDMA_MAX_DMACH / 8];
+	u32	qdmaqnum;
+	u32	qchmap[EDMA_NUM_QDMACH];
+	u32	quetcmap;
+	u32	quepri;
+	u32	drae[4][2];
+	u32	qrae[4];
+	u32	eer[2];
+	u32	ier[2];
+	u32	qeer;
+	u32	param[0];
+};
+
+static void __init edma_alloc_context(struct device *dev, struct edma *cc)
+{
+	cc->ctx = kmalloc(sizeof(*cc->ctx) + cc->num_slots * PARM_SIZE,
+			  GFP_KERNEL);
+	if (!cc->ctx)
+		dev_warn(dev, "no memory to save state across hibernation\n");
+}
+
+static int edma_freeze_noirq(struct device *dev)
+{
+	struct edma_context *ctx;
+	struct edma *cc;
+	int j, i;
+
+	for (j = 0; j < arch_num_cc; j++) {
+		cc = edma_info[j];
+		ctx = cc->ctx;
+		if (!ctx)
+			continue;
+
+		memcpy_fromio(ctx->param, edmacc_regs_base[j] + EDMA_PARM,
+			      cc->num_slots * PARM_SIZE);
+
+		if (edma_read(j, EDMA_CCCFG) & CHMAP_EXIST)
+			for (i = 0; i < cc->num_channels; i++)
+				ctx->dchmap[i] = edma_read_array(j,
+							EDMA_DCHMAP, i);
+		for (i = 0; i < DIV_ROUND_UP(cc->num_channels, 8); i++)
+			ctx->dmaqnum[i] = edma_read_array(j, EDMA_DMAQNUM, i);
+		ctx->qdmaqnum = edma_read(j, EDMA_QDMAQNUM);
+		for (i = 0; i < EDMA_NUM_QDMACH; i++)
+			ctx->qchmap[i] = edma_read_array(j, EDMA_QCHMAP, i);
+		ctx->quetcmap = edma_read(j, EDMA_QUETCMAP);
+		ctx->quepri = edma_read(j, EDMA_QUEPRI);
+
+		for (i = 0; i < cc->num_region; i++) {
+			ctx->drae[i][0] = edma_read_array(j, EDMA_DRAE, i * 2);
+			ctx->drae[i][1] = edma_read_array(j, EDMA_DRAE,
+							  i * 2 + 1);
+			ctx->qrae[i] = edma_read_array(j, EDMA_QRAE, i);
+		}
+
+		for (i = 0; i < 2; i++) {
+			ctx->eer[i] = edma_shadow0_read_array(j, SH_EER, i);
+			ctx->ier[i] = edma_shadow0_read_array(j, SH_IER, i);
+		}
+		ctx->qeer = edma_shadow0_read(j, SH_QEER);
+	}
+
+	return 0;
+}
+
+static int edma_restore_noirq(struct device *dev)
+{
+	struct edma_context *ctx;
+	struct edma *cc;
+	int j, i;
+
+	for (j = 0; j < arch_num_cc; j++) {
+		cc = edma_info[j];
+		ctx = cc->ctx;
+		if (!ctx)
+			continue;
+
+		/* quiesce whatever the boot kernel left enabled */
+		for (i = 0; i < 2; i++) {
+			edma_shadow0_write_array(j, SH_EECR, i, ~0);
+			edma_shadow0_write_array(j, SH_IECR, i, ~0);
+			edma_shadow0_write_array(j, SH_ECR, i, ~0);
+			edma_shadow0_write_array(j, SH_SECR, i, ~0);
+			edma_shadow0_write_array(j, SH_ICR, i, ~0);
+			edma_write_array(j, EDMA_EMCR, i, ~0);
+		}
+		edma_shadow0_write(j, SH_QEECR, ~0);
+		edma_shadow0_write(j, SH_QSECR, ~0);
+		edma_write(j, EDMA_QEMCR, ~0);
+		edma_write(j, EDMA_CCERRCLR, ~0);
+
+		memcpy_toio(edmacc_regs_base[j] + EDMA_PARM, ctx->param,
+			    cc->num_slots * PARM_SIZE);
+
+		if (edma_read(j, EDMA_CCCFG) & CHMAP_EXIST)
+			for (i = 0; i < cc->num_channels; i++)
+				edma_write_array(j, EDMA_DCHMAP, i,
+						 ctx->dchmap[i]);
+		for (i = 0; i < DIV_ROUND_UP(cc->num_channels, 8); i++)
+			edma_write_array(j, EDMA_DMAQNUM, i, ctx->dmaqnum[i]);
+		edma_write(j, EDMA_QDMAQNUM, ctx->qdmaqnum);
+		for (i = 0; i < EDMA_NUM_QDMACH; i++)
+			edma_write_array(j, EDMA_QCHMAP, i, ctx->qchmap[i]);
+		edma_write(j, EDMA_QUETCMAP, ctx->quetcmap);
+		edma_write(j, EDMA_QUEPRI, ctx->quepri);
+
+		for (i = 0; i < cc->num_region; i++) {
+			edma_write_array2(j, EDMA_DRAE, i, 0, ctx->drae[i][0]);
+			edma_write_array2(j, EDMA_DRAE, i, 1, ctx->drae[i][1]);
+			edma_write_array(j, EDMA_QRAE, i, ctx->qrae[i]);
+		}
+
+		for (i = 0; i < 2; i++) {
+			edma_shadow0_write_array(j, SH_IESR, i, ctx->ier[i]);
+			edma_shadow0_write_array(j, SH_EESR, i, ctx->eer[i]);
+		}
+		edma_shadow0_write(j, SH_QEESR, ctx->qeer);
+	}
+
+	return 0;
+}
+
+static const struct dev_pm_ops edma_pm_ops = {
+	.freeze_noirq	= edma_freeze_noirq,
+	.restore_noirq	= edma_restore_noirq,
+};
+#define EDMA_PM_OPS	(&edma_pm_ops)
+#else
+static inline void edma_alloc_context(struct device *dev, struct edma *cc)
+{
+}
+#define EDMA_PM_OPS	NULL
+#endif
+
+/*
+ * One allocation per channel controller, with the per-channel and
+ * per-slot arrays behind struct edma and sized for this controller
+ * rather than for the largest EDMA3.  A DM355 (64 channels, 128 slots)
+ * now fits the 4 KB kmalloc() bucket; the fixed size arrays put every
+ * controller in the 8 KB one.
+ */
+static struct edma * __init edma_alloc_cc(unsigned num_channels,
+		unsigned num_slots)
+{
+	size_t intr = num_channels * sizeof(struct dma_interrupt_data);
+	size_t inuse = BITS_TO_LONGS(num_slots) * sizeof(long);
+	size_t unused = BITS_TO_LONGS(num_channels) * sizeof(long);
+	size_t links = num_slots * sizeof(s16);
+	struct edma *cc;
+	void *p;
+
+	cc = kzalloc(ALIGN(sizeof(*cc), sizeof(u64)) + intr + inuse + unused
+			+ 2 * links + num_slots, GFP_KERNEL);
+	if (!cc)
+		return NULL;
+
+	/* largest alignment first: intr_data holds u64s */
+	p = PTR_ALIGN((void *)(cc + 1), sizeof(u64));
+	cc->intr_data = p;
+	p += intr;
+	cc->edma_inuse = p;
+	p += inuse;
+	cc->edma_unused = p;
+	p += unused;
+	cc->slot_next = p;
+	p += links;
+	cc->slot_prev = p;
+	p += links;
+	cc->slot_order = p;
+
+	cc->num_channels = num_channels;
+	cc->num_slots = num_slots;
+
+	return cc;
+}
+
 static int __init edma_probe(struct platform_device *pdev)
 {
 	struct edma_soc_info	*info = pdev->dev.platform_data;
@@ -1432,19 +2977,21 @@ static int __init edma_probe(struct platform_device *pdev)
 			goto fail1;
 		}
 
-		edma_info[j] = kmalloc(sizeof(struct edma), GFP_KERNEL);
+		edma_info[j] = edma_alloc_cc(
+				min_t(unsigned, info[j].n_channel,
+					EDMA_MAX_DMACH),
+				min_t(unsigned, info[j].n_slot,
+					EDMA_MAX_PARAMENTRY));
 		if (!edma_info[j]) {
 			status = -ENOMEM;
 			goto fail1;
 		}
-		memset(edma_info[j], 0, sizeof(struct edma));
 
-		edma_info[j]->num_channels = min_t(unsigned, info[j].n_channel,
-							EDMA_MAX_DMACH);
-		edma_info[j]->num_slots = min_t(unsigned, info[j].n_slot,
-							EDMA_MAX_PARAMENTRY);
 		edma_info[j]->num_cc = min_t(unsigned, info[j].n_cc,
 							EDMA_MAX_CC);
+		edma_info[j]->num_tc = min_t(unsigned, info[j].n_tc, 8);
+		edma_info[j]->num_region = min_t(unsigned, info[j].n_region, 4);
+		edma_alloc_context(&pdev->dev, edma_info[j]);
 
 		edma_info[j]->default_queue = info[j].default_queue;
 		if (!edma_info[j]->default_queue)
@@ -1459,7 +3006,8 @@ static int __init edma_probe(struct platform_device *pdev)
 
 		/* Mark all channels as unused */
 		memset(edma_info[j]->edma_unused, 0xff,
-			sizeof(edma_info[j]->edma_unused));
+			BITS_TO_LONGS(edma_info[j]->num_channels) *
+			sizeof(long));
 
 		/* Clear the reserved channels in unused list */
 		rsv_chans = info[j].rsv_chans;
@@ -1481,6 +3029,28 @@ static int __init edma_probe(struct platform_device *pdev)
 			}
 		}
 
+		slot_alloc_init(edma_info[j]);
+		memset(edma_info[j]->qdma_chan, -1,
+			sizeof(edma_info[j]->qdma_chan));
+
+		spin_lock_init(&edma_info[j]->defer_lock);
+		tasklet_init(&edma_info[j]->defer_tasklet,
+				edma_defer_tasklet, j);
+		tasklet_init(&edma_info[j]->defer_hi_tasklet,
+				edma_defer_hi_tasklet, j);
+		if (defer_prio > 0) {
+			struct task_struct *task;
+
+			task = kthread_run(edma_defer_thread,
+					   (void *)(unsigned long)j,
+					   "edma%d-defer", j);
+			if (IS_ERR(task))
+				dev_warn(&pdev->dev, "defer thread failed, "
+					 "using tasklets\n");
+			else
+				edma_info[j]->defer_thread = task;
+		}
+
 		sprintf(irq_name, "edma%d", j);
 		irq[j] = platform_get_irq_byname(pdev, irq_name);
 		edma_info[j]->irq_res_start = irq[j];
@@ -1555,6 +3125,9 @@ static int __init edma_probe(struct platform_device *pdev)
 		}
 	}
 
+	edma_sysfs_init(&pdev->dev);
+	edma_debugfs_init();
+
 	return 0;
 
 fail:
@@ -1570,6 +3143,8 @@ fail1:
 			release_mem_region(r[i]->start, len[i]);
 		if (edmacc_regs_base[i])
 			iounmap(edmacc_regs_base[i]);
+		if (edma_info[i])
+			kfree(edma_info[i]->ctx);
 		kfree(edma_info[i]);
 	}
 	return status;
@@ -1578,11 +3153,22 @@ fail1:
 
 static struct platform_driver edma_driver = {
 	.driver.name	= "edma",
+	.driver.pm	= EDMA_PM_OPS,
 };
 
 static int __init edma_init(void)
 {
-	return platform_driver_probe(&edma_driver, edma_probe);
+	int ret;
+
+	ret = platform_driver_probe(&edma_driver, edma_probe);
+	if (ret)
+		return ret;
+
+#if defined(CONFIG_TI_EDMA) || defined(CONFIG_TI_EDMA_MODULE)
+	/* dmaengine front end, drivers/dma/edma.c */
+	platform_device_register_simple("edma-dma", -1, NULL, 0);
+#endif
+	return 0;
 }
 arch_initcall(edma_init);
 
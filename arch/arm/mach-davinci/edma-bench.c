@@ -0,0 +1,396 @@
+/*
+ * EDMA throughput and latency benchmark
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Times memory to memory transfers on one channel, self chained so the
+ * whole ACNT x BCNT x CCNT block runs from a single edma_start(), and
+ * reports throughput and start to completion interrupt latency:
+ *
+ *	edma_bench/queue	event queue, hence transfer controller
+ *	edma_bench/sync		0 A-synchronized, 1 AB-synchronized
+ *	edma_bench/acnt,bcnt,ccnt	transfer shape
+ *	edma_bench/src,dst	0 DDR, 1 on-chip SRAM
+ *	edma_bench/iterations	transfers timed per result
+ *	edma_bench/run		read: one result for the settings above
+ *	edma_bench/sweep	read: every queue, memory pair, sync mode
+ *				and a range of shapes
+ *
+ * Results are one line per configuration under a '#' header, in fixed
+ * columns:
+ *
+ *	cc q sync acnt bcnt ccnt src dst bytes iter MB/s lat_min_ns
+ *	lat_avg_ns lat_max_ns qpeak
+ *
+ * Queues map to transfer controllers through the EDMA device's queue_tc
+ * sysfs attribute.  qpeak is the deepest the queue got during the run.
+ * Repeat a run with other masters busy (EMAC traffic, LCDC scanning out)
+ * to see what they cost, and see perfmon/ for their share of the DDR
+ * bandwidth.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/dma-mapping.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+
+#include <asm/sizes.h>
+
+#include <mach/edma.h>
+#include <mach/sram.h>
+
+#define EDMA_BENCH_MAX_QUEUES	4
+
+/* room for a whole sweep, so seq_read() never has to run it twice */
+#define EDMA_BENCH_SWEEP_BUF	SZ_32K
+
+enum { BENCH_DDR, BENCH_SRAM };
+
+static unsigned int buf_kb = 32;
+module_param(buf_kb, uint, 0444);
+MODULE_PARM_DESC(buf_kb, "buffer size in KiB, in DDR and SRAM (default: 32)");
+
+static struct {
+	struct mutex		lock;
+	struct dentry		*dir;
+	size_t			size;
+
+	/* source and destination buffer in each memory */
+	void			*buf[2][2];
+	dma_addr_t		dma[2][2];
+
+	int			channel;
+	struct completion	done;
+	ktime_t			end;
+	u16			status;
+
+	/* settings for "run" */
+	u32			queue;
+	u32			sync;
+	u32			acnt, bcnt, ccnt;
+	u32			src, dst;
+	u32			iterations;
+} bench = {
+	.sync		= ABSYNC,
+	.acnt		= SZ_4K,
+	.bcnt		= 8,
+	.ccnt		= 1,
+	.iterations	= 100,
+};
+
+struct edma_bench_cfg {
+	unsigned	queue;
+	unsigned	sync;
+	unsigned	acnt, bcnt, ccnt;
+	unsigned	src, dst;
+};
+
+static const char *edma_bench_mem[] = {
+	[BENCH_DDR]	= "ddr",
+	[BENCH_SRAM]	= "sram",
+};
+
+static void edma_bench_callback(unsigned channel, u16 ch_status, void *data)
+{
+	bench.end = ktime_get();
+	bench.status = ch_status;
+	complete(&bench.done);
+}
+
+/*
+ * Intermediate completions chain back to the channel itself, so each
+ * array (A-sync) or frame (AB-sync) triggers the next one and only the
+ * final completion interrupts.
+ */
+static int edma_bench_setup(const struct edma_bench_cfg *c)
+{
+	unsigned slot = EDMA_CHAN_SLOT(bench.channel);
+	struct edmacc_param p;
+	u32 cidx;
+
+	if (!c->acnt || !c->bcnt || !c->ccnt || c->acnt > USHORT_MAX ||
+	    c->bcnt > USHORT_MAX || c->ccnt > USHORT_MAX ||
+	    c->src > BENCH_SRAM || c->dst > BENCH_SRAM ||
+	    (u64)c->acnt * c->bcnt * c->ccnt > bench.size)
+		return -EINVAL;
+	if (!bench.buf[c->src][0] || !bench.buf[c->dst][1])
+		return -ENOMEM;
+
+	/* frame to frame step: from the frame start for AB-sync, from the
+	 * last array for A-sync */
+	cidx = c->sync == ABSYNC ? c->acnt * c->bcnt : c->acnt;
+	if (c->ccnt > 1 && cidx > SHRT_MAX)
+		return -EINVAL;
+
+	p.opt = TCINTEN | ITCCHEN | EDMA_TCC(slot) |
+		(c->sync == ABSYNC ? SYNCDIM : 0);
+	p.src = bench.dma[c->src][0];
+	p.dst = bench.dma[c->dst][1];
+	p.a_b_cnt = (c->bcnt << 16) | c->acnt;
+	p.src_dst_bidx = (c->acnt << 16) | c->acnt;
+	p.link_bcntrld = (c->bcnt << 16) | 0xffff;
+	p.src_dst_cidx = (cidx << 16) | cidx;
+	p.ccnt = c->ccnt;
+
+	edma_write_slot(bench.channel, &p);
+	return edma_set_channel_queue(bench.channel, c->queue);
+}
+
+static int edma_bench_one(struct seq_file *m, const struct edma_bench_cfg *c)
+{
+	unsigned ctlr = EDMA_CTLR(bench.channel);
+	struct edmacc_param p;
+	struct edma_queue_stats qs;
+	u64 lat, total = 0, lat_min = ULLONG_MAX, lat_max = 0, bytes;
+	ktime_t start;
+	unsigned i, rate;
+	int ret;
+
+	ret = edma_bench_setup(c);
+	if (ret)
+		return ret;
+	edma_read_slot(bench.channel, &p);
+	bytes = (u64)c->acnt * c->bcnt * c->ccnt;
+
+	edma_get_queue_stats(ctlr, c->queue, &qs, true);
+	for (i = 0; i < bench.iterations; i++) {
+		/* PaRAM counts down as it runs, start from the saved set */
+		edma_write_slot(bench.channel, &p);
+		INIT_COMPLETION(bench.done);
+
+		start = ktime_get();
+		edma_start(bench.channel);
+		if (!wait_for_completion_timeout(&bench.done, HZ)) {
+			edma_stop(bench.channel);
+			edma_clean_channel(bench.channel);
+			return -ETIMEDOUT;
+		}
+		if (bench.status != DMA_COMPLETE) {
+			edma_clean_channel(bench.channel);
+			return -EIO;
+		}
+
+		lat = ktime_to_ns(ktime_sub(bench.end, start));
+		total += lat;
+		lat_min = min(lat_min, lat);
+		lat_max = max(lat_max, lat);
+	}
+	edma_get_queue_stats(ctlr, c->queue, &qs, true);
+
+	/* bytes per microsecond is MB/s; one decimal */
+	rate = total ? div64_u64(bytes * bench.iterations * 10000, total) : 0;
+	seq_printf(m, "%u %u %s %5u %5u %5u %4s %4s %7llu %5u %5u.%u "
+		   "%9llu %9llu %9llu %2u\n",
+		   ctlr, c->queue, c->sync == ABSYNC ? "ab" : "a",
+		   c->acnt, c->bcnt, c->ccnt, edma_bench_mem[c->src],
+		   edma_bench_mem[c->dst], bytes, bench.iterations,
+		   rate / 10, rate % 10, lat_min,
+		   div_u64(total, bench.iterations), lat_max, qs.peak);
+	return 0;
+}
+
+static void edma_bench_header(struct seq_file *m)
+{
+	seq_printf(m, "# cc q sync acnt bcnt ccnt src dst bytes iter MB/s "
+		   "lat_min_ns lat_avg_ns lat_max_ns qpeak\n");
+}
+
+static int edma_bench_run_show(struct seq_file *m, void *v)
+{
+	struct edma_bench_cfg c = {
+		.queue	= bench.queue,
+		.sync	= bench.sync ? ABSYNC : ASYNC,
+		.acnt	= bench.acnt,
+		.bcnt	= bench.bcnt,
+		.ccnt	= bench.ccnt,
+		.src	= bench.src,
+		.dst	= bench.dst,
+	};
+	int ret;
+
+	if (!bench.iterations)
+		return -EINVAL;
+
+	mutex_lock(&bench.lock);
+	edma_bench_header(m);
+	ret = edma_bench_one(m, &c);
+	mutex_unlock(&bench.lock);
+	return ret;
+}
+
+/* shapes of one buffer's worth, from one big array to many small ones */
+static const u16 edma_bench_acnt[] = { 0, SZ_4K, 512, 64, 16 };
+
+static int edma_bench_sweep_show(struct seq_file *m, void *v)
+{
+	unsigned ctlr = EDMA_CTLR(bench.channel);
+	struct edma_queue_stats qs;
+	struct edma_bench_cfg c;
+	unsigned i, pair;
+	int ret = 0;
+
+	if (!bench.iterations)
+		return -EINVAL;
+
+	mutex_lock(&bench.lock);
+	edma_bench_header(m);
+	for (c.queue = 0; c.queue < EDMA_BENCH_MAX_QUEUES; c.queue++) {
+		if (edma_get_queue_stats(ctlr, c.queue, &qs, false))
+			break;
+		/* ddr-ddr, ddr-sram, sram-ddr */
+		for (pair = 0; pair < 3; pair++) {
+			c.src = pair == 2 ? BENCH_SRAM : BENCH_DDR;
+			c.dst = pair == 1 ? BENCH_SRAM : BENCH_DDR;
+			if (!bench.buf[c.src][0] || !bench.buf[c.dst][1])
+				continue;
+			for (c.sync = ASYNC; c.sync <= ABSYNC; c.sync++) {
+				for (i = 0; i < ARRAY_SIZE(edma_bench_acnt);
+				     i++) {
+					/* the whole buffer in one array */
+					c.acnt = edma_bench_acnt[i] ? :
+						min_t(size_t, bench.size,
+						      SZ_32K);
+					c.bcnt = bench.size / c.acnt;
+					c.ccnt = 1;
+					ret = edma_bench_one(m, &c);
+					if (ret)
+						goto out;
+				}
+			}
+		}
+	}
+out:
+	mutex_unlock(&bench.lock);
+	return ret;
+}
+
+static int edma_bench_run_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, edma_bench_run_show, NULL);
+}
+
+static int edma_bench_sweep_open(struct inode *inode, struct file *file)
+{
+	struct seq_file *m;
+	char *buf;
+	int ret;
+
+	buf = kmalloc(EDMA_BENCH_SWEEP_BUF, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	ret = single_open(file, edma_bench_sweep_show, NULL);
+	if (ret) {
+		kfree(buf);
+		return ret;
+	}
+	m = file->private_data;
+	m->buf = buf;
+	m->size = EDMA_BENCH_SWEEP_BUF;
+	return 0;
+}
+
+static const struct file_operations edma_bench_run_fops = {
+	.owner		= THIS_MODULE,
+	.open		= edma_bench_run_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations edma_bench_sweep_fops = {
+	.owner		= THIS_MODULE,
+	.open		= edma_bench_sweep_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void edma_bench_free_bufs(void)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		if (bench.buf[BENCH_DDR][i])
+			dma_free_coherent(NULL, bench.size,
+					  bench.buf[BENCH_DDR][i],
+					  bench.dma[BENCH_DDR][i]);
+		if (bench.buf[BENCH_SRAM][i])
+			sram_free(bench.buf[BENCH_SRAM][i], bench.size);
+	}
+}
+
+static int __init edma_bench_init(void)
+{
+	int i;
+
+	if (!buf_kb || buf_kb > 64)
+		return -EINVAL;
+	bench.size = buf_kb << 10;
+	mutex_init(&bench.lock);
+	init_completion(&bench.done);
+
+	for (i = 0; i < 2; i++) {
+		bench.buf[BENCH_DDR][i] = dma_alloc_coherent(NULL, bench.size,
+				&bench.dma[BENCH_DDR][i], GFP_KERNEL);
+		if (!bench.buf[BENCH_DDR][i]) {
+			edma_bench_free_bufs();
+			return -ENOMEM;
+		}
+		/* SRAM is optional, rows needing it are skipped */
+		bench.buf[BENCH_SRAM][i] = sram_alloc(bench.size,
+				&bench.dma[BENCH_SRAM][i]);
+	}
+	if (!bench.buf[BENCH_SRAM][0] || !bench.buf[BENCH_SRAM][1])
+		pr_info("edma_bench: no %u KiB of SRAM, DDR only\n", buf_kb);
+
+	bench.channel = edma_alloc_channel(EDMA_CHANNEL_ANY,
+			edma_bench_callback, NULL, EVENTQ_DEFAULT);
+	if (bench.channel < 0) {
+		edma_bench_free_bufs();
+		return bench.channel;
+	}
+
+	bench.dir = debugfs_create_dir("edma_bench", NULL);
+	if (IS_ERR_OR_NULL(bench.dir)) {
+		edma_free_channel(bench.channel);
+		edma_bench_free_bufs();
+		return bench.dir ? PTR_ERR(bench.dir) : -ENOMEM;
+	}
+	debugfs_create_u32("queue", 0644, bench.dir, &bench.queue);
+	debugfs_create_u32("sync", 0644, bench.dir, &bench.sync);
+	debugfs_create_u32("acnt", 0644, bench.dir, &bench.acnt);
+	debugfs_create_u32("bcnt", 0644, bench.dir, &bench.bcnt);
+	debugfs_create_u32("ccnt", 0644, bench.dir, &bench.ccnt);
+	debugfs_create_u32("src", 0644, bench.dir, &bench.src);
+	debugfs_create_u32("dst", 0644, bench.dir, &bench.dst);
+	debugfs_create_u32("iterations", 0644, bench.dir, &bench.iterations);
+	debugfs_create_file("run", 0444, bench.dir, NULL,
+			    &edma_bench_run_fops);
+	debugfs_create_file("sweep", 0444, bench.dir, NULL,
+			    &edma_bench_sweep_fops);
+	return 0;
+}
+module_init(edma_bench_init);
+
+static void __exit edma_bench_exit(void)
+{
+	debugfs_remove_recursive(bench.dir);
+	edma_free_channel(bench.channel);
+	edma_bench_free_bufs();
+}
+module_exit(edma_bench_exit);
+
+MODULE_DESCRIPTION("DaVinci EDMA throughput and latency benchmark");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,388 @@
+/*
+ * EDMA bulk copy engine
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Large kernel copies (page cache, pipe buffers, framebuffer blits) can
+ * be handed to a reserved EDMA channel instead of keeping the ARM926
+ * busy in memcpy().  One copy is in flight at a time; when the channel
+ * is busy, the copy is too small, or the buffers can't be DMA mapped,
+ * the CPU does the copy instead, so callers never have to care.
+ *
+ * The same channel also does 2D copies and fills between buffers the
+ * caller has already made coherent, such as frame buffers.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/interrupt.h>
+#include <linux/dma-mapping.h>
+#include <linux/completion.h>
+#include <linux/cache.h>
+#include <linux/mm.h>
+
+#include <asm/sizes.h>
+
+#include <mach/edma.h>
+
+/* each set moves B arrays of EDMA_COPY_ACNT bytes, or one short array */
+#define EDMA_COPY_ACNT		SZ_16K
+#define EDMA_COPY_MAX_CNT	USHORT_MAX
+#define EDMA_COPY_MAX_LEN	(EDMA_COPY_ACNT * EDMA_COPY_MAX_CNT)
+
+/* widest line edma_fill_2d() can replicate its pattern across */
+#define EDMA_FILL_LINE		SZ_4K
+
+static unsigned int threshold = SZ_16K;
+module_param(threshold, uint, 0644);
+MODULE_PARM_DESC(threshold,
+		"smallest copy handed to EDMA in bytes, 0 = never (default: 16K)");
+
+static struct {
+	int		channel;
+	int		link;
+	unsigned long	busy;
+
+	/* the copy in flight; len is zero for 2D copies, which aren't mapped */
+	dma_addr_t	src;
+	dma_addr_t	dst;
+	size_t		len;
+	void		(*done)(void *data, int status);
+	void		*data;
+
+	/* source line for fills */
+	void		*line;
+	dma_addr_t	line_dma;
+} ecopy = {
+	.channel	= -1,
+	.link		= -1,
+};
+
+static bool edma_copy_usable(void *dst, const void *src, size_t len)
+{
+	if (ecopy.channel < 0 || !threshold || len < threshold ||
+			len > EDMA_COPY_MAX_LEN)
+		return false;
+
+	/* lowmem only, so streaming DMA mappings cover the buffers */
+	if (!virt_addr_valid(src) || !virt_addr_valid(src + len - 1) ||
+			!virt_addr_valid(dst) || !virt_addr_valid(dst + len - 1))
+		return false;
+
+	/*
+	 * Invalidating a partial cache line of the destination would race
+	 * with CPU stores to its neighbours; only whole lines go to DMA.
+	 */
+	return IS_ALIGNED((unsigned long)dst, L1_CACHE_BYTES) &&
+		IS_ALIGNED(len, L1_CACHE_BYTES);
+}
+
+static void edma_copy_set(struct edmacc_param *p, u32 opt, dma_addr_t src,
+		dma_addr_t dst, u16 acnt, u16 bcnt)
+{
+	p->opt = opt;
+	p->src = src;
+	p->dst = dst;
+	p->a_b_cnt = (bcnt << 16) | acnt;
+	p->src_dst_bidx = (acnt << 16) | acnt;
+	p->link_bcntrld = 0xffff;
+	p->src_dst_cidx = 0;
+	p->ccnt = 1;
+}
+
+static void edma_copy_callback(unsigned channel, u16 ch_status, void *unused)
+{
+	void (*done)(void *data, int status) = ecopy.done;
+	void *data = ecopy.data;
+
+	if (ch_status != DMA_COMPLETE)
+		edma_clean_channel(ecopy.channel);
+
+	if (ecopy.len) {
+		dma_unmap_single(NULL, ecopy.dst, ecopy.len, DMA_FROM_DEVICE);
+		dma_unmap_single(NULL, ecopy.src, ecopy.len, DMA_TO_DEVICE);
+	}
+
+	smp_mb__before_clear_bit();
+	clear_bit(0, &ecopy.busy);
+
+	done(data, ch_status == DMA_COMPLETE ? 0 : -EIO);
+}
+
+/*
+ * Program and trigger one copy: an AB-synchronized set for the bulk,
+ * chained to a second set for any remainder.  Returns -EBUSY if the
+ * channel already has a copy in flight.
+ */
+static int edma_copy_submit(void *dst, const void *src, size_t len,
+		void (*done)(void *data, int status), void *data)
+{
+	unsigned tcc = EDMA_TCC(EDMA_CHAN_SLOT(ecopy.channel));
+	struct edmacc_param set;
+	size_t bulk = 0, rest = len;
+	unsigned bcnt;
+
+	if (test_and_set_bit(0, &ecopy.busy))
+		return -EBUSY;
+
+	ecopy.src = dma_map_single(NULL, (void *)src, len, DMA_TO_DEVICE);
+	ecopy.dst = dma_map_single(NULL, dst, len, DMA_FROM_DEVICE);
+	ecopy.len = len;
+	ecopy.done = done;
+	ecopy.data = data;
+
+	if (len > EDMA_COPY_MAX_CNT) {
+		bcnt = len / EDMA_COPY_ACNT;
+		bulk = bcnt * EDMA_COPY_ACNT;
+		rest = len - bulk;
+
+		edma_copy_set(&set, tcc | SYNCDIM | (rest ? TCCHEN : TCINTEN),
+				ecopy.src, ecopy.dst, EDMA_COPY_ACNT, bcnt);
+		edma_write_slot(ecopy.channel, &set);
+	}
+	if (rest) {
+		edma_copy_set(&set, tcc | SYNCDIM | TCINTEN,
+				ecopy.src + bulk, ecopy.dst + bulk, rest, 1);
+		if (bulk) {
+			edma_write_slot(ecopy.link, &set);
+			edma_link(ecopy.channel, ecopy.link);
+		} else
+			edma_write_slot(ecopy.channel, &set);
+	}
+
+	edma_start(ecopy.channel);
+	return 0;
+}
+
+/**
+ * edma_memcpy_async - copy memory using EDMA, completing asynchronously
+ * @dst: destination, kernel lowmem address
+ * @src: source, kernel lowmem address
+ * @len: number of bytes
+ * @done: called with @data and zero, or -EIO if the transfer failed
+ * @data: passed to @done
+ *
+ * Cache maintenance for both buffers is handled here.  Neither buffer
+ * may be touched until @done runs, from the EDMA completion interrupt.
+ * When the copy is not worth offloading or the channel is busy, the CPU
+ * does it and @done is called before this returns.
+ */
+void edma_memcpy_async(void *dst, const void *src, size_t len,
+		void (*done)(void *data, int status), void *data)
+{
+	if (!edma_copy_usable(dst, src, len) ||
+			edma_copy_submit(dst, src, len, done, data) < 0) {
+		memcpy(dst, src, len);
+		done(data, 0);
+	}
+}
+EXPORT_SYMBOL(edma_memcpy_async);
+
+struct edma_copy_wait {
+	struct completion	done;
+	int			status;
+};
+
+static void edma_copy_wake(void *data, int status)
+{
+	struct edma_copy_wait *wait = data;
+
+	wait->status = status;
+	complete(&wait->done);
+}
+
+/**
+ * edma_memcpy - copy memory using EDMA, sleeping until it completes
+ * @dst: destination, kernel lowmem address
+ * @src: source, kernel lowmem address
+ * @len: number of bytes
+ *
+ * Drop-in for memcpy() in process context.  The CPU does the copy when
+ * called from atomic context, when the copy is below the threshold, or
+ * when the channel is busy or reports an error.
+ */
+void *edma_memcpy(void *dst, const void *src, size_t len)
+{
+	struct edma_copy_wait wait;
+
+	if (in_atomic() || irqs_disabled() ||
+			!edma_copy_usable(dst, src, len))
+		return memcpy(dst, src, len);
+
+	init_completion(&wait.done);
+	if (edma_copy_submit(dst, src, len, edma_copy_wake, &wait) < 0)
+		return memcpy(dst, src, len);
+
+	wait_for_completion(&wait.done);
+	if (wait.status)
+		memcpy(dst, src, len);
+	return dst;
+}
+EXPORT_SYMBOL(edma_memcpy);
+
+/*
+ * One AB-synchronized set: @height lines of @width bytes, each line
+ * stepping by its pitch.  A zero @src_pitch repeats the same source line.
+ */
+static int edma_copy_2d_wait(dma_addr_t dst, int dst_pitch, dma_addr_t src,
+		int src_pitch, unsigned width, unsigned height)
+{
+	unsigned tcc = EDMA_TCC(EDMA_CHAN_SLOT(ecopy.channel));
+	struct edma_copy_wait wait;
+	struct edmacc_param set;
+
+	if (test_and_set_bit(0, &ecopy.busy))
+		return -EBUSY;
+
+	init_completion(&wait.done);
+	ecopy.src = src;
+	ecopy.dst = dst;
+	ecopy.len = 0;
+	ecopy.done = edma_copy_wake;
+	ecopy.data = &wait;
+
+	set.opt = tcc | SYNCDIM | TCINTEN;
+	set.src = src;
+	set.dst = dst;
+	set.a_b_cnt = (height << 16) | width;
+	set.src_dst_bidx = ((dst_pitch & 0xffff) << 16) | (src_pitch & 0xffff);
+	set.link_bcntrld = 0xffff;
+	set.src_dst_cidx = 0;
+	set.ccnt = 1;
+	edma_write_slot(ecopy.channel, &set);
+	edma_start(ecopy.channel);
+
+	wait_for_completion(&wait.done);
+	return wait.status;
+}
+
+static bool edma_copy_2d_usable(int dst_pitch, int src_pitch,
+		unsigned width, unsigned height)
+{
+	if (ecopy.channel < 0 || in_atomic() || irqs_disabled())
+		return false;
+	return width && height && width <= EDMA_COPY_MAX_CNT &&
+		height <= EDMA_COPY_MAX_CNT &&
+		dst_pitch == (s16)dst_pitch && src_pitch == (s16)src_pitch;
+}
+
+/**
+ * edma_copy_2d - copy a rectangle using EDMA, sleeping until it completes
+ * @dst: bus address of the first byte of the first destination line
+ * @dst_pitch: bytes from one destination line to the next, may be negative
+ * @src: bus address of the first byte of the first source line
+ * @src_pitch: bytes from one source line to the next, may be negative
+ * @width: bytes per line
+ * @height: number of lines
+ *
+ * Lines are copied in order, so overlapping rectangles are safe as long
+ * as the pitches walk away from the lines still to be read.  Both areas
+ * must already be coherent (uncached or write-combined), as no cache
+ * maintenance is done.  Returns zero, or a negative errno when EDMA
+ * could not be used from this context and the caller must copy.
+ */
+int edma_copy_2d(dma_addr_t dst, int dst_pitch, dma_addr_t src,
+		int src_pitch, unsigned width, unsigned height)
+{
+	if (!edma_copy_2d_usable(dst_pitch, src_pitch, width, height))
+		return -EAGAIN;
+	return edma_copy_2d_wait(dst, dst_pitch, src, src_pitch,
+			width, height);
+}
+EXPORT_SYMBOL(edma_copy_2d);
+
+/**
+ * edma_fill_2d - fill a rectangle with a pixel value using EDMA
+ * @dst: bus address of the first byte of the first line
+ * @dst_pitch: bytes from one line to the next
+ * @pattern: pixel value, in CPU byte order
+ * @bpp: bytes per pixel, 1, 2 or 4
+ * @width: bytes per line, a multiple of @bpp
+ * @height: number of lines
+ *
+ * Same rules and return values as edma_copy_2d(); lines wider than
+ * EDMA_FILL_LINE bytes are left to the caller.
+ */
+int edma_fill_2d(dma_addr_t dst, int dst_pitch, u32 pattern, unsigned bpp,
+		unsigned width, unsigned height)
+{
+	unsigned i;
+	int ret;
+
+	if (!ecopy.line || width > EDMA_FILL_LINE ||
+			!edma_copy_2d_usable(dst_pitch, 0, width, height))
+		return -EAGAIN;
+
+	/* the line belongs to whoever owns the channel */
+	if (test_and_set_bit(1, &ecopy.busy))
+		return -EBUSY;
+
+	switch (bpp) {
+	case 1:
+		memset(ecopy.line, pattern, width);
+		break;
+	case 2:
+		for (i = 0; i < width / 2; i++)
+			((u16 *)ecopy.line)[i] = pattern;
+		break;
+	case 4:
+		for (i = 0; i < width / 4; i++)
+			((u32 *)ecopy.line)[i] = pattern;
+		break;
+	default:
+		clear_bit(1, &ecopy.busy);
+		return -EINVAL;
+	}
+
+	ret = edma_copy_2d_wait(dst, dst_pitch, ecopy.line_dma, 0,
+			width, height);
+	clear_bit(1, &ecopy.busy);
+	return ret;
+}
+EXPORT_SYMBOL(edma_fill_2d);
+
+/**
+ * edma_copy_page - copy_page() through the EDMA copy engine
+ * @to: destination page, kernel lowmem address
+ * @from: source page, kernel lowmem address
+ */
+void edma_copy_page(void *to, void *from)
+{
+	edma_memcpy(to, from, PAGE_SIZE);
+}
+EXPORT_SYMBOL(edma_copy_page);
+
+static int __init edma_copy_init(void)
+{
+	int r;
+
+	r = edma_alloc_channel(EDMA_CHANNEL_ANY, edma_copy_callback, NULL,
+			EVENTQ_DEFAULT);
+	if (r < 0) {
+		pr_warning("edma-copy: no channel (%d), using the CPU\n", r);
+		return 0;
+	}
+
+	ecopy.link = edma_alloc_slot(EDMA_CTLR(r), EDMA_SLOT_ANY);
+	if (ecopy.link < 0) {
+		pr_warning("edma-copy: no PaRAM slot, using the CPU\n");
+		edma_free_channel(r);
+		return 0;
+	}
+	ecopy.channel = r;
+
+	/* fills are optional: without the line only copies are offloaded */
+	ecopy.line = dma_alloc_coherent(NULL, EDMA_FILL_LINE, &ecopy.line_dma,
+			GFP_KERNEL);
+
+	pr_info("edma-copy: channel %d:%d, copies of %u bytes and up\n",
+			EDMA_CTLR(r), EDMA_CHAN_SLOT(r), threshold);
+	return 0;
+}
+late_initcall(edma_copy_init);
@@ -228,7 +228,7 @@ gpio_irq_handler(unsigned irq, struct irq_desc *desc)
 	while (1) {
 		u32		status;
 		int		n;
-		int		res;
+		unsigned	res;
 
 		/* ack any irqs */
 		status = __raw_readl(&g->intstat) & mask;
@@ -241,10 +241,9 @@ gpio_irq_handler(unsigned irq, struct irq_desc *desc)
 		/* now demux them to the right lowlevel handler */
 		n = (int)get_irq_data(irq);
 		while (status) {
-			res = ffs(status);
-			n += res;
-			generic_handle_irq(n - 1);
-			status >>= res;
+			res = __ffs(status);
+			status &= status - 1;
+			generic_handle_irq(n + res);
 		}
 	}
 	desc->chip->unmask(irq);
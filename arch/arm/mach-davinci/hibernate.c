@@ -0,0 +1,72 @@
+/*
+ * DaVinci hibernation support
+ *
+ * The image is written and read back by the generic swsusp code; the ARM
+ * side of entering and leaving it is in arch/arm/kernel/swsusp.S.  What is
+ * left here is the SoC state the boot kernel sets up differently from the
+ * image kernel: PLLs, PSC module states and pin multiplexing.  EDMA saves
+ * its own controller state from its driver.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/sysdev.h>
+
+#include <mach/mux.h>
+
+#include "clock.h"
+
+static bool davinci_soc_saved;
+
+static int davinci_soc_suspend(struct sys_device *dev, pm_message_t state)
+{
+	if (state.event != PM_EVENT_FREEZE)
+		return 0;
+
+	davinci_clk_save();
+	davinci_mux_save();
+	davinci_soc_saved = true;
+
+	return 0;
+}
+
+/*
+ * Runs both when the snapshot has just been taken (nothing changed, so
+ * nothing is rewritten) and, in the restored image, in place of the boot
+ * kernel's settings.
+ */
+static int davinci_soc_resume(struct sys_device *dev)
+{
+	if (!davinci_soc_saved)
+		return 0;
+
+	davinci_clk_restore();
+	davinci_mux_restore();
+	davinci_soc_saved = false;
+
+	return 0;
+}
+
+static struct sysdev_class davinci_soc_sysclass = {
+	.name		= "davinci_soc",
+	.suspend	= davinci_soc_suspend,
+	.resume		= davinci_soc_resume,
+};
+
+static struct sys_device davinci_soc_device = {
+	.id		= 0,
+	.cls		= &davinci_soc_sysclass,
+};
+
+static int __init davinci_hibernate_init(void)
+{
+	int ret;
+
+	ret = sysdev_class_register(&davinci_soc_sysclass);
+	if (ret == 0)
+		ret = sysdev_register(&davinci_soc_device);
+	return ret;
+}
+arch_initcall(davinci_hibernate_init);
@@ -13,6 +13,16 @@
 #define NRCSR_OFFSET		0x00
 #define AWCCR_OFFSET		0x04
 #define A1CR_OFFSET		0x10
+#define PMCR_OFFSET		0x68
+
+/* interrupt raw, masked, mask set and mask clear registers */
+#define AEMIF_IRR_OFFSET	0x40
+#define AEMIF_IMR_OFFSET	0x44
+#define AEMIF_IMSR_OFFSET	0x48
+#define AEMIF_IMCR_OFFSET	0x4c
+
+#define AEMIF_INT_AT		BIT(0)	/* asynchronous timeout */
+#define AEMIF_INT_WR		BIT(2)	/* rising edge on EM_WAIT[0] */
 
 #define ACR_ASIZE_MASK		0x3
 #define ACR_EW_MASK		BIT(30)
@@ -35,6 +45,13 @@
 #define WSTROBE_MAX		0x3f
 #define WSETUP_MAX		0xf
 
+/* NOR page mode, one byte per chip select in PMCR */
+#define PMCR_PG_MD_EN		BIT(0)
+#define PMCR_PG_SIZE_8		BIT(1)
+#define PMCR_PG_DEL(x)		((x) << 2)
+#define PMCR_PG_DEL_MAX		0x3f
+#define PMCR_CS_MASK		0xff
+
 #define TIMING_MASK		(TA(TA_MAX) | \
 					RHOLD(RHOLD_MAX) | \
 					RSTROBE(RSTROBE_MAX) |	\
@@ -59,5 +76,10 @@ struct davinci_aemif_timing {
 
 int davinci_aemif_setup_timing(struct davinci_aemif_timing *t,
 					void __iomem *base, unsigned cs);
+int davinci_aemif_setup_page_mode(void __iomem *base, unsigned cs,
+					unsigned words, unsigned delay);
+void davinci_aemif_release_timing(void __iomem *base, unsigned cs);
+void davinci_aemif_timing_lock(void);
+void davinci_aemif_timing_unlock(void);
 
 #endif
@@ -17,9 +17,15 @@ struct sys_timer;
 extern struct sys_timer davinci_timer;
 
 extern void davinci_irq_init(void);
+extern int davinci_aintc_set_priority(unsigned int irq, unsigned int prio);
+extern int davinci_aintc_get_priority(unsigned int irq);
+extern int davinci_irq_set_priority(unsigned int irq, unsigned int prio);
+extern int davinci_irq_get_priority(unsigned int irq);
 extern void __iomem *davinci_intc_base;
 extern int davinci_intc_type;
 
+struct davinci_sram_carveout;
+
 struct davinci_timer_instance {
 	void __iomem	*base;
 	u32		bottom_irq;
@@ -32,6 +38,12 @@ struct davinci_timer_info {
 	struct davinci_timer_instance	*timers;
 	unsigned int			clockevent_id;
 	unsigned int			clocksource_id;
+	/* optional spare timer run in 64-bit mode as clocksource/sched_clock */
+	struct davinci_timer_instance	*clocksource64;
+	char				*clocksource64_clk;
+	/* optional timer the oprofile sampling driver may claim */
+	struct davinci_timer_instance	*profile;
+	char				*profile_clk;
 };
 
 /* SoC specific init support */
@@ -62,12 +74,27 @@ struct davinci_soc_info {
 	struct emac_platform_data	*emac_pdata;
 	dma_addr_t			sram_dma;
 	unsigned			sram_len;
+	const struct davinci_sram_carveout *sram_carveouts;
+	/* optional on-chip RAM backing the small-buffer DMA pools */
+	dma_addr_t			dma_pool_ram;
+	unsigned			dma_pool_ram_len;
 };
 
 extern struct davinci_soc_info davinci_soc_info;
 
 extern void davinci_common_init(struct davinci_soc_info *soc_info);
 
+extern void davinci_boot_mark(const char *phase);
+extern int davinci_init_async(int (*fn)(void));
+
+/* Like device_initcall(), but run the call with davinci_init_async() */
+#define davinci_async_device_initcall(fn)			\
+	static int __init fn##_async(void)			\
+	{							\
+		return davinci_init_async(fn);			\
+	}							\
+	device_initcall(fn##_async)
+
 /* standard place to map on-chip SRAMs; they *may* support DMA */
 #define SRAM_VIRT	0xfffe0000
 #define SRAM_SIZE	SZ_128K
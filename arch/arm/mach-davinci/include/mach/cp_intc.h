@@ -51,7 +51,16 @@
 #define CP_INTC_HOST_PRIO_VECTOR(n)	(0x1600 + (n << 2))
 #define CP_INTC_VECTOR_ADDR(n)		(0x2000 + (n << 2))
 
+/* Channels 0-1 are routed to nFIQ, channels 2-31 to nIRQ */
+#define CP_INTC_NUM_CHANNELS		32
+#define CP_INTC_FIQ_CHANNEL		0
+#define CP_INTC_HOST_FIQ		0
+#define CP_INTC_HOST_IRQ		1
+
 void __init cp_intc_init(void __iomem *base, unsigned short num_irq,
 			 u8 *irq_prio);
+int cp_intc_set_irq_channel(unsigned int irq, unsigned int channel);
+int cp_intc_get_irq_channel(unsigned int irq);
+int cp_intc_set_fiq(unsigned int irq);
 
 #endif	/* __ASM_HARDWARE_CP_INTC_H */
@@ -13,6 +13,15 @@
 struct davinci_cpuidle_config {
 	u32 ddr2_pdown;
 	void __iomem *ddr2_ctlr_base;
+	/*
+	 * CPU PLL controller, for SoCs whose DDR2 runs off a separate PLL;
+	 * enables the PLL bypass and SRAM idle states.
+	 */
+	void __iomem *cpupll_reg_base;
 };
 
+extern unsigned int davinci_cpu_idle_sz;
+extern void davinci_cpu_idle(void __iomem *ddr2_ctlr_base,
+			     void __iomem *cpupll_reg_base);
+
 #endif
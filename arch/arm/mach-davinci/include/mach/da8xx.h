@@ -14,6 +14,9 @@
 #include <video/da8xx-fb.h>
 
 #include <linux/davinci_emac.h>
+#include <linux/davinci_upp.h>
+#include <linux/davinci_pru_capture.h>
+#include <linux/davinci_ecap_capture.h>
 #include <linux/spi/spi.h>
 #include <linux/platform_device.h>
 
@@ -48,7 +51,11 @@ extern void __iomem *da8xx_syscfg1_base;
 #define DA8XX_SYSCFG0_VIRT(x)	(da8xx_syscfg0_base + (x))
 #define DA8XX_JTAG_ID_REG	0x18
 #define DA8XX_CHIPREV_ID_REG	0x24
+#define DA8XX_KICK0_REG		0x38
+#define DA8XX_KICK1_REG		0x3c
+#define DA8XX_HOST1CFG_REG	0x44	/* DSP boot address */
 #define DA8XX_MSTPRI2_REG	0x118
+#define DA8XX_CHIPSIG_REG	0x174
 #define DA8XX_CFGCHIP0_REG	0x17c
 #define DA8XX_CFGCHIP2_REG	0x184
 #define DA8XX_CFGCHIP3_REG	0x188
@@ -57,6 +64,11 @@ extern void __iomem *da8xx_syscfg1_base;
 #define DA8XX_SYSCFG1_VIRT(x)	(da8xx_syscfg1_base + (x))
 #define DA8XX_DEEPSLEEP_REG	0x8
 
+#define DA8XX_TPCC_BASE		0x01c00000
+#define DA850_TPCC1_BASE	0x01e30000
+#define DA8XX_TPTC0_BASE	0x01c08000
+#define DA8XX_TPTC1_BASE	0x01c08400
+#define DA850_TPTC2_BASE	0x01e38000
 #define DA8XX_PSC0_BASE		0x01c10000
 #define DA8XX_PLL0_BASE		0x01c11000
 #define DA8XX_TIMER64P0_BASE	0x01c20000
@@ -72,6 +84,7 @@ extern void __iomem *da8xx_syscfg1_base;
 #define DA8XX_DDR2_CTL_BASE	0xb0000000
 #define DA8XX_ARM_RAM_BASE	0xffff0000
 #define DA8XX_VPIF_BASE		0x01e17000
+#define DA850_UPP_BASE		0x01e16000
 #define DA8XX_USB0_BASE		0x01e00000
 #define DA850_SATA_BASE		0x01E18000
 #define DA850_SATA_CLK_PWRDN	0x01E2C018
@@ -134,6 +147,7 @@ static inline int cpu_is_davinci_da8xx_arm_only(void)
 
 void __init da830_init(void);
 void __init da850_init(void);
+int da850_set_async3_src(int pllnum);
 
 int da8xx_register_edma(void);
 int da8xx_register_i2c(int instance, struct davinci_i2c_platform_data *pdata);
@@ -149,10 +163,17 @@ void __init da8xx_register_mcasp(int id, struct snd_platform_data *pdata);
 int da8xx_register_rtc(void);
 int da850_register_cpufreq(void);
 int da8xx_register_cpuidle(void);
+int da850_register_dsp_ipc(resource_size_t base, resource_size_t size);
+int da850_register_dsp_loader(resource_size_t ddr_base,
+		resource_size_t ddr_size);
+int da850_register_upp(struct davinci_upp_platform_data *pdata);
+int da8xx_register_pru_capture(struct davinci_pru_capture_platform_data *pdata);
 void __iomem * __init da8xx_get_mem_ctlr(void);
 int da850_register_pm(struct platform_device *pdev);
 void da850_init_spi1(unsigned chipselect_mask,
 	struct spi_board_info *info, unsigned len);
+struct davinci_spi_slave_config;
+void da850_init_spi1_slave(struct davinci_spi_slave_config *cfg);
 void da830_init_spi0(unsigned chipselect_mask,
 	struct spi_board_info *info, unsigned len);
 int da850_init_mcbsp(struct davinci_mcbsp_platform_data *pdata);
@@ -162,10 +183,47 @@ int __init da850_register_vpif_display(struct vpif_display_config
 int __init da850_register_vpif_capture(struct vpif_capture_config
 							*capture_config);
 int __init da850_register_ecap(char);
+int __init da850_register_ecap_capture(unsigned instance,
+		struct davinci_ecap_capture_platform_data *pdata);
 
 int cppi41_init(void);
 int da8xx_register_sata(void);
 
+/* SYSCFG MSTPRIn bus masters, see da8xx-busprio.c */
+enum da8xx_bus_master {
+	DA8XX_MASTER_ARM_I,
+	DA8XX_MASTER_ARM_D,
+	DA8XX_MASTER_DSP_MDMA,
+	DA8XX_MASTER_DSP_CFG,
+	DA8XX_MASTER_UPP,
+	DA8XX_MASTER_SATA,
+	DA8XX_MASTER_PRU0,
+	DA8XX_MASTER_PRU1,
+	DA8XX_MASTER_EDMA0_TC0,
+	DA8XX_MASTER_EDMA0_TC1,
+	DA8XX_MASTER_EDMA1_TC0,
+	DA8XX_MASTER_VPIF_DMA0,
+	DA8XX_MASTER_VPIF_DMA1,
+	DA8XX_MASTER_EMAC,
+	DA8XX_MASTER_USB0_CFG,
+	DA8XX_MASTER_USB0_CDMA,
+	DA8XX_MASTER_UHPI,
+	DA8XX_MASTER_USB1,
+	DA8XX_MASTER_LCDC,
+	DA8XX_NR_MASTERS
+};
+
+struct da8xx_master_prio {
+	enum da8xx_bus_master	master;
+	u8			prio;	/* 0 highest to 7 */
+};
+
+int da8xx_get_master_priority(enum da8xx_bus_master master);
+int da8xx_set_master_priority(enum da8xx_bus_master master, unsigned prio);
+int da8xx_set_ddr_pbbpr(unsigned count);
+int da8xx_set_bus_profile(const char *name);
+void __init da8xx_init_bus_prio(const char *profile);
+
 
 extern struct platform_device da8xx_serial_device;
 extern struct emac_platform_data da8xx_emac_pdata;
@@ -0,0 +1,25 @@
+/*
+ * mach/dma-pool.h - platform-wide pools of small coherent DMA buffers
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __MACH_DMA_POOL_H
+#define __MACH_DMA_POOL_H
+
+#include <linux/types.h>
+
+/* Largest buffer served from the pools; bigger ones get their own pages */
+#define DAVINCI_DMA_POOL_MAX	512
+
+/*
+ * Small coherent buffers (descriptors, scratch words) shared between
+ * drivers instead of each taking a page of the consistent mapping. On
+ * SoCs with shared RAM they live there. Free with the size used to
+ * allocate.
+ */
+extern void *davinci_dma_pool_alloc(size_t size, gfp_t gfp, dma_addr_t *dma);
+extern void davinci_dma_pool_free(size_t size, void *vaddr, dma_addr_t dma);
+
+#endif /* __MACH_DMA_POOL_H */
@@ -57,6 +57,10 @@
 #ifndef EDMA_H_
 #define EDMA_H_
 
+#include <linux/dma-mapping.h>
+#include <linux/string.h>
+#include <asm/page.h>
+
 /* PaRAM slots are laid out like this */
 struct edmacc_param {
 	unsigned int opt;
@@ -261,6 +265,51 @@ void edma_unlink(unsigned from);
 void edma_write_slot(unsigned slot, const struct edmacc_param *params);
 void edma_read_slot(unsigned slot, struct edmacc_param *params);
 
+/*
+ * scatterlist transfers through a chain of linked parameter RAM slots;
+ * a non-zero 'window' caps the slots one chain may take, and longer
+ * lists then stream through a ring refilled by edma_sg_chain_refill()
+ */
+struct edma_sg_chain {
+	unsigned	channel;
+	int		slot;		/* first linked slot, or -1 */
+	unsigned	nr_slots;
+	bool		staged;		/* first set lives in 'slot' */
+	unsigned	window;		/* set by the owner, 0 = unlimited */
+
+	/* what's left to program, and ring bookkeeping */
+	struct edmacc_param	param;
+	struct scatterlist	*sg;
+	dma_addr_t		addr;
+	unsigned		frame;
+	unsigned		frames_left;
+	unsigned		sets_left;
+	unsigned		irqs;		/* half boundaries pending */
+	unsigned		open;		/* halves with no onward link */
+	unsigned		half;		/* half to refill next */
+	bool			to_device;
+	bool			intr;
+};
+
+struct scatterlist;
+int edma_prep_sg_chain(struct edma_sg_chain *chain, unsigned channel,
+		struct scatterlist *sgl, unsigned sg_len, dma_addr_t fifo,
+		u16 acnt, u16 bcnt, enum dma_data_direction direction,
+		bool intr);
+int edma_stage_sg_chain(struct edma_sg_chain *chain, unsigned channel,
+		struct scatterlist *sgl, unsigned sg_len, dma_addr_t fifo,
+		u16 acnt, u16 bcnt, enum dma_data_direction direction,
+		bool intr);
+int edma_load_sg_chain(struct edma_sg_chain *chain);
+bool edma_sg_chain_refill(struct edma_sg_chain *chain);
+void edma_free_sg_chain(struct edma_sg_chain *chain);
+
+/* completion callback dispatch, see edma_set_callback_flags() */
+#define EDMA_CB_DEFERRED	BIT(0)	/* from a tasklet, not hard IRQ */
+#define EDMA_CB_PRIORITY	BIT(1)	/* ahead of other channels */
+
+int edma_set_callback_flags(unsigned channel, unsigned flags);
+
 /* channel control operations */
 int edma_start(unsigned channel);
 void edma_stop(unsigned channel);
@@ -269,6 +318,114 @@ void edma_clear_event(unsigned channel);
 void edma_pause(unsigned channel);
 void edma_resume(unsigned channel);
 
+/* QDMA channels: a prepared transfer starts with one PaRAM write */
+int edma_alloc_qdma(void (*callback)(unsigned channel, u16 ch_status,
+			void *data),
+		void *data, enum dma_event_q eventq_no);
+void edma_free_qdma(unsigned channel);
+void edma_qdma_trigger(unsigned channel, u16 ccnt);
+int edma_qdma_memcpy(unsigned channel, dma_addr_t dst, dma_addr_t src,
+		size_t len);
+bool edma_qdma_done(unsigned channel);
+
+/*
+ * pipelines of channels triggering each other through completion
+ * chaining; only the last stage interrupts
+ */
+#define EDMA_PIPELINE_MAX_STAGES	8
+
+#define EDMA_CHAIN_FINAL	BIT(0)	/* next stage after each transfer */
+#define EDMA_CHAIN_INTERMEDIATE	BIT(1)	/* ... after each array/frame */
+#define EDMA_CHAIN_EVENTS	BIT(2)	/* also runs on its own events */
+
+struct edma_pipeline {
+	unsigned	nr_stages;
+	struct {
+		unsigned	channel;	/* from edma_alloc_channel() */
+		unsigned	chain;		/* EDMA_CHAIN_* */
+	} stage[EDMA_PIPELINE_MAX_STAGES];
+};
+
+int edma_pipeline_connect(struct edma_pipeline *p);
+int edma_pipeline_start(struct edma_pipeline *p);
+void edma_pipeline_stop(struct edma_pipeline *p);
+
+/*
+ * dmaengine front end (drivers/dma/edma.c).  Slave clients hand this to
+ * the channel through dma_chan->private from their dma_request_channel()
+ * filter; channels without it are used for memcpy.
+ */
+struct edma_dma_slave {
+	int			channel;	/* EDMA_CTLR_CHAN() event */
+	enum dma_event_q	eventq;
+	dma_addr_t		tx_reg;		/* peripheral FIFO addresses */
+	dma_addr_t		rx_reg;
+	u16			acnt;		/* FIFO access width, bytes */
+	u16			maxburst;	/* FIFO accesses per event */
+};
+
+struct dma_chan;
+struct dma_async_tx_descriptor *edma_dma_prep_cyclic(struct dma_chan *chan,
+		dma_addr_t buf_addr, size_t buf_len, size_t period_len,
+		enum dma_data_direction direction);
+
+/* runtime event queue and transfer controller QoS */
+struct edma_queue_stats {
+	unsigned	queued;		/* events waiting right now */
+	unsigned	peak;		/* watermark since last cleared */
+	bool		exceeded;	/* peak crossed the threshold */
+};
+
+int edma_set_queue_tc(unsigned ctlr, enum dma_event_q queue, int tc);
+int edma_set_queue_priority(unsigned ctlr, enum dma_event_q queue,
+		int priority);
+int edma_set_queue_watermark(unsigned ctlr, enum dma_event_q queue,
+		int threshold);
+int edma_get_queue_stats(unsigned ctlr, enum dma_event_q queue,
+		struct edma_queue_stats *stats, bool clear);
+int edma_set_channel_queue(unsigned channel, enum dma_event_q queue);
+
+/* bulk copies offloaded to a reserved channel, see edma-copy.c */
+#ifdef CONFIG_DAVINCI_EDMA_COPY
+void *edma_memcpy(void *dst, const void *src, size_t len);
+void edma_memcpy_async(void *dst, const void *src, size_t len,
+		void (*done)(void *data, int status), void *data);
+void edma_copy_page(void *to, void *from);
+int edma_copy_2d(dma_addr_t dst, int dst_pitch, dma_addr_t src,
+		int src_pitch, unsigned width, unsigned height);
+int edma_fill_2d(dma_addr_t dst, int dst_pitch, u32 pattern, unsigned bpp,
+		unsigned width, unsigned height);
+#else
+static inline void *edma_memcpy(void *dst, const void *src, size_t len)
+{
+	return memcpy(dst, src, len);
+}
+
+static inline void edma_memcpy_async(void *dst, const void *src, size_t len,
+		void (*done)(void *data, int status), void *data)
+{
+	memcpy(dst, src, len);
+	done(data, 0);
+}
+
+static inline void edma_copy_page(void *to, void *from)
+{
+	copy_page(to, from);
+}
+
+static inline int edma_copy_2d(dma_addr_t dst, int dst_pitch, dma_addr_t src,
+		int src_pitch, unsigned width, unsigned height)
+{
+	return -ENODEV;
+}
+
+static inline int edma_fill_2d(dma_addr_t dst, int dst_pitch, u32 pattern,
+		unsigned bpp, unsigned width, unsigned height)
+{
+	return -ENODEV;
+}
+#endif
+
 /* platform_data for EDMA driver */
 struct edma_soc_info {
 
@@ -22,6 +22,10 @@
  * parts:	optional array of mtd_partitions for static partitioning
  * nr_parts:	number of mtd_partitions for static partitoning
  * timing:	AEMIF timimg values for NOR access
+ * page_words:	page size of the flash in bus words (4 or 8) to use the
+ *		AEMIF NOR page mode for reads, or 0
+ * page_delay:	page access time of the flash in nanoseconds
+ * cached:	read array data through a cached, read-only mapping
  */
 struct davinciflash_pdata {
 	const char	*map_name;
@@ -30,6 +34,9 @@ struct davinciflash_pdata {
 	struct mtd_partition *parts;
 	unsigned int	nr_parts;
 	struct davinci_aemif_timing *timing;
+	unsigned int	page_words;
+	unsigned int	page_delay;
+	bool		cached;
 };
 
 #endif
@@ -93,6 +93,33 @@ static inline u32 __gpio_mask(unsigned gpio)
 	return 1 << (gpio % 32);
 }
 
+/*
+ * Bank-wide access to the (up to) 32 GPIOs sharing one register set, i.e.
+ * two of the 16-bit hardware banks, for parallel bit-banging.  @gpio is
+ * the first of them (a multiple of 32) and @mask bits are relative to it.
+ *
+ * Writes go through SET_DATA and CLR_DATA so they need no lock against
+ * other users of the bank; the pins being set change one bus write ahead
+ * of those being cleared.  Only for built-in GPIOs set up as outputs.
+ */
+static inline void davinci_gpio_write_mask(unsigned gpio, u32 mask, u32 value)
+{
+	struct gpio_controller *__iomem g = __gpio_to_controller(gpio);
+
+	if (mask & value)
+		__raw_writel(mask & value, &g->set_data);
+	if (mask & ~value)
+		__raw_writel(mask & ~value, &g->clr_data);
+}
+
+/* Same bank layout; the read has the same GPIO clock latency as below */
+static inline u32 davinci_gpio_read_mask(unsigned gpio, u32 mask)
+{
+	struct gpio_controller *__iomem g = __gpio_to_controller(gpio);
+
+	return __raw_readl(&g->in_data) & mask;
+}
+
 /* The get/set/clear functions will inline when called with constant
  * parameters referencing built-in GPIOs, for low-overhead bitbanging.
  *
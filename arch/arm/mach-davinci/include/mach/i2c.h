@@ -16,6 +16,7 @@
 struct davinci_i2c_platform_data {
 	unsigned int	bus_freq;	/* standard bus frequency (kHz) */
 	unsigned int	bus_delay;	/* post-transaction delay (usec) */
+	unsigned int	use_dma;	/* longer messages through EDMA */
 };
 
 /* for board setup code */
@@ -387,6 +387,7 @@
 #define IRQ_DA850_T12CMPINT6_3		88
 #define IRQ_DA850_T12CMPINT7_3		89
 #define IRQ_DA850_RPIINT		91
+#define IRQ_DA850_UPPINT		IRQ_DA850_RPIINT
 #define IRQ_DA850_VPIFINT		92
 #define IRQ_DA850_CCINT1		93
 #define IRQ_DA850_CCERRINT1		94
@@ -406,4 +407,7 @@
 /* da850 currently has the most irqs so use DA850_N_CP_INTC_IRQ */
 #define NR_IRQS				(DA850_N_CP_INTC_IRQ + DAVINCI_N_GPIO)
 
+/* cp_intc FIQ numbers are the system interrupt numbers, see cp_intc_set_fiq() */
+#define FIQ_START			0
+
 #endif /* __ASM_ARCH_IRQS_H */
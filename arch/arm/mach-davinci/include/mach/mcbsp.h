@@ -34,6 +34,19 @@
 #define DAVINCI_MCBSP_MC_RMCM1	0x01
 #define DAVINCI_MCBSP_MC_RMCME	0x08
 
+/* Streaming mode: the DMA ping-pongs between two periods of one buffer */
+#define DAVINCI_MCBSP_STREAM_PERIODS	2
+
+struct davinci_mcbsp_dev;
+
+/*
+ * Called from the EDMA interrupt each time a period has been filled (RX)
+ * or drained (TX).  The DMA carries on with the other period, so the
+ * callback has one period time to consume or refill this one.
+ */
+typedef void (*davinci_mcbsp_stream_cb)(struct davinci_mcbsp_dev *dev,
+					unsigned int period, void *data);
+
 /* Platfrom data */
 struct davinci_mcbsp_platform_data {
 	u32 inst;
@@ -72,6 +85,14 @@ struct davinci_mcbsp_params {
 	/* completion queues */
 	struct completion irq_completion;
 	struct completion dma_completion;
+
+	/* streaming mode */
+	int stream_slot[DAVINCI_MCBSP_STREAM_PERIODS];
+	dma_addr_t stream_buf;
+	unsigned int stream_period_len;
+	davinci_mcbsp_stream_cb stream_cb;
+	void *stream_data;
+	unsigned long stream_errors;
 };
 
 struct davinci_mcbsp_dev {
@@ -112,6 +133,12 @@ void davinci_mcbsp_xmit_word(struct davinci_mcbsp_dev *dev, u32 word);
 u32 davinci_mcbsp_recv_word(struct davinci_mcbsp_dev *dev);
 void davinci_mcbsp_config_fifo(struct davinci_mcbsp_dev *dev);
 void davinci_mcbsp_config_multichannel_mode(struct davinci_mcbsp_dev *dev);
+void davinci_mcbsp_set_channel_mask(struct davinci_mcbsp_dev *dev, u8 mode,
+							const u32 *mask);
+int davinci_mcbsp_stream_start(struct davinci_mcbsp_dev *dev, u8 mode,
+		dma_addr_t buf, unsigned int period_len,
+		davinci_mcbsp_stream_cb cb, void *data);
+void davinci_mcbsp_stream_stop(struct davinci_mcbsp_dev *dev, u8 mode);
 
 #endif
 
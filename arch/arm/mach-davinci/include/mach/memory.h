@@ -32,6 +32,25 @@
 #define PHYS_OFFSET DAVINCI_DDR_BASE
 #endif
 
+/*
+ * Cached, executable window for code linked into .sram.text, right after
+ * the SRAM_VIRT mapping of the DA850 ARM RAM; backed by the top of the
+ * DA850 shared RAM (the bottom is left to the DSP and PRU).
+ */
+#define DAVINCI_SRAM_TEXT_VIRT	0xfffe2000
+#define DAVINCI_SRAM_TEXT_SIZE	SZ_32K
+#define DA850_SRAM_TEXT_BASE	(DA8XX_SHARED_RAM_BASE + SZ_128K - \
+					DAVINCI_SRAM_TEXT_SIZE)
+
+/*
+ * Shared RAM for small DMA descriptors, so they stay off DDR: the OHCI
+ * HCCA and ED/TD pools, then the platform small-buffer pools.
+ */
+#define DA8XX_OHCI_DESC_RAM	(DA8XX_SHARED_RAM_BASE + SZ_64K)
+#define DA8XX_OHCI_DESC_RAM_SIZE	SZ_16K
+#define DA8XX_DMA_POOL_RAM	(DA8XX_OHCI_DESC_RAM + DA8XX_OHCI_DESC_RAM_SIZE)
+#define DA8XX_DMA_POOL_RAM_SIZE	SZ_16K
+
 #define DDR2_SDRCR_OFFSET	0xc
 #define DDR2_SRPD_BIT		BIT(23)
 #define DDR2_MCLKSTOPEN_BIT	BIT(30)
@@ -19,14 +19,17 @@
 #ifndef __INC_MACH_MUX_H
 #define __INC_MACH_MUX_H
 
+/* 8 bytes per pin unless CONFIG_DAVINCI_MUX_DEBUG wants the extras */
 struct mux_config {
 	const char *name;
-	const char *mux_reg_name;
 	const unsigned char mux_reg;
 	const unsigned char mask_offset;
 	const unsigned char mask;
 	const unsigned char mode;
+#ifdef CONFIG_DAVINCI_MUX_DEBUG
+	const char *mux_reg_name;
 	bool debug;
+#endif
 };
 
 enum davinci_dm644x_index {
@@ -1007,9 +1010,15 @@ enum davinci_da850_index {
 #ifdef CONFIG_DAVINCI_MUX
 /* setup pin muxing */
 extern int davinci_cfg_reg(unsigned long reg_cfg);
+extern int davinci_cfg_reg_list(const short pins[]);
+extern void davinci_mux_save(void);
+extern void davinci_mux_restore(void);
 #else
 /* boot loader does it all (no warnings from CONFIG_DAVINCI_MUX_WARNINGS) */
 static inline int davinci_cfg_reg(unsigned long reg_cfg) { return 0; }
+static inline int davinci_cfg_reg_list(const short pins[]) { return 0; }
+static inline void davinci_mux_save(void) { }
+static inline void davinci_mux_restore(void) { }
 #endif
 
 #endif /* __INC_MACH_MUX_H */
@@ -70,7 +70,8 @@ struct davinci_nand_pdata {		/* platform_data */
 	 *
 	 * All DaVinci-family chips support 1-bit hardware ECC.
 	 * Newer ones also support 4-bit ECC, but are awkward
-	 * using it with large page chips.
+	 * using it with large page chips.  ecc_bits = 8 selects
+	 * a software BCH code for parts that need it.
 	 */
 	nand_ecc_modes_t	ecc_mode;
 	u8			ecc_bits;
@@ -84,6 +85,13 @@ struct davinci_nand_pdata {		/* platform_data */
 
 	/* Access timings */
 	struct davinci_aemif_timing	*timing;
+
+	/* Set on both of two identical single-chip devices to present
+	 * them as one MTD, pages alternating between them, so one chip
+	 * programs or erases while the other transfers data.  The first
+	 * one probed supplies the partitions.  Not with 4-bit ECC.
+	 */
+	bool			interleave;
 };
 
 #endif	/* __ARCH_ARM_DAVINCI_NAND_H */
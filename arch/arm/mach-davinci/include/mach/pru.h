@@ -0,0 +1,86 @@
+/*
+ * DA8xx PRU subsystem runtime
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef __ASM_ARCH_DAVINCI_PRU_H
+#define __ASM_ARCH_DAVINCI_PRU_H
+
+#include <linux/types.h>
+
+#include <asm/sizes.h>
+
+#include <mach/irqs.h>
+
+#define DA8XX_PRUSS_BASE		0x01c30000
+#define DA8XX_PRUSS_SIZE		SZ_64K
+
+#define DAVINCI_PRU_NUM_CORES		2
+#define DAVINCI_PRU_IRAM_SIZE		SZ_4K
+#define DAVINCI_PRU_DRAM_SIZE		512
+
+/* PRU_INTC: 64 system events, 10 channels, 10 host interrupts */
+#define DAVINCI_PRU_NUM_EVENTS		64
+#define DAVINCI_PRU_NUM_CHANNELS	10
+
+/* host interrupts 0 and 1 go to the PRUs, 2..9 are the ARM's EVTOUT0..7 */
+#define DAVINCI_PRU_HOST_ARM(n)		((n) + 2)
+#define DAVINCI_PRU_HOST_IRQ(host)	(IRQ_DA8XX_EVTOUT0 + (host) - 2)
+
+struct device;
+
+/*
+ * Single-producer/single-consumer ring in memory both the ARM and a PRU
+ * can reach: PRU data RAM, or the L3 shared RAM.  A 16 byte header is
+ * followed by a power-of-two data area.  head and tail are free running
+ * byte counts; only the producer writes head and only the consumer
+ * writes tail, so neither side needs a lock.  The PRU firmware sees the
+ * same layout, see struct davinci_pru_ring_hdr.
+ */
+struct davinci_pru_ring_hdr {
+	u32	head;
+	u32	tail;
+	u32	size;
+	u32	reserved;
+};
+
+struct davinci_pru_ring {
+	void __iomem	*hdr;
+	void __iomem	*data;
+	u32		size;
+};
+
+int davinci_pru_request(unsigned core, struct device *dev);
+void davinci_pru_release(unsigned core);
+void __iomem *davinci_pru_dram(unsigned core);
+
+int davinci_pru_load_firmware(unsigned core, const char *name);
+int davinci_pru_load(unsigned core, const u32 *code, size_t len);
+void davinci_pru_run(unsigned core);
+void davinci_pru_halt(unsigned core);
+bool davinci_pru_is_running(unsigned core);
+
+int davinci_pru_event_map(unsigned event, unsigned channel, unsigned host);
+void davinci_pru_event_enable(unsigned event);
+void davinci_pru_event_disable(unsigned event);
+void davinci_pru_event_clear(unsigned event);
+void davinci_pru_event_trigger(unsigned event);
+bool davinci_pru_event_pending(unsigned event);
+
+int davinci_pru_ring_init(struct davinci_pru_ring *ring,
+		void __iomem *base, size_t len);
+void davinci_pru_ring_attach(struct davinci_pru_ring *ring,
+		void __iomem *base);
+size_t davinci_pru_ring_count(struct davinci_pru_ring *ring);
+size_t davinci_pru_ring_space(struct davinci_pru_ring *ring);
+size_t davinci_pru_ring_write(struct davinci_pru_ring *ring,
+		const void *buf, size_t len);
+size_t davinci_pru_ring_read(struct davinci_pru_ring *ring,
+		void *buf, size_t len);
+
+#endif /* __ASM_ARCH_DAVINCI_PRU_H */
@@ -175,6 +175,7 @@
 #define DA850_LPSC1_MCBSP1		15
 #define DA8XX_LPSC1_LCDC		16
 #define DA8XX_LPSC1_PWM			17
+#define DA850_LPSC1_UPP			19
 #define DA8XX_LPSC1_ECAP		20
 #define DA830_LPSC1_EQEP		21
 #define DA850_LPSC1_TPTC2		21
@@ -193,12 +194,17 @@
 #define MDCTL		0xA00
 
 #define MDSTAT_STATE_MASK 0x1f
+#define MDCTL_LRST	BIT(8)	/* local reset, active low */
 
 #ifndef __ASSEMBLER__
 
 extern int davinci_psc_is_clk_active(unsigned int ctlr, unsigned int id);
 extern void davinci_psc_config(unsigned int domain, unsigned int ctlr,
 		unsigned int id, char enable);
+extern void davinci_psc_config_batch(unsigned int domain, unsigned int ctlr,
+		const unsigned int *ids, int n, char enable);
+extern void davinci_psc_local_reset(unsigned int ctlr, unsigned int id,
+		bool assert);
 
 #endif
 
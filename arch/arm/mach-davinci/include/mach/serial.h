@@ -30,8 +30,21 @@
 struct davinci_uart_config {
 	/* Bit field of UARTs present; bit 0 --> UART1 */
 	unsigned int enabled_uarts;
+	/* Bit field of UARTs whose data EDMA moves (DA8xx only) */
+	unsigned int dma_uarts;
 };
 
 extern int davinci_serial_init(struct davinci_uart_config *);
 
+struct plat_serial8250_port;
+#ifdef CONFIG_DAVINCI_UART_DMA
+extern int davinci_serial_dma_setup(struct plat_serial8250_port *p, int uart);
+#else
+static inline int davinci_serial_dma_setup(struct plat_serial8250_port *p,
+					   int uart)
+{
+	return -ENODEV;
+}
+#endif
+
 #endif /* __ASM_ARCH_SERIAL_H */
@@ -24,6 +24,18 @@ enum {
 	SPI_VERSION_2, /* For DA8xx */
 };
 
+/*
+ * Receive-only slave operation: the external master clocks a continuous
+ * stream into a ring buffer, exposed as a character device instead of an
+ * SPI bus (drivers/spi/davinci_spi_slave.c).
+ */
+struct davinci_spi_slave_config {
+	u8	bits_per_word;	/* 2 to 16 */
+	u16	mode;		/* SPI_CPOL, SPI_CPHA, SPI_LSB_FIRST, SPI_NO_CS */
+	u32	buf_size;	/* ring bytes, power of two */
+	u32	period_size;	/* bytes per DMA interrupt, power of two */
+};
+
 struct davinci_spi_platform_data {
 	u8	version;
 	u16	num_chipselect;
@@ -39,6 +51,7 @@ struct davinci_spi_platform_data {
 	u32	use_dma;
 	u8	c2tdelay;
 	u8	t2cdelay;
+	struct davinci_spi_slave_config *slave;	/* NULL for master mode */
 };
 
 #endif	/* __ARCH_ARM_DAVINCI_SPI_H */
@@ -10,9 +10,24 @@
 #ifndef __MACH_SRAM_H
 #define __MACH_SRAM_H
 
+#include <linux/compiler.h>
+
 /* ARBITRARY:  SRAM allocations are multiples of this 2^N size */
 #define SRAM_GRANULARITY	512
 
+/*
+ * SoCs may set aside named carve-outs at the start of SRAM, so that e.g.
+ * audio ping-pong buffers can't starve the idle and suspend code.  The
+ * list ends with an entry without a name.
+ */
+struct davinci_sram_carveout {
+	const char	*name;
+	unsigned	len;
+};
+
+#define SRAM_POOL_AUDIO		"audio"
+#define SRAM_POOL_PM		"pm"
+
 /*
  * SRAM allocations return a CPU virtual address, or NULL on error.
  * If a DMA address is requested and the SRAM supports DMA, its
@@ -22,6 +37,24 @@
  * DMA mapped SRAM on systems which don't allow that.
  */
 extern void *sram_alloc(size_t len, dma_addr_t *dma);
+extern void *sram_alloc_pool(const char *pool, size_t len, dma_addr_t *dma);
 extern void sram_free(void *addr, size_t len);
 
+/*
+ * With DAVINCI_SRAM_TEXT, code and constants tagged below are linked to
+ * run from the cached SRAM window at DAVINCI_SRAM_TEXT_VIRT, and copied
+ * there at core_initcall time; don't call them any earlier.  Calls between
+ * SRAM and DDR are out of BL range, hence long_call on the SRAM side; calls
+ * out of SRAM code rely on the linker's long branch stubs.
+ */
+#ifdef CONFIG_DAVINCI_SRAM_TEXT
+#define __sramfunc	__attribute__((long_call)) __section(.sram.text) noinline
+#define __sramlocalfunc	__section(.sram.text)
+#define __sramconst	__section(.sram.rodata)
+#else
+#define __sramfunc
+#define __sramlocalfunc
+#define __sramconst
+#endif
+
 #endif /* __MACH_SRAM_H */
@@ -32,4 +32,9 @@ enum {
 
 extern struct davinci_timer_instance davinci_timer_instance[];
 
+struct clocksource;
+
+/* the 64-bit timer, registered only if the SoC has one to spare */
+extern struct clocksource clocksource_davinci64;
+
 #endif /* __ARCH_ARM_MACH_DAVINCI_TIME_H */
@@ -0,0 +1,257 @@
+/*
+ * DaVinci interrupt priority control and handling time statistics
+ *
+ * Copyright (C) 2009 Texas Instruments, Inc. http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+
+#include <mach/irqs.h>
+#include <mach/common.h>
+#include <mach/cp_intc.h>
+
+/**
+ * davinci_irq_set_priority - change an interrupt's priority at runtime
+ * @irq: SoC interrupt controller interrupt number
+ * @prio: 0 (highest) to 7 on AINTC; the channel, 0 to 31, on CP_INTC
+ *
+ * In both cases the two lowest values steer the interrupt to nFIQ, so
+ * normal interrupts should use 2 and up.  Returns 0 or -EINVAL.
+ */
+int davinci_irq_set_priority(unsigned int irq, unsigned int prio)
+{
+#ifdef CONFIG_CP_INTC
+	if (davinci_intc_type == DAVINCI_INTC_TYPE_CP_INTC)
+		return cp_intc_set_irq_channel(irq, prio);
+#endif
+#ifdef CONFIG_AINTC
+	if (davinci_intc_type == DAVINCI_INTC_TYPE_AINTC)
+		return davinci_aintc_set_priority(irq, prio);
+#endif
+	return -EINVAL;
+}
+EXPORT_SYMBOL(davinci_irq_set_priority);
+
+/**
+ * davinci_irq_get_priority - read back an interrupt's priority
+ * @irq: SoC interrupt controller interrupt number
+ *
+ * Returns the value davinci_irq_set_priority() takes, or -EINVAL for
+ * interrupts the SoC controller doesn't own (e.g. GPIO banks' children).
+ */
+int davinci_irq_get_priority(unsigned int irq)
+{
+#ifdef CONFIG_CP_INTC
+	if (davinci_intc_type == DAVINCI_INTC_TYPE_CP_INTC)
+		return cp_intc_get_irq_channel(irq);
+#endif
+#ifdef CONFIG_AINTC
+	if (davinci_intc_type == DAVINCI_INTC_TYPE_AINTC)
+		return davinci_aintc_get_priority(irq);
+#endif
+	return -EINVAL;
+}
+EXPORT_SYMBOL(davinci_irq_get_priority);
+
+#ifdef CONFIG_DEBUG_FS
+
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#ifdef CONFIG_DAVINCI_IRQ_STATS
+/* log2 buckets of ~1us (1024 ns): < 1us, < 2us, ... < 16ms, longer */
+#define DAVINCI_IRQ_HIST_BINS	16
+
+struct davinci_irq_stat {
+	irq_flow_handler_t	handle;
+	unsigned int		count;
+	unsigned int		max_ns;
+	u64			total_ns;
+	unsigned int		hist[DAVINCI_IRQ_HIST_BINS];
+};
+
+static struct davinci_irq_stat davinci_irq_stats[NR_IRQS];
+
+/*
+ * Flow handler wrapper: time the real one.  Handlers that run with
+ * interrupts enabled include whatever nested inside them.
+ */
+static void davinci_irq_timed(unsigned int irq, struct irq_desc *desc)
+{
+	struct davinci_irq_stat *st = &davinci_irq_stats[irq];
+	unsigned long long start = sched_clock();
+	unsigned int ns;
+
+	st->handle(irq, desc);
+
+	ns = sched_clock() - start;
+	st->count++;
+	st->total_ns += ns;
+	if (ns > st->max_ns)
+		st->max_ns = ns;
+	st->hist[min(fls(ns >> 10), DAVINCI_IRQ_HIST_BINS - 1)]++;
+}
+
+static int davinci_irq_hist_show(struct seq_file *m, void *v)
+{
+	unsigned int irq, i;
+
+	seq_puts(m, "irq  handling time, upper bound of each bucket in us\n   ");
+	for (i = 0; i < DAVINCI_IRQ_HIST_BINS - 1; i++)
+		seq_printf(m, " %7u", 1 << i);
+	seq_puts(m, "   more\n");
+
+	for (irq = 0; irq < NR_IRQS; irq++) {
+		struct davinci_irq_stat *st = &davinci_irq_stats[irq];
+		struct irq_desc *desc = irq_to_desc(irq);
+
+		if (!st->count || !desc->action)
+			continue;
+
+		seq_printf(m, "%3u", irq);
+		for (i = 0; i < DAVINCI_IRQ_HIST_BINS; i++)
+			seq_printf(m, " %7u", st->hist[i]);
+		seq_printf(m, "  %s\n", desc->action->name);
+	}
+
+	return 0;
+}
+
+static int davinci_irq_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, davinci_irq_hist_show, NULL);
+}
+
+static const struct file_operations davinci_irq_hist_operations = {
+	.open		= davinci_irq_hist_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init davinci_irq_stats_init(void)
+{
+	unsigned int irq;
+
+	for (irq = 0; irq < NR_IRQS; irq++) {
+		struct irq_desc *desc = irq_to_desc(irq);
+		unsigned long flags;
+
+		if (davinci_irq_get_priority(irq) < 0)
+			continue;
+
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		if (desc->handle_irq) {
+			davinci_irq_stats[irq].handle = desc->handle_irq;
+			__set_irq_handler_unlocked(irq, davinci_irq_timed);
+		}
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+	}
+}
+#else
+static inline void davinci_irq_stats_init(void) { }
+#endif
+
+static int davinci_irq_show(struct seq_file *m, void *v)
+{
+	unsigned int irq;
+
+	for (irq = 0; irq < NR_IRQS; irq++) {
+		struct irq_desc *desc = irq_to_desc(irq);
+		int prio = davinci_irq_get_priority(irq);
+
+		if (prio < 0 || !desc->action)
+			continue;
+
+		seq_printf(m, "%3u prio %2d", irq, prio);
+#ifdef CONFIG_DAVINCI_IRQ_STATS
+		{
+			struct davinci_irq_stat *st = &davinci_irq_stats[irq];
+			u64 avg = st->total_ns;
+
+			if (st->count)
+				do_div(avg, st->count);
+			seq_printf(m, " count %10u avg %7llu ns max %7u ns",
+				   st->count, avg, st->max_ns);
+		}
+#endif
+		seq_printf(m, "  %s\n", desc->action->name);
+	}
+
+	return 0;
+}
+
+static int davinci_irq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, davinci_irq_show, NULL);
+}
+
+/* "<irq> <prio>" changes a priority; "reset" clears the statistics */
+static ssize_t davinci_irq_write(struct file *file, const char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	char buf[24];
+	unsigned int irq, prio;
+	int ret;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = 0;
+
+#ifdef CONFIG_DAVINCI_IRQ_STATS
+	if (!strncmp(buf, "reset", 5)) {
+		for (irq = 0; irq < NR_IRQS; irq++) {
+			davinci_irq_stats[irq].count = 0;
+			davinci_irq_stats[irq].max_ns = 0;
+			davinci_irq_stats[irq].total_ns = 0;
+			memset(davinci_irq_stats[irq].hist, 0,
+			       sizeof(davinci_irq_stats[irq].hist));
+		}
+		return count;
+	}
+#endif
+
+	if (sscanf(buf, "%u %u", &irq, &prio) != 2)
+		return -EINVAL;
+
+	ret = davinci_irq_set_priority(irq, prio);
+	return ret ? ret : count;
+}
+
+static const struct file_operations davinci_irq_operations = {
+	.open		= davinci_irq_open,
+	.read		= seq_read,
+	.write		= davinci_irq_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init davinci_irq_debugfs_init(void)
+{
+	davinci_irq_stats_init();
+	debugfs_create_file("davinci_irqs", S_IFREG | S_IRUGO | S_IWUSR, NULL,
+			    NULL, &davinci_irq_operations);
+#ifdef CONFIG_DAVINCI_IRQ_STATS
+	debugfs_create_file("davinci_irq_hist", S_IFREG | S_IRUGO, NULL,
+			    NULL, &davinci_irq_hist_operations);
+#endif
+	return 0;
+}
+device_initcall(davinci_irq_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
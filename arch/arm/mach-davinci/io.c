@@ -12,18 +12,46 @@
 #include <linux/io.h>
 
 #include <asm/tlb.h>
+#include <asm/mach/map.h>
+
+#include <mach/common.h>
 
 #define BETWEEN(p, st, sz)	((p) >= (st) && (p) < ((st) + (sz)))
 #define XLATE(p, pst, vst)	((void __iomem *)((p) - (pst) + (vst)))
 
 /*
  * Intercept ioremap() requests for addresses in our fixed mapping regions.
+ *
+ * IO_PHYS..IO_PHYS + IO_SIZE holds every SoC peripheral aperture (EMAC,
+ * EDMA, McASP, LCDC, ...) and is mapped with 1 MB sections, so handing
+ * drivers addresses in it costs no TLB entries beyond those few.  Any
+ * other device range the SoC maps statically (the DA8xx CP_INTC, ARM
+ * RAM) is resolved the same way rather than getting a second, 4 KB page
+ * mapped alias in the vmalloc area.  Only plain device mappings qualify:
+ * a write-combined or cached request still gets its own mapping.
  */
 void __iomem *davinci_ioremap(unsigned long p, size_t size, unsigned int type)
 {
+	struct map_desc *desc = davinci_soc_info.io_desc;
+	unsigned long i;
+
 	if (BETWEEN(p, IO_PHYS, IO_SIZE))
 		return XLATE(p, IO_PHYS, IO_VIRT);
 
+	if (type != MT_DEVICE)
+		goto remap;
+
+	for (i = 0; i < davinci_soc_info.io_desc_num; i++, desc++) {
+		unsigned long start = __pfn_to_phys(desc->pfn);
+
+		if (desc->type != MT_DEVICE || !BETWEEN(p, start, desc->length))
+			continue;
+		if (size > desc->length - (p - start))
+			break;
+		return XLATE(p, start, desc->virtual);
+	}
+
+remap:
 	return __arm_ioremap(p, size, type);
 }
 EXPORT_SYMBOL(davinci_ioremap);
@@ -0,0 +1,293 @@
+/*
+ * GPIO interrupt and wakeup latency tester
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Toggles an output GPIO wired back to an input GPIO and times, against
+ * the clocksource (timer64 where the SoC has one), how long the edge takes
+ * to reach
+ *
+ *	hardirq		the primary handler
+ *	thread		the threaded handler
+ *	wakeup		the task reading the results, woken by the thread
+ *
+ * The pins are given as module parameters, out_gpio and in_gpio.  Read
+ * irq_latency/run in debugfs for one run of irq_latency/samples edges,
+ * irq_latency/interval_ms apart: a min/avg/max line per stage, then a
+ * histogram in 1 us bins, the last bin counting everything slower.  Run
+ * the reader under chrt to see what a real-time task gets, and repeat
+ * with the load of interest (EMAC traffic, NAND, an LCD) for each kernel
+ * configuration.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/gpio.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/delay.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+
+#include <asm/sizes.h>
+
+#define IRQ_LAT_BINS		200	/* 1 us each, plus one for overflow */
+
+/* room for the whole histogram, so seq_read() never has to rerun it */
+#define IRQ_LAT_BUF		SZ_16K
+
+enum { LAT_HARDIRQ, LAT_THREAD, LAT_WAKEUP, LAT_STAGES };
+
+static const char *irq_lat_stage[LAT_STAGES] = {
+	[LAT_HARDIRQ]	= "hardirq",
+	[LAT_THREAD]	= "thread",
+	[LAT_WAKEUP]	= "wakeup",
+};
+
+static int out_gpio = -1;
+module_param(out_gpio, int, 0444);
+MODULE_PARM_DESC(out_gpio, "GPIO toggled by the test");
+
+static int in_gpio = -1;
+module_param(in_gpio, int, 0444);
+MODULE_PARM_DESC(in_gpio, "GPIO wired to out_gpio, its interrupt is timed");
+
+struct irq_lat_hist {
+	u32	bin[IRQ_LAT_BINS + 1];
+	u32	n;
+	u32	min_ns, max_ns;
+	u64	sum_ns;
+};
+
+static struct {
+	struct mutex		lock;
+	struct dentry		*dir;
+	int			irq;
+	int			level;
+
+	/* one edge in flight */
+	bool			armed;
+	ktime_t			start;
+	ktime_t			hardirq;
+	ktime_t			thread;
+	struct completion	done;
+
+	struct irq_lat_hist	hist[LAT_STAGES];
+	u32			missed;
+
+	/* settings for "run" */
+	u32			samples;
+	u32			interval_ms;
+} lat = {
+	.samples	= 1000,
+	.interval_ms	= 1,
+};
+
+static irqreturn_t irq_lat_hardirq(int irq, void *data)
+{
+	if (!lat.armed)
+		return IRQ_NONE;
+	lat.hardirq = ktime_get();
+	return IRQ_WAKE_THREAD;
+}
+
+static irqreturn_t irq_lat_thread(int irq, void *data)
+{
+	lat.thread = ktime_get();
+	lat.armed = false;
+	complete(&lat.done);
+	return IRQ_HANDLED;
+}
+
+static void irq_lat_add(struct irq_lat_hist *h, ktime_t from, ktime_t to)
+{
+	s64 ns = ktime_to_ns(ktime_sub(to, from));
+	u32 us;
+
+	if (ns < 0)
+		ns = 0;
+	us = div_u64(ns, NSEC_PER_USEC);
+	h->bin[min_t(u32, us, IRQ_LAT_BINS)]++;
+	if (!h->n++ || ns < h->min_ns)
+		h->min_ns = ns;
+	if (ns > h->max_ns)
+		h->max_ns = ns;
+	h->sum_ns += ns;
+}
+
+static int irq_lat_sample(void)
+{
+	unsigned long flags;
+	ktime_t woken;
+
+	INIT_COMPLETION(lat.done);
+	lat.level = !lat.level;
+
+	local_irq_save(flags);
+	lat.armed = true;
+	lat.start = ktime_get();
+	gpio_set_value(out_gpio, lat.level);
+	local_irq_restore(flags);
+
+	if (!wait_for_completion_timeout(&lat.done, HZ / 10)) {
+		lat.armed = false;
+		lat.missed++;
+		return -ETIMEDOUT;
+	}
+	woken = ktime_get();
+
+	irq_lat_add(&lat.hist[LAT_HARDIRQ], lat.start, lat.hardirq);
+	irq_lat_add(&lat.hist[LAT_THREAD], lat.start, lat.thread);
+	irq_lat_add(&lat.hist[LAT_WAKEUP], lat.start, woken);
+	return 0;
+}
+
+static int irq_lat_run_show(struct seq_file *m, void *v)
+{
+	unsigned i, s;
+	int ret = 0;
+
+	mutex_lock(&lat.lock);
+	memset(lat.hist, 0, sizeof(lat.hist));
+	lat.missed = 0;
+
+	for (i = 0; i < lat.samples; i++) {
+		if (signal_pending(current)) {
+			ret = -EINTR;
+			goto out;
+		}
+		/* ten missed edges in a row: the pins aren't wired together */
+		if (irq_lat_sample() && lat.missed >= 10 && lat.missed == i + 1) {
+			ret = -EIO;
+			goto out;
+		}
+		if (lat.interval_ms)
+			msleep(lat.interval_ms);
+	}
+
+	seq_printf(m, "# stage n min_ns avg_ns max_ns (missed %u)\n",
+		   lat.missed);
+	for (s = 0; s < LAT_STAGES; s++) {
+		struct irq_lat_hist *h = &lat.hist[s];
+		u64 avg = h->n ? div_u64(h->sum_ns, h->n) : 0;
+
+		seq_printf(m, "%s %u %u %llu %u\n", irq_lat_stage[s], h->n,
+			   h->min_ns, (unsigned long long)avg, h->max_ns);
+	}
+
+	seq_printf(m, "# us hardirq thread wakeup\n");
+	for (i = 0; i <= IRQ_LAT_BINS; i++) {
+		if (!lat.hist[LAT_HARDIRQ].bin[i] &&
+		    !lat.hist[LAT_THREAD].bin[i] &&
+		    !lat.hist[LAT_WAKEUP].bin[i])
+			continue;
+		seq_printf(m, "%s%u %u %u %u\n",
+			   i == IRQ_LAT_BINS ? ">=" : "", i,
+			   lat.hist[LAT_HARDIRQ].bin[i],
+			   lat.hist[LAT_THREAD].bin[i],
+			   lat.hist[LAT_WAKEUP].bin[i]);
+	}
+out:
+	mutex_unlock(&lat.lock);
+	return ret;
+}
+
+static int irq_lat_run_open(struct inode *inode, struct file *file)
+{
+	struct seq_file *m;
+	char *buf;
+	int ret;
+
+	buf = kmalloc(IRQ_LAT_BUF, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	ret = single_open(file, irq_lat_run_show, NULL);
+	if (ret) {
+		kfree(buf);
+		return ret;
+	}
+	m = file->private_data;
+	m->buf = buf;
+	m->size = IRQ_LAT_BUF;
+	return 0;
+}
+
+static const struct file_operations irq_lat_run_fops = {
+	.owner		= THIS_MODULE,
+	.open		= irq_lat_run_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init irq_lat_init(void)
+{
+	int ret;
+
+	if (!gpio_is_valid(out_gpio) || !gpio_is_valid(in_gpio))
+		return -EINVAL;
+	mutex_init(&lat.lock);
+	init_completion(&lat.done);
+
+	ret = gpio_request(out_gpio, "irq_latency out");
+	if (ret)
+		return ret;
+	ret = gpio_request(in_gpio, "irq_latency in");
+	if (ret)
+		goto fail_in;
+	gpio_direction_output(out_gpio, lat.level);
+	gpio_direction_input(in_gpio);
+
+	lat.irq = gpio_to_irq(in_gpio);
+	if (lat.irq < 0) {
+		ret = lat.irq;
+		goto fail_irq;
+	}
+	ret = request_threaded_irq(lat.irq, irq_lat_hardirq, irq_lat_thread,
+			IRQF_TRIGGER_RISING | IRQF_TRIGGER_FALLING,
+			"irq_latency", &lat);
+	if (ret)
+		goto fail_irq;
+
+	lat.dir = debugfs_create_dir("irq_latency", NULL);
+	if (IS_ERR_OR_NULL(lat.dir)) {
+		ret = lat.dir ? PTR_ERR(lat.dir) : -ENOMEM;
+		goto fail_debugfs;
+	}
+	debugfs_create_u32("samples", 0644, lat.dir, &lat.samples);
+	debugfs_create_u32("interval_ms", 0644, lat.dir, &lat.interval_ms);
+	debugfs_create_file("run", 0444, lat.dir, NULL, &irq_lat_run_fops);
+	return 0;
+
+fail_debugfs:
+	free_irq(lat.irq, &lat);
+fail_irq:
+	gpio_free(in_gpio);
+fail_in:
+	gpio_free(out_gpio);
+	return ret;
+}
+module_init(irq_lat_init);
+
+static void __exit irq_lat_exit(void)
+{
+	debugfs_remove_recursive(lat.dir);
+	free_irq(lat.irq, &lat);
+	gpio_free(in_gpio);
+	gpio_free(out_gpio);
+}
+module_exit(irq_lat_exit);
+
+MODULE_DESCRIPTION("DaVinci GPIO interrupt and wakeup latency tester");
+MODULE_LICENSE("GPL");
@@ -23,6 +23,7 @@
 #include <linux/interrupt.h>
 #include <linux/irq.h>
 #include <linux/io.h>
+#include <linux/spinlock.h>
 
 #include <mach/hardware.h>
 #include <mach/cputype.h>
@@ -42,6 +43,8 @@
 #define IRQ_INTPRI0_REG_OFFSET	0x0030
 #define IRQ_INTPRI7_REG_OFFSET	0x004C
 
+static DEFINE_SPINLOCK(davinci_irq_lock);
+
 static inline unsigned int davinci_irq_readl(int offset)
 {
 	return __raw_readl(davinci_intc_base + offset);
@@ -110,6 +113,41 @@ static struct irq_chip davinci_irq_chip_0 = {
 	.unmask = davinci_unmask_irq,
 };
 
+/*
+ * Each INTPRIn register holds a 3-bit priority for eight interrupts, one
+ * per nibble.  0-1 go to nFIQ, 2-7 to nIRQ with 7 the lowest; IRQENTRY
+ * then presents the highest priority pending interrupt first.
+ */
+#define IRQ_INTPRI_REG(irq)	(IRQ_INTPRI0_REG_OFFSET + ((irq) >> 3) * 4)
+#define IRQ_INTPRI_SHIFT(irq)	(((irq) & 7) * 4)
+
+int davinci_aintc_set_priority(unsigned int irq, unsigned int prio)
+{
+	unsigned long flags;
+	u32 pri;
+
+	if (irq >= DAVINCI_N_AINTC_IRQ || prio > 7)
+		return -EINVAL;
+
+	spin_lock_irqsave(&davinci_irq_lock, flags);
+	pri = davinci_irq_readl(IRQ_INTPRI_REG(irq));
+	pri &= ~(0x07 << IRQ_INTPRI_SHIFT(irq));
+	pri |= prio << IRQ_INTPRI_SHIFT(irq);
+	davinci_irq_writel(pri, IRQ_INTPRI_REG(irq));
+	spin_unlock_irqrestore(&davinci_irq_lock, flags);
+
+	return 0;
+}
+
+int davinci_aintc_get_priority(unsigned int irq)
+{
+	if (irq >= DAVINCI_N_AINTC_IRQ)
+		return -EINVAL;
+
+	return (davinci_irq_readl(IRQ_INTPRI_REG(irq)) >>
+			IRQ_INTPRI_SHIFT(irq)) & 0x07;
+}
+
 /* ARM Interrupt Controller Initialization */
 void __init davinci_irq_init(void)
 {
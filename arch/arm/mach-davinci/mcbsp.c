@@ -564,6 +564,40 @@ void davinci_mcbsp_config_multichannel_mode(struct davinci_mcbsp_dev *dev)
 }
 EXPORT_SYMBOL(davinci_mcbsp_config_multichannel_mode);
 
+/**
+ * davinci_mcbsp_set_channel_mask: Select the TDM slots to transfer
+ * @dev: McBSP device pointer
+ * @mode: DAVINCI_MCBSP_RX_MODE and/or DAVINCI_MCBSP_TX_MODE
+ * @mask: 128 bit slot mask, four words, bit n of the mask is slot n
+ *
+ * Puts the receiver and/or transmitter in 8 partition multichannel
+ * selection mode with just the slots in @mask enabled. Only enabled slots
+ * raise DMA events, so a frame in memory holds one word per enabled slot,
+ * in slot order. frame_length1 must cover the highest enabled slot.
+ */
+void davinci_mcbsp_set_channel_mask(struct davinci_mcbsp_dev *dev, u8 mode,
+							const u32 *mask)
+{
+	int i;
+
+	if (mode & DAVINCI_MCBSP_RX_MODE) {
+		for (i = 0; i < 8; i++)
+			dev->rx_params.cer[i] = mask[i / 2] >> ((i % 2) * 16);
+		dev->rx_params.mc_mode = DAVINCI_MCBSP_MC_RMCME |
+						DAVINCI_MCBSP_MC_RMCM1;
+	}
+
+	if (mode & DAVINCI_MCBSP_TX_MODE) {
+		for (i = 0; i < 8; i++)
+			dev->tx_params.cer[i] = mask[i / 2] >> ((i % 2) * 16);
+		dev->tx_params.mc_mode = DAVINCI_MCBSP_MC_XMCME |
+						DAVINCI_MCBSP_MC_XMCM1;
+	}
+
+	davinci_mcbsp_config_multichannel_mode(dev);
+}
+EXPORT_SYMBOL(davinci_mcbsp_set_channel_mask);
+
 /**
  * davinci_mcbsp_dma_tx_cb: Transmit DMA callback fucntion
  * @lch: Channel number for which the callback occurs
@@ -773,6 +807,229 @@ int davinci_mcbsp_recv_buf(struct davinci_mcbsp_dev *dev, dma_addr_t buf,
 }
 EXPORT_SYMBOL(davinci_mcbsp_recv_buf);
 
+/**
+ * davinci_mcbsp_stream_done: Streaming mode period completion
+ * @dev: McBSP device pointer
+ * @params: McBSP rx or tx parameters
+ * @tx: Flag indicating the transmit direction
+ * @ch_status: Status of the DMA transfer
+ *
+ * By the time the completion interrupt is handled the channel has already
+ * been reloaded with the other period, so work out from the current DMA
+ * address which period is done rather than counting interrupts.
+ */
+static void davinci_mcbsp_stream_done(struct davinci_mcbsp_dev *dev,
+		struct davinci_mcbsp_params *params, int tx, u16 ch_status)
+{
+	dma_addr_t src, dst, pos;
+	unsigned int period;
+
+	if (ch_status != DMA_COMPLETE) {
+		/* missed event, the linked PaRAM keeps the stream going */
+		params->stream_errors++;
+		dev_dbg(dev->dev, "%s stream DMA error %u\n",
+					tx ? "TX" : "RX", ch_status);
+		return;
+	}
+
+	edma_get_position(params->lch, &src, &dst);
+	pos = tx ? src : dst;
+	if (pos - params->stream_buf < params->stream_period_len)
+		period = 1;
+	else
+		period = 0;
+
+	if (params->stream_cb)
+		params->stream_cb(dev, period, params->stream_data);
+}
+
+static void davinci_mcbsp_stream_tx_cb(unsigned lch, u16 ch_status,
+								void *data)
+{
+	struct davinci_mcbsp_dev *dev = data;
+
+	davinci_mcbsp_stream_done(dev, &dev->tx_params, 1, ch_status);
+}
+
+static void davinci_mcbsp_stream_rx_cb(unsigned lch, u16 ch_status,
+								void *data)
+{
+	struct davinci_mcbsp_dev *dev = data;
+
+	davinci_mcbsp_stream_done(dev, &dev->rx_params, 0, ch_status);
+}
+
+/**
+ * davinci_mcbsp_stream_free: Release the streaming DMA resources
+ * @params: McBSP rx or tx parameters
+ * @lch: DMA channel used by the stream
+ */
+static void davinci_mcbsp_stream_free(struct davinci_mcbsp_params *params,
+								int lch)
+{
+	int i;
+
+	for (i = 0; i < DAVINCI_MCBSP_STREAM_PERIODS; i++) {
+		if (params->stream_slot[i] >= 0)
+			edma_free_slot(params->stream_slot[i]);
+		params->stream_slot[i] = -1;
+	}
+
+	edma_free_channel(lch);
+	params->stream_cb = NULL;
+}
+
+/**
+ * davinci_mcbsp_stream_start: Start continuous DMA streaming
+ * @dev: McBSP device pointer
+ * @mode: DAVINCI_MCBSP_RX_MODE or DAVINCI_MCBSP_TX_MODE
+ * @buf: DMA address of the buffer, DAVINCI_MCBSP_STREAM_PERIODS periods
+ * @period_len: length of one period in bytes
+ * @cb: called for every period completed
+ * @data: private data passed to @cb
+ *
+ * The DMA channel runs off two PaRAM slots linked to each other, one per
+ * period, so it reloads itself at the end of every period and never stops
+ * until davinci_mcbsp_stream_stop(). There is no gap between periods and
+ * no per-transfer restart. Data is interleaved: one word per slot, and
+ * per enabled slot in multichannel mode. The transmitter or receiver must
+ * be configured and started with davinci_mcbsp_start_tx/rx() beforehand,
+ * as for davinci_mcbsp_xmit_buf().
+ */
+int davinci_mcbsp_stream_start(struct davinci_mcbsp_dev *dev, u8 mode,
+		dma_addr_t buf, unsigned int period_len,
+		davinci_mcbsp_stream_cb cb, void *data)
+{
+	int tx = mode & DAVINCI_MCBSP_TX_MODE;
+	struct davinci_mcbsp_params *params;
+	struct edmacc_param param_set;
+	unsigned int acnt, bcnt;
+	int ret, lch, i;
+	u32 val;
+
+	params = tx ? &dev->tx_params : &dev->rx_params;
+	if (params->lch != -1)
+		return -EBUSY;
+
+	acnt = params->word_length1 / 8;
+	if (params->numevt)
+		acnt *= params->numevt;
+
+	bcnt = acnt ? period_len / acnt : 0;
+	if (!bcnt || bcnt > 0xffff || period_len % acnt)
+		return -EINVAL;
+
+	ret = edma_alloc_channel(params->dma_ch, tx ?
+			davinci_mcbsp_stream_tx_cb : davinci_mcbsp_stream_rx_cb,
+			dev, EVENTQ_0);
+	if (ret < 0)
+		return ret;
+	lch = ret;
+
+	for (i = 0; i < DAVINCI_MCBSP_STREAM_PERIODS; i++)
+		params->stream_slot[i] = -1;
+
+	for (i = 0; i < DAVINCI_MCBSP_STREAM_PERIODS; i++) {
+		ret = edma_alloc_slot(EDMA_CTLR(lch), EDMA_SLOT_ANY);
+		if (ret < 0) {
+			davinci_mcbsp_stream_free(params, lch);
+			return ret;
+		}
+		params->stream_slot[i] = ret;
+	}
+
+	if (params->numevt) {
+		if (tx) {
+			val = davinci_mcbsp_read_reg(dev, MCBSP_WFIFOCTL);
+			davinci_mcbsp_write_reg(dev, MCBSP_WFIFOCTL,
+							val | FIFOEN);
+		} else {
+			val = davinci_mcbsp_read_reg(dev, MCBSP_RFIFOCTL);
+			davinci_mcbsp_write_reg(dev, MCBSP_RFIFOCTL,
+							val | FIFOEN);
+		}
+		params->dma_addr = dev->fifo_base;
+	}
+
+	params->stream_buf = buf;
+	params->stream_period_len = period_len;
+	params->stream_cb = cb;
+	params->stream_data = data;
+	params->stream_errors = 0;
+
+	/* A-synchronized, one McBSP event moves one word (or FIFO burst) */
+	for (i = 0; i < DAVINCI_MCBSP_STREAM_PERIODS; i++) {
+		dma_addr_t addr = buf + i * period_len;
+
+		param_set.opt = TCINTEN | EDMA_TCC(EDMA_CHAN_SLOT(lch));
+		if (tx) {
+			param_set.src = addr;
+			param_set.dst = params->dma_addr;
+			param_set.src_dst_bidx = acnt;
+		} else {
+			param_set.src = params->dma_addr;
+			param_set.dst = addr;
+			param_set.src_dst_bidx = acnt << 16;
+		}
+		param_set.a_b_cnt = bcnt << 16 | acnt;
+		param_set.link_bcntrld = 0xffff;
+		param_set.src_dst_cidx = 0;
+		param_set.ccnt = 1;
+		edma_write_slot(params->stream_slot[i], &param_set);
+	}
+
+	/* ping -> pong -> ping ..., the channel starts on ping */
+	edma_link(params->stream_slot[0], params->stream_slot[1]);
+	edma_link(params->stream_slot[1], params->stream_slot[0]);
+	edma_read_slot(params->stream_slot[0], &param_set);
+	edma_write_slot(lch, &param_set);
+
+	params->lch = lch;
+	edma_start(lch);
+
+	if (tx)
+		davinci_mcbsp_trigger_tx(dev);
+	else
+		davinci_mcbsp_trigger_rx(dev);
+
+	return 0;
+}
+EXPORT_SYMBOL(davinci_mcbsp_stream_start);
+
+/**
+ * davinci_mcbsp_stream_stop: Stop continuous DMA streaming
+ * @dev: McBSP device pointer
+ * @mode: DAVINCI_MCBSP_RX_MODE or DAVINCI_MCBSP_TX_MODE
+ *
+ * Stops the DMA first so the transmitter can drain, then resets the
+ * transmitter or receiver and releases the DMA channel and slots.
+ */
+void davinci_mcbsp_stream_stop(struct davinci_mcbsp_dev *dev, u8 mode)
+{
+	int tx = mode & DAVINCI_MCBSP_TX_MODE;
+	struct davinci_mcbsp_params *params;
+	int lch;
+
+	params = tx ? &dev->tx_params : &dev->rx_params;
+	lch = params->lch;
+	if (lch == -1 || !params->stream_cb)
+		return;
+
+	edma_stop(lch);
+
+	if (tx)
+		davinci_mcbsp_stop_tx(dev);
+	else
+		davinci_mcbsp_stop_rx(dev);
+
+	davinci_mcbsp_stream_free(params, lch);
+
+	if (params->stream_errors)
+		dev_warn(dev->dev, "%s stream: %lu DMA errors\n",
+				tx ? "TX" : "RX", params->stream_errors);
+}
+EXPORT_SYMBOL(davinci_mcbsp_stream_stop);
+
 /**
  * davinci_mcbsp_handle_subframe_interrupt: Sub-frame interrupt management
  * for two partition multi-channel selection mode
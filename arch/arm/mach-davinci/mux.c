@@ -22,12 +22,13 @@
 #include <mach/mux.h>
 #include <mach/common.h>
 
+static DEFINE_SPINLOCK(mux_spin_lock);
+
 /*
  * Sets the DAVINCI MUX register based on the table
  */
 int __init_or_module davinci_cfg_reg(const unsigned long index)
 {
-	static DEFINE_SPINLOCK(mux_spin_lock);
 	struct davinci_soc_info *soc_info = &davinci_soc_info;
 	void __iomem *base = soc_info->pinmux_base;
 	unsigned long flags;
@@ -91,16 +92,114 @@ int __init_or_module davinci_cfg_reg(const unsigned long index)
 }
 EXPORT_SYMBOL(davinci_cfg_reg);
 
-int da8xx_pinmux_setup(const short pins[])
+/* Enough for the 20 PINMUX registers of DA850 */
+#define DAVINCI_MUX_REGS	32
+
+/*
+ * Apply a -1 terminated list of mux table indices.  The fields are merged
+ * per PINMUX register first, so each register touched by the list is read
+ * and written once, under a single hold of the lock.  Unlike
+ * davinci_cfg_reg() this stays available after init, e.g. to switch pins
+ * between the PRU soft UART and McASP at runtime.
+ */
+int davinci_cfg_reg_list(const short pins[])
 {
-	int i, error = -EINVAL;
+	struct davinci_soc_info *soc_info = &davinci_soc_info;
+	void __iomem *base = soc_info->pinmux_base;
+	u32 mask[DAVINCI_MUX_REGS], val[DAVINCI_MUX_REGS];
+	u32 reg_orig, reg;
+	const struct mux_config *cfg;
+	unsigned long flags, used = 0;
+	int i, r;
+
+	if (!pins)
+		return -EINVAL;
+	if (!soc_info->pinmux_pins)
+		BUG();
 
-	if (pins)
-		for (i = 0; pins[i] >= 0; i++) {
-			error = davinci_cfg_reg(pins[i]);
-			if (error)
-				break;
+	for (i = 0; pins[i] >= 0; i++) {
+		if (pins[i] >= soc_info->pinmux_pins_num) {
+			printk(KERN_ERR "Invalid pin mux index: %d (%lu)\n",
+			       pins[i], soc_info->pinmux_pins_num);
+			return -ENODEV;
 		}
 
-	return error;
+		cfg = &soc_info->pinmux_pins[pins[i]];
+		if (cfg->name == NULL) {
+			printk(KERN_ERR "No entry for the specified index\n");
+			return -ENODEV;
+		}
+		if (!cfg->mask)
+			continue;
+
+		r = cfg->mux_reg >> 2;
+		BUG_ON(r >= DAVINCI_MUX_REGS);
+		if (!(used & BIT(r))) {
+			used |= BIT(r);
+			mask[r] = val[r] = 0;
+		}
+		mask[r] |= cfg->mask << cfg->mask_offset;
+		val[r] &= ~(cfg->mask << cfg->mask_offset);
+		val[r] |= cfg->mode << cfg->mask_offset;
+	}
+
+	spin_lock_irqsave(&mux_spin_lock, flags);
+	for (r = 0; r < DAVINCI_MUX_REGS; r++) {
+		if (!(used & BIT(r)))
+			continue;
+
+		reg_orig = __raw_readl(base + (r << 2));
+		reg = (reg_orig & ~mask[r]) | val[r];
+		if (reg != reg_orig)
+			__raw_writel(reg, base + (r << 2));
+#ifdef CONFIG_DAVINCI_MUX_DEBUG
+		if (reg != reg_orig)
+			printk(KERN_WARNING "MUX: PINMUX%d = 0x%08x -> 0x%08x\n",
+			       r, reg_orig, reg);
+#endif
+	}
+	spin_unlock_irqrestore(&mux_spin_lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(davinci_cfg_reg_list);
+
+#ifdef CONFIG_HIBERNATION
+static u32 mux_saved[DAVINCI_MUX_REGS];
+static int mux_saved_num;
+
+/*
+ * Only the PINMUX registers named in the SoC's mux table are saved; the
+ * ones after them in SYSCFG (e.g. CHIPSIG on DA8xx) must not be replayed.
+ */
+void davinci_mux_save(void)
+{
+	struct davinci_soc_info *soc_info = &davinci_soc_info;
+	void __iomem *base = soc_info->pinmux_base;
+	int i, r;
+
+	mux_saved_num = 0;
+	for (i = 0; i < soc_info->pinmux_pins_num; i++) {
+		r = soc_info->pinmux_pins[i].mux_reg >> 2;
+		if (soc_info->pinmux_pins[i].name && r >= mux_saved_num)
+			mux_saved_num = min(r + 1, DAVINCI_MUX_REGS);
+	}
+
+	for (r = 0; r < mux_saved_num; r++)
+		mux_saved[r] = __raw_readl(base + (r << 2));
+}
+
+void davinci_mux_restore(void)
+{
+	void __iomem *base = davinci_soc_info.pinmux_base;
+	int r;
+
+	for (r = 0; r < mux_saved_num; r++)
+		__raw_writel(mux_saved[r], base + (r << 2));
+}
+#endif
+
+int da8xx_pinmux_setup(const short pins[])
+{
+	return davinci_cfg_reg_list(pins);
 }
@@ -15,11 +15,18 @@
 
 #include <mach/mux.h>
 
+#ifdef CONFIG_DAVINCI_MUX_DEBUG
+#define MUX_DEBUG_CFG(reg_name, dbg)					\
+			.mux_reg_name = reg_name,			\
+			.debug = dbg,
+#else
+#define MUX_DEBUG_CFG(reg_name, dbg)
+#endif
+
 #define MUX_CFG(soc, desc, muxreg, mode_offset, mode_mask, mux_mode, dbg)\
 [soc##_##desc] = {							\
 			.name =  #desc,					\
-			.debug = dbg,					\
-			.mux_reg_name = "PINMUX"#muxreg,		\
+			MUX_DEBUG_CFG("PINMUX"#muxreg, dbg)		\
 			.mux_reg = PINMUX##muxreg,			\
 			.mask_offset = mode_offset,			\
 			.mask = mode_mask,				\
@@ -29,8 +36,7 @@
 #define INT_CFG(soc, desc, mode_offset, mode_mask, mux_mode, dbg)	\
 [soc##_##desc] = {							\
 			.name =  #desc,					\
-			.debug = dbg,					\
-			.mux_reg_name = "INTMUX",			\
+			MUX_DEBUG_CFG("INTMUX", dbg)			\
 			.mux_reg = INTMUX,				\
 			.mask_offset = mode_offset,			\
 			.mask = mode_mask,				\
@@ -40,8 +46,7 @@
 #define EVT_CFG(soc, desc, mode_offset, mode_mask, mux_mode, dbg)	\
 [soc##_##desc] = {							\
 			.name =  #desc,					\
-			.debug = dbg,					\
-			.mux_reg_name = "EVTMUX",			\
+			MUX_DEBUG_CFG("EVTMUX", dbg)			\
 			.mux_reg = EVTMUX,				\
 			.mask_offset = mode_offset,			\
 			.mask = mode_mask,				\
@@ -14,6 +14,9 @@
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/spinlock.h>
+#include <linux/sched.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/cacheflush.h>
 #include <asm/delay.h>
@@ -29,6 +32,43 @@
 static void (*davinci_sram_suspend) (struct davinci_pm_config *);
 static struct davinci_pm_config *pdata;
 
+/*
+ * Resume latency of the last suspend: when each resume phase completed,
+ * counted from wake up, and the devices whose resume callbacks took
+ * longest.  Shown in debugfs davinci_resume.
+ */
+#define DAVINCI_RESUME_SLOWEST	8
+
+struct davinci_resume_dev {
+	char		name[24];
+	s64		usecs;
+};
+
+static struct davinci_resume_trace {
+	unsigned long long	wake;		/* SRAM code returned */
+	unsigned long long	early;		/* sysdevs, early resume done */
+	unsigned long long	devices;	/* device resume done */
+	unsigned long long	thawed;		/* tasks running again */
+	struct davinci_resume_dev slowest[DAVINCI_RESUME_SLOWEST];
+} davinci_resume;
+
+static bool davinci_resuming;
+
+/* Hooked into device_resume(); runs in the PM task, tasks frozen */
+void arch_device_resume_time(struct device *dev, s64 usecs)
+{
+	struct davinci_resume_dev *d = davinci_resume.slowest;
+	int i = DAVINCI_RESUME_SLOWEST - 1;
+
+	if (!davinci_resuming || usecs <= d[i].usecs)
+		return;
+
+	for (; i > 0 && usecs > d[i - 1].usecs; i--)
+		d[i] = d[i - 1];
+	d[i].usecs = usecs;
+	strlcpy(d[i].name, dev_name(dev), sizeof d[i].name);
+}
+
 static void davinci_sram_push(void *dest, void *src, unsigned int size)
 {
 	memcpy(dest, src, size);
@@ -60,38 +100,15 @@ static void davinci_pm_suspend(void)
 	val |= pdata->sleepcount;
 	__raw_writel(val, pdata->deepsleep_reg);
 
-	/* System goes to sleep in this call */
+	/*
+	 * System goes to sleep in this call.  The SRAM code relocks the CPU
+	 * PLL along with the DDR PLL before returning; done from here, the
+	 * udelay()s would also run off OSCIN while calibrated for the PLL,
+	 * an order of magnitude longer than asked.
+	 */
 	davinci_sram_suspend(pdata);
 
-	if (pdata->cpupll_reg_base != pdata->ddrpll_reg_base) {
-
-		/* put CPU PLL in reset */
-		val = __raw_readl(pdata->cpupll_reg_base + PLLCTL);
-		val &= ~PLLCTL_PLLRST;
-		__raw_writel(val, pdata->cpupll_reg_base + PLLCTL);
-
-		/* put CPU PLL in power down */
-		val = __raw_readl(pdata->cpupll_reg_base + PLLCTL);
-		val &= ~PLLCTL_PLLPWRDN;
-		__raw_writel(val, pdata->cpupll_reg_base + PLLCTL);
-
-		/* wait for CPU PLL reset */
-		udelay(PLL_RESET_TIME);
-
-		/* bring CPU PLL out of reset */
-		val = __raw_readl(pdata->cpupll_reg_base + PLLCTL);
-		val |= PLLCTL_PLLRST;
-		__raw_writel(val, pdata->cpupll_reg_base + PLLCTL);
-
-		/* Wait for CPU PLL to lock */
-		udelay(PLL_LOCK_TIME);
-
-		/* Remove CPU PLL from bypass mode */
-		val = __raw_readl(pdata->cpupll_reg_base + PLLCTL);
-		val &= ~PLLCTL_PLLENSRC;
-		val |= PLLCTL_PLLEN;
-		__raw_writel(val, pdata->cpupll_reg_base + PLLCTL);
-	}
+	davinci_resume.wake = sched_clock();
 }
 
 static int davinci_pm_enter(suspend_state_t state)
@@ -110,11 +127,93 @@ static int davinci_pm_enter(suspend_state_t state)
 	return ret;
 }
 
+static int davinci_pm_begin(suspend_state_t state)
+{
+	memset(&davinci_resume, 0, sizeof davinci_resume);
+	return 0;
+}
+
+static void davinci_pm_finish(void)
+{
+	davinci_resume.early = sched_clock();
+	davinci_resuming = true;
+}
+
+static void davinci_pm_end(void)
+{
+	davinci_resume.devices = sched_clock();
+	davinci_resuming = false;
+}
+
 static struct platform_suspend_ops davinci_pm_ops = {
+	.begin		= davinci_pm_begin,
 	.enter		= davinci_pm_enter,
+	.finish		= davinci_pm_finish,
+	.end		= davinci_pm_end,
 	.valid		= suspend_valid_only_mem,
 };
 
+static int davinci_pm_notify(struct notifier_block *nb, unsigned long event,
+			     void *unused)
+{
+	if (event == PM_POST_SUSPEND && davinci_resume.wake)
+		davinci_resume.thawed = sched_clock();
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block davinci_pm_nb = {
+	.notifier_call	= davinci_pm_notify,
+};
+
+#ifdef CONFIG_DEBUG_FS
+static void davinci_resume_phase(struct seq_file *m, const char *phase,
+				 unsigned long long ns)
+{
+	if (ns)
+		seq_printf(m, "%-20s %9llu us\n", phase,
+			   (ns - davinci_resume.wake) / 1000);
+}
+
+static int davinci_resume_show(struct seq_file *m, void *v)
+{
+	struct davinci_resume_dev *d = davinci_resume.slowest;
+	int i;
+
+	if (!davinci_resume.wake)
+		return 0;
+
+	davinci_resume_phase(m, "early resume", davinci_resume.early);
+	davinci_resume_phase(m, "devices resumed", davinci_resume.devices);
+	davinci_resume_phase(m, "tasks thawed", davinci_resume.thawed);
+
+	seq_printf(m, "\nslowest device resumes:\n");
+	for (i = 0; i < DAVINCI_RESUME_SLOWEST && d[i].usecs; i++)
+		seq_printf(m, "%-20s %9lld us\n", d[i].name, d[i].usecs);
+
+	return 0;
+}
+
+static int davinci_resume_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, davinci_resume_show, NULL);
+}
+
+static const struct file_operations davinci_resume_fops = {
+	.open		= davinci_resume_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init davinci_resume_debugfs_init(void)
+{
+	debugfs_create_file("davinci_resume", S_IFREG | S_IRUGO, NULL, NULL,
+			    &davinci_resume_fops);
+}
+#else
+static inline void davinci_resume_debugfs_init(void) { }
+#endif
+
 static int __init davinci_pm_probe(struct platform_device *pdev)
 {
 	pdata = pdev->dev.platform_data;
@@ -123,7 +222,8 @@ static int __init davinci_pm_probe(struct platform_device *pdev)
 		return -ENOENT;
 	}
 
-	davinci_sram_suspend = sram_alloc(davinci_cpu_suspend_sz, NULL);
+	davinci_sram_suspend = sram_alloc_pool(SRAM_POOL_PM,
+					       davinci_cpu_suspend_sz, NULL);
 	if (!davinci_sram_suspend) {
 		dev_err(&pdev->dev, "cannot allocate SRAM memory\n");
 		return -ENOMEM;
@@ -133,6 +233,8 @@ static int __init davinci_pm_probe(struct platform_device *pdev)
 						davinci_cpu_suspend_sz);
 
 	suspend_set_ops(&davinci_pm_ops);
+	register_pm_notifier(&davinci_pm_nb);
+	davinci_resume_debugfs_init();
 
 	return 0;
 }
@@ -0,0 +1,482 @@
+/*
+ * DA8xx PRU subsystem runtime
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The PRUSS has two cores sharing one interrupt controller.  The drivers
+ * built on it (soft UART, smart card, CAN) used to poke both directly
+ * through private copies of the TI HAL, so two of them could silently
+ * load over each other.  This file owns the subsystem instead:
+ *
+ *  - cores are claimed per driver, and loaded with request_firmware();
+ *  - PRU_INTC system events are mapped, enabled and raised through one
+ *    locked API, which is also the ARM<->PRU mailbox;
+ *  - SPSC rings in PRU data RAM or shared RAM let firmware hand the ARM
+ *    whole blocks of data instead of one register read per byte.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/device.h>
+#include <linux/firmware.h>
+#include <linux/clk.h>
+#include <linux/io.h>
+#include <linux/delay.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/err.h>
+#include <linux/log2.h>
+
+#include <mach/cputype.h>
+#include <mach/pru.h>
+
+/* offsets in the PRUSS */
+#define PRU_DRAM(n)		((n) * 0x2000)
+#define PRU_INTC		0x4000
+#define PRU_CTRL(n)		(0x7000 + (n) * 0x800)
+#define PRU_IRAM(n)		(0x8000 + (n) * 0x4000)
+
+/* PRU control registers */
+#define PRU_CONTROL		0x00
+#define PRU_CONTROL_SOFT_RST_N	BIT(0)
+#define PRU_CONTROL_ENABLE	BIT(1)
+#define PRU_CONTROL_COUNTENABLE	BIT(3)
+#define PRU_CONTROL_RUNSTATE	BIT(15)
+
+/* PRU_INTC registers */
+#define INTC_GER		0x010
+#define INTC_SISR		0x020
+#define INTC_SICR		0x024
+#define INTC_EISR		0x028
+#define INTC_EICR		0x02c
+#define INTC_HIEISR		0x034
+#define INTC_SRSR(n)		(0x200 + (n) * 4)
+#define INTC_CMR(n)		(0x400 + (n) * 4)
+#define INTC_HMR(n)		(0x800 + (n) * 4)
+#define INTC_SIPR(n)		(0xd00 + (n) * 4)
+#define INTC_SITR(n)		(0xd80 + (n) * 4)
+
+#define PRU_HALT_TIMEOUT_US	1000
+
+static void __iomem *pruss_base;
+static struct clk *pruss_clk;
+
+static DEFINE_MUTEX(pru_lock);
+static struct device *pru_owner[DAVINCI_PRU_NUM_CORES];
+static unsigned pru_users;
+
+/* serialises read-modify-write of the INTC map registers */
+static DEFINE_SPINLOCK(pru_intc_lock);
+
+/**
+ * davinci_pru_request - claim a PRU core
+ * @core: 0 or 1
+ * @dev: the claiming driver's device, also used to find its firmware
+ *
+ * Powers up the PRUSS on the first claim.  Returns -EBUSY if another
+ * driver already owns @core.
+ */
+int davinci_pru_request(unsigned core, struct device *dev)
+{
+	int ret = 0;
+
+	if (!pruss_base)
+		return -ENODEV;
+	if (core >= DAVINCI_PRU_NUM_CORES || !dev)
+		return -EINVAL;
+
+	mutex_lock(&pru_lock);
+	if (pru_owner[core]) {
+		dev_err(dev, "PRU%u is already used by %s\n", core,
+				dev_name(pru_owner[core]));
+		ret = -EBUSY;
+		goto out;
+	}
+	if (!pru_users++)
+		clk_enable(pruss_clk);
+	pru_owner[core] = dev;
+out:
+	mutex_unlock(&pru_lock);
+	return ret;
+}
+EXPORT_SYMBOL(davinci_pru_request);
+
+/**
+ * davinci_pru_release - halt a PRU core and give it up
+ * @core: a core claimed with davinci_pru_request()
+ */
+void davinci_pru_release(unsigned core)
+{
+	if (core >= DAVINCI_PRU_NUM_CORES)
+		return;
+
+	mutex_lock(&pru_lock);
+	if (pru_owner[core]) {
+		davinci_pru_halt(core);
+		pru_owner[core] = NULL;
+		if (!--pru_users)
+			clk_disable(pruss_clk);
+	}
+	mutex_unlock(&pru_lock);
+}
+EXPORT_SYMBOL(davinci_pru_release);
+
+/**
+ * davinci_pru_dram - ARM mapping of a core's 512 byte data RAM
+ * @core: 0 or 1
+ */
+void __iomem *davinci_pru_dram(unsigned core)
+{
+	if (!pruss_base || core >= DAVINCI_PRU_NUM_CORES)
+		return NULL;
+	return pruss_base + PRU_DRAM(core);
+}
+EXPORT_SYMBOL(davinci_pru_dram);
+
+/**
+ * davinci_pru_halt - stop a core and wait for it to finish its instruction
+ * @core: 0 or 1
+ */
+void davinci_pru_halt(unsigned core)
+{
+	void __iomem *ctrl = pruss_base + PRU_CTRL(core) + PRU_CONTROL;
+	unsigned timeout = PRU_HALT_TIMEOUT_US;
+	u32 val;
+
+	val = __raw_readl(ctrl);
+	__raw_writel(val & ~(PRU_CONTROL_ENABLE | PRU_CONTROL_COUNTENABLE),
+			ctrl);
+	while ((__raw_readl(ctrl) & PRU_CONTROL_RUNSTATE) && --timeout)
+		udelay(1);
+	if (!timeout)
+		pr_warning("PRU%u: timeout waiting for halt\n", core);
+}
+EXPORT_SYMBOL(davinci_pru_halt);
+
+/**
+ * davinci_pru_run - start a core at address 0
+ * @core: 0 or 1
+ */
+void davinci_pru_run(unsigned core)
+{
+	void __iomem *ctrl = pruss_base + PRU_CTRL(core) + PRU_CONTROL;
+
+	/* a soft reset clears the program counter back to 0 */
+	__raw_writel(0, ctrl);
+	__raw_writel(PRU_CONTROL_SOFT_RST_N | PRU_CONTROL_ENABLE |
+			PRU_CONTROL_COUNTENABLE, ctrl);
+}
+EXPORT_SYMBOL(davinci_pru_run);
+
+bool davinci_pru_is_running(unsigned core)
+{
+	return __raw_readl(pruss_base + PRU_CTRL(core) + PRU_CONTROL) &
+			PRU_CONTROL_RUNSTATE;
+}
+EXPORT_SYMBOL(davinci_pru_is_running);
+
+/**
+ * davinci_pru_load - copy a program into a halted core's instruction RAM
+ * @core: a claimed core
+ * @code: the PRU instructions
+ * @len: length of @code in bytes
+ *
+ * The core is left halted; start it with davinci_pru_run().
+ */
+int davinci_pru_load(unsigned core, const u32 *code, size_t len)
+{
+	void __iomem *iram;
+	size_t i;
+
+	if (core >= DAVINCI_PRU_NUM_CORES || !pru_owner[core])
+		return -EINVAL;
+	if (!len || len > DAVINCI_PRU_IRAM_SIZE || len & 3)
+		return -EINVAL;
+
+	davinci_pru_halt(core);
+
+	iram = pruss_base + PRU_IRAM(core);
+	for (i = 0; i < len / 4; i++)
+		__raw_writel(code[i], iram + i * 4);
+
+	return 0;
+}
+EXPORT_SYMBOL(davinci_pru_load);
+
+/**
+ * davinci_pru_load_firmware - load a core from a firmware file
+ * @core: a claimed core
+ * @name: file name, looked up relative to the firmware directory
+ */
+int davinci_pru_load_firmware(unsigned core, const char *name)
+{
+	const struct firmware *fw;
+	int ret;
+
+	if (core >= DAVINCI_PRU_NUM_CORES || !pru_owner[core])
+		return -EINVAL;
+
+	ret = request_firmware(&fw, name, pru_owner[core]);
+	if (ret) {
+		dev_err(pru_owner[core], "can't load PRU firmware %s\n", name);
+		return ret;
+	}
+
+	ret = davinci_pru_load(core, (const u32 *)fw->data, fw->size);
+	if (ret)
+		dev_err(pru_owner[core], "bad PRU firmware %s (%zu bytes)\n",
+				name, fw->size);
+
+	release_firmware(fw);
+	return ret;
+}
+EXPORT_SYMBOL(davinci_pru_load_firmware);
+
+/*
+ * PRU_INTC system events.  Events 0..31 are raised by peripherals, 32..63
+ * by the PRUs or, through davinci_pru_event_trigger(), by the ARM; the
+ * latter are the mailbox doorbells in both directions.
+ */
+
+static void pru_intc_set_byte(unsigned reg, unsigned n, u8 val)
+{
+	void __iomem *addr = pruss_base + PRU_INTC + reg + (n & ~3);
+	unsigned shift = (n & 3) * 8;
+	u32 tmp;
+
+	tmp = __raw_readl(addr);
+	tmp &= ~(0xff << shift);
+	tmp |= val << shift;
+	__raw_writel(tmp, addr);
+}
+
+/**
+ * davinci_pru_event_map - route a system event to a host interrupt
+ * @event: system event, 0..63
+ * @channel: INTC channel, 0..9; lower channels win over higher ones
+ * @host: host interrupt, 0..9; use DAVINCI_PRU_HOST_ARM() for the ARM
+ *
+ * The event is made active high and pulse triggered, which is what PRU
+ * firmware generates, and the host interrupt is enabled.  The event
+ * itself stays disabled until davinci_pru_event_enable().
+ */
+int davinci_pru_event_map(unsigned event, unsigned channel, unsigned host)
+{
+	void __iomem *intc = pruss_base + PRU_INTC;
+	unsigned long flags;
+	u32 tmp;
+
+	if (!pruss_base)
+		return -ENODEV;
+	if (event >= DAVINCI_PRU_NUM_EVENTS ||
+			channel >= DAVINCI_PRU_NUM_CHANNELS ||
+			host >= DAVINCI_PRU_NUM_CHANNELS)
+		return -EINVAL;
+
+	spin_lock_irqsave(&pru_intc_lock, flags);
+
+	tmp = __raw_readl(intc + INTC_SIPR(event / 32));
+	__raw_writel(tmp | BIT(event % 32), intc + INTC_SIPR(event / 32));
+	tmp = __raw_readl(intc + INTC_SITR(event / 32));
+	__raw_writel(tmp & ~BIT(event % 32), intc + INTC_SITR(event / 32));
+
+	pru_intc_set_byte(INTC_CMR(0), event, channel);
+	pru_intc_set_byte(INTC_HMR(0), channel, host);
+
+	__raw_writel(event, intc + INTC_SICR);
+	__raw_writel(host, intc + INTC_HIEISR);
+	__raw_writel(1, intc + INTC_GER);
+
+	spin_unlock_irqrestore(&pru_intc_lock, flags);
+	return 0;
+}
+EXPORT_SYMBOL(davinci_pru_event_map);
+
+/* the indexed set/clear registers are atomic, so these need no lock */
+void davinci_pru_event_enable(unsigned event)
+{
+	__raw_writel(event, pruss_base + PRU_INTC + INTC_EISR);
+}
+EXPORT_SYMBOL(davinci_pru_event_enable);
+
+void davinci_pru_event_disable(unsigned event)
+{
+	__raw_writel(event, pruss_base + PRU_INTC + INTC_EICR);
+}
+EXPORT_SYMBOL(davinci_pru_event_disable);
+
+void davinci_pru_event_clear(unsigned event)
+{
+	__raw_writel(event, pruss_base + PRU_INTC + INTC_SICR);
+}
+EXPORT_SYMBOL(davinci_pru_event_clear);
+
+/**
+ * davinci_pru_event_trigger - raise a system event from the ARM
+ * @event: system event, normally one a PRU polls as its doorbell
+ */
+void davinci_pru_event_trigger(unsigned event)
+{
+	/* ring data written before the doorbell must be visible first */
+	wmb();
+	__raw_writel(event, pruss_base + PRU_INTC + INTC_SISR);
+}
+EXPORT_SYMBOL(davinci_pru_event_trigger);
+
+bool davinci_pru_event_pending(unsigned event)
+{
+	return __raw_readl(pruss_base + PRU_INTC + INTC_SRSR(event / 32)) &
+			BIT(event % 32);
+}
+EXPORT_SYMBOL(davinci_pru_event_pending);
+
+/*
+ * SPSC rings.  The producer copies its data in, then publishes the new
+ * head; the consumer reads head, copies out, then publishes the new tail.
+ * The barriers keep each side's index update behind its data accesses,
+ * which is all the ordering a single producer and consumer need.
+ */
+
+#define RING_HEAD(r)	((r)->hdr + offsetof(struct davinci_pru_ring_hdr, head))
+#define RING_TAIL(r)	((r)->hdr + offsetof(struct davinci_pru_ring_hdr, tail))
+#define RING_SIZE(r)	((r)->hdr + offsetof(struct davinci_pru_ring_hdr, size))
+
+/**
+ * davinci_pru_ring_init - lay out an empty ring
+ * @ring: host side handle
+ * @base: ARM mapping of the ring memory, 4 byte aligned
+ * @len: bytes at @base, header included
+ *
+ * The data area is the largest power of two that fits after the header.
+ * Do this before starting the firmware on the other end.
+ */
+int davinci_pru_ring_init(struct davinci_pru_ring *ring,
+		void __iomem *base, size_t len)
+{
+	if (len <= sizeof(struct davinci_pru_ring_hdr) + 4)
+		return -EINVAL;
+
+	ring->hdr = base;
+	ring->data = base + sizeof(struct davinci_pru_ring_hdr);
+	ring->size = rounddown_pow_of_two(len -
+			sizeof(struct davinci_pru_ring_hdr));
+
+	__raw_writel(0, RING_HEAD(ring));
+	__raw_writel(0, RING_TAIL(ring));
+	__raw_writel(ring->size, RING_SIZE(ring));
+	wmb();
+	return 0;
+}
+EXPORT_SYMBOL(davinci_pru_ring_init);
+
+/**
+ * davinci_pru_ring_attach - use a ring the firmware has already laid out
+ * @ring: host side handle
+ * @base: ARM mapping of the ring header
+ */
+void davinci_pru_ring_attach(struct davinci_pru_ring *ring,
+		void __iomem *base)
+{
+	ring->hdr = base;
+	ring->data = base + sizeof(struct davinci_pru_ring_hdr);
+	ring->size = __raw_readl(RING_SIZE(ring));
+}
+EXPORT_SYMBOL(davinci_pru_ring_attach);
+
+size_t davinci_pru_ring_count(struct davinci_pru_ring *ring)
+{
+	return __raw_readl(RING_HEAD(ring)) - __raw_readl(RING_TAIL(ring));
+}
+EXPORT_SYMBOL(davinci_pru_ring_count);
+
+size_t davinci_pru_ring_space(struct davinci_pru_ring *ring)
+{
+	return ring->size - davinci_pru_ring_count(ring);
+}
+EXPORT_SYMBOL(davinci_pru_ring_space);
+
+/**
+ * davinci_pru_ring_write - produce into a ring
+ * @ring: a ring the ARM is the only producer of
+ * @buf: data
+ * @len: bytes in @buf
+ *
+ * Copies as much of @buf as fits and returns the number of bytes queued.
+ */
+size_t davinci_pru_ring_write(struct davinci_pru_ring *ring,
+		const void *buf, size_t len)
+{
+	u32 head = __raw_readl(RING_HEAD(ring));
+	u32 tail = __raw_readl(RING_TAIL(ring));
+	u32 off = head & (ring->size - 1);
+	size_t first;
+
+	/* don't overwrite anything the consumer may still be reading */
+	mb();
+
+	len = min_t(size_t, len, ring->size - (head - tail));
+	first = min_t(size_t, len, ring->size - off);
+	memcpy_toio(ring->data + off, buf, first);
+	memcpy_toio(ring->data, buf + first, len - first);
+
+	wmb();
+	__raw_writel(head + len, RING_HEAD(ring));
+	return len;
+}
+EXPORT_SYMBOL(davinci_pru_ring_write);
+
+/**
+ * davinci_pru_ring_read - consume from a ring
+ * @ring: a ring the ARM is the only consumer of
+ * @buf: destination
+ * @len: room in @buf
+ *
+ * Returns the number of bytes copied, 0 if the ring was empty.
+ */
+size_t davinci_pru_ring_read(struct davinci_pru_ring *ring,
+		void *buf, size_t len)
+{
+	u32 head = __raw_readl(RING_HEAD(ring));
+	u32 tail = __raw_readl(RING_TAIL(ring));
+	u32 off = tail & (ring->size - 1);
+	size_t first;
+
+	/* read the data only after seeing the head that covers it */
+	rmb();
+
+	len = min_t(size_t, len, head - tail);
+	first = min_t(size_t, len, ring->size - off);
+	memcpy_fromio(buf, ring->data + off, first);
+	memcpy_fromio(buf + first, ring->data, len - first);
+
+	mb();
+	__raw_writel(tail + len, RING_TAIL(ring));
+	return len;
+}
+EXPORT_SYMBOL(davinci_pru_ring_read);
+
+static int __init davinci_pru_init(void)
+{
+	if (!cpu_is_davinci_da8xx())
+		return 0;
+
+	pruss_clk = clk_get(NULL, "pru_ck");
+	if (IS_ERR(pruss_clk)) {
+		pr_err("PRU: no clock\n");
+		return PTR_ERR(pruss_clk);
+	}
+
+	pruss_base = ioremap(DA8XX_PRUSS_BASE, DA8XX_PRUSS_SIZE);
+	if (!pruss_base) {
+		clk_put(pruss_clk);
+		return -ENOMEM;
+	}
+	return 0;
+}
+postcore_initcall(davinci_pru_init);
@@ -21,12 +21,13 @@
 #include <linux/kernel.h>
 #include <linux/init.h>
 #include <linux/io.h>
+#include <linux/module.h>
 
 #include <mach/cputype.h>
 #include <mach/psc.h>
 
 /* Return nonzero iff the domain's clock is active */
-int __init davinci_psc_is_clk_active(unsigned int ctlr, unsigned int id)
+int davinci_psc_is_clk_active(unsigned int ctlr, unsigned int id)
 {
 	void __iomem *psc_base;
 	u32 mdstat;
@@ -44,23 +45,26 @@ int __init davinci_psc_is_clk_active(unsigned int ctlr, unsigned int id)
 	/* if clocked, state can be "Enable" or "SyncReset" */
 	return mdstat & BIT(12);
 }
+EXPORT_SYMBOL(davinci_psc_is_clk_active);
 
-/* Enable or disable a PSC domain */
-void davinci_psc_config(unsigned int domain, unsigned int ctlr,
-		unsigned int id, char enable)
+static void __iomem *psc_get_base(unsigned int ctlr)
 {
-	u32 epcpr, ptcmd, ptstat, pdstat, pdctl1, mdstat, mdctl;
-	void __iomem *psc_base;
 	struct davinci_soc_info *soc_info = &davinci_soc_info;
-	u32 next_state = enable ? 0x3 : 0x2; /* 0x3 enables, 0x2 disables */
 
 	if (!soc_info->psc_bases || (ctlr >= soc_info->psc_bases_num)) {
 		pr_warning("PSC: Bad psc data: 0x%x[%d]\n",
 				(int)soc_info->psc_bases, ctlr);
-		return;
+		return NULL;
 	}
 
-	psc_base = soc_info->psc_bases[ctlr];
+	return soc_info->psc_bases[ctlr];
+}
+
+/* Program the next state of one module; takes effect on the next GO */
+static void psc_set_next_state(void __iomem *psc_base, unsigned int ctlr,
+		unsigned int id, u32 next_state)
+{
+	u32 mdctl;
 
 	mdctl = __raw_readl(psc_base + MDCTL + 4 * id);
 	mdctl &= ~MDSTAT_STATE_MASK;
@@ -69,6 +73,12 @@ void davinci_psc_config(unsigned int domain, unsigned int ctlr,
 	if (cpu_is_davinci_da850() && (id == 8) && (ctlr == 1))
 		mdctl |= 0x80000000;
 	__raw_writel(mdctl, psc_base + MDCTL + 4 * id);
+}
+
+/* Issue GO for a domain, powering it up first if needed, and wait for it */
+static void psc_go(void __iomem *psc_base, unsigned int domain)
+{
+	u32 epcpr, ptcmd, ptstat, pdstat, pdctl1;
 
 	pdstat = __raw_readl(psc_base + PDSTAT);
 	if ((pdstat & 0x00000001) == 0) {
@@ -99,8 +109,73 @@ void davinci_psc_config(unsigned int domain, unsigned int ctlr,
 			ptstat = __raw_readl(psc_base + PTSTAT);
 		} while (!(((ptstat >> domain) & 1) == 0));
 	}
+}
+
+static void psc_wait_state(void __iomem *psc_base, unsigned int id,
+		u32 next_state)
+{
+	u32 mdstat;
 
 	do {
 		mdstat = __raw_readl(psc_base + MDSTAT + 4 * id);
 	} while (!((mdstat & MDSTAT_STATE_MASK) == next_state));
 }
+
+/* Enable or disable a PSC domain */
+void davinci_psc_config(unsigned int domain, unsigned int ctlr,
+		unsigned int id, char enable)
+{
+	void __iomem *psc_base = psc_get_base(ctlr);
+	u32 next_state = enable ? 0x3 : 0x2; /* 0x3 enables, 0x2 disables */
+
+	if (!psc_base)
+		return;
+
+	psc_set_next_state(psc_base, ctlr, id, next_state);
+	psc_go(psc_base, domain);
+	psc_wait_state(psc_base, id, next_state);
+}
+EXPORT_SYMBOL(davinci_psc_config);
+
+/*
+ * Enable or disable several modules of one controller and power domain
+ * with a single GO.  The transitions run in parallel, so bringing up a
+ * batch costs one PTSTAT wait instead of one per module.
+ */
+void davinci_psc_config_batch(unsigned int domain, unsigned int ctlr,
+		const unsigned int *ids, int n, char enable)
+{
+	void __iomem *psc_base = psc_get_base(ctlr);
+	u32 next_state = enable ? 0x3 : 0x2;
+	int i;
+
+	if (!psc_base || n <= 0)
+		return;
+
+	for (i = 0; i < n; i++)
+		psc_set_next_state(psc_base, ctlr, ids[i], next_state);
+	psc_go(psc_base, domain);
+	for (i = 0; i < n; i++)
+		psc_wait_state(psc_base, ids[i], next_state);
+}
+
+/*
+ * Hold a module with its own reset, such as the DSP, in local reset or
+ * let it run.  Unlike state changes this needs no GO.
+ */
+void davinci_psc_local_reset(unsigned int ctlr, unsigned int id, bool assert)
+{
+	void __iomem *psc_base = psc_get_base(ctlr);
+	u32 mdctl;
+
+	if (!psc_base)
+		return;
+
+	mdctl = __raw_readl(psc_base + MDCTL + 4 * id);
+	if (assert)
+		mdctl &= ~MDCTL_LRST;
+	else
+		mdctl |= MDCTL_LRST;
+	__raw_writel(mdctl, psc_base + MDCTL + 4 * id);
+}
+EXPORT_SYMBOL(davinci_psc_local_reset);
@@ -0,0 +1,367 @@
+/*
+ * EDMA data path for the DA8xx 8250 UARTs
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * RX runs continuously into a coherent ring split in two halves, each
+ * its own PaRAM set, linked to each other; the FIFO trigger level is one
+ * byte, so nothing is ever left behind in the FIFO.  The ring is drained
+ * into the tty whenever a half fills, and from a timer for whatever has
+ * arrived since.  TX streams straight out of the tty circular buffer,
+ * one FIFO load per transmit event, which the UART raises each time its
+ * FIFO runs empty.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/timer.h>
+#include <linux/tty.h>
+#include <linux/tty_flip.h>
+#include <linux/serial_8250.h>
+#include <linux/serial_reg.h>
+#include <linux/dma-mapping.h>
+
+#include <mach/cputype.h>
+#include <mach/serial.h>
+#include <mach/edma.h>
+
+#define DAVINCI_UART_DMA_RX_SIZE	PAGE_SIZE	/* power of two */
+#define DAVINCI_UART_FIFO_SIZE		16
+
+/* EDMA CC0 events: {RX, TX} per UART */
+static const u8 da8xx_uart_dma_events[DAVINCI_MAX_NR_UARTS][2] = {
+	{  8,  9 },
+	{ 12, 13 },
+	{ 30, 31 },
+};
+
+static unsigned int rx_flush_ms = 10;
+module_param(rx_flush_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(rx_flush_ms,
+	"longest time received data waits in the DMA ring (ms)");
+
+struct davinci_uart_dma {
+	struct plat_serial8250_dma	dma;
+	struct uart_port		*port;
+	int				rx_event;
+	int				tx_event;
+
+	int				rx_chan;
+	int				rx_slot[2];
+	u8				*rx_buf;
+	dma_addr_t			rx_handle;
+	unsigned			rx_tail;
+	struct timer_list		rx_timer;
+
+	int				tx_chan;
+	dma_addr_t			tx_handle;	/* xmit buf */
+	unsigned			tx_len;		/* in flight */
+};
+
+#define to_davinci_uart_dma(d) \
+	container_of(d, struct davinci_uart_dma, dma)
+
+/* Push everything the EDMA has written since the last call to the tty */
+static void davinci_uart_dma_rx_flush(struct davinci_uart_dma *ud)
+{
+	struct uart_port *port = ud->port;
+	struct tty_struct *tty = port->state->port.tty;
+	unsigned long flags;
+	dma_addr_t dst;
+	unsigned head, n;
+
+	spin_lock_irqsave(&port->lock, flags);
+
+	edma_get_position(ud->rx_chan, NULL, &dst);
+	head = (dst - ud->rx_handle) & (DAVINCI_UART_DMA_RX_SIZE - 1);
+
+	while (ud->rx_tail != head) {
+		if (head > ud->rx_tail)
+			n = head - ud->rx_tail;
+		else
+			n = DAVINCI_UART_DMA_RX_SIZE - ud->rx_tail;
+
+		if (tty && !(port->ignore_status_mask & UART_LSR_DR))
+			tty_insert_flip_string(tty, ud->rx_buf + ud->rx_tail,
+					       n);
+		port->icount.rx += n;
+		ud->rx_tail = (ud->rx_tail + n) &
+				(DAVINCI_UART_DMA_RX_SIZE - 1);
+	}
+
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	if (tty)
+		tty_flip_buffer_push(tty);
+}
+
+static void davinci_uart_dma_rx_callback(unsigned channel, u16 ch_status,
+					 void *data)
+{
+	struct davinci_uart_dma *ud = data;
+
+	if (ch_status != DMA_COMPLETE) {
+		dev_warn(ud->port->dev, "RX DMA error %d\n", ch_status);
+		edma_clean_channel(channel);
+	}
+	davinci_uart_dma_rx_flush(ud);
+}
+
+static void davinci_uart_dma_rx_timer(unsigned long data)
+{
+	struct davinci_uart_dma *ud = (struct davinci_uart_dma *)data;
+
+	davinci_uart_dma_rx_flush(ud);
+	mod_timer(&ud->rx_timer,
+		  jiffies + max(msecs_to_jiffies(rx_flush_ms), 1UL));
+}
+
+/* Start the next contiguous run of the xmit buffer; port lock held */
+static void davinci_uart_dma_tx_kick(struct davinci_uart_dma *ud)
+{
+	struct uart_port *port = ud->port;
+	struct circ_buf *xmit = &port->state->xmit;
+	struct edmacc_param param;
+	unsigned acnt = 1, bcnt, ccnt, n;
+
+	if (ud->tx_len)
+		return;
+
+	/*
+	 * An empty FIFO raises no further transmit event, and the one it
+	 * raised when it ran dry may still be latched: drop that and prime
+	 * the FIFO by CPU.  The event raised once these bytes have gone out
+	 * then starts the EDMA on the rest.
+	 */
+	if (port->serial_in(port, UART_LSR) & UART_LSR_THRE) {
+		edma_clear_event(ud->tx_chan);
+		n = DAVINCI_UART_FIFO_SIZE;
+		if (port->x_char) {
+			port->serial_out(port, UART_TX, port->x_char);
+			port->icount.tx++;
+			port->x_char = 0;
+			n--;
+		}
+		while (n && !uart_circ_empty(xmit) && !uart_tx_stopped(port)) {
+			port->serial_out(port, UART_TX, xmit->buf[xmit->tail]);
+			xmit->tail = (xmit->tail + 1) & (UART_XMIT_SIZE - 1);
+			port->icount.tx++;
+			n--;
+		}
+		if (uart_circ_chars_pending(xmit) < WAKEUP_CHARS)
+			uart_write_wakeup(port);
+	}
+
+	if (uart_circ_empty(xmit) || uart_tx_stopped(port))
+		return;
+
+	/* one event per empty FIFO, whole FIFO loads while we can */
+	ud->tx_len = CIRC_CNT_TO_END(xmit->head, xmit->tail, UART_XMIT_SIZE);
+	if (ud->tx_len >= DAVINCI_UART_FIFO_SIZE) {
+		ud->tx_len -= ud->tx_len % DAVINCI_UART_FIFO_SIZE;
+		bcnt = DAVINCI_UART_FIFO_SIZE;
+	} else {
+		bcnt = ud->tx_len;
+	}
+	ccnt = ud->tx_len / bcnt;
+
+	dma_sync_single_for_device(port->dev, ud->tx_handle + xmit->tail,
+				   ud->tx_len, DMA_TO_DEVICE);
+
+	param.opt = SYNCDIM | TCINTEN |
+			EDMA_TCC(EDMA_CHAN_SLOT(ud->tx_chan));
+	param.src = ud->tx_handle + xmit->tail;
+	param.dst = port->mapbase + (UART_TX << port->regshift);
+	param.a_b_cnt = bcnt << 16 | acnt;
+	param.src_dst_bidx = acnt;
+	param.link_bcntrld = 0xffff;
+	param.src_dst_cidx = bcnt * acnt;
+	param.ccnt = ccnt;
+	edma_write_slot(ud->tx_chan, &param);
+	edma_start(ud->tx_chan);
+}
+
+static void davinci_uart_dma_tx_callback(unsigned channel, u16 ch_status,
+					 void *data)
+{
+	struct davinci_uart_dma *ud = data;
+	struct uart_port *port = ud->port;
+	struct circ_buf *xmit = &port->state->xmit;
+	unsigned long flags;
+
+	if (ch_status != DMA_COMPLETE) {
+		dev_warn(port->dev, "TX DMA error %d\n", ch_status);
+		edma_stop(channel);
+		edma_clean_channel(channel);
+	}
+
+	spin_lock_irqsave(&port->lock, flags);
+
+	xmit->tail = (xmit->tail + ud->tx_len) & (UART_XMIT_SIZE - 1);
+	port->icount.tx += ud->tx_len;
+	ud->tx_len = 0;
+
+	if (uart_circ_chars_pending(xmit) < WAKEUP_CHARS)
+		uart_write_wakeup(port);
+
+	davinci_uart_dma_tx_kick(ud);
+
+	spin_unlock_irqrestore(&port->lock, flags);
+}
+
+static void davinci_uart_dma_start_tx(struct plat_serial8250_dma *dma,
+				      struct uart_port *port)
+{
+	davinci_uart_dma_tx_kick(to_davinci_uart_dma(dma));
+}
+
+static void davinci_uart_dma_rx_setup(struct davinci_uart_dma *ud)
+{
+	struct uart_port *port = ud->port;
+	struct edmacc_param param;
+	unsigned half = DAVINCI_UART_DMA_RX_SIZE / 2;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		param.opt = TCINTEN | EDMA_TCC(EDMA_CHAN_SLOT(ud->rx_chan));
+		param.src = port->mapbase + (UART_RX << port->regshift);
+		param.a_b_cnt = half << 16 | 1;
+		param.dst = ud->rx_handle + i * half;
+		param.src_dst_bidx = 1 << 16;
+		param.link_bcntrld = 0xffff;
+		param.src_dst_cidx = 0;
+		param.ccnt = 1;
+		edma_write_slot(ud->rx_slot[i], &param);
+		if (i == 0)
+			edma_write_slot(ud->rx_chan, &param);
+	}
+	edma_link(ud->rx_chan, ud->rx_slot[1]);
+	edma_link(ud->rx_slot[1], ud->rx_slot[0]);
+	edma_link(ud->rx_slot[0], ud->rx_slot[1]);
+
+	ud->rx_tail = 0;
+}
+
+static int davinci_uart_dma_startup(struct plat_serial8250_dma *dma,
+				    struct uart_port *port)
+{
+	struct davinci_uart_dma *ud = to_davinci_uart_dma(dma);
+	int r;
+
+	ud->port = port;
+
+	ud->rx_buf = dma_alloc_coherent(port->dev, DAVINCI_UART_DMA_RX_SIZE,
+					&ud->rx_handle, GFP_KERNEL);
+	if (!ud->rx_buf)
+		return -ENOMEM;
+
+	r = edma_alloc_channel(ud->rx_event, davinci_uart_dma_rx_callback, ud,
+			       EVENTQ_DEFAULT);
+	if (r < 0)
+		goto err_free_buf;
+	ud->rx_chan = r;
+
+	r = edma_alloc_slot(EDMA_CTLR(ud->rx_chan), EDMA_SLOT_ANY);
+	if (r < 0)
+		goto err_free_rx;
+	ud->rx_slot[0] = r;
+
+	r = edma_alloc_slot(EDMA_CTLR(ud->rx_chan), EDMA_SLOT_ANY);
+	if (r < 0)
+		goto err_free_slot0;
+	ud->rx_slot[1] = r;
+
+	r = edma_alloc_channel(ud->tx_event, davinci_uart_dma_tx_callback, ud,
+			       EVENTQ_DEFAULT);
+	if (r < 0)
+		goto err_free_slot1;
+	ud->tx_chan = r;
+
+	ud->tx_handle = dma_map_single(port->dev, port->state->xmit.buf,
+				       UART_XMIT_SIZE, DMA_TO_DEVICE);
+	ud->tx_len = 0;
+
+	davinci_uart_dma_rx_setup(ud);
+	edma_clear_event(ud->rx_chan);
+	edma_start(ud->rx_chan);
+
+	setup_timer(&ud->rx_timer, davinci_uart_dma_rx_timer,
+		    (unsigned long)ud);
+	mod_timer(&ud->rx_timer,
+		  jiffies + max(msecs_to_jiffies(rx_flush_ms), 1UL));
+
+	return 0;
+
+err_free_slot1:
+	edma_free_slot(ud->rx_slot[1]);
+err_free_slot0:
+	edma_free_slot(ud->rx_slot[0]);
+err_free_rx:
+	edma_free_channel(ud->rx_chan);
+err_free_buf:
+	dma_free_coherent(port->dev, DAVINCI_UART_DMA_RX_SIZE,
+			  ud->rx_buf, ud->rx_handle);
+	dev_warn(port->dev, "no EDMA for ttyS%d, using PIO\n", port->line);
+	return r;
+}
+
+static void davinci_uart_dma_shutdown(struct plat_serial8250_dma *dma,
+				      struct uart_port *port)
+{
+	struct davinci_uart_dma *ud = to_davinci_uart_dma(dma);
+
+	del_timer_sync(&ud->rx_timer);
+
+	edma_stop(ud->rx_chan);
+	edma_stop(ud->tx_chan);
+	edma_clean_channel(ud->tx_chan);
+	ud->tx_len = 0;
+
+	dma_unmap_single(port->dev, ud->tx_handle, UART_XMIT_SIZE,
+			 DMA_TO_DEVICE);
+	edma_free_channel(ud->tx_chan);
+	edma_free_slot(ud->rx_slot[1]);
+	edma_free_slot(ud->rx_slot[0]);
+	edma_free_channel(ud->rx_chan);
+	dma_free_coherent(port->dev, DAVINCI_UART_DMA_RX_SIZE,
+			  ud->rx_buf, ud->rx_handle);
+}
+
+/**
+ * davinci_serial_dma_setup - let EDMA drive a UART's data path
+ * @p: the port's platform data
+ * @uart: UART number
+ *
+ * Called from davinci_serial_init() for the ports a board lists in
+ * davinci_uart_config.dma_uarts.  Channels are only claimed when the
+ * port is opened; if that fails the port runs PIO as before.
+ */
+int __init davinci_serial_dma_setup(struct plat_serial8250_port *p, int uart)
+{
+	struct davinci_uart_dma *ud;
+
+	if (!cpu_is_davinci_da8xx() || uart >= DAVINCI_MAX_NR_UARTS)
+		return -ENODEV;
+
+	ud = kzalloc(sizeof(*ud), GFP_KERNEL);
+	if (!ud)
+		return -ENOMEM;
+
+	ud->rx_event = EDMA_CTLR_CHAN(0, da8xx_uart_dma_events[uart][0]);
+	ud->tx_event = EDMA_CTLR_CHAN(0, da8xx_uart_dma_events[uart][1]);
+
+	ud->dma.fcr = UART_FCR_ENABLE_FIFO | UART_FCR_DMA_SELECT |
+			UART_FCR_TRIGGER_1;
+	ud->dma.startup = davinci_uart_dma_startup;
+	ud->dma.shutdown = davinci_uart_dma_shutdown;
+	ud->dma.start_tx = davinci_uart_dma_start_tx;
+
+	p->dma = &ud->dma;
+	return 0;
+}
@@ -92,6 +92,11 @@ int __init davinci_serial_init(struct davinci_uart_config *info)
 			p->clk = uart_clk;
 			davinci_serial_reset(p);
 		}
+
+		if ((info->dma_uarts & (1 << i)) &&
+				davinci_serial_dma_setup(p, i))
+			printk(KERN_WARNING "%s: no EDMA for UART%d\n",
+					__func__, i);
 	}
 
 	return platform_device_register(soc_info->serial_dev);
@@ -11,61 +11,267 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/genalloc.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+#include <asm/cacheflush.h>
 
 #include <mach/common.h>
 #include <mach/sram.h>
 
-static struct gen_pool *sram_pool;
+/*
+ * The SRAM is split into the SoC's named carve-outs, in order from its
+ * start, and a general pool holding whatever is left.  Each pool tracks
+ * its usage; individual allocations are remembered (up to a point) along
+ * with who made them, for debugfs.
+ */
+struct sram_pool {
+	const char		*name;
+	struct gen_pool		*pool;
+	unsigned long		base;
+	unsigned		len;
+	unsigned		used;
+	unsigned		peak;
+};
 
-void *sram_alloc(size_t len, dma_addr_t *dma)
+#define SRAM_MAX_POOLS		4
+#define SRAM_MAX_RECORDS	32
+
+struct sram_record {
+	unsigned long		addr;
+	size_t			len;
+	void			*caller;
+};
+
+static struct sram_pool sram_pools[SRAM_MAX_POOLS];
+static unsigned sram_num_pools;
+static struct sram_record sram_records[SRAM_MAX_RECORDS];
+static DEFINE_SPINLOCK(sram_lock);
+
+static struct sram_pool *sram_find_pool(const char *name)
+{
+	unsigned i;
+
+	for (i = 1; i < sram_num_pools; i++)
+		if (!strcmp(sram_pools[i].name, name))
+			return &sram_pools[i];
+	return &sram_pools[0];
+}
+
+static struct sram_pool *sram_addr_pool(unsigned long addr)
+{
+	unsigned i;
+
+	for (i = 0; i < sram_num_pools; i++)
+		if (addr >= sram_pools[i].base &&
+				addr < sram_pools[i].base + sram_pools[i].len)
+			return &sram_pools[i];
+	return NULL;
+}
+
+static void sram_account(struct sram_pool *p, unsigned long addr,
+			 size_t len, void *caller)
+{
+	unsigned long flags;
+	unsigned i;
+
+	len = ALIGN(len, SRAM_GRANULARITY);
+
+	spin_lock_irqsave(&sram_lock, flags);
+	if (caller) {
+		p->used += len;
+		p->peak = max(p->peak, p->used);
+		for (i = 0; i < SRAM_MAX_RECORDS; i++) {
+			if (!sram_records[i].addr) {
+				sram_records[i].addr = addr;
+				sram_records[i].len = len;
+				sram_records[i].caller = caller;
+				break;
+			}
+		}
+	} else {
+		p->used -= len;
+		for (i = 0; i < SRAM_MAX_RECORDS; i++) {
+			if (sram_records[i].addr == addr) {
+				sram_records[i].addr = 0;
+				break;
+			}
+		}
+	}
+	spin_unlock_irqrestore(&sram_lock, flags);
+}
+
+static void *__sram_alloc(struct sram_pool *p, size_t len, dma_addr_t *dma,
+			  void *caller)
 {
 	unsigned long vaddr;
 	dma_addr_t dma_base = davinci_soc_info.sram_dma;
 
 	if (dma)
 		*dma = 0;
-	if (!sram_pool || (dma && !dma_base))
+	if (!p->pool || (dma && !dma_base))
 		return NULL;
 
-	vaddr = gen_pool_alloc(sram_pool, len);
+	vaddr = gen_pool_alloc(p->pool, len);
 	if (!vaddr)
 		return NULL;
 
+	sram_account(p, vaddr, len, caller);
+
 	if (dma)
 		*dma = dma_base + (vaddr - SRAM_VIRT);
 	return (void *)vaddr;
+}
 
+void *sram_alloc(size_t len, dma_addr_t *dma)
+{
+	return __sram_alloc(&sram_pools[0], len, dma,
+			    __builtin_return_address(0));
 }
 EXPORT_SYMBOL(sram_alloc);
 
+/**
+ * sram_alloc_pool - allocate from one of the SoC's named SRAM carve-outs
+ * @pool: carve-out name, e.g. SRAM_POOL_AUDIO
+ * @len: size in bytes
+ * @dma: if not NULL, returns the DMA address as for sram_alloc()
+ *
+ * Falls back to the general pool when the SoC has no such carve-out.
+ * Release with sram_free().
+ */
+void *sram_alloc_pool(const char *pool, size_t len, dma_addr_t *dma)
+{
+	return __sram_alloc(sram_find_pool(pool), len, dma,
+			    __builtin_return_address(0));
+}
+EXPORT_SYMBOL(sram_alloc_pool);
+
 void sram_free(void *addr, size_t len)
 {
-	gen_pool_free(sram_pool, (unsigned long) addr, len);
+	struct sram_pool *p = sram_addr_pool((unsigned long)addr);
+
+	if (WARN_ON(!p))
+		return;
+
+	gen_pool_free(p->pool, (unsigned long) addr, len);
+	sram_account(p, (unsigned long)addr, len, NULL);
 }
 EXPORT_SYMBOL(sram_free);
 
+#ifdef CONFIG_DAVINCI_SRAM_TEXT
+/* .sram.text is linked at DAVINCI_SRAM_TEXT_VIRT and loaded after .data */
+extern char __sram_text_start, __ssram_text, __esram_text;
+
+static void __init sram_text_init(void)
+{
+	size_t len = &__esram_text - &__ssram_text;
+
+	memcpy(&__ssram_text, &__sram_text_start, len);
+	flush_icache_range((unsigned long)&__ssram_text,
+			   (unsigned long)&__esram_text);
+}
+#else
+static inline void sram_text_init(void) { }
+#endif
+
+static int __init sram_pool_init(struct sram_pool *p, const char *name,
+				 unsigned long base, unsigned len)
+{
+	p->name = name;
+	p->base = base;
+	p->len = len;
+	if (!len)
+		return 0;
+
+	p->pool = gen_pool_create(ilog2(SRAM_GRANULARITY), -1);
+	if (!p->pool)
+		return -ENOMEM;
+	return gen_pool_add(p->pool, base, len, -1);
+}
 
-/*
- * REVISIT This supports CPU and DMA access to/from SRAM, but it
- * doesn't (yet?) support some other notable uses of SRAM:  as TCM
- * for data and/or instructions; and holding code needed to enter
- * and exit suspend states (while DRAM can't be used).
- */
 static int __init sram_init(void)
 {
+	const struct davinci_sram_carveout *c = davinci_soc_info.sram_carveouts;
 	unsigned len = davinci_soc_info.sram_len;
-	int status = 0;
+	unsigned long base = SRAM_VIRT;
+	int status;
+	unsigned i;
+
+	sram_text_init();
+
+	len = min_t(unsigned, len, SRAM_SIZE);
 
-	if (len) {
-		len = min_t(unsigned, len, SRAM_SIZE);
-		sram_pool = gen_pool_create(ilog2(SRAM_GRANULARITY), -1);
-		if (!sram_pool)
-			status = -ENOMEM;
+	/* carve-outs come first; slot 0 is the general pool, with the rest */
+	for (i = 1; c && c->name && i < SRAM_MAX_POOLS; c++, i++) {
+		unsigned n = min_t(unsigned, ALIGN(c->len, SRAM_GRANULARITY),
+				   len);
+
+		status = sram_pool_init(&sram_pools[i], c->name, base, n);
+		if (WARN_ON(status < 0))
+			return status;
+		base += n;
+		len -= n;
 	}
-	if (sram_pool)
-		status = gen_pool_add(sram_pool, SRAM_VIRT, len, -1);
+	sram_num_pools = i;
+
+	status = sram_pool_init(&sram_pools[0], "general", base, len);
 	WARN_ON(status < 0);
 	return status;
 }
 core_initcall(sram_init);
 
+#ifdef CONFIG_DEBUG_FS
+
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+static int davinci_sram_show(struct seq_file *m, void *v)
+{
+	unsigned long flags;
+	unsigned i;
+
+	spin_lock_irqsave(&sram_lock, flags);
+	for (i = 0; i < sram_num_pools; i++) {
+		struct sram_pool *p = &sram_pools[i];
+
+		seq_printf(m, "%-8s %08lx %6u bytes, used %6u peak %6u\n",
+			   p->name, p->base, p->len, p->used, p->peak);
+	}
+	for (i = 0; i < SRAM_MAX_RECORDS; i++) {
+		struct sram_record *r = &sram_records[i];
+
+		if (!r->addr)
+			continue;
+		seq_printf(m, "  %08lx %6zu %-8s %pS\n", r->addr, r->len,
+			   sram_addr_pool(r->addr)->name, r->caller);
+	}
+	spin_unlock_irqrestore(&sram_lock, flags);
+
+#ifdef CONFIG_DAVINCI_SRAM_TEXT
+	seq_printf(m, ".sram.text %08lx %6td bytes of %u\n",
+		   (unsigned long)&__ssram_text, &__esram_text - &__ssram_text,
+		   DAVINCI_SRAM_TEXT_SIZE);
+#endif
+	return 0;
+}
+
+static int davinci_sram_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, davinci_sram_show, NULL);
+}
+
+static const struct file_operations davinci_sram_operations = {
+	.open		= davinci_sram_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init davinci_sram_debugfs_init(void)
+{
+	debugfs_create_file("davinci_sram", S_IFREG | S_IRUGO, NULL, NULL,
+			    &davinci_sram_operations);
+	return 0;
+}
+device_initcall(davinci_sram_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
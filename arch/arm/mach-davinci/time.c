@@ -18,6 +18,8 @@
 #include <linux/clk.h>
 #include <linux/err.h>
 #include <linux/platform_device.h>
+#include <linux/jiffies.h>
+#include <linux/sched.h>
 
 #include <mach/hardware.h>
 #include <asm/mach/irq.h>
@@ -29,6 +31,13 @@
 static struct clock_event_device clockevent_davinci;
 static unsigned int davinci_clock_tick_rate;
 
+/*
+ * Smallest oneshot delta handed to the clockevent, in timer ticks.  Writing
+ * the new period takes a handful of bus cycles; anything shorter than this
+ * simply fires as soon as the timer is re-enabled.
+ */
+#define DAVINCI_TIMER_MIN_DELTA		48
+
 /*
  * This driver configures the 2 64-bit count-up timers as 4 independent
  * 32-bit count-up timers used as follows:
@@ -268,6 +277,119 @@ static cycle_t read_cycles(struct clocksource *cs)
 	return (cycles_t)timer32_read(t);
 }
 
+/*
+ * 64-bit free-running clocksource, on SoCs that have a timer to spare for it
+ * (see davinci_timer_info.clocksource64).  It never wraps, so it backs
+ * sched_clock() as well.
+ */
+static void __iomem *timer64_base;
+static u32 timer64_sched_mult;
+
+#define TIMER64_SCHED_SHIFT		24
+
+static inline u64 timer64_read(void __iomem *base)
+{
+	u32 hi, lo;
+
+	/* TIM34 may carry between the two reads, so retry until it's stable */
+	do {
+		hi = __raw_readl(base + TIM34);
+		lo = __raw_readl(base + TIM12);
+	} while (hi != __raw_readl(base + TIM34));
+
+	return ((u64)hi << 32) | lo;
+}
+
+static cycle_t read_cycles64(struct clocksource *cs)
+{
+	return (cycle_t)timer64_read(timer64_base);
+}
+
+struct clocksource clocksource_davinci64 = {
+	.rating		= 350,
+	.read		= read_cycles64,
+	.mask		= CLOCKSOURCE_MASK(64),
+	.shift		= 24,
+	.flags		= CLOCK_SOURCE_IS_CONTINUOUS,
+};
+
+static void __init timer64_init(void __iomem *base)
+{
+	u32 tgcr;
+
+	/* Disabled, Internal clock source */
+	__raw_writel(0, base + TCR);
+
+	/* reset both halves, then run them as one 64-bit GP timer */
+	__raw_writel(0, base + TGCR);
+	tgcr = TGCR_TIMMODE_64BIT_GP << TGCR_TIMMODE_SHIFT;
+	__raw_writel(tgcr, base + TGCR);
+	tgcr |= (TGCR_UNRESET << TGCR_TIM12RS_SHIFT) |
+		(TGCR_UNRESET << TGCR_TIM34RS_SHIFT);
+	__raw_writel(tgcr, base + TGCR);
+
+	__raw_writel(0, base + TIM12);
+	__raw_writel(0, base + TIM34);
+	__raw_writel(~0, base + PRD12);
+	__raw_writel(~0, base + PRD34);
+
+	/* the enable mode of TIM12 governs the whole counter in 64-bit mode */
+	__raw_writel(TCR_ENAMODE_PERIODIC << 6, base + TCR);
+}
+
+static void __init davinci_clocksource64_init(void)
+{
+	struct davinci_timer_info *dti = davinci_soc_info.timer_info;
+	static char err[] __initdata = KERN_ERR
+		"%s: can't register clocksource!\n";
+	struct clk *clk;
+	unsigned long rate;
+
+	if (!dti->clocksource64)
+		return;
+
+	clk = clk_get(NULL, dti->clocksource64_clk);
+	if (IS_ERR(clk)) {
+		pr_warning("davinci_timer_init: no clock for the 64-bit "
+				"clocksource\n");
+		return;
+	}
+	clk_enable(clk);
+	rate = clk_get_rate(clk);
+
+	timer64_init(dti->clocksource64->base);
+
+	clocksource_davinci64.name = dti->clocksource64_clk;
+	clocksource_davinci64.mult =
+		clocksource_hz2mult(rate, clocksource_davinci64.shift);
+	timer64_sched_mult = clocksource_hz2mult(rate, TIMER64_SCHED_SHIFT);
+
+	timer64_base = dti->clocksource64->base;
+	if (clocksource_register(&clocksource_davinci64)) {
+		printk(err, clocksource_davinci64.name);
+		timer64_base = NULL;
+	}
+}
+
+/*
+ * Scheduler clock, in ns.  The multiply is split in two halves so it can't
+ * overflow however long the counter has been running.
+ */
+unsigned long long notrace sched_clock(void)
+{
+	u64 cyc;
+
+	if (!timer64_base)
+		return (unsigned long long)(jiffies - INITIAL_JIFFIES)
+					* (NSEC_PER_SEC / HZ);
+
+	cyc = timer64_read(timer64_base);
+	return (((cyc >> 32) * timer64_sched_mult)
+			<< (32 - TIMER64_SCHED_SHIFT)) +
+		(((cyc & 0xffffffff) * timer64_sched_mult)
+			>> TIMER64_SCHED_SHIFT);
+}
+
 static struct clocksource clocksource_davinci = {
 	.rating		= 300,
 	.read		= read_cycles,
@@ -379,13 +501,16 @@ static void __init davinci_timer_init(void)
 	if (clocksource_register(&clocksource_davinci))
 		printk(err, clocksource_davinci.name);
 
+	davinci_clocksource64_init();
+
 	/* setup clockevent */
 	clockevent_davinci.name = id_to_name[timers[TID_CLOCKEVENT].id];
 	clockevent_davinci.mult = div_sc(davinci_clock_tick_rate, NSEC_PER_SEC,
 					 clockevent_davinci.shift);
 	clockevent_davinci.max_delta_ns =
 		clockevent_delta2ns(0xfffffffe, &clockevent_davinci);
-	clockevent_davinci.min_delta_ns = 50000; /* 50 usec */
+	clockevent_davinci.min_delta_ns =
+		clockevent_delta2ns(DAVINCI_TIMER_MIN_DELTA, &clockevent_davinci);
 
 	clockevent_davinci.cpumask = cpumask_of(0);
 	clockevents_register_device(&clockevent_davinci);
@@ -0,0 +1,149 @@
+/*
+ * DaVinci user space time page
+ *
+ * Publishes the timekeeping state and the 64-bit clocksource counter to
+ * user space, so gettimeofday() and clock_gettime() can be done without
+ * a syscall.  See <linux/davinci_time.h> for the layout and the reader.
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/miscdevice.h>
+#include <linux/clocksource.h>
+#include <linux/dma-mapping.h>
+#include <linux/time.h>
+#include <linux/davinci_time.h>
+
+#include <mach/hardware.h>
+#include <mach/common.h>
+#include <mach/time.h>
+
+/* 64-bit counter halves in the timer's register page */
+#define TIM12			0x10
+#define TIM34			0x14
+
+static struct davinci_time_data *usertime_data;
+static dma_addr_t usertime_dma;
+static unsigned long usertime_timer_pfn;
+
+/* called with xtime_lock held for write */
+void update_vsyscall(struct timespec *ts, struct clocksource *c, u32 mult)
+{
+	struct davinci_time_data *d = usertime_data;
+
+	if (!d)
+		return;
+
+	d->seq++;
+	smp_wmb();
+
+	d->valid = (c == &clocksource_davinci64);
+	d->cycle_last = c->cycle_last;
+	d->mult = mult;
+	d->shift = c->shift;
+	d->wall_sec = ts->tv_sec;
+	d->wall_nsec = ts->tv_nsec;
+	d->mono_sec = wall_to_monotonic.tv_sec;
+	d->mono_nsec = wall_to_monotonic.tv_nsec;
+
+	smp_wmb();
+	d->seq++;
+}
+
+void update_vsyscall_tz(void)
+{
+	struct davinci_time_data *d = usertime_data;
+	unsigned long flags;
+
+	if (!d)
+		return;
+
+	write_seqlock_irqsave(&xtime_lock, flags);
+	d->seq++;
+	smp_wmb();
+	d->tz_minuteswest = sys_tz.tz_minuteswest;
+	d->tz_dsttime = sys_tz.tz_dsttime;
+	smp_wmb();
+	d->seq++;
+	write_sequnlock_irqrestore(&xtime_lock, flags);
+}
+
+static int usertime_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	if (vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	switch (vma->vm_pgoff) {
+	case 0:
+		return dma_mmap_coherent(NULL, vma, usertime_data,
+				usertime_dma, PAGE_SIZE);
+	case 1:
+		vma->vm_flags |= VM_IO | VM_RESERVED;
+		vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+		return io_remap_pfn_range(vma, vma->vm_start,
+				usertime_timer_pfn, PAGE_SIZE,
+				vma->vm_page_prot);
+	default:
+		return -EINVAL;
+	}
+}
+
+static const struct file_operations usertime_fops = {
+	.owner		= THIS_MODULE,
+	.mmap		= usertime_mmap,
+};
+
+static struct miscdevice usertime_misc = {
+	.minor		= MISC_DYNAMIC_MINOR,
+	.name		= "davinci_time",
+	.fops		= &usertime_fops,
+};
+
+static int __init davinci_usertime_init(void)
+{
+	struct davinci_timer_info *dti = davinci_soc_info.timer_info;
+	struct davinci_time_data *d;
+	unsigned long base;
+	int ret;
+
+	if (!dti || !dti->clocksource64)
+		return -ENODEV;
+
+	base = io_v2p((unsigned long)dti->clocksource64->base);
+	if (base & ~PAGE_MASK)
+		return -ENODEV;
+	usertime_timer_pfn = __phys_to_pfn(base);
+
+	/* uncached, so the user mapping can't see stale lines of the page */
+	d = dma_alloc_coherent(NULL, PAGE_SIZE, &usertime_dma, GFP_KERNEL);
+	if (!d)
+		return -ENOMEM;
+	memset(d, 0, PAGE_SIZE);
+	d->tim12 = TIM12;
+	d->tim34 = TIM34;
+	d->tz_minuteswest = sys_tz.tz_minuteswest;
+	d->tz_dsttime = sys_tz.tz_dsttime;
+
+	ret = misc_register(&usertime_misc);
+	if (ret) {
+		dma_free_coherent(NULL, PAGE_SIZE, d, usertime_dma);
+		return ret;
+	}
+
+	/* the next tick fills in the rest */
+	smp_wmb();
+	usertime_data = d;
+	return 0;
+}
+device_initcall(davinci_usertime_init);
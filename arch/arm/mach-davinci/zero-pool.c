@@ -0,0 +1,220 @@
+/*
+ * mach-davinci/zero-pool.c - pages zeroed by EDMA while the CPU is idle
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Anonymous page faults and get_zeroed_page() normally clear each page
+ * with the ARM926 on the spot, which adds up when an application maps
+ * and touches megabytes at start up.  This keeps a pool of pages that
+ * the EDMA copy engine has already filled from a zero line with a zero
+ * source index, and hands those out first.  The pool is refilled by a
+ * SCHED_IDLE thread, so only otherwise idle time goes into it, and
+ * only while free memory is well above the zone watermarks; under
+ * memory pressure the pool is given back through a shrinker.
+ */
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/vmstat.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/sched.h>
+#include <linux/dma-mapping.h>
+#include <linux/zero_pool.h>
+
+#include <mach/edma.h>
+
+/* the source line, repeated PAGE_SIZE / ZERO_POOL_LINE times per page */
+#define ZERO_POOL_LINE		512
+#define ZERO_POOL_RETRY_MS	100
+
+/* lowmem only, so page_address() works for get_zeroed_page() */
+#define ZERO_POOL_GFP		((GFP_USER | __GFP_MOVABLE | __GFP_NOWARN | \
+				  __GFP_NOMEMALLOC) & ~__GFP_WAIT)
+
+static unsigned int zero_pool_pages = 256;
+module_param_named(pages, zero_pool_pages, uint, 0644);
+MODULE_PARM_DESC(pages, "pre-zeroed pages to keep, 0 = off (default: 256)");
+
+static unsigned int zero_pool_count;
+module_param_named(count, zero_pool_count, uint, 0444);
+MODULE_PARM_DESC(count, "pre-zeroed pages in the pool now");
+
+static unsigned long zero_pool_hits;
+module_param_named(hits, zero_pool_hits, ulong, 0444);
+MODULE_PARM_DESC(hits, "zeroed page allocations served from the pool");
+
+static unsigned long zero_pool_misses;
+module_param_named(misses, zero_pool_misses, ulong, 0444);
+MODULE_PARM_DESC(misses, "zeroed page allocations that found it empty");
+
+static LIST_HEAD(zero_pool_list);
+static DEFINE_SPINLOCK(zero_pool_lock);
+static struct task_struct *zero_pool_task;
+
+static void *zero_pool_line;
+static dma_addr_t zero_pool_line_dma;
+
+static struct page *zero_pool_take(void)
+{
+	struct page *page = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&zero_pool_lock, flags);
+	if (!list_empty(&zero_pool_list)) {
+		page = list_first_entry(&zero_pool_list, struct page, lru);
+		list_del(&page->lru);
+		zero_pool_count--;
+	}
+	spin_unlock_irqrestore(&zero_pool_lock, flags);
+	return page;
+}
+
+/**
+ * zero_pool_get_page - take a page zeroed ahead of time
+ * @gfp_mask: allocation flags of the caller
+ *
+ * Returns a zeroed lowmem page with a reference held, just like
+ * alloc_page(@gfp_mask | __GFP_ZERO) would, or NULL when the pool is
+ * empty or can't satisfy @gfp_mask.  Callable from any context.
+ */
+struct page *zero_pool_get_page(gfp_t gfp_mask)
+{
+	struct page *page;
+
+	if (!zero_pool_task || (gfp_mask & __GFP_DMA))
+		return NULL;
+
+	page = zero_pool_take();
+	if (!page) {
+		zero_pool_misses++;
+		return NULL;
+	}
+
+	zero_pool_hits++;
+	if (zero_pool_count < zero_pool_pages / 2)
+		wake_up_process(zero_pool_task);
+	return page;
+}
+
+/* leave the pool alone unless memory is well above the watermarks */
+static bool zero_pool_may_grow(void)
+{
+	unsigned long high = 0;
+	struct zone *zone;
+
+	for_each_populated_zone(zone)
+		high += high_wmark_pages(zone);
+
+	return global_page_state(NR_FREE_PAGES) >
+		2 * high + zero_pool_pages;
+}
+
+static int zero_pool_fill_one(void)
+{
+	struct page *page;
+	unsigned long flags;
+	dma_addr_t dma;
+	int ret;
+
+	page = alloc_page(ZERO_POOL_GFP);
+	if (!page)
+		return -ENOMEM;
+
+	/* drops whatever the CPU still caches of the page's old contents */
+	dma = dma_map_page(NULL, page, 0, PAGE_SIZE, DMA_FROM_DEVICE);
+	ret = edma_copy_2d(dma, ZERO_POOL_LINE, zero_pool_line_dma, 0,
+			ZERO_POOL_LINE, PAGE_SIZE / ZERO_POOL_LINE);
+	dma_unmap_page(NULL, dma, PAGE_SIZE, DMA_FROM_DEVICE);
+	if (ret < 0) {
+		/* the copy engine is busy; not worth a CPU clear here */
+		__free_page(page);
+		return ret;
+	}
+
+	spin_lock_irqsave(&zero_pool_lock, flags);
+	list_add(&page->lru, &zero_pool_list);
+	zero_pool_count++;
+	spin_unlock_irqrestore(&zero_pool_lock, flags);
+	return 0;
+}
+
+static int zero_pool_thread(void *unused)
+{
+	struct sched_param param = { .sched_priority = 0 };
+	struct page *page;
+
+	sched_setscheduler(current, SCHED_IDLE, &param);
+
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+
+		if (zero_pool_count > zero_pool_pages) {
+			__set_current_state(TASK_RUNNING);
+			page = zero_pool_take();
+			if (page)
+				__free_page(page);
+			continue;
+		}
+
+		if (zero_pool_count == zero_pool_pages ||
+				!zero_pool_may_grow()) {
+			schedule();
+			continue;
+		}
+
+		__set_current_state(TASK_RUNNING);
+		if (zero_pool_fill_one() < 0)
+			msleep_interruptible(ZERO_POOL_RETRY_MS);
+	}
+	return 0;
+}
+
+static int zero_pool_shrink(int nr_to_scan, gfp_t gfp_mask)
+{
+	struct page *page;
+
+	while (nr_to_scan-- > 0) {
+		page = zero_pool_take();
+		if (!page)
+			break;
+		__free_page(page);
+	}
+	return zero_pool_count;
+}
+
+static struct shrinker zero_pool_shrinker = {
+	.shrink	= zero_pool_shrink,
+	.seeks	= DEFAULT_SEEKS,
+};
+
+/* after edma_copy_init(), which is a late_initcall linked before us */
+static int __init zero_pool_init(void)
+{
+	struct task_struct *task;
+
+	zero_pool_line = dma_alloc_coherent(NULL, ZERO_POOL_LINE,
+			&zero_pool_line_dma, GFP_KERNEL);
+	if (!zero_pool_line)
+		return -ENOMEM;
+	memset(zero_pool_line, 0, ZERO_POOL_LINE);
+
+	task = kthread_run(zero_pool_thread, NULL, "kzeropoold");
+	if (IS_ERR(task)) {
+		dma_free_coherent(NULL, ZERO_POOL_LINE, zero_pool_line,
+				zero_pool_line_dma);
+		return PTR_ERR(task);
+	}
+	zero_pool_task = task;
+	register_shrinker(&zero_pool_shrinker);
+
+	pr_info("zero-pool: up to %u pages zeroed by EDMA\n",
+			zero_pool_pages);
+	return 0;
+}
+late_initcall(zero_pool_init);
@@ -19,6 +19,10 @@
 #include <linux/init.h>
 #include <linux/sched.h>
 #include <linux/uaccess.h>
+#include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/mm.h>
+#include <linux/seq_file.h>
 
 #include <asm/unaligned.h>
 
@@ -135,6 +139,167 @@ static int proc_alignment_write(struct file *file, const char __user *buffer,
 
 #endif /* CONFIG_PROC_FS */
 
+#ifdef CONFIG_ALIGNMENT_TRAP_SITES
+#define ALIGNMENT_SITES_BITS	8
+#define ALIGNMENT_SITES		(1 << ALIGNMENT_SITES_BITS)
+
+/* faults of one instruction, in one process for user space ones */
+struct alignment_site {
+	unsigned long	pc;
+	pid_t		pid;		/* 0 for the kernel */
+	unsigned long	count;
+	char		comm[TASK_COMM_LEN];
+};
+
+static struct alignment_site alignment_sites[ALIGNMENT_SITES];
+static unsigned long alignment_sites_dropped;
+static DEFINE_SPINLOCK(alignment_sites_lock);
+
+static void alignment_site_account(unsigned long pc, struct pt_regs *regs)
+{
+	struct alignment_site *s;
+	unsigned long flags;
+	pid_t pid = 0;
+	int i, n;
+
+	if (user_mode(regs))
+		pid = task_tgid_nr(current);
+
+	spin_lock_irqsave(&alignment_sites_lock, flags);
+	i = hash_long(pc ^ pid, ALIGNMENT_SITES_BITS);
+	for (n = 0; n < ALIGNMENT_SITES; n++) {
+		s = &alignment_sites[i];
+		if (!s->count) {
+			s->pc = pc;
+			s->pid = pid;
+			/* no task_lock(), this may have interrupted it */
+			if (pid)
+				memcpy(s->comm, current->comm, TASK_COMM_LEN);
+		}
+		if (s->pc == pc && s->pid == pid) {
+			s->count++;
+			break;
+		}
+		i = (i + 1) & (ALIGNMENT_SITES - 1);
+	}
+	if (n == ALIGNMENT_SITES)
+		alignment_sites_dropped++;
+	spin_unlock_irqrestore(&alignment_sites_lock, flags);
+}
+
+/* file and offset of a user site, while its process is still around */
+static int alignment_site_show_user(struct seq_file *m,
+				    struct alignment_site *s)
+{
+	struct task_struct *task;
+	struct vm_area_struct *vma;
+	struct mm_struct *mm = NULL;
+	int shown = 0;
+
+	rcu_read_lock();
+	task = find_task_by_pid_ns(s->pid, &init_pid_ns);
+	if (task && !strncmp(task->comm, s->comm, TASK_COMM_LEN))
+		get_task_struct(task);
+	else
+		task = NULL;
+	rcu_read_unlock();
+	if (!task)
+		return 0;
+
+	mm = get_task_mm(task);
+	put_task_struct(task);
+	if (!mm)
+		return 0;
+
+	down_read(&mm->mmap_sem);
+	vma = find_vma(mm, s->pc);
+	if (vma && vma->vm_start <= s->pc && vma->vm_file) {
+		seq_path(m, &vma->vm_file->f_path, " \t\n\\");
+		seq_printf(m, "+0x%lx\n", s->pc - vma->vm_start +
+			   (vma->vm_pgoff << PAGE_SHIFT));
+		shown = 1;
+	}
+	up_read(&mm->mmap_sem);
+	mmput(mm);
+	return shown;
+}
+
+static int alignment_sites_show(struct seq_file *m, void *v)
+{
+	struct alignment_site s;
+	unsigned long flags;
+	int i;
+
+	seq_printf(m, "%10s %6s %-16s %-10s %s\n",
+		   "faults", "pid", "comm", "pc", "where");
+
+	for (i = 0; i < ALIGNMENT_SITES; i++) {
+		/* a copy, resolving a user site may sleep */
+		spin_lock_irqsave(&alignment_sites_lock, flags);
+		s = alignment_sites[i];
+		spin_unlock_irqrestore(&alignment_sites_lock, flags);
+		if (!s.count)
+			continue;
+
+		seq_printf(m, "%10lu %6d %-16s 0x%08lx ",
+			   s.count, s.pid, s.pid ? s.comm : "-", s.pc);
+		if (!s.pid)
+			seq_printf(m, "%pS\n", (void *)s.pc);
+		else if (!alignment_site_show_user(m, &s))
+			seq_printf(m, "?\n");
+	}
+	if (alignment_sites_dropped)
+		seq_printf(m, "%10lu faults not accounted, table full\n",
+			   alignment_sites_dropped);
+	return 0;
+}
+
+static int alignment_sites_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, alignment_sites_show, NULL);
+}
+
+static ssize_t alignment_sites_write(struct file *file,
+				     const char __user *buf, size_t count,
+				     loff_t *ppos)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&alignment_sites_lock, flags);
+	memset(alignment_sites, 0, sizeof(alignment_sites));
+	alignment_sites_dropped = 0;
+	spin_unlock_irqrestore(&alignment_sites_lock, flags);
+	return count;
+}
+
+static const struct file_operations alignment_sites_fops = {
+	.open		= alignment_sites_open,
+	.read		= seq_read,
+	.write		= alignment_sites_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init alignment_sites_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("alignment", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("sites", S_IRUGO | S_IWUSR, dir, NULL,
+			    &alignment_sites_fops);
+	return 0;
+}
+late_initcall(alignment_sites_init);
+#else
+static inline void alignment_site_account(unsigned long pc,
+					  struct pt_regs *regs)
+{
+}
+#endif /* CONFIG_ALIGNMENT_TRAP_SITES */
+
 union offset_union {
 	unsigned long un;
 	  signed long sn;
@@ -751,6 +916,8 @@ do_alignment(unsigned long addr, unsigned int fsr, struct pt_regs *regs)
 		goto bad_or_fault;
 	}
 
+	alignment_site_account(instrptr, regs);
+
 	if (user_mode(regs))
 		goto user;
 
@@ -0,0 +1,82 @@
+/*
+ * ARM926 cache lockdown
+ *
+ * Pins the .cachelock.text and .cachelock.data ranges into way 0 of the
+ * I and D caches.  See asm/cachelock.h.
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/irqflags.h>
+
+#include <asm/cputype.h>
+#include <asm/system.h>
+
+extern char __cachelock_text_start[], __cachelock_text_end[];
+extern char __cachelock_data_start[], __cachelock_data_end[];
+
+extern void arm926_cache_lock_way0(unsigned long istart, unsigned long iend,
+				   unsigned long dstart, unsigned long dend);
+
+/* sets per way once way 0 is locked, 0 before; read by proc-arm926.S */
+u32 arm926_cache_lock_sets;
+
+/* decode one half of the ARMv5 cache type register */
+static void __init arm926_cache_geometry(unsigned int ctype,
+					 unsigned int *size, unsigned int *ways)
+{
+	unsigned int m = (ctype >> 2) & 1;
+	unsigned int assoc = (ctype >> 3) & 7;
+
+	*size = (2 + m) << (((ctype >> 6) & 0xf) + 8);
+	*ways = assoc ? (2 + m) << (assoc - 1) : 1;
+}
+
+static int __init arm926_cache_lockdown(void)
+{
+	unsigned long ilen = __cachelock_text_end - __cachelock_text_start;
+	unsigned long dlen = __cachelock_data_end - __cachelock_data_start;
+	unsigned int ctype = read_cpuid_cachetype();
+	unsigned int isize, iways, dsize, dways, way;
+	unsigned long flags;
+
+	if (!ilen && !dlen)
+		return 0;
+
+	arm926_cache_geometry(ctype >> 12, &dsize, &dways);
+	arm926_cache_geometry(ctype, &isize, &iways);
+	way = dsize / dways;
+
+	if (dways != 4 || iways != 4 || isize / iways != way) {
+		pr_err("cache lockdown: unsupported cache type %08x\n", ctype);
+		return -ENODEV;
+	}
+
+	if (ilen > way || dlen > way) {
+		pr_err("cache lockdown: %lu bytes of text and %lu of data, "
+		       "but a way holds %u\n", ilen, dlen, way);
+		return -ENOSPC;
+	}
+
+	local_irq_save(flags);
+	local_fiq_disable();
+	arm926_cache_lock_sets = way / 32;
+	arm926_cache_lock_way0((unsigned long)__cachelock_text_start,
+			       (unsigned long)__cachelock_text_end,
+			       (unsigned long)__cachelock_data_start,
+			       (unsigned long)__cachelock_data_end);
+	local_fiq_enable();
+	local_irq_restore(flags);
+
+	pr_info("cache lockdown: %lu bytes of text and %lu of data locked, "
+		"%uK I and %uK D cache left for the rest\n", ilen, dlen,
+		(isize - way) >> 10, (dsize - way) >> 10);
+	return 0;
+}
+core_initcall(arm926_cache_lockdown);
@@ -17,6 +17,11 @@
 #include <linux/init.h>
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
+#include <linux/dma-contiguous.h>
+#include <linux/vmalloc.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
 
 #include <asm/memory.h>
 #include <asm/highmem.h>
@@ -63,6 +68,19 @@ static u64 get_coherent_dma_mask(struct device *dev)
 	return mask;
 }
 
+/*
+ * Ensure that the allocated pages are zeroed, and that any data
+ * lurking in the kernel direct-mapped region is invalidated.
+ */
+static void __dma_clear_buffer(struct page *page, size_t size)
+{
+	void *ptr = page_address(page);
+
+	memset(ptr, 0, size);
+	dmac_flush_range(ptr, ptr + size);
+	outer_flush_range(__pa(ptr), __pa(ptr) + size);
+}
+
 /*
  * Allocate a DMA buffer for 'dev' of size 'size' using the
  * specified gfp mask.  Note that 'size' must be page aligned.
@@ -71,7 +89,6 @@ static struct page *__dma_alloc_buffer(struct device *dev, size_t size, gfp_t gf
 {
 	unsigned long order = get_order(size);
 	struct page *page, *p, *e;
-	void *ptr;
 	u64 mask = get_coherent_dma_mask(dev);
 
 #ifdef CONFIG_DMA_API_DEBUG
@@ -100,14 +117,7 @@ static struct page *__dma_alloc_buffer(struct device *dev, size_t size, gfp_t gf
 	for (p = page + (size >> PAGE_SHIFT), e = page + (1 << order); p < e; p++)
 		__free_page(p);
 
-	/*
-	 * Ensure that the allocated pages are zeroed, and that any data
-	 * lurking in the kernel direct-mapped region is invalidated.
-	 */
-	ptr = page_address(page);
-	memset(ptr, 0, size);
-	dmac_flush_range(ptr, ptr + size);
-	outer_flush_range(__pa(ptr), __pa(ptr) + size);
+	__dma_clear_buffer(page, size);
 
 	return page;
 }
@@ -279,6 +289,62 @@ static void __dma_free_remap(void *cpu_addr, size_t size)
 
 #endif	/* CONFIG_MMU */
 
+#ifdef CONFIG_CMA
+/*
+ * Buffers from a contiguous DMA region may be much larger than the
+ * consistent mapping window, so their uncached alias goes into the
+ * vmalloc area instead.
+ */
+static struct page *
+__dma_alloc_from_contiguous(struct device *dev, size_t size, gfp_t gfp)
+{
+	struct page *page;
+
+	/* Making room in the region means migrating pages, which sleeps */
+	if (!(gfp & __GFP_WAIT))
+		return NULL;
+
+	page = dma_alloc_from_contiguous(dev, size >> PAGE_SHIFT,
+					 get_order(size));
+	if (page)
+		__dma_clear_buffer(page, size);
+
+	return page;
+}
+
+static void *
+__dma_map_contiguous(struct device *dev, struct page *page, size_t size,
+		     dma_addr_t *handle, pgprot_t prot)
+{
+	unsigned int i, count = size >> PAGE_SHIFT;
+	struct page **pages;
+	void *addr = NULL;
+
+	if (arch_is_coherent()) {
+		addr = page_address(page);
+	} else {
+		pages = kmalloc(count * sizeof(*pages), GFP_KERNEL);
+		if (pages) {
+			for (i = 0; i < count; i++)
+				pages[i] = page + i;
+			addr = vmap(pages, count, VM_MAP, prot);
+			kfree(pages);
+		}
+	}
+
+	if (!addr) {
+		dma_release_from_contiguous(dev, page, count);
+		return NULL;
+	}
+
+	*handle = page_to_dma(dev, page);
+	return addr;
+}
+#else
+#define __dma_alloc_from_contiguous(dev, size, gfp)	NULL
+#define __dma_map_contiguous(dev, page, size, handle, prot)	NULL
+#endif
+
 static void *
 __dma_alloc(struct device *dev, size_t size, dma_addr_t *handle, gfp_t gfp,
 	    pgprot_t prot)
@@ -289,6 +355,10 @@ __dma_alloc(struct device *dev, size_t size, dma_addr_t *handle, gfp_t gfp,
 	*handle = ~0;
 	size = PAGE_ALIGN(size);
 
+	page = __dma_alloc_from_contiguous(dev, size, gfp);
+	if (page)
+		return __dma_map_contiguous(dev, page, size, handle, prot);
+
 	page = __dma_alloc_buffer(dev, size, gfp);
 	if (!page)
 		return NULL;
@@ -356,6 +426,19 @@ static int dma_mmap(struct device *dev, struct vm_area_struct *vma,
 					      user_size << PAGE_SHIFT,
 					      vma->vm_page_prot);
 		}
+	} else if (is_vmalloc_addr(cpu_addr)) {
+		/* a buffer from a contiguous DMA region */
+		unsigned long off = vma->vm_pgoff;
+
+		kern_size = PAGE_ALIGN(size) >> PAGE_SHIFT;
+
+		if (off < kern_size &&
+		    user_size <= (kern_size - off)) {
+			ret = remap_pfn_range(vma, vma->vm_start,
+					      page_to_pfn(dma_to_page(dev, dma_addr)) + off,
+					      user_size << PAGE_SHIFT,
+					      vma->vm_page_prot);
+		}
 	}
 #endif	/* CONFIG_MMU */
 
@@ -384,6 +467,8 @@ EXPORT_SYMBOL(dma_mmap_writecombine);
  */
 void dma_free_coherent(struct device *dev, size_t size, void *cpu_addr, dma_addr_t handle)
 {
+	struct page *page;
+
 	WARN_ON(irqs_disabled());
 
 	if (dma_release_from_coherent(dev, get_order(size), cpu_addr))
@@ -391,13 +476,24 @@ void dma_free_coherent(struct device *dev, size_t size, void *cpu_addr, dma_addr
 
 	size = PAGE_ALIGN(size);
 
-	if (!arch_is_coherent())
-		__dma_free_remap(cpu_addr, size);
+	if (!arch_is_coherent()) {
+		/* only buffers from a contiguous DMA region are vmap()ed */
+		if (is_vmalloc_addr(cpu_addr))
+			vunmap(cpu_addr);
+		else
+			__dma_free_remap(cpu_addr, size);
+	}
 
-	__dma_free_buffer(dma_to_page(dev, handle), size);
+	page = dma_to_page(dev, handle);
+	if (!dma_release_from_contiguous(dev, page, size >> PAGE_SHIFT))
+		__dma_free_buffer(page, size);
 }
 EXPORT_SYMBOL(dma_free_coherent);
 
+/* the D-cache size on the ARM926 and friends */
+u32 dma_cache_whole_limit = SZ_16K;
+EXPORT_SYMBOL(dma_cache_whole_limit);
+
 /*
  * Make an area consistent for devices.
  * Note: Drivers should NOT use this function directly, as it will break
@@ -597,9 +693,114 @@ void dma_sync_sg_for_device(struct device *dev, struct scatterlist *sg,
 					sg_dma_len(s), dir))
 			continue;
 
-		if (!arch_is_coherent())
+		if (!arch_is_coherent()) {
+			dma_cache_account(dev, s->length, dir);
 			dma_cache_maint_page(sg_page(s), s->offset,
 					     s->length, dir);
+		}
 	}
 }
 EXPORT_SYMBOL(dma_sync_sg_for_device);
+
+#ifdef CONFIG_DMA_CACHE_STATS
+#define DMA_CACHE_STATS		32
+#define DMA_CACHE_NAME_LEN	20
+
+/* cache maintenance done on behalf of each driver, by DMA direction */
+struct dma_cache_stat {
+	char			name[DMA_CACHE_NAME_LEN];
+	unsigned long		ops[3];
+	unsigned long long	bytes[3];
+	unsigned long		whole;
+};
+
+static struct dma_cache_stat dma_cache_stats[DMA_CACHE_STATS];
+static DEFINE_SPINLOCK(dma_cache_stats_lock);
+
+void dma_cache_account(struct device *dev, size_t size, int dir)
+{
+	const char *name = "other";
+	struct dma_cache_stat *st;
+	unsigned long flags;
+	int i;
+
+	if (dev && dev->driver)
+		name = dev->driver->name;
+
+	spin_lock_irqsave(&dma_cache_stats_lock, flags);
+	for (i = 0; i < DMA_CACHE_STATS; i++) {
+		st = &dma_cache_stats[i];
+		if (!st->name[0])
+			strlcpy(st->name, name, sizeof(st->name));
+		if (!strncmp(st->name, name, sizeof(st->name) - 1))
+			break;
+	}
+	/* the last slot collects whatever did not fit */
+	if (i == DMA_CACHE_STATS)
+		st = &dma_cache_stats[DMA_CACHE_STATS - 1];
+
+	st->ops[dir]++;
+	st->bytes[dir] += size;
+	if (size >= dma_cache_whole_limit)
+		st->whole++;
+	spin_unlock_irqrestore(&dma_cache_stats_lock, flags);
+}
+EXPORT_SYMBOL(dma_cache_account);
+
+static int dma_cache_stats_show(struct seq_file *m, void *v)
+{
+	struct dma_cache_stat *st;
+	unsigned long flags;
+	int i;
+
+	seq_printf(m, "%-20s %10s %12s %10s %12s %10s %12s %8s\n",
+		   "driver", "flush", "bytes", "clean", "bytes",
+		   "inv", "bytes", "whole");
+
+	spin_lock_irqsave(&dma_cache_stats_lock, flags);
+	for (i = 0; i < DMA_CACHE_STATS && dma_cache_stats[i].name[0]; i++) {
+		st = &dma_cache_stats[i];
+		seq_printf(m, "%-20s %10lu %12llu %10lu %12llu %10lu %12llu "
+			   "%8lu\n", st->name,
+			   st->ops[DMA_BIDIRECTIONAL],
+			   st->bytes[DMA_BIDIRECTIONAL],
+			   st->ops[DMA_TO_DEVICE], st->bytes[DMA_TO_DEVICE],
+			   st->ops[DMA_FROM_DEVICE],
+			   st->bytes[DMA_FROM_DEVICE], st->whole);
+	}
+	spin_unlock_irqrestore(&dma_cache_stats_lock, flags);
+	return 0;
+}
+
+static int dma_cache_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dma_cache_stats_show, NULL);
+}
+
+static const struct file_operations dma_cache_stats_fops = {
+	.open		= dma_cache_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif
+
+#ifdef CONFIG_DEBUG_FS
+static int __init dma_cache_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("dma_cache", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_u32("whole_limit", S_IRUGO | S_IWUSR, dir,
+			   &dma_cache_whole_limit);
+#ifdef CONFIG_DMA_CACHE_STATS
+	debugfs_create_file("stats", S_IRUGO, dir, NULL,
+			    &dma_cache_stats_fops);
+#endif
+	return 0;
+}
+late_initcall(dma_cache_debugfs_init);
+#endif
@@ -41,6 +41,9 @@ static int op_arm_create_files(struct super_block *sb, struct dentry *root)
 		oprofilefs_create_ulong(sb, dir, "user", &counter_config[i].user);
 	}
 
+	if (op_arm_model->create_files)
+		return op_arm_model->create_files(sb, root);
+
 	return 0;
 }
 
@@ -149,6 +152,10 @@ int __init oprofile_arch_init(struct oprofile_operations *ops)
 	spec = &op_armv7_spec;
 #endif
 
+#ifdef CONFIG_OPROFILE_DAVINCI_TIMER
+	spec = &op_davinci_timer_spec;
+#endif
+
 	if (spec) {
 		ret = spec->init();
 		if (ret < 0)
@@ -17,6 +17,8 @@ struct op_arm_model_spec {
 	int (*setup_ctrs)(void);
 	int (*start)(void);
 	void (*stop)(void);
+	/* optional, for models with settings beyond the counters */
+	int (*create_files)(struct super_block *sb, struct dentry *root);
 	char *name;
 };
 
@@ -27,6 +29,7 @@ extern struct op_arm_model_spec op_xscale_spec;
 extern struct op_arm_model_spec op_armv6_spec;
 extern struct op_arm_model_spec op_mpcore_spec;
 extern struct op_arm_model_spec op_armv7_spec;
+extern struct op_arm_model_spec op_davinci_timer_spec;
 
 extern void arm_backtrace(struct pt_regs * const regs, unsigned int depth);
 
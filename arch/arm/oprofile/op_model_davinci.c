@@ -0,0 +1,262 @@
+/**
+ * @file op_model_davinci.c
+ * DaVinci timer sampling driver
+ *
+ * The ARM926 has no performance monitor, so oprofile on DaVinci would
+ * only get the HZ tick.  This samples from a spare timer64 instead, at
+ * /dev/oprofile/timer_hz.  Normally the timer raises the highest
+ * priority IRQ and each sample goes through oprofile_add_sample(), with
+ * kernel and user backtraces.  With /dev/oprofile/timer_fiq set, on
+ * SoCs with a CP_INTC, it raises an FIQ instead: that also samples code
+ * running with IRQs disabled, but only records the pc.
+ *
+ * Userspace sees cpu_type "timer", so opcontrol runs in timer mode.
+ *
+ * @remark Copyright 2010 Texas Instruments Incorporated
+ *
+ * @remark Read the file COPYING
+ */
+#include <linux/types.h>
+#include <linux/errno.h>
+#include <linux/sched.h>
+#include <linux/oprofile.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/io.h>
+#include <linux/ioport.h>
+#include <linux/clk.h>
+#include <linux/err.h>
+
+#include <asm/fiq.h>
+#include <asm/irq_regs.h>
+#include <asm/ptrace.h>
+
+#include <mach/hardware.h>
+#include <mach/common.h>
+#include <mach/irqs.h>
+#include <mach/cp_intc.h>
+
+#include "op_counter.h"
+#include "op_arm_model.h"
+
+/* timer64 registers, TIM12 run as a periodic 32-bit timer */
+#define TIM12			0x10
+#define PRD12			0x18
+#define TCR			0x20
+#define TGCR			0x24
+
+#define TCR_ENAMODE12_PERIODIC	(2 << 6)
+#define TGCR_32BIT_UNCHAINED	(1 << 2)
+#define TGCR_UNRESET		(3 << 0)
+
+#define OP_DAVINCI_DEFAULT_HZ	2000
+#define OP_DAVINCI_MAX_HZ	50000
+
+/* highest priority that still goes to nIRQ, on AINTC and CP_INTC alike */
+#define OP_DAVINCI_IRQ_PRIO	2
+
+static struct davinci_timer_instance *op_timer;
+static struct clk *op_clk;
+static unsigned long op_davinci_hz = OP_DAVINCI_DEFAULT_HZ;
+static unsigned long op_davinci_fiq;
+static u32 op_period;
+static int op_using_fiq;
+static int op_old_prio;
+
+static irqreturn_t op_davinci_sample(int irq, void *arg)
+{
+	oprofile_add_sample(get_irq_regs(), 0);
+	return IRQ_HANDLED;
+}
+
+#ifdef CONFIG_OPROFILE_DAVINCI_FIQ
+/* filled by the FIQ handler, see op_model_davinci_fiq.S */
+#define OP_DAVINCI_RING_ENTRIES	256
+
+struct op_davinci_ring {
+	u32	head;		/* written by the FIQ handler only */
+	u32	tail;		/* written by op_davinci_drain() only */
+	u32	sample[OP_DAVINCI_RING_ENTRIES][2];	/* pc, cpsr */
+};
+
+extern unsigned char op_davinci_fiq_start, op_davinci_fiq_end;
+
+static struct op_davinci_ring op_ring;
+
+static struct fiq_handler op_davinci_fh = {
+	.name	= "oprofile",
+};
+
+static irqreturn_t op_davinci_drain(int irq, void *arg)
+{
+	u32 head = ACCESS_ONCE(op_ring.head);
+	u32 tail = op_ring.tail;
+
+	while (tail != head) {
+		u32 *s = op_ring.sample[tail % OP_DAVINCI_RING_ENTRIES];
+
+		oprofile_add_pc(s[0], (s[1] & MODE_MASK) != USR_MODE, 0);
+		tail++;
+	}
+	barrier();
+	op_ring.tail = tail;
+
+	return IRQ_HANDLED;
+}
+
+static int op_davinci_start_fiq(void)
+{
+	struct pt_regs regs = { };
+	int ret;
+
+	ret = claim_fiq(&op_davinci_fh);
+	if (ret)
+		return ret;
+
+	ret = request_irq(op_timer->top_irq, op_davinci_drain, IRQF_DISABLED,
+			"oprofile", NULL);
+	if (ret)
+		goto err_irq;
+
+	op_ring.head = op_ring.tail = 0;
+	set_fiq_handler(&op_davinci_fiq_start,
+			&op_davinci_fiq_end - &op_davinci_fiq_start);
+	regs.ARM_r8 = (unsigned long)davinci_soc_info.intc_base;
+	regs.ARM_r9 = (unsigned long)&op_ring;
+	regs.ARM_r10 = op_timer->bottom_irq;
+	regs.ARM_fp = op_timer->top_irq;	/* r11 */
+	set_fiq_regs(&regs);
+
+	ret = cp_intc_set_fiq(op_timer->bottom_irq);
+	if (ret)
+		goto err_fiq;
+	enable_fiq(op_timer->bottom_irq);
+	return 0;
+
+err_fiq:
+	free_irq(op_timer->top_irq, NULL);
+err_irq:
+	release_fiq(&op_davinci_fh);
+	return ret;
+}
+
+static void op_davinci_stop_fiq(void)
+{
+	disable_fiq(op_timer->bottom_irq);
+	release_fiq(&op_davinci_fh);
+	free_irq(op_timer->top_irq, NULL);
+}
+#else
+static inline int op_davinci_start_fiq(void)
+{
+	return -ENODEV;
+}
+
+static inline void op_davinci_stop_fiq(void)
+{
+}
+#endif
+
+static int op_davinci_setup(void)
+{
+	unsigned long rate = clk_get_rate(op_clk);
+
+	if (!op_davinci_hz || op_davinci_hz > OP_DAVINCI_MAX_HZ)
+		return -EINVAL;
+
+	op_period = rate / op_davinci_hz;
+#ifdef CONFIG_OPROFILE_DAVINCI_FIQ
+	op_using_fiq = op_davinci_fiq &&
+		davinci_soc_info.intc_type == DAVINCI_INTC_TYPE_CP_INTC;
+#endif
+	return 0;
+}
+
+static int op_davinci_start(void)
+{
+	void __iomem *base = op_timer->base;
+	int ret;
+
+	/* shared with the watchdog on some SoCs, whichever comes first */
+	if (!request_mem_region(io_v2p((unsigned long)base), SZ_1K,
+				"oprofile"))
+		return -EBUSY;
+
+	clk_enable(op_clk);
+
+	op_old_prio = davinci_irq_get_priority(op_timer->bottom_irq);
+	if (op_using_fiq) {
+		ret = op_davinci_start_fiq();
+	} else {
+		ret = request_irq(op_timer->bottom_irq, op_davinci_sample,
+				IRQF_DISABLED | IRQF_TIMER, "oprofile", NULL);
+		if (!ret)
+			davinci_irq_set_priority(op_timer->bottom_irq,
+					OP_DAVINCI_IRQ_PRIO);
+	}
+	if (ret) {
+		clk_disable(op_clk);
+		release_mem_region(io_v2p((unsigned long)base), SZ_1K);
+		return ret;
+	}
+
+	__raw_writel(0, base + TCR);
+	__raw_writel(0, base + TGCR);
+	__raw_writel(TGCR_32BIT_UNCHAINED, base + TGCR);
+	__raw_writel(TGCR_32BIT_UNCHAINED | TGCR_UNRESET, base + TGCR);
+	__raw_writel(0, base + TIM12);
+	__raw_writel(op_period, base + PRD12);
+	__raw_writel(TCR_ENAMODE12_PERIODIC, base + TCR);
+
+	return 0;
+}
+
+static void op_davinci_stop(void)
+{
+	void __iomem *base = op_timer->base;
+
+	__raw_writel(0, base + TCR);
+
+	if (op_using_fiq)
+		op_davinci_stop_fiq();
+	else
+		free_irq(op_timer->bottom_irq, NULL);
+	if (op_old_prio >= 0)
+		davinci_irq_set_priority(op_timer->bottom_irq, op_old_prio);
+
+	clk_disable(op_clk);
+	release_mem_region(io_v2p((unsigned long)base), SZ_1K);
+}
+
+static int op_davinci_create_files(struct super_block *sb,
+		struct dentry *root)
+{
+	oprofilefs_create_ulong(sb, root, "timer_hz", &op_davinci_hz);
+	oprofilefs_create_ulong(sb, root, "timer_fiq", &op_davinci_fiq);
+	return 0;
+}
+
+static int op_davinci_init(void)
+{
+	struct davinci_timer_info *dti = davinci_soc_info.timer_info;
+
+	if (!dti || !dti->profile)
+		return -ENODEV;
+
+	op_clk = clk_get(NULL, dti->profile_clk);
+	if (IS_ERR(op_clk))
+		return PTR_ERR(op_clk);
+
+	op_timer = dti->profile;
+	return 0;
+}
+
+struct op_arm_model_spec op_davinci_timer_spec = {
+	.init		= op_davinci_init,
+	.num_counters	= 0,
+	.setup_ctrs	= op_davinci_setup,
+	.start		= op_davinci_start,
+	.stop		= op_davinci_stop,
+	.create_files	= op_davinci_create_files,
+	.name		= "timer",
+};
@@ -13,6 +13,7 @@
 #include <linux/init.h>
 #include <linux/compiler.h>
 #include <linux/rbtree.h>
+#include <linux/log2.h>
 
 /*
  * See Documentation/block/deadline-iosched.txt
@@ -49,6 +50,17 @@ struct deadline_data {
 	int fifo_batch;
 	int writes_starved;
 	int front_merges;
+	/*
+	 * flash mode, when set: reads go out in arrival order and writes in
+	 * runs covering one erase block of this size each
+	 */
+	int erase_block_kb;
+
+	/*
+	 * statistics
+	 */
+	unsigned long merged_bios;	/* bios merged into a queued request */
+	unsigned long merged_requests;	/* queued requests merged together */
 };
 
 static void deadline_move_request(struct deadline_data *, struct request *);
@@ -158,6 +170,8 @@ static void deadline_merged_request(struct request_queue *q,
 {
 	struct deadline_data *dd = q->elevator->elevator_data;
 
+	dd->merged_bios++;
+
 	/*
 	 * if the merge was a front merge, we need to reposition request
 	 */
@@ -171,6 +185,10 @@ static void
 deadline_merged_requests(struct request_queue *q, struct request *req,
 			 struct request *next)
 {
+	struct deadline_data *dd = q->elevator->elevator_data;
+
+	dd->merged_requests++;
+
 	/*
 	 * if next expires before rq, assign its expire time to rq
 	 * and move into next position (next will be deleted) in fifo
@@ -238,6 +256,17 @@ static inline int deadline_check_fifo(struct deadline_data *dd, int ddir)
 	return 0;
 }
 
+/*
+ * in flash mode, does rq start in the erase block the last request ended in
+ */
+static inline int deadline_same_erase_block(struct deadline_data *dd,
+					    struct request *rq)
+{
+	sector_t mask = ((sector_t)dd->erase_block_kb << 1) - 1;
+
+	return (blk_rq_pos(rq) & ~mask) == ((dd->last_sector - 1) & ~mask);
+}
+
 /*
  * deadline_dispatch_requests selects the best request according to
  * read/write expire, fifo_batch, etc
@@ -258,7 +287,21 @@ static int deadline_dispatch_requests(struct request_queue *q, int force)
 	else
 		rq = dd->next_rq[READ];
 
-	if (rq && dd->batching < dd->fifo_batch)
+	if (rq && dd->erase_block_kb) {
+		/*
+		 * flash has no seeks to save: reads are batched in fifo
+		 * order, a write batch lasts until the end of the erase block
+		 * or until a read expires
+		 */
+		if (rq_data_dir(rq) == READ) {
+			if (dd->batching < dd->fifo_batch) {
+				rq = rq_entry_fifo(dd->fifo_list[READ].next);
+				goto dispatch_request;
+			}
+		} else if (deadline_same_erase_block(dd, rq) &&
+			   !(reads && deadline_check_fifo(dd, READ)))
+			goto dispatch_request;
+	} else if (rq && dd->batching < dd->fifo_batch)
 		/* we have a next request are still entitled to batch */
 		goto dispatch_request;
 
@@ -299,11 +342,13 @@ dispatch_find_request:
 	/*
 	 * we are not running a batch, find best request for selected data_dir
 	 */
-	if (deadline_check_fifo(dd, data_dir) || !dd->next_rq[data_dir]) {
+	if (deadline_check_fifo(dd, data_dir) || !dd->next_rq[data_dir] ||
+	    (dd->erase_block_kb && data_dir == READ)) {
 		/*
 		 * A deadline has expired, the last request was in the other
-		 * direction, or we have run out of higher-sectored requests.
-		 * Start again from the request with the earliest expiry time.
+		 * direction, we have run out of higher-sectored requests, or
+		 * sort order does not matter (flash reads). Start again from
+		 * the request with the earliest expiry time.
 		 */
 		rq = rq_entry_fifo(dd->fifo_list[data_dir].next);
 	} else {
@@ -400,6 +445,7 @@ SHOW_FUNCTION(deadline_write_expire_show, dd->fifo_expire[WRITE], 1);
 SHOW_FUNCTION(deadline_writes_starved_show, dd->writes_starved, 0);
 SHOW_FUNCTION(deadline_front_merges_show, dd->front_merges, 0);
 SHOW_FUNCTION(deadline_fifo_batch_show, dd->fifo_batch, 0);
+SHOW_FUNCTION(deadline_erase_block_kb_show, dd->erase_block_kb, 0);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
@@ -425,6 +471,32 @@ STORE_FUNCTION(deadline_front_merges_store, &dd->front_merges, 0, 1, 0);
 STORE_FUNCTION(deadline_fifo_batch_store, &dd->fifo_batch, 0, INT_MAX, 0);
 #undef STORE_FUNCTION
 
+/* 0 turns flash mode off, anything else is rounded to a power of two */
+static ssize_t
+deadline_erase_block_kb_store(struct elevator_queue *e, const char *page,
+			      size_t count)
+{
+	struct deadline_data *dd = e->elevator_data;
+	int __data;
+	int ret = deadline_var_store(&__data, (page), count);
+
+	if (__data <= 0)
+		dd->erase_block_kb = 0;
+	else
+		dd->erase_block_kb = rounddown_pow_of_two(min(__data, 1 << 20));
+	return ret;
+}
+
+#define STAT_FUNCTION(__FUNC, __VAR)					\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct deadline_data *dd = e->elevator_data;			\
+	return sprintf(page, "%lu\n", __VAR);				\
+}
+STAT_FUNCTION(deadline_merged_bios_show, dd->merged_bios);
+STAT_FUNCTION(deadline_merged_requests_show, dd->merged_requests);
+#undef STAT_FUNCTION
+
 #define DD_ATTR(name) \
 	__ATTR(name, S_IRUGO|S_IWUSR, deadline_##name##_show, \
 				      deadline_##name##_store)
@@ -435,6 +507,9 @@ static struct elv_fs_entry deadline_attrs[] = {
 	DD_ATTR(writes_starved),
 	DD_ATTR(front_merges),
 	DD_ATTR(fifo_batch),
+	DD_ATTR(erase_block_kb),
+	__ATTR(merged_bios, S_IRUGO, deadline_merged_bios_show, NULL),
+	__ATTR(merged_requests, S_IRUGO, deadline_merged_requests_show, NULL),
 	__ATTR_NULL
 };
 
@@ -26,6 +26,7 @@
 #include <linux/jiffies.h>
 #include <linux/timex.h>
 #include <linux/interrupt.h>
+#include <linux/vmalloc.h>
 #include "tcrypt.h"
 #include "internal.h"
 
@@ -458,6 +459,168 @@ out:
 	crypto_free_hash(tfm);
 }
 
+/*
+ * Text-like input: words from a small vocabulary, with one byte in eight
+ * random, so matches are short and literals frequent, as in binaries
+ * and configuration files.
+ */
+static void fill_comp_speed_data(u8 *buf, unsigned int len)
+{
+	static const char * const words[] = {
+		"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "a ",
+		"lazy ", "dog", "\n", "0x3d8f, ", "inode ", "return ", "\t",
+	};
+	unsigned int i = 0;
+	u32 seed = 1;
+	const char *w;
+
+	while (i < len) {
+		seed = seed * 1103515245 + 12345;
+		if (!(seed & 0x70000)) {
+			buf[i++] = seed >> 24;
+			continue;
+		}
+		for (w = words[(seed >> 24) % ARRAY_SIZE(words)];
+		     *w && i < len; w++)
+			buf[i++] = *w;
+	}
+}
+
+static int test_comp_jiffies(struct crypto_comp *tfm, const u8 *src,
+			     unsigned int slen, u8 *dst, unsigned int blen,
+			     int sec)
+{
+	unsigned long start, end;
+	unsigned int dlen;
+	int bcount;
+	int ret;
+
+	for (start = jiffies, end = start + sec * HZ, bcount = 0;
+	     time_before(jiffies, end); bcount++) {
+		dlen = blen;
+		ret = crypto_comp_decompress(tfm, src, slen, dst, &dlen);
+		if (ret)
+			return ret;
+	}
+
+	printk("%6u opers/sec, %9lu bytes/sec\n",
+	       bcount / sec, ((long)bcount * blen) / sec);
+
+	return 0;
+}
+
+static int test_comp_cycles(struct crypto_comp *tfm, const u8 *src,
+			    unsigned int slen, u8 *dst, unsigned int blen)
+{
+	unsigned long cycles = 0;
+	unsigned int dlen;
+	int i;
+	int ret;
+
+	local_bh_disable();
+	local_irq_disable();
+
+	/* Warm-up run. */
+	for (i = 0; i < 4; i++) {
+		dlen = blen;
+		ret = crypto_comp_decompress(tfm, src, slen, dst, &dlen);
+		if (ret)
+			goto out;
+	}
+
+	/* The real thing. */
+	for (i = 0; i < 8; i++) {
+		cycles_t start, end;
+
+		dlen = blen;
+		start = get_cycles();
+
+		ret = crypto_comp_decompress(tfm, src, slen, dst, &dlen);
+		if (ret)
+			goto out;
+
+		end = get_cycles();
+
+		cycles += end - start;
+	}
+
+out:
+	local_irq_enable();
+	local_bh_enable();
+
+	if (ret)
+		return ret;
+
+	printk("%6lu cycles/operation, %4lu cycles/byte\n",
+	       cycles / 8, cycles / (8 * blen));
+
+	return 0;
+}
+
+static void test_comp_speed(const char *algo, unsigned int sec,
+			    unsigned int *sizes)
+{
+	struct crypto_comp *tfm;
+	unsigned int max = 0, blen, clen;
+	u8 *src = NULL, *cmp = NULL, *dst = NULL;
+	int i;
+	int ret;
+
+	printk(KERN_INFO "\ntesting speed of %s decompression\n", algo);
+
+	tfm = crypto_alloc_comp(algo, 0, 0);
+
+	if (IS_ERR(tfm)) {
+		printk(KERN_ERR "failed to load transform for %s: %ld\n", algo,
+		       PTR_ERR(tfm));
+		return;
+	}
+
+	for (i = 0; sizes[i] != 0; i++)
+		max = max(max, sizes[i]);
+
+	src = vmalloc(max);
+	cmp = vmalloc(2 * max);
+	dst = vmalloc(max);
+	if (!src || !cmp || !dst) {
+		printk(KERN_ERR "no memory for %u byte blocks\n", max);
+		goto out;
+	}
+
+	fill_comp_speed_data(src, max);
+
+	for (i = 0; sizes[i] != 0; i++) {
+		blen = sizes[i];
+		clen = 2 * max;
+
+		ret = crypto_comp_compress(tfm, src, blen, cmp, &clen);
+		if (ret) {
+			printk(KERN_ERR "compressing %u bytes failed ret=%d\n",
+			       blen, ret);
+			break;
+		}
+
+		printk(KERN_INFO "test%3u (%6u byte blocks,%6u compressed): ",
+		       i, blen, clen);
+
+		if (sec)
+			ret = test_comp_jiffies(tfm, cmp, clen, dst, blen, sec);
+		else
+			ret = test_comp_cycles(tfm, cmp, clen, dst, blen);
+
+		if (ret) {
+			printk(KERN_ERR "decompression failed ret=%d\n", ret);
+			break;
+		}
+	}
+
+out:
+	vfree(dst);
+	vfree(cmp);
+	vfree(src);
+	crypto_free_comp(tfm);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -744,6 +907,10 @@ static int do_test(int m)
 				speed_template_32_48_64);
 		test_cipher_speed("xts(aes)", DECRYPT, sec, NULL, 0,
 				speed_template_32_48_64);
+		test_cipher_speed("ctr(aes)", ENCRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
+		test_cipher_speed("ctr(aes)", DECRYPT, sec, NULL, 0,
+				speed_template_16_24_32);
 		break;
 
 	case 201:
@@ -884,6 +1051,20 @@ static int do_test(int m)
 	case 399:
 		break;
 
+	case 400:
+		/* fall through */
+
+	case 401:
+		test_comp_speed("deflate", sec, comp_speed_template);
+		if (mode > 400 && mode < 500) break;
+
+	case 402:
+		test_comp_speed("lzo", sec, comp_speed_template);
+		if (mode > 400 && mode < 500) break;
+
+	case 499:
+		break;
+
 	case 1000:
 		test_available();
 		break;
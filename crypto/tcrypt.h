@@ -83,4 +83,15 @@ static struct hash_speed generic_hash_speed_template[] = {
 	{  .blen = 0,	.plen = 0, }
 };
 
+/*
+ * Decompression speed tests: from a JFFS2 or UBIFS node up to the
+ * default squashfs block.
+ */
+static unsigned int comp_speed_template[] = {
+	512, 4096, 16384, 65536, 131072,
+
+	/* End marker */
+	0
+};
+
 #endif	/* _CRYPTO_TCRYPT_H */
@@ -69,6 +69,8 @@
 
 static int ahci_skip_host_reset;
 static int ahci_ignore_sss;
+static int ahci_ccc_completions;
+static int ahci_ccc_timeout;
 
 module_param_named(skip_host_reset, ahci_skip_host_reset, int, 0444);
 MODULE_PARM_DESC(skip_host_reset, "skip global host reset (0=don't skip, 1=skip)");
@@ -76,6 +78,12 @@ MODULE_PARM_DESC(skip_host_reset, "skip global host reset (0=don't skip, 1=skip)
 module_param_named(ignore_sss, ahci_ignore_sss, int, 0444);
 MODULE_PARM_DESC(ignore_sss, "Ignore staggered spinup flag (0=don't ignore, 1=ignore)");
 
+module_param_named(ccc_completions, ahci_ccc_completions, int, 0444);
+MODULE_PARM_DESC(ccc_completions, "Command completions per coalesced interrupt (0=timeout only, max 255)");
+
+module_param_named(ccc_timeout, ahci_ccc_timeout, int, 0444);
+MODULE_PARM_DESC(ccc_timeout, "Command completion coalescing timeout in ms (0=coalescing off)");
+
 static int ahci_enable_alpm(struct ata_port *ap,
 		enum link_pm policy);
 static void ahci_disable_alpm(struct ata_port *ap);
@@ -101,6 +109,9 @@ enum {
 	AHCI_CMD_TBL_AR_SZ	= AHCI_CMD_TBL_SZ * AHCI_MAX_CMDS,
 	AHCI_PORT_PRIV_DMA_SZ	= AHCI_CMD_SLOT_SZ + AHCI_CMD_TBL_AR_SZ +
 				  AHCI_RX_FIS_SZ,
+	AHCI_PORT_PRIV_FBS_DMA_SZ	= AHCI_CMD_SLOT_SZ +
+					  AHCI_CMD_TBL_AR_SZ +
+					  (AHCI_RX_FIS_SZ * 16),
 	AHCI_IRQ_ON_SG		= (1 << 31),
 	AHCI_CMD_ATAPI		= (1 << 5),
 	AHCI_CMD_WRITE		= (1 << 6),
@@ -130,6 +141,8 @@ enum {
 	HOST_IRQ_STAT		= 0x08, /* interrupt status */
 	HOST_PORTS_IMPL		= 0x0c, /* bitmap of implemented ports */
 	HOST_VERSION		= 0x10, /* AHCI spec. version compliancy */
+	HOST_CCC_CTL		= 0x14, /* Cmd Completion Coalescing ctl */
+	HOST_CCC_PORTS		= 0x18, /* ports under CCC */
 	HOST_EM_LOC		= 0x1c, /* Enclosure Management location */
 	HOST_EM_CTL		= 0x20, /* Enclosure Management Control */
 	HOST_CAP2		= 0x24, /* host capabilities, extended */
@@ -139,6 +152,13 @@ enum {
 	HOST_IRQ_EN		= (1 << 1),  /* global IRQ enable */
 	HOST_AHCI_EN		= (1 << 31), /* AHCI enabled */
 
+	/* HOST_CCC_CTL bits */
+	HOST_CCC_TV_SHIFT	= 16,	     /* timeout value, in ms */
+	HOST_CCC_CC_SHIFT	= 8,	     /* command completions */
+	HOST_CCC_INT_SHIFT	= 3,	     /* IS bit used for CCC */
+	HOST_CCC_INT_MASK	= (0x1f << 3),
+	HOST_CCC_EN		= (1 << 0),  /* CCC enable */
+
 	/* HOST_CAP bits */
 	HOST_CAP_SXS		= (1 << 5),  /* Supports External SATA */
 	HOST_CAP_EMS		= (1 << 6),  /* Enclosure Management support */
@@ -179,6 +199,7 @@ enum {
 	PORT_SCR_ERR		= 0x30, /* SATA phy register: SError */
 	PORT_SCR_ACT		= 0x34, /* SATA phy register: SActive */
 	PORT_SCR_NTF		= 0x3c, /* SATA phy register: SNotification */
+	PORT_FBS		= 0x40, /* FIS-based Switching */
 
 	/* PORT_IRQ_{STAT,MASK} bits */
 	PORT_IRQ_COLD_PRES	= (1 << 31), /* cold presence detect */
@@ -212,11 +233,16 @@ enum {
 	DEF_PORT_IRQ		= PORT_IRQ_ERROR | PORT_IRQ_SG_DONE |
 				  PORT_IRQ_SDB_FIS | PORT_IRQ_DMAS_FIS |
 				  PORT_IRQ_PIOS_FIS | PORT_IRQ_D2H_REG_FIS,
+	/* completion events, reported through CCC when it's enabled */
+	PORT_IRQ_COMPLETE	= PORT_IRQ_SG_DONE | PORT_IRQ_SDB_FIS |
+				  PORT_IRQ_DMAS_FIS | PORT_IRQ_PIOS_FIS |
+				  PORT_IRQ_D2H_REG_FIS,
 
 	/* PORT_CMD bits */
 	PORT_CMD_ASP		= (1 << 27), /* Aggressive Slumber/Partial */
 	PORT_CMD_ALPE		= (1 << 26), /* Aggressive Link PM enable */
 	PORT_CMD_ATAPI		= (1 << 24), /* Device is ATAPI */
+	PORT_CMD_FBSCP		= (1 << 22), /* FBS Capable Port */
 	PORT_CMD_PMP		= (1 << 17), /* PMP attached */
 	PORT_CMD_LIST_ON	= (1 << 15), /* cmd list DMA engine running */
 	PORT_CMD_FIS_ON		= (1 << 14), /* FIS DMA engine running */
@@ -231,6 +257,16 @@ enum {
 	PORT_CMD_ICC_PARTIAL	= (0x2 << 28), /* Put i/f in partial state */
 	PORT_CMD_ICC_SLUMBER	= (0x6 << 28), /* Put i/f in slumber state */
 
+	/* PORT_FBS bits */
+	PORT_FBS_DWE_OFFSET	= 16, /* FBS device with error offset */
+	PORT_FBS_DWE_MASK	= (0xf << PORT_FBS_DWE_OFFSET),
+	PORT_FBS_ADO_OFFSET	= 12, /* FBS active dev optimization */
+	PORT_FBS_DEV_OFFSET	= 8,  /* FBS device to issue offset */
+	PORT_FBS_DEV_MASK	= (0xf << PORT_FBS_DEV_OFFSET),  /* FBS.DEV */
+	PORT_FBS_SDE		= (1 << 2), /* FBS single device error */
+	PORT_FBS_DEC		= (1 << 1), /* FBS device error clear */
+	PORT_FBS_EN		= (1 << 0), /* Enable FBS */
+
 	/* hpriv->flags bits */
 	AHCI_HFLAG_NO_NCQ		= (1 << 0),
 	AHCI_HFLAG_IGN_IRQ_IF_ERR	= (1 << 1), /* ignore IRQ_IF_ERR */
@@ -300,6 +336,10 @@ struct ahci_host_priv {
 	u32 			em_loc; /* enclosure management location */
 	void			*base;
 	u32			irq;
+	u32			ccc_irq;	/* IRQ_STAT bit for CCC */
+	u32			ccc_ports;	/* ports under CCC */
+	u8			ccc_cc;		/* CCC completions */
+	u16			ccc_tv;		/* CCC timeout, ms */
 };
 
 struct ahci_port_priv {
@@ -315,6 +355,9 @@ struct ahci_port_priv {
 	unsigned int		ncq_saw_dmas:1;
 	unsigned int		ncq_saw_sdb:1;
 	u32 			intr_mask;	/* interrupts to enable */
+	bool			fbs_supported;	/* FBS capable port */
+	bool			fbs_enabled;	/* FBS turned on */
+	int			fbs_last_dev;	/* FBS.DEV of last cmd */
 	/* enclosure management info per PM slot */
 	struct ahci_em_priv	em_priv[EM_MAX_SLOTS];
 };
@@ -335,6 +378,9 @@ static void ahci_freeze(struct ata_port *ap);
 static void ahci_thaw(struct ata_port *ap);
 static void ahci_pmp_attach(struct ata_port *ap);
 static void ahci_pmp_detach(struct ata_port *ap);
+static int ahci_pmp_qc_defer(struct ata_queued_cmd *qc);
+static void ahci_enable_fbs(struct ata_port *ap);
+static void ahci_disable_fbs(struct ata_port *ap);
 static int ahci_softreset(struct ata_link *link, unsigned int *class,
 			  unsigned long deadline);
 static int ahci_sb600_softreset(struct ata_link *link, unsigned int *class,
@@ -372,11 +418,22 @@ static ssize_t ahci_show_host_version(struct device *dev,
 				      struct device_attribute *attr, char *buf);
 static ssize_t ahci_show_port_cmd(struct device *dev,
 				  struct device_attribute *attr, char *buf);
+static ssize_t ahci_show_ccc(struct device *dev,
+			     struct device_attribute *attr, char *buf);
+static ssize_t ahci_store_ccc(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count);
 
 DEVICE_ATTR(ahci_host_caps, S_IRUGO, ahci_show_host_caps, NULL);
 DEVICE_ATTR(ahci_host_cap2, S_IRUGO, ahci_show_host_cap2, NULL);
 DEVICE_ATTR(ahci_host_version, S_IRUGO, ahci_show_host_version, NULL);
 DEVICE_ATTR(ahci_port_cmd, S_IRUGO, ahci_show_port_cmd, NULL);
+DEVICE_ATTR(ahci_ccc_completions, S_IRUGO | S_IWUSR,
+	    ahci_show_ccc, ahci_store_ccc);
+DEVICE_ATTR(ahci_ccc_timeout, S_IRUGO | S_IWUSR,
+	    ahci_show_ccc, ahci_store_ccc);
+DEVICE_ATTR(ahci_ccc_ports, S_IRUGO | S_IWUSR,
+	    ahci_show_ccc, ahci_store_ccc);
 
 static struct device_attribute *ahci_shost_attrs[] = {
 	&dev_attr_link_power_management_policy,
@@ -386,6 +443,9 @@ static struct device_attribute *ahci_shost_attrs[] = {
 	&dev_attr_ahci_host_cap2,
 	&dev_attr_ahci_host_version,
 	&dev_attr_ahci_port_cmd,
+	&dev_attr_ahci_ccc_completions,
+	&dev_attr_ahci_ccc_timeout,
+	&dev_attr_ahci_ccc_ports,
 	NULL
 };
 
@@ -407,7 +467,7 @@ static struct scsi_host_template ahci_sht = {
 static struct ata_port_operations ahci_ops = {
 	.inherits		= &sata_pmp_port_ops,
 
-	.qc_defer		= sata_pmp_qc_defer_cmd_switch,
+	.qc_defer		= ahci_pmp_qc_defer,
 	.qc_prep		= ahci_qc_prep,
 	.qc_issue		= ahci_qc_issue,
 	.qc_fill_rtf		= ahci_qc_fill_rtf,
@@ -744,14 +804,20 @@ static inline int ahci_nr_ports(u32 cap)
 	return (cap & 0x1f) + 1;
 }
 
-static inline void __iomem *__ahci_port_base(struct ata_host *host,
-					     unsigned int port_no)
+static inline void __iomem *ahci_host_base(struct ata_host *host)
 {
 #ifdef CONFIG_PCI
-	void __iomem *mmio = host->iomap[AHCI_PCI_BAR];
+	return host->iomap[AHCI_PCI_BAR];
 #else
-	void __iomem *mmio = (void __iomem *)host->iomap;
+	return (void __iomem *)host->iomap;
 #endif
+}
+
+static inline void __iomem *__ahci_port_base(struct ata_host *host,
+					     unsigned int port_no)
+{
+	void __iomem *mmio = ahci_host_base(host);
+
 	return mmio + 0x100 + (port_no * 0x80);
 }
 
@@ -810,7 +876,7 @@ static ssize_t ahci_show_host_version(struct device *dev,
 {
 	struct Scsi_Host *shost = class_to_shost(dev);
 	struct ata_port *ap = ata_shost_to_port(shost);
-	void __iomem *mmio = ap->host->iomap[AHCI_PCI_BAR];
+	void __iomem *mmio = ahci_host_base(ap->host);
 
 	return sprintf(buf, "%x\n", readl(mmio + HOST_VERSION));
 }
@@ -825,6 +891,131 @@ static ssize_t ahci_show_port_cmd(struct device *dev,
 	return sprintf(buf, "%x\n", readl(port_mmio + PORT_CMD));
 }
 
+/* completion interrupts a port leaves to CCC */
+static u32 ahci_ccc_port_mask(struct ata_port *ap)
+{
+	struct ahci_host_priv *hpriv = ap->host->private_data;
+
+	if (hpriv->ccc_tv && (hpriv->ccc_ports & (1 << ap->port_no)))
+		return PORT_IRQ_COMPLETE;
+	return 0;
+}
+
+/**
+ *	ahci_set_ccc - program command completion coalescing
+ *	@host: target ATA host
+ *
+ *	Program CCC_CTL and CCC_PORTS from the values in the host
+ *	private area.  While coalescing is on, the ports it covers
+ *	stop raising an interrupt per completion; the HBA raises the
+ *	CCC interrupt instead once ccc_cc commands have completed or
+ *	ccc_tv ms have passed since the first uncounted completion.
+ *	Error and hotplug events still interrupt right away.
+ *
+ *	LOCKING:
+ *	spin_lock_irqsave(host lock), or none during init
+ */
+static void ahci_set_ccc(struct ata_host *host)
+{
+	struct ahci_host_priv *hpriv = host->private_data;
+	void __iomem *mmio = ahci_host_base(host);
+	u32 ctl;
+	int i;
+
+	if (!(hpriv->cap & HOST_CAP_CCC))
+		return;
+
+	/* TV, CC and CCC_PORTS may only change while CCC is disabled */
+	ctl = readl(mmio + HOST_CCC_CTL);
+	writel(ctl & ~HOST_CCC_EN, mmio + HOST_CCC_CTL);
+
+	for (i = 0; i < host->n_ports; i++) {
+		struct ata_port *ap = host->ports[i];
+		struct ahci_port_priv *pp = ap->private_data;
+
+		/* dummy port, or not started yet */
+		if (!pp)
+			continue;
+
+		pp->intr_mask |= PORT_IRQ_COMPLETE;
+		pp->intr_mask &= ~ahci_ccc_port_mask(ap);
+		if (!(ap->pflags & ATA_PFLAG_FROZEN))
+			writel(pp->intr_mask,
+			       ahci_port_base(ap) + PORT_IRQ_MASK);
+	}
+
+	if (!hpriv->ccc_tv) {
+		hpriv->ccc_irq = 0;
+		return;
+	}
+
+	writel(hpriv->ccc_ports, mmio + HOST_CCC_PORTS);
+	ctl = hpriv->ccc_tv << HOST_CCC_TV_SHIFT |
+	      hpriv->ccc_cc << HOST_CCC_CC_SHIFT;
+	writel(ctl, mmio + HOST_CCC_CTL);
+	writel(ctl | HOST_CCC_EN, mmio + HOST_CCC_CTL);
+
+	/* INT is chosen by the HBA, it never clashes with a port bit */
+	ctl = readl(mmio + HOST_CCC_CTL);
+	hpriv->ccc_irq = 1 << ((ctl & HOST_CCC_INT_MASK) >>
+			       HOST_CCC_INT_SHIFT);
+}
+
+static ssize_t ahci_show_ccc(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct Scsi_Host *shost = class_to_shost(dev);
+	struct ata_port *ap = ata_shost_to_port(shost);
+	struct ahci_host_priv *hpriv = ap->host->private_data;
+
+	if (attr == &dev_attr_ahci_ccc_completions)
+		return sprintf(buf, "%u\n", hpriv->ccc_cc);
+	if (attr == &dev_attr_ahci_ccc_timeout)
+		return sprintf(buf, "%u\n", hpriv->ccc_tv);
+	return sprintf(buf, "%x\n", hpriv->ccc_ports);
+}
+
+static ssize_t ahci_store_ccc(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct Scsi_Host *shost = class_to_shost(dev);
+	struct ata_port *ap = ata_shost_to_port(shost);
+	struct ata_host *host = ap->host;
+	struct ahci_host_priv *hpriv = host->private_data;
+	unsigned long flags, val;
+	int rc;
+
+	if (!(hpriv->cap & HOST_CAP_CCC))
+		return -EOPNOTSUPP;
+
+	rc = strict_strtoul(buf, 0, &val);
+	if (rc)
+		return rc;
+
+	spin_lock_irqsave(&host->lock, flags);
+
+	if (attr == &dev_attr_ahci_ccc_completions) {
+		if (val > 0xff)
+			rc = -EINVAL;
+		else
+			hpriv->ccc_cc = val;
+	} else if (attr == &dev_attr_ahci_ccc_timeout) {
+		if (val > 0xffff)
+			rc = -EINVAL;
+		else
+			hpriv->ccc_tv = val;
+	} else
+		hpriv->ccc_ports = val & hpriv->port_map;
+
+	if (!rc)
+		ahci_set_ccc(host);
+
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	return rc ? rc : count;
+}
+
 /**
  *	ahci_save_initial_config - Save and fixup initial config values
  *	@pdev: target PCI device
@@ -1714,6 +1905,8 @@ static void ahci_init_controller(struct ata_host *host)
 		ahci_port_init(pdev, ap, i, mmio, port_mmio);
 	}
 
+	ahci_set_ccc(host);
+
 	tmp = readl(mmio + HOST_CTL);
 	VPRINTK("HOST_CTL 0x%x\n", tmp);
 	writel(tmp | HOST_IRQ_EN, mmio + HOST_CTL);
@@ -2177,6 +2370,31 @@ static void ahci_qc_prep(struct ata_queued_cmd *qc)
 	ahci_fill_cmd_slot(pp, qc->tag, opts);
 }
 
+static void ahci_fbs_dec_intr(struct ata_port *ap)
+{
+	struct ahci_port_priv *pp = ap->private_data;
+	void __iomem *port_mmio = ahci_port_base(ap);
+	u32 fbs = readl(port_mmio + PORT_FBS);
+	int retries = 3;
+
+	DPRINTK("ENTER\n");
+	BUG_ON(!pp->fbs_enabled);
+
+	/* time to wait for DEC is not specified by AHCI spec,
+	 * add a retry loop for safety.
+	 */
+	writel(fbs | PORT_FBS_DEC, port_mmio + PORT_FBS);
+	fbs = readl(port_mmio + PORT_FBS);
+	while ((fbs & PORT_FBS_DEC) && retries--) {
+		udelay(1);
+		fbs = readl(port_mmio + PORT_FBS);
+	}
+
+	if (fbs & PORT_FBS_DEC)
+		dev_printk(KERN_ERR, ap->host->dev,
+			   "failed to clear device error\n");
+}
+
 static void ahci_error_intr(struct ata_port *ap, u32 irq_stat)
 {
 	struct ahci_host_priv *hpriv = ap->host->private_data;
@@ -2185,12 +2403,26 @@ static void ahci_error_intr(struct ata_port *ap, u32 irq_stat)
 	struct ata_link *link = NULL;
 	struct ata_queued_cmd *active_qc;
 	struct ata_eh_info *active_ehi;
+	bool fbs_need_dec = false;
 	u32 serror;
 
-	/* determine active link */
-	ata_for_each_link(link, ap, EDGE)
-		if (ata_link_active(link))
-			break;
+	/* determine active link with error */
+	if (pp->fbs_enabled) {
+		void __iomem *port_mmio = ahci_port_base(ap);
+		u32 fbs = readl(port_mmio + PORT_FBS);
+		int pmp = (fbs & PORT_FBS_DWE_MASK) >> PORT_FBS_DWE_OFFSET;
+
+		if ((fbs & PORT_FBS_SDE) && (pmp < ap->nr_pmp_links) &&
+		    ata_link_online(&ap->pmp_link[pmp])) {
+			link = &ap->pmp_link[pmp];
+			fbs_need_dec = true;
+		}
+
+	} else
+		ata_for_each_link(link, ap, EDGE)
+			if (ata_link_active(link))
+				break;
+
 	if (!link)
 		link = &ap->link;
 
@@ -2227,6 +2459,9 @@ static void ahci_error_intr(struct ata_port *ap, u32 irq_stat)
 	if (irq_stat & PORT_IRQ_UNK_FIS) {
 		u32 *unk = (u32 *)(pp->rx_fis + RX_FIS_UNK);
 
+		if (pp->fbs_enabled)
+			unk += link->pmp * AHCI_RX_FIS_SZ / sizeof(*unk);
+
 		active_ehi->err_mask |= AC_ERR_HSM;
 		active_ehi->action |= ATA_EH_RESET;
 		ata_ehi_push_desc(active_ehi,
@@ -2263,7 +2498,10 @@ static void ahci_error_intr(struct ata_port *ap, u32 irq_stat)
 
 	if (irq_stat & PORT_IRQ_FREEZE)
 		ata_port_freeze(ap);
-	else
+	else if (fbs_need_dec) {
+		ata_link_abort(link);
+		ahci_fbs_dec_intr(ap);
+	} else
 		ata_port_abort(ap);
 }
 
@@ -2274,7 +2512,7 @@ static void ahci_port_intr(struct ata_port *ap)
 	struct ahci_port_priv *pp = ap->private_data;
 	struct ahci_host_priv *hpriv = ap->host->private_data;
 	int resetting = !!(ap->pflags & ATA_PFLAG_RESETTING);
-	u32 status, qc_active;
+	u32 status, qc_active = 0;
 	int rc;
 
 	status = readl(port_mmio + PORT_IRQ_STAT);
@@ -2316,20 +2554,39 @@ static void ahci_port_intr(struct ata_port *ap)
 			/* If the 'N' bit in word 0 of the FIS is set,
 			 * we just received asynchronous notification.
 			 * Tell libata about it.
+			 *
+			 * Lack of SNotification should not appear in
+			 * ahci 1.2, so the workaround is unnecessary
+			 * when FBS is enabled.
 			 */
-			const __le32 *f = pp->rx_fis + RX_FIS_SDB;
-			u32 f0 = le32_to_cpu(f[0]);
-
-			if (f0 & (1 << 15))
-				sata_async_notification(ap);
+			if (pp->fbs_enabled)
+				WARN_ON_ONCE(1);
+			else {
+				const __le32 *f = pp->rx_fis + RX_FIS_SDB;
+				u32 f0 = le32_to_cpu(f[0]);
+
+				if (f0 & (1 << 15))
+					sata_async_notification(ap);
+			}
 		}
 	}
 
-	/* pp->active_link is valid iff any command is in flight */
-	if (ap->qc_active && pp->active_link->sactive)
-		qc_active = readl(port_mmio + PORT_SCR_ACT);
-	else
-		qc_active = readl(port_mmio + PORT_CMD_ISSUE);
+	/* pp->active_link is not reliable once FBS is enabled, both
+	 * PORT_SCR_ACT and PORT_CMD_ISSUE should be checked because
+	 * NCQ and non-NCQ commands may be in flight at the same time.
+	 */
+	if (pp->fbs_enabled) {
+		if (ap->qc_active) {
+			qc_active = readl(port_mmio + PORT_SCR_ACT);
+			qc_active |= readl(port_mmio + PORT_CMD_ISSUE);
+		}
+	} else {
+		/* pp->active_link is valid iff any command is in flight */
+		if (ap->qc_active && pp->active_link->sactive)
+			qc_active = readl(port_mmio + PORT_SCR_ACT);
+		else
+			qc_active = readl(port_mmio + PORT_CMD_ISSUE);
+	}
 
 	rc = ata_qc_complete_multiple(ap, qc_active);
 
@@ -2365,6 +2622,10 @@ static irqreturn_t ahci_interrupt(int irq, void *dev_instance)
 
 	irq_masked = irq_stat & hpriv->port_map;
 
+	/* a CCC interrupt stands for completions on all covered ports */
+	if (irq_stat & hpriv->ccc_irq)
+		irq_masked |= hpriv->ccc_ports;
+
 	spin_lock(&host->lock);
 
 	for (i = 0; i < host->n_ports; i++) {
@@ -2419,6 +2680,15 @@ static unsigned int ahci_qc_issue(struct ata_queued_cmd *qc)
 
 	if (qc->tf.protocol == ATA_PROT_NCQ)
 		writel(1 << qc->tag, port_mmio + PORT_SCR_ACT);
+
+	if (pp->fbs_enabled && pp->fbs_last_dev != qc->dev->link->pmp) {
+		u32 fbs = readl(port_mmio + PORT_FBS);
+		fbs &= ~(PORT_FBS_DEV_MASK | PORT_FBS_DEC);
+		fbs |= qc->dev->link->pmp << PORT_FBS_DEV_OFFSET;
+		writel(fbs, port_mmio + PORT_FBS);
+		pp->fbs_last_dev = qc->dev->link->pmp;
+	}
+
 	writel(1 << qc->tag, port_mmio + PORT_CMD_ISSUE);
 
 	ahci_sw_activity(qc->dev->link);
@@ -2431,6 +2701,9 @@ static bool ahci_qc_fill_rtf(struct ata_queued_cmd *qc)
 	struct ahci_port_priv *pp = qc->ap->private_data;
 	u8 *d2h_fis = pp->rx_fis + RX_FIS_D2H_REG;
 
+	if (pp->fbs_enabled)
+		d2h_fis += qc->dev->link->pmp * AHCI_RX_FIS_SZ;
+
 	ata_tf_from_fis(d2h_fis, &qc->result_tf);
 	return true;
 }
@@ -2483,6 +2756,84 @@ static void ahci_post_internal_cmd(struct ata_queued_cmd *qc)
 		ahci_kick_engine(ap);
 }
 
+static void ahci_enable_fbs(struct ata_port *ap)
+{
+	struct ahci_port_priv *pp = ap->private_data;
+	void __iomem *port_mmio = ahci_port_base(ap);
+	u32 fbs;
+	int rc;
+
+	if (!pp->fbs_supported)
+		return;
+
+	fbs = readl(port_mmio + PORT_FBS);
+	if (fbs & PORT_FBS_EN) {
+		pp->fbs_enabled = true;
+		pp->fbs_last_dev = -1; /* initialization */
+		return;
+	}
+
+	/* PxFBS.EN may only change while the port is idle */
+	rc = ahci_stop_engine(ap);
+	if (rc)
+		return;
+
+	writel(fbs | PORT_FBS_EN, port_mmio + PORT_FBS);
+	fbs = readl(port_mmio + PORT_FBS);
+	if (fbs & PORT_FBS_EN) {
+		dev_printk(KERN_INFO, ap->host->dev, "FBS is enabled.\n");
+		pp->fbs_enabled = true;
+		pp->fbs_last_dev = -1; /* initialization */
+	} else
+		dev_printk(KERN_ERR, ap->host->dev, "Failed to enable FBS\n");
+
+	ahci_start_engine(ap);
+}
+
+static void ahci_disable_fbs(struct ata_port *ap)
+{
+	struct ahci_port_priv *pp = ap->private_data;
+	void __iomem *port_mmio = ahci_port_base(ap);
+	u32 fbs;
+	int rc;
+
+	if (!pp->fbs_supported)
+		return;
+
+	fbs = readl(port_mmio + PORT_FBS);
+	if ((fbs & PORT_FBS_EN) == 0) {
+		pp->fbs_enabled = false;
+		return;
+	}
+
+	rc = ahci_stop_engine(ap);
+	if (rc)
+		return;
+
+	writel(fbs & ~PORT_FBS_EN, port_mmio + PORT_FBS);
+	fbs = readl(port_mmio + PORT_FBS);
+	if (fbs & PORT_FBS_EN)
+		dev_printk(KERN_ERR, ap->host->dev, "Failed to disable FBS\n");
+	else {
+		dev_printk(KERN_INFO, ap->host->dev, "FBS is disabled.\n");
+		pp->fbs_enabled = false;
+	}
+
+	ahci_start_engine(ap);
+}
+
+static int ahci_pmp_qc_defer(struct ata_queued_cmd *qc)
+{
+	struct ata_port *ap = qc->ap;
+	struct ahci_port_priv *pp = ap->private_data;
+
+	/* with FBS every device behind the PMP gets its own queue */
+	if (!sata_pmp_attached(ap) || pp->fbs_enabled)
+		return ata_std_qc_defer(qc);
+	else
+		return sata_pmp_qc_defer_cmd_switch(qc);
+}
+
 static void ahci_pmp_attach(struct ata_port *ap)
 {
 	void __iomem *port_mmio = ahci_port_base(ap);
@@ -2493,6 +2844,8 @@ static void ahci_pmp_attach(struct ata_port *ap)
 	cmd |= PORT_CMD_PMP;
 	writel(cmd, port_mmio + PORT_CMD);
 
+	ahci_enable_fbs(ap);
+
 	pp->intr_mask |= PORT_IRQ_BAD_PMP;
 	writel(pp->intr_mask, port_mmio + PORT_IRQ_MASK);
 }
@@ -2503,6 +2856,8 @@ static void ahci_pmp_detach(struct ata_port *ap)
 	struct ahci_port_priv *pp = ap->private_data;
 	u32 cmd;
 
+	ahci_disable_fbs(ap);
+
 	cmd = readl(port_mmio + PORT_CMD);
 	cmd &= ~PORT_CMD_PMP;
 	writel(cmd, port_mmio + PORT_CMD);
@@ -2599,39 +2954,77 @@ static int ahci_pci_device_resume(struct pci_dev *pdev)
 
 static int ahci_port_start(struct ata_port *ap)
 {
+	struct ahci_host_priv *hpriv = ap->host->private_data;
 	struct device *dev = ap->host->dev;
 	struct ahci_port_priv *pp;
 	void *mem;
 	dma_addr_t mem_dma;
+	size_t dma_sz;
 
 	pp = devm_kzalloc(dev, sizeof(*pp), GFP_KERNEL);
 	if (!pp)
 		return -ENOMEM;
 
-	mem = dmam_alloc_coherent(dev, AHCI_PORT_PRIV_DMA_SZ, &mem_dma,
-				  GFP_KERNEL);
+	/* check FBS capability */
+	if ((hpriv->cap & HOST_CAP_FBS) && sata_pmp_supported(ap)) {
+		void __iomem *port_mmio = ahci_port_base(ap);
+		u32 cmd = readl(port_mmio + PORT_CMD);
+
+		if (cmd & PORT_CMD_FBSCP)
+			pp->fbs_supported = true;
+		else
+			dev_printk(KERN_WARNING, dev,
+				   "port %d can't do FBS\n", ap->port_no);
+	}
+
+	if (pp->fbs_supported)
+		dma_sz = AHCI_PORT_PRIV_FBS_DMA_SZ;
+	else
+		dma_sz = AHCI_PORT_PRIV_DMA_SZ;
+
+	mem = dmam_alloc_coherent(dev, dma_sz, &mem_dma, GFP_KERNEL);
 	if (!mem)
 		return -ENOMEM;
-	memset(mem, 0, AHCI_PORT_PRIV_DMA_SZ);
+	memset(mem, 0, dma_sz);
 
-	/*
-	 * First item in chunk of DMA memory: 32-slot command table,
-	 * 32 bytes each in size
-	 */
-	pp->cmd_slot = mem;
-	pp->cmd_slot_dma = mem_dma;
+	if (pp->fbs_supported) {
+		/*
+		 * With FBS the Received-FIS area holds one 256 byte
+		 * FIS set per PMP port and must be 4K aligned, so it
+		 * goes first.  The command list behind it stays 1K
+		 * aligned.
+		 */
+		pp->rx_fis = mem;
+		pp->rx_fis_dma = mem_dma;
 
-	mem += AHCI_CMD_SLOT_SZ;
-	mem_dma += AHCI_CMD_SLOT_SZ;
+		mem += AHCI_RX_FIS_SZ * 16;
+		mem_dma += AHCI_RX_FIS_SZ * 16;
 
-	/*
-	 * Second item: Received-FIS area
-	 */
-	pp->rx_fis = mem;
-	pp->rx_fis_dma = mem_dma;
+		pp->cmd_slot = mem;
+		pp->cmd_slot_dma = mem_dma;
+
+		mem += AHCI_CMD_SLOT_SZ;
+		mem_dma += AHCI_CMD_SLOT_SZ;
+	} else {
+		/*
+		 * First item in chunk of DMA memory: 32-slot command
+		 * table, 32 bytes each in size
+		 */
+		pp->cmd_slot = mem;
+		pp->cmd_slot_dma = mem_dma;
 
-	mem += AHCI_RX_FIS_SZ;
-	mem_dma += AHCI_RX_FIS_SZ;
+		mem += AHCI_CMD_SLOT_SZ;
+		mem_dma += AHCI_CMD_SLOT_SZ;
+
+		/*
+		 * Second item: Received-FIS area
+		 */
+		pp->rx_fis = mem;
+		pp->rx_fis_dma = mem_dma;
+
+		mem += AHCI_RX_FIS_SZ;
+		mem_dma += AHCI_RX_FIS_SZ;
+	}
 
 	/*
 	 * Third item: data area for storing a single command
@@ -2644,9 +3037,8 @@ static int ahci_port_start(struct ata_port *ap)
 	 * Save off initial list of interrupts to be enabled.
 	 * This could be changed later
 	 */
-	pp->intr_mask = DEF_PORT_IRQ;
-
 	ap->private_data = pp;
+	pp->intr_mask = DEF_PORT_IRQ & ~ahci_ccc_port_mask(ap);
 
 	/* engage engines, captain */
 	return ahci_port_resume(ap);
@@ -3226,6 +3618,13 @@ static int ahci_init_one(struct platform_device *pdev)
 	/* save initial config */
 	ahci_save_initial_config(pdev, hpriv);
 
+	/* coalescing covers every implemented port, off unless asked for */
+	if (hpriv->cap & HOST_CAP_CCC) {
+		hpriv->ccc_ports = hpriv->port_map;
+		hpriv->ccc_cc = clamp(ahci_ccc_completions, 0, 0xff);
+		hpriv->ccc_tv = clamp(ahci_ccc_timeout, 0, 0xffff);
+	}
+
 	/* prepare host */
 	if (hpriv->cap & HOST_CAP_NCQ)
 		pi.flags |= ATA_FLAG_NCQ | ATA_FLAG_FPDMA_AA;
@@ -3377,6 +3776,7 @@ static int ahci_ctlr_resume(struct platform_device *pdev)
 
 	clk_enable(host->clock);
 	ahci_platform_resume(pdev);
+	ahci_set_ccc(host);
 	ata_host_resume(host);
 
 	return 0;
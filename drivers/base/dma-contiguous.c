@@ -0,0 +1,299 @@
+/*
+ * Contiguous DMA regions.
+ *
+ * Regions are reserved from bootmem by board code and lent to the page
+ * allocator as MIGRATE_CMA pageblocks once it is up. Coherent allocations
+ * for the devices a region serves are carved out of it with
+ * alloc_contig_range(), which migrates any movable pages in the way.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/pfn.h>
+#include <linux/bootmem.h>
+#include <linux/bitmap.h>
+#include <linux/slab.h>
+#include <linux/mutex.h>
+#include <linux/device.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/dma-contiguous.h>
+
+#define MAX_CMA_REGIONS		8
+
+/* Coarser alignment than this only wastes the region. */
+#define CMA_MAX_ALIGN_ORDER	8
+
+static struct cma_region *cma_regions[MAX_CMA_REGIONS];
+static int cma_region_count;
+
+/* Serialises bitmap updates and the isolation done by alloc_contig_range() */
+static DEFINE_MUTEX(cma_mutex);
+
+/**
+ * dma_contiguous_reserve() - reserve contiguous DMA regions
+ * @regions:	regions to reserve
+ * @nr:		number of entries in @regions
+ *
+ * Must be called while bootmem is still the allocator, i.e. from the
+ * machine's map_io hook. @regions must stay around for the lifetime of the
+ * kernel. A region that cannot be reserved is skipped; its devices then
+ * fall back to the regular page allocator.
+ */
+int __init dma_contiguous_reserve(struct cma_region *regions, int nr)
+{
+	const unsigned long align = PAGE_SIZE << pageblock_order;
+	struct cma_region *r;
+	unsigned long base, size;
+	void *ptr;
+
+	for (r = regions; r < regions + nr; r++) {
+		if (cma_region_count == MAX_CMA_REGIONS) {
+			pr_err("cma: too many regions, %s not reserved\n",
+			       r->name);
+			return -ENOSPC;
+		}
+
+		size = ALIGN(r->size, align);
+		if (!size)
+			continue;
+
+		if (r->base) {
+			base = r->base;
+			if ((base & (align - 1)) ||
+			    reserve_bootmem(base, size, BOOTMEM_EXCLUSIVE)) {
+				pr_err("cma: cannot reserve %s at %#08lx\n",
+				       r->name, base);
+				continue;
+			}
+		} else {
+			ptr = __alloc_bootmem_nopanic(size, align, 0);
+			if (!ptr) {
+				pr_err("cma: cannot reserve %lu KiB for %s\n",
+				       size >> 10, r->name);
+				continue;
+			}
+			base = __pa(ptr);
+		}
+
+		r->base_pfn = PFN_DOWN(base);
+		r->count = size >> PAGE_SHIFT;
+		cma_regions[cma_region_count++] = r;
+
+		pr_info("cma: reserved %lu MiB at %#08lx for %s\n",
+			size >> 20, base, r->name);
+	}
+
+	return 0;
+}
+
+/* Hand the pageblocks of a reserved region to the page allocator. */
+static int __init cma_activate_region(struct cma_region *r)
+{
+	unsigned long pfn = r->base_pfn;
+	struct zone *zone;
+	unsigned long i;
+
+	if (!pfn_valid(pfn))
+		return -EINVAL;
+
+	/* alloc_contig_range() works within a single zone */
+	zone = page_zone(pfn_to_page(pfn));
+	for (i = 1; i < r->count; i++)
+		if (!pfn_valid(pfn + i) ||
+		    page_zone(pfn_to_page(pfn + i)) != zone)
+			return -EINVAL;
+
+	r->bitmap = kzalloc(BITS_TO_LONGS(r->count) * sizeof(long),
+			    GFP_KERNEL);
+	if (!r->bitmap)
+		return -ENOMEM;
+
+	for (i = 0; i < r->count; i += pageblock_nr_pages)
+		init_cma_reserved_pageblock(pfn_to_page(pfn + i));
+
+	return 0;
+}
+
+static int __init cma_init_reserved_regions(void)
+{
+	int i, ret;
+
+	for (i = 0; i < cma_region_count; i++) {
+		ret = cma_activate_region(cma_regions[i]);
+		if (ret)
+			pr_err("cma: region %s left as a carve-out (%d)\n",
+			       cma_regions[i]->name, ret);
+	}
+
+	return 0;
+}
+core_initcall(cma_init_reserved_regions);
+
+static bool cma_region_serves(struct cma_region *r, const char *name)
+{
+	size_t len = strlen(name);
+	const char *p = r->devs;
+
+	while (p && *p) {
+		if (!strncmp(p, name, len) && (p[len] == ',' || !p[len]))
+			return true;
+		p = strchr(p, ',');
+		if (p)
+			p++;
+	}
+
+	return false;
+}
+
+static struct cma_region *dev_get_cma_region(struct device *dev)
+{
+	const char *name;
+	int i;
+
+	if (!dev)
+		return NULL;
+
+	name = dev_name(dev);
+	for (i = 0; i < cma_region_count; i++)
+		if (cma_regions[i]->bitmap &&
+		    cma_region_serves(cma_regions[i], name))
+			return cma_regions[i];
+
+	return NULL;
+}
+
+/**
+ * dma_alloc_from_contiguous() - allocate pages from a device's region
+ * @dev:	device the buffer is for
+ * @count:	number of pages
+ * @align:	requested alignment of the buffer, as a page order
+ *
+ * Returns the first page of @count physically contiguous pages, or NULL if
+ * @dev has no region or no room could be made in it. May sleep.
+ */
+struct page *dma_alloc_from_contiguous(struct device *dev, int count,
+				       unsigned int align)
+{
+	struct cma_region *r = dev_get_cma_region(dev);
+	unsigned long mask, pfn, pageno, start = 0;
+	struct page *page = NULL;
+	int ret;
+
+	if (!r || count <= 0)
+		return NULL;
+
+	if (align > CMA_MAX_ALIGN_ORDER)
+		align = CMA_MAX_ALIGN_ORDER;
+	mask = (1UL << align) - 1;
+
+	mutex_lock(&cma_mutex);
+
+	for (;;) {
+		pageno = bitmap_find_next_zero_area(r->bitmap, r->count,
+						    start, count, mask);
+		if (pageno >= r->count)
+			break;
+
+		pfn = r->base_pfn + pageno;
+		ret = alloc_contig_range(pfn, pfn + count);
+		if (!ret) {
+			bitmap_set(r->bitmap, pageno, count);
+			r->used += count;
+			page = pfn_to_page(pfn);
+			break;
+		} else if (ret != -EBUSY) {
+			break;
+		}
+
+		/* Something pinned in there, try the next aligned slot */
+		pr_debug("cma: %s: range at pfn %#lx busy, retrying\n",
+			 r->name, pfn);
+		start = pageno + mask + 1;
+	}
+
+	mutex_unlock(&cma_mutex);
+
+	return page;
+}
+
+/**
+ * dma_release_from_contiguous() - give pages back to a device's region
+ * @dev:	device the buffer was allocated for
+ * @pages:	first page of the buffer
+ * @count:	number of pages
+ *
+ * Returns false if the buffer does not come from @dev's region, in which
+ * case the caller frees it the usual way.
+ */
+bool dma_release_from_contiguous(struct device *dev, struct page *pages,
+				 int count)
+{
+	struct cma_region *r = dev_get_cma_region(dev);
+	unsigned long pfn;
+
+	if (!r || !pages)
+		return false;
+
+	pfn = page_to_pfn(pages);
+	if (pfn < r->base_pfn || pfn >= r->base_pfn + r->count)
+		return false;
+
+	VM_BUG_ON(pfn + count > r->base_pfn + r->count);
+
+	mutex_lock(&cma_mutex);
+	bitmap_clear(r->bitmap, pfn - r->base_pfn, count);
+	r->used -= count;
+	free_contig_range(pfn, count);
+	mutex_unlock(&cma_mutex);
+
+	return true;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int cma_regions_show(struct seq_file *m, void *v)
+{
+	struct cma_region *r;
+	int i;
+
+	mutex_lock(&cma_mutex);
+	for (i = 0; i < cma_region_count; i++) {
+		r = cma_regions[i];
+		seq_printf(m, "%-8s %#08lx %6lu KiB %6lu KiB used%s  %s\n",
+			   r->name, (unsigned long)PFN_PHYS(r->base_pfn),
+			   r->count << (PAGE_SHIFT - 10),
+			   r->used << (PAGE_SHIFT - 10),
+			   r->bitmap ? "" : " (carve-out)",
+			   r->devs ? r->devs : "");
+	}
+	mutex_unlock(&cma_mutex);
+
+	return 0;
+}
+
+static int cma_regions_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cma_regions_show, NULL);
+}
+
+static const struct file_operations cma_regions_fops = {
+	.open		= cma_regions_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init cma_debugfs_init(void)
+{
+	if (cma_region_count)
+		debugfs_create_file("cma", S_IRUGO, NULL, NULL,
+				    &cma_regions_fops);
+	return 0;
+}
+late_initcall(cma_debugfs_init);
+#endif
@@ -22,6 +22,7 @@
 #include <linux/mutex.h>
 #include <linux/pm.h>
 #include <linux/pm_runtime.h>
+#include <linux/suspend.h>
 #include <linux/resume-trace.h>
 #include <linux/interrupt.h>
 #include <linux/sched.h>
@@ -464,6 +465,13 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
 	return error;
 }
 
+#ifdef CONFIG_SUSPEND
+void __attribute__ ((weak)) arch_device_resume_time(struct device *dev,
+						    s64 usecs)
+{
+}
+#endif
+
 /**
  * device_resume - Execute "resume" callbacks for given device.
  * @dev: Device to handle.
@@ -472,6 +480,7 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
 static int device_resume(struct device *dev, pm_message_t state)
 {
 	int error = 0;
+	ktime_t starttime = ktime_get();
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
@@ -511,6 +520,12 @@ static int device_resume(struct device *dev, pm_message_t state)
  End:
 	up(&dev->sem);
 
+#ifdef CONFIG_SUSPEND
+	if (state.event == PM_EVENT_RESUME)
+		arch_device_resume_time(dev,
+			ktime_to_us(ktime_sub(ktime_get(), starttime)));
+#endif
+
 	TRACE_RESUME(error);
 	return error;
 }
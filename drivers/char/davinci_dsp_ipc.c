@@ -0,0 +1,670 @@
+/*
+ * DA8xx ARM/DSP shared memory buffer exchange
+ *
+ * Buffers live in a carve-out of DDR that both cores map.  Only their
+ * descriptors move, through two single-producer/single-consumer rings
+ * in the carve-out's control page, and each side kicks the other with
+ * a SYSCFG CHIPSIG interrupt when it has queued or freed something.
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/miscdevice.h>
+#include <linux/interrupt.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/io.h>
+#include <linux/log2.h>
+#include <linux/genalloc.h>
+#include <linux/uaccess.h>
+#include <linux/davinci_dsp_ipc.h>
+#include <linux/davinci_zcbuf.h>
+
+#include <asm/system.h>
+
+#define DRIVER_NAME		"davinci-dsp-ipc"
+
+/* offsets in the CHIPSIG register resource */
+#define CHIPSIG			0x0
+#define CHIPSIG_CLR		0x4
+
+/* descriptors copied per batch in read() and write() */
+#define DSP_IPC_BATCH		16
+
+static unsigned int ring_entries = 64;
+module_param(ring_entries, uint, S_IRUGO);
+MODULE_PARM_DESC(ring_entries,
+	"Descriptors per direction, a power of two (default 64)");
+
+struct dsp_ipc {
+	struct device		*dev;
+	struct miscdevice	misc;
+	void __iomem		*chipsig;
+	void __iomem		*ctrl;
+	resource_size_t		phys;
+	resource_size_t		size;
+	u32			entries;
+	u32			buf_offset;
+	u32			arm_bit;
+	u32			dsp_bit;
+	int			irq;
+	unsigned long		in_use;
+	struct mutex		rd_lock;
+	struct mutex		wr_lock;
+	wait_queue_head_t	wait;
+
+	/* in-kernel client, see dsp_ipc_claim() */
+	void			(*rx)(void *data,
+				      const struct dsp_ipc_desc *desc);
+	void			*rx_data;
+	void __iomem		*bufs;
+	struct gen_pool		*pool;
+	spinlock_t		tx_lock;
+	struct tasklet_struct	rx_tasklet;
+};
+
+/* there is one DSP; in-kernel clients find its channel here */
+static struct dsp_ipc *dsp_ipc_dev;
+static DEFINE_MUTEX(dsp_ipc_dev_lock);
+
+/* buffers handed to in-kernel clients are aligned to this */
+#define DSP_IPC_POOL_ORDER	6
+
+#define CTRL_OFF(field)		offsetof(struct dsp_ipc_ctrl, field)
+
+static inline u32 ctrl_read(struct dsp_ipc *ipc, unsigned off)
+{
+	return __raw_readl(ipc->ctrl + off);
+}
+
+static inline void ctrl_write(struct dsp_ipc *ipc, unsigned off, u32 val)
+{
+	__raw_writel(val, ipc->ctrl + off);
+}
+
+static inline void __iomem *desc_addr(struct dsp_ipc *ipc, int to_arm,
+				      u32 idx)
+{
+	idx &= ipc->entries - 1;
+	if (to_arm)
+		idx += ipc->entries;
+	return ipc->ctrl + sizeof(struct dsp_ipc_ctrl) +
+		idx * sizeof(struct dsp_ipc_desc);
+}
+
+static void dsp_ipc_kick(struct dsp_ipc *ipc)
+{
+	/* descriptors and buffer contents must reach DDR first */
+	dsb();
+	__raw_writel(ipc->dsp_bit, ipc->chipsig + CHIPSIG);
+}
+
+static u32 dsp_ipc_to_dsp_space(struct dsp_ipc *ipc)
+{
+	return ipc->entries - (ctrl_read(ipc, CTRL_OFF(to_dsp.head)) -
+			       ctrl_read(ipc, CTRL_OFF(to_dsp.tail)));
+}
+
+static u32 dsp_ipc_to_arm_count(struct dsp_ipc *ipc)
+{
+	return ctrl_read(ipc, CTRL_OFF(to_arm.head)) -
+		ctrl_read(ipc, CTRL_OFF(to_arm.tail));
+}
+
+static irqreturn_t dsp_ipc_irq(int irq, void *data)
+{
+	struct dsp_ipc *ipc = data;
+
+	if (!(__raw_readl(ipc->chipsig + CHIPSIG) & ipc->arm_bit))
+		return IRQ_NONE;
+
+	__raw_writel(ipc->arm_bit, ipc->chipsig + CHIPSIG_CLR);
+	if (ipc->rx)
+		tasklet_schedule(&ipc->rx_tasklet);
+	else
+		wake_up_interruptible(&ipc->wait);
+	return IRQ_HANDLED;
+}
+
+static void dsp_ipc_rx_tasklet(unsigned long data)
+{
+	struct dsp_ipc *ipc = (struct dsp_ipc *)data;
+	struct dsp_ipc_desc desc;
+	u32 tail, avail;
+
+	while ((avail = dsp_ipc_to_arm_count(ipc))) {
+		rmb();
+		tail = ctrl_read(ipc, CTRL_OFF(to_arm.tail));
+		memcpy_fromio(&desc, desc_addr(ipc, 1, tail), sizeof(desc));
+		ctrl_write(ipc, CTRL_OFF(to_arm.tail), tail + 1);
+		if (avail == ipc->entries)
+			dsp_ipc_kick(ipc);
+		ipc->rx(ipc->rx_data, &desc);
+	}
+}
+
+/**
+ * dsp_ipc_claim - take the channel for an in-kernel client
+ * @rx: called in softirq context for each descriptor the DSP returns
+ * @data: passed to @rx
+ *
+ * Returns the channel, or an ERR_PTR() when there is none or /dev/dsp_ipc
+ * or another client has it.
+ */
+struct dsp_ipc *dsp_ipc_claim(void (*rx)(void *data,
+					 const struct dsp_ipc_desc *desc),
+			      void *data)
+{
+	struct dsp_ipc *ipc;
+	size_t len;
+	int ret;
+
+	mutex_lock(&dsp_ipc_dev_lock);
+	ipc = dsp_ipc_dev;
+	ret = -ENODEV;
+	if (!ipc)
+		goto out;
+	ret = -EBUSY;
+	if (test_and_set_bit(0, &ipc->in_use))
+		goto out;
+
+	len = ipc->size - ipc->buf_offset;
+	ret = -ENOMEM;
+	ipc->bufs = ioremap_wc(ipc->phys + ipc->buf_offset, len);
+	if (!ipc->bufs)
+		goto err_busy;
+	ipc->pool = gen_pool_create(DSP_IPC_POOL_ORDER, -1);
+	if (!ipc->pool)
+		goto err_unmap;
+	if (gen_pool_add(ipc->pool, (unsigned long __force)ipc->bufs,
+			 len, -1))
+		goto err_pool;
+
+	ipc->rx_data = data;
+	ipc->rx = rx;
+	ret = 0;
+	goto out;
+
+err_pool:
+	gen_pool_destroy(ipc->pool);
+err_unmap:
+	iounmap(ipc->bufs);
+err_busy:
+	clear_bit(0, &ipc->in_use);
+out:
+	mutex_unlock(&dsp_ipc_dev_lock);
+	return ret ? ERR_PTR(ret) : ipc;
+}
+EXPORT_SYMBOL_GPL(dsp_ipc_claim);
+
+/**
+ * dsp_ipc_unclaim - give the channel back
+ * @ipc: from dsp_ipc_claim()
+ *
+ * Every buffer must have been freed, so the DSP holds none of them.
+ */
+void dsp_ipc_unclaim(struct dsp_ipc *ipc)
+{
+	mutex_lock(&dsp_ipc_dev_lock);
+	ipc->rx = NULL;
+	tasklet_kill(&ipc->rx_tasklet);
+	gen_pool_destroy(ipc->pool);
+	iounmap(ipc->bufs);
+	clear_bit(0, &ipc->in_use);
+	mutex_unlock(&dsp_ipc_dev_lock);
+}
+EXPORT_SYMBOL_GPL(dsp_ipc_unclaim);
+
+/**
+ * dsp_ipc_dsp_ready - whether the DSP firmware serves the channel
+ * @ipc: from dsp_ipc_claim()
+ */
+bool dsp_ipc_dsp_ready(struct dsp_ipc *ipc)
+{
+	return ctrl_read(ipc, CTRL_OFF(dsp_ready)) != 0;
+}
+EXPORT_SYMBOL_GPL(dsp_ipc_dsp_ready);
+
+/**
+ * dsp_ipc_alloc - allocate a buffer in the buffer area
+ * @ipc: from dsp_ipc_claim()
+ * @len: size in bytes
+ * @offset: returns the buffer's offset, for its descriptor
+ *
+ * The mapping is write-combined, so the ARM can use the buffer as plain
+ * memory; reads are uncached and slow.  Callable from any context.
+ */
+void *dsp_ipc_alloc(struct dsp_ipc *ipc, size_t len, u32 *offset)
+{
+	unsigned long addr = gen_pool_alloc(ipc->pool, len);
+
+	if (!addr)
+		return NULL;
+	*offset = addr - (unsigned long __force)ipc->bufs;
+	return (void *)addr;
+}
+EXPORT_SYMBOL_GPL(dsp_ipc_alloc);
+
+void dsp_ipc_free(struct dsp_ipc *ipc, u32 offset, size_t len)
+{
+	gen_pool_free(ipc->pool, (unsigned long __force)ipc->bufs + offset,
+		      len);
+}
+EXPORT_SYMBOL_GPL(dsp_ipc_free);
+
+/**
+ * dsp_ipc_send - queue descriptors to the DSP
+ * @ipc: from dsp_ipc_claim()
+ * @desc: descriptors naming buffers from dsp_ipc_alloc()
+ * @n: how many
+ *
+ * Queues all @n or, returning -EBUSY, none when the ring lacks room.
+ * The DSP is kicked once.  Callable from any context.
+ */
+int dsp_ipc_send(struct dsp_ipc *ipc, const struct dsp_ipc_desc *desc,
+		 unsigned int n)
+{
+	unsigned long flags;
+	u32 head, i;
+	int ret = 0;
+
+	spin_lock_irqsave(&ipc->tx_lock, flags);
+	if (dsp_ipc_to_dsp_space(ipc) < n) {
+		ret = -EBUSY;
+		goto out;
+	}
+	head = ctrl_read(ipc, CTRL_OFF(to_dsp.head));
+	for (i = 0; i < n; i++)
+		memcpy_toio(desc_addr(ipc, 0, head + i), &desc[i],
+			    sizeof(*desc));
+	wmb();
+	ctrl_write(ipc, CTRL_OFF(to_dsp.head), head + n);
+	dsp_ipc_kick(ipc);
+out:
+	spin_unlock_irqrestore(&ipc->tx_lock, flags);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dsp_ipc_send);
+
+static int dsp_ipc_open(struct inode *inode, struct file *file)
+{
+	struct dsp_ipc *ipc = container_of(file->private_data,
+					   struct dsp_ipc, misc);
+
+	/* the rings have a single producer and consumer on this side */
+	if (test_and_set_bit(0, &ipc->in_use))
+		return -EBUSY;
+
+	file->private_data = ipc;
+	return 0;
+}
+
+static int dsp_ipc_release(struct inode *inode, struct file *file)
+{
+	struct dsp_ipc *ipc = file->private_data;
+
+	clear_bit(0, &ipc->in_use);
+	return 0;
+}
+
+static ssize_t dsp_ipc_read(struct file *file, char __user *buf,
+			    size_t count, loff_t *ppos)
+{
+	struct dsp_ipc *ipc = file->private_data;
+	struct dsp_ipc_desc desc[DSP_IPC_BATCH];
+	size_t want = count / sizeof(*desc);
+	size_t done = 0;
+	u32 tail, avail, n, i;
+	int ret;
+
+	if (!want)
+		return -EINVAL;
+
+	if (mutex_lock_interruptible(&ipc->rd_lock))
+		return -ERESTARTSYS;
+
+	while (!dsp_ipc_to_arm_count(ipc)) {
+		ret = -EAGAIN;
+		if (file->f_flags & O_NONBLOCK)
+			goto out;
+		ret = wait_event_interruptible(ipc->wait,
+					       dsp_ipc_to_arm_count(ipc));
+		if (ret)
+			goto out;
+	}
+
+	while (done < want) {
+		avail = dsp_ipc_to_arm_count(ipc);
+		if (!avail)
+			break;
+		/* head was read before the descriptors it covers */
+		rmb();
+
+		n = min_t(u32, min_t(size_t, want - done, DSP_IPC_BATCH),
+			  avail);
+		tail = ctrl_read(ipc, CTRL_OFF(to_arm.tail));
+		for (i = 0; i < n; i++)
+			memcpy_fromio(&desc[i], desc_addr(ipc, 1, tail + i),
+				      sizeof(*desc));
+		ctrl_write(ipc, CTRL_OFF(to_arm.tail), tail + n);
+
+		/* the DSP only waits for room when it found the ring full */
+		if (avail == ipc->entries)
+			dsp_ipc_kick(ipc);
+
+		if (copy_to_user(buf + done * sizeof(*desc), desc,
+				 n * sizeof(*desc))) {
+			ret = -EFAULT;
+			goto out;
+		}
+		done += n;
+	}
+	ret = 0;
+out:
+	mutex_unlock(&ipc->rd_lock);
+	return done ? done * sizeof(*desc) : ret;
+}
+
+static ssize_t dsp_ipc_write(struct file *file, const char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct dsp_ipc *ipc = file->private_data;
+	struct dsp_ipc_desc desc[DSP_IPC_BATCH];
+	u32 buf_size = ipc->size - ipc->buf_offset;
+	size_t want = count / sizeof(*desc);
+	size_t done = 0;
+	u32 head, space, n, i;
+	int ret;
+
+	if (!want)
+		return -EINVAL;
+
+	if (mutex_lock_interruptible(&ipc->wr_lock))
+		return -ERESTARTSYS;
+
+	while (!dsp_ipc_to_dsp_space(ipc)) {
+		ret = -EAGAIN;
+		if (file->f_flags & O_NONBLOCK)
+			goto out;
+		ret = wait_event_interruptible(ipc->wait,
+					       dsp_ipc_to_dsp_space(ipc));
+		if (ret)
+			goto out;
+	}
+
+	while (done < want) {
+		space = dsp_ipc_to_dsp_space(ipc);
+		if (!space)
+			break;
+
+		n = min_t(u32, min_t(size_t, want - done, DSP_IPC_BATCH),
+			  space);
+		if (copy_from_user(desc, buf + done * sizeof(*desc),
+				   n * sizeof(*desc))) {
+			ret = -EFAULT;
+			goto out;
+		}
+		for (i = 0; i < n; i++) {
+			if (desc[i].flags & DSP_IPC_F_PHYS) {
+				ret = zcbuf_check_phys(desc[i].offset,
+						       desc[i].len);
+				if (ret)
+					goto out;
+			} else if (desc[i].offset > buf_size ||
+				   desc[i].len > buf_size - desc[i].offset) {
+				ret = -EINVAL;
+				goto out;
+			}
+		}
+
+		head = ctrl_read(ipc, CTRL_OFF(to_dsp.head));
+		for (i = 0; i < n; i++)
+			memcpy_toio(desc_addr(ipc, 0, head + i), &desc[i],
+				    sizeof(*desc));
+		/* descriptors before the head that publishes them */
+		wmb();
+		ctrl_write(ipc, CTRL_OFF(to_dsp.head), head + n);
+		done += n;
+	}
+	ret = 0;
+out:
+	/* one kick covers every batch queued by this call */
+	if (done)
+		dsp_ipc_kick(ipc);
+	mutex_unlock(&ipc->wr_lock);
+	return done ? done * sizeof(*desc) : ret;
+}
+
+static unsigned int dsp_ipc_poll(struct file *file, poll_table *wait)
+{
+	struct dsp_ipc *ipc = file->private_data;
+	unsigned int mask = 0;
+
+	poll_wait(file, &ipc->wait, wait);
+
+	if (dsp_ipc_to_arm_count(ipc))
+		mask |= POLLIN | POLLRDNORM;
+	if (dsp_ipc_to_dsp_space(ipc))
+		mask |= POLLOUT | POLLWRNORM;
+	return mask;
+}
+
+static int dsp_ipc_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct dsp_ipc *ipc = file->private_data;
+	unsigned long len = vma->vm_end - vma->vm_start;
+	unsigned long off = vma->vm_pgoff << PAGE_SHIFT;
+	unsigned long buf_size = ipc->size - ipc->buf_offset;
+	unsigned long pfn = (ipc->phys + ipc->buf_offset + off) >> PAGE_SHIFT;
+
+	if (off >= buf_size || len > buf_size - off)
+		return -EINVAL;
+
+	/*
+	 * Write-combined, not cached: the DSP does not snoop the ARM
+	 * cache, and the dsb() before each kick drains the write buffer.
+	 */
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+	vma->vm_flags |= VM_IO | VM_RESERVED;
+
+	return remap_pfn_range(vma, vma->vm_start, pfn, len,
+			       vma->vm_page_prot);
+}
+
+static long dsp_ipc_ioctl(struct file *file, unsigned int cmd,
+			  unsigned long arg)
+{
+	struct dsp_ipc *ipc = file->private_data;
+	struct dsp_ipc_info info;
+
+	switch (cmd) {
+	case DSP_IPC_GET_INFO:
+		info.phys = ipc->phys + ipc->buf_offset;
+		info.size = ipc->size - ipc->buf_offset;
+		info.entries = ipc->entries;
+		info.dsp_ready = ctrl_read(ipc, CTRL_OFF(dsp_ready));
+		if (copy_to_user((void __user *)arg, &info, sizeof(info)))
+			return -EFAULT;
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations dsp_ipc_fops = {
+	.owner		= THIS_MODULE,
+	.open		= dsp_ipc_open,
+	.release	= dsp_ipc_release,
+	.read		= dsp_ipc_read,
+	.write		= dsp_ipc_write,
+	.poll		= dsp_ipc_poll,
+	.mmap		= dsp_ipc_mmap,
+	.unlocked_ioctl	= dsp_ipc_ioctl,
+};
+
+static void dsp_ipc_init_ctrl(struct dsp_ipc *ipc)
+{
+	/* everything but the magic first, so a polling DSP sees it last */
+	ctrl_write(ipc, CTRL_OFF(magic), 0);
+	ctrl_write(ipc, CTRL_OFF(entries), ipc->entries);
+	ctrl_write(ipc, CTRL_OFF(buf_offset), ipc->buf_offset);
+	ctrl_write(ipc, CTRL_OFF(dsp_ready), 0);
+	ctrl_write(ipc, CTRL_OFF(to_dsp.head), 0);
+	ctrl_write(ipc, CTRL_OFF(to_dsp.tail), 0);
+	ctrl_write(ipc, CTRL_OFF(to_arm.head), 0);
+	ctrl_write(ipc, CTRL_OFF(to_arm.tail), 0);
+	wmb();
+	ctrl_write(ipc, CTRL_OFF(magic), DSP_IPC_CTRL_MAGIC);
+}
+
+static int __devinit dsp_ipc_probe(struct platform_device *pdev)
+{
+	struct davinci_dsp_ipc_platform_data *pdata = pdev->dev.platform_data;
+	struct resource *mem, *sig;
+	struct dsp_ipc *ipc;
+	int ret;
+
+	mem = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	sig = platform_get_resource(pdev, IORESOURCE_MEM, 1);
+	if (!pdata || !mem || !sig) {
+		dev_err(&pdev->dev, "missing platform data or resources\n");
+		return -ENODEV;
+	}
+
+	if (!is_power_of_2(ring_entries)) {
+		dev_err(&pdev->dev, "ring_entries must be a power of two\n");
+		return -EINVAL;
+	}
+
+	ipc = kzalloc(sizeof(*ipc), GFP_KERNEL);
+	if (!ipc)
+		return -ENOMEM;
+
+	ipc->dev = &pdev->dev;
+	ipc->phys = mem->start;
+	ipc->size = resource_size(mem);
+	ipc->entries = ring_entries;
+	ipc->buf_offset = PAGE_ALIGN(sizeof(struct dsp_ipc_ctrl) +
+			2 * ring_entries * sizeof(struct dsp_ipc_desc));
+	ipc->arm_bit = BIT(pdata->arm_sig);
+	ipc->dsp_bit = BIT(pdata->dsp_sig);
+	mutex_init(&ipc->rd_lock);
+	mutex_init(&ipc->wr_lock);
+	init_waitqueue_head(&ipc->wait);
+	spin_lock_init(&ipc->tx_lock);
+	tasklet_init(&ipc->rx_tasklet, dsp_ipc_rx_tasklet, (unsigned long)ipc);
+
+	if (ipc->buf_offset >= ipc->size) {
+		dev_err(&pdev->dev, "carve-out too small for the rings\n");
+		ret = -EINVAL;
+		goto err_free;
+	}
+
+	/* fails if the carve-out was not taken away from the kernel */
+	if (!request_mem_region(mem->start, ipc->size, DRIVER_NAME)) {
+		dev_err(&pdev->dev, "carve-out %08x busy\n", mem->start);
+		ret = -EBUSY;
+		goto err_free;
+	}
+
+	ipc->ctrl = ioremap_nocache(ipc->phys, ipc->buf_offset);
+	ipc->chipsig = ioremap(sig->start, resource_size(sig));
+	if (!ipc->ctrl || !ipc->chipsig) {
+		ret = -ENOMEM;
+		goto err_unmap;
+	}
+
+	dsp_ipc_init_ctrl(ipc);
+	__raw_writel(ipc->arm_bit, ipc->chipsig + CHIPSIG_CLR);
+
+	ipc->irq = platform_get_irq(pdev, 0);
+	ret = request_irq(ipc->irq, dsp_ipc_irq, 0, DRIVER_NAME, ipc);
+	if (ret)
+		goto err_unmap;
+
+	ipc->misc.minor = MISC_DYNAMIC_MINOR;
+	ipc->misc.name = "dsp_ipc";
+	ipc->misc.fops = &dsp_ipc_fops;
+	ipc->misc.parent = &pdev->dev;
+	ret = misc_register(&ipc->misc);
+	if (ret)
+		goto err_irq;
+
+	platform_set_drvdata(pdev, ipc);
+	mutex_lock(&dsp_ipc_dev_lock);
+	dsp_ipc_dev = ipc;
+	mutex_unlock(&dsp_ipc_dev_lock);
+	dev_info(&pdev->dev, "%u KiB at %08x, %u descriptors per ring\n",
+		 (ipc->size - ipc->buf_offset) >> 10,
+		 ipc->phys + ipc->buf_offset, ipc->entries);
+	return 0;
+
+err_irq:
+	free_irq(ipc->irq, ipc);
+err_unmap:
+	if (ipc->chipsig)
+		iounmap(ipc->chipsig);
+	if (ipc->ctrl)
+		iounmap(ipc->ctrl);
+	release_mem_region(mem->start, ipc->size);
+err_free:
+	kfree(ipc);
+	return ret;
+}
+
+static int __devexit dsp_ipc_remove(struct platform_device *pdev)
+{
+	struct dsp_ipc *ipc = platform_get_drvdata(pdev);
+
+	/* clients hold a module reference, so none is left here */
+	mutex_lock(&dsp_ipc_dev_lock);
+	dsp_ipc_dev = NULL;
+	mutex_unlock(&dsp_ipc_dev_lock);
+	misc_deregister(&ipc->misc);
+	free_irq(ipc->irq, ipc);
+	/* tell the DSP the channel is gone */
+	ctrl_write(ipc, CTRL_OFF(magic), 0);
+	iounmap(ipc->chipsig);
+	iounmap(ipc->ctrl);
+	release_mem_region(ipc->phys, ipc->size);
+	kfree(ipc);
+	return 0;
+}
+
+static struct platform_driver dsp_ipc_driver = {
+	.probe		= dsp_ipc_probe,
+	.remove		= __devexit_p(dsp_ipc_remove),
+	.driver		= {
+		.name	= DRIVER_NAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init dsp_ipc_init(void)
+{
+	return platform_driver_register(&dsp_ipc_driver);
+}
+module_init(dsp_ipc_init);
+
+static void __exit dsp_ipc_exit(void)
+{
+	platform_driver_unregister(&dsp_ipc_driver);
+}
+module_exit(dsp_ipc_exit);
+
+MODULE_DESCRIPTION("DA8xx ARM/DSP shared memory buffer exchange");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:" DRIVER_NAME);
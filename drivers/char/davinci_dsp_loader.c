@@ -0,0 +1,641 @@
+/*
+ * DA850 DSP image loader
+ *
+ * Loads TI C6000 ELF or COFF images with request_firmware() into the
+ * C674x DSP's memories and releases the DSP from local reset at the
+ * image's entry point, which HOST1CFG needs 1 KiB aligned.  Segments go
+ * in by EDMA from DMA-mapped copies that are kept afterwards, so going
+ * back to an image already loaded once is a stop, an EDMA copy and a
+ * start, without the filesystem or the parser.
+ *
+ * Through sysfs on the platform device:
+ *
+ *	firmware	write a firmware file name to stop the DSP, load that
+ *			image and start it; reads back the running image
+ *	state		"off", "stopped" or "running"; write "off" (reset and
+ *			powered down), "stop" (held in reset) or "start"
+ *	drop_cache	write anything to forget every image but the running
+ *			one
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/firmware.h>
+#include <linux/dma-mapping.h>
+#include <linux/elf.h>
+#include <linux/gfp.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/io.h>
+
+#include <asm/sizes.h>
+
+#include <mach/da8xx.h>
+#include <mach/psc.h>
+#include <mach/edma.h>
+
+#define DRIVER_NAME		"davinci-dsp-loader"
+
+#define DSP_EM_TI_C6000		140
+
+/* cached segments are split into pieces no larger than this */
+#define DSP_SEG_CHUNK		SZ_1M
+/* EDMA line length, within the signed 16 bit line pitch */
+#define DSP_COPY_LINE		SZ_16K
+#define DSP_COPY_MAX_LINES	1024
+
+#define DSP_BOOT_ALIGN		SZ_1K
+
+/* SYSCFG KICKnR values that unlock HOST1CFG and friends */
+#define KICK0_UNLOCK		0x83e70b13
+#define KICK1_UNLOCK		0x95a4f1e0
+
+/* TI COFF version 2 */
+#define COFF_VERSION_2		0x00c2
+#define COFF_TARGET_C6000	0x0099
+#define STYP_DSECT		0x0001
+#define STYP_NOLOAD		0x0002
+#define STYP_COPY		0x0010
+#define STYP_BSS		0x0080
+
+struct coff_filehdr {
+	__le16	version;
+	__le16	nscns;
+	__le32	timdat;
+	__le32	symptr;
+	__le32	nsyms;
+	__le16	opthdr;
+	__le16	flags;
+	__le16	target;
+} __attribute__((packed));
+
+struct coff_opthdr {
+	__le16	magic;
+	__le16	vstamp;
+	__le32	tsize;
+	__le32	dsize;
+	__le32	bsize;
+	__le32	entry;
+	__le32	text_start;
+	__le32	data_start;
+} __attribute__((packed));
+
+struct coff_scnhdr {
+	char	name[8];
+	__le32	paddr;
+	__le32	vaddr;
+	__le32	size;
+	__le32	scnptr;
+	__le32	relptr;
+	__le32	lnnoptr;
+	__le32	nreloc;
+	__le32	nlnno;
+	__le32	flags;
+	__le16	reserved;
+	__le16	page;
+} __attribute__((packed));
+
+static unsigned int cache_kb = 8192;
+module_param(cache_kb, uint, 0644);
+MODULE_PARM_DESC(cache_kb,
+	"KiB of loaded images kept for fast reloads (default 8192)");
+
+struct dsp_seg {
+	u32		da;	/* global DSP address */
+	u32		len;
+	void		*cpu;
+	dma_addr_t	dma;
+};
+
+struct dsp_image {
+	struct list_head	node;
+	char			name[64];
+	u32			entry;
+	size_t			bytes;
+	unsigned int		nseg;
+	struct dsp_seg		*seg;
+};
+
+enum dsp_state { DSP_OFF, DSP_STOPPED, DSP_RUNNING };
+
+static const char *dsp_state_name[] = {
+	[DSP_OFF]	= "off",
+	[DSP_STOPPED]	= "stopped",
+	[DSP_RUNNING]	= "running",
+};
+
+struct dsp_loader {
+	struct device		*dev;
+	void __iomem		*syscfg;
+	struct resource		*win;	/* memories images may load into */
+	unsigned int		nwin;
+	struct mutex		lock;
+	struct list_head	images;	/* most recently loaded first */
+	size_t			cached;
+	struct dsp_image	*running;
+	enum dsp_state		state;
+};
+
+/* The DSP's own view of L2 and L1 aliases the global addresses */
+static u32 dsp_global_addr(u32 da)
+{
+	if (da >= 0x00800000 && da < 0x01000000)
+		return da + 0x11000000;
+	return da;
+}
+
+static bool dsp_loader_addr_ok(struct dsp_loader *dl, u32 da, u32 len)
+{
+	unsigned int i;
+
+	for (i = 0; i < dl->nwin; i++)
+		if (da >= dl->win[i].start &&
+		    len <= dl->win[i].end - da + 1)
+			return true;
+	return false;
+}
+
+static void dsp_image_free(struct dsp_loader *dl, struct dsp_image *img)
+{
+	unsigned int i;
+
+	for (i = 0; i < img->nseg; i++) {
+		dma_unmap_single(dl->dev, img->seg[i].dma, img->seg[i].len,
+				 DMA_TO_DEVICE);
+		free_pages_exact(img->seg[i].cpu, img->seg[i].len);
+	}
+	kfree(img->seg);
+	kfree(img);
+}
+
+/* Adds @memsz bytes at @da, the first @filesz of them from @data */
+static int dsp_image_add(struct dsp_loader *dl, struct dsp_image *img,
+			 u32 da, const u8 *data, u32 filesz, u32 memsz)
+{
+	struct dsp_seg *seg;
+	u32 len, n;
+
+	da = dsp_global_addr(da);
+	if (!dsp_loader_addr_ok(dl, da, memsz)) {
+		dev_err(dl->dev, "%s: %u bytes at %08x outside DSP memory\n",
+			img->name, memsz, da);
+		return -EINVAL;
+	}
+
+	while (memsz) {
+		len = min_t(u32, memsz, DSP_SEG_CHUNK);
+		seg = krealloc(img->seg, (img->nseg + 1) * sizeof(*seg),
+			       GFP_KERNEL);
+		if (!seg)
+			return -ENOMEM;
+		img->seg = seg;
+		seg += img->nseg;
+
+		seg->cpu = alloc_pages_exact(len, GFP_KERNEL);
+		if (!seg->cpu)
+			return -ENOMEM;
+		n = min(len, filesz);
+		memcpy(seg->cpu, data, n);
+		memset(seg->cpu + n, 0, len - n);
+		seg->dma = dma_map_single(dl->dev, seg->cpu, len,
+					  DMA_TO_DEVICE);
+		seg->da = da;
+		seg->len = len;
+		img->nseg++;
+		img->bytes += len;
+
+		da += len;
+		data += n;
+		filesz -= n;
+		memsz -= len;
+	}
+	return 0;
+}
+
+static int dsp_parse_elf(struct dsp_loader *dl, struct dsp_image *img,
+			 const struct firmware *fw)
+{
+	const struct elf32_hdr *eh = (const void *)fw->data;
+	const struct elf32_phdr *ph;
+	unsigned int i;
+	int ret;
+
+	if (fw->size < sizeof(*eh) || eh->e_ident[EI_CLASS] != ELFCLASS32 ||
+	    eh->e_ident[EI_DATA] != ELFDATA2LSB ||
+	    eh->e_machine != DSP_EM_TI_C6000 ||
+	    eh->e_phentsize != sizeof(*ph) || eh->e_phoff > fw->size ||
+	    eh->e_phnum > (fw->size - eh->e_phoff) / sizeof(*ph))
+		return -EINVAL;
+
+	ph = (const void *)(fw->data + eh->e_phoff);
+	for (i = 0; i < eh->e_phnum; i++, ph++) {
+		if (ph->p_type != PT_LOAD || !ph->p_memsz)
+			continue;
+		if (ph->p_offset > fw->size || ph->p_filesz > ph->p_memsz ||
+		    ph->p_filesz > fw->size - ph->p_offset)
+			return -EINVAL;
+		ret = dsp_image_add(dl, img, ph->p_paddr,
+				    fw->data + ph->p_offset,
+				    ph->p_filesz, ph->p_memsz);
+		if (ret)
+			return ret;
+	}
+	img->entry = eh->e_entry;
+	return 0;
+}
+
+static int dsp_parse_coff(struct dsp_loader *dl, struct dsp_image *img,
+			  const struct firmware *fw)
+{
+	const struct coff_filehdr *fh = (const void *)fw->data;
+	const struct coff_opthdr *oh;
+	const struct coff_scnhdr *sh;
+	unsigned int i, nscns;
+	size_t off;
+	int ret;
+
+	if (fw->size < sizeof(*fh) + sizeof(*oh) ||
+	    le16_to_cpu(fh->version) != COFF_VERSION_2 ||
+	    le16_to_cpu(fh->target) != COFF_TARGET_C6000 ||
+	    le16_to_cpu(fh->opthdr) < sizeof(*oh))
+		return -EINVAL;
+
+	oh = (const void *)(fh + 1);
+	off = sizeof(*fh) + le16_to_cpu(fh->opthdr);
+	nscns = le16_to_cpu(fh->nscns);
+	if (off > fw->size || nscns > (fw->size - off) / sizeof(*sh))
+		return -EINVAL;
+
+	sh = (const void *)(fw->data + off);
+	for (i = 0; i < nscns; i++, sh++) {
+		u32 flags = le32_to_cpu(sh->flags);
+		u32 size = le32_to_cpu(sh->size);
+		u32 scnptr = le32_to_cpu(sh->scnptr);
+		u32 filesz = size;
+
+		if (!size || (flags & (STYP_DSECT | STYP_NOLOAD | STYP_COPY)))
+			continue;
+		/* uninitialized sections are zeroed */
+		if ((flags & STYP_BSS) || !scnptr)
+			filesz = 0;
+		else if (scnptr > fw->size || size > fw->size - scnptr)
+			return -EINVAL;
+		ret = dsp_image_add(dl, img, le32_to_cpu(sh->paddr),
+				    fw->data + scnptr, filesz, size);
+		if (ret)
+			return ret;
+	}
+	img->entry = le32_to_cpu(oh->entry);
+	return 0;
+}
+
+static struct dsp_image *dsp_image_read(struct dsp_loader *dl,
+					const char *name)
+{
+	const struct firmware *fw;
+	struct dsp_image *img;
+	int ret;
+
+	img = kzalloc(sizeof(*img), GFP_KERNEL);
+	if (!img)
+		return ERR_PTR(-ENOMEM);
+	strlcpy(img->name, name, sizeof(img->name));
+
+	ret = request_firmware(&fw, name, dl->dev);
+	if (ret)
+		goto err;
+
+	if (fw->size >= SELFMAG && !memcmp(fw->data, ELFMAG, SELFMAG))
+		ret = dsp_parse_elf(dl, img, fw);
+	else
+		ret = dsp_parse_coff(dl, img, fw);
+	release_firmware(fw);
+	if (ret)
+		goto err;
+
+	if (img->entry & (DSP_BOOT_ALIGN - 1)) {
+		dev_err(dl->dev, "%s: entry point %08x not 1 KiB aligned\n",
+			name, img->entry);
+		ret = -EINVAL;
+		goto err;
+	}
+	return img;
+err:
+	dsp_image_free(dl, img);
+	return ERR_PTR(ret);
+}
+
+/* Keeps cache_kb of the images loaded last, and the running one */
+static void dsp_image_trim(struct dsp_loader *dl)
+{
+	struct dsp_image *img, *tmp;
+
+	list_for_each_entry_safe_reverse(img, tmp, &dl->images, node) {
+		if (dl->cached <= (size_t)cache_kb << 10)
+			break;
+		if (img == dl->running)
+			continue;
+		list_del(&img->node);
+		dl->cached -= img->bytes;
+		dsp_image_free(dl, img);
+	}
+}
+
+static int dsp_loader_copy(struct dsp_loader *dl, const struct dsp_seg *seg)
+{
+	void __iomem *p;
+	u32 done = 0;
+
+	while (done < seg->len) {
+		u32 width = min_t(u32, seg->len - done, DSP_COPY_LINE);
+		u32 lines = min_t(u32, (seg->len - done) / width,
+				  DSP_COPY_MAX_LINES);
+
+		if (edma_copy_2d(seg->da + done, width, seg->dma + done, width,
+				 width, lines))
+			break;
+		done += width * lines;
+	}
+	if (done == seg->len)
+		return 0;
+
+	/* no EDMA copy engine: the CPU does the rest */
+	p = ioremap(seg->da + done, seg->len - done);
+	if (!p)
+		return -ENOMEM;
+	memcpy_toio(p, seg->cpu + done, seg->len - done);
+	iounmap(p);
+	return 0;
+}
+
+/* Holds the DSP in local reset, clocked so its memories can be loaded */
+static void dsp_loader_stop(struct dsp_loader *dl)
+{
+	davinci_psc_local_reset(0, DA8XX_LPSC0_GEM, true);
+	if (dl->state == DSP_OFF)
+		davinci_psc_config(DAVINCI_GPSC_DSPDOMAIN, 0, DA8XX_LPSC0_GEM,
+				   1);
+	dl->state = DSP_STOPPED;
+}
+
+static void dsp_loader_off(struct dsp_loader *dl)
+{
+	davinci_psc_local_reset(0, DA8XX_LPSC0_GEM, true);
+	davinci_psc_config(DAVINCI_GPSC_DSPDOMAIN, 0, DA8XX_LPSC0_GEM, 0);
+	dl->state = DSP_OFF;
+}
+
+static void dsp_loader_start(struct dsp_loader *dl, u32 entry)
+{
+	if (dl->state == DSP_OFF)
+		dsp_loader_stop(dl);
+
+	/* left unlocked, as the boot loader leaves them */
+	__raw_writel(KICK0_UNLOCK, dl->syscfg + DA8XX_KICK0_REG);
+	__raw_writel(KICK1_UNLOCK, dl->syscfg + DA8XX_KICK1_REG);
+	__raw_writel(entry, dl->syscfg + DA8XX_HOST1CFG_REG);
+
+	davinci_psc_local_reset(0, DA8XX_LPSC0_GEM, false);
+	dl->state = DSP_RUNNING;
+}
+
+static int dsp_loader_load(struct dsp_loader *dl, const char *name)
+{
+	struct dsp_image *img;
+	bool cached = false;
+	ktime_t start;
+	unsigned int i;
+	int ret;
+
+	list_for_each_entry(img, &dl->images, node) {
+		if (!strcmp(img->name, name)) {
+			list_move(&img->node, &dl->images);
+			cached = true;
+			break;
+		}
+	}
+	if (!cached) {
+		img = dsp_image_read(dl, name);
+		if (IS_ERR(img))
+			return PTR_ERR(img);
+		list_add(&img->node, &dl->images);
+		dl->cached += img->bytes;
+	}
+
+	start = ktime_get();
+	dsp_loader_stop(dl);
+	dl->running = NULL;
+	for (i = 0; i < img->nseg; i++) {
+		ret = dsp_loader_copy(dl, &img->seg[i]);
+		if (ret)
+			return ret;
+	}
+	dsp_loader_start(dl, img->entry);
+	dl->running = img;
+
+	dev_info(dl->dev, "%s: %zu KiB loaded%s in %lld us, started at %08x\n",
+		 img->name, img->bytes >> 10, cached ? " from cache" : "",
+		 (long long)ktime_to_us(ktime_sub(ktime_get(), start)),
+		 img->entry);
+
+	dsp_image_trim(dl);
+	return 0;
+}
+
+static ssize_t firmware_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct dsp_loader *dl = dev_get_drvdata(dev);
+	ssize_t len;
+
+	mutex_lock(&dl->lock);
+	len = sprintf(buf, "%s\n", dl->running ? dl->running->name : "");
+	mutex_unlock(&dl->lock);
+	return len;
+}
+
+static ssize_t firmware_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct dsp_loader *dl = dev_get_drvdata(dev);
+	char name[64];
+	int ret;
+
+	if (!count || count >= sizeof(name))
+		return -EINVAL;
+	memcpy(name, buf, count);
+	name[count] = '\0';
+	strim(name);
+	if (!name[0])
+		return -EINVAL;
+
+	mutex_lock(&dl->lock);
+	ret = dsp_loader_load(dl, name);
+	mutex_unlock(&dl->lock);
+	return ret ? ret : count;
+}
+
+static ssize_t state_show(struct device *dev,
+			  struct device_attribute *attr, char *buf)
+{
+	struct dsp_loader *dl = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%s\n", dsp_state_name[dl->state]);
+}
+
+static ssize_t state_store(struct device *dev,
+			   struct device_attribute *attr,
+			   const char *buf, size_t count)
+{
+	struct dsp_loader *dl = dev_get_drvdata(dev);
+	int ret = 0;
+
+	mutex_lock(&dl->lock);
+	if (sysfs_streq(buf, "off")) {
+		dsp_loader_off(dl);
+	} else if (sysfs_streq(buf, "stop")) {
+		dsp_loader_stop(dl);
+	} else if (sysfs_streq(buf, "start")) {
+		/* the DSP's memories are lost while it is off */
+		if (dl->running && dl->state != DSP_OFF)
+			dsp_loader_start(dl, dl->running->entry);
+		else
+			ret = -EINVAL;
+	} else {
+		ret = -EINVAL;
+	}
+	if (dl->state == DSP_OFF)
+		dl->running = NULL;
+	mutex_unlock(&dl->lock);
+	return ret ? ret : count;
+}
+
+static ssize_t drop_cache_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct dsp_loader *dl = dev_get_drvdata(dev);
+	struct dsp_image *img, *tmp;
+
+	mutex_lock(&dl->lock);
+	list_for_each_entry_safe(img, tmp, &dl->images, node) {
+		if (img == dl->running)
+			continue;
+		list_del(&img->node);
+		dl->cached -= img->bytes;
+		dsp_image_free(dl, img);
+	}
+	mutex_unlock(&dl->lock);
+	return count;
+}
+
+static DEVICE_ATTR(firmware, S_IRUGO | S_IWUSR, firmware_show,
+		   firmware_store);
+static DEVICE_ATTR(state, S_IRUGO | S_IWUSR, state_show, state_store);
+static DEVICE_ATTR(drop_cache, S_IWUSR, NULL, drop_cache_store);
+
+static struct attribute *dsp_loader_attrs[] = {
+	&dev_attr_firmware.attr,
+	&dev_attr_state.attr,
+	&dev_attr_drop_cache.attr,
+	NULL,
+};
+
+static const struct attribute_group dsp_loader_attr_group = {
+	.attrs	= dsp_loader_attrs,
+};
+
+static int __devinit dsp_loader_probe(struct platform_device *pdev)
+{
+	struct resource *regs;
+	struct dsp_loader *dl;
+	int ret;
+
+	regs = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	if (!regs || pdev->num_resources < 2) {
+		dev_err(&pdev->dev, "missing resources\n");
+		return -ENODEV;
+	}
+
+	dl = kzalloc(sizeof(*dl), GFP_KERNEL);
+	if (!dl)
+		return -ENOMEM;
+
+	dl->dev = &pdev->dev;
+	dl->win = &pdev->resource[1];
+	dl->nwin = pdev->num_resources - 1;
+	mutex_init(&dl->lock);
+	INIT_LIST_HEAD(&dl->images);
+
+	/* SYSCFG0 is shared with pinmux and others, so no region request */
+	dl->syscfg = ioremap(regs->start, resource_size(regs));
+	if (!dl->syscfg) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+
+	/* the boot loader may have started the DSP with an unknown image */
+	dl->state = davinci_psc_is_clk_active(0, DA8XX_LPSC0_GEM) ?
+			DSP_RUNNING : DSP_OFF;
+
+	platform_set_drvdata(pdev, dl);
+	ret = sysfs_create_group(&pdev->dev.kobj, &dsp_loader_attr_group);
+	if (ret)
+		goto err_unmap;
+	return 0;
+
+err_unmap:
+	iounmap(dl->syscfg);
+err_free:
+	kfree(dl);
+	return ret;
+}
+
+static int __devexit dsp_loader_remove(struct platform_device *pdev)
+{
+	struct dsp_loader *dl = platform_get_drvdata(pdev);
+	struct dsp_image *img, *tmp;
+
+	/* the DSP keeps running whatever it runs */
+	sysfs_remove_group(&pdev->dev.kobj, &dsp_loader_attr_group);
+	list_for_each_entry_safe(img, tmp, &dl->images, node)
+		dsp_image_free(dl, img);
+	iounmap(dl->syscfg);
+	kfree(dl);
+	return 0;
+}
+
+static struct platform_driver dsp_loader_driver = {
+	.probe		= dsp_loader_probe,
+	.remove		= __devexit_p(dsp_loader_remove),
+	.driver		= {
+		.name	= DRIVER_NAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init dsp_loader_init(void)
+{
+	return platform_driver_register(&dsp_loader_driver);
+}
+module_init(dsp_loader_init);
+
+static void __exit dsp_loader_exit(void)
+{
+	platform_driver_unregister(&dsp_loader_driver);
+}
+module_exit(dsp_loader_exit);
+
+MODULE_DESCRIPTION("DA850 DSP image loader");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:" DRIVER_NAME);
@@ -0,0 +1,393 @@
+/*
+ * DA850 eCAP edge timestamping for PPS and event timing
+ *
+ * The eCAP runs in capture mode with its 32-bit counter free running on
+ * the module clock, latching it into CAP1 on the rising edge and CAP2 on
+ * the falling edge of its pin.  The interrupt handler reads the counter
+ * around a CLOCK_REALTIME sample and subtracts the counter's age of the
+ * latch, so the timestamp reflects the edge itself and interrupt latency
+ * drops out; what remains is one module clock plus the clocksource
+ * resolution.
+ *
+ * Edges go to a PPS source and to /dev/ecap_capN, see
+ * <linux/davinci_ecap_capture.h>.
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/miscdevice.h>
+#include <linux/interrupt.h>
+#include <linux/clk.h>
+#include <linux/err.h>
+#include <linux/fs.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/spinlock.h>
+#include <linux/slab.h>
+#include <linux/io.h>
+#include <linux/time.h>
+#include <linux/math64.h>
+#include <linux/uaccess.h>
+#include <linux/pps_kernel.h>
+#include <linux/davinci_ecap_capture.h>
+
+#define DRIVER_NAME		"ecap_capture"
+
+#define ECAP_TSCTR		0x00
+#define ECAP_CAP1		0x08
+#define ECAP_CAP2		0x0c
+#define ECAP_ECCTL1		0x28
+#define ECAP_ECCTL2		0x2a
+#define ECAP_ECEINT		0x2c
+#define ECAP_ECFLG		0x2e
+#define ECAP_ECCLR		0x30
+
+#define ECCTL1_CAP2POL		BIT(2)		/* event 2 on the falling edge */
+#define ECCTL1_CAPLDEN		BIT(8)
+#define ECCTL1_FREE		(0x3 << 14)	/* keep counting on emu halt */
+
+#define ECCTL2_WRAP_EVT2	(0x1 << 1)	/* CAP1, CAP2, CAP1, ... */
+#define ECCTL2_REARM		BIT(3)
+#define ECCTL2_TSCTRSTOP	BIT(4)		/* counter runs */
+#define ECCTL2_SYNCO_DIS	(0x3 << 6)
+
+#define ECAP_INT		BIT(0)
+#define ECAP_CEVT1		BIT(1)
+#define ECAP_CEVT2		BIT(2)
+
+#define ECAP_CAP_EVENTS		64		/* power of 2 */
+
+struct ecap_cap {
+	struct device		*dev;
+	struct miscdevice	misc;
+	char			name[16];
+	void __iomem		*base;
+	struct resource		*mem;
+	struct clk		*clk;
+	int			irq;
+	bool			invert;
+	int			pps;
+	unsigned long		in_use;
+
+	spinlock_t		lock;
+	struct ecap_event	ev[ECAP_CAP_EVENTS];
+	u32			head;
+	u32			tail;
+	u32			seq;
+	wait_queue_head_t	wait;
+};
+
+/* Record one latched edge; @ctr is the counter's value at @now. */
+static void ecap_cap_event(struct ecap_cap *ec, struct timespec *now,
+			   u32 ctr, u32 cap, bool assert)
+{
+	struct pps_ktime pts;
+	struct ecap_event *ev;
+	struct timespec ts;
+	u64 age_ns;
+
+	age_ns = div_u64((u64)(ctr - cap) * NSEC_PER_SEC,
+			 clk_get_rate(ec->clk));
+	ts = ns_to_timespec(timespec_to_ns(now) - (s64)age_ns);
+
+	pts.sec = ts.tv_sec;
+	pts.nsec = ts.tv_nsec;
+	pts.flags = 0;
+	pps_event(ec->pps, &pts,
+		  assert ? PPS_CAPTUREASSERT : PPS_CAPTURECLEAR, NULL);
+
+	spin_lock(&ec->lock);
+	if (ec->head - ec->tail == ECAP_CAP_EVENTS) {
+		ec->tail++;
+		ec->ev[ec->tail % ECAP_CAP_EVENTS].flags |= ECAP_EVENT_OVERRUN;
+	}
+	ev = &ec->ev[ec->head % ECAP_CAP_EVENTS];
+	ev->sec = ts.tv_sec;
+	ev->nsec = ts.tv_nsec;
+	ev->seq = ec->seq++;
+	ev->counter = cap;
+	ev->flags = assert ? ECAP_EVENT_ASSERT : 0;
+	ec->head++;
+	spin_unlock(&ec->lock);
+}
+
+static irqreturn_t ecap_cap_irq(int irq, void *data)
+{
+	struct ecap_cap *ec = data;
+	struct timespec now;
+	u32 c0, c1, ctr, cap1, cap2;
+	u16 flg;
+
+	flg = __raw_readw(ec->base + ECAP_ECFLG) & (ECAP_CEVT1 | ECAP_CEVT2);
+	if (!flg)
+		return IRQ_NONE;
+
+	/* bracket the clock read with the counter and take the midpoint */
+	c0 = __raw_readl(ec->base + ECAP_TSCTR);
+	getnstimeofday(&now);
+	c1 = __raw_readl(ec->base + ECAP_TSCTR);
+	ctr = c0 + (c1 - c0) / 2;
+
+	cap1 = __raw_readl(ec->base + ECAP_CAP1);
+	cap2 = __raw_readl(ec->base + ECAP_CAP2);
+	__raw_writew(flg | ECAP_INT, ec->base + ECAP_ECCLR);
+
+	/* a short pulse can leave both pending: report the older first */
+	if (flg == (ECAP_CEVT1 | ECAP_CEVT2) && ctr - cap2 > ctr - cap1) {
+		ecap_cap_event(ec, &now, ctr, cap2, ec->invert);
+		ecap_cap_event(ec, &now, ctr, cap1, !ec->invert);
+	} else {
+		if (flg & ECAP_CEVT1)
+			ecap_cap_event(ec, &now, ctr, cap1, !ec->invert);
+		if (flg & ECAP_CEVT2)
+			ecap_cap_event(ec, &now, ctr, cap2, ec->invert);
+	}
+
+	wake_up_interruptible(&ec->wait);
+	return IRQ_HANDLED;
+}
+
+static void ecap_cap_hw_start(struct ecap_cap *ec)
+{
+	__raw_writew(0, ec->base + ECAP_ECEINT);
+	__raw_writew(0xff, ec->base + ECAP_ECCLR);
+	__raw_writew(ECCTL1_CAP2POL | ECCTL1_CAPLDEN | ECCTL1_FREE,
+		     ec->base + ECAP_ECCTL1);
+	__raw_writel(0, ec->base + ECAP_TSCTR);
+	__raw_writew(ECCTL2_WRAP_EVT2 | ECCTL2_REARM | ECCTL2_TSCTRSTOP |
+		     ECCTL2_SYNCO_DIS, ec->base + ECAP_ECCTL2);
+	__raw_writew(ECAP_CEVT1 | ECAP_CEVT2, ec->base + ECAP_ECEINT);
+}
+
+static void ecap_cap_hw_stop(struct ecap_cap *ec)
+{
+	__raw_writew(0, ec->base + ECAP_ECEINT);
+	__raw_writew(0, ec->base + ECAP_ECCTL2);
+	__raw_writew(0xff, ec->base + ECAP_ECCLR);
+}
+
+static int ecap_cap_open(struct inode *inode, struct file *file)
+{
+	struct ecap_cap *ec = container_of(file->private_data,
+					   struct ecap_cap, misc);
+
+	if (test_and_set_bit(0, &ec->in_use))
+		return -EBUSY;
+
+	spin_lock_irq(&ec->lock);
+	ec->tail = ec->head;
+	spin_unlock_irq(&ec->lock);
+
+	file->private_data = ec;
+	return 0;
+}
+
+static int ecap_cap_release(struct inode *inode, struct file *file)
+{
+	struct ecap_cap *ec = file->private_data;
+
+	clear_bit(0, &ec->in_use);
+	return 0;
+}
+
+static ssize_t ecap_cap_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct ecap_cap *ec = file->private_data;
+	struct ecap_event ev;
+	ssize_t done = 0;
+	int ret;
+
+	if (count < sizeof(ev))
+		return -EINVAL;
+
+	spin_lock_irq(&ec->lock);
+	while (ec->head == ec->tail) {
+		spin_unlock_irq(&ec->lock);
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(ec->wait,
+					       ec->head != ec->tail);
+		if (ret)
+			return ret;
+		spin_lock_irq(&ec->lock);
+	}
+
+	while (ec->head != ec->tail && count - done >= sizeof(ev)) {
+		ev = ec->ev[ec->tail++ % ECAP_CAP_EVENTS];
+		spin_unlock_irq(&ec->lock);
+
+		if (copy_to_user(buf + done, &ev, sizeof(ev)))
+			return done ? done : -EFAULT;
+		done += sizeof(ev);
+
+		spin_lock_irq(&ec->lock);
+	}
+	spin_unlock_irq(&ec->lock);
+
+	return done;
+}
+
+static unsigned int ecap_cap_poll(struct file *file, poll_table *wait)
+{
+	struct ecap_cap *ec = file->private_data;
+
+	poll_wait(file, &ec->wait, wait);
+
+	if (ec->head != ec->tail)
+		return POLLIN | POLLRDNORM;
+	return 0;
+}
+
+static const struct file_operations ecap_cap_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ecap_cap_open,
+	.release	= ecap_cap_release,
+	.read		= ecap_cap_read,
+	.poll		= ecap_cap_poll,
+};
+
+static int __devinit ecap_cap_probe(struct platform_device *pdev)
+{
+	struct davinci_ecap_capture_platform_data *pdata =
+		pdev->dev.platform_data;
+	struct pps_source_info info = {
+		.mode	= PPS_CAPTUREBOTH | PPS_OFFSETASSERT |
+			  PPS_OFFSETCLEAR | PPS_CANWAIT | PPS_TSFMT_TSPEC,
+		.owner	= THIS_MODULE,
+		.dev	= &pdev->dev,
+	};
+	struct ecap_cap *ec;
+	struct resource *r;
+	int ret;
+
+	ec = kzalloc(sizeof(*ec), GFP_KERNEL);
+	if (!ec)
+		return -ENOMEM;
+
+	ec->dev = &pdev->dev;
+	ec->invert = pdata && pdata->invert;
+	spin_lock_init(&ec->lock);
+	init_waitqueue_head(&ec->wait);
+	snprintf(ec->name, sizeof(ec->name), "ecap_cap%d", pdev->id);
+
+	r = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	ec->irq = platform_get_irq(pdev, 0);
+	if (!r || ec->irq < 0) {
+		dev_err(&pdev->dev, "missing resources\n");
+		ret = -ENODEV;
+		goto err_free;
+	}
+
+	ec->mem = request_mem_region(r->start, resource_size(r), pdev->name);
+	if (!ec->mem) {
+		ret = -EBUSY;
+		goto err_free;
+	}
+
+	ec->base = ioremap(r->start, resource_size(r));
+	if (!ec->base) {
+		ret = -ENOMEM;
+		goto err_mem;
+	}
+
+	ec->clk = clk_get(&pdev->dev, "ecap");
+	if (IS_ERR(ec->clk)) {
+		ret = PTR_ERR(ec->clk);
+		goto err_unmap;
+	}
+	clk_enable(ec->clk);
+
+	strlcpy(info.name, ec->name, sizeof(info.name));
+	ec->pps = pps_register_source(&info, PPS_CAPTUREASSERT |
+				      PPS_OFFSETASSERT | PPS_CANWAIT |
+				      PPS_TSFMT_TSPEC);
+	if (ec->pps < 0) {
+		ret = ec->pps;
+		goto err_clk;
+	}
+
+	ret = request_irq(ec->irq, ecap_cap_irq, 0, ec->name, ec);
+	if (ret)
+		goto err_pps;
+
+	ec->misc.minor = MISC_DYNAMIC_MINOR;
+	ec->misc.name = ec->name;
+	ec->misc.fops = &ecap_cap_fops;
+	ec->misc.parent = &pdev->dev;
+	ret = misc_register(&ec->misc);
+	if (ret)
+		goto err_irq;
+
+	ecap_cap_hw_start(ec);
+
+	platform_set_drvdata(pdev, ec);
+	dev_info(&pdev->dev, "PPS source %d, %lu Hz timebase\n",
+		 ec->pps, clk_get_rate(ec->clk));
+	return 0;
+
+err_irq:
+	free_irq(ec->irq, ec);
+err_pps:
+	pps_unregister_source(ec->pps);
+err_clk:
+	clk_disable(ec->clk);
+	clk_put(ec->clk);
+err_unmap:
+	iounmap(ec->base);
+err_mem:
+	release_mem_region(ec->mem->start, resource_size(ec->mem));
+err_free:
+	kfree(ec);
+	return ret;
+}
+
+static int __devexit ecap_cap_remove(struct platform_device *pdev)
+{
+	struct ecap_cap *ec = platform_get_drvdata(pdev);
+
+	ecap_cap_hw_stop(ec);
+	misc_deregister(&ec->misc);
+	free_irq(ec->irq, ec);
+	pps_unregister_source(ec->pps);
+	clk_disable(ec->clk);
+	clk_put(ec->clk);
+	iounmap(ec->base);
+	release_mem_region(ec->mem->start, resource_size(ec->mem));
+	kfree(ec);
+	return 0;
+}
+
+static struct platform_driver ecap_cap_driver = {
+	.probe		= ecap_cap_probe,
+	.remove		= __devexit_p(ecap_cap_remove),
+	.driver		= {
+		.name	= DRIVER_NAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init ecap_cap_init(void)
+{
+	return platform_driver_register(&ecap_cap_driver);
+}
+module_init(ecap_cap_init);
+
+static void __exit ecap_cap_exit(void)
+{
+	platform_driver_unregister(&ecap_cap_driver);
+}
+module_exit(ecap_cap_exit);
+
+MODULE_DESCRIPTION("DA850 eCAP edge timestamping");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:" DRIVER_NAME);
@@ -0,0 +1,491 @@
+/*
+ * DA8xx PRU logic capture
+ *
+ * One PRU core samples its R31 inputs on a cycle counter deadline and
+ * stores the samples straight into a DMA-coherent ring in DDR through
+ * its master port.  The ARM only sets up the run and is interrupted
+ * once every "notify" bytes, so capture costs no CPU per sample and the
+ * sample timing doesn't depend on Linux.  User space maps the ring and
+ * hands consumed data back with an ioctl, as with /dev/upp.
+ *
+ * The firmware, PRU_Capture.bin, is built from firmware/omapl_pru/
+ * PRU_Capture.p and shares the control block below with this driver.
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/miscdevice.h>
+#include <linux/interrupt.h>
+#include <linux/dma-mapping.h>
+#include <linux/clk.h>
+#include <linux/delay.h>
+#include <linux/err.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/io.h>
+#include <linux/log2.h>
+#include <linux/uaccess.h>
+#include <linux/davinci_pru_capture.h>
+
+#include <mach/pru.h>
+
+#define DRIVER_NAME		"davinci-pru-capture"
+#define PRUCAP_FIRMWARE		"PRU_Capture.bin"
+
+/* control block at the start of the core's data RAM */
+#define PRUCAP_CMD		0x00	/* ARM: run or stop */
+#define PRUCAP_BUF		0x04	/* ARM: ring, physical address */
+#define PRUCAP_SIZE		0x08	/* ARM: ring size, power of 2 */
+#define PRUCAP_PERIOD		0x0c	/* ARM: PRU cycles per sample */
+#define PRUCAP_SHIFT		0x10
+#define PRUCAP_WIDTH		0x14
+#define PRUCAP_TRIG_MASK	0x18
+#define PRUCAP_TRIG_VALUE	0x1c
+#define PRUCAP_TRIG_MODE	0x20
+#define PRUCAP_NOTIFY		0x24	/* ARM: head publish interval */
+#define PRUCAP_IRQ		0x28	/* ARM: R31 value raising the event */
+#define PRUCAP_PRUCTRL		0x2c	/* ARM: core's control registers */
+#define PRUCAP_HEAD		0x30	/* PRU: bytes captured */
+#define PRUCAP_TAIL		0x34	/* ARM: bytes consumed */
+#define PRUCAP_DROPPED		0x38	/* PRU: bytes lost to a full ring */
+#define PRUCAP_STATE		0x3c	/* PRU: PRUCAP_STATE_* */
+
+#define PRUCAP_CMD_STOP		0
+#define PRUCAP_CMD_RUN		1
+
+/* PRU-local address of a core's control registers */
+#define PRUCAP_PRUCTRL_ADDR(core)	(0x7000 + (core) * 0x800)
+
+/* R31 event output: strobe plus vector, raising system event 32 + vector */
+#define PRUCAP_R31_EVENT(ev)	(BIT(5) | ((ev) - 32))
+
+/* cycles the firmware's sample loop needs at worst, ring wrap included */
+#define PRUCAP_MIN_PERIOD	40
+
+static unsigned int buf_kb = 256;
+module_param(buf_kb, uint, S_IRUGO);
+MODULE_PARM_DESC(buf_kb, "Capture ring size in KiB, a power of 2 (default 256)");
+
+struct prucap {
+	struct device		*dev;
+	struct miscdevice	misc;
+	struct davinci_pru_capture_platform_data *pdata;
+	void __iomem		*dram;
+	unsigned long		pru_rate;
+	int			irq;
+	unsigned long		in_use;
+	bool			configured;
+	bool			loaded;
+	bool			running;
+	struct prucap_config	config;
+	u32			period;
+	u32			tail;
+	u32			buf_size;
+	void			*cpu_addr;
+	dma_addr_t		dma_addr;
+	struct mutex		mutex;
+	wait_queue_head_t	wait;
+};
+
+static inline u32 prucap_read(struct prucap *cap, unsigned off)
+{
+	return __raw_readl(cap->dram + off);
+}
+
+static inline void prucap_write(struct prucap *cap, unsigned off, u32 val)
+{
+	__raw_writel(val, cap->dram + off);
+}
+
+/* captured bytes the driver hasn't had back yet */
+static u32 prucap_count(struct prucap *cap)
+{
+	return prucap_read(cap, PRUCAP_HEAD) - cap->tail;
+}
+
+static irqreturn_t prucap_irq(int irq, void *data)
+{
+	struct prucap *cap = data;
+
+	davinci_pru_event_clear(cap->pdata->event);
+	wake_up_interruptible(&cap->wait);
+	return IRQ_HANDLED;
+}
+
+static int prucap_set_config(struct prucap *cap, struct prucap_config *cfg)
+{
+	u32 period;
+
+	if (!cfg->rate || (cfg->width != 1 && cfg->width != 2) ||
+	    cfg->shift + cfg->width * 8 > 32)
+		return -EINVAL;
+	if (!is_power_of_2(cfg->notify) || cfg->notify < 4 ||
+	    cfg->notify > cap->buf_size / 2)
+		return -EINVAL;
+	if (cfg->trig_mode > PRUCAP_TRIG_EDGE)
+		return -EINVAL;
+
+	period = DIV_ROUND_CLOSEST(cap->pru_rate, cfg->rate);
+	if (period < PRUCAP_MIN_PERIOD)
+		return -ERANGE;
+
+	cap->config = *cfg;
+	cap->period = period;
+	cap->configured = true;
+	return 0;
+}
+
+static int prucap_start(struct prucap *cap)
+{
+	struct prucap_config *cfg = &cap->config;
+	unsigned core = cap->pdata->core;
+	int ret;
+
+	if (cap->running)
+		return -EBUSY;
+	if (!cap->configured)
+		return -EINVAL;
+
+	if (!cap->loaded) {
+		ret = davinci_pru_load_firmware(core, PRUCAP_FIRMWARE);
+		if (ret)
+			return ret;
+		prucap_write(cap, PRUCAP_CMD, PRUCAP_CMD_STOP);
+		davinci_pru_run(core);
+		cap->loaded = true;
+	}
+
+	prucap_write(cap, PRUCAP_BUF, cap->dma_addr);
+	prucap_write(cap, PRUCAP_SIZE, cap->buf_size);
+	prucap_write(cap, PRUCAP_PERIOD, cap->period);
+	prucap_write(cap, PRUCAP_SHIFT, cfg->shift);
+	prucap_write(cap, PRUCAP_WIDTH, cfg->width);
+	prucap_write(cap, PRUCAP_TRIG_MASK, cfg->trig_mask);
+	prucap_write(cap, PRUCAP_TRIG_VALUE, cfg->trig_value);
+	prucap_write(cap, PRUCAP_TRIG_MODE, cfg->trig_mode);
+	prucap_write(cap, PRUCAP_NOTIFY, cfg->notify);
+	prucap_write(cap, PRUCAP_IRQ, PRUCAP_R31_EVENT(cap->pdata->event));
+	prucap_write(cap, PRUCAP_PRUCTRL, PRUCAP_PRUCTRL_ADDR(core));
+	prucap_write(cap, PRUCAP_HEAD, 0);
+	prucap_write(cap, PRUCAP_TAIL, 0);
+	prucap_write(cap, PRUCAP_DROPPED, 0);
+	cap->tail = 0;
+
+	/* the firmware reads the parameters once it sees the command */
+	wmb();
+	prucap_write(cap, PRUCAP_CMD, PRUCAP_CMD_RUN);
+	cap->running = true;
+	return 0;
+}
+
+static void prucap_stop(struct prucap *cap)
+{
+	int timeout = 10;
+
+	if (!cap->running)
+		return;
+
+	prucap_write(cap, PRUCAP_CMD, PRUCAP_CMD_STOP);
+
+	/* the firmware publishes its final head on the way out */
+	while (prucap_read(cap, PRUCAP_STATE) != PRUCAP_STATE_IDLE &&
+	       --timeout)
+		msleep(1);
+	if (!timeout) {
+		dev_warn(cap->dev, "firmware doesn't stop, halting PRU%u\n",
+			 cap->pdata->core);
+		davinci_pru_halt(cap->pdata->core);
+		cap->loaded = false;
+	}
+
+	cap->running = false;
+	wake_up_interruptible(&cap->wait);
+}
+
+static int prucap_sync(struct prucap *cap, struct prucap_sync *sync)
+{
+	int ret = 0;
+
+	if (sync->release > prucap_count(cap)) {
+		ret = -EINVAL;
+	} else {
+		cap->tail += sync->release;
+		prucap_write(cap, PRUCAP_TAIL, cap->tail);
+	}
+	sync->offset = cap->tail & (cap->buf_size - 1);
+	sync->count = prucap_count(cap);
+	return ret;
+}
+
+static int prucap_open(struct inode *inode, struct file *file)
+{
+	struct prucap *cap = container_of(file->private_data, struct prucap,
+					  misc);
+
+	/* the ring is consumed by a single user */
+	if (test_and_set_bit(0, &cap->in_use))
+		return -EBUSY;
+
+	file->private_data = cap;
+	return 0;
+}
+
+static int prucap_release(struct inode *inode, struct file *file)
+{
+	struct prucap *cap = file->private_data;
+
+	mutex_lock(&cap->mutex);
+	prucap_stop(cap);
+	mutex_unlock(&cap->mutex);
+	clear_bit(0, &cap->in_use);
+	return 0;
+}
+
+static unsigned int prucap_poll(struct file *file, poll_table *wait)
+{
+	struct prucap *cap = file->private_data;
+	unsigned int mask = 0;
+
+	poll_wait(file, &cap->wait, wait);
+
+	if (prucap_count(cap))
+		mask |= POLLIN | POLLRDNORM;
+	else if (!cap->running)
+		mask |= POLLHUP;
+	return mask;
+}
+
+static int prucap_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct prucap *cap = file->private_data;
+
+	/* only the PRU writes the ring */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return dma_mmap_coherent(cap->dev, vma, cap->cpu_addr, cap->dma_addr,
+				 cap->buf_size);
+}
+
+static long prucap_ioctl(struct file *file, unsigned int cmd,
+			 unsigned long arg)
+{
+	struct prucap *cap = file->private_data;
+	void __user *argp = (void __user *)arg;
+	struct prucap_status status;
+	struct prucap_config cfg;
+	struct prucap_sync sync;
+	struct prucap_info info;
+	int ret;
+
+	switch (cmd) {
+	case PRUCAP_IOC_GET_INFO:
+		memset(&info, 0, sizeof(info));
+		info.buf_size = cap->buf_size;
+		info.pru_rate = cap->pru_rate;
+		info.max_rate = cap->pru_rate / PRUCAP_MIN_PERIOD;
+		if (copy_to_user(argp, &info, sizeof(info)))
+			return -EFAULT;
+		return 0;
+
+	case PRUCAP_IOC_SET_CONFIG:
+		if (copy_from_user(&cfg, argp, sizeof(cfg)))
+			return -EFAULT;
+		mutex_lock(&cap->mutex);
+		ret = cap->running ? -EBUSY : prucap_set_config(cap, &cfg);
+		mutex_unlock(&cap->mutex);
+		return ret;
+
+	case PRUCAP_IOC_START:
+		mutex_lock(&cap->mutex);
+		ret = prucap_start(cap);
+		mutex_unlock(&cap->mutex);
+		return ret;
+
+	case PRUCAP_IOC_STOP:
+		mutex_lock(&cap->mutex);
+		prucap_stop(cap);
+		mutex_unlock(&cap->mutex);
+		return 0;
+
+	case PRUCAP_IOC_SYNC:
+		if (copy_from_user(&sync, argp, sizeof(sync)))
+			return -EFAULT;
+		mutex_lock(&cap->mutex);
+		ret = prucap_sync(cap, &sync);
+		mutex_unlock(&cap->mutex);
+		if (copy_to_user(argp, &sync, sizeof(sync)))
+			return -EFAULT;
+		return ret;
+
+	case PRUCAP_IOC_GET_STATUS:
+		memset(&status, 0, sizeof(status));
+		mutex_lock(&cap->mutex);
+		if (cap->running)
+			status.state = prucap_read(cap, PRUCAP_STATE);
+		if (cap->configured)
+			status.rate = cap->pru_rate / cap->period;
+		status.captured = prucap_read(cap, PRUCAP_HEAD);
+		status.dropped = prucap_read(cap, PRUCAP_DROPPED);
+		mutex_unlock(&cap->mutex);
+		if (copy_to_user(argp, &status, sizeof(status)))
+			return -EFAULT;
+		return 0;
+
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations prucap_fops = {
+	.owner		= THIS_MODULE,
+	.open		= prucap_open,
+	.release	= prucap_release,
+	.poll		= prucap_poll,
+	.mmap		= prucap_mmap,
+	.unlocked_ioctl	= prucap_ioctl,
+};
+
+static int __devinit prucap_probe(struct platform_device *pdev)
+{
+	struct davinci_pru_capture_platform_data *pdata =
+		pdev->dev.platform_data;
+	struct prucap *cap;
+	struct clk *clk;
+	int ret;
+
+	if (!pdata || pdata->core >= DAVINCI_PRU_NUM_CORES ||
+	    pdata->event < 32 || pdata->event > 47 ||
+	    pdata->host < DAVINCI_PRU_HOST_ARM(0) ||
+	    pdata->host >= DAVINCI_PRU_NUM_CHANNELS) {
+		dev_err(&pdev->dev, "missing or bad platform data\n");
+		return -ENODEV;
+	}
+
+	if (!is_power_of_2(buf_kb)) {
+		dev_err(&pdev->dev, "buf_kb must be a power of 2\n");
+		return -EINVAL;
+	}
+
+	cap = kzalloc(sizeof(*cap), GFP_KERNEL);
+	if (!cap)
+		return -ENOMEM;
+
+	cap->dev = &pdev->dev;
+	cap->pdata = pdata;
+	cap->buf_size = buf_kb << 10;
+	mutex_init(&cap->mutex);
+	init_waitqueue_head(&cap->wait);
+
+	clk = clk_get(NULL, "pru_ck");
+	if (IS_ERR(clk)) {
+		ret = PTR_ERR(clk);
+		goto err_free;
+	}
+	cap->pru_rate = clk_get_rate(clk);
+	clk_put(clk);
+
+	ret = davinci_pru_request(pdata->core, &pdev->dev);
+	if (ret)
+		goto err_free;
+	cap->dram = davinci_pru_dram(pdata->core);
+
+	cap->cpu_addr = dma_alloc_coherent(&pdev->dev, cap->buf_size,
+					   &cap->dma_addr, GFP_KERNEL);
+	if (!cap->cpu_addr) {
+		dev_err(&pdev->dev, "cannot allocate %u KiB ring\n", buf_kb);
+		ret = -ENOMEM;
+		goto err_pru;
+	}
+
+	/* one channel per host interrupt keeps the mapping 1:1 */
+	ret = davinci_pru_event_map(pdata->event, pdata->host, pdata->host);
+	if (ret)
+		goto err_dma;
+	davinci_pru_event_clear(pdata->event);
+
+	cap->irq = DAVINCI_PRU_HOST_IRQ(pdata->host);
+	ret = request_irq(cap->irq, prucap_irq, 0, DRIVER_NAME, cap);
+	if (ret)
+		goto err_dma;
+	davinci_pru_event_enable(pdata->event);
+
+	cap->misc.minor = MISC_DYNAMIC_MINOR;
+	cap->misc.name = "pru_capture";
+	cap->misc.fops = &prucap_fops;
+	cap->misc.parent = &pdev->dev;
+	ret = misc_register(&cap->misc);
+	if (ret)
+		goto err_irq;
+
+	platform_set_drvdata(pdev, cap);
+	dev_info(&pdev->dev, "PRU%u, %u KiB ring, up to %lu samples/s\n",
+		 pdata->core, buf_kb, cap->pru_rate / PRUCAP_MIN_PERIOD);
+	return 0;
+
+err_irq:
+	davinci_pru_event_disable(pdata->event);
+	free_irq(cap->irq, cap);
+err_dma:
+	dma_free_coherent(&pdev->dev, cap->buf_size, cap->cpu_addr,
+			  cap->dma_addr);
+err_pru:
+	davinci_pru_release(pdata->core);
+err_free:
+	kfree(cap);
+	return ret;
+}
+
+static int __devexit prucap_remove(struct platform_device *pdev)
+{
+	struct prucap *cap = platform_get_drvdata(pdev);
+
+	misc_deregister(&cap->misc);
+	davinci_pru_release(cap->pdata->core);
+	davinci_pru_event_disable(cap->pdata->event);
+	free_irq(cap->irq, cap);
+	dma_free_coherent(&pdev->dev, cap->buf_size, cap->cpu_addr,
+			  cap->dma_addr);
+	kfree(cap);
+	return 0;
+}
+
+static struct platform_driver prucap_driver = {
+	.probe		= prucap_probe,
+	.remove		= __devexit_p(prucap_remove),
+	.driver		= {
+		.name	= DRIVER_NAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init prucap_init(void)
+{
+	return platform_driver_register(&prucap_driver);
+}
+module_init(prucap_init);
+
+static void __exit prucap_exit(void)
+{
+	platform_driver_unregister(&prucap_driver);
+}
+module_exit(prucap_exit);
+
+MODULE_DESCRIPTION("DA8xx PRU logic capture");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:" DRIVER_NAME);
+MODULE_FIRMWARE(PRUCAP_FIRMWARE);
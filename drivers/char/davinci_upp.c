@@ -0,0 +1,608 @@
+/*
+ * DA850/OMAP-L138 uPP (Universal Parallel Port) streaming driver
+ *
+ * Each channel streams through a ring of DMA-coherent buffers that user
+ * space maps.  The uPP DMA keeps one window active and one pending, so
+ * the driver queues the next buffer from every end-of-window interrupt
+ * and the port never idles while the ring has room.  No data is copied
+ * by the CPU.
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/miscdevice.h>
+#include <linux/interrupt.h>
+#include <linux/dma-mapping.h>
+#include <linux/clk.h>
+#include <linux/delay.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/slab.h>
+#include <linux/io.h>
+#include <linux/uaccess.h>
+#include <linux/davinci_upp.h>
+
+#define DRIVER_NAME		"davinci-upp"
+
+/* registers */
+#define UPPCR			0x04
+#define UPCTL			0x10
+#define UPICR			0x14
+#define UPIVR			0x18
+#define UPTCR			0x1c
+#define UPIER			0x24
+#define UPIES			0x28
+#define UPIEC			0x2c
+#define UPEOI			0x30
+/* DMA channel I at 0x40, Q at 0x60 */
+#define UPD_BASE(c)		(0x40 + (c) * 0x20)
+#define UPD0			0x00	/* window address */
+#define UPD1			0x04	/* line count, bytes per line */
+#define UPD2			0x08	/* line offset */
+#define UPS2			0x18	/* status */
+
+#define UPPCR_EN		BIT(3)
+#define UPPCR_SWRST		BIT(4)
+#define UPPCR_DB		BIT(7)
+
+#define UPS2_PEND		BIT(1)
+
+/* interrupt bits of DMA channel I, Q's are 8 bits up */
+#define UPINT_DPE		BIT(0)
+#define UPINT_UOR		BIT(1)
+#define UPINT_ERR		BIT(2)
+#define UPINT_EOW		BIT(3)
+#define UPINT_SHIFT(c)		((c) * 8)
+#define UPINT_ALL		(UPINT_DPE | UPINT_UOR | UPINT_ERR | UPINT_EOW)
+
+/* the DMA holds an active and a pending window */
+#define UPP_DMA_DEPTH		2
+
+static unsigned int line_len = 4096;
+module_param(line_len, uint, S_IRUGO);
+MODULE_PARM_DESC(line_len, "Bytes per line, a multiple of 8 (default 4096)");
+
+static unsigned int lines = 16;
+module_param(lines, uint, S_IRUGO);
+MODULE_PARM_DESC(lines, "Lines per buffer (default 16)");
+
+static unsigned int nr_bufs = 8;
+module_param(nr_bufs, uint, S_IRUGO);
+MODULE_PARM_DESC(nr_bufs, "Buffers per channel ring (default 8)");
+
+/*
+ * Free running buffer counts.  The DMA completes buffers in ring order,
+ * so done <= queued and the ring index of a count is count % nr_bufs.
+ * user counts buffers handed back by user space: received ones it has
+ * consumed (user <= done), or ones it has filled for transmission
+ * (queued <= user).
+ */
+struct upp_chan {
+	int			dir;
+	unsigned long		ring_off;
+	u32			done;
+	u32			queued;
+	u32			user;
+	struct upp_chan_stats	stats;
+};
+
+struct upp {
+	struct device		*dev;
+	struct miscdevice	misc;
+	struct davinci_upp_platform_data *pdata;
+	void __iomem		*base;
+	struct clk		*clk;
+	int			irq;
+	unsigned long		in_use;
+	bool			running;
+	u32			buf_size;
+	size_t			map_size;
+	void			*cpu_addr;
+	dma_addr_t		dma_addr;
+	spinlock_t		lock;
+	struct mutex		mutex;
+	wait_queue_head_t	wait;
+	struct upp_chan		chan[UPP_NUM_CHANNELS];
+};
+
+static inline u32 upp_read(struct upp *upp, unsigned off)
+{
+	return __raw_readl(upp->base + off);
+}
+
+static inline void upp_write(struct upp *upp, unsigned off, u32 val)
+{
+	__raw_writel(val, upp->base + off);
+}
+
+/* buffers the caller owns, from ring index ch->user */
+static u32 upp_user_count(struct upp_chan *ch)
+{
+	if (ch->dir == UPP_DIR_RX)
+		return ch->done - ch->user;
+	return nr_bufs - (ch->user - ch->done);
+}
+
+static bool upp_can_queue(struct upp_chan *ch)
+{
+	if (ch->queued - ch->done >= UPP_DMA_DEPTH)
+		return false;
+	if (ch->dir == UPP_DIR_RX)
+		return ch->queued - ch->user < nr_bufs;
+	return ch->queued != ch->user;
+}
+
+/* Caller holds upp->lock. */
+static void upp_refill(struct upp *upp, int c)
+{
+	struct upp_chan *ch = &upp->chan[c];
+	unsigned base = UPD_BASE(c);
+	dma_addr_t addr;
+
+	while (upp->running && upp_can_queue(ch)) {
+		if (upp_read(upp, base + UPS2) & UPS2_PEND)
+			break;
+
+		addr = upp->dma_addr + ch->ring_off +
+			(ch->queued % nr_bufs) * upp->buf_size;
+		upp_write(upp, base + UPD0, addr);
+		upp_write(upp, base + UPD1, (lines << 16) | line_len);
+		/* writing the line offset queues the window */
+		upp_write(upp, base + UPD2, line_len);
+		ch->queued++;
+	}
+}
+
+static irqreturn_t upp_irq(int irq, void *data)
+{
+	struct upp *upp = data;
+	struct upp_chan *ch;
+	u32 status, bits;
+	int c;
+
+	status = upp_read(upp, UPIER);
+	if (!status)
+		return IRQ_NONE;
+	upp_write(upp, UPIER, status);
+
+	spin_lock(&upp->lock);
+	for (c = 0; c < UPP_NUM_CHANNELS; c++) {
+		ch = &upp->chan[c];
+		bits = (status >> UPINT_SHIFT(c)) & UPINT_ALL;
+		if (!bits || ch->dir == UPP_DIR_NONE)
+			continue;
+
+		if (bits & UPINT_UOR)
+			ch->stats.fifo_errors++;
+		if (bits & (UPINT_DPE | UPINT_ERR))
+			ch->stats.dma_errors++;
+		if (!(bits & UPINT_EOW) || ch->queued == ch->done)
+			continue;
+
+		ch->done++;
+		ch->stats.windows++;
+		upp_refill(upp, c);
+		if (ch->queued == ch->done)
+			ch->stats.starved++;
+	}
+	spin_unlock(&upp->lock);
+
+	upp_write(upp, UPEOI, 0);
+	wake_up_interruptible(&upp->wait);
+	return IRQ_HANDLED;
+}
+
+/* Reset the port and load the board configuration; leaves it disabled. */
+static void upp_reset(struct upp *upp)
+{
+	struct davinci_upp_platform_data *pdata = upp->pdata;
+
+	upp_write(upp, UPPCR, UPPCR_SWRST);
+	/* the reset must be held for 200 module clocks */
+	udelay(1);
+	upp_write(upp, UPPCR, 0);
+
+	upp_write(upp, UPCTL, pdata->upctl);
+	upp_write(upp, UPICR, pdata->upicr);
+	upp_write(upp, UPIVR, pdata->upivr);
+	upp_write(upp, UPTCR, pdata->uptcr);
+	upp_write(upp, UPIEC, ~0);
+}
+
+static u32 upp_irq_mask(struct upp *upp)
+{
+	u32 mask = 0;
+	int c;
+
+	for (c = 0; c < UPP_NUM_CHANNELS; c++)
+		if (upp->chan[c].dir != UPP_DIR_NONE)
+			mask |= UPINT_ALL << UPINT_SHIFT(c);
+	return mask;
+}
+
+/* Called with upp->mutex held. */
+static int upp_start(struct upp *upp)
+{
+	int c;
+
+	if (upp->running)
+		return -EBUSY;
+
+	spin_lock_irq(&upp->lock);
+	for (c = 0; c < UPP_NUM_CHANNELS; c++)
+		memset(&upp->chan[c].stats, 0, sizeof(upp->chan[c].stats));
+
+	upp->running = true;
+	upp_write(upp, UPIES, upp_irq_mask(upp));
+	upp_write(upp, UPPCR, UPPCR_EN);
+	for (c = 0; c < UPP_NUM_CHANNELS; c++)
+		if (upp->chan[c].dir != UPP_DIR_NONE)
+			upp_refill(upp, c);
+	spin_unlock_irq(&upp->lock);
+	return 0;
+}
+
+/*
+ * Called with upp->mutex held.  All buffers go back to user space, so
+ * transmit buffers can be filled before the next start.
+ */
+static void upp_stop(struct upp *upp)
+{
+	struct upp_chan *ch;
+	unsigned long timeout;
+	int c;
+
+	if (!upp->running)
+		return;
+
+	spin_lock_irq(&upp->lock);
+	upp->running = false;
+	upp_write(upp, UPIEC, ~0);
+	upp_write(upp, UPPCR, 0);
+	spin_unlock_irq(&upp->lock);
+
+	/* let a burst in flight finish before the reset */
+	timeout = jiffies + msecs_to_jiffies(10);
+	while (upp_read(upp, UPPCR) & UPPCR_DB) {
+		if (time_after(jiffies, timeout)) {
+			dev_warn(upp->dev, "DMA burst did not complete\n");
+			break;
+		}
+		cpu_relax();
+	}
+
+	upp_reset(upp);
+
+	spin_lock_irq(&upp->lock);
+	for (c = 0; c < UPP_NUM_CHANNELS; c++) {
+		ch = &upp->chan[c];
+		ch->done = ch->queued = ch->user = 0;
+	}
+	spin_unlock_irq(&upp->lock);
+	wake_up_interruptible(&upp->wait);
+}
+
+static int upp_sync(struct upp *upp, struct upp_sync *sync)
+{
+	struct upp_chan *ch;
+	int ret = 0;
+
+	if (sync->chan >= UPP_NUM_CHANNELS)
+		return -EINVAL;
+	ch = &upp->chan[sync->chan];
+	if (ch->dir == UPP_DIR_NONE)
+		return -EINVAL;
+
+	spin_lock_irq(&upp->lock);
+	if (sync->release > upp_user_count(ch)) {
+		ret = -EINVAL;
+	} else {
+		ch->user += sync->release;
+		upp_refill(upp, sync->chan);
+	}
+	sync->index = ch->user % nr_bufs;
+	sync->count = upp_user_count(ch);
+	spin_unlock_irq(&upp->lock);
+	return ret;
+}
+
+static int upp_open(struct inode *inode, struct file *file)
+{
+	struct upp *upp = container_of(file->private_data, struct upp, misc);
+
+	/* buffer ownership is tracked for a single user */
+	if (test_and_set_bit(0, &upp->in_use))
+		return -EBUSY;
+
+	file->private_data = upp;
+	return 0;
+}
+
+static int upp_release(struct inode *inode, struct file *file)
+{
+	struct upp *upp = file->private_data;
+
+	mutex_lock(&upp->mutex);
+	upp_stop(upp);
+	mutex_unlock(&upp->mutex);
+	clear_bit(0, &upp->in_use);
+	return 0;
+}
+
+static unsigned int upp_poll(struct file *file, poll_table *wait)
+{
+	struct upp *upp = file->private_data;
+	unsigned int mask = 0;
+	struct upp_chan *ch;
+	unsigned long flags;
+	int c;
+
+	poll_wait(file, &upp->wait, wait);
+
+	spin_lock_irqsave(&upp->lock, flags);
+	for (c = 0; c < UPP_NUM_CHANNELS; c++) {
+		ch = &upp->chan[c];
+		if (ch->dir == UPP_DIR_NONE || !upp_user_count(ch))
+			continue;
+		if (ch->dir == UPP_DIR_RX)
+			mask |= POLLIN | POLLRDNORM;
+		else
+			mask |= POLLOUT | POLLWRNORM;
+	}
+	spin_unlock_irqrestore(&upp->lock, flags);
+
+	if (!upp->running)
+		mask |= POLLERR;
+	return mask;
+}
+
+static int upp_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct upp *upp = file->private_data;
+
+	/* coherent memory is uncached, so the CPU never holds stale lines */
+	return dma_mmap_coherent(upp->dev, vma, upp->cpu_addr, upp->dma_addr,
+				 upp->map_size);
+}
+
+static long upp_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	struct upp *upp = file->private_data;
+	void __user *argp = (void __user *)arg;
+	struct upp_stats stats;
+	struct upp_sync sync;
+	struct upp_info info;
+	int ret, c;
+
+	switch (cmd) {
+	case UPP_IOC_GET_INFO:
+		memset(&info, 0, sizeof(info));
+		info.buf_size = upp->buf_size;
+		info.nr_bufs = nr_bufs;
+		info.map_size = upp->map_size;
+		for (c = 0; c < UPP_NUM_CHANNELS; c++) {
+			info.chan[c].dir = upp->chan[c].dir;
+			info.chan[c].offset = upp->chan[c].ring_off;
+		}
+		if (copy_to_user(argp, &info, sizeof(info)))
+			return -EFAULT;
+		return 0;
+
+	case UPP_IOC_START:
+		mutex_lock(&upp->mutex);
+		ret = upp_start(upp);
+		mutex_unlock(&upp->mutex);
+		return ret;
+
+	case UPP_IOC_STOP:
+		mutex_lock(&upp->mutex);
+		upp_stop(upp);
+		mutex_unlock(&upp->mutex);
+		return 0;
+
+	case UPP_IOC_SYNC:
+		if (copy_from_user(&sync, argp, sizeof(sync)))
+			return -EFAULT;
+		ret = upp_sync(upp, &sync);
+		if (copy_to_user(argp, &sync, sizeof(sync)))
+			return -EFAULT;
+		return ret;
+
+	case UPP_IOC_GET_STATS:
+		spin_lock_irq(&upp->lock);
+		for (c = 0; c < UPP_NUM_CHANNELS; c++)
+			stats.chan[c] = upp->chan[c].stats;
+		spin_unlock_irq(&upp->lock);
+		if (copy_to_user(argp, &stats, sizeof(stats)))
+			return -EFAULT;
+		return 0;
+
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations upp_fops = {
+	.owner		= THIS_MODULE,
+	.open		= upp_open,
+	.release	= upp_release,
+	.poll		= upp_poll,
+	.mmap		= upp_mmap,
+	.unlocked_ioctl	= upp_ioctl,
+};
+
+/* Channel directions from UPCTL.MODE, B only in dual channel mode. */
+static void upp_init_chans(struct upp *upp)
+{
+	static const int dir[4][UPP_NUM_CHANNELS] = {
+		[UPP_UPCTL_MODE_RX]	= { UPP_DIR_RX, UPP_DIR_RX },
+		[UPP_UPCTL_MODE_TX]	= { UPP_DIR_TX, UPP_DIR_TX },
+		[UPP_UPCTL_MODE_ARX_BTX] = { UPP_DIR_RX, UPP_DIR_TX },
+		[UPP_UPCTL_MODE_ATX_BRX] = { UPP_DIR_TX, UPP_DIR_RX },
+	};
+	u32 upctl = upp->pdata->upctl;
+	size_t ring = PAGE_ALIGN(upp->buf_size * nr_bufs);
+	int c;
+
+	upp->map_size = 0;
+	for (c = 0; c < UPP_NUM_CHANNELS; c++) {
+		if (c == UPP_CHAN_B && !(upctl & UPP_UPCTL_CHN))
+			break;
+		upp->chan[c].dir = dir[upctl & UPP_UPCTL_MODE_MASK][c];
+		upp->chan[c].ring_off = upp->map_size;
+		upp->map_size += ring;
+	}
+}
+
+static int __devinit upp_probe(struct platform_device *pdev)
+{
+	struct davinci_upp_platform_data *pdata = pdev->dev.platform_data;
+	struct resource *mem;
+	struct upp *upp;
+	int ret;
+
+	mem = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	if (!pdata || !mem) {
+		dev_err(&pdev->dev, "missing platform data or resources\n");
+		return -ENODEV;
+	}
+
+	/* BCNT is 16 bits and addresses and line offsets 64-bit aligned */
+	if (!line_len || line_len > 0xfff8 || line_len % 8 ||
+	    !lines || lines > 0xffff || nr_bufs < UPP_DMA_DEPTH) {
+		dev_err(&pdev->dev, "invalid buffer geometry\n");
+		return -EINVAL;
+	}
+
+	upp = kzalloc(sizeof(*upp), GFP_KERNEL);
+	if (!upp)
+		return -ENOMEM;
+
+	upp->dev = &pdev->dev;
+	upp->pdata = pdata;
+	upp->buf_size = line_len * lines;
+	spin_lock_init(&upp->lock);
+	mutex_init(&upp->mutex);
+	init_waitqueue_head(&upp->wait);
+	upp_init_chans(upp);
+
+	if (!request_mem_region(mem->start, resource_size(mem), DRIVER_NAME)) {
+		ret = -EBUSY;
+		goto err_free;
+	}
+
+	upp->base = ioremap(mem->start, resource_size(mem));
+	if (!upp->base) {
+		ret = -ENOMEM;
+		goto err_release;
+	}
+
+	upp->clk = clk_get(&pdev->dev, "upp");
+	if (IS_ERR(upp->clk)) {
+		ret = PTR_ERR(upp->clk);
+		goto err_unmap;
+	}
+	clk_enable(upp->clk);
+
+	upp->cpu_addr = dma_alloc_coherent(&pdev->dev, upp->map_size,
+					   &upp->dma_addr, GFP_KERNEL);
+	if (!upp->cpu_addr) {
+		dev_err(&pdev->dev, "cannot allocate %zu KiB of buffers\n",
+			upp->map_size >> 10);
+		ret = -ENOMEM;
+		goto err_clk;
+	}
+
+	upp_reset(upp);
+
+	upp->irq = platform_get_irq(pdev, 0);
+	ret = request_irq(upp->irq, upp_irq, 0, DRIVER_NAME, upp);
+	if (ret)
+		goto err_dma;
+
+	upp->misc.minor = MISC_DYNAMIC_MINOR;
+	upp->misc.name = "upp";
+	upp->misc.fops = &upp_fops;
+	upp->misc.parent = &pdev->dev;
+	ret = misc_register(&upp->misc);
+	if (ret)
+		goto err_irq;
+
+	platform_set_drvdata(pdev, upp);
+	dev_info(&pdev->dev, "%d channel(s), %u x %u byte buffers each\n",
+		 upp->chan[UPP_CHAN_B].dir != UPP_DIR_NONE ? 2 : 1,
+		 nr_bufs, upp->buf_size);
+	return 0;
+
+err_irq:
+	free_irq(upp->irq, upp);
+err_dma:
+	dma_free_coherent(&pdev->dev, upp->map_size, upp->cpu_addr,
+			  upp->dma_addr);
+err_clk:
+	clk_disable(upp->clk);
+	clk_put(upp->clk);
+err_unmap:
+	iounmap(upp->base);
+err_release:
+	release_mem_region(mem->start, resource_size(mem));
+err_free:
+	kfree(upp);
+	return ret;
+}
+
+static int __devexit upp_remove(struct platform_device *pdev)
+{
+	struct upp *upp = platform_get_drvdata(pdev);
+	struct resource *mem = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+
+	misc_deregister(&upp->misc);
+	free_irq(upp->irq, upp);
+	upp_write(upp, UPPCR, UPPCR_SWRST);
+	dma_free_coherent(&pdev->dev, upp->map_size, upp->cpu_addr,
+			  upp->dma_addr);
+	clk_disable(upp->clk);
+	clk_put(upp->clk);
+	iounmap(upp->base);
+	release_mem_region(mem->start, resource_size(mem));
+	kfree(upp);
+	return 0;
+}
+
+static struct platform_driver upp_driver = {
+	.probe		= upp_probe,
+	.remove		= __devexit_p(upp_remove),
+	.driver		= {
+		.name	= DRIVER_NAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init upp_init(void)
+{
+	return platform_driver_register(&upp_driver);
+}
+module_init(upp_init);
+
+static void __exit upp_exit(void)
+{
+	platform_driver_unregister(&upp_driver);
+}
+module_exit(upp_exit);
+
+MODULE_DESCRIPTION("DA850 uPP streaming driver");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:" DRIVER_NAME);
@@ -0,0 +1,470 @@
+/*
+ * DaVinci zero-copy buffers shared by capture, DSP and network
+ *
+ * A camera pipeline moves each frame from the video port to the DSP
+ * and the encoded result on to the EMAC.  Buffers from /dev/zcbuf are
+ * physically contiguous, so all three can work on them in place: V4L2
+ * imports a mapping of one as a USERPTR buffer, the DSP is handed its
+ * physical address through the IPC rings and the socket layer takes
+ * its pages by reference.  Every buffer has a single owner, the CPU or
+ * the devices writing or reading it, and the cache is only cleaned or
+ * invalidated when the owner changes, rather than by each driver on
+ * each hop.
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/kref.h>
+#include <linux/slab.h>
+#include <linux/net.h>
+#include <linux/socket.h>
+#include <linux/dma-mapping.h>
+#include <linux/dma-contiguous.h>
+#include <linux/uaccess.h>
+#include <linux/davinci_zcbuf.h>
+
+/* largest single buffer, a few 1080p frames */
+#define ZCBUF_MAX_SIZE		(16 << 20)
+
+static unsigned long transitions;
+module_param(transitions, ulong, S_IRUGO);
+MODULE_PARM_DESC(transitions, "ownership changes, each one cache pass");
+
+static unsigned long busy;
+module_param(busy, ulong, S_IRUGO);
+MODULE_PARM_DESC(busy, "ownership changes refused while the network "
+		 "still held pages");
+
+struct zcbuf {
+	struct list_head	node;
+	struct kref		ref;
+	struct file		*file;
+	struct page		*page;
+	size_t			size;
+	u32			id;
+	u32			owner;
+	dma_addr_t		dma;	/* while devices own it */
+};
+
+/* what the devices do with a buffer they own */
+static const enum dma_data_direction zcbuf_dir[] = {
+	[ZCBUF_OWNER_DEV_WRITE]	= DMA_FROM_DEVICE,
+	[ZCBUF_OWNER_DEV_READ]	= DMA_TO_DEVICE,
+};
+
+static LIST_HEAD(zcbuf_list);
+static DEFINE_MUTEX(zcbuf_lock);
+static u32 zcbuf_next_id;
+
+static struct miscdevice zcbuf_misc;
+
+/* the misc device is the one boards name in their CMA regions */
+#define zcbuf_dev()		(zcbuf_misc.this_device)
+
+static struct zcbuf *zcbuf_find(struct file *file, u32 id)
+{
+	struct zcbuf *buf;
+
+	list_for_each_entry(buf, &zcbuf_list, node)
+		if (buf->id == id && buf->file == file)
+			return buf;
+	return NULL;
+}
+
+static void zcbuf_mark_clean(struct zcbuf *buf, bool clean)
+{
+	unsigned long i;
+
+	for (i = 0; i < buf->size >> PAGE_SHIFT; i++) {
+		if (clean) {
+			set_page_private(buf->page + i, ZCBUF_PAGE_CLEAN);
+			SetPageOwnerPriv1(buf->page + i);
+		} else {
+			ClearPageOwnerPriv1(buf->page + i);
+			set_page_private(buf->page + i, 0);
+		}
+	}
+}
+
+/* skbs sent by zcbuf_send() still referencing a page */
+static bool zcbuf_pinned(struct zcbuf *buf)
+{
+	unsigned long i;
+
+	for (i = 0; i < buf->size >> PAGE_SHIFT; i++)
+		if (page_count(buf->page + i) != 1)
+			return true;
+	return false;
+}
+
+/*
+ * The cache maintenance of a buffer happens here and only here, as the
+ * streaming DMA mapping the new owner holds until it hands the buffer
+ * on: invalidate for devices writing it, clean for devices reading it.
+ * User space maps buffers write-combined, so only the kernel's cached
+ * alias of the pages needs this.  Called with zcbuf_lock held.
+ */
+static int zcbuf_set_owner(struct zcbuf *buf, u32 owner)
+{
+	if (owner > ZCBUF_OWNER_DEV_READ)
+		return -EINVAL;
+	if (owner == buf->owner)
+		return 0;
+
+	if (buf->owner == ZCBUF_OWNER_DEV_READ) {
+		if (zcbuf_pinned(buf)) {
+			busy++;
+			return -EBUSY;
+		}
+		zcbuf_mark_clean(buf, false);
+	}
+	if (buf->owner != ZCBUF_OWNER_CPU)
+		dma_unmap_page(zcbuf_dev(), buf->dma, buf->size,
+			       zcbuf_dir[buf->owner]);
+
+	if (owner != ZCBUF_OWNER_CPU)
+		buf->dma = dma_map_page(zcbuf_dev(), buf->page, 0, buf->size,
+					zcbuf_dir[owner]);
+	if (owner == ZCBUF_OWNER_DEV_READ)
+		zcbuf_mark_clean(buf, true);
+
+	buf->owner = owner;
+	transitions++;
+	return 0;
+}
+
+static void zcbuf_release_buf(struct kref *ref)
+{
+	struct zcbuf *buf = container_of(ref, struct zcbuf, ref);
+	int count = buf->size >> PAGE_SHIFT;
+
+	/* a device may still be writing it, better lose the memory */
+	if (buf->owner == ZCBUF_OWNER_DEV_WRITE) {
+		pr_warning("zcbuf: %zu bytes at %#08lx freed while a device "
+			   "owns them, leaking\n", buf->size,
+			   (unsigned long)page_to_phys(buf->page));
+		kfree(buf);
+		return;
+	}
+
+	/* pages still in skbs go back once the network drops them */
+	if (buf->owner == ZCBUF_OWNER_DEV_READ) {
+		zcbuf_mark_clean(buf, false);
+		dma_unmap_page(zcbuf_dev(), buf->dma, buf->size,
+			       DMA_TO_DEVICE);
+	}
+	if (!dma_release_from_contiguous(zcbuf_dev(), buf->page, count))
+		free_pages_exact(page_address(buf->page), buf->size);
+	kfree(buf);
+}
+
+static void zcbuf_put(struct zcbuf *buf)
+{
+	kref_put(&buf->ref, zcbuf_release_buf);
+}
+
+static int zcbuf_alloc(struct file *file, struct zcbuf_alloc *req)
+{
+	struct zcbuf *buf;
+	size_t size = PAGE_ALIGN(req->size);
+	struct page *page;
+	void *virt;
+
+	if (!size || size > ZCBUF_MAX_SIZE)
+		return -EINVAL;
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	/* the board's CMA region if it gave us one, else the buddy */
+	page = dma_alloc_from_contiguous(zcbuf_dev(), size >> PAGE_SHIFT,
+					 get_order(size));
+	if (!page) {
+		virt = alloc_pages_exact(size, GFP_KERNEL | __GFP_NOWARN);
+		if (!virt) {
+			kfree(buf);
+			return -ENOMEM;
+		}
+		page = virt_to_page(virt);
+	}
+
+	/*
+	 * Cleared through the cached kernel alias, then written back
+	 * before user space maps the pages uncached.
+	 */
+	memset(page_address(page), 0, size);
+	dma_unmap_page(zcbuf_dev(),
+		       dma_map_page(zcbuf_dev(), page, 0, size, DMA_TO_DEVICE),
+		       size, DMA_TO_DEVICE);
+
+	kref_init(&buf->ref);
+	buf->file = file;
+	buf->page = page;
+	buf->size = size;
+	buf->owner = ZCBUF_OWNER_CPU;
+
+	mutex_lock(&zcbuf_lock);
+	buf->id = zcbuf_next_id++;
+	list_add(&buf->node, &zcbuf_list);
+	mutex_unlock(&zcbuf_lock);
+
+	req->id = buf->id;
+	req->phys = page_to_phys(page);
+	return 0;
+}
+
+static int zcbuf_free(struct file *file, u32 id)
+{
+	struct zcbuf *buf;
+	int ret = -EINVAL;
+
+	mutex_lock(&zcbuf_lock);
+	buf = zcbuf_find(file, id);
+	if (buf) {
+		list_del(&buf->node);
+		ret = 0;
+	}
+	mutex_unlock(&zcbuf_lock);
+
+	/* mappings of it keep it until they go away */
+	if (buf)
+		zcbuf_put(buf);
+	return ret;
+}
+
+static long zcbuf_send(struct file *file, struct zcbuf_send *req)
+{
+	struct zcbuf *buf;
+	struct socket *sock;
+	size_t off = req->offset, left = req->len, n;
+	long sent = 0;
+	int flags, ret;
+
+	mutex_lock(&zcbuf_lock);
+	buf = zcbuf_find(file, req->id);
+	if (!buf) {
+		mutex_unlock(&zcbuf_lock);
+		return -EINVAL;
+	}
+	if (req->offset > buf->size || req->len > buf->size - req->offset)
+		ret = -EINVAL;
+	else
+		ret = zcbuf_set_owner(buf, ZCBUF_OWNER_DEV_READ);
+	if (!ret)
+		kref_get(&buf->ref);
+	mutex_unlock(&zcbuf_lock);
+	if (ret)
+		return ret;
+
+	sock = sockfd_lookup(req->fd, &ret);
+	if (!sock)
+		goto out;
+	ret = 0;
+
+	/* one page at a time, corked into a datagram unless it is the end */
+	while (left) {
+		n = min_t(size_t, left, PAGE_SIZE - (off & ~PAGE_MASK));
+		flags = req->flags & (MSG_MORE | MSG_DONTWAIT);
+		if (n < left)
+			flags |= MSG_MORE;
+
+		ret = kernel_sendpage(sock, buf->page + (off >> PAGE_SHIFT),
+				      off & ~PAGE_MASK, n, flags);
+		if (ret <= 0)
+			break;
+		sent += ret;
+		off += ret;
+		left -= ret;
+	}
+	sockfd_put(sock);
+out:
+	zcbuf_put(buf);
+	return sent ? sent : ret;
+}
+
+static long zcbuf_ioctl(struct file *file, unsigned int cmd,
+			unsigned long arg)
+{
+	void __user *argp = (void __user *)arg;
+	struct zcbuf_alloc alloc;
+	struct zcbuf_owner owner;
+	struct zcbuf_send send;
+	struct zcbuf *buf;
+	u32 id;
+	int ret;
+
+	switch (cmd) {
+	case ZCBUF_ALLOC:
+		if (copy_from_user(&alloc, argp, sizeof(alloc)))
+			return -EFAULT;
+		ret = zcbuf_alloc(file, &alloc);
+		if (!ret && copy_to_user(argp, &alloc, sizeof(alloc))) {
+			zcbuf_free(file, alloc.id);
+			ret = -EFAULT;
+		}
+		return ret;
+
+	case ZCBUF_FREE:
+		if (get_user(id, (u32 __user *)argp))
+			return -EFAULT;
+		return zcbuf_free(file, id);
+
+	case ZCBUF_SET_OWNER:
+		if (copy_from_user(&owner, argp, sizeof(owner)))
+			return -EFAULT;
+		mutex_lock(&zcbuf_lock);
+		buf = zcbuf_find(file, owner.id);
+		ret = buf ? zcbuf_set_owner(buf, owner.owner) : -EINVAL;
+		mutex_unlock(&zcbuf_lock);
+		return ret;
+
+	case ZCBUF_SEND:
+		if (copy_from_user(&send, argp, sizeof(send)))
+			return -EFAULT;
+		return zcbuf_send(file, &send);
+	}
+
+	return -ENOTTY;
+}
+
+static void zcbuf_vm_open(struct vm_area_struct *vma)
+{
+	struct zcbuf *buf = vma->vm_private_data;
+
+	kref_get(&buf->ref);
+}
+
+static void zcbuf_vm_close(struct vm_area_struct *vma)
+{
+	zcbuf_put(vma->vm_private_data);
+}
+
+static const struct vm_operations_struct zcbuf_vm_ops = {
+	.open	= zcbuf_vm_open,
+	.close	= zcbuf_vm_close,
+};
+
+static int zcbuf_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long len = vma->vm_end - vma->vm_start;
+	struct zcbuf *buf;
+	int ret;
+
+	mutex_lock(&zcbuf_lock);
+	buf = zcbuf_find(file, vma->vm_pgoff);
+	if (buf)
+		kref_get(&buf->ref);
+	mutex_unlock(&zcbuf_lock);
+	if (!buf)
+		return -EINVAL;
+
+	ret = -EINVAL;
+	if (len > buf->size)
+		goto err;
+
+	/*
+	 * Write-combined, like the DSP IPC buffers: the devices don't
+	 * snoop the cache and the pages are never in it for user space.
+	 * A PFN mapping is what videobuf-dma-contig takes as USERPTR.
+	 */
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+	vma->vm_flags |= VM_IO | VM_RESERVED | VM_DONTCOPY;
+	ret = remap_pfn_range(vma, vma->vm_start, page_to_pfn(buf->page),
+			      len, vma->vm_page_prot);
+	if (ret)
+		goto err;
+
+	vma->vm_ops = &zcbuf_vm_ops;
+	vma->vm_private_data = buf;
+	return 0;
+err:
+	zcbuf_put(buf);
+	return ret;
+}
+
+static int zcbuf_release(struct inode *inode, struct file *file)
+{
+	struct zcbuf *buf, *tmp;
+	LIST_HEAD(gone);
+
+	mutex_lock(&zcbuf_lock);
+	list_for_each_entry_safe(buf, tmp, &zcbuf_list, node)
+		if (buf->file == file)
+			list_move(&buf->node, &gone);
+	mutex_unlock(&zcbuf_lock);
+
+	list_for_each_entry_safe(buf, tmp, &gone, node)
+		zcbuf_put(buf);
+	return 0;
+}
+
+/**
+ * zcbuf_check_phys - see whether devices may be given a physical range
+ * @phys: start of the range
+ * @len: its length
+ *
+ * For drivers that take physical addresses from user space, like the
+ * DSP IPC channel.  Returns 0 if the range lies within one buffer that
+ * devices own, -EBUSY if that buffer is still the CPU's and -EINVAL if
+ * no buffer holds it.
+ */
+int zcbuf_check_phys(u32 phys, u32 len)
+{
+	struct zcbuf *buf;
+	u32 start;
+	int ret = -EINVAL;
+
+	mutex_lock(&zcbuf_lock);
+	list_for_each_entry(buf, &zcbuf_list, node) {
+		start = page_to_phys(buf->page);
+		if (phys < start || phys - start >= buf->size ||
+		    len > buf->size - (phys - start))
+			continue;
+		ret = buf->owner == ZCBUF_OWNER_CPU ? -EBUSY : 0;
+		break;
+	}
+	mutex_unlock(&zcbuf_lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(zcbuf_check_phys);
+
+static const struct file_operations zcbuf_fops = {
+	.owner		= THIS_MODULE,
+	.unlocked_ioctl	= zcbuf_ioctl,
+	.mmap		= zcbuf_mmap,
+	.release	= zcbuf_release,
+};
+
+static struct miscdevice zcbuf_misc = {
+	.minor		= MISC_DYNAMIC_MINOR,
+	.name		= "zcbuf",
+	.fops		= &zcbuf_fops,
+};
+
+static int __init zcbuf_init(void)
+{
+	return misc_register(&zcbuf_misc);
+}
+module_init(zcbuf_init);
+
+static void __exit zcbuf_exit(void)
+{
+	misc_deregister(&zcbuf_misc);
+}
+module_exit(zcbuf_exit);
+
+MODULE_DESCRIPTION("DaVinci zero-copy buffers for capture, DSP and network");
+MODULE_LICENSE("GPL");
@@ -81,6 +81,9 @@
 #define SET_LED3 _IOW(MOTOR_MAGIC, 3,int)
 #define SET_LED4 _IOW(MOTOR_MAGIC, 4,int)
 #define SET_LED5 _IOW(MOTOR_MAGIC, 5,int)
+/* all four at once: bit 0 DS2 ... bit 3 DS5, one bank write */
+#define SET_LEDS _IOW(MOTOR_MAGIC, 6,int)
+#define GET_LEDS _IOR(MOTOR_MAGIC, 7,int)
 
 /*
     LEDS GPGIO MAP:
@@ -91,6 +94,28 @@
 */
 static int gpio_num[4];
 static int gpio_pin[4];
+
+/*
+  All four LEDs sit in the register set shared by banks 8 and 9, from
+  GPIO 128: its base and each LED's bit, for davinci_gpio_*_mask()
+*/
+#define LEDS_BANK_GPIO (8*16 & ~31)
+#define LED_BIT(i) (1 << (gpio_num[i] - LEDS_BANK_GPIO))
+
+static u32 leds_to_bank(unsigned long leds, u32 *mask)
+{
+    u32 value = 0;
+    int i;
+
+    *mask = 0;
+    for(i=0; i<4; i++)
+    {
+        *mask |= LED_BIT(i);
+        if (leds & (1 << i))
+            value |= LED_BIT(i);
+    }
+    return value;
+}
  
 static int
 am1808_leds_ioctl(
@@ -119,6 +144,28 @@ am1808_leds_ioctl(
         gpio_num_tmp = gpio_num[3];
         break;       
 
+        case SET_LEDS:
+        {
+            u32 mask, value;
+
+            value = leds_to_bank(arg, &mask);
+            davinci_gpio_write_mask(LEDS_BANK_GPIO, mask, value);
+            return 0;
+        }
+
+        case GET_LEDS:
+        {
+            u32 mask, value;
+            int i, leds = 0;
+
+            leds_to_bank(0, &mask);
+            value = davinci_gpio_read_mask(LEDS_BANK_GPIO, mask);
+            for(i=0; i<4; i++)
+                if (value & LED_BIT(i))
+                    leds |= 1 << i;
+            return put_user(leds, (int __user *)arg);
+        }
+
         default:
         return -EINVAL; 
     } 
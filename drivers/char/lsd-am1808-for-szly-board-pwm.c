@@ -36,6 +36,9 @@
 #include <mach/da8xx.h>
 #include <linux/clk.h>
 #include <mach/cslr_syscfg01_am1808.h>
+#include <linux/kfifo.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
 
 #define DEVICE_NAME "pwm" //设备名(/dev/pwm) 
 
@@ -45,6 +48,8 @@
 #define SET_PWM_ON 					_IOW(MOTOR_MAGIC, 4,int)
 #define SET_PWM_OFF 				_IOW(MOTOR_MAGIC, 5,int)
 #define SET_PWM_HIGH_LEVEL_DIV 		_IOW(MOTOR_MAGIC, 6,int)
+// 流模式: 丢弃还没输出的比较值
+#define SET_PWM_STREAM_FLUSH 		_IOW(MOTOR_MAGIC, 7,int)
 
 // test this IO
 //#define PWM1B_PIN   DA850_GPIO2_14
@@ -75,11 +80,40 @@
 #define EHRPWM0_PCCTL 		EHRPWM0_BASE+0x3C
 #define EHRPWM0_TZSEL 		EHRPWM0_BASE+0x24
 #define EHRPWM0_TZCTL 		EHRPWM0_BASE+0x28
+#define EHRPWM0_ETSEL 		EHRPWM0_BASE+0x32
+#define EHRPWM0_ETPS 		EHRPWM0_BASE+0x34
+#define EHRPWM0_ETCLR 		EHRPWM0_BASE+0x38
+
+#define ETSEL_INTSEL_ZERO	(1)
+#define ETSEL_INTEN		(1 << 3)
+#define ETPS_INTPRD_FIRST	(1)
+#define ETCLR_INT		(1)
 
 extern struct clk pwm1_clk;
 static unsigned char g_u8_pwm_on = 0;
 static unsigned long g_u32_pwm_output_freq = 0;
 static unsigned long g_u32_pwm_output_high_level_div = 2;
+static unsigned short g_u16_pwm_period;
+
+/*
+ * Streaming mode: write() queues {CMPA, CMPB} pairs of u16, and the ePWM
+ * event interrupt at counter zero loads the next pair into the shadow
+ * registers every update_div periods, so a waveform costs no syscall per
+ * sample.  The interrupt is only enabled while samples are queued; once
+ * the queue drains the last duty cycle is held.
+ *
+ * The DA850 ePWM is not an EDMA event source, and every Timer64 that
+ * could pace EDMA instead is already in use (clock events, watchdog, PRU
+ * soft UART, clocksource), so this is interrupt driven, not EDMA driven.
+ */
+#define PWM_STREAM_FIFO_SIZE	4096	/* bytes, 1024 samples */
+#define PWM_STREAM_SAMPLE	(2 * sizeof(u16))
+
+static struct kfifo g_pwm_stream_fifo;
+static DECLARE_WAIT_QUEUE_HEAD(g_pwm_stream_wait);
+static DEFINE_MUTEX(g_pwm_stream_mutex);
+static unsigned long g_u32_pwm_update_div = 1;
+static unsigned long g_u32_pwm_update_count = 1;
 
 
 // 经过测试,发现时钟应该就是150MHZ,但是实际通过示波器测试的时候发现
@@ -117,6 +151,7 @@ int fn_pwm_init(void)
 	}	 
 	// 写入周期值
 	u16_tmp = u32_period;
+	g_u16_pwm_period = u16_tmp;
 	__raw_writew(u16_tmp, EHRPWM0_TBPRD);	
 	//printk("pwm1b set period = %d \n",u16_tmp);
 
@@ -173,6 +208,11 @@ int fn_pwm_init(void)
 	u16_tmp = (1 << 2) | (1);    
 	__raw_writew(u16_tmp, EHRPWM0_TZCTL);
 
+	// 事件触发: 计数到0 产生中断,流模式有数据时才打开
+	__raw_writew(ETSEL_INTSEL_ZERO, EHRPWM0_ETSEL);
+	__raw_writew(ETPS_INTPRD_FIRST, EHRPWM0_ETPS);
+	__raw_writew(ETCLR_INT, EHRPWM0_ETCLR);
+
 	// 使能时钟	
 	//clk_enable(&pwm1_clk);	
 
@@ -188,11 +228,121 @@ int fn_pwm_init(void)
 
 
 
+static void fn_pwm_stream_enable(int on)
+{
+	unsigned short u16_tmp;
+
+	u16_tmp = __raw_readw(EHRPWM0_ETSEL);
+	if (on)
+		u16_tmp |= ETSEL_INTEN;
+	else
+		u16_tmp &= ~ETSEL_INTEN;
+	__raw_writew(u16_tmp, EHRPWM0_ETSEL);
+}
+
+// 每个周期的计数到0 事件: 装入下一组比较值
+static irqreturn_t fn_pwm_stream_irq(int irq, void *dev_id)
+{
+	u16 u16_cmp[2];
+
+	__raw_writew(ETCLR_INT, EHRPWM0_ETCLR);
+
+	if (--g_u32_pwm_update_count)
+		return IRQ_HANDLED;
+	g_u32_pwm_update_count = g_u32_pwm_update_div;
+
+	if (kfifo_out(&g_pwm_stream_fifo, (unsigned char *)u16_cmp,
+				PWM_STREAM_SAMPLE) != PWM_STREAM_SAMPLE) {
+		fn_pwm_stream_enable(0);
+		wake_up_interruptible(&g_pwm_stream_wait);
+		return IRQ_HANDLED;
+	}
+
+	__raw_writew(min(u16_cmp[0], g_u16_pwm_period), EHRPWM0_CMPA);
+	__raw_writew(min(u16_cmp[1], g_u16_pwm_period), EHRPWM0_CMPB);
+
+	if (kfifo_avail(&g_pwm_stream_fifo) >= PWM_STREAM_FIFO_SIZE / 2)
+		wake_up_interruptible(&g_pwm_stream_wait);
+
+	return IRQ_HANDLED;
+}
+
+static ssize_t am1808_pwm_write(struct file *file, const char __user *buf,
+		size_t count, loff_t *ppos)
+{
+	unsigned int copied;
+
+	if (!g_u8_pwm_on)
+		return -EIO;
+
+	count -= count % PWM_STREAM_SAMPLE;
+	if (!count)
+		return -EINVAL;
+
+	if (mutex_lock_interruptible(&g_pwm_stream_mutex))
+		return -ERESTARTSYS;
+
+	while (kfifo_is_full(&g_pwm_stream_fifo)) {
+		mutex_unlock(&g_pwm_stream_mutex);
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (wait_event_interruptible(g_pwm_stream_wait,
+				!kfifo_is_full(&g_pwm_stream_fifo)))
+			return -ERESTARTSYS;
+		if (mutex_lock_interruptible(&g_pwm_stream_mutex))
+			return -ERESTARTSYS;
+	}
+
+	copied = kfifo_from_user(&g_pwm_stream_fifo, buf, count);
+	mutex_unlock(&g_pwm_stream_mutex);
+
+	if (!copied)
+		return -EFAULT;
+
+	fn_pwm_stream_enable(1);
+	return copied;
+}
+
+static void fn_pwm_stream_flush(void)
+{
+	fn_pwm_stream_enable(0);
+	mutex_lock(&g_pwm_stream_mutex);
+	kfifo_reset(&g_pwm_stream_fifo);
+	mutex_unlock(&g_pwm_stream_mutex);
+	wake_up_interruptible(&g_pwm_stream_wait);
+}
+
+// sysfs: update_rate, 每秒装入的比较值个数(取PWM频率的整数分频)
+static ssize_t update_rate_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n",
+			g_u32_pwm_output_freq / g_u32_pwm_update_div);
+}
+
+static ssize_t update_rate_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	unsigned long rate;
+
+	if (strict_strtoul(buf, 0, &rate) || !rate)
+		return -EINVAL;
+	if (!g_u32_pwm_output_freq)
+		return -EIO;
+
+	g_u32_pwm_update_div = max(g_u32_pwm_output_freq / rate, 1UL);
+	g_u32_pwm_update_count = g_u32_pwm_update_div;
+	return count;
+}
+static DEVICE_ATTR(update_rate, S_IRUGO | S_IWUSR,
+		update_rate_show, update_rate_store);
+
 // PWM输出关闭
 void fn_pwm_exit(void)
 {
 	unsigned short u16_tmp;	
 	g_u8_pwm_on = 0;
+	fn_pwm_stream_flush();
 	u16_tmp = __raw_readw(CFGCHIP1);
 	u16_tmp &= (~CFGCHIP1_TBCLKSYNC);
 	__raw_writew(u16_tmp, CFGCHIP1);		
@@ -240,6 +390,9 @@ static int am1808_led_ioctl(
 				printk("pwm is off\n");
 			}
 			break;      
+			case SET_PWM_STREAM_FLUSH:
+			fn_pwm_stream_flush();
+			break;
        		default:
       		 printk("cmd may be 2 3 4 5 \n");
        		return -EINVAL; 
@@ -253,6 +406,7 @@ static int am1808_led_ioctl(
 static struct file_operations dev_fops = { 
  	.owner = THIS_MODULE, 
  	.ioctl = am1808_led_ioctl, 
+ 	.write = am1808_pwm_write, 
 }; 
   
 //  把 LED驱动注册为 MISC 设备 
@@ -291,15 +445,41 @@ static int __init dev_init(void)
 		//g_u32_pwm_output_freq = 38000;
         //fn_pwm_init();
 
+		ret = kfifo_alloc(&g_pwm_stream_fifo, PWM_STREAM_FIFO_SIZE,
+				GFP_KERNEL);
+		if (ret)
+			return ret;
+
+		ret = request_irq(IRQ_DA8XX_EHRPWM0, fn_pwm_stream_irq, 0,
+				DEVICE_NAME, NULL);
+		if (ret)
+			goto err_irq;
+
     	// 注册设备 
     	ret = misc_register(&misc); 
+		if (ret)
+			goto err_misc;
+
+		if (device_create_file(misc.this_device, &dev_attr_update_rate))
+			printk(KERN_WARNING DEVICE_NAME": no update_rate knob\n");
+
     	printk (DEVICE_NAME"\tinitialized\n"); //打印初始化信息 
-    	return ret; 
+    	return 0; 
+
+err_misc:
+		free_irq(IRQ_DA8XX_EHRPWM0, NULL);
+err_irq:
+		kfifo_free(&g_pwm_stream_fifo);
+		return ret;
 } 
  
 static void __exit dev_exit(void) 
 { 
+		device_remove_file(misc.this_device, &dev_attr_update_rate);
    	misc_deregister(&misc); 
+		fn_pwm_stream_enable(0);
+		free_irq(IRQ_DA8XX_EHRPWM0, NULL);
+		kfifo_free(&g_pwm_stream_fifo);
 } 
  
 // 模块初始化，仅当使用 insmod/podprobe 命令加载时有用，
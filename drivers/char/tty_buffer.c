@@ -16,6 +16,19 @@
 #include <linux/bitops.h>
 #include <linux/delay.h>
 #include <linux/module.h>
+#include <linux/workqueue.h>
+
+/*
+ * Pushes from interrupt context for low_latency ttys are handed to this
+ * SCHED_FIFO worker at once instead of to keventd a jiffy later, so a
+ * reader wakes within tens of microseconds of the receive interrupt.
+ */
+static struct workqueue_struct *tty_flip_wq;
+
+static int flip_prio = 50;
+module_param(flip_prio, int, S_IRUGO);
+MODULE_PARM_DESC(flip_prio,
+	"SCHED_FIFO priority of the low_latency flip worker (default: 50)");
 
 /**
  *	tty_buffer_free_all		-	free buffers used by a tty
@@ -475,13 +488,16 @@ void tty_flush_to_ldisc(struct tty_struct *tty)
  *	tty_flip_buffer_push	-	terminal
  *	@tty: tty to push
  *
- *	Queue a push of the terminal flip buffers to the line discipline. This
- *	function must not be called from IRQ context if tty->low_latency is set.
+ *	Queue a push of the terminal flip buffers to the line discipline.
+ *	If tty->low_latency is set the push is done at once: directly when
+ *	called from process context, such as a threaded interrupt handler,
+ *	and by the real time flip worker when called from IRQ context.
  *
  *	In the event of the queue being busy for flipping the work will be
  *	held off and retried later.
  *
- *	Locking: tty buffer lock. Driver locks in low latency mode.
+ *	Locking: tty buffer lock. Driver locks in low latency mode when not
+ *	called from IRQ context.
  */
 
 void tty_flip_buffer_push(struct tty_struct *tty)
@@ -492,10 +508,14 @@ void tty_flip_buffer_push(struct tty_struct *tty)
 		tty->buf.tail->commit = tty->buf.tail->used;
 	spin_unlock_irqrestore(&tty->buf.lock, flags);
 
-	if (tty->low_latency)
+	if (!tty->low_latency)
+		schedule_delayed_work(&tty->buf.work, 1);
+	else if (!in_interrupt())
 		flush_to_ldisc(&tty->buf.work.work);
+	else if (tty_flip_wq)
+		queue_delayed_work(tty_flip_wq, &tty->buf.work, 0);
 	else
-		schedule_delayed_work(&tty->buf.work, 1);
+		schedule_delayed_work(&tty->buf.work, 0);
 }
 EXPORT_SYMBOL(tty_flip_buffer_push);
 
@@ -519,3 +539,29 @@ void tty_buffer_init(struct tty_struct *tty)
 	INIT_DELAYED_WORK(&tty->buf.work, flush_to_ldisc);
 }
 
+static void __init tty_flip_set_prio(struct work_struct *work)
+{
+	struct sched_param param = { .sched_priority = flip_prio };
+
+	if (sched_setscheduler(current, SCHED_FIFO, &param))
+		printk(KERN_WARNING "tty: flip worker stays SCHED_OTHER\n");
+}
+
+static int __init tty_flip_wq_init(void)
+{
+	struct work_struct work;
+
+	tty_flip_wq = create_singlethread_workqueue("tty_flip");
+	if (!tty_flip_wq)
+		return -ENOMEM;
+
+	if (flip_prio > 0 && flip_prio < MAX_RT_PRIO) {
+		INIT_WORK_ON_STACK(&work, tty_flip_set_prio);
+		queue_work(tty_flip_wq, &work);
+		flush_workqueue(tty_flip_wq);
+		destroy_work_on_stack(&work);
+	}
+	return 0;
+}
+core_initcall(tty_flip_wq_init);
+
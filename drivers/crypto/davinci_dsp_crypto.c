@@ -0,0 +1,581 @@
+/*
+ * AES and SHA-256 offload to the C674x DSP of OMAP-L138/AM1808
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Requests of at least dsp_min_bytes are copied into the ARM/DSP buffer
+ * exchange and queued to the DSP firmware, up to DSP_CRYPTO_BATCH per
+ * kick; the answer comes back through the exchange's tasklet.  Smaller
+ * requests, requests arriving before the firmware is up, and requests
+ * that find the shared buffers or the ring full run on the ARM with the
+ * generic implementation, as do the incremental hash operations: only
+ * one-shot digests are offloaded.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/interrupt.h>
+#include <linux/spinlock.h>
+#include <linux/scatterlist.h>
+#include <linux/crypto.h>
+#include <linux/davinci_dsp_ipc.h>
+#include <linux/davinci_dsp_crypto.h>
+
+#include <crypto/aes.h>
+#include <crypto/sha.h>
+#include <crypto/algapi.h>
+#include <crypto/internal/hash.h>
+
+/* requests with the DSP at once, and queued per kick */
+#define DSP_CRYPTO_SLOTS	32
+#define DSP_CRYPTO_BATCH	8
+
+#define DSP_CRYPTO_QUEUE_LEN	100
+
+static unsigned int dsp_min_bytes = 2048;
+module_param(dsp_min_bytes, uint, 0644);
+MODULE_PARM_DESC(dsp_min_bytes,
+	"Smallest request handed to the DSP, in bytes (default 2048)");
+
+struct dsp_aes_ctx {
+	u8			key[AES_MAX_KEY_SIZE];
+	unsigned int		keylen;
+	struct crypto_blkcipher	*fallback;
+};
+
+struct dsp_sha_ctx {
+	struct crypto_shash	*fallback;
+};
+
+struct dsp_crypto_reqctx {
+	u32			op;
+	/* ahash only, the state of init/update/final; must be last */
+	struct shash_desc	fallback;
+};
+
+struct dsp_crypto_slot {
+	struct crypto_async_request	*areq;
+	struct dsp_crypto_req		*hdr;
+	u32				offset;
+	size_t				size;
+};
+
+static struct {
+	struct dsp_ipc		*ipc;
+	spinlock_t		lock;
+	struct crypto_queue	queue;
+	struct tasklet_struct	tasklet;
+	struct dsp_crypto_slot	slot[DSP_CRYPTO_SLOTS];
+} dc;
+
+static inline bool dsp_crypto_is_hash(struct crypto_async_request *areq)
+{
+	return crypto_tfm_alg_type(areq->tfm) == CRYPTO_ALG_TYPE_AHASH;
+}
+
+static unsigned int dsp_crypto_nents(struct scatterlist *sg,
+				     unsigned int nbytes)
+{
+	unsigned int n = 0;
+
+	while (sg && nbytes) {
+		nbytes -= min(nbytes, sg->length);
+		sg = sg_next(sg);
+		n++;
+	}
+	return n;
+}
+
+static int dsp_aes_fallback(struct ablkcipher_request *req, u32 op)
+{
+	struct dsp_aes_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
+	struct blkcipher_desc desc = {
+		.tfm	= ctx->fallback,
+		.info	= req->info,
+		/* also runs from the submit tasklet */
+		.flags	= req->base.flags & ~CRYPTO_TFM_REQ_MAY_SLEEP,
+	};
+
+	if (op == DSP_CRYPTO_AES_ECB_ENCRYPT ||
+	    op == DSP_CRYPTO_AES_CBC_ENCRYPT)
+		return crypto_blkcipher_encrypt_iv(&desc, req->dst, req->src,
+						   req->nbytes);
+	return crypto_blkcipher_decrypt_iv(&desc, req->dst, req->src,
+					   req->nbytes);
+}
+
+static int dsp_sha_fallback_digest(struct ahash_request *req)
+{
+	struct dsp_sha_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
+	struct dsp_crypto_reqctx *rctx = ahash_request_ctx(req);
+
+	rctx->fallback.tfm = ctx->fallback;
+	rctx->fallback.flags = 0;
+	return shash_ahash_digest(req, &rctx->fallback);
+}
+
+static int dsp_crypto_fallback(struct crypto_async_request *areq)
+{
+	struct ablkcipher_request *req;
+
+	if (dsp_crypto_is_hash(areq))
+		return dsp_sha_fallback_digest(ahash_request_cast(areq));
+
+	req = ablkcipher_request_cast(areq);
+	return dsp_aes_fallback(req,
+			((struct dsp_crypto_reqctx *)
+			 ablkcipher_request_ctx(req))->op);
+}
+
+/* Copies the request into a shared buffer and fills in its descriptor */
+static int dsp_crypto_load(struct dsp_crypto_slot *s,
+			   struct dsp_ipc_desc *desc)
+{
+	struct crypto_async_request *areq = s->areq;
+	struct dsp_crypto_reqctx *rctx;
+	struct dsp_crypto_req *hdr;
+	struct scatterlist *src;
+	unsigned int nbytes;
+
+	if (dsp_crypto_is_hash(areq)) {
+		struct ahash_request *req = ahash_request_cast(areq);
+
+		rctx = ahash_request_ctx(req);
+		src = req->src;
+		nbytes = req->nbytes;
+	} else {
+		struct ablkcipher_request *req = ablkcipher_request_cast(areq);
+
+		rctx = ablkcipher_request_ctx(req);
+		src = req->src;
+		nbytes = req->nbytes;
+	}
+
+	s->size = sizeof(*hdr) + nbytes;
+	hdr = dsp_ipc_alloc(dc.ipc, s->size, &s->offset);
+	if (!hdr)
+		return -ENOMEM;
+
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->op = rctx->op;
+	hdr->len = nbytes;
+	if (!dsp_crypto_is_hash(areq)) {
+		struct ablkcipher_request *req = ablkcipher_request_cast(areq);
+		struct dsp_aes_ctx *ctx = crypto_tfm_ctx(areq->tfm);
+
+		hdr->keylen = ctx->keylen;
+		memcpy(hdr->key, ctx->key, ctx->keylen);
+		if (rctx->op == DSP_CRYPTO_AES_CBC_ENCRYPT ||
+		    rctx->op == DSP_CRYPTO_AES_CBC_DECRYPT)
+			memcpy(hdr->iv, req->info, AES_BLOCK_SIZE);
+	}
+	sg_copy_to_buffer(src, dsp_crypto_nents(src, nbytes), hdr + 1, nbytes);
+
+	s->hdr = hdr;
+	desc->offset = s->offset;
+	desc->len = s->size;
+	desc->cookie = s - dc.slot;
+	desc->flags = DSP_CRYPTO_SERVICE;
+	return 0;
+}
+
+static void dsp_crypto_put_slot(struct dsp_crypto_slot *s)
+{
+	if (s->hdr)
+		dsp_ipc_free(dc.ipc, s->offset, s->size);
+	s->hdr = NULL;
+	spin_lock_bh(&dc.lock);
+	s->areq = NULL;
+	spin_unlock_bh(&dc.lock);
+}
+
+/* Runs the request on the ARM after all and completes it */
+static void dsp_crypto_finish_on_arm(struct dsp_crypto_slot *s)
+{
+	struct crypto_async_request *areq = s->areq;
+
+	dsp_crypto_put_slot(s);
+	areq->complete(areq, dsp_crypto_fallback(areq));
+}
+
+static void dsp_crypto_submit(unsigned long data)
+{
+	struct crypto_async_request *areq, *backlog;
+	struct dsp_crypto_slot *batch[DSP_CRYPTO_BATCH];
+	struct dsp_ipc_desc desc[DSP_CRYPTO_BATCH];
+	unsigned int n = 0, sent = 0, i = 0;
+
+	while (n < DSP_CRYPTO_BATCH) {
+		spin_lock_bh(&dc.lock);
+		while (i < DSP_CRYPTO_SLOTS && dc.slot[i].areq)
+			i++;
+		if (i == DSP_CRYPTO_SLOTS) {
+			spin_unlock_bh(&dc.lock);
+			break;
+		}
+		backlog = crypto_get_backlog(&dc.queue);
+		areq = crypto_dequeue_request(&dc.queue);
+		if (areq)
+			dc.slot[i].areq = areq;
+		spin_unlock_bh(&dc.lock);
+
+		if (!areq)
+			break;
+		if (backlog)
+			backlog->complete(backlog, -EINPROGRESS);
+		batch[n++] = &dc.slot[i];
+	}
+
+	for (i = 0; i < n; i++) {
+		if (dsp_crypto_load(batch[i], &desc[sent])) {
+			/* out of shared buffer space */
+			dsp_crypto_finish_on_arm(batch[i]);
+			continue;
+		}
+		batch[sent++] = batch[i];
+	}
+
+	if (sent && dsp_ipc_send(dc.ipc, desc, sent))
+		for (i = 0; i < sent; i++)
+			dsp_crypto_finish_on_arm(batch[i]);
+}
+
+static void dsp_crypto_rx(void *data, const struct dsp_ipc_desc *desc)
+{
+	struct crypto_async_request *areq;
+	struct dsp_crypto_slot *s;
+	struct dsp_crypto_req *hdr;
+	int err;
+
+	if (desc->flags != DSP_CRYPTO_SERVICE ||
+	    desc->cookie >= DSP_CRYPTO_SLOTS)
+		return;
+	s = &dc.slot[desc->cookie];
+	areq = s->areq;
+	hdr = s->hdr;
+	if (!areq || !hdr)
+		return;
+
+	err = hdr->status;
+	if (!err && dsp_crypto_is_hash(areq)) {
+		struct ahash_request *req = ahash_request_cast(areq);
+
+		memcpy(req->result, hdr->digest, SHA256_DIGEST_SIZE);
+	} else if (!err) {
+		struct ablkcipher_request *req = ablkcipher_request_cast(areq);
+		struct dsp_crypto_reqctx *rctx = ablkcipher_request_ctx(req);
+
+		sg_copy_from_buffer(req->dst,
+				    dsp_crypto_nents(req->dst, req->nbytes),
+				    hdr + 1, req->nbytes);
+		if (rctx->op == DSP_CRYPTO_AES_CBC_ENCRYPT ||
+		    rctx->op == DSP_CRYPTO_AES_CBC_DECRYPT)
+			memcpy(req->info, hdr->iv, AES_BLOCK_SIZE);
+	}
+
+	dsp_crypto_put_slot(s);
+	areq->complete(areq, err);
+
+	/* a slot is free again */
+	tasklet_schedule(&dc.tasklet);
+}
+
+static int dsp_crypto_enqueue(struct crypto_async_request *areq)
+{
+	int ret;
+
+	spin_lock_bh(&dc.lock);
+	ret = crypto_enqueue_request(&dc.queue, areq);
+	spin_unlock_bh(&dc.lock);
+
+	tasklet_schedule(&dc.tasklet);
+	return ret;
+}
+
+static int dsp_aes_crypt(struct ablkcipher_request *req, u32 op)
+{
+	struct dsp_crypto_reqctx *rctx = ablkcipher_request_ctx(req);
+
+	if (req->nbytes < dsp_min_bytes || !dsp_ipc_dsp_ready(dc.ipc))
+		return dsp_aes_fallback(req, op);
+	if (req->nbytes % AES_BLOCK_SIZE)
+		return -EINVAL;
+
+	rctx->op = op;
+	return dsp_crypto_enqueue(&req->base);
+}
+
+static int dsp_aes_ecb_encrypt(struct ablkcipher_request *req)
+{
+	return dsp_aes_crypt(req, DSP_CRYPTO_AES_ECB_ENCRYPT);
+}
+
+static int dsp_aes_ecb_decrypt(struct ablkcipher_request *req)
+{
+	return dsp_aes_crypt(req, DSP_CRYPTO_AES_ECB_DECRYPT);
+}
+
+static int dsp_aes_cbc_encrypt(struct ablkcipher_request *req)
+{
+	return dsp_aes_crypt(req, DSP_CRYPTO_AES_CBC_ENCRYPT);
+}
+
+static int dsp_aes_cbc_decrypt(struct ablkcipher_request *req)
+{
+	return dsp_aes_crypt(req, DSP_CRYPTO_AES_CBC_DECRYPT);
+}
+
+static int dsp_aes_setkey(struct crypto_ablkcipher *cipher, const u8 *key,
+			  unsigned int len)
+{
+	struct dsp_aes_ctx *ctx = crypto_ablkcipher_ctx(cipher);
+	int ret;
+
+	if (len != AES_KEYSIZE_128 && len != AES_KEYSIZE_192 &&
+	    len != AES_KEYSIZE_256) {
+		crypto_ablkcipher_set_flags(cipher,
+					    CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	memcpy(ctx->key, key, len);
+	ctx->keylen = len;
+
+	crypto_blkcipher_clear_flags(ctx->fallback, CRYPTO_TFM_REQ_MASK);
+	crypto_blkcipher_set_flags(ctx->fallback,
+			crypto_ablkcipher_get_flags(cipher) &
+			CRYPTO_TFM_REQ_MASK);
+	ret = crypto_blkcipher_setkey(ctx->fallback, key, len);
+	if (ret) {
+		crypto_ablkcipher_clear_flags(cipher, CRYPTO_TFM_RES_MASK);
+		crypto_ablkcipher_set_flags(cipher,
+				crypto_blkcipher_get_flags(ctx->fallback) &
+				CRYPTO_TFM_RES_MASK);
+	}
+	return ret;
+}
+
+static int dsp_aes_cra_init(struct crypto_tfm *tfm)
+{
+	struct dsp_aes_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	ctx->fallback = crypto_alloc_blkcipher(tfm->__crt_alg->cra_name, 0,
+			CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback))
+		return PTR_ERR(ctx->fallback);
+
+	tfm->crt_ablkcipher.reqsize = sizeof(struct dsp_crypto_reqctx);
+	return 0;
+}
+
+static void dsp_aes_cra_exit(struct crypto_tfm *tfm)
+{
+	struct dsp_aes_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_blkcipher(ctx->fallback);
+}
+
+static struct crypto_alg dsp_aes_algs[] = {
+{
+	.cra_name		= "ecb(aes)",
+	.cra_driver_name	= "davinci-dsp-ecb-aes",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC |
+				  CRYPTO_ALG_NEED_FALLBACK,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct dsp_aes_ctx),
+	.cra_type		= &crypto_ablkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_init		= dsp_aes_cra_init,
+	.cra_exit		= dsp_aes_cra_exit,
+	.cra_u.ablkcipher	= {
+		.min_keysize	= AES_MIN_KEY_SIZE,
+		.max_keysize	= AES_MAX_KEY_SIZE,
+		.setkey		= dsp_aes_setkey,
+		.encrypt	= dsp_aes_ecb_encrypt,
+		.decrypt	= dsp_aes_ecb_decrypt,
+	},
+}, {
+	.cra_name		= "cbc(aes)",
+	.cra_driver_name	= "davinci-dsp-cbc-aes",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER | CRYPTO_ALG_ASYNC |
+				  CRYPTO_ALG_NEED_FALLBACK,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct dsp_aes_ctx),
+	.cra_type		= &crypto_ablkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_init		= dsp_aes_cra_init,
+	.cra_exit		= dsp_aes_cra_exit,
+	.cra_u.ablkcipher	= {
+		.min_keysize	= AES_MIN_KEY_SIZE,
+		.max_keysize	= AES_MAX_KEY_SIZE,
+		.ivsize		= AES_BLOCK_SIZE,
+		.setkey		= dsp_aes_setkey,
+		.encrypt	= dsp_aes_cbc_encrypt,
+		.decrypt	= dsp_aes_cbc_decrypt,
+	},
+},
+};
+
+static int dsp_sha_init(struct ahash_request *req)
+{
+	struct dsp_sha_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
+	struct dsp_crypto_reqctx *rctx = ahash_request_ctx(req);
+
+	rctx->fallback.tfm = ctx->fallback;
+	rctx->fallback.flags = req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP;
+	return crypto_shash_init(&rctx->fallback);
+}
+
+static int dsp_sha_update(struct ahash_request *req)
+{
+	struct dsp_crypto_reqctx *rctx = ahash_request_ctx(req);
+
+	return shash_ahash_update(req, &rctx->fallback);
+}
+
+static int dsp_sha_final(struct ahash_request *req)
+{
+	struct dsp_crypto_reqctx *rctx = ahash_request_ctx(req);
+
+	return crypto_shash_final(&rctx->fallback, req->result);
+}
+
+static int dsp_sha_finup(struct ahash_request *req)
+{
+	struct dsp_crypto_reqctx *rctx = ahash_request_ctx(req);
+
+	return shash_ahash_finup(req, &rctx->fallback);
+}
+
+static int dsp_sha_digest(struct ahash_request *req)
+{
+	struct dsp_crypto_reqctx *rctx = ahash_request_ctx(req);
+
+	if (req->nbytes < dsp_min_bytes || !dsp_ipc_dsp_ready(dc.ipc))
+		return dsp_sha_fallback_digest(req);
+
+	rctx->op = DSP_CRYPTO_SHA256;
+	return dsp_crypto_enqueue(&req->base);
+}
+
+static int dsp_sha_export(struct ahash_request *req, void *out)
+{
+	struct dsp_crypto_reqctx *rctx = ahash_request_ctx(req);
+
+	return crypto_shash_export(&rctx->fallback, out);
+}
+
+static int dsp_sha_import(struct ahash_request *req, const void *in)
+{
+	struct dsp_sha_ctx *ctx = crypto_tfm_ctx(req->base.tfm);
+	struct dsp_crypto_reqctx *rctx = ahash_request_ctx(req);
+
+	rctx->fallback.tfm = ctx->fallback;
+	rctx->fallback.flags = req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP;
+	return crypto_shash_import(&rctx->fallback, in);
+}
+
+static int dsp_sha_cra_init(struct crypto_tfm *tfm)
+{
+	struct dsp_sha_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	ctx->fallback = crypto_alloc_shash("sha256", 0,
+					   CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback))
+		return PTR_ERR(ctx->fallback);
+
+	crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm),
+			sizeof(struct dsp_crypto_reqctx) +
+			crypto_shash_descsize(ctx->fallback));
+	return 0;
+}
+
+static void dsp_sha_cra_exit(struct crypto_tfm *tfm)
+{
+	struct dsp_sha_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_shash(ctx->fallback);
+}
+
+static struct ahash_alg dsp_sha256_alg = {
+	.init		= dsp_sha_init,
+	.update		= dsp_sha_update,
+	.final		= dsp_sha_final,
+	.finup		= dsp_sha_finup,
+	.digest		= dsp_sha_digest,
+	.export		= dsp_sha_export,
+	.import		= dsp_sha_import,
+	.halg = {
+		.digestsize	= SHA256_DIGEST_SIZE,
+		.statesize	= sizeof(struct sha256_state),
+		.base = {
+			.cra_name		= "sha256",
+			.cra_driver_name	= "davinci-dsp-sha256",
+			.cra_priority		= 300,
+			.cra_flags		= CRYPTO_ALG_TYPE_AHASH |
+						  CRYPTO_ALG_ASYNC |
+						  CRYPTO_ALG_NEED_FALLBACK,
+			.cra_blocksize		= SHA256_BLOCK_SIZE,
+			.cra_ctxsize		= sizeof(struct dsp_sha_ctx),
+			.cra_module		= THIS_MODULE,
+			.cra_init		= dsp_sha_cra_init,
+			.cra_exit		= dsp_sha_cra_exit,
+		},
+	},
+};
+
+static int __init dsp_crypto_init(void)
+{
+	int ret, i;
+
+	spin_lock_init(&dc.lock);
+	crypto_init_queue(&dc.queue, DSP_CRYPTO_QUEUE_LEN);
+	tasklet_init(&dc.tasklet, dsp_crypto_submit, 0);
+
+	dc.ipc = dsp_ipc_claim(dsp_crypto_rx, NULL);
+	if (IS_ERR(dc.ipc))
+		return PTR_ERR(dc.ipc);
+
+	for (i = 0; i < ARRAY_SIZE(dsp_aes_algs); i++) {
+		ret = crypto_register_alg(&dsp_aes_algs[i]);
+		if (ret)
+			goto err_aes;
+	}
+	ret = crypto_register_ahash(&dsp_sha256_alg);
+	if (ret)
+		goto err_aes;
+
+	pr_info("davinci-dsp-crypto: AES and SHA-256 from %u bytes%s\n",
+		dsp_min_bytes, dsp_ipc_dsp_ready(dc.ipc) ? "" :
+		", DSP not running yet");
+	return 0;
+
+err_aes:
+	while (--i >= 0)
+		crypto_unregister_alg(&dsp_aes_algs[i]);
+	dsp_ipc_unclaim(dc.ipc);
+	return ret;
+}
+module_init(dsp_crypto_init);
+
+static void __exit dsp_crypto_exit(void)
+{
+	int i;
+
+	/* no transform is left, so neither is any request */
+	crypto_unregister_ahash(&dsp_sha256_alg);
+	for (i = 0; i < ARRAY_SIZE(dsp_aes_algs); i++)
+		crypto_unregister_alg(&dsp_aes_algs[i]);
+	tasklet_kill(&dc.tasklet);
+	dsp_ipc_unclaim(dc.ipc);
+}
+module_exit(dsp_crypto_exit);
+
+MODULE_DESCRIPTION("AES and SHA-256 offload to the DA8xx C674x DSP");
+MODULE_LICENSE("GPL");
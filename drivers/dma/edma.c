@@ -0,0 +1,777 @@
+/*
+ * dmaengine front end for the TI DaVinci EDMA3 channel controller
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The EDMA channel and PaRAM slot allocator lives in
+ * arch/arm/mach-davinci/dma.c; this driver only builds PaRAM sets for
+ * dmaengine descriptors and hands them to that allocator.
+ *
+ * Each dmaengine channel owns one EDMA channel.  A descriptor is a list
+ * of PaRAM sets: the first one is loaded into the channel's own slot and
+ * the rest go into slots allocated at prep time and linked behind it.
+ * Memcpy channels use software triggered channels and chain each set to
+ * the next one; slave channels use the peripheral's event channel and
+ * let the hardware events pace the transfer.  Cyclic descriptors link
+ * the last set back to the first and interrupt after every period.
+ */
+
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+#include <linux/interrupt.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+
+#include <asm/sizes.h>
+
+#include <mach/edma.h>
+
+/* largest A count used for memcpy; B count covers the rest */
+#define EDMA_DMA_MAX_ACNT	SZ_16K
+#define EDMA_DMA_MAX_CNT	USHORT_MAX
+
+static unsigned int nr_channels = 8;
+module_param(nr_channels, uint, 0444);
+MODULE_PARM_DESC(nr_channels, "number of dmaengine channels (default: 8)");
+
+struct edma_dma_set {
+	struct edmacc_param	param;
+	int			slot;		/* -1: the channel's own slot */
+};
+
+struct edma_desc {
+	struct dma_async_tx_descriptor	txd;
+	struct list_head		node;
+	dma_addr_t			src;
+	dma_addr_t			dst;
+	size_t				len;
+	bool				cyclic;
+	unsigned			nr_sets;
+	struct edma_dma_set		sets[0];
+};
+
+struct edma_chan {
+	struct dma_chan		chan;
+	int			ch_num;		/* EDMA channel, or -1 */
+	struct edma_dma_slave	*slave;
+
+	spinlock_t		lock;
+	struct edma_desc	*active;
+	struct list_head	queue;		/* submitted, not started */
+	struct list_head	free_list;	/* done, waiting for ack */
+	dma_cookie_t		completed_cookie;
+
+	struct tasklet_struct	tasklet;
+	atomic_t		periods;	/* completions not yet handled */
+	unsigned long		error;
+};
+
+struct edma_engine {
+	struct dma_device	dma;
+	struct edma_chan	*chans;
+};
+
+static const struct edmacc_param edma_dma_dummy = {
+	.link_bcntrld	= 0xffff,
+	.ccnt		= 1,
+};
+
+static inline struct edma_chan *to_edma_chan(struct dma_chan *chan)
+{
+	return container_of(chan, struct edma_chan, chan);
+}
+
+static inline struct edma_desc *to_edma_desc(struct dma_async_tx_descriptor *tx)
+{
+	return container_of(tx, struct edma_desc, txd);
+}
+
+static inline struct device *chan2dev(struct dma_chan *chan)
+{
+	return &chan->dev->device;
+}
+
+static dma_cookie_t edma_dma_tx_submit(struct dma_async_tx_descriptor *tx);
+
+/*----------------------------------------------------------------------*/
+
+/* Called with echan->lock held */
+static void edma_dma_reap(struct edma_chan *echan)
+{
+	struct edma_desc *desc, *_desc;
+
+	list_for_each_entry_safe(desc, _desc, &echan->free_list, node) {
+		if (async_tx_test_ack(&desc->txd)) {
+			list_del(&desc->node);
+			kfree(desc);
+		}
+	}
+}
+
+static void edma_dma_free_slots(struct edma_desc *desc)
+{
+	unsigned i;
+
+	for (i = 0; i < desc->nr_sets; i++) {
+		if (desc->sets[i].slot >= 0) {
+			edma_free_slot(desc->sets[i].slot);
+			desc->sets[i].slot = -1;
+		}
+	}
+}
+
+/**
+ * edma_dma_desc_alloc - allocate a descriptor and its link slots
+ * @echan: channel the descriptor will run on
+ * @nr_sets: number of PaRAM sets the transfer needs
+ * @cyclic: whether the sets form a ring
+ *
+ * Non-cyclic descriptors load their first set straight into the
+ * channel slot and need one slot less.  Prep callbacks may run in
+ * atomic context, so everything is allocated without sleeping.
+ */
+static struct edma_desc *edma_dma_desc_alloc(struct edma_chan *echan,
+		unsigned nr_sets, bool cyclic)
+{
+	struct edma_desc *desc;
+	unsigned ctlr = EDMA_CTLR(echan->ch_num);
+	unsigned i;
+	int slot;
+
+	spin_lock_bh(&echan->lock);
+	edma_dma_reap(echan);
+	spin_unlock_bh(&echan->lock);
+
+	desc = kzalloc(sizeof(*desc) + nr_sets * sizeof(desc->sets[0]),
+			GFP_ATOMIC);
+	if (!desc)
+		return NULL;
+
+	desc->nr_sets = nr_sets;
+	desc->cyclic = cyclic;
+	for (i = 0; i < nr_sets; i++)
+		desc->sets[i].slot = -1;
+
+	for (i = cyclic ? 0 : 1; i < nr_sets; i++) {
+		slot = edma_alloc_slot(ctlr, EDMA_SLOT_ANY);
+		if (slot < 0) {
+			dev_dbg(chan2dev(&echan->chan),
+				"out of PaRAM slots (%u sets)\n", nr_sets);
+			edma_dma_free_slots(desc);
+			kfree(desc);
+			return NULL;
+		}
+		desc->sets[i].slot = slot;
+	}
+
+	dma_async_tx_descriptor_init(&desc->txd, &echan->chan);
+	desc->txd.tx_submit = edma_dma_tx_submit;
+	INIT_LIST_HEAD(&desc->node);
+
+	return desc;
+}
+
+static void edma_dma_fill(struct edmacc_param *p, u32 opt,
+		dma_addr_t src, dma_addr_t dst, u16 acnt, u16 bcnt, u16 ccnt,
+		s16 src_bidx, s16 dst_bidx, s16 src_cidx, s16 dst_cidx)
+{
+	p->opt = opt;
+	p->src = src;
+	p->dst = dst;
+	p->a_b_cnt = (bcnt << 16) | acnt;
+	p->src_dst_bidx = ((u16)dst_bidx << 16) | (u16)src_bidx;
+	p->src_dst_cidx = ((u16)dst_cidx << 16) | (u16)src_cidx;
+	p->link_bcntrld = 0xffff;
+	p->ccnt = ccnt;
+}
+
+/**
+ * edma_dma_start - load a descriptor into PaRAM and trigger the channel
+ * @echan: idle channel
+ * @desc: descriptor to run
+ *
+ * Link slots are written back to front so the channel slot, written
+ * last, never points at a half programmed set.
+ *
+ * Called with echan->lock held
+ */
+static void edma_dma_start(struct edma_chan *echan, struct edma_desc *desc)
+{
+	unsigned n = desc->nr_sets;
+	int i, next, slot;
+
+	for (i = n - 1; i >= 0; i--) {
+		if (i + 1 < n)
+			next = desc->sets[i + 1].slot;
+		else
+			next = desc->cyclic ? desc->sets[0].slot : -1;
+
+		slot = desc->sets[i].slot;
+		if (slot >= 0) {
+			edma_write_slot(slot, &desc->sets[i].param);
+			if (next >= 0)
+				edma_link(slot, next);
+		}
+		if (i == 0) {
+			edma_write_slot(echan->ch_num, &desc->sets[0].param);
+			if (next >= 0)
+				edma_link(echan->ch_num, next);
+		}
+	}
+
+	echan->active = desc;
+	edma_start(echan->ch_num);
+}
+
+/* Called with echan->lock held */
+static void edma_dma_idle(struct edma_chan *echan)
+{
+	edma_stop(echan->ch_num);
+	edma_write_slot(echan->ch_num, &edma_dma_dummy);
+	echan->active = NULL;
+}
+
+static void edma_dma_unmap(struct edma_chan *echan, struct edma_desc *desc)
+{
+	struct device *dev = echan->chan.device->dev;
+	unsigned long flags = desc->txd.flags;
+
+	if (echan->slave)
+		return;
+
+	if (!(flags & DMA_COMPL_SKIP_DEST_UNMAP)) {
+		if (flags & DMA_COMPL_DEST_UNMAP_SINGLE)
+			dma_unmap_single(dev, desc->dst, desc->len,
+					DMA_FROM_DEVICE);
+		else
+			dma_unmap_page(dev, desc->dst, desc->len,
+					DMA_FROM_DEVICE);
+	}
+	if (!(flags & DMA_COMPL_SKIP_SRC_UNMAP)) {
+		if (flags & DMA_COMPL_SRC_UNMAP_SINGLE)
+			dma_unmap_single(dev, desc->src, desc->len,
+					DMA_TO_DEVICE);
+		else
+			dma_unmap_page(dev, desc->src, desc->len,
+					DMA_TO_DEVICE);
+	}
+}
+
+/*--  IRQ & Tasklet  ---------------------------------------------------*/
+
+static void edma_dma_callback(unsigned ch_num, u16 ch_status, void *data)
+{
+	struct edma_chan *echan = data;
+
+	if (ch_status == DMA_CC_ERROR)
+		set_bit(0, &echan->error);
+	else
+		atomic_inc(&echan->periods);
+
+	tasklet_schedule(&echan->tasklet);
+}
+
+static void edma_dma_tasklet(unsigned long data)
+{
+	struct edma_chan *echan = (struct edma_chan *)data;
+	struct edma_desc *desc;
+	dma_async_tx_callback callback = NULL;
+	void *param = NULL;
+	int periods;
+
+	spin_lock_bh(&echan->lock);
+
+	periods = atomic_xchg(&echan->periods, 0);
+	desc = echan->active;
+	if (!desc)
+		goto out;
+
+	if (test_and_clear_bit(0, &echan->error)) {
+		/*
+		 * Event missed or null set reached.  The data is lost;
+		 * report the descriptor as done so clients don't hang,
+		 * and restart cyclic transfers where they were.
+		 */
+		dev_err(chan2dev(&echan->chan),
+			"transfer error, cookie %d\n", desc->txd.cookie);
+		edma_clean_channel(echan->ch_num);
+		if (desc->cyclic) {
+			edma_dma_start(echan, desc);
+			goto out;
+		}
+		periods = 1;
+	}
+
+	if (!periods)
+		goto out;
+
+	callback = desc->txd.callback;
+	param = desc->txd.callback_param;
+
+	if (desc->cyclic) {
+		spin_unlock_bh(&echan->lock);
+		while (callback && periods--)
+			callback(param);
+		return;
+	}
+
+	echan->completed_cookie = desc->txd.cookie;
+	edma_dma_idle(echan);
+	edma_dma_free_slots(desc);
+
+	/* keep the hardware busy before running the client's callback */
+	if (!list_empty(&echan->queue)) {
+		struct edma_desc *next;
+
+		next = list_first_entry(&echan->queue, struct edma_desc, node);
+		list_del(&next->node);
+		edma_dma_start(echan, next);
+	}
+
+	list_add_tail(&desc->node, &echan->free_list);
+	spin_unlock_bh(&echan->lock);
+
+	edma_dma_unmap(echan, desc);
+	if (callback)
+		callback(param);
+	dma_run_dependencies(&desc->txd);
+	return;
+
+out:
+	spin_unlock_bh(&echan->lock);
+}
+
+/*--  DMA Engine API  --------------------------------------------------*/
+
+static dma_cookie_t edma_dma_tx_submit(struct dma_async_tx_descriptor *tx)
+{
+	struct edma_desc *desc = to_edma_desc(tx);
+	struct edma_chan *echan = to_edma_chan(tx->chan);
+	dma_cookie_t cookie;
+
+	spin_lock_bh(&echan->lock);
+
+	cookie = echan->chan.cookie;
+	if (++cookie < 0)
+		cookie = 1;
+	echan->chan.cookie = cookie;
+	tx->cookie = cookie;
+
+	list_add_tail(&desc->node, &echan->queue);
+
+	spin_unlock_bh(&echan->lock);
+
+	return cookie;
+}
+
+/**
+ * edma_dma_prep_memcpy - prepare a memory to memory copy
+ * @chan: the channel to prepare operation on
+ * @dest: destination bus address
+ * @src: source bus address
+ * @len: operation length
+ * @flags: tx descriptor status flags
+ *
+ * The bulk of the copy is one AB-synchronized set of EDMA_DMA_MAX_ACNT
+ * byte arrays; any remainder goes in a second, chained set.
+ */
+static struct dma_async_tx_descriptor *
+edma_dma_prep_memcpy(struct dma_chan *chan, dma_addr_t dest, dma_addr_t src,
+		size_t len, unsigned long flags)
+{
+	struct edma_chan *echan = to_edma_chan(chan);
+	unsigned tcc = EDMA_TCC(EDMA_CHAN_SLOT(echan->ch_num));
+	struct edma_desc *desc;
+	size_t bulk, rest;
+	unsigned bcnt, i = 0;
+	u32 opt;
+
+	if (unlikely(!len))
+		return NULL;
+
+	if (len <= EDMA_DMA_MAX_CNT)
+		bcnt = 0;
+	else
+		bcnt = min_t(size_t, len / EDMA_DMA_MAX_ACNT, EDMA_DMA_MAX_CNT);
+	bulk = bcnt * EDMA_DMA_MAX_ACNT;
+	rest = len - bulk;
+	if (unlikely(rest > EDMA_DMA_MAX_CNT)) {
+		dev_dbg(chan2dev(chan), "memcpy of %zu bytes too long\n", len);
+		return NULL;
+	}
+
+	desc = edma_dma_desc_alloc(echan, (bulk ? 1 : 0) + (rest ? 1 : 0),
+			false);
+	if (!desc)
+		return NULL;
+
+	if (bulk) {
+		/* chain to ourselves so the remainder starts right away */
+		opt = tcc | SYNCDIM | (rest ? TCCHEN : TCINTEN);
+		edma_dma_fill(&desc->sets[i++].param, opt, src, dest,
+				EDMA_DMA_MAX_ACNT, bcnt, 1,
+				EDMA_DMA_MAX_ACNT, EDMA_DMA_MAX_ACNT, 0, 0);
+	}
+	if (rest)
+		edma_dma_fill(&desc->sets[i].param, tcc | SYNCDIM | TCINTEN,
+				src + bulk, dest + bulk, rest, 1, 1,
+				0, 0, 0, 0);
+
+	desc->src = src;
+	desc->dst = dest;
+	desc->len = len;
+	desc->txd.flags = flags;
+
+	return &desc->txd;
+}
+
+/*
+ * Fill one slave set moving @len bytes between memory at @mem and the
+ * FIFO, one burst of slave->maxburst accesses per hardware event.
+ */
+static int edma_dma_fill_slave(struct edma_chan *echan,
+		struct edmacc_param *p, u32 opt, dma_addr_t mem, size_t len,
+		enum dma_data_direction direction)
+{
+	struct edma_dma_slave *slave = echan->slave;
+	unsigned acnt = slave->acnt;
+	unsigned bcnt = slave->maxburst ? slave->maxburst : 1;
+	unsigned burst = acnt * bcnt;
+	unsigned ccnt;
+
+	if (unlikely(!acnt || burst > SHORT_MAX || len % burst))
+		return -EINVAL;
+	ccnt = len / burst;
+	if (unlikely(!ccnt || ccnt > EDMA_DMA_MAX_CNT))
+		return -EINVAL;
+
+	opt |= EDMA_TCC(EDMA_CHAN_SLOT(echan->ch_num)) | SYNCDIM;
+	if (direction == DMA_TO_DEVICE)
+		edma_dma_fill(p, opt, mem, slave->tx_reg, acnt, bcnt, ccnt,
+				acnt, 0, burst, 0);
+	else
+		edma_dma_fill(p, opt, slave->rx_reg, mem, acnt, bcnt, ccnt,
+				0, acnt, 0, burst);
+	return 0;
+}
+
+/**
+ * edma_dma_prep_slave_sg - prepare a peripheral transfer
+ * @chan: DMA channel
+ * @sgl: scatterlist to transfer to/from
+ * @sg_len: number of entries in @scatterlist
+ * @direction: DMA direction
+ * @flags: tx descriptor status flags
+ *
+ * One PaRAM set per scatterlist entry; only the last one interrupts.
+ */
+static struct dma_async_tx_descriptor *
+edma_dma_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
+		unsigned int sg_len, enum dma_data_direction direction,
+		unsigned long flags)
+{
+	struct edma_chan *echan = to_edma_chan(chan);
+	struct edma_desc *desc;
+	struct scatterlist *sg;
+	unsigned i;
+
+	if (unlikely(!echan->slave || !sg_len))
+		return NULL;
+	if (direction != DMA_TO_DEVICE && direction != DMA_FROM_DEVICE)
+		return NULL;
+
+	desc = edma_dma_desc_alloc(echan, sg_len, false);
+	if (!desc)
+		return NULL;
+
+	for_each_sg(sgl, sg, sg_len, i) {
+		u32 opt = (i == sg_len - 1) ? TCINTEN : 0;
+
+		if (edma_dma_fill_slave(echan, &desc->sets[i].param, opt,
+				sg_dma_address(sg), sg_dma_len(sg),
+				direction) < 0) {
+			dev_err(chan2dev(chan),
+				"sg entry %u: %u bytes not a burst multiple\n",
+				i, sg_dma_len(sg));
+			goto err;
+		}
+		desc->len += sg_dma_len(sg);
+	}
+
+	desc->txd.flags = flags;
+	return &desc->txd;
+
+err:
+	edma_dma_free_slots(desc);
+	kfree(desc);
+	return NULL;
+}
+
+/**
+ * edma_dma_prep_cyclic - prepare a ring buffer peripheral transfer
+ * @chan: slave channel from the EDMA dmaengine device
+ * @buf_addr: bus address of the ring buffer
+ * @buf_len: ring length, a multiple of @period_len
+ * @period_len: bytes between completion callbacks
+ * @direction: DMA_TO_DEVICE or DMA_FROM_DEVICE
+ *
+ * The descriptor runs until dmaengine_terminate_all(); its callback is
+ * issued once per completed period.  The dmaengine core in this kernel
+ * has no cyclic prep hook, so audio style clients call this directly.
+ */
+struct dma_async_tx_descriptor *edma_dma_prep_cyclic(struct dma_chan *chan,
+		dma_addr_t buf_addr, size_t buf_len, size_t period_len,
+		enum dma_data_direction direction)
+{
+	struct edma_chan *echan = to_edma_chan(chan);
+	struct edma_desc *desc;
+	unsigned i, periods;
+
+	if (unlikely(!echan->slave || !period_len || buf_len % period_len))
+		return NULL;
+	if (direction != DMA_TO_DEVICE && direction != DMA_FROM_DEVICE)
+		return NULL;
+
+	periods = buf_len / period_len;
+	desc = edma_dma_desc_alloc(echan, periods, true);
+	if (!desc)
+		return NULL;
+
+	for (i = 0; i < periods; i++) {
+		if (edma_dma_fill_slave(echan, &desc->sets[i].param, TCINTEN,
+				buf_addr + i * period_len, period_len,
+				direction) < 0) {
+			dev_err(chan2dev(chan),
+				"period of %zu bytes not a burst multiple\n",
+				period_len);
+			edma_dma_free_slots(desc);
+			kfree(desc);
+			return NULL;
+		}
+	}
+
+	desc->len = buf_len;
+	desc->txd.flags = DMA_CTRL_ACK;
+	return &desc->txd;
+}
+EXPORT_SYMBOL_GPL(edma_dma_prep_cyclic);
+
+static void edma_dma_terminate_all(struct dma_chan *chan)
+{
+	struct edma_chan *echan = to_edma_chan(chan);
+	struct edma_desc *desc, *_desc;
+
+	spin_lock_bh(&echan->lock);
+
+	if (echan->active) {
+		desc = echan->active;
+		edma_dma_idle(echan);
+		edma_dma_free_slots(desc);
+		list_add_tail(&desc->node, &echan->free_list);
+	}
+	list_for_each_entry_safe(desc, _desc, &echan->queue, node) {
+		edma_dma_free_slots(desc);
+		list_move_tail(&desc->node, &echan->free_list);
+	}
+
+	echan->completed_cookie = chan->cookie;
+	atomic_set(&echan->periods, 0);
+	clear_bit(0, &echan->error);
+
+	spin_unlock_bh(&echan->lock);
+}
+
+static enum dma_status
+edma_dma_is_tx_complete(struct dma_chan *chan, dma_cookie_t cookie,
+		dma_cookie_t *done, dma_cookie_t *used)
+{
+	struct edma_chan *echan = to_edma_chan(chan);
+	dma_cookie_t last_used, last_complete;
+
+	spin_lock_bh(&echan->lock);
+	last_complete = echan->completed_cookie;
+	last_used = chan->cookie;
+	spin_unlock_bh(&echan->lock);
+
+	if (done)
+		*done = last_complete;
+	if (used)
+		*used = last_used;
+
+	return dma_async_is_complete(cookie, last_complete, last_used);
+}
+
+static void edma_dma_issue_pending(struct dma_chan *chan)
+{
+	struct edma_chan *echan = to_edma_chan(chan);
+	struct edma_desc *desc;
+
+	spin_lock_bh(&echan->lock);
+	if (!echan->active && !list_empty(&echan->queue)) {
+		desc = list_first_entry(&echan->queue, struct edma_desc, node);
+		list_del(&desc->node);
+		edma_dma_start(echan, desc);
+	}
+	spin_unlock_bh(&echan->lock);
+}
+
+static int edma_dma_alloc_chan_resources(struct dma_chan *chan)
+{
+	struct edma_chan *echan = to_edma_chan(chan);
+	struct edma_dma_slave *slave = chan->private;
+	int ch;
+
+	if (echan->ch_num >= 0)
+		return 0;
+
+	ch = edma_alloc_channel(slave ? slave->channel : EDMA_CHANNEL_ANY,
+			edma_dma_callback, echan,
+			slave ? slave->eventq : EVENTQ_DEFAULT);
+	if (ch < 0) {
+		dev_dbg(chan2dev(chan), "no EDMA channel: %d\n", ch);
+		return ch;
+	}
+
+	spin_lock_bh(&echan->lock);
+	echan->ch_num = ch;
+	echan->slave = slave;
+	echan->completed_cookie = chan->cookie = 1;
+	spin_unlock_bh(&echan->lock);
+
+	dev_dbg(chan2dev(chan), "using EDMA channel %d:%d\n",
+			EDMA_CTLR(ch), EDMA_CHAN_SLOT(ch));
+	return 1;
+}
+
+static void edma_dma_free_chan_resources(struct dma_chan *chan)
+{
+	struct edma_chan *echan = to_edma_chan(chan);
+	struct edma_desc *desc, *_desc;
+
+	if (echan->ch_num < 0)
+		return;
+
+	edma_dma_terminate_all(chan);
+	tasklet_kill(&echan->tasklet);
+
+	list_for_each_entry_safe(desc, _desc, &echan->free_list, node) {
+		list_del(&desc->node);
+		kfree(desc);
+	}
+
+	edma_free_channel(echan->ch_num);
+	echan->ch_num = -1;
+	echan->slave = NULL;
+}
+
+/*--  Module Management  -----------------------------------------------*/
+
+static int __init edma_dma_probe(struct platform_device *pdev)
+{
+	struct edma_engine *ecc;
+	unsigned i;
+	int ret;
+
+	if (!nr_channels)
+		return -ENODEV;
+
+	ecc = kzalloc(sizeof(*ecc), GFP_KERNEL);
+	if (!ecc)
+		return -ENOMEM;
+	ecc->chans = kcalloc(nr_channels, sizeof(*ecc->chans), GFP_KERNEL);
+	if (!ecc->chans) {
+		ret = -ENOMEM;
+		goto err_chans;
+	}
+
+	/* copies are mapped against this device */
+	pdev->dev.coherent_dma_mask = DMA_BIT_MASK(32);
+	pdev->dev.dma_mask = &pdev->dev.coherent_dma_mask;
+
+	INIT_LIST_HEAD(&ecc->dma.channels);
+	for (i = 0; i < nr_channels; i++) {
+		struct edma_chan *echan = &ecc->chans[i];
+
+		echan->chan.device = &ecc->dma;
+		echan->ch_num = -1;
+		spin_lock_init(&echan->lock);
+		INIT_LIST_HEAD(&echan->queue);
+		INIT_LIST_HEAD(&echan->free_list);
+		tasklet_init(&echan->tasklet, edma_dma_tasklet,
+				(unsigned long)echan);
+		list_add_tail(&echan->chan.device_node, &ecc->dma.channels);
+	}
+	ecc->dma.chancnt = nr_channels;
+
+	dma_cap_set(DMA_MEMCPY, ecc->dma.cap_mask);
+	dma_cap_set(DMA_SLAVE, ecc->dma.cap_mask);
+
+	ecc->dma.dev = &pdev->dev;
+	ecc->dma.device_alloc_chan_resources = edma_dma_alloc_chan_resources;
+	ecc->dma.device_free_chan_resources = edma_dma_free_chan_resources;
+	ecc->dma.device_prep_dma_memcpy = edma_dma_prep_memcpy;
+	ecc->dma.device_prep_slave_sg = edma_dma_prep_slave_sg;
+	ecc->dma.device_terminate_all = edma_dma_terminate_all;
+	ecc->dma.device_is_tx_complete = edma_dma_is_tx_complete;
+	ecc->dma.device_issue_pending = edma_dma_issue_pending;
+
+	ret = dma_async_device_register(&ecc->dma);
+	if (ret)
+		goto err_register;
+
+	platform_set_drvdata(pdev, ecc);
+	dev_info(&pdev->dev, "EDMA3 dmaengine, %u channels\n", nr_channels);
+	return 0;
+
+err_register:
+	kfree(ecc->chans);
+err_chans:
+	kfree(ecc);
+	return ret;
+}
+
+static int __exit edma_dma_remove(struct platform_device *pdev)
+{
+	struct edma_engine *ecc = platform_get_drvdata(pdev);
+	unsigned i;
+
+	dma_async_device_unregister(&ecc->dma);
+	for (i = 0; i < nr_channels; i++)
+		tasklet_kill(&ecc->chans[i].tasklet);
+
+	platform_set_drvdata(pdev, NULL);
+	kfree(ecc->chans);
+	kfree(ecc);
+	return 0;
+}
+
+static struct platform_driver edma_dma_driver = {
+	.remove		= __exit_p(edma_dma_remove),
+	.driver = {
+		.name	= "edma-dma",
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init edma_dma_init(void)
+{
+	return platform_driver_probe(&edma_dma_driver, edma_dma_probe);
+}
+subsys_initcall(edma_dma_init);
+
+static void __exit edma_dma_exit(void)
+{
+	platform_driver_unregister(&edma_dma_driver);
+}
+module_exit(edma_dma_exit);
+
+MODULE_DESCRIPTION("TI DaVinci EDMA3 dmaengine driver");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("platform:edma-dma");
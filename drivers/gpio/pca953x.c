@@ -16,6 +16,9 @@
 #include <linux/gpio.h>
 #include <linux/i2c.h>
 #include <linux/i2c/pca953x.h>
+#include <linux/interrupt.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
 #ifdef CONFIG_OF_GPIO
 #include <linux/of_platform.h>
 #include <linux/of_gpio.h>
@@ -53,12 +56,24 @@ struct pca953x_chip {
 	uint16_t reg_output;
 	uint16_t reg_direction;
 
+	/* with the INT line wired up, reg_input stays valid until the
+	 * expander signals a change, so reads cost no bus traffic */
+	uint16_t reg_input;
+	int input_valid;
+	int irq; /* INT line requested, 0 = inputs read over the bus */
+
+	struct mutex i2c_lock; /* cached registers vs. the bus */
+	struct list_head list;
+
 	struct i2c_client *client;
 	struct pca953x_platform_data *dyn_pdata;
 	struct gpio_chip gpio_chip;
 	char **names;
 };
 
+static LIST_HEAD(pca953x_chips);
+static DEFINE_MUTEX(pca953x_chips_lock);
+
 static int pca953x_write_reg(struct pca953x_chip *chip, int reg, uint16_t val)
 {
 	int ret;
@@ -94,23 +109,64 @@ static int pca953x_read_reg(struct pca953x_chip *chip, int reg, uint16_t *val)
 	return 0;
 }
 
-static int pca953x_gpio_direction_input(struct gpio_chip *gc, unsigned off)
+/* write a cached register, without bus traffic when it does not change */
+static int pca953x_update_reg(struct pca953x_chip *chip, int reg,
+			      uint16_t *cache, uint16_t val)
 {
-	struct pca953x_chip *chip;
-	uint16_t reg_val;
 	int ret;
 
-	chip = container_of(gc, struct pca953x_chip, gpio_chip);
+	if (val == *cache)
+		return 0;
 
-	reg_val = chip->reg_direction | (1u << off);
-	ret = pca953x_write_reg(chip, PCA953X_DIRECTION, reg_val);
+	ret = pca953x_write_reg(chip, reg, val);
 	if (ret)
 		return ret;
 
-	chip->reg_direction = reg_val;
+	*cache = val;
 	return 0;
 }
 
+/* caller holds i2c_lock */
+static int pca953x_read_input(struct pca953x_chip *chip, uint16_t *val)
+{
+	int ret;
+
+	/* INT only signals changes on inputs, outputs are what we drive */
+	if (chip->input_valid) {
+		*val = (chip->reg_input & chip->reg_direction) |
+		       (chip->reg_output & ~chip->reg_direction);
+		return 0;
+	}
+
+	/* validate before sampling: a change from here on is signalled
+	 * and pca953x_irq() invalidates the value read below again */
+	chip->input_valid = chip->irq > 0;
+	smp_mb();
+
+	ret = pca953x_read_reg(chip, PCA953X_INPUT, val);
+	if (ret < 0) {
+		chip->input_valid = 0;
+		return ret;
+	}
+
+	chip->reg_input = *val;
+	return 0;
+}
+
+static int pca953x_gpio_direction_input(struct gpio_chip *gc, unsigned off)
+{
+	struct pca953x_chip *chip;
+	int ret;
+
+	chip = container_of(gc, struct pca953x_chip, gpio_chip);
+
+	mutex_lock(&chip->i2c_lock);
+	ret = pca953x_update_reg(chip, PCA953X_DIRECTION, &chip->reg_direction,
+				 chip->reg_direction | (1u << off));
+	mutex_unlock(&chip->i2c_lock);
+	return ret;
+}
+
 static int pca953x_gpio_direction_output(struct gpio_chip *gc,
 		unsigned off, int val)
 {
@@ -120,26 +176,25 @@ static int pca953x_gpio_direction_output(struct gpio_chip *gc,
 
 	chip = container_of(gc, struct pca953x_chip, gpio_chip);
 
+	mutex_lock(&chip->i2c_lock);
+
 	/* set output level */
 	if (val)
 		reg_val = chip->reg_output | (1u << off);
 	else
 		reg_val = chip->reg_output & ~(1u << off);
 
-	ret = pca953x_write_reg(chip, PCA953X_OUTPUT, reg_val);
+	ret = pca953x_update_reg(chip, PCA953X_OUTPUT, &chip->reg_output,
+				 reg_val);
 	if (ret)
-		return ret;
-
-	chip->reg_output = reg_val;
+		goto out;
 
 	/* then direction */
-	reg_val = chip->reg_direction & ~(1u << off);
-	ret = pca953x_write_reg(chip, PCA953X_DIRECTION, reg_val);
-	if (ret)
-		return ret;
-
-	chip->reg_direction = reg_val;
-	return 0;
+	ret = pca953x_update_reg(chip, PCA953X_DIRECTION, &chip->reg_direction,
+				 chip->reg_direction & ~(1u << off));
+out:
+	mutex_unlock(&chip->i2c_lock);
+	return ret;
 }
 
 static int pca953x_gpio_get_value(struct gpio_chip *gc, unsigned off)
@@ -150,7 +205,9 @@ static int pca953x_gpio_get_value(struct gpio_chip *gc, unsigned off)
 
 	chip = container_of(gc, struct pca953x_chip, gpio_chip);
 
-	ret = pca953x_read_reg(chip, PCA953X_INPUT, &reg_val);
+	mutex_lock(&chip->i2c_lock);
+	ret = pca953x_read_input(chip, &reg_val);
+	mutex_unlock(&chip->i2c_lock);
 	if (ret < 0) {
 		/* NOTE:  diagnostic already emitted; that's all we should
 		 * do unless gpio_*_value_cansleep() calls become different
@@ -166,20 +223,102 @@ static void pca953x_gpio_set_value(struct gpio_chip *gc, unsigned off, int val)
 {
 	struct pca953x_chip *chip;
 	uint16_t reg_val;
-	int ret;
 
 	chip = container_of(gc, struct pca953x_chip, gpio_chip);
 
+	mutex_lock(&chip->i2c_lock);
 	if (val)
 		reg_val = chip->reg_output | (1u << off);
 	else
 		reg_val = chip->reg_output & ~(1u << off);
 
-	ret = pca953x_write_reg(chip, PCA953X_OUTPUT, reg_val);
-	if (ret)
-		return;
+	pca953x_update_reg(chip, PCA953X_OUTPUT, &chip->reg_output, reg_val);
+	mutex_unlock(&chip->i2c_lock);
+}
+
+/* caller holds pca953x_chips_lock */
+static struct pca953x_chip *pca953x_find_chip(unsigned gpio)
+{
+	struct pca953x_chip *chip;
+
+	list_for_each_entry(chip, &pca953x_chips, list)
+		if (chip->gpio_chip.base == gpio)
+			return chip;
+	return NULL;
+}
 
-	chip->reg_output = reg_val;
+/**
+ * pca953x_gpio_set_multiple - drive several expander outputs at once
+ * @gpio: first GPIO of the expander, its platform data gpio_base
+ * @mask: outputs to change, bit n is GPIO @gpio + n
+ * @bits: their new levels
+ *
+ * All of them change in one register write, none is issued when they
+ * already are at these levels. The pins must be outputs. May sleep.
+ */
+int pca953x_gpio_set_multiple(unsigned gpio, uint16_t mask, uint16_t bits)
+{
+	struct pca953x_chip *chip;
+	int ret = -ENODEV;
+
+	mutex_lock(&pca953x_chips_lock);
+	chip = pca953x_find_chip(gpio);
+	if (chip) {
+		mutex_lock(&chip->i2c_lock);
+		ret = pca953x_update_reg(chip, PCA953X_OUTPUT,
+				&chip->reg_output,
+				(chip->reg_output & ~mask) | (bits & mask));
+		mutex_unlock(&chip->i2c_lock);
+	}
+	mutex_unlock(&pca953x_chips_lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(pca953x_gpio_set_multiple);
+
+/**
+ * pca953x_gpio_get_multiple - sample all expander pins at once
+ * @gpio: first GPIO of the expander, its platform data gpio_base
+ * @bits: pin levels, bit n is GPIO @gpio + n
+ *
+ * One register read at most, none with the expander INT line wired up
+ * and no change signalled since the last one. May sleep.
+ */
+int pca953x_gpio_get_multiple(unsigned gpio, uint16_t *bits)
+{
+	struct pca953x_chip *chip;
+	int ret = -ENODEV;
+
+	mutex_lock(&pca953x_chips_lock);
+	chip = pca953x_find_chip(gpio);
+	if (chip) {
+		mutex_lock(&chip->i2c_lock);
+		ret = pca953x_read_input(chip, bits);
+		mutex_unlock(&chip->i2c_lock);
+	}
+	mutex_unlock(&pca953x_chips_lock);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(pca953x_gpio_get_multiple);
+
+/* INT is asserted on any input change since INPUT was last read */
+static irqreturn_t pca953x_irq(int irq, void *devid)
+{
+	struct pca953x_chip *chip = devid;
+
+	chip->input_valid = 0;
+	return IRQ_WAKE_THREAD;
+}
+
+static irqreturn_t pca953x_irq_thread(int irq, void *devid)
+{
+	struct pca953x_chip *chip = devid;
+	uint16_t reg_val;
+
+	/* reading INPUT releases INT and refills the cache */
+	mutex_lock(&chip->i2c_lock);
+	pca953x_read_input(chip, &reg_val);
+	mutex_unlock(&chip->i2c_lock);
+	return IRQ_HANDLED;
 }
 
 static void pca953x_setup_gpio(struct pca953x_chip *chip, int gpios)
@@ -278,6 +417,7 @@ static int __devinit pca953x_probe(struct i2c_client *client,
 	}
 
 	chip->client = client;
+	mutex_init(&chip->i2c_lock);
 
 	chip->gpio_start = pdata->gpio_base;
 
@@ -301,10 +441,26 @@ static int __devinit pca953x_probe(struct i2c_client *client,
 	if (ret)
 		goto out_failed;
 
+	/* the INT line only ever adds caching, the chip works without */
+	if (client->irq > 0) {
+		ret = request_threaded_irq(client->irq, pca953x_irq,
+				pca953x_irq_thread,
+				IRQF_TRIGGER_FALLING | IRQF_ONESHOT,
+				dev_name(&client->dev), chip);
+		if (ret)
+			dev_warn(&client->dev, "no INT line (irq %d), %d\n",
+					client->irq, ret);
+		else
+			chip->irq = client->irq;
+	}
 
 	ret = gpiochip_add(&chip->gpio_chip);
 	if (ret)
-		goto out_failed;
+		goto out_free_irq;
+
+	mutex_lock(&pca953x_chips_lock);
+	list_add_tail(&chip->list, &pca953x_chips);
+	mutex_unlock(&pca953x_chips_lock);
 
 	if (pdata->setup) {
 		ret = pdata->setup(client, chip->gpio_chip.base,
@@ -316,6 +472,9 @@ static int __devinit pca953x_probe(struct i2c_client *client,
 	i2c_set_clientdata(client, chip);
 	return 0;
 
+out_free_irq:
+	if (chip->irq)
+		free_irq(chip->irq, chip);
 out_failed:
 	kfree(chip->dyn_pdata);
 	kfree(chip);
@@ -338,13 +497,23 @@ static int pca953x_remove(struct i2c_client *client)
 		}
 	}
 
+	mutex_lock(&pca953x_chips_lock);
+	list_del(&chip->list);
+	mutex_unlock(&pca953x_chips_lock);
+
 	ret = gpiochip_remove(&chip->gpio_chip);
 	if (ret) {
 		dev_err(&client->dev, "%s failed, %d\n",
 				"gpiochip_remove()", ret);
+		mutex_lock(&pca953x_chips_lock);
+		list_add_tail(&chip->list, &pca953x_chips);
+		mutex_unlock(&pca953x_chips_lock);
 		return ret;
 	}
 
+	if (chip->irq)
+		free_irq(chip->irq, chip);
+
 	kfree(chip->dyn_pdata);
 	kfree(chip);
 	return 0;
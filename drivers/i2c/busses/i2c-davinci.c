@@ -36,9 +36,11 @@
 #include <linux/platform_device.h>
 #include <linux/io.h>
 #include <linux/cpufreq.h>
+#include <linux/dma-mapping.h>
 
 #include <mach/hardware.h>
 #include <mach/i2c.h>
+#include <mach/edma.h>
 
 /* ----- global defines ----------------------------------------------- */
 
@@ -49,6 +51,9 @@
 				 DAVINCI_I2C_IMR_NACK | \
 				 DAVINCI_I2C_IMR_AL)
 
+/* messages up to this long can go through EDMA, see dma_min_len */
+#define DAVINCI_I2C_DMA_BUF_SIZE	PAGE_SIZE
+
 #define DAVINCI_I2C_OAR_REG	0x00
 #define DAVINCI_I2C_IMR_REG	0x04
 #define DAVINCI_I2C_STR_REG	0x08
@@ -74,6 +79,8 @@
 #define DAVINCI_I2C_STR_BB	BIT(12)
 #define DAVINCI_I2C_STR_RSFULL	BIT(11)
 #define DAVINCI_I2C_STR_SCD	BIT(5)
+#define DAVINCI_I2C_STR_XRDY	BIT(4)
+#define DAVINCI_I2C_STR_RRDY	BIT(3)
 #define DAVINCI_I2C_STR_ARDY	BIT(2)
 #define DAVINCI_I2C_STR_NACK	BIT(1)
 #define DAVINCI_I2C_STR_AL	BIT(0)
@@ -95,9 +102,25 @@
 #define DAVINCI_I2C_IMR_NACK	BIT(1)
 #define DAVINCI_I2C_IMR_AL	BIT(0)
 
+/*
+ * Messages of at least dma_min_len bytes move through EDMA, one event per
+ * byte, so only the completion interrupts reach the CPU.  Messages of at
+ * most poll_max_len bytes are polled with interrupts masked: for a
+ * register address and a couple of data bytes, spinning costs less than
+ * taking and scheduling the interrupts.  Zero disables either mode.
+ */
+static unsigned int dma_min_len = 16;
+module_param(dma_min_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dma_min_len, "shortest message sent through EDMA (bytes)");
+
+static unsigned int poll_max_len = 2;
+module_param(poll_max_len, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(poll_max_len, "longest message handled by polling (bytes)");
+
 struct davinci_i2c_dev {
 	struct device           *dev;
 	void __iomem		*base;
+	resource_size_t		pbase;
 	struct completion	cmd_complete;
 	struct clk              *clk;
 	int			cmd_err;
@@ -107,9 +130,18 @@ struct davinci_i2c_dev {
 	int			stop;
 	u8			terminate;
 	struct i2c_adapter	adapter;
+
+	/* EDMA, if the platform enables it; dma_buf is NULL otherwise */
+	int			dma_rx_chan;
+	int			dma_tx_chan;
+	u8			*dma_buf;	/* bounce buffer, coherent */
+	dma_addr_t		dma_handle;
+	struct completion	dma_complete;
+	int			dma_status;
 #ifdef CONFIG_CPU_FREQ
 	struct completion	xfr_complete;
 	struct notifier_block	freq_transition;
+	unsigned long		input_clk;	/* dividers are set for this */
 #endif
 };
 
@@ -154,6 +186,10 @@ static void i2c_davinci_calc_clk_dividers(struct davinci_i2c_dev *dev)
 	u32 clkl;
 	u32 input_clock = clk_get_rate(dev->clk);
 
+#ifdef CONFIG_CPU_FREQ
+	dev->input_clk = input_clock;
+#endif
+
 	/* NOTE: I2C Clock divider programming info
 	 * As per I2C specs the following formulas provide prescaler
 	 * and low/high divider values
@@ -251,6 +287,144 @@ static int i2c_davinci_wait_bus_not_busy(struct davinci_i2c_dev *dev,
 	return 0;
 }
 
+static void i2c_davinci_dma_callback(unsigned channel, u16 ch_status,
+				     void *data)
+{
+	struct davinci_i2c_dev *dev = data;
+
+	edma_stop(channel);
+	if (ch_status != DMA_COMPLETE)
+		edma_clean_channel(channel);
+	dev->dma_status = ch_status;
+	complete(&dev->dma_complete);
+}
+
+/*
+ * Program the whole message as one A-synchronized transfer: every
+ * ICREVT/ICXEVT moves one byte between the data register and the bounce
+ * buffer.  The SMBus emulation layer hands us on-stack buffers, which
+ * mustn't be mapped for DMA, so the payload is always copied.  TX is
+ * started before the controller so the first XEVT already finds the
+ * channel armed; a stale event left over from an earlier message is
+ * cleared first.
+ */
+static void i2c_davinci_dma_start(struct davinci_i2c_dev *dev,
+				  struct i2c_msg *msg)
+{
+	struct edmacc_param param;
+	int chan;
+
+	param.opt = TCINTEN;
+	param.a_b_cnt = msg->len << 16 | 1;
+	param.link_bcntrld = 0xffff;
+	param.src_dst_cidx = 0;
+	param.ccnt = 1;
+
+	if (msg->flags & I2C_M_RD) {
+		chan = dev->dma_rx_chan;
+		param.src = dev->pbase + DAVINCI_I2C_DRR_REG;
+		param.dst = dev->dma_handle;
+		param.src_dst_bidx = 1 << 16;
+	} else {
+		chan = dev->dma_tx_chan;
+		memcpy(dev->dma_buf, msg->buf, msg->len);
+		param.src = dev->dma_handle;
+		param.dst = dev->pbase + DAVINCI_I2C_DXR_REG;
+		param.src_dst_bidx = 1;
+	}
+	param.opt |= EDMA_TCC(EDMA_CHAN_SLOT(chan));
+	edma_write_slot(chan, &param);
+
+	INIT_COMPLETION(dev->dma_complete);
+	dev->dma_status = -EINPROGRESS;
+	edma_clear_event(chan);
+	edma_start(chan);
+}
+
+/*
+ * Called once the controller is done with the message.  The last EDMA
+ * completion may trail the I2C one by a few microseconds; when the
+ * message failed on the bus the channel is stopped instead.
+ */
+static int i2c_davinci_dma_finish(struct davinci_i2c_dev *dev,
+				  struct i2c_msg *msg, bool ok)
+{
+	int chan = (msg->flags & I2C_M_RD) ? dev->dma_rx_chan
+					   : dev->dma_tx_chan;
+
+	if (ok)
+		wait_for_completion_timeout(&dev->dma_complete,
+					    dev->adapter.timeout);
+	if (dev->dma_status != DMA_COMPLETE) {
+		edma_stop(chan);
+		edma_clean_channel(chan);
+		return -EREMOTEIO;
+	}
+
+	if (msg->flags & I2C_M_RD)
+		memcpy(msg->buf, dev->dma_buf, msg->len);
+	return 0;
+}
+
+/*
+ * Polled message, with the controller's interrupts masked.  Returns like
+ * wait_for_completion_timeout(): zero if the controller timed out.
+ */
+static int i2c_davinci_poll_msg(struct davinci_i2c_dev *dev)
+{
+	unsigned long timeout = jiffies + dev->adapter.timeout;
+	u16 stat, w;
+
+	for (;;) {
+		stat = davinci_i2c_read_reg(dev, DAVINCI_I2C_STR_REG);
+
+		if (stat & (DAVINCI_I2C_STR_AL | DAVINCI_I2C_STR_NACK)) {
+			stat &= DAVINCI_I2C_STR_AL | DAVINCI_I2C_STR_NACK;
+			davinci_i2c_write_reg(dev, DAVINCI_I2C_STR_REG, stat);
+			dev->cmd_err |= stat;
+			dev->buf_len = 0;
+			return 1;
+		}
+
+		if (dev->buf_len && (stat & DAVINCI_I2C_STR_RRDY)) {
+			*dev->buf++ = davinci_i2c_read_reg(dev,
+							   DAVINCI_I2C_DRR_REG);
+			dev->buf_len--;
+			continue;
+		}
+
+		if (dev->buf_len && (stat & DAVINCI_I2C_STR_XRDY)) {
+			davinci_i2c_write_reg(dev, DAVINCI_I2C_DXR_REG,
+					      *dev->buf++);
+			dev->buf_len--;
+			continue;
+		}
+
+		if (stat & DAVINCI_I2C_STR_ARDY) {
+			davinci_i2c_write_reg(dev, DAVINCI_I2C_STR_REG,
+					      DAVINCI_I2C_STR_ARDY);
+			if (dev->buf_len == 0 && dev->stop) {
+				w = davinci_i2c_read_reg(dev,
+							 DAVINCI_I2C_MDR_REG);
+				w |= DAVINCI_I2C_MDR_STP;
+				davinci_i2c_write_reg(dev,
+						      DAVINCI_I2C_MDR_REG, w);
+			}
+			return 1;
+		}
+
+		if (stat & DAVINCI_I2C_STR_SCD) {
+			davinci_i2c_write_reg(dev, DAVINCI_I2C_STR_REG,
+					      DAVINCI_I2C_STR_SCD);
+			return 1;
+		}
+
+		if (time_after(jiffies, timeout))
+			return 0;
+		cpu_relax();
+	}
+}
+
 /*
  * Low level master read/write transaction. This function is called
  * from i2c_davinci_xfer.
@@ -263,6 +437,7 @@ i2c_davinci_xfer_msg(struct i2c_adapter *adap, struct i2c_msg *msg, int stop)
 	u32 flag;
 	u16 w;
 	int r;
+	bool dma, poll;
 
 	if (!pdata)
 		pdata = &davinci_i2c_platform_data_default;
@@ -277,6 +452,10 @@ i2c_davinci_xfer_msg(struct i2c_adapter *adap, struct i2c_msg *msg, int stop)
 	dev->buf_len = msg->len;
 	dev->stop = stop;
 
+	dma = dev->dma_buf && dma_min_len && msg->len >= dma_min_len &&
+		msg->len <= DAVINCI_I2C_DMA_BUF_SIZE;
+	poll = !dma && msg->len && msg->len <= poll_max_len;
+
 	davinci_i2c_write_reg(dev, DAVINCI_I2C_CNT_REG, dev->buf_len);
 
 	INIT_COMPLETION(dev->cmd_complete);
@@ -298,9 +477,16 @@ i2c_davinci_xfer_msg(struct i2c_adapter *adap, struct i2c_msg *msg, int stop)
 		flag &= ~DAVINCI_I2C_MDR_STP;
 	}
 
-	/* Enable receive or transmit interrupts */
+	/*
+	 * Enable receive or transmit interrupts, unless EDMA moves the data;
+	 * a polled message runs with all of them masked.
+	 */
 	w = davinci_i2c_read_reg(dev, DAVINCI_I2C_IMR_REG);
-	if (msg->flags & I2C_M_RD)
+	if (poll)
+		w = 0;
+	else if (dma)
+		w &= ~(DAVINCI_I2C_IMR_RRDY | DAVINCI_I2C_IMR_XRDY);
+	else if (msg->flags & I2C_M_RD)
 		w |= DAVINCI_I2C_IMR_RRDY;
 	else
 		w |= DAVINCI_I2C_IMR_XRDY;
@@ -308,6 +494,11 @@ i2c_davinci_xfer_msg(struct i2c_adapter *adap, struct i2c_msg *msg, int stop)
 
 	dev->terminate = 0;
 
+	if (dma) {
+		i2c_davinci_dma_start(dev, msg);
+		dev->buf_len = 0;
+	}
+
 	/* write the data into mode register */
 	davinci_i2c_write_reg(dev, DAVINCI_I2C_MDR_REG, flag);
 
@@ -320,8 +511,20 @@ i2c_davinci_xfer_msg(struct i2c_adapter *adap, struct i2c_msg *msg, int stop)
 		dev->buf_len--;
 	}
 
-	r = wait_for_completion_interruptible_timeout(&dev->cmd_complete,
-						      dev->adapter.timeout);
+	if (poll) {
+		r = i2c_davinci_poll_msg(dev);
+		davinci_i2c_write_reg(dev, DAVINCI_I2C_IMR_REG,
+				      I2C_DAVINCI_INTR_ALL);
+	} else {
+		r = wait_for_completion_interruptible_timeout(
+				&dev->cmd_complete, dev->adapter.timeout);
+	}
+	if (dma && i2c_davinci_dma_finish(dev, msg, r > 0 && !dev->cmd_err) &&
+	    r > 0 && !dev->cmd_err) {
+		dev_err(dev->dev, "DMA transfer incomplete\n");
+		i2c_davinci_init(dev);
+		return -EREMOTEIO;
+	}
 	if (r == 0) {
 		dev_err(dev->dev, "controller timed out\n");
 		i2c_davinci_init(dev);
@@ -401,6 +604,10 @@ i2c_davinci_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	return num;
 }
 
+/*
+ * SMBus block and I2C block transfers are emulated as plain messages; the
+ * EDMA and polled paths keep them clear of per-byte interrupts.
+ */
 static u32 i2c_davinci_func(struct i2c_adapter *adap)
 {
 	return I2C_FUNC_I2C | I2C_FUNC_SMBUS_EMUL;
@@ -537,7 +744,10 @@ static int i2c_davinci_cpufreq_transition(struct notifier_block *nb,
 	struct davinci_i2c_dev *dev;
 
 	dev = container_of(nb, struct davinci_i2c_dev, freq_transition);
-	if (val == CPUFREQ_POSTCHANGE) {
+
+	/* nothing to do if our clock isn't one cpufreq scales */
+	if (val == CPUFREQ_POSTCHANGE &&
+			clk_get_rate(dev->clk) != dev->input_clk) {
 		wait_for_completion(&dev->xfr_complete);
 		davinci_i2c_reset_ctrl(dev, 0);
 		i2c_davinci_calc_clk_dividers(dev);
@@ -576,6 +786,71 @@ static struct i2c_algorithm i2c_davinci_algo = {
 	.functionality	= i2c_davinci_func,
 };
 
+/*
+ * EDMA is optional: without the platform's blessing, its resources, or
+ * when a channel is taken, messages just stay interrupt driven.
+ */
+static void davinci_i2c_dma_init(struct davinci_i2c_dev *dev,
+				 struct platform_device *pdev)
+{
+	struct davinci_i2c_platform_data *pdata = dev->dev->platform_data;
+	struct resource *rx, *tx, *q;
+	enum dma_event_q eventq = EVENTQ_DEFAULT;
+	int r;
+
+	if (!pdata || !pdata->use_dma)
+		return;
+
+	rx = platform_get_resource(pdev, IORESOURCE_DMA, 0);
+	tx = platform_get_resource(pdev, IORESOURCE_DMA, 1);
+	if (!rx || !tx)
+		return;
+	q = platform_get_resource(pdev, IORESOURCE_DMA, 2);
+	if (q)
+		eventq = q->start;
+
+	dev->dma_buf = dma_alloc_coherent(&pdev->dev, DAVINCI_I2C_DMA_BUF_SIZE,
+					  &dev->dma_handle, GFP_KERNEL);
+	if (!dev->dma_buf)
+		goto err;
+
+	r = edma_alloc_channel(rx->start, i2c_davinci_dma_callback, dev,
+			       eventq);
+	if (r < 0)
+		goto err_free_buf;
+	dev->dma_rx_chan = r;
+
+	r = edma_alloc_channel(tx->start, i2c_davinci_dma_callback, dev,
+			       eventq);
+	if (r < 0)
+		goto err_free_rx;
+	dev->dma_tx_chan = r;
+
+	init_completion(&dev->dma_complete);
+	return;
+
+err_free_rx:
+	edma_free_channel(dev->dma_rx_chan);
+err_free_buf:
+	dma_free_coherent(&pdev->dev, DAVINCI_I2C_DMA_BUF_SIZE,
+			  dev->dma_buf, dev->dma_handle);
+	dev->dma_buf = NULL;
+err:
+	dev_warn(&pdev->dev, "no EDMA, using interrupts only\n");
+}
+
+static void davinci_i2c_dma_release(struct davinci_i2c_dev *dev)
+{
+	if (!dev->dma_buf)
+		return;
+
+	edma_free_channel(dev->dma_tx_chan);
+	edma_free_channel(dev->dma_rx_chan);
+	dma_free_coherent(dev->dev, DAVINCI_I2C_DMA_BUF_SIZE,
+			  dev->dma_buf, dev->dma_handle);
+	dev->dma_buf = NULL;
+}
+
 static int davinci_i2c_probe(struct platform_device *pdev)
 {
 	struct davinci_i2c_dev *dev;
@@ -615,6 +890,7 @@ static int davinci_i2c_probe(struct platform_device *pdev)
 #endif
 	dev->dev = get_device(&pdev->dev);
 	dev->irq = irq->start;
+	dev->pbase = mem->start;
 	platform_set_drvdata(pdev, dev);
 
 	dev->clk = clk_get(&pdev->dev, NULL);
@@ -638,6 +914,8 @@ static int davinci_i2c_probe(struct platform_device *pdev)
 		goto err_unuse_clocks;
 	}
 
+	davinci_i2c_dma_init(dev, pdev);
+
 	r = i2c_davinci_cpufreq_register(dev);
 	if (r) {
 		dev_err(&pdev->dev, "failed to register cpufreq\n");
@@ -663,6 +941,7 @@ static int davinci_i2c_probe(struct platform_device *pdev)
 	return 0;
 
 err_free_irq:
+	davinci_i2c_dma_release(dev);
 	free_irq(dev->irq, dev);
 err_unuse_clocks:
 	iounmap(dev->base);
@@ -696,6 +975,7 @@ static int davinci_i2c_remove(struct platform_device *pdev)
 	dev->clk = NULL;
 
 	davinci_i2c_write_reg(dev, DAVINCI_I2C_MDR_REG, 0);
+	davinci_i2c_dma_release(dev);
 	free_irq(IRQ_I2C, dev);
 	iounmap(dev->base);
 	kfree(dev);
@@ -79,6 +79,12 @@ struct ccdc_hw_ops {
 	void (*get_image_window) (struct v4l2_rect *win);
 	/* Pointer to function to get line length */
 	unsigned int (*get_line_length) (void);
+	/*
+	 * Pointer to function to set horizontal and vertical decimation
+	 * (culling) of the image window. Rounds the factors to ones the
+	 * hw supports. Optional
+	 */
+	int (*set_decimation) (unsigned int *hdiv, unsigned int *vdiv);
 
 	/* Query CCDC control IDs */
 	int (*queryctrl)(struct v4l2_queryctrl *qctrl);
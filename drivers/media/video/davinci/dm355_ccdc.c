@@ -39,6 +39,7 @@
 #include <linux/videodev2.h>
 #include <linux/clk.h>
 #include <linux/err.h>
+#include <linux/log2.h>
 
 #include <media/davinci/dm355_ccdc.h>
 #include <media/davinci/vpss.h>
@@ -64,7 +65,12 @@ static struct ccdc_oper_config {
 	struct clk *sclk;
 	/* ccdc base address */
 	void __iomem *base_addr;
+	/* horizontal and vertical decimation */
+	unsigned int hdiv;
+	unsigned int vdiv;
 } ccdc_cfg = {
+	.hdiv = 1,
+	.vdiv = 1,
 	/* Raw configurations */
 	.bayer = {
 		.pix_fmt = CCDC_PIXFMT_RAW,
@@ -128,6 +134,16 @@ static u32 ccdc_raw_yuv_pix_formats[] =
 		{V4L2_PIX_FMT_UYVY, V4L2_PIX_FMT_YUYV};
 
 /* register access routines */
+/*
+ * Culling patterns for 1/1, 1/2 and 1/4 decimation, indexed by log2 of
+ * the factor. Bayer keeps pixel and line pairs together so the colour
+ * pattern survives, YCbCr keeps whole CbYCrY groups, which only allows
+ * 1/2 horizontally.
+ */
+static const u8 ccdc_cul_bayer[] = { 0xff, 0x33, 0x03 };
+static const u8 ccdc_culh_ycbcr[] = { 0xff, 0x0f };
+static const u8 ccdc_culv_ycbcr[] = { 0xff, 0x55, 0x11 };
+
 static inline u32 regr(u32 offset)
 {
 	return __raw_readl(ccdc_cfg.base_addr + offset);
@@ -352,6 +368,28 @@ static int ccdc_set_params(void __user *params)
 	return -EINVAL;
 }
 
+/*
+ * ccdc_config_culling()
+ * This function will program the culling patterns for the current
+ * decimation
+ */
+static void ccdc_config_culling(void)
+{
+	int h = ilog2(ccdc_cfg.hdiv), v = ilog2(ccdc_cfg.vdiv);
+	u32 culh, culv;
+
+	if (ccdc_cfg.if_type == VPFE_RAW_BAYER) {
+		culh = ccdc_cul_bayer[h];
+		culv = ccdc_cul_bayer[v];
+	} else {
+		culh = ccdc_culh_ycbcr[h];
+		culv = ccdc_culv_ycbcr[v];
+	}
+	/* same pattern for even and odd lines */
+	regw((culh << CCDC_CULH_CULHEVN_SHIFT) | culh, CULH);
+	regw(culv, CULV);
+}
+
 /* This function will configure CCDC for YCbCr video capture */
 static void ccdc_config_ycbcr(void)
 {
@@ -392,6 +430,7 @@ static void ccdc_config_ycbcr(void)
 
 	/* configure video window */
 	ccdc_setwin(&params->win, params->frm_fmt, 2);
+	ccdc_config_culling();
 
 	/* configure the order of y cb cr in SD-RAM */
 	temp = (params->pix_order << CCDC_Y8POS_SHIFT);
@@ -403,7 +442,7 @@ static void ccdc_config_ycbcr(void)
 	 * width to a multiple of 16 pixels and multiply by two to account for
 	 * y:cb:cr 4:2:2 data
 	 */
-	regw(((params->win.width * 2 + 31) >> 5), HSIZE);
+	regw(((params->win.width / ccdc_cfg.hdiv * 2 + 31) >> 5), HSIZE);
 
 	/* configure the memory line offset */
 	if (params->buf_type == CCDC_BUFTYPE_FLD_INTERLEAVED) {
@@ -693,6 +732,7 @@ static int ccdc_config_raw(void)
 
 	/* configure video window */
 	ccdc_setwin(&params->win, params->frm_fmt, 1);
+	ccdc_config_culling();
 
 	/* Optical Clamp Averaging */
 	ccdc_config_black_clamp(&config_params->blk_clamp);
@@ -730,20 +770,20 @@ static int ccdc_config_raw(void)
 	/* If pack 8 is enable then 1 pixel will take 1 byte */
 	if ((config_params->data_sz == CCDC_DATA_8BITS) ||
 	     config_params->alaw.enable) {
-		val |= (((params->win.width) + 31) >> 5) &
+		val |= (((params->win.width / ccdc_cfg.hdiv) + 31) >> 5) &
 			CCDC_HSIZE_VAL_MASK;
 
 		/* adjust to multiple of 32 */
 		dev_dbg(ccdc_cfg.dev, "\nWriting 0x%x to HSIZE...\n",
-		       (((params->win.width) + 31) >> 5) &
+		       (((params->win.width / ccdc_cfg.hdiv) + 31) >> 5) &
 			CCDC_HSIZE_VAL_MASK);
 	} else {
 		/* else one pixel will take 2 byte */
-		val |= (((params->win.width * 2) + 31) >> 5) &
+		val |= (((params->win.width / ccdc_cfg.hdiv * 2) + 31) >> 5) &
 			CCDC_HSIZE_VAL_MASK;
 
 		dev_dbg(ccdc_cfg.dev, "\nWriting 0x%x to HSIZE...\n",
-		       (((params->win.width * 2) + 31) >> 5) &
+		       (((params->win.width / ccdc_cfg.hdiv * 2) + 31) >> 5) &
 			CCDC_HSIZE_VAL_MASK);
 	}
 	regw(val, HSIZE);
@@ -825,10 +865,11 @@ static int ccdc_set_pixel_format(u32 pixfmt)
 
 	if (ccdc_cfg.if_type == VPFE_RAW_BAYER) {
 		ccdc_cfg.bayer.pix_fmt = CCDC_PIXFMT_RAW;
-		if (pixfmt == V4L2_PIX_FMT_SBGGR8)
-			alaw->enable = 1;
-		else if (pixfmt != V4L2_PIX_FMT_SBGGR16)
+		if (pixfmt != V4L2_PIX_FMT_SBGGR8 &&
+		    pixfmt != V4L2_PIX_FMT_SBGGR16)
 			return -EINVAL;
+		/* 8 bit Bayer is the 16 bit data A-law compressed */
+		alaw->enable = pixfmt == V4L2_PIX_FMT_SBGGR8;
 	} else {
 		if (pixfmt == V4L2_PIX_FMT_YUYV)
 			ccdc_cfg.ycbcr.pix_order = CCDC_PIXORDER_YCBYCR;
@@ -839,6 +880,79 @@ static int ccdc_set_pixel_format(u32 pixfmt)
 	}
 	return 0;
 }
+static int ccdc_queryctrl(struct v4l2_queryctrl *qctrl)
+{
+	if (ccdc_cfg.if_type != VPFE_RAW_BAYER)
+		return -EINVAL;
+
+	switch (qctrl->id) {
+	case CCDC_CID_ALAW_GAMMA_WD:
+		strlcpy(qctrl->name, "A-law input bits", sizeof(qctrl->name));
+		qctrl->minimum = CCDC_GAMMA_BITS_13_4;
+		qctrl->maximum = CCDC_GAMMA_BITS_09_0;
+		qctrl->default_value = 2;
+		break;
+	case CCDC_CID_DATA_SHIFT:
+		strlcpy(qctrl->name, "Data shift", sizeof(qctrl->name));
+		qctrl->minimum = CCDC_DATA_NO_SHIFT;
+		qctrl->maximum = CCDC_DATA_SHIFT_6BIT;
+		qctrl->default_value = 2;
+		break;
+	default:
+		return -EINVAL;
+	}
+	qctrl->type = V4L2_CTRL_TYPE_INTEGER;
+	qctrl->step = 1;
+	qctrl->flags = 0;
+	return 0;
+}
+
+static int ccdc_get_control(struct v4l2_control *ctrl)
+{
+	struct ccdc_config_params_raw *params = &ccdc_cfg.bayer.config_params;
+
+	if (ccdc_cfg.if_type != VPFE_RAW_BAYER)
+		return -EINVAL;
+
+	switch (ctrl->id) {
+	case CCDC_CID_ALAW_GAMMA_WD:
+		ctrl->value = params->alaw.gama_wd;
+		break;
+	case CCDC_CID_DATA_SHIFT:
+		ctrl->value = params->datasft;
+		break;
+	default:
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int ccdc_set_control(struct v4l2_control *ctrl)
+{
+	struct ccdc_config_params_raw params = ccdc_cfg.bayer.config_params;
+
+	if (ccdc_cfg.if_type != VPFE_RAW_BAYER)
+		return -EINVAL;
+
+	switch (ctrl->id) {
+	case CCDC_CID_ALAW_GAMMA_WD:
+		params.alaw.enable = 1;
+		params.alaw.gama_wd = ctrl->value;
+		break;
+	case CCDC_CID_DATA_SHIFT:
+		params.datasft = ctrl->value;
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (validate_ccdc_param(&params))
+		return -ERANGE;
+
+	params.alaw.enable = ccdc_cfg.bayer.config_params.alaw.enable;
+	ccdc_cfg.bayer.config_params = params;
+	return 0;
+}
+
 static u32 ccdc_get_pixel_format(void)
 {
 	struct ccdc_a_law *alaw = &ccdc_cfg.bayer.config_params.alaw;
@@ -888,7 +1002,23 @@ static unsigned int ccdc_get_line_length(void)
 			len = ccdc_cfg.bayer.win.width * 2;
 	} else
 		len = ccdc_cfg.ycbcr.win.width * 2;
-	return ALIGN(len, 32);
+	return ALIGN(len / ccdc_cfg.hdiv, 32);
+}
+
+static int ccdc_set_decimation(unsigned int *hdiv, unsigned int *vdiv)
+{
+	unsigned int hmax = ARRAY_SIZE(ccdc_cul_bayer);
+
+	if (ccdc_cfg.if_type != VPFE_RAW_BAYER)
+		hmax = ARRAY_SIZE(ccdc_culh_ycbcr);
+
+	/* the tables hold factors 1 << 0 .. 1 << (size - 1) */
+	*hdiv = rounddown_pow_of_two(clamp(*hdiv, 1U, 1U << (hmax - 1)));
+	*vdiv = rounddown_pow_of_two(clamp(*vdiv, 1U,
+				1U << (ARRAY_SIZE(ccdc_culv_ycbcr) - 1)));
+	ccdc_cfg.hdiv = *hdiv;
+	ccdc_cfg.vdiv = *vdiv;
+	return 0;
 }
 
 static int ccdc_set_frame_format(enum ccdc_frmfmt frm_fmt)
@@ -923,6 +1053,7 @@ static inline void ccdc_setfbaddr(unsigned long addr)
 static int ccdc_set_hw_if_params(struct vpfe_hw_if_param *params)
 {
 	ccdc_cfg.if_type = params->if_type;
+	ccdc_cfg.hdiv = ccdc_cfg.vdiv = 1;
 
 	switch (params->if_type) {
 	case VPFE_BT656:
@@ -959,6 +1090,10 @@ static struct ccdc_hw_device ccdc_hw_dev = {
 		.set_image_window = ccdc_set_image_window,
 		.get_image_window = ccdc_get_image_window,
 		.get_line_length = ccdc_get_line_length,
+		.set_decimation = ccdc_set_decimation,
+		.queryctrl = ccdc_queryctrl,
+		.get_control = ccdc_get_control,
+		.set_control = ccdc_set_control,
 		.setfbaddr = ccdc_setfbaddr,
 		.getfid = ccdc_getfid,
 	},
@@ -303,6 +303,7 @@
 #define MODESET_DEFAULT				0x200
 #define CULH_DEFAULT				0xFFFF
 #define CULV_DEFAULT				0xFF
+#define CCDC_CULH_CULHEVN_SHIFT			8
 #define GAIN_DEFAULT				256
 #define OUTCLIP_DEFAULT				0x3FFF
 #define LSCCFG2_DEFAULT				0xE
@@ -142,4 +142,6 @@
 #define CCDC_CCDCFG_Y8POS_SHIFT			11
 #define CCDC_SDOFST_FIELD_INTERLEAVED		0x249
 #define CCDC_NO_CULLING				0xffff00ff
+#define CCDC_CULLING_CULHEVN_SHIFT		24
+#define CCDC_CULLING_CULHODD_SHIFT		16
 #endif
@@ -62,7 +62,6 @@
  *		- Support for Raw Bayer RGB capture
  *		- Support for chaining Image Processor
  *		- Support for static allocation of buffers
- *		- Support for USERPTR IO
  *		- Support for STREAMON before QBUF
  *		- Support for control ioctls
  */
@@ -73,19 +72,24 @@
 #include <media/v4l2-common.h>
 #include <linux/io.h>
 #include <media/davinci/vpfe_capture.h>
+#include <media/davinci/vpss.h>
 #include "ccdc_hw_device.h"
 
 static int debug;
 static u32 numbuffers = 3;
 static u32 bufsize = (720 * 576 * 2);
+static int capture_priority = 1;
 
 module_param(numbuffers, uint, S_IRUGO);
 module_param(bufsize, uint, S_IRUGO);
 module_param(debug, int, 0644);
+module_param(capture_priority, int, 0644);
 
 MODULE_PARM_DESC(numbuffers, "buffer count (default:3)");
 MODULE_PARM_DESC(bufsize, "buffer size in bytes (default:720 x 576 x 2)");
 MODULE_PARM_DESC(debug, "Debug level 0-1");
+MODULE_PARM_DESC(capture_priority, "VPSS memory priority over display while "
+		 "streaming (default:1)");
 
 MODULE_DESCRIPTION("VPFE Video for Linux Capture Driver");
 MODULE_LICENSE("GPL");
@@ -365,6 +369,16 @@ static int vpfe_config_ccdc_image_format(struct vpfe_device *vpfe_dev)
 		ret = ccdc_dev->hw_ops.set_frame_format(frm_fmt);
 	return ret;
 }
+/* vpfe_clear_decimation: capture the crop window at full size */
+static void vpfe_clear_decimation(struct vpfe_device *vpfe_dev)
+{
+	vpfe_dev->hdiv = 1;
+	vpfe_dev->vdiv = 1;
+	if (ccdc_dev->hw_ops.set_decimation)
+		ccdc_dev->hw_ops.set_decimation(&vpfe_dev->hdiv,
+						&vpfe_dev->vdiv);
+}
+
 /*
  * vpfe_config_image_format()
  * For a given standard, this functions sets up the default
@@ -403,6 +417,7 @@ static int vpfe_config_image_format(struct vpfe_device *vpfe_dev,
 	vpfe_dev->crop.left = 0;
 	vpfe_dev->crop.width = vpfe_dev->std_info.active_pixels;
 	vpfe_dev->crop.height = vpfe_dev->std_info.active_lines;
+	vpfe_clear_decimation(vpfe_dev);
 	vpfe_dev->fmt.fmt.pix.width = vpfe_dev->crop.width;
 	vpfe_dev->fmt.fmt.pix.height = vpfe_dev->crop.height;
 
@@ -676,6 +691,12 @@ static void vpfe_stop_ccdc_capture(struct vpfe_device *vpfe_dev)
 	ccdc_dev->hw_ops.enable(0);
 	if (ccdc_dev->hw_ops.enable_out_to_sdram)
 		ccdc_dev->hw_ops.enable_out_to_sdram(0);
+	if (vpfe_dev->dma_prio) {
+		vpss_dma_priority_put(VPSS_DMA_CAPTURE);
+		vpfe_dev->dma_prio = 0;
+	}
+	v4l2_dbg(1, debug, &vpfe_dev->v4l2_dev, "ccdc wbl overflows: %u\n",
+		 vpss_wbl_overflows(VPSS_PCR_CCDC_WBL_O));
 }
 
 /*
@@ -948,6 +969,35 @@ static int vpfe_enum_fmt_vid_cap(struct file *file, void  *priv,
 	return -EINVAL;
 }
 
+/*
+ * vpfe_set_decimation()
+ * A format smaller than the crop window by at least half in a dimension
+ * is produced by CCDC culling instead of capturing the full window, which
+ * cuts the SDRAM write bandwidth by the same factor. The CCDC rounds the
+ * factors to what it supports and the format is adjusted to match.
+ */
+static void vpfe_set_decimation(struct vpfe_device *vpfe_dev,
+				struct v4l2_pix_format *pix)
+{
+	unsigned int hdiv = 1, vdiv = 1;
+
+	if (ccdc_dev->hw_ops.set_decimation && pix->width && pix->height) {
+		hdiv = vpfe_dev->crop.width / pix->width;
+		vdiv = vpfe_dev->crop.height / pix->height;
+	}
+	if ((hdiv < 2 && vdiv < 2) ||
+	    ccdc_dev->hw_ops.set_decimation(&hdiv, &vdiv)) {
+		vpfe_clear_decimation(vpfe_dev);
+		return;
+	}
+	vpfe_dev->hdiv = hdiv;
+	vpfe_dev->vdiv = vdiv;
+	pix->width = vpfe_dev->crop.width / hdiv;
+	pix->height = vpfe_dev->crop.height / vdiv;
+	if (pix->field == V4L2_FIELD_INTERLACED)
+		pix->height &= ~1;
+}
+
 static int vpfe_s_fmt_vid_cap(struct file *file, void *priv,
 				struct v4l2_format *fmt)
 {
@@ -976,9 +1026,18 @@ static int vpfe_s_fmt_vid_cap(struct file *file, void *priv,
 
 	/* First detach any IRQ if currently attached */
 	vpfe_detach_irq(vpfe_dev);
+	vpfe_set_decimation(vpfe_dev, &fmt->fmt.pix);
 	vpfe_dev->fmt = *fmt;
 	/* set image capture parameters in the ccdc */
 	ret = vpfe_config_ccdc_image_format(vpfe_dev);
+	if (!ret && (vpfe_dev->hdiv > 1 || vpfe_dev->vdiv > 1)) {
+		/* the ccdc decides the line length of a culled image */
+		fmt->fmt.pix.bytesperline =
+			ccdc_dev->hw_ops.get_line_length();
+		fmt->fmt.pix.sizeimage = fmt->fmt.pix.bytesperline *
+					 fmt->fmt.pix.height;
+		vpfe_dev->fmt = *fmt;
+	}
 	mutex_unlock(&vpfe_dev->lock);
 	return ret;
 }
@@ -1218,7 +1277,11 @@ static int vpfe_videobuf_setup(struct videobuf_queue *vq,
 	struct vpfe_device *vpfe_dev = fh->vpfe_dev;
 
 	v4l2_dbg(1, debug, &vpfe_dev->v4l2_dev, "vpfe_buffer_setup\n");
-	*size = config_params.device_bufsize;
+	/* user buffers only have to hold the current format */
+	if (vpfe_dev->memory == V4L2_MEMORY_USERPTR)
+		*size = vpfe_dev->fmt.fmt.pix.sizeimage;
+	else
+		*size = config_params.device_bufsize;
 
 	if (*count < config_params.min_numbuffers)
 		*count = config_params.min_numbuffers;
@@ -1233,6 +1296,8 @@ static int vpfe_videobuf_prepare(struct videobuf_queue *vq,
 {
 	struct vpfe_fh *fh = vq->priv_data;
 	struct vpfe_device *vpfe_dev = fh->vpfe_dev;
+	unsigned long addr;
+	int ret;
 
 	v4l2_dbg(1, debug, &vpfe_dev->v4l2_dev, "vpfe_buffer_prepare\n");
 
@@ -1242,6 +1307,23 @@ static int vpfe_videobuf_prepare(struct videobuf_queue *vq,
 		vb->height = vpfe_dev->fmt.fmt.pix.height;
 		vb->size = vpfe_dev->fmt.fmt.pix.sizeimage;
 		vb->field = field;
+
+		/*
+		 * For USERPTR this looks up the user pages and fails
+		 * unless they are physically contiguous.
+		 */
+		ret = videobuf_iolock(vq, vb, NULL);
+		if (ret < 0)
+			return ret;
+
+		/* the CCDC writes to SDRAM in 32 byte units */
+		addr = videobuf_to_dma_contig(vb);
+		if (addr & 0x1f) {
+			v4l2_err(&vpfe_dev->v4l2_dev,
+				 "buffer address is not aligned to 32 bytes\n");
+			videobuf_dma_contig_free(vq, vb);
+			return -EINVAL;
+		}
 	}
 	vb->state = VIDEOBUF_PREPARED;
 	return 0;
@@ -1277,11 +1359,15 @@ static void vpfe_videobuf_release(struct videobuf_queue *vq,
 
 	/*
 	 * We need to flush the buffer from the dma queue since
-	 * they are de-allocated
+	 * they are de-allocated.  A USERPTR buffer given a new address
+	 * by QBUF while streaming is released on its own; it is not on
+	 * the queue then and the other buffers must stay there.
 	 */
-	spin_lock_irqsave(&vpfe_dev->dma_queue_lock, flags);
-	INIT_LIST_HEAD(&vpfe_dev->dma_queue);
-	spin_unlock_irqrestore(&vpfe_dev->dma_queue_lock, flags);
+	if (vb->memory != V4L2_MEMORY_USERPTR || !vq->streaming) {
+		spin_lock_irqsave(&vpfe_dev->dma_queue_lock, flags);
+		INIT_LIST_HEAD(&vpfe_dev->dma_queue);
+		spin_unlock_irqrestore(&vpfe_dev->dma_queue_lock, flags);
+	}
 	videobuf_dma_contig_free(vq, vb);
 	vb->state = VIDEOBUF_NEEDS_INIT;
 }
@@ -1311,13 +1397,6 @@ static int vpfe_reqbufs(struct file *file, void *priv,
 		return -EINVAL;
 	}
 
-	if (V4L2_MEMORY_USERPTR == req_buf->memory) {
-		/* we don't support user ptr IO */
-		v4l2_dbg(1, debug, &vpfe_dev->v4l2_dev, "vpfe_reqbufs:"
-			 " USERPTR IO not supported\n");
-		return  -EINVAL;
-	}
-
 	ret = mutex_lock_interruptible(&vpfe_dev->lock);
 	if (ret)
 		return ret;
@@ -1359,7 +1438,8 @@ static int vpfe_querybuf(struct file *file, void *priv,
 		return  -EINVAL;
 	}
 
-	if (vpfe_dev->memory != V4L2_MEMORY_MMAP) {
+	if (vpfe_dev->memory != V4L2_MEMORY_MMAP &&
+	    vpfe_dev->memory != V4L2_MEMORY_USERPTR) {
 		v4l2_err(&vpfe_dev->v4l2_dev, "Invalid memory\n");
 		return -EINVAL;
 	}
@@ -1412,6 +1492,10 @@ static int vpfe_queryctrl(struct file *file, void *priv,
 	struct vpfe_device *vpfe_dev = video_drvdata(file);
 	struct vpfe_subdev_info *sdinfo;
 
+	/* CCDC controls first, then those of the decoder/sensor */
+	if (ccdc_dev->hw_ops.queryctrl && !ccdc_dev->hw_ops.queryctrl(qctrl))
+		return 0;
+
 	sdinfo = vpfe_dev->current_subdev;
 
 	return v4l2_device_call_until_err(&vpfe_dev->v4l2_dev, sdinfo->grp_id,
@@ -1424,6 +1508,9 @@ static int vpfe_g_ctrl(struct file *file, void *priv, struct v4l2_control *ctrl)
 	struct vpfe_device *vpfe_dev = video_drvdata(file);
 	struct vpfe_subdev_info *sdinfo;
 
+	if (ccdc_dev->hw_ops.get_control && !ccdc_dev->hw_ops.get_control(ctrl))
+		return 0;
+
 	sdinfo = vpfe_dev->current_subdev;
 
 	return v4l2_device_call_until_err(&vpfe_dev->v4l2_dev, sdinfo->grp_id,
@@ -1433,7 +1520,23 @@ static int vpfe_g_ctrl(struct file *file, void *priv, struct v4l2_control *ctrl)
 static int vpfe_s_ctrl(struct file *file, void *priv, struct v4l2_control *ctrl)
 {
 	struct vpfe_device *vpfe_dev = video_drvdata(file);
+	struct v4l2_queryctrl qctrl = { .id = ctrl->id };
 	struct vpfe_subdev_info *sdinfo;
+	int ret;
+
+	/* CCDC settings are only programmed when streaming starts */
+	if (ccdc_dev->hw_ops.queryctrl && ccdc_dev->hw_ops.set_control &&
+	    !ccdc_dev->hw_ops.queryctrl(&qctrl)) {
+		ret = mutex_lock_interruptible(&vpfe_dev->lock);
+		if (ret)
+			return ret;
+		if (vpfe_dev->started)
+			ret = -EBUSY;
+		else
+			ret = ccdc_dev->hw_ops.set_control(ctrl);
+		mutex_unlock(&vpfe_dev->lock);
+		return ret;
+	}
 
 	sdinfo = vpfe_dev->current_subdev;
 
@@ -1452,12 +1555,17 @@ static void vpfe_calculate_offsets(struct vpfe_device *vpfe_dev)
 	v4l2_dbg(1, debug, &vpfe_dev->v4l2_dev, "vpfe_calculate_offsets\n");
 
 	ccdc_dev->hw_ops.get_image_window(&image_win);
-	vpfe_dev->field_off = image_win.height * image_win.width;
+	vpfe_dev->field_off = (image_win.height / vpfe_dev->vdiv) *
+			      (image_win.width / vpfe_dev->hdiv);
 }
 
 /* vpfe_start_ccdc_capture: start streaming in ccdc/isif */
 static void vpfe_start_ccdc_capture(struct vpfe_device *vpfe_dev)
 {
+	/* display reads must not overflow the CCDC write buffer */
+	if (capture_priority && !vpfe_dev->dma_prio &&
+	    !vpss_dma_priority_get(VPSS_DMA_CAPTURE))
+		vpfe_dev->dma_prio = 1;
 	ccdc_dev->hw_ops.enable(1);
 	if (ccdc_dev->hw_ops.enable_out_to_sdram)
 		ccdc_dev->hw_ops.enable_out_to_sdram(1);
@@ -1668,6 +1776,8 @@ static int vpfe_s_crop(struct file *file, void *priv,
 		goto unlock_out;
 	}
 	ccdc_dev->hw_ops.set_image_window(&crop->c);
+	/* a new crop window is captured at full size until S_FMT scales it */
+	vpfe_clear_decimation(vpfe_dev);
 	vpfe_dev->fmt.fmt.pix.width = crop->c.width;
 	vpfe_dev->fmt.fmt.pix.height = crop->c.height;
 	vpfe_dev->fmt.fmt.pix.bytesperline =
@@ -51,18 +51,26 @@ static u32 ch0_numbuffers = 3;
 static u32 ch1_numbuffers = 3;
 static u32 ch0_bufsize = 1920 * 1080 * 2;
 static u32 ch1_bufsize = 720 * 576 * 2;
+static u32 ch0_queue_depth;
+static u32 ch1_queue_depth;
 
 module_param(debug, int, 0644);
 module_param(ch0_numbuffers, uint, S_IRUGO);
 module_param(ch1_numbuffers, uint, S_IRUGO);
 module_param(ch0_bufsize, uint, S_IRUGO);
 module_param(ch1_bufsize, uint, S_IRUGO);
+module_param(ch0_queue_depth, uint, S_IRUGO | S_IWUSR);
+module_param(ch1_queue_depth, uint, S_IRUGO | S_IWUSR);
 
 MODULE_PARM_DESC(debug, "Debug level 0-1");
 MODULE_PARM_DESC(ch2_numbuffers, "Channel0 buffer count (default:3)");
 MODULE_PARM_DESC(ch3_numbuffers, "Channel1 buffer count (default:3)");
 MODULE_PARM_DESC(ch2_bufsize, "Channel0 buffer size (default:1920 x 1080 x 2)");
 MODULE_PARM_DESC(ch3_bufsize, "Channel1 buffer size (default:720 x 576 x 2)");
+MODULE_PARM_DESC(ch0_queue_depth,
+		 "Channel0 captured frames kept for DQBUF (default:0, all)");
+MODULE_PARM_DESC(ch1_queue_depth,
+		 "Channel1 captured frames kept for DQBUF (default:0, all)");
 
 static struct vpif_config_params config_params = {
 	.min_numbuffers = 3,
@@ -121,7 +129,8 @@ static int vpif_buffer_prepare(struct videobuf_queue *q,
 	if (VIDEOBUF_NEEDS_INIT == vb->state) {
 		vb->width = common->width;
 		vb->height = common->height;
-		vb->size = vb->width * vb->height;
+		/* Y and C planes, so all of a user buffer gets checked */
+		vb->size = common->fmt.fmt.pix.sizeimage;
 		vb->field = field;
 
 		ret = videobuf_iolock(q, vb, NULL);
@@ -166,9 +175,11 @@ static int vpif_buffer_setup(struct videobuf_queue *q, unsigned int *count,
 
 	vpif_dbg(2, debug, "vpif_buffer_setup\n");
 
-	/* If memory type is not mmap, return */
-	if (V4L2_MEMORY_MMAP != common->memory)
+	/* user buffers, which may be another VPIF's, must hold a frame */
+	if (V4L2_MEMORY_MMAP != common->memory) {
+		*size = common->fmt.fmt.pix.sizeimage;
 		return 0;
+	}
 
 	/* Calculate the size of the buffer */
 	*size = config_params.channel_bufsize[ch->channel_id];
@@ -219,8 +230,8 @@ static void vpif_buffer_release(struct videobuf_queue *q,
 
 	common = &ch->common[VPIF_VIDEO_INDEX];
 
-	if (common->memory == V4L2_MEMORY_MMAP)
-		videobuf_dma_contig_free(q, vb);
+	/* drops the user mapping of a USERPTR buffer, MMAP ones are kept */
+	videobuf_dma_contig_free(q, vb);
 	vb->state = VIDEOBUF_NEEDS_INIT;
 }
 
@@ -238,13 +249,14 @@ static u8 channel_first_int[VPIF_NUMBER_OF_OBJECTS][2] =
  * vpif_process_buffer_complete: process a completed buffer
  * @common: ptr to common channel object
  *
- * This function time stamp the buffer and mark it as DONE. It also
- * wake up any process waiting on the QUEUE and set the next buffer
- * as current
+ * This function mark the buffer as DONE. It also wake up any process
+ * waiting on the QUEUE and set the next buffer as current.  The buffer
+ * was time stamped by vpif_frame_start() when its frame began.
  */
 static void vpif_process_buffer_complete(struct common_obj *common)
 {
-	do_gettimeofday(&common->cur_frm->ts);
+	common->stats.frames++;
+	atomic_inc(&common->done_count);
 	common->cur_frm->state = VIDEOBUF_DONE;
 	wake_up_interruptible(&common->cur_frm->done);
 	/* Make curFrm pointing to nextFrm */
@@ -277,6 +289,24 @@ static void vpif_schedule_next_buffer(struct common_obj *common)
 			 addr + common->cbtm_off);
 }
 
+/**
+ * vpif_frame_start: account for the frame starting at this interrupt
+ * @common : ptr to common channel object
+ * @now: time of the interrupt
+ *
+ * The frame is captured into next_frm, whose address was latched at
+ * the frame boundary, so that buffer is time stamped here.  Getting
+ * the same buffer twice in a row means the previous frame in it was
+ * captured over.
+ */
+static void vpif_frame_start(struct common_obj *common, struct timeval *now)
+{
+	if (common->next_frm == common->last_frm)
+		common->stats.dropped++;
+	common->last_frm = common->next_frm;
+	common->next_frm->ts = *now;
+}
+
 /**
  * vpif_channel_isr : ISR handler for vpif capture
  * @irq: irq number
@@ -292,6 +322,7 @@ static irqreturn_t vpif_channel_isr(int irq, void *dev_id)
 	struct common_obj *common;
 	struct channel_obj *ch;
 	enum v4l2_field field;
+	struct timeval now;
 	int channel_id = 0;
 	int fid = -1, i;
 
@@ -304,6 +335,8 @@ static irqreturn_t vpif_channel_isr(int irq, void *dev_id)
 			!config->intr_status(vpif_base, channel_id))
 		return IRQ_NONE;
 
+	do_gettimeofday(&now);
+
 	for (i = 0; i < VPIF_NUMBER_OF_OBJECTS; i++) {
 		common = &ch->common[i];
 		/* skip If streaming is not started in this channel */
@@ -313,6 +346,7 @@ static irqreturn_t vpif_channel_isr(int irq, void *dev_id)
 		/* Check the field format */
 		if (1 == ch->vpifparams.std_info.frm_fmt) {
 			/* Progressive mode */
+			vpif_frame_start(common, &now);
 			if (list_empty(&common->dma_queue))
 				continue;
 
@@ -345,12 +379,14 @@ static irqreturn_t vpif_channel_isr(int irq, void *dev_id)
 					 */
 					if (0 == fid)
 						ch->field_id = fid;
+					common->stats.overruns++;
 					return IRQ_HANDLED;
 				}
 			}
 			/* device field id and local field id are in sync */
 			if (0 == fid) {
 				/* this is even field */
+				vpif_frame_start(common, &now);
 				if (common->cur_frm == common->next_frm)
 					continue;
 
@@ -1021,11 +1057,37 @@ static int vpif_dqbuf(struct file *file, void *priv, struct v4l2_buffer *buf)
 	struct vpif_fh *fh = priv;
 	struct channel_obj *ch = fh->channel;
 	struct common_obj *common = &ch->common[VPIF_VIDEO_INDEX];
+	struct v4l2_buffer stale;
+	int ret;
 
 	vpif_dbg(2, debug, "vpif_dqbuf\n");
 
-	return videobuf_dqbuf(&common->buffer_queue, buf,
+	/*
+	 * When the application has fallen more than queue_depth frames
+	 * behind, hand the oldest ones straight back to the capture queue
+	 * so it gets a recent frame instead.
+	 */
+	while (common->queue_depth &&
+	       atomic_read(&common->done_count) > common->queue_depth) {
+		stale = *buf;
+		ret = videobuf_dqbuf(&common->buffer_queue, &stale, 1);
+		if (ret < 0 && ret != -EIO)
+			break;
+		atomic_add_unless(&common->done_count, -1, 0);
+		common->stats.late++;
+
+		ret = vpif_qbuf(file, priv, &stale);
+		if (ret < 0) {
+			vpif_err("failed to requeue buffer %d\n", stale.index);
+			break;
+		}
+	}
+
+	ret = videobuf_dqbuf(&common->buffer_queue, buf,
 					file->f_flags & O_NONBLOCK);
+	if (!ret)
+		atomic_add_unless(&common->done_count, -1, 0);
+	return ret;
 }
 
 /**
@@ -1121,6 +1183,10 @@ static int vpif_streamon(struct file *file, void *priv,
 	/* Initialize field_id and started member */
 	ch->field_id = 0;
 	common->started = 1;
+	common->last_frm = NULL;
+	atomic_set(&common->done_count, 0);
+	common->queue_depth = ch->channel_id ? ch1_queue_depth :
+					       ch0_queue_depth;
 
 	addr = videobuf_to_dma_contig(common->cur_frm);
 
@@ -1246,6 +1312,35 @@ static int vpif_streamoff(struct file *file, void *priv,
 	return videobuf_streamoff(&common->buffer_queue);
 }
 
+/*
+ * stats: frames, dropped, late and overruns counts of the channel,
+ * writing anything clears them.
+ */
+static ssize_t vpif_stats_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct channel_obj *ch = dev_get_drvdata(dev);
+	struct vpif_capture_stats *stats = &ch->common[VPIF_VIDEO_INDEX].stats;
+
+	return sprintf(buf, "frames %u\ndropped %u\nlate %u\noverruns %u\n",
+		       stats->frames, stats->dropped, stats->late,
+		       stats->overruns);
+}
+
+static ssize_t vpif_stats_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct channel_obj *ch = dev_get_drvdata(dev);
+
+	memset(&ch->common[VPIF_VIDEO_INDEX].stats, 0,
+	       sizeof(struct vpif_capture_stats));
+	return count;
+}
+
+static DEVICE_ATTR(stats, S_IRUGO | S_IWUSR, vpif_stats_show,
+		   vpif_stats_store);
+
 /**
  * vpif_map_sub_device_to_input() - Maps sub device to input
  * @ch - ptr to channel
@@ -1925,6 +2020,8 @@ static __init int vpif_probe(struct platform_device *pdev)
 
 		video_set_drvdata(ch->video_dev, ch);
 
+		if (device_create_file(&ch->video_dev->dev, &dev_attr_stats))
+			vpif_err("unable to create stats attribute\n");
 	}
 
 	i2c_adap = i2c_get_adapter(1);
@@ -2016,6 +2113,7 @@ static int vpif_remove(struct platform_device *device)
 	for (i = 0; i < VPIF_CAPTURE_MAX_DEVICES; i++) {
 		/* Get the pointer to the channel object */
 		ch = vpif_obj.dev[i];
+		device_remove_file(&ch->video_dev->dev, &dev_attr_stats);
 		/* Unregister video device */
 		video_unregister_device(ch->video_dev);
 	}
@@ -62,6 +62,18 @@ struct video_obj {
 	u32 input_idx;
 };
 
+/* Capture statistics, reported through the "stats" sysfs attribute */
+struct vpif_capture_stats {
+	/* frames handed to the application */
+	u32 frames;
+	/* frames captured over for lack of a queued buffer */
+	u32 dropped;
+	/* frames recycled at DQBUF for being more than queue_depth old */
+	u32 late;
+	/* field id lost sync, the interrupt came too late */
+	u32 overruns;
+};
+
 struct common_obj {
 	/* Pointer pointing to current v4l2_buffer */
 	struct videobuf_buffer *cur_frm;
@@ -101,6 +113,13 @@ struct common_obj {
 	u32 width;
 	/* Indicates height of the image data */
 	u32 height;
+	/* buffer the last frame was captured into */
+	struct videobuf_buffer *last_frm;
+	/* captured buffers not yet dequeued */
+	atomic_t done_count;
+	/* most done buffers kept for the application, 0 for all */
+	u32 queue_depth;
+	struct vpif_capture_stats stats;
 };
 
 struct channel_obj {
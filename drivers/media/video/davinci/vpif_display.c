@@ -109,16 +109,20 @@ static int vpif_buffer_prepare(struct videobuf_queue *q,
 	if (VIDEOBUF_NEEDS_INIT == vb->state) {
 		vb->width	= common->width;
 		vb->height	= common->height;
-		vb->size	= vb->width * vb->height;
+		/* Y and C planes, so all of a user buffer gets checked */
+		vb->size	= common->fmt.fmt.pix.sizeimage;
 		vb->field	= field;
 
 		ret = videobuf_iolock(q, vb, NULL);
 		if (ret < 0)
 			goto buf_align_exit;
 
+		/*
+		 * Checked for buffers queued ahead of STREAMON too: a
+		 * USERPTR one, say DSP output in CMEM, is scanned out as is
+		 */
 		addr = videobuf_to_dma_contig(vb);
-		if (q->streaming &&
-			(V4L2_BUF_TYPE_SLICED_VBI_OUTPUT != q->type)) {
+		if (V4L2_BUF_TYPE_SLICED_VBI_OUTPUT != q->type) {
 			if (!ISALIGNED(addr + common->ytop_off) ||
 			    !ISALIGNED(addr + common->ybtm_off) ||
 			    !ISALIGNED(addr + common->ctop_off) ||
@@ -144,8 +148,11 @@ static int vpif_buffer_setup(struct videobuf_queue *q, unsigned int *count,
 	struct channel_obj *ch = fh->channel;
 	struct common_obj *common = &ch->common[VPIF_VIDEO_INDEX];
 
-	if (V4L2_MEMORY_MMAP != common->memory)
+	/* user buffers, which may be another VPIF's, must hold a frame */
+	if (V4L2_MEMORY_MMAP != common->memory) {
+		*size = common->fmt.fmt.pix.sizeimage;
 		return 0;
+	}
 
 	*size = config_params.channel_bufsize[ch->channel_id];
 	if (*count < config_params.min_numbuffers)
@@ -184,8 +191,8 @@ static void vpif_buffer_release(struct videobuf_queue *q,
 
 	common = &ch->common[VPIF_VIDEO_INDEX];
 
-	if (V4L2_MEMORY_USERPTR != vb->memory)
-		videobuf_dma_contig_free(q, vb);
+	/* drops the user mapping of a USERPTR buffer, MMAP ones are kept */
+	videobuf_dma_contig_free(q, vb);
 
 	vb->state = VIDEOBUF_NEEDS_INIT;
 
@@ -228,8 +235,10 @@ static void process_interlaced_mode(int fid, struct common_obj *common)
 	/* device field id and local field id are in sync */
 	/* If this is even field */
 	if (0 == fid) {
-		if (common->cur_frm == common->next_frm)
+		if (common->cur_frm == common->next_frm) {
+			common->repeats++;
 			return;
+		}
 
 		/* one frame is displayed If next frame is
 		 *  available, release cur_frm and move on */
@@ -285,11 +294,15 @@ static irqreturn_t vpif_channel_isr(int irq, void *dev_id)
 			continue;
 
 		if (1 == ch->vpifparams.std_info.frm_fmt) {
-			if (list_empty(&common->dma_queue))
-				continue;
-
-			/* Progressive mode */
-			if (!channel_first_int[i][channel_id]) {
+			/*
+			 * Progressive mode. next_frm, programmed at the last
+			 * interrupt, is being scanned out now, so cur_frm is
+			 * done with even when nothing new was queued. With
+			 * an empty queue the VPIF just shows next_frm again,
+			 * and only that last frame stays held by the driver.
+			 */
+			if (!channel_first_int[i][channel_id] &&
+			    common->cur_frm != common->next_frm) {
 				/* Mark status of the cur_frm to
 				 * done and unlock semaphore on it */
 				do_gettimeofday(&common->cur_frm->ts);
@@ -297,9 +310,13 @@ static irqreturn_t vpif_channel_isr(int irq, void *dev_id)
 				wake_up_interruptible(&common->cur_frm->done);
 				/* Make cur_frm pointing to next_frm */
 				common->cur_frm = common->next_frm;
+			} else if (!channel_first_int[i][channel_id]) {
+				common->repeats++;
 			}
 
 			channel_first_int[i][channel_id] = 0;
+			if (list_empty(&common->dma_queue))
+				continue;
 			process_progressive_mode(common);
 		} else {
 			/* Interlaced mode */
@@ -1029,6 +1046,7 @@ static int vpif_streamon(struct file *file, void *priv,
 
 	/* Initialize field_id and started member */
 	ch->field_id = 0;
+	common->repeats = 0;
 	common->started = 1;
 	if (buftype == V4L2_BUF_TYPE_VIDEO_OUTPUT) {
 		addr = videobuf_to_dma_contig(common->cur_frm);
@@ -1129,6 +1147,9 @@ static int vpif_streamoff(struct file *file, void *priv,
 	common->started = 0;
 	mutex_unlock(&common->lock);
 
+	vpif_dbg(1, debug, "channel %d: %u frames repeated\n",
+		 ch->channel_id + 2, common->repeats);
+
 	return videobuf_streamoff(&common->buffer_queue);
 }
 
@@ -114,6 +114,8 @@ struct common_obj {
 				unsigned long, unsigned long);
 	u32 height;
 	u32 width;
+	u32 repeats;				/* frames shown again for lack
+						 * of a newly queued buffer */
 };
 
 struct channel_obj {
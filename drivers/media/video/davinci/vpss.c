@@ -34,6 +34,8 @@ MODULE_AUTHOR("Texas Instruments");
 
 /* DM644x defines */
 #define DM644X_SBL_PCR_VPSS		(4)
+/* PCR.EXPRITY: VPFE (1) or VPBE (0) first on external memory requests */
+#define DM644X_PCR_EXPRITY		BIT(0)
 
 /* vpss BL register offsets */
 #define DM355_VPSSBL_CCDCMUX		0x1c
@@ -55,8 +57,12 @@ struct vpss_hw_ops {
 	void (*select_ccdc_source)(enum vpss_ccdc_source_sel src_sel);
 	/* clear wbl overflow bit */
 	int (*clear_wbl_overflow)(enum vpss_wbl_sel wbl_sel);
+	/* give a master priority on external memory */
+	void (*set_dma_priority)(enum vpss_dma_master master);
 };
 
+#define VPSS_NUM_WBL	(VPSS_PCR_CCDC_WBL_O - VPSS_PCR_AEW_WBL_0 + 1)
+
 /* vpss configuration */
 struct vpss_oper_config {
 	__iomem void *vpss_bl_regs_base;
@@ -68,6 +74,11 @@ struct vpss_oper_config {
 	char vpss_name[32];
 	spinlock_t vpss_lock;
 	struct vpss_hw_ops hw_ops;
+	/* overflows found when clearing, per write buffer */
+	unsigned int wbl_overflows[VPSS_NUM_WBL];
+	/* priority requests per master, under vpss_lock */
+	unsigned int prio_users[VPSS_DMA_NUM_MASTERS];
+	enum vpss_dma_master prio_master;
 };
 
 static struct vpss_oper_config oper_cfg;
@@ -110,19 +121,37 @@ EXPORT_SYMBOL(vpss_select_ccdc_source);
 
 static int dm644x_clear_wbl_overflow(enum vpss_wbl_sel wbl_sel)
 {
+	unsigned long flags;
 	u32 mask = 1, val;
 
 	if (wbl_sel < VPSS_PCR_AEW_WBL_0 ||
 	    wbl_sel > VPSS_PCR_CCDC_WBL_O)
 		return -1;
 
-	/* writing a 0 clear the overflow */
-	mask = ~(mask << wbl_sel);
-	val = bl_regr(DM644X_SBL_PCR_VPSS) & mask;
-	bl_regw(val, DM644X_SBL_PCR_VPSS);
+	mask <<= wbl_sel;
+	spin_lock_irqsave(&oper_cfg.vpss_lock, flags);
+	val = bl_regr(DM644X_SBL_PCR_VPSS);
+	if (val & mask) {
+		oper_cfg.wbl_overflows[wbl_sel - VPSS_PCR_AEW_WBL_0]++;
+		/* writing a 0 clear the overflow */
+		bl_regw(val & ~mask, DM644X_SBL_PCR_VPSS);
+	}
+	spin_unlock_irqrestore(&oper_cfg.vpss_lock, flags);
 	return 0;
 }
 
+static void dm644x_set_dma_priority(enum vpss_dma_master master)
+{
+	u32 val = bl_regr(DM644X_SBL_PCR_VPSS);
+
+	if (master == VPSS_DMA_CAPTURE)
+		val |= DM644X_PCR_EXPRITY;
+	else
+		val &= ~DM644X_PCR_EXPRITY;
+	/* keep the overflow flags, only a 0 clears them */
+	bl_regw(val, DM644X_SBL_PCR_VPSS);
+}
+
 int vpss_clear_wbl_overflow(enum vpss_wbl_sel wbl_sel)
 {
 	if (!oper_cfg.hw_ops.clear_wbl_overflow)
@@ -132,6 +161,121 @@ int vpss_clear_wbl_overflow(enum vpss_wbl_sel wbl_sel)
 }
 EXPORT_SYMBOL(vpss_clear_wbl_overflow);
 
+/*
+ * vpss_wbl_overflows - write buffer overflows found by
+ * vpss_clear_wbl_overflow() since probe
+ */
+unsigned int vpss_wbl_overflows(enum vpss_wbl_sel wbl_sel)
+{
+	if (wbl_sel < VPSS_PCR_AEW_WBL_0 ||
+	    wbl_sel > VPSS_PCR_CCDC_WBL_O)
+		return 0;
+
+	return oper_cfg.wbl_overflows[wbl_sel - VPSS_PCR_AEW_WBL_0];
+}
+EXPORT_SYMBOL(vpss_wbl_overflows);
+
+/*
+ * caller holds vpss_lock. A display request pins display priority,
+ * otherwise capture wins while it holds one
+ */
+static void vpss_update_dma_priority(void)
+{
+	enum vpss_dma_master master = VPSS_DMA_DISPLAY;
+
+	if (oper_cfg.prio_users[VPSS_DMA_CAPTURE] &&
+	    !oper_cfg.prio_users[VPSS_DMA_DISPLAY])
+		master = VPSS_DMA_CAPTURE;
+	if (master != oper_cfg.prio_master) {
+		oper_cfg.hw_ops.set_dma_priority(master);
+		oper_cfg.prio_master = master;
+	}
+}
+
+/*
+ *  vpss_dma_priority_get - Request external memory priority
+ *  @master: capture (VPFE) or display (VPBE) side
+ *
+ *  The VPSS arbitrates the external memory requests of its capture and
+ *  display sides. Capture write buffers overflow and drop data when
+ *  display reads win for too long, while a late display read only
+ *  repeats a line, so capture is given priority while it has asked for
+ *  it. A display request overrides that, for systems where the display
+ *  must never glitch. Returns -1 where the priority is fixed.
+ */
+int vpss_dma_priority_get(enum vpss_dma_master master)
+{
+	unsigned long flags;
+
+	if (!oper_cfg.hw_ops.set_dma_priority ||
+	    master >= VPSS_DMA_NUM_MASTERS)
+		return -1;
+
+	spin_lock_irqsave(&oper_cfg.vpss_lock, flags);
+	oper_cfg.prio_users[master]++;
+	vpss_update_dma_priority();
+	spin_unlock_irqrestore(&oper_cfg.vpss_lock, flags);
+	return 0;
+}
+EXPORT_SYMBOL(vpss_dma_priority_get);
+
+/*
+ *  vpss_dma_priority_put - Drop a request of vpss_dma_priority_get()
+ *  @master: capture (VPFE) or display (VPBE) side
+ */
+void vpss_dma_priority_put(enum vpss_dma_master master)
+{
+	unsigned long flags;
+
+	if (!oper_cfg.hw_ops.set_dma_priority ||
+	    master >= VPSS_DMA_NUM_MASTERS)
+		return;
+
+	spin_lock_irqsave(&oper_cfg.vpss_lock, flags);
+	if (oper_cfg.prio_users[master])
+		oper_cfg.prio_users[master]--;
+	vpss_update_dma_priority();
+	spin_unlock_irqrestore(&oper_cfg.vpss_lock, flags);
+}
+EXPORT_SYMBOL(vpss_dma_priority_put);
+
+static const char *const vpss_wbl_names[VPSS_NUM_WBL] = {
+	"aew", "af", "rsz4", "rsz3", "rsz2", "rsz1", "prev", "ccdc",
+};
+
+static ssize_t vpss_show_wbl_overflows(struct device *dev,
+				       struct device_attribute *attr, char *buf)
+{
+	int i, len = 0;
+
+	for (i = 0; i < VPSS_NUM_WBL; i++)
+		len += sprintf(buf + len, "%s %u\n", vpss_wbl_names[i],
+			       oper_cfg.wbl_overflows[i]);
+	return len;
+}
+static DEVICE_ATTR(wbl_overflows, S_IRUGO, vpss_show_wbl_overflows, NULL);
+
+static ssize_t vpss_show_dma_priority(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%s (capture %u, display %u)\n",
+		       oper_cfg.prio_master == VPSS_DMA_CAPTURE ?
+		       "capture" : "display",
+		       oper_cfg.prio_users[VPSS_DMA_CAPTURE],
+		       oper_cfg.prio_users[VPSS_DMA_DISPLAY]);
+}
+static DEVICE_ATTR(dma_priority, S_IRUGO, vpss_show_dma_priority, NULL);
+
+static struct attribute *vpss_dm644x_attrs[] = {
+	&dev_attr_wbl_overflows.attr,
+	&dev_attr_dma_priority.attr,
+	NULL,
+};
+
+static const struct attribute_group vpss_dm644x_attr_group = {
+	.attrs = vpss_dm644x_attrs,
+};
+
 /*
  *  dm355_enable_clock - Enable VPSS Clock
  *  @clock_sel: CLock to be enabled/disabled
@@ -249,13 +393,21 @@ static int __init vpss_probe(struct platform_device *pdev)
 		}
 	}
 
+	spin_lock_init(&oper_cfg.vpss_lock);
 	if (dm355) {
 		oper_cfg.hw_ops.enable_clock = dm355_enable_clock;
 		oper_cfg.hw_ops.select_ccdc_source = dm355_select_ccdc_source;
-	} else
+	} else {
 		oper_cfg.hw_ops.clear_wbl_overflow = dm644x_clear_wbl_overflow;
+		oper_cfg.hw_ops.set_dma_priority = dm644x_set_dma_priority;
+		/* display first until capture asks, as out of reset */
+		oper_cfg.prio_master = VPSS_DMA_DISPLAY;
+		dm644x_set_dma_priority(VPSS_DMA_DISPLAY);
+		if (sysfs_create_group(&pdev->dev.kobj,
+				       &vpss_dm644x_attr_group))
+			dev_warn(&pdev->dev, "no sysfs statistics\n");
+	}
 
-	spin_lock_init(&oper_cfg.vpss_lock);
 	dev_info(&pdev->dev, "%s vpss probe success\n", oper_cfg.vpss_name);
 	return 0;
 
@@ -270,6 +422,8 @@ fail1:
 
 static int __devexit vpss_remove(struct platform_device *pdev)
 {
+	if (oper_cfg.hw_ops.set_dma_priority)
+		sysfs_remove_group(&pdev->dev.kobj, &vpss_dm644x_attr_group);
 	iounmap(oper_cfg.vpss_bl_regs_base);
 	release_mem_region(oper_cfg.r1->start, oper_cfg.len1);
 	if (!strcmp(oper_cfg.vpss_name, "dm355_vpss")) {
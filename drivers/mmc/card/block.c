@@ -146,6 +146,7 @@ static const struct block_device_operations mmc_bdops = {
 
 struct mmc_blk_request {
 	struct mmc_request	mrq;
+	struct mmc_command	sbc;
 	struct mmc_command	cmd;
 	struct mmc_command	stop;
 	struct mmc_data		data;
@@ -241,6 +242,20 @@ static u32 get_card_status(struct mmc_card *card, struct request *req)
 	return cmd.resp[0];
 }
 
+/*
+ * Cards that take SET_BLOCK_COUNT get multiblock transfers of a known
+ * length, which they end on their own: no STOP_TRANSMISSION, and no busy
+ * wait after one, per request.
+ */
+static int mmc_blk_use_cmd23(struct mmc_card *card, unsigned int blocks)
+{
+	if (!(card->host->caps & MMC_CAP_CMD23) || blocks > 0xffff)
+		return 0;
+	if (mmc_card_sd(card))
+		return card->scr.cmds & SD_SCR_CMD23_SUPPORT;
+	return card->csd.mmca_vsn >= CSD_SPEC_VER_3;
+}
+
 static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_blk_data *md = mq->data;
@@ -293,6 +308,14 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 				brq.mrq.stop = &brq.stop;
 			readcmd = MMC_READ_MULTIPLE_BLOCK;
 			writecmd = MMC_WRITE_MULTIPLE_BLOCK;
+
+			/* The host still sends the stop after errors. */
+			if (mmc_blk_use_cmd23(card, brq.data.blocks)) {
+				brq.sbc.opcode = MMC_SET_BLOCK_COUNT;
+				brq.sbc.arg = brq.data.blocks;
+				brq.sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
+				brq.mrq.sbc = &brq.sbc;
+			}
 		} else {
 			brq.mrq.stop = NULL;
 			readcmd = MMC_READ_SINGLE_BLOCK;
@@ -333,7 +356,10 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 
 		mmc_queue_bounce_pre(mq);
 
+		mmc_pre_req(card->host, &brq.mrq);
 		mmc_wait_for_req(card->host, &brq.mrq);
+		mmc_post_req(card->host, &brq.mrq, brq.cmd.error ?
+				brq.cmd.error : brq.data.error);
 
 		mmc_queue_bounce_post(mq);
 
@@ -342,7 +368,8 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 		 * until later as we need to wait for the card to leave
 		 * programming mode even when things go wrong.
 		 */
-		if (brq.cmd.error || brq.data.error || brq.stop.error) {
+		if (brq.sbc.error || brq.cmd.error || brq.data.error ||
+		    brq.stop.error) {
 			if (brq.data.blocks > 1 && rq_data_dir(req) == READ) {
 				/* Redo read one sector at a time */
 				printk(KERN_WARNING "%s: retrying using single "
@@ -353,6 +380,13 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 			status = get_card_status(card, req);
 		}
 
+		if (brq.sbc.error) {
+			printk(KERN_ERR "%s: error %d sending SET_BLOCK_COUNT "
+			       "command, response %#x, card status %#x\n",
+			       req->rq_disk->disk_name, brq.sbc.error,
+			       brq.sbc.resp[0], status);
+		}
+
 		if (brq.cmd.error) {
 			printk(KERN_ERR "%s: error %d sending read/write "
 			       "command, response %#x, card status %#x\n",
@@ -378,7 +412,13 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 			       brq.stop.resp[0], status);
 		}
 
-		if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ) {
+		/*
+		 * A host that waits while the card is busy has already waited
+		 * out the programming that ended with the stop command.
+		 */
+		if (!mmc_host_is_spi(card->host) && rq_data_dir(req) != READ &&
+		    !(brq.mrq.stop && !brq.mrq.sbc && !brq.stop.error &&
+		      (card->host->caps & MMC_CAP_WAIT_WHILE_BUSY))) {
 			do {
 				int err;
 
@@ -408,7 +448,8 @@ static int mmc_blk_issue_rq(struct mmc_queue *mq, struct request *req)
 #endif
 		}
 
-		if (brq.cmd.error || brq.stop.error || brq.data.error) {
+		if (brq.sbc.error || brq.cmd.error || brq.stop.error ||
+		    brq.data.error) {
 			if (rq_data_dir(req) == READ) {
 				/*
 				 * After an error, we redo I/O one sector at a
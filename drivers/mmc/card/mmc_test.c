@@ -15,6 +15,10 @@
 #include <linux/mmc/mmc.h>
 
 #include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
 
 #define RESULT_OK		0
 #define RESULT_FAIL		1
@@ -24,8 +28,24 @@
 #define BUFFER_ORDER		2
 #define BUFFER_SIZE		(PAGE_SIZE << BUFFER_ORDER)
 
+/* Performance tests: area of the card used, largest transfer, random ops */
+#define PERF_AREA_SIZE		(4 << 20)
+#define PERF_MAX_XFER		(256 << 10)
+#define PERF_MAX_PAGES		(PERF_MAX_XFER / PAGE_SIZE)
+#define PERF_RANDOM_OPS		256
+
+struct mmc_test_perf {
+	struct page	*pages[PERF_MAX_PAGES];
+	struct scatterlist sg[PERF_MAX_PAGES];
+	unsigned	max_xfer;	/* largest transfer the host takes */
+	unsigned	ops;
+	u32		max;
+	u32		lat[PERF_AREA_SIZE / 512];
+};
+
 struct mmc_test_card {
 	struct mmc_card	*card;
+	struct mmc_test_perf *perf;
 
 	u8		scratch[BUFFER_SIZE];
 	u8		*buffer;
@@ -891,6 +911,242 @@ static int mmc_test_multi_read_high(struct mmc_test_card *test)
 
 #endif /* CONFIG_HIGHMEM */
 
+/*
+ * Performance tests. Each one prints a "result" line of key=value pairs
+ * per transfer size, with the throughput and latency percentiles of the
+ * single transfers, to be compared between kernels by a script. To
+ * compare DMA and PIO, run them again after reloading the host driver
+ * with DMA disabled (e.g. davinci_mmc use_dma=0).
+ */
+
+static int mmc_test_perf_cleanup(struct mmc_test_card *test);
+
+static int mmc_test_perf_prepare(struct mmc_test_card *test)
+{
+	struct mmc_host *host = test->card->host;
+	struct mmc_test_perf *perf;
+	unsigned segs;
+	int i;
+
+	perf = vmalloc(sizeof(*perf));
+	if (!perf)
+		return -ENOMEM;
+	memset(perf, 0, sizeof(*perf));
+	test->perf = perf;
+
+	for (i = 0; i < PERF_MAX_PAGES; i++) {
+		perf->pages[i] = alloc_page(GFP_KERNEL);
+		if (!perf->pages[i]) {
+			mmc_test_perf_cleanup(test);
+			return -ENOMEM;
+		}
+	}
+
+	segs = min(host->max_hw_segs, host->max_phys_segs);
+	perf->max_xfer = PERF_MAX_XFER;
+	perf->max_xfer = min(perf->max_xfer, host->max_req_size);
+	perf->max_xfer = min(perf->max_xfer, host->max_blk_count * 512);
+	perf->max_xfer = min_t(unsigned, perf->max_xfer,
+			       segs * min_t(unsigned, PAGE_SIZE,
+					    host->max_seg_size));
+	perf->max_xfer &= ~511;
+
+	return 0;
+}
+
+static int mmc_test_perf_cleanup(struct mmc_test_card *test)
+{
+	struct mmc_test_perf *perf = test->perf;
+	int i;
+
+	if (!perf)
+		return 0;
+
+	for (i = 0; i < PERF_MAX_PAGES; i++)
+		if (perf->pages[i])
+			__free_page(perf->pages[i]);
+	vfree(perf);
+	test->perf = NULL;
+	return 0;
+}
+
+/*
+ * Transfer @size bytes at byte offset @offs of the test area, and account
+ * the time it took, including waiting for the card to finish programming.
+ */
+static int mmc_test_perf_xfer(struct mmc_test_card *test, unsigned offs,
+	unsigned size, int write)
+{
+	struct mmc_test_perf *perf = test->perf;
+	struct mmc_request mrq;
+	struct mmc_command cmd;
+	struct mmc_command stop;
+	struct mmc_data data;
+	unsigned dev_addr, sg_len, left, seg;
+	ktime_t t0;
+	u32 us;
+	int ret;
+
+	seg = min_t(unsigned, PAGE_SIZE, test->card->host->max_seg_size);
+	sg_len = DIV_ROUND_UP(size, seg);
+	sg_init_table(perf->sg, sg_len);
+	for (left = size, sg_len = 0; left; sg_len++) {
+		unsigned len = min(left, seg);
+
+		sg_set_page(&perf->sg[sg_len], perf->pages[sg_len], len, 0);
+		left -= len;
+	}
+
+	dev_addr = offs;
+	if (mmc_card_blockaddr(test->card))
+		dev_addr >>= 9;
+
+	memset(&mrq, 0, sizeof(struct mmc_request));
+	memset(&cmd, 0, sizeof(struct mmc_command));
+	memset(&data, 0, sizeof(struct mmc_data));
+	memset(&stop, 0, sizeof(struct mmc_command));
+
+	mrq.cmd = &cmd;
+	mrq.data = &data;
+	mrq.stop = &stop;
+
+	mmc_test_prepare_mrq(test, &mrq, perf->sg, sg_len, dev_addr,
+		size / 512, 512, write);
+
+	t0 = ktime_get();
+	mmc_wait_for_req(test->card->host, &mrq);
+	if (write)
+		mmc_test_wait_busy(test);
+	us = ktime_to_us(ktime_sub(ktime_get(), t0));
+
+	ret = mmc_test_check_result(test, &mrq);
+	if (ret)
+		return ret;
+
+	perf->lat[perf->ops % ARRAY_SIZE(perf->lat)] = us;
+	if (us > perf->max)
+		perf->max = us;
+	perf->ops += 1;
+	return 0;
+}
+
+static int mmc_test_cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void mmc_test_perf_report(struct mmc_test_card *test,
+	const char *name, unsigned size, ktime_t start)
+{
+	struct mmc_test_perf *perf = test->perf;
+	s64 us = ktime_to_us(ktime_sub(ktime_get(), start));
+	u64 kib = (u64)perf->ops * size * 1000000;
+	unsigned n = min_t(unsigned, perf->ops, ARRAY_SIZE(perf->lat));
+
+	if (!n)
+		return;
+
+	do_div(kib, 1024);
+	if (us > 0)
+		do_div(kib, us);
+
+	sort(perf->lat, n, sizeof(u32), mmc_test_cmp_u32, NULL);
+	printk(KERN_INFO "%s: result test=%s size=%u ops=%u kib_s=%llu "
+		"p50_us=%u p90_us=%u p99_us=%u max_us=%u\n",
+		mmc_hostname(test->card->host), name, size, perf->ops,
+		(unsigned long long)kib, perf->lat[(n - 1) * 50 / 100],
+		perf->lat[(n - 1) * 90 / 100], perf->lat[(n - 1) * 99 / 100],
+		perf->max);
+}
+
+/*
+ * Go through the test area once for each power of two transfer size from
+ * 512 bytes up to what the host can take in one request.
+ */
+static int mmc_test_perf_seq(struct mmc_test_card *test, int write)
+{
+	struct mmc_test_perf *perf = test->perf;
+	unsigned size, offs;
+	int ret;
+
+	if (!perf->max_xfer)
+		return RESULT_UNSUP_HOST;
+
+	ret = mmc_test_set_blksize(test, 512);
+	if (ret)
+		return ret;
+
+	for (size = 512; size <= perf->max_xfer; size <<= 1) {
+		ktime_t start = ktime_get();
+
+		perf->ops = 0;
+		perf->max = 0;
+		for (offs = 0; offs + size <= PERF_AREA_SIZE; offs += size) {
+			ret = mmc_test_perf_xfer(test, offs, size, write);
+			if (ret)
+				return ret;
+		}
+		mmc_test_perf_report(test, write ? "seq_write" : "seq_read",
+			size, start);
+	}
+
+	return 0;
+}
+
+static int mmc_test_perf_random(struct mmc_test_card *test, int write)
+{
+	struct mmc_test_perf *perf = test->perf;
+	unsigned size = min_t(unsigned, 4096, perf->max_xfer);
+	unsigned long rnd = 1;
+	ktime_t start;
+	int i, ret;
+
+	if (!perf->max_xfer)
+		return RESULT_UNSUP_HOST;
+
+	ret = mmc_test_set_blksize(test, 512);
+	if (ret)
+		return ret;
+
+	start = ktime_get();
+	perf->ops = 0;
+	perf->max = 0;
+	for (i = 0; i < PERF_RANDOM_OPS; i++) {
+		rnd = rnd * 1103515245 + 12345;
+		ret = mmc_test_perf_xfer(test,
+			((rnd >> 8) % (PERF_AREA_SIZE / size)) * size,
+			size, write);
+		if (ret)
+			return ret;
+	}
+	mmc_test_perf_report(test, write ? "rand_write" : "rand_read",
+		size, start);
+
+	return 0;
+}
+
+static int mmc_test_perf_seq_write(struct mmc_test_card *test)
+{
+	return mmc_test_perf_seq(test, 1);
+}
+
+static int mmc_test_perf_seq_read(struct mmc_test_card *test)
+{
+	return mmc_test_perf_seq(test, 0);
+}
+
+static int mmc_test_perf_rand_write(struct mmc_test_card *test)
+{
+	return mmc_test_perf_random(test, 1);
+}
+
+static int mmc_test_perf_rand_read(struct mmc_test_card *test)
+{
+	return mmc_test_perf_random(test, 0);
+}
+
 static const struct mmc_test_case mmc_test_cases[] = {
 	{
 		.name = "Basic write (no data verification)",
@@ -1038,6 +1294,34 @@ static const struct mmc_test_case mmc_test_cases[] = {
 
 #endif /* CONFIG_HIGHMEM */
 
+	{
+		.name = "Sequential write performance by transfer size",
+		.prepare = mmc_test_perf_prepare,
+		.run = mmc_test_perf_seq_write,
+		.cleanup = mmc_test_perf_cleanup,
+	},
+
+	{
+		.name = "Sequential read performance by transfer size",
+		.prepare = mmc_test_perf_prepare,
+		.run = mmc_test_perf_seq_read,
+		.cleanup = mmc_test_perf_cleanup,
+	},
+
+	{
+		.name = "Random write performance",
+		.prepare = mmc_test_perf_prepare,
+		.run = mmc_test_perf_rand_write,
+		.cleanup = mmc_test_perf_cleanup,
+	},
+
+	{
+		.name = "Random read performance",
+		.prepare = mmc_test_perf_prepare,
+		.run = mmc_test_perf_rand_read,
+		.cleanup = mmc_test_perf_cleanup,
+	},
+
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
@@ -131,7 +131,12 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, mq->queue);
 
 #ifdef CONFIG_MMC_BLOCK_BOUNCE
-	if (host->max_hw_segs == 1) {
+	/*
+	 * Hosts that can only do one segment bounce every request. Hosts
+	 * that ask for it with bounce_segs keep their scatter-gather limits
+	 * and only bounce the requests made of many small segments.
+	 */
+	if (host->max_hw_segs == 1 || host->bounce_segs) {
 		unsigned int bouncesz;
 
 		bouncesz = MMC_QUEUE_BOUNCESZ;
@@ -152,7 +157,18 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 			}
 		}
 
-		if (mq->bounce_buf) {
+		if (mq->bounce_buf && host->max_hw_segs > 1) {
+			mq->bounce_sz = bouncesz;
+			mq->bounce_segs = host->bounce_segs;
+			mq->bounce_sg = kmalloc(sizeof(struct scatterlist) *
+				host->max_phys_segs, GFP_KERNEL);
+			if (!mq->bounce_sg) {
+				ret = -ENOMEM;
+				goto cleanup_queue;
+			}
+			sg_init_table(mq->bounce_sg, host->max_phys_segs);
+		} else if (mq->bounce_buf) {
+			mq->bounce_sz = bouncesz;
 			blk_queue_bounce_limit(mq->queue, BLK_BOUNCE_ANY);
 			blk_queue_max_sectors(mq->queue, bouncesz / 512);
 			blk_queue_max_phys_segments(mq->queue, bouncesz / 512);
@@ -178,7 +194,7 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 	}
 #endif
 
-	if (!mq->bounce_buf) {
+	if (!mq->bounce_buf || mq->bounce_segs) {
 		blk_queue_bounce_limit(mq->queue, limit);
 		blk_queue_max_sectors(mq->queue,
 			min(host->max_blk_count, host->max_req_size / 512));
@@ -190,7 +206,7 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card, spinlock_t *lock
 			host->max_phys_segs, GFP_KERNEL);
 		if (!mq->sg) {
 			ret = -ENOMEM;
-			goto cleanup_queue;
+			goto free_bounce_sg;
 		}
 		sg_init_table(mq->sg, host->max_phys_segs);
 	}
@@ -305,10 +321,18 @@ unsigned int mmc_queue_map_sg(struct mmc_queue *mq)
 	struct scatterlist *sg;
 	int i;
 
+	mq->bouncing = 0;
 	if (!mq->bounce_buf)
 		return blk_rq_map_sg(mq->queue, mq->req, mq->sg);
 
+	/* with bounce_segs, only requests that are fragmented and fit */
+	if (mq->bounce_segs &&
+	    (mq->req->nr_phys_segments <= mq->bounce_segs ||
+	     blk_rq_bytes(mq->req) > mq->bounce_sz))
+		return blk_rq_map_sg(mq->queue, mq->req, mq->sg);
+
 	BUG_ON(!mq->bounce_sg);
+	mq->bouncing = 1;
 
 	sg_len = blk_rq_map_sg(mq->queue, mq->req, mq->bounce_sg);
 
@@ -331,7 +355,7 @@ void mmc_queue_bounce_pre(struct mmc_queue *mq)
 {
 	unsigned long flags;
 
-	if (!mq->bounce_buf)
+	if (!mq->bouncing)
 		return;
 
 	if (rq_data_dir(mq->req) != WRITE)
@@ -351,7 +375,7 @@ void mmc_queue_bounce_post(struct mmc_queue *mq)
 {
 	unsigned long flags;
 
-	if (!mq->bounce_buf)
+	if (!mq->bouncing)
 		return;
 
 	if (rq_data_dir(mq->req) != READ)
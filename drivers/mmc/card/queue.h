@@ -17,6 +17,9 @@ struct mmc_queue {
 	char			*bounce_buf;
 	struct scatterlist	*bounce_sg;
 	unsigned int		bounce_sg_len;
+	unsigned int		bounce_sz;
+	unsigned int		bounce_segs;	/* 0: bounce every request */
+	int			bouncing;	/* current request bounced */
 };
 
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *, spinlock_t *);
@@ -142,6 +142,12 @@ mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 	struct scatterlist *sg;
 #endif
 
+	if (mrq->sbc) {
+		pr_debug("%s: starting CMD%u arg %08x flags %08x\n",
+			 mmc_hostname(host), mrq->sbc->opcode,
+			 mrq->sbc->arg, mrq->sbc->flags);
+	}
+
 	pr_debug("%s: starting CMD%u arg %08x flags %08x\n",
 		 mmc_hostname(host), mrq->cmd->opcode,
 		 mrq->cmd->arg, mrq->cmd->flags);
@@ -167,6 +173,10 @@ mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 
 	mrq->cmd->error = 0;
 	mrq->cmd->mrq = mrq;
+	if (mrq->sbc) {
+		mrq->sbc->error = 0;
+		mrq->sbc->mrq = mrq;
+	}
 	if (mrq->data) {
 		BUG_ON(mrq->data->blksz > host->max_blk_size);
 		BUG_ON(mrq->data->blocks > host->max_blk_count);
@@ -220,6 +230,37 @@ void mmc_wait_for_req(struct mmc_host *host, struct mmc_request *mrq)
 
 EXPORT_SYMBOL(mmc_wait_for_req);
 
+/**
+ *	mmc_pre_req - prepare a request's data before starting it
+ *	@host: MMC host to prepare the request for
+ *	@mrq: MMC request to prepare
+ *
+ *	Let the host map and program the data of @mrq ahead of
+ *	mmc_wait_for_req().  Every prepared request must be passed
+ *	to mmc_post_req() once it has completed, or been abandoned.
+ */
+void mmc_pre_req(struct mmc_host *host, struct mmc_request *mrq)
+{
+	if (host->ops->pre_req && mrq->data)
+		host->ops->pre_req(host, mrq);
+}
+
+EXPORT_SYMBOL(mmc_pre_req);
+
+/**
+ *	mmc_post_req - release what mmc_pre_req() set up
+ *	@host: MMC host the request was prepared for
+ *	@mrq: MMC request that was prepared
+ *	@err: zero, or the error the request completed with
+ */
+void mmc_post_req(struct mmc_host *host, struct mmc_request *mrq, int err)
+{
+	if (host->ops->post_req && mrq->data)
+		host->ops->post_req(host, mrq, err);
+}
+
+EXPORT_SYMBOL(mmc_post_req);
+
 /**
  *	mmc_wait_for_cmd - start a command and wait for completion
  *	@host: MMC host to start command
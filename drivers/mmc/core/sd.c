@@ -177,6 +177,9 @@ static int mmc_decode_scr(struct mmc_card *card)
 
 	scr->sda_vsn = UNSTUFF_BITS(resp, 56, 4);
 	scr->bus_widths = UNSTUFF_BITS(resp, 48, 4);
+	if (scr->sda_vsn == SCR_SPEC_VER_2)
+		/* CMD_SUPPORT, only defined from SD 3.00 on; zero before */
+		scr->cmds = UNSTUFF_BITS(resp, 32, 2);
 
 	return 0;
 }
@@ -32,6 +32,12 @@
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
 #include <linux/mmc/mmc.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+
+#include <asm/sizes.h>
 
 #include <mach/mmc.h>
 #include <mach/edma.h>
@@ -103,6 +109,17 @@
 
 /* DAVINCI_MMCST1 definitions */
 #define MMCST1_BUSY           (1 << 0)
+#define MMCST1_FIFOEMP        (1 << 5)
+#define MMCST1_FIFOFUL        (1 << 6)
+
+/* DAVINCI_SDIOST0 definitions */
+#define SDIOST0_DAT1_HI       (1 << 0)
+
+/* DAVINCI_SDIOEN definitions */
+#define SDIOEN_IOINTEN        (1 << 0)
+
+/* DAVINCI_SDIOST definitions */
+#define SDIOST_IOINT          (1 << 0)
 
 /* DAVINCI_MMCCMD definitions */
 #define MMCCMD_CMD_MASK       (0x3F << 0)
@@ -135,26 +152,56 @@
 #define MMCSD_INIT_CLOCK		200000
 
 /*
- * One scatterlist dma "segment" is at most MAX_CCNT rw_threshold units,
- * and we handle up to NR_SG segments.  MMC_BLOCK_BOUNCE kicks in only
- * for drivers with max_hw_segs == 1, making the segments bigger (64KB)
- * than the page or two that's otherwise typical.  NR_SG == 16 gives at
- * least the same throughput boost, using EDMA transfer linkage instead
- * of spending CPU time copying pages.
+ * Scatterlists are handed to edma_prep_sg_chain(), which splits long
+ * segments and links one parameter RAM slot per piece.  NR_SG bounds
+ * how many slots one request may take from the shared pool; longer
+ * lists stream through a ring of that many slots, refilled from the
+ * DMA callback, so MAX_SEGS is limited only by what the block layer
+ * will merge.  When the pool runs dry the request falls back to PIO.
  */
-#define MAX_CCNT	((1 << 16) - 1)
-
-#define NR_SG		16
+#define NR_SG		32
+#define MAX_SEGS	256
 
 static unsigned rw_threshold = 32;
 module_param(rw_threshold, uint, S_IRUGO);
 MODULE_PARM_DESC(rw_threshold,
 		"Read/Write threshold. Default = 32");
 
+/*
+ * Requests with more segments than this are copied through one
+ * contiguous buffer by the block driver (CONFIG_MMC_BLOCK_BOUNCE), so
+ * the card gets one DMA segment instead of many small ones, e.g. 4 KiB
+ * page cache pages.  0 keeps scatter-gather for every request.
+ */
+static unsigned bounce_segs;
+module_param(bounce_segs, uint, S_IRUGO);
+MODULE_PARM_DESC(bounce_segs,
+		"Bounce requests with more segments than this. Default = 0 (off)");
+
 static unsigned __initdata use_dma = 1;
 module_param(use_dma, uint, 0);
 MODULE_PARM_DESC(use_dma, "Whether to use DMA or not. Default = 1");
 
+/*
+ * Below this many bytes a transfer is cheaper done by PIO than by
+ * setting up EDMA; short SDIO CMD53s are the typical case.  Tunable
+ * per host as dma_threshold in sysfs.
+ */
+#define DMA_THRESHOLD	128
+
+#ifdef CONFIG_DEBUG_FS
+/* latency histogram: transfer size buckets by power-of-two time bins */
+#define LAT_SIZES	5	/* <= 64, 512, 4K, 64K bytes and larger */
+#define LAT_BINS	12	/* < 16us, then doubling up to >= 16ms */
+#endif
+
+/* data mapped and staged by pre_req, waiting for its request */
+struct mmc_davinci_next {
+	struct edma_sg_chain	chain;
+	unsigned int		sg_len;
+	s32			cookie;
+};
+
 struct mmc_davinci_host {
 	struct mmc_command *cmd;
 	struct mmc_data *data;
@@ -164,6 +211,9 @@ struct mmc_davinci_host {
 	void __iomem *base;
 	struct resource *mem_res;
 	int irq;
+	int sdio_irq;
+	bool sdio_int;		/* SDIO card interrupt enabled */
+	bool cmd_busy;		/* R1b: command ends at BSYDNE */
 	unsigned char bus_mode;
 
 #define DAVINCI_MMC_DATADIR_NONE	0
@@ -184,15 +234,13 @@ struct mmc_davinci_host {
 	bool use_dma;
 	bool do_dma;
 
-	/* Scatterlist DMA uses one or more parameter RAM entries:
-	 * the main one (associated with rxdma or txdma) plus zero or
-	 * more links.  The entries for a given transfer differ only
-	 * by memory buffer (address, length) and link field.
+	/* Scatterlist DMA uses the main parameter RAM entry (associated
+	 * with rxdma or txdma) plus the links of the current chain.
 	 */
-	struct edmacc_param	tx_template;
-	struct edmacc_param	rx_template;
-	unsigned		n_link;
-	u32			links[NR_SG - 1];
+	struct edma_sg_chain	chain;
+	struct mmc_davinci_next	next_data;
+	s32			cookie;
+	unsigned int		dma_threshold;
 
 	/* For PIO we walk scatterlists one segment at a time. */
 	unsigned int		sg_len;
@@ -200,11 +248,17 @@ struct mmc_davinci_host {
 
 	/* Version of the MMC/SD controller */
 	u8 version;
-	/* for ns in one cycle calculation */
+	/* card clock actually set, and its period for the data timeouts */
+	unsigned int card_clk;
 	unsigned ns_in_one_cycle;
 #ifdef CONFIG_CPU_FREQ
 	struct notifier_block	freq_transition;
 #endif
+#ifdef CONFIG_DEBUG_FS
+	ktime_t			req_start;
+	bool			req_dma;
+	u32			lat_hist[2][LAT_SIZES][LAT_BINS];
+#endif
 };
 
 
@@ -224,7 +278,7 @@ static void davinci_fifo_data_trans(struct mmc_davinci_host *host,
 	unsigned int i;
 
 	if (host->buffer_bytes_left == 0) {
-		host->sg = sg_next(host->data->sg);
+		host->sg = sg_next(host->sg);
 		mmc_davinci_sg_to_buf(host);
 	}
 
@@ -260,6 +314,137 @@ static void davinci_fifo_data_trans(struct mmc_davinci_host *host,
 	host->buffer = p;
 }
 
+/*
+ * After the rw_threshold chunk a FIFO event asked for, keep moving
+ * words for as long as MMCST1 shows the FIFO still has room (writes)
+ * or data (reads), instead of waiting for another interrupt.
+ */
+static void davinci_fifo_data_batch(struct mmc_davinci_host *host)
+{
+	u32 stop = (host->data_dir == DAVINCI_MMC_DATADIR_WRITE)
+			? MMCST1_FIFOFUL : MMCST1_FIFOEMP;
+
+	while (host->bytes_left >= 4 &&
+			!(readl(host->base + DAVINCI_MMCST1) & stop))
+		davinci_fifo_data_trans(host, 4);
+}
+
+#ifdef CONFIG_DEBUG_FS
+
+static unsigned mmc_davinci_size_bucket(unsigned bytes)
+{
+	if (bytes <= 64)
+		return 0;
+	if (bytes <= 512)
+		return 1;
+	if (bytes <= SZ_4K)
+		return 2;
+	if (bytes <= SZ_64K)
+		return 3;
+	return 4;
+}
+
+static void mmc_davinci_account(struct mmc_davinci_host *host,
+		struct mmc_request *req)
+{
+	struct mmc_data *data = req->data;
+	s64 us;
+	unsigned bin;
+
+	if (!data)
+		return;
+
+	us = ktime_us_delta(ktime_get(), host->req_start);
+	bin = (us < 16) ? 0 : min_t(unsigned, fls(us) - 4, LAT_BINS - 1);
+	host->lat_hist[host->req_dma]
+		[mmc_davinci_size_bucket(data->blocks * data->blksz)][bin]++;
+}
+
+static int mmc_davinci_latency_show(struct seq_file *s, void *unused)
+{
+	static const char *sizes[LAT_SIZES] = {
+		"<=64", "<=512", "<=4K", "<=64K", ">64K",
+	};
+	struct mmc_davinci_host *host = s->private;
+	unsigned mode, size, bin;
+
+	seq_printf(s, "%-4s %-6s", "mode", "bytes");
+	for (bin = 0; bin < LAT_BINS - 1; bin++) {
+		unsigned us = 16 << bin;
+
+		if (us < 1024)
+			seq_printf(s, "  <%4uus", us);
+		else
+			seq_printf(s, "  <%4ums", us >> 10);
+	}
+	seq_printf(s, " %8s\n", "more");
+
+	for (mode = 0; mode < 2; mode++) {
+		for (size = 0; size < LAT_SIZES; size++) {
+			seq_printf(s, "%-4s %-6s", mode ? "dma" : "pio",
+					sizes[size]);
+			for (bin = 0; bin < LAT_BINS; bin++)
+				seq_printf(s, " %8u",
+					host->lat_hist[mode][size][bin]);
+			seq_printf(s, "\n");
+		}
+	}
+	return 0;
+}
+
+static int mmc_davinci_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_davinci_latency_show, inode->i_private);
+}
+
+/* any write clears the histogram */
+static ssize_t mmc_davinci_latency_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct mmc_davinci_host *host = s->private;
+
+	memset(host->lat_hist, 0, sizeof(host->lat_hist));
+	return count;
+}
+
+static const struct file_operations mmc_davinci_latency_fops = {
+	.open		= mmc_davinci_latency_open,
+	.read		= seq_read,
+	.write		= mmc_davinci_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void mmc_davinci_debugfs_init(struct mmc_davinci_host *host)
+{
+	/* removed along with the host's directory by mmc_remove_host() */
+	if (host->mmc->debugfs_root)
+		debugfs_create_file("latency", S_IRUGO | S_IWUSR,
+				host->mmc->debugfs_root, host,
+				&mmc_davinci_latency_fops);
+}
+
+#else
+
+static inline void mmc_davinci_account(struct mmc_davinci_host *host,
+		struct mmc_request *req)
+{
+}
+
+static inline void mmc_davinci_debugfs_init(struct mmc_davinci_host *host)
+{
+}
+
+#endif
+
+static void mmc_davinci_request_done(struct mmc_davinci_host *host,
+		struct mmc_request *req)
+{
+	mmc_davinci_account(host, req);
+	mmc_request_done(host->mmc, req);
+}
+
 static void mmc_davinci_start_command(struct mmc_davinci_host *host,
 		struct mmc_command *cmd)
 {
@@ -287,6 +472,7 @@ static void mmc_davinci_start_command(struct mmc_davinci_host *host,
 			break;
 		}; s; }));
 	host->cmd = cmd;
+	host->cmd_busy = false;
 
 	switch (mmc_resp_type(cmd)) {
 	case MMC_RSP_R1B:
@@ -295,6 +481,7 @@ static void mmc_davinci_start_command(struct mmc_davinci_host *host,
 		 * then it's harmless for us to allow it.
 		 */
 		cmd_reg |= MMCCMD_BSYEXP;
+		host->cmd_busy = true;
 		/* FALLTHROUGH */
 	case MMC_RSP_R1:		/* 48 bits, CRC */
 		cmd_reg |= MMCCMD_RSPFMT_R1456;
@@ -343,6 +530,8 @@ static void mmc_davinci_start_command(struct mmc_davinci_host *host,
 
 	/* Enable interrupt (calculate here, defer until FIFO is stuffed). */
 	im_val =  MMCST0_RSPDNE | MMCST0_CRCRS | MMCST0_TOUTRS;
+	if (host->cmd_busy)
+		im_val |= MMCST0_BSYDNE;
 	if (host->data_dir == DAVINCI_MMC_DATADIR_WRITE) {
 		im_val |= MMCST0_DATDNE | MMCST0_CRCWR;
 
@@ -389,9 +578,12 @@ mmc_davinci_xfer_done(struct mmc_davinci_host *host, struct mmc_data *data);
 
 static void mmc_davinci_dma_cb(unsigned channel, u16 ch_status, void *data)
 {
-	if (DMA_COMPLETE != ch_status) {
-		struct mmc_davinci_host *host = data;
+	struct mmc_davinci_host *host = data;
 
+	/* only long chains ask for completions, to refill their ring */
+	if (DMA_COMPLETE == ch_status)
+		edma_sg_chain_refill(&host->chain);
+	else {
 		/* Currently means:  DMA Event Missed, or "null" transfer
 		 * request was seen.  In the future, TC errors (like bad
 		 * addresses) might be presented too.
@@ -404,149 +596,115 @@ static void mmc_davinci_dma_cb(unsigned channel, u16 ch_status, void *data)
 	}
 }
 
-/* Set up tx or rx template, to be modified and updated later */
-static void __init mmc_davinci_dma_setup(struct mmc_davinci_host *host,
-		bool tx, struct edmacc_param *template)
+static inline enum dma_data_direction
+mmc_davinci_dma_dir(struct mmc_data *data)
+{
+	return (data->flags & MMC_DATA_WRITE) ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+}
+
+static int mmc_davinci_prep_chain(struct mmc_davinci_host *host,
+		struct mmc_data *data, struct edma_sg_chain *chain,
+		unsigned sg_len, bool staged)
 {
-	unsigned	sync_dev;
-	const u16	acnt = 4;
-	const u16	bcnt = rw_threshold >> 2;
-	const u16	ccnt = 0;
-	u32		src_port = 0;
-	u32		dst_port = 0;
-	s16		src_bidx, dst_bidx;
-	s16		src_cidx, dst_cidx;
+	int			channel;
+	dma_addr_t		fifo;
+	enum dma_data_direction	direction = mmc_davinci_dma_dir(data);
 
 	/*
 	 * A-B Sync transfer:  each DMA request is for one "frame" of
-	 * rw_threshold bytes, broken into "acnt"-size chunks repeated
-	 * "bcnt" times.  Each segment needs "ccnt" such frames; since
-	 * we tell the block layer our mmc->max_seg_size limit, we can
-	 * trust (later) that it's within bounds.
+	 * rw_threshold bytes, read/written in 4-byte chunks; EDMA will
+	 * optimize memory operations to use larger bursts.
 	 *
-	 * The FIFOs are read/written in 4-byte chunks (acnt == 4) and
-	 * EDMA will optimize memory operations to use larger bursts.
+	 * We can't use FIFO mode for the FIFOs because MMC FIFO addresses
+	 * are not 256-bit (32-byte) aligned, so the FIFO end just uses
+	 * INCR with zero indexes.
 	 */
-	if (tx) {
-		sync_dev = host->txdma;
-
-		/* src_prt, ccnt, and link to be set up later */
-		src_bidx = acnt;
-		src_cidx = acnt * bcnt;
-
-		dst_port = host->mem_res->start + DAVINCI_MMCDXR;
-		dst_bidx = 0;
-		dst_cidx = 0;
+	if (direction == DMA_TO_DEVICE) {
+		channel = host->txdma;
+		fifo = host->mem_res->start + DAVINCI_MMCDXR;
 	} else {
-		sync_dev = host->rxdma;
-
-		src_port = host->mem_res->start + DAVINCI_MMCDRR;
-		src_bidx = 0;
-		src_cidx = 0;
-
-		/* dst_prt, ccnt, and link to be set up later */
-		dst_bidx = acnt;
-		dst_cidx = acnt * bcnt;
+		channel = host->rxdma;
+		fifo = host->mem_res->start + DAVINCI_MMCDRR;
 	}
 
-	/*
-	 * We can't use FIFO mode for the FIFOs because MMC FIFO addresses
-	 * are not 256-bit (32-byte) aligned.  So we use INCR, and the W8BIT
-	 * parameter is ignored.
-	 */
-	edma_set_src(sync_dev, src_port, INCR, W8BIT);
-	edma_set_dest(sync_dev, dst_port, INCR, W8BIT);
-
-	edma_set_src_index(sync_dev, src_bidx, src_cidx);
-	edma_set_dest_index(sync_dev, dst_bidx, dst_cidx);
-
-	edma_set_transfer_params(sync_dev, acnt, bcnt, ccnt, 8, ABSYNC);
-
-	edma_read_slot(sync_dev, template);
-
-	/* don't bother with irqs or chaining */
-	template->opt |= EDMA_CHAN_SLOT(sync_dev) << 12;
+	/* don't bother with irqs; the controller reports completion */
+	if (staged)
+		return edma_stage_sg_chain(chain, channel, data->sg, sg_len,
+				fifo, 4, rw_threshold >> 2, direction, false);
+	return edma_prep_sg_chain(chain, channel, data->sg, sg_len,
+			fifo, 4, rw_threshold >> 2, direction, false);
 }
 
-static void mmc_davinci_send_dma_request(struct mmc_davinci_host *host,
+static int mmc_davinci_send_dma_request(struct mmc_davinci_host *host,
 		struct mmc_data *data)
 {
-	struct edmacc_param	*template;
-	int			channel, slot;
-	unsigned		link;
-	struct scatterlist	*sg;
-	unsigned		sg_len;
-	unsigned		bytes_left = host->bytes_left;
-	const unsigned		shift = ffs(rw_threshold) - 1;;
+	int channel;
 
-	if (host->data_dir == DAVINCI_MMC_DATADIR_WRITE) {
-		template = &host->tx_template;
-		channel = host->txdma;
-	} else {
-		template = &host->rx_template;
-		channel = host->rxdma;
-	}
-
-	/* We know sg_len and ccnt will never be out of range because
-	 * we told the mmc layer which in turn tells the block layer
-	 * to ensure that it only hands us one scatterlist segment
-	 * per EDMA PARAM entry.  Update the PARAM
-	 * entries needed for each segment of this scatterlist.
-	 */
-	for (slot = channel, link = 0, sg = data->sg, sg_len = host->sg_len;
-			sg_len-- != 0 && bytes_left;
-			sg = sg_next(sg), slot = host->links[link++]) {
-		u32		buf = sg_dma_address(sg);
-		unsigned	count = sg_dma_len(sg);
-
-		template->link_bcntrld = sg_len
-				? (EDMA_CHAN_SLOT(host->links[link]) << 5)
-				: 0xffff;
-
-		if (count > bytes_left)
-			count = bytes_left;
-		bytes_left -= count;
-
-		if (host->data_dir == DAVINCI_MMC_DATADIR_WRITE)
-			template->src = buf;
-		else
-			template->dst = buf;
-		template->ccnt = count >> shift;
-
-		edma_write_slot(slot, template);
-	}
+	if (data->host_cookie)
+		channel = edma_load_sg_chain(&host->chain);
+	else
+		channel = mmc_davinci_prep_chain(host, data, &host->chain,
+				host->sg_len, false);
+	if (channel < 0)
+		return channel;
 
 	if (host->version == MMC_CTLR_VERSION_2)
 		edma_clear_event(channel);
 
 	edma_start(channel);
+	return 0;
 }
 
-static int mmc_davinci_start_dma_transfer(struct mmc_davinci_host *host,
+static int mmc_davinci_map_data(struct mmc_davinci_host *host,
 		struct mmc_data *data)
 {
-	int i;
+	int i, sg_len;
 	int mask = rw_threshold - 1;
 
-	host->sg_len = dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
-				((data->flags & MMC_DATA_WRITE)
-				? DMA_TO_DEVICE
-				: DMA_FROM_DEVICE));
+	sg_len = dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			mmc_davinci_dma_dir(data));
 
 	/* no individual DMA segment should need a partial FIFO */
-	for (i = 0; i < host->sg_len; i++) {
+	for (i = 0; i < sg_len; i++) {
 		if (sg_dma_len(data->sg + i) & mask) {
-			dma_unmap_sg(mmc_dev(host->mmc),
-					data->sg, data->sg_len,
-					(data->flags & MMC_DATA_WRITE)
-					? DMA_TO_DEVICE
-					: DMA_FROM_DEVICE);
-			return -1;
+			dma_unmap_sg(mmc_dev(host->mmc), data->sg,
+					data->sg_len, mmc_davinci_dma_dir(data));
+			return -EINVAL;
 		}
 	}
 
+	return sg_len;
+}
+
+static int mmc_davinci_start_dma_transfer(struct mmc_davinci_host *host,
+		struct mmc_data *data)
+{
+	int sg_len;
+
+	if (data->host_cookie) {
+		/* pre_req already mapped the data and staged its chain */
+		host->chain = host->next_data.chain;
+		host->sg_len = host->next_data.sg_len;
+		host->next_data.chain.slot = -1;
+		host->next_data.chain.nr_slots = 0;
+		host->next_data.cookie = 0;
+	} else {
+		sg_len = mmc_davinci_map_data(host, data);
+		if (sg_len < 0)
+			return -1;
+		host->sg_len = sg_len;
+	}
+
+	if (mmc_davinci_send_dma_request(host, data) < 0) {
+		/* the PIO fallback must not leave post_req anything to do */
+		if (data->host_cookie)
+			edma_free_sg_chain(&host->chain);
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+				mmc_davinci_dma_dir(data));
+		data->host_cookie = 0;
+		return -1;
+	}
 	host->do_dma = 1;
-	mmc_davinci_send_dma_request(host, data);
 
 	return 0;
 }
@@ -554,21 +712,16 @@ static int mmc_davinci_start_dma_transfer(struct mmc_davinci_host *host,
 static void __init_or_module
 davinci_release_dma_channels(struct mmc_davinci_host *host)
 {
-	unsigned	i;
-
 	if (!host->use_dma)
 		return;
 
-	for (i = 0; i < host->n_link; i++)
-		edma_free_slot(host->links[i]);
-
 	edma_free_channel(host->txdma);
 	edma_free_channel(host->rxdma);
 }
 
 static int __init davinci_acquire_dma_channels(struct mmc_davinci_host *host)
 {
-	int r, i;
+	int r;
 
 	/* Acquire master DMA write channel */
 	r = edma_alloc_channel(host->txdma, mmc_davinci_dma_cb, host,
@@ -578,7 +731,6 @@ static int __init davinci_acquire_dma_channels(struct mmc_davinci_host *host)
 				"tx", r);
 		return r;
 	}
-	mmc_davinci_dma_setup(host, true, &host->tx_template);
 
 	/* Acquire master DMA read channel */
 	r = edma_alloc_channel(host->rxdma, mmc_davinci_dma_cb, host,
@@ -588,21 +740,14 @@ static int __init davinci_acquire_dma_channels(struct mmc_davinci_host *host)
 				"rx", r);
 		goto free_master_write;
 	}
-	mmc_davinci_dma_setup(host, false, &host->rx_template);
+	host->chain.slot = -1;
+	host->chain.window = NR_SG;
+	host->next_data.chain.slot = -1;
+	host->next_data.chain.window = NR_SG;
 
-	/* Allocate parameter RAM slots, which will later be bound to a
-	 * channel as needed to handle a scatterlist.
-	 */
-	for (i = 0; i < ARRAY_SIZE(host->links); i++) {
-		r = edma_alloc_slot(EDMA_CTLR(host->txdma), EDMA_SLOT_ANY);
-		if (r < 0) {
-			dev_dbg(mmc_dev(host->mmc), "dma PaRAM alloc --> %d\n",
-				r);
-			break;
-		}
-		host->links[i] = r;
-	}
-	host->n_link = i;
+	/* ring refills must keep ahead of the transfer */
+	edma_set_callback_flags(host->txdma, EDMA_CB_PRIORITY);
+	edma_set_callback_flags(host->rxdma, EDMA_CB_PRIORITY);
 
 	return 0;
 
@@ -678,6 +823,7 @@ mmc_davinci_prepare_data(struct mmc_davinci_host *host, struct mmc_request *req)
 	 * used.  The occasional fallback to PIO should't hurt.
 	 */
 	if (host->use_dma && (host->bytes_left & (rw_threshold - 1)) == 0
+			&& host->bytes_left >= host->dma_threshold
 			&& mmc_davinci_start_dma_transfer(host, data) == 0) {
 		/* zero this to ensure we take no PIO paths */
 		host->bytes_left = 0;
@@ -689,6 +835,16 @@ mmc_davinci_prepare_data(struct mmc_davinci_host *host, struct mmc_request *req)
 	}
 }
 
+static void mmc_davinci_start_data_cmd(struct mmc_davinci_host *host,
+		struct mmc_request *req)
+{
+	mmc_davinci_prepare_data(host, req);
+#ifdef CONFIG_DEBUG_FS
+	host->req_dma = host->do_dma;
+#endif
+	mmc_davinci_start_command(host, req->cmd);
+}
+
 static void mmc_davinci_request(struct mmc_host *mmc, struct mmc_request *req)
 {
 	struct mmc_davinci_host *host = mmc_priv(mmc);
@@ -711,95 +867,154 @@ static void mmc_davinci_request(struct mmc_host *mmc, struct mmc_request *req)
 		return;
 	}
 
+#ifdef CONFIG_DEBUG_FS
+	host->req_start = ktime_get();
+#endif
 	host->do_dma = 0;
-	mmc_davinci_prepare_data(host, req);
-	mmc_davinci_start_command(host, req->cmd);
+
+	/* SET_BLOCK_COUNT goes out on its own; the data command follows
+	 * from mmc_davinci_cmd_done().
+	 */
+	if (req->sbc) {
+		host->data = NULL;
+		host->data_dir = DAVINCI_MMC_DATADIR_NONE;
+		mmc_davinci_start_command(host, req->sbc);
+		return;
+	}
+
+	mmc_davinci_start_data_cmd(host, req);
 }
 
-static unsigned int calculate_freq_for_card(struct mmc_davinci_host *host,
-	unsigned int mmc_req_freq)
+/*
+ * Map the data and program its EDMA chain into spare PaRAM slots while
+ * an earlier request may still own the channels; mmc_davinci_request()
+ * then only has to load one set and go.  Anything unusual is left to
+ * the request path, which prepares data itself.
+ */
+static void mmc_davinci_pre_req(struct mmc_host *mmc, struct mmc_request *req)
 {
-	unsigned int mmc_freq = 0, mmc_pclk = 0, mmc_push_pull_divisor = 0;
+	struct mmc_davinci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = req->data;
+	int sg_len;
 
-	mmc_pclk = host->mmc_input_clk;
-	if (mmc_req_freq && mmc_pclk > (2 * mmc_req_freq))
-		mmc_push_pull_divisor = ((unsigned int)mmc_pclk
-				/ (2 * mmc_req_freq)) - 1;
-	else
-		mmc_push_pull_divisor = 0;
+	data->host_cookie = 0;
 
-	mmc_freq = (unsigned int)mmc_pclk
-		/ (2 * (mmc_push_pull_divisor + 1));
+	/* one request is staged at a time */
+	if (!host->use_dma || host->next_data.cookie)
+		return;
+	if ((data->blocks * data->blksz) & (rw_threshold - 1) ||
+			data->blocks * data->blksz < host->dma_threshold)
+		return;
 
-	if (mmc_freq > mmc_req_freq)
-		mmc_push_pull_divisor = mmc_push_pull_divisor + 1;
-	/* Convert ns to clock cycles */
-	if (mmc_req_freq <= 400000)
-		host->ns_in_one_cycle = (1000000) / (((mmc_pclk
-				/ (2 * (mmc_push_pull_divisor + 1)))/1000));
-	else
-		host->ns_in_one_cycle = (1000000) / (((mmc_pclk
-				/ (2 * (mmc_push_pull_divisor + 1)))/1000000));
+	sg_len = mmc_davinci_map_data(host, data);
+	if (sg_len < 0)
+		return;
 
-	return mmc_push_pull_divisor;
+	if (mmc_davinci_prep_chain(host, data, &host->next_data.chain,
+				sg_len, true) < 0) {
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+				mmc_davinci_dma_dir(data));
+		return;
+	}
+
+	if (++host->cookie <= 0)
+		host->cookie = 1;
+	host->next_data.sg_len = sg_len;
+	host->next_data.cookie = host->cookie;
+	data->host_cookie = host->cookie;
 }
 
-static void calculate_clk_divider(struct mmc_host *mmc, struct mmc_ios *ios)
+static void mmc_davinci_post_req(struct mmc_host *mmc, struct mmc_request *req,
+		int err)
 {
-	unsigned int open_drain_freq = 0, mmc_pclk = 0;
-	unsigned int mmc_push_pull_freq = 0;
 	struct mmc_davinci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = req->data;
 
-	if (ios->bus_mode == MMC_BUSMODE_OPENDRAIN) {
-		u32 temp;
+	if (!data->host_cookie)
+		return;
 
-		/* Ignoring the init clock value passed for fixing the inter
-		 * operability with different cards.
-		 */
-		open_drain_freq = ((unsigned int)mmc_pclk
-				/ (2 * MMCSD_INIT_CLOCK)) - 1;
+	/* staged, but the request failed before starting its DMA */
+	if (host->next_data.cookie == data->host_cookie) {
+		edma_free_sg_chain(&host->next_data.chain);
+		host->next_data.cookie = 0;
+	}
 
-		if (open_drain_freq > 0xFF)
-			open_drain_freq = 0xFF;
+	dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			mmc_davinci_dma_dir(data));
+	data->host_cookie = 0;
+}
 
-		temp = readl(host->base + DAVINCI_MMCCLK) & ~MMCCLK_CLKRT_MASK;
-		temp |= open_drain_freq;
-		writel(temp, host->base + DAVINCI_MMCCLK);
+/*
+ * The card clock is mmc_input_clk / (2 * (CLKRT + 1)).  Pick the fastest
+ * one not above what the card may take, and note its period for the data
+ * timeouts.
+ */
+static unsigned int calculate_freq_for_card(struct mmc_davinci_host *host,
+	unsigned int mmc_req_freq)
+{
+	unsigned int mmc_pclk = host->mmc_input_clk;
+	unsigned int div, freq;
 
-		/* Convert ns to clock cycles */
-		host->ns_in_one_cycle = (1000000) / (MMCSD_INIT_CLOCK/1000);
-	} else {
-		u32 temp;
-		mmc_push_pull_freq = calculate_freq_for_card(host, ios->clock);
+	if (mmc_req_freq)
+		div = DIV_ROUND_UP(mmc_pclk, 2 * mmc_req_freq) - 1;
+	else
+		div = MMCCLK_CLKRT_MASK;
+	if (div > MMCCLK_CLKRT_MASK)
+		div = MMCCLK_CLKRT_MASK;
 
-		if (mmc_push_pull_freq > 0xFF)
-			mmc_push_pull_freq = 0xFF;
+	freq = mmc_pclk / (2 * (div + 1));
+	host->card_clk = freq;
+	host->ns_in_one_cycle = DIV_ROUND_UP(NSEC_PER_SEC, freq ? : 1);
 
-		temp = readl(host->base + DAVINCI_MMCCLK) & ~MMCCLK_CLKEN;
-		writel(temp, host->base + DAVINCI_MMCCLK);
+	return div;
+}
 
-		udelay(10);
+static void set_clk_divider(struct mmc_davinci_host *host, unsigned int div)
+{
+	u32 temp;
 
-		temp = readl(host->base + DAVINCI_MMCCLK) & ~MMCCLK_CLKRT_MASK;
-		temp |= mmc_push_pull_freq;
-		writel(temp, host->base + DAVINCI_MMCCLK);
+	temp = readl(host->base + DAVINCI_MMCCLK);
+	if ((temp & MMCCLK_CLKRT_MASK) == div)
+		return;
 
-		writel(temp | MMCCLK_CLKEN, host->base + DAVINCI_MMCCLK);
+	/* the divider may only change with the card clock stopped */
+	temp &= ~MMCCLK_CLKEN;
+	writel(temp, host->base + DAVINCI_MMCCLK);
 
-		udelay(10);
-	}
+	udelay(10);
+
+	temp = (temp & ~MMCCLK_CLKRT_MASK) | div;
+	writel(temp, host->base + DAVINCI_MMCCLK);
+
+	writel(temp | MMCCLK_CLKEN, host->base + DAVINCI_MMCCLK);
+
+	udelay(10);
+}
+
+static void calculate_clk_divider(struct mmc_host *mmc, struct mmc_ios *ios)
+{
+	struct mmc_davinci_host *host = mmc_priv(mmc);
+	unsigned int div;
+
+	/* Ignoring the init clock value passed for fixing the inter
+	 * operability with different cards.
+	 */
+	if (ios->bus_mode == MMC_BUSMODE_OPENDRAIN)
+		div = calculate_freq_for_card(host, MMCSD_INIT_CLOCK);
+	else
+		div = calculate_freq_for_card(host, ios->clock);
+
+	set_clk_divider(host, div);
 }
 
 static void mmc_davinci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 {
-	unsigned int mmc_pclk = 0;
 	struct mmc_davinci_host *host = mmc_priv(mmc);
 
-	mmc_pclk = host->mmc_input_clk;
 	dev_dbg(mmc_dev(host->mmc),
-		"clock %dHz busmode %d powermode %d Vdd %04x\n",
+		"clock %dHz busmode %d powermode %d Vdd %04x timing %d\n",
 		ios->clock, ios->bus_mode, ios->power_mode,
-		ios->vdd);
+		ios->vdd, ios->timing);
 	if (ios->bus_width == MMC_BUS_WIDTH_4) {
 		dev_dbg(mmc_dev(host->mmc), "Enabling 4 bit mode\n");
 		writel(readl(host->base + DAVINCI_MMCCTL) | MMCCTL_WIDTH_4_BIT,
@@ -810,7 +1025,12 @@ static void mmc_davinci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 			host->base + DAVINCI_MMCCTL);
 	}
 
+	/* High speed timing needs nothing beyond the faster clock here: the
+	 * controller launches on the falling edge and samples on the rising
+	 * one in both timings, which is what high speed cards expect.
+	 */
 	calculate_clk_divider(mmc, ios);
+	dev_dbg(mmc_dev(host->mmc), "card clock %uHz\n", host->card_clk);
 
 	host->bus_mode = ios->bus_mode;
 	if (ios->power_mode == MMC_POWER_UP) {
@@ -836,6 +1056,21 @@ static void mmc_davinci_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 	/* FIXME on power OFF, reset things ... */
 }
 
+/*
+ * In 4-bit mode DAT1 doubles as a data line, so a card interrupt can
+ * only be signalled, and seen, in the gaps between data blocks.  One
+ * raised while a transfer owned the bus may never have latched IOINT;
+ * catch it by sampling DAT1 once the data phase is over.
+ */
+static void mmc_davinci_sdio_check(struct mmc_davinci_host *host)
+{
+	if (host->sdio_int &&
+	    !(readl(host->base + DAVINCI_SDIOST0) & SDIOST0_DAT1_HI)) {
+		writel(SDIOST_IOINT, host->base + DAVINCI_SDIOST);
+		mmc_signal_sdio_irq(host->mmc);
+	}
+}
+
 static void
 mmc_davinci_xfer_done(struct mmc_davinci_host *host, struct mmc_data *data)
 {
@@ -843,26 +1078,35 @@ mmc_davinci_xfer_done(struct mmc_davinci_host *host, struct mmc_data *data)
 
 	if (host->do_dma) {
 		davinci_abort_dma(host);
-
-		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
-			     (data->flags & MMC_DATA_WRITE)
-			     ? DMA_TO_DEVICE
-			     : DMA_FROM_DEVICE);
+		edma_free_sg_chain(&host->chain);
+
+		/* post_req releases what pre_req mapped, outside this IRQ */
+		if (!data->host_cookie)
+			dma_unmap_sg(mmc_dev(host->mmc), data->sg,
+				     data->sg_len,
+				     (data->flags & MMC_DATA_WRITE)
+				     ? DMA_TO_DEVICE
+				     : DMA_FROM_DEVICE);
 		host->do_dma = false;
 	}
 	host->data_dir = DAVINCI_MMC_DATADIR_NONE;
 
-	if (!data->stop || (host->cmd && host->cmd->error)) {
-		mmc_request_done(host->mmc, data->mrq);
+	/* After CMD23 the card ends the transfer itself, unless it failed */
+	if (!data->stop || (host->cmd && host->cmd->error) ||
+	    (data->mrq->sbc && !data->error)) {
+		mmc_davinci_request_done(host, data->mrq);
 		writel(0, host->base + DAVINCI_MMCIM);
 	} else
 		mmc_davinci_start_command(host, data->stop);
+
+	mmc_davinci_sdio_check(host);
 }
 
 static void mmc_davinci_cmd_done(struct mmc_davinci_host *host,
 				 struct mmc_command *cmd)
 {
 	host->cmd = NULL;
+	host->cmd_busy = false;
 
 	if (cmd->flags & MMC_RSP_PRESENT) {
 		if (cmd->flags & MMC_RSP_136) {
@@ -877,10 +1121,15 @@ static void mmc_davinci_cmd_done(struct mmc_davinci_host *host,
 		}
 	}
 
+	if (cmd == cmd->mrq->sbc && !cmd->error) {
+		mmc_davinci_start_data_cmd(host, cmd->mrq);
+		return;
+	}
+
 	if (host->data == NULL || cmd->error) {
 		if (cmd->error == -ETIMEDOUT)
 			cmd->mrq->cmd->retries = 0;
-		mmc_request_done(host->mmc, cmd->mrq);
+		mmc_davinci_request_done(host, cmd->mrq);
 		writel(0, host->base + DAVINCI_MMCIM);
 	}
 }
@@ -936,6 +1185,7 @@ static irqreturn_t mmc_davinci_irq(int irq, void *dev_id)
 	 */
 	while (host->bytes_left && (status & (MMCST0_DXRDY | MMCST0_DRRDY))) {
 		davinci_fifo_data_trans(host, rw_threshold);
+		davinci_fifo_data_batch(host);
 		status = readl(host->base + DAVINCI_MMCST0);
 		if (!status)
 			break;
@@ -1020,10 +1270,19 @@ static irqreturn_t mmc_davinci_irq(int irq, void *dev_id)
 	}
 
 	if (qstatus & MMCST0_RSPDNE) {
-		/* End of command phase */
-		end_command = (int) host->cmd;
+		/* End of command phase; after an R1b response that is when
+		 * the card releases DAT0, signalled by BSYDNE below.  Its
+		 * status is still up to date, so a card that never went busy
+		 * doesn't leave us waiting.
+		 */
+		if (!host->cmd_busy || end_command ||
+		    !(readl(host->base + DAVINCI_MMCST1) & MMCST1_BUSY))
+			end_command = (int) host->cmd;
 	}
 
+	if ((qstatus & MMCST0_BSYDNE) && host->cmd_busy)
+		end_command = (int) host->cmd;
+
 	if (end_command)
 		mmc_davinci_cmd_done(host, host->cmd);
 	if (end_transfer)
@@ -1031,6 +1290,45 @@ static irqreturn_t mmc_davinci_irq(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
+static irqreturn_t mmc_davinci_sdio_irq(int irq, void *dev_id)
+{
+	struct mmc_davinci_host *host = dev_id;
+	unsigned int status;
+
+	status = readl(host->base + DAVINCI_SDIOST);
+	if (!(status & SDIOST_IOINT))
+		return IRQ_NONE;
+
+	dev_dbg(mmc_dev(host->mmc), "SDIO interrupt status %x\n", status);
+	writel(status | SDIOST_IOINT, host->base + DAVINCI_SDIOST);
+	mmc_signal_sdio_irq(host->mmc);
+	return IRQ_HANDLED;
+}
+
+/*
+ * The core calls this with enable == 0 from mmc_signal_sdio_irq(), in
+ * IRQ context, and re-enables from its SDIO thread once the card's
+ * handlers have run.
+ */
+static void mmc_davinci_enable_sdio_irq(struct mmc_host *mmc, int enable)
+{
+	struct mmc_davinci_host *host = mmc_priv(mmc);
+
+	if (enable) {
+		host->sdio_int = true;
+		/* the card may be holding DAT1 low already: level, not edge */
+		if (!(readl(host->base + DAVINCI_SDIOST0) & SDIOST0_DAT1_HI)) {
+			writel(SDIOST_IOINT, host->base + DAVINCI_SDIOST);
+			mmc_signal_sdio_irq(host->mmc);
+			return;
+		}
+		writel(SDIOEN_IOINTEN, host->base + DAVINCI_SDIOEN);
+	} else {
+		host->sdio_int = false;
+		writel(0, host->base + DAVINCI_SDIOEN);
+	}
+}
+
 static int mmc_davinci_get_cd(struct mmc_host *mmc)
 {
 	struct platform_device *pdev = to_platform_device(mmc->parent);
@@ -1051,11 +1349,38 @@ static int mmc_davinci_get_ro(struct mmc_host *mmc)
 	return config->get_ro(pdev->id);
 }
 
+static ssize_t dma_threshold_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct mmc_davinci_host *host = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", host->dma_threshold);
+}
+
+static ssize_t dma_threshold_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct mmc_davinci_host *host = dev_get_drvdata(dev);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+
+	host->dma_threshold = val;
+	return count;
+}
+
+static DEVICE_ATTR(dma_threshold, S_IRUGO | S_IWUSR,
+		dma_threshold_show, dma_threshold_store);
+
 static struct mmc_host_ops mmc_davinci_ops = {
+	.pre_req	= mmc_davinci_pre_req,
+	.post_req	= mmc_davinci_post_req,
 	.request	= mmc_davinci_request,
 	.set_ios	= mmc_davinci_set_ios,
 	.get_cd		= mmc_davinci_get_cd,
 	.get_ro		= mmc_davinci_get_ro,
+	.enable_sdio_irq = mmc_davinci_enable_sdio_irq,
 };
 
 /*----------------------------------------------------------------------*/
@@ -1064,6 +1389,7 @@ static struct mmc_host_ops mmc_davinci_ops = {
 static int mmc_davinci_cpufreq_transition(struct notifier_block *nb,
 				     unsigned long val, void *data)
 {
+	struct cpufreq_freqs *freqs = data;
 	struct mmc_davinci_host *host;
 	unsigned int mmc_pclk;
 	struct mmc_host *mmc;
@@ -1071,9 +1397,25 @@ static int mmc_davinci_cpufreq_transition(struct notifier_block *nb,
 
 	host = container_of(nb, struct mmc_davinci_host, freq_transition);
 	mmc = host->mmc;
-	mmc_pclk = clk_get_rate(host->clk);
 
-	if (val == CPUFREQ_POSTCHANGE) {
+	/*
+	 * The MMC input clock comes from the PLL the CPU runs on and scales
+	 * with it.  Going up, set the divider for the new rate beforehand,
+	 * so that a high speed card isn't clocked beyond 50 MHz in between;
+	 * at the old rate that only runs it slower for a moment.
+	 */
+	if (val == CPUFREQ_PRECHANGE && freqs->new > freqs->old &&
+	    mmc->ios.clock) {
+		spin_lock_irqsave(&mmc->lock, flags);
+		host->mmc_input_clk = div_u64((u64)host->mmc_input_clk *
+					      freqs->new, freqs->old);
+		calculate_clk_divider(mmc, &mmc->ios);
+		spin_unlock_irqrestore(&mmc->lock, flags);
+		return 0;
+	}
+
+	mmc_pclk = clk_get_rate(host->clk);
+	if (val == CPUFREQ_POSTCHANGE && mmc_pclk != host->mmc_input_clk) {
 		spin_lock_irqsave(&mmc->lock, flags);
 		host->mmc_input_clk = mmc_pclk;
 		calculate_clk_divider(mmc, &mmc->ios);
@@ -1178,6 +1520,7 @@ static int __init davinci_mmcsd_probe(struct platform_device *pdev)
 	init_mmcsd_host(host);
 
 	host->use_dma = use_dma;
+	host->dma_threshold = DMA_THRESHOLD;
 	host->irq = irq;
 
 	if (host->use_dma && davinci_acquire_dma_channels(host) != 0)
@@ -1185,6 +1528,8 @@ static int __init davinci_mmcsd_probe(struct platform_device *pdev)
 
 	/* REVISIT:  someday, support IRQ-driven card detection.  */
 	mmc->caps |= MMC_CAP_NEEDS_POLL;
+	mmc->caps |= MMC_CAP_CMD23;
+	mmc->caps |= MMC_CAP_WAIT_WHILE_BUSY;
 
 	if (!pdata || pdata->wires == 4 || pdata->wires == 0)
 		mmc->caps |= MMC_CAP_4_BIT_DATA;
@@ -1198,23 +1543,31 @@ static int __init davinci_mmcsd_probe(struct platform_device *pdev)
 		mmc->f_max = pdata->max_freq;
 	if (pdata && pdata->caps)
 		mmc->caps |= pdata->caps;
+
+	/* Above 25 MHz cards have to be switched to high speed timing;
+	 * boards rated for it say so with max_freq.
+	 */
+	if (mmc->f_max > 25000000)
+		mmc->caps |= MMC_CAP_SD_HIGHSPEED | MMC_CAP_MMC_HIGHSPEED;
+
 	mmc->ocr_avail = MMC_VDD_32_33 | MMC_VDD_33_34;
 
 	/* With no iommu coalescing pages, each phys_seg is a hw_seg.
-	 * Each hw_seg uses one EDMA parameter RAM slot, always one
-	 * channel and then usually some linked slots.
+	 * Each hw_seg uses at least one EDMA parameter RAM slot, always
+	 * one channel and then usually some linked slots.
 	 */
-	mmc->max_hw_segs	= 1 + host->n_link;
+	mmc->max_hw_segs	= MAX_SEGS;
 	mmc->max_phys_segs	= mmc->max_hw_segs;
-
-	/* EDMA limit per hw segment (one or two MBytes) */
-	mmc->max_seg_size	= MAX_CCNT * rw_threshold;
+	mmc->bounce_segs	= min_t(unsigned, bounce_segs, MAX_SEGS);
 
 	/* MMC/SD controller limits for multiblock requests */
 	mmc->max_blk_size	= 4095;  /* BLEN is 12 bits */
 	mmc->max_blk_count	= 65535; /* NBLK is 16 bits */
 	mmc->max_req_size	= mmc->max_blk_size * mmc->max_blk_count;
 
+	/* long segments are split across linked slots */
+	mmc->max_seg_size	= mmc->max_req_size;
+
 	dev_dbg(mmc_dev(host->mmc), "max_phys_segs=%d\n", mmc->max_phys_segs);
 	dev_dbg(mmc_dev(host->mmc), "max_hw_segs=%d\n", mmc->max_hw_segs);
 	dev_dbg(mmc_dev(host->mmc), "max_blk_size=%d\n", mmc->max_blk_size);
@@ -1223,6 +1576,19 @@ static int __init davinci_mmcsd_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, host);
 
+	/* optional second IRQ: SDIO card interrupts */
+	host->sdio_irq = platform_get_irq(pdev, 1);
+	if (host->sdio_irq > 0) {
+		if (request_irq(host->sdio_irq, mmc_davinci_sdio_irq, 0,
+				dev_name(&pdev->dev), host) == 0)
+			mmc->caps |= MMC_CAP_SDIO_IRQ;
+		else {
+			dev_warn(&pdev->dev, "no SDIO IRQ, cards are polled\n");
+			host->sdio_irq = 0;
+		}
+	} else
+		host->sdio_irq = 0;
+
 	ret = mmc_davinci_cpufreq_register(host);
 	if (ret) {
 		dev_err(&pdev->dev, "failed to register cpufreq\n");
@@ -1239,6 +1605,10 @@ static int __init davinci_mmcsd_probe(struct platform_device *pdev)
 
 	rename_region(mem, mmc_hostname(mmc));
 
+	if (device_create_file(&pdev->dev, &dev_attr_dma_threshold))
+		dev_warn(&pdev->dev, "failed to create dma_threshold\n");
+	mmc_davinci_debugfs_init(host);
+
 	dev_info(mmc_dev(host->mmc), "Using %s, %d-bit mode\n",
 		host->use_dma ? "DMA" : "PIO",
 		(mmc->caps & MMC_CAP_4_BIT_DATA) ? 4 : 1);
@@ -1249,6 +1619,8 @@ out:
 	mmc_davinci_cpufreq_deregister(host);
 cpu_freq_fail:
 	if (host) {
+		if (host->sdio_irq)
+			free_irq(host->sdio_irq, host);
 		davinci_release_dma_channels(host);
 
 		if (host->clk) {
@@ -1275,12 +1647,15 @@ static int __exit davinci_mmcsd_remove(struct platform_device *pdev)
 {
 	struct mmc_davinci_host *host = platform_get_drvdata(pdev);
 
+	device_remove_file(&pdev->dev, &dev_attr_dma_threshold);
 	platform_set_drvdata(pdev, NULL);
 	if (host) {
 		mmc_davinci_cpufreq_deregister(host);
 
 		mmc_remove_host(host->mmc);
 		free_irq(host->irq, host);
+		if (host->sdio_irq)
+			free_irq(host->sdio_irq, host);
 
 		davinci_release_dma_channels(host);
 
@@ -18,14 +18,20 @@
 #include <linux/init.h>
 #include <linux/clk.h>
 #include <linux/err.h>
+#include <linux/io.h>
+#include <linux/jiffies.h>
+#include <linux/dma-mapping.h>
 #include <linux/cpufreq.h>
 
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/map.h>
 #include <linux/mtd/partitions.h>
 
+#include <asm/cacheflush.h>
+
 #include <mach/flash.h>
 #include <mach/aemif.h>
+#include <mach/edma.h>
 
 struct davinciflash_info {
 	struct mtd_info		*mtd;
@@ -39,8 +45,125 @@ struct davinciflash_info {
 
 	struct clk		*clk;
 	struct davinci_aemif_timing	*timing;
+
+	/* EDMA for bulk reads; channel is negative for CPU copies only */
+	int			dma_channel;
+	int			dma_status;
+	bool			dma_done;
 };
 
+static unsigned dma_threshold = 1024;
+module_param(dma_threshold, uint, 0644);
+MODULE_PARM_DESC(dma_threshold,
+	"Smallest read copied with EDMA, 0 for never (default 1024)");
+
+/* bytes per EDMA array, one cache line so the destination is invalidated */
+#define DAVINCIFLASH_DMA_ACNT	L1_CACHE_BYTES
+
+static void davinciflash_dma_callback(unsigned channel, u16 ch_status,
+		void *data)
+{
+	struct davinciflash_info *info = data;
+
+	info->dma_status = (ch_status == DMA_COMPLETE) ? 0 : -EIO;
+	info->dma_done = true;
+}
+
+/*
+ * The CFI command sets call copy_from with the chip's spinlock held, so
+ * the transfer is polled for rather than slept on.  What EDMA buys is
+ * the flash being read in bursts, at the pace of the EMIF and its page
+ * mode, instead of one uncached CPU load per word.
+ *
+ * @to and @len must be cache line aligned.  Returns the number of bytes
+ * copied, or zero if the caller has to copy them.
+ */
+static ssize_t davinciflash_dma_copy(struct davinciflash_info *info,
+		void *to, unsigned long from, ssize_t len)
+{
+	struct edmacc_param param;
+	unsigned long timeout;
+	dma_addr_t addr;
+	unsigned bcnt;
+
+	bcnt = min_t(ssize_t, len / DAVINCIFLASH_DMA_ACNT, USHORT_MAX);
+	len = bcnt * DAVINCIFLASH_DMA_ACNT;
+	addr = dma_map_single(info->dev, to, len, DMA_FROM_DEVICE);
+
+	param.opt = EDMA_TCC(EDMA_CHAN_SLOT(info->dma_channel))
+			| SYNCDIM | TCINTEN;
+	param.src = info->map.phys + from;
+	param.a_b_cnt = (bcnt << 16) | DAVINCIFLASH_DMA_ACNT;
+	param.dst = addr;
+	param.src_dst_bidx = (DAVINCIFLASH_DMA_ACNT << 16) |
+			DAVINCIFLASH_DMA_ACNT;
+	param.link_bcntrld = 0xffff;
+	param.src_dst_cidx = 0;
+	param.ccnt = 1;
+	edma_write_slot(info->dma_channel, &param);
+
+	info->dma_done = false;
+	edma_start(info->dma_channel);
+
+	timeout = jiffies + msecs_to_jiffies(100);
+	while (!ACCESS_ONCE(info->dma_done)) {
+		if (time_after(jiffies, timeout)) {
+			edma_stop(info->dma_channel);
+			edma_clean_channel(info->dma_channel);
+			info->dma_status = -ETIMEDOUT;
+			break;
+		}
+		cpu_relax();
+	}
+
+	dma_unmap_single(info->dev, addr, len, DMA_FROM_DEVICE);
+
+	if (info->dma_status) {
+		dev_err(info->dev, "DMA read error %d\n", info->dma_status);
+		return 0;
+	}
+	return len;
+}
+
+static void davinciflash_copy_from(struct map_info *map, void *to,
+		unsigned long from, ssize_t len)
+{
+	struct davinciflash_info *info =
+		container_of(map, struct davinciflash_info, map);
+	unsigned head;
+	ssize_t done;
+
+	if (info->dma_channel >= 0 && dma_threshold && len >= dma_threshold &&
+	    virt_addr_valid(to) && virt_addr_valid(to + len - 1) &&
+	    !irqs_disabled() && !oops_in_progress) {
+		/* CPU copy up to a cache line boundary of the buffer */
+		head = -(unsigned long)to & (L1_CACHE_BYTES - 1);
+		inline_map_copy_from(map, to, from, head);
+		to += head;
+		from += head;
+		len -= head;
+
+		while (len >= DAVINCIFLASH_DMA_ACNT) {
+			done = davinciflash_dma_copy(info, to, from, len);
+			if (!done)
+				break;
+			to += done;
+			from += done;
+			len -= done;
+		}
+	}
+
+	/* inline_map_copy_from() reads through map->cached when we have it */
+	inline_map_copy_from(map, to, from, len);
+}
+
+/* CFI calls this for ranges it programmed or erased */
+static void davinciflash_inval_cache(struct map_info *map, unsigned long from,
+		ssize_t len)
+{
+	dmac_inv_range(map->cached + from, map->cached + from + len);
+}
+
 static int __init davinciflash_probe(struct platform_device *pdev)
 {
 	struct davinciflash_pdata 	*pdata = pdev->dev.platform_data;
@@ -87,8 +210,10 @@ static int __init davinciflash_probe(struct platform_device *pdev)
 		goto err_clk_enable;
 	}
 
+	info->dev = &pdev->dev;
 	info->cs = pdev->id;
 	info->timing = pdata->timing;
+	info->dma_channel = -1;
 
 	val = __raw_readl(info->ctlr + A1CR_OFFSET + info->cs * 4);
 	val &= ~(ACR_ASIZE_MASK | ACR_EW_MASK | ACR_SS_MASK);
@@ -101,12 +226,39 @@ static int __init davinciflash_probe(struct platform_device *pdev)
 		goto err_timing;
 	}
 
+	if (pdata->page_words) {
+		ret = davinci_aemif_setup_page_mode(info->ctlr, info->cs,
+				pdata->page_words, pdata->page_delay);
+		if (ret < 0)
+			dev_warn(&pdev->dev, "page mode not enabled: %d\n",
+					ret);
+	}
+
 	info->map.name		= dev_name(&pdev->dev);
 	info->map.phys		= res1->start;
 	info->map.size		= resource_size(res1);
 	info->map.bankwidth	= pdata->width;
 
 	simple_map_init(&info->map);
+	info->map.copy_from	= davinciflash_copy_from;
+
+	/* reads only; CFI invalidates whatever it programs or erases */
+	if (pdata->cached) {
+		info->map.cached = ioremap_cached(res1->start,
+						  resource_size(res1));
+		if (info->map.cached)
+			info->map.inval_cache = davinciflash_inval_cache;
+		else
+			dev_warn(&pdev->dev, "no cached mapping\n");
+	}
+
+	ret = edma_alloc_channel(EDMA_CHANNEL_ANY, davinciflash_dma_callback,
+			info, EVENTQ_DEFAULT);
+	if (ret < 0)
+		dev_warn(&pdev->dev, "no DMA channel, using CPU copies\n");
+	else
+		info->dma_channel = ret;
+
 	info->mtd = do_map_probe("cfi_probe", &info->map);
 	if (!info->mtd) {
 		ret = -EIO;
@@ -158,7 +310,6 @@ static int __init davinciflash_probe(struct platform_device *pdev)
 	if (ret < 0)
 		goto err_partition_mtd;
 
-	info->dev = &pdev->dev;
 	platform_set_drvdata(pdev, info);
 
 	return 0;
@@ -167,6 +318,12 @@ err_partition_mtd:
 	map_destroy(info->mtd);
 
 err_map_probe:
+	if (info->dma_channel >= 0)
+		edma_free_channel(info->dma_channel);
+	if (info->map.cached)
+		iounmap(info->map.cached);
+	davinci_aemif_release_timing(info->ctlr, info->cs);
+
 err_timing:
 	clk_disable(info->clk);
 
@@ -197,6 +354,11 @@ static int __exit davinciflash_remove(struct platform_device *pdev)
 
 	map_destroy(info->mtd);
 
+	if (info->dma_channel >= 0)
+		edma_free_channel(info->dma_channel);
+	if (info->map.cached)
+		iounmap(info->map.cached);
+	davinci_aemif_release_timing(info->ctlr, info->cs);
 	iounmap(info->map.virt);
 	iounmap(info->ctlr);
 
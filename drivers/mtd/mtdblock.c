@@ -13,20 +13,44 @@
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/vmalloc.h>
+#include <linux/bitmap.h>
+#include <linux/err.h>
+#include <linux/workqueue.h>
 
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/blktrans.h>
 #include <linux/mutex.h>
 
+#define MTDBLK_MAX_CACHE	16
+#define MTDBLK_SECT_SHIFT	9
+
+static int cache_blocks = 4;
+module_param(cache_blocks, int, 0444);
+MODULE_PARM_DESC(cache_blocks, "Erase blocks cached per device (1-16)");
+
+static unsigned int writeback_ms = 2000;
+module_param(writeback_ms, uint, 0644);
+MODULE_PARM_DESC(writeback_ms, "Write a dirty cached erase block back after "
+		 "this many ms (0: only on sync, eviction or close)");
+
+struct mtdblk_cache {
+	unsigned char *data;
+	unsigned long *valid;		/* 512 byte sectors present in data */
+	unsigned long offset;
+	unsigned long last_use;		/* LRU stamp */
+	unsigned long dirtied;		/* jiffies when it became dirty */
+	enum { STATE_EMPTY, STATE_DIRTY } state;
+};
 
 static struct mtdblk_dev {
 	struct mtd_info *mtd;
 	int count;
 	struct mutex cache_mutex;
-	unsigned char *cache_data;
-	unsigned long cache_offset;
 	unsigned int cache_size;
-	enum { STATE_EMPTY, STATE_CLEAN, STATE_DIRTY } cache_state;
+	int cache_ways;			/* entries of cache[] allocated */
+	unsigned long lru_clock;
+	struct mtdblk_cache cache[MTDBLK_MAX_CACHE];
+	struct delayed_work writeback;
 } *mtdblks[MAX_MTD_DEVICES];
 
 static struct mutex mtdblks_lock;
@@ -37,8 +61,16 @@ static struct mutex mtdblks_lock;
  * Since typical flash erasable sectors are much larger than what Linux's
  * buffer cache can handle, we must implement read-modify-write on flash
  * sectors for each block write requests.  To avoid over-erasing flash sectors
- * and to speed things up, we locally cache a whole flash sector while it is
- * being written to until a different sector is required.
+ * and to speed things up, we locally cache up to cache_blocks flash sectors
+ * while they are being written to, evicting the least recently used one
+ * when another sector is required.  Dirty sectors are also written back
+ * writeback_ms after they were first dirtied, and on sync and close.
+ *
+ * A cached sector is not read from flash when it is first written to.
+ * The 512 byte pieces written are tracked in 'valid', and only the
+ * pieces still missing are read, merged into runs, when the sector is
+ * written back or read from.  A sector rewritten from start to end, as
+ * when an image is copied onto the device, is never read at all.
  */
 
 static void erase_callback(struct erase_info *done)
@@ -96,40 +128,191 @@ static int erase_write (struct mtd_info *mtd, unsigned long pos,
 }
 
 
-static int write_cached_data (struct mtdblk_dev *mtdblk)
+/* Read the pieces of a cached sector that were not written into it */
+static int fill_cached_data (struct mtdblk_dev *mtdblk,
+			     struct mtdblk_cache *c)
+{
+	struct mtd_info *mtd = mtdblk->mtd;
+	unsigned int nsect = mtdblk->cache_size >> MTDBLK_SECT_SHIFT;
+	unsigned int start, end;
+	size_t retlen, len;
+	int ret;
+
+	for (start = find_first_zero_bit(c->valid, nsect); start < nsect;
+	     start = find_next_zero_bit(c->valid, nsect, end)) {
+		end = find_next_bit(c->valid, nsect, start);
+		len = (end - start) << MTDBLK_SECT_SHIFT;
+
+		ret = mtd->read(mtd, c->offset + (start << MTDBLK_SECT_SHIFT),
+				len, &retlen,
+				c->data + (start << MTDBLK_SECT_SHIFT));
+		if (ret)
+			return ret;
+		if (retlen != len)
+			return -EIO;
+	}
+
+	bitmap_fill(c->valid, nsect);
+	return 0;
+}
+
+static int cached_range_valid(struct mtdblk_cache *c, unsigned int offset,
+			      unsigned int size)
+{
+	unsigned int first = offset >> MTDBLK_SECT_SHIFT;
+	unsigned int last = (offset + size - 1) >> MTDBLK_SECT_SHIFT;
+
+	return find_next_zero_bit(c->valid, last + 1, first) > last;
+}
+
+static int write_cached_data (struct mtdblk_dev *mtdblk,
+			      struct mtdblk_cache *c)
 {
 	struct mtd_info *mtd = mtdblk->mtd;
 	int ret;
 
-	if (mtdblk->cache_state != STATE_DIRTY)
+	if (c->state != STATE_DIRTY)
 		return 0;
 
 	DEBUG(MTD_DEBUG_LEVEL2, "mtdblock: writing cached data for \"%s\" "
 			"at 0x%lx, size 0x%x\n", mtd->name,
-			mtdblk->cache_offset, mtdblk->cache_size);
+			c->offset, mtdblk->cache_size);
 
-	ret = erase_write (mtd, mtdblk->cache_offset,
-			   mtdblk->cache_size, mtdblk->cache_data);
+	ret = fill_cached_data(mtdblk, c);
+	if (ret)
+		return ret;
+
+	ret = erase_write (mtd, c->offset, mtdblk->cache_size, c->data);
 	if (ret)
 		return ret;
 
 	/*
-	 * Here we could argubly set the cache state to STATE_CLEAN.
+	 * Here we could argubly keep the data as a clean cache entry.
 	 * However this could lead to inconsistency since we will not
 	 * be notified if this content is altered on the flash by other
 	 * means.  Let's declare it empty and leave buffering tasks to
 	 * the buffer cache instead.
 	 */
-	mtdblk->cache_state = STATE_EMPTY;
+	c->state = STATE_EMPTY;
 	return 0;
 }
 
+/* Write back every dirty sector, in flash order */
+static int write_all_cached_data (struct mtdblk_dev *mtdblk)
+{
+	struct mtdblk_cache *c;
+	int i, ret;
+
+	for (;;) {
+		c = NULL;
+		for (i = 0; i < mtdblk->cache_ways; i++)
+			if (mtdblk->cache[i].state == STATE_DIRTY &&
+			    (!c || mtdblk->cache[i].offset < c->offset))
+				c = &mtdblk->cache[i];
+		if (!c)
+			return 0;
+
+		ret = write_cached_data(mtdblk, c);
+		if (ret)
+			return ret;
+	}
+}
+
+static struct mtdblk_cache *find_cached_data (struct mtdblk_dev *mtdblk,
+					      unsigned long sect_start)
+{
+	struct mtdblk_cache *c;
+	int i;
+
+	for (i = 0; i < mtdblk->cache_ways; i++) {
+		c = &mtdblk->cache[i];
+		if (c->state != STATE_EMPTY && c->offset == sect_start) {
+			c->last_use = ++mtdblk->lru_clock;
+			return c;
+		}
+	}
+
+	return NULL;
+}
+
+/* Get the entry caching sect_start, evicting the least recently used one */
+static struct mtdblk_cache *get_cached_data (struct mtdblk_dev *mtdblk,
+					     unsigned long sect_start)
+{
+	struct mtdblk_cache *c, *victim = NULL;
+	int i, ret;
+
+	c = find_cached_data(mtdblk, sect_start);
+	if (c)
+		return c;
+
+	for (i = 0; i < mtdblk->cache_ways; i++) {
+		c = &mtdblk->cache[i];
+		if (c->state == STATE_EMPTY) {
+			victim = c;
+			break;
+		}
+		if (!victim || c->last_use < victim->last_use)
+			victim = c;
+	}
+
+	ret = write_cached_data(mtdblk, victim);
+	if (ret)
+		return ERR_PTR(ret);
+
+	victim->offset = sect_start;
+	victim->last_use = ++mtdblk->lru_clock;
+	bitmap_zero(victim->valid, mtdblk->cache_size >> MTDBLK_SECT_SHIFT);
+	return victim;
+}
+
+static void mtdblock_writeback_work(struct work_struct *work)
+{
+	struct mtdblk_dev *mtdblk =
+		container_of(work, struct mtdblk_dev, writeback.work);
+	unsigned long expire = msecs_to_jiffies(writeback_ms);
+	unsigned long next = 0;
+	struct mtdblk_cache *c;
+	int i, ret, pending = 0;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	for (i = 0; i < mtdblk->cache_ways; i++) {
+		c = &mtdblk->cache[i];
+		if (c->state != STATE_DIRTY)
+			continue;
+
+		if (!time_before(jiffies, c->dirtied + expire)) {
+			ret = write_cached_data(mtdblk, c);
+			if (ret) {
+				printk(KERN_WARNING "mtdblock: write-back at "
+				       "0x%lx on \"%s\" failed (%d)\n",
+				       c->offset, mtdblk->mtd->name, ret);
+				c->dirtied = jiffies;
+			}
+		}
+
+		if (c->state == STATE_DIRTY &&
+		    (!pending || time_before(c->dirtied, next))) {
+			next = c->dirtied;
+			pending = 1;
+		}
+	}
+
+	if (pending) {
+		next += expire;
+		schedule_delayed_work(&mtdblk->writeback,
+				      time_after(next, jiffies) ?
+				      next - jiffies : 0);
+	}
+	mutex_unlock(&mtdblk->cache_mutex);
+}
 
 static int do_cached_write (struct mtdblk_dev *mtdblk, unsigned long pos,
 			    int len, const char *buf)
 {
 	struct mtd_info *mtd = mtdblk->mtd;
 	unsigned int sect_size = mtdblk->cache_size;
+	struct mtdblk_cache *c;
 	size_t retlen;
 	int ret;
 
@@ -150,40 +333,40 @@ static int do_cached_write (struct mtdblk_dev *mtdblk, unsigned long pos,
 			/*
 			 * We are covering a whole sector.  Thus there is no
 			 * need to bother with the cache while it may still be
-			 * useful for other partial writes.
+			 * useful for other partial writes.  A cached copy of
+			 * it is superseded.
 			 */
+			c = find_cached_data(mtdblk, sect_start);
+			if (c)
+				c->state = STATE_EMPTY;
 			ret = erase_write (mtd, pos, size, buf);
 			if (ret)
 				return ret;
 		} else {
 			/* Partial sector: need to use the cache */
+			c = get_cached_data(mtdblk, sect_start);
+			if (IS_ERR(c))
+				return PTR_ERR(c);
 
-			if (mtdblk->cache_state == STATE_DIRTY &&
-			    mtdblk->cache_offset != sect_start) {
-				ret = write_cached_data(mtdblk);
-				if (ret)
-					return ret;
-			}
-
-			if (mtdblk->cache_state == STATE_EMPTY ||
-			    mtdblk->cache_offset != sect_start) {
-				/* fill the cache with the current sector */
-				mtdblk->cache_state = STATE_EMPTY;
-				ret = mtd->read(mtd, sect_start, sect_size,
-						&retlen, mtdblk->cache_data);
+			/* only whole 512 byte pieces are tracked */
+			if ((offset | size) & ((1 << MTDBLK_SECT_SHIFT) - 1)) {
+				ret = fill_cached_data(mtdblk, c);
 				if (ret)
 					return ret;
-				if (retlen != sect_size)
-					return -EIO;
-
-				mtdblk->cache_offset = sect_start;
-				mtdblk->cache_size = sect_size;
-				mtdblk->cache_state = STATE_CLEAN;
 			}
 
 			/* write data to our local cache */
-			memcpy (mtdblk->cache_data + offset, buf, size);
-			mtdblk->cache_state = STATE_DIRTY;
+			memcpy (c->data + offset, buf, size);
+			bitmap_set(c->valid, offset >> MTDBLK_SECT_SHIFT,
+				   size >> MTDBLK_SECT_SHIFT);
+
+			if (c->state != STATE_DIRTY) {
+				c->state = STATE_DIRTY;
+				c->dirtied = jiffies;
+				if (writeback_ms)
+					schedule_delayed_work(&mtdblk->writeback,
+						msecs_to_jiffies(writeback_ms));
+			}
 		}
 
 		buf += size;
@@ -200,6 +383,7 @@ static int do_cached_read (struct mtdblk_dev *mtdblk, unsigned long pos,
 {
 	struct mtd_info *mtd = mtdblk->mtd;
 	unsigned int sect_size = mtdblk->cache_size;
+	struct mtdblk_cache *c;
 	size_t retlen;
 	int ret;
 
@@ -220,11 +404,17 @@ static int do_cached_read (struct mtdblk_dev *mtdblk, unsigned long pos,
 		 * Check if the requested data is already cached
 		 * Read the requested amount of data from our internal cache if it
 		 * contains what we want, otherwise we read the data directly
-		 * from flash.
+		 * from flash.  The missing parts of a cached sector have to be
+		 * read into it first, the flash copy of them may be stale.
 		 */
-		if (mtdblk->cache_state != STATE_EMPTY &&
-		    mtdblk->cache_offset == sect_start) {
-			memcpy (buf, mtdblk->cache_data + offset, size);
+		c = find_cached_data(mtdblk, sect_start);
+		if (c) {
+			if (!cached_range_valid(c, offset, size)) {
+				ret = fill_cached_data(mtdblk, c);
+				if (ret)
+					return ret;
+			}
+			memcpy (buf, c->data + offset, size);
 		} else {
 			ret = mtd->read(mtd, pos, size, &retlen, buf);
 			if (ret)
@@ -241,27 +431,72 @@ static int do_cached_read (struct mtdblk_dev *mtdblk, unsigned long pos,
 	return 0;
 }
 
+static int alloc_cache(struct mtdblk_dev *mtdblk)
+{
+	unsigned int nsect = mtdblk->cache_size >> MTDBLK_SECT_SHIFT;
+	int ways = clamp(cache_blocks, 1, MTDBLK_MAX_CACHE);
+	struct mtdblk_cache *c;
+
+	while (mtdblk->cache_ways < ways) {
+		c = &mtdblk->cache[mtdblk->cache_ways];
+		c->data = vmalloc(mtdblk->cache_size);
+		c->valid = kzalloc(BITS_TO_LONGS(nsect) * sizeof(long),
+				   GFP_KERNEL);
+		if (!c->data || !c->valid) {
+			vfree(c->data);
+			kfree(c->valid);
+			c->data = NULL;
+			c->valid = NULL;
+			break;
+		}
+		mtdblk->cache_ways++;
+	}
+
+	return mtdblk->cache_ways ? 0 : -ENOMEM;
+}
+
+static void free_cache(struct mtdblk_dev *mtdblk)
+{
+	int i;
+
+	for (i = 0; i < mtdblk->cache_ways; i++) {
+		vfree(mtdblk->cache[i].data);
+		kfree(mtdblk->cache[i].valid);
+	}
+}
+
 static int mtdblock_readsect(struct mtd_blktrans_dev *dev,
 			      unsigned long block, char *buf)
 {
 	struct mtdblk_dev *mtdblk = mtdblks[dev->devnum];
-	return do_cached_read(mtdblk, block<<9, 512, buf);
+	int ret;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	ret = do_cached_read(mtdblk, block<<9, 512, buf);
+	mutex_unlock(&mtdblk->cache_mutex);
+	return ret;
 }
 
 static int mtdblock_writesect(struct mtd_blktrans_dev *dev,
 			      unsigned long block, char *buf)
 {
 	struct mtdblk_dev *mtdblk = mtdblks[dev->devnum];
-	if (unlikely(!mtdblk->cache_data && mtdblk->cache_size)) {
-		mtdblk->cache_data = vmalloc(mtdblk->mtd->erasesize);
-		if (!mtdblk->cache_data)
+	int ret;
+
+	mutex_lock(&mtdblk->cache_mutex);
+	if (unlikely(!mtdblk->cache_ways && mtdblk->cache_size)) {
+		if (alloc_cache(mtdblk)) {
+			mutex_unlock(&mtdblk->cache_mutex);
 			return -EINTR;
+		}
 		/* -EINTR is not really correct, but it is the best match
 		 * documented in man 2 write for all cases.  We could also
 		 * return -EAGAIN sometimes, but why bother?
 		 */
 	}
-	return do_cached_write(mtdblk, block<<9, 512, buf);
+	ret = do_cached_write(mtdblk, block<<9, 512, buf);
+	mutex_unlock(&mtdblk->cache_mutex);
+	return ret;
 }
 
 static int mtdblock_open(struct mtd_blktrans_dev *mbd)
@@ -290,11 +525,9 @@ static int mtdblock_open(struct mtd_blktrans_dev *mbd)
 	mtdblk->mtd = mtd;
 
 	mutex_init(&mtdblk->cache_mutex);
-	mtdblk->cache_state = STATE_EMPTY;
-	if ( !(mtdblk->mtd->flags & MTD_NO_ERASE) && mtdblk->mtd->erasesize) {
+	INIT_DELAYED_WORK(&mtdblk->writeback, mtdblock_writeback_work);
+	if ( !(mtdblk->mtd->flags & MTD_NO_ERASE) && mtdblk->mtd->erasesize)
 		mtdblk->cache_size = mtdblk->mtd->erasesize;
-		mtdblk->cache_data = NULL;
-	}
 
 	mtdblks[dev] = mtdblk;
 	mutex_unlock(&mtdblks_lock);
@@ -314,15 +547,16 @@ static int mtdblock_release(struct mtd_blktrans_dev *mbd)
 	mutex_lock(&mtdblks_lock);
 
 	mutex_lock(&mtdblk->cache_mutex);
-	write_cached_data(mtdblk);
+	write_all_cached_data(mtdblk);
 	mutex_unlock(&mtdblk->cache_mutex);
 
 	if (!--mtdblk->count) {
 		/* It was the last usage. Free the device */
 		mtdblks[dev] = NULL;
+		cancel_delayed_work_sync(&mtdblk->writeback);
 		if (mtdblk->mtd->sync)
 			mtdblk->mtd->sync(mtdblk->mtd);
-		vfree(mtdblk->cache_data);
+		free_cache(mtdblk);
 		kfree(mtdblk);
 	}
 
@@ -338,7 +572,7 @@ static int mtdblock_flush(struct mtd_blktrans_dev *dev)
 	struct mtdblk_dev *mtdblk = mtdblks[dev->devnum];
 
 	mutex_lock(&mtdblk->cache_mutex);
-	write_cached_data(mtdblk);
+	write_all_cached_data(mtdblk);
 	mutex_unlock(&mtdblk->cache_mutex);
 
 	if (mtdblk->mtd->sync)
@@ -15,6 +15,8 @@
 #include <linux/smp_lock.h>
 #include <linux/backing-dev.h>
 #include <linux/compat.h>
+#include <linux/pagemap.h>
+#include <linux/vmalloc.h>
 
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/compatmac.h>
@@ -137,6 +139,100 @@ static int mtd_close(struct inode *inode, struct file *file)
 */
 #define MAX_KMALLOC_SIZE 0x20000
 
+/*
+ * Reads and writes of at least an eraseblock, starting and ending on
+ * page boundaries, skip the kmalloc() bounce buffer.  The user pages
+ * are pinned a chunk at a time and vmap()ed into one virtually
+ * contiguous buffer that mtd->read/write work on directly, so the data
+ * is neither copied nor limited to MAX_KMALLOC_SIZE pieces; NAND
+ * drivers that do DMA can transfer straight to or from those pages.
+ */
+#define MTD_DIRECT_CHUNK	(1024 * 1024)
+
+static int mtd_direct_ok(struct mtd_file_info *mfi, loff_t pos, size_t count)
+{
+	struct mtd_info *mtd = mfi->mtd;
+
+	return mfi->mode == MTD_MODE_NORMAL && count >= mtd->erasesize &&
+		!mtd_mod_by_ws(pos, mtd) && !mtd_mod_by_ws(count, mtd);
+}
+
+static int mtd_direct_chunk(struct mtd_info *mtd, loff_t pos,
+			    unsigned long uaddr, size_t len, int write,
+			    size_t *retlen)
+{
+	unsigned int offset = uaddr & ~PAGE_MASK;
+	int nr = (offset + len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	struct page **pages;
+	void *vaddr;
+	int i, got, ret;
+
+	pages = kmalloc(nr * sizeof(*pages), GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	/* a read from flash writes the user's pages */
+	down_read(&current->mm->mmap_sem);
+	got = get_user_pages(current, current->mm, uaddr & PAGE_MASK, nr,
+			     !write, 0, pages, NULL);
+	up_read(&current->mm->mmap_sem);
+	if (got < nr) {
+		ret = got < 0 ? got : -EFAULT;
+		goto out;
+	}
+
+	vaddr = vmap(pages, nr, VM_MAP, PAGE_KERNEL);
+	if (!vaddr) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	if (write)
+		ret = mtd->write(mtd, pos, len, retlen, vaddr + offset);
+	else
+		ret = mtd->read(mtd, pos, len, retlen, vaddr + offset);
+	/* also writes back what the CPU stored through the alias */
+	vunmap(vaddr);
+
+out:
+	for (i = 0; i < got; i++) {
+		if (!write)
+			set_page_dirty_lock(pages[i]);
+		page_cache_release(pages[i]);
+	}
+	kfree(pages);
+	return ret;
+}
+
+static ssize_t mtd_direct_io(struct mtd_info *mtd, char __user *buf,
+			     size_t count, loff_t *ppos, int write)
+{
+	size_t chunk, retlen, total_retlen = 0;
+	size_t len;
+	int ret;
+
+	/* whole eraseblocks, so chunks stay page aligned */
+	chunk = max_t(size_t, MTD_DIRECT_CHUNK / mtd->erasesize, 1) *
+		mtd->erasesize;
+
+	while (count) {
+		len = min(count, chunk);
+		retlen = 0;
+		ret = mtd_direct_chunk(mtd, *ppos, (unsigned long)buf, len,
+				       write, &retlen);
+		/* same as for bounced reads: pass data with ECC trouble on */
+		if (ret && (write || (ret != -EUCLEAN && ret != -EBADMSG)))
+			return total_retlen ? total_retlen : ret;
+
+		*ppos += retlen;
+		total_retlen += retlen;
+		count -= retlen;
+		buf += retlen;
+		if (retlen == 0)
+			break;
+	}
+	return total_retlen;
+}
+
 static ssize_t mtd_read(struct file *file, char __user *buf, size_t count,loff_t *ppos)
 {
 	struct mtd_file_info *mfi = file->private_data;
@@ -155,8 +251,8 @@ static ssize_t mtd_read(struct file *file, char __user *buf, size_t count,loff_t
 	if (!count)
 		return 0;
 
-	/* FIXME: Use kiovec in 2.5 to lock down the user's buffers
-	   and pass them directly to the MTD functions */
+	if (mtd_direct_ok(mfi, *ppos, count))
+		return mtd_direct_io(mtd, buf, count, ppos, 0);
 
 	if (count > MAX_KMALLOC_SIZE)
 		kbuf=kmalloc(MAX_KMALLOC_SIZE, GFP_KERNEL);
@@ -251,6 +347,9 @@ static ssize_t mtd_write(struct file *file, const char __user *buf, size_t count
 	if (!count)
 		return 0;
 
+	if (mtd_direct_ok(mfi, *ppos, count))
+		return mtd_direct_io(mtd, (char __user *)buf, count, ppos, 1);
+
 	if (count > MAX_KMALLOC_SIZE)
 		kbuf=kmalloc(MAX_KMALLOC_SIZE, GFP_KERNEL);
 	else
@@ -30,10 +30,18 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/io.h>
+#include <linux/completion.h>
+#include <linux/interrupt.h>
+#include <linux/delay.h>
+#include <linux/dma-mapping.h>
+#include <linux/workqueue.h>
+#include <linux/vmalloc.h>
+#include <linux/hrtimer.h>
 #include <linux/mtd/nand.h>
 #include <linux/mtd/partitions.h>
 
 #include <mach/nand.h>
+#include <mach/edma.h>
 
 #include <asm/mach-types.h>
 
@@ -46,7 +54,8 @@
  *
  * The 1-bit ECC hardware is supported, as well as the newer 4-bit ECC
  * available on chips like the DM355 and OMAP-L137 and needed with the
- * more error-prone MLC NAND chips.
+ * more error-prone MLC NAND chips.  Parts needing 8-bit correction get
+ * a software BCH code.
  *
  * This driver assumes EM_WAIT connects all the NAND devices' RDY/nBUSY
  * outputs in a "wire-AND" configuration, with no per-chip signals.
@@ -75,11 +84,42 @@ struct davinci_nand_info {
 	uint32_t		core_chipsel;
 
 	struct davinci_aemif_timing	*timing;
+	bool			timing_held;
+
+	/* EDMA page data transfers; channel is negative for PIO only */
+	int			dma_channel;
+	dma_addr_t		phys_base;
+	struct completion	dma_done;
+	int			dma_status;
+
+	/* EM_WAIT rising edge interrupt, else zero to poll for ready */
+	int			irq;
+	struct completion	ready;
+
+	/* late check of a flash bbt against the factory markers */
+	struct delayed_work	bbt_verify;
+
+	/* interleaved with another chipselect into one MTD */
+	struct davinci_nand_ileave	*ileave;
 };
 
 static DEFINE_SPINLOCK(davinci_nand_lock);
 static bool ecc4_busy;
 
+static unsigned __initdata use_dma = 1;
+module_param(use_dma, uint, 0);
+MODULE_PARM_DESC(use_dma, "Whether to use DMA for page data. Default = 1");
+
+static unsigned dma_threshold = 512;
+module_param(dma_threshold, uint, 0644);
+MODULE_PARM_DESC(dma_threshold,
+		"Smallest buffer moved by DMA, 0 = never. Default = 512");
+
+static unsigned bbt_verify_delay = 30;
+module_param(bbt_verify_delay, uint, 0644);
+MODULE_PARM_DESC(bbt_verify_delay,
+		"Seconds after probe to check a flash BBT, 0 = never. Default = 30");
+
 #define to_davinci_nand(m) container_of(m, struct davinci_nand_info, mtd)
 
 
@@ -134,6 +174,20 @@ static void nand_davinci_select_chip(struct mtd_info *mtd, int chip)
 
 	info->chip.IO_ADDR_W = (void __iomem __force *)addr;
 	info->chip.IO_ADDR_R = info->chip.IO_ADDR_W;
+
+	/*
+	 * nand_base selects the chip for the length of each operation;
+	 * keep cpufreq from retiming the chip select in the middle.
+	 */
+	if (!info->timing || oops_in_progress)
+		return;
+	if (chip >= 0 && !info->timing_held) {
+		davinci_aemif_timing_lock();
+		info->timing_held = true;
+	} else if (chip < 0 && info->timing_held) {
+		info->timing_held = false;
+		davinci_aemif_timing_unlock();
+	}
 }
 
 /*----------------------------------------------------------------------*/
@@ -301,35 +355,29 @@ static int nand_davinci_calculate_4bit(struct mtd_info *mtd,
 	return 0;
 }
 
-/* Correct up to 4 bits in data we just read, using state left in the
- * hardware plus the ecc_code computed when it was first written.
- */
-static int nand_davinci_correct_4bit(struct mtd_info *mtd,
-		u_char *data, u_char *ecc_code, u_char *null)
+/* All ten ECC bytes 0xff?  The sector is erased; ignore its ECC. */
+static bool nand_davinci_erased_4bit(const u_char *ecc_code)
 {
 	int i;
-	struct davinci_nand_info *info = to_davinci_nand(mtd);
-	unsigned short ecc10[8];
-	unsigned short *ecc16;
-	u32 syndrome[4];
-	u32 ecc_state;
-	unsigned num_errors, corrected;
-	unsigned long timeo = jiffies + msecs_to_jiffies(100);
 
-	/* All bytes 0xff?  It's an erased page; ignore its ECC. */
 	for (i = 0; i < 10; i++) {
 		if (ecc_code[i] != 0xff)
-			goto compare;
+			return false;
 	}
-	return 0;
+	return true;
+}
+
+/* Unpack ten bytes into eight 10 bit values.  We know we're
+ * little-endian, and use type punning for less shifting/masking.
+ */
+static int nand_davinci_unpack_4bit(const u_char *ecc_code,
+		unsigned short ecc10[8])
+{
+	const unsigned short *ecc16;
 
-compare:
-	/* Unpack ten bytes into eight 10 bit values.  We know we're
-	 * little-endian, and use type punning for less shifting/masking.
-	 */
 	if (WARN_ON(0x01 & (unsigned) ecc_code))
 		return -EINVAL;
-	ecc16 = (unsigned short *)ecc_code;
+	ecc16 = (const unsigned short *)ecc_code;
 
 	ecc10[0] =  (ecc16[0] >>  0) & 0x3ff;
 	ecc10[1] = ((ecc16[0] >> 10) & 0x3f) | ((ecc16[1] << 6) & 0x3c0);
@@ -340,6 +388,18 @@ compare:
 	ecc10[6] = ((ecc16[3] >> 12) & 0xf)  | ((ecc16[4] << 4) & 0x3f0);
 	ecc10[7] =  (ecc16[4] >>  6) & 0x3ff;
 
+	return 0;
+}
+
+/* Hand the expected ECC for the sector just read to the controller and
+ * report whether the resulting syndrome shows any errors.
+ */
+static bool nand_davinci_syndrome_4bit(struct davinci_nand_info *info,
+		const unsigned short ecc10[8])
+{
+	u32 syndrome[4];
+	int i;
+
 	/* Tell ECC controller about the expected ECC codes. */
 	for (i = 7; i >= 0; i--)
 		davinci_nand_writel(info, NAND_4BIT_ECC_LOAD_OFFSET, ecc10[i]);
@@ -349,8 +409,18 @@ compare:
 	 */
 	davinci_nand_readl(info, NANDFSR_OFFSET);
 	nand_davinci_readecc_4bit(info, syndrome);
-	if (!(syndrome[0] | syndrome[1] | syndrome[2] | syndrome[3]))
-		return 0;
+	return syndrome[0] | syndrome[1] | syndrome[2] | syndrome[3];
+}
+
+/* Locate and flip the bad bits behind a non-zero syndrome.  Returns the
+ * number of bits corrected, or -EIO if there were too many.
+ */
+static int nand_davinci_fix_4bit(struct davinci_nand_info *info, u_char *data)
+{
+	int i;
+	u32 ecc_state;
+	unsigned num_errors, corrected;
+	unsigned long timeo = jiffies + msecs_to_jiffies(100);
 
 	/*
 	 * Clear any previous address calculation by doing a dummy read of an
@@ -359,8 +429,8 @@ compare:
 	davinci_nand_readl(info, NAND_ERR_ADD1_OFFSET);
 
 	/* Start address calculation, and wait for it to complete.
-	 * We _could_ start reading more data while this is working,
-	 * to speed up the overall page read.
+	 * Starting the next sector's ECC would discard this state, so
+	 * the read of further data can't overlap with it.
 	 */
 	davinci_nand_writel(info, NANDFCR_OFFSET,
 			davinci_nand_readl(info, NANDFCR_OFFSET) | BIT(13));
@@ -432,6 +502,580 @@ correct:
 	return corrected;
 }
 
+/* Correct up to 4 bits in data we just read, using state left in the
+ * hardware plus the ecc_code computed when it was first written.
+ */
+static int nand_davinci_correct_4bit(struct mtd_info *mtd,
+		u_char *data, u_char *ecc_code, u_char *null)
+{
+	struct davinci_nand_info *info = to_davinci_nand(mtd);
+	unsigned short ecc10[8];
+
+	if (nand_davinci_erased_4bit(ecc_code))
+		return 0;
+
+	if (nand_davinci_unpack_4bit(ecc_code, ecc10) < 0)
+		return -EINVAL;
+
+	if (!nand_davinci_syndrome_4bit(info, ecc10))
+		return 0;
+
+	return nand_davinci_fix_4bit(info, data);
+}
+
+/* 2 KiB pages hold four 512 byte sectors */
+#define NAND_4BIT_MAX_STEPS	4
+
+/*
+ * Page read for 4-bit ECC with the ECC bytes stored in the OOB.  The OOB
+ * comes in first, so every sector's expected ECC is unpacked before any
+ * data is transferred; after each sector only the eight ECC loads and
+ * the syndrome check remain.  Clean sectors never touch the address
+ * calculation, and the ECC statistics are updated once per page.
+ */
+static int nand_davinci_read_page_4bit(struct mtd_info *mtd,
+		struct nand_chip *chip, uint8_t *buf, int page)
+{
+	struct davinci_nand_info *info = to_davinci_nand(mtd);
+	int i, eccsize = chip->ecc.size;
+	int eccbytes = chip->ecc.bytes;
+	int eccsteps = chip->ecc.steps;
+	uint8_t *ecc_code = chip->buffers->ecccode;
+	uint32_t *eccpos = chip->ecc.layout->eccpos;
+	unsigned short ecc10[NAND_4BIT_MAX_STEPS][8];
+	unsigned long check = 0;
+	unsigned corrected = 0, failed = 0;
+	int step;
+
+	/* Read the OOB area first.  The page is already in the chip's
+	 * data (or cache) register, so just move the column around;
+	 * that keeps cache reads going.
+	 */
+	chip->cmdfunc(mtd, NAND_CMD_RNDOUT, mtd->writesize, -1);
+	chip->read_buf(mtd, chip->oob_poi, mtd->oobsize);
+	chip->cmdfunc(mtd, NAND_CMD_RNDOUT, 0, -1);
+
+	for (i = 0; i < chip->ecc.total; i++)
+		ecc_code[i] = chip->oob_poi[eccpos[i]];
+
+	for (step = 0; step < eccsteps; step++) {
+		uint8_t *code = &ecc_code[step * eccbytes];
+
+		if (nand_davinci_erased_4bit(code))
+			continue;
+		if (nand_davinci_unpack_4bit(code, ecc10[step]) < 0)
+			failed++;
+		else
+			__set_bit(step, &check);
+	}
+
+	for (step = 0; step < eccsteps; step++) {
+		uint8_t *p = buf + step * eccsize;
+		int stat;
+
+		chip->ecc.hwctl(mtd, NAND_ECC_READ);
+		chip->read_buf(mtd, p, eccsize);
+
+		/* terminate the ECC calculation, see calculate_4bit() */
+		davinci_nand_readl(info, NAND_4BIT_ECC1_OFFSET);
+
+		if (!test_bit(step, &check) ||
+				!nand_davinci_syndrome_4bit(info, ecc10[step]))
+			continue;
+
+		stat = nand_davinci_fix_4bit(info, p);
+		if (stat < 0)
+			failed++;
+		else
+			corrected += stat;
+	}
+
+	mtd->ecc_stats.failed += failed;
+	mtd->ecc_stats.corrected += corrected;
+	return 0;
+}
+
+/* All bytes 0xff?  Programming such a sector leaves it erased. */
+static bool nand_davinci_blank(const uint8_t *buf, int len)
+{
+	const unsigned long *p = (const unsigned long *)buf;
+	int i;
+
+	if (!IS_ALIGNED((unsigned long)buf, sizeof(*p))) {
+		for (i = 0; i < len; i++) {
+			if (buf[i] != 0xff)
+				return false;
+		}
+		return true;
+	}
+
+	for (i = 0; i < len / sizeof(*p); i++) {
+		if (p[i] != ~0UL)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Page write for 4-bit ECC, for subpage writes.  The ECC of an all-0xff
+ * sector is not all 0xff, so the generic hwecc write would program ECC
+ * bytes for the sectors a subpage write pads out, and a later write to
+ * those sectors could not store its ECC anymore.  Sectors which are still
+ * blank keep their ECC bytes erased instead; read_page_4bit() already
+ * treats such sectors as erased.  This is what lets UBI put the VID header
+ * in the second 512 byte subpage of a 2 KiB page.
+ */
+static void nand_davinci_write_page_4bit(struct mtd_info *mtd,
+		struct nand_chip *chip, const uint8_t *buf)
+{
+	int i, eccsize = chip->ecc.size;
+	int eccbytes = chip->ecc.bytes;
+	int eccsteps = chip->ecc.steps;
+	uint8_t *ecc_calc = chip->buffers->ecccalc;
+	const uint8_t *p = buf;
+	uint32_t *eccpos = chip->ecc.layout->eccpos;
+
+	for (i = 0; eccsteps; eccsteps--, i += eccbytes, p += eccsize) {
+		if (nand_davinci_blank(p, eccsize)) {
+			chip->write_buf(mtd, p, eccsize);
+			memset(&ecc_calc[i], 0xff, eccbytes);
+			continue;
+		}
+		chip->ecc.hwctl(mtd, NAND_ECC_WRITE);
+		chip->write_buf(mtd, p, eccsize);
+		chip->ecc.calculate(mtd, p, &ecc_calc[i]);
+	}
+
+	for (i = 0; i < chip->ecc.total; i++)
+		chip->oob_poi[eccpos[i]] = ecc_calc[i];
+
+	chip->write_buf(mtd, chip->oob_poi, mtd->oobsize);
+}
+
+/*----------------------------------------------------------------------*/
+
+/*
+ * 8-bit software ECC, for NAND parts needing more than the 4-bit hardware
+ * can correct.  A binary BCH code over GF(2^13) corrects up to eight bit
+ * errors in each 512 byte sector with 13 ECC bytes; the 4-bit engine uses
+ * a different (Reed-Solomon) code, so it can't help here.
+ *
+ * Reads are made cheap for the common case instead: the page comes in
+ * with a single transfer, and a clean sector costs one table-driven
+ * re-encode, a byte at a time, and a compare with the stored ECC.  Only
+ * when they differ are syndromes computed, and then from the 104 bit
+ * difference rather than the whole sector, before Berlekamp-Massey and a
+ * Chien search over the 4200 bit positions actually used.
+ *
+ * As with the 4-bit ECC, sectors left blank keep erased ECC bytes, and
+ * sectors with all-0xff ECC read as erased.
+ */
+
+#define BCH8_M		13
+#define BCH8_N		((1 << BCH8_M) - 1)
+#define BCH8_T		8
+#define BCH8_ECC_BITS	(BCH8_M * BCH8_T)
+#define BCH8_ECC_BYTES	13
+#define BCH8_BITS	(512 * 8 + BCH8_ECC_BITS)
+#define BCH8_POLY	0x201b		/* x^13 + x^4 + x^3 + x + 1 */
+
+struct davinci_bch8 {
+	u16		alpha_to[BCH8_N + 1];
+	u16		index_of[BCH8_N + 1];
+	/* x^104 * t(x) mod g(x), left aligned in 104 of 128 bits */
+	u32		enc[256][4];
+	unsigned	users;
+};
+
+static struct davinci_bch8 *bch8;
+
+static inline u16 bch8_mul(u16 a, u16 b)
+{
+	if (!a || !b)
+		return 0;
+	return bch8->alpha_to[(bch8->index_of[a] + bch8->index_of[b]) % BCH8_N];
+}
+
+static inline u16 bch8_div(u16 a, u16 b)
+{
+	if (!a)
+		return 0;
+	return bch8->alpha_to[(bch8->index_of[a] + BCH8_N - bch8->index_of[b])
+			% BCH8_N];
+}
+
+/* shift the left aligned 104 bit remainder by one, dropping the top bit */
+static inline void bch8_shl1(u32 r[4])
+{
+	r[0] = (r[0] << 1) | (r[1] >> 31);
+	r[1] = (r[1] << 1) | (r[2] >> 31);
+	r[2] = (r[2] << 1) | (r[3] >> 31);
+	r[3] = (r[3] << 1) & 0xff000000;
+}
+
+/*
+ * Build the field, the generator polynomial (the product of the minimal
+ * polynomials of alpha^1, alpha^3 ... alpha^15, degree 104), and from it
+ * the byte-wise remainder table.
+ */
+static int __init nand_davinci_bch8_init(void)
+{
+	u16 *g;
+	u8 *root;
+	u32 gl[4] = { 0, 0, 0, 0 }, r[4];
+	int i, j, deg = 0, x = 1;
+
+	if (bch8) {
+		bch8->users++;
+		return 0;
+	}
+
+	bch8 = vmalloc(sizeof(*bch8));
+	g = kzalloc((BCH8_ECC_BITS + 1) * sizeof(*g), GFP_KERNEL);
+	root = kzalloc(BCH8_N, GFP_KERNEL);
+	if (!bch8 || !g || !root)
+		goto fail;
+
+	for (i = 0; i < BCH8_N; i++) {
+		bch8->alpha_to[i] = x;
+		bch8->index_of[x] = i;
+		x <<= 1;
+		if (x & (1 << BCH8_M))
+			x ^= BCH8_POLY;
+	}
+	bch8->alpha_to[BCH8_N] = 1;
+	bch8->index_of[0] = 0;
+
+	/* the roots of g are the conjugates of alpha^(2i+1), i < t */
+	for (i = 1; i < 2 * BCH8_T; i += 2) {
+		j = i;
+		do {
+			root[j] = 1;
+			j = (j * 2) % BCH8_N;
+		} while (j != i);
+	}
+
+	g[0] = 1;
+	for (i = 0; i < BCH8_N; i++) {
+		if (!root[i])
+			continue;
+		if (deg == BCH8_ECC_BITS)
+			goto fail;
+		/* g *= (x + alpha^i) */
+		g[++deg] = 1;
+		for (j = deg - 1; j > 0; j--)
+			g[j] = g[j - 1] ^ bch8_mul(g[j], bch8->alpha_to[i]);
+		g[0] = bch8_mul(g[0], bch8->alpha_to[i]);
+	}
+	if (deg != BCH8_ECC_BITS)
+		goto fail;
+
+	/* binary coefficients below x^104, left aligned like remainders */
+	for (i = 0; i < BCH8_ECC_BITS; i++) {
+		int pos = BCH8_ECC_BITS - 1 - i;
+
+		if (g[i] > 1)
+			goto fail;
+		if (g[i])
+			gl[pos / 32] |= BIT(31 - pos % 32);
+	}
+
+	for (i = 0; i < 256; i++) {
+		memset(r, 0, sizeof(r));
+		for (j = 7; j >= 0; j--) {
+			bool fb = (r[0] >> 31) ^ ((i >> j) & 1);
+
+			bch8_shl1(r);
+			if (fb) {
+				r[0] ^= gl[0];
+				r[1] ^= gl[1];
+				r[2] ^= gl[2];
+				r[3] ^= gl[3];
+			}
+		}
+		memcpy(bch8->enc[i], r, sizeof(r));
+	}
+
+	kfree(root);
+	kfree(g);
+	bch8->users = 1;
+	return 0;
+
+fail:
+	kfree(root);
+	kfree(g);
+	vfree(bch8);
+	bch8 = NULL;
+	return -ENOMEM;
+}
+
+static void nand_davinci_bch8_exit(void)
+{
+	if (bch8 && !--bch8->users) {
+		vfree(bch8);
+		bch8 = NULL;
+	}
+}
+
+static void nand_davinci_bch8_encode(const u_char *data, u_char *ecc)
+{
+	u32 (*enc)[4] = bch8->enc;
+	u32 w0 = 0, w1 = 0, w2 = 0, w3 = 0;
+	const u32 *t;
+	int i;
+
+	for (i = 0; i < 512; i++) {
+		t = enc[(w0 >> 24) ^ data[i]];
+		w0 = ((w0 << 8) | (w1 >> 24)) ^ t[0];
+		w1 = ((w1 << 8) | (w2 >> 24)) ^ t[1];
+		w2 = ((w2 << 8) | (w3 >> 24)) ^ t[2];
+		w3 = t[3];
+	}
+
+	ecc[0] = w0 >> 24;
+	ecc[1] = w0 >> 16;
+	ecc[2] = w0 >> 8;
+	ecc[3] = w0;
+	ecc[4] = w1 >> 24;
+	ecc[5] = w1 >> 16;
+	ecc[6] = w1 >> 8;
+	ecc[7] = w1;
+	ecc[8] = w2 >> 24;
+	ecc[9] = w2 >> 16;
+	ecc[10] = w2 >> 8;
+	ecc[11] = w2;
+	ecc[12] = w3 >> 24;
+}
+
+static void nand_davinci_hwctl_bch8(struct mtd_info *mtd, int mode)
+{
+}
+
+static int nand_davinci_calculate_bch8(struct mtd_info *mtd,
+		const u_char *dat, u_char *ecc_code)
+{
+	nand_davinci_bch8_encode(dat, ecc_code);
+	return 0;
+}
+
+/*
+ * Locate the errors whose remainder is diff.  Returns their number with
+ * the bit positions (codeword degrees) in errloc, or -EBADMSG.
+ */
+static int nand_davinci_bch8_locate(const u_char *diff, int *errloc)
+{
+	u16 s[2 * BCH8_T + 1];
+	u16 elp[2 * BCH8_T + 2], b[2 * BCH8_T + 2], tmp[2 * BCH8_T + 2];
+	int log_elp[BCH8_T + 1];
+	int i, j, n, k, deg, l = 0, m = 1, nerr = 0;
+	u16 d, bb = 1, coef, sum;
+
+	/* odd syndromes from the set bits, even ones by squaring */
+	memset(s, 0, sizeof(s));
+	for (k = 0; k < BCH8_ECC_BYTES; k++) {
+		if (!diff[k])
+			continue;
+		for (i = 0; i < 8; i++) {
+			if (!(diff[k] & BIT(i)))
+				continue;
+			deg = (BCH8_ECC_BYTES - 1 - k) * 8 + i;
+			for (j = 1; j < 2 * BCH8_T; j += 2)
+				s[j] ^= bch8->alpha_to[(j * deg) % BCH8_N];
+		}
+	}
+	for (j = 2; j <= 2 * BCH8_T; j += 2)
+		s[j] = bch8_mul(s[j / 2], s[j / 2]);
+
+	/* Berlekamp-Massey */
+	memset(elp, 0, sizeof(elp));
+	memset(b, 0, sizeof(b));
+	elp[0] = b[0] = 1;
+	for (n = 0; n < 2 * BCH8_T; n++) {
+		d = s[n + 1];
+		for (i = 1; i <= l; i++)
+			d ^= bch8_mul(elp[i], s[n + 1 - i]);
+		if (!d) {
+			m++;
+			continue;
+		}
+		coef = bch8_div(d, bb);
+		memcpy(tmp, elp, sizeof(tmp));
+		for (i = 0; i + m < ARRAY_SIZE(elp); i++)
+			elp[i + m] ^= bch8_mul(coef, b[i]);
+		if (2 * l <= n) {
+			l = n + 1 - l;
+			memcpy(b, tmp, sizeof(b));
+			bb = d;
+			m = 1;
+		} else {
+			m++;
+		}
+	}
+	if (l > BCH8_T)
+		return -EBADMSG;
+	for (i = l + 1; i < ARRAY_SIZE(elp); i++)
+		if (elp[i])
+			return -EBADMSG;
+
+	/* Chien search: errors at p where elp(alpha^-p) == 0 */
+	for (i = 1; i <= l; i++)
+		log_elp[i] = elp[i] ? bch8->index_of[elp[i]] : -1;
+	for (n = 0; n < BCH8_BITS && nerr < l; n++) {
+		sum = 1;
+		for (i = 1; i <= l; i++) {
+			if (log_elp[i] < 0)
+				continue;
+			sum ^= bch8->alpha_to[log_elp[i]];
+			log_elp[i] -= i;
+			if (log_elp[i] < 0)
+				log_elp[i] += BCH8_N;
+		}
+		if (!sum)
+			errloc[nerr++] = n;
+	}
+
+	return nerr == l ? nerr : -EBADMSG;
+}
+
+/*
+ * Zero bits of an erased sector, up to eight of them, else -1.  Such
+ * bitflips are normal on MLC parts and must not fail the read.
+ */
+static int nand_davinci_erased_bch8(const u_char *data, const u_char *ecc)
+{
+	const u32 *p = (const u32 *)data;
+	int i, flips = 0;
+
+	for (i = 0; i < BCH8_ECC_BYTES; i++)
+		flips += hweight8(ecc[i] ^ 0xff);
+
+	if (!IS_ALIGNED((unsigned long)data, sizeof(*p))) {
+		for (i = 0; i < 512 && flips <= BCH8_T; i++)
+			flips += hweight8(data[i] ^ 0xff);
+	} else {
+		for (i = 0; i < 512 / 4 && flips <= BCH8_T; i++)
+			flips += hweight32(~p[i]);
+	}
+
+	return flips <= BCH8_T ? flips : -1;
+}
+
+static int nand_davinci_correct_bch8(struct mtd_info *mtd,
+		u_char *data, u_char *ecc_code, u_char *null)
+{
+	u_char calc[BCH8_ECC_BYTES], differ = 0;
+	int errloc[BCH8_T];
+	int i, n, pos;
+
+	nand_davinci_bch8_encode(data, calc);
+	for (i = 0; i < BCH8_ECC_BYTES; i++) {
+		calc[i] ^= ecc_code[i];
+		differ |= calc[i];
+	}
+	if (!differ)
+		return 0;
+
+	n = nand_davinci_bch8_locate(calc, errloc);
+	if (n < 0) {
+		/* possibly an erased sector with a few bits flipped */
+		n = nand_davinci_erased_bch8(data, ecc_code);
+		if (n < 0)
+			return -EBADMSG;
+		memset(data, 0xff, 512);
+		return n;
+	}
+
+	for (i = 0; i < n; i++) {
+		/* errors in the ECC bytes need no fixing */
+		if (errloc[i] < BCH8_ECC_BITS)
+			continue;
+		pos = errloc[i] - BCH8_ECC_BITS;
+		data[511 - pos / 8] ^= BIT(pos % 8);
+	}
+	return n;
+}
+
+/* All thirteen ECC bytes 0xff?  The sector is erased. */
+static bool nand_davinci_blank_ecc_bch8(const u_char *ecc_code)
+{
+	int i;
+
+	for (i = 0; i < BCH8_ECC_BYTES; i++) {
+		if (ecc_code[i] != 0xff)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Page read for 8-bit ECC: the whole page data in one transfer, then the
+ * OOB, then per sector the check described above.
+ */
+static int nand_davinci_read_page_bch8(struct mtd_info *mtd,
+		struct nand_chip *chip, uint8_t *buf, int page)
+{
+	int i, eccsize = chip->ecc.size;
+	int eccbytes = chip->ecc.bytes;
+	int eccsteps = chip->ecc.steps;
+	uint8_t *ecc_code = chip->buffers->ecccode;
+	uint32_t *eccpos = chip->ecc.layout->eccpos;
+	unsigned corrected = 0, failed = 0;
+	int step, stat;
+
+	chip->read_buf(mtd, buf, mtd->writesize);
+	chip->read_buf(mtd, chip->oob_poi, mtd->oobsize);
+
+	for (i = 0; i < chip->ecc.total; i++)
+		ecc_code[i] = chip->oob_poi[eccpos[i]];
+
+	for (step = 0; step < eccsteps; step++) {
+		uint8_t *p = buf + step * eccsize;
+		uint8_t *code = &ecc_code[step * eccbytes];
+
+		if (nand_davinci_blank_ecc_bch8(code)) {
+			stat = nand_davinci_erased_bch8(p, code);
+			if (stat > 0)
+				memset(p, 0xff, eccsize);
+		} else {
+			stat = nand_davinci_correct_bch8(mtd, p, code, NULL);
+		}
+
+		if (stat < 0)
+			failed++;
+		else
+			corrected += stat;
+	}
+
+	mtd->ecc_stats.failed += failed;
+	mtd->ecc_stats.corrected += corrected;
+	return 0;
+}
+
+/* Page write for 8-bit ECC; blank sectors as in write_page_4bit() */
+static void nand_davinci_write_page_bch8(struct mtd_info *mtd,
+		struct nand_chip *chip, const uint8_t *buf)
+{
+	int i, eccsize = chip->ecc.size;
+	int eccbytes = chip->ecc.bytes;
+	int eccsteps = chip->ecc.steps;
+	uint8_t *ecc_calc = chip->buffers->ecccalc;
+	const uint8_t *p = buf;
+	uint32_t *eccpos = chip->ecc.layout->eccpos;
+
+	for (i = 0; eccsteps; eccsteps--, i += eccbytes, p += eccsize) {
+		if (nand_davinci_blank(p, eccsize))
+			memset(&ecc_calc[i], 0xff, eccbytes);
+		else
+			nand_davinci_bch8_encode(p, &ecc_calc[i]);
+	}
+
+	for (i = 0; i < chip->ecc.total; i++)
+		chip->oob_poi[eccpos[i]] = ecc_calc[i];
+
+	chip->write_buf(mtd, buf, mtd->writesize);
+	chip->write_buf(mtd, chip->oob_poi, mtd->oobsize);
+}
+
 /*----------------------------------------------------------------------*/
 
 /*
@@ -443,10 +1087,102 @@ correct:
  * the two LSBs for NAND access ... so we can issue 32-bit reads/writes
  * and have that transparently morphed into multiple NAND operations.
  */
+static void nand_davinci_dma_callback(unsigned channel, u16 ch_status,
+		void *data)
+{
+	struct davinci_nand_info *info = data;
+
+	info->dma_status = (ch_status == DMA_COMPLETE) ? 0 : -EIO;
+	complete(&info->dma_done);
+}
+
+/*
+ * Page data can instead go through one manually triggered A-B synced
+ * EDMA transfer of 32-bit arrays, with the NAND side held at a single
+ * address (per the note above) while the CPU sleeps.  Buffers that are
+ * small, neither lowmem nor within one vmalloc page, or not aligned
+ * well enough stay with PIO; reads have to own whole cache lines, since
+ * those get invalidated.  vmalloc buffers are pinned user pages from
+ * mtdchar's direct I/O, freshly mapped and not yet touched through that
+ * mapping, so the cache maintenance done on the page itself suffices.
+ *
+ * Returns zero once the buffer went through EDMA, even if the transfer
+ * then failed:  the chip has consumed the data either way, and ECC will
+ * catch a bad read.  Otherwise the caller should use PIO.
+ */
+static int nand_davinci_dma_xfer(struct davinci_nand_info *info,
+		void *buf, int len, bool to_nand)
+{
+	enum dma_data_direction dir = to_nand ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	unsigned align = to_nand ? 0x03 : L1_CACHE_BYTES - 1;
+	struct edmacc_param param;
+	dma_addr_t nand, addr;
+
+	if (info->dma_channel < 0 || !dma_threshold || len < dma_threshold)
+		return -EINVAL;
+	if (((((unsigned)buf) | len) & align) || (len >> 2) > USHORT_MAX)
+		return -EINVAL;
+	if (oops_in_progress || irqs_disabled())
+		return -EINVAL;
+	if (is_vmalloc_addr(buf)) {
+		if (offset_in_page(buf) + len > PAGE_SIZE)
+			return -EINVAL;
+	} else if (!virt_addr_valid(buf)) {
+		return -EINVAL;
+	}
+
+	/* the chipselect's current data window, as picked by select_chip */
+	nand = info->phys_base + (info->chip.IO_ADDR_R - info->vaddr);
+	if (is_vmalloc_addr(buf))
+		addr = dma_map_page(info->dev, vmalloc_to_page(buf),
+				offset_in_page(buf), len, dir);
+	else
+		addr = dma_map_single(info->dev, buf, len, dir);
+
+	param.opt = EDMA_TCC(EDMA_CHAN_SLOT(info->dma_channel))
+			| SYNCDIM | TCINTEN;
+	param.a_b_cnt = ((len >> 2) << 16) | 4;
+	if (to_nand) {
+		param.src = addr;
+		param.dst = nand;
+		param.src_dst_bidx = 4;
+	} else {
+		param.src = nand;
+		param.dst = addr;
+		param.src_dst_bidx = 4 << 16;
+	}
+	param.link_bcntrld = 0xffff;
+	param.src_dst_cidx = 0;
+	param.ccnt = 1;
+	edma_write_slot(info->dma_channel, &param);
+
+	INIT_COMPLETION(info->dma_done);
+	edma_start(info->dma_channel);
+	if (!wait_for_completion_timeout(&info->dma_done,
+				msecs_to_jiffies(100))) {
+		edma_stop(info->dma_channel);
+		edma_clean_channel(info->dma_channel);
+		info->dma_status = -ETIMEDOUT;
+	}
+
+	if (is_vmalloc_addr(buf))
+		dma_unmap_page(info->dev, addr, len, dir);
+	else
+		dma_unmap_single(info->dev, addr, len, dir);
+
+	if (info->dma_status)
+		dev_err(info->dev, "DMA %s error %d\n",
+				to_nand ? "write" : "read", info->dma_status);
+	return 0;
+}
+
 static void nand_davinci_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
 {
 	struct nand_chip *chip = mtd->priv;
 
+	if (nand_davinci_dma_xfer(to_davinci_nand(mtd), buf, len, false) == 0)
+		return;
+
 	if ((0x03 & ((unsigned)buf)) == 0 && (0x03 & len) == 0)
 		ioread32_rep(chip->IO_ADDR_R, buf, len >> 2);
 	else if ((0x01 & ((unsigned)buf)) == 0 && (0x01 & len) == 0)
@@ -460,6 +1196,10 @@ static void nand_davinci_write_buf(struct mtd_info *mtd,
 {
 	struct nand_chip *chip = mtd->priv;
 
+	if (nand_davinci_dma_xfer(to_davinci_nand(mtd), (void *)buf,
+				len, true) == 0)
+		return;
+
 	if ((0x03 & ((unsigned)buf)) == 0 && (0x03 & len) == 0)
 		iowrite32_rep(chip->IO_ADDR_R, buf, len >> 2);
 	else if ((0x01 & ((unsigned)buf)) == 0 && (0x01 & len) == 0)
@@ -479,6 +1219,97 @@ static int nand_davinci_dev_ready(struct mtd_info *mtd)
 	return davinci_nand_readl(info, NANDFSR_OFFSET) & BIT(0);
 }
 
+static irqreturn_t nand_davinci_ready_irq(int irq, void *data)
+{
+	struct davinci_nand_info *info = data;
+
+	if (!(davinci_nand_readl(info, AEMIF_IMR_OFFSET) & AEMIF_INT_WR))
+		return IRQ_NONE;
+
+	davinci_nand_writel(info, AEMIF_IMCR_OFFSET, AEMIF_INT_WR);
+	davinci_nand_writel(info, AEMIF_IRR_OFFSET, AEMIF_INT_WR);
+	complete(&info->ready);
+
+	return IRQ_HANDLED;
+}
+
+/*
+ * Like nand_wait(), but sleep until EM_WAIT rises instead of spinning
+ * through a 2 msec erase or a 200 usec program.  The edge may already
+ * have passed by the time the interrupt is armed, so the pin level is
+ * checked afterwards; any wakeup that finds the chip still busy (a
+ * lost edge, a timeout) falls back to polling until the deadline.
+ */
+static int nand_davinci_waitfunc(struct mtd_info *mtd, struct nand_chip *chip)
+{
+	struct davinci_nand_info *info = to_davinci_nand(mtd);
+	unsigned long timeo = jiffies;
+
+	if (chip->state == FL_ERASING)
+		timeo += (HZ * 400) / 1000;
+	else
+		timeo += (HZ * 20) / 1000;
+
+	ndelay(100);
+	chip->cmdfunc(mtd, NAND_CMD_STATUS, -1, -1);
+
+	INIT_COMPLETION(info->ready);
+	davinci_nand_writel(info, AEMIF_IRR_OFFSET, AEMIF_INT_WR);
+	davinci_nand_writel(info, AEMIF_IMSR_OFFSET, AEMIF_INT_WR);
+
+	if (!nand_davinci_dev_ready(mtd) && time_before(jiffies, timeo))
+		wait_for_completion_timeout(&info->ready, timeo - jiffies);
+
+	davinci_nand_writel(info, AEMIF_IMCR_OFFSET, AEMIF_INT_WR);
+
+	while (!nand_davinci_dev_ready(mtd) && time_before(jiffies, timeo))
+		cond_resched();
+
+	return chip->read_byte(mtd);
+}
+
+/*
+ * EM_WAIT can't tell interleaved chips apart, so they are polled through
+ * their own status register, sleeping in between so the other chip's
+ * thread gets the CPU and the bus.
+ */
+static int nand_davinci_wait_status(struct mtd_info *mtd,
+		struct nand_chip *chip)
+{
+	unsigned long timeo = jiffies;
+	unsigned long poll_us;
+	ktime_t delay;
+	int status;
+
+	if (chip->state == FL_ERASING) {
+		timeo += (HZ * 400) / 1000;
+		poll_us = 500;
+	} else {
+		timeo += (HZ * 20) / 1000;
+		poll_us = 50;
+	}
+
+	ndelay(100);
+	chip->cmdfunc(mtd, NAND_CMD_STATUS, -1, -1);
+
+	for (;;) {
+		status = chip->read_byte(mtd);
+		if ((status & NAND_STATUS_READY) ||
+		    !time_before(jiffies, timeo))
+			break;
+
+		if (oops_in_progress) {
+			udelay(poll_us);
+			continue;
+		}
+		delay = ktime_set(0, poll_us * NSEC_PER_USEC);
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_hrtimeout(&delay, HRTIMER_MODE_REL);
+	}
+
+	return status;
+}
+
 /*----------------------------------------------------------------------*/
 
 /* An ECC layout for using 4-bit ECC with small-page flash, storing
@@ -518,6 +1349,613 @@ static struct nand_ecclayout hwecc4_2048 __initconst = {
 	},
 };
 
+/* 8-bit ECC on small-page flash: 13 ECC bytes around the badblock marker */
+static struct nand_ecclayout bch8_small __initconst = {
+	.eccbytes = 13,
+	.eccpos = { 0, 1, 2, 3, 4,
+		/* offset 5 holds the badblock marker */
+		6, 7, 8, 9, 10, 11, 12, 13, },
+	.oobfree = {
+		{.offset = 14, .length = 2, },
+	},
+};
+
+/* 8-bit ECC on large-page (2048 bytes) flash: 52 ECC bytes at the end of
+ * the spare area, leaving bytes 2..11 free.  The default flash BBT
+ * markers don't fit there; see bch8_bbt_main_descr.
+ */
+static struct nand_ecclayout bch8_2048 __initconst = {
+	.eccbytes = 52,
+	.eccpos = {
+		12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+		25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37,
+		38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50,
+		51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+		},
+	.oobfree = {
+		/* 2 bytes at offset 0 hold manufacturer badblock markers */
+		{.offset = 2, .length = 10, },
+	},
+};
+
+/* flash BBT markers within the bytes bch8_2048 leaves free */
+static uint8_t bch8_bbt_pattern[] = { 'B', 'b', 't', '0' };
+static uint8_t bch8_mirror_pattern[] = { '1', 't', 'b', 'B' };
+
+static struct nand_bbt_descr bch8_bbt_main_descr = {
+	.options	= NAND_BBT_LASTBLOCK | NAND_BBT_CREATE |
+			  NAND_BBT_WRITE | NAND_BBT_2BIT |
+			  NAND_BBT_VERSION | NAND_BBT_PERCHIP,
+	.offs		= 2,
+	.len		= 4,
+	.veroffs	= 6,
+	.maxblocks	= 4,
+	.pattern	= bch8_bbt_pattern
+};
+
+static struct nand_bbt_descr bch8_bbt_mirror_descr = {
+	.options	= NAND_BBT_LASTBLOCK | NAND_BBT_CREATE |
+			  NAND_BBT_WRITE | NAND_BBT_2BIT |
+			  NAND_BBT_VERSION | NAND_BBT_PERCHIP,
+	.offs		= 2,
+	.len		= 4,
+	.veroffs	= 6,
+	.maxblocks	= 4,
+	.pattern	= bch8_mirror_pattern
+};
+
+/*
+ * With a flash BBT, nand_scan only reads the table pages.  Check every
+ * block the table calls good against its factory marker once the system
+ * is up, adding any the table missed.
+ */
+static void nand_davinci_verify_bbt(struct work_struct *work)
+{
+	struct davinci_nand_info *info = container_of(to_delayed_work(work),
+			struct davinci_nand_info, bbt_verify);
+	int ret;
+
+	ret = nand_verify_bbt(&info->mtd);
+	if (ret < 0)
+		dev_warn(info->dev, "bad block table check failed (%d)\n", ret);
+	else if (ret)
+		dev_info(info->dev, "added %d bad blocks to the bad block table\n",
+				ret);
+}
+
+/*----------------------------------------------------------------------*/
+
+/*
+ * Two identical chips on separate chipselects can be interleaved into one
+ * MTD.  Pages alternate between the chips, so each eraseblock of the MTD
+ * is the same eraseblock on both, and a run of pages keeps both busy:
+ * one programs (or reads its array) while the next page moves over the
+ * bus to the other.  The second chip's share of every request runs from
+ * a worker thread, the first's from the caller.
+ */
+struct davinci_nand_ileave {
+	struct mtd_info		mtd;
+	struct mtd_info		*die[2];
+	struct workqueue_struct	*wq;
+	struct davinci_nand_pdata	*pdata;
+	bool			registered;
+	bool			partitioned;
+	char			name[32];
+};
+
+/* what one chip does for a request on the interleaved MTD */
+struct davinci_nand_ileave_op {
+	struct work_struct	work;
+	struct completion	done;
+	struct davinci_nand_ileave	*il;
+	int			(*fn)(struct davinci_nand_ileave_op *op);
+	unsigned		die;
+	bool			write;
+
+	loff_t			ofs;
+	size_t			len;
+	u_char			*buf;
+	struct mtd_oob_ops	*ops;
+	struct erase_info	*instr;
+
+	size_t			retlen;
+	size_t			oobretlen;
+	loff_t			fail_addr;	/* on the chip, erase only */
+	int			ret;
+};
+
+#define to_ileave(m)	container_of(m, struct davinci_nand_ileave, mtd)
+
+/* keep the first hard error; ECC corrections only if nothing worse */
+static void nand_davinci_il_status(struct davinci_nand_ileave_op *op,
+		int ret)
+{
+	if (!ret || op->ret == ret)
+		return;
+	if (!op->ret || op->ret == -EUCLEAN)
+		op->ret = ret;
+}
+
+static void nand_davinci_il_work(struct work_struct *work)
+{
+	struct davinci_nand_ileave_op *op;
+
+	op = container_of(work, struct davinci_nand_ileave_op, work);
+	op->ret = op->fn(op);
+	complete(&op->done);
+}
+
+/* run @fn for both chips at once and merge what they did */
+static int nand_davinci_il_run(struct davinci_nand_ileave *il,
+		struct davinci_nand_ileave_op *tmpl,
+		int (*fn)(struct davinci_nand_ileave_op *op))
+{
+	struct davinci_nand_ileave_op op[2];
+	struct mtd_info *mtd = &il->mtd;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		op[i] = *tmpl;
+		op[i].il = il;
+		op[i].fn = fn;
+		op[i].die = i;
+		op[i].retlen = 0;
+		op[i].oobretlen = 0;
+		op[i].fail_addr = MTD_FAIL_ADDR_UNKNOWN;
+		op[i].ret = 0;
+	}
+
+	INIT_WORK(&op[1].work, nand_davinci_il_work);
+	init_completion(&op[1].done);
+	queue_work(il->wq, &op[1].work);
+
+	op[0].ret = fn(&op[0]);
+	wait_for_completion(&op[1].done);
+
+	tmpl->retlen = op[0].retlen + op[1].retlen;
+	tmpl->oobretlen = op[0].oobretlen + op[1].oobretlen;
+	tmpl->fail_addr = op[0].fail_addr;
+	if (tmpl->fail_addr == MTD_FAIL_ADDR_UNKNOWN ||
+	    (op[1].fail_addr != MTD_FAIL_ADDR_UNKNOWN &&
+	     op[1].fail_addr < tmpl->fail_addr))
+		tmpl->fail_addr = op[1].fail_addr;
+	tmpl->ret = 0;
+	nand_davinci_il_status(tmpl, op[0].ret);
+	nand_davinci_il_status(tmpl, op[1].ret);
+
+	mtd->ecc_stats.corrected = il->die[0]->ecc_stats.corrected +
+		il->die[1]->ecc_stats.corrected;
+	mtd->ecc_stats.failed = il->die[0]->ecc_stats.failed +
+		il->die[1]->ecc_stats.failed;
+
+	return tmpl->ret;
+}
+
+/* offset on its chip of MTD offset @ofs, whose page is on chip @die */
+static inline loff_t nand_davinci_il_ofs(struct mtd_info *mtd, loff_t ofs)
+{
+	uint32_t inpage = ofs & mtd->writesize_mask;
+
+	return ((ofs >> mtd->writesize_shift) >> 1 << mtd->writesize_shift)
+		+ inpage;
+}
+
+static int nand_davinci_il_rw(struct davinci_nand_ileave_op *op)
+{
+	struct mtd_info *mtd = &op->il->mtd;
+	struct mtd_info *die = op->il->die[op->die];
+	loff_t ofs = op->ofs, end = op->ofs + op->len;
+	size_t chunk, retlen;
+	int ret;
+
+	while (ofs < end) {
+		chunk = min_t(loff_t, end - ofs,
+				mtd->writesize - (ofs & mtd->writesize_mask));
+		if (((ofs >> mtd->writesize_shift) & 1) == op->die) {
+			retlen = 0;
+			if (op->write)
+				ret = die->write(die,
+					nand_davinci_il_ofs(mtd, ofs), chunk,
+					&retlen, op->buf + (ofs - op->ofs));
+			else
+				ret = die->read(die,
+					nand_davinci_il_ofs(mtd, ofs), chunk,
+					&retlen, op->buf + (ofs - op->ofs));
+			op->retlen += retlen;
+			nand_davinci_il_status(op, ret);
+			if (ret && ret != -EUCLEAN)
+				break;
+		}
+		ofs += chunk;
+	}
+
+	return op->ret;
+}
+
+static int nand_davinci_il_read(struct mtd_info *mtd, loff_t from,
+		size_t len, size_t *retlen, u_char *buf)
+{
+	struct davinci_nand_ileave_op op = {
+		.ofs	= from,
+		.len	= len,
+		.buf	= buf,
+	};
+	int ret;
+
+	if (from < 0 || from >= mtd->size || len > mtd->size - from)
+		return -EINVAL;
+
+	ret = nand_davinci_il_run(to_ileave(mtd), &op, nand_davinci_il_rw);
+	*retlen = op.retlen;
+	return ret;
+}
+
+static int nand_davinci_il_write(struct mtd_info *mtd, loff_t to,
+		size_t len, size_t *retlen, const u_char *buf)
+{
+	struct davinci_nand_ileave_op op = {
+		.write	= true,
+		.ofs	= to,
+		.len	= len,
+		.buf	= (u_char *)buf,
+	};
+	int ret;
+
+	if (to < 0 || to >= mtd->size || len > mtd->size - to)
+		return -EINVAL;
+
+	ret = nand_davinci_il_run(to_ileave(mtd), &op, nand_davinci_il_rw);
+	*retlen = op.retlen;
+	return ret;
+}
+
+/*
+ * OOB operations go page by page, each page taking the next slice of the
+ * OOB buffer, so the caller sees the same layout as on a single chip.
+ */
+static int nand_davinci_il_oob(struct davinci_nand_ileave_op *op)
+{
+	struct mtd_info *mtd = &op->il->mtd;
+	struct mtd_info *die = op->il->die[op->die];
+	struct mtd_oob_ops *ops = op->ops;
+	struct mtd_oob_ops dops;
+	size_t avail, oobdone = 0, datdone = 0, chunk, ochunk;
+	loff_t ofs = op->ofs;
+	int ret;
+
+	avail = (ops->mode == MTD_OOB_AUTO) ? mtd->oobavail : mtd->oobsize;
+	avail -= ops->ooboffs;
+
+	for (;;) {
+		chunk = 0;
+		if (ops->datbuf) {
+			if (datdone >= ops->len)
+				break;
+			chunk = min_t(size_t, ops->len - datdone, mtd->writesize
+					- (ofs & mtd->writesize_mask));
+		} else if (oobdone >= ops->ooblen) {
+			break;
+		}
+		ochunk = ops->oobbuf ? min(avail, ops->ooblen - oobdone) : 0;
+
+		if (((ofs >> mtd->writesize_shift) & 1) == op->die) {
+			dops = *ops;
+			dops.len = chunk;
+			dops.ooblen = ochunk;
+			dops.datbuf = ops->datbuf ? ops->datbuf + datdone : NULL;
+			dops.oobbuf = ochunk ? ops->oobbuf + oobdone : NULL;
+			dops.retlen = 0;
+			dops.oobretlen = 0;
+
+			if (op->write)
+				ret = die->write_oob(die,
+					nand_davinci_il_ofs(mtd, ofs), &dops);
+			else
+				ret = die->read_oob(die,
+					nand_davinci_il_ofs(mtd, ofs), &dops);
+			op->retlen += dops.retlen;
+			op->oobretlen += dops.oobretlen;
+			nand_davinci_il_status(op, ret);
+			if (ret && ret != -EUCLEAN)
+				break;
+		}
+
+		datdone += chunk;
+		oobdone += ochunk;
+		ofs = ((ofs >> mtd->writesize_shift) + 1) << mtd->writesize_shift;
+	}
+
+	return op->ret;
+}
+
+static int nand_davinci_il_read_oob(struct mtd_info *mtd, loff_t from,
+		struct mtd_oob_ops *ops)
+{
+	struct davinci_nand_ileave_op op = {
+		.ofs	= from,
+		.ops	= ops,
+	};
+	int ret;
+
+	if (from < 0 || from >= mtd->size ||
+	    (ops->datbuf && ops->len > mtd->size - from))
+		return -EINVAL;
+
+	ret = nand_davinci_il_run(to_ileave(mtd), &op, nand_davinci_il_oob);
+	ops->retlen = op.retlen;
+	ops->oobretlen = op.oobretlen;
+	return ret;
+}
+
+static int nand_davinci_il_write_oob(struct mtd_info *mtd, loff_t to,
+		struct mtd_oob_ops *ops)
+{
+	struct davinci_nand_ileave_op op = {
+		.write	= true,
+		.ofs	= to,
+		.ops	= ops,
+	};
+	int ret;
+
+	if (to < 0 || to >= mtd->size ||
+	    (ops->datbuf && ops->len > mtd->size - to))
+		return -EINVAL;
+
+	ret = nand_davinci_il_run(to_ileave(mtd), &op, nand_davinci_il_oob);
+	ops->retlen = op.retlen;
+	ops->oobretlen = op.oobretlen;
+	return ret;
+}
+
+/* both chips erase the same block numbers: half the MTD's offsets */
+static int nand_davinci_il_erase_op(struct davinci_nand_ileave_op *op)
+{
+	struct mtd_info *die = op->il->die[op->die];
+	struct erase_info ei;
+	int ret;
+
+	memset(&ei, 0, sizeof(ei));
+	ei.mtd = die;
+	ei.addr = op->instr->addr >> 1;
+	ei.len = op->instr->len >> 1;
+
+	ret = die->erase(die, &ei);
+	if (ret)
+		op->fail_addr = ei.fail_addr;
+	return ret;
+}
+
+static int nand_davinci_il_erase(struct mtd_info *mtd,
+		struct erase_info *instr)
+{
+	struct davinci_nand_ileave *il = to_ileave(mtd);
+	struct davinci_nand_ileave_op op = {
+		.instr	= instr,
+	};
+	int ret;
+
+	if ((instr->addr | instr->len) & (mtd->erasesize - 1) ||
+	    instr->addr + instr->len > mtd->size)
+		return -EINVAL;
+
+	instr->fail_addr = MTD_FAIL_ADDR_UNKNOWN;
+	ret = nand_davinci_il_run(il, &op, nand_davinci_il_erase_op);
+
+	if (ret) {
+		instr->state = MTD_ERASE_FAILED;
+		if (op.fail_addr != MTD_FAIL_ADDR_UNKNOWN)
+			instr->fail_addr = (op.fail_addr >>
+				(mtd->erasesize_shift - 1)) << mtd->erasesize_shift;
+	} else {
+		instr->state = MTD_ERASE_DONE;
+	}
+	mtd_erase_callback(instr);
+
+	return ret;
+}
+
+static int nand_davinci_il_block_isbad(struct mtd_info *mtd, loff_t ofs)
+{
+	struct davinci_nand_ileave *il = to_ileave(mtd);
+	int ret;
+
+	if (ofs < 0 || ofs >= mtd->size)
+		return -EINVAL;
+
+	ret = il->die[0]->block_isbad(il->die[0], ofs >> 1);
+	if (!ret)
+		ret = il->die[1]->block_isbad(il->die[1], ofs >> 1);
+	return ret;
+}
+
+static int nand_davinci_il_block_markbad(struct mtd_info *mtd, loff_t ofs)
+{
+	struct davinci_nand_ileave *il = to_ileave(mtd);
+	int ret, ret1;
+
+	if (ofs < 0 || ofs >= mtd->size)
+		return -EINVAL;
+
+	ret = il->die[0]->block_markbad(il->die[0], ofs >> 1);
+	ret1 = il->die[1]->block_markbad(il->die[1], ofs >> 1);
+	if (!ret && !ret1)
+		mtd->ecc_stats.badblocks++;
+	return ret ? : ret1;
+}
+
+static void nand_davinci_il_sync(struct mtd_info *mtd)
+{
+	struct davinci_nand_ileave *il = to_ileave(mtd);
+
+	il->die[0]->sync(il->die[0]);
+	il->die[1]->sync(il->die[1]);
+}
+
+static int nand_davinci_il_suspend(struct mtd_info *mtd)
+{
+	struct davinci_nand_ileave *il = to_ileave(mtd);
+	int ret;
+
+	ret = il->die[0]->suspend(il->die[0]);
+	if (ret)
+		return ret;
+	ret = il->die[1]->suspend(il->die[1]);
+	if (ret)
+		il->die[0]->resume(il->die[0]);
+	return ret;
+}
+
+static void nand_davinci_il_resume(struct mtd_info *mtd)
+{
+	struct davinci_nand_ileave *il = to_ileave(mtd);
+
+	il->die[0]->resume(il->die[0]);
+	il->die[1]->resume(il->die[1]);
+}
+
+/* the first chip of a pair waits here for its partner */
+static struct davinci_nand_ileave *ileave_pending;
+
+static int __init nand_davinci_il_register(struct davinci_nand_ileave *il)
+{
+	struct mtd_info *mtd = &il->mtd, *die = il->die[0];
+	struct mtd_partition *parts = NULL;
+	int nr_parts = 0, ret;
+
+	mtd->type = die->type;
+	mtd->flags = die->flags;
+	mtd->size = die->size * 2;
+	mtd->erasesize = die->erasesize * 2;
+	mtd->writesize = die->writesize;
+	mtd->oobsize = die->oobsize;
+	mtd->oobavail = die->oobavail;
+	mtd->ecclayout = die->ecclayout;
+	mtd->subpage_sft = 0;
+	/* the chips are never registered themselves: no shifts set there */
+	mtd->erasesize_shift = ffs(mtd->erasesize) - 1;
+	mtd->writesize_shift = ffs(mtd->writesize) - 1;
+	mtd->erasesize_mask = (1 << mtd->erasesize_shift) - 1;
+	mtd->writesize_mask = (1 << mtd->writesize_shift) - 1;
+	mtd->name = il->name;
+	mtd->owner = THIS_MODULE;
+	mtd->dev.parent = die->dev.parent;
+
+	mtd->read = nand_davinci_il_read;
+	mtd->write = nand_davinci_il_write;
+	mtd->read_oob = nand_davinci_il_read_oob;
+	mtd->write_oob = nand_davinci_il_write_oob;
+	mtd->erase = nand_davinci_il_erase;
+	mtd->block_isbad = nand_davinci_il_block_isbad;
+	mtd->block_markbad = nand_davinci_il_block_markbad;
+	mtd->sync = nand_davinci_il_sync;
+	mtd->suspend = nand_davinci_il_suspend;
+	mtd->resume = nand_davinci_il_resume;
+
+	il->wq = create_singlethread_workqueue(il->name);
+	if (!il->wq)
+		return -ENOMEM;
+
+	if (mtd_has_partitions()) {
+		if (mtd_has_cmdlinepart()) {
+			static const char *probes[] __initconst =
+				{ "cmdlinepart", NULL };
+
+			nr_parts = parse_mtd_partitions(mtd, probes,
+							&parts, 0);
+		}
+		if (nr_parts <= 0) {
+			parts = il->pdata->parts;
+			nr_parts = il->pdata->nr_parts;
+		}
+		if (nr_parts > 0 && add_mtd_partitions(mtd, parts,
+						       nr_parts) == 0)
+			il->partitioned = true;
+	}
+
+	ret = 0;
+	if (!il->partitioned)
+		ret = add_mtd_device(mtd) ? -ENODEV : 0;
+	if (ret) {
+		destroy_workqueue(il->wq);
+		return ret;
+	}
+
+	il->registered = true;
+	pr_info("%s: %s and %s interleaved, %u KiB eraseblocks\n",
+		il->name, die->name, il->die[1]->name, mtd->erasesize >> 10);
+	return 0;
+}
+
+static int __init nand_davinci_il_add(struct davinci_nand_info *info,
+		struct davinci_nand_pdata *pdata)
+{
+	struct davinci_nand_ileave *il = ileave_pending;
+	struct mtd_info *die;
+	int ret;
+
+	if (!il) {
+		il = kzalloc(sizeof(*il), GFP_KERNEL);
+		if (!il)
+			return -ENOMEM;
+		il->die[0] = &info->mtd;
+		il->pdata = pdata;
+		info->ileave = il;
+		ileave_pending = il;
+		dev_info(info->dev, "waiting for a chip to interleave with\n");
+		return 0;
+	}
+
+	die = il->die[0];
+	if (die->size != info->mtd.size ||
+	    die->erasesize != info->mtd.erasesize ||
+	    die->writesize != info->mtd.writesize ||
+	    die->oobsize != info->mtd.oobsize ||
+	    die->oobavail != info->mtd.oobavail) {
+		dev_err(info->dev, "chip differs from %s, not interleaving\n",
+			die->name);
+		return -EINVAL;
+	}
+
+	il->die[1] = &info->mtd;
+	snprintf(il->name, sizeof(il->name), "%s+%d", die->name,
+		 info->core_chipsel);
+	info->ileave = il;
+	ileave_pending = NULL;
+
+	ret = nand_davinci_il_register(il);
+	if (ret) {
+		il->die[1] = NULL;
+		info->ileave = NULL;
+		ileave_pending = il;
+	}
+	return ret;
+}
+
+static void nand_davinci_il_del(struct davinci_nand_info *info)
+{
+	struct davinci_nand_ileave *il = info->ileave;
+
+	if (il->registered) {
+		if (mtd_has_partitions() && il->partitioned)
+			del_mtd_partitions(&il->mtd);
+		else
+			del_mtd_device(&il->mtd);
+		destroy_workqueue(il->wq);
+		il->registered = false;
+	}
+
+	if (il->die[0] == &info->mtd)
+		il->die[0] = NULL;
+	else
+		il->die[1] = NULL;
+	info->ileave = NULL;
+
+	if (ileave_pending == il)
+		ileave_pending = NULL;
+	if (!il->die[0] && !il->die[1])
+		kfree(il);
+}
+
 static int __init nand_davinci_probe(struct platform_device *pdev)
 {
 	struct davinci_nand_pdata	*pdata = pdev->dev.platform_data;
@@ -538,6 +1976,13 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 	if (pdev->id < 0 || pdev->id > 3)
 		return -ENODEV;
 
+	/* interleaving pairs up chipselects, each holding one chip */
+	if (pdata->interleave && (pdata->mask_chipsel ||
+			(pdata->ecc_mode == NAND_ECC_HW && pdata->ecc_bits == 4))) {
+		dev_err(&pdev->dev, "can't interleave with this setup\n");
+		return -EINVAL;
+	}
+
 	info = kzalloc(sizeof(*info), GFP_KERNEL);
 	if (!info) {
 		dev_err(&pdev->dev, "unable to allocate memory\n");
@@ -546,6 +1991,8 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 	}
 
 	platform_set_drvdata(pdev, info);
+	info->dma_channel = -1;
+	INIT_DELAYED_WORK(&info->bbt_verify, nand_davinci_verify_bbt);
 
 	res1 = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	res2 = platform_get_resource(pdev, IORESOURCE_MEM, 1);
@@ -566,6 +2013,7 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 	info->dev		= &pdev->dev;
 	info->base		= base;
 	info->vaddr		= vaddr;
+	info->phys_base		= res1->start;
 
 	info->mtd.priv		= &info->chip;
 	info->mtd.name		= dev_name(&pdev->dev);
@@ -578,8 +2026,11 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 	info->chip.chip_delay	= 0;
 	info->chip.select_chip	= nand_davinci_select_chip;
 
-	/* options such as NAND_USE_FLASH_BBT or 16-bit widths */
-	info->chip.options	= pdata->options;
+	/* options such as NAND_USE_FLASH_BBT or 16-bit widths; none
+	 * of our read_page methods issue page commands, so cache read
+	 * and two-plane program sequences are fine here
+	 */
+	info->chip.options	= pdata->options | NAND_PIPELINE_OPS;
 	info->chip.bbt_td	= pdata->bbt_td;
 	info->chip.bbt_md	= pdata->bbt_md;
 	info->timing		= pdata->timing;
@@ -632,6 +2083,18 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 			info->chip.ecc.correct = nand_davinci_correct_4bit;
 			info->chip.ecc.hwctl = nand_davinci_hwctl_4bit;
 			info->chip.ecc.bytes = 10;
+		} else if (pdata->ecc_bits == 8) {
+			/* software BCH, only the page layout is checked
+			 * once the chip is known
+			 */
+			ret = nand_davinci_bch8_init();
+			if (ret < 0)
+				goto err_ecc;
+
+			info->chip.ecc.calculate = nand_davinci_calculate_bch8;
+			info->chip.ecc.correct = nand_davinci_correct_bch8;
+			info->chip.ecc.hwctl = nand_davinci_hwctl_bch8;
+			info->chip.ecc.bytes = BCH8_ECC_BYTES;
 		} else {
 			info->chip.ecc.calculate = nand_davinci_calculate_1bit;
 			info->chip.ecc.correct = nand_davinci_correct_1bit;
@@ -687,6 +2150,38 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 
 	spin_unlock_irq(&davinci_nand_lock);
 
+	/* sleep on EM_WAIT when the board routes its interrupt to us */
+	ret = pdata->interleave ? 0 : platform_get_irq(pdev, 0);
+	if (ret > 0) {
+		init_completion(&info->ready);
+		davinci_nand_writel(info, AEMIF_IMCR_OFFSET, AEMIF_INT_WR);
+		if (request_irq(ret, nand_davinci_ready_irq, 0,
+					dev_name(&pdev->dev), info) == 0) {
+			info->irq = ret;
+			info->chip.waitfunc = nand_davinci_waitfunc;
+		} else
+			dev_warn(&pdev->dev, "IRQ %d busy, polling for ready\n",
+					ret);
+	}
+
+	/* interleaved chips busy at once all pull on the same EM_WAIT */
+	if (pdata->interleave) {
+		info->chip.dev_ready = NULL;
+		info->chip.chip_delay = 25;
+		info->chip.waitfunc = nand_davinci_wait_status;
+	}
+
+	if (use_dma) {
+		init_completion(&info->dma_done);
+		ret = edma_alloc_channel(EDMA_CHANNEL_ANY,
+				nand_davinci_dma_callback, info,
+				EVENTQ_DEFAULT);
+		if (ret < 0)
+			dev_warn(&pdev->dev, "no DMA channel, using PIO\n");
+		else
+			info->dma_channel = ret;
+	}
+
 	/* Scan to find existence of the device(s) */
 	ret = nand_scan_ident(&info->mtd, pdata->mask_chipsel ? 2 : 1);
 	if (ret < 0) {
@@ -721,6 +2216,9 @@ static int __init nand_davinci_probe(struct platform_device *pdev)
 		if (chunks == 4) {
 			info->ecclayout = hwecc4_2048;
 			info->chip.ecc.mode = NAND_ECC_HW_OOB_FIRST;
+			info->chip.ecc.read_page = nand_davinci_read_page_4bit;
+			info->chip.ecc.write_page =
+					nand_davinci_write_page_4bit;
 			goto syndrome_done;
 		}
 
@@ -739,11 +2237,40 @@ syndrome_done:
 		info->chip.ecc.layout = &info->ecclayout;
 	}
 
+	if (pdata->ecc_bits == 8) {
+		int	chunks = info->mtd.writesize / 512;
+
+		if (chunks == 1 && info->mtd.oobsize >= 16) {
+			info->ecclayout = bch8_small;
+		} else if (chunks == 4 && info->mtd.oobsize >= 64) {
+			info->ecclayout = bch8_2048;
+			if (!info->chip.bbt_td) {
+				info->chip.bbt_td = &bch8_bbt_main_descr;
+				info->chip.bbt_md = &bch8_bbt_mirror_descr;
+			}
+		} else {
+			dev_warn(&pdev->dev, "no 8-bit ECC support "
+					"for this page size\n");
+			ret = -EIO;
+			goto err_scan;
+		}
+
+		info->chip.ecc.read_page = nand_davinci_read_page_bch8;
+		info->chip.ecc.write_page = nand_davinci_write_page_bch8;
+		info->chip.ecc.layout = &info->ecclayout;
+	}
+
 	ret = nand_scan_tail(&info->mtd);
 	if (ret < 0)
 		goto err_scan;
 
-	if (mtd_has_partitions()) {
+	if (pdata->interleave) {
+		ret = nand_davinci_il_add(info, pdata);
+		if (ret < 0) {
+			nand_release(&info->mtd);
+			goto err_scan;
+		}
+	} else if (mtd_has_partitions()) {
 		struct mtd_partition	*mtd_parts = NULL;
 		int			mtd_parts_nb = 0;
 
@@ -776,7 +2303,7 @@ syndrome_done:
 	/* If there's no partition info, just package the whole chip
 	 * as a single MTD device.
 	 */
-	if (!info->partitioned)
+	if (!info->partitioned && !pdata->interleave)
 		ret = add_mtd_device(&info->mtd) ? -ENODEV : 0;
 
 	if (ret < 0)
@@ -786,9 +2313,20 @@ syndrome_done:
 	dev_info(&pdev->dev, "controller rev. %d.%d\n",
 	       (val >> 8) & 0xff, val & 0xff);
 
+	/* A flash BBT spared us the full scan at boot; do it later */
+	if ((info->chip.options & NAND_USE_FLASH_BBT) && bbt_verify_delay)
+		schedule_delayed_work(&info->bbt_verify,
+				bbt_verify_delay * HZ);
+
 	return 0;
 
 err_scan:
+	if (info->dma_channel >= 0)
+		edma_free_channel(info->dma_channel);
+	if (info->irq)
+		free_irq(info->irq, info);
+	davinci_aemif_release_timing(info->base, info->core_chipsel);
+
 err_timing:
 	clk_disable(info->clk);
 
@@ -800,8 +2338,11 @@ err_clk_enable:
 		ecc4_busy = false;
 	spin_unlock_irq(&davinci_nand_lock);
 
-err_ecc:
 err_clk:
+	if (pdata->ecc_bits == 8)
+		nand_davinci_bch8_exit();
+
+err_ecc:
 err_ioremap:
 	if (base)
 		iounmap(base);
@@ -818,7 +2359,12 @@ static int __exit nand_davinci_remove(struct platform_device *pdev)
 	struct davinci_nand_info *info = platform_get_drvdata(pdev);
 	int status;
 
-	if (mtd_has_partitions() && info->partitioned)
+	cancel_delayed_work_sync(&info->bbt_verify);
+
+	status = 0;
+	if (info->ileave)
+		nand_davinci_il_del(info);
+	else if (mtd_has_partitions() && info->partitioned)
 		status = del_mtd_partitions(&info->mtd);
 	else
 		status = del_mtd_device(&info->mtd);
@@ -828,11 +2374,20 @@ static int __exit nand_davinci_remove(struct platform_device *pdev)
 		ecc4_busy = false;
 	spin_unlock_irq(&davinci_nand_lock);
 
+	if (info->chip.ecc.correct == nand_davinci_correct_bch8)
+		nand_davinci_bch8_exit();
+
+	davinci_aemif_release_timing(info->base, info->core_chipsel);
 	iounmap(info->base);
 	iounmap(info->vaddr);
 
 	nand_release(&info->mtd);
 
+	if (info->dma_channel >= 0)
+		edma_free_channel(info->dma_channel);
+	if (info->irq)
+		free_irq(info->irq, info);
+
 	clk_disable(info->clk);
 	clk_put(info->clk);
 
@@ -612,7 +612,9 @@ static void nand_command_lp(struct mtd_info *mtd, unsigned int command,
 				column >>= 1;
 			chip->cmd_ctrl(mtd, column, ctrl);
 			ctrl &= ~NAND_CTRL_CHANGE;
-			chip->cmd_ctrl(mtd, column >> 8, ctrl);
+			/* ONFI parameter page takes a single address byte */
+			if (command != NAND_CMD_PARAM)
+				chip->cmd_ctrl(mtd, column >> 8, ctrl);
 		}
 		if (page_addr != -1) {
 			chip->cmd_ctrl(mtd, page_addr, ctrl);
@@ -637,6 +639,7 @@ static void nand_command_lp(struct mtd_info *mtd, unsigned int command,
 	case NAND_CMD_ERASE1:
 	case NAND_CMD_ERASE2:
 	case NAND_CMD_SEQIN:
+	case NAND_CMD_MULTI_SEQIN:
 	case NAND_CMD_RNDIN:
 	case NAND_CMD_STATUS:
 	case NAND_CMD_DEPLETE1:
@@ -1229,6 +1232,7 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	struct mtd_ecc_stats stats;
 	int blkcheck = (1 << (chip->phys_erase_shift - chip->page_shift)) - 1;
 	int sndcmd = 1;
+	int cachepages = 0;
 	int ret = 0;
 	uint32_t readlen = ops->len;
 	uint32_t oobreadlen = ops->ooblen;
@@ -1251,8 +1255,21 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 		bytes = min(mtd->writesize - col, readlen);
 		aligned = (bytes == mtd->writesize);
 
+		/*
+		 * Stream whole pages up to the end of the request or of the
+		 * eraseblock through the chip's cache register, so the next
+		 * page comes out of the array while this one is transferred.
+		 */
+		if (sndcmd && aligned && NAND_HAS_CACHEREAD(chip) &&
+		    (chip->options & NAND_PIPELINE_OPS)) {
+			cachepages = min_t(int, readlen >> chip->page_shift,
+					   blkcheck + 1 - (page & blkcheck));
+			if (cachepages < 2)
+				cachepages = 0;
+		}
+
 		/* Is the current page in the buffer ? */
-		if (realpage != chip->pagebuf || oob) {
+		if (realpage != chip->pagebuf || oob || cachepages) {
 			bufpoi = aligned ? buf : chip->buffers->databuf;
 
 			if (likely(sndcmd)) {
@@ -1260,6 +1277,12 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 				sndcmd = 0;
 			}
 
+			/* Move this page to the cache register */
+			if (cachepages)
+				chip->cmdfunc(mtd, --cachepages ?
+					      NAND_CMD_READCACHESEQ :
+					      NAND_CMD_READCACHEEND, -1, -1);
+
 			/* Now read the page into the buffer */
 			if (unlikely(ops->mode == MTD_OOB_RAW))
 				ret = chip->ecc.read_page_raw(mtd, chip,
@@ -1269,8 +1292,14 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 			else
 				ret = chip->ecc.read_page(mtd, chip, bufpoi,
 							  page);
-			if (ret < 0)
+			if (ret < 0) {
+				/* Leave cache read mode */
+				if (cachepages)
+					chip->cmdfunc(mtd,
+						      NAND_CMD_READCACHEEND,
+						      -1, -1);
 				break;
+			}
 
 			/* Transfer not aligned data */
 			if (!aligned) {
@@ -1333,9 +1362,11 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 		}
 
 		/* Check, if the chip supports auto page increment
-		 * or if we have hit a block boundary.
+		 * or if we have hit a block boundary.  A cache read
+		 * keeps going without new read commands.
 		 */
-		if (!NAND_CANAUTOINCR(chip) || !(page & blkcheck))
+		if (!cachepages &&
+		    (!NAND_CANAUTOINCR(chip) || !(page & blkcheck)))
 			sndcmd = 1;
 	}
 
@@ -1874,6 +1905,48 @@ static int nand_write_page(struct mtd_info *mtd, struct nand_chip *chip,
 	return 0;
 }
 
+/**
+ * nand_write_page_planes - [Internal] program one page in each of two planes
+ * @mtd:	MTD device structure
+ * @chip:	NAND chip descriptor
+ * @buf:	the data to write, a page for each plane one eraseblock apart
+ * @page:	page number to write in the even (first plane) eraseblock
+ *
+ * The first page is queued with MULTI_PAGEPROG, which only costs the
+ * short tDBSY busy time; both pages then program together.
+ */
+static int nand_write_page_planes(struct mtd_info *mtd, struct nand_chip *chip,
+				  const uint8_t *buf, int page)
+{
+	int pair = page + (1 << (chip->phys_erase_shift - chip->page_shift));
+	int status;
+
+	chip->cmdfunc(mtd, NAND_CMD_SEQIN, 0x00, page);
+	chip->ecc.write_page(mtd, chip, buf);
+	chip->cmdfunc(mtd, NAND_CMD_MULTI_PAGEPROG, -1, -1);
+
+	chip->cmdfunc(mtd, chip->plane_seqin, 0x00, pair);
+	chip->ecc.write_page(mtd, chip, buf + mtd->erasesize);
+	chip->cmdfunc(mtd, NAND_CMD_PAGEPROG, -1, -1);
+
+	status = chip->waitfunc(mtd, chip);
+	if ((status & NAND_STATUS_FAIL) && (chip->errstat))
+		status = chip->errstat(mtd, chip, FL_WRITING, status, page);
+	if (status & NAND_STATUS_FAIL)
+		return -EIO;
+
+#ifdef CONFIG_MTD_NAND_VERIFY_WRITE
+	chip->cmdfunc(mtd, NAND_CMD_READ0, 0, page);
+	if (chip->verify_buf(mtd, buf, mtd->writesize))
+		return -EIO;
+
+	chip->cmdfunc(mtd, NAND_CMD_READ0, 0, pair);
+	if (chip->verify_buf(mtd, buf + mtd->erasesize, mtd->writesize))
+		return -EIO;
+#endif
+	return 0;
+}
+
 /**
  * nand_fill_oob - [Internal] Transfer client buffer to oob
  * @chip:	nand chip structure
@@ -1925,6 +1998,27 @@ static uint8_t *nand_fill_oob(struct nand_chip *chip, uint8_t *oob,
 
 #define NOTALIGNED(x)	(x & (chip->subpagesize - 1)) != 0
 
+/*
+ * Whether nand_do_write_ops can program the next two eraseblocks as a
+ * two-plane pair: both whole and from the caller's buffer, starting at
+ * an even (first plane) block.
+ */
+static int nand_use_planes(struct mtd_info *mtd, struct nand_chip *chip,
+			   struct mtd_oob_ops *ops, int page, int column,
+			   uint32_t writelen)
+{
+	int blockshift = chip->phys_erase_shift - chip->page_shift;
+
+	if (!NAND_HAS_MULTIPLANE(chip) ||
+	    !(chip->options & NAND_PIPELINE_OPS) ||
+	    chip->write_page != nand_write_page ||
+	    ops->oobbuf || ops->mode == MTD_OOB_RAW)
+		return 0;
+
+	return !column && writelen >= 2 * mtd->erasesize &&
+		!(page & ((2 << blockshift) - 1));
+}
+
 /**
  * nand_do_write_ops - [Internal] NAND write with ECC
  * @mtd:	MTD device structure
@@ -1985,6 +2079,39 @@ static int nand_do_write_ops(struct mtd_info *mtd, loff_t to,
 		int cached = writelen > bytes && page != blockmask;
 		uint8_t *wbuf = buf;
 
+		/*
+		 * An even/odd pair of whole eraseblocks sits in both planes;
+		 * program the two blocks a page from each at a time.
+		 */
+		if (nand_use_planes(mtd, chip, ops, page, column, writelen)) {
+			int i;
+
+			for (i = 0; i <= blockmask; i++) {
+				ret = nand_write_page_planes(mtd, chip,
+						buf + i * mtd->writesize,
+						page + i);
+				if (ret)
+					break;
+			}
+			if (ret)
+				break;
+
+			bytes = 2 * mtd->erasesize;
+			writelen -= bytes;
+			if (!writelen)
+				break;
+
+			buf += bytes;
+			realpage += 2 * (blockmask + 1);
+			page = realpage & chip->pagemask;
+			if (!page) {
+				chipnr++;
+				chip->select_chip(mtd, -1);
+				chip->select_chip(mtd, chipnr);
+			}
+			continue;
+		}
+
 		/* Partial page write ? */
 		if (unlikely(column || writelen < (mtd->writesize - 1))) {
 			cached = 0;
@@ -2577,6 +2704,69 @@ static void nand_set_defaults(struct nand_chip *chip, int busw)
 
 }
 
+/*
+ * ONFI parameter page CRC: polynomial 0x8005, seeded with 0x4f4e and fed
+ * most significant bit first.
+ */
+static u16 nand_onfi_crc16(u16 crc, uint8_t byte)
+{
+	int i;
+
+	crc ^= byte << 8;
+	for (i = 0; i < 8; i++)
+		crc = (crc << 1) ^ ((crc & 0x8000) ? 0x8005 : 0);
+	return crc;
+}
+
+/*
+ * Pick up the optional read cache and multi-plane program commands from
+ * the ID bytes, or from the ONFI parameter page when the chip has one.
+ */
+static void nand_detect_pipeline_ops(struct mtd_info *mtd,
+				     struct nand_chip *chip, int maf_id)
+{
+	uint8_t optcmd = 0, features = 0, plane_bits = 0;
+	u16 crc = 0x4f4e, pcrc;
+	int i;
+
+	/* Samsung and Micron report simultaneously programmed pages */
+	if ((maf_id == NAND_MFR_SAMSUNG || maf_id == NAND_MFR_MICRON) &&
+	    (chip->cellinfo & NAND_CI_SIMULPROG_MSK))
+		chip->plane_seqin = maf_id == NAND_MFR_SAMSUNG ?
+			NAND_CMD_MULTI_SEQIN : NAND_CMD_SEQIN;
+
+	chip->cmdfunc(mtd, NAND_CMD_READID, 0x20, -1);
+	if (chip->read_byte(mtd) != 'O' || chip->read_byte(mtd) != 'N' ||
+	    chip->read_byte(mtd) != 'F' || chip->read_byte(mtd) != 'I')
+		return;
+
+	chip->cmdfunc(mtd, NAND_CMD_PARAM, 0, -1);
+	for (i = 0; i < 254; i++) {
+		uint8_t byte = chip->read_byte(mtd);
+
+		if (i == 6)
+			features = byte;
+		else if (i == 8)
+			optcmd = byte;
+		else if (i == 113)
+			plane_bits = byte;
+		crc = nand_onfi_crc16(crc, byte);
+	}
+	pcrc = chip->read_byte(mtd);
+	pcrc |= chip->read_byte(mtd) << 8;
+	if (pcrc != crc) {
+		printk(KERN_INFO "NAND device: bad ONFI parameter page CRC\n");
+		return;
+	}
+
+	/* Optional commands bit 1: read cache commands */
+	if (optcmd & 0x02)
+		chip->options |= NAND_CACHERD;
+	/* Features bit 3: interleaved (multi-plane) operations */
+	if ((features & 0x08) && plane_bits == 1 && !chip->plane_seqin)
+		chip->plane_seqin = NAND_CMD_SEQIN;
+}
+
 /*
  * Get the flash and manufacturer id and lookup if the type is supported
  */
@@ -2734,6 +2924,18 @@ static struct nand_flash_dev *nand_get_flash_type(struct mtd_info *mtd,
 	       " 0x%02x, Chip ID: 0x%02x (%s %s)\n", *maf_id, dev_id,
 	       nand_manuf_ids[maf_idx].name, type->name);
 
+	chip->plane_seqin = 0;
+	if ((chip->options & NAND_PIPELINE_OPS) && !type->pagesize) {
+		nand_detect_pipeline_ops(mtd, chip, *maf_id);
+		if (NAND_HAS_CACHEREAD(chip) || NAND_HAS_MULTIPLANE(chip))
+			printk(KERN_INFO "NAND device: %s%s%s\n",
+			       NAND_HAS_CACHEREAD(chip) ? "cache read" : "",
+			       NAND_HAS_CACHEREAD(chip) &&
+			       NAND_HAS_MULTIPLANE(chip) ? ", " : "",
+			       NAND_HAS_MULTIPLANE(chip) ?
+			       "two-plane program" : "");
+	}
+
 	return type;
 }
 
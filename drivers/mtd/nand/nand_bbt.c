@@ -248,6 +248,23 @@ static int scan_read_raw(struct mtd_info *mtd, uint8_t *buf, loff_t offs,
 	return mtd->read_oob(mtd, offs, &ops);
 }
 
+/*
+ * Scan read the oob area of one page from flash
+ */
+static int scan_read_oob(struct mtd_info *mtd, uint8_t *buf, loff_t offs)
+{
+	struct mtd_oob_ops ops;
+
+	ops.mode = MTD_OOB_PLACE;
+	ops.ooboffs = 0;
+	ops.ooblen = mtd->oobsize;
+	ops.oobbuf = buf;
+	ops.datbuf = NULL;
+	ops.len = 0;
+
+	return mtd->read_oob(mtd, offs, &ops);
+}
+
 /*
  * Scan write data with oob to flash
  */
@@ -497,6 +514,19 @@ static int search_bbt(struct mtd_info *mtd, uint8_t *buf, struct nand_bbt_descr
 			int actblock = startblock + dir * block;
 			loff_t offs = (loff_t)actblock << this->bbt_erase_shift;
 
+			/* The ident pattern and version live in the oob;
+			 * only an empty check needs the page data too. */
+			if (!(td->options & NAND_BBT_SCANEMPTY)) {
+				scan_read_oob(mtd, buf, offs);
+				if (!check_short_pattern(buf, td)) {
+					td->pages[i] = actblock << blocktopage;
+					if (td->options & NAND_BBT_VERSION)
+						td->version[i] = buf[td->veroffs];
+					break;
+				}
+				continue;
+			}
+
 			/* Read first page */
 			scan_read_raw(mtd, buf, offs, mtd->writesize);
 			if (!check_pattern(buf, scanlen, mtd->writesize, td)) {
@@ -1067,6 +1097,67 @@ int nand_update_bbt(struct mtd_info *mtd, loff_t offs)
 	return res;
 }
 
+/**
+ * nand_verify_bbt - [NAND Interface] check a flash bbt against the chip
+ * @mtd:	MTD device structure
+ *
+ * A bad block table read from flash lets nand_scan skip scanning every
+ * block.  This does that scan later, e.g. from a work queue once the
+ * system is up: every block the table calls good has its factory marker
+ * checked, and blocks found marked bad are added to the table(s) on
+ * flash.  Returns the number of blocks added, or a negative error.
+ */
+int nand_verify_bbt(struct mtd_info *mtd)
+{
+	struct nand_chip *this = mtd->priv;
+	struct nand_bbt_descr *bd = this->badblock_pattern;
+	int i, len, numblocks, ret, added = 0;
+	uint8_t *buf;
+	loff_t from;
+
+	if (!this->bbt || !bd)
+		return -EINVAL;
+
+	/* Scans needing page data too are too slow for this */
+	if (bd->options & (NAND_BBT_SCANALLPAGES | NAND_BBT_SCANEMPTY))
+		return 0;
+
+	buf = kmalloc(mtd->oobsize, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	len = (bd->options & NAND_BBT_SCAN2NDPAGE) ? 2 : 1;
+	numblocks = mtd->size >> this->bbt_erase_shift;
+
+	for (i = 0, from = 0; i < numblocks;
+	     i++, from += (1 << this->bbt_erase_shift)) {
+		/* Two bits per block; anything but 00 is bad or reserved */
+		if ((this->bbt[i >> 2] >> ((i & 0x03) << 1)) & 0x03)
+			continue;
+
+		ret = scan_block_fast(mtd, bd, from, buf, len);
+		if (ret < 0) {
+			kfree(buf);
+			return ret;
+		}
+		if (!ret)
+			continue;
+
+		printk(KERN_WARNING "nand_verify_bbt: Bad eraseblock %d at "
+		       "0x%012llx missing from bbt\n", i,
+		       (unsigned long long)from);
+		ret = mtd->block_markbad(mtd, from);
+		if (ret < 0) {
+			kfree(buf);
+			return ret;
+		}
+		added++;
+	}
+
+	kfree(buf);
+	return added;
+}
+
 /* Define some generic bad / good block scan pattern which are used
  * while scanning a device for factory marked good / bad blocks. */
 static uint8_t scan_ff_pattern[] = { 0xff, 0xff };
@@ -1216,3 +1307,4 @@ int nand_isbad_bbt(struct mtd_info *mtd, loff_t offs, int allowbbt)
 
 EXPORT_SYMBOL(nand_scan_bbt);
 EXPORT_SYMBOL(nand_default_bbt);
+EXPORT_SYMBOL(nand_verify_bbt);
@@ -0,0 +1,631 @@
+/*
+ * Copyright (C) 2010 Texas Instruments Incorporated
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; see the file COPYING. If not, write to the Free Software
+ * Foundation, 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ *
+ * Benchmark an MTD device or a UBI volume: sequential and random throughput
+ * and per-operation latency percentiles.
+ *
+ * Unlike mtd_speedtest, every operation is timed on its own, and each test
+ * ends with one "result" line of key=value pairs, so runs on different
+ * kernels can be compared by a script:
+ *
+ *   mtd_benchtest: result target=mtd0 test=read size=2048 ops=65536
+ *   kib_s=9210 p50_us=212 p90_us=215 p99_us=260 max_us=1302
+ *
+ * For an MTD device, "read" goes through the ECC path and "read_raw" reads
+ * the same pages with MTD_OOB_RAW, so the difference is the ECC cost.
+ * "subpage_write" is run when the device supports sub-page writes. The ECC
+ * mode itself is chosen when the NAND driver is probed, so compare ECC modes
+ * by reloading the driver and running the benchmark again.
+ *
+ * If ubi_num is given, the UBI volume ubi_num:vol_id is benchmarked instead
+ * (through the UBI kernel API, including the UBI headers and EBA overhead).
+ *
+ * Either way, the contents of the device or volume are destroyed.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/err.h>
+#include <linux/mtd/mtd.h>
+#include <linux/mtd/ubi.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+
+#define PRINT_PREF KERN_INFO "mtd_benchtest: "
+
+#if defined(CONFIG_MTD_UBI) || defined(CONFIG_MTD_UBI_MODULE)
+#define BENCH_UBI
+#endif
+
+static int dev;
+module_param(dev, int, S_IRUGO);
+MODULE_PARM_DESC(dev, "MTD device number to use");
+
+static int ubi_num = -1;
+module_param(ubi_num, int, S_IRUGO);
+MODULE_PARM_DESC(ubi_num, "UBI device number, benchmark a UBI volume "
+		 "instead of an MTD device");
+
+static int vol_id;
+module_param(vol_id, int, S_IRUGO);
+MODULE_PARM_DESC(vol_id, "UBI volume ID to use with ubi_num");
+
+static int count = 1024;
+module_param(count, int, S_IRUGO);
+MODULE_PARM_DESC(count, "Number of operations of the random tests");
+
+static int samples = 4096;
+module_param(samples, int, S_IRUGO);
+MODULE_PARM_DESC(samples, "Latencies kept per test for the percentiles "
+		 "(the most recent ones)");
+
+static struct mtd_info *mtd;
+#ifdef BENCH_UBI
+static struct ubi_volume_desc *ubi;
+#endif
+static unsigned char *iobuf;
+static unsigned char *bbt;
+static char target[16];
+
+static int pgsize;
+static int ebsize;
+static int ebcnt;
+static int pgcnt;
+static int goodebcnt;
+static unsigned long next = 1;
+
+/* One test in progress */
+static struct {
+	const char *name;
+	unsigned int size;
+	unsigned int ops;
+	ktime_t start;
+	u32 *lat;
+	u32 max;
+} bench;
+
+static inline unsigned int simple_rand(void)
+{
+	next = next * 1103515245 + 12345;
+	return (unsigned int)((next / 65536) % 32768);
+}
+
+static inline void simple_srand(unsigned long seed)
+{
+	next = seed;
+}
+
+static void set_random_data(unsigned char *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i)
+		buf[i] = simple_rand();
+}
+
+/* A random number in [0, n), for n up to 2^30 */
+static unsigned int rand_below(unsigned int n)
+{
+	return ((simple_rand() << 15) | simple_rand()) % n;
+}
+
+static void bench_start(const char *name, unsigned int size)
+{
+	printk(PRINT_PREF "testing %s, %u bytes per operation\n", name, size);
+	bench.name = name;
+	bench.size = size;
+	bench.ops = 0;
+	bench.max = 0;
+	bench.start = ktime_get();
+}
+
+/* Account one operation which was started at @t0 */
+static void bench_op(ktime_t t0)
+{
+	u32 us = ktime_to_us(ktime_sub(ktime_get(), t0));
+
+	bench.lat[bench.ops % samples] = us;
+	if (us > bench.max)
+		bench.max = us;
+	bench.ops += 1;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u32 percentile(int n, int pct)
+{
+	return bench.lat[(n - 1) * pct / 100];
+}
+
+static void bench_end(void)
+{
+	s64 us = ktime_to_us(ktime_sub(ktime_get(), bench.start));
+	u64 kib = (u64)bench.ops * bench.size;
+	int n = min_t(unsigned int, bench.ops, samples);
+
+	if (!n)
+		return;
+
+	kib *= 1000000;
+	do_div(kib, 1024);
+	if (us > 0)
+		do_div(kib, us);
+
+	sort(bench.lat, n, sizeof(u32), cmp_u32, NULL);
+	printk(PRINT_PREF "result target=%s test=%s size=%u ops=%u "
+	       "kib_s=%llu p50_us=%u p90_us=%u p99_us=%u max_us=%u\n",
+	       target, bench.name, bench.size, bench.ops,
+	       (unsigned long long)kib, percentile(n, 50), percentile(n, 90),
+	       percentile(n, 99), bench.max);
+}
+
+/*
+ * MTD device
+ */
+
+static int erase_eraseblock(int ebnum)
+{
+	int err;
+	struct erase_info ei;
+	loff_t addr = ebnum * mtd->erasesize;
+
+	memset(&ei, 0, sizeof(struct erase_info));
+	ei.mtd  = mtd;
+	ei.addr = addr;
+	ei.len  = mtd->erasesize;
+
+	err = mtd->erase(mtd, &ei);
+	if (err) {
+		printk(PRINT_PREF "error %d while erasing EB %d\n", err, ebnum);
+		return err;
+	}
+
+	if (ei.state == MTD_ERASE_FAILED) {
+		printk(PRINT_PREF "some erase error occurred at EB %d\n",
+		       ebnum);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int erase_whole_device(int timed)
+{
+	int err;
+	unsigned int i;
+
+	if (timed)
+		bench_start("erase", mtd->erasesize);
+	for (i = 0; i < ebcnt; ++i) {
+		ktime_t t0 = ktime_get();
+
+		if (bbt[i])
+			continue;
+		err = erase_eraseblock(i);
+		if (err)
+			return err;
+		if (timed)
+			bench_op(t0);
+		cond_resched();
+	}
+	if (timed)
+		bench_end();
+	return 0;
+}
+
+static int write_chunk(loff_t addr, size_t len, void *buf)
+{
+	size_t written = 0;
+	int err;
+
+	err = mtd->write(mtd, addr, len, &written, buf);
+	if (err || written != len) {
+		printk(PRINT_PREF "error: write failed at %#llx\n", addr);
+		if (!err)
+			err = -EINVAL;
+	}
+	return err;
+}
+
+static int read_chunk(loff_t addr, size_t len, void *buf, int raw)
+{
+	size_t read = 0;
+	int err;
+
+	if (raw) {
+		struct mtd_oob_ops ops;
+
+		memset(&ops, 0, sizeof(ops));
+		ops.mode = MTD_OOB_RAW;
+		ops.len = len;
+		ops.datbuf = buf;
+		err = mtd->read_oob(mtd, addr, &ops);
+		read = ops.retlen;
+	} else
+		err = mtd->read(mtd, addr, len, &read, buf);
+
+	/* Ignore corrected ECC errors */
+	if (err == -EUCLEAN)
+		err = 0;
+	if (err || read != len) {
+		printk(PRINT_PREF "error: read failed at %#llx\n", addr);
+		if (!err)
+			err = -EINVAL;
+	}
+	return err;
+}
+
+/* Write (or read) every good eraseblock sequentially, @len bytes at a time */
+static int seq_test(const char *name, int len, int write, int raw)
+{
+	int i, err;
+	loff_t addr;
+
+	bench_start(name, len);
+	for (i = 0; i < ebcnt; ++i) {
+		if (bbt[i])
+			continue;
+		for (addr = 0; addr < mtd->erasesize; addr += len) {
+			loff_t ofs = (loff_t)i * mtd->erasesize + addr;
+			ktime_t t0 = ktime_get();
+
+			if (write)
+				err = write_chunk(ofs, len, iobuf + addr);
+			else
+				err = read_chunk(ofs, len, iobuf + addr, raw);
+			if (err)
+				return err;
+			bench_op(t0);
+		}
+		cond_resched();
+	}
+	bench_end();
+	return 0;
+}
+
+static int random_read_test(void)
+{
+	int i, err;
+
+	bench_start("randread", pgsize);
+	for (i = 0; i < count; i++) {
+		int eb, pg;
+		ktime_t t0;
+
+		do {
+			eb = rand_below(ebcnt);
+		} while (bbt[eb]);
+		pg = rand_below(pgcnt);
+
+		t0 = ktime_get();
+		err = read_chunk((loff_t)eb * mtd->erasesize + pg * pgsize,
+				 pgsize, iobuf, 0);
+		if (err)
+			return err;
+		bench_op(t0);
+		cond_resched();
+	}
+	bench_end();
+	return 0;
+}
+
+static int scan_for_bad_eraseblocks(void)
+{
+	int i, bad = 0;
+
+	bbt = kzalloc(ebcnt, GFP_KERNEL);
+	if (!bbt) {
+		printk(PRINT_PREF "error: cannot allocate memory\n");
+		return -ENOMEM;
+	}
+
+	if (!mtd->block_isbad) {
+		goodebcnt = ebcnt;
+		return 0;
+	}
+
+	printk(PRINT_PREF "scanning for bad eraseblocks\n");
+	for (i = 0; i < ebcnt; ++i) {
+		bbt[i] = mtd->block_isbad(mtd, (loff_t)i * mtd->erasesize) ?
+			 1 : 0;
+		if (bbt[i])
+			bad += 1;
+		cond_resched();
+	}
+	printk(PRINT_PREF "scanned %d eraseblocks, %d are bad\n", i, bad);
+	goodebcnt = ebcnt - bad;
+	return 0;
+}
+
+static int mtd_bench(void)
+{
+	int err, subpgsize;
+	uint64_t tmp;
+
+	mtd = get_mtd_device(NULL, dev);
+	if (IS_ERR(mtd)) {
+		err = PTR_ERR(mtd);
+		printk(PRINT_PREF "error: cannot get MTD device\n");
+		return err;
+	}
+
+	if (mtd->writesize == 1) {
+		printk(PRINT_PREF "not NAND flash, assume page size is 512 "
+		       "bytes.\n");
+		pgsize = 512;
+	} else
+		pgsize = mtd->writesize;
+
+	tmp = mtd->size;
+	do_div(tmp, mtd->erasesize);
+	ebcnt = tmp;
+	ebsize = mtd->erasesize;
+	pgcnt = mtd->erasesize / pgsize;
+	subpgsize = mtd->writesize >> mtd->subpage_sft;
+	snprintf(target, sizeof(target), "mtd%d", dev);
+
+	printk(PRINT_PREF "result target=%s test=info type=%d size=%llu "
+	       "erasesize=%u writesize=%u subpagesize=%d oobsize=%u "
+	       "eccbytes=%u\n", target, mtd->type,
+	       (unsigned long long)mtd->size, mtd->erasesize, mtd->writesize,
+	       subpgsize, mtd->oobsize,
+	       mtd->ecclayout ? mtd->ecclayout->eccbytes : 0);
+
+	err = -ENOMEM;
+	iobuf = kmalloc(ebsize, GFP_KERNEL);
+	if (!iobuf) {
+		printk(PRINT_PREF "error: cannot allocate memory\n");
+		goto out;
+	}
+	set_random_data(iobuf, ebsize);
+
+	err = scan_for_bad_eraseblocks();
+	if (err || !goodebcnt)
+		goto out;
+
+	err = erase_whole_device(1);
+	if (err)
+		goto out;
+
+	err = seq_test("write", pgsize, 1, 0);
+	if (err)
+		goto out;
+
+	err = seq_test("read", pgsize, 0, 0);
+	if (err)
+		goto out;
+
+	if (mtd->read_oob && mtd->writesize > 1) {
+		err = seq_test("read_raw", pgsize, 0, 1);
+		if (err)
+			goto out;
+	}
+
+	err = random_read_test();
+	if (err)
+		goto out;
+
+	if (mtd->subpage_sft) {
+		err = erase_whole_device(0);
+		if (err)
+			goto out;
+		err = seq_test("subpage_write", subpgsize, 1, 0);
+		if (err)
+			goto out;
+	}
+
+	err = erase_whole_device(0);
+out:
+	kfree(iobuf);
+	kfree(bbt);
+	put_mtd_device(mtd);
+	return err;
+}
+
+/*
+ * UBI volume
+ */
+
+#ifdef BENCH_UBI
+static int ubi_seq_test(const char *name, int write)
+{
+	int lnum, offs, err;
+
+	bench_start(name, pgsize);
+	for (lnum = 0; lnum < ebcnt; lnum++) {
+		if (write) {
+			err = ubi_leb_unmap(ubi, lnum);
+			if (err)
+				return err;
+		}
+		for (offs = 0; offs + pgsize <= ebsize; offs += pgsize) {
+			ktime_t t0 = ktime_get();
+
+			if (write)
+				err = ubi_leb_write(ubi, lnum, iobuf + offs,
+						    offs, pgsize, UBI_UNKNOWN);
+			else
+				err = ubi_leb_read(ubi, lnum, iobuf + offs,
+						   offs, pgsize, 0);
+			if (err) {
+				printk(PRINT_PREF "error %d: LEB %d:%d\n",
+				       err, lnum, offs);
+				return err;
+			}
+			bench_op(t0);
+		}
+		cond_resched();
+	}
+	bench_end();
+	return 0;
+}
+
+static int ubi_random_read_test(void)
+{
+	int i, err;
+
+	bench_start("randread", pgsize);
+	for (i = 0; i < count; i++) {
+		int lnum = rand_below(ebcnt);
+		int offs = rand_below(ebsize / pgsize) * pgsize;
+		ktime_t t0 = ktime_get();
+
+		err = ubi_leb_read(ubi, lnum, iobuf, offs, pgsize, 0);
+		if (err) {
+			printk(PRINT_PREF "error %d: LEB %d:%d\n",
+			       err, lnum, offs);
+			return err;
+		}
+		bench_op(t0);
+		cond_resched();
+	}
+	bench_end();
+	return 0;
+}
+
+static int ubi_unmap_test(void)
+{
+	int lnum, err;
+
+	bench_start("unmap", ebsize);
+	for (lnum = 0; lnum < ebcnt; lnum++) {
+		ktime_t t0 = ktime_get();
+
+		err = ubi_leb_unmap(ubi, lnum);
+		if (err)
+			return err;
+		bench_op(t0);
+	}
+	bench_end();
+	return ubi_sync(ubi_num);
+}
+
+static int ubi_bench(void)
+{
+	struct ubi_device_info di;
+	struct ubi_volume_info vi;
+	int err;
+
+	err = ubi_get_device_info(ubi_num, &di);
+	if (err) {
+		printk(PRINT_PREF "error: cannot get UBI device %d\n",
+		       ubi_num);
+		return err;
+	}
+
+	ubi = ubi_open_volume(ubi_num, vol_id, UBI_EXCLUSIVE);
+	if (IS_ERR(ubi)) {
+		printk(PRINT_PREF "error: cannot open UBI volume %d:%d\n",
+		       ubi_num, vol_id);
+		return PTR_ERR(ubi);
+	}
+	ubi_get_volume_info(ubi, &vi);
+
+	ebcnt = vi.size;
+	ebsize = vi.usable_leb_size;
+	pgsize = di.min_io_size;
+	snprintf(target, sizeof(target), "ubi%d_%d", ubi_num, vol_id);
+
+	printk(PRINT_PREF "result target=%s test=info lebs=%d lebsize=%d "
+	       "miniosize=%d\n", target, ebcnt, ebsize, pgsize);
+
+	err = -ENOMEM;
+	iobuf = vmalloc(ebsize);
+	if (!iobuf) {
+		printk(PRINT_PREF "error: cannot allocate memory\n");
+		goto out;
+	}
+	set_random_data(iobuf, ebsize);
+
+	err = ubi_seq_test("write", 1);
+	if (err)
+		goto out;
+
+	err = ubi_seq_test("read", 0);
+	if (err)
+		goto out;
+
+	err = ubi_random_read_test();
+	if (err)
+		goto out;
+
+	err = ubi_unmap_test();
+out:
+	vfree(iobuf);
+	ubi_close_volume(ubi);
+	return err;
+}
+#else
+static int ubi_bench(void)
+{
+	printk(PRINT_PREF "error: UBI support is not enabled\n");
+	return -ENODEV;
+}
+#endif
+
+static int __init mtd_benchtest_init(void)
+{
+	int err;
+
+	printk(KERN_INFO "\n");
+	printk(KERN_INFO "=================================================\n");
+
+	if (count <= 0 || samples <= 0) {
+		printk(PRINT_PREF "error: bad count or samples\n");
+		return -EINVAL;
+	}
+
+	bench.lat = vmalloc(samples * sizeof(u32));
+	if (!bench.lat) {
+		printk(PRINT_PREF "error: cannot allocate memory\n");
+		return -ENOMEM;
+	}
+
+	simple_srand(1);
+	if (ubi_num >= 0) {
+		printk(PRINT_PREF "UBI volume: %d:%d\n", ubi_num, vol_id);
+		err = ubi_bench();
+	} else {
+		printk(PRINT_PREF "MTD device: %d\n", dev);
+		err = mtd_bench();
+	}
+
+	vfree(bench.lat);
+	if (err)
+		printk(PRINT_PREF "error %d occurred\n", err);
+	else
+		printk(PRINT_PREF "finished\n");
+	printk(KERN_INFO "=================================================\n");
+	return err;
+}
+module_init(mtd_benchtest_init);
+
+static void __exit mtd_benchtest_exit(void)
+{
+	return;
+}
+module_exit(mtd_benchtest_exit);
+
+MODULE_DESCRIPTION("MTD and UBI benchmark module");
+MODULE_LICENSE("GPL");
@@ -123,6 +123,18 @@ static struct device_attribute dev_bgt_enabled =
 static struct device_attribute dev_mtd_num =
 	__ATTR(mtd_num, S_IRUGO, dev_attribute_show, NULL);
 
+static ssize_t dev_attribute_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count);
+
+/* Tunables of the WL sub-system in '/<sysfs>/class/ubi/ubiX/' */
+static struct device_attribute dev_free_watermark =
+	__ATTR(free_watermark, S_IRUGO | S_IWUSR, dev_attribute_show,
+	       dev_attribute_store);
+static struct device_attribute dev_wl_rate =
+	__ATTR(wl_rate, S_IRUGO | S_IWUSR, dev_attribute_show,
+	       dev_attribute_store);
+
 /**
  * ubi_volume_notify - send a volume change notification.
  * @ubi: UBI device description object
@@ -346,8 +358,42 @@ static ssize_t dev_attribute_show(struct device *dev,
 		ret = sprintf(buf, "%d\n", ubi->thread_enabled);
 	else if (attr == &dev_mtd_num)
 		ret = sprintf(buf, "%d\n", ubi->mtd->index);
+	else if (attr == &dev_free_watermark)
+		ret = sprintf(buf, "%d\n", ubi->free_watermark);
+	else if (attr == &dev_wl_rate)
+		ret = sprintf(buf, "%d\n", ubi->wl_rate);
+	else
+		ret = -EINVAL;
+
+	ubi_put_device(ubi);
+	return ret;
+}
+
+/* "Store" method for files in '/<sysfs>/class/ubi/ubiX/' */
+static ssize_t dev_attribute_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	ssize_t ret = count;
+	unsigned long val;
+	struct ubi_device *ubi;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+
+	ubi = container_of(dev, struct ubi_device, dev);
+	ubi = ubi_get_device(ubi->ubi_num);
+	if (!ubi)
+		return -ENODEV;
+
+	spin_lock(&ubi->wl_lock);
+	if (attr == &dev_free_watermark && val <= ubi->peb_count)
+		ubi->free_watermark = val;
+	else if (attr == &dev_wl_rate && val <= INT_MAX)
+		ubi->wl_rate = val;
 	else
 		ret = -EINVAL;
+	spin_unlock(&ubi->wl_lock);
 
 	ubi_put_device(ubi);
 	return ret;
@@ -410,6 +456,12 @@ static int ubi_sysfs_init(struct ubi_device *ubi)
 	if (err)
 		return err;
 	err = device_create_file(&ubi->dev, &dev_mtd_num);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_free_watermark);
+	if (err)
+		return err;
+	err = device_create_file(&ubi->dev, &dev_wl_rate);
 	return err;
 }
 
@@ -419,6 +471,8 @@ static int ubi_sysfs_init(struct ubi_device *ubi)
  */
 static void ubi_sysfs_close(struct ubi_device *ubi)
 {
+	device_remove_file(&ubi->dev, &dev_wl_rate);
+	device_remove_file(&ubi->dev, &dev_free_watermark);
 	device_remove_file(&ubi->dev, &dev_mtd_num);
 	device_remove_file(&ubi->dev, &dev_bgt_enabled);
 	device_remove_file(&ubi->dev, &dev_min_io_size);
@@ -599,6 +653,7 @@ static int attach_by_scanning(struct ubi_device *ubi)
 	if (err)
 		goto out_wl;
 
+	ubi_ckpt_reserve(ubi);
 	ubi_scan_destroy_si(si);
 	return 0;
 
@@ -853,6 +908,7 @@ static int ubi_reboot_notifier(struct notifier_block *n, unsigned long state,
 	ubi = container_of(n, struct ubi_device, reboot_notifier);
 	if (ubi->bgt_thread)
 		kthread_stop(ubi->bgt_thread);
+	ubi_ckpt_update(ubi, 1);
 	ubi_sync(ubi->ubi_num);
 	return NOTIFY_DONE;
 }
@@ -947,6 +1003,10 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num, int vid_hdr_offset)
 	if (err)
 		goto out_free;
 
+	err = ubi_ckpt_init(ubi);
+	if (err)
+		goto out_free;
+
 	err = -ENOMEM;
 	ubi->peb_buf1 = vmalloc(ubi->peb_size);
 	if (!ubi->peb_buf1)
@@ -1028,12 +1088,14 @@ out_uif:
 out_nofree:
 	do_free = 0;
 out_detach:
+	ubi_ckpt_close(ubi);
 	ubi_wl_close(ubi);
 	if (do_free)
 		free_user_volumes(ubi);
 	free_internal_volumes(ubi);
 	vfree(ubi->vtbl);
 out_free:
+	ubi_ckpt_close(ubi);
 	vfree(ubi->peb_buf1);
 	vfree(ubi->peb_buf2);
 #ifdef CONFIG_MTD_UBI_DEBUG_PARANOID
@@ -1094,6 +1156,10 @@ int ubi_detach_mtd_dev(int ubi_num, int anyway)
 	if (ubi->bgt_thread)
 		kthread_stop(ubi->bgt_thread);
 
+	/* Leave a fresh checkpoint behind to speed up the next attach */
+	ubi_ckpt_update(ubi, 1);
+	ubi_ckpt_close(ubi);
+
 	/*
 	 * Get a reference to the device in order to prevent 'dev_release()'
 	 * from freeing @ubi object.
@@ -0,0 +1,656 @@
+/*
+ * Copyright (c) International Business Machines Corp., 2006
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See
+ * the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * UBI checkpoint sub-system.
+ *
+ * Attaching by scanning reads the EC and VID headers of every PEB, which on
+ * large NAND flashes takes most of the boot time. This sub-system
+ * periodically stores a checkpoint of the in-RAM state: the erase counter of
+ * each PEB, the LEB each used PEB is mapped to, and which PEBs are free or
+ * waiting for erasure. The checkpoint is written to a single LEB of the
+ * checkpoint internal volume, which always lives in one of the first
+ * %UBI_CKPT_MAX_START PEBs, so it is found by probing only those.
+ *
+ * When attaching, the PEBs the checkpoint recorded as used or as waiting for
+ * erasure are taken from the checkpoint, and only the rest - free PEBs, which
+ * may have been written since, and PEBs in transitional states - are
+ * scanned. LEBs written after the checkpoint therefore always come from
+ * scanned PEBs. They carry real sequence numbers and win over the mapping
+ * recorded in the checkpoint, which is given sequence number zero.
+ *
+ * This is correct as long as no PEB the checkpoint trusts has changed, so
+ * the checkpoint has to be invalidated before:
+ *  o a PEB the checkpoint records as used is erased (or marked bad);
+ *  o a PEB the checkpoint records as used or waiting for erasure is handed
+ *    out for writing.
+ * Invalidation appends a small stale record to the checkpoint LEB. Only these
+ * two events invalidate the checkpoint: writing to free PEBs and erasing PEBs
+ * which were written after the checkpoint do not, so in a typical workload
+ * the checkpoint stays valid for a long time. A stale checkpoint is re-written
+ * from a delayed work after %CONFIG_MTD_UBI_CHECKPOINT_INTERVAL seconds, and
+ * always when the device is detached or the system reboots.
+ *
+ * The checkpoint has to describe every PEB in one LEB, so it is not used on
+ * devices with too many PEBs for that (about 8000 PEBs with 128KiB
+ * eraseblocks).
+ */
+
+#include <linux/crc32.h>
+#include <linux/err.h>
+#include "ubi.h"
+
+/*
+ * Number of PEBs reserved for the checkpoint: one for the checkpoint itself
+ * and one for the checkpoint which replaces it.
+ */
+#define CKPT_RESERVED_PEBS 2
+
+/* How often a stale checkpoint is re-written */
+#define CKPT_INTERVAL (CONFIG_MTD_UBI_CHECKPOINT_INTERVAL * HZ)
+
+/**
+ * ckpt_max_len - maximum checkpoint size.
+ * @ubi: UBI device description object
+ *
+ * Returns the size of the checkpoint of a device with the maximum number of
+ * volumes, aligned to the minimal I/O unit.
+ */
+static int ckpt_max_len(const struct ubi_device *ubi)
+{
+	int len;
+
+	len = sizeof(struct ubi_ckpt_hdr);
+	len += (UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT) *
+	       sizeof(struct ubi_ckpt_vol);
+	len += ubi->peb_count * sizeof(struct ubi_ckpt_peb);
+	return ALIGN(len, ubi->min_io_size);
+}
+
+/* Size of the stale record aligned to the minimal I/O unit */
+static int stale_len(const struct ubi_device *ubi)
+{
+	return ALIGN(sizeof(__be32), ubi->min_io_size);
+}
+
+/**
+ * ckpt_worker - re-write a stale checkpoint.
+ * @work: the work object
+ */
+static void ckpt_worker(struct work_struct *work)
+{
+	struct ubi_device *ubi = container_of(work, struct ubi_device,
+					      ckpt_work.work);
+
+	int err;
+
+	err = ubi_ckpt_update(ubi, 0);
+	if (err && err != -EROFS)
+		schedule_delayed_work(&ubi->ckpt_work, CKPT_INTERVAL);
+}
+
+/**
+ * ubi_ckpt_init - initialize the checkpoint sub-system.
+ * @ubi: UBI device description object
+ *
+ * This function has to be called after the I/O sub-system was initialized
+ * and before the device is scanned. Returns zero in case of success and
+ * %-ENOMEM in case of failure. If the checkpoint of this device would not fit
+ * one LEB, checkpoints are just disabled.
+ */
+int ubi_ckpt_init(struct ubi_device *ubi)
+{
+	mutex_init(&ubi->ckpt_mutex);
+	init_rwsem(&ubi->ckpt_eba_sem);
+	INIT_DELAYED_WORK(&ubi->ckpt_work, ckpt_worker);
+	ubi->ckpt_pnum = -1;
+	ubi->ckpt_valid = 0;
+
+	if (ckpt_max_len(ubi) + stale_len(ubi) > ubi->leb_size) {
+		ubi_msg("too many PEBs (%d) for a checkpoint, disable",
+			ubi->peb_count);
+		ubi->ckpt_disabled = 1;
+		return 0;
+	}
+
+	ubi->ckpt_state = kzalloc(ubi->peb_count, GFP_KERNEL);
+	if (!ubi->ckpt_state)
+		return -ENOMEM;
+
+	ubi->ckpt_buf = vmalloc(ubi->leb_size);
+	if (!ubi->ckpt_buf) {
+		kfree(ubi->ckpt_state);
+		ubi->ckpt_state = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/**
+ * ubi_ckpt_close - close the checkpoint sub-system.
+ * @ubi: UBI device description object
+ *
+ * This function does not write the checkpoint, use 'ubi_ckpt_update()' for
+ * this before the device goes away.
+ */
+void ubi_ckpt_close(struct ubi_device *ubi)
+{
+	if (!ubi->ckpt_state)
+		return;
+
+	cancel_delayed_work_sync(&ubi->ckpt_work);
+	vfree(ubi->ckpt_buf);
+	kfree(ubi->ckpt_state);
+	ubi->ckpt_buf = NULL;
+	ubi->ckpt_state = NULL;
+}
+
+/**
+ * ubi_ckpt_reserve - reserve PEBs for checkpoints.
+ * @ubi: UBI device description object
+ *
+ * This function is called when the other sub-systems have made their
+ * reservations. If there are not enough available PEBs, checkpoints are
+ * disabled, the device is still attached. The first checkpoint is scheduled
+ * unless the device was attached by a valid one.
+ */
+void ubi_ckpt_reserve(struct ubi_device *ubi)
+{
+	if (ubi->ckpt_disabled)
+		return;
+
+	spin_lock(&ubi->volumes_lock);
+	if (ubi->avail_pebs < CKPT_RESERVED_PEBS) {
+		spin_unlock(&ubi->volumes_lock);
+		ubi_warn("not enough available PEBs for checkpoints (%d, need "
+			 "%d), disable", ubi->avail_pebs, CKPT_RESERVED_PEBS);
+		ubi->ckpt_disabled = 1;
+		return;
+	}
+	ubi->avail_pebs -= CKPT_RESERVED_PEBS;
+	ubi->rsvd_pebs += CKPT_RESERVED_PEBS;
+	spin_unlock(&ubi->volumes_lock);
+
+	if (!ubi->ckpt_valid)
+		schedule_delayed_work(&ubi->ckpt_work, CKPT_INTERVAL);
+}
+
+/**
+ * check_ckpt - validate a checkpoint.
+ * @ubi: UBI device description object
+ * @pnum: the PEB the checkpoint was read from
+ * @hdr: the checkpoint, read up to the stale record inclusive
+ *
+ * This function returns zero if the checkpoint is valid and matches the
+ * device, %1 if it is corrupted or does not match the device, and %2 if it is
+ * intact but stale.
+ */
+static int check_ckpt(const struct ubi_device *ubi, int pnum,
+		      const struct ubi_ckpt_hdr *hdr)
+{
+	int data_len, vol_count, len;
+	uint32_t crc;
+	const uint8_t *stale;
+
+	if (be32_to_cpu(hdr->magic) != UBI_CKPT_HDR_MAGIC ||
+	    hdr->version != UBI_CKPT_VERSION) {
+		dbg_bld("bad checkpoint magic or version in PEB %d", pnum);
+		return 1;
+	}
+
+	crc = crc32(UBI_CRC32_INIT, hdr, UBI_CKPT_HDR_SIZE_CRC);
+	if (crc != be32_to_cpu(hdr->hdr_crc)) {
+		dbg_bld("bad checkpoint header CRC in PEB %d", pnum);
+		return 1;
+	}
+
+	vol_count = be32_to_cpu(hdr->vol_count);
+	data_len = be32_to_cpu(hdr->data_len);
+	if (be32_to_cpu(hdr->peb_count) != ubi->peb_count ||
+	    be32_to_cpu(hdr->vid_hdr_offset) != ubi->vid_hdr_offset ||
+	    be32_to_cpu(hdr->leb_start) != ubi->leb_start ||
+	    vol_count > UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT ||
+	    data_len != vol_count * sizeof(struct ubi_ckpt_vol) +
+			ubi->peb_count * sizeof(struct ubi_ckpt_peb)) {
+		ubi_warn("checkpoint in PEB %d does not match the device",
+			 pnum);
+		return 1;
+	}
+
+	if (ubi->image_seq && hdr->image_seq &&
+	    be32_to_cpu(hdr->image_seq) != ubi->image_seq) {
+		ubi_warn("checkpoint in PEB %d has image sequence number %d, "
+			 "expected %d", pnum, be32_to_cpu(hdr->image_seq),
+			 ubi->image_seq);
+		return 1;
+	}
+
+	crc = crc32(UBI_CRC32_INIT, hdr + 1, data_len);
+	if (crc != be32_to_cpu(hdr->data_crc)) {
+		dbg_bld("bad checkpoint data CRC in PEB %d", pnum);
+		return 1;
+	}
+
+	/* Anything but 0xFF bytes in place of the stale record means stale */
+	len = ALIGN(sizeof(struct ubi_ckpt_hdr) + data_len, ubi->min_io_size);
+	stale = (const uint8_t *)hdr + len;
+	if (stale[0] != 0xFF || stale[1] != 0xFF || stale[2] != 0xFF ||
+	    stale[3] != 0xFF) {
+		dbg_bld("checkpoint in PEB %d is stale", pnum);
+		return 2;
+	}
+
+	return 0;
+}
+
+/**
+ * struct ckpt_cand - a checkpoint candidate found when probing.
+ * @pnum: the PEB
+ * @sqnum: sequence number of its VID header
+ */
+struct ckpt_cand {
+	int pnum;
+	unsigned long long sqnum;
+};
+
+/**
+ * ubi_ckpt_read - find and read the newest valid checkpoint.
+ * @ubi: UBI device description object
+ * @ckpt_pnum: the PEB the checkpoint was found in is returned here
+ *
+ * This function probes the first %UBI_CKPT_MAX_START PEBs for checkpoint
+ * LEBs and reads the one with the highest sequence number which is intact.
+ * An older checkpoint is only used if the newer ones were not completely
+ * written, and none is used if the newest intact one is stale. Returns the
+ * checkpoint, which stays in @ubi->ckpt_buf until the next
+ * 'ubi_ckpt_update()', or %NULL if no usable checkpoint was found. Read
+ * errors are not fatal, they just make UBI fall back to full scanning.
+ */
+const struct ubi_ckpt_hdr *ubi_ckpt_read(struct ubi_device *ubi,
+					 int *ckpt_pnum)
+{
+	int err, pnum, i, found = 0, data_len;
+	int probe = min_t(int, ubi->peb_count, UBI_CKPT_MAX_START);
+	unsigned long long sqnum;
+	struct ckpt_cand *cands;
+	struct ubi_vid_hdr *vid_hdr;
+	struct ubi_ckpt_hdr *hdr = ubi->ckpt_buf;
+
+	if (ubi->ckpt_disabled)
+		return NULL;
+
+	cands = kmalloc(probe * sizeof(struct ckpt_cand), GFP_KERNEL);
+	if (!cands)
+		return NULL;
+
+	vid_hdr = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	if (!vid_hdr) {
+		kfree(cands);
+		return NULL;
+	}
+
+	for (pnum = 0; pnum < probe; pnum++) {
+		err = ubi_io_is_bad(ubi, pnum);
+		if (err)
+			continue;
+
+		err = ubi_io_read_vid_hdr(ubi, pnum, vid_hdr, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			continue;
+		if (be32_to_cpu(vid_hdr->vol_id) != UBI_CKPT_VOLUME_ID)
+			continue;
+
+		/* Keep the candidates sorted by descending sequence number */
+		sqnum = be64_to_cpu(vid_hdr->sqnum);
+		for (i = found; i > 0 && cands[i - 1].sqnum < sqnum; i--)
+			cands[i] = cands[i - 1];
+		cands[i].pnum = pnum;
+		cands[i].sqnum = sqnum;
+		found += 1;
+	}
+	ubi_free_vid_hdr(ubi, vid_hdr);
+
+	for (i = 0; i < found; i++) {
+		pnum = cands[i].pnum;
+
+		err = ubi_io_read_data(ubi, hdr, pnum, 0,
+				       ALIGN(sizeof(struct ubi_ckpt_hdr),
+					     ubi->min_io_size));
+		if (err && err != UBI_IO_BITFLIPS)
+			continue;
+		if (be32_to_cpu(hdr->magic) != UBI_CKPT_HDR_MAGIC)
+			continue;
+
+		data_len = be32_to_cpu(hdr->data_len);
+		if (data_len < 0 ||
+		    data_len > ckpt_max_len(ubi) - sizeof(struct ubi_ckpt_hdr))
+			continue;
+
+		err = ubi_io_read_data(ubi, hdr, pnum, 0,
+				       ALIGN(sizeof(struct ubi_ckpt_hdr) +
+					     data_len, ubi->min_io_size) +
+				       stale_len(ubi));
+		if (err && err != UBI_IO_BITFLIPS)
+			continue;
+
+		err = check_ckpt(ubi, pnum, hdr);
+		if (err == 1)
+			continue;
+		if (err)
+			break;
+
+		dbg_bld("checkpoint found in PEB %d, sqnum %llu", pnum,
+			cands[i].sqnum);
+		*ckpt_pnum = pnum;
+		kfree(cands);
+		return hdr;
+	}
+
+	kfree(cands);
+	return NULL;
+}
+
+/**
+ * ubi_ckpt_attached - note that the device was attached by a checkpoint.
+ * @ubi: UBI device description object
+ * @ckpt_pnum: the PEB the checkpoint was read from
+ *
+ * The checkpoint read by 'ubi_ckpt_read()' stays valid on the flash, so the
+ * PEB states it records are needed to know when to invalidate it.
+ */
+void ubi_ckpt_attached(struct ubi_device *ubi, int ckpt_pnum)
+{
+	int i, vol_count;
+	const struct ubi_ckpt_hdr *hdr = ubi->ckpt_buf;
+	const struct ubi_ckpt_peb *pebs;
+
+	vol_count = be32_to_cpu(hdr->vol_count);
+	pebs = (const void *)hdr + sizeof(struct ubi_ckpt_hdr) +
+	       vol_count * sizeof(struct ubi_ckpt_vol);
+	for (i = 0; i < ubi->peb_count; i++)
+		ubi->ckpt_state[i] = pebs[i].state;
+
+	ubi->ckpt_pnum = ckpt_pnum;
+	ubi->ckpt_len = ALIGN(sizeof(struct ubi_ckpt_hdr) +
+			      be32_to_cpu(hdr->data_len), ubi->min_io_size);
+	ubi->ckpt_valid = 1;
+}
+
+/**
+ * write_stale - write the stale record.
+ * @ubi: UBI device description object
+ * @pnum: the checkpoint PEB
+ * @offset: offset of the stale record within the LEB
+ *
+ * Returns zero in case of success and a negative error code in case of
+ * failure.
+ */
+static int write_stale(struct ubi_device *ubi, int pnum, int offset)
+{
+	int err, len = stale_len(ubi);
+	void *buf;
+
+	buf = kmalloc(len, GFP_NOFS);
+	if (!buf)
+		return -ENOMEM;
+
+	memset(buf, 0xFF, len);
+	*(__be32 *)buf = cpu_to_be32(UBI_CKPT_STALE_MAGIC);
+	err = ubi_io_write_data(ubi, buf, pnum, offset, len);
+	kfree(buf);
+	return err;
+}
+
+/**
+ * mark_stale - mark the current checkpoint stale.
+ * @ubi: UBI device description object
+ *
+ * This function has to be called with @ubi->ckpt_mutex locked. A failure to
+ * write the stale record is fatal: the checkpoint would not match the flash
+ * any more, so UBI switches to read-only mode.
+ */
+static void mark_stale(struct ubi_device *ubi)
+{
+	int err;
+
+	ubi->ckpt_valid = 0;
+	err = write_stale(ubi, ubi->ckpt_pnum, ubi->ckpt_len);
+	if (err) {
+		ubi_err("cannot invalidate checkpoint in PEB %d, error %d",
+			ubi->ckpt_pnum, err);
+		ubi_ro_mode(ubi);
+		return;
+	}
+
+	dbg_wl("checkpoint in PEB %d is stale", ubi->ckpt_pnum);
+	if (!ubi->ckpt_disabled)
+		schedule_delayed_work(&ubi->ckpt_work, CKPT_INTERVAL);
+}
+
+/**
+ * ubi_ckpt_check_peb - invalidate the checkpoint if a PEB is about to change.
+ * @ubi: UBI device description object
+ * @pnum: the PEB which is about to be erased or written to
+ * @write: non-zero if @pnum is about to be written to, zero if it is about to
+ *         be erased
+ *
+ * This function has to be called before a PEB is erased and before a free
+ * PEB is handed out for writing. If the current checkpoint trusts the
+ * contents of @pnum, it is marked stale.
+ */
+void ubi_ckpt_check_peb(struct ubi_device *ubi, int pnum, int write)
+{
+	int state;
+
+	if (!ubi->ckpt_state)
+		return;
+
+	mutex_lock(&ubi->ckpt_mutex);
+	if (ubi->ckpt_valid && pnum != ubi->ckpt_pnum) {
+		state = ubi->ckpt_state[pnum];
+		if (state == UBI_CKPT_PEB_USED ||
+		    (write && state == UBI_CKPT_PEB_ERASE)) {
+			dbg_wl("PEB %d (state %d) is about to be %s", pnum,
+			       state, write ? "written" : "erased");
+			mark_stale(ubi);
+		}
+	}
+	mutex_unlock(&ubi->ckpt_mutex);
+}
+
+/**
+ * fill_volumes - record volumes and the LEB->PEB mapping in the checkpoint.
+ * @ubi: UBI device description object
+ * @vols: where to put the volume records
+ * @pebs: the PEB records to update
+ *
+ * Has to be called with @ubi->volumes_lock locked. Returns the number of
+ * volume records.
+ */
+static int fill_volumes(struct ubi_device *ubi, struct ubi_ckpt_vol *vols,
+			struct ubi_ckpt_peb *pebs)
+{
+	int i, lnum, pnum, vol_count = 0;
+	struct ubi_volume *vol;
+	struct ubi_ckpt_vol *cv;
+
+	for (i = 0; i < ubi->vtbl_slots + UBI_INT_VOL_COUNT; i++) {
+		vol = ubi->volumes[i];
+		if (!vol)
+			continue;
+
+		cv = &vols[vol_count++];
+		memset(cv, 0, sizeof(struct ubi_ckpt_vol));
+		cv->vol_id = cpu_to_be32(vol->vol_id);
+		cv->data_pad = cpu_to_be32(vol->data_pad);
+		if (vol->vol_type == UBI_STATIC_VOLUME) {
+			cv->vol_type = UBI_VID_STATIC;
+			cv->used_ebs = cpu_to_be32(vol->used_ebs);
+			cv->last_data_size = cpu_to_be32(vol->last_eb_bytes);
+		} else
+			cv->vol_type = UBI_VID_DYNAMIC;
+		if (vol->vol_id == UBI_LAYOUT_VOLUME_ID)
+			cv->compat = UBI_LAYOUT_VOLUME_COMPAT;
+
+		for (lnum = 0; lnum < vol->reserved_pebs; lnum++) {
+			pnum = vol->eba_tbl[lnum];
+			if (pnum < 0)
+				continue;
+			pebs[pnum].state = UBI_CKPT_PEB_USED;
+			pebs[pnum].vol_id = cpu_to_be32(vol->vol_id);
+			pebs[pnum].lnum = cpu_to_be32(lnum);
+		}
+	}
+
+	return vol_count;
+}
+
+/**
+ * ubi_ckpt_update - write a new checkpoint.
+ * @ubi: UBI device description object
+ * @force: write even if the current checkpoint is still valid
+ *
+ * The current checkpoint stays valid while PEBs are written and erased, but
+ * every PEB written since it was made is scanned when attaching. So it is
+ * worth writing a fresh one when the device goes away, which is what @force
+ * is for. Returns zero in case of success and a negative error code in case
+ * of failure.
+ */
+int ubi_ckpt_update(struct ubi_device *ubi, int force)
+{
+	int err, i, pnum, old_pnum, vol_count, data_len, len;
+	struct ubi_ckpt_hdr *hdr = ubi->ckpt_buf;
+	struct ubi_ckpt_vol *vols;
+	struct ubi_ckpt_peb *pebs;
+	struct ubi_vid_hdr *vid_hdr;
+	uint32_t crc;
+
+	if (ubi->ckpt_disabled || !ubi->ckpt_state)
+		return 0;
+	if (ubi->ro_mode)
+		return -EROFS;
+
+	vid_hdr = ubi_zalloc_vid_hdr(ubi, GFP_NOFS);
+	if (!vid_hdr)
+		return -ENOMEM;
+
+	/*
+	 * @ubi->ckpt_eba_sem keeps the EBA sub-system from un-mapping LEBs
+	 * while the LEB->PEB mapping and the PEB states are recorded, and
+	 * @ubi->ckpt_mutex keeps PEBs the new checkpoint trusts from being
+	 * erased or written to until it is on the flash.
+	 */
+	down_write(&ubi->ckpt_eba_sem);
+	mutex_lock(&ubi->ckpt_mutex);
+	if (ubi->ckpt_valid && !force) {
+		up_write(&ubi->ckpt_eba_sem);
+		err = 0;
+		goto out_unlock;
+	}
+
+	pnum = ubi_wl_get_ckpt_peb(ubi);
+	if (pnum < 0) {
+		up_write(&ubi->ckpt_eba_sem);
+		err = pnum;
+		dbg_wl("no free PEB for the checkpoint, error %d", err);
+		goto out_unlock;
+	}
+
+	vols = (void *)(hdr + 1);
+	spin_lock(&ubi->volumes_lock);
+	vol_count = ubi->vol_count;
+	pebs = (void *)(vols + vol_count);
+	ubi_wl_ckpt_states(ubi, pebs);
+	if (fill_volumes(ubi, vols, pebs) != vol_count)
+		BUG();
+	spin_unlock(&ubi->volumes_lock);
+	up_write(&ubi->ckpt_eba_sem);
+
+	/* The old and the new checkpoint PEBs are dropped by scanning */
+	old_pnum = ubi->ckpt_pnum;
+	if (old_pnum >= 0)
+		pebs[old_pnum].state = UBI_CKPT_PEB_SCAN;
+	pebs[pnum].state = UBI_CKPT_PEB_SCAN;
+
+	data_len = vol_count * sizeof(struct ubi_ckpt_vol) +
+		   ubi->peb_count * sizeof(struct ubi_ckpt_peb);
+	len = ALIGN(sizeof(struct ubi_ckpt_hdr) + data_len, ubi->min_io_size);
+	memset((void *)(hdr + 1) + data_len, 0xFF,
+	       len - sizeof(struct ubi_ckpt_hdr) - data_len);
+
+	memset(hdr, 0, sizeof(struct ubi_ckpt_hdr));
+	hdr->magic = cpu_to_be32(UBI_CKPT_HDR_MAGIC);
+	hdr->version = UBI_CKPT_VERSION;
+	hdr->peb_count = cpu_to_be32(ubi->peb_count);
+	hdr->vol_count = cpu_to_be32(vol_count);
+	hdr->vid_hdr_offset = cpu_to_be32(ubi->vid_hdr_offset);
+	hdr->leb_start = cpu_to_be32(ubi->leb_start);
+	hdr->image_seq = cpu_to_be32(ubi->image_seq);
+	hdr->data_len = cpu_to_be32(data_len);
+	spin_lock(&ubi->ltree_lock);
+	hdr->sqnum = cpu_to_be64(ubi->global_sqnum);
+	spin_unlock(&ubi->ltree_lock);
+	crc = crc32(UBI_CRC32_INIT, hdr + 1, data_len);
+	hdr->data_crc = cpu_to_be32(crc);
+	crc = crc32(UBI_CRC32_INIT, hdr, UBI_CKPT_HDR_SIZE_CRC);
+	hdr->hdr_crc = cpu_to_be32(crc);
+
+	vid_hdr->vol_type = UBI_CKPT_VOLUME_TYPE;
+	vid_hdr->compat = UBI_CKPT_VOLUME_COMPAT;
+	vid_hdr->vol_id = cpu_to_be32(UBI_CKPT_VOLUME_ID);
+	vid_hdr->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
+
+	err = ubi_io_write_vid_hdr(ubi, pnum, vid_hdr);
+	if (!err)
+		err = ubi_io_write_data(ubi, hdr, pnum, 0, len);
+	if (err) {
+		ubi_warn("failed to write checkpoint to PEB %d, error %d",
+			 pnum, err);
+		ubi_wl_put_ckpt_peb(ubi, pnum, 1);
+		goto out_unlock;
+	}
+
+	/*
+	 * The replaced checkpoint is still intact and would be picked up if
+	 * the new one went stale before the old PEB is erased.
+	 */
+	if (old_pnum >= 0 && ubi->ckpt_valid) {
+		err = write_stale(ubi, old_pnum, ubi->ckpt_len);
+		if (err) {
+			ubi_err("cannot invalidate checkpoint in PEB %d, "
+				"error %d", old_pnum, err);
+			ubi_ro_mode(ubi);
+		}
+	}
+
+	for (i = 0; i < ubi->peb_count; i++)
+		ubi->ckpt_state[i] = pebs[i].state;
+	ubi->ckpt_pnum = pnum;
+	ubi->ckpt_len = len;
+	ubi->ckpt_valid = 1;
+
+	if (old_pnum >= 0)
+		ubi_wl_put_ckpt_peb(ubi, old_pnum, 0);
+	dbg_wl("checkpoint written to PEB %d, %d volumes", pnum, vol_count);
+
+out_unlock:
+	mutex_unlock(&ubi->ckpt_mutex);
+	ubi_free_vid_hdr(ubi, vid_hdr);
+	return err;
+}
@@ -669,6 +669,7 @@ struct ubi_scan_leb *ubi_scan_get_free_peb(struct ubi_device *ubi,
 		seb = list_entry(si->free.next, struct ubi_scan_leb, u.list);
 		list_del(&seb->u.list);
 		dbg_bld("return free PEB %d, EC %d", seb->pnum, seb->ec);
+		ubi_ckpt_check_peb(ubi, seb->pnum, 1);
 		return seb;
 	}
 
@@ -698,6 +699,7 @@ struct ubi_scan_leb *ubi_scan_get_free_peb(struct ubi_device *ubi,
 			seb->ec += 1;
 			list_del(&seb->u.list);
 			dbg_bld("return PEB %d, EC %d", seb->pnum, seb->ec);
+			ubi_ckpt_check_peb(ubi, seb->pnum, 1);
 			return seb;
 		}
 	}
@@ -706,6 +708,21 @@ struct ubi_scan_leb *ubi_scan_get_free_peb(struct ubi_device *ubi,
 	return ERR_PTR(-ENOSPC);
 }
 
+/**
+ * add_ec - account an erase counter in the scanning information.
+ * @si: scanning information
+ * @ec: the erase counter
+ */
+static void add_ec(struct ubi_scan_info *si, int ec)
+{
+	si->ec_sum += ec;
+	si->ec_count += 1;
+	if (ec > si->max_ec)
+		si->max_ec = ec;
+	if (ec < si->min_ec)
+		si->min_ec = ec;
+}
+
 /**
  * process_eb - read, check UBI headers, and add them to scanning information.
  * @ubi: UBI device description object
@@ -828,6 +845,17 @@ static int process_eb(struct ubi_device *ubi, struct ubi_scan_info *si,
 	}
 
 	vol_id = be32_to_cpu(vidh->vol_id);
+	if (vol_id == UBI_CKPT_VOLUME_ID) {
+		/*
+		 * An old or stale checkpoint, the current one is never
+		 * scanned. It is not needed any longer.
+		 */
+		err = add_to_list(si, pnum, ec, &si->erase);
+		if (err)
+			return err;
+		goto adjust_mean_ec;
+	}
+
 	if (vol_id > UBI_MAX_VOLUMES && vol_id != UBI_LAYOUT_VOLUME_ID) {
 		int lnum = be32_to_cpu(vidh->lnum);
 
@@ -872,18 +900,161 @@ static int process_eb(struct ubi_device *ubi, struct ubi_scan_info *si,
 		return err;
 
 adjust_mean_ec:
-	if (!ec_corr) {
-		si->ec_sum += ec;
-		si->ec_count += 1;
-		if (ec > si->max_ec)
-			si->max_ec = ec;
-		if (ec < si->min_ec)
-			si->min_ec = ec;
+	if (!ec_corr)
+		add_ec(si, ec);
+
+	return 0;
+}
+
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+
+/**
+ * find_ckpt_vol - find a volume record in the checkpoint.
+ * @vols: volume records
+ * @vol_count: count of volume records
+ * @vol_id: the volume ID to look for
+ *
+ * Returns the volume record or %NULL if there is no such volume.
+ */
+static const struct ubi_ckpt_vol *find_ckpt_vol(const struct ubi_ckpt_vol *vols,
+						int vol_count, int vol_id)
+{
+	int i;
+
+	for (i = 0; i < vol_count; i++)
+		if (be32_to_cpu(vols[i].vol_id) == vol_id)
+			return &vols[i];
+	return NULL;
+}
+
+/**
+ * scan_checkpoint - attach by the checkpoint.
+ * @ubi: UBI device description object
+ * @si: scanning information
+ *
+ * This function fills @si from the checkpoint instead of reading the headers
+ * of the PEBs the checkpoint knows about, and scans the others as usual. The
+ * LEBs taken from the checkpoint get sequence number zero, so any copy
+ * written after the checkpoint was made wins over them.
+ *
+ * Returns zero in case of success, %1 if there is no usable checkpoint, and a
+ * negative error code if the checkpoint does not match the flash or the
+ * device could not be scanned.
+ */
+static int scan_checkpoint(struct ubi_device *ubi, struct ubi_scan_info *si)
+{
+	int err, pnum, ckpt_pnum, vol_count, vol_id, lnum, used_ebs, ec;
+	int scanned = 0;
+	const struct ubi_ckpt_hdr *hdr;
+	const struct ubi_ckpt_vol *vols, *cv;
+	const struct ubi_ckpt_peb *pebs;
+
+	hdr = ubi_ckpt_read(ubi, &ckpt_pnum);
+	if (!hdr)
+		return 1;
+
+	vol_count = be32_to_cpu(hdr->vol_count);
+	vols = (const void *)(hdr + 1);
+	pebs = (const void *)(vols + vol_count);
+
+	if (!ubi->image_seq)
+		ubi->image_seq = be32_to_cpu(hdr->image_seq);
+	si->is_empty = 0;
+	si->ckpt_pnum = ckpt_pnum;
+	si->ckpt_ec = be32_to_cpu(pebs[ckpt_pnum].ec);
+	add_ec(si, si->ckpt_ec);
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		cond_resched();
+
+		if (pnum == ckpt_pnum)
+			continue;
+
+		ec = be32_to_cpu(pebs[pnum].ec);
+		switch (pebs[pnum].state) {
+		case UBI_CKPT_PEB_USED:
+			vol_id = be32_to_cpu(pebs[pnum].vol_id);
+			lnum = be32_to_cpu(pebs[pnum].lnum);
+			cv = find_ckpt_vol(vols, vol_count, vol_id);
+			if (!cv) {
+				ubi_err("checkpoint maps PEB %d to unknown "
+					"volume %d", pnum, vol_id);
+				return -EINVAL;
+			}
+
+			used_ebs = be32_to_cpu(cv->used_ebs);
+			memset(vidh, 0, sizeof(struct ubi_vid_hdr));
+			vidh->vol_type = cv->vol_type;
+			vidh->compat = cv->compat;
+			vidh->vol_id = cv->vol_id;
+			vidh->lnum = cpu_to_be32(lnum);
+			vidh->used_ebs = cv->used_ebs;
+			vidh->data_pad = cv->data_pad;
+			if (cv->vol_type == UBI_VID_STATIC && lnum == used_ebs - 1)
+				vidh->data_size = cv->last_data_size;
+
+			err = ubi_scan_add_used(ubi, si, pnum, ec, vidh, 0);
+			break;
+
+		case UBI_CKPT_PEB_ERASE:
+			err = add_to_list(si, pnum, ec, &si->erase);
+			break;
+
+		default:
+			scanned += 1;
+			err = process_eb(ubi, si, pnum);
+			if (err)
+				return err;
+			continue;
+		}
+
+		if (err)
+			return err;
+		add_ec(si, ec);
 	}
 
+	if (si->max_sqnum < be64_to_cpu(hdr->sqnum))
+		si->max_sqnum = be64_to_cpu(hdr->sqnum);
+
+	ubi_ckpt_attached(ubi, ckpt_pnum);
+	ubi_msg("attached by checkpoint in PEB %d, scanned %d of %d PEBs",
+		ckpt_pnum, scanned, ubi->peb_count);
 	return 0;
 }
 
+#else
+
+static inline int scan_checkpoint(struct ubi_device *ubi,
+				  struct ubi_scan_info *si)
+{
+	return 1;
+}
+
+#endif /* CONFIG_MTD_UBI_CHECKPOINT */
+
+/**
+ * alloc_si - allocate and initialize scanning information.
+ *
+ * Returns the new object or %NULL if there is no memory.
+ */
+static struct ubi_scan_info *alloc_si(void)
+{
+	struct ubi_scan_info *si;
+
+	si = kzalloc(sizeof(struct ubi_scan_info), GFP_KERNEL);
+	if (!si)
+		return NULL;
+
+	INIT_LIST_HEAD(&si->corr);
+	INIT_LIST_HEAD(&si->free);
+	INIT_LIST_HEAD(&si->erase);
+	INIT_LIST_HEAD(&si->alien);
+	si->volumes = RB_ROOT;
+	si->is_empty = 1;
+	si->ckpt_pnum = -1;
+	return si;
+}
+
 /**
  * ubi_scan - scan an MTD device.
  * @ubi: UBI device description object
@@ -897,19 +1068,12 @@ struct ubi_scan_info *ubi_scan(struct ubi_device *ubi)
 	struct rb_node *rb1, *rb2;
 	struct ubi_scan_volume *sv;
 	struct ubi_scan_leb *seb;
-	struct ubi_scan_info *si;
+	struct ubi_scan_info *si, *new_si;
 
-	si = kzalloc(sizeof(struct ubi_scan_info), GFP_KERNEL);
+	si = alloc_si();
 	if (!si)
 		return ERR_PTR(-ENOMEM);
 
-	INIT_LIST_HEAD(&si->corr);
-	INIT_LIST_HEAD(&si->free);
-	INIT_LIST_HEAD(&si->erase);
-	INIT_LIST_HEAD(&si->alien);
-	si->volumes = RB_ROOT;
-	si->is_empty = 1;
-
 	err = -ENOMEM;
 	ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
 	if (!ech)
@@ -919,13 +1083,29 @@ struct ubi_scan_info *ubi_scan(struct ubi_device *ubi)
 	if (!vidh)
 		goto out_ech;
 
-	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
-		cond_resched();
-
-		dbg_gen("process PEB %d", pnum);
-		err = process_eb(ubi, si, pnum);
-		if (err < 0)
+	err = scan_checkpoint(ubi, si);
+	if (err < 0) {
+		ubi_warn("cannot attach by checkpoint, error %d, scan all PEBs",
+			 err);
+		new_si = alloc_si();
+		if (!new_si) {
+			err = -ENOMEM;
 			goto out_vidh;
+		}
+		ubi_scan_destroy_si(si);
+		si = new_si;
+		err = 1;
+	}
+
+	if (err > 0) {
+		for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+			cond_resched();
+
+			dbg_gen("process PEB %d", pnum);
+			err = process_eb(ubi, si, pnum);
+			if (err < 0)
+				goto out_vidh;
+		}
 	}
 
 	dbg_msg("scanning is finished");
@@ -973,7 +1153,11 @@ struct ubi_scan_info *ubi_scan(struct ubi_device *ubi)
 		if (seb->ec == UBI_SCAN_UNKNOWN_EC)
 			seb->ec = si->mean_ec;
 
-	err = paranoid_check_si(ubi, si);
+	/*
+	 * LEBs taken from the checkpoint have no sequence numbers and the
+	 * checkpoint PEB is in no list, so the check does not apply.
+	 */
+	err = si->ckpt_pnum < 0 ? paranoid_check_si(ubi, si) : 0;
 	if (err) {
 		if (err > 0)
 			err = -EINVAL;
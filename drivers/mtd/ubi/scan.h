@@ -103,6 +103,9 @@ struct ubi_scan_volume {
  * @ec_sum: a temporary variable used when calculating @mean_ec
  * @ec_count: a temporary variable used when calculating @mean_ec
  * @corr_count: count of corrupted PEBs
+ * @ckpt_pnum: PEB of the checkpoint the device was attached by, %-1 if it was
+ *             fully scanned
+ * @ckpt_ec: erase counter of @ckpt_pnum
  *
  * This data structure contains the result of scanning and may be used by other
  * UBI sub-systems to build final UBI data structures, further error-recovery
@@ -126,6 +129,8 @@ struct ubi_scan_info {
 	uint64_t ec_sum;
 	int ec_count;
 	int corr_count;
+	int ckpt_pnum;
+	int ckpt_ec;
 };
 
 struct ubi_device;
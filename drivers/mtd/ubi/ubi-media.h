@@ -312,6 +312,18 @@ struct ubi_vid_hdr {
 #define UBI_LAYOUT_VOLUME_NAME   "layout volume"
 #define UBI_LAYOUT_VOLUME_COMPAT UBI_COMPAT_REJECT
 
+/*
+ * The checkpoint volume contains a snapshot of the erase counters and of the
+ * LEB->PEB mapping which allows attaching without reading every PEB. It is
+ * always a single LEB and lives in one of the first %UBI_CKPT_MAX_START PEBs,
+ * so that it can be found quickly. Older UBI implementations simply delete it.
+ */
+
+#define UBI_CKPT_VOLUME_ID     (UBI_LAYOUT_VOLUME_ID + 1)
+#define UBI_CKPT_VOLUME_TYPE   UBI_VID_DYNAMIC
+#define UBI_CKPT_VOLUME_COMPAT UBI_COMPAT_DELETE
+#define UBI_CKPT_MAX_START     64
+
 /* The maximum number of volumes per one UBI device */
 #define UBI_MAX_VOLUMES 128
 
@@ -375,4 +387,105 @@ struct ubi_vtbl_record {
 	__be32  crc;
 } __attribute__ ((packed));
 
+/* Checkpoint header magic number (ASCII "UBIK") */
+#define UBI_CKPT_HDR_MAGIC   0x5542494B
+/* Magic of the record which marks a checkpoint as stale (ASCII "UBIX") */
+#define UBI_CKPT_STALE_MAGIC 0x55424958
+/* The version of the checkpoint format */
+#define UBI_CKPT_VERSION 1
+
+/*
+ * PEB states recorded in the checkpoint.
+ *
+ * @UBI_CKPT_PEB_SCAN: state unknown, the PEB has to be scanned at attach time
+ * @UBI_CKPT_PEB_FREE: the PEB was free; it has to be scanned because it may
+ *                     have been written after the checkpoint
+ * @UBI_CKPT_PEB_USED: the PEB is mapped to the LEB recorded in the entry
+ * @UBI_CKPT_PEB_ERASE: the PEB contains obsolete data and has to be erased
+ */
+enum {
+	UBI_CKPT_PEB_SCAN  = 0,
+	UBI_CKPT_PEB_FREE  = 1,
+	UBI_CKPT_PEB_USED  = 2,
+	UBI_CKPT_PEB_ERASE = 3
+};
+
+/**
+ * struct ubi_ckpt_hdr - checkpoint header.
+ * @magic: checkpoint header magic number (%UBI_CKPT_HDR_MAGIC)
+ * @version: checkpoint format version (%UBI_CKPT_VERSION)
+ * @padding1: reserved for future, zeroes
+ * @peb_count: count of PEBs described by the checkpoint
+ * @vol_count: count of volume records which follow the header
+ * @vid_hdr_offset: VID header offset the checkpoint was made with
+ * @leb_start: data offset the checkpoint was made with
+ * @image_seq: image sequence number
+ * @data_len: length of the volume and PEB records in bytes
+ * @sqnum: global sequence number at the time the checkpoint was made
+ * @data_crc: CRC32 checksum of the volume and PEB records
+ * @padding2: reserved for future, zeroes
+ * @hdr_crc: checkpoint header CRC checksum
+ *
+ * The checkpoint occupies the data area of the checkpoint LEB and consists of
+ * this header, @vol_count &struct ubi_ckpt_vol records and @peb_count
+ * &struct ubi_ckpt_peb records indexed by PEB number. The minimal I/O unit
+ * following the checkpoint is left empty: UBI writes a stale record there
+ * (just the %UBI_CKPT_STALE_MAGIC magic) as soon as the flash stops matching
+ * the checkpoint.
+ */
+struct ubi_ckpt_hdr {
+	__be32  magic;
+	__u8    version;
+	__u8    padding1[3];
+	__be32  peb_count;
+	__be32  vol_count;
+	__be32  vid_hdr_offset;
+	__be32  leb_start;
+	__be32  image_seq;
+	__be32  data_len;
+	__be64  sqnum;
+	__be32  data_crc;
+	__u8    padding2[16];
+	__be32  hdr_crc;
+} __attribute__ ((packed));
+
+/* Size of the checkpoint header without the ending CRC */
+#define UBI_CKPT_HDR_SIZE_CRC (sizeof(struct ubi_ckpt_hdr) - sizeof(__be32))
+
+/**
+ * struct ubi_ckpt_vol - volume record of the checkpoint.
+ * @vol_id: volume ID
+ * @used_ebs: value of the @used_ebs field of the volume's VID headers
+ * @data_pad: value of the @data_pad field of the volume's VID headers
+ * @last_data_size: data size of the last LEB (static volumes only)
+ * @vol_type: VID header volume type (%UBI_VID_DYNAMIC or %UBI_VID_STATIC)
+ * @compat: compatibility flags of the volume
+ * @padding: reserved for future, zeroes
+ */
+struct ubi_ckpt_vol {
+	__be32  vol_id;
+	__be32  used_ebs;
+	__be32  data_pad;
+	__be32  last_data_size;
+	__u8    vol_type;
+	__u8    compat;
+	__u8    padding[2];
+} __attribute__ ((packed));
+
+/**
+ * struct ubi_ckpt_peb - PEB record of the checkpoint.
+ * @ec: erase counter
+ * @vol_id: volume ID (%UBI_CKPT_PEB_USED PEBs only)
+ * @lnum: logical eraseblock number (%UBI_CKPT_PEB_USED PEBs only)
+ * @state: one of the %UBI_CKPT_PEB_* states
+ * @padding: reserved for future, zeroes
+ */
+struct ubi_ckpt_peb {
+	__be32  ec;
+	__be32  vol_id;
+	__be32  lnum;
+	__u8    state;
+	__u8    padding[3];
+} __attribute__ ((packed));
+
 #endif /* !__UBI_MEDIA_H__ */
@@ -37,6 +37,7 @@
 #include <linux/string.h>
 #include <linux/vmalloc.h>
 #include <linux/notifier.h>
+#include <linux/workqueue.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/ubi.h>
 
@@ -335,7 +336,8 @@ struct ubi_wl_entry;
  * @pq_head: protection queue head
  * @wl_lock: protects the @used, @free, @pq, @pq_head, @lookuptbl, @move_from,
  * 	     @move_to, @move_to_put @erase_pending, @wl_scheduled, @works,
- * 	     @erroneous, and @erroneous_peb_count fields
+ * 	     @erroneous, @erroneous_peb_count, @free_count, @wl_window and
+ * 	     @wl_moves fields
  * @move_mutex: serializes eraseblock moves
  * @work_sem: synchronizes the WL worker with use tasks
  * @wl_scheduled: non-zero if the wear-leveling was scheduled
@@ -346,6 +348,13 @@ struct ubi_wl_entry;
  * @move_to_put: if the "to" PEB was put
  * @works: list of pending works
  * @works_count: count of pending works
+ * @erase_pending: count of pending erase works
+ * @free_count: count of physical eraseblocks in the @free tree
+ * @free_watermark: erasures are done first and wear-leveling waits while
+ *                  there are fewer free physical eraseblocks than this
+ * @wl_rate: maximum number of wear-leveling moves per second, %0 if unlimited
+ * @wl_window: start of the current wear-leveling rate limiting period
+ * @wl_moves: wear-leveling moves done in the current period
  * @bgt_thread: background thread description object
  * @thread_enabled: if the background thread is enabled
  * @bgt_name: background thread name
@@ -382,6 +391,18 @@ struct ubi_wl_entry;
  * @ckvol_mutex: serializes static volume checking when opening
  * @dbg_peb_buf: buffer of PEB size used for debugging
  * @dbg_buf_mutex: protects @dbg_peb_buf
+ *
+ * @ckpt_mutex: serializes checkpoint updates and invalidation, protects the
+ *              other checkpoint fields
+ * @ckpt_eba_sem: keeps LEBs from being re-mapped while a checkpoint is taken
+ * @ckpt_work: delayed work which re-writes a stale checkpoint
+ * @ckpt_pnum: PEB holding the current checkpoint, %-1 if there is none
+ * @ckpt_len: length of the current checkpoint aligned to @min_io_size, which
+ *            is where its stale record goes
+ * @ckpt_valid: non-zero if the current checkpoint matches the flash
+ * @ckpt_disabled: non-zero if checkpoints are not used on this device
+ * @ckpt_state: %UBI_CKPT_PEB_* state of each PEB in the current checkpoint
+ * @ckpt_buf: a buffer of LEB size the checkpoint is built and read in
  */
 struct ubi_device {
 	struct cdev cdev;
@@ -432,6 +453,12 @@ struct ubi_device {
 	int move_to_put;
 	struct list_head works;
 	int works_count;
+	int erase_pending;
+	int free_count;
+	int free_watermark;
+	int wl_rate;
+	unsigned long wl_window;
+	int wl_moves;
 	struct task_struct *bgt_thread;
 	int thread_enabled;
 	char bgt_name[sizeof(UBI_BGT_NAME_PATTERN)+2];
@@ -467,6 +494,17 @@ struct ubi_device {
 	void *dbg_peb_buf;
 	struct mutex dbg_buf_mutex;
 #endif
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	struct mutex ckpt_mutex;
+	struct rw_semaphore ckpt_eba_sem;
+	struct delayed_work ckpt_work;
+	int ckpt_pnum;
+	int ckpt_len;
+	int ckpt_valid;
+	int ckpt_disabled;
+	uint8_t *ckpt_state;
+	void *ckpt_buf;
+#endif
 };
 
 extern struct kmem_cache *ubi_wl_entry_slab;
@@ -523,6 +561,7 @@ int ubi_eba_atomic_leb_change(struct ubi_device *ubi, struct ubi_volume *vol,
 int ubi_eba_copy_leb(struct ubi_device *ubi, int from, int to,
 		     struct ubi_vid_hdr *vid_hdr);
 int ubi_eba_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si);
+unsigned long long ubi_next_sqnum(struct ubi_device *ubi);
 
 /* wl.c */
 int ubi_wl_get_peb(struct ubi_device *ubi, int dtype);
@@ -532,6 +571,11 @@ int ubi_wl_scrub_peb(struct ubi_device *ubi, int pnum);
 int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si);
 void ubi_wl_close(struct ubi_device *ubi);
 int ubi_thread(void *u);
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+int ubi_wl_get_ckpt_peb(struct ubi_device *ubi);
+int ubi_wl_put_ckpt_peb(struct ubi_device *ubi, int pnum, int torture);
+void ubi_wl_ckpt_states(struct ubi_device *ubi, struct ubi_ckpt_peb *pebs);
+#endif
 
 /* io.c */
 int ubi_io_read(const struct ubi_device *ubi, void *buf, int pnum, int offset,
@@ -563,6 +607,40 @@ int ubi_notify_all(struct ubi_device *ubi, int ntype,
 		   struct notifier_block *nb);
 int ubi_enumerate_volumes(struct notifier_block *nb);
 
+/* checkpoint.c */
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+int ubi_ckpt_init(struct ubi_device *ubi);
+void ubi_ckpt_close(struct ubi_device *ubi);
+void ubi_ckpt_reserve(struct ubi_device *ubi);
+const struct ubi_ckpt_hdr *ubi_ckpt_read(struct ubi_device *ubi,
+					 int *ckpt_pnum);
+void ubi_ckpt_attached(struct ubi_device *ubi, int ckpt_pnum);
+void ubi_ckpt_check_peb(struct ubi_device *ubi, int pnum, int write);
+int ubi_ckpt_update(struct ubi_device *ubi, int force);
+
+static inline void ubi_ckpt_eba_lock(struct ubi_device *ubi)
+{
+	down_read(&ubi->ckpt_eba_sem);
+}
+
+static inline void ubi_ckpt_eba_unlock(struct ubi_device *ubi)
+{
+	up_read(&ubi->ckpt_eba_sem);
+}
+#else
+static inline int ubi_ckpt_init(struct ubi_device *ubi) { return 0; }
+static inline void ubi_ckpt_close(struct ubi_device *ubi) {}
+static inline void ubi_ckpt_reserve(struct ubi_device *ubi) {}
+static inline void ubi_ckpt_check_peb(struct ubi_device *ubi, int pnum,
+				      int write) {}
+static inline int ubi_ckpt_update(struct ubi_device *ubi, int force)
+{
+	return 0;
+}
+static inline void ubi_ckpt_eba_lock(struct ubi_device *ubi) {}
+static inline void ubi_ckpt_eba_unlock(struct ubi_device *ubi) {}
+#endif
+
 /* kapi.c */
 void ubi_do_get_device_info(struct ubi_device *ubi, struct ubi_device_info *di);
 void ubi_do_get_volume_info(struct ubi_device *ubi, struct ubi_volume *vol,
@@ -0,0 +1,465 @@
+/*
+ * Read-only block devices on top of UBI volumes
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See
+ * the GNU General Public License for more details.
+ */
+
+/*
+ * A "ubiblockX_Y" block device is created for every volume Y of UBI device
+ * X. It is meant for read-only file systems such as squashfs, which then
+ * get UBI's wear levelling and bad block handling without going through
+ * gluebi and mtdblock. Requests are served with ubi_leb_read().
+ *
+ * Small requests would each cost a full NAND page read, so whole LEBs are
+ * read into a small per-device cache (leb_cache LEBs, 0 disables it) and
+ * requests are served from there. Readahead on the queue is at least one
+ * LEB, so sequential reads run ahead into the next LEB instead of
+ * stopping at its boundary.
+ *
+ * The volume is opened with UBI_READONLY for as long as the block device
+ * is open, so it cannot be updated or removed under a mounted file system.
+ */
+
+#include <linux/err.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/blkdev.h>
+#include <linux/genhd.h>
+#include <linux/hdreg.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/math64.h>
+#include <linux/mtd/ubi.h>
+#include "ubi-media.h"
+
+#define UBIBLOCK_MAX_LEBS	8
+
+static int leb_cache = 2;
+module_param(leb_cache, int, 0444);
+MODULE_PARM_DESC(leb_cache, "LEBs cached per block device (0-8, default 2)");
+
+/**
+ * struct ubiblock_leb - a cached logical eraseblock.
+ * @buf: LEB contents
+ * @lnum: LEB number, %-1 if the slot is empty
+ * @last_use: LRU stamp
+ */
+struct ubiblock_leb {
+	void *buf;
+	int lnum;
+	unsigned long last_use;
+};
+
+/**
+ * struct ubiblock - a UBI block device.
+ * @ubi_num: UBI device number
+ * @vol_id: volume ID
+ * @leb_size: usable LEB size of the volume
+ * @size: bytes of data in the volume
+ * @desc: volume descriptor while the block device is open
+ * @refcnt: open count
+ * @mutex: protects @desc, @refcnt and the cache buffers
+ * @gd: the disk
+ * @rq: its request queue
+ * @queue_lock: request queue lock
+ * @wq: workqueue the requests are served on, as ubi_leb_read() sleeps
+ * @work: request serving work
+ * @nr_lebs: number of slots in @lebs
+ * @lru: LRU clock of @lebs
+ * @lebs: LEB cache, only touched by @work
+ * @list: link in @ubiblock_devices
+ */
+struct ubiblock {
+	int ubi_num;
+	int vol_id;
+	int leb_size;
+	long long size;
+	struct ubi_volume_desc *desc;
+	int refcnt;
+	struct mutex mutex;
+	struct gendisk *gd;
+	struct request_queue *rq;
+	spinlock_t queue_lock;
+	struct workqueue_struct *wq;
+	struct work_struct work;
+	int nr_lebs;
+	unsigned long lru;
+	struct ubiblock_leb lebs[UBIBLOCK_MAX_LEBS];
+	struct list_head list;
+};
+
+static int ubiblock_major;
+static LIST_HEAD(ubiblock_devices);
+static DEFINE_MUTEX(devices_mutex);
+
+static struct ubiblock *find_dev(int ubi_num, int vol_id)
+{
+	struct ubiblock *dev;
+
+	list_for_each_entry(dev, &ubiblock_devices, list)
+		if (dev->ubi_num == ubi_num && dev->vol_id == vol_id)
+			return dev;
+	return NULL;
+}
+
+/* Bytes of LEB @lnum holding data; the last LEB may be partial */
+static int leb_data_len(struct ubiblock *dev, int lnum)
+{
+	long long left = dev->size - (long long)lnum * dev->leb_size;
+
+	return left < dev->leb_size ? left : dev->leb_size;
+}
+
+static struct ubiblock_leb *ubiblock_get_leb(struct ubiblock *dev, int lnum)
+{
+	struct ubiblock_leb *leb, *victim = NULL;
+	int i, err;
+
+	for (i = 0; i < dev->nr_lebs; i++) {
+		leb = &dev->lebs[i];
+		if (leb->lnum == lnum) {
+			leb->last_use = ++dev->lru;
+			return leb;
+		}
+		if (!victim || leb->lnum == -1 ||
+		    (victim->lnum != -1 && leb->last_use < victim->last_use))
+			victim = leb;
+	}
+
+	if (!victim)
+		return NULL;
+
+	victim->lnum = -1;
+	err = ubi_leb_read(dev->desc, lnum, victim->buf, 0,
+			   leb_data_len(dev, lnum), 0);
+	if (err)
+		return ERR_PTR(err);
+
+	victim->lnum = lnum;
+	victim->last_use = ++dev->lru;
+	return victim;
+}
+
+static int ubiblock_read(struct ubiblock *dev, char *buf, u64 pos, int len)
+{
+	struct ubiblock_leb *leb;
+	int lnum, n, err;
+	u32 offset;
+
+	while (len > 0) {
+		lnum = div_u64_rem(pos, dev->leb_size, &offset);
+		n = min_t(int, len, dev->leb_size - offset);
+
+		leb = ubiblock_get_leb(dev, lnum);
+		if (IS_ERR(leb))
+			return PTR_ERR(leb);
+		if (leb) {
+			memcpy(buf, leb->buf + offset, n);
+		} else {
+			err = ubi_leb_read(dev->desc, lnum, buf, offset, n, 0);
+			if (err)
+				return err;
+		}
+
+		buf += n;
+		pos += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static int ubiblock_do_request(struct ubiblock *dev, struct request *req)
+{
+	u64 pos = (u64)blk_rq_pos(req) << 9;
+	int err;
+
+	if (!blk_fs_request(req))
+		return -EIO;
+
+	if (rq_data_dir(req) != READ)
+		return -EROFS;
+
+	if (pos + blk_rq_cur_bytes(req) > dev->size)
+		return -EIO;
+
+	err = ubiblock_read(dev, req->buffer, pos, blk_rq_cur_bytes(req));
+	if (err) {
+		printk(KERN_ERR "ubiblock%d_%d: read of %u bytes at %llu "
+		       "failed, error %d\n", dev->ubi_num, dev->vol_id,
+		       blk_rq_cur_bytes(req), pos, err);
+		return -EIO;
+	}
+
+	rq_flush_dcache_pages(req);
+	return 0;
+}
+
+static void ubiblock_work(struct work_struct *work)
+{
+	struct ubiblock *dev = container_of(work, struct ubiblock, work);
+	struct request_queue *rq = dev->rq;
+	struct request *req;
+	int res;
+
+	spin_lock_irq(rq->queue_lock);
+	req = blk_fetch_request(rq);
+	while (req) {
+		spin_unlock_irq(rq->queue_lock);
+		res = ubiblock_do_request(dev, req);
+		spin_lock_irq(rq->queue_lock);
+
+		if (!__blk_end_request_cur(req, res))
+			req = blk_fetch_request(rq);
+	}
+	spin_unlock_irq(rq->queue_lock);
+}
+
+static void ubiblock_request(struct request_queue *rq)
+{
+	struct ubiblock *dev = rq->queuedata;
+
+	queue_work(dev->wq, &dev->work);
+}
+
+static void ubiblock_free_cache(struct ubiblock *dev)
+{
+	int i;
+
+	for (i = 0; i < dev->nr_lebs; i++)
+		vfree(dev->lebs[i].buf);
+	dev->nr_lebs = 0;
+}
+
+static int ubiblock_open(struct block_device *bdev, fmode_t mode)
+{
+	struct ubiblock *dev = bdev->bd_disk->private_data;
+	int err = 0;
+
+	if (mode & FMODE_WRITE)
+		return -EROFS;
+
+	mutex_lock(&dev->mutex);
+	if (dev->refcnt == 0) {
+		dev->desc = ubi_open_volume(dev->ubi_num, dev->vol_id,
+					    UBI_READONLY);
+		if (IS_ERR(dev->desc)) {
+			err = PTR_ERR(dev->desc);
+			dev->desc = NULL;
+			goto out;
+		}
+
+		/* without a cache, reads go to ubi_leb_read() directly */
+		while (dev->nr_lebs < clamp(leb_cache, 0, UBIBLOCK_MAX_LEBS)) {
+			struct ubiblock_leb *leb = &dev->lebs[dev->nr_lebs];
+
+			leb->buf = vmalloc(dev->leb_size);
+			if (!leb->buf)
+				break;
+			leb->lnum = -1;
+			dev->nr_lebs++;
+		}
+	}
+	dev->refcnt++;
+out:
+	mutex_unlock(&dev->mutex);
+	return err;
+}
+
+static int ubiblock_release(struct gendisk *gd, fmode_t mode)
+{
+	struct ubiblock *dev = gd->private_data;
+
+	mutex_lock(&dev->mutex);
+	if (--dev->refcnt == 0) {
+		flush_workqueue(dev->wq);
+		ubiblock_free_cache(dev);
+		ubi_close_volume(dev->desc);
+		dev->desc = NULL;
+	}
+	mutex_unlock(&dev->mutex);
+	return 0;
+}
+
+static int ubiblock_getgeo(struct block_device *bdev, struct hd_geometry *geo)
+{
+	/* Some tools need this info */
+	geo->heads = 1;
+	geo->cylinders = 1;
+	geo->sectors = get_capacity(bdev->bd_disk);
+	geo->start = 0;
+	return 0;
+}
+
+static const struct block_device_operations ubiblock_ops = {
+	.owner		= THIS_MODULE,
+	.open		= ubiblock_open,
+	.release	= ubiblock_release,
+	.getgeo		= ubiblock_getgeo,
+};
+
+static void ubiblock_set_size(struct ubiblock *dev,
+			      const struct ubi_volume_info *vi)
+{
+	if (vi->vol_type == UBI_STATIC_VOLUME)
+		dev->size = vi->used_bytes;
+	else
+		dev->size = (long long)vi->size * vi->usable_leb_size;
+	set_capacity(dev->gd, dev->size >> 9);
+}
+
+static int ubiblock_create(struct ubi_volume_info *vi)
+{
+	struct ubiblock *dev;
+	struct gendisk *gd;
+	unsigned int ra_pages;
+	int err = -ENOMEM;
+
+	if (vi->vol_id >= UBI_MAX_VOLUMES)
+		return -EINVAL;
+
+	dev = kzalloc(sizeof(struct ubiblock), GFP_KERNEL);
+	if (!dev)
+		return -ENOMEM;
+
+	dev->ubi_num = vi->ubi_num;
+	dev->vol_id = vi->vol_id;
+	dev->leb_size = vi->usable_leb_size;
+	mutex_init(&dev->mutex);
+	spin_lock_init(&dev->queue_lock);
+	INIT_WORK(&dev->work, ubiblock_work);
+
+	gd = alloc_disk(1);
+	if (!gd)
+		goto out_free_dev;
+	dev->gd = gd;
+
+	gd->major = ubiblock_major;
+	gd->first_minor = dev->ubi_num * UBI_MAX_VOLUMES + dev->vol_id;
+	gd->fops = &ubiblock_ops;
+	gd->private_data = dev;
+	sprintf(gd->disk_name, "ubiblock%d_%d", dev->ubi_num, dev->vol_id);
+	set_disk_ro(gd, 1);
+	ubiblock_set_size(dev, vi);
+
+	dev->rq = blk_init_queue(ubiblock_request, &dev->queue_lock);
+	if (!dev->rq)
+		goto out_put_disk;
+	dev->rq->queuedata = dev;
+	gd->queue = dev->rq;
+
+	ra_pages = DIV_ROUND_UP(dev->leb_size, PAGE_CACHE_SIZE);
+	if (dev->rq->backing_dev_info.ra_pages < ra_pages)
+		dev->rq->backing_dev_info.ra_pages = ra_pages;
+
+	dev->wq = create_singlethread_workqueue(gd->disk_name);
+	if (!dev->wq)
+		goto out_cleanup_queue;
+
+	mutex_lock(&devices_mutex);
+	list_add_tail(&dev->list, &ubiblock_devices);
+	mutex_unlock(&devices_mutex);
+
+	add_disk(gd);
+	printk(KERN_INFO "ubiblock: %s for volume \"%s\", %lld bytes\n",
+	       gd->disk_name, vi->name, dev->size);
+	return 0;
+
+out_cleanup_queue:
+	blk_cleanup_queue(dev->rq);
+out_put_disk:
+	put_disk(gd);
+out_free_dev:
+	kfree(dev);
+	printk(KERN_ERR "ubiblock: cannot create block device for UBI %d "
+	       "volume %d, error %d\n", vi->ubi_num, vi->vol_id, err);
+	return err;
+}
+
+static void ubiblock_destroy(struct ubiblock *dev)
+{
+	list_del(&dev->list);
+	del_gendisk(dev->gd);
+	blk_cleanup_queue(dev->rq);
+	destroy_workqueue(dev->wq);
+	put_disk(dev->gd);
+	kfree(dev);
+}
+
+static int ubiblock_notify(struct notifier_block *nb, unsigned long l,
+			   void *ns_ptr)
+{
+	struct ubi_notification *nt = ns_ptr;
+	struct ubiblock *dev;
+
+	switch (l) {
+	case UBI_VOLUME_ADDED:
+		ubiblock_create(&nt->vi);
+		break;
+	case UBI_VOLUME_REMOVED:
+		/* UBI refuses to remove a volume we hold open */
+		mutex_lock(&devices_mutex);
+		dev = find_dev(nt->vi.ubi_num, nt->vi.vol_id);
+		if (dev)
+			ubiblock_destroy(dev);
+		mutex_unlock(&devices_mutex);
+		break;
+	case UBI_VOLUME_RESIZED:
+	case UBI_VOLUME_UPDATED:
+		mutex_lock(&devices_mutex);
+		dev = find_dev(nt->vi.ubi_num, nt->vi.vol_id);
+		if (dev)
+			ubiblock_set_size(dev, &nt->vi);
+		mutex_unlock(&devices_mutex);
+		break;
+	default:
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block ubiblock_notifier = {
+	.notifier_call	= ubiblock_notify,
+};
+
+static int __init ubiblock_init(void)
+{
+	int err;
+
+	ubiblock_major = register_blkdev(0, "ubiblock");
+	if (ubiblock_major < 0)
+		return ubiblock_major;
+
+	err = ubi_register_volume_notifier(&ubiblock_notifier, 0);
+	if (err)
+		unregister_blkdev(ubiblock_major, "ubiblock");
+	return err;
+}
+
+static void __exit ubiblock_exit(void)
+{
+	struct ubiblock *dev, *next;
+
+	ubi_unregister_volume_notifier(&ubiblock_notifier);
+
+	mutex_lock(&devices_mutex);
+	list_for_each_entry_safe(dev, next, &ubiblock_devices, list)
+		ubiblock_destroy(dev);
+	mutex_unlock(&devices_mutex);
+
+	unregister_blkdev(ubiblock_major, "ubiblock");
+}
+
+module_init(ubiblock_init);
+module_exit(ubiblock_exit);
+MODULE_DESCRIPTION("Read-only block devices on top of UBI volumes");
+MODULE_LICENSE("GPL");
@@ -141,6 +141,16 @@
  */
 #define WL_MAX_FAILURES 32
 
+/*
+ * Default number of free physical eraseblocks the WL sub-system tries to keep
+ * ready for writers. While there are fewer, pending erasures are done before
+ * anything else and wear-leveling waits for them.
+ */
+#define WL_FREE_WATERMARK CONFIG_MTD_UBI_FREE_WATERMARK
+
+/* Default maximum number of wear-leveling moves per second, 0 - no limit */
+#define WL_MAX_RATE CONFIG_MTD_UBI_WL_RATE
+
 /**
  * struct ubi_work - UBI work description data structure.
  * @list: a link in the list of pending works
@@ -456,10 +466,13 @@ retry:
 	 * be protected from being moved for some time.
 	 */
 	rb_erase(&e->u.rb, &ubi->free);
+	ubi->free_count -= 1;
 	dbg_wl("PEB %d EC %d", e->pnum, e->ec);
 	prot_queue_add(ubi, e);
 	spin_unlock(&ubi->wl_lock);
 
+	ubi_ckpt_check_peb(ubi, e->pnum, 1);
+
 	err = ubi_dbg_check_all_ff(ubi, e->pnum, ubi->vid_hdr_aloffset,
 				   ubi->peb_size - ubi->vid_hdr_aloffset);
 	if (err) {
@@ -516,6 +529,8 @@ static int sync_erase(struct ubi_device *ubi, struct ubi_wl_entry *e,
 	if (err > 0)
 		return -EINVAL;
 
+	ubi_ckpt_check_peb(ubi, e->pnum, 0);
+
 	ec_hdr = kzalloc(ubi->ec_hdr_alsize, GFP_NOFS);
 	if (!ec_hdr)
 		return -ENOMEM;
@@ -599,18 +614,30 @@ repeat:
 	spin_unlock(&ubi->wl_lock);
 }
 
+static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
+			int cancel);
+
 /**
  * schedule_ubi_work - schedule a work.
  * @ubi: UBI device description object
  * @wrk: the work to schedule
  *
  * This function adds a work defined by @wrk to the tail of the pending works
- * list.
+ * list. Erase works go to the head of the list instead while the pool of free
+ * physical eraseblocks is below @ubi->free_watermark, so that writers waiting
+ * in 'produce_free_peb()' and the background thread do them first.
  */
 static void schedule_ubi_work(struct ubi_device *ubi, struct ubi_work *wrk)
 {
 	spin_lock(&ubi->wl_lock);
-	list_add_tail(&wrk->list, &ubi->works);
+	if (wrk->func == &erase_worker) {
+		ubi->erase_pending += 1;
+		if (ubi->free_count < ubi->free_watermark)
+			list_add(&wrk->list, &ubi->works);
+		else
+			list_add_tail(&wrk->list, &ubi->works);
+	} else
+		list_add_tail(&wrk->list, &ubi->works);
 	ubi_assert(ubi->works_count >= 0);
 	ubi->works_count += 1;
 	if (ubi->thread_enabled)
@@ -618,9 +645,6 @@ static void schedule_ubi_work(struct ubi_device *ubi, struct ubi_work *wrk)
 	spin_unlock(&ubi->wl_lock);
 }
 
-static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
-			int cancel);
-
 /**
  * schedule_erase - schedule an erase work.
  * @ubi: UBI device description object
@@ -650,6 +674,37 @@ static int schedule_erase(struct ubi_device *ubi, struct ubi_wl_entry *e,
 	return 0;
 }
 
+/**
+ * wl_deferred - check if wear-leveling has to wait.
+ * @ubi: UBI device description object
+ *
+ * Wear-leveling moves are postponed while the free pool is below the
+ * watermark and erasures which will refill it are pending, because a move
+ * takes a free physical eraseblock and keeps the worker busy for a while.
+ * They are also limited to @ubi->wl_rate moves per second. Erase works call
+ * 'ensure_wear_leveling()' when they are done, which re-schedules deferred
+ * wear-leveling. Scrubbing is never deferred.
+ *
+ * This function has to be called with @ubi->wl_lock locked. Returns non-zero
+ * if wear-leveling has to wait and zero if not.
+ */
+static int wl_deferred(struct ubi_device *ubi)
+{
+	if (ubi->free_count < ubi->free_watermark && ubi->erase_pending)
+		return 1;
+
+	if (ubi->wl_rate) {
+		if (time_after_eq(jiffies, ubi->wl_window + HZ)) {
+			ubi->wl_window = jiffies;
+			ubi->wl_moves = 0;
+		}
+		if (ubi->wl_moves >= ubi->wl_rate)
+			return 1;
+	}
+
+	return 0;
+}
+
 /**
  * wear_leveling_worker - wear-leveling worker function.
  * @ubi: UBI device description object
@@ -712,6 +767,12 @@ static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
 			       e1->ec, e2->ec);
 			goto out_cancel;
 		}
+		if (wl_deferred(ubi)) {
+			dbg_wl("defer WL: %d free PEBs, %d erasures pending",
+			       ubi->free_count, ubi->erase_pending);
+			goto out_cancel;
+		}
+		ubi->wl_moves += 1;
 		paranoid_check_in_wl_tree(e1, &ubi->used);
 		rb_erase(&e1->u.rb, &ubi->used);
 		dbg_wl("move PEB %d EC %d to PEB %d EC %d",
@@ -728,10 +789,13 @@ static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
 
 	paranoid_check_in_wl_tree(e2, &ubi->free);
 	rb_erase(&e2->u.rb, &ubi->free);
+	ubi->free_count -= 1;
 	ubi->move_from = e1;
 	ubi->move_to = e2;
 	spin_unlock(&ubi->wl_lock);
 
+	ubi_ckpt_check_peb(ubi, e2->pnum, 1);
+
 	/*
 	 * Now we are going to copy physical eraseblock @e1->pnum to @e2->pnum.
 	 * We so far do not know which logical eraseblock our physical
@@ -963,6 +1027,8 @@ static int ensure_wear_leveling(struct ubi_device *ubi)
 
 		if (!(e2->ec - e1->ec >= UBI_WL_THRESHOLD))
 			goto out_unlock;
+		if (wl_deferred(ubi))
+			goto out_unlock;
 		dbg_wl("schedule wear-leveling");
 	} else
 		dbg_wl("schedule scrubbing");
@@ -1005,6 +1071,11 @@ static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
 	struct ubi_wl_entry *e = wl_wrk->e;
 	int pnum = e->pnum, err, need;
 
+	spin_lock(&ubi->wl_lock);
+	ubi->erase_pending -= 1;
+	ubi_assert(ubi->erase_pending >= 0);
+	spin_unlock(&ubi->wl_lock);
+
 	if (cancel) {
 		dbg_wl("cancel erasure of PEB %d EC %d", pnum, e->ec);
 		kfree(wl_wrk);
@@ -1021,6 +1092,7 @@ static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
 
 		spin_lock(&ubi->wl_lock);
 		wl_tree_add(e, &ubi->free);
+		ubi->free_count += 1;
 		spin_unlock(&ubi->wl_lock);
 
 		/*
@@ -1425,6 +1497,9 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 	init_rwsem(&ubi->work_sem);
 	ubi->max_ec = si->max_ec;
 	INIT_LIST_HEAD(&ubi->works);
+	ubi->free_watermark = WL_FREE_WATERMARK;
+	ubi->wl_rate = WL_MAX_RATE;
+	ubi->wl_window = jiffies;
 
 	sprintf(ubi->bgt_name, UBI_BGT_NAME_PATTERN, ubi->ubi_num);
 
@@ -1464,6 +1539,7 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 		e->ec = seb->ec;
 		ubi_assert(e->ec >= 0);
 		wl_tree_add(e, &ubi->free);
+		ubi->free_count += 1;
 		ubi->lookuptbl[e->pnum] = e;
 	}
 
@@ -1506,6 +1582,19 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 		}
 	}
 
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	if (si->ckpt_pnum >= 0) {
+		/* The current checkpoint PEB is not in any tree */
+		e = kmem_cache_alloc(ubi_wl_entry_slab, GFP_KERNEL);
+		if (!e)
+			goto out_free;
+
+		e->pnum = si->ckpt_pnum;
+		e->ec = si->ckpt_ec;
+		ubi->lookuptbl[e->pnum] = e;
+	}
+#endif
+
 	if (ubi->avail_pebs < WL_RESERVED_PEBS) {
 		ubi_err("no enough physical eraseblocks (%d, need %d)",
 			ubi->avail_pebs, WL_RESERVED_PEBS);
@@ -1526,6 +1615,11 @@ out_free:
 	tree_destroy(&ubi->used);
 	tree_destroy(&ubi->free);
 	tree_destroy(&ubi->scrub);
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	if (si->ckpt_pnum >= 0 && ubi->lookuptbl[si->ckpt_pnum])
+		kmem_cache_free(ubi_wl_entry_slab,
+				ubi->lookuptbl[si->ckpt_pnum]);
+#endif
 	kfree(ubi->lookuptbl);
 	return err;
 }
@@ -1560,9 +1654,111 @@ void ubi_wl_close(struct ubi_device *ubi)
 	tree_destroy(&ubi->erroneous);
 	tree_destroy(&ubi->free);
 	tree_destroy(&ubi->scrub);
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+	if (ubi->ckpt_pnum >= 0)
+		kmem_cache_free(ubi_wl_entry_slab,
+				ubi->lookuptbl[ubi->ckpt_pnum]);
+#endif
 	kfree(ubi->lookuptbl);
 }
 
+#ifdef CONFIG_MTD_UBI_CHECKPOINT
+
+/**
+ * ubi_wl_get_ckpt_peb - get a free PEB for the checkpoint.
+ * @ubi: UBI device description object
+ *
+ * The checkpoint has to live in one of the first %UBI_CKPT_MAX_START PEBs, so
+ * this function picks the least worn out free PEB among them. The PEB is not
+ * added to any tree, it is owned by the checkpoint sub-system until it is
+ * returned with 'ubi_wl_put_ckpt_peb()'. Returns the PEB number in case of
+ * success and %-ENOSPC if there is no suitable free PEB.
+ */
+int ubi_wl_get_ckpt_peb(struct ubi_device *ubi)
+{
+	struct rb_node *rb;
+	struct ubi_wl_entry *e;
+
+	spin_lock(&ubi->wl_lock);
+	ubi_rb_for_each_entry(rb, e, &ubi->free, u.rb) {
+		if (e->pnum < UBI_CKPT_MAX_START) {
+			rb_erase(&e->u.rb, &ubi->free);
+			ubi->free_count -= 1;
+			spin_unlock(&ubi->wl_lock);
+			dbg_wl("PEB %d EC %d", e->pnum, e->ec);
+			return e->pnum;
+		}
+	}
+	spin_unlock(&ubi->wl_lock);
+	return -ENOSPC;
+}
+
+/**
+ * ubi_wl_put_ckpt_peb - return a checkpoint PEB.
+ * @ubi: UBI device description object
+ * @pnum: the PEB to return
+ * @torture: if this physical eraseblock has to be tortured
+ *
+ * This function schedules erasure of a PEB obtained with
+ * 'ubi_wl_get_ckpt_peb()'. Returns zero in case of success and a negative
+ * error code in case of failure.
+ */
+int ubi_wl_put_ckpt_peb(struct ubi_device *ubi, int pnum, int torture)
+{
+	struct ubi_wl_entry *e;
+
+	dbg_wl("PEB %d", pnum);
+	spin_lock(&ubi->wl_lock);
+	e = ubi->lookuptbl[pnum];
+	spin_unlock(&ubi->wl_lock);
+	ubi_assert(e);
+
+	return schedule_erase(ubi, e, torture);
+}
+
+/**
+ * ubi_wl_ckpt_states - record erase counters and PEB states for a checkpoint.
+ * @ubi: UBI device description object
+ * @pebs: the checkpoint PEB records to fill
+ *
+ * Free PEBs are recorded as %UBI_CKPT_PEB_FREE and PEBs which are in no tree,
+ * i.e., waiting for erasure or being moved, as %UBI_CKPT_PEB_ERASE. Used PEBs
+ * are left in the %UBI_CKPT_PEB_SCAN state, the caller marks the mapped ones
+ * as %UBI_CKPT_PEB_USED.
+ */
+void ubi_wl_ckpt_states(struct ubi_device *ubi, struct ubi_ckpt_peb *pebs)
+{
+	int i;
+	struct rb_node *rb;
+	struct ubi_wl_entry *e;
+
+	memset(pebs, 0, ubi->peb_count * sizeof(struct ubi_ckpt_peb));
+
+	spin_lock(&ubi->wl_lock);
+	for (i = 0; i < ubi->peb_count; i++) {
+		e = ubi->lookuptbl[i];
+		if (!e)
+			continue;
+		pebs[i].ec = cpu_to_be32(e->ec);
+		pebs[i].state = UBI_CKPT_PEB_ERASE;
+	}
+
+	ubi_rb_for_each_entry(rb, e, &ubi->free, u.rb)
+		pebs[e->pnum].state = UBI_CKPT_PEB_FREE;
+	ubi_rb_for_each_entry(rb, e, &ubi->used, u.rb)
+		pebs[e->pnum].state = UBI_CKPT_PEB_SCAN;
+	ubi_rb_for_each_entry(rb, e, &ubi->scrub, u.rb)
+		pebs[e->pnum].state = UBI_CKPT_PEB_SCAN;
+	ubi_rb_for_each_entry(rb, e, &ubi->erroneous, u.rb)
+		pebs[e->pnum].state = UBI_CKPT_PEB_SCAN;
+	for (i = 0; i < UBI_PROT_QUEUE_LEN; i++)
+		list_for_each_entry(e, &ubi->pq[i], u.list)
+			pebs[e->pnum].state = UBI_CKPT_PEB_SCAN;
+	spin_unlock(&ubi->wl_lock);
+}
+
+#endif /* CONFIG_MTD_UBI_CHECKPOINT */
+
 #ifdef CONFIG_MTD_UBI_DEBUG_PARANOID
 
 /**
@@ -33,6 +33,7 @@
 #include <linux/can/dev.h>
 #include <linux/can/error.h>
 #include <mach/da8xx.h>
+#include <mach/pru.h>
 #include <pru_can_emulation_api.h>
 
 #define DRV_NAME "ti_omapl_pru_can"
@@ -79,8 +80,7 @@
  */
 struct omapl_pru_can_priv {
 	struct can_priv can;	/* must be the first member,can_priv = netdev_priv(ndev) */
-	struct workqueue_struct *pru_can_wQ;
-	struct work_struct rx_work;
+	struct napi_struct napi;
 	struct net_device *ndev;
 	struct clk *clk;
 	struct clk *clk_timer;
@@ -95,7 +95,17 @@ struct omapl_pru_can_priv {
 	u32 tx_head;
 	u32 tx_tail;
 	u32 tx_next;
+	u32 tx_busy;		/* mailboxes handed to the PRU, not yet sent */
+	u8 tx_dlc[MB_MAX + 1];
 	u32 rx_next;
+	u32 rx_id[MB_MAX + 1];	/* acceptance filter, one CAN ID per mailbox */
+};
+
+static const u32 omapl_pru_can_dflt_rx_id[MB_MAX + 1] = {
+	CONFIG_OMAPL_PRU_CANID_MBX0, CONFIG_OMAPL_PRU_CANID_MBX1,
+	CONFIG_OMAPL_PRU_CANID_MBX2, CONFIG_OMAPL_PRU_CANID_MBX3,
+	CONFIG_OMAPL_PRU_CANID_MBX4, CONFIG_OMAPL_PRU_CANID_MBX5,
+	CONFIG_OMAPL_PRU_CANID_MBX6, CONFIG_OMAPL_PRU_CANID_MBX7,
 };
 
 static int omapl_pru_can_get_state(const struct net_device *ndev,
@@ -187,6 +197,13 @@ static int omapl_pru_can_set_mode(struct net_device *ndev, enum can_mode mode)
 	return ret;
 }
 
+/*
+ * Frames are striped across the TX mailboxes, tx_tail up to tx_head, so up
+ * to MB_MAX + 1 can be queued on the PRU at once.  The PRU sends pending
+ * mailboxes lowest first; so that a frame never overtakes an earlier one,
+ * the queue stops at tx_head and only restarts from tx_tail once every
+ * mailbox has gone out.
+ */
 static netdev_tx_t omapl_pru_can_start_xmit(struct sk_buff *skb,
 					    struct net_device *ndev)
 {
@@ -196,8 +213,9 @@ static netdev_tx_t omapl_pru_can_start_xmit(struct sk_buff *skb,
 	u8 *data = cf->data;
 	u8 dlc = cf->can_dlc;
 	u8 *ptr8data = NULL;
+	unsigned long flags;
+	u32 mbxno;
 
-	netif_stop_queue(ndev);
 	if (cf->can_id & CAN_EFF_FLAG)	/* Extended frame format */
 		*((u32 *) & priv->can_tx_hndl.strcanmailbox) =
 		    (cf->can_id & CAN_EFF_MASK) | PRU_CANMID_IDE;
@@ -213,41 +231,32 @@ static netdev_tx_t omapl_pru_can_start_xmit(struct sk_buff *skb,
 		*ptr8data-- = *data++;
 	}
 	*((u32 *) & priv->can_tx_hndl.strcanmailbox.u16datalength) = (u32) dlc;
-/*
- * search for the next available mbx
- * if the next mbx is busy, then try the next + 1
- * do this until the head is reached.
- * if still unable to tx, stop accepting any packets
- * if able to tx and the head is reached, then reset next to tail, i.e mbx0
- * if head is not reached, then just point to the next mbx
- */
-	for (; priv->tx_next <= priv->tx_head; priv->tx_next++) {
-		priv->can_tx_hndl.ecanmailboxnumber =
-		    (can_mailbox_number) priv->tx_next;
-		if (-1 == pru_can_write_data_to_mailbox(&priv->can_tx_hndl)) {
-			if (priv->tx_next == priv->tx_head) {
-				priv->tx_next = priv->tx_tail;
-				if (!netif_queue_stopped(ndev))
-					netif_stop_queue(ndev);	/* IF stalled */
-				dev_err(priv->ndev->dev.parent,
-					"%s: no tx mbx available", __func__);
-				return NETDEV_TX_BUSY;
-			} else
-				continue;
-		} else {
-			/* set transmit request */
-			pru_can_transfer(priv->tx_next, CAN_TX_PRU_1);
-			pru_can_transfer_mode_set(false, ecanreceive);
-			pru_can_transfer_mode_set(true, ecantransmit);
-			pru_can_start_or_abort_transmission(PRU_CAN_START);
-			priv->tx_next++;
-			can_put_echo_skb(skb, ndev, 0);
-			break;
-		}
-	}
-	if (priv->tx_next > priv->tx_head) {
-		priv->tx_next = priv->tx_tail;
+
+	spin_lock_irqsave(&priv->mbox_lock, flags);
+	mbxno = priv->tx_next;
+	priv->can_tx_hndl.ecanmailboxnumber = (can_mailbox_number) mbxno;
+	if (-1 == pru_can_write_data_to_mailbox(&priv->can_tx_hndl)) {
+		netif_stop_queue(ndev);
+		spin_unlock_irqrestore(&priv->mbox_lock, flags);
+		dev_err(priv->ndev->dev.parent,
+			"%s: tx mbx %u not available\n", __func__, mbxno);
+		return NETDEV_TX_BUSY;
 	}
+
+	priv->tx_busy |= BIT(mbxno);
+	priv->tx_dlc[mbxno] = dlc;
+	can_put_echo_skb(skb, ndev, mbxno);
+
+	/* set transmit request */
+	pru_can_transfer(mbxno, CAN_TX_PRU_1);
+	pru_can_transfer_mode_set(false, ecanreceive);
+	pru_can_transfer_mode_set(true, ecantransmit);
+	pru_can_start_or_abort_transmission(PRU_CAN_START);
+
+	if (++priv->tx_next > priv->tx_head)
+		netif_stop_queue(ndev);
+	spin_unlock_irqrestore(&priv->mbox_lock, flags);
+
 	return NETDEV_TX_OK;
 }
 
@@ -274,7 +283,8 @@ static int omapl_pru_can_rx(struct net_device *ndev, u32 mbxno)
 	priv->can_rx_hndl.ecanmailboxnumber = (can_mailbox_number) mbxno;
 	if (pru_can_get_data_from_mailbox(&priv->can_rx_hndl)) {
 		__can_err("pru_can_get_data_from_mailbox: failed\n");
-		return EAGAIN;
+		kfree_skb(skb);
+		return -EAGAIN;
 	}
 	/* give ownweship to pru */
 	pru_can_transfer(mbxno, CAN_RX_PRU_0);
@@ -314,9 +324,9 @@ static int omapl_pru_can_rx(struct net_device *ndev, u32 mbxno)
 	if (pru_can_mbx_data & CAN_RTR_FLAG)
 		cf->can_id |= CAN_RTR_FLAG;
 
-	netif_rx_ni(skb);
 	stats->rx_packets++;
 	stats->rx_bytes += cf->can_dlc;
+	netif_receive_skb(skb);
 	return 0;
 }
 
@@ -370,44 +380,59 @@ static int omapl_pru_can_err(struct net_device *ndev, int int_status,
 	return 0;
 }
 
-void omapl_pru_can_rx_wQ(struct work_struct *work)
+/* RTR first, then the filled mailboxes lowest first; -1 if none */
+static int omapl_pru_can_rx_pending(struct omapl_pru_can_priv *priv)
 {
-	struct omapl_pru_can_priv *priv = container_of(work,
-						       struct
-						       omapl_pru_can_priv,
-						       rx_work);
-	struct net_device *ndev = priv->ndev;
-	u32 bit_set, mbxno = 0;
+	u32 status;
 
 	if (-1 == pru_can_get_interrupt_status(&priv->can_rx_hndl))
-		return;
+		return -1;
+
+	status = priv->can_rx_hndl.u32interruptstatus;
+	if (PRU_CAN_ISR_BIT_RRI & status)
+		return RTR_MBX_NO;
+	if (status & 0xFF)
+		return __ffs(status & 0xFF);
+	return -1;
+}
 
-	if (PRU_CAN_ISR_BIT_RRI & priv->can_rx_hndl.u32interruptstatus) {
-		mbxno = RTR_MBX_NO;
-		omapl_pru_can_rx(ndev, mbxno);
-	} else {
-		/* Extract the mboxno from the status */
-		for (bit_set = 0; ((priv->can_rx_hndl.u32interruptstatus
-				    & 0xFF) >> bit_set != 0); bit_set++) ;
-		if (0 == bit_set) {
-			dev_err(ndev->dev.parent,
-				"%s: invalid mailbox number: %X\n", __func__,
-				priv->can_rx_hndl.u32interruptstatus);
-		} else {
-			mbxno = bit_set - 1;	/* mail box numbering starts from 0 */
-			if (PRU_CAN_ISR_BIT_ESI & priv->can_rx_hndl.
-			    u32interruptstatus) {
-				pru_can_get_global_status(&priv->can_rx_hndl);
-				omapl_pru_can_err(ndev,
-						  priv->can_rx_hndl.
-						  u32interruptstatus,
-						  priv->can_rx_hndl.
-						  u32globalstatus);
-			} else {
-				omapl_pru_can_rx(ndev, mbxno);
-			}
-		}
+/*
+ * Drain every filled RX mailbox per poll instead of one per interrupt.
+ * Each mailbox read hands it straight back to the PRU, so the status
+ * is re-read after each frame to pick up frames that arrived meanwhile.
+ */
+static int omapl_pru_can_rx_poll(struct napi_struct *napi, int quota)
+{
+	struct net_device *ndev = napi->dev;
+	struct omapl_pru_can_priv *priv = netdev_priv(ndev);
+	int num_pkts = 0;
+	int mbxno;
+
+	if (!netif_running(ndev))
+		return 0;
+
+	mbxno = omapl_pru_can_rx_pending(priv);
+	if (PRU_CAN_ISR_BIT_ESI & priv->can_rx_hndl.u32interruptstatus) {
+		pru_can_get_global_status(&priv->can_rx_hndl);
+		omapl_pru_can_err(ndev, priv->can_rx_hndl.u32interruptstatus,
+				  priv->can_rx_hndl.u32globalstatus);
+	}
+
+	while (mbxno >= 0 && num_pkts < quota) {
+		if (omapl_pru_can_rx(ndev, mbxno) < 0)
+			return num_pkts;
+		++num_pkts;
+		mbxno = omapl_pru_can_rx_pending(priv);
 	}
+
+	if (num_pkts < quota) {
+		napi_complete(napi);
+		/* a frame may have landed after the last status read */
+		if (omapl_pru_can_rx_pending(priv) >= 0)
+			napi_reschedule(napi);
+	}
+
+	return num_pkts;
 }
 
 irqreturn_t omapl_tx_can_intr(int irq, void *dev_id)
@@ -415,43 +440,45 @@ irqreturn_t omapl_tx_can_intr(int irq, void *dev_id)
 	struct net_device *ndev = dev_id;
 	struct omapl_pru_can_priv *priv = netdev_priv(ndev);
 	struct net_device_stats *stats = &ndev->stats;
-	u32 bit_set, mbxno;
+	u32 status, done, mbxno;
 
+	spin_lock(&priv->mbox_lock);
 	pru_can_get_interrupt_status(&priv->can_tx_hndl);
-	if ((PRU_CAN_ISR_BIT_CCI & priv->can_tx_hndl.u32interruptstatus)
-	    || (PRU_CAN_ISR_BIT_SRDI & priv->can_tx_hndl.u32interruptstatus)) {
-		__can_debug("tx_int_status = 0x%X\n",
-			    priv->can_tx_hndl.u32interruptstatus);
-		can_free_echo_skb(ndev, 0);
+	status = priv->can_tx_hndl.u32interruptstatus;
+	if ((PRU_CAN_ISR_BIT_CCI & status) || (PRU_CAN_ISR_BIT_SRDI & status)) {
+		__can_debug("tx_int_status = 0x%X\n", status);
+		/* the PRU dropped what it had queued */
+		for (done = priv->tx_busy; done; done &= done - 1)
+			can_free_echo_skb(ndev, __ffs(done));
+		priv->tx_busy = 0;
+	} else if (PRU_CAN_ISR_BIT_ESI & status) {
+		/* read gsr and ack pru */
+		pru_can_get_global_status(&priv->can_tx_hndl);
+		omapl_pru_can_err(ndev, status,
+				  priv->can_tx_hndl.u32globalstatus);
 	} else {
-		for (bit_set = 0; ((priv->can_tx_hndl.u32interruptstatus
-				    & 0xFF) >> bit_set != 0); bit_set++) ;
-		if (0 == bit_set) {
-			__can_err("%s: invalid mailbox number\n", __func__);
-			can_free_echo_skb(ndev, 0);
-		} else {
-			mbxno = bit_set - 1;	/* mail box numbering starts from 0 */
-			if (PRU_CAN_ISR_BIT_ESI & priv->can_tx_hndl.
-			    u32interruptstatus) {
-				/* read gsr and ack pru */
-				pru_can_get_global_status(&priv->can_tx_hndl);
-				omapl_pru_can_err(ndev,
-						  priv->can_tx_hndl.
-						  u32interruptstatus,
-						  priv->can_tx_hndl.
-						  u32globalstatus);
-			} else {
-				stats->tx_packets++;
-				/* stats->tx_bytes += dlc; */
-				//can_//get_echo_skb(ndev, 0);
-			}
+		done = status & priv->tx_busy & 0xFF;
+		if (!done)
+			__can_err("%s: invalid mailbox status %X\n", __func__,
+				  status);
+		for (; done; done &= done - 1) {
+			mbxno = __ffs(done);
+			stats->tx_packets++;
+			stats->tx_bytes += priv->tx_dlc[mbxno];
+			can_get_echo_skb(ndev, mbxno);
+			priv->tx_busy &= ~BIT(mbxno);
 		}
 	}
-	if (netif_queue_stopped(ndev))
+
+	/* every mailbox has gone out: start over and let the PRU listen */
+	if (!priv->tx_busy) {
+		priv->tx_next = priv->tx_tail;
+		pru_can_transfer_mode_set(true, ecanreceive);
+	}
+	if (netif_queue_stopped(ndev) && priv->tx_next <= priv->tx_head)
 		netif_wake_queue(ndev);
+	spin_unlock(&priv->mbox_lock);
 
-	can_get_echo_skb(ndev, 0);
-	pru_can_transfer_mode_set(true, ecanreceive);
 	return IRQ_HANDLED;
 }
 
@@ -466,10 +493,8 @@ irqreturn_t omapl_rx_can_intr(int irq, void *dev_id)
 	if(intc_status & 4){
 		return omapl_tx_can_intr(irq, dev_id);
 	}
-	if(intc_status & 2){
-		if (!work_pending(&priv->rx_work))
-            queue_work(priv->pru_can_wQ, &priv->rx_work);
-	}
+	if (intc_status & 2)
+		napi_schedule(&priv->napi);
 
 	return IRQ_HANDLED;
 }
@@ -477,7 +502,7 @@ irqreturn_t omapl_rx_can_intr(int irq, void *dev_id)
 static int omapl_pru_can_open(struct net_device *ndev)
 {
 	struct omapl_pru_can_priv *priv = netdev_priv(ndev);
-	int err;
+	int err, i;
 
 	/* register interrupt handler */
 	err = request_irq(priv->trx_irq, &omapl_rx_can_intr, IRQF_SHARED,
@@ -498,17 +523,14 @@ static int omapl_pru_can_open(struct net_device *ndev)
 	pru_can_emulation_init(&priv->pru_arm_iomap, priv->can.clock.freq);
 	priv->tx_tail = MB_MIN;
 	priv->tx_head = MB_MAX;
+	priv->tx_next = priv->tx_tail;
+	priv->tx_busy = 0;
 
-	pru_can_receive_id_map(CONFIG_OMAPL_PRU_CANID_MBX0, 0);
-	pru_can_receive_id_map(CONFIG_OMAPL_PRU_CANID_MBX1, 1);
-	pru_can_receive_id_map(CONFIG_OMAPL_PRU_CANID_MBX2, 2);
-	pru_can_receive_id_map(CONFIG_OMAPL_PRU_CANID_MBX3, 3);
-	pru_can_receive_id_map(CONFIG_OMAPL_PRU_CANID_MBX4, 4);
-	pru_can_receive_id_map(CONFIG_OMAPL_PRU_CANID_MBX5, 5);
-	pru_can_receive_id_map(CONFIG_OMAPL_PRU_CANID_MBX6, 6);
-	pru_can_receive_id_map(CONFIG_OMAPL_PRU_CANID_MBX7, 7);
+	for (i = MB_MIN; i <= MB_MAX; i++)
+		pru_can_receive_id_map(priv->rx_id[i], i);
 
 	omapl_pru_can_start(ndev);
+	napi_enable(&priv->napi);
 	netif_start_queue(ndev);
 	return 0;
 
@@ -524,6 +546,7 @@ static int omapl_pru_can_close(struct net_device *ndev)
 
 	if (!netif_queue_stopped(ndev))
 		netif_stop_queue(ndev);
+	napi_disable(&priv->napi);
 
 	close_candev(ndev);
 
@@ -539,6 +562,55 @@ static const struct net_device_ops omapl_pru_can_netdev_ops = {
 	.ndo_start_xmit = omapl_pru_can_start_xmit,
 };
 
+/*
+ * rx_id_map: the CAN ID each RX mailbox accepts.  The PRU drops frames
+ * with any other ID, so they never cost the ARM an interrupt.  Reads
+ * list "<mailbox> <id>" per line; writing "<mailbox> <id>" changes one,
+ * taking effect at once if the interface is up.
+ */
+static ssize_t omapl_pru_can_show_rx_id(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct omapl_pru_can_priv *priv = netdev_priv(to_net_dev(dev));
+	ssize_t len = 0;
+	int i;
+
+	for (i = MB_MIN; i <= MB_MAX; i++)
+		len += sprintf(buf + len, "%d 0x%x\n", i, priv->rx_id[i]);
+	return len;
+}
+
+static ssize_t omapl_pru_can_store_rx_id(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t count)
+{
+	struct net_device *ndev = to_net_dev(dev);
+	struct omapl_pru_can_priv *priv = netdev_priv(ndev);
+	unsigned int mbxno;
+	u32 id;
+
+	if (sscanf(buf, "%u %i", &mbxno, &id) != 2)
+		return -EINVAL;
+	if (mbxno > MB_MAX || id > CAN_EFF_MASK)
+		return -EINVAL;
+
+	priv->rx_id[mbxno] = id;
+	if (netif_running(ndev))
+		pru_can_receive_id_map(id, mbxno);
+	return count;
+}
+
+static DEVICE_ATTR(rx_id_map, S_IRUGO | S_IWUSR, omapl_pru_can_show_rx_id,
+		   omapl_pru_can_store_rx_id);
+
+static struct attribute *omapl_pru_can_attrs[] = {
+	&dev_attr_rx_id_map.attr,
+	NULL,
+};
+
+static const struct attribute_group omapl_pru_can_attr_group = {
+	.attrs = omapl_pru_can_attrs,
+};
+
 static int __devinit omapl_pru_can_probe(struct platform_device *pdev)
 {
 	struct net_device *ndev = NULL;
@@ -614,6 +686,9 @@ static int __devinit omapl_pru_can_probe(struct platform_device *pdev)
 
 	priv->ndev = ndev;
 	priv->trx_irq = trx_irq->start;
+	spin_lock_init(&priv->mbox_lock);
+	memcpy(priv->rx_id, omapl_pru_can_dflt_rx_id, sizeof(priv->rx_id));
+	netif_napi_add(ndev, &priv->napi, omapl_pru_can_rx_poll, MB_MAX + 1);
 
 	priv->can.bittiming_const = NULL;
 	priv->can.do_set_bittiming = omapl_pru_can_set_bittiming;
@@ -652,12 +727,22 @@ static int __devinit omapl_pru_can_probe(struct platform_device *pdev)
 		goto probe_exit_clk;
 	}
 
+	/* PRU0 transmits and PRU1 receives */
+	err = davinci_pru_request(0, &pdev->dev);
+	if (err)
+		goto probe_exit_clk;
+	err = davinci_pru_request(1, &pdev->dev);
+	if (err) {
+		davinci_pru_release(0);
+		goto probe_exit_clk;
+	}
+
 	err = request_firmware(&priv->fw_tx, "PRU_CAN_Emulation_Tx.bin",
 			       &pdev->dev);
 	if (err) {
 		dev_err(&pdev->dev, "can't load firmware\n");
 		err = -ENODEV;
-		goto probe_exit_clk;
+		goto probe_release_pru;
 	}
 
 	dev_info(&pdev->dev, "fw_tx size %d. downloading...\n",
@@ -718,12 +803,9 @@ static int __devinit omapl_pru_can_probe(struct platform_device *pdev)
 	kfree((const void *)fw_pru.ptr_pru0);
 	kfree((const void *)fw_pru.ptr_pru1);
 
-	/*Create The Work Queue */
-	if ((priv->pru_can_wQ =
-	     create_freezeable_workqueue("omapl_pru_wQ")) == NULL)
-		dev_err(&pdev->dev, "failed to create work queue\n");
+	if (sysfs_create_group(&ndev->dev.kobj, &omapl_pru_can_attr_group))
+		dev_warn(&pdev->dev, "can't create sysfs attributes\n");
 
-	INIT_WORK(&priv->rx_work, omapl_pru_can_rx_wQ);
 	dev_info(&pdev->dev,
 		 "%s device registered"
 		 "(&reg_base=0x%p, trx_irq = %d,  clk = %d)\n",
@@ -737,6 +819,9 @@ probe_release_fw_1:
 	release_firmware(priv->fw_rx);
 probe_release_fw:
 	release_firmware(priv->fw_tx);
+probe_release_pru:
+	davinci_pru_release(1);
+	davinci_pru_release(0);
 probe_exit_clk:
 	clk_put(priv->clk);
 probe_exit_candev:
@@ -759,11 +844,12 @@ static int __devexit omapl_pru_can_remove(struct platform_device *pdev)
 	omapl_pru_can_stop(ndev);
 
 	pru_can_emulation_exit();
+	davinci_pru_release(1);
+	davinci_pru_release(0);
 	release_firmware(priv->fw_tx);
 	release_firmware(priv->fw_rx);
 	clk_put(priv->clk);
-	flush_workqueue(priv->pru_can_wQ);
-	destroy_workqueue(priv->pru_can_wQ);
+	sysfs_remove_group(&ndev->dev.kobj, &omapl_pru_can_attr_group);
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	iounmap(priv->pru_arm_iomap.pru_io_addr);
 	release_mem_region(res->start, resource_size(res));
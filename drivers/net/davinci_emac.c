@@ -29,8 +29,14 @@
  *     PHY layer usage
  */
 
-/** Pending Items in this driver:
- * 1. Use Linux cache infrastcture for DMA'ed memory (dma_xxx functions)
+/** Channel usage:
+ * Up to 8 TX and 8 RX CPPI channels are used, as set in platform data.
+ * Every TX channel is a netdev TX queue; the hardware services TX channels
+ * in fixed priority (channel 7 highest) and emac_dev_select_queue() maps
+ * skb->priority onto them. Unicast frames for the interface address go to
+ * RX channel 0 while broadcast, multicast and promiscuous frames can be
+ * steered to other channels through the RX MBP register. NAPI services RX
+ * channels from the highest numbered down.
  */
 
 #include <linux/module.h>
@@ -46,7 +52,10 @@
 #include <linux/interrupt.h>
 #include <linux/init.h>
 #include <linux/netdevice.h>
+#include <linux/rtnetlink.h>
 #include <linux/etherdevice.h>
+#include <linux/if_vlan.h>
+#include <linux/ip.h>
 #include <linux/skbuff.h>
 #include <linux/ethtool.h>
 #include <linux/highmem.h>
@@ -60,9 +69,18 @@
 #include <linux/semaphore.h>
 #include <linux/phy.h>
 #include <linux/bitops.h>
+#include <linux/log2.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/io.h>
 #include <linux/uaccess.h>
 #include <linux/davinci_emac.h>
+#include <linux/davinci_zcbuf.h>
+#include <linux/pm_qos_params.h>
+#include <net/ip.h>
+#include <net/sch_generic.h>
 
 #include <asm/irq.h>
 #include <asm/page.h>
@@ -71,6 +89,64 @@ static int debug_level;
 module_param(debug_level, int, 0);
 MODULE_PARM_DESC(debug_level, "DaVinci EMAC debug level (NETIF_MSG bits)");
 
+static int rx_pool_depth = 32;
+module_param(rx_pool_depth, int, 0);
+MODULE_PARM_DESC(rx_pool_depth, "DaVinci EMAC RX buffers pooled per channel");
+
+static int rx_copybreak = 256;
+module_param(rx_copybreak, int, 0644);
+MODULE_PARM_DESC(rx_copybreak, "DaVinci EMAC RX frames below this size are "
+		 "copied, 0 = off");
+
+static int busy_poll;
+module_param(busy_poll, int, 0);
+MODULE_PARM_DESC(busy_poll, "DaVinci EMAC low latency RX: usecs a realtime "
+		 "thread keeps polling after the last packet, 0 = NAPI");
+
+static int poll_thread;
+module_param(poll_thread, int, 0);
+MODULE_PARM_DESC(poll_thread, "DaVinci EMAC: poll from a realtime thread "
+		 "instead of the NET_RX softirq, also without busy_poll");
+
+static int busy_poll_prio = 50;
+module_param(busy_poll_prio, int, 0);
+MODULE_PARM_DESC(busy_poll_prio, "DaVinci EMAC poll thread SCHED_FIFO priority");
+
+static int mdio_irq = 1;
+module_param(mdio_irq, int, 0);
+MODULE_PARM_DESC(mdio_irq, "DaVinci EMAC: sleep on MDIO accesses and take PHY "
+		 "link changes from the MDIO interrupts, 0 = poll");
+
+static int cpufreq_min_khz = 300000;
+module_param(cpufreq_min_khz, int, 0644);
+MODULE_PARM_DESC(cpufreq_min_khz, "DaVinci EMAC: lowest CPU frequency in kHz "
+		 "asked for during traffic bursts, 0 = off");
+
+static int cpufreq_burst_pkts = 50;
+module_param(cpufreq_burst_pkts, int, 0644);
+MODULE_PARM_DESC(cpufreq_burst_pkts, "DaVinci EMAC: packets per 100 ms that "
+		 "count as a burst");
+
+static int cpufreq_hold_ms = 1000;
+module_param(cpufreq_hold_ms, int, 0644);
+MODULE_PARM_DESC(cpufreq_hold_ms, "DaVinci EMAC: msecs the CPU frequency "
+		 "floor is kept after the last burst");
+
+static int tx_reclaim = 32;
+module_param(tx_reclaim, int, 0644);
+MODULE_PARM_DESC(tx_reclaim, "DaVinci EMAC: retire sent packets from xmit "
+		 "with the TX interrupt masked while at least this many TX "
+		 "BD's are free, 0 = interrupt per completion");
+
+#ifdef CONFIG_TI_DAVINCI_EMAC_BENCH
+static int rx_sink;
+module_param(rx_sink, int, 0644);
+MODULE_PARM_DESC(rx_sink, "DaVinci EMAC benchmark: free received frames "
+		 "instead of passing them to the stack");
+#else
+#define rx_sink		0
+#endif
+
 /* Netif debug messages possible */
 #define DAVINCI_EMAC_DEBUG	(NETIF_MSG_DRV | \
 				NETIF_MSG_PROBE | \
@@ -99,6 +175,7 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_DEF_PASS_CRC		(0) /* Do not pass CRC upto frames */
 #define EMAC_DEF_QOS_EN			(0) /* EMAC proprietary QoS disabled */
 #define EMAC_DEF_NO_BUFF_CHAIN		(0) /* No buffer chain */
+#define EMAC_DEF_TX_SG_EN		(1) /* TX buffer chaining enabled */
 #define EMAC_DEF_MACCTRL_FRAME_EN	(0) /* Discard Maccontrol frames */
 #define EMAC_DEF_SHORT_FRAME_EN		(0) /* Discard short frames */
 #define EMAC_DEF_ERROR_FRAME_EN		(0) /* Discard error frames */
@@ -115,15 +192,24 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_DEF_BUFFER_OFFSET		(0) /* Buffer offset to DMA (future) */
 #define EMAC_DEF_MIN_ETHPKTSIZE		(60) /* Minimum ethernet pkt size */
 #define EMAC_DEF_MAX_FRAME_SIZE		(1500 + 14 + 4 + 4)
+#define EMAC_FRAME_EXTRA		(ETH_HLEN + VLAN_HLEN + ETH_FCS_LEN)
+#define EMAC_MIN_MTU			(68)
+#define EMAC_DM646X_MAX_MTU		(9000) /* jumbo frames, gigabit EMAC */
+#define EMAC_RX_HDR_COPY		(128) /* page RX: header bytes copied */
+#define EMAC_RX_RULES			(16) /* RX classifier table size */
+#define EMAC_RX_FILTER_LEN		(96) /* header bytes it looks at */
 #define EMAC_DEF_TX_CH			(0) /* Default 0th channel */
 #define EMAC_DEF_RX_CH			(0) /* Default 0th channel */
 #define EMAC_DEF_MDIO_TICK_MS		(10) /* typically 1 tick=1 ms) */
-#define EMAC_DEF_MAX_TX_CH		(1) /* Max TX channels configured */
-#define EMAC_DEF_MAX_RX_CH		(1) /* Max RX channels configured */
+#define EMAC_DEF_MAX_TX_CH		(1) /* TX channels if pdata has none */
+#define EMAC_DEF_MAX_RX_CH		(1) /* RX channels if pdata has none */
 #define EMAC_POLL_WEIGHT		(64) /* Default NAPI poll weight */
 
 /* Buffer descriptor parameters */
 #define EMAC_DEF_TX_MAX_SERVICE		(32) /* TX max service BD's */
+#define EMAC_DEF_TX_KICK_BATCH		(16) /* TX BD's queued per doorbell */
+#define EMAC_DEF_TX_BYTE_LIMIT		(16 * EMAC_DEF_MAX_FRAME_SIZE)
+#define EMAC_DEF_TX_RECLAIM_MS		(10) /* TX irq masked by xmit at most */
 #define EMAC_DEF_RX_MAX_SERVICE		(64) /* should = netdev->weight */
 
 /* EMAC register related defines */
@@ -133,6 +219,7 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_TX_CONTROL_TX_ENABLE_VAL	(0x1)
 #define EMAC_RX_CONTROL_RX_ENABLE_VAL	(0x1)
 #define EMAC_MAC_HOST_ERR_INTMASK_VAL	(0x2)
+#define EMAC_MAC_STAT_INTMASK_VAL	(0x1)
 #define EMAC_RX_UNICAST_CLEAR_ALL	(0xFF)
 #define EMAC_INT_MASK_CLEAR		(0xFF)
 
@@ -193,12 +280,19 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_DM644X_MAC_IN_VECTOR_STATPEND_INT	BIT(16)
 #define EMAC_DM644X_MAC_IN_VECTOR_RX_INT_VEC	BIT(8)
 #define EMAC_DM644X_MAC_IN_VECTOR_TX_INT_VEC	BIT(0)
+#define EMAC_DM644X_MAC_IN_VECTOR_RX_INT_SHIFT	(8)
+#define EMAC_DM644X_MAC_IN_VECTOR_TX_INT_SHIFT	(0)
 
 /** NOTE:: For DM646x the IN_VECTOR has changed */
 #define EMAC_DM646X_MAC_IN_VECTOR_RX_INT_VEC	BIT(EMAC_DEF_RX_CH)
 #define EMAC_DM646X_MAC_IN_VECTOR_TX_INT_VEC	BIT(16 + EMAC_DEF_TX_CH)
 #define EMAC_DM646X_MAC_IN_VECTOR_HOST_INT	BIT(26)
 #define EMAC_DM646X_MAC_IN_VECTOR_STATPEND_INT	BIT(27)
+#define EMAC_DM646X_MAC_IN_VECTOR_RX_INT_SHIFT	(0)
+#define EMAC_DM646X_MAC_IN_VECTOR_TX_INT_SHIFT	(16)
+
+/* Per channel pending bits in MAC_IN_VECTOR (one byte each for TX/RX) */
+#define EMAC_MAC_IN_VECTOR_CH_MASK		(0xFF)
 
 /* CPPI bit positions */
 #define EMAC_CPPI_SOP_BIT		BIT(31)
@@ -209,10 +303,16 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_CPPI_PASS_CRC_BIT		BIT(26)
 #define EMAC_RX_BD_BUF_SIZE		(0xFFFF)
 #define EMAC_BD_LENGTH_FOR_CACHE	(16) /* only CPPI bytes */
+#define EMAC_TX_MAX_BD_PER_PKT		(MAX_SKB_FRAGS + 1) /* head + frags */
+#define EMAC_TX_BD_SIZE			(16) /* struct emac_tx_bd */
+#define EMAC_RX_BD_SIZE			(32) /* struct emac_rx_bd, 4 word aligned */
+#define EMAC_MIN_RING_SIZE		(16) /* BD's per channel */
+#define EMAC_MAX_RING_SIZE		(1024)
 #define EMAC_RX_BD_PKT_LENGTH_MASK	(0xFFFF)
 
 /* Max hardware defines */
 #define EMAC_MAX_TXRX_CHANNELS		 (8)  /* Max hardware channels */
+#define EMAC_TXPRIO_LEVELS		 (8)  /* skb->priority levels mapped */
 #define EMAC_DEF_MAX_MULTICAST_ADDRESSES (64) /* Max mcast addr's */
 
 /* EMAC Peripheral Device Register Memory Layout structure */
@@ -293,6 +393,12 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_TXUNDERRUN		0x25C
 #define EMAC_TXCARRIERSENSE	0x260
 #define EMAC_TXOCTETS		0x264
+#define EMAC_FRAME64		0x268
+#define EMAC_FRAME65T127	0x26C
+#define EMAC_FRAME128T255	0x270
+#define EMAC_FRAME256T511	0x274
+#define EMAC_FRAME512T1023	0x278
+#define EMAC_FRAME1024TUP	0x27C
 #define EMAC_NETOCTETS		0x280
 #define EMAC_RXSOFOVERRUNS	0x284
 #define EMAC_RXMOFOVERRUNS	0x288
@@ -302,6 +408,9 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_CTRL_EWCTL		(0x4)
 #define EMAC_CTRL_EWINTTCNT	(0x8)
 
+/* EMAC DM644x interrupt pacing (EWINTTCNT, in bus clocks) */
+#define EMAC_DM644X_EWINTCNT_MASK	(0x1FFFF)
+
 /* EMAC MDIO related */
 /* Mask & Control defines */
 #define MDIO_CONTROL_CLKDIV	(0xFF)
@@ -313,6 +422,9 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define MDIO_USERACCESS_PHYADR	(0x1F << 16)
 #define MDIO_USERACCESS_DATA	(0xFFFF)
 #define MDIO_USERPHYSEL_LINKSEL	BIT(7)
+#define MDIO_USERPHYSEL_LINKINTENB	BIT(6)
+#define MDIO_USERPHYSEL_PHYADRMON	(0x1F)
+#define MDIO_INT_INST0		BIT(0) /* USERACCESS0/USERPHYSEL0 event */
 #define MDIO_VER_MODID		(0xFFFF << 16)
 #define MDIO_VER_REVMAJ		(0xFF   << 8)
 #define MDIO_VER_REVMIN		(0xFF)
@@ -320,17 +432,77 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define MDIO_USERACCESS(inst)	(0x80 + (inst * 8))
 #define MDIO_USERPHYSEL(inst)	(0x84 + (inst * 8))
 #define MDIO_CONTROL		(0x04)
+#define MDIO_LINKINTRAW		(0x10)
+#define MDIO_LINKINTMASKED	(0x14)
+#define MDIO_USERINTRAW		(0x20)
+#define MDIO_USERINTMASKED	(0x24)
+#define MDIO_USERINTMASKSET	(0x28)
+#define MDIO_USERINTMASKCLR	(0x2C)
+#define EMAC_MDIO_TIMEOUT	(msecs_to_jiffies(10))
 
 /* EMAC DM646X control module registers */
+#define EMAC_DM646X_CMINTCTRL	(0x0C)
 #define EMAC_DM646X_CMRXINTEN	(0x14)
 #define EMAC_DM646X_CMTXINTEN	(0x18)
+#define EMAC_DM646X_CMMISCINTEN	(0x1C)
+#define EMAC_DM646X_CMRXINTMAX	(0x70)
+#define EMAC_DM646X_CMTXINTMAX	(0x74)
+
+/* EMAC DM646X interrupt pacing (CMINTCTRL, CMRX/TXINTMAX) */
+#define EMAC_DM646X_INTCTRL_RXPACEEN	BIT(16)
+#define EMAC_DM646X_INTCTRL_TXPACEEN	BIT(17)
+#define EMAC_DM646X_INTPRESCALE_MASK	(0x7FF) /* bus clocks per 4us */
+#define EMAC_DM646X_CMINTMAX_CNT	(63) /* max interrupts per pace unit */
+#define EMAC_DM646X_CMINTMIN_CNT	(2)  /* min interrupts per pace unit */
+#define EMAC_DM646X_PACE_UNIT_USECS	(1000) /* pace unit: 250 4us pulses */
+#define EMAC_DM646X_CMINTMAX_INTVL	(EMAC_DM646X_PACE_UNIT_USECS / \
+					 EMAC_DM646X_CMINTMIN_CNT)
+#define EMAC_DM646X_CMINTMIN_INTVL	((EMAC_DM646X_PACE_UNIT_USECS / \
+					 EMAC_DM646X_CMINTMAX_CNT) + 1)
+
+/* Adaptive RX interrupt pacing defaults (ethtool -C adaptive-rx on) */
+#define EMAC_DEF_COAL_RATE_LOW		(2000)	/* pkts/s: below use low */
+#define EMAC_DEF_COAL_RATE_HIGH		(20000)	/* pkts/s: above use high */
+#define EMAC_DEF_COAL_USECS_LOW		(EMAC_DM646X_CMINTMIN_INTVL)
+#define EMAC_DEF_COAL_USECS_HIGH	(250)
+#define EMAC_DEF_COAL_SAMPLE_SECS	(1)
+
+/* EMAC DM646X C0 misc interrupt sources (CMMISCINTEN) */
+#define EMAC_DM646X_MISCINT_USER	BIT(0) /* MDIO user access done */
+#define EMAC_DM646X_MISCINT_LINK	BIT(1) /* MDIO link change */
+#define EMAC_DM646X_MISC_IRQ_RES	(3) /* IRQ resource of the MISC line */
 
 /* EMAC EOI codes for C0 */
 #define EMAC_DM646X_MAC_EOI_C0_RXEN	(0x01)
 #define EMAC_DM646X_MAC_EOI_C0_TXEN	(0x02)
+#define EMAC_DM646X_MAC_EOI_C0_MISCEN	(0x03)
 
 /* EMAC Stats Clear Mask */
-#define EMAC_STATS_CLR_MASK    (0xFFFFFFFF)
+#define EMAC_NUM_HW_STATS	((EMAC_RXDMAOVERRUNS - EMAC_RXGOODFRAMES) / 4 + 1)
+#define EMAC_HW_STAT(reg)	(priv->hw_stats[((reg) - EMAC_RXGOODFRAMES) / 4])
+#define EMAC_STATS_INTERVAL	(5 * HZ) /* octets wrap in 34s at 1Gbps */
+#define EMAC_LAT_BUCKETS	(16) /* log2 usecs, last one open ended */
+
+/* benchmark stages, see emac_bench_add() */
+enum {
+	EMAC_BENCH_TX_XMIT,	/* emac_dev_xmit, all of it */
+	EMAC_BENCH_TX_MAP,	/* mapping (cache clean) of the skb */
+	EMAC_BENCH_TX_DESC,	/* emac_send: BD setup and doorbell */
+	EMAC_BENCH_TX_REAP,	/* completed BD's, unmapping included */
+	EMAC_BENCH_TX_FREE,	/* freeing or recycling sent skbs */
+	EMAC_BENCH_RX_POLL,	/* emac_rx_bdproc, all of it */
+	EMAC_BENCH_RX_ALLOC,	/* refilling the ring */
+	EMAC_BENCH_RX_UNMAP,	/* handing the buffer to the CPU */
+	EMAC_BENCH_RX_STACK,	/* eth_type_trans on, or the rx_sink */
+	EMAC_BENCH_NR
+};
+
+struct emac_bench {
+	u32 calls;
+	u32 items; /* packets or buffers the calls covered */
+	u64 ns;
+	u32 max_ns; /* longest single call */
+};
 
 /** net_buf_obj: EMAC network bufferdata structure
  *
@@ -339,9 +511,20 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 struct emac_netbufobj {
 	void *buf_token;
 	char *data_ptr;
+	dma_addr_t dma_addr;
 	int length;
 };
 
+/** emac_skb_cb: EMAC RX skb control block
+ *
+ * Streaming DMA mapping of a RX skb owned by the driver (ring or pool)
+ */
+struct emac_skb_cb {
+	dma_addr_t dma_addr;
+};
+
+#define EMAC_SKB_CB(skb)	((struct emac_skb_cb *)((skb)->cb))
+
 /** net_pkt_obj: EMAC network packet data structure
  *
  * EMAC network packet data structure - supports buffer list (for future)
@@ -362,8 +545,19 @@ struct emac_tx_bd {
 	int buff_ptr;
 	int off_b_len;
 	int mode; /* SOP, EOP, ownership, EOQ, teardown,Qstarv, length */
-	struct emac_tx_bd __iomem *next;
-	void *buf_token;
+};
+
+/** emac_tx_buf: EMAC TX buffer software state
+ *
+ * One per TX BD of the ring, kept in cached memory so that completion
+ * never reads driver state back from CPPI RAM
+ */
+struct emac_tx_buf {
+	struct sk_buff *skb; /* SOP only */
+	dma_addr_t dma_addr;
+	u32 length;
+	u32 num_bd; /* SOP only: BD's used by the packet */
+	u32 pkt_length; /* SOP only: bytes accounted in flight */
 };
 
 /** emac_txch: EMAC TX Channel data structure
@@ -378,14 +572,34 @@ struct emac_txch {
 	/* CPPI specific */
 	u32 alloc_size;
 	void __iomem *bd_mem;
-	struct emac_tx_bd __iomem *bd_pool_head;
-	struct emac_tx_bd __iomem *active_queue_head;
-	struct emac_tx_bd __iomem *active_queue_tail;
+	u32 bd_mask; /* num_bd is a power of 2 */
+	struct emac_tx_buf *buf;
 	struct emac_tx_bd __iomem *last_hw_bdprocessed;
-	u32 queue_active;
+	u32 stop_thresh; /* stop queue below this many free BD's */
 	u32 teardown_pending;
 	u32 *tx_complete;
 
+	/* The BD ring is single producer (xmit, under the netdev queue lock)
+	 * single consumer (NAPI, or xmit reclaiming while holding reaping).
+	 * Indices run free and are masked on use */
+	u32 head; /* next BD to fill, written by xmit only */
+	u32 tail; /* next BD to retire, written by completion only */
+	u32 kick; /* first BD queued since the last doorbell */
+	u32 kick_batch; /* BD's queued before the doorbell is forced */
+	u32 bytes_queued; /* written by xmit only */
+	u32 bytes_completed; /* written by completion only */
+	u32 byte_limit; /* bytes in flight before the queue is stopped */
+	u32 byte_limit_min; /* two frames at the current MTU */
+	u32 byte_limit_max;
+
+	/* hardware queue restart (TXHDP and EOQ), taken once per doorbell
+	 * and on end of queue only, never from hard irq context */
+	spinlock_t lock;
+	u32 queue_active;
+	u32 hw_next; /* where to restart the hardware when idle */
+	u32 irq_masked; /* TX interrupt left to xmit reclaim, under lock */
+	unsigned long reaping; /* bit 0: a context is retiring BD's */
+
 	/** statistics */
 	u32 proc_count;     /* TX: # of times emac_tx_bdproc is called */
 	u32 mis_queued_packets;
@@ -393,9 +607,16 @@ struct emac_txch {
 	u32 end_of_queue_add;
 	u32 out_of_tx_bd;
 	u32 no_active_pkts; /* IRQ when there were no packets to process */
-	u32 active_queue_count;
+	u32 queue_stopped;
+	u32 starved; /* hardware ran dry while the queue was stopped */
+	u32 xmit_reclaimed; /* packets retired by xmit, without interrupt */
+	u32 irq_rearmed; /* TX interrupt unmasked as safety net */
 };
 
+#define EMAC_TX_BD(txch, idx)	((struct emac_tx_bd __iomem *)(txch)->bd_mem + \
+				((idx) & (txch)->bd_mask))
+#define EMAC_TX_BUF(txch, idx)	(&(txch)->buf[(idx) & (txch)->bd_mask])
+
 /** emac_rx_bd: EMAC RX Buffer descriptor data structure
  *
  * EMAC RX Buffer descriptor data structure
@@ -419,6 +640,7 @@ struct emac_rxch {
 	u32 num_bd;
 	u32 service_max;
 	u32 buf_size;
+	u32 frags; /* buffers are pages, a frame may span several BD's */
 	char mac_addr[6];
 
 	/** CPPI specific */
@@ -434,6 +656,10 @@ struct emac_rxch {
 	struct emac_netpktobj pkt_queue;
 	struct emac_netbufobj buf_queue;
 
+	/* pool of spare RX skbs, cache already invalidated for buf_size */
+	struct sk_buff_head pool;
+	u32 pool_depth;
+
 	/** statistics */
 	u32 proc_count; /* number of times emac_rx_bdproc is called */
 	u32 processed_bd;
@@ -444,6 +670,21 @@ struct emac_rxch {
 	u32 end_of_queue_add;
 	u32 end_of_queue;
 	u32 mis_queued_packets;
+	u32 pool_hits; /* RX buffer taken from pool */
+	u32 pool_misses; /* RX buffer had to be allocated */
+	u32 pool_recycled; /* buffer returned to pool (TX done / drop) */
+	u32 pool_count; /* current pool depth, sampled for ethtool */
+	u32 copybreak; /* frames copied, buffer left on the ring */
+	u32 frag_frames; /* frames received into page fragments */
+	u32 filtered; /* frames dropped by the RX classifier */
+};
+
+/* RX classifier rule; h_u is stored already masked with m_u */
+struct emac_rx_rule {
+	struct ethtool_rx_flow_spec fs;
+	u32 rate; /* frames per second let through, 0 = no limit */
+	unsigned long window; /* jiffies the current second started at */
+	u32 count; /* frames let through in the current second */
 };
 
 /* emac_priv: EMAC private data structure
@@ -456,7 +697,6 @@ struct emac_priv {
 	struct platform_device *pdev;
 	struct napi_struct napi;
 	char mac_addr[6];
-	spinlock_t tx_lock;
 	spinlock_t rx_lock;
 	void __iomem *remap_addr;
 	u32 emac_base_phys;
@@ -465,12 +705,20 @@ struct emac_priv {
 	void __iomem *emac_ctrl_ram;
 	u32 ctrl_ram_size;
 	u32 hw_ram_addr;
-	struct emac_txch *txch[EMAC_DEF_MAX_TX_CH];
-	struct emac_rxch *rxch[EMAC_DEF_MAX_RX_CH];
+	struct emac_txch *txch[EMAC_MAX_TXRX_CHANNELS];
+	struct emac_rxch *rxch[EMAC_MAX_TXRX_CHANNELS];
+	u32 num_tx_ch; /* TX channels in use, one netdev queue each */
+	u32 num_rx_ch; /* RX channels in use, higher channel serviced first */
+	u32 rx_bcast_ch; /* RX channel for broadcast frames */
+	u32 rx_mcast_ch; /* RX channel for multicast frames */
+	u32 rx_prom_ch; /* RX channel for promiscuous frames */
+	struct emac_rx_rule rx_rules[EMAC_RX_RULES]; /* under rx_lock */
+	u32 rx_rules_used; /* bit per rule location in use */
 	u32 link; /* 1=link on, 0=link off */
 	u32 speed; /* 0=Auto Neg, 1=No PHY, 10,100, 1000 - mbps */
 	u32 duplex; /* Link duplex: 0=Half, 1=Full */
 	u32 rx_buf_size;
+	u32 rx_frags; /* MTU needs page fragment RX buffers */
 	u32 isr_count;
 	u8 rmii_en;
 	u8 version;
@@ -483,39 +731,164 @@ struct emac_priv {
 	struct timer_list periodic_timer;
 	u32 periodic_ticks;
 	u32 timer_active;
+	/* unmasks TX interrupts xmit left masked once it went quiet */
+	struct timer_list tx_reclaim_timer;
 	u32 phy_mask;
 	/* mii_bus,phy members */
 	struct mii_bus *mii_bus;
 	struct phy_device *phydev;
+	u32 misc_irq; /* MDIO interrupts requested at probe, 0 = polled */
+	u32 link_irq; /* phydev link monitored by the MDIO module */
 	spinlock_t lock;
 	/*platform specific members*/
 	void (*int_enable) (void);
 	void (*int_disable) (void);
+	/* interrupt pacing, 0 usecs = pacing disabled */
+	u32 rx_coal_usecs;
+	u32 tx_coal_usecs;
+	u32 coal_adaptive;
+	u32 coal_rate_low;
+	u32 coal_rate_high;
+	u32 coal_usecs_low;
+	u32 coal_usecs_high;
+	u32 coal_sample_secs;
+	u32 coal_cur_usecs; /* RX interval currently programmed */
+	u32 coal_pkts; /* RX packets in current sample window */
+	unsigned long coal_sample_end;
+	/* BD rings, laid out at open in CPPI RAM then (bd_ddr_en) in DDR */
+	u32 tx_ring_size; /* BD's per TX channel, power of 2 */
+	u32 rx_ring_size; /* BD's per RX channel */
+	u32 bd_ddr_en;
+	void __iomem *tx_bd_mem[EMAC_MAX_TXRX_CHANNELS];
+	void __iomem *rx_bd_mem[EMAC_MAX_TXRX_CHANNELS];
+	void *bd_ddr;
+	dma_addr_t bd_ddr_phys;
+	u32 bd_ddr_size;
+	dma_addr_t tx_pad_dma; /* emac_tx_pad, mapped while open */
+	/* RX buffers kept mapped from stop to the next open */
+	struct sk_buff_head rx_park[EMAC_MAX_TXRX_CHANNELS];
+	struct list_head rx_park_pages[EMAC_MAX_TXRX_CHANNELS];
+	u32 rx_park_buf_size;
+	u32 rx_park_frags;
+	/* hardware statistics, accumulated by stats_work */
+	spinlock_t stats_lock;
+	struct delayed_work stats_work;
+	u64 hw_stats[EMAC_NUM_HW_STATS];
+	/* reopen after system resume, left to a work item; rtnl held */
+	struct work_struct resume_work;
+	u32 resume_pending;
+	/* low latency RX: interrupts wake poll_task instead of NAPI */
+	struct task_struct *poll_task;
+	ktime_t irq_stamp; /* last interrupt, zero once accounted */
+	u32 rx_lat_hist[EMAC_LAT_BUCKETS]; /* interrupt to RX processing */
+	u32 rx_polled; /* RX passes that found frames without interrupt */
+	struct dentry *debugfs;
+#ifdef CONFIG_TI_DAVINCI_EMAC_BENCH
+	struct emac_bench bench[EMAC_BENCH_NR];
+	struct dentry *bench_debugfs;
+#endif
+	/* PM_QOS_CPU_FREQ_MIN held during traffic bursts, see emac_qos_work */
+	struct delayed_work qos_work;
+	unsigned long qos_flags;
+	unsigned long qos_window; /* start of the current burst window */
+	u32 qos_pkts; /* packets in that window */
+	unsigned long qos_last; /* last window that counted as a burst */
 };
 
+/* qos_flags */
+#define EMAC_QOS_ADDED		0 /* requirement registered while open */
+#define EMAC_QOS_BUSY		1 /* qos_work scheduled or holding the floor */
+#define EMAC_QOS_HELD		2 /* floor currently requested */
+
+#define EMAC_QOS_WINDOW		(HZ / 10)
+
 /* clock frequency for EMAC */
 static struct clk *emac_clk;
 static unsigned long emac_bus_frequency;
 static unsigned long mdio_max_freq;
 
+/* MDIO user access completion, signalled by emac_misc_irq */
+static DECLARE_COMPLETION(emac_mdio_done);
+static int emac_mdio_irq_en;
+
+/**
+ * emac_bd_phys: Hardware address of a buffer descriptor
+ * @priv: The DaVinci EMAC private adapter structure
+ * @addr: BD in CPPI RAM or in the DDR BD area, NULL for end of queue
+ */
+static inline u32 emac_bd_phys(struct emac_priv *priv, void __iomem *addr)
+{
+	void *bd = (void __force *)addr;
+
+	if (bd == NULL)
+		return 0;
+	if (bd >= priv->bd_ddr && bd < priv->bd_ddr + priv->bd_ddr_size)
+		return priv->bd_ddr_phys + (bd - priv->bd_ddr);
+	return ((u32 __force)addr - (u32 __force)priv->emac_ctrl_ram) +
+	       priv->hw_ram_addr;
+}
+
 #define emac_virt_to_phys(addr, priv) \
-	(((u32 __force)(addr) - (u32 __force)(priv->emac_ctrl_ram)) \
-	+ priv->hw_ram_addr)
+	emac_bd_phys(priv, (void __iomem *)(addr))
+
+/**
+ * emac_bd_mem_fits: Check whether rings fit in CPPI RAM
+ * @priv: The DaVinci EMAC private adapter structure
+ * @tx_ring_size: BD's per TX channel
+ * @rx_ring_size: BD's per RX channel
+ */
+static inline int emac_bd_mem_fits(struct emac_priv *priv, u32 tx_ring_size,
+				   u32 rx_ring_size)
+{
+	return priv->num_tx_ch * tx_ring_size * EMAC_TX_BD_SIZE +
+	       priv->num_rx_ch * rx_ring_size * EMAC_RX_BD_SIZE <=
+	       priv->ctrl_ram_size;
+}
 
-/* Cache macros - Packet buffers would be from skb pool which is cached */
+/* Packet buffers are skb's mapped with the streaming DMA API; TX buffers
+ * are mapped DMA_TO_DEVICE (clean only) and RX buffers DMA_FROM_DEVICE
+ * (invalidate only) for as long as the driver owns them */
 #define EMAC_VIRT_NOCACHE(addr) (addr)
-#define EMAC_CACHE_INVALIDATE(addr, size) \
-	dma_cache_maint((void *)addr, size, DMA_FROM_DEVICE)
-#define EMAC_CACHE_WRITEBACK(addr, size) \
-	dma_cache_maint((void *)addr, size, DMA_TO_DEVICE)
-#define EMAC_CACHE_WRITEBACK_INVALIDATE(addr, size) \
-	dma_cache_maint((void *)addr, size, DMA_BIDIRECTIONAL)
+#define emac_dma_dev(priv)	(&(priv)->pdev->dev)
 
 /* DM644x does not have BD's in cached memory - so no cache functions */
 #define BD_CACHE_INVALIDATE(addr, size)
 #define BD_CACHE_WRITEBACK(addr, size)
 #define BD_CACHE_WRITEBACK_INVALIDATE(addr, size)
 
+#ifdef CONFIG_TI_DAVINCI_EMAC_BENCH
+/*
+ * Stage timing on sched_clock(), which runs off the 64-bit timer where
+ * the SoC has one to spare.  Updates aren't atomic: TX and RX processing
+ * both run in softirq context on a uniprocessor.
+ */
+static inline u64 emac_bench_now(void)
+{
+	return cpu_clock(raw_smp_processor_id());
+}
+
+static void emac_bench_add(struct emac_priv *priv, int stage, u64 start,
+			   u32 items)
+{
+	struct emac_bench *b = &priv->bench[stage];
+	u32 ns = emac_bench_now() - start;
+
+	b->calls++;
+	b->items += items;
+	b->ns += ns;
+	if (ns > b->max_ns)
+		b->max_ns = ns;
+}
+#else
+static inline u64 emac_bench_now(void)
+{
+	return 0;
+}
+
+static inline void emac_bench_add(struct emac_priv *priv, int stage,
+				  u64 start, u32 items) {}
+#endif
+
 /* EMAC TX Host Error description strings */
 static char *emac_txhost_errcodes[16] = {
 	"No error", "SOP error", "Ownership bit not set in SOP buffer",
@@ -533,6 +906,9 @@ static char *emac_rxhost_errcodes[16] = {
 	"Reserved", "Reserved", "Reserved", "Reserved"
 };
 
+/* Zeroes padding short fragmented TX frames, never written */
+static u8 emac_tx_pad[EMAC_DEF_MIN_ETHPKTSIZE];
+
 /* Helper macros */
 #define emac_read(reg)		  ioread32(priv->emac_base + (reg))
 #define emac_write(reg, val)      iowrite32(val, priv->emac_base + (reg))
@@ -701,17 +1077,535 @@ static int emac_set_settings(struct net_device *ndev, struct ethtool_cmd *ecmd)
 
 }
 
+/* ethtool statistics kept per channel in struct emac_rxch / emac_txch */
+struct emac_ch_stat {
+	char name[ETH_GSTRING_LEN];
+	int offset;
+};
+
+#define EMAC_RXCH_STAT(m)	{ #m, offsetof(struct emac_rxch, m) }
+
+static const struct emac_ch_stat emac_rxch_stats[] = {
+	EMAC_RXCH_STAT(pool_count),
+	EMAC_RXCH_STAT(pool_hits),
+	EMAC_RXCH_STAT(pool_misses),
+	EMAC_RXCH_STAT(pool_recycled),
+	EMAC_RXCH_STAT(out_of_rx_buffers),
+	EMAC_RXCH_STAT(copybreak),
+	EMAC_RXCH_STAT(frag_frames),
+	EMAC_RXCH_STAT(filtered),
+};
+
+#define EMAC_RXCH_NUM_STATS	ARRAY_SIZE(emac_rxch_stats)
+
+#define EMAC_TXCH_STAT(m)	{ #m, offsetof(struct emac_txch, m) }
+
+static const struct emac_ch_stat emac_txch_stats[] = {
+	EMAC_TXCH_STAT(byte_limit),
+	EMAC_TXCH_STAT(queue_stopped),
+	EMAC_TXCH_STAT(starved),
+	EMAC_TXCH_STAT(end_of_queue_add),
+	EMAC_TXCH_STAT(mis_queued_packets),
+	EMAC_TXCH_STAT(out_of_tx_bd),
+	EMAC_TXCH_STAT(xmit_reclaimed),
+	EMAC_TXCH_STAT(irq_rearmed),
+};
+
+#define EMAC_TXCH_NUM_STATS	ARRAY_SIZE(emac_txch_stats)
+
+/* hardware statistics registers, in register order */
+static const char emac_hw_stat_names[EMAC_NUM_HW_STATS][ETH_GSTRING_LEN] = {
+	"rx_good_frames", "rx_broadcast_frames", "rx_multicast_frames",
+	"rx_pause_frames", "rx_crc_errors", "rx_align_code_errors",
+	"rx_oversized_frames", "rx_jabber_frames", "rx_undersized_frames",
+	"rx_fragments", "rx_filtered_frames", "rx_qos_filtered_frames",
+	"rx_octets", "tx_good_frames", "tx_broadcast_frames",
+	"tx_multicast_frames", "tx_pause_frames", "tx_deferred_frames",
+	"tx_collision_frames", "tx_single_collision_frames",
+	"tx_multiple_collision_frames", "tx_excessive_collisions",
+	"tx_late_collisions", "tx_underrun", "tx_carrier_sense_errors",
+	"tx_octets", "frames_64", "frames_65_127", "frames_128_255",
+	"frames_256_511", "frames_512_1023", "frames_1024_up", "net_octets",
+	"rx_sof_overruns", "rx_mof_overruns", "rx_dma_overruns",
+};
+
+/**
+ * emac_get_sset_count: Get number of ethtool strings in a set
+ * @ndev: The DaVinci EMAC network adapter
+ * @sset: string set
+ *
+ * Returns number of per channel statistics for ETH_SS_STATS
+ */
+static int emac_get_sset_count(struct net_device *ndev, int sset)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+
+	switch (sset) {
+	case ETH_SS_STATS:
+		return priv->num_rx_ch * EMAC_RXCH_NUM_STATS +
+		       priv->num_tx_ch * EMAC_TXCH_NUM_STATS +
+		       EMAC_NUM_HW_STATS;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/**
+ * emac_get_strings: Get ethtool statistics names
+ * @ndev: The DaVinci EMAC network adapter
+ * @stringset: string set
+ * @data: buffer for the names
+ *
+ * Names are prefixed with the channel, e.g. "rx0_pool_hits", followed by
+ * the hardware statistics
+ */
+static void emac_get_strings(struct net_device *ndev, u32 stringset, u8 *data)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	u32 ch, i;
+
+	if (stringset != ETH_SS_STATS)
+		return;
+
+	for (ch = 0; ch < priv->num_rx_ch; ch++) {
+		for (i = 0; i < EMAC_RXCH_NUM_STATS; i++) {
+			snprintf(data, ETH_GSTRING_LEN, "rx%d_%s", ch,
+				 emac_rxch_stats[i].name);
+			data += ETH_GSTRING_LEN;
+		}
+	}
+	for (ch = 0; ch < priv->num_tx_ch; ch++) {
+		for (i = 0; i < EMAC_TXCH_NUM_STATS; i++) {
+			snprintf(data, ETH_GSTRING_LEN, "tx%d_%s", ch,
+				 emac_txch_stats[i].name);
+			data += ETH_GSTRING_LEN;
+		}
+	}
+	memcpy(data, emac_hw_stat_names, sizeof(emac_hw_stat_names));
+}
+
+/**
+ * emac_get_ethtool_stats: Get ethtool statistics
+ * @ndev: The DaVinci EMAC network adapter
+ * @stats: ethtool stats command
+ * @data: buffer for the values
+ *
+ * Channels not set up (interface down) report zero. Hardware statistics
+ * are the totals last accumulated by stats_work, no register is read.
+ */
+static void emac_get_ethtool_stats(struct net_device *ndev,
+				   struct ethtool_stats *stats, u64 *data)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	struct emac_rxch *rxch;
+	struct emac_txch *txch;
+	u32 ch, i;
+
+	for (ch = 0; ch < priv->num_rx_ch; ch++) {
+		rxch = priv->rxch[ch];
+		if (rxch)
+			rxch->pool_count = skb_queue_len(&rxch->pool);
+		for (i = 0; i < EMAC_RXCH_NUM_STATS; i++) {
+			*data++ = rxch ? *(u32 *)((char *)rxch +
+					emac_rxch_stats[i].offset) : 0;
+		}
+	}
+	for (ch = 0; ch < priv->num_tx_ch; ch++) {
+		txch = priv->txch[ch];
+		for (i = 0; i < EMAC_TXCH_NUM_STATS; i++) {
+			*data++ = txch ? *(u32 *)((char *)txch +
+					emac_txch_stats[i].offset) : 0;
+		}
+	}
+	spin_lock_bh(&priv->stats_lock);
+	memcpy(data, priv->hw_stats, sizeof(priv->hw_stats));
+	spin_unlock_bh(&priv->stats_lock);
+}
+
+/**
+ * emac_set_pacing: Program EMAC interrupt pacing hardware
+ * @priv: The DaVinci EMAC private adapter structure
+ * @rx_usecs: minimum RX interrupt interval, 0 to disable pacing
+ * @tx_usecs: minimum TX interrupt interval, 0 to disable pacing
+ *
+ * DM646x/DA8xx control module counts 4us pulses (prescaled from the bus
+ * clock) and allows at most CMRX/TXINTMAX interrupts per 250 pulses. Above
+ * 500us the pulse itself is stretched, shared by RX and TX. DM644x has a
+ * single EWINTTCNT timer in bus clocks used for both directions.
+ *
+ * Returns the RX interval actually programmed
+ */
+static u32 emac_set_pacing(struct emac_priv *priv, u32 rx_usecs, u32 tx_usecs)
+{
+	u32 bus_mhz = emac_bus_frequency / 1000000;
+	u32 int_ctrl, prescale, dvdr = 1, max_usecs, cnt;
+
+	if (!bus_mhz)
+		return 0;
+
+	if (priv->version != EMAC_VERSION_2) {
+		prescale = rx_usecs * bus_mhz;
+		if (prescale > EMAC_DM644X_EWINTCNT_MASK) {
+			prescale = EMAC_DM644X_EWINTCNT_MASK;
+			rx_usecs = prescale / bus_mhz;
+		}
+		int_ctrl = emac_ctrl_read(EMAC_CTRL_EWINTTCNT);
+		int_ctrl &= ~EMAC_DM644X_EWINTCNT_MASK;
+		emac_ctrl_write(EMAC_CTRL_EWINTTCNT, int_ctrl | prescale);
+		return rx_usecs;
+	}
+
+	prescale = bus_mhz * 4;
+	max_usecs = max(rx_usecs, tx_usecs);
+	if (max_usecs > EMAC_DM646X_CMINTMAX_INTVL) {
+		dvdr = DIV_ROUND_UP(max_usecs, EMAC_DM646X_CMINTMAX_INTVL);
+		dvdr = min(dvdr, EMAC_DM646X_INTPRESCALE_MASK / prescale);
+		if (!dvdr)
+			dvdr = 1;
+		prescale *= dvdr;
+	}
+
+	int_ctrl = emac_ctrl_read(EMAC_DM646X_CMINTCTRL);
+	int_ctrl &= ~(EMAC_DM646X_INTPRESCALE_MASK |
+		      EMAC_DM646X_INTCTRL_RXPACEEN |
+		      EMAC_DM646X_INTCTRL_TXPACEEN);
+	int_ctrl |= (prescale & EMAC_DM646X_INTPRESCALE_MASK);
+
+	if (rx_usecs) {
+		cnt = clamp_t(u32, (EMAC_DM646X_PACE_UNIT_USECS * dvdr) /
+			      rx_usecs, EMAC_DM646X_CMINTMIN_CNT,
+			      EMAC_DM646X_CMINTMAX_CNT);
+		emac_ctrl_write(EMAC_DM646X_CMRXINTMAX, cnt);
+		int_ctrl |= EMAC_DM646X_INTCTRL_RXPACEEN;
+		rx_usecs = (EMAC_DM646X_PACE_UNIT_USECS * dvdr) / cnt;
+	}
+	if (tx_usecs) {
+		cnt = clamp_t(u32, (EMAC_DM646X_PACE_UNIT_USECS * dvdr) /
+			      tx_usecs, EMAC_DM646X_CMINTMIN_CNT,
+			      EMAC_DM646X_CMINTMAX_CNT);
+		emac_ctrl_write(EMAC_DM646X_CMTXINTMAX, cnt);
+		int_ctrl |= EMAC_DM646X_INTCTRL_TXPACEEN;
+	}
+	emac_ctrl_write(EMAC_DM646X_CMINTCTRL, int_ctrl);
+
+	return rx_usecs;
+}
+
+/**
+ * emac_get_coalesce: Get interrupt pacing settings
+ * @ndev: The DaVinci EMAC network adapter
+ * @coal: ethtool coalesce structure
+ *
+ * Returns success (0)
+ */
+static int emac_get_coalesce(struct net_device *ndev,
+			     struct ethtool_coalesce *coal)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+
+	coal->rx_coalesce_usecs = priv->rx_coal_usecs;
+	coal->tx_coalesce_usecs = priv->tx_coal_usecs;
+	coal->use_adaptive_rx_coalesce = priv->coal_adaptive;
+	coal->pkt_rate_low = priv->coal_rate_low;
+	coal->pkt_rate_high = priv->coal_rate_high;
+	coal->rx_coalesce_usecs_low = priv->coal_usecs_low;
+	coal->rx_coalesce_usecs_high = priv->coal_usecs_high;
+	coal->rate_sample_interval = priv->coal_sample_secs;
+	return 0;
+}
+
+/**
+ * emac_set_coalesce: Set interrupt pacing settings
+ * @ndev: The DaVinci EMAC network adapter
+ * @coal: ethtool coalesce structure
+ *
+ * Fixed pacing uses rx-usecs/tx-usecs. With adaptive-rx the RX interval
+ * switches between rx-usecs-low and rx-usecs-high depending on the packet
+ * rate measured over sample-interval seconds. Frame count based
+ * coalescing is not supported by the hardware.
+ *
+ * Returns success (0) or -EINVAL / -EOPNOTSUPP for unsupported settings
+ */
+static int emac_set_coalesce(struct net_device *ndev,
+			     struct ethtool_coalesce *coal)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+
+	if (coal->rx_max_coalesced_frames || coal->tx_max_coalesced_frames ||
+	    coal->use_adaptive_tx_coalesce)
+		return -EOPNOTSUPP;
+
+	if (coal->use_adaptive_rx_coalesce &&
+	    (!coal->rate_sample_interval ||
+	     coal->pkt_rate_low > coal->pkt_rate_high))
+		return -EINVAL;
+
+	priv->rx_coal_usecs = coal->rx_coalesce_usecs;
+	priv->tx_coal_usecs = coal->tx_coalesce_usecs;
+	priv->coal_adaptive = coal->use_adaptive_rx_coalesce;
+	priv->coal_rate_low = coal->pkt_rate_low;
+	priv->coal_rate_high = coal->pkt_rate_high;
+	priv->coal_usecs_low = coal->rx_coalesce_usecs_low;
+	priv->coal_usecs_high = coal->rx_coalesce_usecs_high;
+	priv->coal_sample_secs = coal->rate_sample_interval;
+	priv->coal_pkts = 0;
+	priv->coal_sample_end = jiffies + priv->coal_sample_secs * HZ;
+
+	if (netif_running(ndev))
+		priv->coal_cur_usecs = emac_set_pacing(priv,
+				priv->rx_coal_usecs, priv->tx_coal_usecs);
+	return 0;
+}
+
+/**
+ * emac_adapt_coalesce: Adaptive RX interrupt pacing
+ * @priv: The DaVinci EMAC private adapter structure
+ * @num_pkts: RX packets processed in this poll
+ *
+ * Called from NAPI poll. At the end of every sample window the RX pacing
+ * interval is set from the measured packet rate: long intervals under load
+ * bound the interrupt rate, short ones keep latency low when idle.
+ */
+static void emac_adapt_coalesce(struct emac_priv *priv, u32 num_pkts)
+{
+	u32 rate, usecs;
+
+	priv->coal_pkts += num_pkts;
+	if (time_before(jiffies, priv->coal_sample_end))
+		return;
+
+	rate = priv->coal_pkts / priv->coal_sample_secs;
+	priv->coal_pkts = 0;
+	priv->coal_sample_end = jiffies + priv->coal_sample_secs * HZ;
+
+	if (rate <= priv->coal_rate_low)
+		usecs = priv->coal_usecs_low;
+	else if (rate >= priv->coal_rate_high)
+		usecs = priv->coal_usecs_high;
+	else
+		usecs = priv->rx_coal_usecs;
+
+	if (usecs != priv->coal_cur_usecs)
+		priv->coal_cur_usecs = emac_set_pacing(priv, usecs,
+						       priv->tx_coal_usecs);
+}
+
 /**
  * ethtool_ops: DaVinci EMAC Ethtool structure
  *
  * Ethtool support for EMAC adapter
  *
  */
+static int emac_dev_open(struct net_device *ndev);
+static int emac_dev_stop(struct net_device *ndev);
+static void emac_resume_work(struct work_struct *work);
+
+/**
+ * emac_get_ringparam: Get BD ring sizes
+ * @ndev: The DaVinci EMAC network adapter
+ * @ring: ethtool ring parameters
+ *
+ * Sizes are per channel. Without DDR BD's the maximum of each direction
+ * is what fits in CPPI RAM next to the current size of the other one
+ */
+static void emac_get_ringparam(struct net_device *ndev,
+			       struct ethtool_ringparam *ring)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	u32 tx_used = priv->num_tx_ch * priv->tx_ring_size * EMAC_TX_BD_SIZE;
+	u32 rx_used = priv->num_rx_ch * priv->rx_ring_size * EMAC_RX_BD_SIZE;
+
+	ring->rx_max_pending = EMAC_MAX_RING_SIZE;
+	ring->tx_max_pending = EMAC_MAX_RING_SIZE;
+	if (!priv->bd_ddr_en) {
+		ring->rx_max_pending = min_t(u32, EMAC_MAX_RING_SIZE,
+			(priv->ctrl_ram_size - tx_used) /
+			(priv->num_rx_ch * EMAC_RX_BD_SIZE));
+		ring->tx_max_pending = rounddown_pow_of_two(min_t(u32,
+			EMAC_MAX_RING_SIZE, (priv->ctrl_ram_size - rx_used) /
+			(priv->num_tx_ch * EMAC_TX_BD_SIZE)));
+	}
+	ring->rx_pending = priv->rx_ring_size;
+	ring->tx_pending = priv->tx_ring_size;
+}
+
+/**
+ * emac_set_ringparam: Set BD ring sizes
+ * @ndev: The DaVinci EMAC network adapter
+ * @ring: ethtool ring parameters
+ *
+ * TX sizes are rounded down to a power of 2. A running interface is
+ * stopped and reopened with the new rings.
+ *
+ * Returns success(0) or error code
+ */
+static int emac_set_ringparam(struct net_device *ndev,
+			      struct ethtool_ringparam *ring)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	u32 tx_ring_size, rx_ring_size;
+
+	if (ring->rx_mini_pending || ring->rx_jumbo_pending)
+		return -EINVAL;
+	if (ring->rx_pending < EMAC_MIN_RING_SIZE ||
+	    ring->rx_pending > EMAC_MAX_RING_SIZE ||
+	    ring->tx_pending < EMAC_MIN_RING_SIZE ||
+	    ring->tx_pending > EMAC_MAX_RING_SIZE)
+		return -EINVAL;
+
+	tx_ring_size = rounddown_pow_of_two(ring->tx_pending);
+	rx_ring_size = ring->rx_pending;
+	if (!priv->bd_ddr_en &&
+	    !emac_bd_mem_fits(priv, tx_ring_size, rx_ring_size))
+		return -EINVAL;
+	if (tx_ring_size == priv->tx_ring_size &&
+	    rx_ring_size == priv->rx_ring_size)
+		return 0;
+
+	if (!netif_running(ndev)) {
+		priv->tx_ring_size = tx_ring_size;
+		priv->rx_ring_size = rx_ring_size;
+		return 0;
+	}
+
+	emac_dev_stop(ndev);
+	priv->tx_ring_size = tx_ring_size;
+	priv->rx_ring_size = rx_ring_size;
+	return emac_dev_open(ndev);
+}
+
+/**
+ * emac_get_rxnfc: Read the RX classifier table
+ * @ndev: The DaVinci EMAC network adapter
+ * @info: ethtool RX flow classification command
+ * @rule_locs: room for info->rule_cnt locations, for ETHTOOL_GRXCLSRLALL
+ *
+ * Returns success(0) or error code
+ */
+static int emac_get_rxnfc(struct net_device *ndev,
+			  struct ethtool_rxnfc *info, void *rule_locs)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	u32 *locs = rule_locs;
+	unsigned long flags;
+	u32 i, n = 0;
+	int ret = 0;
+
+	spin_lock_irqsave(&priv->rx_lock, flags);
+	switch (info->cmd) {
+	case ETHTOOL_GRXRINGS:
+		info->data = 1;
+		break;
+	case ETHTOOL_GRXCLSRLCNT:
+		info->rule_cnt = hweight32(priv->rx_rules_used);
+		info->data = EMAC_RX_RULES;
+		break;
+	case ETHTOOL_GRXCLSRULE:
+		i = info->fs.location;
+		if (i >= EMAC_RX_RULES || !(priv->rx_rules_used & BIT(i))) {
+			ret = -ENOENT;
+			break;
+		}
+		info->fs = priv->rx_rules[i].fs;
+		break;
+	case ETHTOOL_GRXCLSRLALL:
+		for (i = 0; i < EMAC_RX_RULES; i++) {
+			if (!(priv->rx_rules_used & BIT(i)))
+				continue;
+			if (n == info->rule_cnt) {
+				ret = -EMSGSIZE;
+				break;
+			}
+			locs[n++] = i;
+		}
+		info->rule_cnt = n;
+		info->data = EMAC_RX_RULES;
+		break;
+	default:
+		ret = -EOPNOTSUPP;
+	}
+	spin_unlock_irqrestore(&priv->rx_lock, flags);
+	return ret;
+}
+
+/**
+ * emac_set_rxnfc: Insert or delete an RX classifier rule
+ * @ndev: The DaVinci EMAC network adapter
+ * @cmd: ethtool RX flow classification command
+ *
+ * Rules match ETHER_FLOW (MAC addresses and ethertype, the one inside a
+ * VLAN tag if there is one), TCP_V4_FLOW or UDP_V4_FLOW frames on the
+ * fields whose m_u mask bits are set. The lowest matching location
+ * decides: ring_cookie RX_CLS_FLOW_DISC drops the frame, otherwise it
+ * goes to the stack, at most (ring_cookie >> 32) frames per second of
+ * it if that is not zero. Frames no rule matches are passed; a last
+ * all-zero mask ETHER_FLOW rule that drops makes the table a whitelist.
+ *
+ * Returns success(0) or error code
+ */
+static int emac_set_rxnfc(struct net_device *ndev, struct ethtool_rxnfc *cmd)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	struct ethtool_rx_flow_spec *fs = &cmd->fs;
+	struct emac_rx_rule rule;
+	unsigned long flags;
+	int i, ret = 0;
+
+	if (cmd->cmd != ETHTOOL_SRXCLSRLINS && cmd->cmd != ETHTOOL_SRXCLSRLDEL)
+		return -EOPNOTSUPP;
+	if (fs->location >= EMAC_RX_RULES)
+		return -EINVAL;
+
+	if (cmd->cmd == ETHTOOL_SRXCLSRLDEL) {
+		spin_lock_irqsave(&priv->rx_lock, flags);
+		if (priv->rx_rules_used & BIT(fs->location))
+			priv->rx_rules_used &= ~BIT(fs->location);
+		else
+			ret = -ENOENT;
+		spin_unlock_irqrestore(&priv->rx_lock, flags);
+		return ret;
+	}
+
+	if (fs->flow_type != ETHER_FLOW && fs->flow_type != TCP_V4_FLOW &&
+	    fs->flow_type != UDP_V4_FLOW)
+		return -EINVAL;
+	/* there is only one ring to steer to */
+	if ((u32)fs->ring_cookie && fs->ring_cookie != RX_CLS_FLOW_DISC)
+		return -EINVAL;
+
+	memset(&rule, 0, sizeof(rule));
+	rule.fs = *fs;
+	for (i = 0; i < sizeof(rule.fs.h_u); i++)
+		rule.fs.h_u.hdata[i] &= rule.fs.m_u.hdata[i];
+	if (fs->ring_cookie != RX_CLS_FLOW_DISC)
+		rule.rate = fs->ring_cookie >> 32;
+	rule.window = jiffies;
+
+	spin_lock_irqsave(&priv->rx_lock, flags);
+	priv->rx_rules[fs->location] = rule;
+	priv->rx_rules_used |= BIT(fs->location);
+	spin_unlock_irqrestore(&priv->rx_lock, flags);
+	return 0;
+}
+
 static const struct ethtool_ops ethtool_ops = {
 	.get_drvinfo = emac_get_drvinfo,
 	.get_settings = emac_get_settings,
 	.set_settings = emac_set_settings,
 	.get_link = ethtool_op_get_link,
+	.get_sg = ethtool_op_get_sg,
+	.set_sg = ethtool_op_set_sg,
+	.get_tx_csum = ethtool_op_get_tx_csum,
+	.set_tx_csum = ethtool_op_set_tx_hw_csum,
+	.get_sset_count = emac_get_sset_count,
+	.get_strings = emac_get_strings,
+	.get_ethtool_stats = emac_get_ethtool_stats,
+	.get_coalesce = emac_get_coalesce,
+	.set_coalesce = emac_set_coalesce,
+	.get_ringparam = emac_get_ringparam,
+	.set_ringparam = emac_set_ringparam,
+	.get_rxnfc = emac_get_rxnfc,
+	.set_rxnfc = emac_set_rxnfc,
 };
 
 /**
@@ -768,15 +1662,14 @@ static void emac_update_phystatus(struct emac_priv *priv)
 		/* link ON */
 		if (!netif_carrier_ok(ndev))
 			netif_carrier_on(ndev);
-	/* reactivate the transmit queue if it is stopped */
-		if (netif_running(ndev) && netif_queue_stopped(ndev))
-			netif_wake_queue(ndev);
+	/* reactivate the transmit queues if they are stopped */
+		if (netif_running(ndev))
+			netif_tx_wake_all_queues(ndev);
 	} else {
 		/* link OFF */
 		if (netif_carrier_ok(ndev))
 			netif_carrier_off(ndev);
-		if (!netif_queue_stopped(ndev))
-			netif_stop_queue(ndev);
+		netif_tx_stop_all_queues(ndev);
 	}
 }
 
@@ -952,7 +1845,8 @@ static void emac_dev_mcast_set(struct net_device *ndev)
 
 	mbp_enable = emac_read(EMAC_RXMBPENABLE);
 	if (ndev->flags & IFF_PROMISC) {
-		mbp_enable &= (~EMAC_MBP_PROMISCCH(EMAC_DEF_PROM_CH));
+		mbp_enable &= ~EMAC_RXMBP_PROMCH_MASK;
+		mbp_enable |= EMAC_MBP_PROMISCCH(priv->rx_prom_ch);
 		mbp_enable |= (EMAC_MBP_RXPROMISC);
 	} else {
 		mbp_enable = (mbp_enable & ~EMAC_MBP_RXPROMISC);
@@ -1068,43 +1962,297 @@ static irqreturn_t emac_irq(int irq, void *dev_id)
 	++priv->isr_count;
 	if (likely(netif_running(priv->ndev))) {
 		emac_int_disable(priv);
-		napi_schedule(&priv->napi);
+		priv->irq_stamp = ktime_get();
+		if (priv->poll_task)
+			wake_up_process(priv->poll_task);
+		else
+			napi_schedule(&priv->napi);
 	} else {
 		/* we are closing down, so dont process anything */
 	}
 	return IRQ_HANDLED;
 }
 
-/** EMAC on-chip buffer descriptor memory
- *
- * WARNING: Please note that the on chip memory is used for both TX and RX
- * buffer descriptor queues and is equally divided between TX and RX desc's
- * If the number of TX or RX descriptors change this memory pointers need
- * to be adjusted. If external memory is allocated then these pointers can
- * pointer to the memory
- *
- */
-#define EMAC_TX_BD_MEM(priv)	((priv)->emac_ctrl_ram)
-#define EMAC_RX_BD_MEM(priv)	((priv)->emac_ctrl_ram + \
-				(((priv)->ctrl_ram_size) >> 1))
+/*************************************************************************
+ *  EMAC RX buffer pool
+ *************************************************************************/
 
 /**
- * emac_init_txch: TX channel initialization
+ * emac_rx_pool_put: Return a RX sized skb to the channel pool
  * @priv: The DaVinci EMAC private adapter structure
  * @ch: RX channel number
+ * @skb: unmapped skb with data at the cleared buffer start (NET_SKB_PAD)
  *
- * Called during device init to setup a TX channel (allocate buffer desc
- * create free pool and keep ready for transmission
- *
- * Returns success(0) or mem alloc failures error code
+ * Maps the buffer for RX so that it can be handed to the hardware later
+ * without cache maintenance. Frees the skb if the pool is full.
  */
-static int emac_init_txch(struct emac_priv *priv, u32 ch)
+static void emac_rx_pool_put(struct emac_priv *priv, u32 ch,
+			     struct sk_buff *skb)
 {
-	struct device *emac_dev = &priv->ndev->dev;
-	u32 cnt, bd_size;
-	void __iomem *mem;
-	struct emac_tx_bd __iomem *curr_bd;
-	struct emac_txch *txch = NULL;
+	struct emac_rxch *rxch = priv->rxch[ch];
+
+	if (skb_queue_len(&rxch->pool) >= rxch->pool_depth) {
+		dev_kfree_skb_any(skb);
+		return;
+	}
+	skb->dev = priv->ndev;
+	skb_reserve(skb, NET_IP_ALIGN);
+	EMAC_SKB_CB(skb)->dma_addr = dma_map_single(emac_dma_dev(priv),
+			skb->data, rxch->buf_size, DMA_FROM_DEVICE);
+	skb_queue_tail(&rxch->pool, skb);
+	++rxch->pool_recycled;
+}
+
+/**
+ * emac_rx_skb_free: Unmap and free a RX skb owned by the driver
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: RX channel number
+ * @skb: mapped RX skb
+ */
+static void emac_rx_skb_free(struct emac_priv *priv, u32 ch,
+			     struct sk_buff *skb)
+{
+	dma_unmap_single(emac_dma_dev(priv), EMAC_SKB_CB(skb)->dma_addr,
+			 priv->rxch[ch]->buf_size, DMA_FROM_DEVICE);
+	dev_kfree_skb_any(skb);
+}
+
+/**
+ * emac_rx_pool_fill: Top up the RX channel pool
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: RX channel number
+ * @gfp: allocation flags
+ *
+ * Called when the channel is set up and when NAPI goes idle so that the
+ * allocation and full buffer invalidate happen outside the RX hot path.
+ */
+static void emac_rx_pool_fill(struct emac_priv *priv, u32 ch, gfp_t gfp)
+{
+	struct emac_rxch *rxch = priv->rxch[ch];
+	struct sk_buff *skb;
+
+	while (skb_queue_len(&rxch->pool) < rxch->pool_depth) {
+		skb = __dev_alloc_skb(rxch->buf_size, gfp);
+		if (NULL == skb)
+			break;
+		skb->dev = priv->ndev;
+		skb_reserve(skb, NET_IP_ALIGN);
+		EMAC_SKB_CB(skb)->dma_addr = dma_map_single(emac_dma_dev(priv),
+				skb->data, rxch->buf_size, DMA_FROM_DEVICE);
+		skb_queue_tail(&rxch->pool, skb);
+	}
+}
+
+/* Largest frame the current MTU allows on the wire, VLAN tag and FCS
+ * included; RXMAXLEN and the buffer sizes derive from it */
+#define emac_max_frame(priv)	((priv)->ndev->mtu + EMAC_FRAME_EXTRA)
+
+/**
+ * emac_rx_bds_per_frame: RX BD's a full sized frame takes
+ * @mtu: MTU the RX buffers are sized for
+ *
+ * One skb per frame as long as it fits a page, otherwise the frame is
+ * spread over page sized buffers
+ */
+static u32 emac_rx_bds_per_frame(int mtu)
+{
+	u32 frame = mtu + EMAC_FRAME_EXTRA;
+
+	if (frame + NET_IP_ALIGN <= SKB_MAX_ORDER(NET_SKB_PAD, 0))
+		return 1;
+	return DIV_ROUND_UP(frame, PAGE_SIZE);
+}
+
+/* Page RX buffers stay mapped while on the ring, page_private holds the
+ * DMA address */
+static inline dma_addr_t emac_rx_buf_dma(struct emac_rxch *rxch, void *token)
+{
+	if (rxch->frags)
+		return page_private((struct page *)token);
+	return EMAC_SKB_CB((struct sk_buff *)token)->dma_addr;
+}
+
+/**
+ * emac_rx_buf_free: Unmap and free a RX buffer owned by the driver
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: RX channel number
+ * @token: mapped RX skb, or page with page fragment buffers
+ */
+static void emac_rx_buf_free(struct emac_priv *priv, u32 ch, void *token)
+{
+	struct page *page = token;
+
+	if (!priv->rxch[ch]->frags) {
+		emac_rx_skb_free(priv, ch, token);
+		return;
+	}
+	dma_unmap_page(emac_dma_dev(priv), page_private(page), PAGE_SIZE,
+		       DMA_FROM_DEVICE);
+	set_page_private(page, 0);
+	__free_page(page);
+}
+
+/**
+ * emac_rx_buf_park: Keep a RX buffer for the next open
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: RX channel number
+ * @token: mapped RX skb, or page with page fragment buffers
+ *
+ * The buffer stays mapped; the CPU never read it, so the hardware can
+ * be given it again without cache maintenance
+ */
+static void emac_rx_buf_park(struct emac_priv *priv, u32 ch, void *token)
+{
+	if (priv->rxch[ch]->frags)
+		list_add_tail(&((struct page *)token)->lru,
+			      &priv->rx_park_pages[ch]);
+	else
+		skb_queue_tail(&priv->rx_park[ch], (struct sk_buff *)token);
+}
+
+/**
+ * emac_rx_park_free: Free the RX buffers kept from the last stop
+ * @priv: The DaVinci EMAC private adapter structure
+ */
+static void emac_rx_park_free(struct emac_priv *priv)
+{
+	struct sk_buff *skb;
+	struct page *page, *tmp;
+	u32 ch;
+
+	for (ch = 0; ch < EMAC_MAX_TXRX_CHANNELS; ch++) {
+		while ((skb = skb_dequeue(&priv->rx_park[ch])) != NULL) {
+			dma_unmap_single(emac_dma_dev(priv),
+					 EMAC_SKB_CB(skb)->dma_addr,
+					 priv->rx_park_buf_size,
+					 DMA_FROM_DEVICE);
+			dev_kfree_skb_any(skb);
+		}
+		list_for_each_entry_safe(page, tmp, &priv->rx_park_pages[ch],
+					 lru) {
+			list_del(&page->lru);
+			dma_unmap_page(emac_dma_dev(priv), page_private(page),
+				       PAGE_SIZE, DMA_FROM_DEVICE);
+			set_page_private(page, 0);
+			__free_page(page);
+		}
+	}
+}
+
+/** EMAC buffer descriptor memory
+ *
+ * Every channel gets a ring of tx/rx_ring_size BD's. The rings are laid
+ * out back to back in the on chip CPPI RAM, TX channels first. When the
+ * platform allows it (bd_ddr), rings that do not fit are placed in
+ * coherent DDR instead, otherwise ring sizes are limited to what fits in
+ * CPPI RAM. Without configured sizes CPPI RAM is divided equally between
+ * TX and RX and then between the channels in use.
+ */
+static void __iomem *emac_place_bd_mem(struct emac_priv *priv, u32 size,
+				       u32 *ram_used, u32 *ddr_used)
+{
+	void __iomem *mem;
+
+	if (*ram_used + size <= priv->ctrl_ram_size) {
+		mem = priv->emac_ctrl_ram + *ram_used;
+		*ram_used += size;
+	} else {
+		mem = (void __force __iomem *)priv->bd_ddr + *ddr_used;
+		*ddr_used += size;
+	}
+	return mem;
+}
+
+static u32 emac_layout_bd_mem(struct emac_priv *priv)
+{
+	u32 ram_used = 0, ddr_used = 0, ch;
+
+	for (ch = 0; ch < priv->num_tx_ch; ch++)
+		priv->tx_bd_mem[ch] = emac_place_bd_mem(priv,
+				priv->tx_ring_size * EMAC_TX_BD_SIZE,
+				&ram_used, &ddr_used);
+	for (ch = 0; ch < priv->num_rx_ch; ch++)
+		priv->rx_bd_mem[ch] = emac_place_bd_mem(priv,
+				priv->rx_ring_size * EMAC_RX_BD_SIZE,
+				&ram_used, &ddr_used);
+	return ddr_used;
+}
+
+/**
+ * emac_release_bd_ddr: Release the DDR BD area
+ * @priv: The DaVinci EMAC private adapter structure
+ */
+static void emac_release_bd_ddr(struct emac_priv *priv)
+{
+	if (priv->bd_ddr)
+		dma_free_coherent(emac_dma_dev(priv), priv->bd_ddr_size,
+				  priv->bd_ddr, priv->bd_ddr_phys);
+	priv->bd_ddr = NULL;
+	priv->bd_ddr_size = 0;
+}
+
+/**
+ * emac_alloc_bd_mem: Assign BD memory to every channel
+ * @priv: The DaVinci EMAC private adapter structure
+ *
+ * Called at open, allocates the DDR BD area when rings overflow CPPI RAM
+ *
+ * Returns success(0) or -ENOMEM
+ */
+static int emac_alloc_bd_mem(struct emac_priv *priv)
+{
+	struct device *emac_dev = &priv->ndev->dev;
+	u32 size;
+
+	priv->tx_pad_dma = dma_map_single(emac_dma_dev(priv), emac_tx_pad,
+					  sizeof(emac_tx_pad), DMA_TO_DEVICE);
+
+	/* the DDR area of the last open is reused if the rings still fit */
+	size = emac_layout_bd_mem(priv);
+	if (size == priv->bd_ddr_size)
+		return 0;
+
+	emac_release_bd_ddr(priv);
+	if (size == 0)
+		return 0;
+
+	priv->bd_ddr = dma_alloc_coherent(emac_dma_dev(priv), size,
+					  &priv->bd_ddr_phys, GFP_KERNEL);
+	if (priv->bd_ddr == NULL) {
+		dev_err(emac_dev, "DaVinci EMAC: BD ring mem alloc failed");
+		return -ENOMEM;
+	}
+	priv->bd_ddr_size = size;
+	emac_layout_bd_mem(priv);
+	return 0;
+}
+
+/**
+ * emac_free_bd_mem: Put BD memory aside at stop
+ * @priv: The DaVinci EMAC private adapter structure
+ *
+ * The DDR BD area stays allocated for the next open
+ */
+static void emac_free_bd_mem(struct emac_priv *priv)
+{
+	dma_unmap_single(emac_dma_dev(priv), priv->tx_pad_dma,
+			 sizeof(emac_tx_pad), DMA_TO_DEVICE);
+}
+
+/**
+ * emac_init_txch: TX channel initialization
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: RX channel number
+ *
+ * Called during device init to setup a TX channel (allocate buffer desc
+ * create free pool and keep ready for transmission
+ *
+ * Returns success(0) or mem alloc failures error code
+ */
+static int emac_init_txch(struct emac_priv *priv, u32 ch)
+{
+	struct device *emac_dev = &priv->ndev->dev;
+	struct emac_txch *txch = NULL;
 
 	txch = kzalloc(sizeof(struct emac_txch), GFP_KERNEL);
 	if (NULL == txch) {
@@ -1113,10 +2261,9 @@ static int emac_init_txch(struct emac_priv *priv, u32 ch)
 	}
 	priv->txch[ch] = txch;
 	txch->service_max = EMAC_DEF_TX_MAX_SERVICE;
-	txch->active_queue_head = NULL;
-	txch->active_queue_tail = NULL;
 	txch->queue_active = 0;
 	txch->teardown_pending = 0;
+	spin_lock_init(&txch->lock);
 
 	/* allocate memory for TX CPPI channel on a 4 byte boundry */
 	txch->tx_complete = kzalloc(txch->service_max * sizeof(u32),
@@ -1124,33 +2271,53 @@ static int emac_init_txch(struct emac_priv *priv, u32 ch)
 	if (NULL == txch->tx_complete) {
 		dev_err(emac_dev, "DaVinci EMAC: Tx service mem alloc failed");
 		kfree(txch);
+		priv->txch[ch] = NULL;
 		return -ENOMEM;
 	}
 
-	/* allocate buffer descriptor pool align every BD on four word
-	 * boundry for future requirements */
-	bd_size = (sizeof(struct emac_tx_bd) + 0xF) & ~0xF;
-	txch->num_bd = (priv->ctrl_ram_size >> 1) / bd_size;
-	txch->alloc_size = (((bd_size * txch->num_bd) + 0xF) & ~0xF);
+	/* BD's are used as a ring indexed by a power of 2 mask, the 16 byte
+	 * BD's are four word aligned as the channel BD memory is */
+	txch->num_bd = priv->tx_ring_size;
+	txch->bd_mask = txch->num_bd - 1;
+	txch->alloc_size = txch->num_bd * EMAC_TX_BD_SIZE;
+	txch->buf = kzalloc(txch->num_bd * sizeof(struct emac_tx_buf),
+			    GFP_KERNEL);
+	if (NULL == txch->buf) {
+		dev_err(emac_dev, "DaVinci EMAC: Tx ring mem alloc failed");
+		kfree(txch->tx_complete);
+		kfree(txch);
+		priv->txch[ch] = NULL;
+		return -ENOMEM;
+	}
 
 	/* alloc TX BD memory */
-	txch->bd_mem = EMAC_TX_BD_MEM(priv);
+	txch->bd_mem = priv->tx_bd_mem[ch];
 	__memzero((void __force *)txch->bd_mem, txch->alloc_size);
-
-	/* initialize the BD linked list */
-	mem = (void __force __iomem *)
-			(((u32 __force) txch->bd_mem + 0xF) & ~0xF);
-	txch->bd_pool_head = NULL;
-	for (cnt = 0; cnt < txch->num_bd; cnt++) {
-		curr_bd = mem + (cnt * bd_size);
-		curr_bd->next = txch->bd_pool_head;
-		txch->bd_pool_head = curr_bd;
-	}
+	txch->head = txch->tail = txch->kick = txch->hw_next = 0;
+
+	/* keep room for a fully fragmented skb while the queue is awake,
+	 * but never reserve more than half of a small ring for it */
+	txch->stop_thresh = min_t(u32, EMAC_TX_MAX_BD_PER_PKT,
+				  txch->num_bd >> 1);
+	if (txch->stop_thresh == 0)
+		txch->stop_thresh = 1;
+
+	/* a doorbell batch never wraps onto the BD checked for EOQ */
+	txch->kick_batch = min_t(u32, EMAC_DEF_TX_KICK_BATCH,
+				 txch->num_bd >> 1);
+
+	/* the byte limit adapts to the wire, between two full frames and
+	 * what the ring can hold */
+	txch->byte_limit_min = 2 * emac_max_frame(priv);
+	txch->byte_limit_max = max_t(u32, txch->byte_limit_min,
+				     txch->num_bd * emac_max_frame(priv));
+	txch->byte_limit = clamp_t(u32, EMAC_DEF_TX_BYTE_LIMIT,
+				   txch->byte_limit_min, txch->byte_limit_max);
+	txch->bytes_queued = txch->bytes_completed = 0;
 
 	/* reset statistics counters */
 	txch->out_of_tx_bd = 0;
 	txch->no_active_pkts = 0;
-	txch->active_queue_count = 0;
 
 	return 0;
 }
@@ -1170,12 +2337,55 @@ static void emac_cleanup_txch(struct emac_priv *priv, u32 ch)
 	if (txch) {
 		if (txch->bd_mem)
 			txch->bd_mem = NULL;
+		kfree(txch->buf);
 		kfree(txch->tx_complete);
 		kfree(txch);
 		priv->txch[ch] = NULL;
 	}
 }
 
+/**
+ * emac_tx_unmap_buf: Release the DMA mapping of a transmitted buffer
+ * @priv: The DaVinci EMAC private adapter structure
+ * @buf: TX buffer state
+ * @sop: buffer is the first of its packet
+ *
+ * The SOP BD carries the linear part of the skb (dma_map_single), any
+ * following BD a page fragment (dma_map_page) or the shared padding
+ */
+static void emac_tx_unmap_buf(struct emac_priv *priv,
+			      struct emac_tx_buf *buf, int sop)
+{
+	if (buf->dma_addr == priv->tx_pad_dma)
+		return;
+	if (sop)
+		dma_unmap_single(emac_dma_dev(priv), buf->dma_addr,
+				 buf->length, DMA_TO_DEVICE);
+	else
+		dma_unmap_page(emac_dma_dev(priv), buf->dma_addr,
+			       buf->length, DMA_TO_DEVICE);
+}
+
+/**
+ * emac_tx_can_queue: Check TX channel room against the stop thresholds
+ * @txch: TX channel
+ *
+ * Called by xmit after stopping the queue and by completion before waking
+ * it, each after a full barrier so that neither misses the other's update
+ *
+ * Returns true when both bytes in flight and free BD's allow a packet
+ */
+static inline int emac_tx_can_queue(struct emac_txch *txch)
+{
+	u32 in_flight = ACCESS_ONCE(txch->bytes_queued) -
+			ACCESS_ONCE(txch->bytes_completed);
+	u32 free_bd = txch->num_bd - (ACCESS_ONCE(txch->head) -
+				      ACCESS_ONCE(txch->tail));
+
+	return in_flight < ACCESS_ONCE(txch->byte_limit) &&
+	       free_bd >= txch->stop_thresh;
+}
+
 /**
  * emac_net_tx_complete: TX packet completion function
  * @priv: The DaVinci EMAC private adapter structure
@@ -1191,15 +2401,20 @@ static int emac_net_tx_complete(struct emac_priv *priv,
 				int num_tokens, u32 ch)
 {
 	u32 cnt;
+	struct emac_rxch *rxch = priv->rxch[EMAC_DEF_RX_CH];
 
-	if (unlikely(num_tokens && netif_queue_stopped(priv->ndev)))
-		netif_start_queue(priv->ndev);
 	for (cnt = 0; cnt < num_tokens; cnt++) {
 		struct sk_buff *skb = (struct sk_buff *)net_data_tokens[cnt];
 		if (skb == NULL)
 			continue;
 		priv->net_dev_stats.tx_packets++;
 		priv->net_dev_stats.tx_bytes += skb->len;
+		/* forwarded RX buffers go back to the RX pool */
+		if (rxch && skb_queue_len(&rxch->pool) < rxch->pool_depth &&
+		    skb_recycle_check(skb, rxch->buf_size)) {
+			emac_rx_pool_put(priv, EMAC_DEF_RX_CH, skb);
+			continue;
+		}
 		dev_kfree_skb_any(skb);
 	}
 	return 0;
@@ -1218,7 +2433,8 @@ static void emac_txch_teardown(struct emac_priv *priv, u32 ch)
 	struct device *emac_dev = &priv->ndev->dev;
 	u32 teardown_cnt = 0xFFFFFFF0; /* Some high value */
 	struct emac_txch *txch = priv->txch[ch];
-	struct emac_tx_bd __iomem *curr_bd;
+	struct emac_tx_buf *sop;
+	u32 idx, cnt;
 
 	while ((emac_read(EMAC_TXCP(ch)) & EMAC_TEARDOWN_VALUE) !=
 	       EMAC_TEARDOWN_VALUE) {
@@ -1233,20 +2449,18 @@ static void emac_txch_teardown(struct emac_priv *priv, u32 ch)
 	emac_write(EMAC_TXCP(ch), EMAC_TEARDOWN_VALUE);
 
 	/* process sent packets and return skb's to upper layer */
-	if (1 == txch->queue_active) {
-		curr_bd = txch->active_queue_head;
-		while (curr_bd != NULL) {
-			emac_net_tx_complete(priv, (void __force *)
-					&curr_bd->buf_token, 1, ch);
-			if (curr_bd != txch->active_queue_tail)
-				curr_bd = curr_bd->next;
-			else
-				break;
-		}
-		txch->bd_pool_head = txch->active_queue_head;
-		txch->active_queue_head =
-		txch->active_queue_tail = NULL;
+	idx = txch->tail;
+	while (idx != txch->head) {
+		sop = EMAC_TX_BUF(txch, idx);
+		for (cnt = 0; cnt < sop->num_bd; cnt++)
+			emac_tx_unmap_buf(priv, EMAC_TX_BUF(txch, idx + cnt),
+					  cnt == 0);
+		emac_net_tx_complete(priv, (void **)&sop->skb, 1, ch);
+		txch->bytes_completed += sop->pkt_length;
+		idx += sop->num_bd;
 	}
+	txch->tail = txch->kick = txch->hw_next = idx;
+	txch->queue_active = 0;
 }
 
 /**
@@ -1263,37 +2477,91 @@ static void emac_stop_txch(struct emac_priv *priv, u32 ch)
 
 	if (txch) {
 		txch->teardown_pending = 1;
-		emac_write(EMAC_TXTEARDOWN, 0);
+		emac_write(EMAC_TXTEARDOWN, ch);
 		emac_txch_teardown(priv, ch);
 		txch->teardown_pending = 0;
 		emac_write(EMAC_TXINTMASKCLEAR, BIT(ch));
 	}
 }
 
+/**
+ * emac_tx_eoq: Handle a TX packet completed with end of queue
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: TX channel number
+ * @eop: ring index of the EOP BD flagged EOQ
+ *
+ * The hardware stopped at @eop. Restart it on the next packet if xmit
+ * has queued one (misqueued packet), otherwise record where the next
+ * doorbell has to start it. The EOQ flag is cleared by whoever restarts
+ * the hardware, so a stop is acted upon exactly once.
+ */
+static void emac_tx_eoq(struct emac_priv *priv, u32 ch, u32 eop)
+{
+	struct emac_txch *txch = priv->txch[ch];
+	struct emac_tx_bd __iomem *eop_bd = EMAC_TX_BD(txch, eop);
+	u32 next = eop + 1;
+	u32 frame_status;
+
+	spin_lock(&txch->lock);
+	frame_status = eop_bd->mode;
+	if (!(frame_status & EMAC_CPPI_EOQ_BIT))
+		goto out; /* restarted by the xmit doorbell */
+	eop_bd->mode = frame_status & ~EMAC_CPPI_EOQ_BIT;
+
+	if (ACCESS_ONCE(txch->head) == next) {
+		txch->queue_active = 0; /* end of queue */
+		txch->hw_next = next;
+		smp_mb(); /* pairs with xmit: head update, queue_active read */
+		if (ACCESS_ONCE(txch->head) == next) {
+			/* all in flight bytes went out while the queue was
+			 * stopped: the limit is starving the wire */
+			if (__netif_subqueue_stopped(priv->ndev, ch)) {
+				++txch->starved;
+				txch->byte_limit = min(txch->byte_limit_max,
+					txch->byte_limit +
+					(txch->byte_limit >> 1));
+			}
+			goto out;
+		}
+	}
+
+	/* misqueued packet */
+	emac_write(EMAC_TXHDP(ch),
+		   emac_virt_to_phys(EMAC_TX_BD(txch, next), priv));
+	txch->queue_active = 1;
+	++txch->mis_queued_packets;
+out:
+	spin_unlock(&txch->lock);
+}
+
 /**
  * emac_tx_bdproc: TX buffer descriptor (packet) processing
  * @priv: The DaVinci EMAC private adapter structure
  * @ch: TX channel number to process buffer descriptors for
  * @budget: number of packets allowed to process
- * @pending: indication to caller that packets are pending to process
  *
  * Processes TX buffer descriptors after packets are transmitted - checks
- * ownership bit on the TX * descriptor and requeues it to free pool & frees
- * the SKB buffer. Only "budget" number of packets are processed and
- * indication of pending packets provided to the caller
+ * ownership bit on the SOP descriptor, retires the packet's BD's from the
+ * ring & frees the SKB buffer. Only "budget" number of packets are
+ * processed. Runs lockless against xmit queueing: only the ring tail and
+ * completed byte count are written here. NAPI and xmit reclaim both retire,
+ * whoever finds the reaping bit taken leaves the work to the other.
  *
  * Returns number of packets processed
  */
 static int emac_tx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 {
 	struct device *emac_dev = &priv->ndev->dev;
-	unsigned long flags;
 	u32 frame_status;
 	u32 pkts_processed = 0;
 	u32 tx_complete_cnt = 0;
-	struct emac_tx_bd __iomem *curr_bd;
+	u32 bytes = 0;
+	u32 head, tail, eop, idx;
+	struct emac_tx_bd __iomem *eop_bd;
+	struct emac_tx_buf *sop;
 	struct emac_txch *txch = priv->txch[ch];
 	u32 *tx_complete_ptr = txch->tx_complete;
+	u64 start;
 
 	if (unlikely(1 == txch->teardown_pending)) {
 		if (netif_msg_tx_err(priv) && net_ratelimit()) {
@@ -1303,53 +2571,216 @@ static int emac_tx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 		return 0;  /* dont handle any pkt completions */
 	}
 
+	if (test_and_set_bit_lock(0, &txch->reaping))
+		return 0;
+
 	++txch->proc_count;
-	spin_lock_irqsave(&priv->tx_lock, flags);
-	curr_bd = txch->active_queue_head;
-	if (NULL == curr_bd) {
+	start = emac_bench_now();
+	head = ACCESS_ONCE(txch->head);
+	smp_rmb(); /* ring entries before head are valid */
+	tail = txch->tail;
+	if (tail == head) {
 		emac_write(EMAC_TXCP(ch),
 			   emac_virt_to_phys(txch->last_hw_bdprocessed, priv));
 		txch->no_active_pkts++;
-		spin_unlock_irqrestore(&priv->tx_lock, flags);
+		clear_bit_unlock(0, &txch->reaping);
 		return 0;
 	}
-	BD_CACHE_INVALIDATE(curr_bd, EMAC_BD_LENGTH_FOR_CACHE);
-	frame_status = curr_bd->mode;
-	while ((curr_bd) &&
-	      ((frame_status & EMAC_CPPI_OWNERSHIP_BIT) == 0) &&
-	      (pkts_processed < budget)) {
-		emac_write(EMAC_TXCP(ch), emac_virt_to_phys(curr_bd, priv));
-		txch->active_queue_head = curr_bd->next;
-		if (frame_status & EMAC_CPPI_EOQ_BIT) {
-			if (curr_bd->next) {	/* misqueued packet */
-				emac_write(EMAC_TXHDP(ch), curr_bd->h_next);
-				++txch->mis_queued_packets;
-			} else {
-				txch->queue_active = 0; /* end of queue */
-			}
-		}
-		*tx_complete_ptr = (u32) curr_bd->buf_token;
+
+	/* ownership is released on the SOP BD and EOQ flagged on the EOP BD,
+	 * so every iteration retires one packet (SOP upto its EOP BD) */
+	while (tail != head && pkts_processed < budget) {
+		frame_status = EMAC_TX_BD(txch, tail)->mode;
+		if (frame_status & EMAC_CPPI_OWNERSHIP_BIT)
+			break;
+		sop = EMAC_TX_BUF(txch, tail);
+		eop = tail + sop->num_bd - 1;
+		eop_bd = EMAC_TX_BD(txch, eop);
+		if (eop != tail)
+			frame_status = eop_bd->mode;
+		emac_write(EMAC_TXCP(ch), emac_virt_to_phys(eop_bd, priv));
+		if (unlikely(frame_status & EMAC_CPPI_EOQ_BIT))
+			emac_tx_eoq(priv, ch, eop);
+
+		for (idx = tail; idx != eop + 1; idx++)
+			emac_tx_unmap_buf(priv, EMAC_TX_BUF(txch, idx),
+					  idx == tail);
+		*tx_complete_ptr = (u32) sop->skb;
 		++tx_complete_ptr;
 		++tx_complete_cnt;
-		curr_bd->next = txch->bd_pool_head;
-		txch->bd_pool_head = curr_bd;
-		--txch->active_queue_count;
+		bytes += sop->pkt_length;
+
 		pkts_processed++;
-		txch->last_hw_bdprocessed = curr_bd;
-		curr_bd = txch->active_queue_head;
-		if (curr_bd) {
-			BD_CACHE_INVALIDATE(curr_bd, EMAC_BD_LENGTH_FOR_CACHE);
-			frame_status = curr_bd->mode;
-		}
+		txch->last_hw_bdprocessed = eop_bd;
+		tail = eop + 1;
 	} /* end of pkt processing loop */
 
+	if (pkts_processed) {
+		/* the BD's and their state belong to xmit again */
+		smp_mb();
+		ACCESS_ONCE(txch->tail) = tail;
+		ACCESS_ONCE(txch->bytes_completed) =
+			txch->bytes_completed + bytes;
+
+		/* half the limit still queued after a completion round is
+		 * slack the wire did not need: decay the limit */
+		if (txch->bytes_queued - txch->bytes_completed >
+		    (txch->byte_limit >> 1))
+			txch->byte_limit = max(txch->byte_limit_min,
+				txch->byte_limit - (txch->byte_limit >> 4));
+
+		smp_mb(); /* pairs with xmit stopping the queue */
+		if (unlikely(__netif_subqueue_stopped(priv->ndev, ch) &&
+			     emac_tx_can_queue(txch)))
+			netif_wake_subqueue(priv->ndev, ch);
+	}
+
+	emac_bench_add(priv, EMAC_BENCH_TX_REAP, start, pkts_processed);
+
+	/* free (or recycle) the skbs */
+	start = emac_bench_now();
 	emac_net_tx_complete(priv,
 			     (void *)&txch->tx_complete[0],
 			     tx_complete_cnt, ch);
-	spin_unlock_irqrestore(&priv->tx_lock, flags);
+	emac_bench_add(priv, EMAC_BENCH_TX_FREE, start, tx_complete_cnt);
+	clear_bit_unlock(0, &txch->reaping);
 	return pkts_processed;
 }
 
+/**
+ * emac_tx_reclaim: Retire sent packets from the xmit path
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: TX channel number
+ *
+ * A streaming sender keeps coming back to xmit, so what it sent earlier is
+ * retired here rather than from a TX interrupt and NAPI round. One read of
+ * the oldest SOP BD tells whether the hardware completed anything. Only
+ * xmit fills BD's, so a stale tail still points at a valid BD.
+ */
+static void emac_tx_reclaim(struct emac_priv *priv, u32 ch)
+{
+	struct emac_txch *txch = priv->txch[ch];
+	u32 tail = ACCESS_ONCE(txch->tail);
+
+	if (tx_reclaim <= 0 || tail == txch->head ||
+	    (EMAC_TX_BD(txch, tail)->mode & EMAC_CPPI_OWNERSHIP_BIT))
+		return;
+	txch->xmit_reclaimed += emac_tx_bdproc(priv, ch, txch->service_max);
+}
+
+/**
+ * emac_tx_irq_mask: Mask or unmask a TX channel interrupt
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: TX channel number
+ * @masked: leave completions to xmit reclaim
+ *
+ * Unmasking with completions not yet acknowledged raises the interrupt
+ * right away, so nothing retired while masked is lost
+ */
+static void emac_tx_irq_mask(struct emac_priv *priv, u32 ch, u32 masked)
+{
+	struct emac_txch *txch = priv->txch[ch];
+
+	spin_lock(&txch->lock);
+	if (txch->irq_masked != masked) {
+		emac_write(masked ? EMAC_TXINTMASKCLEAR : EMAC_TXINTMASKSET,
+			   BIT(ch));
+		txch->irq_masked = masked;
+		if (!masked)
+			++txch->irq_rearmed;
+	}
+	spin_unlock(&txch->lock);
+}
+
+/**
+ * emac_tx_irq_update: Keep the TX interrupt as a safety net only
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: TX channel number
+ *
+ * Called by xmit after queueing. The TX interrupt stays masked while xmit
+ * reclaim keeps up. It comes back below the tx_reclaim free BD watermark
+ * and when the queue is stopped, where only completion makes room, and
+ * from tx_reclaim_timer once xmit went quiet with packets in flight, so
+ * that their skbs do not wait for the next packet to be released.
+ */
+static void emac_tx_irq_update(struct emac_priv *priv, u32 ch)
+{
+	struct emac_txch *txch = priv->txch[ch];
+	u32 in_flight = txch->head - ACCESS_ONCE(txch->tail);
+	u32 masked = tx_reclaim > 0 &&
+		     txch->num_bd - in_flight >= tx_reclaim &&
+		     !__netif_subqueue_stopped(priv->ndev, ch);
+
+	if (masked && in_flight && !timer_pending(&priv->tx_reclaim_timer))
+		mod_timer(&priv->tx_reclaim_timer, jiffies +
+			  msecs_to_jiffies(EMAC_DEF_TX_RECLAIM_MS));
+	if (masked != ACCESS_ONCE(txch->irq_masked))
+		emac_tx_irq_mask(priv, ch, masked);
+}
+
+/**
+ * emac_tx_reclaim_timer: Unmask TX interrupts xmit reclaim left masked
+ * @data: The DaVinci EMAC private adapter structure
+ *
+ * Completions of the last packets of a burst are left to the interrupt,
+ * the next xmit masks it again
+ */
+static void emac_tx_reclaim_timer(unsigned long data)
+{
+	struct emac_priv *priv = (struct emac_priv *)data;
+	struct emac_txch *txch;
+	u32 ch;
+
+	for (ch = 0; ch < priv->num_tx_ch; ch++) {
+		txch = priv->txch[ch];
+		if (txch && ACCESS_ONCE(txch->irq_masked))
+			emac_tx_irq_mask(priv, ch, 0);
+	}
+}
+
+/**
+ * emac_tx_kick: Ring the TX doorbell for the BD's queued since the last one
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: TX channel number
+ *
+ * Packets are chained behind each other as they are queued and the
+ * hardware follows the chain while it is running, so the doorbell only has
+ * to start an idle channel, or restart it if it reached the end of queue
+ * just before the batch was chained - one TXHDP write and one uncached EOQ
+ * read per batch. A stop within the batch is restarted on completion.
+ */
+static void emac_tx_kick(struct emac_priv *priv, u32 ch)
+{
+	struct emac_txch *txch = priv->txch[ch];
+	struct emac_tx_bd __iomem *tail_bd;
+	u32 head = txch->head;
+	u32 frame_status;
+
+	if (txch->kick == head)
+		return;
+
+	spin_lock(&txch->lock);
+	if (!txch->queue_active) {
+		if (txch->hw_next != head) {
+			emac_write(EMAC_TXHDP(ch), emac_virt_to_phys(
+				   EMAC_TX_BD(txch, txch->hw_next), priv));
+			txch->queue_active = 1;
+			++txch->queue_reinit;
+		}
+	} else {
+		tail_bd = EMAC_TX_BD(txch, txch->kick - 1);
+		frame_status = tail_bd->mode;
+		if (frame_status & EMAC_CPPI_EOQ_BIT) {
+			tail_bd->mode = frame_status & ~EMAC_CPPI_EOQ_BIT;
+			emac_write(EMAC_TXHDP(ch), emac_virt_to_phys(
+				   EMAC_TX_BD(txch, txch->kick), priv));
+			++txch->end_of_queue_add;
+		}
+	}
+	txch->kick = head;
+	spin_unlock(&txch->lock);
+}
+
 #define EMAC_ERR_TX_OUT_OF_BD -1
 
 /**
@@ -1364,76 +2795,87 @@ static int emac_tx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
  */
 static int emac_send(struct emac_priv *priv, struct emac_netpktobj *pkt, u32 ch)
 {
-	unsigned long flags;
-	struct emac_tx_bd __iomem *curr_bd;
+	struct emac_tx_bd __iomem *curr_bd = NULL;
+	struct emac_tx_bd __iomem *sop_bd;
+	struct emac_tx_bd __iomem *prev_bd = NULL;
+	struct emac_tx_buf *buf;
 	struct emac_txch *txch;
 	struct emac_netbufobj *buf_list;
+	struct netdev_queue *txq;
+	u32 head;
+	int cnt;
 
 	txch = priv->txch[ch];
 	buf_list = pkt->buf_list;   /* get handle to the buffer array */
 
-	/* check packet size and pad if short */
-	if (pkt->pkt_length < EMAC_DEF_MIN_ETHPKTSIZE) {
-		buf_list->length += (EMAC_DEF_MIN_ETHPKTSIZE - pkt->pkt_length);
-		pkt->pkt_length = EMAC_DEF_MIN_ETHPKTSIZE;
-	}
-
-	spin_lock_irqsave(&priv->tx_lock, flags);
-	curr_bd = txch->bd_pool_head;
-	if (curr_bd == NULL) {
+	head = txch->head;
+	if (unlikely(txch->num_bd - (head - ACCESS_ONCE(txch->tail)) <
+		     pkt->num_bufs)) {
 		txch->out_of_tx_bd++;
-		spin_unlock_irqrestore(&priv->tx_lock, flags);
+		emac_tx_kick(priv, ch);
 		return EMAC_ERR_TX_OUT_OF_BD;
 	}
 
-	txch->bd_pool_head = curr_bd->next;
-	curr_bd->buf_token = buf_list->buf_token;
-	/* FIXME buff_ptr = dma_map_single(... data_ptr ...) */
-	curr_bd->buff_ptr = virt_to_phys(buf_list->data_ptr);
-	curr_bd->off_b_len = buf_list->length;
-	curr_bd->h_next = 0;
-	curr_bd->next = NULL;
-	curr_bd->mode = (EMAC_CPPI_SOP_BIT | EMAC_CPPI_OWNERSHIP_BIT |
-			 EMAC_CPPI_EOP_BIT | pkt->pkt_length);
-
-	/* flush the packet from cache if write back cache is present */
-	BD_CACHE_WRITEBACK_INVALIDATE(curr_bd, EMAC_BD_LENGTH_FOR_CACHE);
-
-	/* send the packet */
-	if (txch->active_queue_head == NULL) {
-		txch->active_queue_head = curr_bd;
-		txch->active_queue_tail = curr_bd;
-		if (1 != txch->queue_active) {
-			emac_write(EMAC_TXHDP(ch),
-					emac_virt_to_phys(curr_bd, priv));
-			txch->queue_active = 1;
-		}
-		++txch->queue_reinit;
-	} else {
-		register struct emac_tx_bd __iomem *tail_bd;
-		register u32 frame_status;
-
-		tail_bd = txch->active_queue_tail;
-		tail_bd->next = curr_bd;
-		txch->active_queue_tail = curr_bd;
-		tail_bd = EMAC_VIRT_NOCACHE(tail_bd);
-		tail_bd->h_next = (int)emac_virt_to_phys(curr_bd, priv);
-		frame_status = tail_bd->mode;
-		if (frame_status & EMAC_CPPI_EOQ_BIT) {
-			emac_write(EMAC_TXHDP(ch),
-				emac_virt_to_phys(curr_bd, priv));
-			frame_status &= ~(EMAC_CPPI_EOQ_BIT);
-			tail_bd->mode = frame_status;
-			++txch->end_of_queue_add;
+	/* fill one BD per buffer, SOP on the first and EOP on the last */
+	sop_bd = EMAC_TX_BD(txch, head);
+	for (cnt = 0; cnt < pkt->num_bufs; cnt++, buf_list++) {
+		curr_bd = EMAC_TX_BD(txch, head + cnt);
+		buf = EMAC_TX_BUF(txch, head + cnt);
+		buf->dma_addr = buf_list->dma_addr;
+		buf->length = buf_list->length;
+
+		curr_bd->buff_ptr = buf_list->dma_addr;
+		curr_bd->off_b_len = buf_list->length;
+		curr_bd->h_next = 0;
+		if (prev_bd) {
+			curr_bd->mode = 0;
+			prev_bd->h_next = emac_virt_to_phys(curr_bd, priv);
 		}
+		prev_bd = curr_bd;
 	}
-	txch->active_queue_count++;
-	spin_unlock_irqrestore(&priv->tx_lock, flags);
+	buf = EMAC_TX_BUF(txch, head);
+	buf->skb = pkt->pkt_token;
+	buf->num_bd = pkt->num_bufs;
+	buf->pkt_length = pkt->pkt_length;
+	if (curr_bd != sop_bd)
+		curr_bd->mode = EMAC_CPPI_EOP_BIT;
+	sop_bd->mode = EMAC_CPPI_SOP_BIT | EMAC_CPPI_OWNERSHIP_BIT |
+		       (curr_bd == sop_bd ? EMAC_CPPI_EOP_BIT : 0) |
+		       pkt->pkt_length;
+
+	/* chain the packet behind the previous one, a running channel picks
+	 * it up on its own. The doorbell is deferred to the end of the batch */
+	wmb();
+	EMAC_TX_BD(txch, head - 1)->h_next = emac_virt_to_phys(sop_bd, priv);
+
+	smp_wmb(); /* ring entries before head for completion */
+	ACCESS_ONCE(txch->head) = head + pkt->num_bufs;
+	ACCESS_ONCE(txch->bytes_queued) = txch->bytes_queued + pkt->pkt_length;
+
+	/* stop on bytes in flight, or before a worst case fragmented skb
+	 * would not fit */
+	if (unlikely(!emac_tx_can_queue(txch))) {
+		emac_tx_kick(priv, ch);
+		netif_stop_subqueue(priv->ndev, ch);
+		++txch->queue_stopped;
+		smp_mb(); /* pairs with completion waking the queue */
+		if (emac_tx_can_queue(txch))
+			netif_start_subqueue(priv->ndev, ch);
+		return 0;
+	}
+
+	/* ring the doorbell once the qdisc has nothing more for this queue,
+	 * right away if the channel went idle */
+	smp_mb(); /* pairs with end of queue: queue_active update, head read */
+	txq = netdev_get_tx_queue(priv->ndev, ch);
+	if (!ACCESS_ONCE(txch->queue_active) || !qdisc_qlen(txq->qdisc) ||
+	    txch->head - txch->kick >= txch->kick_batch)
+		emac_tx_kick(priv, ch);
 	return 0;
 }
 
 /**
- * emac_dev_xmit: EMAC Transmit function
+ * __emac_dev_xmit: EMAC Transmit function
  * @skb: SKB pointer
  * @ndev: The DaVinci EMAC network adapter
  *
@@ -1442,13 +2884,18 @@ static int emac_send(struct emac_priv *priv, struct emac_netpktobj *pkt, u32 ch)
  *
  * Returns success(NETDEV_TX_OK) or error code (typically out of desc's)
  */
-static int emac_dev_xmit(struct sk_buff *skb, struct net_device *ndev)
+static int __emac_dev_xmit(struct sk_buff *skb, struct net_device *ndev)
 {
 	struct device *emac_dev = &ndev->dev;
 	int ret_code;
-	struct emac_netbufobj tx_buf; /* buffer obj-only single frame support */
+	struct emac_netbufobj tx_buf[EMAC_TX_MAX_BD_PER_PKT]; /* head + frags */
 	struct emac_netpktobj tx_packet;  /* packet object */
 	struct emac_priv *priv = netdev_priv(ndev);
+	u16 ch = skb_get_queue_mapping(skb);
+	struct emac_txch *txch = priv->txch[ch];
+	u32 pad = 0;
+	int cnt;
+	u64 start;
 
 	/* If no link, return */
 	if (unlikely(!priv->link)) {
@@ -1457,35 +2904,144 @@ static int emac_dev_xmit(struct sk_buff *skb, struct net_device *ndev)
 		return NETDEV_TX_BUSY;
 	}
 
-	/* Build the buffer and packet objects - Since only single fragment is
-	 * supported, need not set length and token in both packet & object.
-	 * Doing so for completeness sake & to show that this needs to be done
-	 * in multifragment case
-	 */
-	tx_packet.buf_list = &tx_buf;
-	tx_packet.num_bufs = 1; /* only single fragment supported */
-	tx_packet.pkt_length = skb->len;
+	/* EMAC has no checksum engine: resolve partial checksums here. This
+	 * only reads the payload, unlike the copy + checksum the stack does
+	 * when the device does not advertise SG */
+	if (skb->ip_summed == CHECKSUM_PARTIAL && skb_checksum_help(skb))
+		goto drop;
+
+	/* Short fragmented frames (PACKET_TX_RING sends the ring frame by
+	 * reference) get their padding from emac_tx_pad in one more BD
+	 * instead of being copied. Frames with more fragments than the stop
+	 * threshold reserves are linearized */
+	if (skb_shinfo(skb)->nr_frags) {
+		if (skb->len < EMAC_DEF_MIN_ETHPKTSIZE)
+			pad = EMAC_DEF_MIN_ETHPKTSIZE - skb->len;
+		if (unlikely(skb_shinfo(skb)->nr_frags + !!pad >=
+			     txch->stop_thresh)) {
+			if (skb_linearize(skb))
+				goto drop;
+			pad = 0;
+		}
+	}
+
+	/* Zero pad short linear frames, the padding goes out in the same
+	 * buffer */
+	tx_packet.pkt_length = skb->len + pad;
+	tx_buf[0].length = skb_headlen(skb);
+	if (!pad && skb->len < EMAC_DEF_MIN_ETHPKTSIZE) {
+		if (skb_padto(skb, EMAC_DEF_MIN_ETHPKTSIZE)) {
+			priv->net_dev_stats.tx_dropped++;
+			return NETDEV_TX_OK; /* skb freed by skb_padto */
+		}
+		tx_packet.pkt_length = EMAC_DEF_MIN_ETHPKTSIZE;
+		tx_buf[0].length = EMAC_DEF_MIN_ETHPKTSIZE;
+	}
+
+	/* Build the buffer and packet objects - one buffer for the linear
+	 * part followed by one buffer per page fragment, each mapped for
+	 * DMA_TO_DEVICE which only cleans the cache */
+	tx_packet.buf_list = &tx_buf[0];
+	tx_packet.num_bufs = skb_shinfo(skb)->nr_frags + 1 + !!pad;
 	tx_packet.pkt_token = (void *)skb;
-	tx_buf.length = skb->len;
-	tx_buf.buf_token = (void *)skb;
-	tx_buf.data_ptr = skb->data;
-	EMAC_CACHE_WRITEBACK((unsigned long)skb->data, skb->len);
+	tx_buf[0].buf_token = (void *)skb;
+	tx_buf[0].data_ptr = skb->data;
+	start = emac_bench_now();
+	tx_buf[0].dma_addr = dma_map_single(emac_dma_dev(priv), skb->data,
+					    tx_buf[0].length, DMA_TO_DEVICE);
+	for (cnt = 0; cnt < skb_shinfo(skb)->nr_frags; cnt++) {
+		skb_frag_t *frag = &skb_shinfo(skb)->frags[cnt];
+		struct emac_netbufobj *buf = &tx_buf[cnt + 1];
+
+		buf->length = frag->size;
+		buf->buf_token = (void *)skb;
+		buf->data_ptr = page_address(frag->page) + frag->page_offset;
+		/* zcbuf pages were cleaned when handed to the devices; the
+		 * unmap of TO_DEVICE has nothing to undo either way */
+		if (zcbuf_page_clean(frag->page))
+			buf->dma_addr = page_to_dma(emac_dma_dev(priv),
+						    frag->page) +
+					frag->page_offset;
+		else
+			buf->dma_addr = dma_map_page(emac_dma_dev(priv),
+						     frag->page,
+						     frag->page_offset,
+						     frag->size,
+						     DMA_TO_DEVICE);
+	}
+	emac_bench_add(priv, EMAC_BENCH_TX_MAP, start, tx_packet.num_bufs);
+	if (pad) {
+		struct emac_netbufobj *buf = &tx_buf[tx_packet.num_bufs - 1];
+
+		buf->length = pad;
+		buf->buf_token = (void *)skb;
+		buf->data_ptr = emac_tx_pad;
+		buf->dma_addr = priv->tx_pad_dma;
+	}
 	ndev->trans_start = jiffies;
-	ret_code = emac_send(priv, &tx_packet, EMAC_DEF_TX_CH);
+	emac_tx_reclaim(priv, ch);
+	start = emac_bench_now();
+	ret_code = emac_send(priv, &tx_packet, ch);
+	emac_bench_add(priv, EMAC_BENCH_TX_DESC, start, 1);
 	if (unlikely(ret_code != 0)) {
+		dma_unmap_single(emac_dma_dev(priv), tx_buf[0].dma_addr,
+				 tx_buf[0].length, DMA_TO_DEVICE);
+		for (cnt = 1; cnt < tx_packet.num_bufs - !!pad; cnt++)
+			dma_unmap_page(emac_dma_dev(priv), tx_buf[cnt].dma_addr,
+				       tx_buf[cnt].length, DMA_TO_DEVICE);
 		if (ret_code == EMAC_ERR_TX_OUT_OF_BD) {
 			if (netif_msg_tx_err(priv) && net_ratelimit())
 				dev_err(emac_dev, "DaVinci EMAC: xmit() fatal"\
-					" err. Out of TX BD's");
-			netif_stop_queue(priv->ndev);
+					" err. Out of TX BD's on ch %d", ch);
+			netif_stop_subqueue(priv->ndev, ch);
+			smp_mb(); /* pairs with completion waking the queue */
+			if (emac_tx_can_queue(txch))
+				netif_start_subqueue(priv->ndev, ch);
 		}
+		emac_tx_irq_update(priv, ch);
 		priv->net_dev_stats.tx_dropped++;
 		return NETDEV_TX_BUSY;
 	}
 
+	emac_tx_irq_update(priv, ch);
+	return NETDEV_TX_OK;
+
+drop:
+	priv->net_dev_stats.tx_dropped++;
+	dev_kfree_skb_any(skb);
 	return NETDEV_TX_OK;
 }
 
+static int emac_dev_xmit(struct sk_buff *skb, struct net_device *ndev)
+{
+	u64 start = emac_bench_now();
+	int ret;
+
+	ret = __emac_dev_xmit(skb, ndev);
+	emac_bench_add(netdev_priv(ndev), EMAC_BENCH_TX_XMIT, start, 1);
+	return ret;
+}
+
+/**
+ * emac_dev_select_queue: Select TX queue (CPPI channel) for a packet
+ * @ndev: The DaVinci EMAC network adapter
+ * @skb: SKB pointer
+ *
+ * TX channels are serviced in fixed priority order by the hardware with
+ * channel 7 the highest priority, so skb->priority (TC_PRIO_xxx) is spread
+ * linearly over the channels in use: control and interactive traffic lands
+ * on the highest channel, best effort and bulk on the lowest.
+ *
+ * Returns TX queue index, which is also the CPPI TX channel number
+ */
+static u16 emac_dev_select_queue(struct net_device *ndev, struct sk_buff *skb)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	u32 prio = skb->priority & (EMAC_TXPRIO_LEVELS - 1);
+
+	return (prio * priv->num_tx_ch) / EMAC_TXPRIO_LEVELS;
+}
+
 /**
  * emac_dev_tx_timeout: EMAC Transmit timeout function
  * @ndev: The DaVinci EMAC network adapter
@@ -1500,17 +3056,21 @@ static void emac_dev_tx_timeout(struct net_device *ndev)
 {
 	struct emac_priv *priv = netdev_priv(ndev);
 	struct device *emac_dev = &ndev->dev;
+	u32 ch;
 
 	if (netif_msg_tx_err(priv))
 		dev_err(emac_dev, "DaVinci EMAC: xmit timeout, restarting TX");
 
 	priv->net_dev_stats.tx_errors++;
 	emac_int_disable(priv);
-	emac_stop_txch(priv, EMAC_DEF_TX_CH);
-	emac_cleanup_txch(priv, EMAC_DEF_TX_CH);
-	emac_init_txch(priv, EMAC_DEF_TX_CH);
-	emac_write(EMAC_TXHDP(0), 0);
-	emac_write(EMAC_TXINTMASKSET, BIT(EMAC_DEF_TX_CH));
+	del_timer_sync(&priv->tx_reclaim_timer);
+	for (ch = 0; ch < priv->num_tx_ch; ch++) {
+		emac_stop_txch(priv, ch);
+		emac_cleanup_txch(priv, ch);
+		emac_init_txch(priv, ch);
+		emac_write(EMAC_TXHDP(ch), 0);
+		emac_write(EMAC_TXINTMASKSET, BIT(ch));
+	}
 	emac_int_enable(priv);
 }
 
@@ -1531,8 +3091,40 @@ static void *emac_net_alloc_rx_buf(struct emac_priv *priv, int buf_size,
 {
 	struct net_device *ndev = priv->ndev;
 	struct device *emac_dev = &ndev->dev;
+	struct emac_rxch *rxch = priv->rxch[ch];
 	struct sk_buff *p_skb;
+	struct page *page;
+
+	if (rxch->frags) {
+		if (!list_empty(&priv->rx_park_pages[ch])) {
+			page = list_first_entry(&priv->rx_park_pages[ch],
+						struct page, lru);
+			list_del(&page->lru);
+			*data_token = (void *) page;
+			return page_address(page);
+		}
+		page = alloc_page(GFP_ATOMIC);
+		if (unlikely(NULL == page)) {
+			if (netif_msg_rx_err(priv) && net_ratelimit())
+				dev_err(emac_dev, "DaVinci EMAC: failed to "\
+					"alloc page");
+			return NULL;
+		}
+		set_page_private(page, dma_map_page(emac_dma_dev(priv), page,
+				 0, PAGE_SIZE, DMA_FROM_DEVICE));
+		*data_token = (void *) page;
+		return page_address(page);
+	}
 
+	/* pooled buffers are already set up and invalidated */
+	p_skb = skb_dequeue(&rxch->pool);
+	if (likely(p_skb)) {
+		++rxch->pool_hits;
+		*data_token = (void *) p_skb;
+		return p_skb->data;
+	}
+
+	++rxch->pool_misses;
 	p_skb = dev_alloc_skb(buf_size);
 	if (unlikely(NULL == p_skb)) {
 		if (netif_msg_rx_err(priv) && net_ratelimit())
@@ -1544,10 +3136,13 @@ static void *emac_net_alloc_rx_buf(struct emac_priv *priv, int buf_size,
 	p_skb->dev = ndev;
 	skb_reserve(p_skb, NET_IP_ALIGN);
 	*data_token = (void *) p_skb;
-	EMAC_CACHE_WRITEBACK_INVALIDATE((unsigned long)p_skb->data, buf_size);
+	EMAC_SKB_CB(p_skb)->dma_addr = dma_map_single(emac_dma_dev(priv),
+				p_skb->data, buf_size, DMA_FROM_DEVICE);
 	return p_skb->data;
 }
 
+static void emac_cleanup_rxch(struct emac_priv *priv, u32 ch);
+
 /**
  * emac_init_rxch: RX channel initialization
  * @priv: The DaVinci EMAC private adapter structure
@@ -1574,9 +3169,15 @@ static int emac_init_rxch(struct emac_priv *priv, u32 ch, char *param)
 	}
 	priv->rxch[ch] = rxch;
 	rxch->buf_size = priv->rx_buf_size;
+	rxch->frags = priv->rx_frags;
 	rxch->service_max = EMAC_DEF_RX_MAX_SERVICE;
 	rxch->queue_active = 0;
 	rxch->teardown_pending = 0;
+	skb_queue_head_init(&rxch->pool);
+	rxch->pool_depth = rxch->frags ? 0 : max(rx_pool_depth, 0);
+
+	/* skbs parked at the last stop fill the ring through the pool */
+	skb_queue_splice_init(&priv->rx_park[ch], &rxch->pool);
 
 	/* save mac address */
 	for (cnt = 0; cnt < 6; cnt++)
@@ -1584,10 +3185,10 @@ static int emac_init_rxch(struct emac_priv *priv, u32 ch, char *param)
 
 	/* allocate buffer descriptor pool align every BD on four word
 	 * boundry for future requirements */
-	bd_size = (sizeof(struct emac_rx_bd) + 0xF) & ~0xF;
-	rxch->num_bd = (priv->ctrl_ram_size >> 1) / bd_size;
+	bd_size = EMAC_RX_BD_SIZE;
+	rxch->num_bd = priv->rx_ring_size;
 	rxch->alloc_size = (((bd_size * rxch->num_bd) + 0xF) & ~0xF);
-	rxch->bd_mem = EMAC_RX_BD_MEM(priv);
+	rxch->bd_mem = priv->rx_bd_mem[ch];
 	__memzero((void __force *)rxch->bd_mem, rxch->alloc_size);
 	rxch->pkt_queue.buf_list = &rxch->buf_queue;
 
@@ -1602,19 +3203,18 @@ static int emac_init_rxch(struct emac_priv *priv, u32 ch, char *param)
 		curr_bd->data_ptr = emac_net_alloc_rx_buf(priv,
 				    rxch->buf_size,
 				    (void __force **)&curr_bd->buf_token,
-				    EMAC_DEF_RX_CH);
+				    ch);
 		if (curr_bd->data_ptr == NULL) {
 			dev_err(emac_dev, "DaVinci EMAC: RX buf mem alloc " \
 				"failed for ch %d\n", ch);
-			kfree(rxch);
+			emac_cleanup_rxch(priv, ch);
 			return -ENOMEM;
 		}
 
 		/* populate the hardware descriptor */
 		curr_bd->h_next = emac_virt_to_phys(rxch->active_queue_head,
 				priv);
-		/* FIXME buff_ptr = dma_map_single(... data_ptr ...) */
-		curr_bd->buff_ptr = virt_to_phys(curr_bd->data_ptr);
+		curr_bd->buff_ptr = emac_rx_buf_dma(rxch, curr_bd->buf_token);
 		curr_bd->off_b_len = rxch->buf_size;
 		curr_bd->mode = EMAC_CPPI_OWNERSHIP_BIT;
 
@@ -1629,6 +3229,21 @@ static int emac_init_rxch(struct emac_priv *priv, u32 ch, char *param)
 	   RX BD ready to be given to RX HDP and rxch->active_queue_tail
 	   points to the last RX BD
 	 */
+
+	/* prefill the spare buffer pool, ring buffers are not pool misses;
+	 * parked buffers beyond what ring and pool take are freed */
+	rxch->pool_misses = 0;
+	rxch->pool_hits = 0;
+	while (skb_queue_len(&rxch->pool) > rxch->pool_depth)
+		emac_rx_skb_free(priv, ch, skb_dequeue(&rxch->pool));
+	emac_rx_pool_fill(priv, ch, GFP_KERNEL);
+	while (!list_empty(&priv->rx_park_pages[ch])) {
+		struct page *page = list_first_entry(&priv->rx_park_pages[ch],
+						     struct page, lru);
+
+		list_del(&page->lru);
+		emac_rx_buf_free(priv, ch, page);
+	}
 	return 0;
 }
 
@@ -1692,19 +3307,22 @@ static void emac_cleanup_rxch(struct emac_priv *priv, u32 ch)
 {
 	struct emac_rxch *rxch = priv->rxch[ch];
 	struct emac_rx_bd __iomem *curr_bd;
+	struct sk_buff *skb;
 
 	if (rxch) {
-		/* free the receive buffers previously allocated */
+		/* keep the receive buffers, mapped, for the next open */
+		priv->rx_park_buf_size = rxch->buf_size;
+		priv->rx_park_frags = rxch->frags;
 		curr_bd = rxch->active_queue_head;
 		while (curr_bd) {
-			if (curr_bd->buf_token) {
-				dev_kfree_skb_any((struct sk_buff *)\
-						  curr_bd->buf_token);
-			}
+			if (curr_bd->buf_token)
+				emac_rx_buf_park(priv, ch, curr_bd->buf_token);
 			curr_bd = curr_bd->next;
 		}
 		if (rxch->bd_mem)
 			rxch->bd_mem = NULL;
+		while ((skb = skb_dequeue(&rxch->pool)) != NULL)
+			emac_rx_buf_park(priv, ch, skb);
 		kfree(rxch);
 		priv->rxch[ch] = NULL;
 	}
@@ -1802,9 +3420,7 @@ static void emac_setmac(struct emac_priv *priv, u32 ch, char *mac_addr)
 	if (priv->rx_addr_type == 0) {
 		emac_set_type0addr(priv, ch, mac_addr);
 	} else if (priv->rx_addr_type == 1) {
-		u32 cnt;
-		for (cnt = 0; cnt < EMAC_MAX_TXRX_CHANNELS; cnt++)
-			emac_set_type1addr(priv, ch, mac_addr);
+		emac_set_type1addr(priv, ch, mac_addr);
 	} else if (priv->rx_addr_type == 2) {
 		emac_set_type2addr(priv, ch, mac_addr, ch, 1);
 		emac_set_type0addr(priv, ch, mac_addr);
@@ -1872,8 +3488,7 @@ static void emac_addbd_to_rx_queue(struct emac_priv *priv, u32 ch,
 
 	/* populate the hardware descriptor */
 	curr_bd->h_next = 0;
-	/* FIXME buff_ptr = dma_map_single(... buffer ...) */
-	curr_bd->buff_ptr = virt_to_phys(buffer);
+	curr_bd->buff_ptr = emac_rx_buf_dma(rxch, buf_token);
 	curr_bd->off_b_len = rxch->buf_size;
 	curr_bd->mode = EMAC_CPPI_OWNERSHIP_BIT;
 	curr_bd->next = NULL;
@@ -1916,11 +3531,31 @@ static void emac_addbd_to_rx_queue(struct emac_priv *priv, u32 ch,
  * @priv: The DaVinci EMAC private adapter structure
  * @net_pkt_list: Network packet list (received packets)
  *
- * Invalidates packet buffer memory and sends the received packet to upper
- * layer
+ * Sends the received (already unmapped) packet to upper layer
  *
  * Returns success or appropriate error code (none as of now)
  */
+/**
+ * emac_rx_handoff: Pass a received frame up
+ * @priv: The DaVinci EMAC private adapter structure
+ * @skb: the frame
+ *
+ * With the rx_sink benchmark parameter set the frame is freed right here
+ * instead, so the driver's own cost per frame can be measured apart from
+ * the stack's.
+ */
+static void emac_rx_handoff(struct emac_priv *priv, struct sk_buff *skb)
+{
+	u64 start = emac_bench_now();
+
+	skb->protocol = eth_type_trans(skb, priv->ndev);
+	if (rx_sink)
+		dev_kfree_skb(skb);
+	else
+		napi_gro_receive(&priv->napi, skb);
+	emac_bench_add(priv, EMAC_BENCH_RX_STACK, start, 1);
+}
+
 static int emac_net_rx_cb(struct emac_priv *priv,
 			  struct emac_netpktobj *net_pkt_list)
 {
@@ -1928,14 +3563,317 @@ static int emac_net_rx_cb(struct emac_priv *priv,
 	p_skb = (struct sk_buff *)net_pkt_list->pkt_token;
 	/* set length of packet */
 	skb_put(p_skb, net_pkt_list->pkt_length);
-	EMAC_CACHE_INVALIDATE((unsigned long)p_skb->data, p_skb->len);
-	p_skb->protocol = eth_type_trans(p_skb, priv->ndev);
-	netif_receive_skb(p_skb);
+	emac_rx_handoff(priv, p_skb);
 	priv->net_dev_stats.rx_bytes += net_pkt_list->pkt_length;
 	priv->net_dev_stats.rx_packets++;
 	return 0;
 }
 
+/* masked compare of a header field against a stored, pre-masked one */
+static bool emac_rx_field_match(const void *field, const void *value,
+				const void *mask, int len)
+{
+	const u8 *f = field, *v = value, *m = mask;
+
+	while (len--)
+		if ((*f++ & *m++) != *v++)
+			return false;
+	return true;
+}
+
+static bool emac_rx_rule_match(const struct ethtool_rx_flow_spec *fs,
+			       const struct ethhdr *eth, __be16 proto,
+			       const struct iphdr *iph, const __be16 *ports)
+{
+	const struct ethtool_tcpip4_spec *h, *m;
+	u8 ip_proto = IPPROTO_UDP;
+
+	switch (fs->flow_type) {
+	case ETHER_FLOW:
+		return emac_rx_field_match(eth->h_dest,
+				fs->h_u.ether_spec.h_dest,
+				fs->m_u.ether_spec.h_dest, ETH_ALEN) &&
+			emac_rx_field_match(eth->h_source,
+				fs->h_u.ether_spec.h_source,
+				fs->m_u.ether_spec.h_source, ETH_ALEN) &&
+			(proto & fs->m_u.ether_spec.h_proto) ==
+				fs->h_u.ether_spec.h_proto;
+	case TCP_V4_FLOW:
+		ip_proto = IPPROTO_TCP;
+		/* fall through */
+	case UDP_V4_FLOW:
+		if (!iph || iph->protocol != ip_proto)
+			return false;
+		h = &fs->h_u.tcp_ip4_spec;
+		m = &fs->m_u.tcp_ip4_spec;
+		if ((iph->saddr & m->ip4src) != h->ip4src ||
+		    (iph->daddr & m->ip4dst) != h->ip4dst ||
+		    (iph->tos & m->tos) != h->tos)
+			return false;
+		if (!m->psrc && !m->pdst)
+			return true;
+		/* later fragments carry no ports */
+		return ports && (ports[0] & m->psrc) == h->psrc &&
+			(ports[1] & m->pdst) == h->pdst;
+	}
+	return false;
+}
+
+/* the rule's verdict, counting the frame against its rate limit */
+static bool emac_rx_rule_drop(struct emac_rx_rule *rule)
+{
+	if (rule->fs.ring_cookie == RX_CLS_FLOW_DISC)
+		return true;
+	if (!rule->rate)
+		return false;
+	if (time_after_eq(jiffies, rule->window + HZ)) {
+		rule->window = jiffies;
+		rule->count = 0;
+	}
+	return ++rule->count > rule->rate;
+}
+
+static bool emac_rx_classify(struct emac_priv *priv, const u8 *data,
+			     u32 len)
+{
+	const struct ethhdr *eth = (const struct ethhdr *)data;
+	const struct iphdr *iph = NULL;
+	const __be16 *ports = NULL;
+	u32 off = ETH_HLEN;
+	__be16 proto;
+	int i;
+
+	if (len < ETH_HLEN)
+		return false;
+	proto = eth->h_proto;
+	if (proto == htons(ETH_P_8021Q) && len >= VLAN_ETH_HLEN) {
+		proto = ((const struct vlan_ethhdr *)data)->
+				h_vlan_encapsulated_proto;
+		off = VLAN_ETH_HLEN;
+	}
+	if (proto == htons(ETH_P_IP) && len >= off + sizeof(*iph)) {
+		iph = (const struct iphdr *)(data + off);
+		off += iph->ihl * 4;
+		if (!(iph->frag_off & htons(IP_OFFSET)) && len >= off + 4)
+			ports = (const __be16 *)(data + off);
+	}
+
+	for (i = 0; i < EMAC_RX_RULES; i++) {
+		if ((priv->rx_rules_used & BIT(i)) &&
+		    emac_rx_rule_match(&priv->rx_rules[i].fs, eth, proto,
+				       iph, ports))
+			return emac_rx_rule_drop(&priv->rx_rules[i]);
+	}
+	return false;
+}
+
+/**
+ * emac_rx_filter: Early drop of unwanted frames
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: RX channel number
+ * @curr_bd: BD holding the frame
+ * @len: frame length
+ *
+ * Runs the frame's headers past the ethtool RX classifier rules before
+ * any buffer is allocated for it. A dropped frame leaves its buffer on
+ * the ring, so a flood of unwanted traffic costs a header look up per
+ * frame and no allocation or trip through the stack. The headers read
+ * are invalidated again either way. Called with rx_lock held.
+ *
+ * Returns true if the frame is to be dropped
+ */
+static bool emac_rx_filter(struct emac_priv *priv, u32 ch,
+			   struct emac_rx_bd __iomem *curr_bd, u32 len)
+{
+	struct emac_rxch *rxch = priv->rxch[ch];
+	struct sk_buff *skb = curr_bd->buf_token;
+	dma_addr_t dma_addr = EMAC_SKB_CB(skb)->dma_addr;
+	bool drop;
+
+	len = min_t(u32, len, EMAC_RX_FILTER_LEN);
+	dma_sync_single_for_cpu(emac_dma_dev(priv), dma_addr, len,
+				DMA_FROM_DEVICE);
+	drop = emac_rx_classify(priv, curr_bd->data_ptr, len);
+	dma_sync_single_for_device(emac_dma_dev(priv), dma_addr, len,
+				   DMA_FROM_DEVICE);
+
+	if (drop) {
+		++rxch->filtered;
+		++priv->net_dev_stats.rx_dropped;
+	}
+	return drop;
+}
+
+/**
+ * emac_rx_copybreak: Copy a small received frame out of its RX buffer
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: RX channel number
+ * @curr_bd: BD holding the frame
+ * @len: frame length
+ *
+ * The frame is copied into a right sized skb so the full size buffer can
+ * stay on the ring. Reading it pulls the copied bytes into the cache, so
+ * only those are invalidated again before the buffer goes back to the
+ * hardware.
+ *
+ * Returns the copy, or the ring skb if no copy could be allocated
+ */
+static struct sk_buff *emac_rx_copybreak(struct emac_priv *priv, u32 ch,
+					 struct emac_rx_bd __iomem *curr_bd,
+					 u32 len)
+{
+	struct emac_rxch *rxch = priv->rxch[ch];
+	struct sk_buff *skb = curr_bd->buf_token;
+	dma_addr_t dma_addr = EMAC_SKB_CB(skb)->dma_addr;
+	struct sk_buff *copy;
+
+	copy = netdev_alloc_skb(priv->ndev, len + NET_IP_ALIGN);
+	if (unlikely(copy == NULL))
+		return skb;
+	skb_reserve(copy, NET_IP_ALIGN);
+
+	dma_sync_single_for_cpu(emac_dma_dev(priv), dma_addr, len,
+				DMA_FROM_DEVICE);
+	skb_copy_to_linear_data(copy, curr_bd->data_ptr, len);
+	dma_sync_single_for_device(emac_dma_dev(priv), dma_addr, len,
+				   DMA_FROM_DEVICE);
+	++rxch->copybreak;
+	return copy;
+}
+
+/**
+ * emac_rx_frag_bdproc: RX processing with page fragment buffers
+ * @priv: The DaVinci EMAC private adapter structure
+ * @ch: RX channel number to process buffer descriptors for
+ * @budget: number of packets allowed to process
+ *
+ * Used when the MTU does not fit a page sized skb. Every BD holds a page
+ * and the hardware spreads a frame over as many BD's as it needs, clearing
+ * ownership of the SOP BD once the whole frame is in. The first
+ * EMAC_RX_HDR_COPY bytes are copied into a small skb for the protocol
+ * headers and the rest of the pages attached as fragments; a page that was
+ * copied completely stays on the ring.
+ *
+ * Returns number of packets processed
+ */
+static int emac_rx_frag_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
+{
+	struct emac_rxch *rxch = priv->rxch[ch];
+	struct device *dma_dev = emac_dma_dev(priv);
+	struct emac_rx_bd __iomem *curr_bd, *sop_bd;
+	struct sk_buff *skb;
+	struct page *page;
+	unsigned long flags;
+	u32 frame_status, pkt_length, len, copy;
+	u32 pkts_processed = 0;
+	void *token;
+
+	if (unlikely(1 == rxch->teardown_pending))
+		return 0;
+	++rxch->proc_count;
+	spin_lock_irqsave(&priv->rx_lock, flags);
+	curr_bd = rxch->active_queue_head;
+	while (curr_bd && (pkts_processed < budget)) {
+		BD_CACHE_INVALIDATE(curr_bd, EMAC_BD_LENGTH_FOR_CACHE);
+		frame_status = curr_bd->mode;
+		if (frame_status & EMAC_CPPI_OWNERSHIP_BIT)
+			break;
+
+		pkt_length = frame_status & EMAC_RX_BD_PKT_LENGTH_MASK;
+		skb = netdev_alloc_skb(priv->ndev,
+				       EMAC_RX_HDR_COPY + NET_IP_ALIGN);
+		if (likely(skb))
+			skb_reserve(skb, NET_IP_ALIGN);
+		else
+			++priv->net_dev_stats.rx_dropped;
+
+		sop_bd = curr_bd;
+		for (;;) {
+			len = curr_bd->off_b_len & EMAC_RX_BD_BUF_SIZE;
+			page = curr_bd->buf_token;
+			token = page;
+			copy = 0;
+			if (skb && curr_bd == sop_bd) {
+				copy = min_t(u32, len, EMAC_RX_HDR_COPY);
+				dma_sync_single_for_cpu(dma_dev,
+					page_private(page), copy,
+					DMA_FROM_DEVICE);
+				memcpy(skb_put(skb, copy), page_address(page),
+				       copy);
+				dma_sync_single_for_device(dma_dev,
+					page_private(page), copy,
+					DMA_FROM_DEVICE);
+			}
+			if (skb && copy < len) {
+				if (skb_shinfo(skb)->nr_frags >= MAX_SKB_FRAGS ||
+				    !emac_net_alloc_rx_buf(priv, rxch->buf_size,
+							   &token, ch)) {
+					/* drop the frame, the page goes back
+					 * to the ring unread */
+					++rxch->out_of_rx_buffers;
+					++priv->net_dev_stats.rx_dropped;
+					dev_kfree_skb_any(skb);
+					skb = NULL;
+					token = page;
+				} else {
+					dma_unmap_page(dma_dev,
+						page_private(page), PAGE_SIZE,
+						DMA_FROM_DEVICE);
+					set_page_private(page, 0);
+					skb_fill_page_desc(skb,
+						skb_shinfo(skb)->nr_frags,
+						page, copy, len - copy);
+					skb->len += len - copy;
+					skb->data_len += len - copy;
+					skb->truesize += PAGE_SIZE;
+				}
+			}
+
+			emac_write(EMAC_RXCP(ch),
+				   emac_virt_to_phys(curr_bd, priv));
+			++rxch->processed_bd;
+			rxch->active_queue_head = curr_bd->next;
+
+			/* check if end of RX queue ? */
+			if (frame_status & EMAC_CPPI_EOQ_BIT) {
+				if (curr_bd->next) {
+					++rxch->mis_queued_packets;
+					emac_write(EMAC_RXHDP(ch),
+						emac_virt_to_phys(
+						curr_bd->next, priv));
+				} else {
+					++rxch->end_of_queue;
+					rxch->queue_active = 0;
+				}
+			}
+
+			/* recycle BD, with a new page if this one was used */
+			emac_addbd_to_rx_queue(priv, ch, curr_bd,
+					       page_address(token), token);
+			curr_bd = rxch->active_queue_head;
+			if ((frame_status & EMAC_CPPI_EOP_BIT) || !curr_bd)
+				break;
+			BD_CACHE_INVALIDATE(curr_bd, EMAC_BD_LENGTH_FOR_CACHE);
+			frame_status = curr_bd->mode;
+		}
+
+		spin_unlock_irqrestore(&priv->rx_lock, flags);
+		if (likely(skb)) {
+			if (skb_shinfo(skb)->nr_frags)
+				++rxch->frag_frames;
+			emac_rx_handoff(priv, skb);
+			priv->net_dev_stats.rx_bytes += pkt_length;
+			priv->net_dev_stats.rx_packets++;
+		}
+		spin_lock_irqsave(&priv->rx_lock, flags);
+		curr_bd = rxch->active_queue_head;
+		++pkts_processed;
+	}
+
+	spin_unlock_irqrestore(&priv->rx_lock, flags);
+	return pkts_processed;
+}
+
 /**
  * emac_rx_bdproc: RX buffer descriptor (packet) processing
  * @priv: The DaVinci EMAC private adapter structure
@@ -1963,11 +3901,17 @@ static int emac_rx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 	struct emac_netbufobj buf_obj;
 	struct emac_netbufobj *rx_buf_obj;
 	void *new_buf_token;
+	struct sk_buff *rx_skb;
+	u32 pkt_length;
 	struct emac_rxch *rxch = priv->rxch[ch];
+	u64 poll_start, start;
 
+	if (rxch->frags)
+		return emac_rx_frag_bdproc(priv, ch, budget);
 	if (unlikely(1 == rxch->teardown_pending))
 		return 0;
 	++rxch->proc_count;
+	poll_start = emac_bench_now();
 	spin_lock_irqsave(&priv->rx_lock, flags);
 	pkt_obj.buf_list = &buf_obj;
 	curr_pkt = &pkt_obj;
@@ -1979,11 +3923,33 @@ static int emac_rx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 	       ((frame_status & EMAC_CPPI_OWNERSHIP_BIT) == 0) &&
 	       (pkts_processed < budget)) {
 
-		new_buffer = emac_net_alloc_rx_buf(priv, rxch->buf_size,
-					&new_buf_token, EMAC_DEF_RX_CH);
-		if (unlikely(NULL == new_buffer)) {
-			++rxch->out_of_rx_buffers;
-			goto end_emac_rx_bdproc;
+		rx_skb = curr_bd->buf_token;
+		pkt_length = frame_status & EMAC_RX_BD_PKT_LENGTH_MASK;
+		if (unlikely(priv->rx_rules_used) &&
+		    emac_rx_filter(priv, ch, curr_bd, pkt_length))
+			rx_skb = NULL;
+		else if (pkt_length < rx_copybreak)
+			rx_skb = emac_rx_copybreak(priv, ch, curr_bd,
+						   pkt_length);
+		if (rx_skb != curr_bd->buf_token) {
+			/* copied, or no buffer: the ring keeps its buffer */
+			new_buffer = curr_bd->data_ptr;
+			new_buf_token = curr_bd->buf_token;
+		} else {
+			start = emac_bench_now();
+			new_buffer = emac_net_alloc_rx_buf(priv, rxch->buf_size,
+						&new_buf_token, ch);
+			emac_bench_add(priv, EMAC_BENCH_RX_ALLOC, start, 1);
+			if (unlikely(NULL == new_buffer)) {
+				/* drop the frame and give its buffer straight
+				 * back to the ring; the CPU never read it so
+				 * nothing needs to be invalidated */
+				++rxch->out_of_rx_buffers;
+				++priv->net_dev_stats.rx_dropped;
+				new_buffer = curr_bd->data_ptr;
+				new_buf_token = curr_bd->buf_token;
+				rx_skb = NULL;
+			}
 		}
 
 		/* populate received packet data structure */
@@ -1991,10 +3957,9 @@ static int emac_rx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 		rx_buf_obj->data_ptr = (char *)curr_bd->data_ptr;
 		rx_buf_obj->length = curr_bd->off_b_len & EMAC_RX_BD_BUF_SIZE;
 		rx_buf_obj->buf_token = curr_bd->buf_token;
-		curr_pkt->pkt_token = curr_pkt->buf_list->buf_token;
+		curr_pkt->pkt_token = rx_skb;
 		curr_pkt->num_bufs = 1;
-		curr_pkt->pkt_length =
-			(frame_status & EMAC_RX_BD_PKT_LENGTH_MASK);
+		curr_pkt->pkt_length = pkt_length;
 		emac_write(EMAC_RXCP(ch), emac_virt_to_phys(curr_bd, priv));
 		++rxch->processed_bd;
 		last_bd = curr_bd;
@@ -2020,7 +3985,17 @@ static int emac_rx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 		/* return the packet to the user - BD ptr passed in
 		 * last parameter for potential *future* use */
 		spin_unlock_irqrestore(&priv->rx_lock, flags);
-		emac_net_rx_cb(priv, curr_pkt);
+		if (rx_skb == rx_buf_obj->buf_token) {
+			/* the buffer was invalidated when it was mapped, so
+			 * handing it to the CPU needs no further maintenance */
+			start = emac_bench_now();
+			dma_unmap_single(emac_dma_dev(priv),
+				EMAC_SKB_CB(rx_skb)->dma_addr,
+				rxch->buf_size, DMA_FROM_DEVICE);
+			emac_bench_add(priv, EMAC_BENCH_RX_UNMAP, start, 1);
+		}
+		if (likely(rx_skb))
+			emac_net_rx_cb(priv, curr_pkt);
 		spin_lock_irqsave(&priv->rx_lock, flags);
 		curr_bd = rxch->active_queue_head;
 		if (curr_bd) {
@@ -2030,8 +4005,8 @@ static int emac_rx_bdproc(struct emac_priv *priv, u32 ch, u32 budget)
 		++pkts_processed;
 	}
 
-end_emac_rx_bdproc:
 	spin_unlock_irqrestore(&priv->rx_lock, flags);
+	emac_bench_add(priv, EMAC_BENCH_RX_POLL, poll_start, pkts_processed);
 	return pkts_processed;
 }
 
@@ -2072,16 +4047,16 @@ static int emac_hw_enable(struct emac_priv *priv)
 		 ((EMAC_DEF_SHORT_FRAME_EN) ? (EMAC_RXMBP_CSFEN_MASK) : 0x0) |
 		 ((EMAC_DEF_ERROR_FRAME_EN) ? (EMAC_RXMBP_CEFEN_MASK) : 0x0) |
 		 ((EMAC_DEF_PROM_EN) ? (EMAC_RXMBP_CAFEN_MASK) : 0x0) |
-		 ((EMAC_DEF_PROM_CH & EMAC_RXMBP_CHMASK) << \
+		 ((priv->rx_prom_ch & EMAC_RXMBP_CHMASK) << \
 			EMAC_RXMBP_PROMCH_SHIFT) |
 		 ((EMAC_DEF_BCAST_EN) ? (EMAC_RXMBP_BROADEN_MASK) : 0x0) |
-		 ((EMAC_DEF_BCAST_CH & EMAC_RXMBP_CHMASK) << \
+		 ((priv->rx_bcast_ch & EMAC_RXMBP_CHMASK) << \
 			EMAC_RXMBP_BROADCH_SHIFT) |
 		 ((EMAC_DEF_MCAST_EN) ? (EMAC_RXMBP_MULTIEN_MASK) : 0x0) |
-		 ((EMAC_DEF_MCAST_CH & EMAC_RXMBP_CHMASK) << \
+		 ((priv->rx_mcast_ch & EMAC_RXMBP_CHMASK) << \
 			EMAC_RXMBP_MULTICH_SHIFT));
 	emac_write(EMAC_RXMBPENABLE, mbp_enable);
-	emac_write(EMAC_RXMAXLEN, (EMAC_DEF_MAX_FRAME_SIZE &
+	emac_write(EMAC_RXMAXLEN, (emac_max_frame(priv) &
 				   EMAC_RX_MAX_LEN_MASK));
 	emac_write(EMAC_RXBUFFEROFFSET, (EMAC_DEF_BUFFER_OFFSET &
 					 EMAC_RX_BUFFER_OFFSET_MASK));
@@ -2095,36 +4070,211 @@ static int emac_hw_enable(struct emac_priv *priv)
 	val = emac_read(EMAC_RXCONTROL);
 	val |= EMAC_RX_CONTROL_RX_ENABLE_VAL;
 	emac_write(EMAC_RXCONTROL, val);
-	emac_write(EMAC_MACINTMASKSET, EMAC_MAC_HOST_ERR_INTMASK_VAL);
+	emac_write(EMAC_MACINTMASKSET, EMAC_MAC_HOST_ERR_INTMASK_VAL |
+		   EMAC_MAC_STAT_INTMASK_VAL);
 
-	for (ch = 0; ch < EMAC_DEF_MAX_TX_CH; ch++) {
+	for (ch = 0; ch < priv->num_tx_ch; ch++) {
 		emac_write(EMAC_TXHDP(ch), 0);
 		emac_write(EMAC_TXINTMASKSET, BIT(ch));
 	}
-	for (ch = 0; ch < EMAC_DEF_MAX_RX_CH; ch++) {
+	for (ch = 0; ch < priv->num_rx_ch; ch++) {
 		struct emac_rxch *rxch = priv->rxch[ch];
-		emac_setmac(priv, ch, rxch->mac_addr);
+		/* unicast frames for our address land on the default channel,
+		 * the other channels only see what the MBP register steers */
+		if (ch == EMAC_DEF_RX_CH)
+			emac_setmac(priv, ch, rxch->mac_addr);
 		emac_write(EMAC_RXINTMASKSET, BIT(ch));
 		rxch->queue_active = 1;
 		emac_write(EMAC_RXHDP(ch),
 			   emac_virt_to_phys(rxch->active_queue_head, priv));
 	}
 
-	/* Enable MII */
-	val = emac_read(EMAC_MACCONTROL);
-	val |= (EMAC_MACCONTROL_GMIIEN);
-	emac_write(EMAC_MACCONTROL, val);
+	/* Enable MII */
+	val = emac_read(EMAC_MACCONTROL);
+	val |= (EMAC_MACCONTROL_GMIIEN);
+	emac_write(EMAC_MACCONTROL, val);
+
+	/* Restore interrupt pacing */
+	priv->coal_cur_usecs = emac_set_pacing(priv, priv->rx_coal_usecs,
+					       priv->tx_coal_usecs);
+	priv->coal_pkts = 0;
+	priv->coal_sample_end = jiffies + priv->coal_sample_secs * HZ;
+
+	/* Enable NAPI and interrupts */
+	napi_enable(&priv->napi);
+	emac_int_enable(priv);
+	return 0;
+
+}
+
+/**
+ * emac_rx_latency: Account interrupt to RX processing latency
+ * @priv: The DaVinci EMAC private adapter structure
+ *
+ * The first RX pass after an interrupt adds the time since the interrupt
+ * to a log2 usecs histogram; passes finding frames without an interrupt
+ * (busy polling) are only counted.
+ */
+static void emac_rx_latency(struct emac_priv *priv)
+{
+	s64 usecs;
+	u32 bucket = 0;
+
+	if (priv->irq_stamp.tv64 == 0) {
+		++priv->rx_polled;
+		return;
+	}
+	usecs = ktime_us_delta(ktime_get(), priv->irq_stamp);
+	priv->irq_stamp.tv64 = 0;
+	if (usecs > 0)
+		bucket = min_t(u32, ilog2((u32)min_t(s64, usecs, 1 << 30)) + 1,
+			       EMAC_LAT_BUCKETS - 1);
+	++priv->rx_lat_hist[bucket];
+}
+
+/**
+ * emac_qos_activity: Account packets towards the CPU frequency floor
+ * @priv: The DaVinci EMAC private adapter structure
+ * @pkts: packets just processed
+ *
+ * Called from the poll path. Once a window sees cpufreq_burst_pkts packets
+ * qos_work is kicked to raise the floor; pm_qos updates may sleep, so they
+ * can't be made from here.
+ */
+static void emac_qos_activity(struct emac_priv *priv, u32 pkts)
+{
+	if (!pkts || !test_bit(EMAC_QOS_ADDED, &priv->qos_flags))
+		return;
+
+	if (time_after(jiffies, priv->qos_window + EMAC_QOS_WINDOW)) {
+		priv->qos_window = jiffies;
+		priv->qos_pkts = 0;
+	}
+	priv->qos_pkts += pkts;
+	if (priv->qos_pkts < cpufreq_burst_pkts)
+		return;
+
+	priv->qos_last = jiffies;
+	if (!test_and_set_bit(EMAC_QOS_BUSY, &priv->qos_flags))
+		schedule_delayed_work(&priv->qos_work, 0);
+}
+
+/**
+ * emac_qos_work: Hold the CPU frequency floor while traffic lasts
+ * @work: qos_work of the DaVinci EMAC private adapter structure
+ *
+ * Requests cpufreq_min_khz and re-arms itself until no burst has been seen
+ * for cpufreq_hold_ms, so that the OPP doesn't follow every gap in the
+ * traffic. Then drops the request again.
+ */
+static void emac_qos_work(struct work_struct *work)
+{
+	struct emac_priv *priv = container_of(work, struct emac_priv,
+					      qos_work.work);
+	char *name = (char *)dev_name(&priv->pdev->dev);
+	unsigned long hold = msecs_to_jiffies(cpufreq_hold_ms);
+	unsigned long idle = jiffies - priv->qos_last;
+
+	if (cpufreq_min_khz > 0 && idle < hold) {
+		if (!test_and_set_bit(EMAC_QOS_HELD, &priv->qos_flags))
+			pm_qos_update_requirement(PM_QOS_CPU_FREQ_MIN, name,
+						  cpufreq_min_khz);
+		schedule_delayed_work(&priv->qos_work, hold - idle);
+		return;
+	}
+
+	if (test_and_clear_bit(EMAC_QOS_HELD, &priv->qos_flags))
+		pm_qos_update_requirement(PM_QOS_CPU_FREQ_MIN, name,
+					  PM_QOS_DEFAULT_VALUE);
+	clear_bit(EMAC_QOS_BUSY, &priv->qos_flags);
+	smp_mb__after_clear_bit();
+
+	/* a burst seen meanwhile found EMAC_QOS_BUSY still set */
+	if (cpufreq_min_khz > 0 && time_before(jiffies, priv->qos_last + hold) &&
+	    !test_and_set_bit(EMAC_QOS_BUSY, &priv->qos_flags))
+		schedule_delayed_work(&priv->qos_work, 0);
+}
+
+/**
+ * emac_poll_channels: Process the TX and RX channels flagged in MACINVECTOR
+ * @priv: The DaVinci EMAC private adapter structure
+ * @status: MACINVECTOR
+ * @budget: Number of receive packets to process
+ * @tx_pkts: returns TX packets completed, RX is skipped if any
+ *
+ * TX completions are handled first and for every TX channel, RX channels
+ * highest first sharing the budget.
+ *
+ * Returns number of packets received
+ */
+static u32 emac_poll_channels(struct emac_priv *priv, u32 status, int budget,
+			      u32 *tx_pkts)
+{
+	unsigned int mask;
+	u32 num_pkts = 0;
+	u32 tx_shift, rx_shift, ch;
+
+	tx_shift = EMAC_DM644X_MAC_IN_VECTOR_TX_INT_SHIFT;
+	rx_shift = EMAC_DM644X_MAC_IN_VECTOR_RX_INT_SHIFT;
+
+	if (priv->version == EMAC_VERSION_2) {
+		tx_shift = EMAC_DM646X_MAC_IN_VECTOR_TX_INT_SHIFT;
+		rx_shift = EMAC_DM646X_MAC_IN_VECTOR_RX_INT_SHIFT;
+	}
+
+	mask = (status >> tx_shift) & EMAC_MAC_IN_VECTOR_CH_MASK;
+	for (ch = 0; mask && ch < priv->num_tx_ch; ch++) {
+		if (mask & BIT(ch))
+			num_pkts += emac_tx_bdproc(priv, ch,
+						   EMAC_DEF_TX_MAX_SERVICE);
+	} /* TX processing */
+
+	*tx_pkts = num_pkts;
+	if (num_pkts) {
+		emac_qos_activity(priv, num_pkts);
+		return 0;
+	}
+
+	/* Service RX channels highest priority first, sharing the budget */
+	mask = (status >> rx_shift) & EMAC_MAC_IN_VECTOR_CH_MASK;
+	if (mask)
+		emac_rx_latency(priv);
+	for (ch = priv->num_rx_ch; mask && ch-- > 0; ) {
+		if (num_pkts >= budget)
+			break;
+		if (mask & BIT(ch))
+			num_pkts += emac_rx_bdproc(priv, ch,
+						   budget - num_pkts);
+	} /* RX processing */
+
+	emac_qos_activity(priv, num_pkts);
+	return num_pkts;
+}
 
-	/* Enable NAPI and interrupts */
-	napi_enable(&priv->napi);
-	emac_int_enable(priv);
-	return 0;
+/**
+ * emac_poll_stat_pend: Hand the statistics threshold over to stats_work
+ * @priv: The DaVinci EMAC private adapter structure
+ * @status: MACINVECTOR
+ *
+ * The register reads are left to stats_work, the interrupt stays masked
+ * until it ran
+ */
+static void emac_poll_stat_pend(struct emac_priv *priv, u32 status)
+{
+	u32 mask = EMAC_DM644X_MAC_IN_VECTOR_STATPEND_INT;
 
+	if (priv->version == EMAC_VERSION_2)
+		mask = EMAC_DM646X_MAC_IN_VECTOR_STATPEND_INT;
+	if (unlikely(status & mask)) {
+		emac_write(EMAC_MACINTMASKCLEAR, EMAC_MAC_STAT_INTMASK_VAL);
+		cancel_delayed_work(&priv->stats_work);
+		schedule_delayed_work(&priv->stats_work, 0);
+	}
 }
 
 /**
  * emac_poll: EMAC NAPI Poll function
- * @ndev: The DaVinci EMAC network adapter
+ * @napi: pointer to the napi_struct containing The DaVinci EMAC device
  * @budget: Number of receive packets to process (as told by NAPI layer)
  *
  * NAPI Poll function implemented to process packets as per budget. We check
@@ -2143,35 +4293,25 @@ static int emac_poll(struct napi_struct *napi, int budget)
 	struct device *emac_dev = &ndev->dev;
 	u32 status = 0;
 	u32 num_pkts = 0;
+	u32 tx_pkts, ch;
 
 	/* Check interrupt vectors and call packet processing */
 	status = emac_read(EMAC_MACINVECTOR);
-
-	mask = EMAC_DM644X_MAC_IN_VECTOR_TX_INT_VEC;
-
-	if (priv->version == EMAC_VERSION_2)
-		mask = EMAC_DM646X_MAC_IN_VECTOR_TX_INT_VEC;
-
-	if (status & mask) {
-		num_pkts = emac_tx_bdproc(priv, EMAC_DEF_TX_CH,
-					  EMAC_DEF_TX_MAX_SERVICE);
-	} /* TX processing */
-
-	if (num_pkts)
+	num_pkts = emac_poll_channels(priv, status, budget, &tx_pkts);
+	if (tx_pkts)
 		return budget;
 
-	mask = EMAC_DM644X_MAC_IN_VECTOR_RX_INT_VEC;
-
-	if (priv->version == EMAC_VERSION_2)
-		mask = EMAC_DM646X_MAC_IN_VECTOR_RX_INT_VEC;
+	if (priv->coal_adaptive)
+		emac_adapt_coalesce(priv, num_pkts);
 
-	if (status & mask) {
-		num_pkts = emac_rx_bdproc(priv, EMAC_DEF_RX_CH, budget);
-	} /* RX processing */
+	emac_poll_stat_pend(priv, status);
 
 	if (num_pkts < budget) {
 		napi_complete(napi);
 		emac_int_enable(priv);
+		/* idle: top up the RX buffer pools outside the RX path */
+		for (ch = 0; ch < priv->num_rx_ch; ch++)
+			emac_rx_pool_fill(priv, ch, GFP_ATOMIC);
 	}
 
 	mask = EMAC_DM644X_MAC_IN_VECTOR_HOST_INT;
@@ -2181,7 +4321,7 @@ static int emac_poll(struct napi_struct *napi, int budget)
 	if (unlikely(status & mask)) {
 		u32 ch, cause;
 		dev_err(emac_dev, "DaVinci EMAC: Fatal Hardware Error\n");
-		netif_stop_queue(ndev);
+		netif_tx_stop_all_queues(ndev);
 		napi_disable(&priv->napi);
 
 		status = emac_read(EMAC_MACSTATUS);
@@ -2209,6 +4349,228 @@ static int emac_poll(struct napi_struct *napi, int budget)
 	return num_pkts;
 }
 
+/**
+ * emac_busy_poll_thread: Low latency RX thread
+ * @data: The DaVinci EMAC private adapter structure
+ *
+ * Used instead of NAPI when busy_poll or poll_thread is set. The interrupt
+ * handler wakes this SCHED_FIFO thread directly, skipping the softirq, so
+ * packet processing is ranked by busy_poll_prio against application
+ * realtime tasks. It polls the channels with EMAC interrupts masked while
+ * a full budget of work was found or until no frame arrived for busy_poll
+ * usecs, and sleeps again with interrupts enabled.
+ */
+static int emac_busy_poll_thread(void *data)
+{
+	struct emac_priv *priv = data;
+	struct sched_param param = { .sched_priority = busy_poll_prio };
+	ktime_t idle_end;
+	u32 status, num_pkts, tx_pkts, ch;
+	u32 host_mask = EMAC_DM644X_MAC_IN_VECTOR_HOST_INT;
+	int more;
+
+	if (priv->version == EMAC_VERSION_2)
+		host_mask = EMAC_DM646X_MAC_IN_VECTOR_HOST_INT;
+	sched_setscheduler(current, SCHED_FIFO, &param);
+	while (!kthread_should_stop()) {
+		idle_end = ktime_add_us(ktime_get(), busy_poll);
+		do {
+			local_bh_disable();
+			status = emac_read(EMAC_MACINVECTOR);
+			num_pkts = emac_poll_channels(priv, status,
+						      EMAC_POLL_WEIGHT,
+						      &tx_pkts);
+			napi_gro_flush(&priv->napi);
+			emac_poll_stat_pend(priv, status);
+			/* host errors are reported by the NAPI handler */
+			if (unlikely(status & host_mask))
+				napi_schedule(&priv->napi);
+			local_bh_enable();
+			if (num_pkts || tx_pkts)
+				idle_end = ktime_add_us(ktime_get(),
+							busy_poll);
+			more = num_pkts >= EMAC_POLL_WEIGHT || tx_pkts;
+			cpu_relax();
+		} while ((more ||
+			  ktime_to_ns(ktime_sub(idle_end, ktime_get())) > 0) &&
+			 !kthread_should_stop());
+
+		for (ch = 0; ch < priv->num_rx_ch; ch++)
+			emac_rx_pool_fill(priv, ch, GFP_KERNEL);
+
+		/* an interrupt after this point wakes us straight away */
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop()) {
+			__set_current_state(TASK_RUNNING);
+			break;
+		}
+		if (netif_running(priv->ndev))
+			emac_int_enable(priv);
+		schedule();
+	}
+	return 0;
+}
+
+#ifdef CONFIG_DEBUG_FS
+static struct dentry *emac_debugfs_root;
+
+static int emac_rx_latency_show(struct seq_file *m, void *v)
+{
+	struct emac_priv *priv = m->private;
+	u32 i;
+
+	seq_printf(m, "mode: %s\n", !priv->poll_task ? "napi" :
+		   busy_poll > 0 ? "busy poll" : "poll thread");
+	seq_printf(m, "polled: %u\n", priv->rx_polled);
+	seq_printf(m, "      < 1 us: %u\n", priv->rx_lat_hist[0]);
+	for (i = 1; i < EMAC_LAT_BUCKETS - 1; i++)
+		seq_printf(m, "%5u-%5u us: %u\n", 1 << (i - 1), 1 << i,
+			   priv->rx_lat_hist[i]);
+	seq_printf(m, "    >= %5u us: %u\n", 1 << (EMAC_LAT_BUCKETS - 2),
+		   priv->rx_lat_hist[EMAC_LAT_BUCKETS - 1]);
+	return 0;
+}
+
+static int emac_rx_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, emac_rx_latency_show, inode->i_private);
+}
+
+/* any write clears the histogram */
+static ssize_t emac_rx_latency_write(struct file *file,
+				     const char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	struct emac_priv *priv = ((struct seq_file *)file->private_data)->private;
+
+	memset(priv->rx_lat_hist, 0, sizeof(priv->rx_lat_hist));
+	priv->rx_polled = 0;
+	return count;
+}
+
+static const struct file_operations emac_rx_latency_fops = {
+	.owner		= THIS_MODULE,
+	.open		= emac_rx_latency_open,
+	.read		= seq_read,
+	.write		= emac_rx_latency_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+#ifdef CONFIG_TI_DAVINCI_EMAC_BENCH
+static const char *emac_bench_names[EMAC_BENCH_NR] = {
+	[EMAC_BENCH_TX_XMIT]	= "tx xmit",
+	[EMAC_BENCH_TX_MAP]	= "  map",
+	[EMAC_BENCH_TX_DESC]	= "  descriptors",
+	[EMAC_BENCH_TX_REAP]	= "tx reap",
+	[EMAC_BENCH_TX_FREE]	= "tx free",
+	[EMAC_BENCH_RX_POLL]	= "rx poll",
+	[EMAC_BENCH_RX_ALLOC]	= "  alloc",
+	[EMAC_BENCH_RX_UNMAP]	= "  unmap",
+	[EMAC_BENCH_RX_STACK]	= "  stack",
+};
+
+/* indented stages are part of the one above them */
+static int emac_bench_show(struct seq_file *m, void *v)
+{
+	struct emac_priv *priv = m->private;
+	struct emac_bench *b;
+	int i;
+
+	seq_printf(m, "rx_sink: %s\n", rx_sink ? "on" : "off");
+	seq_printf(m, "%-14s %10s %10s %12s %8s %8s\n", "stage", "calls",
+		   "items", "total us", "ns/item", "max ns");
+	for (i = 0; i < EMAC_BENCH_NR; i++) {
+		b = &priv->bench[i];
+		seq_printf(m, "%-14s %10u %10u %12llu %8llu %8u\n",
+			   emac_bench_names[i], b->calls, b->items,
+			   div_u64(b->ns, NSEC_PER_USEC),
+			   b->items ? div_u64(b->ns, b->items) : 0ULL,
+			   b->max_ns);
+	}
+	return 0;
+}
+
+static int emac_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, emac_bench_show, inode->i_private);
+}
+
+/* any write clears the counters */
+static ssize_t emac_bench_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct emac_priv *priv = ((struct seq_file *)file->private_data)->private;
+
+	memset(priv->bench, 0, sizeof(priv->bench));
+	return count;
+}
+
+static const struct file_operations emac_bench_fops = {
+	.owner		= THIS_MODULE,
+	.open		= emac_bench_open,
+	.read		= seq_read,
+	.write		= emac_bench_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void emac_bench_debugfs_add(struct emac_priv *priv)
+{
+	char name[32];
+
+	snprintf(name, sizeof(name), "%s-bench", dev_name(&priv->pdev->dev));
+	priv->bench_debugfs = debugfs_create_file(name, S_IRUGO | S_IWUSR,
+						  emac_debugfs_root, priv,
+						  &emac_bench_fops);
+}
+
+static void emac_bench_debugfs_remove(struct emac_priv *priv)
+{
+	debugfs_remove(priv->bench_debugfs);
+	priv->bench_debugfs = NULL;
+}
+#else
+static inline void emac_bench_debugfs_add(struct emac_priv *priv) {}
+static inline void emac_bench_debugfs_remove(struct emac_priv *priv) {}
+#endif
+
+static void emac_debugfs_add(struct emac_priv *priv)
+{
+	if (!emac_debugfs_root)
+		return;
+	priv->debugfs = debugfs_create_file(dev_name(&priv->pdev->dev),
+					    S_IRUGO | S_IWUSR,
+					    emac_debugfs_root, priv,
+					    &emac_rx_latency_fops);
+	emac_bench_debugfs_add(priv);
+}
+
+static void emac_debugfs_remove(struct emac_priv *priv)
+{
+	emac_bench_debugfs_remove(priv);
+	debugfs_remove(priv->debugfs);
+	priv->debugfs = NULL;
+}
+
+static void emac_debugfs_init(void)
+{
+	emac_debugfs_root = debugfs_create_dir("davinci_emac", NULL);
+	if (IS_ERR(emac_debugfs_root))
+		emac_debugfs_root = NULL;
+}
+
+static void emac_debugfs_exit(void)
+{
+	debugfs_remove(emac_debugfs_root);
+}
+#else
+static inline void emac_debugfs_add(struct emac_priv *priv) {}
+static inline void emac_debugfs_remove(struct emac_priv *priv) {}
+static inline void emac_debugfs_init(void) {}
+static inline void emac_debugfs_exit(void) {}
+#endif
+
 #ifdef CONFIG_NET_POLL_CONTROLLER
 /**
  * emac_poll_controller: EMAC Poll controller function
@@ -2234,6 +4596,20 @@ void emac_poll_controller(struct net_device *ndev)
 		while ((emac_mdio_read((MDIO_USERACCESS(0))) &\
 			MDIO_USERACCESS_GO) != 0)
 
+/*
+ * Wait for the access just started to finish. With the MDIO user interrupt
+ * we sleep through the ~30 usecs a frame takes on the wire instead of
+ * spinning on GO; the loop below then finds it clear, and also covers a lost
+ * interrupt or callers that cannot sleep.
+ */
+static void emac_mdio_wait(struct mii_bus *bus)
+{
+	if (emac_mdio_irq_en && !in_atomic() && !irqs_disabled())
+		wait_for_completion_timeout(&emac_mdio_done, EMAC_MDIO_TIMEOUT);
+
+	MDIO_WAIT_FOR_USER_ACCESS;
+}
+
 static int emac_mii_read(struct mii_bus *bus, int phy_id, int phy_reg)
 {
 	unsigned int phy_data = 0;
@@ -2247,10 +4623,12 @@ static int emac_mii_read(struct mii_bus *bus, int phy_id, int phy_reg)
 		       ((phy_reg << 21) & MDIO_USERACCESS_REGADR) |
 		       ((phy_id << 16) & MDIO_USERACCESS_PHYADR) |
 		       (phy_data & MDIO_USERACCESS_DATA));
+	if (emac_mdio_irq_en)
+		INIT_COMPLETION(emac_mdio_done);
 	emac_mdio_write(MDIO_USERACCESS(0), phy_control);
 
 	/* Wait until mdio is ready for next command */
-	MDIO_WAIT_FOR_USER_ACCESS;
+	emac_mdio_wait(bus);
 
 	return emac_mdio_read(MDIO_USERACCESS(0)) & MDIO_USERACCESS_DATA;
 
@@ -2270,8 +4648,14 @@ static int emac_mii_write(struct mii_bus *bus, int phy_id,
 		   ((phy_reg << 21) & MDIO_USERACCESS_REGADR) |
 		   ((phy_id << 16) & MDIO_USERACCESS_PHYADR) |
 		   (phy_data & MDIO_USERACCESS_DATA));
+	if (emac_mdio_irq_en)
+		INIT_COMPLETION(emac_mdio_done);
 	emac_mdio_write(MDIO_USERACCESS(0), control);
 
+	/* sleep here rather than spin before the next command */
+	if (emac_mdio_irq_en)
+		emac_mdio_wait(bus);
+
 	return 0;
 }
 
@@ -2300,6 +4684,123 @@ static int mii_irqs[PHY_MAX_ADDR] = { PHY_POLL, PHY_POLL };
 
 static struct mii_bus *emac_mii;
 
+/**
+ * emac_misc_irq: EMAC MISC interrupt handler
+ * @irq: interrupt number
+ * @dev_id: EMAC network adapter data structure ptr
+ *
+ * Completes MDIO user accesses and passes link changes seen by the MDIO
+ * module on to phylib, which then reads the PHY at once rather than on its
+ * next poll.
+ *
+ * Returns interrupt handled condition
+ */
+static irqreturn_t emac_misc_irq(int irq, void *dev_id)
+{
+	struct net_device *ndev = (struct net_device *)dev_id;
+	struct emac_priv *priv = netdev_priv(ndev);
+	struct mii_bus *bus = priv->mii_bus;
+	irqreturn_t ret = IRQ_NONE;
+
+	if (emac_mdio_read(MDIO_USERINTMASKED) & MDIO_INT_INST0) {
+		emac_mdio_write(MDIO_USERINTRAW, MDIO_INT_INST0);
+		complete(&emac_mdio_done);
+		ret = IRQ_HANDLED;
+	}
+
+	if (emac_mdio_read(MDIO_LINKINTMASKED) & MDIO_INT_INST0) {
+		emac_mdio_write(MDIO_LINKINTRAW, MDIO_INT_INST0);
+		if (priv->link_irq)
+			phy_mac_interrupt(priv->phydev);
+		ret = IRQ_HANDLED;
+	}
+
+	/* ack misc- only then a new pulse will be generated */
+	emac_write(EMAC_DM646X_MACEOIVECTOR, EMAC_DM646X_MAC_EOI_C0_MISCEN);
+
+	return ret;
+}
+
+/**
+ * emac_mdio_irq_init: Take the MDIO interrupts on the MISC line
+ * @priv: The DaVinci EMAC private adapter structure
+ *
+ * Only the DM646x style control module routes them; elsewhere, or if the
+ * line cannot be had, MDIO accesses and the PHY link stay polled.
+ */
+static void emac_mdio_irq_init(struct emac_priv *priv)
+{
+	struct mii_bus *bus = priv->mii_bus;
+	struct resource *res;
+
+	priv->misc_irq = 0;
+	priv->link_irq = 0;
+	res = platform_get_resource(priv->pdev, IORESOURCE_IRQ,
+				    EMAC_DM646X_MISC_IRQ_RES);
+	if (!mdio_irq || priv->version != EMAC_VERSION_2 || !res)
+		return;
+
+	if (request_irq(res->start, emac_misc_irq, IRQF_DISABLED,
+			priv->ndev->name, priv->ndev)) {
+		dev_warn(&priv->pdev->dev, "DaVinci EMAC: MISC irq %d busy, "\
+			 "polling MDIO\n", res->start);
+		return;
+	}
+	priv->misc_irq = res->start;
+
+	emac_mdio_write(MDIO_USERPHYSEL(0), 0);
+	emac_mdio_write(MDIO_USERINTRAW, MDIO_INT_INST0);
+	emac_mdio_write(MDIO_LINKINTRAW, MDIO_INT_INST0);
+	emac_mdio_write(MDIO_USERINTMASKSET, MDIO_INT_INST0);
+	emac_ctrl_write(EMAC_DM646X_CMMISCINTEN, EMAC_DM646X_MISCINT_USER |
+			EMAC_DM646X_MISCINT_LINK);
+	emac_write(EMAC_DM646X_MACEOIVECTOR, EMAC_DM646X_MAC_EOI_C0_MISCEN);
+	emac_mdio_irq_en = 1;
+}
+
+static void emac_mdio_irq_exit(struct emac_priv *priv)
+{
+	struct mii_bus *bus = priv->mii_bus;
+
+	if (!priv->misc_irq)
+		return;
+
+	emac_mdio_irq_en = 0;
+	emac_ctrl_write(EMAC_DM646X_CMMISCINTEN, 0);
+	emac_mdio_write(MDIO_USERINTMASKCLR, MDIO_INT_INST0);
+	emac_mdio_write(MDIO_USERPHYSEL(0), 0);
+	free_irq(priv->misc_irq, priv->ndev);
+	priv->misc_irq = 0;
+}
+
+/**
+ * emac_mdio_link_irq: Start or stop the MDIO module watching our PHY
+ * @priv: The DaVinci EMAC private adapter structure
+ * @on: non zero to raise LINKINT on link changes of priv->phydev
+ *
+ * The MDIO state machine keeps polling the status of every PHY in hardware,
+ * USERPHYSEL0 just selects the one whose link changes interrupt us.
+ */
+static void emac_mdio_link_irq(struct emac_priv *priv, int on)
+{
+	struct mii_bus *bus = priv->mii_bus;
+
+	if (!priv->misc_irq || !priv->phydev)
+		return;
+
+	if (on) {
+		emac_mdio_write(MDIO_LINKINTRAW, MDIO_INT_INST0);
+		emac_mdio_write(MDIO_USERPHYSEL(0), MDIO_USERPHYSEL_LINKINTENB |
+				(priv->phydev->addr &
+				 MDIO_USERPHYSEL_PHYADRMON));
+		priv->link_irq = 1;
+	} else {
+		priv->link_irq = 0;
+		emac_mdio_write(MDIO_USERPHYSEL(0), 0);
+		synchronize_irq(priv->misc_irq);
+	}
+}
+
 static void emac_adjust_link(struct net_device *ndev)
 {
 	struct emac_priv *priv = netdev_priv(ndev);
@@ -2364,6 +4865,48 @@ static int emac_devioctl(struct net_device *ndev, struct ifreq *ifrq, int cmd)
 	return -EOPNOTSUPP;
 }
 
+/**
+ * emac_update_hw_stats: Accumulate the EMAC statistics registers
+ * @priv: The DaVinci EMAC private adapter structure
+ *
+ * Adds every statistics register to its 64 bit total. With GMIIEN set the
+ * registers are write to decrement, so writing back the value read clears
+ * exactly what was accumulated without losing concurrent counts.
+ */
+static void emac_update_hw_stats(struct emac_priv *priv)
+{
+	u32 gmii_en = emac_read(EMAC_MACCONTROL) & EMAC_MACCONTROL_GMIIEN;
+	u32 i, val;
+
+	spin_lock_bh(&priv->stats_lock);
+	for (i = 0; i < EMAC_NUM_HW_STATS; i++) {
+		val = emac_read(EMAC_RXGOODFRAMES + i * 4);
+		priv->hw_stats[i] += val;
+		if (gmii_en)
+			emac_write(EMAC_RXGOODFRAMES + i * 4, val);
+	}
+	spin_unlock_bh(&priv->stats_lock);
+}
+
+/**
+ * emac_stats_work: Periodic hardware statistics worker
+ * @work: stats_work of the DaVinci EMAC private adapter structure
+ *
+ * Runs every EMAC_STATS_INTERVAL, well within the time the 32 bit octet
+ * counters take to wrap, and right away when a counter crosses the
+ * statistics interrupt threshold. Re-enables that interrupt.
+ */
+static void emac_stats_work(struct work_struct *work)
+{
+	struct emac_priv *priv = container_of(work, struct emac_priv,
+					      stats_work.work);
+
+	emac_update_hw_stats(priv);
+	emac_write(EMAC_MACINTMASKSET, EMAC_MAC_STAT_INTMASK_VAL);
+	schedule_delayed_work(&priv->stats_work,
+			      round_jiffies_relative(EMAC_STATS_INTERVAL));
+}
+
 /**
  * emac_dev_open: EMAC device open
  * @ndev: The DaVinci EMAC network adapter
@@ -2377,7 +4920,8 @@ static int emac_devioctl(struct net_device *ndev, struct ifreq *ifrq, int cmd)
 static int emac_dev_open(struct net_device *ndev)
 {
 	struct device *emac_dev = &ndev->dev;
-	u32 rc, cnt, ch;
+	u32 cnt, ch;
+	int rc;
 	int phy_addr;
 	struct resource *res;
 	int q, m;
@@ -2390,7 +4934,14 @@ static int emac_dev_open(struct net_device *ndev)
 		ndev->dev_addr[cnt] = priv->mac_addr[cnt];
 
 	/* Configuration items */
-	priv->rx_buf_size = EMAC_DEF_MAX_FRAME_SIZE + NET_IP_ALIGN;
+	priv->rx_frags = emac_rx_bds_per_frame(ndev->mtu) > 1;
+	if (priv->rx_frags)
+		priv->rx_buf_size = PAGE_SIZE;
+	else
+		priv->rx_buf_size = emac_max_frame(priv) + NET_IP_ALIGN;
+	if (priv->rx_buf_size != priv->rx_park_buf_size ||
+	    priv->rx_frags != priv->rx_park_frags)
+		emac_rx_park_free(priv);
 
 	/* Clear basic hardware */
 	for (ch = 0; ch < EMAC_MAX_TXRX_CHANNELS; ch++) {
@@ -2405,22 +4956,34 @@ static int emac_dev_open(struct net_device *ndev)
 	emac_write(EMAC_MACHASH1, 0);
 	emac_write(EMAC_MACHASH2, 0);
 
-	/* multi ch not supported - open 1 TX, 1RX ch by default */
-	rc = emac_init_txch(priv, EMAC_DEF_TX_CH);
-	if (0 != rc) {
-		dev_err(emac_dev, "DaVinci EMAC: emac_init_txch() failed");
+	rc = emac_alloc_bd_mem(priv);
+	if (rc)
 		return rc;
+
+	/* open every configured TX and RX channel */
+	for (ch = 0; ch < priv->num_tx_ch; ch++) {
+		rc = emac_init_txch(priv, ch);
+		if (0 != rc) {
+			dev_err(emac_dev, "DaVinci EMAC: emac_init_txch() "\
+				"failed for ch %d", ch);
+			goto init_ch_err;
+		}
 	}
-	rc = emac_init_rxch(priv, EMAC_DEF_RX_CH, priv->mac_addr);
-	if (0 != rc) {
-		dev_err(emac_dev, "DaVinci EMAC: emac_init_rxch() failed");
-		return rc;
+	for (ch = 0; ch < priv->num_rx_ch; ch++) {
+		rc = emac_init_rxch(priv, ch, priv->mac_addr);
+		if (0 != rc) {
+			dev_err(emac_dev, "DaVinci EMAC: emac_init_rxch() "\
+				"failed for ch %d", ch);
+			goto init_ch_err;
+		}
 	}
 
 	/* Request IRQ */
 
 	while ((res = platform_get_resource(priv->pdev, IORESOURCE_IRQ, k))) {
 		for (i = res->start; i <= res->end; i++) {
+			if (i == priv->misc_irq)
+				continue;
 			if (request_irq(i, emac_irq, IRQF_DISABLED,
 					ndev->name, ndev))
 				goto rollback;
@@ -2430,10 +4993,16 @@ static int emac_dev_open(struct net_device *ndev)
 
 	/* Start/Enable EMAC hardware */
 	emac_hw_enable(priv);
+	schedule_delayed_work(&priv->stats_work,
+			      round_jiffies_relative(EMAC_STATS_INTERVAL));
 
-	/* find the first phy */
-	priv->phydev = NULL;
-	if (priv->phy_mask) {
+	/* find the first phy, it stays attached from the last open on */
+	if (priv->phy_mask && priv->phydev) {
+		priv->link = 0;
+		priv->speed = 0;
+		priv->duplex = ~0;
+		emac_mdio_link_irq(priv, 1);
+	} else if (priv->phy_mask) {
 		emac_mii_reset(priv->mii_bus);
 		for (phy_addr = 0; phy_addr < PHY_MAX_ADDR; phy_addr++) {
 			if (priv->mii_bus->phy_map[phy_addr]) {
@@ -2442,6 +5011,10 @@ static int emac_dev_open(struct net_device *ndev)
 			}
 		}
 
+		/* link changes come from emac_misc_irq, no need to poll */
+		if (priv->phydev && priv->misc_irq)
+			priv->phydev->irq = PHY_IGNORE_INTERRUPT;
+
 		if (!priv->phydev) {
 			printk(KERN_ERR "%s: no PHY found\n", ndev->name);
 			return -1;
@@ -2459,6 +5032,7 @@ static int emac_dev_open(struct net_device *ndev)
 		priv->link = 0;
 		priv->speed = 0;
 		priv->duplex = ~0;
+		emac_mdio_link_irq(priv, 1);
 
 		printk(KERN_INFO "%s: attached PHY driver [%s] "
 			"(mii_bus:phy_addr=%s, id=%x)\n", ndev->name,
@@ -2481,15 +5055,51 @@ static int emac_dev_open(struct net_device *ndev)
 	if (priv->phy_mask)
 		phy_start(priv->phydev);
 
+	priv->qos_flags = 0;
+	priv->qos_pkts = 0;
+	priv->qos_window = jiffies;
+	if (cpufreq_min_khz > 0) {
+		if (pm_qos_add_requirement(PM_QOS_CPU_FREQ_MIN,
+				(char *)dev_name(&priv->pdev->dev),
+				PM_QOS_DEFAULT_VALUE))
+			dev_warn(emac_dev, "DaVinci EMAC: no CPU frequency "
+				 "floor during bursts\n");
+		else
+			set_bit(EMAC_QOS_ADDED, &priv->qos_flags);
+	}
+
+	priv->poll_task = NULL;
+	priv->irq_stamp.tv64 = 0;
+	if (busy_poll > 0 || poll_thread) {
+		struct task_struct *task;
+
+		task = kthread_run(emac_busy_poll_thread, priv, "%s-poll",
+				   ndev->name);
+		if (IS_ERR(task))
+			dev_warn(emac_dev, "DaVinci EMAC: poll thread "\
+				 "failed, using NAPI\n");
+		else
+			priv->poll_task = task;
+	}
+
 	return 0;
 
+init_ch_err:
+	for (ch = 0; ch < priv->num_tx_ch; ch++)
+		emac_cleanup_txch(priv, ch);
+	for (ch = 0; ch < priv->num_rx_ch; ch++)
+		emac_cleanup_rxch(priv, ch);
+	emac_free_bd_mem(priv);
+	return rc;
+
 rollback:
 
 	dev_err(emac_dev, "DaVinci EMAC: request_irq() failed");
 
 	for (q = k; k >= 0; k--) {
 		for (m = i; m >= res->start; m--)
-			free_irq(m, ndev);
+			if (m != priv->misc_irq)
+				free_irq(m, ndev);
 		res = platform_get_resource(priv->pdev, IORESOURCE_IRQ, k-1);
 		m = res->end;
 	}
@@ -2512,26 +5122,60 @@ static int emac_dev_stop(struct net_device *ndev)
 	int irq_num;
 	struct emac_priv *priv = netdev_priv(ndev);
 	struct device *emac_dev = &ndev->dev;
+	u32 ch;
+
+	/* closed while the reopen after resume was still pending */
+	if (priv->resume_pending) {
+		priv->resume_pending = 0;
+		return 0;
+	}
 
 	/* inform the upper layers. */
-	netif_stop_queue(ndev);
+	netif_tx_stop_all_queues(ndev);
 	napi_disable(&priv->napi);
 
 	netif_carrier_off(ndev);
+	if (priv->poll_task) {
+		kthread_stop(priv->poll_task);
+		priv->poll_task = NULL;
+	}
 	emac_int_disable(priv);
-	emac_stop_txch(priv, EMAC_DEF_TX_CH);
-	emac_stop_rxch(priv, EMAC_DEF_RX_CH);
-	emac_cleanup_txch(priv, EMAC_DEF_TX_CH);
-	emac_cleanup_rxch(priv, EMAC_DEF_RX_CH);
+	del_timer_sync(&priv->tx_reclaim_timer);
+	for (ch = 0; ch < priv->num_tx_ch; ch++)
+		emac_stop_txch(priv, ch);
+	for (ch = 0; ch < priv->num_rx_ch; ch++)
+		emac_stop_rxch(priv, ch);
+	for (ch = 0; ch < priv->num_tx_ch; ch++)
+		emac_cleanup_txch(priv, ch);
+	for (ch = 0; ch < priv->num_rx_ch; ch++)
+		emac_cleanup_rxch(priv, ch);
+
+	if (test_bit(EMAC_QOS_ADDED, &priv->qos_flags)) {
+		cancel_delayed_work_sync(&priv->qos_work);
+		pm_qos_remove_requirement(PM_QOS_CPU_FREQ_MIN,
+				(char *)dev_name(&priv->pdev->dev));
+		priv->qos_flags = 0;
+	}
+
+	/* collect the counters before the reset clears them */
+	cancel_delayed_work_sync(&priv->stats_work);
+	emac_update_hw_stats(priv);
 	emac_write(EMAC_SOFTRESET, 1);
+	emac_free_bd_mem(priv);
 
-	if (priv->phydev)
-		phy_disconnect(priv->phydev);
+	/* the PHY is only halted, so that the next open finds the link
+	 * up without negotiating it again */
+	if (priv->phydev) {
+		emac_mdio_link_irq(priv, 0);
+		phy_stop(priv->phydev);
+	}
+	priv->link = 0;
 
 	/* Free IRQ */
 	while ((res = platform_get_resource(priv->pdev, IORESOURCE_IRQ, i))) {
 		for (irq_num = res->start; irq_num <= res->end; irq_num++)
-			free_irq(irq_num, priv->ndev);
+			if (irq_num != priv->misc_irq)
+				free_irq(irq_num, priv->ndev);
 		i++;
 	}
 
@@ -2547,64 +5191,95 @@ static int emac_dev_stop(struct net_device *ndev)
  *
  * Called when system wants to get statistics from the device.
  *
- * We return the statistics in net_device_stats structure pulled from emac
+ * We return the statistics in net_device_stats structure pulled from emac,
+ * as last accumulated by stats_work, without touching the hardware
  */
 static struct net_device_stats *emac_dev_getnetstats(struct net_device *ndev)
 {
 	struct emac_priv *priv = netdev_priv(ndev);
-	u32 mac_control;
-	u32 stats_clear_mask;
-
-	/* update emac hardware stats and reset the registers*/
-
-	mac_control = emac_read(EMAC_MACCONTROL);
 
-	if (mac_control & EMAC_MACCONTROL_GMIIEN)
-		stats_clear_mask = EMAC_STATS_CLR_MASK;
-	else
-		stats_clear_mask = 0;
-
-	priv->net_dev_stats.multicast += emac_read(EMAC_RXMCASTFRAMES);
-	emac_write(EMAC_RXMCASTFRAMES, stats_clear_mask);
+	priv->net_dev_stats.multicast = EMAC_HW_STAT(EMAC_RXMCASTFRAMES);
+	priv->net_dev_stats.collisions = EMAC_HW_STAT(EMAC_TXCOLLISION) +
+					 EMAC_HW_STAT(EMAC_TXSINGLECOLL) +
+					 EMAC_HW_STAT(EMAC_TXMULTICOLL);
+	priv->net_dev_stats.rx_length_errors =
+		EMAC_HW_STAT(EMAC_RXOVERSIZED) + EMAC_HW_STAT(EMAC_RXJABBER) +
+		EMAC_HW_STAT(EMAC_RXUNDERSIZED);
+	priv->net_dev_stats.rx_over_errors = EMAC_HW_STAT(EMAC_RXSOFOVERRUNS) +
+					     EMAC_HW_STAT(EMAC_RXMOFOVERRUNS);
+	priv->net_dev_stats.rx_fifo_errors = EMAC_HW_STAT(EMAC_RXDMAOVERRUNS);
+	priv->net_dev_stats.rx_crc_errors = EMAC_HW_STAT(EMAC_RXCRCERRORS);
+	priv->net_dev_stats.rx_frame_errors =
+		EMAC_HW_STAT(EMAC_RXALIGNCODEERRORS);
+	priv->net_dev_stats.tx_carrier_errors =
+		EMAC_HW_STAT(EMAC_TXCARRIERSENSE);
+	priv->net_dev_stats.tx_fifo_errors = EMAC_HW_STAT(EMAC_TXUNDERRUN);
+	priv->net_dev_stats.tx_aborted_errors =
+		EMAC_HW_STAT(EMAC_TXEXCESSIVECOLL);
+	priv->net_dev_stats.tx_window_errors = EMAC_HW_STAT(EMAC_TXLATECOLL);
 
-	priv->net_dev_stats.collisions += (emac_read(EMAC_TXCOLLISION) +
-					   emac_read(EMAC_TXSINGLECOLL) +
-					   emac_read(EMAC_TXMULTICOLL));
-	emac_write(EMAC_TXCOLLISION, stats_clear_mask);
-	emac_write(EMAC_TXSINGLECOLL, stats_clear_mask);
-	emac_write(EMAC_TXMULTICOLL, stats_clear_mask);
-
-	priv->net_dev_stats.rx_length_errors += (emac_read(EMAC_RXOVERSIZED) +
-						emac_read(EMAC_RXJABBER) +
-						emac_read(EMAC_RXUNDERSIZED));
-	emac_write(EMAC_RXOVERSIZED, stats_clear_mask);
-	emac_write(EMAC_RXJABBER, stats_clear_mask);
-	emac_write(EMAC_RXUNDERSIZED, stats_clear_mask);
+	return &priv->net_dev_stats;
+}
 
-	priv->net_dev_stats.rx_over_errors += (emac_read(EMAC_RXSOFOVERRUNS) +
-					       emac_read(EMAC_RXMOFOVERRUNS));
-	emac_write(EMAC_RXSOFOVERRUNS, stats_clear_mask);
-	emac_write(EMAC_RXMOFOVERRUNS, stats_clear_mask);
+/**
+ * emac_dev_change_mtu: EMAC MTU change
+ * @ndev: The DaVinci EMAC network adapter
+ * @new_mtu: requested MTU
+ *
+ * Jumbo frames are for the gigabit (DM646x) EMAC only. RX buffers are sized
+ * for the MTU at open, page fragments once a frame does not fit a page; the
+ * RX ring is scaled by the BD's a frame takes so that it keeps the same
+ * number of frames, as far as the BD memory allows. A running interface is
+ * stopped and reopened.
+ *
+ * Returns success(0) or -EINVAL
+ */
+static int emac_dev_change_mtu(struct net_device *ndev, int new_mtu)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	int max_mtu = (priv->version == EMAC_VERSION_2) ?
+		      EMAC_DM646X_MAX_MTU : ETH_DATA_LEN;
+	u32 rx_ring_size, rx_max;
 
-	priv->net_dev_stats.rx_fifo_errors += emac_read(EMAC_RXDMAOVERRUNS);
-	emac_write(EMAC_RXDMAOVERRUNS, stats_clear_mask);
+	if (new_mtu < EMAC_MIN_MTU || new_mtu > max_mtu)
+		return -EINVAL;
+	if (new_mtu == ndev->mtu)
+		return 0;
 
-	priv->net_dev_stats.tx_carrier_errors +=
-		emac_read(EMAC_TXCARRIERSENSE);
-	emac_write(EMAC_TXCARRIERSENSE, stats_clear_mask);
+	rx_ring_size = priv->rx_ring_size / emac_rx_bds_per_frame(ndev->mtu) *
+		       emac_rx_bds_per_frame(new_mtu);
+	rx_ring_size = clamp_t(u32, rx_ring_size, EMAC_MIN_RING_SIZE,
+			       EMAC_MAX_RING_SIZE);
+	if (!priv->bd_ddr_en) {
+		rx_max = (priv->ctrl_ram_size - priv->num_tx_ch *
+			  priv->tx_ring_size * EMAC_TX_BD_SIZE) /
+			 (priv->num_rx_ch * EMAC_RX_BD_SIZE);
+		rx_ring_size = max_t(u32, min(rx_ring_size, rx_max),
+				     EMAC_MIN_RING_SIZE);
+		if (!emac_bd_mem_fits(priv, priv->tx_ring_size, rx_ring_size))
+			rx_ring_size = priv->rx_ring_size;
+	}
 
-	priv->net_dev_stats.tx_fifo_errors = emac_read(EMAC_TXUNDERRUN);
-	emac_write(EMAC_TXUNDERRUN, stats_clear_mask);
+	if (!netif_running(ndev)) {
+		ndev->mtu = new_mtu;
+		priv->rx_ring_size = rx_ring_size;
+		return 0;
+	}
 
-	return &priv->net_dev_stats;
+	emac_dev_stop(ndev);
+	ndev->mtu = new_mtu;
+	priv->rx_ring_size = rx_ring_size;
+	return emac_dev_open(ndev);
 }
 
 static const struct net_device_ops emac_netdev_ops = {
 	.ndo_open		= emac_dev_open,
 	.ndo_stop		= emac_dev_stop,
 	.ndo_start_xmit		= emac_dev_xmit,
+	.ndo_select_queue	= emac_dev_select_queue,
 	.ndo_set_multicast_list	= emac_dev_mcast_set,
 	.ndo_set_mac_address	= emac_dev_setmac_addr,
+	.ndo_change_mtu		= emac_dev_change_mtu,
 	.ndo_do_ioctl		= emac_devioctl,
 	.ndo_tx_timeout		= emac_dev_tx_timeout,
 	.ndo_get_stats		= emac_dev_getnetstats,
@@ -2630,6 +5305,8 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 	unsigned long size;
 	struct emac_platform_data *pdata;
 	struct device *emac_dev;
+	u32 num_tx_ch;
+	int i;
 
 	/* obtain emac clock from kernel */
 	emac_clk = clk_get(&pdev->dev, NULL);
@@ -2640,7 +5317,18 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 	emac_bus_frequency = clk_get_rate(emac_clk);
 	/* TODO: Probe PHY here if possible */
 
-	ndev = alloc_etherdev(sizeof(struct emac_priv));
+	pdata = pdev->dev.platform_data;
+	if (!pdata) {
+		printk(KERN_ERR "DaVinci EMAC: No platfrom data\n");
+		clk_put(emac_clk);
+		return -ENODEV;
+	}
+
+	/* one netdev TX queue per CPPI TX channel */
+	num_tx_ch = pdata->num_tx_ch ? pdata->num_tx_ch : EMAC_DEF_MAX_TX_CH;
+	num_tx_ch = min_t(u32, num_tx_ch, EMAC_MAX_TXRX_CHANNELS);
+
+	ndev = alloc_etherdev_mq(sizeof(struct emac_priv), num_tx_ch);
 	if (!ndev) {
 		printk(KERN_ERR "DaVinci EMAC: Error allocating net_device\n");
 		clk_put(emac_clk);
@@ -2653,15 +5341,18 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 	priv->ndev = ndev;
 	priv->msg_enable = netif_msg_init(debug_level, DAVINCI_EMAC_DEBUG);
 
-	spin_lock_init(&priv->tx_lock);
 	spin_lock_init(&priv->rx_lock);
-	spin_lock_init(&priv->lock);
-
-	pdata = pdev->dev.platform_data;
-	if (!pdata) {
-		printk(KERN_ERR "DaVinci EMAC: No platfrom data\n");
-		return -ENODEV;
+	spin_lock_init(&priv->stats_lock);
+	INIT_DELAYED_WORK(&priv->stats_work, emac_stats_work);
+	INIT_WORK(&priv->resume_work, emac_resume_work);
+	INIT_DELAYED_WORK(&priv->qos_work, emac_qos_work);
+	setup_timer(&priv->tx_reclaim_timer, emac_tx_reclaim_timer,
+		    (unsigned long)priv);
+	for (i = 0; i < EMAC_MAX_TXRX_CHANNELS; i++) {
+		skb_queue_head_init(&priv->rx_park[i]);
+		INIT_LIST_HEAD(&priv->rx_park_pages[i]);
 	}
+	spin_lock_init(&priv->lock);
 
 	/* MAC addr and PHY mask , RMII enable info from platform_data */
 	memcpy(priv->mac_addr, pdata->mac_addr, 6);
@@ -2671,6 +5362,28 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 	priv->int_enable = pdata->interrupt_enable;
 	priv->int_disable = pdata->interrupt_disable;
 
+	/* interrupt pacing off until set with ethtool -C */
+	priv->coal_rate_low = EMAC_DEF_COAL_RATE_LOW;
+	priv->coal_rate_high = EMAC_DEF_COAL_RATE_HIGH;
+	priv->coal_usecs_low = EMAC_DEF_COAL_USECS_LOW;
+	priv->coal_usecs_high = EMAC_DEF_COAL_USECS_HIGH;
+	priv->coal_sample_secs = EMAC_DEF_COAL_SAMPLE_SECS;
+
+	/* TX/RX channel counts and RX steering from platform_data */
+	priv->num_tx_ch = num_tx_ch;
+	priv->num_rx_ch = pdata->num_rx_ch ? pdata->num_rx_ch :
+			  EMAC_DEF_MAX_RX_CH;
+	priv->num_rx_ch = min_t(u32, priv->num_rx_ch, EMAC_MAX_TXRX_CHANNELS);
+	priv->rx_bcast_ch = EMAC_DEF_BCAST_CH;
+	priv->rx_mcast_ch = EMAC_DEF_MCAST_CH;
+	priv->rx_prom_ch = EMAC_DEF_PROM_CH;
+	if (pdata->rx_bcast_ch < priv->num_rx_ch)
+		priv->rx_bcast_ch = pdata->rx_bcast_ch;
+	if (pdata->rx_mcast_ch < priv->num_rx_ch)
+		priv->rx_mcast_ch = pdata->rx_mcast_ch;
+	if (pdata->rx_prom_ch < priv->num_rx_ch)
+		priv->rx_prom_ch = pdata->rx_prom_ch;
+
 	emac_dev = &ndev->dev;
 	/* Get EMAC platform data */
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
@@ -2709,6 +5422,29 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 		priv->hw_ram_addr = (u32 __force)res->start +
 					pdata->ctrl_ram_offset;
 
+	/* ring sizes from platform_data, default an equal share of CPPI RAM */
+	priv->bd_ddr_en = pdata->bd_ddr;
+	priv->tx_ring_size = pdata->tx_ring_size ? pdata->tx_ring_size :
+		((priv->ctrl_ram_size >> 1) / priv->num_tx_ch) /
+		EMAC_TX_BD_SIZE;
+	priv->rx_ring_size = pdata->rx_ring_size ? pdata->rx_ring_size :
+		((priv->ctrl_ram_size >> 1) / priv->num_rx_ch) /
+		EMAC_RX_BD_SIZE;
+	priv->tx_ring_size = rounddown_pow_of_two(clamp_t(u32,
+		priv->tx_ring_size, EMAC_MIN_RING_SIZE, EMAC_MAX_RING_SIZE));
+	priv->rx_ring_size = clamp_t(u32, priv->rx_ring_size,
+				     EMAC_MIN_RING_SIZE, EMAC_MAX_RING_SIZE);
+	if (!priv->bd_ddr_en && !emac_bd_mem_fits(priv, priv->tx_ring_size,
+						  priv->rx_ring_size)) {
+		dev_warn(emac_dev, "DaVinci EMAC: BD rings do not fit in CPPI "
+			 "RAM, using defaults\n");
+		priv->tx_ring_size = rounddown_pow_of_two(
+			((priv->ctrl_ram_size >> 1) / priv->num_tx_ch) /
+			EMAC_TX_BD_SIZE);
+		priv->rx_ring_size = ((priv->ctrl_ram_size >> 1) /
+				      priv->num_rx_ch) / EMAC_RX_BD_SIZE;
+	}
+
 	res = platform_get_resource(pdev, IORESOURCE_IRQ, 0);
 	if (!res) {
 		dev_err(emac_dev, "DaVinci EMAC: Error getting irq res\n");
@@ -2726,6 +5462,9 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 
 	ndev->netdev_ops = &emac_netdev_ops;
 	SET_ETHTOOL_OPS(ndev, &ethtool_ops);
+	if (EMAC_DEF_TX_SG_EN)
+		ndev->features |= NETIF_F_SG | NETIF_F_HW_CSUM;
+	ndev->features |= NETIF_F_GRO;
 	netif_napi_add(ndev, &priv->napi, emac_poll, EMAC_POLL_WEIGHT);
 
 	clk_enable(emac_clk);
@@ -2765,12 +5504,15 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 	rc = mdiobus_register(emac_mii);
 	if (rc)
 		goto mdiobus_quit;
+	emac_mdio_irq_init(priv);
 
 	if (netif_msg_probe(priv)) {
 		dev_notice(emac_dev, "DaVinci EMAC Probe found device "\
-			   "(regs: %p, irq: %d)\n",
-			   (void *)priv->emac_base_phys, ndev->irq);
+			   "(regs: %p, irq: %d, %d TX / %d RX channels)\n",
+			   (void *)priv->emac_base_phys, ndev->irq,
+			   priv->num_tx_ch, priv->num_rx_ch);
 	}
+	emac_debugfs_add(priv);
 	return 0;
 
 mdiobus_quit:
@@ -2790,6 +5532,23 @@ probe_quit:
 	return rc;
 }
 
+/**
+ * emac_release_parked: Free what stop keeps for the next open
+ * @priv: The DaVinci EMAC private adapter structure
+ *
+ * Detaches the PHY and frees the parked RX buffers and the DDR BD area,
+ * before the clock goes off or the device goes away
+ */
+static void emac_release_parked(struct emac_priv *priv)
+{
+	if (priv->phydev) {
+		phy_disconnect(priv->phydev);
+		priv->phydev = NULL;
+	}
+	emac_rx_park_free(priv);
+	emac_release_bd_ddr(priv);
+}
+
 /**
  * davinci_emac_remove: EMAC device remove
  * @pdev: The DaVinci EMAC device that we are removing
@@ -2804,17 +5563,21 @@ static int __devexit davinci_emac_remove(struct platform_device *pdev)
 	struct emac_priv *priv = netdev_priv(ndev);
 
 	dev_notice(&ndev->dev, "DaVinci EMAC: davinci_emac_remove()\n");
+	emac_debugfs_remove(priv);
 
 	platform_set_drvdata(pdev, NULL);
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	flush_work(&priv->resume_work);
+	unregister_netdev(ndev);
+	emac_release_parked(priv);
+	emac_mdio_irq_exit(priv);
 	mdiobus_unregister(priv->mii_bus);
 	mdiobus_free(priv->mii_bus);
 
 	release_mem_region(res->start, res->end - res->start + 1);
 
-	unregister_netdev(ndev);
-	free_netdev(ndev);
 	iounmap(priv->remap_addr);
+	free_netdev(ndev);
 
 	clk_disable(emac_clk);
 	clk_put(emac_clk);
@@ -2826,23 +5589,54 @@ static
 int davinci_emac_suspend(struct platform_device *pdev, pm_message_t state)
 {
 	struct net_device *dev = platform_get_drvdata(pdev);
+	struct emac_priv *priv = netdev_priv(dev);
+
+	/* a reopen still pending from the last resume goes first */
+	flush_work(&priv->resume_work);
 
 	if (netif_running(dev))
 		emac_dev_stop(dev);
+	emac_release_parked(priv);
 
 	clk_disable(emac_clk);
 
 	return 0;
 }
 
+/**
+ * emac_resume_work: Reopen the interface after system resume
+ * @work: resume_work of the DaVinci EMAC private adapter structure
+ *
+ * Reopening allocates the RX buffers and reconnects the PHY, then the
+ * link takes autonegotiation time anyway; the rest of the system need
+ * not wait for it to resume.
+ */
+static void emac_resume_work(struct work_struct *work)
+{
+	struct emac_priv *priv = container_of(work, struct emac_priv,
+					      resume_work);
+	struct net_device *ndev = priv->ndev;
+
+	rtnl_lock();
+	if (priv->resume_pending) {
+		priv->resume_pending = 0;
+		if (netif_running(ndev))
+			emac_dev_open(ndev);
+	}
+	rtnl_unlock();
+}
+
 static int davinci_emac_resume(struct platform_device *pdev)
 {
 	struct net_device *dev = platform_get_drvdata(pdev);
+	struct emac_priv *priv = netdev_priv(dev);
 
 	clk_enable(emac_clk);
 
-	if (netif_running(dev))
-		emac_dev_open(dev);
+	if (netif_running(dev)) {
+		priv->resume_pending = 1;
+		schedule_work(&priv->resume_work);
+	}
 
 	return 0;
 }
@@ -2869,7 +5663,13 @@ static struct platform_driver davinci_emac_driver = {
  */
 static int __init davinci_emac_init(void)
 {
-	return platform_driver_register(&davinci_emac_driver);
+	int rc;
+
+	emac_debugfs_init();
+	rc = platform_driver_register(&davinci_emac_driver);
+	if (rc)
+		emac_debugfs_exit();
+	return rc;
 }
 late_initcall(davinci_emac_init);
 
@@ -2882,6 +5682,7 @@ late_initcall(davinci_emac_init);
 static void __exit davinci_emac_exit(void)
 {
 	platform_driver_unregister(&davinci_emac_driver);
+	emac_debugfs_exit();
 }
 module_exit(davinci_emac_exit);
 
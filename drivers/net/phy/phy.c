@@ -410,6 +410,7 @@ EXPORT_SYMBOL(phy_start_aneg);
 
 
 static void phy_change(struct work_struct *work);
+static void phy_mac_change(struct work_struct *work);
 
 /**
  * phy_start_machine - start PHY state machine tracking
@@ -429,6 +430,9 @@ void phy_start_machine(struct phy_device *phydev,
 {
 	phydev->adjust_state = handler;
 
+	if (PHY_IGNORE_INTERRUPT == phydev->irq)
+		INIT_WORK(&phydev->phy_queue, phy_mac_change);
+
 	schedule_delayed_work(&phydev->state_queue, HZ);
 }
 
@@ -442,6 +446,8 @@ void phy_start_machine(struct phy_device *phydev,
  */
 void phy_stop_machine(struct phy_device *phydev)
 {
+	if (PHY_IGNORE_INTERRUPT == phydev->irq)
+		cancel_work_sync(&phydev->phy_queue);
 	cancel_delayed_work_sync(&phydev->state_queue);
 
 	mutex_lock(&phydev->lock);
@@ -692,6 +698,43 @@ phy_err:
 	phy_error(phydev);
 }
 
+/**
+ * phy_mac_change - Scheduled by phy_mac_interrupt to handle link changes
+ * @work: work_struct that describes the work to be done
+ */
+static void phy_mac_change(struct work_struct *work)
+{
+	struct phy_device *phydev =
+		container_of(work, struct phy_device, phy_queue);
+
+	mutex_lock(&phydev->lock);
+	if ((PHY_RUNNING == phydev->state) || (PHY_NOLINK == phydev->state))
+		phydev->state = PHY_CHANGELINK;
+	mutex_unlock(&phydev->lock);
+
+	/* reschedule state queue work to run as soon as possible */
+	cancel_delayed_work_sync(&phydev->state_queue);
+	schedule_delayed_work(&phydev->state_queue, 0);
+}
+
+/**
+ * phy_mac_interrupt - MAC says the link of this PHY may have changed
+ * @phydev: target phy_device struct, irq set to PHY_IGNORE_INTERRUPT
+ *
+ * Description: For MACs that watch the link themselves, e.g. with an
+ *   MDIO controller that polls the PHY status in hardware and raises
+ *   an interrupt on change.  The PHY is then neither polled by the
+ *   state machine while the link is up nor asked to interrupt.  May
+ *   be called from interrupt context.
+ */
+void phy_mac_interrupt(struct phy_device *phydev)
+{
+	if (PHY_IGNORE_INTERRUPT == phydev->irq &&
+	    PHY_HALTED != phydev->state)
+		schedule_work(&phydev->phy_queue);
+}
+EXPORT_SYMBOL(phy_mac_interrupt);
+
 /**
  * phy_stop - Bring down the PHY link, and stop checking the status
  * @phydev: target phy_device struct
@@ -703,7 +746,7 @@ void phy_stop(struct phy_device *phydev)
 	if (PHY_HALTED == phydev->state)
 		goto out_unlock;
 
-	if (phydev->irq != PHY_POLL) {
+	if (phy_interrupt_is_valid(phydev)) {
 		/* Disable PHY Interrupts */
 		phy_config_interrupt(phydev, PHY_INTERRUPT_DISABLED);
 
@@ -890,7 +933,7 @@ void phy_state_machine(struct work_struct *work)
 
 			phydev->adjust_link(phydev->attached_dev);
 
-			if (PHY_POLL != phydev->irq)
+			if (phy_interrupt_is_valid(phydev))
 				err = phy_config_interrupt(phydev,
 						PHY_INTERRUPT_ENABLED);
 			break;
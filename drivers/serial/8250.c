@@ -40,6 +40,7 @@
 #include <linux/mutex.h>
 #include <linux/cpufreq.h>
 #include <linux/clk.h>
+#include <linux/hrtimer.h>
 
 #include <asm/io.h>
 #include <asm/irq.h>
@@ -135,6 +136,7 @@ struct uart_8250_port {
 	unsigned short		capabilities;	/* port capabilities */
 	unsigned short		bugs;		/* port bugs */
 	unsigned int		tx_loadsz;	/* transmit fifo load size */
+	unsigned int		char_ns;	/* time to send one character */
 	unsigned char		acr;
 	unsigned char		ier;
 	unsigned char		lcr;
@@ -162,6 +164,10 @@ struct uart_8250_port {
 #ifdef CONFIG_CPU_FREQ
 	struct notifier_block	freq_transition;
 #endif
+
+	/* platform DMA engine, see struct plat_serial8250_dma */
+	struct plat_serial8250_dma *dma;
+	unsigned char		dma_active;
 };
 
 struct irq_info {
@@ -1340,6 +1346,11 @@ static void serial8250_start_tx(struct uart_port *port)
 {
 	struct uart_8250_port *up = (struct uart_8250_port *)port;
 
+	if (up->dma_active) {
+		up->dma->start_tx(up->dma, port);
+		return;
+	}
+
 	if (!(up->ier & UART_IER_THRI)) {
 		up->ier |= UART_IER_THRI;
 		serial_out(up, UART_IER, up->ier);
@@ -1536,6 +1547,21 @@ static void serial8250_handle_port(struct uart_8250_port *up)
 
 	DEBUG_INTR("status = %x...", status);
 
+	if (up->dma_active) {
+		/* the data itself moves by DMA, only account for errors */
+		if (status & UART_LSR_BI)
+			up->port.icount.brk++;
+		if (status & UART_LSR_PE)
+			up->port.icount.parity++;
+		if (status & UART_LSR_FE)
+			up->port.icount.frame++;
+		if (status & UART_LSR_OE)
+			up->port.icount.overrun++;
+		check_modem_status(up);
+		spin_unlock_irqrestore(&up->port.lock, flags);
+		return;
+	}
+
 	if (status & (UART_LSR_DR | UART_LSR_BI))
 		receive_chars(up, &status);
 	check_modem_status(up);
@@ -2151,12 +2177,20 @@ dont_test_tx_en:
 	up->lsr_saved_flags = 0;
 	up->msr_saved_flags = 0;
 
+	/*
+	 * Hand the data path to the platform's DMA engine, if it has one
+	 * and can get its channels; otherwise the port stays PIO.
+	 */
+	up->dma_active = up->dma && !up->dma->startup(up->dma, &up->port);
+
 	/*
 	 * Finally, enable interrupts.  Note: Modem status interrupts
 	 * are set via set_termios(), which will be occurring imminently
 	 * anyway, so we don't enable them here.
 	 */
-	up->ier = UART_IER_RLSI | UART_IER_RDI;
+	up->ier = UART_IER_RLSI;
+	if (!up->dma_active)
+		up->ier |= UART_IER_RDI;
 	serial_outp(up, UART_IER, up->ier);
 
 	if (up->port.flags & UPF_FOURPORT) {
@@ -2183,6 +2217,11 @@ static void serial8250_shutdown(struct uart_port *port)
 	up->ier = 0;
 	serial_outp(up, UART_IER, 0);
 
+	if (up->dma_active) {
+		up->dma->shutdown(up->dma, &up->port);
+		up->dma_active = 0;
+	}
+
 	spin_lock_irqsave(&up->port.lock, flags);
 	if (up->port.flags & UPF_FOURPORT) {
 		/* reset interrupts on the AST Fourport board */
@@ -2295,6 +2334,8 @@ serial8250_set_termios(struct uart_port *port, struct ktermios *termios,
 		else
 			fcr = uart_config[up->port.type].fcr;
 	}
+	if (up->dma_active)
+		fcr = up->dma->fcr;
 
 	/*
 	 * MCR-based auto flow control.  When AFE is enabled, RTS will be
@@ -2320,6 +2361,7 @@ serial8250_set_termios(struct uart_port *port, struct ktermios *termios,
 	 * Update the per-port timeout.
 	 */
 	uart_update_timeout(port, termios->c_cflag, baud);
+	up->char_ns = 10 * NSEC_PER_SEC / baud;
 
 	up->port.read_status_mask = UART_LSR_OE | UART_LSR_THRE | UART_LSR_DR;
 	if (termios->c_iflag & INPCK)
@@ -2724,6 +2766,127 @@ static void serial8250_console_putchar(struct uart_port *port, int ch)
 	serial_out(up, UART_TX, ch);
 }
 
+#ifdef CONFIG_SERIAL_8250_CONSOLE_BUFFERED
+/*
+ * Buffered console: messages are copied to a ring and fed to the TX FIFO
+ * from an hrtimer that fires whenever the previous FIFO load should have
+ * gone out, so printk() no longer spins on THRE.  Oops output, and output
+ * once the system is going down, is still written synchronously after
+ * flushing whatever is left in the ring.  If the ring fills up the writer
+ * makes room by sending synchronously, so nothing is ever dropped.
+ */
+#define CON_BUF_SIZE	(1 << CONFIG_SERIAL_8250_CONSOLE_BUF_SHIFT)
+
+static char con_buf[CON_BUF_SIZE];
+static unsigned int con_head, con_tail;
+static struct hrtimer con_timer;
+static struct uart_8250_port *con_port;
+
+static inline unsigned int con_buf_used(void)
+{
+	return (con_head - con_tail) & (CON_BUF_SIZE - 1);
+}
+
+/* Send the next FIFO load; returns the time to wait, 0 when done */
+static unsigned long con_buf_drain(struct uart_8250_port *up)
+{
+	unsigned int n = 0;
+
+	if (!con_buf_used())
+		return 0;
+
+	if (serial_in(up, UART_LSR) & UART_LSR_THRE) {
+		while (con_buf_used() && n < up->tx_loadsz) {
+			serial_out(up, UART_TX, con_buf[con_tail]);
+			con_tail = (con_tail + 1) & (CON_BUF_SIZE - 1);
+			n++;
+		}
+	}
+
+	return max(n, 1U) * up->char_ns;
+}
+
+/* Synchronously send everything still in the ring */
+static void con_buf_flush(struct uart_8250_port *up)
+{
+	while (con_buf_used()) {
+		serial8250_console_putchar(&up->port, con_buf[con_tail]);
+		con_tail = (con_tail + 1) & (CON_BUF_SIZE - 1);
+	}
+}
+
+static enum hrtimer_restart con_timer_fn(struct hrtimer *timer)
+{
+	struct uart_8250_port *up = con_port;
+	unsigned long flags, wait;
+
+	spin_lock_irqsave(&up->port.lock, flags);
+	wait = con_buf_drain(up);
+	spin_unlock_irqrestore(&up->port.lock, flags);
+
+	if (!wait)
+		return HRTIMER_NORESTART;
+	hrtimer_forward_now(timer, ns_to_ktime(wait));
+	return HRTIMER_RESTART;
+}
+
+static void con_buf_put(struct uart_8250_port *up, char c)
+{
+	/* full: make room the slow way */
+	if (con_buf_used() == CON_BUF_SIZE - 1) {
+		serial8250_console_putchar(&up->port, con_buf[con_tail]);
+		con_tail = (con_tail + 1) & (CON_BUF_SIZE - 1);
+	}
+	con_buf[con_head] = c;
+	con_head = (con_head + 1) & (CON_BUF_SIZE - 1);
+}
+
+/* Returns 0 if the output was queued, else the caller writes it itself */
+static int serial8250_console_queue(struct uart_8250_port *up,
+				    const char *s, unsigned int count)
+{
+	unsigned long flags, wait;
+
+	if (up != con_port || !up->char_ns || oops_in_progress ||
+	    up->port.sysrq || system_state > SYSTEM_RUNNING)
+		return -EBUSY;
+
+	spin_lock_irqsave(&up->port.lock, flags);
+	for (; count; count--, s++) {
+		if (*s == '\n')
+			con_buf_put(up, '\r');
+		con_buf_put(up, *s);
+	}
+	/* a running callback that found the ring empty will not rearm */
+	if (!hrtimer_is_queued(&con_timer)) {
+		wait = con_buf_drain(up);
+		if (wait)
+			hrtimer_start(&con_timer, ns_to_ktime(wait),
+				      HRTIMER_MODE_REL);
+	}
+	spin_unlock_irqrestore(&up->port.lock, flags);
+
+	return 0;
+}
+
+static void serial8250_console_buf_init(struct uart_8250_port *up)
+{
+	if (con_port)
+		hrtimer_cancel(&con_timer);
+	hrtimer_init(&con_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	con_timer.function = con_timer_fn;
+	con_port = up;
+}
+#else
+static inline void con_buf_flush(struct uart_8250_port *up) { }
+static inline int serial8250_console_queue(struct uart_8250_port *up,
+					   const char *s, unsigned int count)
+{
+	return -EBUSY;
+}
+static inline void serial8250_console_buf_init(struct uart_8250_port *up) { }
+#endif
+
 /*
  *	Print a string to the serial port trying not to disturb
  *	any possible real use of the port...
@@ -2740,6 +2903,9 @@ serial8250_console_write(struct console *co, const char *s, unsigned int count)
 
 	touch_nmi_watchdog();
 
+	if (!serial8250_console_queue(up, s, count))
+		return;
+
 	local_irq_save(flags);
 	if (up->port.sysrq) {
 		/* serial8250_handle_port() already took the lock */
@@ -2759,6 +2925,7 @@ serial8250_console_write(struct console *co, const char *s, unsigned int count)
 	else
 		serial_out(up, UART_IER, 0);
 
+	con_buf_flush(up);
 	uart_console_write(&up->port, s, count, serial8250_console_putchar);
 
 	/*
@@ -2805,6 +2972,8 @@ static int __init serial8250_console_setup(struct console *co, char *options)
 	if (options)
 		uart_parse_options(options, &baud, &parity, &bits, &flow);
 
+	serial8250_console_buf_init(&serial8250_ports[co->index]);
+
 	return uart_set_options(port, co, baud, parity, bits, flow);
 }
 
@@ -3036,6 +3205,7 @@ static int __devinit serial8250_probe(struct platform_device *dev)
 		port.irqflags		|= irqflag;
 		if (p->clk)
 			serial8250_ports[i].clk = p->clk;
+		serial8250_ports[i].dma = p->dma;
 
 		ret = serial8250_register_port(&port);
 		if (ret < 0) {
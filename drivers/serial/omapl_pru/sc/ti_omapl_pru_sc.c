@@ -33,11 +33,16 @@
 #include <linux/serial_reg.h>
 #include <linux/delay.h>
 #include <linux/ti_omapl_pru_suart.h>
+#include <linux/ti_omapl_pru_sc.h>
+#include <linux/completion.h>
+#include <linux/mutex.h>
+#include <linux/uaccess.h>
 #include "omapl_suart_board.h"
 #include "suart_api.h"
 #include "suart_utils.h"
 #include "suart_err.h"
 #include "pru.h"
+#include <mach/pru.h>
 
 #define NR_SUART	8
 #define DRV_NAME "ti_omapl_pru_suart"
@@ -76,6 +81,24 @@ struct suart_dma {
 static dma_addr_t dma_phys_addr;
 static void *dma_vaddr_buff;
 
+/*
+ * A block exchange in progress.  The interrupt handler feeds the PRU the
+ * next FIFO load of @tx as each one completes and gathers what comes
+ * back into @rx, until @rx_want, known once the header is in, is met.
+ */
+struct sc_block {
+	const u8 *tx;
+	unsigned int tx_len;
+	unsigned int tx_pos;
+	u8 rx[SC_T1_MAX_BLOCK];
+	unsigned int rx_len;
+	unsigned int rx_want;
+	unsigned int edc_len;	/* T=1 epilogue, or 0 for a PPS answer */
+	bool active;
+	int status;
+	struct completion done;
+};
+
 struct omapl_pru_suart {
 	struct uart_port port[NR_SUART];
 	arm_pru_iomap pru_arm_iomap;
@@ -93,6 +116,9 @@ struct omapl_pru_suart {
 	u32 tx_loadsz;
     char ifd_cmd[NR_SUART];
     char ifd_rsp[NR_SUART];
+	u8 dir_bits[NR_SUART];
+	struct sc_block block[NR_SUART];
+	struct mutex block_mutex[NR_SUART];
 };
 
 // TBD need to move these to proper header file
@@ -249,6 +275,10 @@ static void omapl_pru_tx_chars(struct omapl_pru_suart *soft_uart, u32 uart_no)
 		return;
 	}
 
+	/* the tty waits while a block exchange owns the line */
+	if (soft_uart->block[uart_no].active)
+		return;
+
 	if (down_trylock(&soft_uart->port_sem[uart_no]))
 		return;
 
@@ -354,6 +384,231 @@ static void omapl_pru_rx_chars(struct omapl_pru_suart *soft_uart, u32 uart_no, u
 	spin_lock(&soft_uart->port[uart_no].lock);
 }
 
+static void sc_block_done(struct sc_block *blk, int status)
+{
+	blk->status = status;
+	blk->active = false;
+	complete(&blk->done);
+}
+
+/* Load the next chunk of a block; port lock held. */
+static void sc_block_tx(struct omapl_pru_suart *soft_uart, u32 uart_no)
+{
+	struct sc_block *blk = &soft_uart->block[uart_no];
+	unsigned int count = min(blk->tx_len - blk->tx_pos,
+				 (unsigned int)SUART_FIFO_LEN + 1);
+
+	if (!count || down_trylock(&soft_uart->port_sem[uart_no]))
+		return;
+
+	memcpy(soft_uart->suart_dma_addr[uart_no].dma_vaddr_buff_tx,
+	       blk->tx + blk->tx_pos, count);
+	blk->tx_pos += count;
+
+	/* the PRU takes the length less one */
+	if (SUART_SUCCESS != pru_softuart_write(&soft_uart->suart_hdl[uart_no],
+				(unsigned int *)
+				&soft_uart->suart_dma_addr[uart_no].dma_phys_addr_tx,
+				count - 1)) {
+		up(&soft_uart->port_sem[uart_no]);
+		sc_block_done(blk, -EIO);
+	}
+}
+
+/* Length of the answer, once enough of it is in to tell. */
+static unsigned int sc_block_want(struct sc_block *blk)
+{
+	if (blk->edc_len) {
+		/* NAD, PCB, LEN, information field, epilogue */
+		if (blk->rx_len >= 3)
+			return 3 + blk->rx[2] + blk->edc_len;
+	} else {
+		/* PPSS, PPS0, the PPS1..3 that PPS0 announces, PCK */
+		if (blk->rx_len >= 2)
+			return 3 + hweight8(blk->rx[1] & 0x70);
+	}
+	return 0;
+}
+
+static void sc_block_rx(struct omapl_pru_suart *soft_uart, u32 uart_no,
+		u16 rx_status, u32 fifo_bytes, u32 config_reg,
+		unsigned char *data_pointer, u16 ctrl_reg)
+{
+	struct sc_block *blk = &soft_uart->block[uart_no];
+	unsigned char data[SUART_FIFO_LEN + 1];
+	unsigned int count = 0;
+
+	pru_softuart_read_data(&soft_uart->suart_hdl[uart_no], data,
+			sizeof(data), &count, rx_status, fifo_bytes,
+			config_reg, data_pointer, ctrl_reg);
+	soft_uart->port[uart_no].icount.rx += count;
+
+	if (rx_status & (CHN_TXRX_STATUS_FE | CHN_TXRX_STATUS_PE |
+			 CHN_TXRX_STATUS_OVRNERR | CHN_TXRX_STATUS_BI)) {
+		sc_block_done(blk, -EIO);
+		return;
+	}
+
+	count = min(count, (unsigned int)sizeof(blk->rx) - blk->rx_len);
+	memcpy(blk->rx + blk->rx_len, data, count);
+	blk->rx_len += count;
+
+	if (!blk->rx_want)
+		blk->rx_want = sc_block_want(blk);
+	if (blk->rx_want && blk->rx_len >= blk->rx_want)
+		sc_block_done(blk, 0);
+	else if (blk->rx_len == sizeof(blk->rx))
+		sc_block_done(blk, -EPROTO);
+}
+
+/*
+ * Send @tx_len bytes and wait, for at most @timeout_ms, for the whole
+ * answer.  Returns its length or a negative error.
+ */
+static int sc_block_xfer(struct omapl_pru_suart *soft_uart, u32 uart_no,
+		const u8 *tx, unsigned int tx_len, unsigned int edc_len,
+		unsigned int timeout_ms, u8 *rx)
+{
+	struct uart_port *port = &soft_uart->port[uart_no];
+	struct sc_block *blk = &soft_uart->block[uart_no];
+	unsigned long flags;
+	long left;
+	int ret;
+
+	mutex_lock(&soft_uart->block_mutex[uart_no]);
+
+	spin_lock_irqsave(&port->lock, flags);
+	blk->tx = tx;
+	blk->tx_len = tx_len;
+	blk->tx_pos = 0;
+	blk->rx_len = 0;
+	blk->rx_want = 0;
+	blk->edc_len = edc_len;
+	blk->status = 0;
+	INIT_COMPLETION(blk->done);
+	blk->active = true;
+	/* if a tty write is still going, its completion starts us */
+	sc_block_tx(soft_uart, uart_no);
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	left = wait_for_completion_interruptible_timeout(&blk->done,
+			msecs_to_jiffies(timeout_ms));
+
+	spin_lock_irqsave(&port->lock, flags);
+	if (blk->active) {
+		blk->active = false;
+		ret = left < 0 ? left : -ETIMEDOUT;
+	} else if (blk->status) {
+		ret = blk->status;
+	} else {
+		memcpy(rx, blk->rx, blk->rx_len);
+		ret = blk->rx_len;
+	}
+	spin_unlock_irqrestore(&port->lock, flags);
+
+	mutex_unlock(&soft_uart->block_mutex[uart_no]);
+	return ret;
+}
+
+/* The rates PPS can select: SUART divisors the card clock setup supports */
+static const struct {
+	u8 di;
+	u16 divisor;
+} sc_pps_rates[] = {
+	{ 1, 0x06 },	/* Di 1, 9600 bit/s at the 3.57 MHz card clock */
+	{ 2, 0x03 },	/* Di 2 */
+	{ 3, 0x01 },	/* Di 4 */
+};
+
+static int sc_pps(struct omapl_pru_suart *soft_uart, u32 uart_no,
+		struct sc_pps *pps)
+{
+	struct uart_port *port = &soft_uart->port[uart_no];
+	u8 req[4], rsp[SC_T1_MAX_BLOCK];
+	unsigned long flags;
+	u16 divisor = 0;
+	int i, ret;
+
+	if (pps->fi > 1 || pps->protocol > 15 || !pps->timeout_ms)
+		return -EINVAL;
+	for (i = 0; i < ARRAY_SIZE(sc_pps_rates); i++)
+		if (sc_pps_rates[i].di == pps->di)
+			divisor = sc_pps_rates[i].divisor;
+	if (!divisor)
+		return -EINVAL;
+
+	req[0] = 0xff;
+	req[1] = 0x10 | pps->protocol;
+	req[2] = (pps->fi << 4) | pps->di;
+	req[3] = req[0] ^ req[1] ^ req[2];
+
+	ret = sc_block_xfer(soft_uart, uart_no, req, sizeof(req), 0,
+			    pps->timeout_ms, rsp);
+	if (ret < 0)
+		return ret;
+
+	/* anything but an echo means the card keeps the default rate */
+	if (ret != sizeof(req) || memcmp(req, rsp, sizeof(req)))
+		return -EPROTO;
+
+	spin_lock_irqsave(&port->lock, flags);
+	if (SUART_SUCCESS != pru_softuart_setbaud(&soft_uart->suart_hdl[uart_no],
+						  divisor, divisor) ||
+	    SUART_SUCCESS != pru_softuart_setdir(&soft_uart->suart_hdl[uart_no],
+						 soft_uart->dir_bits[uart_no],
+						 soft_uart->clk_freq_timer2,
+						 divisor))
+		ret = -EIO;
+	else
+		ret = 0;
+	spin_unlock_irqrestore(&port->lock, flags);
+	return ret;
+}
+
+static int pru_suart_ioctl(struct uart_port *port, unsigned int cmd,
+		unsigned long arg)
+{
+	struct omapl_pru_suart *soft_uart =
+	    container_of(port, struct omapl_pru_suart, port[port->line]);
+	void __user *argp = (void __user *)arg;
+	struct sc_block_xfer *xfer;
+	struct sc_pps pps;
+	int ret;
+
+	switch (cmd) {
+	case SC_IOC_T1_XFER:
+		xfer = kmalloc(sizeof(*xfer), GFP_KERNEL);
+		if (!xfer)
+			return -ENOMEM;
+		if (copy_from_user(xfer, argp, sizeof(*xfer))) {
+			ret = -EFAULT;
+		} else if (xfer->tx_len < 4 || xfer->tx_len > SC_T1_MAX_BLOCK ||
+			   !xfer->bwt_ms) {
+			ret = -EINVAL;
+		} else {
+			ret = sc_block_xfer(soft_uart, port->line, xfer->tx,
+					xfer->tx_len,
+					(xfer->flags & SC_BLOCK_CRC) ? 2 : 1,
+					xfer->bwt_ms, xfer->rx);
+			if (ret >= 0) {
+				xfer->rx_len = ret;
+				ret = copy_to_user(argp, xfer, sizeof(*xfer)) ?
+					-EFAULT : 0;
+			}
+		}
+		kfree(xfer);
+		return ret;
+
+	case SC_IOC_PPS:
+		if (copy_from_user(&pps, argp, sizeof(pps)))
+			return -EFAULT;
+		return sc_pps(soft_uart, port->line, &pps);
+
+	default:
+		return -ENOIOCTLCMD;
+	}
+}
+
 static irqreturn_t omapl_pru_suart_interrupt(int irq, void *dev_id)
 {
     struct uart_port *port = dev_id;
@@ -389,7 +644,10 @@ static irqreturn_t omapl_pru_suart_interrupt(int irq, void *dev_id)
 			config_reg = pru_softuart_getRxConfig2(&soft_uart->suart_hdl[port->line]);
 			data_pointer = pru_softuart_getRxDataPointer(&soft_uart->suart_hdl[port->line]);
 			ctrl_reg = pru_softuart_getRxCntrlReg(&soft_uart->suart_hdl[port->line]);
-			omapl_pru_rx_chars(soft_uart, port->line, rx_status, fifo_bytes, config_reg, data_pointer, ctrl_reg);
+			if (soft_uart->block[port->line].active)
+				sc_block_rx(soft_uart, port->line, rx_status, fifo_bytes, config_reg, data_pointer, ctrl_reg);
+			else
+				omapl_pru_rx_chars(soft_uart, port->line, rx_status, fifo_bytes, config_reg, data_pointer, ctrl_reg);
 		}
 	}
 
@@ -397,7 +655,10 @@ static irqreturn_t omapl_pru_suart_interrupt(int irq, void *dev_id)
 			pru_intr_clr_isrstatus(uartNum, PRU_TX_INTR);
 			pru_softuart_clrTxStatus(&soft_uart->suart_hdl[port->line]);
 			up(&soft_uart->port_sem[port->line]);
-			omapl_pru_tx_chars(soft_uart, port->line);
+			if (soft_uart->block[port->line].active)
+				sc_block_tx(soft_uart, port->line);
+			else
+				omapl_pru_tx_chars(soft_uart, port->line);
 		}
 	} while (txrx_flag & (PRU_RX_INTR | PRU_TX_INTR));
 
@@ -570,6 +831,7 @@ static void pru_suart_set_termios(struct uart_port *port,
 /*
  * Calculate the dir delay offset (bits)
  */
+	soft_uart->dir_bits[port->line] = dir_delay_offset;
         if (SUART_SUCCESS !=
             pru_softuart_setdir(&soft_uart->suart_hdl[port->line],
                                  dir_delay_offset, soft_uart->clk_freq_timer2,
@@ -949,6 +1211,7 @@ static struct uart_ops pru_suart_ops = {
 	.request_port = pru_suart_request_port,
 	.config_port = pru_suart_config_port,
 	.verify_port = pru_suart_verify_port,
+	.ioctl = pru_suart_ioctl,
 };
 
 static struct uart_driver pru_suart_reg = {
@@ -1119,13 +1382,23 @@ static int __devinit omapl_pru_suart_probe(struct platform_device *pdev)
                 clk_enable(soft_uart->clk_timer2);
         }
 
+	/* the smart card uses both cores, keep other PRU drivers off them */
+	err = davinci_pru_request(PRU_NUM0, &pdev->dev);
+	if (err)
+		goto probe_exit_clk;
+	err = davinci_pru_request(PRU_NUM1, &pdev->dev);
+	if (err) {
+		davinci_pru_release(PRU_NUM0);
+		goto probe_exit_clk;
+	}
+
     /* Request the firmware for PRU0 */
 	err = request_firmware(&soft_uart->fw_pru0, "PRU_SUART_SC_Emulation.bin",
 			       &pdev->dev);
 	if (err) {
 		dev_err(&pdev->dev, "can't load firmware\n");
 		err = -ENODEV;
-		goto probe_exit_clk;
+		goto probe_release_pru;
 	}
 	dev_info(&pdev->dev, "fw_pru0 size %td. downloading...\n",
 		 soft_uart->fw_pru0->size);
@@ -1136,7 +1409,7 @@ static int __devinit omapl_pru_suart_probe(struct platform_device *pdev)
 	if (err) {
 		dev_err(&pdev->dev, "can't load firmware\n");
 		err = -ENODEV;
-		goto probe_exit_clk;
+		goto probe_release_pru;
 	}
 	dev_info(&pdev->dev, "fw_pru1 size %td. downloading...\n",
 		 soft_uart->fw_pru1->size);
@@ -1147,7 +1420,7 @@ static int __devinit omapl_pru_suart_probe(struct platform_device *pdev)
 	if (!dma_vaddr_buff) {
         __suart_err("Failed to allocate shared ram.\n");
         err = -EFAULT;
-        goto probe_exit_clk;
+        goto probe_release_pru;
     }
 
 	soft_uart->pru_arm_iomap.pFifoBufferPhysBase = (void *)dma_phys_addr;
@@ -1202,6 +1475,8 @@ static int __devinit omapl_pru_suart_probe(struct platform_device *pdev)
 		soft_uart->port[i].serial_out = NULL;
 		uart_add_one_port(&pru_suart_reg, &soft_uart->port[i]);
 		init_MUTEX(&soft_uart->port_sem[i]);
+		mutex_init(&soft_uart->block_mutex[i]);
+		init_completion(&soft_uart->block[i].done);
 	}
 	platform_set_drvdata(pdev, &soft_uart->port[0]);
 
@@ -1225,6 +1500,9 @@ static int __devinit omapl_pru_suart_probe(struct platform_device *pdev)
 probe_release_fw:
 	release_firmware(soft_uart->fw_pru0);
 	release_firmware(soft_uart->fw_pru1);
+probe_release_pru:
+	davinci_pru_release(PRU_NUM1);
+	davinci_pru_release(PRU_NUM0);
 probe_exit_clk:
 	clk_put(soft_uart->clk_mcasp);
 probe_exit_clk_timer2:
@@ -1295,6 +1573,8 @@ static int __devexit omapl_pru_suart_remove(struct platform_device *pdev)
 	clk_disable(soft_uart->clk_mcasp);
 	clk_disable(soft_uart->clk_timer2);
 	pru_softuart_deinit();
+	davinci_pru_release(PRU_NUM1);
+	davinci_pru_release(PRU_NUM0);
 	clk_disable(soft_uart->clk_pru);
 	iounmap(soft_uart->pru_arm_iomap.mcasp_io_addr);
 	iounmap(soft_uart->pru_arm_iomap.pru_io_addr);
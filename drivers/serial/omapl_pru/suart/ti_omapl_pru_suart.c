@@ -32,12 +32,14 @@
 #include <linux/clk.h>
 #include <linux/serial_reg.h>
 #include <linux/delay.h>
+#include <linux/dma-mapping.h>
 #include <linux/ti_omapl_pru_suart.h>
 #include "omapl_suart_board.h"
 #include "suart_api.h"
 #include "suart_utils.h"
 #include "suart_err.h"
 #include "pru.h"
+#include <mach/pru.h>
 
 #define NR_SUART	8
 #define DRV_NAME "ti_omapl_pru_suart"
@@ -45,7 +47,7 @@
 #define MAX_SUART_RETRIES 100
 #define SUART_CNTX_SZ 512
 #define PLATFORM_SUART_RES_SZ 6
-#define SUART_FIFO_TIMEOUT_DFLT 5
+#define SUART_FIFO_TIMEOUT_DFLT 0
 #define SUART_FIFO_TIMEOUT_MIN 4
 #define SUART_FIFO_TIMEOUT_MAX 500
 
@@ -60,10 +62,29 @@
 #define SUPPORT_SYSRQ
 #endif
 
-/* Default timeout set to 5ms */
+/* Default is no fixed timeout, use rx_timeout_bits */
 static int suart_timeout = SUART_FIFO_TIMEOUT_DFLT;
 module_param(suart_timeout, int, S_IRUGO);
-MODULE_PARM_DESC(suart_timeout, "fifo timeout in milli seconds (min: 4; max: 500)");
+MODULE_PARM_DESC(suart_timeout, "fifo timeout in milli seconds (min: 4; max: 500; 0: use rx_timeout_bits)");
+
+/*
+ * The firmware flushes a partly filled RX FIFO once the line has been
+ * idle this many bit times.  35 is the 3.5 characters Modbus RTU uses
+ * to separate frames; it is converted to the port's baud rate, so a
+ * frame is handed up about as soon as it can be known to be complete.
+ */
+static unsigned int rx_timeout_bits = 35;
+module_param(rx_timeout_bits, uint, S_IRUGO);
+MODULE_PARM_DESC(rx_timeout_bits, "rx idle timeout in bit times (default: 35)");
+
+/*
+ * Ports in this mask start with UPF_LOW_LATENCY, as "setserial low_latency"
+ * would set it: received data then reaches the reader through the real
+ * time flip worker instead of a keventd run a jiffy later.
+ */
+static unsigned int low_latency;
+module_param(low_latency, uint, S_IRUGO);
+MODULE_PARM_DESC(low_latency, "bit mask of low latency ports (default: 0)");
 
 struct suart_dma {
 	void *dma_vaddr_buff_tx;
@@ -89,8 +110,37 @@ struct omapl_pru_suart {
 	u32 clk_freq_mcasp;
 	u32 clk_freq_timer2;
 	u32 tx_loadsz;
+	u16 rx_idle[NR_SUART];	/* idle timeout in firmware ticks, 0 if closed */
+	/* transmit chunk the PRU is reading straight out of xmit->buf */
+	dma_addr_t tx_dma[NR_SUART];
+	u16 tx_dma_len[NR_SUART];
+	u16 tx_count[NR_SUART];	/* bytes to retire, 0 after a flush */
 };
 
+/*
+ * The firmware has one idle timeout for all channels, counted in bit
+ * periods at SUART_DEFAULT_BAUD.  Use the shortest any open port wants,
+ * so no port waits longer than asked; slower ports just flush early.
+ */
+static void suart_update_rx_timeout(struct omapl_pru_suart *soft_uart)
+{
+	u32 timeout = USHORT_MAX;
+	int i;
+
+	if (suart_timeout) {
+		pru_set_fifo_timeout((SUART_DEFAULT_BAUD * suart_timeout) / 1000);
+		return;
+	}
+
+	for (i = 0; i < NR_SUART; i++)
+		if (soft_uart->rx_idle[i] && soft_uart->rx_idle[i] < timeout)
+			timeout = soft_uart->rx_idle[i];
+	if (timeout == USHORT_MAX)
+		timeout = clamp_t(u32, rx_timeout_bits, 1, USHORT_MAX);
+
+	pru_set_fifo_timeout(timeout);
+}
+
 static u32 suart_get_duplex(struct omapl_pru_suart *soft_uart, u32 uart_no)
 {
 	return (soft_uart->suart_hdl[uart_no].uartType);
@@ -140,32 +190,27 @@ static void omapl_pru_tx_chars(struct omapl_pru_suart *soft_uart, u32 uart_no)
 		return;
 	}
 
-	for (count = 0; count <= soft_uart->tx_loadsz; count++) {
-		*((char *)soft_uart->suart_dma_addr[uart_no].dma_vaddr_buff_tx +
-		  count) = xmit->buf[xmit->tail];
-		xmit->tail = (xmit->tail + 1) & (UART_XMIT_SIZE - 1);	/* limit to PAGE_SIZE */
-		soft_uart->port[uart_no].icount.tx++;
-		if (uart_circ_empty(xmit)) {
-			uart_circ_clear(xmit);
-			break;
-		}
-	}
-
-	if (count == (SUART_FIFO_LEN + 1))
-			count = SUART_FIFO_LEN;
-
-	/* Write the character to the data port */
+	/*
+	 * The PRU reads the chunk straight out of the circular buffer; the
+	 * bytes stay queued there until it reports the chunk done.
+	 */
+	count = min_t(int, CIRC_CNT_TO_END(xmit->head, xmit->tail,
+					   UART_XMIT_SIZE),
+		      soft_uart->tx_loadsz + 1);
+	soft_uart->tx_dma[uart_no] = dma_map_single(soft_uart->port[uart_no].dev,
+					xmit->buf + xmit->tail, count,
+					DMA_TO_DEVICE);
+	soft_uart->tx_dma_len[uart_no] = count;
+	soft_uart->tx_count[uart_no] = count;
+
+	/* the PRU takes the length less one */
 	if (SUART_SUCCESS != pru_softuart_write(&soft_uart->suart_hdl[uart_no],
 						(unsigned int *)
-						&soft_uart->suart_dma_addr
-						[uart_no].dma_phys_addr_tx,
-						count)) {
+						&soft_uart->tx_dma[uart_no],
+						count - 1)) {
 		__suart_err("failed to tx data\n");
 	}
 
-	if (uart_circ_chars_pending(xmit) < WAKEUP_CHARS)
-		uart_write_wakeup(&soft_uart->port[uart_no]);
-
 #if 0
 	if (uart_circ_empty(xmit)){
 		__stop_tx(soft_uart, uart_no);
@@ -173,6 +218,28 @@ static void omapl_pru_tx_chars(struct omapl_pru_suart *soft_uart, u32 uart_no)
 #endif
 }
 
+/* The PRU is done with the chunk omapl_pru_tx_chars() gave it. */
+static void omapl_pru_tx_done(struct omapl_pru_suart *soft_uart, u32 uart_no)
+{
+	struct circ_buf *xmit = &soft_uart->port[uart_no].state->xmit;
+
+	if (!soft_uart->tx_dma_len[uart_no])
+		return;
+
+	dma_unmap_single(soft_uart->port[uart_no].dev,
+			 soft_uart->tx_dma[uart_no],
+			 soft_uart->tx_dma_len[uart_no], DMA_TO_DEVICE);
+	soft_uart->tx_dma_len[uart_no] = 0;
+
+	xmit->tail = (xmit->tail + soft_uart->tx_count[uart_no]) &
+			(UART_XMIT_SIZE - 1);
+	soft_uart->port[uart_no].icount.tx += soft_uart->tx_count[uart_no];
+	soft_uart->tx_count[uart_no] = 0;
+
+	if (uart_circ_chars_pending(xmit) < WAKEUP_CHARS)
+		uart_write_wakeup(&soft_uart->port[uart_no]);
+}
+
 static void omapl_pru_rx_chars(struct omapl_pru_suart *soft_uart, u32 uart_no, u16 rx_status, u32 fifo_bytes, u32 config_reg, unsigned char * data_pointer, u16 ctrl_reg)
 {
 	struct tty_struct *tty = soft_uart->port[uart_no].state->port.tty;
@@ -278,6 +345,7 @@ static irqreturn_t omapl_pru_suart_interrupt(int irq, void *dev_id)
 		if ((PRU_TX_INTR & txrx_flag) == PRU_TX_INTR) {
 			pru_intr_clr_isrstatus(uartNum, PRU_TX_INTR);
 			pru_softuart_clrTxStatus(&soft_uart->suart_hdl[port->line]);
+			omapl_pru_tx_done(soft_uart, port->line);
 			up(&soft_uart->port_sem[port->line]);
 			omapl_pru_tx_chars(soft_uart, port->line);
 		}
@@ -436,6 +504,11 @@ static void pru_suart_set_termios(struct uart_port *port,
 				  port->uartclk / 16 / 0xffff,
 				  port->uartclk / 16);
 
+	soft_uart->rx_idle[port->line] = clamp_t(u32,
+			rx_timeout_bits * (SUART_DEFAULT_BAUD / baud),
+			1, USHORT_MAX);
+	suart_update_rx_timeout(soft_uart);
+
 /*
  * Ok, we're now changing the port state.  Do it with
  * interrupts disabled.
@@ -609,6 +682,18 @@ static void pru_suart_shutdown(struct uart_port *port)
 
 	/* free interrupts */
 	free_irq(port->irq, port);
+
+	/* a chunk still in flight is not coming back through the irq */
+	if (soft_uart->tx_dma_len[port->line]) {
+		dma_unmap_single(port->dev, soft_uart->tx_dma[port->line],
+				 soft_uart->tx_dma_len[port->line],
+				 DMA_TO_DEVICE);
+		soft_uart->tx_dma_len[port->line] = 0;
+		soft_uart->tx_count[port->line] = 0;
+	}
+
+	soft_uart->rx_idle[port->line] = 0;
+	suart_update_rx_timeout(soft_uart);
 }
 
 /*
@@ -663,7 +748,6 @@ static int pru_suart_request_port(struct uart_port *port)
 	    container_of(port, struct omapl_pru_suart, port[port->line]);
 	struct platform_device *pdev = to_platform_device(port->dev);
 	suart_config pru_suart_config;
-	u32 timeout = 0;
 	u32 err = 0;
 	if (soft_uart == NULL) {
 		__suart_err("soft_uart ptr failed\n");
@@ -677,7 +761,9 @@ static int pru_suart_request_port(struct uart_port *port)
 	}
 
 	/* set fifo timeout */
-	if (SUART_FIFO_TIMEOUT_MIN > suart_timeout){
+	if (!suart_timeout) {
+		/* per baud rate, see pru_suart_set_termios() */
+	} else if (SUART_FIFO_TIMEOUT_MIN > suart_timeout){
 		__suart_err("fifo timeout less than %d ms not supported\n", SUART_FIFO_TIMEOUT_MIN);
 		suart_timeout = SUART_FIFO_TIMEOUT_MIN;
 	} else if (SUART_FIFO_TIMEOUT_MAX < suart_timeout){
@@ -685,9 +771,7 @@ static int pru_suart_request_port(struct uart_port *port)
 		suart_timeout = SUART_FIFO_TIMEOUT_MAX;
 	}
 
-	/* This is only for x8 */
-	timeout = (SUART_DEFAULT_BAUD * suart_timeout) / 1000;
-	pru_set_fifo_timeout(timeout);
+	suart_update_rx_timeout(soft_uart);
 
 	if (soft_uart->suart_hdl[port->line].uartNum == PRU_SUART_UART1) {
 		pru_suart_config.TXSerializer = PRU_SUART1_CONFIG_TX_SER;
@@ -787,6 +871,22 @@ static void pru_suart_config_port(struct uart_port *port, int flags)
 		port->type = OMAPL_PRU_SUART;
 }
 
+/*
+ *	The tty layer has emptied the transmit buffer.  A chunk the PRU is
+ *	still sending is left mapped, but its bytes must not be retired
+ *	from the (now reset) circular buffer when it completes.
+ *
+ *	Locking: port->lock taken.
+ *	Interrupts: locally disabled.
+ */
+static void pru_suart_flush_buffer(struct uart_port *port)
+{
+	struct omapl_pru_suart *soft_uart =
+	    container_of(port, struct omapl_pru_suart, port[port->line]);
+
+	soft_uart->tx_count[port->line] = 0;
+}
+
 /*
  *	Verify the new serial port information contained within serinfo is
  *  suitable for this port type.
@@ -833,6 +933,7 @@ static struct uart_ops pru_suart_ops = {
 	.request_port = pru_suart_request_port,
 	.config_port = pru_suart_config_port,
 	.verify_port = pru_suart_verify_port,
+	.flush_buffer = pru_suart_flush_buffer,
 };
 
 static struct uart_driver pru_suart_reg = {
@@ -987,12 +1088,22 @@ static int __devinit omapl_pru_suart_probe(struct platform_device *pdev)
         }
 
 
+	/* both cores run SUART firmware, keep other PRU drivers off them */
+	err = davinci_pru_request(PRU_NUM0, &pdev->dev);
+	if (err)
+		goto probe_exit_clk;
+	err = davinci_pru_request(PRU_NUM1, &pdev->dev);
+	if (err) {
+		davinci_pru_release(PRU_NUM0);
+		goto probe_exit_clk;
+	}
+
 	err = request_firmware(&soft_uart->fw, "PRU_SUART_Emulation.bin",
 			       &pdev->dev);
 	if (err) {
 		dev_err(&pdev->dev, "can't load firmware\n");
 		err = -ENODEV;
-		goto probe_exit_clk;
+		goto probe_release_pru;
 	}
 	dev_info(&pdev->dev, "fw size %td. downloading...\n",
 		 soft_uart->fw->size);
@@ -1007,7 +1118,7 @@ static int __devinit omapl_pru_suart_probe(struct platform_device *pdev)
 	if (!dma_vaddr_buff) {
         __suart_err("Failed to allocate shared ram.\n");
         err = -EFAULT;
-        goto probe_exit_clk;
+        goto probe_release_fw;
     }
 
 	soft_uart->pru_arm_iomap.pFifoBufferPhysBase = (void *)dma_phys_addr;
@@ -1029,6 +1140,8 @@ static int __devinit omapl_pru_suart_probe(struct platform_device *pdev)
 		soft_uart->port[i].ops = &pru_suart_ops;
 		soft_uart->port[i].iotype = UPIO_MEM;	/* user conf parallel io */
 		soft_uart->port[i].flags = UPF_BOOT_AUTOCONF | UPF_IOREMAP;
+		if (low_latency & BIT(i))
+			soft_uart->port[i].flags |= UPF_LOW_LATENCY;
 		soft_uart->port[i].mapbase = res_mem[1]->start;
 		soft_uart->port[i].membase =
 		    (unsigned char *)&soft_uart->pru_arm_iomap;
@@ -1080,6 +1193,9 @@ static int __devinit omapl_pru_suart_probe(struct platform_device *pdev)
 
 probe_release_fw:
 	release_firmware(soft_uart->fw);
+probe_release_pru:
+	davinci_pru_release(PRU_NUM1);
+	davinci_pru_release(PRU_NUM0);
 probe_exit_clk:
 	clk_put(soft_uart->clk_mcasp);
 probe_exit_clk_timer2:
@@ -1147,6 +1263,8 @@ static int __devexit omapl_pru_suart_remove(struct platform_device *pdev)
 	clk_disable(soft_uart->clk_mcasp);
 	clk_disable(soft_uart->clk_timer2);
 	pru_softuart_deinit();
+	davinci_pru_release(PRU_NUM1);
+	davinci_pru_release(PRU_NUM0);
 	clk_disable(soft_uart->clk_pru);
 	iounmap(soft_uart->pru_arm_iomap.mcasp_io_addr);
 	iounmap(soft_uart->pru_arm_iomap.pru_io_addr);
@@ -25,12 +25,15 @@
 #include <linux/err.h>
 #include <linux/clk.h>
 #include <linux/dma-mapping.h>
+#include <linux/cache.h>
+#include <linux/mm.h>
 #include <linux/spi/spi.h>
-#include <linux/spi/spi_bitbang.h>
+#include <linux/workqueue.h>
 #include <linux/cpufreq.h>
 
 #include <mach/spi.h>
 #include <mach/edma.h>
+#include <mach/dma-pool.h>
 
 #include "davinci_spi.h"
 
@@ -38,6 +41,9 @@
 
 static unsigned use_dma;
 
+static void davinci_spi_chain_done(struct davinci_spi *davinci_spi,
+				   u16 ch_status);
+
 static void davinci_spi_rx_buf_u8(u32 data, struct davinci_spi *davinci_spi)
 {
 	u8 *rx = davinci_spi->rx;
@@ -111,31 +117,28 @@ static void davinci_spi_set_dma_req(const struct spi_device *spi, int enable)
 }
 
 /*
- * Interface to control the chip select signal
+ * Interface to control the chip select signal: transfers activate it,
+ * this drops it again
  */
-static void davinci_spi_chipselect(struct spi_device *spi, int value)
+static void davinci_spi_cs_deassert(struct spi_device *spi)
 {
 	struct davinci_spi *davinci_spi;
-	struct davinci_spi_platform_data *pdata;
 	u32 data1_reg_val = 0;
 
 	davinci_spi = spi_master_get_devdata(spi->master);
-	pdata = davinci_spi->pdata;
 
 	/*
 	 * Board specific chip select logic decides the polarity and cs
 	 * line for the controller
 	 */
-	if (value == BITBANG_CS_INACTIVE) {
-		set_io_bits(davinci_spi->base + SPIDEF, CS_DEFAULT);
+	set_io_bits(davinci_spi->base + SPIDEF, CS_DEFAULT);
 
-		data1_reg_val |= CS_DEFAULT << SPIDAT1_CSNR_SHIFT;
-		iowrite32(data1_reg_val, davinci_spi->base + SPIDAT1);
+	data1_reg_val |= CS_DEFAULT << SPIDAT1_CSNR_SHIFT;
+	iowrite32(data1_reg_val, davinci_spi->base + SPIDAT1);
 
-		while ((ioread32(davinci_spi->base + SPIBUF)
-					& SPIBUF_RXEMPTY_MASK) == 0)
-			cpu_relax();
-	}
+	while ((ioread32(davinci_spi->base + SPIBUF)
+				& SPIBUF_RXEMPTY_MASK) == 0)
+		cpu_relax();
 }
 
 static void davinci_spi_calc_clk_div(struct davinci_spi *davinci_spi)
@@ -236,6 +239,12 @@ static void davinci_spi_dma_rx_callback(unsigned lch, u16 ch_status, void *data)
 	davinci_spi_dma = &(davinci_spi->dma_channels[spi->chip_select]);
 	pdata = davinci_spi->pdata;
 
+	/* the last RX set of a chained message ends the whole message */
+	if (davinci_spi->chain_msg) {
+		davinci_spi_chain_done(davinci_spi, ch_status);
+		return;
+	}
+
 	if (ch_status == DMA_COMPLETE)
 		edma_stop(davinci_spi_dma->dma_rx_channel);
 	else {
@@ -259,6 +268,12 @@ static void davinci_spi_dma_tx_callback(unsigned lch, u16 ch_status, void *data)
 	davinci_spi_dma = &(davinci_spi->dma_channels[spi->chip_select]);
 	pdata = davinci_spi->pdata;
 
+	/* chained TX only interrupts on errors, which end the message */
+	if (davinci_spi->chain_msg) {
+		davinci_spi_chain_done(davinci_spi, ch_status);
+		return;
+	}
+
 	if (ch_status == DMA_COMPLETE)
 		edma_stop(davinci_spi_dma->dma_tx_channel);
 	else {
@@ -282,7 +297,7 @@ static int davinci_spi_request_dma(struct spi_device *spi)
 	davinci_spi = spi_master_get_devdata(spi->master);
 	davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
 	pdata = davinci_spi->pdata;
-	sdev = davinci_spi->bitbang.master->dev.parent;
+	sdev = davinci_spi->master->dev.parent;
 
 	r = edma_alloc_channel(davinci_spi_dma->dma_rx_sync_dev,
 				davinci_spi_dma_rx_callback, spi,
@@ -321,7 +336,7 @@ static int davinci_spi_setup(struct spi_device *spi)
 	struct device *sdev;
 
 	davinci_spi = spi_master_get_devdata(spi->master);
-	sdev = davinci_spi->bitbang.master->dev.parent;
+	sdev = davinci_spi->master->dev.parent;
 
 	/* if bits per word length is zero then set it default 8 */
 	if (!spi->bits_per_word)
@@ -495,7 +510,7 @@ static int davinci_spi_bufs_prep(struct spi_device *spi,
 static int davinci_spi_check_error(struct davinci_spi *davinci_spi,
 				   int int_status)
 {
-	struct device *sdev = davinci_spi->bitbang.master->dev.parent;
+	struct device *sdev = davinci_spi->master->dev.parent;
 
 	if (int_status & SPIFLG_TIMEOUT_MASK) {
 		dev_dbg(sdev, "SPI Time-out Error\n");
@@ -536,6 +551,57 @@ static int davinci_spi_check_error(struct davinci_spi *davinci_spi,
 	return 0;
 }
 
+/*
+ * PIO word loop, in lock-step: each word is written once the previous
+ * one has come back, so the receive buffer can't overrun and TXBUF is
+ * always free.  @conv is a constant at each call site, giving separate
+ * 8- and 16-bit loops with no per-word indirect calls.
+ */
+static __always_inline void davinci_spi_pio_loop(void __iomem *base,
+		u32 data1_reg_val, const void *tx, void *rx, unsigned count,
+		const unsigned conv)
+{
+	const u8 *tx8 = tx;
+	const u16 *tx16 = tx;
+	u8 *rx8 = rx;
+	u16 *rx16 = rx;
+	unsigned i;
+	u32 buf;
+
+	for (i = 0; i < count; i++) {
+		u32 word = 0;
+
+		if (tx)
+			word = conv == 2 ? tx16[i] : tx8[i];
+		iowrite32(data1_reg_val | word, base + SPIDAT1);
+
+		do {
+			buf = ioread32(base + SPIBUF);
+		} while (buf & SPIBUF_RXEMPTY_MASK);
+
+		if (rx) {
+			if (conv == 2)
+				rx16[i] = buf;
+			else
+				rx8[i] = buf;
+		}
+	}
+}
+
+static void davinci_spi_pio_words(struct davinci_spi *davinci_spi,
+		u32 data1_reg_val, const void *tx, void *rx, unsigned count,
+		unsigned conv)
+{
+	data1_reg_val &= ~0xffff;
+
+	if (conv == 2)
+		davinci_spi_pio_loop(davinci_spi->base, data1_reg_val,
+				tx, rx, count, 2);
+	else
+		davinci_spi_pio_loop(davinci_spi->base, data1_reg_val,
+				tx, rx, count, 1);
+}
+
 /*
  * davinci_spi_bufs - functions which will handle transfer data
  * @spi: spi device on which data transfer to be done
@@ -550,8 +616,7 @@ static int davinci_spi_bufs_pio(struct spi_device *spi, struct spi_transfer *t)
 	struct davinci_spi *davinci_spi;
 	int int_status, count, ret = 0;
 	u8 conv, tmp;
-	u32 tx_data, data1_reg_val;
-	u32 buf_val, flg_val;
+	u32 data1_reg_val;
 	struct davinci_spi_platform_data *pdata;
 
 	davinci_spi = spi_master_get_devdata(spi->master);
@@ -591,75 +656,30 @@ static int davinci_spi_bufs_pio(struct spi_device *spi, struct spi_transfer *t)
 		cpu_relax();
 
 	/* Determine the command to execute READ or WRITE */
-	if (t->tx_buf) {
+	if (t->tx_buf || pdata->poll_mode) {
 		clear_io_bits(davinci_spi->base + SPIINT, SPIINT_MASKALL);
 
-		while (1) {
-			tx_data = davinci_spi->get_tx(davinci_spi);
+		/* polled RX keeps the serial clock going with dummy words */
+		davinci_spi_pio_words(davinci_spi, data1_reg_val, t->tx_buf,
+				t->rx_buf, count, conv);
+	} else {	/* Receive in Interrupt mode */
+		int i;
 
-			data1_reg_val &= ~(0xFFFF);
-			data1_reg_val |= (0xFFFF & tx_data);
+		for (i = 0; i < davinci_spi->count; i++) {
+			set_io_bits(davinci_spi->base + SPIINT,
+					SPIINT_BITERR_INTR
+					| SPIINT_OVRRUN_INTR
+					| SPIINT_RX_INTR);
 
-			buf_val = ioread32(davinci_spi->base + SPIBUF);
-			if ((buf_val & SPIBUF_TXFULL_MASK) == 0) {
-				iowrite32(data1_reg_val,
-						davinci_spi->base + SPIDAT1);
+			iowrite32(data1_reg_val,
+					davinci_spi->base + SPIDAT1);
 
-				count--;
-			}
-			while (ioread32(davinci_spi->base + SPIBUF)
-					& SPIBUF_RXEMPTY_MASK)
+			while (ioread32(davinci_spi->base + SPIINT) &
+					SPIINT_RX_INTR)
 				cpu_relax();
-
-			/* getting the returned byte */
-			if (t->rx_buf) {
-				buf_val = ioread32(davinci_spi->base + SPIBUF);
-				davinci_spi->get_rx(buf_val, davinci_spi);
-			}
-			if (count <= 0)
-				break;
-		}
-	} else {
-		if (pdata->poll_mode) {
-			while (1) {
-				/* keeps the serial clock going */
-				if ((ioread32(davinci_spi->base + SPIBUF)
-						& SPIBUF_TXFULL_MASK) == 0)
-					iowrite32(data1_reg_val,
-						davinci_spi->base + SPIDAT1);
-
-				while (ioread32(davinci_spi->base + SPIBUF) &
-						SPIBUF_RXEMPTY_MASK)
-					cpu_relax();
-
-				flg_val = ioread32(davinci_spi->base + SPIFLG);
-				buf_val = ioread32(davinci_spi->base + SPIBUF);
-
-				davinci_spi->get_rx(buf_val, davinci_spi);
-
-				count--;
-				if (count <= 0)
-					break;
-			}
-		} else {	/* Receive in Interrupt mode */
-			int i;
-
-			for (i = 0; i < davinci_spi->count; i++) {
-				set_io_bits(davinci_spi->base + SPIINT,
-						SPIINT_BITERR_INTR
-						| SPIINT_OVRRUN_INTR
-						| SPIINT_RX_INTR);
-
-				iowrite32(data1_reg_val,
-						davinci_spi->base + SPIDAT1);
-
-				while (ioread32(davinci_spi->base + SPIINT) &
-						SPIINT_RX_INTR)
-					cpu_relax();
-			}
-			iowrite32((data1_reg_val & 0x0ffcffff),
-					davinci_spi->base + SPIDAT1);
 		}
+		iowrite32((data1_reg_val & 0x0ffcffff),
+				davinci_spi->base + SPIDAT1);
 	}
 
 	/*
@@ -685,49 +705,158 @@ out:
 #define DAVINCI_DMA_DATA_TYPE_S16	0x02
 #define DAVINCI_DMA_DATA_TYPE_S32	0x04
 
+/* Smallest middle part of a transfer worth sending by DMA */
+#define DAVINCI_SPI_DMA_MIN	(2 * L1_CACHE_BYTES)
+
+/*
+ * Whether a buffer can be DMA mapped as it is: lowmem, and for RX whole
+ * cache lines, so invalidating it can't lose CPU writes next to it.
+ */
+static bool davinci_spi_dma_safe(const void *buf, unsigned len, bool rx)
+{
+	if (!buf)
+		return true;
+	if (!virt_addr_valid(buf) || !virt_addr_valid(buf + len - 1))
+		return false;
+	return !rx || (IS_ALIGNED((unsigned long)buf, L1_CACHE_BYTES) &&
+			IS_ALIGNED(len, L1_CACHE_BYTES));
+}
+
+/*
+ * DMA @len bytes at @offset into the transfer.  With no tx_buf, a zero
+ * word from tmp_buf is clocked out for every word received.
+ */
+static int davinci_spi_dma_words(struct davinci_spi *davinci_spi,
+		struct spi_device *spi, struct spi_transfer *t,
+		unsigned offset, unsigned len, unsigned conv, bool premapped)
+{
+	struct davinci_spi_dma *davinci_spi_dma;
+	struct device *sdev = davinci_spi->master->dev.parent;
+	unsigned long tx_reg, rx_reg;
+	dma_addr_t tx_dma, rx_dma = 0;
+	unsigned count = len / conv;
+
+	davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
+
+	tx_reg = (unsigned long)davinci_spi->pbase + SPIDAT1;
+	rx_reg = (unsigned long)davinci_spi->pbase + SPIBUF;
+
+	init_completion(&davinci_spi_dma->dma_rx_completion);
+	init_completion(&davinci_spi_dma->dma_tx_completion);
+
+	if (t->tx_buf && premapped)
+		tx_dma = t->tx_dma + offset;
+	else if (t->tx_buf)
+		tx_dma = dma_map_single(&spi->dev, (void *)t->tx_buf + offset,
+				len, DMA_TO_DEVICE);
+	else
+		tx_dma = dma_map_single(&spi->dev, davinci_spi->tmp_buf,
+				conv, DMA_TO_DEVICE);
+	if (dma_mapping_error(&spi->dev, tx_dma)) {
+		dev_dbg(sdev, "Unable to DMA map a %d bytes TX buffer\n", len);
+		return -ENOMEM;
+	}
+
+	if (t->rx_buf) {
+		if (premapped)
+			rx_dma = t->rx_dma + offset;
+		else
+			rx_dma = dma_map_single(&spi->dev, t->rx_buf + offset,
+					len, DMA_FROM_DEVICE);
+		if (dma_mapping_error(&spi->dev, rx_dma)) {
+			dev_dbg(sdev, "Couldn't DMA map a %d bytes RX buffer\n",
+					len);
+			if (!premapped || !t->tx_buf)
+				dma_unmap_single(&spi->dev, tx_dma,
+						t->tx_buf ? len : conv,
+						DMA_TO_DEVICE);
+			return -ENOMEM;
+		}
+
+		edma_set_transfer_params(davinci_spi_dma->dma_rx_channel,
+				conv, count, 1, 0, ASYNC);
+		edma_set_src(davinci_spi_dma->dma_rx_channel,
+				rx_reg, INCR, W8BIT);
+		edma_set_dest(davinci_spi_dma->dma_rx_channel,
+				rx_dma, INCR, W8BIT);
+		edma_set_src_index(davinci_spi_dma->dma_rx_channel, 0, 0);
+		edma_set_dest_index(davinci_spi_dma->dma_rx_channel, conv, 0);
+	}
+
+	edma_set_transfer_params(davinci_spi_dma->dma_tx_channel,
+			conv, count, 1, 0, ASYNC);
+	edma_set_dest(davinci_spi_dma->dma_tx_channel, tx_reg, INCR, W8BIT);
+	edma_set_src(davinci_spi_dma->dma_tx_channel, tx_dma, INCR, W8BIT);
+	edma_set_src_index(davinci_spi_dma->dma_tx_channel,
+			t->tx_buf ? conv : 0, 0);
+	edma_set_dest_index(davinci_spi_dma->dma_tx_channel, 0, 0);
+
+	if (t->rx_buf)
+		edma_start(davinci_spi_dma->dma_rx_channel);
+	edma_start(davinci_spi_dma->dma_tx_channel);
+	davinci_spi_set_dma_req(spi, 1);
+
+	wait_for_completion_interruptible(&davinci_spi_dma->dma_tx_completion);
+	if (t->rx_buf)
+		wait_for_completion_interruptible(
+				&davinci_spi_dma->dma_rx_completion);
+
+	if (!t->tx_buf)
+		dma_unmap_single(&spi->dev, tx_dma, conv, DMA_TO_DEVICE);
+	else if (!premapped)
+		dma_unmap_single(&spi->dev, tx_dma, len, DMA_TO_DEVICE);
+	if (t->rx_buf && !premapped)
+		dma_unmap_single(&spi->dev, rx_dma, len, DMA_FROM_DEVICE);
+
+	return 0;
+}
+
+/*
+ * DMA transfer of caller buffers, without bouncing.  Buffers outside
+ * lowmem, and transfers too short to be worth it, go by PIO.  An RX
+ * buffer is only DMA'd in whole cache lines: a partial line at either
+ * end is moved by PIO around the DMA'd middle.  Buffers the caller
+ * already mapped are DMA'd whole.
+ */
 static int davinci_spi_bufs_dma(struct spi_device *spi, struct spi_transfer *t)
 {
 	struct davinci_spi *davinci_spi;
 	int int_status = 0;
-	int count, temp_count;
-	u8 conv = 1;
+	u8 conv;
 	u8 tmp;
 	u32 data1_reg_val;
-	struct davinci_spi_dma *davinci_spi_dma;
-	int word_len, data_type, ret = 0;
-	unsigned long tx_reg, rx_reg;
+	int ret = 0;
+	unsigned head = 0, tail = 0, mid;
+	bool premapped = t->tx_dma || t->rx_dma;
 	struct davinci_spi_platform_data *pdata;
-	struct device *sdev;
 
 	davinci_spi = spi_master_get_devdata(spi->master);
 	pdata = davinci_spi->pdata;
-	sdev = davinci_spi->bitbang.master->dev.parent;
-
-	davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
-
-	tx_reg = (unsigned long)davinci_spi->pbase + SPIDAT1;
-	rx_reg = (unsigned long)davinci_spi->pbase + SPIBUF;
-
-	davinci_spi->tx = t->tx_buf;
-	davinci_spi->rx = t->rx_buf;
 
 	/* convert len to words based on bits_per_word */
 	conv = davinci_spi->slave[spi->chip_select].bytes_per_word;
-	davinci_spi->count = t->len / conv;
 
-	init_completion(&davinci_spi_dma->dma_rx_completion);
-	init_completion(&davinci_spi_dma->dma_tx_completion);
+	if (!premapped) {
+		unsigned long start = (unsigned long)t->rx_buf;
+		unsigned long end = start + t->len;
 
-	word_len = conv * 8;
+		if (!davinci_spi_dma_safe(t->tx_buf, t->len, false) ||
+		    !davinci_spi_dma_safe(t->rx_buf, t->len, false) ||
+		    (start & (conv - 1)))
+			return davinci_spi_bufs_pio(spi, t);
 
-	if (word_len <= 8)
-		data_type = DAVINCI_DMA_DATA_TYPE_S8;
-	else if (word_len <= 16)
-		data_type = DAVINCI_DMA_DATA_TYPE_S16;
-	else if (word_len <= 32)
-		data_type = DAVINCI_DMA_DATA_TYPE_S32;
-	else
-		return -EINVAL;
+		if (t->rx_buf) {
+			head = ALIGN(start, L1_CACHE_BYTES) - start;
+			tail = end & (L1_CACHE_BYTES - 1);
+		}
+		if (head + tail + DAVINCI_SPI_DMA_MIN > t->len)
+			return davinci_spi_bufs_pio(spi, t);
+	}
+	mid = t->len - head - tail;
+
+	davinci_spi->tx = t->tx_buf;
+	davinci_spi->rx = t->rx_buf;
+	davinci_spi->count = t->len / conv;
 
 	ret = davinci_spi_bufs_prep(spi, davinci_spi);
 	if (ret)
@@ -741,7 +870,6 @@ static int davinci_spi_bufs_dma(struct spi_device *spi, struct spi_transfer *t)
 			(pdata->t2cdelay << SPI_T2CDELAY_SHIFT),
 			davinci_spi->base + SPIDELAY);
 
-	count = davinci_spi->count;	/* the number of elements */
 	data1_reg_val = pdata->cs_hold << SPIDAT1_CSHOLD_SHIFT;
 
 	/* CS default = 0xFF */
@@ -763,103 +891,465 @@ static int davinci_spi_bufs_dma(struct spi_device *spi, struct spi_transfer *t)
 				& SPIBUF_RXEMPTY_MASK) == 0)
 		cpu_relax();
 
+	if (head)
+		davinci_spi_pio_words(davinci_spi, data1_reg_val, t->tx_buf,
+				t->rx_buf, head / conv, conv);
 
-	if (t->tx_buf) {
-		t->tx_dma = dma_map_single(&spi->dev, (void *)t->tx_buf, count,
-				DMA_TO_DEVICE);
-		if (dma_mapping_error(&spi->dev, t->tx_dma)) {
-			dev_dbg(sdev, "Unable to DMA map a %d bytes"
-				" TX buffer\n", count);
-			ret = -ENOMEM;
-			goto out;
+	ret = davinci_spi_dma_words(davinci_spi, spi, t, head, mid, conv,
+			premapped);
+	if (ret)
+		goto out;
+
+	if (tail)
+		davinci_spi_pio_words(davinci_spi, data1_reg_val,
+				t->tx_buf ? t->tx_buf + head + mid : NULL,
+				t->rx_buf + head + mid, tail / conv, conv);
+
+	/*
+	 * Check for bit error, desync error,parity error,timeout error and
+	 * receive overflow errors
+	 */
+	int_status = ioread32(davinci_spi->base + SPIFLG);
+
+	ret = davinci_spi_check_error(davinci_spi, int_status);
+	if (ret != 0)
+		goto out;
+
+	/* SPI Framework maintains the count only in bytes so convert back */
+	davinci_spi->count *= conv;
+out:
+	davinci_spi->in_use = false;
+	complete(&davinci_spi->done);
+
+	return (ret != 0) ? ret : t->len;
+}
+
+/*
+ * Whether a message can run as one EDMA chain: a single word size and
+ * clock for all of it, chipselect held from its first word to its last,
+ * and no delays between transfers.
+ */
+static bool davinci_spi_can_chain(struct davinci_spi *davinci_spi,
+				  struct spi_device *spi, struct spi_message *m)
+{
+	struct davinci_spi_dma *davinci_spi_dma;
+	struct spi_transfer *t, *first;
+	unsigned bits, conv, n = 0;
+
+	if (!use_dma || !davinci_spi->chain.nslots ||
+	    list_empty(&m->transfers))
+		return false;
+
+	davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
+	if (davinci_spi_dma->dma_rx_channel == -1 ||
+	    davinci_spi_dma->dma_tx_channel == -1)
+		return false;
+
+	first = list_first_entry(&m->transfers, struct spi_transfer,
+				 transfer_list);
+	bits = first->bits_per_word ? : spi->bits_per_word;
+	conv = bits > 8 ? 2 : 1;
+
+	list_for_each_entry(t, &m->transfers, transfer_list) {
+		if (t->bits_per_word != first->bits_per_word ||
+		    t->speed_hz != first->speed_hz)
+			return false;
+		if (t->delay_usecs || t->cs_change)
+			return false;
+		if (!t->len || (!t->tx_buf && !t->rx_buf))
+			return false;
+		if (t->len % conv || t->len / conv > 0xffff)
+			return false;
+		if (!m->is_dma_mapped &&
+		    (!davinci_spi_dma_safe(t->tx_buf, t->len, false) ||
+		     !davinci_spi_dma_safe(t->rx_buf, t->len, true)))
+			return false;
+		if (++n > davinci_spi->chain.nslots)
+			return false;
+	}
+	return true;
+}
+
+/* Unmap the buffers of a chained message, up to transfer @stop */
+static void davinci_spi_chain_unmap(struct spi_device *spi,
+				    struct spi_message *m,
+				    struct spi_transfer *stop)
+{
+	struct spi_transfer *t;
+
+	if (m->is_dma_mapped)
+		return;
+
+	list_for_each_entry(t, &m->transfers, transfer_list) {
+		if (t == stop)
+			break;
+		if (t->tx_buf)
+			dma_unmap_single(&spi->dev, t->tx_dma, t->len,
+					 DMA_TO_DEVICE);
+		if (t->rx_buf)
+			dma_unmap_single(&spi->dev, t->rx_dma, t->len,
+					 DMA_FROM_DEVICE);
+	}
+}
+
+static int davinci_spi_chain_map(struct spi_device *spi,
+				 struct spi_message *m)
+{
+	struct spi_transfer *t;
+
+	if (m->is_dma_mapped)
+		return 0;
+
+	list_for_each_entry(t, &m->transfers, transfer_list) {
+		if (t->tx_buf) {
+			t->tx_dma = dma_map_single(&spi->dev,
+					(void *)t->tx_buf, t->len,
+					DMA_TO_DEVICE);
+			if (dma_mapping_error(&spi->dev, t->tx_dma))
+				goto err;
 		}
-		temp_count = count;
-	} else {
-		/* We need TX clocking for RX transaction */
-		t->tx_dma = dma_map_single(&spi->dev,
-				(void *)davinci_spi->tmp_buf, count + 1,
-				DMA_TO_DEVICE);
-		if (dma_mapping_error(&spi->dev, t->tx_dma)) {
-			dev_dbg(sdev, "Unable to DMA map a %d bytes"
-				" TX tmp buffer\n", count);
-			ret = -ENOMEM;
-			goto out;
+		if (t->rx_buf) {
+			t->rx_dma = dma_map_single(&spi->dev, t->rx_buf,
+					t->len, DMA_FROM_DEVICE);
+			if (dma_mapping_error(&spi->dev, t->rx_dma)) {
+				if (t->tx_buf)
+					dma_unmap_single(&spi->dev, t->tx_dma,
+							 t->len, DMA_TO_DEVICE);
+				goto err;
+			}
 		}
-		temp_count = count + 1;
 	}
+	return 0;
 
-	edma_set_transfer_params(davinci_spi_dma->dma_tx_channel,
-					data_type, temp_count, 1, 0, ASYNC);
-	edma_set_dest(davinci_spi_dma->dma_tx_channel, tx_reg, INCR, W8BIT);
-	edma_set_src(davinci_spi_dma->dma_tx_channel, t->tx_dma, INCR, W8BIT);
-	edma_set_src_index(davinci_spi_dma->dma_tx_channel, data_type, 0);
-	edma_set_dest_index(davinci_spi_dma->dma_tx_channel, 0, 0);
+err:
+	davinci_spi_chain_unmap(spi, m, t);
+	return -ENOMEM;
+}
 
-	if (t->rx_buf) {
-		/* initiate transaction */
-		iowrite32(data1_reg_val, davinci_spi->base + SPIDAT1);
+/* One A-synchronized set: an array of @acnt bytes per SPI DMA event */
+static void davinci_spi_chain_set(struct edmacc_param *p, int channel,
+				  dma_addr_t src, dma_addr_t dst, u16 acnt,
+				  u16 bcnt, u16 src_bidx, u16 dst_bidx)
+{
+	p->opt = EDMA_TCC(EDMA_CHAN_SLOT(channel));
+	p->src = src;
+	p->dst = dst;
+	p->a_b_cnt = bcnt << 16 | acnt;
+	p->src_dst_bidx = dst_bidx << 16 | src_bidx;
+	p->link_bcntrld = 0xffff;
+	p->src_dst_cidx = 0;
+	p->ccnt = 1;
+}
 
-		t->rx_dma = dma_map_single(&spi->dev, (void *)t->rx_buf, count,
-				DMA_FROM_DEVICE);
-		if (dma_mapping_error(&spi->dev, t->rx_dma)) {
-			dev_dbg(sdev, "Couldn't DMA map a %d bytes RX buffer\n",
-					count);
-			if (t->tx_buf != NULL)
-				dma_unmap_single(NULL, t->tx_dma,
-						 count, DMA_TO_DEVICE);
-			ret = -ENOMEM;
-			goto out;
-		}
-		edma_set_transfer_params(davinci_spi_dma->dma_rx_channel,
-				data_type, count, 1, 0, ASYNC);
-		edma_set_src(davinci_spi_dma->dma_rx_channel,
-				rx_reg, INCR, W8BIT);
-		edma_set_dest(davinci_spi_dma->dma_rx_channel,
-				t->rx_dma, INCR, W8BIT);
-		edma_set_src_index(davinci_spi_dma->dma_rx_channel, 0, 0);
-		edma_set_dest_index(davinci_spi_dma->dma_rx_channel,
-				data_type, 0);
+/*
+ * Start a message as one EDMA chain: a PaRAM set per transfer in each
+ * direction, linked.  CSHOLD keeps chipselect active between words and
+ * transfers; the message's last word is written to SPIDAT1 as a whole,
+ * with CSHOLD cleared, so the controller drops chipselect by itself.
+ * Only the last RX set interrupts, ending the message.
+ */
+static int davinci_spi_chain_start(struct davinci_spi *davinci_spi,
+				   struct spi_device *spi,
+				   struct spi_message *m)
+{
+	struct davinci_spi_dma *davinci_spi_dma;
+	struct davinci_spi_chain *chain = &davinci_spi->chain;
+	struct davinci_spi_platform_data *pdata = davinci_spi->pdata;
+	dma_addr_t tx_reg = davinci_spi->pbase + SPIDAT1;
+	dma_addr_t rx_reg = davinci_spi->pbase + SPIBUF;
+	dma_addr_t scratch = chain->scratch_dma;
+	struct spi_transfer *t, *last;
+	struct edmacc_param param;
+	int rx_slot = 0, tx_slot = 0, nrx = 0, ntx = 0, slot, ret;
+	u32 data1_reg_val, last_word = 0;
+	unsigned conv, words;
+	u8 tmp;
+
+	davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
+	last = list_entry(m->transfers.prev, struct spi_transfer,
+			  transfer_list);
+
+	/* every transfer in the message uses the same settings */
+	ret = davinci_spi_setup_transfer(spi, last);
+	if (ret)
+		return ret;
+	conv = davinci_spi->slave[spi->chip_select].bytes_per_word;
+
+	ret = davinci_spi_chain_map(spi, m);
+	if (ret)
+		return ret;
+
+	davinci_spi_bufs_prep(spi, davinci_spi);
+
+	iowrite32(0 | (pdata->c2tdelay << SPI_C2TDELAY_SHIFT) |
+			(pdata->t2cdelay << SPI_T2CDELAY_SHIFT),
+			davinci_spi->base + SPIDELAY);
+
+	tmp = ~(0x1 << spi->chip_select);
+	clear_io_bits(davinci_spi->base + SPIDEF, ~tmp);
+	data1_reg_val = (1 << SPIDAT1_CSHOLD_SHIFT)
+			| (tmp << SPIDAT1_CSNR_SHIFT);
+
+	if (last->tx_buf)
+		last_word = conv == 2 ?
+			((const u16 *)last->tx_buf)[last->len / 2 - 1] :
+			((const u8 *)last->tx_buf)[last->len - 1];
+	chain->scratch[DAVINCI_SPI_TX_ZERO] = 0;
+	chain->scratch[DAVINCI_SPI_TX_LAST] = last_word
+			| (data1_reg_val & ~(1 << SPIDAT1_CSHOLD_SHIFT));
+
+	list_for_each_entry(t, &m->transfers, transfer_list) {
+		words = t->len / conv;
+
+		davinci_spi_chain_set(&param, davinci_spi_dma->dma_rx_channel,
+				rx_reg, t->rx_buf ? t->rx_dma :
+				scratch + 4 * DAVINCI_SPI_RX_SINK,
+				conv, words, 0, t->rx_buf ? conv : 0);
+		if (t == last)
+			param.opt |= TCINTEN;
+		slot = nrx ? chain->rx_slot[nrx - 1] :
+			davinci_spi_dma->dma_rx_channel;
+		edma_write_slot(slot, &param);
+		if (nrx)
+			edma_link(rx_slot, slot);
+		rx_slot = slot;
+		nrx++;
+
+		/* the message's last word goes out on its own, below */
+		if (t == last)
+			words--;
+		if (!words)
+			continue;
+
+		davinci_spi_chain_set(&param, davinci_spi_dma->dma_tx_channel,
+				t->tx_buf ? t->tx_dma :
+				scratch + 4 * DAVINCI_SPI_TX_ZERO,
+				tx_reg, conv, words, t->tx_buf ? conv : 0, 0);
+		slot = ntx ? chain->tx_slot[ntx - 1] :
+			davinci_spi_dma->dma_tx_channel;
+		edma_write_slot(slot, &param);
+		if (ntx)
+			edma_link(tx_slot, slot);
+		tx_slot = slot;
+		ntx++;
 	}
 
-	if ((t->tx_buf) || (t->rx_buf))
-		edma_start(davinci_spi_dma->dma_tx_channel);
+	davinci_spi_chain_set(&param, davinci_spi_dma->dma_tx_channel,
+			scratch + 4 * DAVINCI_SPI_TX_LAST, tx_reg, 4, 1, 0, 0);
+	slot = ntx ? chain->tx_slot[ntx - 1] : davinci_spi_dma->dma_tx_channel;
+	edma_write_slot(slot, &param);
+	if (ntx)
+		edma_link(tx_slot, slot);
 
-	if (t->rx_buf)
-		edma_start(davinci_spi_dma->dma_rx_channel);
+	INIT_COMPLETION(davinci_spi->done);
+	davinci_spi->in_use = true;
+	davinci_spi->chain_msg = m;
 
-	if ((t->rx_buf) || (t->tx_buf))
-		davinci_spi_set_dma_req(spi, 1);
+	/* disable all interrupts for dma transfers */
+	clear_io_bits(davinci_spi->base + SPIINT, SPIINT_MASKALL);
+	/* Disable SPI to write configuration bits in SPIDAT */
+	clear_io_bits(davinci_spi->base + SPIGCR1, SPIGCR1_SPIENA_MASK);
+	iowrite32(data1_reg_val, davinci_spi->base + SPIDAT1);
+	/* Enable SPI */
+	set_io_bits(davinci_spi->base + SPIGCR1, SPIGCR1_SPIENA_MASK);
 
-	if (t->tx_buf)
-		wait_for_completion_interruptible(
-				&davinci_spi_dma->dma_tx_completion);
+	while ((ioread32(davinci_spi->base + SPIBUF)
+				& SPIBUF_RXEMPTY_MASK) == 0)
+		cpu_relax();
 
-	if (t->rx_buf)
-		wait_for_completion_interruptible(
-				&davinci_spi_dma->dma_rx_completion);
+	edma_start(davinci_spi_dma->dma_rx_channel);
+	edma_start(davinci_spi_dma->dma_tx_channel);
+	davinci_spi_set_dma_req(spi, 1);
 
-	dma_unmap_single(NULL, t->tx_dma, temp_count, DMA_TO_DEVICE);
+	return 0;
+}
 
-	if (t->rx_buf)
-		dma_unmap_single(NULL, t->rx_dma, count, DMA_FROM_DEVICE);
+/* Finish the chained message, from the EDMA callback */
+static void davinci_spi_chain_done(struct davinci_spi *davinci_spi,
+				   u16 ch_status)
+{
+	struct spi_message *m = davinci_spi->chain_msg;
+	struct spi_device *spi = m->spi;
+	struct davinci_spi_dma *davinci_spi_dma;
+	struct spi_transfer *t;
+	int status;
 
-	/*
-	 * Check for bit error, desync error,parity error,timeout error and
-	 * receive overflow errors
-	 */
-	int_status = ioread32(davinci_spi->base + SPIFLG);
+	davinci_spi_dma = &davinci_spi->dma_channels[spi->chip_select];
 
-	ret = davinci_spi_check_error(davinci_spi, int_status);
-	if (ret != 0)
-		goto out;
+	davinci_spi_set_dma_req(spi, 0);
+	edma_stop(davinci_spi_dma->dma_tx_channel);
+	edma_stop(davinci_spi_dma->dma_rx_channel);
 
-	/* SPI Framework maintains the count only in bytes so convert back */
-	davinci_spi->count *= conv;
-out:
+	if (ch_status != DMA_COMPLETE) {
+		edma_clean_channel(davinci_spi_dma->dma_tx_channel);
+		edma_clean_channel(davinci_spi_dma->dma_rx_channel);
+		status = -EIO;
+	} else
+		status = davinci_spi_check_error(davinci_spi,
+				ioread32(davinci_spi->base + SPIFLG));
+
+	/* the last word didn't go out, so CSHOLD still holds chipselect */
+	if (status)
+		davinci_spi_cs_deassert(spi);
+
+	davinci_spi_chain_unmap(spi, m, NULL);
+
+	if (!status)
+		list_for_each_entry(t, &m->transfers, transfer_list)
+			m->actual_length += t->len;
+	m->status = status;
+
+	davinci_spi->chain_msg = NULL;
 	davinci_spi->in_use = false;
 	complete(&davinci_spi->done);
 
-	return (ret != 0) ? ret : t->len;
+	m->complete(m->context);
+
+	/* on to the next message */
+	queue_work(davinci_spi->workqueue, &davinci_spi->work);
+}
+
+/*
+ * Run a message transfer by transfer, waiting for each; for messages
+ * that can't be chained.
+ */
+static void davinci_spi_run_message(struct davinci_spi *davinci_spi,
+				    struct spi_message *m)
+{
+	struct spi_device *spi = m->spi;
+	struct spi_transfer *t;
+	unsigned cs_change = 1;
+	int status = 0;
+
+	list_for_each_entry(t, &m->transfers, transfer_list) {
+		status = davinci_spi_setup_transfer(spi, t);
+		if (status < 0)
+			break;
+
+		cs_change = t->cs_change;
+
+		if (!t->tx_buf && !t->rx_buf && t->len) {
+			status = -EINVAL;
+			break;
+		}
+
+		if (t->len) {
+			if (!m->is_dma_mapped)
+				t->rx_dma = t->tx_dma = 0;
+			if (use_dma)
+				status = davinci_spi_bufs_dma(spi, t);
+			else
+				status = davinci_spi_bufs_pio(spi, t);
+		}
+		if (status > 0)
+			m->actual_length += status;
+		if (status != t->len) {
+			if (status >= 0)
+				status = -EREMOTEIO;
+			break;
+		}
+		status = 0;
+
+		if (t->delay_usecs)
+			udelay(t->delay_usecs);
+
+		if (!cs_change)
+			continue;
+		if (t->transfer_list.next == &m->transfers)
+			break;
+
+		davinci_spi_cs_deassert(spi);
+	}
+
+	m->status = status;
+	m->complete(m->context);
+
+	/* leave chipselect active only if the last transfer asked for it */
+	if (!(status == 0 && cs_change))
+		davinci_spi_cs_deassert(spi);
+}
+
+/* Message pump: one chained message in flight, or one at a time by PIO */
+static void davinci_spi_work(struct work_struct *work)
+{
+	struct davinci_spi *davinci_spi =
+		container_of(work, struct davinci_spi, work);
+	struct spi_message *m;
+	unsigned long flags;
+
+	spin_lock_irqsave(&davinci_spi->lock, flags);
+	while (!list_empty(&davinci_spi->queue) && !davinci_spi->chain_msg) {
+		m = container_of(davinci_spi->queue.next,
+				 struct spi_message, queue);
+		list_del_init(&m->queue);
+		spin_unlock_irqrestore(&davinci_spi->lock, flags);
+
+		if (!davinci_spi_can_chain(davinci_spi, m->spi, m) ||
+		    davinci_spi_chain_start(davinci_spi, m->spi, m) < 0)
+			davinci_spi_run_message(davinci_spi, m);
+
+		spin_lock_irqsave(&davinci_spi->lock, flags);
+	}
+	spin_unlock_irqrestore(&davinci_spi->lock, flags);
+}
+
+static int davinci_spi_transfer(struct spi_device *spi, struct spi_message *m)
+{
+	struct davinci_spi *davinci_spi = spi_master_get_devdata(spi->master);
+	unsigned long flags;
+
+	m->actual_length = 0;
+	m->status = -EINPROGRESS;
+
+	spin_lock_irqsave(&davinci_spi->lock, flags);
+	list_add_tail(&m->queue, &davinci_spi->queue);
+	queue_work(davinci_spi->workqueue, &davinci_spi->work);
+	spin_unlock_irqrestore(&davinci_spi->lock, flags);
+
+	return 0;
+}
+
+static void davinci_spi_chain_free(struct device *dev,
+				   struct davinci_spi_chain *chain)
+{
+	int i;
+
+	for (i = 0; i < chain->nslots; i++) {
+		edma_free_slot(chain->tx_slot[i]);
+		edma_free_slot(chain->rx_slot[i]);
+	}
+	chain->nslots = 0;
+
+	if (chain->scratch)
+		davinci_dma_pool_free(DAVINCI_SPI_SCRATCH, chain->scratch,
+				      chain->scratch_dma);
+	chain->scratch = NULL;
+}
+
+/* Get what message chaining needs; without it, messages run unchained */
+static void davinci_spi_chain_alloc(struct device *dev,
+				    struct davinci_spi_chain *chain,
+				    unsigned ctlr)
+{
+	int i;
+
+	/* a few words; share a pool page instead of taking a whole one */
+	chain->scratch = davinci_dma_pool_alloc(DAVINCI_SPI_SCRATCH, GFP_KERNEL,
+						&chain->scratch_dma);
+	if (!chain->scratch)
+		return;
+
+	for (i = 0; i < DAVINCI_SPI_MAX_CHAIN; i++) {
+		chain->tx_slot[i] = edma_alloc_slot(ctlr, EDMA_SLOT_ANY);
+		if (chain->tx_slot[i] < 0)
+			break;
+		chain->rx_slot[i] = edma_alloc_slot(ctlr, EDMA_SLOT_ANY);
+		if (chain->rx_slot[i] < 0) {
+			edma_free_slot(chain->tx_slot[i]);
+			break;
+		}
+	}
+	chain->nslots = i;
 }
 
 #ifdef CONFIG_CPU_FREQ
@@ -872,11 +1362,20 @@ static int davinci_spi_cpufreq_transition(struct notifier_block *nb,
 	davinci_spi = container_of(nb, struct davinci_spi, freq_transition);
 	pdata = davinci_spi->pdata;
 
+	/*
+	 * A clock that kept its rate across a transition isn't one cpufreq
+	 * scales (on DA850, SPI1 can run off PLL1), so later transitions
+	 * needn't hold things up waiting for the current transfer.
+	 */
 	if (val == CPUFREQ_PRECHANGE) {
-		if (davinci_spi->in_use)
+		davinci_spi->clk_rate = clk_get_rate(davinci_spi->clk);
+		if (davinci_spi->in_use && davinci_spi->clk_scales)
 			wait_for_completion(&davinci_spi->done);
 	} else if (val == CPUFREQ_POSTCHANGE) {
-		davinci_spi_calc_clk_div(davinci_spi);
+		davinci_spi->clk_scales = davinci_spi->clk_rate !=
+					clk_get_rate(davinci_spi->clk);
+		if (davinci_spi->clk_scales)
+			davinci_spi_calc_clk_div(davinci_spi);
 	}
 	return 0;
 }
@@ -884,6 +1383,7 @@ static int davinci_spi_cpufreq_transition(struct notifier_block *nb,
 static inline int davinci_spi_cpufreq_register(struct davinci_spi *spi)
 {
 	spi->freq_transition.notifier_call = davinci_spi_cpufreq_transition;
+	spi->clk_scales = true;
 
 	return cpufreq_register_notifier(&spi->freq_transition,
 					 CPUFREQ_TRANSITION_NOTIFIER);
@@ -958,6 +1458,10 @@ static int davinci_spi_probe(struct platform_device *pdev)
 		goto err;
 	}
 
+	/* a controller clocked by an external master is not a bus */
+	if (pdata->slave)
+		return davinci_spi_slave_probe(pdev);
+
 	master = spi_alloc_master(&pdev->dev, sizeof(struct davinci_spi));
 	if (master == NULL) {
 		ret = -ENOMEM;
@@ -1014,8 +1518,8 @@ static int davinci_spi_probe(struct platform_device *pdev)
 		goto irq_free;
 	}
 
-	davinci_spi->bitbang.master = spi_master_get(master);
-	if (davinci_spi->bitbang.master == NULL) {
+	davinci_spi->master = spi_master_get(master);
+	if (davinci_spi->master == NULL) {
 		ret = -ENODEV;
 		goto free_tmp_buf;
 	}
@@ -1032,16 +1536,15 @@ static int davinci_spi_probe(struct platform_device *pdev)
 	master->num_chipselect = pdata->num_chipselect;
 	master->setup = davinci_spi_setup;
 	master->cleanup = davinci_spi_cleanup;
-
-	davinci_spi->bitbang.chipselect = davinci_spi_chipselect;
-	davinci_spi->bitbang.setup_transfer = davinci_spi_setup_transfer;
+	master->transfer = davinci_spi_transfer;
 
 	davinci_spi->version = pdata->version;
 	use_dma = pdata->use_dma;
 
-	davinci_spi->bitbang.flags = SPI_NO_CS | SPI_LSB_FIRST | SPI_LOOP;
+	master->mode_bits = SPI_CPOL | SPI_CPHA | SPI_NO_CS | SPI_LSB_FIRST
+		| SPI_LOOP;
 	if (davinci_spi->version == SPI_VERSION_2)
-		davinci_spi->bitbang.flags |= SPI_READY;
+		master->mode_bits |= SPI_READY;
 
 	if (use_dma) {
 			r = platform_get_resource(pdev, IORESOURCE_DMA, 0);
@@ -1059,10 +1562,8 @@ static int davinci_spi_probe(struct platform_device *pdev)
 	    dma_rx_chan == SPI_NO_RESOURCE ||
 	    dma_tx_chan == SPI_NO_RESOURCE ||
 	    dma_eventq	== SPI_NO_RESOURCE) {
-		davinci_spi->bitbang.txrx_bufs = davinci_spi_bufs_pio;
 		use_dma = 0;
 	} else {
-		davinci_spi->bitbang.txrx_bufs = davinci_spi_bufs_dma;
 		davinci_spi->dma_channels = kzalloc(master->num_chipselect
 				* sizeof(struct davinci_spi_dma), GFP_KERNEL);
 		if (davinci_spi->dma_channels == NULL) {
@@ -1079,6 +1580,9 @@ static int davinci_spi_probe(struct platform_device *pdev)
 				dma_tx_chan;
 			davinci_spi->dma_channels[i].eventq = dma_eventq;
 		}
+
+		davinci_spi_chain_alloc(&pdev->dev, &davinci_spi->chain,
+				EDMA_CTLR(dma_tx_chan));
 		dev_info(&pdev->dev, "DaVinci SPI driver in EDMA mode\n"
 				"Using RX channel = %d , TX channel = %d and "
 				"event queue = %d", dma_rx_chan, dma_tx_chan,
@@ -1089,11 +1593,22 @@ static int davinci_spi_probe(struct platform_device *pdev)
 	davinci_spi->get_tx = davinci_spi_tx_buf_u8;
 
 	init_completion(&davinci_spi->done);
+
+	spin_lock_init(&davinci_spi->lock);
+	INIT_LIST_HEAD(&davinci_spi->queue);
+	INIT_WORK(&davinci_spi->work, davinci_spi_work);
+	davinci_spi->workqueue = create_singlethread_workqueue(
+			dev_name(&pdev->dev));
+	if (davinci_spi->workqueue == NULL) {
+		ret = -EBUSY;
+		goto free_dma;
+	}
+
 	ret = davinci_spi_cpufreq_register(davinci_spi);
 	if (ret) {
 		pr_info("davinci SPI contorller driver failed to register "
 							"cpufreq\n");
-		goto free_dma;
+		goto free_wq;
 	}
 
 	/* Reset In/OUT SPI module */
@@ -1117,7 +1632,7 @@ static int davinci_spi_probe(struct platform_device *pdev)
 	else
 		iowrite32(SPI_INTLVL_0, davinci_spi->base + SPILVL);
 
-	ret = spi_bitbang_start(&davinci_spi->bitbang);
+	ret = spi_register_master(master);
 	if (ret)
 		goto unregister_cpufreq;
 
@@ -1131,7 +1646,10 @@ static int davinci_spi_probe(struct platform_device *pdev)
 
 unregister_cpufreq:
 	davinci_spi_cpufreq_deregister(davinci_spi);
+free_wq:
+	destroy_workqueue(davinci_spi->workqueue);
 free_dma:
+	davinci_spi_chain_free(&pdev->dev, &davinci_spi->chain);
 	kfree(davinci_spi->dma_channels);
 free_clk:
 	clk_disable(davinci_spi->clk);
@@ -1158,20 +1676,26 @@ err:
  *
  * This function will do the reverse action of davinci_spi_probe function
  * It will free the IRQ and SPI controller's memory region.
- * It will also call spi_bitbang_stop to destroy the work queue which was
- * created by spi_bitbang_start.
+ * It will also unregister the master and destroy the work queue which
+ * pumps its messages.
  */
 static int __exit davinci_spi_remove(struct platform_device *pdev)
 {
 	struct davinci_spi *davinci_spi;
 	struct spi_master *master;
+	struct davinci_spi_platform_data *pdata = pdev->dev.platform_data;
+
+	if (pdata->slave)
+		return davinci_spi_slave_remove(pdev);
 
 	master = dev_get_drvdata(&pdev->dev);
 	davinci_spi = spi_master_get_devdata(master);
 
-	spi_bitbang_stop(&davinci_spi->bitbang);
+	spi_unregister_master(master);
+	destroy_workqueue(davinci_spi->workqueue);
 
 	davinci_spi_cpufreq_deregister(davinci_spi);
+	davinci_spi_chain_free(&pdev->dev, &davinci_spi->chain);
 
 	clk_disable(davinci_spi->clk);
 	clk_put(davinci_spi->clk);
@@ -1194,6 +1718,8 @@ static int davinci_spi_suspend(struct platform_device *pdev, pm_message_t pmsg)
 	int ret;
 
 	pdata = pdev->dev.platform_data;
+	if (pdata->slave)
+		return davinci_spi_slave_suspend(pdev);
 	master = dev_get_drvdata(&(pdev)->dev);
 	davinci_spi = spi_master_get_devdata(master);
 
@@ -1222,6 +1748,8 @@ static int davinci_spi_resume(struct platform_device *pdev)
 	struct davinci_spi_platform_data *pdata = NULL;
 
 	pdata = pdev->dev.platform_data;
+	if (pdata->slave)
+		return davinci_spi_slave_resume(pdev);
 	master = dev_get_drvdata(&(pdev)->dev);
 	davinci_spi = spi_master_get_devdata(master);
 
@@ -143,11 +143,40 @@ struct davinci_spi_dma {
 	struct completion	dma_rx_completion;
 };
 
+/* Most transfers in a message sent as one linked EDMA chain */
+#define DAVINCI_SPI_MAX_CHAIN	16
+
+/* Scratch words for chained messages, in coherent memory */
+#define DAVINCI_SPI_TX_ZERO	0	/* clocked out when there's no tx_buf */
+#define DAVINCI_SPI_RX_SINK	4	/* soaks up rx when there's no rx_buf */
+#define DAVINCI_SPI_TX_LAST	8	/* last word, with CSHOLD cleared */
+#define DAVINCI_SPI_SCRATCH	(3 * 16)
+
+/* PaRAM link slots shared by all chipselects; nslots is zero if none */
+struct davinci_spi_chain {
+	int			tx_slot[DAVINCI_SPI_MAX_CHAIN];
+	int			rx_slot[DAVINCI_SPI_MAX_CHAIN];
+	int			nslots;
+
+	u32			*scratch;
+	dma_addr_t		scratch_dma;
+};
+
 /* SPI Controller driver's private data. */
 struct davinci_spi {
-	struct spi_bitbang	bitbang;
+	struct spi_master	*master;
 	struct clk		*clk;
 
+	/* message queue, pumped by work */
+	struct workqueue_struct	*workqueue;
+	struct work_struct	work;
+	spinlock_t		lock;
+	struct list_head	queue;
+
+	/* message in flight as one EDMA chain, ended by the RX callback */
+	struct spi_message	*chain_msg;
+	struct davinci_spi_chain chain;
+
 	u8			version;
 	resource_size_t		pbase;
 	void __iomem		*base;
@@ -173,7 +202,33 @@ struct davinci_spi {
 
 #ifdef CONFIG_CPU_FREQ
 	struct notifier_block	freq_transition;
+	unsigned long		clk_rate;	/* before the transition */
+	bool			clk_scales;	/* with the CPU clock */
 #endif
 };
 
+#ifdef CONFIG_SPI_DAVINCI_SLAVE
+int davinci_spi_slave_probe(struct platform_device *pdev);
+int davinci_spi_slave_remove(struct platform_device *pdev);
+int davinci_spi_slave_suspend(struct platform_device *pdev);
+int davinci_spi_slave_resume(struct platform_device *pdev);
+#else
+static inline int davinci_spi_slave_probe(struct platform_device *pdev)
+{
+	return -ENODEV;
+}
+static inline int davinci_spi_slave_remove(struct platform_device *pdev)
+{
+	return 0;
+}
+static inline int davinci_spi_slave_suspend(struct platform_device *pdev)
+{
+	return 0;
+}
+static inline int davinci_spi_slave_resume(struct platform_device *pdev)
+{
+	return 0;
+}
+#endif
+
 #endif /* __DAVINCI_SPI_H */
@@ -0,0 +1,584 @@
+/*
+ * DaVinci SPI slave receiver
+ *
+ * Runs the SPI controller as a slave for masters, like an FPGA, that push
+ * a continuous stream. Each received word raises an RX DMA event; a ring of
+ * linked PaRAM sets, one per period, lands the words in a coherent buffer
+ * and interrupts once per period, so nothing has to be set up per transfer.
+ * The buffer is handed to user space through a misc device that supports
+ * read(), mmap() and poll().
+ *
+ * In 4-pin mode the master frames the stream with SCS: the controller only
+ * shifts while it is asserted. With SPI_NO_CS the slave is always selected
+ * and word alignment relies on the master never stopping mid-word.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <linux/interrupt.h>
+#include <linux/io.h>
+#include <linux/module.h>
+#include <linux/delay.h>
+#include <linux/platform_device.h>
+#include <linux/err.h>
+#include <linux/clk.h>
+#include <linux/dma-mapping.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/miscdevice.h>
+#include <linux/log2.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/spi/spi.h>
+#include <linux/spi/davinci_spi_slave.h>
+
+#include <mach/spi.h>
+#include <mach/edma.h>
+
+#include "davinci_spi.h"
+
+/* One PaRAM set per period */
+#define DAVINCI_SPIS_MAX_PERIODS	32
+
+/* SPI0 and SPI1 */
+#define DAVINCI_SPIS_MAX_DEVS		2
+
+struct davinci_spis {
+	struct device		*dev;
+	struct davinci_spi_slave_config *cfg;
+	u8			version;
+	u32			intr_level;
+
+	resource_size_t		pbase;
+	size_t			region_size;
+	void __iomem		*base;
+	int			irq;
+	struct clk		*clk;
+
+	int			dma_rx_sync_dev;
+	enum dma_event_q	eventq;
+	int			dma_channel;
+	int			slot[DAVINCI_SPIS_MAX_PERIODS];
+	unsigned		nperiods;
+
+	void			*buf;
+	dma_addr_t		buf_dma;
+	u32			buf_size;
+	u32			period_size;
+
+	/* ring state, updated by the DMA callback */
+	spinlock_t		lock;
+	u32			head;
+	u32			tail;
+	u32			overruns;
+	u32			hw_overruns;
+	bool			xrun;	/* not reported to read() yet */
+	wait_queue_head_t	wait;
+
+	unsigned long		busy;
+	char			name[20];
+	struct miscdevice	misc;
+};
+
+/* misc_open() leaves private_data alone, so open looks devices up here */
+static struct davinci_spis *davinci_spis_devs[DAVINCI_SPIS_MAX_DEVS];
+
+static inline struct davinci_spis *file_to_spis(struct file *file)
+{
+	return file->private_data;
+}
+
+/*
+ * Bytes that may be read without racing the DMA: the period being filled
+ * overlays the oldest one, so the ring holds one period less than its size.
+ */
+static inline u32 davinci_spis_room(struct davinci_spis *spis)
+{
+	return spis->buf_size - spis->period_size;
+}
+
+static void davinci_spis_dma_callback(unsigned lch, u16 ch_status, void *data)
+{
+	struct davinci_spis *spis = data;
+	unsigned long flags;
+
+	if (unlikely(ch_status != DMA_COMPLETE)) {
+		dev_err(spis->dev, "EDMA error on channel %d\n", lch);
+		return;
+	}
+
+	spin_lock_irqsave(&spis->lock, flags);
+	spis->head += spis->period_size;
+	if (spis->head - spis->tail > davinci_spis_room(spis)) {
+		spis->tail = spis->head - davinci_spis_room(spis);
+		spis->overruns++;
+		spis->xrun = true;
+	}
+	spin_unlock_irqrestore(&spis->lock, flags);
+
+	wake_up_interruptible(&spis->wait);
+}
+
+static irqreturn_t davinci_spis_irq(int irq, void *data)
+{
+	struct davinci_spis *spis = data;
+	u32 flg = ioread32(spis->base + SPIFLG);
+
+	if (!(flg & SPIFLG_OVRRUN_MASK))
+		return IRQ_NONE;
+
+	/* write one to clear */
+	iowrite32(SPIFLG_OVRRUN_MASK, spis->base + SPIFLG);
+	spis->hw_overruns++;
+	return IRQ_HANDLED;
+}
+
+/* Controller in slave mode with the configured word format, not enabled */
+static void davinci_spis_hw_init(struct davinci_spis *spis)
+{
+	struct davinci_spi_slave_config *cfg = spis->cfg;
+	u32 pc0, fmt;
+
+	iowrite32(0, spis->base + SPIGCR0);
+	udelay(100);
+	iowrite32(1, spis->base + SPIGCR0);
+
+	/* slave: clock and chipselect come from the master */
+	iowrite32(0, spis->base + SPIGCR1);
+
+	pc0 = SPIPC0_DIFUN_MASK | SPIPC0_DOFUN_MASK | SPIPC0_CLKFUN_MASK;
+	if (!(cfg->mode & SPI_NO_CS))
+		pc0 |= SPIPC0_EN0FUN_MASK;
+	iowrite32(pc0, spis->base + SPIPC0);
+
+	/* SPIFMT_PHASE_MASK is the inverse of SPI_CPHA, as in master mode */
+	fmt = cfg->bits_per_word & SPIFMT_CHARLEN_MASK;
+	if (!(cfg->mode & SPI_CPHA))
+		fmt |= SPIFMT_PHASE_MASK;
+	if (cfg->mode & SPI_CPOL)
+		fmt |= SPIFMT_POLARITY_MASK;
+	if (cfg->mode & SPI_LSB_FIRST)
+		fmt |= SPIFMT_SHIFTDIR_MASK;
+	iowrite32(fmt, spis->base + SPIFMT0);
+
+	iowrite32(spis->intr_level ? SPI_INTLVL_1 : SPI_INTLVL_0,
+			spis->base + SPILVL);
+	iowrite32(0, spis->base + SPIINT);
+	iowrite32(SPIFLG_MASK, spis->base + SPIFLG);
+}
+
+/* Lays the ring out as a loop of linked PaRAM sets and starts receiving */
+static void davinci_spis_start(struct davinci_spis *spis)
+{
+	u16 acnt = spis->cfg->bits_per_word > 8 ? 2 : 1;
+	struct edmacc_param p;
+	unsigned i;
+
+	spin_lock_irq(&spis->lock);
+	spis->head = spis->tail = 0;
+	spis->overruns = spis->hw_overruns = 0;
+	spis->xrun = false;
+	spin_unlock_irq(&spis->lock);
+
+	p.opt = EDMA_TCC(EDMA_CHAN_SLOT(spis->dma_channel)) | TCINTEN;
+	p.src = spis->pbase + SPIBUF;
+	p.a_b_cnt = (spis->period_size / acnt) << 16 | acnt;
+	p.src_dst_bidx = acnt << 16;
+	p.link_bcntrld = 0xffff;
+	p.src_dst_cidx = 0;
+	p.ccnt = 1;
+	for (i = 0; i < spis->nperiods; i++) {
+		p.dst = spis->buf_dma + i * spis->period_size;
+		edma_write_slot(spis->slot[i], &p);
+	}
+	for (i = 0; i < spis->nperiods; i++)
+		edma_link(spis->slot[i], spis->slot[(i + 1) % spis->nperiods]);
+
+	/* the channel runs period 0, then follows the loop from period 1 */
+	edma_read_slot(spis->slot[0], &p);
+	edma_write_slot(spis->dma_channel, &p);
+	edma_start(spis->dma_channel);
+
+	iowrite32(SPIINT_DMA_REQ_EN | SPIINT_OVRRUN_INTR, spis->base + SPIINT);
+	iowrite32(SPIGCR1_SPIENA_MASK, spis->base + SPIGCR1);
+}
+
+static void davinci_spis_stop(struct davinci_spis *spis)
+{
+	iowrite32(0, spis->base + SPIGCR1);
+	iowrite32(0, spis->base + SPIINT);
+	edma_stop(spis->dma_channel);
+	edma_clean_channel(spis->dma_channel);
+	wake_up_interruptible(&spis->wait);
+}
+
+static int davinci_spis_open(struct inode *inode, struct file *file)
+{
+	struct davinci_spis *spis = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(davinci_spis_devs); i++)
+		if (davinci_spis_devs[i] &&
+		    davinci_spis_devs[i]->misc.minor == iminor(inode))
+			spis = davinci_spis_devs[i];
+	if (!spis)
+		return -ENODEV;
+
+	if (test_and_set_bit(0, &spis->busy))
+		return -EBUSY;
+
+	file->private_data = spis;
+	davinci_spis_start(spis);
+	return nonseekable_open(inode, file);
+}
+
+static int davinci_spis_release(struct inode *inode, struct file *file)
+{
+	struct davinci_spis *spis = file_to_spis(file);
+
+	davinci_spis_stop(spis);
+	clear_bit(0, &spis->busy);
+	return 0;
+}
+
+static ssize_t davinci_spis_read(struct file *file, char __user *ubuf,
+				 size_t count, loff_t *ppos)
+{
+	struct davinci_spis *spis = file_to_spis(file);
+	u32 tail, avail, off;
+	size_t n;
+	int ret;
+
+	spin_lock_irq(&spis->lock);
+	while (spis->head == spis->tail && !spis->xrun) {
+		spin_unlock_irq(&spis->lock);
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(spis->wait,
+				spis->head != spis->tail || spis->xrun);
+		if (ret)
+			return ret;
+		spin_lock_irq(&spis->lock);
+	}
+	if (spis->xrun) {
+		spis->xrun = false;
+		spin_unlock_irq(&spis->lock);
+		return -EOVERFLOW;
+	}
+	tail = spis->tail;
+	avail = spis->head - tail;
+	spin_unlock_irq(&spis->lock);
+
+	off = tail & (spis->buf_size - 1);
+	n = min_t(size_t, count, min(avail, spis->buf_size - off));
+	if (copy_to_user(ubuf, spis->buf + off, n))
+		return -EFAULT;
+
+	spin_lock_irq(&spis->lock);
+	/* the DMA may have lapped us while copying */
+	if (spis->tail != tail) {
+		spis->xrun = false;
+		spin_unlock_irq(&spis->lock);
+		return -EOVERFLOW;
+	}
+	spis->tail += n;
+	spin_unlock_irq(&spis->lock);
+
+	return n;
+}
+
+static unsigned int davinci_spis_poll(struct file *file, poll_table *wait)
+{
+	struct davinci_spis *spis = file_to_spis(file);
+	unsigned int mask = 0;
+
+	poll_wait(file, &spis->wait, wait);
+
+	spin_lock_irq(&spis->lock);
+	if (spis->head != spis->tail || spis->xrun)
+		mask |= POLLIN | POLLRDNORM;
+	spin_unlock_irq(&spis->lock);
+
+	return mask;
+}
+
+static long davinci_spis_ioctl(struct file *file, unsigned int cmd,
+			       unsigned long arg)
+{
+	struct davinci_spis *spis = file_to_spis(file);
+	struct spis_status st;
+	int ret = 0;
+
+	switch (cmd) {
+	case SPIS_IOC_STATUS:
+		spin_lock_irq(&spis->lock);
+		st.buf_size = spis->buf_size;
+		st.period_size = spis->period_size;
+		st.head = spis->head;
+		st.tail = spis->tail;
+		st.overruns = spis->overruns;
+		st.hw_overruns = spis->hw_overruns;
+		spis->xrun = false;
+		spin_unlock_irq(&spis->lock);
+		if (copy_to_user((void __user *)arg, &st, sizeof(st)))
+			return -EFAULT;
+		break;
+	case SPIS_IOC_CONSUME:
+		spin_lock_irq(&spis->lock);
+		if (arg > spis->head - spis->tail)
+			ret = -EINVAL;
+		else
+			spis->tail += arg;
+		spin_unlock_irq(&spis->lock);
+		break;
+	default:
+		ret = -ENOTTY;
+	}
+
+	return ret;
+}
+
+/* The ring is mapped read-only; it belongs to the DMA */
+static int davinci_spis_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct davinci_spis *spis = file_to_spis(file);
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start > PAGE_ALIGN(spis->buf_size))
+		return -EINVAL;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	return dma_mmap_coherent(spis->dev, vma, spis->buf, spis->buf_dma,
+				 vma->vm_end - vma->vm_start);
+}
+
+static const struct file_operations davinci_spis_fops = {
+	.owner		= THIS_MODULE,
+	.llseek		= no_llseek,
+	.read		= davinci_spis_read,
+	.poll		= davinci_spis_poll,
+	.unlocked_ioctl	= davinci_spis_ioctl,
+	.mmap		= davinci_spis_mmap,
+	.open		= davinci_spis_open,
+	.release	= davinci_spis_release,
+};
+
+static int davinci_spis_check_config(struct davinci_spi_slave_config *cfg)
+{
+	unsigned acnt = cfg->bits_per_word > 8 ? 2 : 1;
+
+	if (cfg->bits_per_word < 2 || cfg->bits_per_word > 16)
+		return -EINVAL;
+	if (!is_power_of_2(cfg->buf_size) || !is_power_of_2(cfg->period_size))
+		return -EINVAL;
+	if (cfg->period_size < PAGE_SIZE || cfg->period_size / acnt > 0xffff)
+		return -EINVAL;
+	if (cfg->buf_size < 2 * cfg->period_size ||
+	    cfg->buf_size / cfg->period_size > DAVINCI_SPIS_MAX_PERIODS)
+		return -EINVAL;
+	return 0;
+}
+
+/**
+ * davinci_spi_slave_probe - set up a controller for slave reception
+ * @pdev: the controller, whose platform data has a slave configuration
+ *
+ * Called by the master driver's probe instead of registering a bus. Takes
+ * the same resources: registers, interrupt, and the RX DMA channel and
+ * event queue.
+ */
+int davinci_spi_slave_probe(struct platform_device *pdev)
+{
+	struct davinci_spi_platform_data *pdata = pdev->dev.platform_data;
+	struct davinci_spis *spis;
+	struct resource *r;
+	unsigned i;
+	int ret;
+
+	if (pdev->id < 0 || pdev->id >= ARRAY_SIZE(davinci_spis_devs))
+		return -EINVAL;
+
+	ret = davinci_spis_check_config(pdata->slave);
+	if (ret) {
+		dev_err(&pdev->dev, "bad slave configuration\n");
+		return ret;
+	}
+
+	spis = kzalloc(sizeof(*spis), GFP_KERNEL);
+	if (!spis)
+		return -ENOMEM;
+
+	spis->dev = &pdev->dev;
+	spis->cfg = pdata->slave;
+	spis->version = pdata->version;
+	spis->intr_level = pdata->intr_level;
+	spis->buf_size = spis->cfg->buf_size;
+	spis->period_size = spis->cfg->period_size;
+	spis->nperiods = spis->buf_size / spis->period_size;
+	spin_lock_init(&spis->lock);
+	init_waitqueue_head(&spis->wait);
+	for (i = 0; i < DAVINCI_SPIS_MAX_PERIODS; i++)
+		spis->slot[i] = -1;
+
+	r = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	if (!r) {
+		ret = -ENOENT;
+		goto free_spis;
+	}
+	spis->pbase = r->start;
+	spis->region_size = resource_size(r);
+	if (!request_mem_region(r->start, spis->region_size, pdev->name)) {
+		ret = -EBUSY;
+		goto free_spis;
+	}
+	spis->base = ioremap(r->start, spis->region_size);
+	if (!spis->base) {
+		ret = -ENOMEM;
+		goto release_region;
+	}
+
+	/* DMA resources: RX channel, TX channel (unused), event queue */
+	r = platform_get_resource(pdev, IORESOURCE_DMA, 0);
+	if (!r) {
+		ret = -ENOENT;
+		goto unmap_io;
+	}
+	spis->dma_rx_sync_dev = r->start;
+	r = platform_get_resource(pdev, IORESOURCE_DMA, 2);
+	spis->eventq = r ? r->start : EVENTQ_DEFAULT;
+
+	spis->clk = clk_get(&pdev->dev, NULL);
+	if (IS_ERR(spis->clk)) {
+		ret = -ENODEV;
+		goto unmap_io;
+	}
+	clk_enable(spis->clk);
+	davinci_spis_hw_init(spis);
+
+	spis->irq = platform_get_irq(pdev, 0);
+	if (spis->irq <= 0) {
+		ret = -EINVAL;
+		goto free_clk;
+	}
+	ret = request_irq(spis->irq, davinci_spis_irq, 0,
+			  dev_name(&pdev->dev), spis);
+	if (ret)
+		goto free_clk;
+
+	spis->buf = dma_alloc_coherent(&pdev->dev, spis->buf_size,
+				       &spis->buf_dma, GFP_KERNEL);
+	if (!spis->buf) {
+		ret = -ENOMEM;
+		goto free_irq;
+	}
+
+	ret = edma_alloc_channel(spis->dma_rx_sync_dev,
+			davinci_spis_dma_callback, spis, spis->eventq);
+	if (ret < 0)
+		goto free_buf;
+	spis->dma_channel = ret;
+
+	for (i = 0; i < spis->nperiods; i++) {
+		ret = edma_alloc_slot(EDMA_CTLR(spis->dma_channel),
+				EDMA_SLOT_ANY);
+		if (ret < 0)
+			goto free_dma;
+		spis->slot[i] = ret;
+	}
+
+	davinci_spis_devs[pdev->id] = spis;
+	snprintf(spis->name, sizeof(spis->name), "spi_slave%d", pdev->id);
+	spis->misc.minor = MISC_DYNAMIC_MINOR;
+	spis->misc.name = spis->name;
+	spis->misc.fops = &davinci_spis_fops;
+	spis->misc.parent = &pdev->dev;
+	ret = misc_register(&spis->misc);
+	if (ret) {
+		davinci_spis_devs[pdev->id] = NULL;
+		goto free_dma;
+	}
+
+	dev_set_drvdata(&pdev->dev, spis);
+	dev_info(&pdev->dev, "slave receiver, %u x %u byte ring\n",
+		 spis->nperiods, spis->period_size);
+	return 0;
+
+free_dma:
+	for (i = 0; i < spis->nperiods; i++)
+		if (spis->slot[i] >= 0)
+			edma_free_slot(spis->slot[i]);
+	edma_free_channel(spis->dma_channel);
+free_buf:
+	dma_free_coherent(&pdev->dev, spis->buf_size, spis->buf,
+			  spis->buf_dma);
+free_irq:
+	free_irq(spis->irq, spis);
+free_clk:
+	clk_disable(spis->clk);
+	clk_put(spis->clk);
+unmap_io:
+	iounmap(spis->base);
+release_region:
+	release_mem_region(spis->pbase, spis->region_size);
+free_spis:
+	kfree(spis);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(davinci_spi_slave_probe);
+
+int davinci_spi_slave_remove(struct platform_device *pdev)
+{
+	struct davinci_spis *spis = dev_get_drvdata(&pdev->dev);
+	unsigned i;
+
+	misc_deregister(&spis->misc);
+	davinci_spis_devs[pdev->id] = NULL;
+
+	for (i = 0; i < spis->nperiods; i++)
+		edma_free_slot(spis->slot[i]);
+	edma_free_channel(spis->dma_channel);
+	dma_free_coherent(&pdev->dev, spis->buf_size, spis->buf,
+			  spis->buf_dma);
+	free_irq(spis->irq, spis);
+	iowrite32(0, spis->base + SPIGCR0);
+	clk_disable(spis->clk);
+	clk_put(spis->clk);
+	iounmap(spis->base);
+	release_mem_region(spis->pbase, spis->region_size);
+	kfree(spis);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(davinci_spi_slave_remove);
+
+/* Reception cannot survive suspend; refuse while the device is open */
+int davinci_spi_slave_suspend(struct platform_device *pdev)
+{
+	struct davinci_spis *spis = dev_get_drvdata(&pdev->dev);
+
+	if (test_bit(0, &spis->busy))
+		return -EBUSY;
+	clk_disable(spis->clk);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(davinci_spi_slave_suspend);
+
+int davinci_spi_slave_resume(struct platform_device *pdev)
+{
+	struct davinci_spis *spis = dev_get_drvdata(&pdev->dev);
+
+	clk_enable(spis->clk);
+	davinci_spis_hw_init(spis);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(davinci_spi_slave_resume);
+
+MODULE_DESCRIPTION("TI DaVinci SPI slave receiver");
+MODULE_LICENSE("GPL");
@@ -65,6 +65,12 @@ static void rzs_clear_flag(struct ramzswap *rzs, u32 index,
 	rzs->table[index].flags &= ~BIT(flag);
 }
 
+static inline u32 size_class(size_t clen)
+{
+	return min_t(size_t, (clen - 1) / (PAGE_SIZE / RZS_SIZE_CLASSES),
+			RZS_SIZE_CLASSES - 1);
+}
+
 static int page_zero_filled(void *ptr)
 {
 	unsigned int pos;
@@ -271,6 +277,22 @@ void ramzswap_ioctl_get_stats(struct ramzswap *rzs,
 #endif /* CONFIG_RAMZSWAP_STATS */
 }
 
+static void ramzswap_ioctl_get_size_stats(struct ramzswap *rzs,
+			struct ramzswap_ioctl_size_stats *s)
+{
+	s->class_size = PAGE_SIZE / RZS_SIZE_CLASSES;
+	s->pool_bytes = xv_get_total_size_bytes(rzs->mem_pool);
+	s->free_bytes = xv_get_free_stats(rzs->mem_pool, s->free_blocks,
+					RZS_SIZE_CLASSES);
+
+#if defined(CONFIG_RAMZSWAP_STATS)
+	mutex_lock(&rzs->lock);
+	memcpy(s->pages_stored, rzs->stats.size_class,
+		sizeof(s->pages_stored));
+	mutex_unlock(&rzs->lock);
+#endif
+}
+
 static int add_backing_swap_extent(struct ramzswap *rzs,
 				pgoff_t phy_pagenum,
 				pgoff_t num_pages)
@@ -619,6 +641,7 @@ static void ramzswap_free_page(struct ramzswap *rzs, size_t index)
 out:
 	rzs->stats.compr_size -= clen;
 	stat_dec(rzs->stats.pages_stored);
+	stat_dec(rzs->stats.size_class[size_class(clen)]);
 
 	rzs->table[index].page = NULL;
 	rzs->table[index].offset = 0;
@@ -902,6 +925,7 @@ memstore:
 	/* Update stats */
 	rzs->stats.compr_size += clen;
 	stat_inc(rzs->stats.pages_stored);
+	stat_inc(rzs->stats.size_class[size_class(clen)]);
 	if (clen <= PAGE_SIZE / 2)
 		stat_inc(rzs->stats.good_compress);
 
@@ -1266,6 +1290,27 @@ static int ramzswap_ioctl(struct block_device *bdev, fmode_t mode,
 		kfree(stats);
 		break;
 	}
+	case RZSIO_GET_SIZE_STATS:
+	{
+		struct ramzswap_ioctl_size_stats *stats;
+		if (!rzs->init_done) {
+			ret = -ENOTTY;
+			goto out;
+		}
+		stats = kzalloc(sizeof(*stats), GFP_KERNEL);
+		if (!stats) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		ramzswap_ioctl_get_size_stats(rzs, stats);
+		if (copy_to_user((void *)arg, stats, sizeof(*stats))) {
+			kfree(stats);
+			ret = -EFAULT;
+			goto out;
+		}
+		kfree(stats);
+		break;
+	}
 	case RZSIO_INIT:
 		ret = ramzswap_ioctl_init_device(rzs);
 		break;
@@ -130,6 +130,7 @@ struct ramzswap_stats {
 	u32 pages_expand;	/* % of incompressible pages */
 	u64 bdev_num_reads;	/* no. of reads on backing dev */
 	u64 bdev_num_writes;	/* no. of writes on backing dev */
+	u32 size_class[RZS_SIZE_CLASSES];	/* pages by compressed size */
 #endif
 };
 
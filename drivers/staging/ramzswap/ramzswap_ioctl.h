@@ -39,11 +39,24 @@ struct ramzswap_ioctl_stats {
 	u64 bdev_num_writes;	/* no. of writes on backing dev */
 } __attribute__ ((packed, aligned(4)));
 
+/* Compressed sizes are grouped in classes of PAGE_SIZE / RZS_SIZE_CLASSES */
+#define RZS_SIZE_CLASSES	16
+
+struct ramzswap_ioctl_size_stats {
+	u32 class_size;		/* bytes covered by each class */
+	u32 pages_stored[RZS_SIZE_CLASSES];	/* by compressed size */
+	u32 free_blocks[RZS_SIZE_CLASSES];	/* xvmalloc free blocks
+						 * by block size */
+	u64 free_bytes;		/* unused space in xvmalloc pages */
+	u64 pool_bytes;		/* total size of xvmalloc pages */
+} __attribute__ ((packed, aligned(4)));
+
 #define RZSIO_SET_DISKSIZE_KB	_IOW('z', 0, size_t)
 #define RZSIO_SET_MEMLIMIT_KB	_IOW('z', 1, size_t)
 #define RZSIO_SET_BACKING_SWAP	_IOW('z', 2, unsigned char[MAX_SWAP_NAME_LEN])
 #define RZSIO_GET_STATS		_IOR('z', 3, struct ramzswap_ioctl_stats)
 #define RZSIO_INIT		_IO('z', 4)
 #define RZSIO_RESET		_IO('z', 5)
+#define RZSIO_GET_SIZE_STATS	_IOR('z', 6, struct ramzswap_ioctl_size_stats)
 
 #endif
@@ -505,3 +505,44 @@ u64 xv_get_total_size_bytes(struct xv_pool *pool)
 {
 	return pool->total_pages << PAGE_SHIFT;
 }
+
+/**
+ * xv_get_free_stats - report how the free space of a pool is split up
+ * @pool: pool to report on
+ * @nr_free: array of @nr_classes counters, incremented for each free block
+ * @nr_classes: number of equally sized classes PAGE_SIZE is divided into
+ *
+ * Free space spread over many small blocks is fragmentation: large objects
+ * cannot use it and the pool has to grow instead. Walks all the freelists
+ * with the pool locked, so this is for statistics only.
+ *
+ * Returns total size of free blocks in the pool.
+ */
+u64 xv_get_free_stats(struct xv_pool *pool, u32 *nr_free, u32 nr_classes)
+{
+	u32 i, offset, size;
+	u64 free_bytes = 0;
+	struct page *page;
+	struct block_header *block;
+
+	spin_lock(&pool->lock);
+	for (i = 0; i < NUM_FREE_LISTS; i++) {
+		page = pool->freelist[i].page;
+		offset = pool->freelist[i].offset;
+
+		while (page) {
+			block = get_ptr_atomic(page, offset, KM_USER0);
+			size = block->size;
+			page = block->link.next_page;
+			offset = block->link.next_offset;
+			put_ptr_atomic(block, KM_USER0);
+
+			free_bytes += size;
+			nr_free[min_t(u32, size * nr_classes / PAGE_SIZE,
+					nr_classes - 1)]++;
+		}
+	}
+	spin_unlock(&pool->lock);
+
+	return free_bytes;
+}
@@ -26,5 +26,6 @@ void xv_free(struct xv_pool *pool, struct page *page, u32 offset);
 
 u32 xv_get_object_size(void *obj);
 u64 xv_get_total_size_bytes(struct xv_pool *pool);
+u64 xv_get_free_stats(struct xv_pool *pool, u32 *nr_free, u32 nr_classes);
 
 #endif
@@ -302,13 +302,16 @@ static const char fsg_string_interface[] = "Mass Storage";
 
 
 #define FSG_NO_INTR_EP 1
-#define FSG_BUFFHD_STATIC_BUFFER 1
 #define FSG_NO_DEVICE_STRINGS    1
 #define FSG_NO_OTG               1
 #define FSG_NO_INTR_EP           1
 
 #include "storage_common.c"
 
+/* Upper bounds for the num_buffers and buflen parameters */
+#define FSG_MAX_BUFFERS		32
+#define FSG_MAX_BUFLEN		(128 * 1024)
+
 
 /*-------------------------------------------------------------------------*/
 
@@ -334,7 +337,9 @@ struct fsg_common {
 
 	struct fsg_buffhd	*next_buffhd_to_fill;
 	struct fsg_buffhd	*next_buffhd_to_drain;
-	struct fsg_buffhd	buffhds[FSG_NUM_BUFFERS];
+	struct fsg_buffhd	*buffhds;
+	unsigned int		num_buffers;
+	unsigned int		buflen;
 
 	int			cmnd_size;
 	u8			cmnd[MAX_COMMAND_SIZE];
@@ -402,6 +407,10 @@ struct fsg_config {
 	u16 release;
 
 	char			can_stall;
+
+	/* I/O buffer pipeline; zero means the defaults */
+	unsigned		num_buffers;
+	unsigned		buflen;
 };
 
 
@@ -706,6 +715,7 @@ static int do_read(struct fsg_common *common)
 	loff_t			file_offset, file_offset_tmp;
 	unsigned int		amount;
 	unsigned int		partial_page;
+	unsigned long		ra_pages;
 	ssize_t			nread;
 
 	/* Get the starting Logical Block Address and check that it's
@@ -734,6 +744,13 @@ static int do_read(struct fsg_common *common)
 	if (unlikely(amount_left == 0))
 		return -EIO;		/* No default reply */
 
+	/* Let the page cache read ahead at least as far as the buffers
+	 * reach, so the medium is already busy with the next chunks while
+	 * the earlier ones go out on the bulk-in endpoint. */
+	ra_pages = (common->num_buffers * common->buflen) >> PAGE_CACHE_SHIFT;
+	if (curlun->filp->f_ra.ra_pages < ra_pages)
+		curlun->filp->f_ra.ra_pages = ra_pages;
+
 	for (;;) {
 
 		/* Figure out how much we need to read:
@@ -744,7 +761,7 @@ static int do_read(struct fsg_common *common)
 		 *	the next page.
 		 * If this means reading 0 then we were asked to read past
 		 *	the end of file. */
-		amount = min(amount_left, FSG_BUFLEN);
+		amount = min(amount_left, common->buflen);
 		amount = min((loff_t) amount,
 				curlun->file_length - file_offset);
 		partial_page = file_offset & (PAGE_CACHE_SIZE - 1);
@@ -893,7 +910,7 @@ static int do_write(struct fsg_common *common)
 			 * If this means getting 0, then we were asked
 			 *	to write past the end of file.
 			 * Finally, round down to a block boundary. */
-			amount = min(amount_left_to_req, FSG_BUFLEN);
+			amount = min(amount_left_to_req, common->buflen);
 			amount = min((loff_t) amount, curlun->file_length -
 					usb_offset);
 			partial_page = usb_offset & (PAGE_CACHE_SIZE - 1);
@@ -1096,7 +1113,7 @@ static int do_verify(struct fsg_common *common)
 		 * And don't try to read past the end of the file.
 		 * If this means reading 0 then we were asked to read
 		 * past the end of file. */
-		amount = min(amount_left, FSG_BUFLEN);
+		amount = min(amount_left, common->buflen);
 		amount = min((loff_t) amount,
 				curlun->file_length - file_offset);
 		if (amount == 0) {
@@ -1505,7 +1522,8 @@ static int pad_with_zeros(struct fsg_dev *fsg)
 				return rc;
 		}
 
-		nsend = min(fsg->common->usb_amount_left, FSG_BUFLEN);
+		nsend = min(fsg->common->usb_amount_left,
+			    fsg->common->buflen);
 		memset(bh->buf + nkeep, 0, nsend - nkeep);
 		bh->inreq->length = nsend;
 		bh->inreq->zero = 0;
@@ -1548,7 +1566,7 @@ static int throw_away_data(struct fsg_common *common)
 		bh = common->next_buffhd_to_fill;
 		if (bh->state == BUF_STATE_EMPTY
 		 && common->usb_amount_left > 0) {
-			amount = min(common->usb_amount_left, FSG_BUFLEN);
+			amount = min(common->usb_amount_left, common->buflen);
 
 			/* amount is always divisible by 512, hence by
 			 * the bulk-out maxpacket size */
@@ -2272,7 +2290,7 @@ reset:
 	if (common->prev_fsg) {
 		struct fsg_dev *fsg = common->prev_fsg;
 
-		for (i = 0; i < FSG_NUM_BUFFERS; ++i) {
+		for (i = 0; i < common->num_buffers; ++i) {
 			struct fsg_buffhd *bh = &common->buffhds[i];
 
 			if (bh->inreq) {
@@ -2326,7 +2344,7 @@ reset:
 		clear_bit(IGNORE_BULK_OUT, &fsg->atomic_bitflags);
 
 		/* Allocate the requests */
-		for (i = 0; i < FSG_NUM_BUFFERS; ++i) {
+		for (i = 0; i < common->num_buffers; ++i) {
 			struct fsg_buffhd	*bh = &common->buffhds[i];
 
 			rc = alloc_request(common, fsg->bulk_in, &bh->inreq);
@@ -2433,7 +2451,7 @@ static void handle_exception(struct fsg_common *common)
 
 	/* Cancel all the pending transfers */
 	if (fsg_is_set(common)) {
-		for (i = 0; i < FSG_NUM_BUFFERS; ++i) {
+		for (i = 0; i < common->num_buffers; ++i) {
 			bh = &common->buffhds[i];
 			if (bh->inreq_busy)
 				usb_ep_dequeue(common->fsg->bulk_in, bh->inreq);
@@ -2445,7 +2463,7 @@ static void handle_exception(struct fsg_common *common)
 		/* Wait until everything is idle */
 		for (;;) {
 			int num_active = 0;
-			for (i = 0; i < FSG_NUM_BUFFERS; ++i) {
+			for (i = 0; i < common->num_buffers; ++i) {
 				bh = &common->buffhds[i];
 				num_active += bh->inreq_busy + bh->outreq_busy;
 			}
@@ -2466,7 +2484,7 @@ static void handle_exception(struct fsg_common *common)
 	 * state, and the exception.  Then invoke the handler. */
 	spin_lock_irq(&common->lock);
 
-	for (i = 0; i < FSG_NUM_BUFFERS; ++i) {
+	for (i = 0; i < common->num_buffers; ++i) {
 		bh = &common->buffhds[i];
 		bh->state = BUF_STATE_EMPTY;
 	}
@@ -2675,7 +2693,7 @@ static struct fsg_common *fsg_common_init(struct fsg_common *common,
 			return ERR_PTR(-ENOMEM);
 		common->free_storage_on_release = 1;
 	} else {
-		memset(common, 0, sizeof common);
+		memset(common, 0, sizeof *common);
 		common->free_storage_on_release = 0;
 	}
 
@@ -2748,15 +2766,30 @@ static struct fsg_common *fsg_common_init(struct fsg_common *common,
 	common->nluns = nluns;
 
 
-	/* Data buffers cyclic list */
-	/* Buffers in buffhds are static -- no need for additional
-	 * allocation. */
+	/* Data buffers cyclic list.  More and bigger buffers let reads
+	 * from the backing file run further ahead of the USB transfers. */
+	common->num_buffers = clamp_t(unsigned, cfg->num_buffers ?: FSG_NUM_BUFFERS,
+				      2, FSG_MAX_BUFFERS);
+	common->buflen = clamp_t(unsigned, cfg->buflen ?: FSG_BUFLEN,
+				 PAGE_CACHE_SIZE, FSG_MAX_BUFLEN) & PAGE_CACHE_MASK;
+
+	common->buffhds = kcalloc(common->num_buffers, sizeof *common->buffhds,
+				  GFP_KERNEL);
+	if (!common->buffhds) {
+		rc = -ENOMEM;
+		goto error_release;
+	}
 	bh = common->buffhds;
-	i = FSG_NUM_BUFFERS - 1;
+	i = common->num_buffers;
 	do {
+		bh->buf = kmalloc(common->buflen, GFP_KERNEL);
+		if (!bh->buf) {
+			rc = -ENOMEM;
+			goto error_release;
+		}
 		bh->next = bh + 1;
 	} while (++bh, --i);
-	bh->next = common->buffhds;
+	bh[-1].next = common->buffhds;
 
 
 	/* Prepare inquiryString */
@@ -2884,6 +2917,11 @@ static void fsg_common_release(struct kref *ref)
 	}
 
 	kfree(common->luns);
+	if (common->buffhds) {
+		for (i = 0; i < common->num_buffers; ++i)
+			kfree(common->buffhds[i].buf);
+		kfree(common->buffhds);
+	}
 	if (common->free_storage_on_release)
 		kfree(common);
 }
@@ -3009,6 +3047,8 @@ struct fsg_module_parameters {
 	unsigned int	file_count, ro_count, removable_count, cdrom_count;
 	unsigned int	luns;	/* nluns */
 	int		stall;	/* can_stall */
+	unsigned int	num_buffers;
+	unsigned int	buflen;
 };
 
 
@@ -3035,7 +3075,11 @@ struct fsg_module_parameters {
 	_FSG_MODULE_PARAM(prefix, params, luns, uint,			\
 			  "number of LUNs");				\
 	_FSG_MODULE_PARAM(prefix, params, stall, bool,			\
-			  "false to prevent bulk stalls")
+			  "false to prevent bulk stalls");		\
+	_FSG_MODULE_PARAM(prefix, params, num_buffers, uint,		\
+			  "number of I/O buffers (2-32)");		\
+	_FSG_MODULE_PARAM(prefix, params, buflen, uint,		\
+			  "size of each I/O buffer (4 KiB-128 KiB)")
 
 
 static void
@@ -3072,6 +3116,8 @@ fsg_config_from_params(struct fsg_config *cfg,
 
 	/* Finalise */
 	cfg->can_stall = params->stall;
+	cfg->num_buffers = params->num_buffers;
+	cfg->buflen = params->buflen;
 }
 
 static inline struct fsg_common *
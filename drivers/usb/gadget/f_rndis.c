@@ -101,6 +101,22 @@ static inline struct f_rndis *func_to_rndis(struct usb_function *f)
 	return container_of(f, struct f_rndis, port.func);
 }
 
+/* RNDIS lets one transfer carry several PACKET_MSGs.  Up to ten fill the
+ * 16 KB transfers Windows hosts accept.  The OUT side defaults to one,
+ * since each extra packet grows every (atomically allocated) rx skb.
+ */
+static unsigned rndis_dl_max_pkts = 10;
+module_param(rndis_dl_max_pkts, uint, S_IRUGO);
+MODULE_PARM_DESC(rndis_dl_max_pkts, "max packets per IN transfer");
+
+static unsigned rndis_ul_max_pkts = 1;
+module_param(rndis_ul_max_pkts, uint, S_IRUGO);
+MODULE_PARM_DESC(rndis_ul_max_pkts, "max packets per OUT transfer");
+
+/* room for one full-size frame, padded as rndis_add_hdr_into() does */
+#define RNDIS_DL_PKT_ROOM \
+	ALIGN(sizeof(struct rndis_packet_msg_type) + ETH_FRAME_LEN, 8)
+
 /* peak (theoretical) bulk transfer rate in bits-per-second */
 static unsigned int bitrate(struct usb_gadget *g)
 {
@@ -705,6 +721,8 @@ rndis_bind(struct usb_configuration *c, struct usb_function *f)
 
 	rndis_set_param_medium(rndis->config, NDIS_MEDIUM_802_3, 0);
 	rndis_set_host_mac(rndis->config, rndis->ethaddr);
+	rndis_set_max_pkt_xfer(rndis->config, rndis->port.ul_max_pkts,
+			&rndis->port.dl_max_xfer);
 
 	if (rndis_set_param_vendor(rndis->config, vendorID,
 				manufacturer))
@@ -839,6 +857,10 @@ int __init rndis_bind_config(struct usb_configuration *c, u8 ethaddr[ETH_ALEN])
 	rndis->port.header_len = sizeof(struct rndis_packet_msg_type);
 	rndis->port.wrap = rndis_add_header;
 	rndis->port.unwrap = rndis_rm_hdr;
+	rndis->port.wrap_into = rndis_add_hdr_into;
+	rndis->port.dl_max_pkts = rndis_dl_max_pkts;
+	rndis->port.dl_buf_len = rndis_dl_max_pkts * RNDIS_DL_PKT_ROOM;
+	rndis->port.ul_max_pkts = rndis_ul_max_pkts ? : 1;
 
 	rndis->port.func.name = "rndis";
 	rndis->port.func.strings = rndis_strings;
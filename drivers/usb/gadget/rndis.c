@@ -566,6 +566,11 @@ static int rndis_init_response (int configNr, rndis_init_msg_type *buf)
 	if (!params->dev)
 		return -ENOTSUPP;
 
+	/* the host caps how much we may pack into one IN transfer */
+	if (params->host_max_xfer)
+		*params->host_max_xfer = get_unaligned_le32(
+				&buf->MaxTransferSize);
+
 	r = rndis_add_response (configNr, sizeof (rndis_init_cmplt_type));
 	if (!r)
 		return -ENOMEM;
@@ -580,11 +585,11 @@ static int rndis_init_response (int configNr, rndis_init_msg_type *buf)
 	resp->MinorVersion = cpu_to_le32 (RNDIS_MINOR_VERSION);
 	resp->DeviceFlags = cpu_to_le32 (RNDIS_DF_CONNECTIONLESS);
 	resp->Medium = cpu_to_le32 (RNDIS_MEDIUM_802_3);
-	resp->MaxPacketsPerTransfer = cpu_to_le32 (1);
-	resp->MaxTransferSize = cpu_to_le32 (
-		  params->dev->mtu
+	resp->MaxPacketsPerTransfer = cpu_to_le32 (params->max_pkt_per_xfer);
+	resp->MaxTransferSize = cpu_to_le32 (params->max_pkt_per_xfer
+		* (params->dev->mtu
 		+ sizeof (struct ethhdr)
-		+ sizeof (struct rndis_packet_msg_type)
+		+ sizeof (struct rndis_packet_msg_type))
 		+ 22);
 	resp->PacketAlignmentFactor = cpu_to_le32 (0);
 	resp->AFListOffset = cpu_to_le32 (0);
@@ -899,6 +904,8 @@ int rndis_register(void (*resp_avail)(void *v), void *v)
 			rndis_per_dev_params [i].used = 1;
 			rndis_per_dev_params [i].resp_avail = resp_avail;
 			rndis_per_dev_params [i].v = v;
+			rndis_per_dev_params [i].max_pkt_per_xfer = 1;
+			rndis_per_dev_params [i].host_max_xfer = NULL;
 			pr_debug("%s: configNr = %d\n", __func__, i);
 			return i;
 		}
@@ -954,6 +961,24 @@ int rndis_set_param_medium (u8 configNr, u32 medium, u32 speed)
 	return 0;
 }
 
+/*
+ * @max_pkt_per_xfer is how many PACKET_MSGs the host may send in one OUT
+ * transfer; the OUT buffers must be sized to match.  The MaxTransferSize
+ * the host gives in its INITIALIZE_MSG is stored to @host_max_xfer.
+ */
+int rndis_set_max_pkt_xfer (u8 configNr, u32 max_pkt_per_xfer,
+			    u32 *host_max_xfer)
+{
+	pr_debug("%s: %u\n", __func__, max_pkt_per_xfer);
+	if (configNr >= RNDIS_MAX_CONFIGS) return -1;
+
+	rndis_per_dev_params [configNr].max_pkt_per_xfer =
+				max_pkt_per_xfer ? : 1;
+	rndis_per_dev_params [configNr].host_max_xfer = host_max_xfer;
+
+	return 0;
+}
+
 void rndis_add_hdr (struct sk_buff *skb)
 {
 	struct rndis_packet_msg_type	*header;
@@ -968,6 +993,35 @@ void rndis_add_hdr (struct sk_buff *skb)
 	header->DataLength = cpu_to_le32(skb->len - sizeof *header);
 }
 
+/*
+ * Append @skb as one PACKET_MSG of a multi-packet transfer at @buf.
+ * Messages are padded to 8 bytes where @room allows, so the next header
+ * stays aligned; MessageLength covers the padding.  Returns the bytes
+ * used, or zero if the message doesn't fit in @room.
+ */
+unsigned rndis_add_hdr_into(struct sk_buff *skb, void *buf, unsigned room)
+{
+	struct rndis_packet_msg_type	*header = buf;
+	unsigned			len;
+
+	len = sizeof *header + skb->len;
+	if (len > room)
+		return 0;
+	len = min(ALIGN(len, 8), room);
+
+	memset (header, 0, sizeof *header);
+	header->MessageType = cpu_to_le32(REMOTE_NDIS_PACKET_MSG);
+	header->MessageLength = cpu_to_le32(len);
+	header->DataOffset = cpu_to_le32 (36);
+	header->DataLength = cpu_to_le32(skb->len);
+
+	skb_copy_bits(skb, 0, header + 1, skb->len);
+	memset((u8 *)(header + 1) + skb->len, 0,
+			len - sizeof *header - skb->len);
+
+	return len;
+}
+
 void rndis_free_response (int configNr, u8 *buf)
 {
 	rndis_resp_t		*r;
@@ -1026,25 +1080,62 @@ int rndis_rm_hdr(struct gether *port,
 			struct sk_buff *skb,
 			struct sk_buff_head *list)
 {
-	/* tmp points to a struct rndis_packet_msg_type */
-	__le32		*tmp = (void *) skb->data;
+	struct sk_buff	*skb2;
+	__le32		*tmp;
+	u32		msg_len, data_offset, data_len;
+	bool		first = true;
 
-	/* MessageType, MessageLength */
-	if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
-			!= get_unaligned(tmp++)) {
-		dev_kfree_skb_any(skb);
-		return -EINVAL;
-	}
-	tmp++;
+	/* one transfer may carry several PACKET_MSGs back to back; all
+	 * but the last are cloned, sharing the transfer's buffer
+	 */
+	while (skb->len >= sizeof(struct rndis_packet_msg_type)) {
+		/* tmp points to a struct rndis_packet_msg_type */
+		tmp = (void *) skb->data;
+
+		/* MessageType, MessageLength; hosts may pad the transfer
+		 * after the last message
+		 */
+		if (cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
+				!= get_unaligned(tmp++)) {
+			if (first) {
+				dev_kfree_skb_any(skb);
+				return -EINVAL;
+			}
+			break;
+		}
+		msg_len = get_unaligned_le32(tmp++);
+
+		/* DataOffset, DataLength */
+		data_offset = get_unaligned_le32(tmp++) + 8;
+		data_len = get_unaligned_le32(tmp++);
+		if (data_offset > skb->len
+				|| data_len > skb->len - data_offset) {
+			dev_kfree_skb_any(skb);
+			return -EOVERFLOW;
+		}
+		first = false;
+
+		if (msg_len >= skb->len
+				|| msg_len < data_offset + data_len) {
+			skb_pull(skb, data_offset);
+			skb_trim(skb, data_len);
+			skb_queue_tail(list, skb);
+			return 0;
+		}
+
+		skb2 = skb_clone(skb, GFP_ATOMIC);
+		if (!skb2) {
+			dev_kfree_skb_any(skb);
+			return -ENOMEM;
+		}
+		skb_pull(skb2, data_offset);
+		skb_trim(skb2, data_len);
+		skb_queue_tail(list, skb2);
 
-	/* DataOffset, DataLength */
-	if (!skb_pull(skb, get_unaligned_le32(tmp++) + 8)) {
-		dev_kfree_skb_any(skb);
-		return -EOVERFLOW;
+		skb_pull(skb, msg_len);
 	}
-	skb_trim(skb, get_unaligned_le32(tmp++));
 
-	skb_queue_tail(list, skb);
+	dev_kfree_skb_any(skb);
 	return 0;
 }
 
@@ -239,6 +239,12 @@ typedef struct rndis_params
 	void			(*resp_avail)(void *v);
 	void			*v;
 	struct list_head	resp_queue;
+
+	/* multi-packet transfers: what we accept from the host, and
+	 * where to record the host's limit for what we send it
+	 */
+	u32			max_pkt_per_xfer;
+	u32			*host_max_xfer;
 } rndis_params;
 
 /* RNDIS Message parser and other useless functions */
@@ -250,7 +256,10 @@ int  rndis_set_param_dev (u8 configNr, struct net_device *dev,
 int  rndis_set_param_vendor (u8 configNr, u32 vendorID,
 			    const char *vendorDescr);
 int  rndis_set_param_medium (u8 configNr, u32 medium, u32 speed);
+int  rndis_set_max_pkt_xfer (u8 configNr, u32 max_pkt_per_xfer,
+			    u32 *host_max_xfer);
 void rndis_add_hdr (struct sk_buff *skb);
+unsigned rndis_add_hdr_into(struct sk_buff *skb, void *buf, unsigned room);
 int rndis_rm_hdr(struct gether *port, struct sk_buff *skb,
 			struct sk_buff_head *list);
 u8   *rndis_get_next_response (int configNr, u32 *length);
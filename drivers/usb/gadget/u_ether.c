@@ -25,6 +25,8 @@
 #include <linux/kernel.h>
 #include <linux/device.h>
 #include <linux/ctype.h>
+#include <linux/slab.h>
+#include <linux/hrtimer.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
 
@@ -76,6 +78,18 @@ struct eth_dev {
 						struct sk_buff *skb,
 						struct sk_buff_head *list);
 
+	/* multi-frame IN transfers, see gether.wrap_into */
+	bool			tx_aggr;
+	unsigned		(*wrap_into)(struct sk_buff *skb,
+						void *buf, unsigned room);
+	unsigned		tx_aggr_max;	/* frames per transfer */
+	unsigned		tx_aggr_len;	/* bytes per buffer */
+	struct usb_request	*tx_aggr_req;	/* being filled; req_lock */
+	unsigned		tx_aggr_cnt;
+	struct hrtimer		tx_aggr_timer;
+
+	unsigned		ul_max_pkts;
+
 	struct work_struct	work;
 
 	unsigned long		todo;
@@ -102,6 +116,15 @@ MODULE_PARM_DESC(qmult, "queue length multiplier at high speed");
 #define qmult		1
 #endif
 
+/* for links packing several frames per transfer: how long a partly
+ * filled IN transfer may wait for more frames while earlier ones are
+ * still in flight.  It's always sent once the IN queue drains.
+ */
+static unsigned tx_aggr_usecs = 200;
+module_param(tx_aggr_usecs, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(tx_aggr_usecs,
+		"max usecs a partial multi-frame transfer waits, 0 = no limit");
+
 /* for dual-speed hardware, use deeper queues at highspeed */
 static inline int qlen(struct usb_gadget *gadget)
 {
@@ -234,8 +257,11 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 * means receivers can't recover lost synch on their own (because
 	 * new packets don't only start after a short RX).
 	 */
-	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
+	size += sizeof(struct ethhdr) + dev->net->mtu;
 	size += dev->port_usb->header_len;
+	if (dev->ul_max_pkts > 1)
+		size *= dev->ul_max_pkts;
+	size += RX_EXTRA;
 	size += out->maxpacket - 1;
 	size -= size % out->maxpacket;
 
@@ -457,11 +483,213 @@ static void eth_work(struct work_struct *work)
 		DBG(dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
+/*-------------------------------------------------------------------------*/
+
+/* Multi-frame IN transfers.  Frames are copied into the request being
+ * filled while earlier transfers are still in flight; it's queued when
+ * full, when the IN queue drains, or after tx_aggr_usecs.  An idle link
+ * thus sends each frame at once, and a busy one amortizes the per
+ * transfer DMA and IRQ costs over several frames.
+ */
+
+static void tx_complete(struct usb_ep *ep, struct usb_request *req);
+
+/* caller holds req_lock */
+static struct usb_request *eth_aggr_take(struct eth_dev *dev)
+{
+	struct usb_request	*req = dev->tx_aggr_req;
+
+	dev->tx_aggr_req = NULL;
+	dev->tx_aggr_cnt = 0;
+	return req;
+}
+
+static void eth_aggr_queue(struct eth_dev *dev, struct usb_ep *in,
+		struct usb_request *req)
+{
+	unsigned long	flags;
+	int		retval;
+
+	req->context = NULL;
+	req->complete = tx_complete;
+	req->no_interrupt = 0;
+
+	/* same zlp rules as for single frames; buffers have a spare byte */
+	req->zero = 1;
+	if (!dev->zlp && (req->length % in->maxpacket) == 0)
+		req->length++;
+
+	/* counted first, so tx_complete() can't see the queue drain early */
+	atomic_inc(&dev->tx_qlen);
+	retval = usb_ep_queue(in, req, GFP_ATOMIC);
+	if (retval == 0) {
+		dev->net->trans_start = jiffies;
+		return;
+	}
+
+	DBG(dev, "tx queue err %d\n", retval);
+	atomic_dec(&dev->tx_qlen);
+	dev->net->stats.tx_errors++;
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (list_empty(&dev->tx_reqs))
+		netif_start_queue(dev->net);
+	list_add(&req->list, &dev->tx_reqs);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+}
+
+static void eth_aggr_flush(struct eth_dev *dev, struct usb_ep *in)
+{
+	struct usb_request	*req;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	req = eth_aggr_take(dev);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	if (req) {
+		hrtimer_try_to_cancel(&dev->tx_aggr_timer);
+		eth_aggr_queue(dev, in, req);
+	}
+}
+
+static enum hrtimer_restart eth_aggr_timeout(struct hrtimer *timer)
+{
+	struct eth_dev	*dev = container_of(timer, struct eth_dev,
+						tx_aggr_timer);
+	struct usb_ep	*in = NULL;
+	unsigned long	flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->port_usb)
+		in = dev->port_usb->in_ep;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (in)
+		eth_aggr_flush(dev, in);
+	return HRTIMER_NORESTART;
+}
+
+static netdev_tx_t eth_aggr_xmit(struct eth_dev *dev, struct sk_buff *skb,
+		struct usb_ep *in, u32 max_xfer)
+{
+	struct usb_request	*req, *full = NULL;
+	unsigned		room, len = 0;
+	unsigned long		flags;
+	bool			arm = false;
+
+	/* the host may accept less than we buffer */
+	room = dev->tx_aggr_len;
+	if (max_xfer && max_xfer < room)
+		room = max_xfer;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	req = dev->tx_aggr_req;
+	if (req) {
+		if (req->length < room)
+			len = dev->wrap_into(skb, req->buf + req->length,
+					room - req->length);
+		if (!len) {
+			/* send what we have, start over in a new one */
+			full = eth_aggr_take(dev);
+			req = NULL;
+		}
+	}
+
+	if (!req) {
+		/* see eth_start_xmit() on an empty freelist */
+		if (list_empty(&dev->tx_reqs)) {
+			netif_stop_queue(dev->net);
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			if (full)
+				eth_aggr_queue(dev, in, full);
+			return NETDEV_TX_BUSY;
+		}
+
+		req = container_of(dev->tx_reqs.next,
+				struct usb_request, list);
+		list_del(&req->list);
+		req->length = 0;
+
+		len = dev->wrap_into(skb, req->buf, room);
+		if (!len) {
+			/* too big for the host even on its own */
+			list_add(&req->list, &dev->tx_reqs);
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			dev->net->stats.tx_dropped++;
+			dev_kfree_skb_any(skb);
+			if (full)
+				eth_aggr_queue(dev, in, full);
+			return NETDEV_TX_OK;
+		}
+		dev->tx_aggr_req = req;
+	}
+
+	req->length += len;
+	dev->tx_aggr_cnt++;
+	dev->net->stats.tx_packets++;
+	dev->net->stats.tx_bytes += skb->len;
+
+	/* an idle queue means nobody will complete and flush this */
+	if (dev->tx_aggr_cnt >= dev->tx_aggr_max
+			|| (!full && !atomic_read(&dev->tx_qlen)))
+		req = eth_aggr_take(dev);
+	else {
+		/* first frame of a new transfer bounds how long it waits */
+		arm = (dev->tx_aggr_cnt == 1);
+		req = NULL;
+	}
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	dev_kfree_skb_any(skb);
+
+	if (full)
+		eth_aggr_queue(dev, in, full);
+
+	if (req) {
+		hrtimer_try_to_cancel(&dev->tx_aggr_timer);
+		eth_aggr_queue(dev, in, req);
+	} else if (arm && tx_aggr_usecs)
+		hrtimer_start(&dev->tx_aggr_timer,
+				ns_to_ktime(tx_aggr_usecs * (u64) NSEC_PER_USEC),
+				HRTIMER_MODE_REL);
+	return NETDEV_TX_OK;
+}
+
+/* give each IN request a buffer to pack frames into */
+static int eth_aggr_alloc(struct eth_dev *dev, unsigned len)
+{
+	struct usb_request	*req;
+	int			status = 0;
+
+	spin_lock(&dev->req_lock);
+	list_for_each_entry(req, &dev->tx_reqs, list)
+		req->buf = NULL;
+	list_for_each_entry(req, &dev->tx_reqs, list) {
+		/* plus one byte for the zlp workaround */
+		req->buf = kmalloc(len + 1, GFP_ATOMIC);
+		if (!req->buf) {
+			status = -ENOMEM;
+			break;
+		}
+	}
+	if (status < 0) {
+		list_for_each_entry(req, &dev->tx_reqs, list) {
+			kfree(req->buf);
+			req->buf = NULL;
+		}
+	}
+	spin_unlock(&dev->req_lock);
+	return status;
+}
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
 	struct eth_dev	*dev = ep->driver_data;
 
+	/* multi-frame transfers have no skb; their frames were counted
+	 * as they were copied in
+	 */
 	switch (req->status) {
 	default:
 		dev->net->stats.tx_errors++;
@@ -471,16 +699,22 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 	case -ESHUTDOWN:		/* disconnect etc */
 		break;
 	case 0:
-		dev->net->stats.tx_bytes += skb->len;
+		if (skb)
+			dev->net->stats.tx_bytes += skb->len;
 	}
-	dev->net->stats.tx_packets++;
+	if (skb)
+		dev->net->stats.tx_packets++;
 
 	spin_lock(&dev->req_lock);
 	list_add(&req->list, &dev->tx_reqs);
 	spin_unlock(&dev->req_lock);
-	dev_kfree_skb_any(skb);
+	if (skb)
+		dev_kfree_skb_any(skb);
+
+	/* don't hold a partial transfer once nothing else is in flight */
+	if (atomic_dec_and_test(&dev->tx_qlen) && dev->tx_aggr)
+		eth_aggr_flush(dev, ep);
 
-	atomic_dec(&dev->tx_qlen);
 	if (netif_carrier_ok(dev->net))
 		netif_wake_queue(dev->net);
 }
@@ -500,14 +734,17 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 	unsigned long		flags;
 	struct usb_ep		*in;
 	u16			cdc_filter;
+	u32			max_xfer;
 
 	spin_lock_irqsave(&dev->lock, flags);
 	if (dev->port_usb) {
 		in = dev->port_usb->in_ep;
 		cdc_filter = dev->port_usb->cdc_filter;
+		max_xfer = dev->port_usb->dl_max_xfer;
 	} else {
 		in = NULL;
 		cdc_filter = 0;
+		max_xfer = 0;
 	}
 	spin_unlock_irqrestore(&dev->lock, flags);
 
@@ -538,6 +775,9 @@ static netdev_tx_t eth_start_xmit(struct sk_buff *skb,
 		/* ignores USB_CDC_PACKET_TYPE_DIRECTED */
 	}
 
+	if (dev->tx_aggr)
+		return eth_aggr_xmit(dev, skb, in, max_xfer);
+
 	spin_lock_irqsave(&dev->req_lock, flags);
 	/*
 	 * this freelist can be empty if an interrupt triggered disconnect()
@@ -779,6 +1019,9 @@ int __init gether_setup(struct usb_gadget *g, u8 ethaddr[ETH_ALEN])
 	INIT_LIST_HEAD(&dev->tx_reqs);
 	INIT_LIST_HEAD(&dev->rx_reqs);
 
+	hrtimer_init(&dev->tx_aggr_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dev->tx_aggr_timer.function = eth_aggr_timeout;
+
 	skb_queue_head_init(&dev->rx_frames);
 
 	/* network device setup */
@@ -894,6 +1137,19 @@ struct net_device *gether_connect(struct gether *link)
 		dev->header_len = link->header_len;
 		dev->unwrap = link->unwrap;
 		dev->wrap = link->wrap;
+		dev->ul_max_pkts = link->ul_max_pkts;
+
+		/* without packing buffers, send one frame per transfer */
+		dev->tx_aggr = false;
+		if (link->wrap_into && link->dl_max_pkts > 1) {
+			if (eth_aggr_alloc(dev, link->dl_buf_len) == 0) {
+				dev->wrap_into = link->wrap_into;
+				dev->tx_aggr_max = link->dl_max_pkts;
+				dev->tx_aggr_len = link->dl_buf_len;
+				dev->tx_aggr = true;
+			} else
+				DBG(dev, "no tx packing buffers\n");
+		}
 
 		spin_lock(&dev->lock);
 		dev->port_usb = link;
@@ -950,6 +1206,16 @@ void gether_disconnect(struct gether *link)
 	netif_stop_queue(dev->net);
 	netif_carrier_off(dev->net);
 
+	/* a partly filled transfer goes back with the rest */
+	if (dev->tx_aggr) {
+		hrtimer_cancel(&dev->tx_aggr_timer);
+		spin_lock(&dev->req_lock);
+		req = eth_aggr_take(dev);
+		if (req)
+			list_add(&req->list, &dev->tx_reqs);
+		spin_unlock(&dev->req_lock);
+	}
+
 	/* disable endpoints, forcing (synchronous) completion
 	 * of all pending i/o.  then free the request objects
 	 * and forget about the endpoints.
@@ -962,6 +1228,8 @@ void gether_disconnect(struct gether *link)
 		list_del(&req->list);
 
 		spin_unlock(&dev->req_lock);
+		if (dev->tx_aggr)
+			kfree(req->buf);
 		usb_ep_free_request(link->in_ep, req);
 		spin_lock(&dev->req_lock);
 	}
@@ -988,6 +1256,9 @@ void gether_disconnect(struct gether *link)
 	dev->header_len = 0;
 	dev->unwrap = NULL;
 	dev->wrap = NULL;
+	dev->ul_max_pkts = 0;
+	dev->tx_aggr = false;
+	dev->wrap_into = NULL;
 
 	spin_lock(&dev->lock);
 	dev->port_usb = NULL;
@@ -68,6 +68,20 @@ struct gether {
 						struct sk_buff *skb,
 						struct sk_buff_head *list);
 
+	/* optional multi-frame transfers.  wrap_into() appends one framed
+	 * skb at buf, returning the bytes used or zero if it won't fit in
+	 * room; frames are then copied into dl_buf_len byte IN buffers,
+	 * at most dl_max_pkts per transfer.  dl_max_xfer, if nonzero, is
+	 * the host's limit on the transfer size.  ul_max_pkts sizes the
+	 * OUT buffers for what unwrap() may be handed.
+	 */
+	unsigned			(*wrap_into)(struct sk_buff *skb,
+						void *buf, unsigned room);
+	unsigned			dl_max_pkts;
+	unsigned			dl_buf_len;
+	u32				dl_max_xfer;
+	unsigned			ul_max_pkts;
+
 	/* called on network open/close */
 	void				(*open)(struct gether *);
 	void				(*close)(struct gether *);
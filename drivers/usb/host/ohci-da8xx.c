@@ -31,6 +31,35 @@ static struct clk *usb20_clk;
 /* Over-current indicator change bitmask */
 static volatile u16 ocic_mask;
 
+#ifdef CONFIG_USB_OHCI_DA8XX_DESC_RAM
+/*
+ * The second memory resource is shared RAM for the HCCA and the ED/TD
+ * pools; declared as the device's coherent memory, those allocations land
+ * there and the controller's list walks stay off DDR. Whatever doesn't fit
+ * falls back to DDR as before.
+ */
+static void ohci_da8xx_desc_ram_init(struct platform_device *pdev)
+{
+	struct resource *ram = platform_get_resource(pdev, IORESOURCE_MEM, 1);
+
+	if (!ram)
+		return;
+
+	if (dma_declare_coherent_memory(&pdev->dev, ram->start, ram->start,
+					resource_size(ram),
+					DMA_MEMORY_MAP) != DMA_MEMORY_MAP)
+		dev_warn(&pdev->dev, "descriptors stay in DDR\n");
+}
+
+static void ohci_da8xx_desc_ram_exit(struct platform_device *pdev)
+{
+	dma_release_declared_memory(&pdev->dev);
+}
+#else
+static inline void ohci_da8xx_desc_ram_init(struct platform_device *pdev) { }
+static inline void ohci_da8xx_desc_ram_exit(struct platform_device *pdev) { }
+#endif
+
 static void ohci_da8xx_clock(int on)
 {
 	u32 cfgchip2;
@@ -347,9 +376,13 @@ static int usb_hcd_da8xx_probe(const struct hc_driver *driver,
 		error = -ENODEV;
 		goto err4;
 	}
+
+	/* before usb_add_hcd(), which allocates the HCCA */
+	ohci_da8xx_desc_ram_init(pdev);
+
 	error = usb_add_hcd(hcd, irq, IRQF_DISABLED);
 	if (error)
-		goto err4;
+		goto err5;
 
 	if (hub->ocic_notify) {
 		error = hub->ocic_notify(ohci_da8xx_ocic_handler);
@@ -361,6 +394,8 @@ static int usb_hcd_da8xx_probe(const struct hc_driver *driver,
 	return 0;
 
 	usb_remove_hcd(hcd);
+err5:
+	ohci_da8xx_desc_ram_exit(pdev);
 err4:
 	iounmap(hcd->regs);
 err3:
@@ -390,6 +425,7 @@ usb_hcd_da8xx_remove(struct usb_hcd *hcd, struct platform_device *pdev)
 
 	hub->ocic_notify(NULL);
 	usb_remove_hcd(hcd);
+	ohci_da8xx_desc_ram_exit(pdev);
 	iounmap(hcd->regs);
 	release_mem_region(hcd->rsrc_start, hcd->rsrc_len);
 	usb_put_hcd(hcd);
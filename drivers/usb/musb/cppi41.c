@@ -923,6 +923,35 @@ unsigned long cppi41_queue_pop(const struct cppi41_queue_obj *queue_obj)
 }
 EXPORT_SYMBOL(cppi41_queue_pop);
 
+/*
+ * cppi41_queue_pop_batch - pop up to budget descriptors from a given queue
+ */
+int cppi41_queue_pop_batch(const struct cppi41_queue_obj *queue_obj,
+			   unsigned long *desc_addr, int budget)
+{
+	u32 count, val;
+	int n;
+
+	count = __raw_readl(queue_obj->base_addr + QMGR_QUEUE_REG_A(0)) &
+		QMGR_QUEUE_ENTRY_COUNT_MASK;
+	if (count > budget)
+		count = budget;
+
+	for (n = 0; n < count; n++) {
+		val = __raw_readl(queue_obj->base_addr + QMGR_QUEUE_REG_D(0));
+		val &= QMGR_QUEUE_DESC_PTR_MASK;
+		if (!val)
+			break;
+		desc_addr[n] = val;
+	}
+
+	DBG("Popped %d of %u descriptors from queue @ %p\n", n, count,
+	    queue_obj->base_addr);
+
+	return n;
+}
+EXPORT_SYMBOL(cppi41_queue_pop_batch);
+
 /*
  * cppi41_get_teardown_info - extract information from a teardown descriptor
  */
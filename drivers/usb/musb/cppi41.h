@@ -71,6 +71,9 @@
 #define QMGR_QUEUE_DESC_SIZE_SHIFT	0
 #define QMGR_QUEUE_DESC_SIZE_MASK	(0x1f << QMGR_QUEUE_DESC_SIZE_SHIFT)
 
+/* Queue Register A bits */
+#define QMGR_QUEUE_ENTRY_COUNT_MASK	0x3fff
+
 /*
  * Queue Manager - Queue Status Region
  */
@@ -718,6 +721,21 @@ void cppi41_queue_push(const struct cppi41_queue_obj *queue_obj, u32 desc_addr,
  */
 unsigned long cppi41_queue_pop(const struct cppi41_queue_obj *queue_obj);
 
+/**
+ * cppi41_queue_pop_batch - pop several descriptors from CPPI 4.1 queue
+ * @queue_obj:	pointer to the queue object
+ * @desc_addr:	array receiving the descriptors' physical addresses
+ * @budget:	size of @desc_addr
+ *
+ * This function is called to drain up to @budget descriptors from the
+ * queue, reading its entry count once instead of popping until empty.
+ *
+ * Returns the number of descriptors popped; fewer than @budget means
+ * the queue was emptied.
+ */
+int cppi41_queue_pop_batch(const struct cppi41_queue_obj *queue_obj,
+			   unsigned long *desc_addr, int budget);
+
 /*
  * CPPI 4.1 Miscellaneous APIs
  */
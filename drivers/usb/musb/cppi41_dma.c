@@ -21,6 +21,8 @@
 
 #include <linux/errno.h>
 #include <linux/dma-mapping.h>
+#include <linux/interrupt.h>
+#include <linux/usb.h>
 
 #include "cppi41.h"
 
@@ -33,6 +35,10 @@
 #define USB_CPPI41_DESC_ALIGN	(1 << USB_CPPI41_DESC_SIZE_SHIFT)
 #define USB_CPPI41_CH_NUM_PD	64	/* 4K bulk data at full speed */
 #define USB_CPPI41_MAX_PD	(USB_CPPI41_CH_NUM_PD * USB_CPPI41_NUM_CH)
+/* the PD region is split evenly between the Tx and Rx channels */
+#define USB_CPPI41_POOL_NUM_PD	(USB_CPPI41_MAX_PD / (2 * USB_CPPI41_NUM_CH))
+/* completions handled per queue per tasklet run */
+#define USB_CPPI41_POLL_BUDGET	32
 
 #undef DEBUG_CPPI_TD
 #undef USBDRV_DEBUG
@@ -51,6 +57,7 @@
  * USB Packet Descriptor
  */
 struct usb_pkt_desc;
+struct cppi41_channel;
 
 struct usb_pkt_desc {
 	/* Hardware descriptor fields from this point */
@@ -58,9 +65,11 @@ struct usb_pkt_desc {
 	/* Protocol specific data */
 	dma_addr_t dma_addr;
 	struct usb_pkt_desc *next_pd_ptr;
+	struct cppi41_channel *owner;	/* channel whose pool this PD is in */
 	u8 ch_num;
 	u8 ep_num;
 	u8 eop;
+	u16 iso_frame;			/* index in cppi41_channel.iso_frames */
 };
 
 /**
@@ -95,6 +104,14 @@ struct cppi41_channel {
 	u16 pkt_size;
 	u8  transfer_mode;
 	u8  zlp_queued;
+
+	/* Isochronous transfer, see cppi41_channel_program_iso() */
+	struct usb_iso_packet_descriptor *iso_frames;
+	unsigned iso_nframes;
+	unsigned iso_queued;		/* frames handed to the DMA */
+	unsigned iso_done;		/* frames completed */
+
+	struct usb_pkt_desc *pd_pool_head; /* Free PD pool head */
 };
 
 /**
@@ -110,7 +127,6 @@ struct cppi41 {
 	struct cppi41_channel tx_cppi_ch[USB_CPPI41_NUM_CH];
 	struct cppi41_channel rx_cppi_ch[USB_CPPI41_NUM_CH];
 
-	struct usb_pkt_desc *pd_pool_head; /* Free PD pool head */
 	dma_addr_t pd_mem_phys;		/* PD memory physical address */
 	void *pd_mem;			/* PD memory pointer */
 	u8 pd_mem_rgn;			/* PD memory region number */
@@ -119,8 +135,16 @@ struct cppi41 {
 	struct cppi41_queue_obj queue_obj; /* Teardown completion queue */
 					/* object */
 	u32 pkt_info;			/* Tx PD Packet Information field */
+
+	/* completion queues left to drain, see cppi41_completion() */
+	struct tasklet_struct completion_tasklet;
+	u32 pend_rx;
+	u32 pend_tx;
+	u8 irq_masked;
 };
 
+static void cppi41_completion_tasklet(unsigned long data);
+
 #ifdef DEBUG_CPPI_TD
 static void print_pd_list(struct usb_pkt_desc *pd_pool_head)
 {
@@ -138,21 +162,27 @@ static void print_pd_list(struct usb_pkt_desc *pd_pool_head)
 }
 #endif
 
-static struct usb_pkt_desc *usb_get_free_pd(struct cppi41 *cppi)
+/*
+ * Each channel draws from its own slice of the PD region, so a busy Rx
+ * endpoint can't starve the others of descriptors.
+ */
+static struct usb_pkt_desc *usb_get_free_pd(struct cppi41_channel *cppi_ch)
 {
-	struct usb_pkt_desc *free_pd = cppi->pd_pool_head;
+	struct usb_pkt_desc *free_pd = cppi_ch->pd_pool_head;
 
 	if (free_pd != NULL) {
-		cppi->pd_pool_head = free_pd->next_pd_ptr;
+		cppi_ch->pd_pool_head = free_pd->next_pd_ptr;
 		free_pd->next_pd_ptr = NULL;
 	}
 	return free_pd;
 }
 
-static void usb_put_free_pd(struct cppi41 *cppi, struct usb_pkt_desc *free_pd)
+static void usb_put_free_pd(struct usb_pkt_desc *free_pd)
 {
-	free_pd->next_pd_ptr = cppi->pd_pool_head;
-	cppi->pd_pool_head = free_pd;
+	struct cppi41_channel *cppi_ch = free_pd->owner;
+
+	free_pd->next_pd_ptr = cppi_ch->pd_pool_head;
+	cppi_ch->pd_pool_head = free_pd;
 }
 
 /**
@@ -216,21 +246,6 @@ static int __init cppi41_controller_start(struct dma_controller *controller)
 		goto free_queue;
 	}
 
-	/*
-	 * "Slice" PDs one-by-one from the big chunk and
-	 * add them to the free pool.
-	 */
-	curr_pd = (struct usb_pkt_desc *)cppi->pd_mem;
-	pd_addr = cppi->pd_mem_phys;
-	for (i = 0; i < USB_CPPI41_MAX_PD; i++) {
-		curr_pd->dma_addr = pd_addr;
-
-		usb_put_free_pd(cppi, curr_pd);
-		curr_pd = (struct usb_pkt_desc *)((char *)curr_pd +
-						  USB_CPPI41_DESC_ALIGN);
-		pd_addr += USB_CPPI41_DESC_ALIGN;
-	}
-
 	/* Configure the Tx channels */
 	for (i = 0, cppi_ch = cppi->tx_cppi_ch;
 	     i < ARRAY_SIZE(cppi->tx_cppi_ch); ++i, ++cppi_ch) {
@@ -264,6 +279,31 @@ static int __init cppi41_controller_start(struct dma_controller *controller)
 		cppi_ch->channel.private_data = cppi;
 	}
 
+	/*
+	 * "Slice" PDs one-by-one from the big chunk and add them to
+	 * the channels' free pools, Tx channels first.
+	 */
+	curr_pd = (struct usb_pkt_desc *)cppi->pd_mem;
+	pd_addr = cppi->pd_mem_phys;
+	for (i = 0; i < USB_CPPI41_MAX_PD; i++) {
+		unsigned pool = i / USB_CPPI41_POOL_NUM_PD;
+
+		curr_pd->dma_addr = pd_addr;
+		if (pool < USB_CPPI41_NUM_CH)
+			curr_pd->owner = &cppi->tx_cppi_ch[pool];
+		else
+			curr_pd->owner =
+				&cppi->rx_cppi_ch[pool - USB_CPPI41_NUM_CH];
+
+		usb_put_free_pd(curr_pd);
+		curr_pd = (struct usb_pkt_desc *)((char *)curr_pd +
+						  USB_CPPI41_DESC_ALIGN);
+		pd_addr += USB_CPPI41_DESC_ALIGN;
+	}
+
+	cppi->pend_rx = cppi->pend_tx = 0;
+	cppi->irq_masked = 0;
+
 	/* Construct/store Tx PD packet info field for later use */
 	cppi->pkt_info = (CPPI41_PKT_TYPE_USB << CPPI41_PKT_TYPE_SHIFT) |
 			 (CPPI41_RETURN_LINKED << CPPI41_RETURN_POLICY_SHIFT) |
@@ -312,6 +352,12 @@ static int cppi41_controller_stop(struct dma_controller *controller)
 
 	cppi = container_of(controller, struct cppi41, controller);
 
+	tasklet_kill(&cppi->completion_tasklet);
+	if (cppi->irq_masked) {
+		cppi->irq_masked = 0;
+		enable_irq(cppi->musb->nIrq);
+	}
+
 	/*
 	 * pop all the teardwon descriptor queued to tdQueue
 	 */
@@ -561,7 +607,7 @@ static unsigned cppi41_next_tx_segment(struct cppi41_channel *tx_ch)
 		struct cppi41_host_pkt_desc *hw_desc;
 
 		/* Get Tx host packet descriptor from the free pool */
-		curr_pd = usb_get_free_pd(cppi);
+		curr_pd = usb_get_free_pd(tx_ch);
 		if (curr_pd == NULL) {
 			DBG(1, "No Tx PDs\n");
 			break;
@@ -700,26 +746,29 @@ static unsigned cppi41_next_rx_segment(struct cppi41_channel *rx_ch)
 	u32 pkt_size = rx_ch->pkt_size;
 	u32 max_rx_transfer_size = 128 * 1024;
 	u32 i, n_bd , pkt_len;
-	struct usb_gadget_driver *gadget_driver;
 
 	if (is_peripheral_active(cppi->musb)) {
-		/* TODO: temporary fix for CDC/RNDIS which needs to be in
-		 * GENERIC_RNDIS mode. Without this RNDIS gadget taking
-		 * more then 2K ms for a 64 byte pings.
+		/*
+		 * Generic RNDIS mode closes the PD on a short packet or once
+		 * the EP size register's count is reached, so a request of
+		 * N full packets ends without a ZLP and up to 64 KB of it
+		 * completes in one PD and one IRQ.  A tail shorter than the
+		 * packet size, or an endpoint the mode can't handle, is
+		 * received one packet per PD in transparent mode.
 		 */
-#ifdef CONFIG_USB_GADGET_MUSB_HDRC
-		gadget_driver = cppi->musb->gadget_driver;
-#endif
-		if (!strcmp(gadget_driver->driver.name, "g_ether")) {
+		if ((pkt_size & 0x3f) == 0 && length >= pkt_size) {
 			cppi41_mode_update(rx_ch, USB_GENERIC_RNDIS_MODE);
+			if (length > USB_GENERIC_RNDIS_EP_SIZE_MAX)
+				length = USB_GENERIC_RNDIS_EP_SIZE_MAX;
+			else
+				length -= length % pkt_size;
+			cppi41_set_ep_size(rx_ch, length);
 		} else {
-			max_rx_transfer_size = 512;
 			cppi41_mode_update(rx_ch, USB_TRANSPARENT_MODE);
+			if (length > pkt_size)
+				length = pkt_size;
 		}
-		pkt_len = 0;
-		if (rx_ch->length < max_rx_transfer_size)
-			pkt_len = rx_ch->length;
-		cppi41_set_ep_size(rx_ch, pkt_len);
+		max_rx_transfer_size = length ? length : pkt_size;
 	} else {
 		/*
 		 * Rx can use the generic RNDIS mode where we can
@@ -730,10 +779,10 @@ static unsigned cppi41_next_rx_segment(struct cppi41_channel *rx_ch)
 			cppi41_mode_update(rx_ch, USB_GENERIC_RNDIS_MODE);
 			cppi41_autoreq_update(rx_ch, USB_AUTOREQ_ALL_BUT_EOP);
 
-			if (likely(length < 0x10000))
+			if (likely(length < USB_GENERIC_RNDIS_EP_SIZE_MAX))
 				pkt_size = length - length % pkt_size;
 			else
-				pkt_size = 0x10000;
+				pkt_size = USB_GENERIC_RNDIS_EP_SIZE_MAX;
 			cppi41_set_ep_size(rx_ch, pkt_size);
 		} else {
 			cppi41_mode_update(rx_ch, USB_TRANSPARENT_MODE);
@@ -751,7 +800,7 @@ static unsigned cppi41_next_rx_segment(struct cppi41_channel *rx_ch)
 
 	for (i = 0; i < n_bd ; ++i) {
 		/* Get Rx packet descriptor from the free pool */
-		curr_pd = usb_get_free_pd(cppi);
+		curr_pd = usb_get_free_pd(rx_ch);
 		if (curr_pd == NULL) {
 			/* Shouldn't ever happen! */
 			DBG(4, "No Rx PDs\n");
@@ -849,6 +898,7 @@ static int cppi41_channel_program(struct dma_channel *channel,	u16 maxpacket,
 	cppi_ch->transfer_mode = mode;
 	cppi_ch->zlp_queued = 0;
 	cppi_ch->channel.actual_len = 0;
+	cppi_ch->iso_frames = NULL;
 
 	/* Tx or Rx channel? */
 	if (cppi_ch->transmit)
@@ -859,6 +909,160 @@ static int cppi41_channel_program(struct dma_channel *channel,	u16 maxpacket,
 	return	queued > 0;
 }
 
+/*
+ * CPPI 4.1 isochronous transfers:
+ * ================================
+ * Each frame of an isochronous URB is one USB packet, so it gets a PD of
+ * its own in the transparent mode, all of them queued up front (as many
+ * as the channel's pool holds, the rest as earlier ones complete).  The
+ * frames then move without any per-frame work from the HCD and the URB
+ * completes with a single musb_dma_completion() call.
+ *
+ * In the host Rx direction AUTOREQ keeps the IN tokens going for every
+ * frame but the last; it is switched off once only the last frame is
+ * outstanding.  If the completion is handled late, one more packet may
+ * have been requested; it waits in the FIFO and becomes the first frame
+ * of the next URB queued for the endpoint, which for a stream is where
+ * it belongs.
+ */
+
+/**
+ * cppi41_next_iso_segment - queue PDs for the frames not yet handed out
+ * @cppi_ch:	Tx or Rx channel
+ *
+ * Context: controller IRQ-locked
+ */
+static unsigned cppi41_next_iso_segment(struct cppi41_channel *cppi_ch)
+{
+	struct cppi41 *cppi = cppi_ch->channel.private_data;
+	struct usb_iso_packet_descriptor *d;
+	struct cppi41_host_pkt_desc *hw_desc;
+	struct usb_pkt_desc *curr_pd;
+	unsigned n = 0;
+
+	while (cppi_ch->iso_queued < cppi_ch->iso_nframes) {
+		curr_pd = usb_get_free_pd(cppi_ch);
+		if (curr_pd == NULL)
+			break;
+
+		d = cppi_ch->iso_frames + cppi_ch->iso_queued;
+		hw_desc = &curr_pd->hw_desc;
+		if (cppi_ch->transmit) {
+			hw_desc->desc_info = (CPPI41_DESC_TYPE_HOST <<
+					      CPPI41_DESC_TYPE_SHIFT) |
+					     d->length;
+			hw_desc->tag_info = cppi_ch->tag_info;
+			hw_desc->pkt_info = cppi->pkt_info;
+			hw_desc->buf_ptr = cppi_ch->start_addr + d->offset;
+			hw_desc->buf_len = d->length;
+			hw_desc->next_desc_ptr = 0;
+		} else {
+			hw_desc->orig_buf_ptr = cppi_ch->start_addr + d->offset;
+			hw_desc->orig_buf_len = d->length;
+		}
+
+		curr_pd->ch_num = cppi_ch->ch_num;
+		curr_pd->ep_num = cppi_ch->end_pt->epnum;
+		curr_pd->eop = 0;
+		curr_pd->iso_frame = cppi_ch->iso_queued++;
+
+		cppi41_queue_push(&cppi_ch->queue_obj, curr_pd->dma_addr,
+				  USB_CPPI41_DESC_ALIGN,
+				  cppi_ch->transmit ? d->length : 0);
+		n++;
+	}
+
+	return n;
+}
+
+/**
+ * cppi41_channel_program_iso - program channel for an isochronous transfer
+ * @channel:	the channel
+ * @maxpacket:	max packet size
+ * @dma_addr:	DMA address of the transfer buffer
+ * @frames:	the frame descriptors, offsets relative to @dma_addr; each
+ *		frame must fit one packet (and fill one, for Rx)
+ * @nframes:	number of frames
+ *
+ * Context: controller IRQ-locked
+ */
+static int cppi41_channel_program_iso(struct dma_channel *channel,
+				      u16 maxpacket, dma_addr_t dma_addr,
+				      struct usb_iso_packet_descriptor *frames,
+				      unsigned nframes)
+{
+	struct cppi41_channel *cppi_ch;
+
+	cppi_ch = container_of(channel, struct cppi41_channel, channel);
+
+	if (channel->status != MUSB_DMA_STATUS_FREE || !nframes)
+		return 0;
+
+	channel->status = MUSB_DMA_STATUS_BUSY;
+
+	cppi_ch->start_addr = dma_addr;
+	cppi_ch->curr_offset = 0;
+	cppi_ch->pkt_size = maxpacket;
+	cppi_ch->length = 0;
+	cppi_ch->transfer_mode = 0;
+	cppi_ch->zlp_queued = 0;
+	cppi_ch->channel.actual_len = 0;
+
+	cppi_ch->iso_frames = frames;
+	cppi_ch->iso_nframes = nframes;
+	cppi_ch->iso_queued = 0;
+	cppi_ch->iso_done = 0;
+
+	cppi41_mode_update(cppi_ch, USB_TRANSPARENT_MODE);
+	if (!cppi_ch->transmit)
+		cppi41_autoreq_update(cppi_ch, nframes > 1 ?
+				      USB_AUTOREQ_ALWAYS : USB_NO_AUTOREQ);
+
+	DBG(4, "%cX DMA%u, iso, maxpkt %u, addr %#x, %u frames\n",
+	    cppi_ch->transmit ? 'T' : 'R', cppi_ch->ch_num, maxpacket,
+	    dma_addr, nframes);
+
+	if (!cppi41_next_iso_segment(cppi_ch)) {
+		cppi_ch->iso_frames = NULL;
+		if (!cppi_ch->transmit)
+			cppi41_autoreq_update(cppi_ch, USB_NO_AUTOREQ);
+		channel->status = MUSB_DMA_STATUS_FREE;
+		return 0;
+	}
+	return 1;
+}
+
+/*
+ * Account a completed isochronous frame PD, giving the PD back; the
+ * transfer completes once all its frames have.
+ */
+static void cppi41_iso_pd_done(struct cppi41 *cppi,
+			       struct cppi41_channel *cppi_ch,
+			       struct usb_pkt_desc *curr_pd, u32 length)
+{
+	struct usb_iso_packet_descriptor *d;
+	u8 ep_num = curr_pd->ep_num;
+
+	d = cppi_ch->iso_frames + curr_pd->iso_frame;
+	d->actual_length = length;
+	d->status = 0;
+	cppi_ch->channel.actual_len += length;
+
+	usb_put_free_pd(curr_pd);
+
+	if (++cppi_ch->iso_done < cppi_ch->iso_nframes) {
+		if (!cppi_ch->transmit &&
+		    cppi_ch->iso_done == cppi_ch->iso_nframes - 1)
+			cppi41_autoreq_update(cppi_ch, USB_NO_AUTOREQ);
+		cppi41_next_iso_segment(cppi_ch);
+		return;
+	}
+
+	cppi_ch->iso_frames = NULL;
+	cppi_ch->channel.status = MUSB_DMA_STATUS_FREE;
+	musb_dma_completion(cppi->musb, ep_num, cppi_ch->transmit);
+}
+
 static struct usb_pkt_desc *usb_get_pd_ptr(struct cppi41 *cppi,
 					   unsigned long pd_addr)
 {
@@ -994,7 +1198,7 @@ static void usb_rx_ch_teardown(struct cppi41_channel *rx_ch)
 		 * Return Rx PDs to the software list --
 		 * this is protected by critical section.
 		 */
-		usb_put_free_pd(cppi, curr_pd);
+		usb_put_free_pd(curr_pd);
 	} while (0);
 
 	/* Now restore the default Rx completion queue... */
@@ -1045,7 +1249,7 @@ static int cppi41_channel_abort(struct dma_channel *channel)
 
 #ifdef DEBUG_CPPI_TD
 	printk("Before teardown:");
-	print_pd_list(cppi->pd_pool_head);
+	print_pd_list(cppi_ch->pd_pool_head);
 #endif
 
 	if (cppi_ch->transmit) {
@@ -1126,17 +1330,22 @@ static int cppi41_channel_abort(struct dma_channel *channel)
 		 * this is protected by critical section.
 		 */
 		dprintk("Returning PD %p to the free PD list\n", curr_pd);
-		usb_put_free_pd(cppi, curr_pd);
+		usb_put_free_pd(curr_pd);
 	}
 
 #ifdef DEBUG_CPPI_TD
 	printk("After teardown:");
-	print_pd_list(cppi->pd_pool_head);
+	print_pd_list(cppi_ch->pd_pool_head);
 #endif
 
 	/* Re-enable the DMA channel */
 	cppi41_dma_ch_enable(&cppi_ch->dma_ch_obj);
 
+	if (cppi_ch->iso_frames) {
+		cppi_ch->iso_frames = NULL;
+		if (!cppi_ch->transmit)
+			cppi41_autoreq_update(cppi_ch, USB_NO_AUTOREQ);
+	}
 	channel->status = MUSB_DMA_STATUS_FREE;
 
 	return 0;
@@ -1162,6 +1371,10 @@ struct dma_controller * __init dma_controller_create(struct musb  *musb,
 	cppi->controller.channel_release = cppi41_channel_release;
 	cppi->controller.channel_program = cppi41_channel_program;
 	cppi->controller.channel_abort = cppi41_channel_abort;
+	cppi->controller.channel_program_iso = cppi41_channel_program_iso;
+
+	tasklet_init(&cppi->completion_tasklet, cppi41_completion_tasklet,
+		     (unsigned long)cppi);
 
 	return &cppi->controller;
 }
@@ -1180,25 +1393,32 @@ void dma_controller_destroy(struct dma_controller *controller)
 	kfree(cppi);
 }
 
-static void usb_process_tx_queue(struct cppi41 *cppi, unsigned index)
+/*
+ * Returns the number of PDs popped, USB_CPPI41_POLL_BUDGET meaning there
+ * may be more left in the queue.
+ */
+static int usb_process_tx_queue(struct cppi41 *cppi, unsigned index)
 {
 	struct cppi41_queue_obj tx_queue_obj;
-	unsigned long pd_addr;
+	unsigned long pd_addr[USB_CPPI41_POLL_BUDGET];
+	int i, n;
 
 	if (cppi41_queue_init(&tx_queue_obj, usb_cppi41_info.q_mgr,
 			      usb_cppi41_info.tx_comp_q[index])) {
 		DBG(1, "ERROR: cppi41_queue_init failed for "
 		    "Tx completion queue");
-		return;
+		return 0;
 	}
 
-	while ((pd_addr = cppi41_queue_pop(&tx_queue_obj)) != 0) {
+	n = cppi41_queue_pop_batch(&tx_queue_obj, pd_addr,
+				   USB_CPPI41_POLL_BUDGET);
+	for (i = 0; i < n; i++) {
 		struct usb_pkt_desc *curr_pd;
 		struct cppi41_channel *tx_ch;
 		u8 ch_num, ep_num;
 		u32 length;
 
-		curr_pd = usb_get_pd_ptr(cppi, pd_addr);
+		curr_pd = usb_get_pd_ptr(cppi, pd_addr[i]);
 		if (curr_pd == NULL) {
 			ERR("Invalid PD popped from Tx completion queue\n");
 			continue;
@@ -1210,13 +1430,17 @@ static void usb_process_tx_queue(struct cppi41 *cppi, unsigned index)
 		length = curr_pd->hw_desc.buf_len;
 
 		tx_ch = &cppi->tx_cppi_ch[ch_num];
+		if (tx_ch->iso_frames) {
+			cppi41_iso_pd_done(cppi, tx_ch, curr_pd, length);
+			continue;
+		}
 		tx_ch->channel.actual_len += length;
 
 		/*
 		 * Return Tx PD to the software list --
 		 * this is protected by critical section
 		 */
-		usb_put_free_pd(cppi, curr_pd);
+		usb_put_free_pd(curr_pd);
 
 		if ((tx_ch->curr_offset < tx_ch->length) ||
 		    (tx_ch->transfer_mode && !tx_ch->zlp_queued))
@@ -1236,26 +1460,31 @@ static void usb_process_tx_queue(struct cppi41 *cppi, unsigned index)
 			musb_dma_completion(cppi->musb, ep_num, 1);
 		}
 	}
+
+	return n;
 }
 
-static void usb_process_rx_queue(struct cppi41 *cppi, unsigned index)
+static int usb_process_rx_queue(struct cppi41 *cppi, unsigned index)
 {
 	struct cppi41_queue_obj rx_queue_obj;
-	unsigned long pd_addr;
+	unsigned long pd_addr[USB_CPPI41_POLL_BUDGET];
+	int i, n;
 
 	if (cppi41_queue_init(&rx_queue_obj, usb_cppi41_info.q_mgr,
 			      usb_cppi41_info.rx_comp_q[index])) {
 		DBG(1, "ERROR: cppi41_queue_init failed for Rx queue\n");
-		return;
+		return 0;
 	}
 
-	while ((pd_addr = cppi41_queue_pop(&rx_queue_obj)) != 0) {
+	n = cppi41_queue_pop_batch(&rx_queue_obj, pd_addr,
+				   USB_CPPI41_POLL_BUDGET);
+	for (i = 0; i < n; i++) {
 		struct usb_pkt_desc *curr_pd;
 		struct cppi41_channel *rx_ch;
 		u8 ch_num, ep_num;
 		u32 length;
 
-		curr_pd = usb_get_pd_ptr(cppi, pd_addr);
+		curr_pd = usb_get_pd_ptr(cppi, pd_addr[i]);
 		if (curr_pd == NULL) {
 			ERR("Invalid PD popped from Rx completion queue\n");
 			continue;
@@ -1267,6 +1496,10 @@ static void usb_process_rx_queue(struct cppi41 *cppi, unsigned index)
 		length = curr_pd->hw_desc.buf_len;
 
 		rx_ch = &cppi->rx_cppi_ch[ch_num];
+		if (rx_ch->iso_frames) {
+			cppi41_iso_pd_done(cppi, rx_ch, curr_pd, length);
+			continue;
+		}
 		rx_ch->channel.actual_len += length;
 
 		if (curr_pd->eop) {
@@ -1284,7 +1517,7 @@ static void usb_process_rx_queue(struct cppi41 *cppi, unsigned index)
 		 * Return Rx PD to the software list --
 		 * this is protected by critical section
 		 */
-		usb_put_free_pd(cppi, curr_pd);
+		usb_put_free_pd(curr_pd);
 
 		if (unlikely(rx_ch->channel.actual_len >= rx_ch->length ||
 			     length < curr_pd->hw_desc.orig_buf_len)) {
@@ -1298,28 +1531,70 @@ static void usb_process_rx_queue(struct cppi41 *cppi, unsigned index)
 				cppi41_next_rx_segment(rx_ch);
 		}
 	}
+
+	return n;
 }
 
 /*
- * cppi41_completion - handle interrupts from the Tx/Rx completion queues
+ * cppi41_completion_tasklet - drain the pending Tx/Rx completion queues
+ *
+ * Each queue gets at most USB_CPPI41_POLL_BUDGET descriptors per run; the
+ * ones not emptied stay pending and the tasklet reschedules itself, so the
+ * controller IRQ is only unmasked again once everything's been drained.
  *
  * NOTE: since we have to manually prod the Rx process in the transparent mode,
  *	 we certainly want to handle the Rx queues first.
  */
-void cppi41_completion(struct musb *musb, u32 rx, u32 tx)
+static void cppi41_completion_tasklet(unsigned long data)
 {
-	struct cppi41 *cppi;
+	struct cppi41 *cppi = (struct cppi41 *)data;
+	struct musb *musb = cppi->musb;
+	unsigned long flags;
 	unsigned index;
+	u32 rx, tx;
 
-	cppi = container_of(musb->dma_controller, struct cppi41, controller);
+	spin_lock_irqsave(&musb->lock, flags);
 
 	/* Process packet descriptors from the Rx queues */
-	for (index = 0; rx != 0; rx >>= 1, index++)
-		if (rx & 1)
-			usb_process_rx_queue(cppi, index);
+	for (index = 0, rx = cppi->pend_rx; rx != 0; rx >>= 1, index++)
+		if ((rx & 1) && usb_process_rx_queue(cppi, index) <
+				USB_CPPI41_POLL_BUDGET)
+			cppi->pend_rx &= ~(1 << index);
 
 	/* Process packet descriptors from the Tx completion queues */
-	for (index = 0; tx != 0; tx >>= 1, index++)
-		if (tx & 1)
-			usb_process_tx_queue(cppi, index);
+	for (index = 0, tx = cppi->pend_tx; tx != 0; tx >>= 1, index++)
+		if ((tx & 1) && usb_process_tx_queue(cppi, index) <
+				USB_CPPI41_POLL_BUDGET)
+			cppi->pend_tx &= ~(1 << index);
+
+	if (cppi->pend_rx || cppi->pend_tx) {
+		tasklet_schedule(&cppi->completion_tasklet);
+	} else if (cppi->irq_masked) {
+		cppi->irq_masked = 0;
+		enable_irq(musb->nIrq);
+	}
+
+	spin_unlock_irqrestore(&musb->lock, flags);
+}
+
+/*
+ * cppi41_completion - handle interrupts from the Tx/Rx completion queues
+ *
+ * The completion queue interrupts stay asserted for as long as the queues
+ * aren't empty, so the controller IRQ is masked here and the queues are
+ * drained from cppi41_completion_tasklet() instead.
+ */
+void cppi41_completion(struct musb *musb, u32 rx, u32 tx)
+{
+	struct cppi41 *cppi;
+
+	cppi = container_of(musb->dma_controller, struct cppi41, controller);
+
+	cppi->pend_rx |= rx;
+	cppi->pend_tx |= tx;
+	if (!cppi->irq_masked) {
+		cppi->irq_masked = 1;
+		disable_irq_nosync(musb->nIrq);
+	}
+	tasklet_schedule(&cppi->completion_tasklet);
 }
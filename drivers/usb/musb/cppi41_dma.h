@@ -53,6 +53,9 @@ extern const struct usb_cppi41_info usb_cppi41_info;
  * @musb:	the controller
  * @rx: 	bitmask having bit N set if Rx queue N is not empty
  * @tx: 	bitmask having bit N set if Tx completion queue N is not empty
+ *
+ * Masks the controller IRQ and defers the queue processing to a tasklet;
+ * the IRQ is unmasked again once all the flagged queues are empty.
  */
 void cppi41_completion(struct musb *musb, u32 rx, u32 tx);
 
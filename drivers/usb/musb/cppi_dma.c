@@ -344,6 +344,8 @@ static void cppi_channel_release(struct dma_channel *channel)
 	/* for now, leave its cppi IRQ enabled (we won't trigger it) */
 	c->hw_ep = NULL;
 	channel->status = MUSB_DMA_STATUS_UNKNOWN;
+	if (!c->transmit)
+		del_timer(&c->rndis_timer);
 }
 
 /* Context: controller irqlocked */
@@ -719,24 +721,23 @@ cppi_next_tx_segment(struct musb *musb, struct cppi_channel *tx)
  */
 
 
-/* Heuristic, intended to kick in for ethernet/rndis peripheral ONLY
+/* Heuristic, intended to kick in for ethernet/rndis style transfers
  *
  * IFF
- *  (a)	peripheral mode ... since rndis peripherals could pad their
- *	writes to hosts, causing i/o failure; or we'd have to cope with
- *	a largely unknowable variety of host side protocol variants
- *  (b)	and short reads are NOT errors ... since full reads would
+ *  (a)	short reads are NOT errors ... since full reads would
  *	cause those same i/o failures
- *  (c)	and read length is
+ *  (b)	and read length is
  *	- less than 64KB (max per cppi descriptor)
  *	- not a multiple of 4096 (g_zero default, full reads typical)
  *	- N (>1) packets long, ditto (full reads not EXPECTED)
  * THEN
- *   try rx rndis mode
+ *   try rx rndis mode: one BD, and one IRQ, for the whole transfer.  On
+ *   the host side AUTOREQ issues the IN tokens after the HCD's first one.
  *
  * Cost of heuristic failing:  RXDMA wedges at the end of transfers that
- * fill out the whole buffer.  Buggy host side usb network drivers could
- * trigger that, but "in the field" such bugs seem to be all but unknown.
+ * fill out the whole buffer.  Peers that pad their writes, or host side
+ * protocol variants we can't know about, trigger that; it is caught by
+ * cppi_rndis_watchdog(), at the cost of a tick or two of latency.
  *
  * So this module parameter lets the heuristic be disabled.  When using
  * gadgetfs, the heuristic will probably need to be disabled.
@@ -746,6 +747,75 @@ static int cppi_rx_rndis = 1;
 module_param(cppi_rx_rndis, bool, 0);
 MODULE_PARM_DESC(cppi_rx_rndis, "enable/disable RX RNDIS heuristic");
 
+/* host side RNDIS mode RX: AUTOREQ "all but EOP", else "never" */
+static void cppi_rndis_autoreq(struct cppi_channel *rx,
+		void __iomem *tibase, int is_rndis)
+{
+	u32	val, tmp;
+
+	tmp = musb_readl(tibase, DAVINCI_AUTOREQ_REG);
+	val = tmp & ~((0x3) << (rx->index * 2));
+	if (is_rndis)
+		val |= ((0x1) << (rx->index * 2));
+	if (val != tmp)
+		musb_writel(tibase, DAVINCI_AUTOREQ_REG, val);
+}
+
+/*
+ * RNDIS mode RX only ends a segment on a short packet, so a segment the
+ * peer fills exactly with full packets never completes.  Catch that: the
+ * BD is still owned by CPPI, but its current buffer pointer in the RX
+ * state RAM sits at the end of the buffer, and still does a tick later.
+ * All the data is in memory by then, so tear the channel down and report
+ * the segment as complete.
+ */
+static void cppi_rndis_watchdog(unsigned long data)
+{
+	struct cppi_channel		*rx = (struct cppi_channel *)data;
+	struct cppi_rx_stateram __iomem	*rx_ram = rx->state_ram;
+	struct musb			*musb = rx->controller->musb;
+	struct cppi_descriptor		*bd;
+	unsigned long			flags;
+	u32				cur, len;
+	u16				csr;
+
+	spin_lock_irqsave(&musb->lock, flags);
+
+	bd = rx->head;
+	if (rx->channel.status != MUSB_DMA_STATUS_BUSY || !rx->is_rndis || !bd)
+		goto out;
+
+	/* catch latest BD writes from CPPI */
+	rmb();
+	cur = musb_readl(&rx_ram->rx_buf_current, 0);
+	if (!(bd->hw_options & CPPI_OWN_SET)
+			|| cur != bd->hw_bufp + bd->buflen
+			|| cur != rx->rndis_cur) {
+		/* receiving, completing, or first sight of a full buffer */
+		rx->rndis_cur = cur;
+		mod_timer(&rx->rndis_timer, jiffies + 1);
+		goto out;
+	}
+
+	DBG(2, "RX DMA%d rndis segment of %u wedged, recovering\n",
+			rx->index, bd->buflen);
+
+	len = rx->offset;
+	cppi_channel_abort(&rx->channel);
+	rx->channel.actual_len = len;
+
+	/* completion handlers expect DMAENAB still set */
+	musb_ep_select(musb->mregs, rx->index + 1);
+	csr = musb_readw(rx->hw_ep->regs, MUSB_RXCSR);
+	csr |= MUSB_RXCSR_DMAENAB | (is_host_active(musb)
+			? MUSB_RXCSR_H_WZC_BITS : MUSB_RXCSR_P_WZC_BITS);
+	musb_writew(rx->hw_ep->regs, MUSB_RXCSR, csr);
+
+	musb_dma_completion(musb, rx->index + 1, 0);
+out:
+	spin_unlock_irqrestore(&musb->lock, flags);
+}
+
 
 /**
  * cppi_next_rx_segment - dma read for the next chunk of a buffer
@@ -781,7 +851,6 @@ cppi_next_rx_segment(struct musb *musb, struct cppi_channel *rx, int onepacket)
 
 		/* maybe apply the heuristic above */
 		if (cppi_rx_rndis
-				&& is_peripheral_active(musb)
 				&& length > maxpacket
 				&& (length & ~0xffff) == 0
 				&& (length & 0x0fff) != 0
@@ -810,8 +879,10 @@ cppi_next_rx_segment(struct musb *musb, struct cppi_channel *rx, int onepacket)
 	 * finishes. So:  multipacket transfers involve two or more segments.
 	 * And always at least two IRQs ... RNDIS mode is not an option.
 	 */
-	if (is_host_active(musb))
+	if (is_host_active(musb)) {
+		cppi_rndis_autoreq(rx, tibase, is_rndis);
 		n_bds = cppi_autoreq_update(rx, tibase, onepacket, n_bds);
+	}
 
 	cppi_rndis_update(rx, 1, musb->ctrl_base, is_rndis);
 
@@ -940,6 +1011,11 @@ cppi_next_rx_segment(struct musb *musb, struct cppi_channel *rx, int onepacket)
 			n_bds + 2);
 	}
 
+	if (is_rndis) {
+		rx->rndis_cur = 0;
+		mod_timer(&rx->rndis_timer, jiffies + 1);
+	}
+
 	cppi_dump_rx(4, rx, "/S");
 }
 
@@ -1282,6 +1358,11 @@ irqreturn_t cppi_interrupt(int irq, void *dev_id)
 
 			/* all segments completed! */
 			rx_ch->channel.status = MUSB_DMA_STATUS_FREE;
+			if (rx_ch->is_rndis) {
+				del_timer(&rx_ch->rndis_timer);
+				if (is_host_active(musb))
+					cppi_rndis_autoreq(rx_ch, tibase, 0);
+			}
 
 			hw_ep = rx_ch->hw_ep;
 
@@ -1307,6 +1388,7 @@ dma_controller_create(struct musb *musb, void __iomem *mregs)
 	struct device		*dev = musb->controller;
 	struct platform_device	*pdev = to_platform_device(dev);
 	int			irq = platform_get_irq(pdev, 1);
+	int			i;
 
 	controller = kzalloc(sizeof *controller, GFP_KERNEL);
 	if (!controller)
@@ -1323,6 +1405,11 @@ dma_controller_create(struct musb *musb, void __iomem *mregs)
 	controller->controller.channel_program = cppi_channel_program;
 	controller->controller.channel_abort = cppi_channel_abort;
 
+	for (i = 0; i < ARRAY_SIZE(controller->rx); i++)
+		setup_timer(&controller->rx[i].rndis_timer,
+				cppi_rndis_watchdog,
+				(unsigned long)(controller->rx + i));
+
 	/* NOTE: allocating from on-chip SRAM would give the least
 	 * contention for memory access, if that ever matters here.
 	 */
@@ -1355,12 +1442,16 @@ dma_controller_create(struct musb *musb, void __iomem *mregs)
 void dma_controller_destroy(struct dma_controller *c)
 {
 	struct cppi	*cppi;
+	int		i;
 
 	cppi = container_of(c, struct cppi, controller);
 
 	if (cppi->irq)
 		free_irq(cppi->irq, cppi->musb);
 
+	for (i = 0; i < ARRAY_SIZE(cppi->rx); i++)
+		del_timer_sync(&cppi->rx[i].rndis_timer);
+
 	/* assert:  caller stopped the controller first */
 	dma_pool_destroy(cppi->pool);
 
@@ -1401,6 +1492,8 @@ static int cppi_channel_abort(struct dma_channel *channel)
 
 	if (!cppi_ch->transmit && cppi_ch->head)
 		cppi_dump_rxq(3, "/abort", cppi_ch);
+	if (!cppi_ch->transmit)
+		del_timer(&cppi_ch->rndis_timer);
 
 	mbase = controller->mregs;
 	tibase = controller->tibase;
@@ -7,6 +7,7 @@
 #include <linux/list.h>
 #include <linux/errno.h>
 #include <linux/dmapool.h>
+#include <linux/timer.h>
 
 #include "musb_dma.h"
 #include "musb_core.h"
@@ -105,6 +106,10 @@ struct cppi_channel {
 	struct cppi_descriptor	*tail;
 	struct cppi_descriptor	*last_processed;
 
+	/* RX RNDIS mode wedge detection, see cppi_rndis_watchdog() */
+	struct timer_list	rndis_timer;
+	u32			rndis_cur;
+
 	/* use tx_complete in host role to track endpoints waiting for
 	 * FIFONOTEMPTY to clear.
 	 */
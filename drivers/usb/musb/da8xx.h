@@ -38,6 +38,7 @@
 #define USB_INTR_SRC_MASKED_REG 0x38
 #define USB_END_OF_INTR_REG     0x3c
 #define USB_GENERIC_RNDIS_EP_SIZE_REG(n) (0x50 + (((n) - 1) << 2))
+#define USB_GENERIC_RNDIS_EP_SIZE_MAX    0x10000
 
 #define USB_TX_MODE_REG         USB_MODE_REG
 #define USB_RX_MODE_REG         USB_MODE_REG
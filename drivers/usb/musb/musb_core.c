@@ -1020,6 +1020,32 @@ static void musb_shutdown(struct platform_device *pdev)
 	defined(CONFIG_ARCH_OMAP2430) || defined(CONFIG_ARCH_OMAP34XX) || \
 	defined(CONFIG_MACH_OMAP3517EVM)
 static ushort __initdata fifo_mode = 4;
+#elif defined(CONFIG_ARCH_DAVINCI_DA8XX)
+/*
+ * DA8xx only has 4KB of FIFO RAM, so default to the table that double
+ * buffers the endpoints the configured class drivers will stream on.
+ * The gadget driver isn't bound yet when the FIFOs are laid out, so this
+ * goes by what's been built; "fifo_mode=N" still overrides it.
+ */
+#if defined(CONFIG_USB_GADGET_MUSB_HDRC) && \
+	(defined(CONFIG_USB_AUDIO) || defined(CONFIG_USB_AUDIO_MODULE))
+static ushort __initdata fifo_mode = 6;
+#elif defined(CONFIG_USB_MUSB_HDRC_HCD) && \
+	(defined(CONFIG_USB_VIDEO_CLASS) || \
+	 defined(CONFIG_USB_VIDEO_CLASS_MODULE) || \
+	 defined(CONFIG_SND_USB_AUDIO) || defined(CONFIG_SND_USB_AUDIO_MODULE))
+static ushort __initdata fifo_mode = 7;
+#elif (defined(CONFIG_USB_GADGET_MUSB_HDRC) && \
+	(defined(CONFIG_USB_FILE_STORAGE) || \
+	 defined(CONFIG_USB_FILE_STORAGE_MODULE) || \
+	 defined(CONFIG_USB_MASS_STORAGE) || \
+	 defined(CONFIG_USB_MASS_STORAGE_MODULE))) || \
+	(defined(CONFIG_USB_MUSB_HDRC_HCD) && \
+	(defined(CONFIG_USB_STORAGE) || defined(CONFIG_USB_STORAGE_MODULE)))
+static ushort __initdata fifo_mode = 3;
+#else
+static ushort __initdata fifo_mode = 2;
+#endif
 #else
 static ushort __initdata fifo_mode = 2;
 #endif
@@ -1145,6 +1171,32 @@ static struct fifo_cfg __initdata mode_5_cfg[] = {
 { .hw_ep_num = 15, .style = FIFO_RXTX, .maxpacket = 1024, },
 };
 
+/*
+ * mode 6 - fits in 4KB, peripheral ISO sink (e.g. g_audio): the gadget
+ * autoconfig hands out ep1 first, so that's where the double buffers go.
+ */
+static struct fifo_cfg __initdata mode_6_cfg[] = {
+{ .hw_ep_num = 1, .style = FIFO_TX,   .maxpacket = 512, .mode = BUF_DOUBLE, },
+{ .hw_ep_num = 1, .style = FIFO_RX,   .maxpacket = 1024, .mode = BUF_DOUBLE, },
+{ .hw_ep_num = 2, .style = FIFO_TX,   .maxpacket = 256, },
+{ .hw_ep_num = 2, .style = FIFO_RX,   .maxpacket = 256, },
+{ .hw_ep_num = 3, .style = FIFO_RXTX, .maxpacket = 256, },
+{ .hw_ep_num = 4, .style = FIFO_RXTX, .maxpacket = 64, },
+};
+
+/*
+ * mode 7 - fits in 4KB, host ISO capture (UVC, USB audio): ep1 stays the
+ * single-buffered bulk endpoint, ISO transfers get scheduled on ep2.
+ */
+static struct fifo_cfg __initdata mode_7_cfg[] = {
+{ .hw_ep_num = 1, .style = FIFO_TX,   .maxpacket = 512, },
+{ .hw_ep_num = 1, .style = FIFO_RX,   .maxpacket = 512, },
+{ .hw_ep_num = 2, .style = FIFO_TX,   .maxpacket = 256, .mode = BUF_DOUBLE, },
+{ .hw_ep_num = 2, .style = FIFO_RX,   .maxpacket = 1024, .mode = BUF_DOUBLE, },
+{ .hw_ep_num = 3, .style = FIFO_RXTX, .maxpacket = 256, },
+{ .hw_ep_num = 4, .style = FIFO_RXTX, .maxpacket = 64, },
+};
+
 /*
  * configure a fifo; for non-shared endpoints, this may be called
  * once for a tx fifo and once for an rx fifo.
@@ -1263,6 +1315,14 @@ static int __init ep_config_from_table(struct musb *musb)
 		cfg = mode_5_cfg;
 		n = ARRAY_SIZE(mode_5_cfg);
 		break;
+	case 6:
+		cfg = mode_6_cfg;
+		n = ARRAY_SIZE(mode_6_cfg);
+		break;
+	case 7:
+		cfg = mode_7_cfg;
+		n = ARRAY_SIZE(mode_7_cfg);
+		break;
 	}
 
 	printk(KERN_DEBUG "%s: setup fifo_mode %d\n",
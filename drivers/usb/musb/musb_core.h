@@ -281,6 +281,13 @@ struct musb_hw_ep {
 
 	u8			rx_reinit;
 	u8			tx_reinit;
+
+	/* utilisation, reported through procfs */
+	unsigned long		rx_urbs;
+	unsigned long		tx_urbs;
+	u64			rx_bytes;
+	u64			tx_bytes;
+	unsigned long		rx_nak_rotations;
 #endif
 
 #ifdef CONFIG_USB_GADGET_MUSB_HDRC
@@ -347,6 +354,7 @@ struct musb {
 	struct list_head	control;	/* of musb_qh */
 	struct list_head	in_bulk;	/* of musb_qh */
 	struct list_head	out_bulk;	/* of musb_qh */
+	unsigned long		bulk_promotions; /* qhs moved off bulk_ep */
 #endif
 
 	/* called with IRQs blocked; ON/nonzero implies starting a session,
@@ -115,6 +115,7 @@ enum dma_channel_status {
 };
 
 struct dma_controller;
+struct usb_iso_packet_descriptor;
 
 /**
  * struct dma_channel - A DMA channel.
@@ -161,6 +162,9 @@ dma_channel_status(struct dma_channel *c)
  * @channel_release: call this to release a DMA channel
  * @channel_abort: call this to abort a pending DMA transaction,
  *	returning it to FREE (but allocated) state
+ * @channel_program_iso: optional; queue every frame of an isochronous
+ *	transfer, one packet per frame, filling in each frame's actual_length
+ *	and status and completing once, after the last frame
  *
  * Controllers manage dma channels.
  */
@@ -175,6 +179,10 @@ struct dma_controller {
 							dma_addr_t dma_addr,
 							u32 length);
 	int			(*channel_abort)(struct dma_channel *);
+	int			(*channel_program_iso)(struct dma_channel *,
+				u16 maxpacket, dma_addr_t dma_addr,
+				struct usb_iso_packet_descriptor *frames,
+				unsigned nframes);
 };
 
 /* called after channel_program(), may indicate a fault */
@@ -45,6 +45,16 @@
 #include "musb_core.h"
 #include "musb_host.h"
 
+/*
+ * Interrupt and ISO transfers can't share a hardware endpoint the way bulk
+ * does on musb->bulk_ep, so bulk only gets an endpoint of its own while
+ * more than this many are left free for them.
+ */
+static unsigned periodic_reserve = 1;
+module_param(periodic_reserve, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(periodic_reserve,
+	"host endpoints per direction kept free for interrupt/ISO transfers");
+
 
 /* MUSB HOST status 22-mar-2006
  *
@@ -229,6 +239,7 @@ musb_start_urb(struct musb *musb, int is_in, struct musb_qh *qh)
 		break;
 	case USB_ENDPOINT_XFER_ISOC:
 		qh->iso_idx = 0;
+		qh->iso_dma = 0;
 		qh->frame = 0;
 		offset = urb->iso_frame_desc[0].offset;
 		len = urb->iso_frame_desc[0].length;
@@ -357,6 +368,99 @@ static inline void musb_save_toggle(struct musb_qh *qh, int is_in,
  *
  * Context: caller owns controller lock, IRQs are blocked
  */
+/*
+ * How well does hw_ep suit qh?  Returns the FIFO space to spare, negative if
+ * the endpoint can't be used for it.
+ */
+static int musb_ep_fit(struct musb_hw_ep *hw_ep, struct musb_qh *qh,
+		struct urb *urb, int is_in)
+{
+	int	diff;
+	u8	toggle;
+	u8	txtype;
+
+	if (is_in)
+		diff = hw_ep->max_packet_sz_rx;
+	else
+		diff = hw_ep->max_packet_sz_tx;
+	diff -= (qh->maxpacket * qh->hb_mult);
+	if (diff < 0 || is_in || qh->type != USB_ENDPOINT_XFER_BULK)
+		return diff;
+
+	/*
+	 * Mentor controller has a bug in that if we schedule
+	 * a BULK Tx transfer on an endpoint that had earlier
+	 * handled ISOC then the BULK transfer has to start on
+	 * a zero toggle.  If the BULK transfer starts on a 1
+	 * toggle then this transfer will fail as the mentor
+	 * controller starts the Bulk transfer on a 0 toggle
+	 * irrespective of the programming of the toggle bits
+	 * in the TXCSR register.  Check for this condition
+	 * while allocating the EP for a Tx Bulk transfer.  If
+	 * so skip this EP.
+	 */
+	toggle = usb_gettoggle(urb->dev, qh->epnum, !is_in);
+	txtype = (musb_readb(hw_ep->regs, MUSB_TXTYPE) >> 4) & 0x3;
+	if (toggle && (txtype == USB_ENDPOINT_XFER_ISOC))
+		return -1;
+
+	return diff;
+}
+
+/*
+ * hw_ep just went idle; if bulk qhs are taking turns on bulk_ep, give it to
+ * the one waiting that moves the most data (high speed first, then larger
+ * packets) so e.g. a disk stops round-robining with a serial adapter's
+ * reads.  The ring's head is live on bulk_ep and stays where it is.
+ *
+ * Returns the promoted qh, for the caller to start.
+ */
+static struct musb_qh *
+musb_bulk_promote(struct musb *musb, struct musb_hw_ep *hw_ep, int is_in)
+{
+	struct list_head	*head = is_in ? &musb->in_bulk : &musb->out_bulk;
+	struct musb_hw_ep	*ep;
+	struct musb_qh		*qh, *best = NULL;
+	unsigned		free = 0;
+	int			epnum;
+
+	if (list_empty(head) || list_is_singular(head))
+		return NULL;
+
+	for (epnum = 1, ep = musb->endpoints + 1;
+			epnum < musb->nr_endpoints;
+			epnum++, ep++)
+		if (ep != musb->bulk_ep && !musb_ep_get_qh(ep, is_in))
+			free++;
+	if (free <= periodic_reserve)
+		return NULL;
+
+	list_for_each_entry(qh, head, ring) {
+		if (qh == first_qh(head) || !qh->is_ready || !qh->dev)
+			continue;
+		if (musb_ep_fit(hw_ep, qh, next_urb(qh), is_in) < 0)
+			continue;
+		if (!best || qh->dev->speed > best->dev->speed
+				|| (qh->dev->speed == best->dev->speed
+					&& qh->maxpacket > best->maxpacket))
+			best = qh;
+	}
+	if (!best)
+		return NULL;
+
+	DBG(4, "qh %p promoted to %cX%d\n", best, is_in ? 'R' : 'T',
+	    hw_ep->epnum);
+
+	/* no NAK limit once it owns the endpoint, as in musb_urb_enqueue() */
+	list_del(&best->ring);
+	best->mux = 0;
+	best->intv_reg = 0;
+	best->hw_ep = hw_ep;
+	musb->bulk_promotions++;
+
+	return best;
+}
+
 static void musb_advance_schedule(struct musb *musb, struct urb *urb,
 				  struct musb_hw_ep *hw_ep, int is_in)
 {
@@ -367,6 +471,14 @@ static void musb_advance_schedule(struct musb *musb, struct urb *urb,
 
 	status = (urb->status == -EINPROGRESS) ? 0 : urb->status;
 
+	if (is_in) {
+		ep->rx_urbs++;
+		ep->rx_bytes += urb->actual_length;
+	} else {
+		ep->tx_urbs++;
+		ep->tx_bytes += urb->actual_length;
+	}
+
 	/* save toggle eagerly, for paranoia */
 	switch (qh->type) {
 	case USB_ENDPOINT_XFER_BULK:
@@ -421,6 +533,10 @@ static void musb_advance_schedule(struct musb *musb, struct urb *urb,
 			 */
 			kfree(qh);
 			qh = NULL;
+
+			/* the endpoint's free now; a queued bulk qh may take it */
+			if (ep != musb->bulk_ep)
+				qh = musb_bulk_promote(musb, ep, is_in);
 			break;
 		}
 	}
@@ -612,6 +728,33 @@ musb_rx_reinit(struct musb *musb, struct musb_qh *qh, struct musb_hw_ep *ep)
 	ep->rx_reinit = 0;
 }
 
+/*
+ * Hand all frames of an isochronous URB to the DMA controller at once,
+ * when it can take them: the frames then move without an interrupt and
+ * reprogramming per frame, and the URB completes once.  Each frame must
+ * be a single packet, and for IN one that a full packet fits in.
+ */
+static bool musb_iso_dma_program(struct dma_controller *dma,
+		struct dma_channel *channel, struct musb_qh *qh,
+		struct urb *urb, int is_in)
+{
+	int	i;
+
+	if (!dma->channel_program_iso || qh->hb_mult != 1)
+		return false;
+
+	for (i = 0; i < urb->number_of_packets; i++) {
+		u32	len = urb->iso_frame_desc[i].length;
+
+		if (is_in ? len < qh->maxpacket : len > qh->maxpacket)
+			return false;
+	}
+
+	return dma->channel_program_iso(channel, qh->maxpacket,
+			urb->transfer_dma, urb->iso_frame_desc,
+			urb->number_of_packets);
+}
+
 static bool musb_tx_dma_program(struct dma_controller *dma,
 		struct musb_hw_ep *hw_ep, struct musb_qh *qh,
 		struct urb *urb, u32 offset, u32 length)
@@ -655,6 +798,11 @@ static bool musb_tx_dma_program(struct dma_controller *dma,
 
 	qh->segsize = length;
 
+	qh->iso_dma = usb_pipeisoc(urb->pipe) && qh->iso_idx == 0 &&
+		musb_iso_dma_program(dma, channel, qh, urb, 0);
+	if (qh->iso_dma)
+		return true;
+
 	if (!dma->channel_program(channel, pkt_size, mode,
 			urb->transfer_dma + offset, length)) {
 		dma->channel_release(channel);
@@ -851,10 +999,15 @@ static void musb_ep_program(struct musb *musb, u8 epnum,
 				csr = musb_readw(hw_ep->regs,
 						MUSB_RXCSR);
 
+				qh->iso_dma = qh->type == USB_ENDPOINT_XFER_ISOC
+					&& musb_iso_dma_program(dma_controller,
+						dma_channel, qh, urb, 1);
+
 				/* unless caller treats short rx transfers as
 				 * errors, we dare not queue multiple transfers.
 				 */
-				dma_ok = dma_controller->channel_program(
+				dma_ok = qh->iso_dma ||
+					dma_controller->channel_program(
 						dma_channel, packet_sz,
 						!(urb->transfer_flags
 							& URB_SHORT_NOT_OK),
@@ -1259,7 +1412,11 @@ void musb_host_tx(struct musb *musb, u8 epnum)
 			length = qh->segsize;
 		qh->offset += length;
 
-		if (usb_pipeisoc(pipe)) {
+		if (usb_pipeisoc(pipe) && qh->iso_dma) {
+			/* the DMA filled in every frame */
+			qh->iso_idx = urb->number_of_packets;
+			done = true;
+		} else if (usb_pipeisoc(pipe)) {
 			struct usb_iso_packet_descriptor	*d;
 
 			d = urb->iso_frame_desc + qh->iso_idx;
@@ -1408,6 +1565,7 @@ static void musb_bulk_rx_nak_timeout(struct musb *musb, struct musb_hw_ep *ep)
 
 		/* move cur_qh to end of queue */
 		list_move_tail(&cur_qh->ring, &musb->in_bulk);
+		ep->rx_nak_rotations++;
 
 		/* get the next qh from musb->in_bulk */
 		next_qh = first_qh(&musb->in_bulk);
@@ -1577,7 +1735,11 @@ void musb_host_rx(struct musb *musb, u8 epnum)
 
 		musb_writew(hw_ep->regs, MUSB_RXCSR, val);
 
-		if (usb_pipeisoc(pipe)) {
+		if (usb_pipeisoc(pipe) && qh->iso_dma) {
+			/* the DMA filled in every frame */
+			qh->iso_idx = urb->number_of_packets;
+			done = true;
+		} else if (usb_pipeisoc(pipe)) {
 			struct usb_iso_packet_descriptor *d;
 
 			d = urb->iso_frame_desc + qh->iso_idx;
@@ -1790,10 +1952,9 @@ static int musb_schedule(
 	int			idle;
 	int			best_diff;
 	int			best_end, epnum;
+	int			free = 0;
 	struct musb_hw_ep	*hw_ep = NULL;
 	struct list_head	*head = NULL;
-	u8			toggle;
-	u8			txtype;
 	struct urb		*urb = next_urb(qh);
 
 	/* use fixed hardware for control and bulk */
@@ -1826,38 +1987,18 @@ static int musb_schedule(
 		if (hw_ep == musb->bulk_ep)
 			continue;
 
-		if (is_in)
-			diff = hw_ep->max_packet_sz_rx;
-		else
-			diff = hw_ep->max_packet_sz_tx;
-		diff -= (qh->maxpacket * qh->hb_mult);
-
+		free++;
+		diff = musb_ep_fit(hw_ep, qh, urb, is_in);
 		if (diff >= 0 && best_diff > diff) {
-
-			/*
-			 * Mentor controller has a bug in that if we schedule
-			 * a BULK Tx transfer on an endpoint that had earlier
-			 * handled ISOC then the BULK transfer has to start on
-			 * a zero toggle.  If the BULK transfer starts on a 1
-			 * toggle then this transfer will fail as the mentor
-			 * controller starts the Bulk transfer on a 0 toggle
-			 * irrespective of the programming of the toggle bits
-			 * in the TXCSR register.  Check for this condition
-			 * while allocating the EP for a Tx Bulk transfer.  If
-			 * so skip this EP.
-			 */
-			hw_ep = musb->endpoints + epnum;
-			toggle = usb_gettoggle(urb->dev, qh->epnum, !is_in);
-			txtype = (musb_readb(hw_ep->regs, MUSB_TXTYPE)
-					>> 4) & 0x3;
-			if (!is_in && (qh->type == USB_ENDPOINT_XFER_BULK) &&
-				toggle && (txtype == USB_ENDPOINT_XFER_ISOC))
-				continue;
-
 			best_diff = diff;
 			best_end = epnum;
 		}
 	}
+
+	/* bulk can always fall back to ep1, periodic transfers can't */
+	if (qh->type == USB_ENDPOINT_XFER_BULK && free <= periodic_reserve)
+		best_end = -1;
+
 	/* use bulk reserved ep1 if no other ep is free */
 	if (best_end < 0 && qh->type == USB_ENDPOINT_XFER_BULK) {
 		hw_ep = musb->bulk_ep;
@@ -71,6 +71,7 @@ struct musb_qh {
 	u16			maxpacket;
 	u16			frame;		/* for periodic schedule */
 	unsigned		iso_idx;	/* in urb->iso_frame_desc[] */
+	u8			iso_dma;	/* whole iso urb queued to DMA */
 };
 
 /* map from control or bulk queue head to the first qh on that ring */
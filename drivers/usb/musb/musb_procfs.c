@@ -239,8 +239,24 @@ dump_end_info(struct musb *musb, u8 epnum, char *aBuffer, unsigned max)
 				else
 					dump_rx = 0;
 				dump_tx = !dump_rx;
-			} else
+			} else {
+				if (!hw_ep->rx_urbs && !hw_ep->tx_urbs)
+					break;
+				code = snprintf(buf, max,
+					"\nEP%d: idle; rx %lu urbs %llu bytes, "
+					"tx %lu urbs %llu bytes\n",
+					epnum,
+					hw_ep->rx_urbs,
+					(unsigned long long) hw_ep->rx_bytes,
+					hw_ep->tx_urbs,
+					(unsigned long long) hw_ep->tx_bytes);
+				if (code <= 0)
+					break;
+				code = min(code, (int) max);
+				buf += code;
+				max -= code;
 				break;
+			}
 			/* END TEMPORARY */
 
 
@@ -274,6 +290,18 @@ dump_end_info(struct musb *musb, u8 epnum, char *aBuffer, unsigned max)
 				buf += code;
 				max -= code;
 
+				code = snprintf(buf, max,
+					"    util: %lu urbs, %llu bytes, "
+					"%lu nak rotations\n",
+					hw_ep->rx_urbs,
+					(unsigned long long) hw_ep->rx_bytes,
+					hw_ep->rx_nak_rotations);
+				if (code <= 0)
+					break;
+				code = min(code, (int) max);
+				buf += code;
+				max -= code;
+
 				if ((is_cppi_enabled() || is_cppi41_enabled())
 						&& epnum
 						&& hw_ep->rx_channel) {
@@ -362,6 +390,16 @@ dump_end_info(struct musb *musb, u8 epnum, char *aBuffer, unsigned max)
 				buf += code;
 				max -= code;
 
+				code = snprintf(buf, max,
+					"    util: %lu urbs, %llu bytes\n",
+					hw_ep->tx_urbs,
+					(unsigned long long) hw_ep->tx_bytes);
+				if (code <= 0)
+					break;
+				code = min(code, (int) max);
+				buf += code;
+				max -= code;
+
 				if ((is_cppi_enabled() || is_cppi41_enabled())
 						&& epnum
 						&& hw_ep->tx_channel) {
@@ -518,8 +556,9 @@ static int dump_header_stats(struct musb *musb, char *buffer)
 #endif
 
 #ifdef	CONFIG_USB_MUSB_HDRC_HCD
-	code = sprintf(buffer, "Root port status: %08x\n",
-			musb->port1_status);
+	code = sprintf(buffer, "Root port status: %08x, "
+			"bulk promotions %lu\n",
+			musb->port1_status, musb->bulk_promotions);
 	if (code <= 0)
 		goto done;
 	buffer += code;
@@ -30,12 +30,18 @@
 #include <linux/clk.h>
 #include <linux/cpufreq.h>
 #include <linux/console.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <video/da8xx-fb.h>
+#include <video/davinci-fbaccel.h>
 
 #define DRIVER_NAME "da8xx_lcdc"
 
 /* LCD Status Register */
+#define LCD_END_OF_FRAME1		BIT(9)
 #define LCD_END_OF_FRAME0		BIT(8)
+#define LCD_PL_LOAD_DONE		BIT(6)
 #define LCD_FIFO_UNDERFLOW		BIT(5)
 #define LCD_SYNC_LOST			BIT(2)
 
@@ -46,6 +52,10 @@
 #define LCD_DMA_BURST_4			0x2
 #define LCD_DMA_BURST_8			0x3
 #define LCD_DMA_BURST_16		0x4
+#define LCD_DMA_BURST_MASK		LCD_DMA_BURST_SIZE(0x7)
+#define LCD_DMA_TH_FIFO_READY(x)	((x) << 8)
+#define LCD_DMA_TH_FIFO_MASK		LCD_DMA_TH_FIFO_READY(0x7)
+#define LCD_DMA_TH_FIFO_MAX		6	/* 512 words */
 #define LCD_END_OF_FRAME_INT_ENA	BIT(2)
 #define LCD_DUAL_FRAME_BUFFER_ENABLE	BIT(0)
 
@@ -57,11 +67,13 @@
 #define LCD_PALETTE_LOAD_MODE(x)	((x) << 20)
 #define PALETTE_AND_DATA		0x00
 #define PALETTE_ONLY			0x01
+#define DATA_ONLY			0x02
 
 #define LCD_MONO_8BIT_MODE		BIT(9)
 #define LCD_RASTER_ORDER		BIT(8)
 #define LCD_TFT_MODE			BIT(7)
 #define LCD_UNDERFLOW_INT_ENA		BIT(6)
+#define LCD_PL_INT_ENA			BIT(4)
 #define LCD_MONOCHROME_MODE		BIT(1)
 #define LCD_RASTER_ENABLE		BIT(0)
 #define LCD_TFT_ALT_ENABLE		BIT(23)
@@ -86,6 +98,8 @@
 #define  LCD_DMA_CTRL_REG			0x40
 #define  LCD_DMA_FRM_BUF_BASE_ADDR_0_REG	0x44
 #define  LCD_DMA_FRM_BUF_CEILING_ADDR_0_REG	0x48
+#define  LCD_DMA_FRM_BUF_BASE_ADDR_1_REG	0x4C
+#define  LCD_DMA_FRM_BUF_CEILING_ADDR_1_REG	0x50
 
 #define WSI_TIMEOUT	50
 #define PALETTE_SIZE	256
@@ -94,6 +108,24 @@
 #define UPPER_MARGIN	32
 #define LOWER_MARGIN	32
 
+static unsigned int num_buffers = 2;
+module_param(num_buffers, uint, S_IRUGO);
+MODULE_PARM_DESC(num_buffers,
+		"frames of virtual height to pan between (default: 2)");
+
+/*
+ * Each FIFO underflow slows the pixel clock by one more divider step,
+ * up to max_derate percent, so the raster asks less of the EMIF while
+ * other masters are busy.  After DERATE_HOLD without an underflow the
+ * clock is sped back up a step at a time.
+ */
+static unsigned int max_derate = 10;
+module_param(max_derate, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(max_derate,
+		"max % the refresh slows down on underflows (default: 10)");
+
+#define DERATE_HOLD	(10 * HZ)
+
 static resource_size_t da8xx_fb_reg_base;
 static struct resource *lcdc_regs;
 
@@ -115,8 +147,30 @@ struct da8xx_fb_par {
 	unsigned short pseudo_palette[16];
 	unsigned int databuf_sz;
 	unsigned int palette_sz;
+	unsigned int vram_size;		/* pixel data of all the frames */
+	unsigned int alloc_sz;		/* frames plus the palette, paged */
 	unsigned int pxl_clk;
 	int blank;
+	int palette_dirty;		/* changed while blanked */
+
+	/* frame the DMA switches to at the next end of frame */
+	spinlock_t lock;
+	u32 dma_start;
+	u32 dma_end;
+	int pan_pending;		/* FB base registers still to update */
+	int vsync_flag;
+	wait_queue_head_t vsync_wait;
+
+	/* raster DMA tuning */
+	int dma_burst;
+	int fifo_th;
+	unsigned int priority;
+	int (*set_priority)(unsigned int prio);
+	unsigned int underflows;
+	unsigned long last_underflow;
+	unsigned int clk_div;		/* divider for the nominal pxl_clk */
+	unsigned int clk_derate;	/* steps added to it on underflows */
+	struct delayed_work derate_work;
 #ifdef CONFIG_CPU_FREQ
 	struct notifier_block	freq_transition;
 #endif
@@ -218,24 +272,48 @@ static inline void lcd_disable_raster(void)
 		lcdc_write(reg & ~LCD_RASTER_ENABLE, LCD_RASTER_CTRL_REG);
 }
 
+/*
+ * The palette is loaded on its own, then the DMA is switched to data
+ * only, alternating between FB0 and FB1.  That lets the end of frame
+ * interrupt point the idle one at a new frame for panning.  The raster
+ * must be disabled when the load mode changes.
+ */
 static void lcd_blit(int load_mode, struct da8xx_fb_par *par)
 {
-	u32 tmp = par->p_palette_base + par->databuf_sz - 4;
-	u32 reg;
-
-	/* Update the databuf in the hw. */
-	lcdc_write(par->p_palette_base, LCD_DMA_FRM_BUF_BASE_ADDR_0_REG);
-	lcdc_write(tmp, LCD_DMA_FRM_BUF_CEILING_ADDR_0_REG);
+	unsigned long flags;
+	u32 reg, reg_dma;
 
-	/* Start the DMA. */
 	reg = lcdc_read(LCD_RASTER_CTRL_REG);
 	reg &= ~(3 << 20);
-	if (load_mode == LOAD_DATA)
-		reg |= LCD_PALETTE_LOAD_MODE(PALETTE_AND_DATA);
-	else if (load_mode == LOAD_PALETTE)
-		reg |= LCD_PALETTE_LOAD_MODE(PALETTE_ONLY);
+	reg_dma = lcdc_read(LCD_DMA_CTRL_REG);
+
+	if (load_mode == LOAD_DATA) {
+		reg |= LCD_PALETTE_LOAD_MODE(DATA_ONLY);
+		reg_dma |= LCD_END_OF_FRAME_INT_ENA |
+			LCD_DUAL_FRAME_BUFFER_ENABLE;
+
+		spin_lock_irqsave(&par->lock, flags);
+		lcdc_write(par->dma_start, LCD_DMA_FRM_BUF_BASE_ADDR_0_REG);
+		lcdc_write(par->dma_end, LCD_DMA_FRM_BUF_CEILING_ADDR_0_REG);
+		lcdc_write(par->dma_start, LCD_DMA_FRM_BUF_BASE_ADDR_1_REG);
+		lcdc_write(par->dma_end, LCD_DMA_FRM_BUF_CEILING_ADDR_1_REG);
+		spin_unlock_irqrestore(&par->lock, flags);
+	} else if (load_mode == LOAD_PALETTE) {
+		reg |= LCD_PALETTE_LOAD_MODE(PALETTE_ONLY) | LCD_PL_INT_ENA;
+		reg_dma &= ~LCD_DUAL_FRAME_BUFFER_ENABLE;
+
+		dsb();
+		lcdc_write(par->p_palette_base,
+				LCD_DMA_FRM_BUF_BASE_ADDR_0_REG);
+		lcdc_write(par->p_palette_base + par->palette_sz - 4,
+				LCD_DMA_FRM_BUF_CEILING_ADDR_0_REG);
+	}
 
+	lcdc_write(reg_dma, LCD_DMA_CTRL_REG);
 	lcdc_write(reg, LCD_RASTER_CTRL_REG);
+
+	/* Start the DMA. */
+	lcd_enable_raster();
 }
 
 /* Configure the Burst Size and fifo threhold of DMA */
@@ -243,7 +321,11 @@ static int lcd_cfg_dma(int burst_size,  int fifo_th)
 {
 	u32 reg;
 
-	reg = lcdc_read(LCD_DMA_CTRL_REG) & 0x00000001;
+	if (fifo_th < 0 || fifo_th > LCD_DMA_TH_FIFO_MAX)
+		return -EINVAL;
+
+	reg = lcdc_read(LCD_DMA_CTRL_REG) &
+		~(LCD_DMA_BURST_MASK | LCD_DMA_TH_FIFO_MASK);
 	switch (burst_size) {
 	case 1:
 		reg |= LCD_DMA_BURST_SIZE(LCD_DMA_BURST_1);
@@ -264,7 +346,7 @@ static int lcd_cfg_dma(int burst_size,  int fifo_th)
 		return -EINVAL;
 	}
 
-	reg |= (fifo_th << 8);
+	reg |= LCD_DMA_TH_FIFO_READY(fifo_th);
 
 	lcdc_write(reg, LCD_DMA_CTRL_REG);
 
@@ -425,6 +507,7 @@ static int fb_setcolreg(unsigned regno, unsigned red, unsigned green,
 	struct da8xx_fb_par *par = info->par;
 	unsigned short *palette = (unsigned short *)par->v_palette_base;
 	u_short pal;
+	int update_hw = 0;
 
 	if (regno > 255)
 		return 1;
@@ -441,7 +524,10 @@ static int fb_setcolreg(unsigned regno, unsigned red, unsigned green,
 		pal |= (green & 0x00f0);
 		pal |= (blue & 0x000f);
 
-		palette[regno] = pal;
+		if (palette[regno] != pal) {
+			update_hw = 1;
+			palette[regno] = pal;
+		}
 
 	} else if ((info->var.bits_per_pixel == 16) && regno < 16) {
 		red >>= (16 - info->var.red.length);
@@ -455,7 +541,20 @@ static int fb_setcolreg(unsigned regno, unsigned red, unsigned green,
 
 		par->pseudo_palette[regno] = red | green | blue;
 
-		palette[0] = 0x4000;
+		if (palette[0] != 0x4000) {
+			update_hw = 1;
+			palette[0] = 0x4000;
+		}
+	}
+
+	/* The DMA only reads the palette when told to reload it */
+	if (update_hw) {
+		if (par->blank) {
+			par->palette_dirty = 1;
+		} else {
+			lcd_disable_raster();
+			lcd_blit(LOAD_PALETTE, par);
+		}
 	}
 
 	return 0;
@@ -477,6 +576,11 @@ static void lcd_calc_clk_divider(struct da8xx_fb_par *par)
 
 	lcd_clk = clk_get_rate(par->lcdc_clk);
 	div = lcd_clk / par->pxl_clk;
+	par->clk_div = div;
+
+	if (par->clk_derate > div * max_derate / 100)
+		par->clk_derate = div * max_derate / 100;
+	div += par->clk_derate;
 
 	/* Configure the LCD clock divisor. */
 	lcdc_write(LCD_CLK_DIVISOR(div) |
@@ -545,16 +649,63 @@ static irqreturn_t lcdc_irq_handler(int irq, void *arg)
 {
 	struct da8xx_fb_par *par = arg;
 	u32 stat = lcdc_read(LCD_STAT_REG);
+	u32 reg;
 
 	if ((stat & LCD_SYNC_LOST) && (stat & LCD_FIFO_UNDERFLOW)) {
 		lcd_disable_raster();
 		clk_disable(par->lcdc_clk);
 		lcdc_write(stat, LCD_STAT_REG);
+
+		par->underflows++;
+		par->last_underflow = jiffies;
+		if (par->clk_derate < par->clk_div * max_derate / 100) {
+			par->clk_derate++;
+			lcd_calc_clk_divider(par);
+		}
+		if (par->clk_derate)
+			schedule_delayed_work(&par->derate_work, DERATE_HOLD);
+
 		lcd_enable_raster();
 		clk_enable(par->lcdc_clk);
-	} else
+	} else if (stat & LCD_PL_LOAD_DONE) {
+		/* the raster must be off before the PL status is cleared */
+		lcd_disable_raster();
 		lcdc_write(stat, LCD_STAT_REG);
 
+		reg = lcdc_read(LCD_RASTER_CTRL_REG) & ~LCD_PL_INT_ENA;
+		lcdc_write(reg, LCD_RASTER_CTRL_REG);
+
+		/* palette is in, now scan out the pixel data */
+		lcd_blit(LOAD_DATA, par);
+	} else {
+		lcdc_write(stat, LCD_STAT_REG);
+
+		/* FBn is idle until the other frame ends: aim it */
+		spin_lock(&par->lock);
+		if (stat & LCD_END_OF_FRAME0) {
+			lcdc_write(par->dma_start,
+					LCD_DMA_FRM_BUF_BASE_ADDR_0_REG);
+			lcdc_write(par->dma_end,
+					LCD_DMA_FRM_BUF_CEILING_ADDR_0_REG);
+			if (par->pan_pending)
+				par->pan_pending--;
+		}
+		if (stat & LCD_END_OF_FRAME1) {
+			lcdc_write(par->dma_start,
+					LCD_DMA_FRM_BUF_BASE_ADDR_1_REG);
+			lcdc_write(par->dma_end,
+					LCD_DMA_FRM_BUF_CEILING_ADDR_1_REG);
+			if (par->pan_pending)
+				par->pan_pending--;
+		}
+		if ((stat & (LCD_END_OF_FRAME0 | LCD_END_OF_FRAME1)) &&
+		    !par->pan_pending) {
+			par->vsync_flag = 1;
+			wake_up_interruptible(&par->vsync_wait);
+		}
+		spin_unlock(&par->lock);
+	}
+
 	return IRQ_HANDLED;
 }
 
@@ -603,9 +754,200 @@ static int fb_check_var(struct fb_var_screeninfo *var,
 	var->green.msb_right = 0;
 	var->blue.msb_right = 0;
 	var->transp.msb_right = 0;
+
+	/* panning is limited to the frames allocated at probe */
+	if (var->yres_virtual < var->yres)
+		var->yres_virtual = var->yres;
+	if (info->fix.line_length &&
+	    var->yres_virtual > info->fix.smem_len / info->fix.line_length)
+		err = -EINVAL;
 	return err;
 }
 
+/* Speed the pixel clock back up once the bus has been quiet for a while */
+static void lcd_derate_work(struct work_struct *work)
+{
+	struct da8xx_fb_par *par = container_of(work, struct da8xx_fb_par,
+						derate_work.work);
+	unsigned long quiet = par->last_underflow + DERATE_HOLD;
+
+	if (time_before(jiffies, quiet)) {
+		schedule_delayed_work(&par->derate_work, quiet - jiffies);
+		return;
+	}
+
+	disable_irq(par->irq);
+	if (par->clk_derate) {
+		par->clk_derate--;
+		lcd_disable_raster();
+		lcd_calc_clk_divider(par);
+		if (!par->blank)
+			lcd_enable_raster();
+	}
+	enable_irq(par->irq);
+
+	if (par->clk_derate)
+		schedule_delayed_work(&par->derate_work, DERATE_HOLD);
+}
+
+/* Change the DMA request parameters with the raster stopped */
+static int lcd_retune_dma(struct da8xx_fb_par *par, int burst, int fifo_th)
+{
+	int ret;
+
+	disable_irq(par->irq);
+	lcd_disable_raster();
+	ret = lcd_cfg_dma(burst, fifo_th);
+	if (!ret) {
+		par->dma_burst = burst;
+		par->fifo_th = fifo_th;
+	} else {
+		lcd_cfg_dma(par->dma_burst, par->fifo_th);
+	}
+	if (!par->blank)
+		lcd_enable_raster();
+	enable_irq(par->irq);
+
+	return ret;
+}
+
+static ssize_t dma_burst_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+
+	return sprintf(buf, "%d\n", par->dma_burst);
+}
+
+static ssize_t dma_burst_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+	unsigned long val;
+	int ret;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+
+	ret = lcd_retune_dma(par, val, par->fifo_th);
+	return ret ? ret : count;
+}
+
+static ssize_t fifo_threshold_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+
+	return sprintf(buf, "%d\n", par->fifo_th);
+}
+
+static ssize_t fifo_threshold_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+	unsigned long val;
+	int ret;
+
+	if (strict_strtoul(buf, 0, &val) || val > LCD_DMA_TH_FIFO_MAX)
+		return -EINVAL;
+
+	ret = lcd_retune_dma(par, par->dma_burst, val);
+	return ret ? ret : count;
+}
+
+static ssize_t priority_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+
+	if (!par->set_priority)
+		return -ENODEV;
+
+	return sprintf(buf, "%u\n", par->priority);
+}
+
+static ssize_t priority_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+	unsigned long val;
+	int ret;
+
+	if (!par->set_priority)
+		return -ENODEV;
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+
+	ret = par->set_priority(val);
+	if (ret)
+		return ret;
+
+	par->priority = val;
+	return count;
+}
+
+static ssize_t underflows_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+
+	return sprintf(buf, "%u\n", par->underflows);
+}
+
+/* any write clears the count */
+static ssize_t underflows_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+
+	par->underflows = 0;
+	return count;
+}
+
+static ssize_t refresh_derate_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct fb_info *info = dev_get_drvdata(dev);
+	struct da8xx_fb_par *par = info->par;
+
+	return sprintf(buf, "%u/%u\n", par->clk_derate, par->clk_div);
+}
+
+static DEVICE_ATTR(dma_burst, S_IRUGO | S_IWUSR,
+		   dma_burst_show, dma_burst_store);
+static DEVICE_ATTR(fifo_threshold, S_IRUGO | S_IWUSR,
+		   fifo_threshold_show, fifo_threshold_store);
+static DEVICE_ATTR(priority, S_IRUGO | S_IWUSR,
+		   priority_show, priority_store);
+static DEVICE_ATTR(underflows, S_IRUGO | S_IWUSR,
+		   underflows_show, underflows_store);
+static DEVICE_ATTR(refresh_derate, S_IRUGO, refresh_derate_show, NULL);
+
+static struct attribute *da8xx_fb_attrs[] = {
+	&dev_attr_dma_burst.attr,
+	&dev_attr_fifo_threshold.attr,
+	&dev_attr_priority.attr,
+	&dev_attr_underflows.attr,
+	&dev_attr_refresh_derate.attr,
+	NULL,
+};
+
+static const struct attribute_group da8xx_fb_attr_group = {
+	.attrs = da8xx_fb_attrs,
+};
+
 #ifdef CONFIG_CPU_FREQ
 static int lcd_da8xx_cpufreq_transition(struct notifier_block *nb,
 				     unsigned long val, void *data)
@@ -648,6 +990,8 @@ static int __devexit fb_remove(struct platform_device *dev)
 #ifdef CONFIG_CPU_FREQ
 		lcd_da8xx_cpufreq_deregister(par);
 #endif
+		sysfs_remove_group(&dev->dev.kobj, &da8xx_fb_attr_group);
+
 		if (par->panel_power_ctrl)
 			par->panel_power_ctrl(0);
 
@@ -659,10 +1003,10 @@ static int __devexit fb_remove(struct platform_device *dev)
 
 		unregister_framebuffer(info);
 		fb_dealloc_cmap(&info->cmap);
-		dma_free_coherent(NULL, par->databuf_sz + PAGE_SIZE,
-					info->screen_base - PAGE_SIZE,
+		dma_free_writecombine(NULL, par->alloc_sz, info->screen_base,
 					info->fix.smem_start);
 		free_irq(par->irq, par);
+		cancel_delayed_work_sync(&par->derate_work);
 		clk_disable(par->lcdc_clk);
 		clk_put(par->lcdc_clk);
 		framebuffer_release(info);
@@ -673,6 +1017,29 @@ static int __devexit fb_remove(struct platform_device *dev)
 	return 0;
 }
 
+/*
+ * Sleep until the next end of frame, or until a pan done before the
+ * call has reached both FB0 and FB1, when the frame panned away from is
+ * no longer being scanned out.
+ */
+static int fb_wait_for_vsync(struct fb_info *info)
+{
+	struct da8xx_fb_par *par = info->par;
+	int ret;
+
+	spin_lock_irq(&par->lock);
+	par->vsync_flag = 0;
+	spin_unlock_irq(&par->lock);
+
+	ret = wait_event_interruptible_timeout(par->vsync_wait,
+			par->vsync_flag != 0, HZ / 5);
+	if (ret < 0)
+		return ret;
+	if (ret == 0)
+		return -ETIMEDOUT;
+	return 0;
+}
+
 static int fb_ioctl(struct fb_info *info, unsigned int cmd,
 			  unsigned long arg)
 {
@@ -702,6 +1069,10 @@ static int fb_ioctl(struct fb_info *info, unsigned int cmd,
 					sync_arg.pulse_width,
 					sync_arg.front_porch);
 		break;
+	case FBIO_WAITFORVSYNC:
+		return fb_wait_for_vsync(info);
+	case FBIO_COPYAREA:
+		return davinci_fb_ioctl_copyarea(info, (void __user *)arg);
 	default:
 		return -EINVAL;
 	}
@@ -722,7 +1093,12 @@ static int cfb_blank(int blank, struct fb_info *info)
 		if (par->panel_power_ctrl)
 			par->panel_power_ctrl(1);
 
-		lcd_enable_raster();
+		if (par->palette_dirty) {
+			par->palette_dirty = 0;
+			lcd_blit(LOAD_PALETTE, par);
+		} else {
+			lcd_enable_raster();
+		}
 		break;
 	case FB_BLANK_POWERDOWN:
 		if (par->panel_power_ctrl)
@@ -737,13 +1113,40 @@ static int cfb_blank(int blank, struct fb_info *info)
 	return ret;
 }
 
+/*
+ * Only records the new frame; the end of frame interrupt hands it to
+ * each FB base register while the DMA scans the other.
+ */
+static int da8xx_pan_display(struct fb_var_screeninfo *var,
+			     struct fb_info *info)
+{
+	struct da8xx_fb_par *par = info->par;
+	struct fb_fix_screeninfo *fix = &info->fix;
+	u32 start;
+
+	start = fix->smem_start + var->yoffset * fix->line_length +
+		var->xoffset * info->var.bits_per_pixel / 8;
+
+	/* the new frame must be in memory before the DMA can fetch it */
+	dsb();
+
+	spin_lock_irq(&par->lock);
+	par->dma_start = start;
+	par->dma_end = start + info->var.yres * fix->line_length - 4;
+	par->pan_pending = 2;
+	spin_unlock_irq(&par->lock);
+
+	return 0;
+}
+
 static struct fb_ops da8xx_fb_ops = {
 	.owner = THIS_MODULE,
 	.fb_check_var = fb_check_var,
 	.fb_setcolreg = fb_setcolreg,
+	.fb_pan_display = da8xx_pan_display,
 	.fb_ioctl = fb_ioctl,
-	.fb_fillrect = cfb_fillrect,
-	.fb_copyarea = cfb_copyarea,
+	.fb_fillrect = davinci_fb_fillrect,
+	.fb_copyarea = davinci_fb_copyarea,
 	.fb_imageblit = cfb_imageblit,
 	.fb_blank = cfb_blank,
 };
@@ -822,6 +1225,16 @@ static int __init fb_probe(struct platform_device *device)
 	par = da8xx_fb_info->par;
 	par->lcdc_clk = fb_clk;
 	par->pxl_clk = lcdc_info->pxl_clk;
+	spin_lock_init(&par->lock);
+	init_waitqueue_head(&par->vsync_wait);
+	INIT_DELAYED_WORK(&par->derate_work, lcd_derate_work);
+	par->dma_burst = lcd_cfg->dma_burst_sz;
+	par->fifo_th = lcd_cfg->fifo_th;
+	if (fb_pdata->set_priority) {
+		par->set_priority = fb_pdata->set_priority;
+		par->priority = fb_pdata->priority;
+		par->set_priority(par->priority);
+	}
 	if (fb_pdata->panel_power_ctrl) {
 		par->panel_power_ctrl = fb_pdata->panel_power_ctrl;
 		par->panel_power_ctrl(1);
@@ -833,9 +1246,21 @@ static int __init fb_probe(struct platform_device *device)
 		goto err_release_fb;
 	}
 
-	/* allocate frame buffer */
-	da8xx_fb_info->screen_base = dma_alloc_coherent(NULL,
-					par->databuf_sz + PAGE_SIZE,
+	/*
+	 * allocate frame buffer: num_buffers frames followed by the palette.
+	 * The frames start the allocation so smem_start is page aligned for
+	 * mmap and buffer import; the palette is only fetched on its own
+	 * (PALETTE_ONLY) when it changes, so it costs nothing per frame.
+	 * The LCDC only reads it, so it is bufferable like the user mmap
+	 * (see fb_pgprotect()); the write buffer is drained before the DMA
+	 * is pointed at a frame or the palette.
+	 */
+	if (!num_buffers)
+		num_buffers = 1;
+	par->vram_size = (par->databuf_sz - par->palette_sz) * num_buffers;
+	par->alloc_sz = PAGE_ALIGN(par->vram_size + par->palette_sz);
+	da8xx_fb_info->screen_base = dma_alloc_writecombine(NULL,
+					par->alloc_sz,
 					(resource_size_t *)
 					&da8xx_fb_info->fix.smem_start,
 					GFP_KERNEL | GFP_DMA);
@@ -847,17 +1272,15 @@ static int __init fb_probe(struct platform_device *device)
 		goto err_release_fb;
 	}
 
-	/* move palette base pointer by (PAGE_SIZE - palette_sz) bytes */
-	par->v_palette_base = da8xx_fb_info->screen_base +
-				(PAGE_SIZE - par->palette_sz);
-	par->p_palette_base = da8xx_fb_info->fix.smem_start +
-				(PAGE_SIZE - par->palette_sz);
+	/* the palette sits right after the last frame */
+	par->v_palette_base = da8xx_fb_info->screen_base + par->vram_size;
+	par->p_palette_base = da8xx_fb_info->fix.smem_start + par->vram_size;
 
-	/* the rest of the frame buffer is pixel data */
-	da8xx_fb_info->screen_base = par->v_palette_base + par->palette_sz;
-	da8xx_fb_fix.smem_start = par->p_palette_base + par->palette_sz;
-	da8xx_fb_fix.smem_len = par->databuf_sz - par->palette_sz;
+	da8xx_fb_fix.smem_start = da8xx_fb_info->fix.smem_start;
+	da8xx_fb_fix.smem_len = par->vram_size;
 	da8xx_fb_fix.line_length = (lcdc_info->width * lcd_cfg->bpp) / 8;
+	par->dma_start = da8xx_fb_fix.smem_start;
+	par->dma_end = par->dma_start + par->databuf_sz - par->palette_sz - 4;
 
 	par->irq = platform_get_irq(device, 0);
 	if (par->irq < 0) {
@@ -876,7 +1299,7 @@ static int __init fb_probe(struct platform_device *device)
 	da8xx_fb_var.xres_virtual = lcdc_info->width;
 
 	da8xx_fb_var.yres = lcdc_info->height;
-	da8xx_fb_var.yres_virtual = lcdc_info->height;
+	da8xx_fb_var.yres_virtual = lcdc_info->height * num_buffers;
 
 	da8xx_fb_var.grayscale =
 	    lcd_cfg->p_disp_panel->panel_shade == MONOCHROME ? 1 : 0;
@@ -903,11 +1326,11 @@ static int __init fb_probe(struct platform_device *device)
 	if (ret)
 		goto err_free_irq;
 
-	/* First palette_sz byte of the frame buffer is the palette */
+	/* The palette after the frames holds palette_sz bytes */
 	da8xx_fb_info->cmap.len = par->palette_sz;
 
-	/* Flush the buffer to the screen. */
-	lcd_blit(LOAD_DATA, par);
+	/* Load the palette; the interrupt then starts the pixel data. */
+	lcd_blit(LOAD_PALETTE, par);
 
 	/* initialize var_screeninfo */
 	da8xx_fb_var.activate = FB_ACTIVATE_FORCE;
@@ -930,6 +1353,9 @@ static int __init fb_probe(struct platform_device *device)
 	}
 #endif
 
+	if (sysfs_create_group(&device->dev.kobj, &da8xx_fb_attr_group))
+		dev_warn(&device->dev, "failed to create sysfs attributes\n");
+
 	/* enable raster engine */
 	lcd_enable_raster();
 
@@ -953,10 +1379,10 @@ err_dealloc_cmap:
 
 err_free_irq:
 	free_irq(par->irq, par);
+	cancel_delayed_work_sync(&par->derate_work);
 
 err_release_fb_mem:
-	dma_free_coherent(NULL, par->databuf_sz + PAGE_SIZE,
-				da8xx_fb_info->screen_base - PAGE_SIZE,
+	dma_free_writecombine(NULL, par->alloc_sz, da8xx_fb_info->screen_base,
 				da8xx_fb_info->fix.smem_start);
 
 err_release_fb:
@@ -0,0 +1,129 @@
+/*
+ * EDMA 2D acceleration shared by the DaVinci frame buffer drivers
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Solid fills and screen to screen copies become one AB-synchronized
+ * EDMA set on the bulk copy channel, a line per array with the frame
+ * buffer pitch as the array index.  Small rectangles, raster ops other
+ * than ROP_COPY, pixels smaller than a byte, and calls from atomic
+ * context go to the cfb_* routines.  Glyph expansion has no EDMA
+ * equivalent, so imageblit stays on the CPU.
+ */
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/fb.h>
+#include <linux/uaccess.h>
+
+#include <mach/edma.h>
+
+#include <video/davinci-fbaccel.h>
+
+static unsigned int threshold = 4096;
+module_param(threshold, uint, 0644);
+MODULE_PARM_DESC(threshold,
+		"smallest rectangle handed to EDMA in bytes (default: 4096)");
+
+static bool davinci_fb_accel_ok(struct fb_info *info, u32 width, u32 height)
+{
+	u32 bpp = info->var.bits_per_pixel;
+
+	if (bpp != 8 && bpp != 16 && bpp != 32)
+		return false;
+	return width * height * (bpp / 8) >= threshold;
+}
+
+void davinci_fb_fillrect(struct fb_info *info, const struct fb_fillrect *rect)
+{
+	u32 cpp = info->var.bits_per_pixel / 8;
+	u32 pitch = info->fix.line_length;
+	u32 color;
+
+	if (info->state != FBINFO_STATE_RUNNING)
+		return;
+
+	if (rect->rop != ROP_COPY ||
+	    !davinci_fb_accel_ok(info, rect->width, rect->height))
+		goto cpu;
+
+	/* same color lookup as cfb_fillrect() */
+	if (info->fix.visual == FB_VISUAL_TRUECOLOR ||
+	    info->fix.visual == FB_VISUAL_DIRECTCOLOR)
+		color = ((u32 *)info->pseudo_palette)[rect->color];
+	else
+		color = rect->color;
+
+	/* earlier CPU drawing may still be in the write buffer */
+	dsb();
+	if (!edma_fill_2d(info->fix.smem_start + rect->dy * pitch +
+				rect->dx * cpp, pitch, color, cpp,
+				rect->width * cpp, rect->height))
+		return;
+cpu:
+	cfb_fillrect(info, rect);
+}
+EXPORT_SYMBOL(davinci_fb_fillrect);
+
+void davinci_fb_copyarea(struct fb_info *info, const struct fb_copyarea *area)
+{
+	u32 cpp = info->var.bits_per_pixel / 8;
+	int pitch = info->fix.line_length;
+	u32 sy = area->sy, dy = area->dy;
+
+	if (info->state != FBINFO_STATE_RUNNING)
+		return;
+
+	if (!davinci_fb_accel_ok(info, area->width, area->height))
+		goto cpu;
+
+	/* lines are copied in order: nothing may be overwritten unread */
+	if (dy == sy && area->dx > area->sx &&
+	    area->dx < area->sx + area->width)
+		goto cpu;
+	if (dy > sy) {
+		sy += area->height - 1;
+		dy += area->height - 1;
+		pitch = -pitch;
+	}
+
+	dsb();
+	if (!edma_copy_2d(info->fix.smem_start +
+				dy * info->fix.line_length + area->dx * cpp,
+			pitch,
+			info->fix.smem_start +
+				sy * info->fix.line_length + area->sx * cpp,
+			pitch, area->width * cpp, area->height))
+		return;
+cpu:
+	cfb_copyarea(info, area);
+}
+EXPORT_SYMBOL(davinci_fb_copyarea);
+
+/* FBIO_COPYAREA: the rectangle is checked against the virtual screen */
+int davinci_fb_ioctl_copyarea(struct fb_info *info, void __user *argp)
+{
+	struct fb_var_screeninfo *var = &info->var;
+	struct fb_copyarea area;
+
+	if (copy_from_user(&area, argp, sizeof(area)))
+		return -EFAULT;
+
+	if (area.width > var->xres_virtual ||
+	    area.height > var->yres_virtual ||
+	    area.sx > var->xres_virtual - area.width ||
+	    area.dx > var->xres_virtual - area.width ||
+	    area.sy > var->yres_virtual - area.height ||
+	    area.dy > var->yres_virtual - area.height)
+		return -EINVAL;
+
+	davinci_fb_copyarea(info, &area);
+	return 0;
+}
+EXPORT_SYMBOL(davinci_fb_ioctl_copyarea);
+
+MODULE_DESCRIPTION("EDMA acceleration for DaVinci frame buffers");
+MODULE_LICENSE("GPL");
@@ -33,6 +33,13 @@
 #include <asm/uaccess.h>
 
 #include <video/davincifb.h>
+#include <video/davinci-fbaccel.h>
+#ifdef CONFIG_VIDEO_VPSS_SYSTEM
+#include <media/davinci/vpss.h>
+
+/* display side VPSS memory priority request, vpss_prio=display */
+static int vpss_prio_held;
+#endif
 #include <asm/system.h>
 
 #define MODULE_NAME "davincifb"
@@ -112,6 +119,11 @@ static struct dm_info {
 	unsigned long vsync_cnt;
 	int timeout;
 
+	/* layout queued by FBIO_SETCOMPOSITION for the next vsync */
+	spinlock_t comp_lock;
+	struct davincifb_composition comp;
+	int comp_pending;
+
 	/* this is the function that configures the output device (NTSC/PAL/LCD)
 	 * for the required output format (composite/s-video/component/rgb)
 	 */
@@ -270,6 +282,8 @@ static struct dmparams_t {
 	u32 osd1_yres;
 	u32 osd1_xpos;
 	u32 osd1_ypos;
+
+	u8 display_prio;	/* keep VPSS memory priority while capturing */
 } dmparams = {
 	NTSC,		/* output */
 	    COMPOSITE,		/* format */
@@ -289,6 +303,7 @@ static int davincifb_venc_check_mode(const struct dm_win_info *w,
 }
 
 static void set_sdram_params(char *id, u32 addr, u32 line_length);
+static void davincifb_apply_composition(struct dm_info *dm);
 static irqreturn_t davincifb_isr(int irq, void *arg)
 {
 	struct dm_info *dm = (struct dm_info *)arg;
@@ -326,6 +341,7 @@ static irqreturn_t davincifb_isr(int irq, void *arg)
 					 dm->vid1->info.fix.line_length);
 			dm->vid1->sdram_address = 0;
 		}
+		davincifb_apply_composition(dm);
 		return IRQ_HANDLED;
 	} else {
 		++dm->vsync_cnt;
@@ -728,6 +744,142 @@ static void set_win_mode(char *id)
 
 }
 
+static struct dm_win_info *win_by_index(struct dm_info *dm, int i)
+{
+	switch (i) {
+	case 0:
+		return dm->vid0;
+	case 1:
+		return dm->vid1;
+	case 2:
+		return dm->osd0;
+	case 3:
+		return dm->osd1;
+	}
+	return NULL;
+}
+
+/* Checks a composition from user space before it is queued. Windows keep
+ * their display size (xres, yres); zooming only changes how much of the
+ * framebuffer is fetched to fill it.
+ */
+static int davincifb_check_composition(struct dm_info *dm,
+				       const struct davincifb_composition *c)
+{
+	const struct davincifb_win_config *wc;
+	struct dm_win_info *w;
+	int i;
+
+	for (i = 0; i < DAVINCIFB_NR_WINS; i++) {
+		wc = &c->win[i];
+		if (!(wc->flags & DAVINCIFB_WIN_UPDATE))
+			continue;
+		w = win_by_index(dm, i);
+		if (!w)
+			return -ENODEV;
+		if (wc->zoom_h > 2 || wc->zoom_v > 2 || wc->blend > 7)
+			return -EINVAL;
+		if (wc->xpos + w->info.var.xres > DISP_XRES ||
+		    wc->ypos + w->info.var.yres > DISP_YRES)
+			return -EINVAL;
+	}
+	if (c->transp_key > 0xffff)
+		return -EINVAL;
+
+	return 0;
+}
+
+/* Programs the queued composition. Called from the ISR in the same place the
+ * panned framebuffer addresses are latched, so all windows change together.
+ */
+static void davincifb_apply_composition(struct dm_info *dm)
+{
+	struct davincifb_win_config *wc;
+	struct fb_var_screeninfo *v;
+	struct dm_win_info *w;
+	int i;
+
+	spin_lock(&dm->comp_lock);
+	if (!dm->comp_pending) {
+		spin_unlock(&dm->comp_lock);
+		return;
+	}
+
+	for (i = 0; i < DAVINCIFB_NR_WINS; i++) {
+		wc = &dm->comp.win[i];
+		w = win_by_index(dm, i);
+		if (!(wc->flags & DAVINCIFB_WIN_UPDATE) || !w)
+			continue;
+		v = &w->info.var;
+
+		w->x = wc->xpos;
+		w->y = wc->ypos;
+		set_win_position(w->info.fix.id,
+				 x_pos(w), y_pos(w), v->xres, v->yres / 2);
+		set_zoom(i, wc->zoom_h, wc->zoom_v);
+
+		if (w == dm->osd0) {
+			dispc_reg_merge(OSD_OSDWIN0MD,
+					wc->blend << OSD_OSDWIN0MD_BLND0_SHIFT,
+					OSD_OSDWIN0MD_BLND0);
+			if (wc->flags & DAVINCIFB_WIN_TRANSP)
+				dispc_reg_out(OSD_TRANSPVA, dm->comp.transp_key);
+			dispc_reg_merge(OSD_OSDWIN0MD,
+					(wc->flags & DAVINCIFB_WIN_TRANSP) ?
+					OSD_OSDWIN0MD_TE0 : 0,
+					OSD_OSDWIN0MD_TE0);
+		} else if (w == dm->osd1 &&
+			   !(dispc_reg_in(OSD_OSDWIN1MD) & OSD_OSDWIN1MD_OASW)) {
+			/* as the attribute window, OSD1 carries per-pixel
+			 * blend values instead, see FBIO_SETATTRIBUTE
+			 */
+			dispc_reg_merge(OSD_OSDWIN1MD,
+					wc->blend << OSD_OSDWIN1MD_BLND1_SHIFT,
+					OSD_OSDWIN1MD_BLND1);
+		}
+
+		set_win_enable(w->info.fix.id, wc->flags & DAVINCIFB_WIN_ENABLE);
+		wc->flags = 0;
+	}
+	dm->comp_pending = 0;
+	spin_unlock(&dm->comp_lock);
+
+	wake_up_interruptible(&dm->vsync_wait);
+}
+
+/* Queues a composition for the next vsync and waits until it has been
+ * programmed. Entries not yet applied from an earlier call are kept unless
+ * this one updates the same window.
+ */
+static int davincifb_set_composition(struct dm_info *dm,
+				     const struct davincifb_composition *c)
+{
+	unsigned long flags;
+	int i, ret;
+
+	ret = davincifb_check_composition(dm, c);
+	if (ret)
+		return ret;
+
+	spin_lock_irqsave(&dm->comp_lock, flags);
+	for (i = 0; i < DAVINCIFB_NR_WINS; i++)
+		if (c->win[i].flags & DAVINCIFB_WIN_UPDATE)
+			dm->comp.win[i] = c->win[i];
+	dm->comp.transp_key = c->transp_key;
+	dm->comp_pending = 1;
+	spin_unlock_irqrestore(&dm->comp_lock, flags);
+
+	ret = wait_event_interruptible_timeout(dm->vsync_wait,
+					       !dm->comp_pending,
+					       dm->timeout);
+	if (ret < 0)
+		return ret;
+	if (ret == 0)
+		return -ETIMEDOUT;
+
+	return 0;
+}
+
 /**
  *      davincifb_set_par - Optional function. Alters the hardware state.
  *      @info: frame buffer structure that represents a single frame buffer
@@ -773,6 +925,7 @@ static int davincifb_ioctl(struct fb_info *info, unsigned int cmd,
 	void __user *argp = (void __user *)arg;
 	struct fb_fillrect rect;
 	struct zoom_params zoom;
+	struct davincifb_composition comp;
 	long std = 0;
 
 	switch (cmd) {
@@ -818,6 +971,12 @@ static int davincifb_ioctl(struct fb_info *info, unsigned int cmd,
 			return -EINVAL;
 		}
 		break;
+	case FBIO_SETCOMPOSITION:
+		if (copy_from_user(&comp, argp, sizeof(comp)))
+			return -EFAULT;
+		return davincifb_set_composition(w->dm, &comp);
+	case FBIO_COPYAREA:
+		return davinci_fb_ioctl_copyarea(info, argp);
 	case FBIO_GETSTD:
 		std = ((dmparams.output << 16) | (dmparams.format));	//(NTSC <<16) | (COPOSITE);
 		if (copy_to_user(argp, &std, sizeof(u_int32_t)))
@@ -1067,6 +1226,10 @@ int __init davincifb_setup(char *options)
 				dmparams.osd1_xpos = xpos;
 				dmparams.osd1_ypos = ypos;
 			}
+		} else if (!strncmp(this_opt, "vpss_prio=", 10)) {
+			/* capture (default): VPFE first while streaming */
+			dmparams.display_prio =
+				!strncmp(this_opt + 10, "display", 7);
 		}
 	}
 	printk(KERN_INFO "DaVinci: "
@@ -1131,8 +1294,8 @@ static int mem_release(struct dm_win_info *w)
 		iounmap((void *)w->fb_base);
 		release_mem_region(w->fb_base_phys, w->fb_size);
 	} else
-		dma_free_coherent(NULL, w->fb_size, (void *)w->fb_base,
-				  w->fb_base_phys);
+		dma_free_writecombine(NULL, w->fb_size, (void *)w->fb_base,
+				      w->fb_base_phys);
 	kfree(w);
 	return (0);
 }
@@ -1165,18 +1328,20 @@ static int mem_alloc(struct dm_win_info **win, dma_addr_t fb_base_phys,
 			goto free_par;
 		}
 		w->fb_base =
-		    (unsigned long)ioremap(w->fb_base_phys, w->fb_size);
+		    (unsigned long)ioremap_wc(w->fb_base_phys, w->fb_size);
 		if (!w->fb_base) {
 			dev_err(dev, "%s: cannot map framebuffer\n", fbname);
 			goto release_fb;
 		}
 	} else {
-		/* allocate coherent memory for the framebuffer */
-		w->fb_base = (unsigned long)dma_alloc_coherent(dev,
-							       w->fb_size,
-							       &w->fb_base_phys,
-							       GFP_KERNEL |
-							       GFP_DMA);
+		/*
+		 * The OSD only reads the framebuffer, so it can sit in the
+		 * write buffer like the user mmap (see fb_pgprotect()).
+		 */
+		w->fb_base = (unsigned long)dma_alloc_writecombine(dev,
+							w->fb_size,
+							&w->fb_base_phys,
+							GFP_KERNEL | GFP_DMA);
 		if (!w->fb_base) {
 			dev_err(dev, "%s: cannot allocate framebuffer\n",
 				fbname);
@@ -1413,6 +1578,12 @@ static inline void fix_default_var(struct dm_win_info *w,
  */
 static int davincifb_remove(struct platform_device *pdev)
 {
+#ifdef CONFIG_VIDEO_VPSS_SYSTEM
+	if (vpss_prio_held) {
+		vpss_dma_priority_put(VPSS_DMA_DISPLAY);
+		vpss_prio_held = 0;
+	}
+#endif
 	free_irq(IRQ_VENCINT, &dm);
 
 	/* Cleanup all framebuffers */
@@ -1473,6 +1644,7 @@ static int davincifb_probe(struct platform_device *pdev)
 	/* initialize the vsync wait queue */
 	init_waitqueue_head(&dm->vsync_wait);
 	dm->timeout = HZ / 5;
+	spin_lock_init(&dm->comp_lock);
 
 	if ((dmparams.output == NTSC) && (dmparams.format == COMPOSITE))
 		dm->output_device_config = davincifb_ntsc_composite_config;
@@ -1651,6 +1823,10 @@ static int davincifb_probe(struct platform_device *pdev)
 	/* Turn ON the output device */
 	dm->output_device_config(1);
 
+#ifdef CONFIG_VIDEO_VPSS_SYSTEM
+	if (dmparams.display_prio)
+		vpss_prio_held = !vpss_dma_priority_get(VPSS_DMA_DISPLAY);
+#endif
 	return (0);
 
       exit:
@@ -1673,8 +1849,8 @@ static struct fb_ops davincifb_ops = {
 	.fb_setcolreg = davincifb_setcolreg,
 	.fb_blank = davincifb_blank,
 	.fb_pan_display = davincifb_pan_display,
-	.fb_fillrect = cfb_fillrect,
-	.fb_copyarea = cfb_copyarea,
+	.fb_fillrect = davinci_fb_fillrect,
+	.fb_copyarea = davinci_fb_copyarea,
 	.fb_imageblit = cfb_imageblit,
 	.fb_rotate = NULL,
 	.fb_sync = NULL,
@@ -0,0 +1,178 @@
+// PRU logic capture firmware for DA8xx
+//
+// Samples 8 or 16 bits of R31 every PERIOD cycles of the PRU cycle
+// counter, packs the samples into words and stores them into a ring in
+// DDR.  The control block at the start of the core's data RAM is shared
+// with drivers/char/davinci_pru_capture.c, which documents the fields.
+//
+// Build with the TI PRU assembler and install as PRU_Capture.bin:
+//
+//	pasm -b PRU_Capture.p
+//
+// Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+.origin 0
+.entrypoint START
+
+#define CTRL_CMD		0x00
+#define CTRL_BUF		0x04
+#define CTRL_HEAD		0x30
+#define CTRL_TAIL		0x34
+#define CTRL_DROPPED		0x38
+#define CTRL_STATE		0x3c
+
+#define CMD_RUN			1
+
+#define TRIG_NONE		0
+#define TRIG_EDGE		2
+
+#define STATE_IDLE		0
+#define STATE_ARMED		1
+#define STATE_CAPTURE		2
+
+#define PRUCTRL_CONTROL		0x00
+#define PRUCTRL_CYCLE		0x0c
+#define CONTROL_COUNTENABLE	3
+
+// parameters, loaded in one burst from CTRL_BUF on
+#define rBuf		r2
+#define rMask		r3	// ring size - 1
+#define rPeriod		r4
+#define rShift		r5
+#define rWidth		r6
+#define rTrigMask	r7
+#define rTrigValue	r8
+#define rTrigMode	r9
+#define rNotify		r10	// notify interval - 1
+#define rIrq		r11
+#define rPruCtrl	r12
+
+// state
+#define rHead		r13
+#define rTail		r14
+#define rDropped	r15
+#define rDeadline	r16
+#define rSample		r17
+#define rWord		r18
+#define rFill		r19	// bytes in rWord
+#define rPrev		r20
+#define rTmp		r21
+#define rSampleMask	r22
+#define rTmp2		r23
+#define rZero		r1
+
+START:
+	MOV	rZero, 0
+
+IDLE:
+	MOV	rTmp, STATE_IDLE
+	SBBO	rTmp, rZero, CTRL_STATE, 4
+WAIT_CMD:
+	LBBO	rTmp, rZero, CTRL_CMD, 4
+	QBNE	WAIT_CMD, rTmp, CMD_RUN
+
+	LBBO	rBuf, rZero, CTRL_BUF, 44
+	SUB	rMask, rMask, 1
+	SUB	rNotify, rNotify, 1
+	MOV	rHead, 0
+	MOV	rDropped, 0
+	MOV	rWord, 0
+	MOV	rFill, 0
+	MOV	rSampleMask, 0xff
+	QBEQ	NARROW, rWidth, 1
+	MOV	rSampleMask, 0xffff
+NARROW:
+
+	// arm the trigger
+	MOV	rTmp, STATE_ARMED
+	SBBO	rTmp, rZero, CTRL_STATE, 4
+	QBEQ	TRIGGERED, rTrigMode, TRIG_NONE
+	LSR	rPrev, r31, rShift
+	AND	rPrev, rPrev, rTrigMask
+ARMED:
+	LBBO	rTmp, rZero, CTRL_CMD, 4
+	QBNE	STOP, rTmp, CMD_RUN
+	LSR	rSample, r31, rShift
+	AND	rSample, rSample, rTrigMask
+	QBEQ	ARMED_EDGE, rTrigMode, TRIG_EDGE
+	QBNE	ARMED, rSample, rTrigValue
+	JMP	TRIGGERED
+ARMED_EDGE:
+	// fire when the pins come to match, not while they already do
+	MOV	rTmp, rPrev
+	MOV	rPrev, rSample
+	QBEQ	ARMED, rTmp, rTrigValue
+	QBNE	ARMED, rSample, rTrigValue
+
+TRIGGERED:
+	MOV	rTmp, STATE_CAPTURE
+	SBBO	rTmp, rZero, CTRL_STATE, 4
+	LBBO	rDeadline, rPruCtrl, PRUCTRL_CYCLE, 4
+
+SAMPLE:
+	// sample on the deadline, which moves on by exactly one period
+	LBBO	rTmp, rPruCtrl, PRUCTRL_CYCLE, 4
+	SUB	rTmp, rTmp, rDeadline
+	QBBS	SAMPLE, rTmp, 31
+	LSR	rSample, r31, rShift
+	ADD	rDeadline, rDeadline, rPeriod
+
+	AND	rSample, rSample, rSampleMask
+	LSL	rTmp, rFill, 3
+	LSL	rSample, rSample, rTmp
+	OR	rWord, rWord, rSample
+	ADD	rFill, rFill, rWidth
+	QBNE	SAMPLE, rFill, 4
+
+	// a word is full: store it unless the ring is
+	MOV	rFill, 0
+	LBBO	rTail, rZero, CTRL_TAIL, 4
+	SUB	rTmp, rHead, rTail
+	SUB	rTmp, rMask, rTmp
+	QBBC	STORE, rTmp, 31
+	ADD	rDropped, rDropped, 4
+	SBBO	rDropped, rZero, CTRL_DROPPED, 4
+	MOV	rWord, 0
+	JMP	CHECK
+STORE:
+	AND	rTmp, rHead, rMask
+	SBBO	rWord, rBuf, rTmp, 4
+	MOV	rWord, 0
+	ADD	rHead, rHead, 4
+	AND	rTmp2, rHead, rNotify
+	QBNE	CHECK, rTmp2, 0
+
+	// read the word back so it has landed before the head covers it
+	LBBO	rTmp2, rBuf, rTmp, 4
+	SBBO	rHead, rZero, CTRL_HEAD, 4
+	MOV	r31.b0, rIrq.b0
+
+CHECK:
+	// keep the cycle counter, which stops at 0xffffffff, in range; the
+	// few cycles it is paused for here shift the timebase, not the period
+	QBBC	NO_REBASE, rDeadline, 31
+	MOV	rSample, 0x40000000
+	LBBO	rTmp, rPruCtrl, PRUCTRL_CONTROL, 4
+	CLR	rTmp, rTmp, CONTROL_COUNTENABLE
+	SBBO	rTmp, rPruCtrl, PRUCTRL_CONTROL, 4
+	LBBO	rTmp2, rPruCtrl, PRUCTRL_CYCLE, 4
+	SUB	rTmp2, rTmp2, rSample
+	SBBO	rTmp2, rPruCtrl, PRUCTRL_CYCLE, 4
+	SET	rTmp, rTmp, CONTROL_COUNTENABLE
+	SBBO	rTmp, rPruCtrl, PRUCTRL_CONTROL, 4
+	SUB	rDeadline, rDeadline, rSample
+NO_REBASE:
+	LBBO	rTmp, rZero, CTRL_CMD, 4
+	QBEQ	SAMPLE, rTmp, CMD_RUN
+
+STOP:
+	// a partly filled word is dropped; publish where the data ends
+	LBBO	rTmp2, rBuf, 0, 4
+	SBBO	rHead, rZero, CTRL_HEAD, 4
+	MOV	r31.b0, rIrq.b0
+	JMP	IDLE
@@ -7,6 +7,7 @@
 #include <linux/fs.h>
 #include <linux/msdos_fs.h>
 #include <linux/blkdev.h>
+#include <linux/vmalloc.h>
 #include "fat.h"
 
 struct fatent_operations {
@@ -452,6 +453,84 @@ static void fat_collect_bhs(struct buffer_head **bhs, int *nr_bhs,
 	}
 }
 
+/*
+ * Allocation through the used-cluster map.  The search starts right after
+ * the last cluster given to this file so that concurrent writers each get
+ * contiguous extents, and a request for several clusters takes a free run
+ * of that length when there is one.  Only the FAT blocks holding the chosen
+ * entries are read.
+ */
+static int fat_alloc_clusters_map(struct inode *inode, int *cluster,
+				  int nr_cluster, struct buffer_head **bhs,
+				  int *nr_bhs, int *idx_clus)
+{
+	struct super_block *sb = inode->i_sb;
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	struct fatent_operations *ops = sbi->fatent_ops;
+	unsigned long *map = sbi->free_map;
+	unsigned long size = sbi->max_cluster;
+	unsigned long start, entry;
+	struct fat_entry fatent, prev_ent;
+	int wrapped = 0, err = 0;
+
+	start = MSDOS_I(inode)->i_alloc_hint ?: sbi->prev_free;
+	start++;
+	if (start >= size)
+		start = FAT_START_ENT;
+
+	entry = start;
+	if (nr_cluster > 1) {
+		entry = bitmap_find_next_zero_area(map, size, start,
+						   nr_cluster, 0);
+		if (entry >= size)
+			entry = start;
+	}
+
+	fatent_init(&prev_ent);
+	fatent_init(&fatent);
+	while (*idx_clus < nr_cluster) {
+		entry = find_next_zero_bit(map, size, entry);
+		if (entry >= size) {
+			if (wrapped) {
+				sbi->free_clusters = 0;
+				sbi->free_clus_valid = 1;
+				sb->s_dirt = 1;
+				err = -ENOSPC;
+				break;
+			}
+			wrapped = 1;
+			entry = FAT_START_ENT;
+			continue;
+		}
+
+		fatent_set_entry(&fatent, entry);
+		err = fat_ent_read_block(sb, &fatent);
+		if (err)
+			break;
+
+		__set_bit(entry, map);
+		if (ops->ent_get(&fatent) != FAT_ENT_FREE)
+			continue;	/* stale map entry, now fixed */
+
+		ops->ent_put(&fatent, FAT_ENT_EOF);
+		if (prev_ent.nr_bhs)
+			ops->ent_put(&prev_ent, entry);
+
+		fat_collect_bhs(bhs, nr_bhs, &fatent);
+
+		sbi->prev_free = entry;
+		if (sbi->free_clusters != -1)
+			sbi->free_clusters--;
+		sb->s_dirt = 1;
+
+		cluster[(*idx_clus)++] = entry;
+		prev_ent = fatent;
+	}
+
+	fatent_brelse(&fatent);
+	return err;
+}
+
 int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 {
 	struct super_block *sb = inode->i_sb;
@@ -471,6 +550,13 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	}
 
 	err = nr_bhs = idx_clus = 0;
+	fatent_init(&fatent);
+	if (sbi->free_map) {
+		err = fat_alloc_clusters_map(inode, cluster, nr_cluster,
+					     bhs, &nr_bhs, &idx_clus);
+		goto out;
+	}
+
 	count = FAT_START_ENT;
 	fatent_init(&prev_ent);
 	fatent_init(&fatent);
@@ -584,6 +670,8 @@ int fat_free_clusters(struct inode *inode, int cluster)
 		}
 
 		ops->ent_put(&fatent, FAT_ENT_FREE);
+		if (sbi->free_map)
+			__clear_bit(fatent.entry, sbi->free_map);
 		if (sbi->free_clusters != -1) {
 			sbi->free_clusters++;
 			sb->s_dirt = 1;
@@ -644,12 +732,29 @@ int fat_count_free_clusters(struct super_block *sb)
 	struct fatent_operations *ops = sbi->fatent_ops;
 	struct fat_entry fatent;
 	unsigned long reada_blocks, reada_mask, cur_block;
+	unsigned long *map = NULL;
 	int err = 0, free;
 
 	lock_fat(sbi);
-	if (sbi->free_clusters != -1 && sbi->free_clus_valid)
+	if (sbi->free_clusters != -1 && sbi->free_clus_valid &&
+	    (sbi->free_map || !sbi->options.free_map))
 		goto out;
 
+	/* The full scan is also what builds the used-cluster map */
+	if (sbi->options.free_map && !sbi->free_map) {
+		size_t len = BITS_TO_LONGS(sbi->max_cluster) * sizeof(long);
+
+		map = vmalloc(len);
+		if (map) {
+			memset(map, 0, len);
+			bitmap_set(map, 0, FAT_START_ENT);
+		} else {
+			printk(KERN_WARNING "FAT: no memory for the free "
+			       "cluster map, free_map disabled\n");
+			sbi->options.free_map = 0;
+		}
+	}
+
 	reada_blocks = FAT_READA_SIZE >> sb->s_blocksize_bits;
 	reada_mask = reada_blocks - 1;
 	cur_block = 0;
@@ -672,13 +777,49 @@ int fat_count_free_clusters(struct super_block *sb)
 		do {
 			if (ops->ent_get(&fatent) == FAT_ENT_FREE)
 				free++;
+			else if (map)
+				__set_bit(fatent.entry, map);
 		} while (fat_ent_next(sbi, &fatent));
 	}
 	sbi->free_clusters = free;
 	sbi->free_clus_valid = 1;
 	sb->s_dirt = 1;
 	fatent_brelse(&fatent);
+	sbi->free_map = map;
+	map = NULL;
 out:
 	unlock_fat(sbi);
+	vfree(map);
 	return err;
 }
+
+static void fat_free_map_work(struct work_struct *work)
+{
+	struct msdos_sb_info *sbi =
+		container_of(work, struct msdos_sb_info, free_map_work);
+
+	fat_count_free_clusters(sbi->fat_inode->i_sb);
+}
+
+/*
+ * With the free_map option the used-cluster map is built by a scan in the
+ * background right after mount; until it is there, allocation falls back
+ * to the linear search.
+ */
+void fat_free_map_init(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+
+	INIT_WORK(&sbi->free_map_work, fat_free_map_work);
+	if (sbi->options.free_map)
+		schedule_work(&sbi->free_map_work);
+}
+
+void fat_free_map_destroy(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+
+	cancel_work_sync(&sbi->free_map_work);
+	vfree(sbi->free_map);
+	sbi->free_map = NULL;
+}
@@ -51,6 +51,8 @@ static int fat_add_cluster(struct inode *inode)
 	err = fat_chain_add(inode, cluster, 1);
 	if (err)
 		fat_free_clusters(inode, cluster);
+	else
+		MSDOS_I(inode)->i_alloc_hint = cluster;
 	return err;
 }
 
@@ -469,6 +471,8 @@ static void fat_put_super(struct super_block *sb)
 
 	lock_kernel();
 
+	fat_free_map_destroy(sb);
+
 	if (sb->s_dirt)
 		fat_write_super(sb);
 
@@ -494,6 +498,7 @@ static struct inode *fat_alloc_inode(struct super_block *sb)
 	ei = kmem_cache_alloc(fat_inode_cachep, GFP_NOFS);
 	if (!ei)
 		return NULL;
+	ei->i_alloc_hint = 0;
 	return &ei->vfs_inode;
 }
 
@@ -860,6 +865,8 @@ static int fat_show_options(struct seq_file *m, struct vfsmount *mnt)
 		seq_puts(m, ",errors=remount-ro");
 	if (opts->discard)
 		seq_puts(m, ",discard");
+	if (opts->free_map)
+		seq_puts(m, ",free_map");
 
 	return 0;
 }
@@ -873,7 +880,7 @@ enum {
 	Opt_shortname_winnt, Opt_shortname_mixed, Opt_utf8_no, Opt_utf8_yes,
 	Opt_uni_xl_no, Opt_uni_xl_yes, Opt_nonumtail_no, Opt_nonumtail_yes,
 	Opt_obsolate, Opt_flush, Opt_tz_utc, Opt_rodir, Opt_err_cont,
-	Opt_err_panic, Opt_err_ro, Opt_discard, Opt_err,
+	Opt_err_panic, Opt_err_ro, Opt_discard, Opt_free_map, Opt_err,
 };
 
 static const match_table_t fat_tokens = {
@@ -902,6 +909,7 @@ static const match_table_t fat_tokens = {
 	{Opt_err_panic, "errors=panic"},
 	{Opt_err_ro, "errors=remount-ro"},
 	{Opt_discard, "discard"},
+	{Opt_free_map, "free_map"},
 	{Opt_obsolate, "conv=binary"},
 	{Opt_obsolate, "conv=text"},
 	{Opt_obsolate, "conv=auto"},
@@ -1142,6 +1150,9 @@ static int parse_options(char *options, int is_vfat, int silent, int *debug,
 		case Opt_discard:
 			opts->discard = 1;
 			break;
+		case Opt_free_map:
+			opts->free_map = 1;
+			break;
 
 		/* obsolete mount options */
 		case Opt_obsolate:
@@ -1479,6 +1490,8 @@ int fat_fill_super(struct super_block *sb, void *data, int silent,
 		goto out_fail;
 	}
 
+	fat_free_map_init(sb);
+
 	return 0;
 
 out_invalid:
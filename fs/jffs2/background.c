@@ -72,6 +72,7 @@ void jffs2_stop_garbage_collect_thread(struct jffs2_sb_info *c)
 static int jffs2_garbage_collect_thread(void *_c)
 {
 	struct jffs2_sb_info *c = _c;
+	int running = 0, urgent;
 
 	allow_signal(SIGKILL);
 	allow_signal(SIGSTOP);
@@ -87,14 +88,19 @@ static int jffs2_garbage_collect_thread(void *_c)
 		allow_signal(SIGHUP);
 	again:
 		spin_lock(&c->erase_completion_lock);
-		if (!jffs2_thread_should_wake(c)) {
+		if (running ? !jffs2_thread_should_continue(c) :
+			      !jffs2_thread_should_wake(c)) {
 			set_current_state (TASK_INTERRUPTIBLE);
 			spin_unlock(&c->erase_completion_lock);
 			D1(printk(KERN_DEBUG "jffs2_garbage_collect_thread sleeping...\n"));
 			schedule();
+			running = 0;
 		} else
 			spin_unlock(&c->erase_completion_lock);
-			
+
+		spin_lock(&c->erase_completion_lock);
+		urgent = jffs2_thread_gc_urgent(c);
+		spin_unlock(&c->erase_completion_lock);
 
 		/* Problem - immediately after bootup, the GCD spends a lot
 		 * of time in places like jffs2_kill_fragtree(); so much so
@@ -105,8 +111,11 @@ static int jffs2_garbage_collect_thread(void *_c)
 		 * disk).
 		 * This forces the GCD to slow the hell down.   Pulling an
 		 * inode in with read_inode() is much preferable to having
-		 * the GC thread get there first. */
-		schedule_timeout_interruptible(msecs_to_jiffies(50));
+		 * the GC thread get there first.
+		 * Unless writers are about to run out of space, in which case
+		 * every pass we make here is one they don't have to make. */
+		if (!urgent)
+			schedule_timeout_interruptible(msecs_to_jiffies(50));
 
 		if (kthread_should_stop()) {
 			D1(printk(KERN_DEBUG "jffs2_garbage_collect_thread():  kthread_stop() called.\n"));
@@ -150,6 +159,7 @@ static int jffs2_garbage_collect_thread(void *_c)
 			printk(KERN_NOTICE "No space for garbage collection. Aborting GC thread\n");
 			goto die;
 		}
+		running = 1;
 	}
  die:
 	spin_lock(&c->erase_completion_lock);
@@ -286,6 +286,11 @@ static void jffs2_calc_trigger_levels(struct jffs2_sb_info *c)
 
 	c->resv_blocks_gctrigger = c->resv_blocks_write + 1;
 
+	/* Once woken, how many free blocks does the GC thread make before
+	   it goes back to sleep. Working on a few blocks ahead of the
+	   trigger saves wakeups and keeps writers out of foreground GC */
+	c->resv_blocks_gcstop = c->resv_blocks_gctrigger + 2;
+
 	/* When do we allow garbage collection to merge nodes to make
 	   long-term progress at the expense of short-term space exhaustion? */
 	c->resv_blocks_gcmerge = c->resv_blocks_deletion + 1;
@@ -314,6 +319,8 @@ static void jffs2_calc_trigger_levels(struct jffs2_sb_info *c)
 		  c->resv_blocks_write, c->resv_blocks_write*c->sector_size/1024);
 	dbg_fsbuild("Blocks required to quiesce GC thread: %d (%d KiB)\n",
 		  c->resv_blocks_gctrigger, c->resv_blocks_gctrigger*c->sector_size/1024);
+	dbg_fsbuild("Blocks required to stop GC thread:    %d (%d KiB)\n",
+		  c->resv_blocks_gcstop, c->resv_blocks_gcstop*c->sector_size/1024);
 	dbg_fsbuild("Blocks required to allow GC merges:   %d (%d KiB)\n",
 		  c->resv_blocks_gcmerge, c->resv_blocks_gcmerge*c->sector_size/1024);
 	dbg_fsbuild("Blocks required to GC bad blocks:     %d (%d KiB)\n",
@@ -33,7 +33,7 @@ int jffs2_fsync(struct file *filp, struct dentry *dentry, int datasync)
 	struct jffs2_sb_info *c = JFFS2_SB_INFO(inode->i_sb);
 
 	/* Trigger GC to flush any pending writes for this inode */
-	jffs2_flush_wbuf_gc(c, inode->i_ino);
+	jffs2_fsync_wbuf(c, inode->i_ino);
 
 	return 0;
 }
@@ -391,6 +391,7 @@ int jffs2_remount_fs (struct super_block *sb, int *flags, char *data)
 	lock_kernel();
 	if (!(sb->s_flags & MS_RDONLY)) {
 		jffs2_stop_garbage_collect_thread(c);
+		jffs2_wbuf_cancel_flush(c);
 		mutex_lock(&c->alloc_sem);
 		jffs2_flush_wbuf_pad(c);
 		mutex_unlock(&c->alloc_sem);
@@ -668,6 +669,10 @@ void jffs2_gc_release_page(struct jffs2_sb_info *c,
 static int jffs2_flash_setup(struct jffs2_sb_info *c) {
 	int ret = 0;
 
+#ifdef CONFIG_JFFS2_FS_WRITEBUFFER
+	INIT_DELAYED_WORK(&c->wbuf_dwork, jffs2_wbuf_flush_work);
+#endif
+
 	if (jffs2_cleanmarker_oob(c)) {
 		/* NAND flash... do setup accordingly */
 		ret = jffs2_nand_flash_setup(c);
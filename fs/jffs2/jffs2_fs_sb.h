@@ -69,6 +69,7 @@ struct jffs2_sb_info {
 	uint8_t resv_blocks_gctrigger;	/* ... wake up the GC thread */
 	uint8_t resv_blocks_gcbad;	/* ... pick a block from the bad_list to GC */
 	uint8_t resv_blocks_gcmerge;	/* ... merge pages when garbage collecting */
+	uint8_t resv_blocks_gcstop;	/* ... let the GC thread go back to sleep */
 	/* Number of 'very dirty' blocks before we trigger immediate GC */
 	uint8_t vdirty_blocks_gctrigger;
 
@@ -118,6 +119,7 @@ struct jffs2_sb_info {
 	uint32_t wbuf_len;
 	struct jffs2_inodirty *wbuf_inodes;
 	struct rw_semaphore wbuf_sem;	/* Protects the write buffer */
+	struct delayed_work wbuf_dwork;	/* Deferred fsync flush */
 
 	unsigned char *oobbuf;
 	int oobavail; /* How many bytes are available for JFFS2 in OOB */
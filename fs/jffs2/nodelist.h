@@ -378,6 +378,8 @@ extern uint32_t __jffs2_ref_totlen(struct jffs2_sb_info *c,
 
 /* nodemgmt.c */
 int jffs2_thread_should_wake(struct jffs2_sb_info *c);
+int jffs2_thread_should_continue(struct jffs2_sb_info *c);
+int jffs2_thread_gc_urgent(struct jffs2_sb_info *c);
 int jffs2_reserve_space(struct jffs2_sb_info *c, uint32_t minsize,
 			uint32_t *len, int prio, uint32_t sumsize);
 int jffs2_reserve_space_gc(struct jffs2_sb_info *c, uint32_t minsize,
@@ -726,6 +726,32 @@ void jffs2_mark_node_obsolete(struct jffs2_sb_info *c, struct jffs2_raw_node_ref
 	mutex_unlock(&c->erase_free_sem);
 }
 
+/* Dirty space GC can reclaim, see jffs2_thread_should_wake() */
+static uint32_t jffs2_gc_dirty(struct jffs2_sb_info *c)
+{
+	return c->dirty_size + c->erasing_size - c->nr_erasing_blocks * c->sector_size;
+}
+
+/* Called with erase_completion_lock held. Once the GC thread has been
+   woken, keep it going until it has made resv_blocks_gcstop blocks free,
+   rather than dropping back to sleep right at the trigger level. */
+int jffs2_thread_should_continue(struct jffs2_sb_info *c)
+{
+	if (jffs2_thread_should_wake(c))
+		return 1;
+
+	return c->nr_free_blocks + c->nr_erasing_blocks < c->resv_blocks_gcstop &&
+		jffs2_gc_dirty(c) > c->nospc_dirty_size;
+}
+
+/* Called with erase_completion_lock held. Writers are about to have to
+   GC for themselves; the GC thread should not pause between passes. */
+int jffs2_thread_gc_urgent(struct jffs2_sb_info *c)
+{
+	return c->nr_free_blocks + c->nr_erasing_blocks <= c->resv_blocks_write &&
+		jffs2_gc_dirty(c) > c->nospc_dirty_size;
+}
+
 int jffs2_thread_should_wake(struct jffs2_sb_info *c)
 {
 	int ret = 0;
@@ -747,7 +773,7 @@ int jffs2_thread_should_wake(struct jffs2_sb_info *c)
 	 * Blocks on erasable_list are counted as dirty_size, but not in c->nr_erasing_blocks
 	 * This helps us to force gc and pick eventually a clean block to spread the load.
 	 */
-	dirty = c->dirty_size + c->erasing_size - c->nr_erasing_blocks * c->sector_size;
+	dirty = jffs2_gc_dirty(c);
 
 	if (c->nr_free_blocks + c->nr_erasing_blocks < c->resv_blocks_gctrigger &&
 			(dirty > c->nospc_dirty_size))
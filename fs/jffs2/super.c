@@ -199,6 +199,7 @@ static void jffs2_put_super (struct super_block *sb)
 	if (sb->s_dirt)
 		jffs2_write_super(sb);
 
+	jffs2_wbuf_cancel_flush(c);
 	mutex_lock(&c->alloc_sem);
 	jffs2_flush_wbuf_pad(c);
 	mutex_unlock(&c->alloc_sem);
@@ -748,6 +748,40 @@ int jffs2_flush_wbuf_gc(struct jffs2_sb_info *c, uint32_t ino)
 	return ret;
 }
 
+void jffs2_wbuf_flush_work(struct work_struct *work)
+{
+	struct jffs2_sb_info *c = container_of(work, struct jffs2_sb_info,
+					       wbuf_dwork.work);
+
+	D1(printk(KERN_DEBUG "jffs2_wbuf_flush_work(): deferred fsync flush\n"));
+	jffs2_flush_wbuf_gc(c, 0);
+}
+
+/* fsync() for the write-buffer. With CONFIG_JFFS2_FSYNC_DELAY, a pending
+   write for the inode only arms a flush at most that many ms away; if
+   later writes fill the page first, the flush finds nothing to do and
+   no padding is wasted. */
+int jffs2_fsync_wbuf(struct jffs2_sb_info *c, uint32_t ino)
+{
+	if (!CONFIG_JFFS2_FSYNC_DELAY || !c->wbuf)
+		return jffs2_flush_wbuf_gc(c, ino);
+
+	mutex_lock(&c->alloc_sem);
+	if (jffs2_wbuf_pending_for_ino(c, ino))
+		schedule_delayed_work(&c->wbuf_dwork,
+			msecs_to_jiffies(CONFIG_JFFS2_FSYNC_DELAY));
+	mutex_unlock(&c->alloc_sem);
+	return 0;
+}
+
+/* Called before the write-buffer is flushed for unmount or remount
+   read-only: the deferred flush must not run after that. */
+void jffs2_wbuf_cancel_flush(struct jffs2_sb_info *c)
+{
+	if (c->wbuf)
+		cancel_delayed_work_sync(&c->wbuf_dwork);
+}
+
 /* Pad write-buffer to end and write it, wasting space. */
 int jffs2_flush_wbuf_pad(struct jffs2_sb_info *c)
 {
@@ -153,7 +153,18 @@ int squashfs_read_data(struct super_block *sb, void **buffer, u64 index,
 	}
 
 	if (compressed) {
-		int zlib_err = 0, zlib_init = 0;
+		int zlib_err = 0, zlib_init = 0, i;
+
+		/*
+		 * Wait for the reads before taking the decompressor, so that
+		 * a reader waiting for the device does not hold up readers
+		 * whose blocks are already in the buffer cache.
+		 */
+		for (i = 0; i < b; i++) {
+			wait_on_buffer(bh[i]);
+			if (!buffer_uptodate(bh[i]))
+				goto block_release;
+		}
 
 		/*
 		 * Uncompress block.
@@ -169,9 +180,6 @@ int squashfs_read_data(struct super_block *sb, void **buffer, u64 index,
 			if (msblk->stream.avail_in == 0 && k < b) {
 				avail = min(bytes, msblk->devblksize - offset);
 				bytes -= avail;
-				wait_on_buffer(bh[k]);
-				if (!buffer_uptodate(bh[k]))
-					goto release_mutex;
 
 				if (avail == 0) {
 					offset = 0;
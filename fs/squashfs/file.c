@@ -38,6 +38,12 @@
  * Larger files use multiple slots, with 1.75 TiB files using all 8 slots.
  * The index cache is designed to be memory efficient, and by default uses
  * 16 KiB.
+ *
+ * Readahead looks up the location of all datablocks covered by the readahead
+ * window in one pass through the block list, and starts reading them from
+ * the device before the first one is decompressed.  Decompression then finds
+ * the following blocks already read (or in flight), which turns a sequence of
+ * small synchronous reads into one large sequential read.
  */
 
 #include <linux/fs.h>
@@ -48,6 +54,7 @@
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
 #include <linux/zlib.h>
+#include <linux/buffer_head.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -330,19 +337,18 @@ failed:
 
 
 /*
- * Get the on-disk location and compressed size of the datablock
- * specified by index.  Fill_meta_index() does most of the work.
+ * Get the on-disk location of the datablock specified by index, and the
+ * location <start, offset> of its entry in the block list.
+ * Fill_meta_index() does most of the work.
  */
-static int read_blocklist(struct inode *inode, int index, u64 *block)
+static int locate_blocklist(struct inode *inode, int index, u64 *start,
+				int *offset, u64 *block)
 {
-	u64 start;
 	long long blks;
-	int offset;
-	__le32 size;
-	int res = fill_meta_index(inode, index, &start, &offset, block);
+	int res = fill_meta_index(inode, index, start, offset, block);
 
-	TRACE("read_blocklist: res %d, index %d, start 0x%llx, offset"
-		       " 0x%x, block 0x%llx\n", res, index, start, offset,
+	TRACE("locate_blocklist: res %d, index %d, start 0x%llx, offset"
+		       " 0x%x, block 0x%llx\n", res, index, *start, *offset,
 			*block);
 
 	if (res < 0)
@@ -355,12 +361,30 @@ static int read_blocklist(struct inode *inode, int index, u64 *block)
 	 * extra block indexes needed.
 	 */
 	if (res < index) {
-		blks = read_indexes(inode->i_sb, index - res, &start, &offset);
+		blks = read_indexes(inode->i_sb, index - res, start, offset);
 		if (blks < 0)
 			return (int) blks;
 		*block += blks;
 	}
 
+	return 0;
+}
+
+
+/*
+ * Get the on-disk location and compressed size of the datablock
+ * specified by index.
+ */
+static int read_blocklist(struct inode *inode, int index, u64 *block)
+{
+	u64 start;
+	int offset;
+	__le32 size;
+	int res = locate_blocklist(inode, index, &start, &offset, block);
+
+	if (res < 0)
+		return res;
+
 	/*
 	 * Read length of block specified by index.
 	 */
@@ -497,6 +521,92 @@ out:
 }
 
 
+/*
+ * Start reading datablocks [index, index + n) from the device, without
+ * waiting for the reads to complete.  This is only a hint, errors are
+ * ignored and left to squashfs_readpage() to report.
+ */
+static void prefetch_datablocks(struct inode *inode, int index, int n)
+{
+	struct super_block *sb = inode->i_sb;
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	u64 start, block;
+	int offset, i;
+	__le32 *blist;
+
+	n = min_t(int, n, SQUASHFS_READAHEAD_BLKS);
+	blist = kmalloc(n * sizeof(*blist), GFP_KERNEL);
+	if (blist == NULL)
+		return;
+
+	if (locate_blocklist(inode, index, &start, &offset, &block) < 0 ||
+			squashfs_read_metadata(sb, blist, &start, &offset,
+			n * sizeof(*blist)) < 0)
+		goto out;
+
+	for (i = 0; i < n; i++) {
+		int length = SQUASHFS_COMPRESSED_SIZE_BLOCK(
+						le32_to_cpu(blist[i]));
+		u64 cur = block >> msblk->devblksize_log2;
+		u64 end = (block + length + msblk->devblksize - 1) >>
+						msblk->devblksize_log2;
+
+		if (length > msblk->block_size ||
+				block + length > msblk->bytes_used)
+			break;
+
+		TRACE("prefetch_datablocks: block 0x%llx, length %d\n",
+				block, length);
+		for (; cur < end; cur++)
+			sb_breadahead(sb, cur);
+		block += length;
+	}
+
+out:
+	kfree(blist);
+}
+
+
+static int squashfs_readpages_filler(void *data, struct page *page)
+{
+	return squashfs_readpage(data, page);
+}
+
+
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+				struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	pgoff_t first = ULONG_MAX, last = 0;
+	struct page *page;
+
+	list_for_each_entry(page, pages, lru) {
+		first = min(first, page->index);
+		last = max(last, page->index);
+	}
+
+	/*
+	 * Only datablocks are prefetched, the tail-end fragment is shared
+	 * with other files and goes through the fragment cache.  There is
+	 * nothing to gain for a window within a single datablock.
+	 */
+	if (first <= last && (first >> shift) < file_end &&
+			(first >> shift) != (last >> shift)) {
+		int index = first >> shift;
+		int n = min_t(int, (last >> shift) + 1, file_end) - index;
+
+		prefetch_datablocks(inode, index, n);
+	}
+
+	return read_cache_pages(mapping, pages, squashfs_readpages_filler,
+				file);
+}
+
+
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+	.readpages = squashfs_readpages
 };
@@ -178,6 +178,9 @@
 /* cached data constants for filesystem */
 #define SQUASHFS_CACHED_BLKS		8
 
+/* max datablocks prefetched by one readahead call */
+#define SQUASHFS_READAHEAD_BLKS		32
+
 #define SQUASHFS_MAX_FILE_SIZE_LOG	64
 
 #define SQUASHFS_MAX_FILE_SIZE		(1LL << \
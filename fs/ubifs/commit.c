@@ -165,6 +165,8 @@ static int do_commit(struct ubifs_info *c)
 	dbg_cmt("commit end");
 	spin_unlock(&c->cs_lock);
 
+	/* Commit has just made a lot of znodes clean, enforce the cap */
+	ubifs_tnc_check_cap(c);
 	return 0;
 
 out_up:
@@ -790,8 +790,10 @@ static int ubifs_do_bulk_read(struct ubifs_info *c, struct bu_info *bu,
 	ui->last_page_read = offset + page_idx - 1;
 
 out_free:
-	if (allocate)
+	if (allocate) {
 		kfree(bu->buf);
+		bu->buf = NULL;
+	}
 	return ret;
 
 out_warn:
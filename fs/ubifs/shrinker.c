@@ -35,6 +35,17 @@
  * The age of znodes is just the time-stamp when they were last looked at.
  * The current shrinker first tries to evict old znodes, then young ones.
  *
+ * On small-RAM systems waiting for the VM to call the shrinker lets the TNC
+ * grow until the page cache is squeezed out. So each file-system may also
+ * have a cap on the number of clean znodes ('c->tnc_max_clean', set by the
+ * "max_clean_znodes" mount option or via sysfs). The cap is checked on the
+ * TNC look-up paths and after each commit, and 'ubifs_tnc_trim()' brings the
+ * TNC down below it using the same level-order walk.
+ *
+ * Under memory pressure the shrinker also frees the pre-allocated bulk-read
+ * buffer of idle file-systems. Bulk-read then allocates a buffer of the size
+ * it actually needs for each read.
+ *
  * Since the shrinker is global, it has to protect against races with FS
  * un-mounts, which is done by the 'ubifs_infos_lock' and 'c->umount_mutex'.
  */
@@ -73,7 +84,6 @@ static int shrink_tnc(struct ubifs_info *c, int nr, int age, int *contention)
 	struct ubifs_znode *znode, *zprev;
 	int time = get_seconds();
 
-	ubifs_assert(mutex_is_locked(&c->umount_mutex));
 	ubifs_assert(mutex_is_locked(&c->tnc_mutex));
 
 	if (!c->zroot.znode || atomic_long_read(&c->clean_zn_cnt) == 0)
@@ -196,6 +206,7 @@ static int shrink_tnc_trees(int nr, int age, int *contention)
 		 * OK, now we have TNC locked, the file-system cannot go away -
 		 * it is safe to reap the cache.
 		 */
+		ubifs_assert(mutex_is_locked(&c->umount_mutex));
 		c->shrinker_run_no = run_no;
 		freed += shrink_tnc(c, nr, age, contention);
 		mutex_unlock(&c->tnc_mutex);
@@ -215,6 +226,61 @@ static int shrink_tnc_trees(int nr, int age, int *contention)
 	return freed;
 }
 
+/**
+ * ubifs_tnc_trim - bring the TNC below its clean znode cap.
+ * @c: UBIFS file-system description object
+ *
+ * This function frees clean znodes until there are no more than 3/4 of
+ * @c->tnc_max_clean of them left, so that the cap is not hit again on the very
+ * next look-up. Old znodes go first, then young ones, then any clean znode.
+ * The caller must hold a reference to the file-system (i.e., be in a VFS
+ * operation, the commit or the sysfs code) and must not hold @c->tnc_mutex.
+ */
+void ubifs_tnc_trim(struct ubifs_info *c)
+{
+	static const int ages[] = { OLD_ZNODE_AGE, YOUNG_ZNODE_AGE, 0 };
+	int i, freed = 0, contention = 0;
+	long nr, max_clean = c->tnc_max_clean;
+
+	if (!max_clean)
+		return;
+
+	mutex_lock(&c->tnc_mutex);
+	nr = atomic_long_read(&c->clean_zn_cnt) - max_clean + (max_clean >> 2);
+	for (i = 0; i < ARRAY_SIZE(ages) && freed < nr; i++)
+		freed += shrink_tnc(c, nr - freed, ages[i], &contention);
+	mutex_unlock(&c->tnc_mutex);
+
+	dbg_tnc("trimmed %d of %ld znodes, cap %ld", freed, nr, max_clean);
+}
+
+/**
+ * shrink_bu_bufs - free pre-allocated bulk-read buffers.
+ *
+ * This function walks the list of mounted UBIFS file-systems and frees the
+ * pre-allocated bulk-read buffers which are not in use at the moment. Returns
+ * the number of freed buffers.
+ */
+static int shrink_bu_bufs(void)
+{
+	struct ubifs_info *c;
+	int freed = 0;
+
+	spin_lock(&ubifs_infos_lock);
+	list_for_each_entry(c, &ubifs_infos, infos_list) {
+		if (!c->bu.buf || !mutex_trylock(&c->bu_mutex))
+			continue;
+		if (c->bu.buf) {
+			kfree(c->bu.buf);
+			c->bu.buf = NULL;
+			freed += 1;
+		}
+		mutex_unlock(&c->bu_mutex);
+	}
+	spin_unlock(&ubifs_infos_lock);
+	return freed;
+}
+
 /**
  * kick_a_thread - kick a background thread to start commit.
  *
@@ -285,6 +351,9 @@ int ubifs_shrinker(int nr, gfp_t gfp_mask)
 	if (nr == 0)
 		return clean_zn_cnt;
 
+	if (shrink_bu_bufs())
+		dbg_tnc("freed bulk-read buffers");
+
 	if (!clean_zn_cnt) {
 		/*
 		 * No clean znodes, nothing to reap. All we can do in this case
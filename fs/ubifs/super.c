@@ -432,6 +432,9 @@ static int ubifs_show_options(struct seq_file *s, struct vfsmount *mnt)
 			   ubifs_compr_name(c->mount_opts.compr_type));
 	}
 
+	if (c->tnc_max_clean)
+		seq_printf(s, ",max_clean_znodes=%ld", c->tnc_max_clean);
+
 	return 0;
 }
 
@@ -904,6 +907,7 @@ static int check_volume_empty(struct ubifs_info *c)
  * Opt_chk_data_crc: check CRCs when reading data nodes
  * Opt_no_chk_data_crc: do not check CRCs when reading data nodes
  * Opt_override_compr: override default compressor
+ * Opt_max_clean_znodes: limit the number of clean znodes cached in the TNC
  * Opt_err: just end of array marker
  */
 enum {
@@ -914,6 +918,7 @@ enum {
 	Opt_chk_data_crc,
 	Opt_no_chk_data_crc,
 	Opt_override_compr,
+	Opt_max_clean_znodes,
 	Opt_err,
 };
 
@@ -925,6 +930,7 @@ static const match_table_t tokens = {
 	{Opt_chk_data_crc, "chk_data_crc"},
 	{Opt_no_chk_data_crc, "no_chk_data_crc"},
 	{Opt_override_compr, "compr=%s"},
+	{Opt_max_clean_znodes, "max_clean_znodes=%u"},
 	{Opt_err, NULL},
 };
 
@@ -1024,6 +1030,17 @@ static int ubifs_parse_options(struct ubifs_info *c, char *options,
 			c->default_compr = c->mount_opts.compr_type;
 			break;
 		}
+		case Opt_max_clean_znodes:
+		{
+			int max_clean;
+
+			if (match_int(&args[0], &max_clean) || max_clean < 0) {
+				ubifs_err("bad value in \"%s\"", p);
+				return -EINVAL;
+			}
+			c->tnc_max_clean = max_clean;
+			break;
+		}
 		default:
 		{
 			unsigned long flag;
@@ -1368,6 +1385,12 @@ static int mount_ubifs(struct ubifs_info *c)
 	if (err)
 		goto out_infos;
 
+	err = ubifs_sysfs_init_fs(c);
+	if (err) {
+		dbg_debugfs_exit_fs(c);
+		goto out_infos;
+	}
+
 	c->always_chk_crc = 0;
 
 	ubifs_msg("mounted UBI device %d, volume %d, name \"%s\"",
@@ -1482,6 +1505,7 @@ static void ubifs_umount(struct ubifs_info *c)
 	dbg_gen("un-mounting UBI device %d, volume %d", c->vi.ubi_num,
 		c->vi.vol_id);
 
+	ubifs_sysfs_exit_fs(c);
 	dbg_debugfs_exit_fs(c);
 	spin_lock(&ubifs_infos_lock);
 	list_del(&c->infos_list);
@@ -1811,8 +1835,10 @@ static int ubifs_remount_fs(struct super_block *sb, int *flags, char *data)
 		bu_init(c);
 	else {
 		dbg_gen("disable bulk-read");
+		mutex_lock(&c->bu_mutex);
 		kfree(c->bu.buf);
 		c->bu.buf = NULL;
+		mutex_unlock(&c->bu_mutex);
 	}
 
 	ubifs_assert(c->lst.taken_empty_lebs > 0);
@@ -2193,8 +2219,14 @@ static int __init ubifs_init(void)
 	if (err)
 		goto out_compr;
 
+	err = ubifs_sysfs_init();
+	if (err)
+		goto out_dbg;
+
 	return 0;
 
+out_dbg:
+	dbg_debugfs_exit();
 out_compr:
 	ubifs_compressors_exit();
 out_shrinker:
@@ -2212,6 +2244,7 @@ static void __exit ubifs_exit(void)
 	ubifs_assert(list_empty(&ubifs_infos));
 	ubifs_assert(atomic_long_read(&ubifs_clean_zn_cnt) == 0);
 
+	ubifs_sysfs_exit();
 	dbg_debugfs_exit();
 	ubifs_compressors_exit();
 	unregister_shrinker(&ubifs_shrinker_info);
@@ -0,0 +1,205 @@
+/*
+ * This file is part of UBIFS.
+ *
+ * Copyright (C) 2006-2008 Nokia Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This file implements the "/sys/fs/ubifs/ubiX_Y" directories which report
+ * how much memory the in-memory index structures of a mounted file-system
+ * take and allow to tune the TNC cap (see 'ubifs_tnc_trim()') at run-time.
+ *
+ * The kobject is removed before the file-system starts going away, and the
+ * sysfs core waits for all running 'show()' and 'store()' calls to finish
+ * before the removal completes, so the handlers may freely use @c.
+ */
+
+#include "ubifs.h"
+
+/* The "/sys/fs/ubifs" directory */
+static struct kset *ubifs_kset;
+
+struct ubifs_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct ubifs_info *c, char *buf);
+	ssize_t (*store)(struct ubifs_info *c, const char *buf, size_t count);
+};
+
+static ssize_t clean_znodes_show(struct ubifs_info *c, char *buf)
+{
+	return sprintf(buf, "%ld\n", atomic_long_read(&c->clean_zn_cnt));
+}
+
+static ssize_t dirty_znodes_show(struct ubifs_info *c, char *buf)
+{
+	return sprintf(buf, "%ld\n", atomic_long_read(&c->dirty_zn_cnt));
+}
+
+static ssize_t max_clean_znodes_show(struct ubifs_info *c, char *buf)
+{
+	return sprintf(buf, "%ld\n", c->tnc_max_clean);
+}
+
+static ssize_t max_clean_znodes_store(struct ubifs_info *c, const char *buf,
+				      size_t count)
+{
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val) || val > LONG_MAX)
+		return -EINVAL;
+
+	c->tnc_max_clean = val;
+	ubifs_tnc_check_cap(c);
+	return count;
+}
+
+/*
+ * The LPT is loaded lazily, so this is the upper bound - the size it takes
+ * when all nnodes and pnodes are in memory.
+ */
+static ssize_t lpt_max_bytes_show(struct ubifs_info *c, char *buf)
+{
+	long long sz;
+
+	sz = (long long)c->pnode_cnt * sizeof(struct ubifs_pnode);
+	sz += (long long)c->nnode_cnt * sizeof(struct ubifs_nnode);
+	sz += c->lpt_lebs * sizeof(struct ubifs_lpt_lprops);
+	sz += c->lsave_cnt * sizeof(int);
+	return sprintf(buf, "%lld\n", sz);
+}
+
+static ssize_t bulk_read_buf_show(struct ubifs_info *c, char *buf)
+{
+	return sprintf(buf, "%d\n", c->bu.buf ? c->max_bu_buf_len : 0);
+}
+
+#define UBIFS_ATTR(_name, _mode, _show, _store)			\
+static struct ubifs_attr ubifs_attr_##_name = {			\
+	.attr = { .name = __stringify(_name), .mode = _mode },	\
+	.show = _show,						\
+	.store = _store,					\
+}
+
+#define UBIFS_RO_ATTR(name) UBIFS_ATTR(name, 0444, name##_show, NULL)
+#define UBIFS_RW_ATTR(name) UBIFS_ATTR(name, 0644, name##_show, name##_store)
+
+UBIFS_RO_ATTR(clean_znodes);
+UBIFS_RO_ATTR(dirty_znodes);
+UBIFS_RW_ATTR(max_clean_znodes);
+UBIFS_RO_ATTR(lpt_max_bytes);
+UBIFS_RO_ATTR(bulk_read_buf);
+
+static struct attribute *ubifs_attrs[] = {
+	&ubifs_attr_clean_znodes.attr,
+	&ubifs_attr_dirty_znodes.attr,
+	&ubifs_attr_max_clean_znodes.attr,
+	&ubifs_attr_lpt_max_bytes.attr,
+	&ubifs_attr_bulk_read_buf.attr,
+	NULL,
+};
+
+static ssize_t ubifs_attr_show(struct kobject *kobj, struct attribute *attr,
+			       char *buf)
+{
+	struct ubifs_info *c = container_of(kobj, struct ubifs_info, kobj);
+	struct ubifs_attr *a = container_of(attr, struct ubifs_attr, attr);
+
+	return a->show ? a->show(c, buf) : 0;
+}
+
+static ssize_t ubifs_attr_store(struct kobject *kobj, struct attribute *attr,
+				const char *buf, size_t count)
+{
+	struct ubifs_info *c = container_of(kobj, struct ubifs_info, kobj);
+	struct ubifs_attr *a = container_of(attr, struct ubifs_attr, attr);
+
+	return a->store ? a->store(c, buf, count) : -EPERM;
+}
+
+static void ubifs_kobj_release(struct kobject *kobj)
+{
+	struct ubifs_info *c = container_of(kobj, struct ubifs_info, kobj);
+
+	complete(&c->kobj_unregister);
+}
+
+static struct sysfs_ops ubifs_attr_ops = {
+	.show	= ubifs_attr_show,
+	.store	= ubifs_attr_store,
+};
+
+static struct kobj_type ubifs_ktype = {
+	.default_attrs	= ubifs_attrs,
+	.sysfs_ops	= &ubifs_attr_ops,
+	.release	= ubifs_kobj_release,
+};
+
+/**
+ * ubifs_sysfs_init_fs - create the sysfs directory of a file-system.
+ * @c: UBIFS file-system description object
+ *
+ * This function returns zero in case of success and a negative error code in
+ * case of failure.
+ */
+int ubifs_sysfs_init_fs(struct ubifs_info *c)
+{
+	int err;
+
+	init_completion(&c->kobj_unregister);
+	c->kobj.kset = ubifs_kset;
+	err = kobject_init_and_add(&c->kobj, &ubifs_ktype, NULL, "ubi%d_%d",
+				   c->vi.ubi_num, c->vi.vol_id);
+	if (err) {
+		ubifs_err("cannot create sysfs directory, error %d", err);
+		kobject_put(&c->kobj);
+		wait_for_completion(&c->kobj_unregister);
+	}
+	return err;
+}
+
+/**
+ * ubifs_sysfs_exit_fs - remove the sysfs directory of a file-system.
+ * @c: UBIFS file-system description object
+ */
+void ubifs_sysfs_exit_fs(struct ubifs_info *c)
+{
+	kobject_put(&c->kobj);
+	wait_for_completion(&c->kobj_unregister);
+}
+
+/**
+ * ubifs_sysfs_init - create the "/sys/fs/ubifs" directory.
+ *
+ * This function returns zero in case of success and a negative error code in
+ * case of failure.
+ */
+int ubifs_sysfs_init(void)
+{
+	ubifs_kset = kset_create_and_add("ubifs", NULL, fs_kobj);
+	if (!ubifs_kset) {
+		ubifs_err("cannot create \"/sys/fs/ubifs\"");
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+/**
+ * ubifs_sysfs_exit - remove the "/sys/fs/ubifs" directory.
+ */
+void ubifs_sysfs_exit(void)
+{
+	kset_unregister(ubifs_kset);
+}
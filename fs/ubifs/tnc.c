@@ -1445,6 +1445,7 @@ int ubifs_tnc_locate(struct ubifs_info *c, const union ubifs_key *key,
 	struct ubifs_znode *znode;
 	struct ubifs_zbranch zbr, *zt;
 
+	ubifs_tnc_check_cap(c);
 again:
 	mutex_lock(&c->tnc_mutex);
 	found = ubifs_lookup_level0(c, key, &znode, &n);
@@ -2772,6 +2773,7 @@ struct ubifs_dent_node *ubifs_tnc_next_ent(struct ubifs_info *c,
 	dbg_tnc("%s %s", nm->name ? (char *)nm->name : "(lowest)", DBGKEY(key));
 	ubifs_assert(is_hash_key(c, key));
 
+	ubifs_tnc_check_cap(c);
 	mutex_lock(&c->tnc_mutex);
 	err = ubifs_lookup_level0(c, key, &znode, &n);
 	if (unlikely(err < 0))
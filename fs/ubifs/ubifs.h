@@ -35,6 +35,8 @@
 #include <linux/mtd/ubi.h>
 #include <linux/pagemap.h>
 #include <linux/backing-dev.h>
+#include <linux/kobject.h>
+#include <linux/completion.h>
 #include "ubifs-media.h"
 
 /* Version of this UBIFS implementation */
@@ -1031,6 +1033,8 @@ struct ubifs_debug_info;
  * @dirty_pg_cnt: number of dirty pages (not used)
  * @dirty_zn_cnt: number of dirty znodes
  * @clean_zn_cnt: number of clean znodes
+ * @tnc_max_clean: maximum number of clean znodes to keep in the TNC, %0 if
+ *                 unlimited (see 'ubifs_tnc_trim()')
  *
  * @budg_idx_growth: amount of bytes budgeted for index growth
  * @budg_data_growth: amount of bytes budgeted for cached data
@@ -1174,6 +1178,9 @@ struct ubifs_debug_info;
  * @always_chk_crc: always check CRCs (while mounting and remounting rw)
  * @mount_opts: UBIFS-specific mount options
  *
+ * @kobj: kobject of the "/sys/fs/ubifs/ubiX_Y" directory
+ * @kobj_unregister: completed when @kobj is released
+ *
  * @dbg: debugging-related information
  */
 struct ubifs_info {
@@ -1272,6 +1279,7 @@ struct ubifs_info {
 	atomic_long_t dirty_pg_cnt;
 	atomic_long_t dirty_zn_cnt;
 	atomic_long_t clean_zn_cnt;
+	long tnc_max_clean;
 
 	long long budg_idx_growth;
 	long long budg_data_growth;
@@ -1405,6 +1413,9 @@ struct ubifs_info {
 	int always_chk_crc;
 	struct ubifs_mount_opts mount_opts;
 
+	struct kobject kobj;
+	struct completion kobj_unregister;
+
 #ifdef CONFIG_UBIFS_FS_DEBUG
 	struct ubifs_debug_info *dbg;
 #endif
@@ -1575,6 +1586,26 @@ int ubifs_tnc_end_commit(struct ubifs_info *c);
 
 /* shrinker.c */
 int ubifs_shrinker(int nr_to_scan, gfp_t gfp_mask);
+void ubifs_tnc_trim(struct ubifs_info *c);
+
+/**
+ * ubifs_tnc_check_cap - trim the TNC if it holds too many clean znodes.
+ * @c: UBIFS file-system description object
+ *
+ * This function must not be called with @c->tnc_mutex held.
+ */
+static inline void ubifs_tnc_check_cap(struct ubifs_info *c)
+{
+	if (unlikely(c->tnc_max_clean &&
+		     atomic_long_read(&c->clean_zn_cnt) > c->tnc_max_clean))
+		ubifs_tnc_trim(c);
+}
+
+/* sysfs.c */
+int ubifs_sysfs_init(void);
+void ubifs_sysfs_exit(void);
+int ubifs_sysfs_init_fs(struct ubifs_info *c);
+void ubifs_sysfs_exit_fs(struct ubifs_info *c);
 
 /* commit.c */
 int ubifs_bg_thread(void *info);
@@ -17,169 +17,61 @@
 #include "yportenv.h"
 
 /*
- * Each entry in yaffs_tnode_list and yaffs_obj_list hold blocks
- * of approx 100 objects that are themn allocated singly.
- * This is basically a simplified slab allocator.
+ * Tnodes and objects come from a pair of slab caches per device, so
+ * memory freed by deleting or truncating files goes back to the system
+ * instead of waiting on a private free list until unmount. The tnode
+ * cache has to be per device because the tnode size depends on the
+ * size of the flash.
  *
- * We don't use the Linux slab allocator because slab does not allow
- * us to dump all the objects in one hit when we do a umount and tear
- * down  all the tnodes and objects. slab requires that we first free
- * the individual objects.
- *
- * Once yaffs has been mainlined I shall try to motivate for a change
- * to slab to provide the extra features we need here.
+ * Slab wants every object freed before the cache is destroyed, so at
+ * unmount or an aborted mount we walk the object hash and free each
+ * object together with its file tree; nothing yaffs still uses lives
+ * anywhere else.
  */
 
-struct yaffs_tnode_list {
-	struct yaffs_tnode_list *next;
-	struct yaffs_tnode *tnodes;
-};
-
-struct yaffs_obj_list {
-	struct yaffs_obj_list *next;
-	struct yaffs_obj *objects;
-};
-
 struct yaffs_allocator {
-	int n_tnodes_created;
-	struct yaffs_tnode *free_tnodes;
-	int n_free_tnodes;
-	struct yaffs_tnode_list *alloc_tnode_list;
-
-	int n_obj_created;
-	struct list_head free_objs;
-	int n_free_objects;
-
-	struct yaffs_obj_list *allocated_obj_list;
+	struct kmem_cache *tnode_cache;
+	struct kmem_cache *obj_cache;
+	char tnode_cache_name[24];
+	char obj_cache_name[24];
 };
 
-static void yaffs_deinit_raw_tnodes(struct yaffs_dev *dev)
-{
-	struct yaffs_allocator *allocator =
-	    (struct yaffs_allocator *)dev->allocator;
-	struct yaffs_tnode_list *tmp;
-
-	if (!allocator) {
-		BUG();
-		return;
-	}
-
-	while (allocator->alloc_tnode_list) {
-		tmp = allocator->alloc_tnode_list->next;
-
-		kfree(allocator->alloc_tnode_list->tnodes);
-		kfree(allocator->alloc_tnode_list);
-		allocator->alloc_tnode_list = tmp;
-	}
-
-	allocator->free_tnodes = NULL;
-	allocator->n_free_tnodes = 0;
-	allocator->n_tnodes_created = 0;
-}
-
-static void yaffs_init_raw_tnodes(struct yaffs_dev *dev)
-{
-	struct yaffs_allocator *allocator = dev->allocator;
-
-	if (!allocator) {
-		BUG();
-		return;
-	}
-
-	allocator->alloc_tnode_list = NULL;
-	allocator->free_tnodes = NULL;
-	allocator->n_free_tnodes = 0;
-	allocator->n_tnodes_created = 0;
-}
+static atomic_t yaffs_allocator_seq = ATOMIC_INIT(0);
 
-static int yaffs_create_tnodes(struct yaffs_dev *dev, int n_tnodes)
+static void yaffs_free_tnode_tree(struct yaffs_dev *dev,
+				  struct yaffs_allocator *allocator,
+				  struct yaffs_tnode *tn, u32 level)
 {
-	struct yaffs_allocator *allocator =
-	    (struct yaffs_allocator *)dev->allocator;
 	int i;
-	struct yaffs_tnode *new_tnodes;
-	u8 *mem;
-	struct yaffs_tnode *curr;
-	struct yaffs_tnode *next;
-	struct yaffs_tnode_list *tnl;
 
-	if (!allocator) {
-		BUG();
-		return YAFFS_FAIL;
-	}
-
-	if (n_tnodes < 1)
-		return YAFFS_OK;
-
-	/* make these things */
-	new_tnodes = kmalloc(n_tnodes * dev->tnode_size, GFP_NOFS);
-	mem = (u8 *) new_tnodes;
-
-	if (!new_tnodes) {
-		yaffs_trace(YAFFS_TRACE_ERROR,
-			"yaffs: Could not allocate Tnodes");
-		return YAFFS_FAIL;
-	}
-
-	/* New hookup for wide tnodes */
-	for (i = 0; i < n_tnodes - 1; i++) {
-		curr = (struct yaffs_tnode *)&mem[i * dev->tnode_size];
-		next = (struct yaffs_tnode *)&mem[(i + 1) * dev->tnode_size];
-		curr->internal[0] = next;
-	}
-
-	curr = (struct yaffs_tnode *)&mem[(n_tnodes - 1) * dev->tnode_size];
-	curr->internal[0] = allocator->free_tnodes;
-	allocator->free_tnodes = (struct yaffs_tnode *)mem;
-
-	allocator->n_free_tnodes += n_tnodes;
-	allocator->n_tnodes_created += n_tnodes;
+	if (!tn)
+		return;
 
-	/* Now add this bunch of tnodes to a list for freeing up.
-	 * NB If we can't add this to the management list it isn't fatal
-	 * but it just means we can't free this bunch of tnodes later.
-	 */
-	tnl = kmalloc(sizeof(struct yaffs_tnode_list), GFP_NOFS);
-	if (!tnl) {
-		yaffs_trace(YAFFS_TRACE_ERROR,
-			"Could not add tnodes to management list");
-		return YAFFS_FAIL;
-	} else {
-		tnl->tnodes = new_tnodes;
-		tnl->next = allocator->alloc_tnode_list;
-		allocator->alloc_tnode_list = tnl;
+	if (level > 0) {
+		for (i = 0; i < YAFFS_NTNODES_INTERNAL; i++)
+			yaffs_free_tnode_tree(dev, allocator,
+					      tn->internal[i], level - 1);
 	}
-
-	yaffs_trace(YAFFS_TRACE_ALLOCATE, "Tnodes added");
-
-	return YAFFS_OK;
+	kmem_cache_free(allocator->tnode_cache, tn);
 }
 
 struct yaffs_tnode *yaffs_alloc_raw_tnode(struct yaffs_dev *dev)
 {
-	struct yaffs_allocator *allocator =
-	    (struct yaffs_allocator *)dev->allocator;
-	struct yaffs_tnode *tn = NULL;
+	struct yaffs_allocator *allocator = dev->allocator;
+	struct yaffs_tnode *tn;
 
 	if (!allocator) {
 		BUG();
 		return NULL;
 	}
 
-	/* If there are none left make more */
-	if (!allocator->free_tnodes)
-		yaffs_create_tnodes(dev, YAFFS_ALLOCATION_NTNODES);
-
-	if (allocator->free_tnodes) {
-		tn = allocator->free_tnodes;
-		allocator->free_tnodes = allocator->free_tnodes->internal[0];
-		allocator->n_free_tnodes--;
-	}
-
+	tn = kmem_cache_alloc(allocator->tnode_cache, GFP_NOFS);
+	if (!tn)
+		yaffs_trace(YAFFS_TRACE_ERROR,
+			"yaffs: Could not allocate Tnodes");
 	return tn;
 }
 
-/* FreeTnode frees up a tnode and puts it back on the free list */
 void yaffs_free_raw_tnode(struct yaffs_dev *dev, struct yaffs_tnode *tn)
 {
 	struct yaffs_allocator *allocator = dev->allocator;
@@ -189,158 +81,93 @@ void yaffs_free_raw_tnode(struct yaffs_dev *dev, struct yaffs_tnode *tn)
 		return;
 	}
 
-	if (tn) {
-		tn->internal[0] = allocator->free_tnodes;
-		allocator->free_tnodes = tn;
-		allocator->n_free_tnodes++;
-	}
+	if (tn)
+		kmem_cache_free(allocator->tnode_cache, tn);
 	dev->checkpoint_blocks_required = 0;	/* force recalculation */
 }
 
-/*--------------- yaffs_obj alloaction ------------------------
- *
- * Free yaffs_objs are stored in a list using obj->siblings.
- * The blocks of allocated objects are stored in a linked list.
- */
-
-static void yaffs_init_raw_objs(struct yaffs_dev *dev)
+struct yaffs_obj *yaffs_alloc_raw_obj(struct yaffs_dev *dev)
 {
 	struct yaffs_allocator *allocator = dev->allocator;
+	struct yaffs_obj *obj;
 
 	if (!allocator) {
 		BUG();
-		return;
+		return NULL;
 	}
 
-	allocator->allocated_obj_list = NULL;
-	INIT_LIST_HEAD(&allocator->free_objs);
-	allocator->n_free_objects = 0;
+	obj = kmem_cache_alloc(allocator->obj_cache, GFP_NOFS);
+	if (!obj)
+		yaffs_trace(YAFFS_TRACE_ALLOCATE,
+			"Could not allocate more objects");
+	return obj;
 }
 
-static void yaffs_deinit_raw_objs(struct yaffs_dev *dev)
+void yaffs_free_raw_obj(struct yaffs_dev *dev, struct yaffs_obj *obj)
 {
 	struct yaffs_allocator *allocator = dev->allocator;
-	struct yaffs_obj_list *tmp;
 
 	if (!allocator) {
 		BUG();
 		return;
 	}
 
-	while (allocator->allocated_obj_list) {
-		tmp = allocator->allocated_obj_list->next;
-		kfree(allocator->allocated_obj_list->objects);
-		kfree(allocator->allocated_obj_list);
-		allocator->allocated_obj_list = tmp;
-	}
-
-	INIT_LIST_HEAD(&allocator->free_objs);
-	allocator->n_free_objects = 0;
-	allocator->n_obj_created = 0;
-}
-
-static int yaffs_create_free_objs(struct yaffs_dev *dev, int n_obj)
-{
-	struct yaffs_allocator *allocator = dev->allocator;
-	int i;
-	struct yaffs_obj *new_objs;
-	struct yaffs_obj_list *list;
-
-	if (!allocator) {
-		BUG();
-		return YAFFS_FAIL;
-	}
-
-	if (n_obj < 1)
-		return YAFFS_OK;
-
-	/* make these things */
-	new_objs = kmalloc(n_obj * sizeof(struct yaffs_obj), GFP_NOFS);
-	list = kmalloc(sizeof(struct yaffs_obj_list), GFP_NOFS);
-
-	if (!new_objs || !list) {
-		kfree(new_objs);
-		new_objs = NULL;
-		kfree(list);
-		list = NULL;
-		yaffs_trace(YAFFS_TRACE_ALLOCATE,
-			"Could not allocate more objects");
-		return YAFFS_FAIL;
-	}
-
-	/* Hook them into the free list */
-	for (i = 0; i < n_obj; i++)
-		list_add(&new_objs[i].siblings, &allocator->free_objs);
-
-	allocator->n_free_objects += n_obj;
-	allocator->n_obj_created += n_obj;
-
-	/* Now add this bunch of Objects to a list for freeing up. */
-
-	list->objects = new_objs;
-	list->next = allocator->allocated_obj_list;
-	allocator->allocated_obj_list = list;
-
-	return YAFFS_OK;
+	kmem_cache_free(allocator->obj_cache, obj);
 }
 
-struct yaffs_obj *yaffs_alloc_raw_obj(struct yaffs_dev *dev)
+/*
+ * yaffs_allocator_usage() reports the slab memory held by tnodes and
+ * objects in use, for /proc/yaffs.
+ */
+void yaffs_allocator_usage(struct yaffs_dev *dev, u32 *tnode_bytes,
+			   u32 *obj_bytes)
 {
-	struct yaffs_obj *obj = NULL;
-	struct list_head *lh;
 	struct yaffs_allocator *allocator = dev->allocator;
 
-	if (!allocator) {
-		BUG();
-		return obj;
-	}
-
-	/* If there are none left make more */
-	if (list_empty(&allocator->free_objs))
-		yaffs_create_free_objs(dev, YAFFS_ALLOCATION_NOBJECTS);
-
-	if (!list_empty(&allocator->free_objs)) {
-		lh = allocator->free_objs.next;
-		obj = list_entry(lh, struct yaffs_obj, siblings);
-		list_del_init(lh);
-		allocator->n_free_objects--;
-	}
+	*tnode_bytes = 0;
+	*obj_bytes = 0;
+	if (!allocator)
+		return;
 
-	return obj;
+	*tnode_bytes = dev->n_tnodes *
+			kmem_cache_size(allocator->tnode_cache);
+	*obj_bytes = dev->n_obj * kmem_cache_size(allocator->obj_cache);
 }
 
-void yaffs_free_raw_obj(struct yaffs_dev *dev, struct yaffs_obj *obj)
+void yaffs_deinit_raw_tnodes_and_objs(struct yaffs_dev *dev)
 {
-
 	struct yaffs_allocator *allocator = dev->allocator;
+	struct yaffs_obj *obj;
+	struct yaffs_obj *tmp;
+	int i;
 
 	if (!allocator) {
 		BUG();
 		return;
 	}
 
-	/* Link into the free list. */
-	list_add(&obj->siblings, &allocator->free_objs);
-	allocator->n_free_objects++;
-}
-
-void yaffs_deinit_raw_tnodes_and_objs(struct yaffs_dev *dev)
-{
-
-	if (!dev->allocator) {
-		BUG();
-		return;
+	for (i = 0; i < YAFFS_NOBJECT_BUCKETS; i++) {
+		list_for_each_entry_safe(obj, tmp, &dev->obj_bucket[i].list,
+					 hash_link) {
+			list_del(&obj->hash_link);
+			if (obj->variant_type == YAFFS_OBJECT_TYPE_FILE)
+				yaffs_free_tnode_tree(dev, allocator,
+					obj->variant.file_variant.top,
+					obj->variant.file_variant.top_level);
+			kmem_cache_free(allocator->obj_cache, obj);
+		}
 	}
 
-	yaffs_deinit_raw_tnodes(dev);
-	yaffs_deinit_raw_objs(dev);
-	kfree(dev->allocator);
+	kmem_cache_destroy(allocator->tnode_cache);
+	kmem_cache_destroy(allocator->obj_cache);
+	kfree(allocator);
 	dev->allocator = NULL;
 }
 
 void yaffs_init_raw_tnodes_and_objs(struct yaffs_dev *dev)
 {
 	struct yaffs_allocator *allocator;
+	int seq;
 
 	if (dev->allocator) {
 		BUG();
@@ -348,10 +175,29 @@ void yaffs_init_raw_tnodes_and_objs(struct yaffs_dev *dev)
 	}
 
 	allocator = kmalloc(sizeof(struct yaffs_allocator), GFP_NOFS);
-	if (allocator) {
-		dev->allocator = allocator;
-		yaffs_init_raw_tnodes(dev);
-		yaffs_init_raw_objs(dev);
+	if (!allocator)
+		return;
+
+	/* slab keeps the name pointer, so it lives in the allocator */
+	seq = atomic_inc_return(&yaffs_allocator_seq);
+	snprintf(allocator->tnode_cache_name,
+		 sizeof(allocator->tnode_cache_name), "yaffs%d_tnode", seq);
+	snprintf(allocator->obj_cache_name,
+		 sizeof(allocator->obj_cache_name), "yaffs%d_obj", seq);
+
+	allocator->tnode_cache = kmem_cache_create(allocator->tnode_cache_name,
+						   dev->tnode_size, 0, 0, NULL);
+	allocator->obj_cache = kmem_cache_create(allocator->obj_cache_name,
+						 sizeof(struct yaffs_obj), 0,
+						 0, NULL);
+	if (!allocator->tnode_cache || !allocator->obj_cache) {
+		if (allocator->tnode_cache)
+			kmem_cache_destroy(allocator->tnode_cache);
+		if (allocator->obj_cache)
+			kmem_cache_destroy(allocator->obj_cache);
+		kfree(allocator);
+		return;
 	}
-}
 
+	dev->allocator = allocator;
+}
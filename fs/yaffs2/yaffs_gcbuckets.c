@@ -0,0 +1,233 @@
+/*
+ * YAFFS: Yet Another Flash File System. A NAND-flash specific file system.
+ *
+ * Copyright (C) 2002-2011 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include "yportenv.h"
+#include "yaffs_gcbuckets.h"
+#include "yaffs_getblockinfo.h"
+#include "yaffs_yaffs2.h"
+
+/*
+ * Garbage collection candidate lists
+ *
+ * Every FULL block that has at least one discarded chunk sits on the
+ * bucket list for its live chunk count (pages in use less soft deleted
+ * pages), and every block marked gc_prioritise sits on the prioritised
+ * list. The lists are kept up to date by calling yaffs_gc_bucket_update()
+ * after any change to a block's state, page counts or gc_prioritise, so
+ * choosing a victim no longer means scanning the block array: the
+ * dirtiest block is at the head of the lowest non-empty bucket.
+ *
+ * The links live in their own array rather than in yaffs_block_info,
+ * whose layout is part of the checkpoint format. Block numbers are used
+ * as links; 0 ends a list since internal_start_block is never 0.
+ */
+
+static inline struct yaffs_gc_link *yaffs_gc_link(struct yaffs_dev *dev,
+						  int blk)
+{
+	return &dev->gc_links[blk - dev->internal_start_block];
+}
+
+static void yaffs_gc_bucket_del(struct yaffs_dev *dev, int blk,
+				struct yaffs_gc_link *l)
+{
+	if (l->prev)
+		yaffs_gc_link(dev, l->prev)->next = l->next;
+	else
+		dev->gc_buckets[l->bucket] = l->next;
+	if (l->next)
+		yaffs_gc_link(dev, l->next)->prev = l->prev;
+	l->bucket = -1;
+}
+
+static void yaffs_gc_bucket_add(struct yaffs_dev *dev, int blk,
+				struct yaffs_gc_link *l, int bucket)
+{
+	l->prev = 0;
+	l->next = dev->gc_buckets[bucket];
+	if (l->next)
+		yaffs_gc_link(dev, l->next)->prev = blk;
+	dev->gc_buckets[bucket] = blk;
+	l->bucket = bucket;
+	if (bucket < dev->gc_min_bucket)
+		dev->gc_min_bucket = bucket;
+}
+
+static void yaffs_gc_prio_del(struct yaffs_dev *dev, int blk,
+			      struct yaffs_gc_link *l)
+{
+	if (l->prio_prev)
+		yaffs_gc_link(dev, l->prio_prev)->prio_next = l->prio_next;
+	else
+		dev->gc_prio_head = l->prio_next;
+	if (l->prio_next)
+		yaffs_gc_link(dev, l->prio_next)->prio_prev = l->prio_prev;
+	l->prio = 0;
+}
+
+static void yaffs_gc_prio_add(struct yaffs_dev *dev, int blk,
+			      struct yaffs_gc_link *l)
+{
+	l->prio_prev = 0;
+	l->prio_next = dev->gc_prio_head;
+	if (l->prio_next)
+		yaffs_gc_link(dev, l->prio_next)->prio_prev = blk;
+	dev->gc_prio_head = blk;
+	l->prio = 1;
+}
+
+static void yaffs_gc_buckets_clear(struct yaffs_dev *dev)
+{
+	int n_blocks = dev->internal_end_block - dev->internal_start_block + 1;
+	int i;
+
+	memset(dev->gc_links, 0, n_blocks * sizeof(struct yaffs_gc_link));
+	for (i = 0; i < n_blocks; i++)
+		dev->gc_links[i].bucket = -1;
+	memset(dev->gc_buckets, 0,
+	       dev->param.chunks_per_block * sizeof(int));
+	dev->gc_prio_head = 0;
+	dev->gc_min_bucket = dev->param.chunks_per_block;
+}
+
+int yaffs_gc_buckets_init(struct yaffs_dev *dev)
+{
+	int n_blocks = dev->internal_end_block - dev->internal_start_block + 1;
+
+	dev->gc_links =
+		kmalloc(n_blocks * sizeof(struct yaffs_gc_link), GFP_NOFS);
+	if (!dev->gc_links) {
+		dev->gc_links =
+		    vmalloc(n_blocks * sizeof(struct yaffs_gc_link));
+		dev->gc_links_alt = 1;
+	} else {
+		dev->gc_links_alt = 0;
+	}
+	dev->gc_buckets =
+		kmalloc(dev->param.chunks_per_block * sizeof(int), GFP_NOFS);
+
+	if (!dev->gc_links || !dev->gc_buckets) {
+		yaffs_gc_buckets_deinit(dev);
+		return YAFFS_FAIL;
+	}
+
+	yaffs_gc_buckets_clear(dev);
+	return YAFFS_OK;
+}
+
+void yaffs_gc_buckets_deinit(struct yaffs_dev *dev)
+{
+	if (dev->gc_links_alt && dev->gc_links)
+		vfree(dev->gc_links);
+	else
+		kfree(dev->gc_links);
+	dev->gc_links_alt = 0;
+	dev->gc_links = NULL;
+
+	kfree(dev->gc_buckets);
+	dev->gc_buckets = NULL;
+}
+
+void yaffs_gc_bucket_update(struct yaffs_dev *dev,
+			    struct yaffs_block_info *bi)
+{
+	int blk = dev->internal_start_block + (bi - dev->block_info);
+	struct yaffs_gc_link *l = yaffs_gc_link(dev, blk);
+	int bucket = -1;
+
+	/* A block with nothing discarded would not free any space */
+	if (bi->block_state == YAFFS_BLOCK_STATE_FULL) {
+		int live = bi->pages_in_use - bi->soft_del_pages;
+
+		if (live < 0)
+			live = 0;
+		if (live < dev->param.chunks_per_block)
+			bucket = live;
+	}
+
+	if (bucket != l->bucket) {
+		if (l->bucket >= 0)
+			yaffs_gc_bucket_del(dev, blk, l);
+		if (bucket >= 0)
+			yaffs_gc_bucket_add(dev, blk, l, bucket);
+	}
+
+	if (bi->gc_prioritise && !l->prio)
+		yaffs_gc_prio_add(dev, blk, l);
+	else if (!bi->gc_prioritise && l->prio)
+		yaffs_gc_prio_del(dev, blk, l);
+}
+
+/*
+ * yaffs_gc_buckets_rebuild() refills the lists from the block array, once
+ * the scan or the checkpoint restore has set up every block.
+ */
+void yaffs_gc_buckets_rebuild(struct yaffs_dev *dev)
+{
+	int n_blocks = dev->internal_end_block - dev->internal_start_block + 1;
+	int i;
+
+	yaffs_gc_buckets_clear(dev);
+	for (i = 0; i < n_blocks; i++)
+		yaffs_gc_bucket_update(dev, &dev->block_info[i]);
+}
+
+/*
+ * yaffs_gc_bucket_find() returns the block with the fewest live chunks,
+ * no more than max_live, that may be collected now, or 0 if there is none.
+ * Only yaffs2 blocks holding a shrink header are ever passed over, so the
+ * walk normally stops at the first block it looks at.
+ */
+int yaffs_gc_bucket_find(struct yaffs_dev *dev, int max_live)
+{
+	int bucket;
+	int blk;
+
+	if (max_live >= dev->param.chunks_per_block)
+		max_live = dev->param.chunks_per_block - 1;
+
+	for (bucket = dev->gc_min_bucket; bucket <= max_live; bucket++) {
+		blk = dev->gc_buckets[bucket];
+		if (!blk && bucket == dev->gc_min_bucket) {
+			dev->gc_min_bucket++;
+			continue;
+		}
+		for (; blk; blk = yaffs_gc_link(dev, blk)->next) {
+			if (yaffs_block_ok_for_gc(dev,
+					yaffs_get_block_info(dev, blk)))
+				return blk;
+		}
+	}
+	return 0;
+}
+
+/*
+ * yaffs_gc_prio_find() returns a prioritised block that may be collected
+ * now, or 0. prioritised_exist is set if any block is still prioritised.
+ */
+int yaffs_gc_prio_find(struct yaffs_dev *dev, int *prioritised_exist)
+{
+	struct yaffs_block_info *bi;
+	int blk;
+
+	*prioritised_exist = dev->gc_prio_head != 0;
+
+	for (blk = dev->gc_prio_head; blk;
+	     blk = yaffs_gc_link(dev, blk)->prio_next) {
+		bi = yaffs_get_block_info(dev, blk);
+		if (bi->block_state == YAFFS_BLOCK_STATE_FULL &&
+		    yaffs_block_ok_for_gc(dev, bi))
+			return blk;
+	}
+	return 0;
+}
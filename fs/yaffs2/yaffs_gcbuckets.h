@@ -0,0 +1,33 @@
+/*
+ * YAFFS: Yet another Flash File System . A NAND-flash specific file system.
+ *
+ * Copyright (C) 2002-2011 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 2.1 as
+ * published by the Free Software Foundation.
+ *
+ * Note: Only YAFFS headers are LGPL, YAFFS C code is covered by GPL.
+ */
+
+/*
+ * Garbage collection candidate lists
+ */
+
+#ifndef __YAFFS_GCBUCKETS_H__
+#define __YAFFS_GCBUCKETS_H__
+
+#include "yaffs_guts.h"
+
+int yaffs_gc_buckets_init(struct yaffs_dev *dev);
+void yaffs_gc_buckets_deinit(struct yaffs_dev *dev);
+void yaffs_gc_buckets_rebuild(struct yaffs_dev *dev);
+void yaffs_gc_bucket_update(struct yaffs_dev *dev,
+			    struct yaffs_block_info *bi);
+int yaffs_gc_bucket_find(struct yaffs_dev *dev, int max_live);
+int yaffs_gc_prio_find(struct yaffs_dev *dev, int *prioritised_exist);
+
+#endif
@@ -28,9 +28,8 @@
 #include "yaffs_allocator.h"
 #include "yaffs_attribs.h"
 #include "yaffs_summary.h"
+#include "yaffs_gcbuckets.h"
 
-/* Note YAFFS_GC_GOOD_ENOUGH must be <= YAFFS_GC_PASSIVE_THRESHOLD */
-#define YAFFS_GC_GOOD_ENOUGH 2
 #define YAFFS_GC_PASSIVE_THRESHOLD 4
 
 #include "yaffs_ecc.h"
@@ -239,6 +238,7 @@ void yaffs_handle_chunk_error(struct yaffs_dev *dev,
 		bi->gc_prioritise = 1;
 		dev->has_pending_prioritised_gc = 1;
 		bi->chunk_error_strikes++;
+		yaffs_gc_bucket_update(dev, bi);
 
 		if (bi->chunk_error_strikes > 3) {
 			bi->needs_retiring = 1;	/* Too many stikes, so retire */
@@ -460,6 +460,7 @@ static int yaffs_alloc_chunk(struct yaffs_dev *dev, int use_reserver,
 		if (dev->alloc_page >= dev->param.chunks_per_block) {
 			bi->block_state = YAFFS_BLOCK_STATE_FULL;
 			dev->alloc_block = -1;
+			yaffs_gc_bucket_update(dev, bi);
 		}
 
 		if (block_ptr)
@@ -500,6 +501,7 @@ void yaffs_skip_rest_of_block(struct yaffs_dev *dev)
 		if (bi->block_state == YAFFS_BLOCK_STATE_ALLOCATING) {
 			bi->block_state = YAFFS_BLOCK_STATE_FULL;
 			dev->alloc_block = -1;
+			yaffs_gc_bucket_update(dev, bi);
 		}
 	}
 }
@@ -646,6 +648,7 @@ static void yaffs_retire_block(struct yaffs_dev *dev, int flash_block)
 	bi->block_state = YAFFS_BLOCK_STATE_DEAD;
 	bi->gc_prioritise = 0;
 	bi->needs_retiring = 0;
+	yaffs_gc_bucket_update(dev, bi);
 
 	dev->n_retired_blocks++;
 }
@@ -1192,6 +1195,7 @@ static void yaffs_soft_del_chunk(struct yaffs_dev *dev, int chunk)
 		the_block->soft_del_pages++;
 		dev->n_free_chunks++;
 		yaffs2_update_oldest_dirty_seq(dev, block_no, the_block);
+		yaffs_gc_bucket_update(dev, the_block);
 	}
 }
 
@@ -2260,6 +2264,8 @@ static void yaffs_deinit_blocks(struct yaffs_dev *dev)
 		kfree(dev->chunk_bits);
 	dev->chunk_bits_alt = 0;
 	dev->chunk_bits = NULL;
+
+	yaffs_gc_buckets_deinit(dev);
 }
 
 static int yaffs_init_blocks(struct yaffs_dev *dev)
@@ -2268,6 +2274,8 @@ static int yaffs_init_blocks(struct yaffs_dev *dev)
 
 	dev->block_info = NULL;
 	dev->chunk_bits = NULL;
+	dev->gc_links = NULL;
+	dev->gc_buckets = NULL;
 	dev->alloc_block = -1;	/* force it to get a new one */
 
 	/* If the first allocation strategy fails, thry the alternate one */
@@ -2298,6 +2306,8 @@ static int yaffs_init_blocks(struct yaffs_dev *dev)
 	if (!dev->chunk_bits)
 		goto alloc_error;
 
+	if (!yaffs_gc_buckets_init(dev))
+		goto alloc_error;
 
 	memset(dev->block_info, 0, n_blocks * sizeof(struct yaffs_block_info));
 	memset(dev->chunk_bits, 0, dev->chunk_bit_stride * n_blocks);
@@ -2327,6 +2337,7 @@ void yaffs_block_became_dirty(struct yaffs_dev *dev, int block_no)
 	yaffs2_clear_oldest_dirty_seq(dev, bi);
 
 	bi->block_state = YAFFS_BLOCK_STATE_DIRTY;
+	yaffs_gc_bucket_update(dev, bi);
 
 	/* If this is the block being garbage collected then stop gc'ing */
 	if (block_no == dev->gc_block)
@@ -2382,6 +2393,7 @@ void yaffs_block_became_dirty(struct yaffs_dev *dev, int block_no)
 	bi->skip_erased_check = 1;	/* Clean, so no need to check */
 	bi->gc_prioritise = 0;
 	bi->has_summary=0;
+	yaffs_gc_bucket_update(dev, bi);
 
 	yaffs_clear_chunk_bits(dev, block_no);
 
@@ -2551,8 +2563,10 @@ static int yaffs_gc_block(struct yaffs_dev *dev, int block, int whole_block)
 
 	/*yaffs_verify_free_chunks(dev); */
 
-	if (bi->block_state == YAFFS_BLOCK_STATE_FULL)
+	if (bi->block_state == YAFFS_BLOCK_STATE_FULL) {
 		bi->block_state = YAFFS_BLOCK_STATE_COLLECTING;
+		yaffs_gc_bucket_update(dev, bi);
+	}
 
 	bi->has_shrink_hdr = 0;	/* clear the flag so that the block can erase */
 
@@ -2598,6 +2612,7 @@ static int yaffs_gc_block(struct yaffs_dev *dev, int block, int whole_block)
 		 * because checkpointing does not restore gc.
 		 */
 		bi->block_state = YAFFS_BLOCK_STATE_FULL;
+		yaffs_gc_bucket_update(dev, bi);
 	} else {
 		/* The gc completed. */
 		/* Do any required cleanups */
@@ -2633,15 +2648,13 @@ static int yaffs_gc_block(struct yaffs_dev *dev, int block, int whole_block)
 }
 
 /*
- * find_gc_block() selects the dirtiest block (or close enough)
- * for garbage collection.
+ * find_gc_block() selects the dirtiest block for garbage collection,
+ * taking it from the candidate lists kept by yaffs_gcbuckets.c.
  */
 
 static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 				    int aggressive, int background)
 {
-	int i;
-	int iterations;
 	unsigned selected = 0;
 	int prioritised = 0;
 	int prioritised_exist = 0;
@@ -2651,20 +2664,9 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 	/* First let's see if we need to grab a prioritised block */
 	if (dev->has_pending_prioritised_gc && !aggressive) {
 		dev->gc_dirtiest = 0;
-		bi = dev->block_info;
-		for (i = dev->internal_start_block;
-		     i <= dev->internal_end_block && !selected; i++) {
-
-			if (bi->gc_prioritise) {
-				prioritised_exist = 1;
-				if (bi->block_state == YAFFS_BLOCK_STATE_FULL &&
-				    yaffs_block_ok_for_gc(dev, bi)) {
-					selected = i;
-					prioritised = 1;
-				}
-			}
-			bi++;
-		}
+		selected = yaffs_gc_prio_find(dev, &prioritised_exist);
+		if (selected)
+			prioritised = 1;
 
 		/*
 		 * If there is a prioritised block and none was selected then
@@ -2681,18 +2683,14 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 	}
 
 	/* If we're doing aggressive GC then we are happy to take a less-dirty
-	 * block, and search harder.
+	 * block.
 	 * else (leasurely gc), then we only bother to do this if the
 	 * block has only a few pages in use.
 	 */
 
 	if (!selected) {
-		int pages_used;
-		int n_blocks =
-		    dev->internal_end_block - dev->internal_start_block + 1;
 		if (aggressive) {
 			threshold = dev->param.chunks_per_block;
-			iterations = n_blocks;
 		} else {
 			int max_threshold;
 
@@ -2709,39 +2707,15 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 				threshold = YAFFS_GC_PASSIVE_THRESHOLD;
 			if (threshold > max_threshold)
 				threshold = max_threshold;
-
-			iterations = n_blocks / 16 + 1;
-			if (iterations > 100)
-				iterations = 100;
 		}
 
-		for (i = 0;
-		     i < iterations &&
-		     (dev->gc_dirtiest < 1 ||
-		      dev->gc_pages_in_use > YAFFS_GC_GOOD_ENOUGH);
-		     i++) {
-			dev->gc_block_finder++;
-			if (dev->gc_block_finder < dev->internal_start_block ||
-			    dev->gc_block_finder > dev->internal_end_block)
-				dev->gc_block_finder =
-				    dev->internal_start_block;
-
-			bi = yaffs_get_block_info(dev, dev->gc_block_finder);
-
-			pages_used = bi->pages_in_use - bi->soft_del_pages;
-
-			if (bi->block_state == YAFFS_BLOCK_STATE_FULL &&
-			    pages_used < dev->param.chunks_per_block &&
-			    (dev->gc_dirtiest < 1 ||
-			     pages_used < dev->gc_pages_in_use) &&
-			    yaffs_block_ok_for_gc(dev, bi)) {
-				dev->gc_dirtiest = dev->gc_block_finder;
-				dev->gc_pages_in_use = pages_used;
-			}
+		selected = yaffs_gc_bucket_find(dev, threshold);
+		if (selected) {
+			bi = yaffs_get_block_info(dev, selected);
+			dev->gc_dirtiest = selected;
+			dev->gc_pages_in_use =
+			    bi->pages_in_use - bi->soft_del_pages;
 		}
-
-		if (dev->gc_dirtiest > 0 && dev->gc_pages_in_use <= threshold)
-			selected = dev->gc_dirtiest;
 	}
 
 	/*
@@ -2783,8 +2757,8 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 	} else {
 		dev->gc_not_done++;
 		yaffs_trace(YAFFS_TRACE_GC,
-			"GC none: finder %d skip %d threshold %d dirtiest %d using %d oldest %d%s",
-			dev->gc_block_finder, dev->gc_not_done, threshold,
+			"GC none: min bucket %d skip %d threshold %d dirtiest %d using %d oldest %d%s",
+			dev->gc_min_bucket, dev->gc_not_done, threshold,
 			dev->gc_dirtiest, dev->gc_pages_in_use,
 			dev->oldest_dirty_block, background ? " bg" : "");
 	}
@@ -2975,6 +2949,7 @@ void yaffs_chunk_del(struct yaffs_dev *dev, int chunk_id, int mark_flash,
 		dev->n_free_chunks++;
 		yaffs_clear_chunk_bit(dev, block, page);
 		bi->pages_in_use--;
+		yaffs_gc_bucket_update(dev, bi);
 
 		if (bi->pages_in_use == 0 &&
 		    !bi->has_shrink_hdr &&
@@ -4735,7 +4710,6 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	dev->passive_gc_count = 0;
 	dev->oldest_dirty_gc_count = 0;
 	dev->bg_gcs = 0;
-	dev->gc_block_finder = 0;
 	dev->buffered_block = -1;
 	dev->doing_buffered_block_rewrite = 0;
 	dev->n_deleted_files = 0;
@@ -4858,6 +4832,8 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 			init_failed = 1;
 		}
 
+		if (!init_failed)
+			yaffs_gc_buckets_rebuild(dev);
 		yaffs_strip_deleted_objs(dev);
 		yaffs_fix_hanging_objs(dev);
 		if (dev->param.empty_lost_n_found)
@@ -287,6 +287,16 @@ struct yaffs_block_info {
 
 };
 
+/* Garbage collection list links, one per block. See yaffs_gcbuckets.c */
+struct yaffs_gc_link {
+	int next;		/* block numbers, 0 ends the list */
+	int prev;
+	int prio_next;
+	int prio_prev;
+	int bucket;		/* live chunks, -1 when not a candidate */
+	int prio;		/* on the prioritised list */
+};
+
 /* -------------------------- Object structure -------------------------------*/
 /* This is the object structure as stored on NAND */
 
@@ -553,6 +563,9 @@ struct yaffs_param {
 	int (*read_chunk_tags_fn) (struct yaffs_dev *dev,
 				   int nand_chunk, u8 *data,
 				   struct yaffs_ext_tags *tags);
+	/* Optional. Reads the tags of every chunk in a block for scanning */
+	int (*read_block_tags_fn) (struct yaffs_dev *dev, int block_no,
+				   struct yaffs_ext_tags *tags);
 	int (*bad_block_fn) (struct yaffs_dev *dev, int block_no);
 	int (*query_block_fn) (struct yaffs_dev *dev, int block_no,
 			       enum yaffs_block_state *state,
@@ -651,6 +664,7 @@ struct yaffs_dev {
 	u8 *chunk_bits;		/* bitmap of chunks in use */
 	unsigned block_info_alt:1;	/* allocated using alternative alloc */
 	unsigned chunk_bits_alt:1;	/* allocated using alternative alloc */
+	unsigned gc_links_alt:1;	/* allocated using alternative alloc */
 	int chunk_bit_stride;	/* Number of bytes of chunk_bits per block.
 				 * Must be consistent with chunks_per_block.
 				 */
@@ -679,7 +693,10 @@ struct yaffs_dev {
 	unsigned has_pending_prioritised_gc;	/* We think this device might
 						have pending prioritised gcs */
 	unsigned gc_disable;
-	unsigned gc_block_finder;
+	struct yaffs_gc_link *gc_links;
+	int *gc_buckets;	/* FULL blocks by number of live chunks */
+	int gc_min_bucket;	/* all buckets below this are empty */
+	int gc_prio_head;	/* blocks with gc_prioritise set */
 	unsigned gc_dirtiest;
 	unsigned gc_pages_in_use;
 	unsigned gc_not_done;
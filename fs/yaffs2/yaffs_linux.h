@@ -33,6 +33,12 @@ struct yaffs_linux_context {
 
 	struct task_struct *readdir_process;
 	unsigned mount_id;
+
+	/* Background checkpointing, see yaffs_bg_checkpoint_due() */
+	int ckpt_dirty;
+	unsigned long ckpt_dirty_since;
+	u32 ckpt_writes;
+	u32 bg_last_writes;
 };
 
 #define yaffs_dev_to_lc(dev) ((struct yaffs_linux_context *)((dev)->os_context))
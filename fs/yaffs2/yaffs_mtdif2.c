@@ -200,6 +200,67 @@ int nandmtd2_read_chunk_tags(struct yaffs_dev *dev, int nand_chunk,
 		return YAFFS_FAIL;
 }
 
+/*
+ * Reads the tags of a whole block with one OOB-only request: the NAND
+ * layer walks the pages itself and, with MTD_OOB_AUTO, packs the free
+ * bytes of each page one after the other. Scanning uses this in place of
+ * one read_oob call per chunk.
+ */
+int nandmtd2_read_block_tags(struct yaffs_dev *dev, int block_no,
+			     struct yaffs_ext_tags *tags)
+{
+#if (MTD_VERSION_CODE > MTD_VERSION(2, 6, 17))
+	struct mtd_info *mtd = yaffs_dev_to_mtd(dev);
+	struct mtd_oob_ops ops;
+	struct yaffs_packed_tags2 pt;
+	int packed_tags_size =
+	    dev->param.no_tags_ecc ? sizeof(pt.t) : sizeof(pt);
+	void *packed_tags_ptr =
+	    dev->param.no_tags_ecc ? (void *)&pt.t : (void *)&pt;
+	int n_chunks = dev->param.chunks_per_block;
+	u8 *buffer;
+	int retval;
+	int i;
+
+	yaffs_trace(YAFFS_TRACE_MTD,
+		"nandmtd2_read_block_tags block %d", block_no);
+
+	if (dev->param.inband_tags || mtd->oobavail < packed_tags_size)
+		return YAFFS_FAIL;
+
+	buffer = kmalloc(mtd->oobavail * n_chunks, GFP_NOFS);
+	if (!buffer)
+		return YAFFS_FAIL;
+
+	ops.mode = MTD_OOB_AUTO;
+	ops.ooblen = mtd->oobavail * n_chunks;
+	ops.len = ops.ooblen;
+	ops.ooboffs = 0;
+	ops.datbuf = NULL;
+	ops.oobbuf = buffer;
+	retval = mtd->read_oob(mtd, ((loff_t) block_no) * n_chunks *
+			       dev->param.total_bytes_per_chunk, &ops);
+
+	if (retval == 0 && ops.oobretlen == ops.ooblen) {
+		for (i = 0; i < n_chunks; i++) {
+			memcpy(packed_tags_ptr, buffer + i * mtd->oobavail,
+			       packed_tags_size);
+			yaffs_unpack_tags2(&tags[i], &pt,
+					   !dev->param.no_tags_ecc);
+		}
+	}
+
+	kfree(buffer);
+
+	if (retval == 0 && ops.oobretlen == ops.ooblen)
+		return YAFFS_OK;
+	else
+		return YAFFS_FAIL;
+#else
+	return YAFFS_FAIL;
+#endif
+}
+
 int nandmtd2_mark_block_bad(struct yaffs_dev *dev, int block_no)
 {
 	struct mtd_info *mtd = yaffs_dev_to_mtd(dev);
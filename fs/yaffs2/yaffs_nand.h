@@ -20,6 +20,9 @@
 int yaffs_rd_chunk_tags_nand(struct yaffs_dev *dev, int nand_chunk,
 			     u8 *buffer, struct yaffs_ext_tags *tags);
 
+int yaffs_rd_block_tags_nand(struct yaffs_dev *dev, int block_no,
+			     struct yaffs_ext_tags *tags);
+
 int yaffs_wr_chunk_tags_nand(struct yaffs_dev *dev,
 			     int nand_chunk,
 			     const u8 *buffer, struct yaffs_ext_tags *tags);
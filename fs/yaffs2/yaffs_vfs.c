@@ -166,6 +166,7 @@ static uint32_t YCALCBLOCKS(uint64_t partition_size, uint32_t block_size)
 #include "yaffs_trace.h"
 #include "yaffs_guts.h"
 #include "yaffs_attribs.h"
+#include "yaffs_allocator.h"
 
 #include "yaffs_linux.h"
 
@@ -179,6 +180,8 @@ unsigned int yaffs_auto_checkpoint = 1;
 unsigned int yaffs_gc_control = 1;
 unsigned int yaffs_bg_enable = 1;
 unsigned int yaffs_auto_select = 1;
+unsigned int yaffs_bg_checkpoint_secs = 30;
+unsigned int yaffs_bg_checkpoint_chunks = 2048;
 /* Module Parameters */
 #if (LINUX_VERSION_CODE > KERNEL_VERSION(2, 5, 0))
 module_param(yaffs_trace_mask, uint, 0644);
@@ -186,6 +189,8 @@ module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
 module_param(yaffs_gc_control, uint, 0644);
 module_param(yaffs_bg_enable, uint, 0644);
+module_param(yaffs_bg_checkpoint_secs, uint, 0644);
+module_param(yaffs_bg_checkpoint_chunks, uint, 0644);
 #else
 MODULE_PARM(yaffs_trace_mask, "i");
 MODULE_PARM(yaffs_wr_attempts, "i");
@@ -2236,6 +2241,43 @@ void yaffs_background_waker(unsigned long data)
 	wake_up_process((struct task_struct *)data);
 }
 
+/*
+ * The checkpoint on flash is dropped by the first write after it, so after
+ * power loss the next mount has to do a full scan unless a new checkpoint
+ * was written since.  Have the background thread write one once the device
+ * has been quiet for a pass, when either yaffs_bg_checkpoint_chunks chunks
+ * were written since the last one or it has been missing for
+ * yaffs_bg_checkpoint_secs.  Power loss while idle then costs a checkpoint
+ * restore at mount rather than a scan.  Zero secs turns this off.
+ */
+static int yaffs_bg_checkpoint_due(struct yaffs_dev *dev, unsigned long now)
+{
+	struct yaffs_linux_context *context = yaffs_dev_to_lc(dev);
+	u32 writes = dev->n_page_writes;
+	int quiet = (writes == context->bg_last_writes);
+
+	context->bg_last_writes = writes;
+
+	if (dev->is_checkpointed) {
+		context->ckpt_dirty = 0;
+		return 0;
+	}
+
+	if (!context->ckpt_dirty) {
+		context->ckpt_dirty = 1;
+		context->ckpt_dirty_since = now;
+		context->ckpt_writes = writes;
+	}
+
+	if (!yaffs_bg_checkpoint_secs || !quiet || !context->super ||
+	    yaffs_bg_gc_urgency(dev))
+		return 0;
+
+	return time_after_eq(now, context->ckpt_dirty_since +
+			     yaffs_bg_checkpoint_secs * HZ) ||
+	    (writes - context->ckpt_writes) >= yaffs_bg_checkpoint_chunks;
+}
+
 static int yaffs_bg_thread_fn(void *data)
 {
 	struct yaffs_dev *dev = (struct yaffs_dev *)data;
@@ -2271,6 +2313,13 @@ static int yaffs_bg_thread_fn(void *data)
 
 		if (time_after(now, next_dir_update) && yaffs_bg_enable) {
 			yaffs_update_dirty_dirs(dev);
+			if (yaffs_bg_checkpoint_due(dev, now)) {
+				yaffs_trace(YAFFS_TRACE_BACKGROUND |
+					YAFFS_TRACE_CHECKPOINT,
+					"yaffs_background: checkpoint");
+				yaffs_flush_super(context->super, 1);
+				context->super->s_dirt = 0;
+			}
 			next_dir_update = now + HZ;
 		}
 
@@ -2855,6 +2904,7 @@ static struct super_block *yaffs_internal_read_super(int yaffs_version,
 	if (yaffs_version == 2) {
 		param->write_chunk_tags_fn = nandmtd2_write_chunk_tags;
 		param->read_chunk_tags_fn = nandmtd2_read_chunk_tags;
+		param->read_block_tags_fn = nandmtd2_read_block_tags;
 		param->bad_block_fn = nandmtd2_mark_block_bad;
 		param->query_block_fn = nandmtd2_query_block;
 		yaffs_dev_to_lc(dev)->spare_buffer =
@@ -3115,6 +3165,11 @@ static char *yaffs_dump_dev_part0(char *buf, struct yaffs_dev *dev)
 
 static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 {
+	u32 tnode_bytes;
+	u32 obj_bytes;
+
+	yaffs_allocator_usage(dev, &tnode_bytes, &obj_bytes);
+
 	buf += sprintf(buf, "data_bytes_per_chunk. %d\n",
 				dev->data_bytes_per_chunk);
 	buf += sprintf(buf, "chunk_grp_bits....... %d\n", dev->chunk_grp_bits);
@@ -3125,6 +3180,8 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 	buf += sprintf(buf, "\n");
 	buf += sprintf(buf, "n_tnodes............. %d\n", dev->n_tnodes);
 	buf += sprintf(buf, "n_obj................ %d\n", dev->n_obj);
+	buf += sprintf(buf, "tnode_bytes.......... %u\n", tnode_bytes);
+	buf += sprintf(buf, "obj_bytes............ %u\n", obj_bytes);
 	buf += sprintf(buf, "n_free_chunks........ %d\n", dev->n_free_chunks);
 	buf += sprintf(buf, "\n");
 	buf += sprintf(buf, "n_page_writes........ %u\n", dev->n_page_writes);
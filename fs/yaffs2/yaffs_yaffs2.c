@@ -936,7 +936,8 @@ static inline int yaffs2_scan_chunk(struct yaffs_dev *dev,
 		int *found_chunks,
 		u8 *chunk_data,
 		struct list_head *hard_list,
-		int summary_available)
+		int summary_available,
+		struct yaffs_ext_tags *block_tags)
 {
 	struct yaffs_obj_hdr *oh;
 	struct yaffs_obj *in;
@@ -958,7 +959,11 @@ static inline int yaffs2_scan_chunk(struct yaffs_dev *dev,
 		tags.seq_number = bi->seq_number;
 	}
 
-	if (!summary_available || tags.obj_id == 0) {
+	if (!summary_available && block_tags) {
+		tags = block_tags[chunk_in_block];
+		result = YAFFS_OK;
+		dev->tags_used++;
+	} else if (!summary_available || tags.obj_id == 0) {
 		result = yaffs_rd_chunk_tags_nand(dev, chunk, NULL, &tags);
 		dev->tags_used++;
 	} else {
@@ -1360,6 +1365,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 	struct yaffs_block_index *block_index = NULL;
 	int alt_block_index = 0;
 	int summary_available;
+	struct yaffs_ext_tags *block_tags = NULL;
+	int block_tags_ok;
 
 	yaffs_trace(YAFFS_TRACE_SCAN,
 		"yaffs2_scan_backwards starts  intstartblk %d intendblk %d...",
@@ -1387,6 +1394,11 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	chunk_data = yaffs_get_temp_buffer(dev);
 
+	/* Blocks without a summary get their tags read in one go if we can */
+	if (dev->param.read_block_tags_fn)
+		block_tags = kmalloc(dev->param.chunks_per_block *
+				     sizeof(struct yaffs_ext_tags), GFP_NOFS);
+
 	/* Scan all the blocks to determine their state */
 	bi = dev->block_info;
 	for (blk = dev->internal_start_block; blk <= dev->internal_end_block;
@@ -1470,6 +1482,9 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 		deleted = 0;
 
 		summary_available = yaffs_summary_read(dev, dev->sum_tags, blk);
+		block_tags_ok = !summary_available && block_tags &&
+			yaffs_rd_block_tags_nand(dev, blk, block_tags) ==
+			YAFFS_OK;
 
 		/* For each chunk in each block that needs scanning.... */
 		found_chunks = 0;
@@ -1488,7 +1503,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 			 */
 			if (yaffs2_scan_chunk(dev, bi, blk, c,
 					&found_chunks, chunk_data,
-					&hard_list, summary_available) ==
+					&hard_list, summary_available,
+					block_tags_ok ? block_tags : NULL) ==
 					YAFFS_FAIL)
 				alloc_failed = 1;
 		}
@@ -1514,6 +1530,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 	else
 		kfree(block_index);
 
+	kfree(block_tags);
+
 	/* Ok, we've done all the scanning.
 	 * Fix up the hard link chains.
 	 * We have scanned all the objects, now it's time to add these
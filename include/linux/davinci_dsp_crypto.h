@@ -0,0 +1,44 @@
+/*
+ * DA8xx crypto offload to the C674x DSP
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _LINUX_DAVINCI_DSP_CRYPTO_H
+#define _LINUX_DAVINCI_DSP_CRYPTO_H
+
+#include <linux/types.h>
+
+/*
+ * Requests travel over the ARM/DSP buffer exchange (davinci_dsp_ipc.h).
+ * A descriptor carrying DSP_CRYPTO_SERVICE in its flags names a buffer
+ * holding a struct dsp_crypto_req followed by len bytes of data.  The
+ * DSP encrypts or decrypts the data in place, leaving the next IV in iv,
+ * or hashes it into digest, sets status and returns the descriptor.
+ * The DSP may batch: the ARM queues several descriptors per kick.
+ */
+#define DSP_CRYPTO_SERVICE	0x50595243	/* "CRYP" */
+
+enum dsp_crypto_op {
+	DSP_CRYPTO_AES_ECB_ENCRYPT = 1,
+	DSP_CRYPTO_AES_ECB_DECRYPT,
+	DSP_CRYPTO_AES_CBC_ENCRYPT,
+	DSP_CRYPTO_AES_CBC_DECRYPT,
+	DSP_CRYPTO_SHA256,
+};
+
+struct dsp_crypto_req {
+	__u32	op;
+	__s32	status;		/* set by the DSP, 0 or a -errno */
+	__u32	len;		/* of the data after this header */
+	__u32	keylen;
+	__u8	key[32];
+	__u8	iv[16];
+	__u8	digest[32];
+};
+
+#endif /* _LINUX_DAVINCI_DSP_CRYPTO_H */
@@ -0,0 +1,103 @@
+/*
+ * DA8xx ARM/DSP shared memory buffer exchange
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _LINUX_DAVINCI_DSP_IPC_H
+#define _LINUX_DAVINCI_DSP_IPC_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * The carve-out starts with a control page the DSP firmware shares:
+ *
+ *	struct dsp_ipc_ctrl
+ *	struct dsp_ipc_desc to_dsp[entries]
+ *	struct dsp_ipc_desc to_arm[entries]
+ *
+ * and the buffer area at buf_offset fills the rest.  Each ring has one
+ * producer, which alone writes head, and one consumer, which alone
+ * writes tail; both are free running entry counts.  Descriptors name
+ * buffers by their offset in the buffer area, so neither side copies
+ * data.  The control page must be mapped uncached on the DSP too.
+ */
+#define DSP_IPC_CTRL_MAGIC	0x43504944	/* "DIPC" */
+
+struct dsp_ipc_desc {
+	__u32	offset;		/* into the buffer area */
+	__u32	len;
+	__u32	cookie;		/* opaque, handed back unchanged */
+	__u32	flags;
+};
+
+/* offset is the physical address of a zcbuf the devices own */
+#define DSP_IPC_F_PHYS		0x80000000
+
+struct dsp_ipc_ring {
+	__u32	head;
+	__u32	tail;
+};
+
+struct dsp_ipc_ctrl {
+	__u32			magic;
+	__u32			entries;	/* per ring, power of 2 */
+	__u32			buf_offset;
+	__u32			dsp_ready;	/* set by the DSP */
+	struct dsp_ipc_ring	to_dsp;
+	struct dsp_ipc_ring	to_arm;
+};
+
+/*
+ * The character device: write() queues struct dsp_ipc_desc to the DSP,
+ * read() returns the ones the DSP queued back, poll() waits for either,
+ * and mmap() at offset 0 maps the buffer area.
+ */
+struct dsp_ipc_info {
+	__u32	phys;		/* of the buffer area, for the DSP */
+	__u32	size;		/* of the buffer area */
+	__u32	entries;
+	__u32	dsp_ready;
+};
+
+#define DSP_IPC_IOC_MAGIC	'D'
+#define DSP_IPC_GET_INFO	_IOR(DSP_IPC_IOC_MAGIC, 0, struct dsp_ipc_info)
+
+#ifdef __KERNEL__
+/**
+ * struct davinci_dsp_ipc_platform_data - CHIPSIG lines used by the channel
+ * @arm_sig: CHIPSIG bit the DSP raises towards the ARM (0 or 1), matching
+ *	the CHIPINT interrupt resource
+ * @dsp_sig: CHIPSIG bit the ARM raises towards the DSP (2 or 3)
+ */
+struct davinci_dsp_ipc_platform_data {
+	u8	arm_sig;
+	u8	dsp_sig;
+};
+
+/*
+ * In-kernel users claim the channel instead of opening the device, and
+ * the two exclude each other.  Buffers come from a pool over the buffer
+ * area, mapped write-combined; dsp_ipc_send() queues all of its
+ * descriptors or none, with a single kick, and @rx is called from a
+ * tasklet for each descriptor the DSP hands back.
+ */
+struct dsp_ipc;
+
+struct dsp_ipc *dsp_ipc_claim(void (*rx)(void *data,
+					 const struct dsp_ipc_desc *desc),
+			      void *data);
+void dsp_ipc_unclaim(struct dsp_ipc *ipc);
+bool dsp_ipc_dsp_ready(struct dsp_ipc *ipc);
+void *dsp_ipc_alloc(struct dsp_ipc *ipc, size_t len, u32 *offset);
+void dsp_ipc_free(struct dsp_ipc *ipc, u32 offset, size_t len);
+int dsp_ipc_send(struct dsp_ipc *ipc, const struct dsp_ipc_desc *desc,
+		 unsigned int n);
+#endif
+
+#endif /* _LINUX_DAVINCI_DSP_IPC_H */
@@ -0,0 +1,49 @@
+/*
+ * DA850 eCAP edge timestamping
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _LINUX_DAVINCI_ECAP_CAPTURE_H
+#define _LINUX_DAVINCI_ECAP_CAPTURE_H
+
+#include <linux/types.h>
+
+/*
+ * The eCAP latches its free running counter on both edges of its input
+ * pin.  Each edge is reported as a PPS event (assert on the rising edge
+ * unless the board inverts it) and as one struct ecap_event read() from
+ * /dev/ecap_capN.  The time is CLOCK_REALTIME at the latch, not at the
+ * interrupt.
+ *
+ * The device keeps the last 64 events; a reader that falls further
+ * behind loses the oldest, and the first event it gets after the gap
+ * carries ECAP_EVENT_OVERRUN.  Opening the device discards older events.
+ */
+#define ECAP_EVENT_ASSERT	0x0001	/* else the clear edge */
+#define ECAP_EVENT_OVERRUN	0x0002	/* events were lost before this one */
+
+struct ecap_event {
+	__s64	sec;
+	__u32	nsec;
+	__u32	seq;		/* per device, counts every edge */
+	__u32	counter;	/* raw eCAP counter latch */
+	__u32	flags;
+};
+
+#ifdef __KERNEL__
+/**
+ * struct davinci_ecap_capture_platform_data - eCAP capture board setup
+ * @invert: the signal reaches the pin inverted, so assert is the falling
+ *	edge
+ */
+struct davinci_ecap_capture_platform_data {
+	bool	invert;
+};
+#endif
+
+#endif /* _LINUX_DAVINCI_ECAP_CAPTURE_H */
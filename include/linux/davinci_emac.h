@@ -26,6 +26,14 @@ struct emac_platform_data {
 	u32 mdio_max_freq;
 	u8 rmii_en;
 	u8 version;
+	u8 num_tx_ch;	/* TX channels/netdev queues, 0 = 1 channel */
+	u8 num_rx_ch;	/* RX channels, 0 = 1 channel */
+	u8 rx_bcast_ch;	/* RX channel for broadcast frames */
+	u8 rx_mcast_ch;	/* RX channel for multicast frames */
+	u8 rx_prom_ch;	/* RX channel for promiscuous frames */
+	u8 bd_ddr;	/* rings not fitting CPPI RAM go to DDR */
+	u16 tx_ring_size;	/* BD's per TX channel, 0 = share CPPI RAM */
+	u16 rx_ring_size;	/* BD's per RX channel, 0 = share CPPI RAM */
 	void (*interrupt_enable) (void);
 	void (*interrupt_disable) (void);
 };
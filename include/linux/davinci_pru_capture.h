@@ -0,0 +1,94 @@
+/*
+ * DA8xx PRU logic capture
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _LINUX_DAVINCI_PRU_CAPTURE_H
+#define _LINUX_DAVINCI_PRU_CAPTURE_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * A PRU samples 8 or 16 consecutive bits of its R31 inputs at a fixed
+ * rate into a ring of buf_size bytes, which mmap() at offset 0 maps read
+ * only.  Samples are packed little endian, one or two bytes each.
+ *
+ * Data moves in ring order: PRUCAP_IOC_SYNC hands @release bytes back to
+ * the driver and returns the run of captured bytes the caller now owns,
+ * starting at ring offset @offset.  The firmware publishes its position
+ * every @notify bytes and when it stops, and poll() reports POLLIN when
+ * data is waiting.  Samples that find the ring full are dropped and
+ * counted, the capture itself keeps its timing.
+ *
+ * Capture starts with PRUCAP_IOC_START, at once or once the trigger
+ * condition on (sample & trig_mask) is met, and runs until
+ * PRUCAP_IOC_STOP or close().
+ */
+#define PRUCAP_TRIG_NONE	0	/* capture from the start */
+#define PRUCAP_TRIG_LEVEL	1	/* when the pins match trig_value */
+#define PRUCAP_TRIG_EDGE	2	/* when the pins come to match it */
+
+#define PRUCAP_STATE_IDLE	0
+#define PRUCAP_STATE_ARMED	1	/* waiting for the trigger */
+#define PRUCAP_STATE_CAPTURE	2
+
+struct prucap_info {
+	__u32	buf_size;
+	__u32	pru_rate;	/* PRU clock, Hz */
+	__u32	max_rate;	/* highest sample rate, Hz */
+};
+
+struct prucap_config {
+	__u32	rate;		/* samples per second */
+	__u32	shift;		/* first R31 bit sampled */
+	__u32	width;		/* bytes per sample: 1 or 2 */
+	__u32	notify;		/* bytes between wakeups, power of 2 */
+	__u32	trig_mode;
+	__u32	trig_mask;	/* applied to the shifted sample */
+	__u32	trig_value;
+};
+
+struct prucap_sync {
+	__u32	release;	/* in: bytes given back to the driver */
+	__u32	offset;		/* out: ring offset of the caller's data */
+	__u32	count;		/* out: bytes owned, wrapping at buf_size */
+};
+
+struct prucap_status {
+	__u32	state;
+	__u32	rate;		/* actual sample rate, Hz */
+	__u32	captured;	/* bytes written to the ring */
+	__u32	dropped;	/* bytes lost to a full ring */
+};
+
+#define PRUCAP_IOC_MAGIC	'p'
+#define PRUCAP_IOC_GET_INFO	_IOR(PRUCAP_IOC_MAGIC, 0x40, struct prucap_info)
+#define PRUCAP_IOC_SET_CONFIG	_IOW(PRUCAP_IOC_MAGIC, 0x41, struct prucap_config)
+#define PRUCAP_IOC_START	_IO(PRUCAP_IOC_MAGIC, 0x42)
+#define PRUCAP_IOC_STOP		_IO(PRUCAP_IOC_MAGIC, 0x43)
+#define PRUCAP_IOC_SYNC		_IOWR(PRUCAP_IOC_MAGIC, 0x44, struct prucap_sync)
+#define PRUCAP_IOC_GET_STATUS	_IOR(PRUCAP_IOC_MAGIC, 0x45, struct prucap_status)
+
+#ifdef __KERNEL__
+/**
+ * struct davinci_pru_capture_platform_data - PRU capture resources
+ * @core: PRU core running the capture firmware, 0 or 1
+ * @event: system event the firmware raises, 32..47
+ * @host: ARM host interrupt the event is routed to, 2..9
+ *
+ * The pins sampled must be muxed to the core's R31 inputs by the board.
+ */
+struct davinci_pru_capture_platform_data {
+	unsigned	core;
+	unsigned	event;
+	unsigned	host;
+};
+#endif
+
+#endif /* _LINUX_DAVINCI_PRU_CAPTURE_H */
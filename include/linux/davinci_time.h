@@ -0,0 +1,61 @@
+/*
+ * DaVinci user space time page
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _LINUX_DAVINCI_TIME_H
+#define _LINUX_DAVINCI_TIME_H
+
+#include <linux/types.h>
+
+/*
+ * /dev/davinci_time can be mmap()ed read-only, one page at each offset:
+ *
+ *	0		struct davinci_time_data, refreshed every tick
+ *	PAGE_SIZE	the registers of the 64-bit clocksource timer
+ *
+ * Both are uncached, so a reader needs no cache maintenance.  To read
+ * the time:
+ *
+ *	do {
+ *		while ((seq = data->seq) & 1)
+ *			;
+ *		if (!data->valid)
+ *			use the syscall;
+ *		do {
+ *			hi = timer[data->tim34 / 4];
+ *			lo = timer[data->tim12 / 4];
+ *		} while (hi != timer[data->tim34 / 4]);
+ *		cycles = ((__u64)hi << 32) | lo;
+ *		nsec = data->wall_nsec +
+ *			(((cycles - data->cycle_last) * data->mult)
+ *				>> data->shift);
+ *		sec = data->wall_sec;
+ *	} while (data->seq != seq);
+ *
+ * then carry nsec into sec.  CLOCK_MONOTONIC adds mono_sec/mono_nsec.
+ * valid is clear whenever timekeeping runs off a clocksource user space
+ * can't read, for instance when cpufreq gave up the 64-bit one.
+ */
+struct davinci_time_data {
+	__u32	seq;		/* odd while being updated */
+	__u32	valid;
+	__u64	cycle_last;
+	__u32	mult;
+	__u32	shift;
+	__u32	wall_sec;
+	__u32	wall_nsec;
+	__s32	mono_sec;	/* wall_to_monotonic */
+	__s32	mono_nsec;
+	__s32	tz_minuteswest;
+	__s32	tz_dsttime;
+	__u32	tim12;		/* offsets in the timer page */
+	__u32	tim34;
+};
+
+#endif /* _LINUX_DAVINCI_TIME_H */
@@ -0,0 +1,127 @@
+/*
+ * DA850/OMAP-L138 uPP (Universal Parallel Port) streaming
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _LINUX_DAVINCI_UPP_H
+#define _LINUX_DAVINCI_UPP_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * Each enabled channel streams through a ring of nr_bufs buffers of
+ * buf_size bytes, which mmap() at offset 0 maps in one piece; a channel's
+ * ring starts at its info offset.  Buffer ownership moves in ring order:
+ * UPP_IOC_SYNC hands @release buffers back to the driver (received ones
+ * consumed, or ones to transmit filled) and returns the run of buffers
+ * the caller now owns, starting at ring index @index.  poll() reports
+ * POLLIN when a receive channel has data and POLLOUT when a transmit
+ * channel has room.
+ */
+#define UPP_NUM_CHANNELS	2
+#define UPP_CHAN_A		0
+#define UPP_CHAN_B		1
+
+#define UPP_DIR_NONE		0	/* channel not in use */
+#define UPP_DIR_RX		1
+#define UPP_DIR_TX		2
+
+struct upp_chan_info {
+	__u32	dir;
+	__u32	offset;		/* of the ring in the mapping */
+};
+
+struct upp_info {
+	__u32			buf_size;
+	__u32			nr_bufs;
+	__u32			map_size;
+	struct upp_chan_info	chan[UPP_NUM_CHANNELS];
+};
+
+struct upp_sync {
+	__u32	chan;
+	__u32	release;	/* in: buffers given back to the driver */
+	__u32	index;		/* out: first buffer owned by the caller */
+	__u32	count;		/* out: buffers owned, wrapping at nr_bufs */
+};
+
+struct upp_chan_stats {
+	__u32	windows;	/* buffers completed by the DMA */
+	__u32	starved;	/* DMA ran out of buffers (rx overrun/tx underrun) */
+	__u32	fifo_errors;	/* port FIFO overrun or underrun */
+	__u32	dma_errors;	/* DMA programming or internal bus errors */
+};
+
+struct upp_stats {
+	struct upp_chan_stats	chan[UPP_NUM_CHANNELS];
+};
+
+#define UPP_IOC_MAGIC		'u'
+#define UPP_IOC_GET_INFO	_IOR(UPP_IOC_MAGIC, 0x60, struct upp_info)
+#define UPP_IOC_START		_IO(UPP_IOC_MAGIC, 0x61)
+#define UPP_IOC_STOP		_IO(UPP_IOC_MAGIC, 0x62)
+#define UPP_IOC_SYNC		_IOWR(UPP_IOC_MAGIC, 0x63, struct upp_sync)
+#define UPP_IOC_GET_STATS	_IOR(UPP_IOC_MAGIC, 0x64, struct upp_stats)
+
+#ifdef __KERNEL__
+/* UPCTL: channel configuration */
+#define UPP_UPCTL_MODE_RX	0	/* A and B receive */
+#define UPP_UPCTL_MODE_TX	1	/* A and B transmit */
+#define UPP_UPCTL_MODE_ARX_BTX	2
+#define UPP_UPCTL_MODE_ATX_BRX	3
+#define UPP_UPCTL_MODE_MASK	3
+#define UPP_UPCTL_CHN		BIT(2)	/* dual channel */
+#define UPP_UPCTL_SDRTXIL	BIT(3)
+#define UPP_UPCTL_DDRDEMUX	BIT(4)
+#define UPP_UPCTL_DRA		BIT(16)	/* double data rate, A */
+#define UPP_UPCTL_IWA		BIT(17)	/* 16 bit interface, A */
+#define UPP_UPCTL_DPWA(n)	((n) << 18)
+#define UPP_UPCTL_DPFA(n)	((n) << 21)
+#define UPP_UPCTL_DRB		BIT(24)
+#define UPP_UPCTL_IWB		BIT(25)
+#define UPP_UPCTL_DPWB(n)	((n) << 26)
+#define UPP_UPCTL_DPFB(n)	((n) << 29)
+
+/* UPICR: interface signals, channel A in the low half, B in the high */
+#define UPP_UPICR_STARTPOL	BIT(0)
+#define UPP_UPICR_ENAPOL	BIT(1)
+#define UPP_UPICR_WAITPOL	BIT(2)
+#define UPP_UPICR_START		BIT(3)
+#define UPP_UPICR_ENA		BIT(4)
+#define UPP_UPICR_WAIT		BIT(5)
+#define UPP_UPICR_CLKDIV(n)	((n) << 8)
+#define UPP_UPICR_CLKINV	BIT(12)
+#define UPP_UPICR_TRIS		BIT(13)
+#define UPP_UPICR_B(v)		((v) << 16)
+
+/* UPTCR: DMA read thresholds, 0 = 64, 1 = 128, 3 = 256 bytes */
+#define UPP_UPTCR_RDSIZEI(n)	((n) << 0)
+#define UPP_UPTCR_RDSIZEQ(n)	((n) << 8)
+#define UPP_UPTCR_TXSIZEA(n)	((n) << 16)
+#define UPP_UPTCR_TXSIZEB(n)	((n) << 24)
+
+/**
+ * struct davinci_upp_platform_data - uPP wiring on the board
+ * @upctl: UPCTL value: mode, channel count, widths and data formats
+ * @upicr: UPICR value: control signals, polarities and clock dividers
+ * @upivr: UPIVR value: idle levels driven by transmit channels
+ * @uptcr: UPTCR value: DMA thresholds
+ *
+ * Channel A is always served by DMA channel I and channel B, when
+ * UPP_UPCTL_CHN is set, by DMA channel Q.
+ */
+struct davinci_upp_platform_data {
+	u32	upctl;
+	u32	upicr;
+	u32	upivr;
+	u32	uptcr;
+};
+#endif
+
+#endif /* _LINUX_DAVINCI_UPP_H */
@@ -0,0 +1,97 @@
+/*
+ * DaVinci zero-copy buffers shared by capture, DSP and network
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _LINUX_DAVINCI_ZCBUF_H
+#define _LINUX_DAVINCI_ZCBUF_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * A buffer is physically contiguous and always has exactly one owner.
+ * The CPU owns it after ZCBUF_ALLOC; handing it to a device that writes
+ * it (V4L2 capture, a DSP producing output) or to devices that read it
+ * (a DSP consuming input, socket TX) takes ZCBUF_SET_OWNER, and that is
+ * the only place the kernel does cache maintenance for it.  Moving a
+ * buffer away from ZCBUF_OWNER_DEV_READ fails with EBUSY while the
+ * network stack still holds pages of it.
+ *
+ * mmap() at offset id * page size maps a buffer write-combined.  Such
+ * a mapping can be queued to a videobuf-dma-contig driver as a V4L2
+ * USERPTR buffer and its phys used in DSP IPC descriptors flagged
+ * DSP_IPC_F_PHYS.
+ */
+#define ZCBUF_OWNER_CPU		0
+#define ZCBUF_OWNER_DEV_WRITE	1
+#define ZCBUF_OWNER_DEV_READ	2
+
+struct zcbuf_alloc {
+	__u32	size;		/* in: bytes, rounded up to pages */
+	__u32	id;		/* out */
+	__u32	phys;		/* out: for the DSP */
+};
+
+struct zcbuf_owner {
+	__u32	id;
+	__u32	owner;		/* ZCBUF_OWNER_* */
+};
+
+/*
+ * Queue len bytes at offset of the buffer on socket fd by page
+ * reference, with MSG_MORE and MSG_DONTWAIT taken from flags.  The
+ * buffer moves to ZCBUF_OWNER_DEV_READ first.  Returns the bytes
+ * queued.
+ */
+struct zcbuf_send {
+	__u32	id;
+	__u32	offset;
+	__u32	len;
+	__s32	fd;
+	__u32	flags;
+};
+
+#define ZCBUF_IOC_MAGIC		'z'
+#define ZCBUF_ALLOC		_IOWR(ZCBUF_IOC_MAGIC, 0, struct zcbuf_alloc)
+#define ZCBUF_FREE		_IOW(ZCBUF_IOC_MAGIC, 1, __u32)
+#define ZCBUF_SET_OWNER		_IOW(ZCBUF_IOC_MAGIC, 2, struct zcbuf_owner)
+#define ZCBUF_SEND		_IOW(ZCBUF_IOC_MAGIC, 3, struct zcbuf_send)
+
+#ifdef __KERNEL__
+#include <linux/mm.h>
+
+#if defined(CONFIG_DAVINCI_ZCBUF) || defined(CONFIG_DAVINCI_ZCBUF_MODULE)
+int zcbuf_check_phys(u32 phys, u32 len);
+#else
+static inline int zcbuf_check_phys(u32 phys, u32 len)
+{
+	return -EINVAL;
+}
+#endif
+
+/*
+ * Marks the pages of a buffer the devices own for reading: the CPU
+ * cache holds nothing dirty of them, so a driver mapping such a page
+ * DMA_TO_DEVICE may use its bus address as is.  PG_owner_priv_1 is
+ * PG_checked of filesystems, hence the magic and the mapping test.
+ */
+#define ZCBUF_PAGE_CLEAN	0x7a636266	/* "zcbf" */
+
+static inline bool zcbuf_page_clean(struct page *page)
+{
+#if defined(CONFIG_DAVINCI_ZCBUF) || defined(CONFIG_DAVINCI_ZCBUF_MODULE)
+	return PageOwnerPriv1(page) && !page->mapping &&
+	       page_private(page) == ZCBUF_PAGE_CLEAN;
+#else
+	return false;
+#endif
+}
+#endif
+
+#endif /* _LINUX_DAVINCI_ZCBUF_H */
@@ -0,0 +1,77 @@
+#ifndef __LINUX_DMA_CONTIGUOUS_H
+#define __LINUX_DMA_CONTIGUOUS_H
+
+/*
+ * Contiguous DMA regions.
+ *
+ * Board code reserves named regions of RAM early at boot and lists the
+ * devices each one serves. Until those devices need the memory it is handed
+ * to the page allocator as MIGRATE_CMA pageblocks, which only back movable
+ * (page cache and anonymous) allocations. A coherent DMA allocation for one
+ * of the devices migrates whatever is in the way and takes the range back,
+ * so large buffers stay guaranteed without keeping the memory idle.
+ */
+
+#ifdef __KERNEL__
+
+#include <linux/types.h>
+
+struct device;
+struct page;
+
+/**
+ * struct cma_region - a contiguous DMA region declared by board code
+ * @name:	short name shown in the region listing
+ * @size:	size in bytes, rounded up to whole pageblocks
+ * @base:	physical start address, or 0 to place the region anywhere
+ * @devs:	comma separated dev_name()s whose coherent allocations are
+ *		served from this region, e.g. "vpif_capture,vpif_display"
+ *
+ * The remaining fields are private to the allocator.
+ */
+struct cma_region {
+	const char	*name;
+	unsigned long	size;
+	phys_addr_t	base;
+	const char	*devs;
+
+	unsigned long	base_pfn;
+	unsigned long	count;
+	unsigned long	*bitmap;
+	unsigned long	used;
+};
+
+#ifdef CONFIG_CMA
+
+extern int dma_contiguous_reserve(struct cma_region *regions, int nr);
+
+extern struct page *dma_alloc_from_contiguous(struct device *dev, int count,
+					      unsigned int order);
+extern bool dma_release_from_contiguous(struct device *dev, struct page *pages,
+					int count);
+
+#else
+
+static inline int dma_contiguous_reserve(struct cma_region *regions, int nr)
+{
+	return 0;
+}
+
+static inline struct page *dma_alloc_from_contiguous(struct device *dev,
+						     int count,
+						     unsigned int order)
+{
+	return NULL;
+}
+
+static inline bool dma_release_from_contiguous(struct device *dev,
+					       struct page *pages, int count)
+{
+	return false;
+}
+
+#endif
+
+#endif
+
+#endif
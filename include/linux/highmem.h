@@ -4,6 +4,7 @@
 #include <linux/fs.h>
 #include <linux/mm.h>
 #include <linux/uaccess.h>
+#include <linux/zero_pool.h>
 
 #include <asm/cacheflush.h>
 
@@ -105,9 +106,13 @@ __alloc_zeroed_user_highpage(gfp_t movableflags,
 			struct vm_area_struct *vma,
 			unsigned long vaddr)
 {
-	struct page *page = alloc_page_vma(GFP_HIGHUSER | movableflags,
-			vma, vaddr);
+	struct page *page;
 
+	page = zero_pool_get_page(GFP_HIGHUSER | movableflags);
+	if (page)
+		return page;
+
+	page = alloc_page_vma(GFP_HIGHUSER | movableflags, vma, vaddr);
 	if (page)
 		clear_user_highpage(page, vaddr);
 
@@ -17,3 +17,12 @@ struct pca953x_platform_data {
 				void *context);
 	char		**names;
 };
+
+/*
+ * Batched access to all pins of one expander, @gpio being its gpio_base.
+ * Wiring the expander INT line up as the i2c_board_info irq lets reads
+ * be served from a cache that is only refilled on change.
+ */
+extern int pca953x_gpio_set_multiple(unsigned gpio, uint16_t mask,
+				     uint16_t bits);
+extern int pca953x_gpio_get_multiple(unsigned gpio, uint16_t *bits);
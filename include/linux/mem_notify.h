@@ -0,0 +1,16 @@
+#ifndef _LINUX_MEM_NOTIFY_H
+#define _LINUX_MEM_NOTIFY_H
+
+/*
+ * Memory pressure notification, see mm/mem_notify.c
+ */
+
+#ifdef CONFIG_MEM_NOTIFY
+extern void mem_notify_reclaim(void);
+#else
+static inline void mem_notify_reclaim(void)
+{
+}
+#endif
+
+#endif /* _LINUX_MEM_NOTIFY_H */
@@ -81,6 +81,16 @@ struct mmc_host_ops {
 	 */
 	int (*enable)(struct mmc_host *host);
 	int (*disable)(struct mmc_host *host, int lazy);
+	/*
+	 * 'pre_req' may map and program a request's data ahead of 'request',
+	 * so that work overlaps whatever the host is doing at the time, and
+	 * 'post_req' undoes it once the request has completed.  Hosts tag
+	 * prepared data through its 'host_cookie'.  Both are optional, and
+	 * 'request' must still cope with data that was never prepared.
+	 */
+	void	(*pre_req)(struct mmc_host *host, struct mmc_request *req);
+	void	(*post_req)(struct mmc_host *host, struct mmc_request *req,
+			    int err);
 	void	(*request)(struct mmc_host *host, struct mmc_request *req);
 	/*
 	 * Avoid calling these three functions too often or in a "fast path",
@@ -151,11 +161,14 @@ struct mmc_host {
 #define MMC_CAP_DISABLE		(1 << 7)	/* Can the host be disabled */
 #define MMC_CAP_NONREMOVABLE	(1 << 8)	/* Nonremovable e.g. eMMC */
 #define MMC_CAP_WAIT_WHILE_BUSY	(1 << 9)	/* Waits while card is busy */
+#define MMC_CAP_CMD23		(1 << 10)	/* Can issue mrq->sbc (CMD23) */
 
 	/* host specific block data */
 	unsigned int		max_seg_size;	/* see blk_queue_max_segment_size */
 	unsigned short		max_hw_segs;	/* see blk_queue_max_hw_segments */
 	unsigned short		max_phys_segs;	/* see blk_queue_max_phys_segments */
+	unsigned short		bounce_segs;	/* bounce requests with more
+						 * segments (0: off) */
 	unsigned short		unused;
 	unsigned int		max_req_size;	/* maximum number of bytes in one req */
 	unsigned int		max_blk_size;	/* maximum size of one mmc block */
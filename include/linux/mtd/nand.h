@@ -86,6 +86,13 @@ extern void nand_wait_ready(struct mtd_info *mtd);
 #define NAND_CMD_READSTART	0x30
 #define NAND_CMD_RNDOUTSTART	0xE0
 #define NAND_CMD_CACHEDPROG	0x15
+#define NAND_CMD_READCACHESEQ	0x31
+#define NAND_CMD_READCACHEEND	0x3f
+#define NAND_CMD_MULTI_PAGEPROG	0x11
+#define NAND_CMD_MULTI_SEQIN	0x81
+
+/* ONFI commands */
+#define NAND_CMD_PARAM		0xec
 
 /* Extended commands for AG-AND device */
 /*
@@ -169,6 +176,8 @@ typedef enum {
 #define NAND_NO_READRDY		0x00000100
 /* Chip does not allow subpage writes */
 #define NAND_NO_SUBPAGE_WRITE	0x00000200
+/* Chip has read cache (sequential) function */
+#define NAND_CACHERD		0x00000400
 
 /* Options valid for Samsung large page devices */
 #define NAND_SAMSUNG_LP_OPTIONS \
@@ -179,6 +188,8 @@ typedef enum {
 #define NAND_MUST_PAD(chip) (!(chip->options & NAND_NO_PADDING))
 #define NAND_HAS_CACHEPROG(chip) ((chip->options & NAND_CACHEPRG))
 #define NAND_HAS_COPYBACK(chip) ((chip->options & NAND_COPYBACK))
+#define NAND_HAS_CACHEREAD(chip) ((chip->options & NAND_CACHERD))
+#define NAND_HAS_MULTIPLANE(chip) ((chip)->plane_seqin != 0)
 /* Large page NAND with SOFT_ECC should support subpage reads */
 #define NAND_SUBPAGE_READ(chip) ((chip->ecc.mode == NAND_ECC_SOFT) \
 					&& (chip->page_shift > 9))
@@ -197,6 +208,10 @@ typedef enum {
 #define NAND_OWN_BUFFERS	0x00040000
 /* Chip may not exist, so silence any errors in scan */
 #define NAND_SCAN_SILENT_NODEV	0x00080000
+/* The controller driver copes with cache read and multi-plane program
+ * sequences: its read_page doesn't issue page commands of its own, so
+ * whole eraseblock reads and writes may use them when the chip can. */
+#define NAND_PIPELINE_OPS	0x00100000
 
 /* Options set by nand scan */
 /* Nand scan has allocated controller struct */
@@ -205,6 +220,7 @@ typedef enum {
 /* Cell info constants */
 #define NAND_CI_CHIPNR_MSK	0x03
 #define NAND_CI_CELLTYPE_MSK	0x0C
+#define NAND_CI_SIMULPROG_MSK	0x30
 
 /* Keep gcc happy */
 struct nand_chip;
@@ -336,6 +352,8 @@ struct nand_buffers {
  *			special functionality. See the defines for further explanation
  * @badblockpos:	[INTERN] position of the bad block marker in the oob area
  * @cellinfo:		[INTERN] MLC/multichip data from chip ident
+ * @plane_seqin:	[INTERN] command opening the second plane of a two-plane
+ *			program, 0 if the chip can't program two planes at once
  * @numchips:		[INTERN] number of physical chips
  * @chipsize:		[INTERN] the size of one chip for multichip arrays
  * @pagemask:		[INTERN] page number mask = number of (pages / chip) - 1
@@ -390,6 +408,7 @@ struct nand_chip {
 	int		pagebuf;
 	int		subpagesize;
 	uint8_t		cellinfo;
+	unsigned	plane_seqin;
 	int		badblockpos;
 
 	flstate_t	state;
@@ -462,6 +481,7 @@ extern struct nand_manufacturers nand_manuf_ids[];
 
 extern int nand_scan_bbt(struct mtd_info *mtd, struct nand_bbt_descr *bd);
 extern int nand_update_bbt(struct mtd_info *mtd, loff_t offs);
+extern int nand_verify_bbt(struct mtd_info *mtd);
 extern int nand_default_bbt(struct mtd_info *mtd);
 extern int nand_isbad_bbt(struct mtd_info *mtd, loff_t offs, int allowbbt);
 extern int nand_erase_nand(struct mtd_info *mtd, struct erase_info *instr,
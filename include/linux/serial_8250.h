@@ -14,6 +14,22 @@
 #include <linux/serial_core.h>
 #include <linux/platform_device.h>
 
+/*
+ * Optional DMA engine for a platform port.  While startup() has succeeded
+ * the DMA code owns the data path: the 8250 core no longer reads RBR or
+ * feeds THR, it only services line and modem status interrupts, and
+ * hands start_tx() over with the port lock held.
+ */
+struct plat_serial8250_dma {
+	unsigned char	fcr;		/* FCR while DMA is active */
+	int		(*startup)(struct plat_serial8250_dma *,
+				   struct uart_port *);
+	void		(*shutdown)(struct plat_serial8250_dma *,
+				    struct uart_port *);
+	void		(*start_tx)(struct plat_serial8250_dma *,
+				    struct uart_port *);
+};
+
 /*
  * This is the platform device platform_data structure
  */
@@ -33,6 +49,7 @@ struct plat_serial8250_port {
 	unsigned int	type;		/* If UPF_FIXED_TYPE */
 	unsigned int	(*serial_in)(struct uart_port *, int);
 	void		(*serial_out)(struct uart_port *, int, int);
+	struct plat_serial8250_dma *dma;
 };
 
 /*
@@ -0,0 +1,46 @@
+/*
+ * User interface of the DaVinci SPI slave receiver
+ *
+ * The controller runs as an SPI slave and an EDMA ring catches everything
+ * the external master clocks in. The ring is read with read(), or mapped
+ * read-only with mmap() and consumed through the ioctls below; poll()
+ * reports data as each period lands.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef DAVINCI_SPI_SLAVE_H
+#define DAVINCI_SPI_SLAVE_H
+
+#include <linux/types.h>
+
+/**
+ * struct spis_status - state of the receive ring
+ * @buf_size: ring size in bytes; a power of two, the mmap() length
+ * @period_size: bytes the DMA lands between interrupts
+ * @head: bytes received since open, modulo 2^32
+ * @tail: bytes consumed since open, modulo 2^32
+ * @overruns: times the reader fell so far behind that data was dropped
+ * @hw_overruns: words lost in the controller because DMA was too late
+ *
+ * Received data is at ring offset (@tail % @buf_size) and is
+ * (@head - @tail) bytes long, possibly wrapping around the ring end.
+ */
+struct spis_status {
+	__u32		buf_size;
+	__u32		period_size;
+	__u32		head;
+	__u32		tail;
+	__u32		overruns;
+	__u32		hw_overruns;
+};
+
+#define SPIS_IOC_MAGIC			'k'
+
+#define SPIS_IOC_STATUS		_IOR(SPIS_IOC_MAGIC, 0x40, struct spis_status)
+/* mark bytes read through the mapping as consumed */
+#define SPIS_IOC_CONSUME	_IOW(SPIS_IOC_MAGIC, 0x41, __u32)
+
+#endif /* DAVINCI_SPI_SLAVE_H */
@@ -141,6 +141,17 @@ extern void arch_suspend_disable_irqs(void);
  */
 extern void arch_suspend_enable_irqs(void);
 
+/**
+ * arch_device_resume_time - account for a device's resume callbacks
+ * @dev: device just resumed
+ * @usecs: time taken by its bus, type and class resume callbacks
+ *
+ * Called during resume from suspend for every device resumed.  This is a
+ * weak symbol in the common code doing nothing, so that platforms can
+ * track what holds up resume.
+ */
+extern void arch_device_resume_time(struct device *dev, s64 usecs);
+
 extern int pm_suspend(suspend_state_t state);
 #else /* !CONFIG_SUSPEND */
 #define suspend_valid_only_mem	NULL
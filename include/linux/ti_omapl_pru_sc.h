@@ -0,0 +1,58 @@
+/*
+ *  linux/include/linux/ti_omapl_pru_sc.h
+ *
+ * Block mode for the TI OMAPL PRU smart card reader
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation version 2.
+ */
+#ifndef _LINUX_TI_OMAPL_PRU_SC_H
+#define _LINUX_TI_OMAPL_PRU_SC_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * ISO 7816-3 T=1 blocks are exchanged whole with ioctl()s on the reader's
+ * ttySU port instead of through read() and write(): the driver sends the
+ * block, collects the card's answer in its interrupt handler as the PRU
+ * delivers it, and wakes the caller once, when the answer's length field
+ * says it is complete.  The tty keeps working for ATR and T=0 traffic in
+ * between.
+ */
+
+/* prologue, up to 254 information bytes, CRC */
+#define SC_T1_MAX_BLOCK		(3 + 254 + 2)
+
+#define SC_BLOCK_CRC		0x0001	/* two byte CRC epilogue, else LRC */
+
+struct sc_block_xfer {
+	__u32	tx_len;
+	__u32	rx_len;		/* out: bytes in rx */
+	__u32	bwt_ms;		/* block waiting time, from the start */
+	__u32	flags;
+	__u8	tx[SC_T1_MAX_BLOCK];
+	__u8	rx[SC_T1_MAX_BLOCK];
+};
+
+/*
+ * Protocol and parameters selection.  Send it right after the ATR; on
+ * success the port runs at the new rate until the next termios change.
+ * Only Fi = 372 (FI 0 or 1) with Di = 1, 2 or 4 (DI 1..3) can be set.
+ */
+struct sc_pps {
+	__u8	protocol;	/* T */
+	__u8	fi;		/* FI and DI as coded in TA1 */
+	__u8	di;
+	__u8	reserved;
+	__u32	timeout_ms;
+};
+
+#define SC_IOC_MAGIC		'S'
+#define SC_IOC_T1_XFER		_IOWR(SC_IOC_MAGIC, 0x70, struct sc_block_xfer)
+#define SC_IOC_PPS		_IOW(SC_IOC_MAGIC, 0x71, struct sc_pps)
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef _LINUX_ZERO_POOL_H
+#define _LINUX_ZERO_POOL_H
+
+#include <linux/gfp.h>
+
+/*
+ * Pool of pages zeroed ahead of time, drawn from by anonymous page
+ * faults and get_zeroed_page(). Provided by the platform, such as a
+ * DMA engine filling pages while the CPU is idle.
+ */
+
+#ifdef CONFIG_ZERO_PAGE_POOL
+extern struct page *zero_pool_get_page(gfp_t gfp_mask);
+#else
+static inline struct page *zero_pool_get_page(gfp_t gfp_mask)
+{
+	return NULL;
+}
+#endif
+
+#endif /* _LINUX_ZERO_POOL_H */
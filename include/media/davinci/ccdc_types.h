@@ -40,4 +40,13 @@ enum ccdc_buftype {
 	CCDC_BUFTYPE_FLD_INTERLEAVED,
 	CCDC_BUFTYPE_FLD_SEPARATED
 };
+
+/*
+ * CCDC controls for raw capture.  The A-law input window picks the ten
+ * input bits compressed to 8 when an 8 bit Bayer format is selected (enum
+ * ccdc_gamma_width); the data shift (DM355 only) drops low order bits
+ * before the data is stored (enum ccdc_datasft).
+ */
+#define CCDC_CID_ALAW_GAMMA_WD	(V4L2_CID_PRIVATE_BASE + 0)
+#define CCDC_CID_DATA_SHIFT	(V4L2_CID_PRIVATE_BASE + 1)
 #endif
@@ -149,6 +149,9 @@ struct vpfe_device {
 	 * is different from the image window
 	 */
 	struct v4l2_rect crop;
+	/* CCDC decimation of the crop window, 1 when off */
+	unsigned int hdiv;
+	unsigned int vdiv;
 	/* Buffer queue used in video-buf */
 	struct videobuf_queue buffer_queue;
 	/* Queue of filled frames */
@@ -163,6 +166,8 @@ struct vpfe_device {
 	u32 io_usrs;
 	/* Indicates whether streaming started */
 	u8 started;
+	/* holds a VPSS external memory priority request */
+	u8 dma_prio;
 	/*
 	 * offset where second field starts from the starting of the
 	 * buffer for field seperated YCbCr formats
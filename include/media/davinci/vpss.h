@@ -66,4 +66,19 @@ enum vpss_wbl_sel {
 	VPSS_PCR_CCDC_WBL_O,
 };
 int vpss_clear_wbl_overflow(enum vpss_wbl_sel wbl_sel);
+/* overflows found by vpss_clear_wbl_overflow() on dm644x */
+unsigned int vpss_wbl_overflows(enum vpss_wbl_sel wbl_sel);
+
+/* VPSS sides competing for external memory on dm644x */
+enum vpss_dma_master {
+	VPSS_DMA_DISPLAY,	/* VPBE: OSD and video windows */
+	VPSS_DMA_CAPTURE,	/* VPFE: CCDC, previewer, resizer, H3A */
+	VPSS_DMA_NUM_MASTERS
+};
+/*
+ * ask for / give back priority on external memory: capture wins while
+ * it holds a request and display holds none. 0 - success, -1 - fixed
+ */
+int vpss_dma_priority_get(enum vpss_dma_master master);
+void vpss_dma_priority_put(enum vpss_dma_master master);
 #endif
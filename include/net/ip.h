@@ -200,6 +200,21 @@ extern int inet_peer_gc_maxtime;
 /* From ip_output.c */
 extern int sysctl_ip_dynaddr;
 
+/* From ip_fastfwd.c */
+#ifdef CONFIG_IP_FASTFWD
+extern int sysctl_ip_fastfwd;
+extern int ip_fastfwd_input(struct sk_buff *skb);
+extern void ip_fastfwd_learn(struct sk_buff *skb);
+extern void ip_fastfwd_flush(void);
+#else
+static inline int ip_fastfwd_input(struct sk_buff *skb)
+{
+	return 0;
+}
+static inline void ip_fastfwd_learn(struct sk_buff *skb) {}
+static inline void ip_fastfwd_flush(void) {}
+#endif
+
 extern void ipfrag_init(void);
 
 extern void ip_static_sysctl_init(void);
@@ -289,6 +289,7 @@ struct snd_pcm_runtime {
 	unsigned int info;
 	unsigned int rate_num;
 	unsigned int rate_den;
+	unsigned int no_period_wakeup: 1;
 
 	/* -- SW params -- */
 	int tstamp_mode;		/* mmap timestamp is updated */
@@ -583,6 +584,12 @@ static inline size_t snd_pcm_lib_period_bytes(struct snd_pcm_substream *substrea
 	return frames_to_bytes(runtime, runtime->period_size);
 }
 
+/* length of a period in jiffies, rounded up */
+static inline long snd_pcm_period_jiffies(struct snd_pcm_runtime *runtime)
+{
+	return DIV_ROUND_UP(runtime->period_size * HZ, runtime->rate);
+}
+
 /*
  *  result is: 0 ... (boundary - 1)
  */
@@ -39,6 +39,13 @@ struct da8xx_lcdc_platform_data {
 	void *controller_data;
 	const char type[25];
 	void (*panel_power_ctrl)(int);
+
+	/*
+	 * LCDC master priority on the SCR, 0 (highest) to 7, written
+	 * through set_priority when the SoC provides one.
+	 */
+	int (*set_priority)(unsigned int prio);
+	unsigned int priority;
 };
 
 struct lcd_ctrl_config {
@@ -103,6 +110,11 @@ struct lcd_sync_arg {
 #define FBIPUT_HSYNC		_IOW('F', 9, int)
 #define FBIPUT_VSYNC		_IOW('F', 10, int)
 
+/* Wait for the next vertical sync, or a pending pan to take effect */
+#ifndef FBIO_WAITFORVSYNC
+#define FBIO_WAITFORVSYNC	_IOW('F', 0x20, u_int32_t)
+#endif
+
 struct da8xx_clcd_platform_data {
 	u8 version;
 };
@@ -0,0 +1,25 @@
+/*
+ * EDMA 2D acceleration shared by the DaVinci frame buffer drivers
+ *
+ * Copyright (C) 2010 Texas Instruments Incorporated - http://www.ti.com/
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _DAVINCI_FBACCEL_H
+#define _DAVINCI_FBACCEL_H
+
+#include <linux/fb.h>
+
+/* screen to screen copy, same semantics as fb_copyarea */
+#define FBIO_COPYAREA		_IOW('F', 0x26, struct fb_copyarea)
+
+#ifdef __KERNEL__
+void davinci_fb_fillrect(struct fb_info *info, const struct fb_fillrect *rect);
+void davinci_fb_copyarea(struct fb_info *info,
+		const struct fb_copyarea *area);
+int davinci_fb_ioctl_copyarea(struct fb_info *info, void __user *argp);
+#endif
+
+#endif /* _DAVINCI_FBACCEL_H */
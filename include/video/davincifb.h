@@ -240,7 +240,7 @@
 #define	OSD_OSDWIN0MD_OVZ0_SHIFT		8
 #define	OSD_OSDWIN0MD_BMW0			(3 << 6)
 #define	OSD_OSDWIN0MD_BMW0_SHIFT		6
-#define	OSD_OSDWIN0MD_BLND0			(3 << 3)
+#define	OSD_OSDWIN0MD_BLND0			(7 << 3)
 #define	OSD_OSDWIN0MD_BLND0_SHIFT		3
 #define	OSD_OSDWIN0MD_TE0			(1 << 2)
 #define	OSD_OSDWIN0MD_OFF0			(1 << 1)
@@ -256,7 +256,7 @@
 #define	OSD_OSDWIN1MD_OVZ1_SHIFT		8
 #define	OSD_OSDWIN1MD_BMW1			(3 << 6)
 #define	OSD_OSDWIN1MD_BMW1_SHIFT		6
-#define	OSD_OSDWIN1MD_BLND1			(3 << 3)
+#define	OSD_OSDWIN1MD_BLND1			(7 << 3)
 #define	OSD_OSDWIN1MD_BLND1_SHIFT		3
 #define	OSD_OSDWIN1MD_TE1			(1 << 2)
 #define	OSD_OSDWIN1MD_OFF1			(1 << 1)
@@ -439,4 +439,34 @@ struct zoom_params
 };
 #define FBIO_SETZOOM		_IOW('F', 0x24, struct zoom_params)
 #define FBIO_GETSTD		_IOR('F', 0x25, u_int32_t)
+
+/* Window layout for FBIO_SETCOMPOSITION. win[] is indexed like
+ * zoom_params.window_id: 0 = VID0, 1 = VID1, 2 = OSD0, 3 = OSD1. Only
+ * entries with DAVINCIFB_WIN_UPDATE set are changed. The whole set is
+ * checked up front and programmed during one vertical blanking interval,
+ * so no frame is shown with half of the new layout; the ioctl returns once
+ * it is on screen.
+ */
+#define DAVINCIFB_NR_WINS	4
+
+#define DAVINCIFB_WIN_UPDATE	(1 << 0)
+#define DAVINCIFB_WIN_ENABLE	(1 << 1)
+#define DAVINCIFB_WIN_TRANSP	(1 << 2)	/* OSD0 only: colour keying */
+
+struct davincifb_win_config
+{
+	u_int32_t flags;
+	u_int32_t xpos;
+	u_int32_t ypos;
+	u_int32_t zoom_h;	/* 0 = x1, 1 = x2, 2 = x4 */
+	u_int32_t zoom_v;
+	u_int32_t blend;	/* OSD0/OSD1: 0 (video only) to 7 (OSD only) */
+};
+
+struct davincifb_composition
+{
+	struct davincifb_win_config win[DAVINCIFB_NR_WINS];
+	u_int32_t transp_key;	/* RGB565 value shown transparent on OSD0 */
+};
+#define FBIO_SETCOMPOSITION	_IOW('F', 0x27, struct davincifb_composition)
 #endif /* _DAVINCIFB_H_ */
@@ -8,6 +8,7 @@
 #include <linux/dirent.h>
 #include <linux/syscalls.h>
 #include <linux/utime.h>
+#include <linux/async.h>
 
 static __initdata char *message;
 static void __init error(char *x)
@@ -567,7 +568,7 @@ static void __init clean_rootfs(void)
 }
 #endif
 
-static int __init populate_rootfs(void)
+static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
 {
 	char *err = unpack_to_rootfs(__initramfs_start,
 			 __initramfs_end - __initramfs_start);
@@ -581,7 +582,7 @@ static int __init populate_rootfs(void)
 			initrd_end - initrd_start);
 		if (!err) {
 			free_initrd();
-			return 0;
+			return;
 		} else {
 			clean_rootfs();
 			unpack_to_rootfs(__initramfs_start,
@@ -605,6 +606,43 @@ static int __init populate_rootfs(void)
 		free_initrd();
 #endif
 	}
+}
+
+/*
+ * Unpacking runs from an async thread so that device initcalls can probe
+ * while the archive is decompressed.  Anything that needs the contents of
+ * rootfs - running init, user mode helpers such as hotplug and firmware
+ * loading - calls wait_for_initramfs() first.  Boot with
+ * "initramfs_async=0" to unpack synchronously as before.
+ */
+static int __initdata initramfs_async = 1;
+static async_cookie_t initramfs_cookie;
+
+static int __init initramfs_async_setup(char *str)
+{
+	initramfs_async = simple_strtol(str, NULL, 0) != 0;
+	return 1;
+}
+__setup("initramfs_async=", initramfs_async_setup);
+
+/**
+ * wait_for_initramfs - wait until rootfs has been populated
+ *
+ * Returns immediately once unpacking is complete or if it was not done
+ * asynchronously.
+ */
+void wait_for_initramfs(void)
+{
+	if (initramfs_cookie)
+		async_synchronize_cookie(initramfs_cookie + 1);
+}
+
+static int __init populate_rootfs(void)
+{
+	if (initramfs_async)
+		initramfs_cookie = async_schedule(do_populate_rootfs, NULL);
+	else
+		do_populate_rootfs(NULL, 0);
 	return 0;
 }
 rootfs_initcall(populate_rootfs);
@@ -35,6 +35,7 @@
 #include <linux/resource.h>
 #include <linux/notifier.h>
 #include <linux/suspend.h>
+#include <linux/initrd.h>
 #include <asm/uaccess.h>
 
 #include <trace/events/module.h>
@@ -184,6 +185,8 @@ static int ____call_usermodehelper(void *data)
 	 */
 	set_user_nice(current, 0);
 
+	/* The helper may live in an initramfs that is still being unpacked */
+	wait_for_initramfs();
 	retval = kernel_execve(sub_info->path, sub_info->argv, sub_info->envp);
 
 	/* Exec failed? */
@@ -102,12 +102,25 @@ static struct pm_qos_object network_throughput_pm_qos = {
 	.comparitor = max_compare
 };
 
+/* lowest CPU frequency in kHz that drivers need while they are busy */
+static BLOCKING_NOTIFIER_HEAD(cpu_freq_min_notifier);
+static struct pm_qos_object cpu_freq_min_pm_qos = {
+	.requirements =
+		{LIST_HEAD_INIT(cpu_freq_min_pm_qos.requirements.list)},
+	.notifiers = &cpu_freq_min_notifier,
+	.name = "cpu_freq_min",
+	.default_value = 0,
+	.target_value = ATOMIC_INIT(0),
+	.comparitor = max_compare
+};
+
 
 static struct pm_qos_object *pm_qos_array[] = {
 	&null_pm_qos,
 	&cpu_dma_pm_qos,
 	&network_lat_pm_qos,
-	&network_throughput_pm_qos
+	&network_throughput_pm_qos,
+	&cpu_freq_min_pm_qos
 };
 
 static DEFINE_SPINLOCK(pm_qos_lock);
@@ -409,9 +422,14 @@ static int __init pm_qos_power_init(void)
 		return ret;
 	}
 	ret = register_pm_qos_misc(&network_throughput_pm_qos);
-	if (ret < 0)
+	if (ret < 0) {
 		printk(KERN_ERR
 			"pm_qos_param: network_throughput setup failed\n");
+		return ret;
+	}
+	ret = register_pm_qos_misc(&cpu_freq_min_pm_qos);
+	if (ret < 0)
+		printk(KERN_ERR "pm_qos_param: cpu_freq_min setup failed\n");
 
 	return ret;
 }
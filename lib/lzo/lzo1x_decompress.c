@@ -14,6 +14,7 @@
 #ifndef STATIC
 #include <linux/module.h>
 #include <linux/kernel.h>
+#include <linux/string.h>
 #endif
 
 #include <asm/unaligned.h>
@@ -27,6 +28,19 @@
 #define COPY4(dst, src)	\
 		put_unaligned(get_unaligned((const u32 *)(src)), (u32 *)(dst))
 
+/*
+ * Without cheap unaligned loads COPY4() is built from byte accesses and
+ * costs more than the bytes it moves, so literal runs, and the longer
+ * matches that do not overlap their own output, go through memcpy(),
+ * which aligns one side and moves words with shifts.  Short or
+ * overlapping matches stay byte copies.
+ */
+#ifdef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+#define LZO_USE_MEMCPY	0
+#else
+#define LZO_USE_MEMCPY	1
+#endif
+
 int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 			unsigned char *out, size_t *out_len)
 {
@@ -72,6 +86,13 @@ int lzo1x_decompress_safe(const unsigned char *in, size_t in_len,
 		if (HAVE_IP(t + 4, ip_end, ip))
 			goto input_overrun;
 
+		if (LZO_USE_MEMCPY) {
+			memcpy(op, ip, t + 3);
+			op += t + 3;
+			ip += t + 3;
+			goto first_literal_run;
+		}
+
 		COPY4(op, ip);
 		op += 4;
 		ip += 4;
@@ -183,7 +204,12 @@ match:
 			if (HAVE_OP(t + 3 - 1, op_end, op))
 				goto output_overrun;
 
-			if (t >= 2 * 4 - (3 - 1) && (op - m_pos) >= 4) {
+			if (LZO_USE_MEMCPY && t >= 2 * 4 - (3 - 1) &&
+			    (op - m_pos) >= t + 3 - 1) {
+				memcpy(op, m_pos, t + 3 - 1);
+				op += t + 3 - 1;
+			} else if (!LZO_USE_MEMCPY &&
+				   t >= 2 * 4 - (3 - 1) && (op - m_pos) >= 4) {
 				COPY4(op, m_pos);
 				op += 4;
 				m_pos += 4;
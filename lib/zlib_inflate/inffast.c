@@ -33,6 +33,43 @@
 #  define UP_UNALIGNED(a) get_unaligned(++(a))
 #endif
 
+#ifndef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+/*
+   Without cheap unaligned loads, UP_UNALIGNED() is a pair of byte loads
+   and the halfword copy below gains nothing unless the distance is even,
+   when source and destination are aligned alike.  When the distance is
+   also a multiple of four, copy longer matches a word at a time: the
+   words never overlap, since each one starts at least four bytes back.
+ */
+#  define WORD_COPY(dist, len) ((len) >= 8 && !((dist) & 3))
+#  define UP_SAME_ALIGN(dist) (!((dist) & 1))
+
+static inline unsigned char *copy_words(unsigned char *out, unsigned dist,
+                                        unsigned len)
+{
+    unsigned char *to = out + OFF;
+    const unsigned char *from = to - dist;
+
+    while ((unsigned long)to & 3) {
+        *to++ = *from++;
+        len--;
+    }
+    do {
+        *(u32 *)to = *(const u32 *)from;
+        to += 4;
+        from += 4;
+        len -= 4;
+    } while (len >= 4);
+    while (len--)
+        *to++ = *from++;
+    return to - OFF;
+}
+#else
+#  define WORD_COPY(dist, len) 0
+#  define UP_SAME_ALIGN(dist) 0
+#  define copy_words(out, dist, len) (out)
+#endif
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -242,6 +279,9 @@ void inflate_fast(z_streamp strm, unsigned start)
                             PUP(out) = PUP(from);
                     }
                 }
+                else if (WORD_COPY(dist, len)) {
+                    out = copy_words(out, dist, len);
+                }
                 else {
 		    unsigned short *sout;
 		    unsigned long loops;
@@ -259,9 +299,14 @@ void inflate_fast(z_streamp strm, unsigned start)
 
 			sfrom = (unsigned short *)(from - OFF);
 			loops = len >> 1;
-			do
-			    PUP(sout) = UP_UNALIGNED(sfrom);
-			while (--loops);
+			if (UP_SAME_ALIGN(dist))
+			    do
+				PUP(sout) = PUP(sfrom);
+			    while (--loops);
+			else
+			    do
+				PUP(sout) = UP_UNALIGNED(sfrom);
+			    while (--loops);
 			out = (unsigned char *)sout + OFF;
 			from = (unsigned char *)sfrom + OFF;
 		    } else { /* dist == 1 or dist == 2 */
@@ -0,0 +1,201 @@
+/*
+ * mm/mem_notify.c - memory pressure notification for user space
+ *
+ * Applications holding caches of their own (decoded images, media
+ * buffers, ...) open /dev/mem_notify and poll it. It becomes readable
+ * whenever memory pressure rises to a higher level, and read() returns
+ * the current level, so the caches can be shed while the kernel still
+ * has page cache to live on, well before it thrashes or the OOM killer
+ * runs.
+ *
+ * The level is re-evaluated from the reclaim path, that is whenever a
+ * zone went below its watermarks, and on every poll/read. It is derived
+ * from what reclaim can still get without user space help, free pages
+ * plus file backed LRU pages, against three thresholds. By default these
+ * are multiples of the zones' high watermarks; each can be set in kB
+ * through the low_kb, medium_kb and critical_kb parameters.
+ */
+
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/mem_notify.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/module.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include <linux/vmstat.h>
+#include <linux/wait.h>
+
+enum {
+	MEM_NOTIFY_NONE,
+	MEM_NOTIFY_LOW,
+	MEM_NOTIFY_MEDIUM,
+	MEM_NOTIFY_CRITICAL,
+};
+
+static const char *const mem_notify_names[] = {
+	[MEM_NOTIFY_NONE]	= "none",
+	[MEM_NOTIFY_LOW]	= "low",
+	[MEM_NOTIFY_MEDIUM]	= "medium",
+	[MEM_NOTIFY_CRITICAL]	= "critical",
+};
+
+/* default thresholds, in high watermarks */
+static const unsigned int mem_notify_wmarks[] = {
+	[MEM_NOTIFY_LOW]	= 8,
+	[MEM_NOTIFY_MEDIUM]	= 4,
+	[MEM_NOTIFY_CRITICAL]	= 2,
+};
+
+static unsigned int low_kb;
+module_param(low_kb, uint, 0644);
+MODULE_PARM_DESC(low_kb, "free + file cache kB below which pressure is "
+		 "low, 0 = 8 high watermarks");
+
+static unsigned int medium_kb;
+module_param(medium_kb, uint, 0644);
+MODULE_PARM_DESC(medium_kb, "free + file cache kB below which pressure is "
+		 "medium, 0 = 4 high watermarks");
+
+static unsigned int critical_kb;
+module_param(critical_kb, uint, 0644);
+MODULE_PARM_DESC(critical_kb, "free + file cache kB below which pressure "
+		 "is critical, 0 = 2 high watermarks");
+
+static DECLARE_WAIT_QUEUE_HEAD(mem_notify_wait);
+static DEFINE_SPINLOCK(mem_notify_lock);
+static int mem_notify_level;
+static unsigned long mem_notify_events; /* rises of the level */
+
+static unsigned long mem_notify_threshold(int level, unsigned int kb,
+					  unsigned long high)
+{
+	if (kb)
+		return kb >> (PAGE_SHIFT - 10);
+	return high * mem_notify_wmarks[level];
+}
+
+static int mem_notify_eval(void)
+{
+	unsigned long avail, high = 0;
+	struct zone *zone;
+
+	for_each_populated_zone(zone)
+		high += high_wmark_pages(zone);
+
+	avail = global_page_state(NR_FREE_PAGES) +
+		global_page_state(NR_ACTIVE_FILE) +
+		global_page_state(NR_INACTIVE_FILE);
+
+	if (avail < mem_notify_threshold(MEM_NOTIFY_CRITICAL,
+					 critical_kb, high))
+		return MEM_NOTIFY_CRITICAL;
+	if (avail < mem_notify_threshold(MEM_NOTIFY_MEDIUM, medium_kb, high))
+		return MEM_NOTIFY_MEDIUM;
+	if (avail < mem_notify_threshold(MEM_NOTIFY_LOW, low_kb, high))
+		return MEM_NOTIFY_LOW;
+	return MEM_NOTIFY_NONE;
+}
+
+/* re-evaluate the level, waking up pollers when it went up */
+static int mem_notify_update(void)
+{
+	int level = mem_notify_eval();
+	unsigned long flags;
+	int rose = 0;
+
+	if (level == ACCESS_ONCE(mem_notify_level))
+		return level;
+
+	spin_lock_irqsave(&mem_notify_lock, flags);
+	if (level > mem_notify_level) {
+		mem_notify_events++;
+		rose = 1;
+	}
+	mem_notify_level = level;
+	spin_unlock_irqrestore(&mem_notify_lock, flags);
+
+	if (rose)
+		wake_up_interruptible(&mem_notify_wait);
+	return level;
+}
+
+/**
+ * mem_notify_reclaim - memory pressure hook of the reclaim path
+ *
+ * Called by kswapd and direct reclaim, that is once a zone is below its
+ * watermarks. Cheap enough for every reclaim round: a few vmstat reads.
+ */
+void mem_notify_reclaim(void)
+{
+	mem_notify_update();
+}
+
+static int mem_notify_open(struct inode *inode, struct file *file)
+{
+	/* a new reader is told about pressure already present */
+	file->private_data = (void *)(mem_notify_events - 1);
+	return nonseekable_open(inode, file);
+}
+
+static int mem_notify_pending(struct file *file, int level)
+{
+	return level > MEM_NOTIFY_NONE &&
+	       (unsigned long)file->private_data != mem_notify_events;
+}
+
+static ssize_t mem_notify_read(struct file *file, char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	char text[16];
+	int level, len, ret;
+
+	level = mem_notify_update();
+	if (!mem_notify_pending(file, level) &&
+	    !(file->f_flags & O_NONBLOCK)) {
+		ret = wait_event_interruptible(mem_notify_wait,
+			mem_notify_pending(file, mem_notify_update()));
+		if (ret)
+			return ret;
+		level = ACCESS_ONCE(mem_notify_level);
+	}
+
+	file->private_data = (void *)mem_notify_events;
+	len = scnprintf(text, sizeof(text), "%s\n", mem_notify_names[level]);
+	if (count < len)
+		return -EINVAL;
+	if (copy_to_user(buf, text, len))
+		return -EFAULT;
+	return len;
+}
+
+static unsigned int mem_notify_poll(struct file *file, poll_table *wait)
+{
+	poll_wait(file, &mem_notify_wait, wait);
+	return mem_notify_pending(file, mem_notify_update()) ?
+		POLLIN | POLLRDNORM : 0;
+}
+
+static const struct file_operations mem_notify_fops = {
+	.owner		= THIS_MODULE,
+	.open		= mem_notify_open,
+	.read		= mem_notify_read,
+	.poll		= mem_notify_poll,
+	.llseek		= no_llseek,
+};
+
+static struct miscdevice mem_notify_dev = {
+	.minor		= MISC_DYNAMIC_MINOR,
+	.name		= "mem_notify",
+	.fops		= &mem_notify_fops,
+};
+
+static int __init mem_notify_init(void)
+{
+	return misc_register(&mem_notify_dev);
+}
+device_initcall(mem_notify_init);
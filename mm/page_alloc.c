@@ -49,6 +49,9 @@
 #include <linux/debugobjects.h>
 #include <linux/kmemleak.h>
 #include <linux/memory.h>
+#include <linux/migrate.h>
+#include <linux/mm_inline.h>
+#include <linux/zero_pool.h>
 #include <trace/events/kmem.h>
 
 #include <asm/tlbflush.h>
@@ -523,6 +526,22 @@ static inline int free_pages_check(struct page *page)
  * And clear the zone's pages_scanned counter, to hold off the "all pages are
  * pinned" detection logic.
  */
+/*
+ * MIGRATE_MOVABLE pcp lists also carry pages of MIGRATE_CMA pageblocks,
+ * which must go back to their own free lists, or to the isolated ones if
+ * alloc_contig_range() isolated the block after the page was freed.
+ */
+static inline int pcp_free_migratetype(struct page *page, int migratetype)
+{
+#ifdef CONFIG_CMA
+	if (unlikely(get_pageblock_migratetype(page) == MIGRATE_ISOLATE))
+		return MIGRATE_ISOLATE;
+	if (is_migrate_cma(page_private(page)))
+		return MIGRATE_CMA;
+#endif
+	return migratetype;
+}
+
 static void free_pcppages_bulk(struct zone *zone, int count,
 					struct per_cpu_pages *pcp)
 {
@@ -556,7 +575,8 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 			page = list_entry(list->prev, struct page, lru);
 			/* must delete as __free_one_page list manipulates */
 			list_del(&page->lru);
-			__free_one_page(page, zone, 0, migratetype);
+			__free_one_page(page, zone, 0,
+					pcp_free_migratetype(page, migratetype));
 			trace_mm_page_pcpu_drain(page, 0, migratetype);
 		} while (--count && --batch_free && !list_empty(list));
 	}
@@ -744,7 +764,12 @@ struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
 static int fallbacks[MIGRATE_TYPES][MIGRATE_TYPES-1] = {
 	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE,   MIGRATE_RESERVE },
 	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE,   MIGRATE_RESERVE },
+#ifdef CONFIG_CMA
+	[MIGRATE_MOVABLE]     = { MIGRATE_CMA,         MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE, MIGRATE_RESERVE },
+	[MIGRATE_CMA]         = { MIGRATE_RESERVE }, /* Never used */
+#else
 	[MIGRATE_MOVABLE]     = { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE, MIGRATE_RESERVE },
+#endif
 	[MIGRATE_RESERVE]     = { MIGRATE_RESERVE,     MIGRATE_RESERVE,   MIGRATE_RESERVE }, /* Never used */
 };
 
@@ -846,7 +871,7 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 
 			/* MIGRATE_RESERVE handled later if necessary */
 			if (migratetype == MIGRATE_RESERVE)
-				continue;
+				break;
 
 			area = &(zone->free_area[current_order]);
 			if (list_empty(&area->free_list[migratetype]))
@@ -860,11 +885,13 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			 * If breaking a large block of pages, move all free
 			 * pages to the preferred allocation list. If falling
 			 * back for a reclaimable kernel allocation, be more
-			 * agressive about taking ownership of free pages
+			 * agressive about taking ownership of free pages.
+			 * MIGRATE_CMA pageblocks are only ever borrowed from.
 			 */
-			if (unlikely(current_order >= (pageblock_order >> 1)) ||
+			if (!is_migrate_cma(migratetype) &&
+			    (unlikely(current_order >= (pageblock_order >> 1)) ||
 					start_migratetype == MIGRATE_RECLAIMABLE ||
-					page_group_by_mobility_disabled) {
+					page_group_by_mobility_disabled)) {
 				unsigned long pages;
 				pages = move_freepages_block(zone, page,
 								start_migratetype);
@@ -883,7 +910,8 @@ __rmqueue_fallback(struct zone *zone, int order, int start_migratetype)
 			rmv_page_order(page);
 
 			/* Take ownership for orders >= pageblock_order */
-			if (current_order >= pageblock_order)
+			if (current_order >= pageblock_order &&
+			    !is_migrate_cma(migratetype))
 				change_pageblock_range(page, current_order,
 							start_migratetype);
 
@@ -959,7 +987,10 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 			list_add(&page->lru, list);
 		else
 			list_add_tail(&page->lru, list);
-		set_page_private(page, migratetype);
+		if (is_migrate_cma(get_pageblock_migratetype(page)))
+			set_page_private(page, MIGRATE_CMA);
+		else
+			set_page_private(page, migratetype);
 		list = &page->lru;
 	}
 	__mod_zone_page_state(zone, NR_FREE_PAGES, -(i << order));
@@ -1995,6 +2026,10 @@ EXPORT_SYMBOL(__get_free_pages);
 
 unsigned long get_zeroed_page(gfp_t gfp_mask)
 {
+	struct page *page = zero_pool_get_page(gfp_mask);
+
+	if (page)
+		return (unsigned long)page_address(page);
 	return __get_free_pages(gfp_mask | __GFP_ZERO, 0);
 }
 EXPORT_SYMBOL(get_zeroed_page);
@@ -5025,6 +5060,7 @@ int set_migratetype_isolate(struct page *page)
 
 	spin_lock_irqsave(&zone->lock, flags);
 	if (get_pageblock_migratetype(page) == MIGRATE_MOVABLE ||
+	    is_migrate_cma(get_pageblock_migratetype(page)) ||
 	    zone_idx == ZONE_MOVABLE) {
 		ret = 0;
 		goto out;
@@ -5077,7 +5113,7 @@ out:
 	return ret;
 }
 
-void unset_migratetype_isolate(struct page *page)
+void unset_migratetype_isolate(struct page *page, unsigned migratetype)
 {
 	struct zone *zone;
 	unsigned long flags;
@@ -5085,12 +5121,168 @@ void unset_migratetype_isolate(struct page *page)
 	spin_lock_irqsave(&zone->lock, flags);
 	if (get_pageblock_migratetype(page) != MIGRATE_ISOLATE)
 		goto out;
-	set_pageblock_migratetype(page, MIGRATE_MOVABLE);
-	move_freepages_block(zone, page, MIGRATE_MOVABLE);
+	set_pageblock_migratetype(page, migratetype);
+	move_freepages_block(zone, page, migratetype);
 out:
 	spin_unlock_irqrestore(&zone->lock, flags);
 }
 
+#ifdef CONFIG_CMA
+/*
+ * Free a pageblock that was reserved at boot for a contiguous DMA region
+ * into the buddy allocator. Its pages back movable allocations until the
+ * region's owner takes them back with alloc_contig_range().
+ */
+void __init init_cma_reserved_pageblock(struct page *page)
+{
+	unsigned i = pageblock_nr_pages;
+	struct page *p = page;
+
+	do {
+		__ClearPageReserved(p);
+		set_page_count(p, 0);
+	} while (++p, --i);
+
+	set_page_refcounted(page);
+	set_pageblock_migratetype(page, MIGRATE_CMA);
+	__free_pages(page, pageblock_order);
+	totalram_pages += pageblock_nr_pages;
+}
+
+static struct page *
+alloc_contig_migrate_alloc(struct page *page, unsigned long private,
+			   int **resultp)
+{
+	return alloc_page(GFP_HIGHUSER_MOVABLE);
+}
+
+/* Migrate every page in use in [start, end) out of the (isolated) range. */
+static int alloc_contig_migrate_range(unsigned long start, unsigned long end)
+{
+	unsigned long pfn;
+	struct page *page;
+	int tries, ret;
+	LIST_HEAD(source);
+
+	for (tries = 0; tries < 5; tries++) {
+		/* pagevecs hold pages off the LRU, pcp lists hold free ones */
+		lru_add_drain_all();
+		drain_all_pages();
+
+		for (pfn = start; pfn < end; pfn++) {
+			page = pfn_to_page(pfn);
+			if (!page_count(page))
+				continue;
+			if (!isolate_lru_page(page)) {
+				list_add_tail(&page->lru, &source);
+				inc_zone_page_state(page, NR_ISOLATED_ANON +
+						    page_is_file_cache(page));
+			}
+		}
+		if (list_empty(&source))
+			break;
+
+		/* this function returns # of failed pages */
+		ret = migrate_pages(&source, alloc_contig_migrate_alloc, 0, 0);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * alloc_contig_range() - allocate a range of physically contiguous pages
+ * @start:	first PFN of the range
+ * @end:	one past the last PFN of the range
+ *
+ * Every pageblock the range touches must be MIGRATE_CMA, and the caller
+ * must keep other alloc_contig_range() calls off those pageblocks. Pages in
+ * use are migrated elsewhere first. On success every page of the range is
+ * handed over with a reference count of one; release them with
+ * free_contig_range(). Returns -EBUSY if some page could not be moved, e.g.
+ * because it is pinned for I/O.
+ */
+int alloc_contig_range(unsigned long start, unsigned long end)
+{
+	unsigned long block_start = start & ~(pageblock_nr_pages - 1);
+	unsigned long block_end = ALIGN(end, pageblock_nr_pages);
+	unsigned long outer_start, outer_end, pfn, flags;
+	struct zone *zone = page_zone(pfn_to_page(start));
+	struct page *page;
+	unsigned int order;
+	int ret;
+
+	ret = start_isolate_page_range(block_start, block_end, MIGRATE_CMA);
+	if (ret)
+		return ret;
+
+	ret = alloc_contig_migrate_range(start, end);
+	if (ret)
+		goto done;
+
+	lru_add_drain_all();
+	drain_all_pages();
+
+	spin_lock_irqsave(&zone->lock, flags);
+
+	/*
+	 * The range may start in the middle of a free buddy page; find its
+	 * head so the whole page can come off the free list.
+	 */
+	order = 0;
+	outer_start = start;
+	while (!PageBuddy(pfn_to_page(outer_start))) {
+		if (++order >= MAX_ORDER) {
+			ret = -EBUSY;
+			goto unlock;
+		}
+		outer_start &= ~0UL << order;
+	}
+
+	/* Everything from there on must be free now */
+	for (pfn = outer_start; pfn < end; pfn += 1UL << page_order(page)) {
+		page = pfn_to_page(pfn);
+		if (!PageBuddy(page)) {
+			ret = -EBUSY;
+			goto unlock;
+		}
+	}
+	outer_end = pfn;
+
+	for (pfn = outer_start; pfn < outer_end; pfn += 1UL << order) {
+		page = pfn_to_page(pfn);
+		order = page_order(page);
+		list_del(&page->lru);
+		rmv_page_order(page);
+		zone->free_area[order].nr_free--;
+		__mod_zone_page_state(zone, NR_FREE_PAGES, -(1UL << order));
+		set_page_refcounted(page);
+		if (order)
+			split_page(page, order);
+	}
+
+unlock:
+	spin_unlock_irqrestore(&zone->lock, flags);
+	if (ret)
+		goto done;
+
+	/* Give back what the outer buddy pages brought in on either side */
+	free_contig_range(outer_start, start - outer_start);
+	free_contig_range(end, outer_end - end);
+
+done:
+	undo_isolate_page_range(block_start, block_end, MIGRATE_CMA);
+	return ret;
+}
+
+void free_contig_range(unsigned long pfn, unsigned long nr_pages)
+{
+	for (; nr_pages--; pfn++)
+		__free_page(pfn_to_page(pfn));
+}
+#endif
+
 #ifdef CONFIG_MEMORY_HOTREMOVE
 /*
  * All pages in the range must be isolated before calling this.
@@ -40,6 +40,7 @@
 #include <linux/memcontrol.h>
 #include <linux/delayacct.h>
 #include <linux/sysctl.h>
+#include <linux/mem_notify.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -1743,8 +1744,10 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 
 	delayacct_freepages_start();
 
-	if (scanning_global_lru(sc))
+	if (scanning_global_lru(sc)) {
 		count_vm_event(ALLOCSTALL);
+		mem_notify_reclaim();
+	}
 	/*
 	 * mem_cgroup will not do shrink_slab.
 	 */
@@ -1984,6 +1987,7 @@ loop_again:
 	sc.nr_reclaimed = 0;
 	sc.may_writepage = !laptop_mode;
 	count_vm_event(PAGEOUTRUN);
+	mem_notify_reclaim();
 
 	for (i = 0; i < pgdat->nr_zones; i++)
 		temp_priority[i] = DEF_PRIORITY;
@@ -343,6 +343,22 @@ static struct dev_rcv_lists *find_dev_rcv_lists(struct net_device *dev)
  *  Constistency checked mask.
  *  Reduced can_id to have a preprocessed filter compare value.
  */
+/*
+ * Fold the 29 bit EFF identifier into CAN_EFF_RCV_HASH_BITS. All bits take
+ * part, so IDs only differing in the source address or in the PGN (J1939)
+ * still end up in different buckets.
+ */
+static unsigned int effhash(canid_t can_id)
+{
+	unsigned int hash;
+
+	hash = can_id;
+	hash ^= can_id >> CAN_EFF_RCV_HASH_BITS;
+	hash ^= can_id >> (2 * CAN_EFF_RCV_HASH_BITS);
+
+	return hash & (CAN_EFF_RCV_ARRAY_SZ - 1);
+}
+
 static struct hlist_head *find_rcv_list(canid_t *can_id, canid_t *mask,
 					struct dev_rcv_lists *d)
 {
@@ -379,10 +395,8 @@ static struct hlist_head *find_rcv_list(canid_t *can_id, canid_t *mask,
 	    !(*can_id & CAN_RTR_FLAG)) {
 
 		if (*can_id & CAN_EFF_FLAG) {
-			if (*mask == (CAN_EFF_MASK | CAN_EFF_RTR_FLAGS)) {
-				/* RFC: a future use-case for hash-tables? */
-				return &d->rx[RX_EFF];
-			}
+			if (*mask == (CAN_EFF_MASK | CAN_EFF_RTR_FLAGS))
+				return &d->rx_eff[effhash(*can_id)];
 		} else {
 			if (*mask == (CAN_SFF_MASK | CAN_EFF_RTR_FLAGS))
 				return &d->rx_sff[*can_id];
@@ -625,7 +639,8 @@ static int can_rcv_filter(struct dev_rcv_lists *d, struct sk_buff *skb)
 		return matches;
 
 	if (can_id & CAN_EFF_FLAG) {
-		hlist_for_each_entry_rcu(r, n, &d->rx[RX_EFF], list) {
+		hlist_for_each_entry_rcu(r, n, &d->rx_eff[effhash(can_id)],
+					 list) {
 			if (r->can_id == can_id) {
 				deliver(skb, r);
 				matches++;
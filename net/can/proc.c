@@ -81,7 +81,6 @@ static const char rx_list_name[][8] = {
 	[RX_ALL] = "rx_all",
 	[RX_FIL] = "rx_fil",
 	[RX_INV] = "rx_inv",
-	[RX_EFF] = "rx_eff",
 };
 
 /*
@@ -383,30 +382,34 @@ static const struct file_operations can_rcvlist_proc_fops = {
 	.release	= single_release,
 };
 
-static int can_rcvlist_sff_proc_show(struct seq_file *m, void *v)
+/*
+ * Show the receive lists kept in per-device arrays (rx_sff, rx_eff).
+ * @offs is the offset of the array in struct dev_rcv_lists.
+ */
+static void can_rcvlist_array_show(struct seq_file *m, const char *name,
+				   size_t offs, int size)
 {
 	struct dev_rcv_lists *d;
 	struct hlist_node *n;
 
-	/* RX_SFF */
-	seq_puts(m, "\nreceive list 'rx_sff':\n");
+	seq_printf(m, "\nreceive list '%s':\n", name);
 
 	rcu_read_lock();
 	hlist_for_each_entry_rcu(d, n, &can_rx_dev_list, list) {
+		struct hlist_head *rx = (void *)d + offs;
 		int i, all_empty = 1;
 		/* check wether at least one list is non-empty */
-		for (i = 0; i < 0x800; i++)
-			if (!hlist_empty(&d->rx_sff[i])) {
+		for (i = 0; i < size; i++)
+			if (!hlist_empty(&rx[i])) {
 				all_empty = 0;
 				break;
 			}
 
 		if (!all_empty) {
 			can_print_recv_banner(m);
-			for (i = 0; i < 0x800; i++) {
-				if (!hlist_empty(&d->rx_sff[i]))
-					can_print_rcvlist(m, &d->rx_sff[i],
-							  d->dev);
+			for (i = 0; i < size; i++) {
+				if (!hlist_empty(&rx[i]))
+					can_print_rcvlist(m, &rx[i], d->dev);
 			}
 		} else
 			seq_printf(m, "  (%s: no entry)\n", DNAME(d->dev));
@@ -414,6 +417,13 @@ static int can_rcvlist_sff_proc_show(struct seq_file *m, void *v)
 	rcu_read_unlock();
 
 	seq_putc(m, '\n');
+}
+
+static int can_rcvlist_sff_proc_show(struct seq_file *m, void *v)
+{
+	/* RX_SFF */
+	can_rcvlist_array_show(m, "rx_sff",
+			       offsetof(struct dev_rcv_lists, rx_sff), 0x800);
 	return 0;
 }
 
@@ -422,6 +432,28 @@ static int can_rcvlist_sff_proc_open(struct inode *inode, struct file *file)
 	return single_open(file, can_rcvlist_sff_proc_show, NULL);
 }
 
+static int can_rcvlist_eff_proc_show(struct seq_file *m, void *v)
+{
+	/* RX_EFF */
+	can_rcvlist_array_show(m, "rx_eff",
+			       offsetof(struct dev_rcv_lists, rx_eff),
+			       CAN_EFF_RCV_ARRAY_SZ);
+	return 0;
+}
+
+static int can_rcvlist_eff_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, can_rcvlist_eff_proc_show, NULL);
+}
+
+static const struct file_operations can_rcvlist_eff_proc_fops = {
+	.owner		= THIS_MODULE,
+	.open		= can_rcvlist_eff_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static const struct file_operations can_rcvlist_sff_proc_fops = {
 	.owner		= THIS_MODULE,
 	.open		= can_rcvlist_sff_proc_open,
@@ -469,8 +501,8 @@ void can_init_proc(void)
 					   &can_rcvlist_proc_fops, (void *)RX_FIL);
 	pde_rcvlist_inv = proc_create_data(CAN_PROC_RCVLIST_INV, 0644, can_dir,
 					   &can_rcvlist_proc_fops, (void *)RX_INV);
-	pde_rcvlist_eff = proc_create_data(CAN_PROC_RCVLIST_EFF, 0644, can_dir,
-					   &can_rcvlist_proc_fops, (void *)RX_EFF);
+	pde_rcvlist_eff = proc_create(CAN_PROC_RCVLIST_EFF, 0644, can_dir,
+				      &can_rcvlist_eff_proc_fops);
 	pde_rcvlist_sff = proc_create(CAN_PROC_RCVLIST_SFF, 0644, can_dir,
 				      &can_rcvlist_sff_proc_fops);
 }
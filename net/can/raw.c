@@ -615,6 +615,11 @@ static int raw_getsockopt(struct socket *sock, int level, int optname,
 	return 0;
 }
 
+/*
+ * A write may carry several struct can_frame back to back. Each of them is
+ * sent in its own skb, in order. If sending fails after some frames went
+ * out, the number of bytes sent so far is returned.
+ */
 static int raw_sendmsg(struct kiocb *iocb, struct socket *sock,
 		       struct msghdr *msg, size_t size)
 {
@@ -622,6 +627,7 @@ static int raw_sendmsg(struct kiocb *iocb, struct socket *sock,
 	struct raw_sock *ro = raw_sk(sk);
 	struct sk_buff *skb;
 	struct net_device *dev;
+	size_t sent = 0;
 	int ifindex;
 	int err;
 
@@ -636,42 +642,42 @@ static int raw_sendmsg(struct kiocb *iocb, struct socket *sock,
 	} else
 		ifindex = ro->ifindex;
 
-	if (size != sizeof(struct can_frame))
+	if (!size || size % sizeof(struct can_frame))
 		return -EINVAL;
 
 	dev = dev_get_by_index(&init_net, ifindex);
 	if (!dev)
 		return -ENXIO;
 
-	skb = sock_alloc_send_skb(sk, size, msg->msg_flags & MSG_DONTWAIT,
-				  &err);
-	if (!skb)
-		goto put_dev;
+	for (; sent < size; sent += sizeof(struct can_frame)) {
+		skb = sock_alloc_send_skb(sk, sizeof(struct can_frame),
+					  msg->msg_flags & MSG_DONTWAIT, &err);
+		if (!skb)
+			break;
 
-	err = memcpy_fromiovec(skb_put(skb, size), msg->msg_iov, size);
-	if (err < 0)
-		goto free_skb;
-	err = sock_tx_timestamp(msg, sk, skb_tx(skb));
-	if (err < 0)
-		goto free_skb;
-	skb->dev = dev;
-	skb->sk  = sk;
+		/* memcpy_fromiovec() advances the iovec frame by frame */
+		err = memcpy_fromiovec(skb_put(skb, sizeof(struct can_frame)),
+				       msg->msg_iov, sizeof(struct can_frame));
+		if (err < 0) {
+			kfree_skb(skb);
+			break;
+		}
+		err = sock_tx_timestamp(msg, sk, skb_tx(skb));
+		if (err < 0) {
+			kfree_skb(skb);
+			break;
+		}
+		skb->dev = dev;
+		skb->sk  = sk;
 
-	err = can_send(skb, ro->loopback);
+		err = can_send(skb, ro->loopback);
+		if (err)
+			break;
+	}
 
 	dev_put(dev);
 
-	if (err)
-		goto send_failed;
-
-	return size;
-
-free_skb:
-	kfree_skb(skb);
-put_dev:
-	dev_put(dev);
-send_failed:
-	return err;
+	return sent ? sent : err;
 }
 
 static int raw_recvmsg(struct kiocb *iocb, struct socket *sock,
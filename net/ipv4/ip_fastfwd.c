@@ -0,0 +1,295 @@
+/*
+ * INET		An implementation of the TCP/IP protocol suite for the LINUX
+ *		operating system.  INET is implemented using the  BSD Socket
+ *		interface as the means of communication with the user level.
+ *
+ *		IPv4 fast forwarding cache.
+ *
+ *		A small direct-mapped table of routes which recently forwarded
+ *		a packet, consulted by ip_rcv() before the PRE_ROUTING hook.
+ *		On a hit the packet skips the netfilter hooks, ip_route_input()
+ *		and ip_forward(): the TTL is decremented, the cached hardware
+ *		header is pushed and the frame goes straight to
+ *		dev_queue_xmit().  Anything out of the ordinary (IP options,
+ *		TTL expiry, a packet above the path MTU, an unresolved
+ *		neighbour) falls back to the normal path.
+ *
+ *		Entries are only learnt while no IPv4 netfilter hooks and no
+ *		IPsec policies are installed, and the table is flushed with
+ *		the routing cache, so a hit forwards the packet exactly like
+ *		the slow path would.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/spinlock.h>
+#include <linux/jhash.h>
+#include <linux/netdevice.h>
+#include <linux/skbuff.h>
+#include <linux/netfilter.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <net/net_namespace.h>
+#include <net/ip.h>
+#include <net/route.h>
+#include <net/neighbour.h>
+#include <net/xfrm.h>
+
+#define IP_FASTFWD_SIZE		(1 << CONFIG_IP_FASTFWD_SHIFT)
+
+struct ip_fastfwd_entry {
+	__be32		daddr;
+	__be32		saddr;
+	int		iif;
+	u32		mark;
+	u8		tos;
+	struct rtable	*rt;
+	unsigned long	hits;
+};
+
+static struct ip_fastfwd_entry ip_fastfwd_table[IP_FASTFWD_SIZE];
+static DEFINE_SPINLOCK(ip_fastfwd_lock);
+
+static struct {
+	unsigned long	hits;
+	unsigned long	misses;
+	unsigned long	fallbacks;
+	unsigned long	inserts;
+	unsigned long	evictions;
+	unsigned long	flushes;
+} ip_fastfwd_stats;
+
+int sysctl_ip_fastfwd __read_mostly;
+
+static inline unsigned ip_fastfwd_hash(__be32 daddr, __be32 saddr, int iif)
+{
+	return jhash_3words((__force u32)daddr, (__force u32)saddr, iif, 0) &
+		(IP_FASTFWD_SIZE - 1);
+}
+
+/* Caller holds ip_fastfwd_lock. */
+static void ip_fastfwd_evict(struct ip_fastfwd_entry *e)
+{
+	dst_release(&e->rt->u.dst);
+	e->rt = NULL;
+}
+
+/*
+ * The fast path skips every hook between ip_rcv() and dev_queue_xmit(), so
+ * it may only be used while there is nothing registered there.
+ */
+static int ip_fastfwd_allowed(struct net *net)
+{
+#ifdef CONFIG_NETFILTER
+	if (!list_empty(&nf_hooks[NFPROTO_IPV4][NF_INET_PRE_ROUTING]) ||
+	    !list_empty(&nf_hooks[NFPROTO_IPV4][NF_INET_FORWARD]) ||
+	    !list_empty(&nf_hooks[NFPROTO_IPV4][NF_INET_POST_ROUTING]))
+		return 0;
+#endif
+#ifdef CONFIG_XFRM
+	if (net->xfrm.policy_count[XFRM_POLICY_IN] ||
+	    net->xfrm.policy_count[XFRM_POLICY_OUT] ||
+	    net->xfrm.policy_count[XFRM_POLICY_FWD])
+		return 0;
+#endif
+	return 1;
+}
+
+/**
+ * ip_fastfwd_input - forward a packet from the fast forwarding cache
+ * @skb: validated IPv4 packet, as seen by ip_rcv()
+ *
+ * Returns 1 if the packet was consumed, 0 if it has to take the normal
+ * receive path.
+ */
+int ip_fastfwd_input(struct sk_buff *skb)
+{
+	struct iphdr *iph = ip_hdr(skb);
+	struct ip_fastfwd_entry *e;
+	struct net_device *dev;
+	struct hh_cache *hh;
+	struct rtable *rt;
+	int iif;
+
+	if (!sysctl_ip_fastfwd)
+		return 0;
+
+	if (iph->ihl != 5 || iph->ttl <= 1 || skb->pkt_type != PACKET_HOST ||
+	    skb_is_gso(skb) || skb_dst(skb))
+		return 0;
+
+	iif = skb->dev->ifindex;
+	e = &ip_fastfwd_table[ip_fastfwd_hash(iph->daddr, iph->saddr, iif)];
+
+	spin_lock(&ip_fastfwd_lock);
+	rt = e->rt;
+	if (!rt || e->daddr != iph->daddr || e->saddr != iph->saddr ||
+	    e->iif != iif || e->tos != (iph->tos & IPTOS_RT_MASK) ||
+	    e->mark != skb->mark ||
+	    !net_eq(dev_net(rt->u.dst.dev), dev_net(skb->dev))) {
+		ip_fastfwd_stats.misses++;
+		goto slow;
+	}
+
+	if (rt->u.dst.obsolete) {
+		ip_fastfwd_evict(e);
+		ip_fastfwd_stats.misses++;
+		goto slow;
+	}
+
+	/* Neighbour not (or no longer) resolved, or packet needs fragmenting */
+	hh = rt->u.dst.hh;
+	if (!hh || hh->hh_output != dev_queue_xmit ||
+	    skb->len > dst_mtu(&rt->u.dst)) {
+		ip_fastfwd_stats.fallbacks++;
+		goto slow;
+	}
+
+	dst_hold(&rt->u.dst);
+	e->hits++;
+	ip_fastfwd_stats.hits++;
+	spin_unlock(&ip_fastfwd_lock);
+
+	dev = rt->u.dst.dev;
+	skb_dst_set(skb, &rt->u.dst);
+
+	if (skb_cow(skb, LL_RESERVED_SPACE(dev) + rt->u.dst.header_len)) {
+		kfree_skb(skb);
+		return 1;
+	}
+
+	skb_forward_csum(skb);
+	iph = ip_hdr(skb);
+	ip_decrease_ttl(iph);
+	skb->priority = rt_tos2priority(iph->tos);
+
+	IP_INC_STATS_BH(dev_net(dev), IPSTATS_MIB_OUTFORWDATAGRAMS);
+	IP_UPD_PO_STATS_BH(dev_net(dev), IPSTATS_MIB_OUT, skb->len);
+
+	skb->dev = dev;
+	skb->protocol = htons(ETH_P_IP);
+	neigh_hh_output(hh, skb);
+	return 1;
+
+slow:
+	spin_unlock(&ip_fastfwd_lock);
+	return 0;
+}
+
+/**
+ * ip_fastfwd_learn - remember the route of a forwarded packet
+ * @skb: packet about to leave ip_forward_finish()
+ */
+void ip_fastfwd_learn(struct sk_buff *skb)
+{
+	struct rtable *rt = skb_rtable(skb);
+	struct ip_fastfwd_entry *e;
+	struct rtable *old;
+
+	if (!sysctl_ip_fastfwd)
+		return;
+
+	if (IPCB(skb)->opt.optlen || rt->rt_type != RTN_UNICAST ||
+	    (rt->rt_flags & (RTCF_DOREDIRECT | RTCF_LOCAL | RTCF_BROADCAST |
+			     RTCF_MULTICAST)) ||
+	    rt->fl.oif || rt->u.dst.xfrm || rt->u.dst.output != ip_output ||
+	    !ip_fastfwd_allowed(dev_net(rt->u.dst.dev)))
+		return;
+
+	e = &ip_fastfwd_table[ip_fastfwd_hash(rt->fl.fl4_dst, rt->fl.fl4_src,
+					      rt->fl.iif)];
+
+	spin_lock(&ip_fastfwd_lock);
+	old = e->rt;
+	if (old == rt) {
+		spin_unlock(&ip_fastfwd_lock);
+		return;
+	}
+	if (old) {
+		dst_release(&old->u.dst);
+		ip_fastfwd_stats.evictions++;
+	}
+
+	dst_hold(&rt->u.dst);
+	e->daddr = rt->fl.fl4_dst;
+	e->saddr = rt->fl.fl4_src;
+	e->iif = rt->fl.iif;
+	e->tos = rt->fl.fl4_tos;
+	e->mark = rt->fl.mark;
+	e->hits = 0;
+	e->rt = rt;
+	ip_fastfwd_stats.inserts++;
+	spin_unlock(&ip_fastfwd_lock);
+}
+
+/**
+ * ip_fastfwd_flush - drop every cached route
+ *
+ * Called whenever the routing cache is invalidated.
+ */
+void ip_fastfwd_flush(void)
+{
+	int i;
+
+	spin_lock_bh(&ip_fastfwd_lock);
+	for (i = 0; i < IP_FASTFWD_SIZE; i++)
+		if (ip_fastfwd_table[i].rt)
+			ip_fastfwd_evict(&ip_fastfwd_table[i]);
+	ip_fastfwd_stats.flushes++;
+	spin_unlock_bh(&ip_fastfwd_lock);
+}
+
+#ifdef CONFIG_PROC_FS
+static int ip_fastfwd_seq_show(struct seq_file *seq, void *v)
+{
+	int i;
+
+	spin_lock_bh(&ip_fastfwd_lock);
+	seq_printf(seq, "size=%d hits=%lu misses=%lu fallbacks=%lu "
+		   "inserts=%lu evictions=%lu flushes=%lu\n",
+		   IP_FASTFWD_SIZE, ip_fastfwd_stats.hits,
+		   ip_fastfwd_stats.misses, ip_fastfwd_stats.fallbacks,
+		   ip_fastfwd_stats.inserts, ip_fastfwd_stats.evictions,
+		   ip_fastfwd_stats.flushes);
+	seq_puts(seq, "Source\t\tDestination\tTOS\tIif\tOif\tHits\n");
+	for (i = 0; i < IP_FASTFWD_SIZE; i++) {
+		struct ip_fastfwd_entry *e = &ip_fastfwd_table[i];
+
+		if (!e->rt)
+			continue;
+		seq_printf(seq, "%08X\t%08X\t%02X\t%d\t%d\t%lu\n",
+			   (__force u32)e->saddr, (__force u32)e->daddr,
+			   e->tos, e->iif, e->rt->u.dst.dev->ifindex, e->hits);
+	}
+	spin_unlock_bh(&ip_fastfwd_lock);
+	return 0;
+}
+
+static int ip_fastfwd_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ip_fastfwd_seq_show, NULL);
+}
+
+static const struct file_operations ip_fastfwd_seq_fops = {
+	.owner	 = THIS_MODULE,
+	.open	 = ip_fastfwd_seq_open,
+	.read	 = seq_read,
+	.llseek	 = seq_lseek,
+	.release = single_release,
+};
+
+static int __init ip_fastfwd_proc_init(void)
+{
+	if (!proc_net_fops_create(&init_net, "ip_fastfwd", S_IRUGO,
+				  &ip_fastfwd_seq_fops))
+		return -ENOMEM;
+	return 0;
+}
+late_initcall(ip_fastfwd_proc_init);
+#endif /* CONFIG_PROC_FS */
@@ -46,6 +46,8 @@ static int ip_forward_finish(struct sk_buff *skb)
 
 	if (unlikely(opt->optlen))
 		ip_forward_options(skb);
+	else
+		ip_fastfwd_learn(skb);
 
 	return dst_output(skb);
 }
@@ -63,6 +63,20 @@ static int ipv4_local_port_range(ctl_table *table, int write,
 	return ret;
 }
 
+#ifdef CONFIG_IP_FASTFWD
+/* Drop the cached routes when the fast path is switched off. */
+static int proc_ip_fastfwd(ctl_table *ctl, int write,
+			   void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	int ret;
+
+	ret = proc_dointvec(ctl, write, buffer, lenp, ppos);
+	if (write && ret == 0 && !sysctl_ip_fastfwd)
+		ip_fastfwd_flush();
+	return ret;
+}
+#endif
+
 static int proc_tcp_congestion_control(ctl_table *ctl, int write,
 				       void __user *buffer, size_t *lenp, loff_t *ppos)
 {
@@ -169,6 +183,15 @@ static struct ctl_table ipv4_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec
 	},
+#ifdef CONFIG_IP_FASTFWD
+	{
+		.procname	= "ip_fastfwd",
+		.data		= &sysctl_ip_fastfwd,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_ip_fastfwd
+	},
+#endif
 	{
 		.procname	= "tcp_syn_retries",
 		.data		= &sysctl_tcp_syn_retries,
@@ -0,0 +1,50 @@
+#!/bin/sh
+#
+# Static memory footprint of arch/arm/mach-davinci
+#
+# Lists text, data and bss per object of a built tree, splitting out what
+# free_initmem() gives back (.init.* sections), worst first.  Run it from
+# the top of the build tree:
+#
+#	CROSS_COMPILE=arm-none-linux-gnueabi- scripts/davinci_footprint.sh [objdir]
+#
+# Comparing the report before and after a change shows what it costs on
+# a RAM-tight board; scripts/bloat-o-meter does the same per symbol for
+# two vmlinux files.
+
+SIZE=${CROSS_COMPILE}size
+dir=${1:-arch/arm/mach-davinci}
+
+if [ ! -d "$dir" ]; then
+	echo "usage: $0 [objdir]" >&2
+	exit 1
+fi
+
+for o in "$dir"/*.o; do
+	case "$o" in
+	*/built-in.o|*.mod.o)
+		continue ;;
+	esac
+	$SIZE -A "$o" | awk -v obj="${o##*/}" '
+		$1 ~ /^\.init\./	{ init += $2; next }
+		$1 ~ /^\.exit\./	{ init += $2; next }
+		$1 ~ /^\.(text|rodata)/	{ text += $2; next }
+		$1 ~ /^__(ksymtab|kcrctab)/ { text += $2; next }
+		$1 ~ /^\.data/		{ data += $2; next }
+		$1 ~ /^\.bss/		{ bss += $2; next }
+		END {
+			printf "%8d %8d %8d %8d %8d  %s\n", text, data, bss,
+				text + data + bss, init, obj
+		}'
+done | sort -k4 -n -r | awk '
+	BEGIN {
+		printf "%8s %8s %8s %8s %8s  %s\n", "text", "data", "bss",
+			"resident", "init", "object"
+	}
+	{
+		print
+		t += $1; d += $2; b += $3; r += $4; i += $5
+	}
+	END {
+		printf "%8d %8d %8d %8d %8d  %s\n", t, d, b, r, i, "total"
+	}'
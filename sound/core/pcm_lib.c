@@ -1682,7 +1682,10 @@ static int wait_for_avail_min(struct snd_pcm_substream *substream,
 		}
 		set_current_state(TASK_INTERRUPTIBLE);
 		snd_pcm_stream_unlock_irq(substream);
-		tout = schedule_timeout(msecs_to_jiffies(10000));
+		if (runtime->no_period_wakeup)
+			tout = schedule_timeout(snd_pcm_period_jiffies(runtime));
+		else
+			tout = schedule_timeout(msecs_to_jiffies(10000));
 		snd_pcm_stream_lock_irq(substream);
 		switch (runtime->status->state) {
 		case SNDRV_PCM_STATE_SUSPENDED:
@@ -1703,7 +1706,13 @@ static int wait_for_avail_min(struct snd_pcm_substream *substream,
 			err = -EBADFD;
 			goto _endloop;
 		}
-		if (!tout) {
+		if (!tout && runtime->no_period_wakeup) {
+			/* no interrupt moves hw_ptr, so poll it */
+			if (snd_pcm_update_hw_ptr(substream) < 0) {
+				err = -EPIPE;
+				break;
+			}
+		} else if (!tout) {
 			snd_printd("%s write error (DMA or IRQ trouble?)\n",
 				   is_playback ? "playback" : "capture");
 			err = -EIO;
@@ -141,6 +141,13 @@ static int evm_aic3x_init(struct snd_soc_codec *codec)
 	return 0;
 }
 
+/* S/PDIF out through the McASP DIT, channel status set from user space */
+static int evm_dit_init(struct snd_soc_codec *codec)
+{
+	return davinci_mcasp_add_iec958_controls(codec,
+			&davinci_mcasp_dai[DAVINCI_MCASP_DIT_DAI]);
+}
+
 /* davinci-evm digital audio interface glue - connects codec <--> CPU */
 static struct snd_soc_dai_link evm_dai = {
 	.name = "TLV320AIC3X",
@@ -165,6 +172,7 @@ static struct snd_soc_dai_link dm6467_evm_dai[] = {
 		.stream_name = "spdif",
 		.cpu_dai = &davinci_mcasp_dai[DAVINCI_MCASP_DIT_DAI],
 		.codec_dai = &dit_stub_dai,
+		.init = evm_dit_init,
 		.ops = &evm_ops,
 	},
 };
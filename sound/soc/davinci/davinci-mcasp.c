@@ -22,6 +22,8 @@
 #include <linux/io.h>
 #include <linux/clk.h>
 
+#include <sound/asoundef.h>
+#include <sound/control.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -31,6 +33,18 @@
 #include "davinci-pcm.h"
 #include "davinci-mcasp.h"
 
+/*
+ * Digital loopback: the transmit serializers feed the receive serializers
+ * inside the McASP, and the receiver runs off the transmit bit clock and
+ * frame sync, so a full duplex stream plays back what it records without
+ * a codec in the path.  Serializers pair up 0->1, 2->3...; with
+ * loopback=2 the odd ones transmit instead.  For latency and xrun testing.
+ */
+static int loopback;
+module_param(loopback, int, 0644);
+MODULE_PARM_DESC(loopback, "digital loopback, 1 = even serializers "
+		 "transmit, 2 = odd serializers transmit, 0 = off");
+
 /*
  * McASP register definitions
  */
@@ -83,6 +97,8 @@
 #define DAVINCI_MCASP_TXCLKCHK_REG	0xc8
 #define DAVINCI_MCASP_XEVTCTL_REG	0xcc
 
+/* DIT channel status and user data: 6 registers (192 bits) each */
+#define DAVINCI_MCASP_DIT_NUM_REGS	6
 /* Left(even TDM Slot) Channel Status Register File */
 #define DAVINCI_MCASP_DITCSRA_REG	0x100
 /* Right(odd TDM slot) Channel Status Register File */
@@ -290,6 +306,9 @@
 
 #define DAVINCI_MCASP_NUM_SERIALIZER	16
 
+/* Depth of the McASP read and write FIFOs, in 32-bit words */
+#define DAVINCI_MCASP_FIFO_WORDS	64
+
 static inline void mcasp_set_bits(void __iomem *reg, u32 val)
 {
 	__raw_writel(__raw_readl(reg) | val, reg);
@@ -567,11 +586,66 @@ static int davinci_config_channel_size(struct davinci_audio_dev *dev,
 	return 0;
 }
 
+/* Number of serializers set up for the direction of @stream */
+static int davinci_mcasp_num_ser(struct davinci_audio_dev *dev, int stream)
+{
+	u8 mode = (stream == SNDRV_PCM_STREAM_PLAYBACK) ? TX_MODE : RX_MODE;
+	int i, ser = 0;
+
+	for (i = 0; i < dev->num_serializer; i++)
+		if (dev->serial_dir[i] == mode)
+			ser++;
+	return ser;
+}
+
+/*
+ * Words the FIFO of @stream hands over per DMA event: txnumevt/rxnumevt
+ * words for each serializer in that direction, or one word for each
+ * when that would not fit in the FIFO.  Zero when the FIFO is not used.
+ */
+static u8 davinci_mcasp_fifo_words(struct davinci_audio_dev *dev, int stream)
+{
+	u8 numevt;
+	int ser;
+
+	if (stream == SNDRV_PCM_STREAM_PLAYBACK)
+		numevt = dev->txnumevt;
+	else
+		numevt = dev->rxnumevt;
+	if (!numevt)
+		return 0;
+
+	ser = davinci_mcasp_num_ser(dev, stream);
+	if (numevt * ser > DAVINCI_MCASP_FIFO_WORDS)
+		numevt = 1;
+	return numevt * ser;
+}
+
+/*
+ * Words one DMA event of @stream has to move.  All serializers of a
+ * direction share the DMA port and raise a single event per time slot, so
+ * even without the FIFO a multi-serializer stream takes one word for each
+ * of them per event.  The words arrive serializer by serializer within a
+ * slot, which makes ALSA channel n slot n / ser on serializer n % ser: a
+ * 16 channel stream over 4 serializers in 4 slot TDM needs one EDMA channel.
+ */
+static u8 davinci_mcasp_dma_words(struct davinci_audio_dev *dev, int stream)
+{
+	u8 fifo_words = davinci_mcasp_fifo_words(dev, stream);
+	int ser;
+
+	if (fifo_words)
+		return fifo_words;
+	ser = davinci_mcasp_num_ser(dev, stream);
+	return ser > 1 ? ser : 0;
+}
+
 static void davinci_hw_common_param(struct davinci_audio_dev *dev, int stream)
 {
 	int i;
 	u8 tx_ser = 0;
 	u8 rx_ser = 0;
+	u8 fifo_words = davinci_mcasp_fifo_words(dev, stream);
 
 	/* Default configuration */
 	mcasp_set_bits(dev->base + DAVINCI_MCASP_PWREMUMGT_REG, MCASP_SOFT);
@@ -603,25 +677,19 @@ static void davinci_hw_common_param(struct davinci_audio_dev *dev, int stream)
 		}
 	}
 
-	if (dev->txnumevt && stream == SNDRV_PCM_STREAM_PLAYBACK) {
-		if (dev->txnumevt * tx_ser > 64)
-			dev->txnumevt = 1;
-
+	if (fifo_words && stream == SNDRV_PCM_STREAM_PLAYBACK) {
 		mcasp_mod_bits(dev->base + DAVINCI_MCASP_WFIFOCTL, tx_ser,
 								NUMDMA_MASK);
 		mcasp_mod_bits(dev->base + DAVINCI_MCASP_WFIFOCTL,
-				((dev->txnumevt * tx_ser) << 8), NUMEVT_MASK);
+				(fifo_words << 8), NUMEVT_MASK);
 		mcasp_set_bits(dev->base + DAVINCI_MCASP_WFIFOCTL, FIFO_ENABLE);
 	}
 
-	if (dev->rxnumevt && stream == SNDRV_PCM_STREAM_CAPTURE) {
-		if (dev->rxnumevt * rx_ser > 64)
-			dev->rxnumevt = 1;
-
+	if (fifo_words && stream == SNDRV_PCM_STREAM_CAPTURE) {
 		mcasp_mod_bits(dev->base + DAVINCI_MCASP_RFIFOCTL, rx_ser,
 								NUMDMA_MASK);
 		mcasp_mod_bits(dev->base + DAVINCI_MCASP_RFIFOCTL,
-				((dev->rxnumevt * rx_ser) << 8), NUMEVT_MASK);
+				(fifo_words << 8), NUMEVT_MASK);
 		mcasp_set_bits(dev->base + DAVINCI_MCASP_RFIFOCTL, FIFO_ENABLE);
 	}
 }
@@ -672,9 +740,71 @@ static void davinci_hw_param(struct davinci_audio_dev *dev, int stream)
 	}
 }
 
+/* IEC 60958-3 sampling frequency code of @rate */
+static u8 davinci_mcasp_dit_fs(unsigned int rate)
+{
+	switch (rate) {
+	case 22050:
+		return IEC958_AES3_CON_FS_22050;
+	case 24000:
+		return IEC958_AES3_CON_FS_24000;
+	case 32000:
+		return IEC958_AES3_CON_FS_32000;
+	case 44100:
+		return IEC958_AES3_CON_FS_44100;
+	case 48000:
+		return IEC958_AES3_CON_FS_48000;
+	case 88200:
+		return IEC958_AES3_CON_FS_88200;
+	case 96000:
+		return IEC958_AES3_CON_FS_96000;
+	default:
+		return IEC958_AES3_CON_FS_NOTID;
+	}
+}
+
+/*
+ * Program the DIT channel status RAM of both subframes from the
+ * iec958_status bytes, LSB first, with the consumer format sampling
+ * frequency and word length of the stream filled in. A non-audio
+ * (IEC 61937) stream keeps the word length the user set.
+ */
+static void davinci_mcasp_dit_cs(struct davinci_audio_dev *dev)
+{
+	u8 cs[DAVINCI_MCASP_DIT_NUM_REGS * 4];
+	unsigned long flags;
+	u32 val;
+	int i;
+
+	spin_lock_irqsave(&dev->iec958_lock, flags);
+	memcpy(cs, dev->iec958_status.status, sizeof(cs));
+	spin_unlock_irqrestore(&dev->iec958_lock, flags);
+
+	if (!(cs[0] & IEC958_AES0_PROFESSIONAL)) {
+		cs[3] = (cs[3] & ~IEC958_AES3_CON_FS) |
+			davinci_mcasp_dit_fs(dev->dit_rate);
+		if (!(cs[0] & IEC958_AES0_NONAUDIO))
+			cs[4] = (cs[4] & ~(IEC958_AES4_CON_WORDLEN |
+					   IEC958_AES4_CON_MAX_WORDLEN_24)) |
+				IEC958_AES4_CON_WORDLEN_20_16;
+	}
+
+	for (i = 0; i < DAVINCI_MCASP_DIT_NUM_REGS; i++) {
+		val = cs[4 * i] | (cs[4 * i + 1] << 8) |
+		      (cs[4 * i + 2] << 16) | (cs[4 * i + 3] << 24);
+		mcasp_set_reg(dev->base + DAVINCI_MCASP_DITCSRA_REG + (i << 2),
+			      val);
+		mcasp_set_reg(dev->base + DAVINCI_MCASP_DITCSRB_REG + (i << 2),
+			      val);
+	}
+}
+
 /* S/PDIF */
-static void davinci_hw_dit_param(struct davinci_audio_dev *dev)
+static void davinci_hw_dit_param(struct davinci_audio_dev *dev,
+				 unsigned int rate)
 {
+	int i;
+
 	/* Set the PDIR for Serialiser as output */
 	mcasp_set_bits(dev->base + DAVINCI_MCASP_PDIR_REG, AFSX);
 
@@ -702,10 +832,32 @@ static void davinci_hw_dit_param(struct davinci_audio_dev *dev)
 	/* Only 44100 and 48000 are valid, both have the same setting */
 	mcasp_set_bits(dev->base + DAVINCI_MCASP_AHCLKXCTL_REG, AHCLKXDIV(3));
 
+	/* channel status for this rate, no user data */
+	dev->dit_rate = rate;
+	davinci_mcasp_dit_cs(dev);
+	for (i = 0; i < DAVINCI_MCASP_DIT_NUM_REGS; i++) {
+		mcasp_set_reg(dev->base + DAVINCI_MCASP_DITUDRA_REG + (i << 2),
+			      0);
+		mcasp_set_reg(dev->base + DAVINCI_MCASP_DITUDRB_REG + (i << 2),
+			      0);
+	}
+
 	/* Enable the DIT */
 	mcasp_set_bits(dev->base + DAVINCI_MCASP_TXDITCTL_REG, DITEN);
 }
 
+/*
+ * DIT slots are 32 bits carrying a 24 bit sample left aligned, the
+ * McASP adds preamble, V, U, C and P bits and does the biphase coding.
+ * 16 bit samples (PCM or IEC 61937 bursts) go out in bits 23-8.
+ */
+static void davinci_config_dit_size(struct davinci_audio_dev *dev)
+{
+	mcasp_mod_bits(dev->base + DAVINCI_MCASP_TXFMT_REG,
+		       TXSSZ(0x0F) | TXROT(6), TXSSZ(0x0F) | TXROT(7));
+	mcasp_set_reg(dev->base + DAVINCI_MCASP_TXMASK_REG, 0x0000ffff);
+}
+
 static int davinci_mcasp_hw_params(struct snd_pcm_substream *substream,
 					struct snd_pcm_hw_params *params,
 					struct snd_soc_dai *cpu_dai)
@@ -714,19 +866,32 @@ static int davinci_mcasp_hw_params(struct snd_pcm_substream *substream,
 	struct davinci_pcm_dma_params *dma_params =
 					&dev->dma_params[substream->stream];
 	int word_length;
+	int ser;
 	u8 fifo_level;
 
+	/* every serializer carries all tdm_slots of the frame */
+	ser = davinci_mcasp_num_ser(dev, substream->stream);
+	if (dev->op_mode != DAVINCI_MCASP_DIT_MODE && ser > 1 &&
+	    params_channels(params) != ser * dev->tdm_slots) {
+		printk(KERN_WARNING "davinci-mcasp: %d serializers need %d "
+				"channels\n", ser, ser * dev->tdm_slots);
+		return -EINVAL;
+	}
+
 	davinci_hw_common_param(dev, substream->stream);
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		fifo_level = dev->txnumevt;
-	else
-		fifo_level = dev->rxnumevt;
+	fifo_level = davinci_mcasp_fifo_words(dev, substream->stream);
 
 	if (dev->op_mode == DAVINCI_MCASP_DIT_MODE)
-		davinci_hw_dit_param(dev);
+		davinci_hw_dit_param(dev, params_rate(params));
 	else
 		davinci_hw_param(dev, substream->stream);
 
+	if (loopback && dev->op_mode != DAVINCI_MCASP_DIT_MODE)
+		mcasp_set_reg(dev->base + DAVINCI_MCASP_LBCTL_REG, LBEN |
+			      (loopback == 2 ? LBORD : 0) | LBGENMODE(1));
+	else
+		mcasp_set_reg(dev->base + DAVINCI_MCASP_LBCTL_REG, 0);
+
 	switch (params_format(params)) {
 	case SNDRV_PCM_FORMAT_S8:
 		dma_params->data_type = 1;
@@ -753,8 +918,11 @@ static int davinci_mcasp_hw_params(struct snd_pcm_substream *substream,
 	else
 		dma_params->acnt = dma_params->data_type;
 
-	dma_params->fifo_level = fifo_level;
-	davinci_config_channel_size(dev, word_length);
+	dma_params->fifo_level = davinci_mcasp_dma_words(dev, substream->stream);
+	if (dev->op_mode == DAVINCI_MCASP_DIT_MODE)
+		davinci_config_dit_size(dev);
+	else
+		davinci_config_channel_size(dev, word_length);
 
 	return 0;
 }
@@ -799,6 +967,102 @@ static int davinci_mcasp_trigger(struct snd_pcm_substream *substream,
 	return ret;
 }
 
+static int davinci_mcasp_iec958_info(struct snd_kcontrol *kcontrol,
+				     struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_IEC958;
+	uinfo->count = 1;
+	return 0;
+}
+
+static int davinci_mcasp_iec958_get(struct snd_kcontrol *kcontrol,
+				    struct snd_ctl_elem_value *ucontrol)
+{
+	struct davinci_audio_dev *dev = snd_kcontrol_chip(kcontrol);
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->iec958_lock, flags);
+	memcpy(ucontrol->value.iec958.status, dev->iec958_status.status,
+	       sizeof(dev->iec958_status.status));
+	spin_unlock_irqrestore(&dev->iec958_lock, flags);
+	return 0;
+}
+
+/*
+ * Setting IEC958_AES0_NONAUDIO here is what turns S16_LE stereo into an
+ * IEC 61937 (AC-3, DTS, ...) passthrough stream for the receiver
+ */
+static int davinci_mcasp_iec958_put(struct snd_kcontrol *kcontrol,
+				    struct snd_ctl_elem_value *ucontrol)
+{
+	struct davinci_audio_dev *dev = snd_kcontrol_chip(kcontrol);
+	unsigned long flags;
+	int changed;
+
+	spin_lock_irqsave(&dev->iec958_lock, flags);
+	changed = memcmp(dev->iec958_status.status,
+			 ucontrol->value.iec958.status,
+			 sizeof(dev->iec958_status.status)) != 0;
+	memcpy(dev->iec958_status.status, ucontrol->value.iec958.status,
+	       sizeof(dev->iec958_status.status));
+	spin_unlock_irqrestore(&dev->iec958_lock, flags);
+
+	/* a running stream picks the change up at the next block */
+	if (changed && dev->clk_active && dev->dit_rate)
+		davinci_mcasp_dit_cs(dev);
+	return changed;
+}
+
+static int davinci_mcasp_iec958_mask_get(struct snd_kcontrol *kcontrol,
+					 struct snd_ctl_elem_value *ucontrol)
+{
+	memset(ucontrol->value.iec958.status, 0xff,
+	       DAVINCI_MCASP_DIT_NUM_REGS * 4);
+	return 0;
+}
+
+static struct snd_kcontrol_new davinci_mcasp_iec958_controls[] = {
+	{
+		.iface	= SNDRV_CTL_ELEM_IFACE_PCM,
+		.name	= SNDRV_CTL_NAME_IEC958("", PLAYBACK, DEFAULT),
+		.info	= davinci_mcasp_iec958_info,
+		.get	= davinci_mcasp_iec958_get,
+		.put	= davinci_mcasp_iec958_put,
+	},
+	{
+		.access	= SNDRV_CTL_ELEM_ACCESS_READ,
+		.iface	= SNDRV_CTL_ELEM_IFACE_PCM,
+		.name	= SNDRV_CTL_NAME_IEC958("", PLAYBACK, MASK),
+		.info	= davinci_mcasp_iec958_info,
+		.get	= davinci_mcasp_iec958_mask_get,
+	},
+};
+
+/**
+ * davinci_mcasp_add_iec958_controls - S/PDIF channel status controls
+ * @codec: codec of the card the DIT link belongs to
+ * @dai: the McASP DIT DAI
+ *
+ * For the dai_link init of a machine driver. Adds the standard
+ * "IEC958 Playback Default" and "IEC958 Playback Mask" controls, the
+ * ones alsa-lib's iec958 plugin and AC-3/DTS passthrough players set.
+ */
+int davinci_mcasp_add_iec958_controls(struct snd_soc_codec *codec,
+				      struct snd_soc_dai *dai)
+{
+	struct davinci_audio_dev *dev = dai->private_data;
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(davinci_mcasp_iec958_controls); i++) {
+		ret = snd_ctl_add(codec->card,
+			snd_ctl_new1(&davinci_mcasp_iec958_controls[i], dev));
+		if (ret < 0)
+			return ret;
+	}
+	return 0;
+}
+EXPORT_SYMBOL_GPL(davinci_mcasp_add_iec958_controls);
+
 static struct snd_soc_dai_ops davinci_mcasp_dai_ops = {
 	.trigger	= davinci_mcasp_trigger,
 	.hw_params	= davinci_mcasp_hw_params,
@@ -812,7 +1076,7 @@ struct snd_soc_dai davinci_mcasp_dai[] = {
 		.id 		= 0,
 		.playback	= {
 			.channels_min	= 2,
-			.channels_max 	= 2,
+			.channels_max 	= 384,
 			.rates 		= DAVINCI_MCASP_RATES,
 			.formats 	= SNDRV_PCM_FMTBIT_S8 |
 						SNDRV_PCM_FMTBIT_S16_LE |
@@ -820,7 +1084,7 @@ struct snd_soc_dai davinci_mcasp_dai[] = {
 		},
 		.capture 	= {
 			.channels_min 	= 2,
-			.channels_max 	= 2,
+			.channels_max 	= 384,
 			.rates 		= DAVINCI_MCASP_RATES,
 			.formats	= SNDRV_PCM_FMTBIT_S8 |
 						SNDRV_PCM_FMTBIT_S16_LE |
@@ -891,8 +1155,17 @@ static int davinci_mcasp_probe(struct platform_device *pdev)
 	dev->txnumevt = pdata->txnumevt;
 	dev->rxnumevt = pdata->rxnumevt;
 
+	/* consumer PCM, copying permitted, until the user says otherwise */
+	spin_lock_init(&dev->iec958_lock);
+	dev->iec958_status.status[0] = IEC958_AES0_CON_NOT_COPYRIGHT;
+	dev->iec958_status.status[1] = IEC958_AES1_CON_PCM_CODER;
+
 	dma_data = &dev->dma_params[SNDRV_PCM_STREAM_PLAYBACK];
 	dma_data->eventq_no = pdata->eventq_no;
+	/* known before hw_params, so the PCM can constrain periods to it */
+	dma_data->fifo_level = davinci_mcasp_dma_words(dev,
+			SNDRV_PCM_STREAM_PLAYBACK);
+	dma_data->sram_size = pdata->sram_size_playback;
 	dma_data->dma_addr = (dma_addr_t) (pdata->tx_dma_offset +
 							io_v2p(dev->base));
 
@@ -907,6 +1180,9 @@ static int davinci_mcasp_probe(struct platform_device *pdev)
 
 	dma_data = &dev->dma_params[SNDRV_PCM_STREAM_CAPTURE];
 	dma_data->eventq_no = pdata->eventq_no;
+	dma_data->fifo_level = davinci_mcasp_dma_words(dev,
+			SNDRV_PCM_STREAM_CAPTURE);
+	dma_data->sram_size = pdata->sram_size_capture;
 	dma_data->dma_addr = (dma_addr_t)(pdata->rx_dma_offset +
 							io_v2p(dev->base));
 
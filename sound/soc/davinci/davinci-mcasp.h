@@ -19,6 +19,8 @@
 #define DAVINCI_MCASP_H
 
 #include <linux/io.h>
+#include <linux/spinlock.h>
+#include <sound/asound.h>
 #include <mach/asp.h>
 #include "davinci-pcm.h"
 
@@ -56,6 +58,15 @@ struct davinci_audio_dev {
 	/* McASP FIFO related */
 	u8	txnumevt;
 	u8	rxnumevt;
+
+	/* DIT channel status, the rate of the running stream patched in */
+	spinlock_t		iec958_lock;
+	struct snd_aes_iec958	iec958_status;
+	unsigned int		dit_rate;	/* 0: DIT not set up */
 };
 
+struct snd_soc_codec;
+int davinci_mcasp_add_iec958_controls(struct snd_soc_codec *codec,
+				      struct snd_soc_dai *dai);
+
 #endif	/* DAVINCI_MCASP_H */
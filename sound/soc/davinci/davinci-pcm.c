@@ -16,6 +16,11 @@
 #include <linux/slab.h>
 #include <linux/dma-mapping.h>
 #include <linux/kernel.h>
+#include <linux/pm_qos_params.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/kthread.h>
+#include <linux/vmalloc.h>
 
 #include <sound/core.h>
 #include <sound/pcm.h>
@@ -46,10 +51,21 @@ static void print_buf_info(int slot, char *name)
 }
 #endif
 
+/*
+ * The ondemand governor sees little CPU load while EDMA streams, and at the
+ * lowest OPP the period interrupts and the application refilling the
+ * buffer can't keep up.  A configured stream holds this floor.
+ */
+static int cpufreq_min_khz = 300000;
+module_param(cpufreq_min_khz, int, 0644);
+MODULE_PARM_DESC(cpufreq_min_khz, "lowest CPU frequency in kHz while a stream "
+		 "is set up, 0 = off");
+
 static struct snd_pcm_hardware pcm_hardware_playback = {
 	.info = (SNDRV_PCM_INFO_INTERLEAVED | SNDRV_PCM_INFO_BLOCK_TRANSFER |
 		 SNDRV_PCM_INFO_MMAP | SNDRV_PCM_INFO_MMAP_VALID |
-		 SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME),
+		 SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME |
+		 SNDRV_PCM_INFO_NO_PERIOD_WAKEUP),
 	.formats = (SNDRV_PCM_FMTBIT_S16_LE),
 	.rates = (SNDRV_PCM_RATE_8000 | SNDRV_PCM_RATE_16000 |
 		  SNDRV_PCM_RATE_22050 | SNDRV_PCM_RATE_32000 |
@@ -59,11 +75,11 @@ static struct snd_pcm_hardware pcm_hardware_playback = {
 	.rate_min = 8000,
 	.rate_max = 96000,
 	.channels_min = 2,
-	.channels_max = 2,
+	.channels_max = 384,
 	.buffer_bytes_max = 128 * 1024,
 	.period_bytes_min = 32,
-	.period_bytes_max = 8 * 1024,
-	.periods_min = 16,
+	.period_bytes_max = 64 * 1024,
+	.periods_min = 2,
 	.periods_max = 255,
 	.fifo_size = 0,
 };
@@ -71,7 +87,7 @@ static struct snd_pcm_hardware pcm_hardware_playback = {
 static struct snd_pcm_hardware pcm_hardware_capture = {
 	.info = (SNDRV_PCM_INFO_INTERLEAVED | SNDRV_PCM_INFO_BLOCK_TRANSFER |
 		 SNDRV_PCM_INFO_MMAP | SNDRV_PCM_INFO_MMAP_VALID |
-		 SNDRV_PCM_INFO_PAUSE),
+		 SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_NO_PERIOD_WAKEUP),
 	.formats = (SNDRV_PCM_FMTBIT_S16_LE),
 	.rates = (SNDRV_PCM_RATE_8000 | SNDRV_PCM_RATE_16000 |
 		  SNDRV_PCM_RATE_22050 | SNDRV_PCM_RATE_32000 |
@@ -81,11 +97,11 @@ static struct snd_pcm_hardware pcm_hardware_capture = {
 	.rate_min = 8000,
 	.rate_max = 96000,
 	.channels_min = 2,
-	.channels_max = 2,
+	.channels_max = 384,
 	.buffer_bytes_max = 128 * 1024,
 	.period_bytes_min = 32,
-	.period_bytes_max = 8 * 1024,
-	.periods_min = 16,
+	.period_bytes_max = 64 * 1024,
+	.periods_min = 2,
 	.periods_max = 255,
 	.fifo_size = 0,
 };
@@ -125,6 +141,11 @@ static struct snd_pcm_hardware pcm_hardware_capture = {
  *
  * When capture is started:
  * 	asp_params started
+ *
+ * The iram buffer holds one period (ping and pong halves) and is taken
+ * from SRAM in hw_params, within the stream's sram_size budget, so a
+ * full duplex stream can have both directions in SRAM.  Periods larger
+ * than the budget, or SRAM already in use, mean DMA straight to SDRAM.
  */
 struct davinci_runtime_data {
 	spinlock_t lock;
@@ -137,10 +158,341 @@ struct davinci_runtime_data {
 	int ram_link2;
 	struct edmacc_param asp_params;
 	struct edmacc_param ram_params;
+	struct snd_dma_buffer iram_dma;	/* SRAM ping/pong, if area set */
+	char qos_name[16];	/* PM_QOS_CPU_FREQ_MIN requirement, if set */
+#ifdef CONFIG_SND_DAVINCI_SOC_STRESS
+	int xrun_logged;	/* this xrun is in the stress log already */
+#endif
+};
+
+#ifdef CONFIG_SND_DAVINCI_SOC_STRESS
+/*
+ * Latency and xrun statistics for full duplex testing, normally with the
+ * McASP in digital loopback and an application copying capture straight
+ * to playback.  In davinci-pcm/ in debugfs:
+ *
+ *  latency	frames between a sample reaching the capture buffer and it
+ *		being played out: capture frames not yet read plus playback
+ *		frames queued, sampled at every capture period.
+ *  xruns	xrun counts and the last few xruns with the stream pointers
+ *		and the EDMA positions at the time.
+ *  load_kb	non-zero runs a thread copying that many KiB over and over,
+ *		to load the memory bus while streaming.
+ *
+ * Writing to latency or xruns clears them.
+ */
+#define DAVINCI_PCM_XRUN_LOG	16
+
+struct davinci_pcm_xrun {
+	struct timespec ts;
+	int stream;
+	snd_pcm_uframes_t hw_ptr;
+	snd_pcm_uframes_t appl_ptr;
+	dma_addr_t asp_src, asp_dst;
+	dma_addr_t ram_src, ram_dst;	/* ping/pong only */
+};
+
+static DEFINE_SPINLOCK(stress_lock);
+static DEFINE_MUTEX(stress_load_mutex);
+
+static struct {
+	struct snd_pcm_substream *running[2];
+	unsigned long xruns[2];
+	unsigned int xrun_next;
+	struct davinci_pcm_xrun xrun[DAVINCI_PCM_XRUN_LOG];
+	unsigned long lat_samples;
+	snd_pcm_sframes_t lat_last, lat_min, lat_max;
+	u64 lat_sum;
+	struct dentry *dir;
+	struct task_struct *load;
+	void *load_buf[2];
+	u32 load_kb;
+} stress;
+
+static void davinci_pcm_stress_trigger(struct snd_pcm_substream *substream,
+				       int cmd)
+{
+	unsigned long flags;
+	int stream = substream->stream;
+
+	spin_lock_irqsave(&stress_lock, flags);
+	switch (cmd) {
+	case SNDRV_PCM_TRIGGER_START:
+	case SNDRV_PCM_TRIGGER_RESUME:
+	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
+		stress.running[stream] = substream;
+		break;
+	default:
+		if (stress.running[stream] == substream)
+			stress.running[stream] = NULL;
+		break;
+	}
+	spin_unlock_irqrestore(&stress_lock, flags);
+}
+
+static void davinci_pcm_stress_xrun(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct davinci_runtime_data *prtd = runtime->private_data;
+	struct davinci_pcm_xrun x = { .stream = substream->stream };
+	unsigned long flags;
+
+	edma_get_position(prtd->asp_channel, &x.asp_src, &x.asp_dst);
+	if (prtd->ram_channel >= 0)
+		edma_get_position(prtd->ram_channel, &x.ram_src, &x.ram_dst);
+	x.hw_ptr = runtime->status->hw_ptr;
+	x.appl_ptr = runtime->control->appl_ptr;
+	getnstimeofday(&x.ts);
+
+	spin_lock_irqsave(&stress_lock, flags);
+	stress.xruns[x.stream]++;
+	stress.xrun[stress.xrun_next++ % DAVINCI_PCM_XRUN_LOG] = x;
+	spin_unlock_irqrestore(&stress_lock, flags);
+
+	if (printk_ratelimit())
+		printk(KERN_WARNING "davinci_pcm: %s xrun, hw_ptr %lu "
+		       "appl_ptr %lu asp %08x/%08x\n",
+		       x.stream == SNDRV_PCM_STREAM_PLAYBACK ?
+		       "playback" : "capture", x.hw_ptr, x.appl_ptr,
+		       x.asp_src, x.asp_dst);
+}
+
+static void davinci_pcm_stress_latency(struct snd_pcm_substream *capture)
+{
+	struct snd_pcm_substream *playback;
+	snd_pcm_sframes_t lat;
+	unsigned long flags;
+
+	spin_lock_irqsave(&stress_lock, flags);
+	playback = stress.running[SNDRV_PCM_STREAM_PLAYBACK];
+	if (playback && playback->pcm->card == capture->pcm->card) {
+		lat = snd_pcm_playback_hw_avail(playback->runtime) +
+		      snd_pcm_capture_avail(capture->runtime);
+		if (!stress.lat_samples++ || lat < stress.lat_min)
+			stress.lat_min = lat;
+		if (lat > stress.lat_max)
+			stress.lat_max = lat;
+		stress.lat_last = lat;
+		stress.lat_sum += lat;
+	}
+	spin_unlock_irqrestore(&stress_lock, flags);
+}
+
+/* Called from the DMA interrupt after the period has been reported */
+static void davinci_pcm_stress_period(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct davinci_runtime_data *prtd = runtime->private_data;
+
+	if (runtime->status->state == SNDRV_PCM_STATE_XRUN) {
+		/* the other half of ping/pong may still complete */
+		if (!prtd->xrun_logged)
+			davinci_pcm_stress_xrun(substream);
+		prtd->xrun_logged = 1;
+		return;
+	}
+	prtd->xrun_logged = 0;
+
+	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE)
+		davinci_pcm_stress_latency(substream);
+}
+
+static int davinci_pcm_latency_show(struct seq_file *m, void *v)
+{
+	unsigned long samples;
+	snd_pcm_sframes_t last, lat_min, lat_max;
+	u64 avg;
+
+	spin_lock_irq(&stress_lock);
+	samples = stress.lat_samples;
+	last = stress.lat_last;
+	lat_min = stress.lat_min;
+	lat_max = stress.lat_max;
+	avg = stress.lat_sum;
+	spin_unlock_irq(&stress_lock);
+
+	if (samples)
+		do_div(avg, samples);
+	seq_printf(m, "samples %lu\nlast %ld\nmin %ld\navg %llu\nmax %ld\n",
+		   samples, last, lat_min, (unsigned long long)avg, lat_max);
+	return 0;
+}
+
+static int davinci_pcm_xruns_show(struct seq_file *m, void *v)
+{
+	struct davinci_pcm_xrun log[DAVINCI_PCM_XRUN_LOG];
+	unsigned long xruns[2];
+	unsigned int next, n, i;
+
+	spin_lock_irq(&stress_lock);
+	memcpy(log, stress.xrun, sizeof(log));
+	memcpy(xruns, stress.xruns, sizeof(xruns));
+	next = stress.xrun_next;
+	spin_unlock_irq(&stress_lock);
+
+	seq_printf(m, "playback %lu\ncapture %lu\n", xruns[0], xruns[1]);
+	seq_printf(m, "# time stream hw_ptr appl_ptr asp_src asp_dst "
+		   "ram_src ram_dst\n");
+	n = min_t(unsigned int, next, DAVINCI_PCM_XRUN_LOG);
+	for (i = next - n; i != next; i++) {
+		struct davinci_pcm_xrun *x = &log[i % DAVINCI_PCM_XRUN_LOG];
+
+		seq_printf(m, "%lu.%06lu %c %lu %lu %08x %08x %08x %08x\n",
+			   (unsigned long)x->ts.tv_sec, x->ts.tv_nsec / 1000,
+			   x->stream == SNDRV_PCM_STREAM_PLAYBACK ? 'p' : 'c',
+			   x->hw_ptr, x->appl_ptr, x->asp_src, x->asp_dst,
+			   x->ram_src, x->ram_dst);
+	}
+	return 0;
+}
+
+static int davinci_pcm_stress_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, inode->i_private, NULL);
+}
+
+static ssize_t davinci_pcm_stress_write(struct file *file,
+		const char __user *buf, size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+
+	spin_lock_irq(&stress_lock);
+	if (m->op->show == davinci_pcm_latency_show) {
+		stress.lat_samples = 0;
+		stress.lat_last = stress.lat_min = stress.lat_max = 0;
+		stress.lat_sum = 0;
+	} else {
+		memset(stress.xruns, 0, sizeof(stress.xruns));
+		stress.xrun_next = 0;
+	}
+	spin_unlock_irq(&stress_lock);
+
+	return count;
+}
+
+static const struct file_operations davinci_pcm_stress_fops = {
+	.owner		= THIS_MODULE,
+	.open		= davinci_pcm_stress_open,
+	.read		= seq_read,
+	.write		= davinci_pcm_stress_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
 };
 
+static int davinci_pcm_load_thread(void *data)
+{
+	size_t len = (size_t)data;
+
+	while (!kthread_should_stop()) {
+		memcpy(stress.load_buf[1], stress.load_buf[0], len);
+		memcpy(stress.load_buf[0], stress.load_buf[1], len);
+		cond_resched();
+	}
+	return 0;
+}
+
+static void davinci_pcm_load_stop(void)
+{
+	if (stress.load) {
+		kthread_stop(stress.load);
+		stress.load = NULL;
+	}
+	vfree(stress.load_buf[0]);
+	vfree(stress.load_buf[1]);
+	stress.load_buf[0] = stress.load_buf[1] = NULL;
+	stress.load_kb = 0;
+}
+
+static int davinci_pcm_load_get(void *data, u64 *val)
+{
+	*val = stress.load_kb;
+	return 0;
+}
+
+static int davinci_pcm_load_set(void *data, u64 val)
+{
+	size_t len = val * 1024;
+	int ret = 0;
+
+	if (val > 16 * 1024)
+		return -EINVAL;
+
+	mutex_lock(&stress_load_mutex);
+	davinci_pcm_load_stop();
+	if (!val)
+		goto out;
+
+	stress.load_buf[0] = vmalloc(len);
+	stress.load_buf[1] = vmalloc(len);
+	if (!stress.load_buf[0] || !stress.load_buf[1]) {
+		ret = -ENOMEM;
+		goto fail;
+	}
+	memset(stress.load_buf[0], 0x5a, len);
+
+	stress.load = kthread_run(davinci_pcm_load_thread, (void *)len,
+				  "pcm-load");
+	if (IS_ERR(stress.load)) {
+		ret = PTR_ERR(stress.load);
+		stress.load = NULL;
+		goto fail;
+	}
+	stress.load_kb = val;
+	goto out;
+fail:
+	davinci_pcm_load_stop();
+out:
+	mutex_unlock(&stress_load_mutex);
+	return ret;
+}
+DEFINE_SIMPLE_ATTRIBUTE(davinci_pcm_load_fops, davinci_pcm_load_get,
+			davinci_pcm_load_set, "%llu\n");
+
+static void davinci_pcm_stress_init(void)
+{
+	stress.dir = debugfs_create_dir("davinci-pcm", NULL);
+	if (IS_ERR_OR_NULL(stress.dir)) {
+		stress.dir = NULL;
+		return;
+	}
+	debugfs_create_file("latency", 0644, stress.dir,
+			    davinci_pcm_latency_show, &davinci_pcm_stress_fops);
+	debugfs_create_file("xruns", 0644, stress.dir,
+			    davinci_pcm_xruns_show, &davinci_pcm_stress_fops);
+	debugfs_create_file("load_kb", 0644, stress.dir, NULL,
+			    &davinci_pcm_load_fops);
+}
+
+static void davinci_pcm_stress_exit(void)
+{
+	debugfs_remove_recursive(stress.dir);
+	mutex_lock(&stress_load_mutex);
+	davinci_pcm_load_stop();
+	mutex_unlock(&stress_load_mutex);
+}
+#else
+static inline void davinci_pcm_stress_trigger(
+		struct snd_pcm_substream *substream, int cmd)
+{
+}
+
+static inline void davinci_pcm_stress_period(
+		struct snd_pcm_substream *substream)
+{
+}
+
+static inline void davinci_pcm_stress_init(void)
+{
+}
+
+static inline void davinci_pcm_stress_exit(void)
+{
+}
+#endif
+
 /*
- * Not used with ping/pong
+ * Not used with ping/pong.  Without period wakeups the set covers the
+ * whole buffer and links to itself, so the CPU never has to reload it.
  */
 static void davinci_pcm_enqueue_dma(struct snd_pcm_substream *substream)
 {
@@ -157,6 +509,7 @@ static void davinci_pcm_enqueue_dma(struct snd_pcm_substream *substream)
 	unsigned short acnt;
 	unsigned int count;
 	unsigned int fifo_level;
+	unsigned int burst, periods = 1;
 
 	period_size = snd_pcm_lib_period_bytes(substream);
 	dma_offset = prtd->period * period_size;
@@ -166,17 +519,21 @@ static void davinci_pcm_enqueue_dma(struct snd_pcm_substream *substream)
 	pr_debug("davinci_pcm: audio_set_dma_params_play channel = %d "
 		"dma_ptr = %x period_size=%x\n", link, dma_pos, period_size);
 
+	if (runtime->no_period_wakeup) {
+		dma_pos = runtime->dma_addr;
+		periods = runtime->periods;
+	}
+
 	data_type = prtd->params->data_type;
-	count = period_size / data_type;
-	if (fifo_level)
-		count /= fifo_level;
+	burst = fifo_level ? fifo_level : 1;
+	count = period_size / (data_type * burst);
 
 	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
 		src = dma_pos;
 		dst = prtd->params->dma_addr;
 		src_bidx = data_type;
 		dst_bidx = 0;
-		src_cidx = data_type * fifo_level;
+		src_cidx = data_type * burst;
 		dst_cidx = 0;
 	} else {
 		src = prtd->params->dma_addr;
@@ -184,7 +541,7 @@ static void davinci_pcm_enqueue_dma(struct snd_pcm_substream *substream)
 		src_bidx = 0;
 		dst_bidx = data_type;
 		src_cidx = 0;
-		dst_cidx = data_type * fifo_level;
+		dst_cidx = data_type * burst;
 	}
 
 	acnt = prtd->params->acnt;
@@ -195,10 +552,11 @@ static void davinci_pcm_enqueue_dma(struct snd_pcm_substream *substream)
 	edma_set_dest_index(link, dst_bidx, dst_cidx);
 
 	if (!fifo_level)
-		edma_set_transfer_params(link, acnt, count, 1, 0, ASYNC);
+		edma_set_transfer_params(link, acnt, count, periods, count,
+							ASYNC);
 	else
-		edma_set_transfer_params(link, acnt, fifo_level, count,
-							fifo_level, ABSYNC);
+		edma_set_transfer_params(link, acnt, fifo_level,
+				count * periods, fifo_level, ABSYNC);
 
 	prtd->period++;
 	if (unlikely(prtd->period >= runtime->periods))
@@ -224,40 +582,10 @@ static void davinci_pcm_dma_irq(unsigned link, u16 ch_status, void *data)
 			spin_unlock(&prtd->lock);
 		}
 		snd_pcm_period_elapsed(substream);
+		davinci_pcm_stress_period(substream);
 	}
 }
 
-static int allocate_sram(struct snd_pcm_substream *substream, unsigned size,
-		struct snd_pcm_hardware *ppcm)
-{
-	struct snd_dma_buffer *buf = &substream->dma_buffer;
-	struct snd_dma_buffer *iram_dma = NULL;
-	dma_addr_t iram_phys = 0;
-	void *iram_virt = NULL;
-
-	if (buf->private_data || !size)
-		return 0;
-
-	ppcm->period_bytes_max = size;
-	iram_virt = sram_alloc(size, &iram_phys);
-	if (!iram_virt)
-		goto exit1;
-	iram_dma = kzalloc(sizeof(*iram_dma), GFP_KERNEL);
-	if (!iram_dma)
-		goto exit2;
-	iram_dma->area = iram_virt;
-	iram_dma->addr = iram_phys;
-	memset(iram_dma->area, 0, size);
-	iram_dma->bytes = size;
-	buf->private_data = iram_dma;
-	return 0;
-exit2:
-	if (iram_virt)
-		sram_free(iram_virt, size);
-exit1:
-	return -ENOMEM;
-}
-
 /*
  * Only used with ping/pong.
  * This is called after runtime->dma_addr, period_bytes and data_type are valid
@@ -267,8 +595,7 @@ static int ping_pong_dma_setup(struct snd_pcm_substream *substream)
 	unsigned short ram_src_cidx, ram_dst_cidx;
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct davinci_runtime_data *prtd = runtime->private_data;
-	struct snd_dma_buffer *iram_dma =
-		(struct snd_dma_buffer *)substream->dma_buffer.private_data;
+	struct snd_dma_buffer *iram_dma = &prtd->iram_dma;
 	struct davinci_pcm_dma_params *params = prtd->params;
 	unsigned int data_type = params->data_type;
 	unsigned int acnt = params->acnt;
@@ -453,10 +780,10 @@ static int request_ping_pong(struct snd_pcm_substream *substream,
 		prtd->asp_link[1]);
 	return 0;
 exit4:
-	edma_free_channel(prtd->asp_link[1]);
+	edma_free_slot(prtd->asp_link[1]);
 	prtd->asp_link[1] = -1;
 exit3:
-	edma_free_channel(prtd->ram_link);
+	edma_free_slot(prtd->ram_link);
 	prtd->ram_link = -1;
 exit2:
 	edma_free_channel(prtd->ram_channel);
@@ -465,9 +792,91 @@ exit1:
 	return link;
 }
 
+/*
+ * Issue transfer completion IRQ when the channel completes a transfer,
+ * then always reload from the same slot (by a kind of loopback link).
+ * The completion IRQ handler will update the reload slot with a new
+ * buffer.
+ *
+ * REVISIT save p_ram here after setting up everything except
+ * the buffer and its length (ccnt) ... use it as a template
+ * so davinci_pcm_enqueue_dma() takes less time in IRQ.
+ */
+static void davinci_pcm_link_sdram(struct davinci_runtime_data *prtd)
+{
+	int link = prtd->asp_link[0];
+
+	edma_read_slot(link, &prtd->asp_params);
+	prtd->asp_params.opt &= ~(TCCMODE | TCCHEN | EDMA_TCC(0x3f));
+	prtd->asp_params.opt |= TCINTEN |
+		EDMA_TCC(EDMA_CHAN_SLOT(prtd->asp_channel));
+	prtd->asp_params.link_bcntrld = EDMA_CHAN_SLOT(link) << 5;
+	edma_write_slot(link, &prtd->asp_params);
+}
+
+/*
+ * Move a stream to SRAM ping/pong when its period fits the SRAM budget
+ * of the stream and the SRAM is free; otherwise it keeps DMAing to and
+ * from SDRAM.
+ */
+static void davinci_pcm_sram_request(struct snd_pcm_substream *substream,
+		unsigned period_bytes)
+{
+	struct davinci_runtime_data *prtd = substream->runtime->private_data;
+	struct snd_dma_buffer *iram_dma = &prtd->iram_dma;
+
+	if (period_bytes > prtd->params->sram_size)
+		return;
+
+	iram_dma->area = sram_alloc_pool(SRAM_POOL_AUDIO, period_bytes,
+					 &iram_dma->addr);
+	if (!iram_dma->area) {
+		pr_debug("davinci_pcm: no %u bytes of SRAM, using SDRAM\n",
+				period_bytes);
+		return;
+	}
+	iram_dma->bytes = period_bytes;
+	memset(iram_dma->area, 0, period_bytes);
+
+	if (request_ping_pong(substream, prtd, iram_dma) < 0) {
+		printk(KERN_WARNING "%s: dma channel allocation failed,"
+				"not using sram\n", __func__);
+		sram_free(iram_dma->area, iram_dma->bytes);
+		iram_dma->area = NULL;
+	}
+}
+
+static void davinci_pcm_sram_free(struct davinci_runtime_data *prtd)
+{
+	struct snd_dma_buffer *iram_dma = &prtd->iram_dma;
+
+	if (!iram_dma->area)
+		return;
+
+	edma_stop(prtd->ram_channel);
+	edma_stop(prtd->asp_channel);
+	edma_unlink(prtd->asp_link[1]);
+	edma_unlink(prtd->ram_link);
+
+	edma_free_slot(prtd->asp_link[1]);
+	edma_free_slot(prtd->ram_link);
+	if (prtd->ram_link2 >= 0)
+		edma_free_slot(prtd->ram_link2);
+	edma_free_channel(prtd->ram_channel);
+	prtd->asp_link[1] = -1;
+	prtd->ram_link = -1;
+	prtd->ram_link2 = -1;
+	prtd->ram_channel = -1;
+
+	sram_free(iram_dma->area, iram_dma->bytes);
+	iram_dma->area = NULL;
+
+	edma_unlink(prtd->asp_link[0]);
+	davinci_pcm_link_sdram(prtd);
+}
+
 static int davinci_pcm_dma_request(struct snd_pcm_substream *substream)
 {
-	struct snd_dma_buffer *iram_dma;
 	struct davinci_runtime_data *prtd = substream->runtime->private_data;
 	struct davinci_pcm_dma_params *params = prtd->params;
 	int link;
@@ -481,34 +890,16 @@ static int davinci_pcm_dma_request(struct snd_pcm_substream *substream)
 	if (link < 0)
 		goto exit1;
 
+	/* period updates must not wait behind other EDMA completions */
+	edma_set_callback_flags(prtd->asp_channel, EDMA_CB_PRIORITY);
+
 	/* Request asp link channels */
 	link = prtd->asp_link[0] = edma_alloc_slot(
 			EDMA_CTLR(prtd->asp_channel), EDMA_SLOT_ANY);
 	if (link < 0)
 		goto exit2;
 
-	iram_dma = (struct snd_dma_buffer *)substream->dma_buffer.private_data;
-	if (iram_dma) {
-		if (request_ping_pong(substream, prtd, iram_dma) == 0)
-			return 0;
-		printk(KERN_WARNING "%s: dma channel allocation failed,"
-				"not using sram\n", __func__);
-	}
-
-	/* Issue transfer completion IRQ when the channel completes a
-	 * transfer, then always reload from the same slot (by a kind
-	 * of loopback link).  The completion IRQ handler will update
-	 * the reload slot with a new buffer.
-	 *
-	 * REVISIT save p_ram here after setting up everything except
-	 * the buffer and its length (ccnt) ... use it as a template
-	 * so davinci_pcm_enqueue_dma() takes less time in IRQ.
-	 */
-	edma_read_slot(link, &prtd->asp_params);
-	prtd->asp_params.opt |= TCINTEN |
-		EDMA_TCC(EDMA_CHAN_SLOT(prtd->asp_channel));
-	prtd->asp_params.link_bcntrld = EDMA_CHAN_SLOT(link) << 5;
-	edma_write_slot(link, &prtd->asp_params);
+	davinci_pcm_link_sdram(prtd);
 	return 0;
 exit2:
 	edma_free_channel(prtd->asp_channel);
@@ -539,21 +930,42 @@ static int davinci_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 		ret = -EINVAL;
 		break;
 	}
+	if (!ret)
+		davinci_pcm_stress_trigger(substream, cmd);
 
 	spin_unlock(&prtd->lock);
 
 	return ret;
 }
 
+/* The period interrupt is only needed to wake up the application */
+static void davinci_pcm_period_irq(int slot, bool enable)
+{
+	struct edmacc_param p;
+
+	edma_read_slot(slot, &p);
+	if (enable)
+		p.opt |= TCINTEN;
+	else
+		p.opt &= ~TCINTEN;
+	edma_write_slot(slot, &p);
+}
+
 static int davinci_pcm_prepare(struct snd_pcm_substream *substream)
 {
-	struct davinci_runtime_data *prtd = substream->runtime->private_data;
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct davinci_runtime_data *prtd = runtime->private_data;
+	struct davinci_pcm_dma_params *params = prtd->params;
 
 	if (prtd->ram_channel >= 0) {
 		int ret = ping_pong_dma_setup(substream);
 		if (ret < 0)
 			return ret;
 
+		/* the pong interrupt only reports the period */
+		davinci_pcm_period_irq(prtd->asp_link[1],
+				!runtime->no_period_wakeup);
+
 		edma_write_slot(prtd->ram_channel, &prtd->ram_params);
 		edma_write_slot(prtd->asp_channel, &prtd->asp_params);
 
@@ -571,13 +983,21 @@ static int davinci_pcm_prepare(struct snd_pcm_substream *substream)
 		edma_start(prtd->asp_channel);
 		return 0;
 	}
+	/* a whole-buffer set must fit the 16 bit EDMA counts */
+	if (runtime->no_period_wakeup && params->fifo_level &&
+	    snd_pcm_lib_buffer_bytes(substream) /
+	    (params->data_type * params->fifo_level) > 0xffff)
+		return -EINVAL;
+
+	davinci_pcm_period_irq(prtd->asp_link[0], !runtime->no_period_wakeup);
 	prtd->period = 0;
 	davinci_pcm_enqueue_dma(substream);
 
 	/* Copy self-linked parameter RAM entry into master channel */
 	edma_read_slot(prtd->asp_link[0], &prtd->asp_params);
 	edma_write_slot(prtd->asp_channel, &prtd->asp_params);
-	davinci_pcm_enqueue_dma(substream);
+	if (!runtime->no_period_wakeup)
+		davinci_pcm_enqueue_dma(substream);
 	edma_start(prtd->asp_channel);
 
 	return 0;
@@ -657,7 +1077,6 @@ static int davinci_pcm_open(struct snd_pcm_substream *substream)
 
 	ppcm = (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) ?
 			&pcm_hardware_playback : &pcm_hardware_capture;
-	allocate_sram(substream, params->sram_size, ppcm);
 	snd_soc_set_runtime_hwparams(substream, ppcm);
 	/* ensure that buffer size is a multiple of period size */
 	ret = snd_pcm_hw_constraint_integer(runtime,
@@ -665,6 +1084,22 @@ static int davinci_pcm_open(struct snd_pcm_substream *substream)
 	if (ret < 0)
 		return ret;
 
+	/*
+	 * With a FIFO or several serializers, every DMA event moves
+	 * fifo_level words, so a period (or each ping/pong half of one) must
+	 * be a whole number of events whatever the sample width.
+	 */
+	if (params->fifo_level) {
+		unsigned step = params->fifo_level * sizeof(u32);
+
+		if (params->sram_size)
+			step *= 2;
+		ret = snd_pcm_hw_constraint_step(runtime, 0,
+				SNDRV_PCM_HW_PARAM_PERIOD_BYTES, step);
+		if (ret < 0)
+			return ret;
+	}
+
 	prtd = kzalloc(sizeof(struct davinci_runtime_data), GFP_KERNEL);
 	if (prtd == NULL)
 		return -ENOMEM;
@@ -693,6 +1128,10 @@ static int davinci_pcm_close(struct snd_pcm_substream *substream)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 	struct davinci_runtime_data *prtd = runtime->private_data;
 
+	davinci_pcm_stress_trigger(substream, SNDRV_PCM_TRIGGER_STOP);
+	davinci_pcm_qos_remove(prtd);
+	davinci_pcm_sram_free(prtd);
+
 	if (prtd->ram_channel >= 0)
 		edma_stop(prtd->ram_channel);
 	if (prtd->asp_channel >= 0)
@@ -722,15 +1161,52 @@ static int davinci_pcm_close(struct snd_pcm_substream *substream)
 	return 0;
 }
 
+static void davinci_pcm_qos_add(struct snd_pcm_substream *substream)
+{
+	struct davinci_runtime_data *prtd = substream->runtime->private_data;
+
+	if (prtd->qos_name[0] || cpufreq_min_khz <= 0)
+		return;
+
+	snprintf(prtd->qos_name, sizeof(prtd->qos_name), "pcmC%dD%d%c",
+		 substream->pcm->card->number, substream->pcm->device,
+		 substream->stream == SNDRV_PCM_STREAM_PLAYBACK ? 'p' : 'c');
+	if (pm_qos_add_requirement(PM_QOS_CPU_FREQ_MIN, prtd->qos_name,
+				   cpufreq_min_khz))
+		prtd->qos_name[0] = '\0';
+}
+
+static void davinci_pcm_qos_remove(struct davinci_runtime_data *prtd)
+{
+	if (!prtd->qos_name[0])
+		return;
+
+	pm_qos_remove_requirement(PM_QOS_CPU_FREQ_MIN, prtd->qos_name);
+	prtd->qos_name[0] = '\0';
+}
+
 static int davinci_pcm_hw_params(struct snd_pcm_substream *substream,
 				 struct snd_pcm_hw_params *hw_params)
 {
-	return snd_pcm_lib_malloc_pages(substream,
+	struct davinci_runtime_data *prtd = substream->runtime->private_data;
+	int ret;
+
+	ret = snd_pcm_lib_malloc_pages(substream,
 					params_buffer_bytes(hw_params));
+	if (ret < 0)
+		return ret;
+
+	/* hw_params may be called again with another period size */
+	davinci_pcm_sram_free(prtd);
+	davinci_pcm_sram_request(substream, params_period_bytes(hw_params));
+	davinci_pcm_qos_add(substream);
+	return ret;
 }
 
 static int davinci_pcm_hw_free(struct snd_pcm_substream *substream)
 {
+	davinci_pcm_qos_remove(substream->runtime->private_data);
+	davinci_pcm_sram_free(substream->runtime->private_data);
 	return snd_pcm_lib_free_pages(substream);
 }
 
@@ -786,7 +1262,6 @@ static void davinci_pcm_free(struct snd_pcm *pcm)
 	int stream;
 
 	for (stream = 0; stream < 2; stream++) {
-		struct snd_dma_buffer *iram_dma;
 		substream = pcm->streams[stream].substream;
 		if (!substream)
 			continue;
@@ -798,11 +1273,6 @@ static void davinci_pcm_free(struct snd_pcm *pcm)
 		dma_free_writecombine(pcm->card->dev, buf->bytes,
 				      buf->area, buf->addr);
 		buf->area = NULL;
-		iram_dma = (struct snd_dma_buffer *)buf->private_data;
-		if (iram_dma) {
-			sram_free(iram_dma->area, iram_dma->bytes);
-			kfree(iram_dma);
-		}
 	}
 }
 
@@ -847,12 +1317,18 @@ EXPORT_SYMBOL_GPL(davinci_soc_platform);
 
 static int __init davinci_soc_platform_init(void)
 {
-	return snd_soc_register_platform(&davinci_soc_platform);
+	int ret;
+
+	ret = snd_soc_register_platform(&davinci_soc_platform);
+	if (!ret)
+		davinci_pcm_stress_init();
+	return ret;
 }
 module_init(davinci_soc_platform_init);
 
 static void __exit davinci_soc_platform_exit(void)
 {
+	davinci_pcm_stress_exit();
 	snd_soc_unregister_platform(&davinci_soc_platform);
 }
 module_exit(davinci_soc_platform_exit);
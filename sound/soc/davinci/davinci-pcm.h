@@ -24,7 +24,7 @@ struct davinci_pcm_dma_params {
 	enum dma_event_q eventq_no;	/* event queue number */
 	unsigned char data_type;	/* xfer data type */
 	unsigned char convert_mono_stereo;
-	unsigned int fifo_level;
+	unsigned int fifo_level;	/* words per DMA event, 0 for one */
 };
 
 